@@ -43,6 +43,11 @@ typedef struct {
 #if CLS_BINARY_IMAGE_RUNTIME_NODE_RECORD_NAME
   char name[CLS_BINARY_IMAGE_RUNTIME_NODE_NAME_SIZE];
 #endif
+  // Set when the node is claimed for a newly loaded image, until its details are filled in on the
+  // binary image queue. Until then, only baseAddress and vmaddrSlide are valid, see
+  // FIRCLSBinaryImageSafeResolveNode.
+  bool detailsPending;
+  intptr_t vmaddrSlide;
 } FIRCLSBinaryImageRuntimeNode;
 
 typedef struct {
@@ -59,9 +64,35 @@ typedef struct {
   const char* path;
 } FIRCLSBinaryImageReadOnlyContext;
 
+#if CLS_COMPACT_UNWINDING_SUPPORTED
+// The address range of the __TEXT segment of a loaded image, and the index of its node.
+typedef struct {
+  uintptr_t start;
+  uintptr_t end;
+  uint32_t nodeIndex;
+} FIRCLSBinaryImageAddressRange;
+
+// The address ranges of all loaded images, sorted by start address, so that crash-time lookups
+// can binary search them instead of scanning every node.
+typedef struct {
+  uint32_t count;
+  FIRCLSBinaryImageAddressRange ranges[CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT];
+} FIRCLSBinaryImageAddressIndex;
+#endif
+
 typedef struct {
   FIRCLSFile file;
   FIRCLSBinaryImageRuntimeNode nodes[CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT];
+  // The number of nodes with detailsPending set.
+  _Atomic(uint32_t) volatile pendingNodeCount;
+#if CLS_COMPACT_UNWINDING_SUPPORTED
+  // The index is double-buffered: the binary image queue rebuilds the inactive copy and then
+  // publishes it. The generation changes with each publication, so a reader that sees the same
+  // generation before and after a lookup knows the copy it read wasn't being rebuilt meanwhile.
+  FIRCLSBinaryImageAddressIndex addressIndexes[2];
+  _Atomic(uint32_t) volatile activeAddressIndex;
+  _Atomic(uint32_t) volatile addressIndexGeneration;
+#endif
 } FIRCLSBinaryImageReadWriteContext;
 
 void FIRCLSBinaryImageInit(FIRCLSBinaryImageReadOnlyContext* roContext,
@@ -73,6 +104,10 @@ bool FIRCLSBinaryImageSafeFindImageForAddress(uintptr_t address,
 bool FIRCLSBinaryImageSafeHasUnwindInfo(FIRCLSBinaryImageRuntimeNode* image);
 #endif
 
+// Fills in the details of a copy of a node whose image hasn't been parsed yet, by parsing it now.
+// Does nothing for other nodes. Only reads the image's memory, so it can be used at crash time.
+void FIRCLSBinaryImageSafeResolveNode(FIRCLSBinaryImageRuntimeNode* node);
+
 bool FIRCLSBinaryImageFindImageForUUID(const char* uuidString,
                                        FIRCLSBinaryImageDetails* imageDetails);
 
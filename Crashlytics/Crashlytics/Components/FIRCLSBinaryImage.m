@@ -47,7 +47,15 @@ static void FIRCLSBinaryImageChanged(bool added,
                                      intptr_t vmaddr_slide);
 static bool FIRCLSBinaryImageFillInImageDetails(FIRCLSBinaryImageDetails* details);
 
+static uint32_t FIRCLSBinaryImageClaimNode(const struct mach_header* mh, intptr_t vmaddr_slide);
 static void FIRCLSBinaryImageStoreNode(bool added, FIRCLSBinaryImageDetails imageDetails);
+static void FIRCLSBinaryImageStoreClaimedNode(uint32_t nodeIndex,
+                                              FIRCLSBinaryImageDetails imageDetails);
+#if CLS_COMPACT_UNWINDING_SUPPORTED
+static void FIRCLSBinaryImageUpdateAddressIndex(bool added,
+                                                uint32_t nodeIndex,
+                                                const FIRCLSBinaryImageRuntimeNode* node);
+#endif
 static void FIRCLSBinaryImageRecordSlice(bool added, const FIRCLSBinaryImageDetails imageDetails);
 
 #pragma mark - Core API
@@ -107,6 +115,63 @@ static bool FIRCLSBinaryImageOpenIfNeeded(bool* needsClosing) {
 }
 
 #if CLS_COMPACT_UNWINDING_SUPPORTED
+static bool FIRCLSBinaryImageNodeContainsAddress(const FIRCLSBinaryImageRuntimeNode* node,
+                                                 uintptr_t address) {
+  return (address >= (uintptr_t)node->baseAddress) &&
+         (address < (uintptr_t)node->baseAddress + node->size);
+}
+
+// Binary searches the published address index, setting `found` to whether the address is in a
+// loaded image. Returns false if the index changed during the lookup too many times to trust the
+// result.
+static bool FIRCLSBinaryImageSafeSearchAddressIndex(FIRCLSBinaryImageReadWriteContext* context,
+                                                    uintptr_t address,
+                                                    FIRCLSBinaryImageRuntimeNode* image,
+                                                    bool* found) {
+  // A crash suspends the other threads, so the index changes at most once during a crash-time
+  // lookup. Retrying a few times covers lookups made while the process keeps running.
+  for (uint32_t attempt = 0; attempt < 4; ++attempt) {
+    uint32_t generation = atomic_load(&context->addressIndexGeneration);
+    const FIRCLSBinaryImageAddressIndex* index =
+        &context->addressIndexes[atomic_load(&context->activeAddressIndex) & 1];
+
+    uint32_t count = index->count;
+    if (count > CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT) {
+      count = CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT;
+    }
+
+    // Find the last range that starts at or before the address.
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high) {
+      uint32_t middle = low + (high - low) / 2;
+      if (index->ranges[middle].start <= address) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+
+    *found = false;
+    if (low > 0) {
+      const FIRCLSBinaryImageAddressRange* range = &index->ranges[low - 1];
+      if (address < range->end && range->nodeIndex < CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT) {
+        FIRCLSBinaryImageRuntimeNode node = context->nodes[range->nodeIndex];
+        if (FIRCLSBinaryImageNodeContainsAddress(&node, address)) {
+          *image = node;  // copy the image
+          *found = true;
+        }
+      }
+    }
+
+    if (atomic_load(&context->addressIndexGeneration) == generation) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 bool FIRCLSBinaryImageSafeFindImageForAddress(uintptr_t address,
                                               FIRCLSBinaryImageRuntimeNode* image) {
   if (!FIRCLSContextIsInitialized()) {
@@ -127,6 +192,17 @@ bool FIRCLSBinaryImageSafeFindImageForAddress(uintptr_t address,
     return false;
   }
 
+  bool found = false;
+  if (FIRCLSBinaryImageSafeSearchAddressIndex(&_firclsContext.writable->binaryImage, address,
+                                              image, &found)) {
+    // Images that haven't been parsed yet aren't in the index.
+    if (found || atomic_load(&_firclsContext.writable->binaryImage.pendingNodeCount) == 0) {
+      return found;
+    }
+  }
+
+  // The index kept changing during the lookup, or the address could be in an image that hasn't
+  // been parsed yet, so fall back to scanning the nodes themselves.
   for (uint32_t i = 0; i < CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT; ++i) {
     FIRCLSBinaryImageRuntimeNode* node = &nodes[i];
     if (!FIRCLSIsValidPointer(node)) {
@@ -135,9 +211,11 @@ bool FIRCLSBinaryImageSafeFindImageForAddress(uintptr_t address,
       continue;
     }
 
-    if ((address >= (uintptr_t)node->baseAddress) &&
-        (address < (uintptr_t)node->baseAddress + node->size)) {
-      *image = *node;  // copy the image
+    FIRCLSBinaryImageRuntimeNode candidate = *node;
+    FIRCLSBinaryImageSafeResolveNode(&candidate);
+
+    if (FIRCLSBinaryImageNodeContainsAddress(&candidate, address)) {
+      *image = candidate;
       return true;
     }
   }
@@ -150,6 +228,26 @@ bool FIRCLSBinaryImageSafeHasUnwindInfo(FIRCLSBinaryImageRuntimeNode* image) {
 }
 #endif
 
+void FIRCLSBinaryImageSafeResolveNode(FIRCLSBinaryImageRuntimeNode* node) {
+  if (!FIRCLSIsValidPointer(node) || !node->detailsPending) {
+    return;
+  }
+
+  if (!FIRCLSIsValidPointer(node->baseAddress)) {
+    return;
+  }
+
+  FIRCLSBinaryImageDetails imageDetails;
+  memset(&imageDetails, 0, sizeof(FIRCLSBinaryImageDetails));
+
+  imageDetails.slice = FIRCLSMachOSliceWithHeader(node->baseAddress);
+  imageDetails.vmaddr_slide = node->vmaddrSlide;
+  FIRCLSBinaryImageFillInImageDetails(&imageDetails);
+
+  imageDetails.node.vmaddrSlide = node->vmaddrSlide;
+  *node = imageDetails.node;
+}
+
 bool FIRCLSBinaryImageFindImageForUUID(const char* uuidString,
                                        FIRCLSBinaryImageDetails* imageDetails) {
   if (!imageDetails || !uuidString) {
@@ -363,6 +461,28 @@ static void FIRCLSBinaryImageChanged(bool added,
                                      const struct mach_header* mh,
                                      intptr_t vmaddr_slide) {
   //    FIRCLSSDKLog("Binary image %s %p\n", added ? "loaded" : "unloaded", mh);
+  if (added) {
+    // dyld calls this for every image at launch, so only claim a node for the image here. Parsing
+    // its load commands is left to the binary image queue, and crash-time lookups parse the images
+    // that are still pending themselves.
+    uint32_t nodeIndex = FIRCLSBinaryImageClaimNode(mh, vmaddr_slide);
+
+    dispatch_async(FIRCLSGetBinaryImageQueue(), ^{
+      FIRCLSBinaryImageDetails imageDetails;
+      memset(&imageDetails, 0, sizeof(FIRCLSBinaryImageDetails));
+
+      imageDetails.slice = FIRCLSMachOSliceWithHeader((void*)mh);
+      imageDetails.vmaddr_slide = vmaddr_slide;
+      FIRCLSBinaryImageFillInImageDetails(&imageDetails);
+
+      FIRCLSBinaryImageStoreClaimedNode(nodeIndex, imageDetails);
+      FIRCLSBinaryImageRecordSlice(true, imageDetails);
+    });
+
+    return;
+  }
+
+  // The image is about to be unmapped, so it has to be parsed right away.
   FIRCLSBinaryImageDetails imageDetails;
   memset(&imageDetails, 0, sizeof(FIRCLSBinaryImageDetails));
 
@@ -379,6 +499,69 @@ static void FIRCLSBinaryImageChanged(bool added,
 }
 
 #pragma mark - In-Memory Storage
+// Returns the index of the node now holding the image's base address, or
+// CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT if there's no room left.
+static uint32_t FIRCLSBinaryImageClaimNode(const struct mach_header* mh, intptr_t vmaddr_slide) {
+  if (!_firclsContext.writable) {
+    FIRCLSSDKLog("Error: Writable context is NULL\n");
+    return CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT;
+  }
+
+  FIRCLSBinaryImageReadWriteContext* context = &_firclsContext.writable->binaryImage;
+
+  for (uint32_t i = 0; i < CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT; ++i) {
+    FIRCLSBinaryImageRuntimeNode* node = &context->nodes[i];
+    void* searchAddress = NULL;
+
+    if (node->baseAddress != NULL) {
+      continue;
+    }
+
+    // dyld can call back on several threads at once, so the claim has to be atomic.
+    if (atomic_compare_exchange_strong(&node->baseAddress, &searchAddress, (void*)mh)) {
+      node->vmaddrSlide = vmaddr_slide;
+      node->detailsPending = true;
+      atomic_fetch_add(&context->pendingNodeCount, 1);
+
+      return i;
+    }
+  }
+
+  FIRCLSSDKLog("Error: Unable to claim a node for %p\n", mh);
+
+  return CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT;
+}
+
+// Only called on the binary image queue.
+static void FIRCLSBinaryImageStoreClaimedNode(uint32_t nodeIndex,
+                                              FIRCLSBinaryImageDetails imageDetails) {
+  if (nodeIndex >= CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT) {
+    return;
+  }
+
+  FIRCLSBinaryImageReadWriteContext* context = &_firclsContext.writable->binaryImage;
+  FIRCLSBinaryImageRuntimeNode* node = &context->nodes[nodeIndex];
+
+  if (!node->detailsPending || node->baseAddress != imageDetails.node.baseAddress) {
+    FIRCLSSDKLog("Error: Claimed node %u no longer holds %p\n", nodeIndex,
+                 (void*)imageDetails.node.baseAddress);
+    return;
+  }
+
+  // Fill in everything else before clearing detailsPending, so a crash-time reader either
+  // resolves the node itself or sees all of its details.
+  imageDetails.node.vmaddrSlide = node->vmaddrSlide;
+  imageDetails.node.detailsPending = true;
+  *node = imageDetails.node;
+  __sync_synchronize();
+  node->detailsPending = false;
+  atomic_fetch_sub(&context->pendingNodeCount, 1);
+
+#if CLS_COMPACT_UNWINDING_SUPPORTED
+  FIRCLSBinaryImageUpdateAddressIndex(true, nodeIndex, node);
+#endif
+}
+
 static void FIRCLSBinaryImageStoreNode(bool added, FIRCLSBinaryImageDetails imageDetails) {
   // This function is mutating a structure that needs to be accessed at crash time. We
   // need to make sure the structure is always in as valid a state as possible.
@@ -428,6 +611,10 @@ static void FIRCLSBinaryImageStoreNode(bool added, FIRCLSBinaryImageDetails imag
       *node = imageDetails.node;
       success = true;
 
+#if CLS_COMPACT_UNWINDING_SUPPORTED
+      FIRCLSBinaryImageUpdateAddressIndex(added, i, node);
+#endif
+
       break;
     }
 
@@ -446,6 +633,46 @@ static void FIRCLSBinaryImageStoreNode(bool added, FIRCLSBinaryImageDetails imag
   }
 }
 
+#if CLS_COMPACT_UNWINDING_SUPPORTED
+// Only called on the binary image queue, so there is a single writer.
+static void FIRCLSBinaryImageUpdateAddressIndex(bool added,
+                                                uint32_t nodeIndex,
+                                                const FIRCLSBinaryImageRuntimeNode* node) {
+  FIRCLSBinaryImageReadWriteContext* context = &_firclsContext.writable->binaryImage;
+
+  uint32_t active = atomic_load(&context->activeAddressIndex) & 1;
+  const FIRCLSBinaryImageAddressIndex* current = &context->addressIndexes[active];
+  FIRCLSBinaryImageAddressIndex* next = &context->addressIndexes[active ^ 1];
+
+  // Copy the current ranges, dropping the node's previous one if it had any.
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < current->count; ++i) {
+    if (current->ranges[i].nodeIndex != nodeIndex) {
+      next->ranges[count++] = current->ranges[i];
+    }
+  }
+
+  if (added && node->size > 0) {
+    uintptr_t start = (uintptr_t)node->baseAddress;
+    uint32_t position = count;
+    while (position > 0 && next->ranges[position - 1].start > start) {
+      next->ranges[position] = next->ranges[position - 1];
+      --position;
+    }
+
+    next->ranges[position].start = start;
+    next->ranges[position].end = start + node->size;
+    next->ranges[position].nodeIndex = nodeIndex;
+    ++count;
+  }
+
+  next->count = count;
+
+  atomic_store(&context->activeAddressIndex, active ^ 1);
+  atomic_fetch_add(&context->addressIndexGeneration, 1);
+}
+#endif
+
 #pragma mark - On-Disk Storage
 static void FIRCLSBinaryImageRecordDetails(FIRCLSFile* file,
                                            const FIRCLSBinaryImageDetails imageDetails) {
@@ -53,6 +53,10 @@ typedef struct {
 #endif
   void* delegate;
   void* callbackDelegate;
+  // Write buffers for the crash files, in the read-write region. The signal and mach exception
+  // handlers share one, because only the first of them to run records the crash.
+  char* crashRecordBuffer;
+  char* exceptionRecordBuffer;
 
   FIRCLSBinaryImageReadOnlyContext binaryimage;
   FIRCLSExceptionReadOnlyContext exception;
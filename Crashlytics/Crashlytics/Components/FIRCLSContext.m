@@ -30,6 +30,8 @@
 #include "Crashlytics/Crashlytics/Components/FIRCLSProcess.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSDefines.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSFeatures.h"
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSProfiling.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSUtility.h"
 
 // The writable size is our handler stack plus whatever scratch we need.  We have to use this space
@@ -40,7 +42,7 @@
 // defined as 0 for tv/watch.
 #define CLS_MINIMUM_READWRITE_SIZE                                         \
   (CLS_SIGNAL_HANDLER_STACK_SIZE + CLS_MACH_EXCEPTION_HANDLER_STACK_SIZE + \
-   sizeof(FIRCLSReadWriteContext))
+   sizeof(FIRCLSReadWriteContext) + 2 * CLS_FILE_CRASH_RECORD_BUFFER_SIZE)
 
 // We need enough space here for the context, plus storage for strings.
 #define CLS_MINIMUM_READABLE_SIZE (sizeof(FIRCLSReadOnlyContext) + 4096 * 4)
@@ -100,6 +102,7 @@ FIRCLSContextInitData FIRCLSContextBuildInitData(FIRCLSInternalReport* report,
 bool FIRCLSContextInitialize(FIRCLSInternalReport* report,
                              FIRCLSSettings* settings,
                              FIRCLSFileManager* fileManager) {
+  FIRCLSProfileMark mark = FIRCLSProfilingStart();
   FIRCLSContextInitData initDataObj = FIRCLSContextBuildInitData(report, settings, fileManager);
   FIRCLSContextInitData* initData = &initDataObj;
 
@@ -175,6 +178,16 @@ bool FIRCLSContextInitialize(FIRCLSInternalReport* report,
     _firclsContext.readonly->logging.internalKVStorage.compactedPath =
         FIRCLSContextAppendToRoot(rootPath, FIRCLSReportInternalCompactedKVFile);
 
+#if CLS_USER_LOG_RING_ENABLED
+    _firclsContext.readonly->logging.logRingPath =
+        FIRCLSContextAppendToRoot(rootPath, FIRCLSReportLogRingFile);
+    if (FIRCLSUserLoggingRingOpen(&_firclsContext.readonly->logging.logRing,
+                                  _firclsContext.readonly->logging.logRingPath,
+                                  initData->maxLogSize)) {
+      _firclsContext.readonly->logging.logStorage.ring = &_firclsContext.readonly->logging.logRing;
+    }
+#endif
+
     FIRCLSUserLoggingInit(&_firclsContext.readonly->logging, &_firclsContext.writable->logging);
   });
 
@@ -182,8 +195,10 @@ bool FIRCLSContextInitialize(FIRCLSInternalReport* report,
     _firclsContext.readonly->binaryimage.path =
         FIRCLSContextAppendToRoot(rootPath, FIRCLSReportBinaryImageFile);
 
+    FIRCLSProfileMark binaryImageMark = FIRCLSProfilingStart();
     FIRCLSBinaryImageInit(&_firclsContext.readonly->binaryimage,
                           &_firclsContext.writable->binaryImage);
+    FIRCLSProfileRecordStartupPhase(FIRCLSStartupPhaseBinaryImageRegistration, binaryImageMark);
   });
 
   dispatch_group_async(group, queue, ^{
@@ -202,7 +217,15 @@ bool FIRCLSContextInitialize(FIRCLSInternalReport* report,
       _firclsContext.readonly->signal.path =
           FIRCLSContextAppendToRoot(rootPath, FIRCLSReportSignalFile);
 
+      FIRCLSProfileMark signalMark = FIRCLSProfilingStart();
       FIRCLSSignalInitialize(&_firclsContext.readonly->signal);
+      FIRCLSProfileRecordStartupPhase(FIRCLSStartupPhaseSignalHandlers, signalMark);
+    });
+#endif
+
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+    dispatch_group_async(group, queue, ^{
+      FIRCLSProcessStartUnwindHelpers();
     });
 #endif
 
@@ -211,7 +234,9 @@ bool FIRCLSContextInitialize(FIRCLSInternalReport* report,
       _firclsContext.readonly->machException.path =
           FIRCLSContextAppendToRoot(rootPath, FIRCLSReportMachExceptionFile);
 
+      FIRCLSProfileMark machExceptionMark = FIRCLSProfilingStart();
       FIRCLSMachExceptionInit(&_firclsContext.readonly->machException, initData->machExceptionMask);
+      FIRCLSProfileRecordStartupPhase(FIRCLSStartupPhaseMachExceptionHandler, machExceptionMark);
     });
 #endif
 
@@ -221,8 +246,10 @@ bool FIRCLSContextInitialize(FIRCLSInternalReport* report,
       _firclsContext.readonly->exception.maxCustomExceptions =
           initData->customExceptionsEnabled ? initData->maxCustomExceptions : 0;
 
+      FIRCLSProfileMark exceptionMark = FIRCLSProfilingStart();
       FIRCLSExceptionInitialize(&_firclsContext.readonly->exception,
                                 &_firclsContext.writable->exception, initData->delegate);
+      FIRCLSProfileRecordStartupPhase(FIRCLSStartupPhaseExceptionHandler, exceptionMark);
     });
   } else {
     FIRCLSSDKLog("Debugger present - not installing handlers\n");
@@ -256,6 +283,8 @@ bool FIRCLSContextInitialize(FIRCLSInternalReport* report,
     FIRCLSSDKLog("Error: Delayed initialization\n");
   }
 
+  FIRCLSProfileRecordStartupPhase(FIRCLSStartupPhaseContextInit, mark);
+
   return true;
 }
 
@@ -323,6 +352,12 @@ static void FIRCLSContextAllocate(FIRCLSContext* context) {
   context->writable = FIRCLSAllocatorSafeAllocate(context->allocator,
                                                   sizeof(FIRCLSReadWriteContext), CLS_READWRITE);
   memset(context->writable, 0, sizeof(FIRCLSReadWriteContext));
+
+  // Not cleared, so these pages aren't touched until a crash is recorded
+  context->readonly->crashRecordBuffer = FIRCLSAllocatorSafeAllocate(
+      context->allocator, CLS_FILE_CRASH_RECORD_BUFFER_SIZE, CLS_READWRITE);
+  context->readonly->exceptionRecordBuffer = FIRCLSAllocatorSafeAllocate(
+      context->allocator, CLS_FILE_CRASH_RECORD_BUFFER_SIZE, CLS_READWRITE);
 }
 
 void FIRCLSContextBaseDeinit(void) {
@@ -26,8 +26,53 @@
 #include <pthread.h>
 #include <sys/sysctl.h>
 
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+#include <errno.h>
+#include <mach/semaphore.h>
+#include <stdatomic.h>
+#include <string.h>
+#endif
+
 #define THREAD_NAME_BUFFER_SIZE (64)
 
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+// The thread handling the crash unwinds threads too, so this many more unwind at once.
+#define CLS_UNWIND_HELPER_THREAD_COUNT (3)
+// Processes with more threads than this are unwound serially.
+#define CLS_UNWIND_BUFFER_THREAD_COUNT (256)
+// Threads with deeper stacks than this are unwound again serially while being recorded.
+#define CLS_UNWIND_BUFFER_FRAME_COUNT (256)
+// How long to wait for each helper to finish, in case one of them got stuck.
+#define CLS_UNWIND_HELPER_TIMEOUT_SECONDS (2)
+
+// The result of unwinding one thread ahead of recording it.
+typedef struct {
+  FIRCLSThreadContext registers;
+  uintptr_t pcs[CLS_UNWIND_BUFFER_FRAME_COUNT];
+  uint32_t pcCount;
+  uint64_t repeatedPC;
+  uint32_t repeatedPCCount;
+  // False if the thread has to be unwound serially instead.
+  bool complete;
+} FIRCLSProcessUnwoundThread;
+
+typedef struct {
+  bool started;
+  thread_t helpers[CLS_UNWIND_HELPER_THREAD_COUNT];
+  uint32_t helperCount;
+  semaphore_t startSemaphore;
+  semaphore_t doneSemaphore;
+
+  FIRCLSProcess *_Atomic process;
+  _Atomic(uint32_t) nextThreadIndex;
+  FIRCLSProcessUnwoundThread *threads;
+} FIRCLSProcessUnwindHelpers;
+
+static FIRCLSProcessUnwindHelpers _firclsUnwindHelpers;
+
+static bool FIRCLSProcessIsUnwindHelperThread(thread_t thread);
+#endif
+
 #pragma mark Prototypes
 static bool FIRCLSProcessGetThreadName(FIRCLSProcess *process,
                                        thread_t thread,
@@ -126,6 +171,13 @@ bool FIRCLSProcessSuspendAllOtherThreads(FIRCLSProcess *process) {
       continue;
     }
 
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+    // The helpers have to keep running to unwind the other threads.
+    if (FIRCLSProcessIsUnwindHelperThread(thread)) {
+      continue;
+    }
+#endif
+
     // FIXME: workaround to get this building on watch, but we need to suspend/resume threads!
 #if CLS_CAN_SUSPEND_THREADS
     success = success && (thread_suspend(thread) == KERN_SUCCESS);
@@ -149,6 +201,12 @@ bool FIRCLSProcessResumeAllOtherThreads(FIRCLSProcess *process) {
       continue;
     }
 
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+    if (FIRCLSProcessIsUnwindHelperThread(thread)) {
+      continue;
+    }
+#endif
+
     // FIXME: workaround to get this building on watch, but we need to suspend/resume threads!
 #if CLS_CAN_SUSPEND_THREADS
     success = success && (thread_resume(thread) == KERN_SUCCESS);
@@ -473,12 +531,238 @@ static bool FIRCLSProcessRecordThread(FIRCLSProcess *process, thread_t thread, F
   return true;
 }
 
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+#pragma mark - Parallel Unwinding
+static bool FIRCLSProcessIsUnwindHelperThread(thread_t thread) {
+  if (!_firclsUnwindHelpers.started) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < _firclsUnwindHelpers.helperCount; ++i) {
+    if (MACH_PORT_INDEX(_firclsUnwindHelpers.helpers[i]) == MACH_PORT_INDEX(thread)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Unwinds a thread into its buffer, following the same rules as FIRCLSProcessRecordThread. The
+// logging level is left alone, since other threads are unwinding at the same time.
+static void FIRCLSProcessUnwindThread(FIRCLSProcess *process,
+                                      thread_t thread,
+                                      FIRCLSProcessUnwoundThread *unwound) {
+  FIRCLSUnwindContext unwindContext;
+
+  unwound->complete = false;
+  unwound->pcCount = 0;
+  unwound->repeatedPC = 0;
+  unwound->repeatedPCCount = 0;
+
+  if (!FIRCLSProcessGetThreadState(process, thread, &unwound->registers)) {
+    return;
+  }
+
+  if (!FIRCLSUnwindInit(&unwindContext, unwound->registers)) {
+    return;
+  }
+
+  while (FIRCLSUnwindNextFrame(&unwindContext)) {
+    const uintptr_t pc = FIRCLSUnwindGetPC(&unwindContext);
+    const uint32_t frameCount = FIRCLSUnwindGetFrameRepeatCount(&unwindContext);
+
+    if (unwound->repeatedPC == pc && unwound->repeatedPC != 0) {
+      unwound->repeatedPCCount = frameCount;
+      continue;
+    }
+
+    if (frameCount >= FIRCLSUnwindInfiniteRecursionCountThreshold && unwound->repeatedPC == 0) {
+      unwound->repeatedPC = pc;
+      continue;
+    }
+
+    if (unwound->pcCount == CLS_UNWIND_BUFFER_FRAME_COUNT) {
+      return;
+    }
+
+    unwound->pcs[unwound->pcCount++] = pc;
+  }
+
+  unwound->complete = true;
+}
+
+// Claims and unwinds threads of the process being recorded until none are left. Runs on the
+// thread handling the crash and on each helper.
+static void FIRCLSProcessUnwindPendingThreads(void) {
+  FIRCLSProcess *process = atomic_load(&_firclsUnwindHelpers.process);
+  if (!process) {
+    return;
+  }
+
+  const uint32_t threadCount = FIRCLSProcessGetThreadCount(process);
+  for (;;) {
+    uint32_t i = atomic_fetch_add(&_firclsUnwindHelpers.nextThreadIndex, 1);
+    if (i >= threadCount) {
+      return;
+    }
+
+    thread_t thread = FIRCLSProcessGetThread(process, i);
+    FIRCLSProcessUnwoundThread *unwound = &_firclsUnwindHelpers.threads[i];
+
+    // The thread handling the crash fakes its own state from its current frame, and the helpers
+    // are running, so those are left to be unwound serially.
+    if (FIRCLSProcessIsCurrentThread(process, thread) ||
+        FIRCLSProcessIsUnwindHelperThread(thread)) {
+      unwound->complete = false;
+      continue;
+    }
+
+    FIRCLSProcessUnwindThread(process, thread, unwound);
+  }
+}
+
+static void *FIRCLSProcessUnwindHelperMain(void *unused) {
+  pthread_setname_np("com.google.firebase.crashlytics.unwind");
+
+  for (;;) {
+    kern_return_t result = semaphore_wait(_firclsUnwindHelpers.startSemaphore);
+    if (result == KERN_ABORTED) {
+      continue;
+    }
+    if (result != KERN_SUCCESS) {
+      break;
+    }
+
+    FIRCLSProcessUnwindPendingThreads();
+
+    semaphore_signal(_firclsUnwindHelpers.doneSemaphore);
+  }
+
+  return NULL;
+}
+
+void FIRCLSProcessStartUnwindHelpers(void) {
+  if (_firclsUnwindHelpers.started) {
+    return;
+  }
+
+  vm_address_t buffer = 0;
+  if (vm_allocate(mach_task_self(), &buffer,
+                  sizeof(FIRCLSProcessUnwoundThread) * CLS_UNWIND_BUFFER_THREAD_COUNT,
+                  VM_FLAGS_ANYWHERE) != KERN_SUCCESS) {
+    FIRCLSSDKLog("Error: unable to allocate unwind buffers\n");
+    return;
+  }
+  _firclsUnwindHelpers.threads = (FIRCLSProcessUnwoundThread *)buffer;
+
+  if (semaphore_create(mach_task_self(), &_firclsUnwindHelpers.startSemaphore, SYNC_POLICY_FIFO,
+                       0) != KERN_SUCCESS ||
+      semaphore_create(mach_task_self(), &_firclsUnwindHelpers.doneSemaphore, SYNC_POLICY_FIFO,
+                       0) != KERN_SUCCESS) {
+    FIRCLSSDKLog("Error: unable to create unwind semaphores\n");
+    return;
+  }
+
+  for (uint32_t i = 0; i < CLS_UNWIND_HELPER_THREAD_COUNT; ++i) {
+    pthread_t helper;
+    if (pthread_create(&helper, NULL, FIRCLSProcessUnwindHelperMain, NULL) != 0) {
+      FIRCLSSDKLog("pthread_create %s\n", strerror(errno));
+      break;
+    }
+    pthread_detach(helper);
+
+    _firclsUnwindHelpers.helpers[_firclsUnwindHelpers.helperCount++] =
+        pthread_mach_thread_np(helper);
+  }
+
+  _firclsUnwindHelpers.started = true;
+}
+
+// Unwinds the threads of the process on the helpers and this thread. Returns false if the threads
+// have to be unwound serially while being recorded.
+static bool FIRCLSProcessUnwindAllThreads(FIRCLSProcess *process) {
+  if (!_firclsUnwindHelpers.started || _firclsUnwindHelpers.helperCount == 0) {
+    return false;
+  }
+
+  if (FIRCLSProcessGetThreadCount(process) > CLS_UNWIND_BUFFER_THREAD_COUNT) {
+    return false;
+  }
+
+  atomic_store(&_firclsUnwindHelpers.nextThreadIndex, 0);
+  atomic_store(&_firclsUnwindHelpers.process, process);
+
+  for (uint32_t i = 0; i < _firclsUnwindHelpers.helperCount; ++i) {
+    semaphore_signal(_firclsUnwindHelpers.startSemaphore);
+  }
+
+  FIRCLSProcessUnwindPendingThreads();
+
+  // If a helper doesn't finish, the buffers may still be written to, so don't use any of them.
+  const mach_timespec_t timeout = {.tv_sec = CLS_UNWIND_HELPER_TIMEOUT_SECONDS, .tv_nsec = 0};
+  bool finished = true;
+  for (uint32_t i = 0; i < _firclsUnwindHelpers.helperCount && finished; ++i) {
+    kern_return_t result;
+    do {
+      result = semaphore_timedwait(_firclsUnwindHelpers.doneSemaphore, timeout);
+    } while (result == KERN_ABORTED);
+
+    if (result != KERN_SUCCESS) {
+      FIRCLSSDKLogError("Timed out waiting for threads to be unwound\n");
+      finished = false;
+    }
+  }
+
+  atomic_store(&_firclsUnwindHelpers.process, NULL);
+
+  return finished;
+}
+
+// Records a thread from the result of FIRCLSProcessUnwindThread, in the same format as
+// FIRCLSProcessRecordThread.
+static void FIRCLSProcessRecordUnwoundThread(FIRCLSProcess *process,
+                                             thread_t thread,
+                                             const FIRCLSProcessUnwoundThread *unwound,
+                                             FIRCLSFile *file) {
+  FIRCLSFileWriteHashStart(file);
+
+  FIRCLSFileWriteHashKey(file, "registers");
+  FIRCLSFileWriteHashStart(file);
+  FIRCLSProcessRecordThreadRegisters(unwound->registers, file);
+  FIRCLSFileWriteHashEnd(file);
+
+  FIRCLSFileWriteHashKey(file, "stacktrace");
+  FIRCLSFileWriteArrayStart(file);
+  for (uint32_t i = 0; i < unwound->pcCount; ++i) {
+    FIRCLSFileWriteArrayEntryUint64(file, unwound->pcs[i]);
+  }
+  FIRCLSFileWriteArrayEnd(file);
+
+  if (FIRCLSProcessIsCrashedThread(process, thread)) {
+    FIRCLSFileWriteHashEntryBoolean(file, "crashed", true);
+  }
+
+  if (unwound->repeatedPC != 0) {
+    FIRCLSFileWriteHashEntryUint64(file, "repeated_pc", unwound->repeatedPC);
+    FIRCLSFileWriteHashEntryUint64(file, "repeat_count", unwound->repeatedPCCount);
+  }
+
+  FIRCLSFileWriteHashEnd(file);
+}
+#endif
+
 bool FIRCLSProcessRecordAllThreads(FIRCLSProcess *process, FIRCLSFile *file) {
   uint32_t threadCount;
   uint32_t i;
 
   threadCount = FIRCLSProcessGetThreadCount(process);
 
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+  // Unwinding dominates the time it takes to record the threads, so do that in parallel first,
+  // and then write the results out in order.
+  const bool unwound = FIRCLSProcessUnwindAllThreads(process);
+#endif
+
   FIRCLSFileWriteSectionStart(file, "threads");
 
   FIRCLSFileWriteArrayStart(file);
@@ -488,6 +772,13 @@ bool FIRCLSProcessRecordAllThreads(FIRCLSProcess *process, FIRCLSFile *file) {
 
     thread = FIRCLSProcessGetThread(process, i);
 
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+    if (unwound && _firclsUnwindHelpers.threads[i].complete) {
+      FIRCLSProcessRecordUnwoundThread(process, thread, &_firclsUnwindHelpers.threads[i], file);
+      continue;
+    }
+#endif
+
     FIRCLSSDKLogInfo("recording thread %d data\n", i);
     if (!FIRCLSProcessRecordThread(process, thread, file)) {
       FIRCLSSDKLogError("Failed to record thread state. Closing threads JSON to prevent malformed crash report.\n");
@@ -772,15 +1063,17 @@ static void FIRCLSProcessRecordCrashInfo(FIRCLSFile *file) {
   }
 
   for (uint32_t i = 0; i < CLS_BINARY_IMAGE_RUNTIME_NODE_COUNT; ++i) {
-    FIRCLSBinaryImageRuntimeNode *node = &nodes[i];
+    // Images loaded just before the crash may not have been parsed yet.
+    FIRCLSBinaryImageRuntimeNode node = nodes[i];
+    FIRCLSBinaryImageSafeResolveNode(&node);
 
-    if (!node->crashInfo) {
+    if (!node.crashInfo) {
       continue;
     }
 
     crash_info_t info;
 
-    if (!FIRCLSReadMemory((vm_address_t)node->crashInfo, &info, sizeof(crash_info_t))) {
+    if (!FIRCLSReadMemory((vm_address_t)node.crashInfo, &info, sizeof(crash_info_t))) {
       continue;
     }
 
@@ -798,7 +1091,7 @@ static void FIRCLSProcessRecordCrashInfo(FIRCLSFile *file) {
     }
 
 #if CLS_BINARY_IMAGE_RUNTIME_NODE_RECORD_NAME
-    FIRCLSSDKLogInfo("Found crash info for %s\n", node->name);
+    FIRCLSSDKLogInfo("Found crash info for %s\n", node.name);
 #endif
 
     FIRCLSSDKLogDebug("attempting to read crash info string\n");
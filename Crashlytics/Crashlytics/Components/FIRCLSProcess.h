@@ -17,6 +17,7 @@
 #include <mach/mach.h>
 #include <stdbool.h>
 
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSFeatures.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
 
 typedef struct {
@@ -38,6 +39,13 @@ bool FIRCLSProcessDebuggerAttached(void);
 bool FIRCLSProcessSuspendAllOtherThreads(FIRCLSProcess *process);
 bool FIRCLSProcessResumeAllOtherThreads(FIRCLSProcess *process);
 
+#if CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED
+// Starts the helper threads that FIRCLSProcessRecordAllThreads unwinds threads on, and allocates
+// the buffers they unwind into. Starting threads isn't async-signal-safe, so this has to be called
+// while initializing, before any crash can be handled.
+void FIRCLSProcessStartUnwindHelpers(void);
+#endif
+
 void FIRCLSProcessRecordThreadNames(FIRCLSProcess *process, FIRCLSFile *file);
 void FIRCLSProcessRecordDispatchQueueNames(FIRCLSProcess *process, FIRCLSFile *file);
 bool FIRCLSProcessRecordAllThreads(FIRCLSProcess *process, FIRCLSFile *file);
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include "Crashlytics/Crashlytics/Components/FIRCLSUserLoggingRing.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
 
 __BEGIN_DECLS
@@ -50,6 +51,8 @@ typedef struct {
   uint32_t maxEntries;
   bool restrictBySize;
   uint32_t* entryCount;
+  // When open, messages logged to this storage go to the ring instead of the files.
+  FIRCLSUserLoggingRing* ring;
 } FIRCLSUserLoggingABStorage;
 
 typedef struct {
@@ -59,6 +62,9 @@ typedef struct {
   FIRCLSUserLoggingABStorage logStorage;
   FIRCLSUserLoggingABStorage errorStorage;
   FIRCLSUserLoggingABStorage customExceptionStorage;
+
+  const char* logRingPath;
+  FIRCLSUserLoggingRing logRing;
 } FIRCLSUserLoggingReadOnlyContext;
 
 typedef struct {
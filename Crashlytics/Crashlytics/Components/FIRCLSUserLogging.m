@@ -579,6 +579,15 @@ void FIRCLSLogInternal(FIRCLSUserLoggingABStorage *storage,
 
   const uint64_t time = te.tv_sec * 1000LL + te.tv_usec / 1000;
 
+  // no queue or file involved, so this is safe to call from any thread
+  if (FIRCLSUserLoggingRingIsOpen(storage->ring)) {
+    const char *utf8 = [message UTF8String];
+    if (utf8) {
+      FIRCLSUserLoggingRingWrite(storage->ring, time, utf8, strlen(utf8));
+    }
+    return;
+  }
+
   FIRCLSUserLoggingWriteAndCheckABFiles(storage, activePath, ^(FIRCLSFile *file) {
     FIRCLSLogInternalWrite(file, message, time);
   });
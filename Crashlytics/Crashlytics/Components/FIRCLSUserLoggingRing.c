@@ -0,0 +1,326 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Crashlytics/Components/FIRCLSUserLoggingRing.h"
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSDefines.h"
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSUtility.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CLS_USER_LOGGING_RING_MAGIC (0x52534c43)  // "CLSR"
+#define CLS_USER_LOGGING_RING_VERSION (1)
+#define CLS_USER_LOGGING_RING_PART_SIZE (CLS_USER_LOGGING_RING_SLOT_SIZE - 24)
+#define CLS_USER_LOGGING_RING_MAX_SLOTS (UINT16_MAX)
+
+struct FIRCLSUserLoggingRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t reserved;
+  // The sequence number of the next slot to be reserved. Slot n is stored at n % slotCount.
+  _Atomic uint64_t nextSequence;
+  char padding[CLS_USER_LOGGING_RING_SLOT_SIZE - 24];
+};
+
+// A message takes as many consecutive slots as it needs, each holding one part of it.
+struct FIRCLSUserLoggingRingSlot {
+  // One more than the sequence number of the slot once its contents are committed, and 0 while
+  // they're being written.
+  _Atomic uint64_t committedSequence;
+  uint64_t time;
+  uint32_t length;     // of the part in this slot
+  uint16_t part;       // index of this slot's part in the message
+  uint16_t partCount;  // slots taken by the message
+  char bytes[CLS_USER_LOGGING_RING_PART_SIZE];
+};
+
+_Static_assert(sizeof(FIRCLSUserLoggingRingSlot) == CLS_USER_LOGGING_RING_SLOT_SIZE,
+               "slots must be exactly CLS_USER_LOGGING_RING_SLOT_SIZE bytes");
+_Static_assert(sizeof(FIRCLSUserLoggingRingHeader) == CLS_USER_LOGGING_RING_SLOT_SIZE,
+               "the header must keep the slots aligned");
+
+#pragma mark - Writing
+bool FIRCLSUserLoggingRingOpen(FIRCLSUserLoggingRing* ring, const char* path, size_t capacity) {
+  if (!FIRCLSIsValidPointer(ring) || !FIRCLSIsValidPointer(path)) {
+    FIRCLSSDKLog("Error: invalid log ring parameters\n");
+    return false;
+  }
+
+  memset(ring, 0, sizeof(FIRCLSUserLoggingRing));
+
+  if (capacity == 0) {
+    return false;
+  }
+
+  size_t slotCount =
+      (capacity + CLS_USER_LOGGING_RING_PART_SIZE - 1) / CLS_USER_LOGGING_RING_PART_SIZE;
+  if (slotCount > CLS_USER_LOGGING_RING_MAX_SLOTS) {
+    slotCount = CLS_USER_LOGGING_RING_MAX_SLOTS;
+  }
+
+  const size_t length =
+      sizeof(FIRCLSUserLoggingRingHeader) + slotCount * sizeof(FIRCLSUserLoggingRingSlot);
+
+#if TARGET_OS_IPHONE
+  // Same data protection class as the other report files. See FIRCLSFileInitWithPathMode.
+  int fd = open_dprotected_np(path, O_RDWR | O_CREAT | O_TRUNC, 4, 0, 0644);
+#else
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+#endif
+  if (fd < 0) {
+    FIRCLSSDKLog("Error: Unable to open log ring %s\n", strerror(errno));
+    return false;
+  }
+
+  // the file is extended with zeros, which leaves every slot uncommitted
+  if (ftruncate(fd, (off_t)length) != 0) {
+    FIRCLSSDKLog("Error: Unable to size log ring %s\n", strerror(errno));
+    close(fd);
+    unlink(path);
+    return false;
+  }
+
+  void* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  // the mapping keeps its own reference to the file
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    FIRCLSSDKLog("Error: Unable to map log ring %s\n", strerror(errno));
+    unlink(path);
+    return false;
+  }
+
+  ring->header = mapping;
+  ring->slots = (FIRCLSUserLoggingRingSlot*)((char*)mapping + sizeof(FIRCLSUserLoggingRingHeader));
+  ring->mappedLength = length;
+
+  ring->header->magic = CLS_USER_LOGGING_RING_MAGIC;
+  ring->header->version = CLS_USER_LOGGING_RING_VERSION;
+  ring->header->slotCount = (uint32_t)slotCount;
+  atomic_init(&ring->header->nextSequence, 0);
+
+  return true;
+}
+
+void FIRCLSUserLoggingRingClose(FIRCLSUserLoggingRing* ring) {
+  if (!FIRCLSUserLoggingRingIsOpen(ring)) {
+    return;
+  }
+
+  munmap(ring->header, ring->mappedLength);
+
+  memset(ring, 0, sizeof(FIRCLSUserLoggingRing));
+}
+
+bool FIRCLSUserLoggingRingIsOpen(const FIRCLSUserLoggingRing* ring) {
+  return FIRCLSIsValidPointer(ring) && FIRCLSIsValidPointer(ring->header);
+}
+
+void FIRCLSUserLoggingRingWrite(FIRCLSUserLoggingRing* ring,
+                                uint64_t time,
+                                const char* message,
+                                size_t length) {
+  if (!FIRCLSUserLoggingRingIsOpen(ring) || !message) {
+    return;
+  }
+
+  const uint32_t slotCount = ring->header->slotCount;
+
+  size_t partCount =
+      (length + CLS_USER_LOGGING_RING_PART_SIZE - 1) / CLS_USER_LOGGING_RING_PART_SIZE;
+  if (partCount == 0) {
+    partCount = 1;
+  } else if (partCount > slotCount) {
+    partCount = slotCount;
+    length = partCount * CLS_USER_LOGGING_RING_PART_SIZE;
+  }
+
+  // This is the only synchronization between writers. Writers racing a full lap around the ring
+  // could still write the same slot at once, which needs more slots reserved during one message
+  // than the ring has.
+  const uint64_t firstSequence =
+      atomic_fetch_add_explicit(&ring->header->nextSequence, partCount, memory_order_relaxed);
+
+  for (size_t part = 0; part < partCount; ++part) {
+    const uint64_t sequence = firstSequence + part;
+    FIRCLSUserLoggingRingSlot* slot = &ring->slots[sequence % slotCount];
+
+    const size_t offset = part * CLS_USER_LOGGING_RING_PART_SIZE;
+    size_t partLength = length - offset;
+    if (partLength > CLS_USER_LOGGING_RING_PART_SIZE) {
+      partLength = CLS_USER_LOGGING_RING_PART_SIZE;
+    }
+
+    // Uncommit the slot before overwriting it, so it is never read with parts of two messages.
+    atomic_store_explicit(&slot->committedSequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->time = time;
+    slot->length = (uint32_t)partLength;
+    slot->part = (uint16_t)part;
+    slot->partCount = (uint16_t)partCount;
+    memcpy(slot->bytes, message + offset, partLength);
+
+    atomic_store_explicit(&slot->committedSequence, sequence + 1, memory_order_release);
+  }
+}
+
+#pragma mark - Reading
+static const FIRCLSUserLoggingRingSlot* FIRCLSUserLoggingRingCommittedSlot(
+    const FIRCLSUserLoggingRingHeader* header,
+    const FIRCLSUserLoggingRingSlot* slots,
+    uint64_t sequence) {
+  const FIRCLSUserLoggingRingSlot* slot = &slots[sequence % header->slotCount];
+
+  if (atomic_load_explicit(&slot->committedSequence, memory_order_acquire) != sequence + 1) {
+    return NULL;
+  }
+
+  if (slot->length > CLS_USER_LOGGING_RING_PART_SIZE || slot->partCount == 0 ||
+      slot->part >= slot->partCount) {
+    return NULL;
+  }
+
+  return slot;
+}
+
+static void FIRCLSUserLoggingRingWriteMessages(const FIRCLSUserLoggingRingHeader* header,
+                                               const FIRCLSUserLoggingRingSlot* slots,
+                                               FIRCLSFile* file) {
+  const uint32_t slotCount = header->slotCount;
+  const uint64_t nextSequence = atomic_load_explicit(&header->nextSequence, memory_order_acquire);
+
+  char* message = malloc((size_t)slotCount * CLS_USER_LOGGING_RING_PART_SIZE + 1);
+  if (!message) {
+    FIRCLSSDKLog("Error: Unable to malloc for log ring messages\n");
+    return;
+  }
+
+  // Parts of messages whose start was overwritten, or that were never committed, are skipped.
+  uint64_t sequence = nextSequence > slotCount ? nextSequence - slotCount : 0;
+  while (sequence < nextSequence) {
+    const FIRCLSUserLoggingRingSlot* first =
+        FIRCLSUserLoggingRingCommittedSlot(header, slots, sequence);
+    if (!first || first->part != 0) {
+      sequence++;
+      continue;
+    }
+
+    const uint16_t partCount = first->partCount;
+    size_t length = 0;
+    bool complete = sequence + partCount <= nextSequence;
+
+    for (uint16_t part = 0; complete && part < partCount; ++part) {
+      const FIRCLSUserLoggingRingSlot* slot =
+          FIRCLSUserLoggingRingCommittedSlot(header, slots, sequence + part);
+      if (!slot || slot->part != part || slot->partCount != partCount) {
+        complete = false;
+        break;
+      }
+
+      memcpy(message + length, slot->bytes, slot->length);
+      length += slot->length;
+    }
+
+    if (!complete) {
+      sequence++;
+      continue;
+    }
+
+    message[length] = '\0';
+
+    // the same sections FIRCLSLogInternalWrite writes
+    FIRCLSFileWriteSectionStart(file, "log");
+    FIRCLSFileWriteHashStart(file);
+    FIRCLSFileWriteHashEntryHexEncodedString(file, "msg", message);
+    FIRCLSFileWriteHashEntryUint64(file, "time", first->time);
+    FIRCLSFileWriteHashEnd(file);
+    FIRCLSFileWriteSectionEnd(file);
+
+    sequence += partCount;
+  }
+
+  free(message);
+}
+
+bool FIRCLSUserLoggingRingConvertToLogFile(const char* ringPath, const char* logPath) {
+  if (!FIRCLSIsValidPointer(ringPath) || !FIRCLSIsValidPointer(logPath)) {
+    FIRCLSSDKLog("Error: invalid log ring paths\n");
+    return false;
+  }
+
+  int fd = open(ringPath, O_RDONLY);
+  if (fd < 0) {
+    return errno == ENOENT;
+  }
+
+  struct stat fileStats;
+  if (fstat(fd, &fileStats) != 0 ||
+      fileStats.st_size < (off_t)sizeof(FIRCLSUserLoggingRingHeader)) {
+    FIRCLSSDKLog("Error: log ring is too small\n");
+    close(fd);
+    unlink(ringPath);
+    return false;
+  }
+
+  const size_t length = (size_t)fileStats.st_size;
+  void* mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    FIRCLSSDKLog("Error: Unable to map log ring %s\n", strerror(errno));
+    return false;
+  }
+
+  const FIRCLSUserLoggingRingHeader* header = mapping;
+  const FIRCLSUserLoggingRingSlot* slots =
+      (const FIRCLSUserLoggingRingSlot*)((const char*)mapping +
+                                         sizeof(FIRCLSUserLoggingRingHeader));
+
+  bool valid = header->magic == CLS_USER_LOGGING_RING_MAGIC &&
+               header->version == CLS_USER_LOGGING_RING_VERSION && header->slotCount > 0 &&
+               length >= sizeof(FIRCLSUserLoggingRingHeader) +
+                             (size_t)header->slotCount * sizeof(FIRCLSUserLoggingRingSlot);
+
+  bool success = false;
+  FIRCLSFile file;
+
+  if (!valid) {
+    FIRCLSSDKLog("Error: log ring is invalid\n");
+  } else if (!FIRCLSFileInitWithPath(&file, logPath, true)) {
+    FIRCLSSDKLog("Error: Unable to open log file for log ring\n");
+  } else {
+    FIRCLSUserLoggingRingWriteMessages(header, slots, &file);
+    success = FIRCLSFileClose(&file);
+  }
+
+  munmap(mapping, length);
+
+  // an invalid ring can never be read, so it is removed as well
+  if (success || !valid) {
+    unlink(ringPath);
+  }
+
+  return success;
+}
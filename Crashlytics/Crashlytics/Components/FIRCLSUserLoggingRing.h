@@ -0,0 +1,60 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+// A ring of user log messages in a memory-mapped file. Any number of threads can write to it at
+// once without locking: a writer reserves slots with one atomic add, copies the message in and
+// marks each slot committed. The mapping is shared with the file, so whatever was committed is on
+// disk even if the process crashes, without any flush.
+//
+// The ring is only read on a later launch, once nothing writes to it anymore, and converted into
+// the "log" sections of the user log files.
+
+__BEGIN_DECLS
+
+#define CLS_USER_LOGGING_RING_SLOT_SIZE (128)
+
+typedef struct FIRCLSUserLoggingRingHeader FIRCLSUserLoggingRingHeader;
+typedef struct FIRCLSUserLoggingRingSlot FIRCLSUserLoggingRingSlot;
+
+typedef struct {
+  FIRCLSUserLoggingRingHeader* header;
+  FIRCLSUserLoggingRingSlot* slots;
+  size_t mappedLength;
+} FIRCLSUserLoggingRing;
+
+// Creates the ring file at path, replacing any existing one, with room for about capacity bytes of
+// messages.
+bool FIRCLSUserLoggingRingOpen(FIRCLSUserLoggingRing* ring, const char* path, size_t capacity);
+void FIRCLSUserLoggingRingClose(FIRCLSUserLoggingRing* ring);
+bool FIRCLSUserLoggingRingIsOpen(const FIRCLSUserLoggingRing* ring);
+
+// Messages longer than the ring are truncated. Once the ring is full, the oldest messages are
+// overwritten.
+void FIRCLSUserLoggingRingWrite(FIRCLSUserLoggingRing* ring,
+                                uint64_t time,
+                                const char* message,
+                                size_t length);
+
+// Appends the messages in the ring file at ringPath to the log file at logPath as "log" sections,
+// oldest first, then removes the ring file. Returns true if there is no ring file.
+bool FIRCLSUserLoggingRingConvertToLogFile(const char* ringPath, const char* logPath);
+
+__END_DECLS
@@ -146,12 +146,18 @@ NSInteger compareNewer(FIRCLSInternalReport *reportA,
 
 - (void)sendUnsentReportsWithToken:(FIRCLSDataCollectionToken *)dataCollectionToken
                           asUrgent:(BOOL)urgent {
+  NSMutableArray<FIRCLSInternalReport *> *reportsToProcess = [NSMutableArray array];
   for (NSString *path in self.existingUnemptyActiveReportPaths) {
-    [self processExistingActiveReportPath:path
-                      dataCollectionToken:dataCollectionToken
-                                 asUrgent:urgent];
+    FIRCLSInternalReport *report = [self processExistingActiveReportPath:path
+                                                     dataCollectionToken:dataCollectionToken
+                                                                asUrgent:urgent];
+    if (report) {
+      [reportsToProcess addObject:report];
+    }
   }
 
+  [self processActiveReports:reportsToProcess dataCollectionToken:dataCollectionToken];
+
   // deal with stuff in processing more carefully - do not process again
   [self.operationQueue addOperationWithBlock:^{
     for (NSString *path in self.processingReportPaths) {
@@ -178,9 +184,11 @@ NSInteger compareNewer(FIRCLSInternalReport *reportA,
   }];
 }
 
-- (void)processExistingActiveReportPath:(NSString *)path
-                    dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
-                               asUrgent:(BOOL)urgent {
+// Returns the report if it still has to be processed, which is left to processActiveReports:.
+- (FIRCLSInternalReport *)processExistingActiveReportPath:(NSString *)path
+                                      dataCollectionToken:
+                                          (FIRCLSDataCollectionToken *)dataCollectionToken
+                                                 asUrgent:(BOOL)urgent {
   FIRCLSInternalReport *report = [FIRCLSInternalReport reportWithPath:path];
 
   // TODO: hasAnyEvents should really be called on the background queue.
@@ -189,7 +197,7 @@ NSInteger compareNewer(FIRCLSInternalReport *reportA,
       [self.fileManager removeItemAtPath:path];
     }];
 
-    return;
+    return nil;
   }
 
   if (urgent && [dataCollectionToken isValid]) {
@@ -198,15 +206,32 @@ NSInteger compareNewer(FIRCLSInternalReport *reportA,
                             dataCollectionToken:dataCollectionToken
                                        asUrgent:urgent
                                  withProcessing:YES];
+    return nil;
+  }
+
+  return report;
+}
+
+// Symbolicating and demangling is most of the work of sending reports. The pending reports are
+// processed one after the other in a single operation, sharing the demangled symbol cache, at a
+// quality of service below the app's own launch work.
+- (void)processActiveReports:(NSArray<FIRCLSInternalReport *> *)reports
+         dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken {
+  if (reports.count == 0) {
     return;
   }
 
-  [self.operationQueue addOperationWithBlock:^{
-    [self.reportUploader prepareAndSubmitReport:report
-                            dataCollectionToken:dataCollectionToken
-                                       asUrgent:NO
-                                 withProcessing:YES];
+  NSBlockOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
+    for (FIRCLSInternalReport *report in reports) {
+      [self.reportUploader prepareAndSubmitReport:report
+                              dataCollectionToken:dataCollectionToken
+                                         asUrgent:NO
+                                   withProcessing:YES];
+    }
   }];
+  operation.qualityOfService = NSQualityOfServiceUtility;
+
+  [self.operationQueue addOperation:operation];
 }
 
 - (void)deleteUnsentReports {
@@ -330,6 +330,8 @@ typedef NSNumber FIRCLSWrappedReportAction;
 
     return [allOpsFinished onQueue:dispatch_get_main_queue()
                               then:^id _Nullable(id _Nullable allOpsFinishedValue) {
+                                [FIRCLSReportManager logStartupPhases];
+
                                 // Signal that to callers of processReports that everything is
                                 // finished.
                                 [unsentReportsHandled fulfill:nil];
@@ -340,6 +342,19 @@ typedef NSNumber FIRCLSWrappedReportAction;
   return promise;
 }
 
+// Logs how long each phase of starting up took, so the cost of Crashlytics on app launch can be
+// tracked. By the time unsent reports are handled, all of the phases have run.
++ (void)logStartupPhases {
+  NSMutableString *summary = [NSMutableString string];
+
+  for (int phase = 0; phase < FIRCLSStartupPhaseCount; phase++) {
+    [summary appendFormat:@" %s: %.3f ms;", FIRCLSProfileStartupPhaseName(phase),
+                          FIRCLSProfileStartupPhaseDuration(phase)];
+  }
+
+  FIRCLSDebugLog(@"Startup phases:%@", summary);
+}
+
 - (void)beginSettingsWithToken:(FIRCLSDataCollectionToken *)token {
   if (self.settings.isCacheExpired) {
     // This method can be called more than once if the user calls
@@ -27,6 +27,7 @@
 #import "Crashlytics/Crashlytics/Models/Record/FIRCLSReportAdapter.h"
 #import "Crashlytics/Crashlytics/Operations/Reports/FIRCLSProcessReportOperation.h"
 
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSProfiling.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSUtility.h"
 
 #import "Crashlytics/Shared/FIRCLSConstants.h"
@@ -113,7 +114,11 @@
           FIRCLSProcessReportOperation *processOperation =
               [[FIRCLSProcessReportOperation alloc] initWithReport:report resolver:resolver];
 
+          FIRCLSProfileMark processingMark = FIRCLSProfilingStart();
           [processOperation start];
+          FIRCLSProfileRecordStartupPhase(FIRCLSStartupPhaseReportProcessing, processingMark);
+        } else {
+          [FIRCLSProcessReportOperation convertBinaryRecordsInReport:report];
         }
 
         // With the new report endpoint, the report is deleted once it is written to GDT
@@ -205,7 +205,9 @@ void FIRCLSExceptionRecord(FIRCLSExceptionType type,
       const char *path = _firclsContext.readonly->exception.path;
       FIRCLSFile file;
 
-      if (!FIRCLSFileInitWithPath(&file, path, false)) {
+      if (!FIRCLSFileInitCrashRecordWithPath(&file, path,
+                                             _firclsContext.readonly->exceptionRecordBuffer,
+                                             CLS_FILE_CRASH_RECORD_BUFFER_SIZE)) {
         FIRCLSSDKLog("Unable to open exception file\n");
         return;
       }
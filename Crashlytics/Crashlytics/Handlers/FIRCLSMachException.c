@@ -484,7 +484,9 @@ static bool FIRCLSMachExceptionRecord(FIRCLSMachExceptionReadContext* context,
 
   FIRCLSFile file;
 
-  if (!FIRCLSFileInitWithPath(&file, context->path, false)) {
+  if (!FIRCLSFileInitCrashRecordWithPath(&file, context->path,
+                                         _firclsContext.readonly->crashRecordBuffer,
+                                         CLS_FILE_CRASH_RECORD_BUFFER_SIZE)) {
     FIRCLSSDKLog("Unable to open mach exception file\n");
     return false;
   }
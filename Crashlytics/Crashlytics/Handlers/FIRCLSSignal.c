@@ -243,7 +243,9 @@ static void FIRCLSSignalRecordSignal(int savedErrno, siginfo_t *info, void *uapV
 
   FIRCLSFile file;
 
-  if (!FIRCLSFileInitWithPath(&file, _firclsContext.readonly->signal.path, false)) {
+  if (!FIRCLSFileInitCrashRecordWithPath(&file, _firclsContext.readonly->signal.path,
+                                         _firclsContext.readonly->crashRecordBuffer,
+                                         CLS_FILE_CRASH_RECORD_BUFFER_SIZE)) {
     FIRCLSSDKLog("Unable to open signal file\n");
     return;
   }
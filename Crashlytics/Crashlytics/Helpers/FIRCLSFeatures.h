@@ -19,6 +19,15 @@
 #define CLS_MEMORY_PROTECTION_ENABLED 1
 #define CLS_COMPACT_UNWINDED_ENABLED 1
 #define CLS_DWARF_UNWINDING_ENABLED 1
+// Unwinds the threads of a crashing process on helper threads started ahead of time, in addition
+// to the thread handling the crash.
+#define CLS_PARALLEL_THREAD_UNWINDING_ENABLED 0
+// Writes the signal, mach exception and exception files in the binary FIRCLSFile encoding, which
+// are converted to JSON text before the report is uploaded.
+#define CLS_BINARY_CRASH_RECORDS_ENABLED 1
+// Records FIRCLSLog messages in a memory-mapped ring, see FIRCLSUserLoggingRing.h, rather than
+// appending them to the log files on the logging queue.
+#define CLS_USER_LOG_RING_ENABLED 1
 
 #define CLS_USE_SIGALTSTACK (!TARGET_OS_WATCH && !TARGET_OS_TV)
 #define CLS_CAN_SUSPEND_THREADS !TARGET_OS_WATCH
@@ -30,3 +39,6 @@
 
 #define CLS_DWARF_UNWINDING_SUPPORTED \
   (CLS_COMPACT_UNWINDING_SUPPORTED && CLS_DWARF_UNWINDING_ENABLED)
+
+#define CLS_PARALLEL_THREAD_UNWINDING_SUPPORTED \
+  (CLS_CAN_SUSPEND_THREADS && CLS_PARALLEL_THREAD_UNWINDING_ENABLED)
@@ -34,11 +34,19 @@ typedef struct {
   int collectionDepth;
   bool needComma;
 
+  // Writes values as tagged binary records rather than JSON text. See
+  // FIRCLSFileInitCrashRecordWithPath.
+  bool binary;
+
   bool bufferWrites;
+  bool ownsWriteBuffer;
+  bool flushAfterSections;
   char* writeBuffer;
+  size_t writeBufferCapacity;
   size_t writeBufferLength;
 
   off_t writtenLength;
+  uint32_t writeCount;  // calls to write(2), for measuring how well writes are batched
 } FIRCLSFile;
 typedef FIRCLSFile* FIRCLSFileRef;
 
@@ -46,6 +54,8 @@ typedef FIRCLSFile* FIRCLSFileRef;
 #define CLS_FILE_HEX_BUFFER \
   (32)  // must be at least 2, and should be even (to account for 2 chars per hex value)
 #define CLS_FILE_MAX_WRITE_ATTEMPTS (50)
+// Size of the buffers crash files are written through, which are allocated ahead of time.
+#define CLS_FILE_CRASH_RECORD_BUFFER_SIZE (64 * 1024)
 
 extern const size_t FIRCLSWriteBufferLength;
 
@@ -57,6 +67,21 @@ bool FIRCLSFileInitWithPathMode(FIRCLSFile* file,
                                 bool appendMode,
                                 bool bufferWrites);
 
+// Opens a file in append mode for recording a crash. With CLS_BINARY_CRASH_RECORDS_ENABLED, the
+// values are written in a compact binary encoding (a 0x00 byte starting each section, then tagged
+// values with varint lengths and numbers), which skips the JSON formatting while crashing.
+// FIRCLSFileReadSections reads both encodings, and FIRCLSFileConvertBinaryRecordsToJSON rewrites
+// the file as JSON text for upload.
+//
+// Writes are buffered in writeBuffer, which must have been allocated ahead of time since the
+// heap can't be used while crashing, and isn't freed on close. The buffer is flushed at the end of
+// each section, so that the sections completed before any fault in the handler are kept. Without
+// a buffer, every value is written to the file directly.
+bool FIRCLSFileInitCrashRecordWithPath(FIRCLSFile* file,
+                                       const char* path,
+                                       char* writeBuffer,
+                                       size_t writeBufferCapacity);
+
 void FIRCLSFileFlushWriteBuffer(FIRCLSFile* file);
 bool FIRCLSFileClose(FIRCLSFile* file);
 bool FIRCLSFileCloseWithOffset(FIRCLSFile* file, off_t* finalSize);
@@ -102,6 +127,9 @@ void FIRCLSFileWriteInt64(FIRCLSFile* file, int64_t number);
 NSArray* FIRCLSFileReadSections(const char* path,
                                 bool deleteOnFailure,
                                 NSObject* (^transformer)(id obj));
+// Rewrites a file containing binary sections as one JSON section per line. Returns true if the
+// file is already all JSON text, or was rewritten.
+bool FIRCLSFileConvertBinaryRecordsToJSON(const char* path);
 NSString* FIRCLSFileHexEncodeString(const char* string);
 NSString* FIRCLSFileHexDecodeString(const char* string);
 #endif
@@ -14,6 +14,7 @@
 
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
 
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSFeatures.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSUtility.h"
 #include "Crashlytics/Shared/FIRCLSByteUtility.h"
 
@@ -33,6 +34,26 @@ static const size_t FIRCLSUInt64StringBufferLength = 21;
 static const size_t FIRCLSStringBufferLength = 16;
 const size_t FIRCLSWriteBufferLength = 1000;
 
+// The binary encoding. Each section starts with a FIRCLSFileBinarySectionMarker byte, which never
+// appears in JSON text, followed by a single tagged value. Lengths and numbers are LEB128 varints.
+static const uint8_t FIRCLSFileBinarySectionMarker = 0x00;
+static const int FIRCLSFileBinaryMaxDepth = 64;
+
+typedef enum {
+  FIRCLSFileBinaryTagHashStart = 1,
+  FIRCLSFileBinaryTagHashEnd = 2,
+  FIRCLSFileBinaryTagArrayStart = 3,
+  FIRCLSFileBinaryTagArrayEnd = 4,
+  FIRCLSFileBinaryTagKey = 5,          // varint length, then bytes
+  FIRCLSFileBinaryTagUInt = 6,         // varint
+  FIRCLSFileBinaryTagNegativeInt = 7,  // varint magnitude
+  FIRCLSFileBinaryTagString = 8,       // varint length, then bytes
+  FIRCLSFileBinaryTagHexString = 9,    // varint length, then bytes, read as a hex string
+  FIRCLSFileBinaryTagNull = 10,
+  FIRCLSFileBinaryTagTrue = 11,
+  FIRCLSFileBinaryTagFalse = 12,
+} FIRCLSFileBinaryTag;
+
 static bool FIRCLSFileInit(FIRCLSFile* file, int fdm, bool appendMode, bool bufferWrites);
 
 static void FIRCLSFileWriteToFileDescriptorOrBuffer(FIRCLSFile* file,
@@ -53,6 +74,7 @@ static void FIRCLSFileWriteColletionEntryProlog(FIRCLSFile* file);
 static void FIRCLSFileWriteColletionEntryEpilog(FIRCLSFile* file);
 
 #define CLS_FILE_DEBUG_LOGGING 0
+#define CLS_FILE_VARINT_MAX_LENGTH (10)  // enough for any 64-bit value
 
 #pragma mark - File Structure
 static bool FIRCLSFileInit(FIRCLSFile* file, int fd, bool appendMode, bool bufferWrites) {
@@ -78,6 +100,8 @@ static bool FIRCLSFileInit(FIRCLSFile* file, int fd, bool appendMode, bool buffe
       return false;
     }
 
+    file->ownsWriteBuffer = true;
+    file->writeBufferCapacity = FIRCLSWriteBufferLength;
     file->writeBufferLength = 0;
   }
 
@@ -136,6 +160,30 @@ bool FIRCLSFileInitWithPathMode(FIRCLSFile* file,
   return FIRCLSFileInit(file, fd, appendMode, bufferWrites);
 }
 
+bool FIRCLSFileInitCrashRecordWithPath(FIRCLSFile* file,
+                                       const char* path,
+                                       char* writeBuffer,
+                                       size_t writeBufferCapacity) {
+  if (!FIRCLSFileInitWithPath(file, path, false)) {
+    return false;
+  }
+
+  // one byte of the buffer is kept for the terminator
+  if (FIRCLSIsValidPointer(writeBuffer) && writeBufferCapacity > 1) {
+    file->bufferWrites = true;
+    file->flushAfterSections = true;
+    file->writeBuffer = writeBuffer;
+    file->writeBufferCapacity = writeBufferCapacity;
+    file->writeBufferLength = 0;
+  }
+
+#if CLS_BINARY_CRASH_RECORDS_ENABLED
+  file->binary = true;
+#endif
+
+  return true;
+}
+
 bool FIRCLSFileClose(FIRCLSFile* file) {
   return FIRCLSFileCloseWithOffset(file, NULL);
 }
@@ -149,7 +197,15 @@ bool FIRCLSFileCloseWithOffset(FIRCLSFile* file, off_t* finalSize) {
     if (file->writeBufferLength > 0) {
       FIRCLSFileFlushWriteBuffer(file);
     }
-    free(file->writeBuffer);
+
+    if (file->ownsWriteBuffer) {
+      free(file->writeBuffer);
+    }
+  }
+
+  if (file->flushAfterSections) {
+    FIRCLSSDKLog("Crash record is %lld bytes, written with %u writes\n",
+                 (long long)file->writtenLength, file->writeCount);
   }
 
   if (FIRCLSIsValidPointer(finalSize)) {
@@ -181,7 +237,7 @@ void FIRCLSFileFlushWriteBuffer(FIRCLSFile* file) {
     return;
   }
 
-  if (!file->bufferWrites) {
+  if (!file->bufferWrites || file->writeBufferLength == 0) {
     return;
   }
 
@@ -193,9 +249,9 @@ static void FIRCLSFileWriteToFileDescriptorOrBuffer(FIRCLSFile* file,
                                                     const char* string,
                                                     size_t length) {
   if (file->bufferWrites) {
-    if (file->writeBufferLength + length > FIRCLSWriteBufferLength - 1) {
+    if (file->writeBufferLength + length > file->writeBufferCapacity - 1) {
       // fill remaining space in buffer
-      size_t remainingSpace = FIRCLSWriteBufferLength - file->writeBufferLength - 1;
+      size_t remainingSpace = file->writeBufferCapacity - file->writeBufferLength - 1;
       FIRCLSFileWriteToBuffer(file, string, remainingSpace);
       FIRCLSFileFlushWriteBuffer(file);
 
@@ -211,6 +267,8 @@ static void FIRCLSFileWriteToFileDescriptorOrBuffer(FIRCLSFile* file,
 }
 
 static void FIRCLSFileWriteToFileDescriptor(FIRCLSFile* file, const char* string, size_t length) {
+  file->writeCount++;
+
   if (!FIRCLSFileWriteWithRetries(file->fd, string, length)) {
     return;
   }
@@ -223,10 +281,10 @@ static void FIRCLSFileWriteToFileDescriptor(FIRCLSFile* file, const char* string
 // FIRCLSFileWriteToFileDescriptorOrBuffer.
 static void FIRCLSFileWriteToBuffer(FIRCLSFile* file, const char* string, size_t length) {
   size_t writeLength = length;
-  if (file->writeBufferLength + writeLength > FIRCLSWriteBufferLength - 1) {
-    writeLength = FIRCLSWriteBufferLength - file->writeBufferLength - 1;
+  if (file->writeBufferLength + writeLength > file->writeBufferCapacity - 1) {
+    writeLength = file->writeBufferCapacity - file->writeBufferLength - 1;
   }
-  strncpy(file->writeBuffer + file->writeBufferLength, string, writeLength);
+  memcpy(file->writeBuffer + file->writeBufferLength, string, writeLength);
   file->writeBufferLength += writeLength;
   file->writeBuffer[file->writeBufferLength] = '\0';
 }
@@ -272,6 +330,54 @@ bool FIRCLSFileWriteWithRetries(int fd, const void* buffer, size_t length) {
                                       });
 }
 
+#pragma mark - Binary Encoding
+
+static size_t FIRCLSFileEncodeVarint(uint8_t* buffer, uint64_t value) {
+  size_t length = 0;
+
+  while (value >= 0x80) {
+    buffer[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+
+  buffer[length++] = (uint8_t)value;
+
+  return length;
+}
+
+static void FIRCLSFileWriteBinaryTag(FIRCLSFile* file, FIRCLSFileBinaryTag tag) {
+  const char byte = (char)tag;
+
+  FIRCLSFileWriteToFileDescriptorOrBuffer(file, &byte, 1);
+}
+
+// Writes the tag and its varint together, in a single write.
+static void FIRCLSFileWriteBinaryTagWithVarint(FIRCLSFile* file,
+                                               FIRCLSFileBinaryTag tag,
+                                               uint64_t value) {
+  uint8_t buffer[1 + CLS_FILE_VARINT_MAX_LENGTH];
+
+  buffer[0] = (uint8_t)tag;
+  size_t length = 1 + FIRCLSFileEncodeVarint(&buffer[1], value);
+
+  FIRCLSFileWriteToFileDescriptorOrBuffer(file, (const char*)buffer, length);
+}
+
+static void FIRCLSFileWriteBinaryBytes(FIRCLSFile* file,
+                                       FIRCLSFileBinaryTag tag,
+                                       const char* bytes,
+                                       size_t length) {
+  if (!bytes) {
+    FIRCLSFileWriteBinaryTag(file, FIRCLSFileBinaryTagNull);
+    return;
+  }
+
+  FIRCLSFileWriteBinaryTagWithVarint(file, tag, length);
+  if (length > 0) {
+    FIRCLSFileWriteToFileDescriptorOrBuffer(file, bytes, length);
+  }
+}
+
 #pragma mark - Strings
 
 static void FIRCLSFileWriteUnbufferedStringWithSuffix(FIRCLSFile* file,
@@ -326,6 +432,12 @@ static void FIRCLSFileWriteStringWithSuffix(FIRCLSFile* file,
 }
 
 void FIRCLSFileWriteString(FIRCLSFile* file, const char* string) {
+  if (file->binary) {
+    FIRCLSFileWriteBinaryBytes(file, FIRCLSFileBinaryTagString, string,
+                               string ? strlen(string) : 0);
+    return;
+  }
+
   if (!string) {
     FIRCLSFileWriteToFileDescriptorOrBuffer(file, "null", 4);
     return;
@@ -339,6 +451,13 @@ void FIRCLSFileWriteHexEncodedString(FIRCLSFile* file, const char* string) {
     return;
   }
 
+  // The raw bytes are written, and only hex encoded once read back.
+  if (file->binary) {
+    FIRCLSFileWriteBinaryBytes(file, FIRCLSFileBinaryTagHexString, string,
+                               string ? strlen(string) : 0);
+    return;
+  }
+
   if (!string) {
     FIRCLSFileWriteToFileDescriptorOrBuffer(file, "null", 4);
     return;
@@ -380,6 +499,11 @@ void FIRCLSFileWriteHexEncodedString(FIRCLSFile* file, const char* string) {
 
 #pragma mark - Integers
 void FIRCLSFileWriteUInt64(FIRCLSFile* file, uint64_t number, bool hex) {
+  if (file->binary) {
+    FIRCLSFileWriteBinaryTagWithVarint(file, FIRCLSFileBinaryTagUInt, number);
+    return;
+  }
+
   char buffer[FIRCLSUInt64StringBufferLength];
   short i = FIRCLSFilePrepareUInt64(buffer, number, hex);
   char* beginning = &buffer[i];  // Write from a pointer to the begining of the string.
@@ -394,6 +518,17 @@ void FIRCLSFileFDWriteUInt64(int fd, uint64_t number, bool hex) {
 }
 
 void FIRCLSFileWriteInt64(FIRCLSFile* file, int64_t number) {
+  if (file->binary) {
+    if (number < 0) {
+      // negate as unsigned, so INT64_MIN doesn't overflow
+      FIRCLSFileWriteBinaryTagWithVarint(file, FIRCLSFileBinaryTagNegativeInt,
+                                         0 - (uint64_t)number);
+    } else {
+      FIRCLSFileWriteBinaryTagWithVarint(file, FIRCLSFileBinaryTagUInt, (uint64_t)number);
+    }
+    return;
+  }
+
   if (number < 0) {
     FIRCLSFileWriteToFileDescriptorOrBuffer(file, "-", 1);
     number *= -1;  // make it positive
@@ -440,6 +575,11 @@ short FIRCLSFilePrepareUInt64(char* buffer, uint64_t number, bool hex) {
 }
 
 void FIRCLSFileWriteBool(FIRCLSFile* file, bool value) {
+  if (file->binary) {
+    FIRCLSFileWriteBinaryTag(file, value ? FIRCLSFileBinaryTagTrue : FIRCLSFileBinaryTagFalse);
+    return;
+  }
+
   if (value) {
     FIRCLSFileWriteToFileDescriptorOrBuffer(file, "true", 4);
   } else {
@@ -448,16 +588,34 @@ void FIRCLSFileWriteBool(FIRCLSFile* file, bool value) {
 }
 
 void FIRCLSFileWriteSectionStart(FIRCLSFile* file, const char* name) {
+  if (file->binary) {
+    const char marker = (char)FIRCLSFileBinarySectionMarker;
+    FIRCLSFileWriteToFileDescriptorOrBuffer(file, &marker, 1);
+  }
+
   FIRCLSFileWriteHashStart(file);
   FIRCLSFileWriteHashKey(file, name);
 }
 
 void FIRCLSFileWriteSectionEnd(FIRCLSFile* file) {
   FIRCLSFileWriteHashEnd(file);
-  FIRCLSFileWriteToFileDescriptorOrBuffer(file, "\n", 1);
+
+  if (!file->binary) {
+    FIRCLSFileWriteToFileDescriptorOrBuffer(file, "\n", 1);
+  }
+
+  if (file->flushAfterSections) {
+    FIRCLSFileFlushWriteBuffer(file);
+  }
 }
 
 void FIRCLSFileWriteCollectionStart(FIRCLSFile* file, const char openingChar) {
+  if (file->binary) {
+    FIRCLSFileWriteBinaryTag(file, openingChar == '{' ? FIRCLSFileBinaryTagHashStart
+                                                      : FIRCLSFileBinaryTagArrayStart);
+    return;
+  }
+
   char string[2];
 
   string[0] = ',';
@@ -475,6 +633,12 @@ void FIRCLSFileWriteCollectionStart(FIRCLSFile* file, const char openingChar) {
 }
 
 void FIRCLSFileWriteCollectionEnd(FIRCLSFile* file, const char closingChar) {
+  if (file->binary) {
+    FIRCLSFileWriteBinaryTag(file, closingChar == '}' ? FIRCLSFileBinaryTagHashEnd
+                                                      : FIRCLSFileBinaryTagArrayEnd);
+    return;
+  }
+
   FIRCLSFileWriteToFileDescriptorOrBuffer(file, &closingChar, 1);
 
   if (file->collectionDepth <= 0) {
@@ -488,7 +652,7 @@ void FIRCLSFileWriteCollectionEnd(FIRCLSFile* file, const char closingChar) {
 }
 
 void FIRCLSFileWriteColletionEntryProlog(FIRCLSFile* file) {
-  if (file->needComma) {
+  if (file->needComma && !file->binary) {
     FIRCLSFileWriteToFileDescriptorOrBuffer(file, ",", 1);
   }
 }
@@ -506,6 +670,11 @@ void FIRCLSFileWriteHashEnd(FIRCLSFile* file) {
 }
 
 void FIRCLSFileWriteHashKey(FIRCLSFile* file, const char* key) {
+  if (file->binary) {
+    FIRCLSFileWriteBinaryBytes(file, FIRCLSFileBinaryTagKey, key, strlen(key));
+    return;
+  }
+
   FIRCLSFileWriteColletionEntryProlog(file);
 
   FIRCLSFileWriteStringWithSuffix(file, key, strlen(key), ':');
@@ -597,6 +766,156 @@ void FIRCLSFileWriteArrayEntryHexEncodedString(FIRCLSFile* file, const char* val
   FIRCLSFileWriteColletionEntryEpilog(file);
 }
 
+#pragma mark - Reading
+
+static bool FIRCLSFileReadVarint(const uint8_t* bytes,
+                                 NSUInteger length,
+                                 NSUInteger* offset,
+                                 uint64_t* value) {
+  uint64_t result = 0;
+
+  for (unsigned int shift = 0; shift < 64; shift += 7) {
+    if (*offset >= length) {
+      return false;
+    }
+
+    uint8_t byte = bytes[(*offset)++];
+    result |= (uint64_t)(byte & 0x7f) << shift;
+
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static NSData* FIRCLSFileReadBinaryBytes(const uint8_t* bytes,
+                                         NSUInteger length,
+                                         NSUInteger* offset) {
+  uint64_t byteCount = 0;
+  if (!FIRCLSFileReadVarint(bytes, length, offset, &byteCount)) {
+    return nil;
+  }
+
+  if (byteCount > length - *offset) {
+    return nil;
+  }
+
+  NSData* data = [NSData dataWithBytes:bytes + *offset length:(NSUInteger)byteCount];
+  *offset += (NSUInteger)byteCount;
+
+  return data;
+}
+
+static NSString* FIRCLSFileReadBinaryString(const uint8_t* bytes,
+                                            NSUInteger length,
+                                            NSUInteger* offset) {
+  NSData* data = FIRCLSFileReadBinaryBytes(bytes, length, offset);
+  if (!data) {
+    return nil;
+  }
+
+  return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
+
+static NSString* FIRCLSFileHexEncodeBytes(const uint8_t* bytes, size_t length);
+
+// Decodes the tagged value at offset, returning nil if it is truncated or malformed.
+static id FIRCLSFileReadBinaryValue(const uint8_t* bytes,
+                                    NSUInteger length,
+                                    NSUInteger* offset,
+                                    int depth) {
+  if (depth > FIRCLSFileBinaryMaxDepth || *offset >= length) {
+    return nil;
+  }
+
+  uint8_t tag = bytes[(*offset)++];
+  uint64_t number = 0;
+
+  switch (tag) {
+    case FIRCLSFileBinaryTagHashStart: {
+      NSMutableDictionary* hash = [NSMutableDictionary dictionary];
+
+      while (*offset < length) {
+        uint8_t entryTag = bytes[(*offset)++];
+        if (entryTag == FIRCLSFileBinaryTagHashEnd) {
+          return hash;
+        }
+
+        if (entryTag != FIRCLSFileBinaryTagKey) {
+          return nil;
+        }
+
+        NSString* key = FIRCLSFileReadBinaryString(bytes, length, offset);
+        if (!key) {
+          return nil;
+        }
+
+        id value = FIRCLSFileReadBinaryValue(bytes, length, offset, depth + 1);
+        if (!value) {
+          return nil;
+        }
+
+        hash[key] = value;
+      }
+
+      return nil;
+    }
+    case FIRCLSFileBinaryTagArrayStart: {
+      NSMutableArray* array = [NSMutableArray array];
+
+      while (*offset < length) {
+        if (bytes[*offset] == FIRCLSFileBinaryTagArrayEnd) {
+          (*offset)++;
+          return array;
+        }
+
+        id value = FIRCLSFileReadBinaryValue(bytes, length, offset, depth + 1);
+        if (!value) {
+          return nil;
+        }
+
+        [array addObject:value];
+      }
+
+      return nil;
+    }
+    case FIRCLSFileBinaryTagUInt:
+      if (!FIRCLSFileReadVarint(bytes, length, offset, &number)) {
+        return nil;
+      }
+
+      return @(number);
+    case FIRCLSFileBinaryTagNegativeInt:
+      if (!FIRCLSFileReadVarint(bytes, length, offset, &number) ||
+          number > (uint64_t)INT64_MAX + 1) {
+        return nil;
+      }
+
+      return @((int64_t)(0 - number));
+    case FIRCLSFileBinaryTagString:
+      return FIRCLSFileReadBinaryString(bytes, length, offset);
+    case FIRCLSFileBinaryTagHexString: {
+      NSData* data = FIRCLSFileReadBinaryBytes(bytes, length, offset);
+      if (!data) {
+        return nil;
+      }
+
+      return FIRCLSFileHexEncodeBytes(data.bytes, data.length);
+    }
+    case FIRCLSFileBinaryTagNull:
+      return [NSNull null];
+    case FIRCLSFileBinaryTagTrue:
+      return @YES;
+    case FIRCLSFileBinaryTagFalse:
+      return @NO;
+    default:
+      return nil;
+  }
+}
+
 NSArray* FIRCLSFileReadSections(const char* path,
                                 bool deleteOnFailure,
                                 NSObject* (^transformer)(id obj)) {
@@ -606,12 +925,9 @@ NSArray* FIRCLSFileReadSections(const char* path,
   }
 
   NSString* pathString = [NSString stringWithUTF8String:path];
-  NSString* contents = [NSString stringWithContentsOfFile:pathString
-                                                 encoding:NSUTF8StringEncoding
-                                                    error:nil];
-  NSArray* components = [contents componentsSeparatedByString:@"\n"];
+  NSData* contents = [NSData dataWithContentsOfFile:pathString];
 
-  if (!components) {
+  if (!contents) {
     if (deleteOnFailure) {
       unlink(path);
     }
@@ -622,11 +938,38 @@ NSArray* FIRCLSFileReadSections(const char* path,
 
   NSMutableArray* array = [NSMutableArray array];
 
-  // loop through all the entires, and
-  for (NSString* component in components) {
-    NSData* data = [component dataUsingEncoding:NSUTF8StringEncoding];
+  const uint8_t* bytes = contents.bytes;
+  NSUInteger length = contents.length;
+  NSUInteger offset = 0;
+
+  // loop through all the entires, which are either binary sections or lines of JSON
+  while (offset < length) {
+    id obj = nil;
+
+    if (bytes[offset] == FIRCLSFileBinarySectionMarker) {
+      offset++;
+
+      obj = FIRCLSFileReadBinaryValue(bytes, length, &offset, 0);
+      if (!obj) {
+        // the end of a malformed section is unknown, so nothing after it can be read
+        FIRCLSSDKLog("Unable to decode binary section in %s\n", path);
+        break;
+      }
+    } else {
+      NSUInteger lineEnd = offset;
+      while (lineEnd < length && bytes[lineEnd] != '\n' &&
+             bytes[lineEnd] != FIRCLSFileBinarySectionMarker) {
+        lineEnd++;
+      }
+
+      NSData* data = [contents subdataWithRange:NSMakeRange(offset, lineEnd - offset)];
+      offset = (lineEnd < length && bytes[lineEnd] == '\n') ? lineEnd + 1 : lineEnd;
+
+      if (data.length > 0) {
+        obj = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+      }
+    }
 
-    id obj = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
     if (!obj) {
       continue;
     }
@@ -645,8 +988,50 @@ NSArray* FIRCLSFileReadSections(const char* path,
   return array;
 }
 
+bool FIRCLSFileConvertBinaryRecordsToJSON(const char* path) {
+  if (!FIRCLSIsValidPointer(path)) {
+    FIRCLSSDKLogError("Error: input path is invalid\n");
+    return false;
+  }
+
+  NSString* pathString = [NSString stringWithUTF8String:path];
+  NSData* contents = [NSData dataWithContentsOfFile:pathString];
+
+  if (!contents) {
+    FIRCLSSDKLog("Unable to read file %s\n", path);
+    return false;
+  }
+
+  if (contents.length == 0 ||
+      !memchr(contents.bytes, FIRCLSFileBinarySectionMarker, contents.length)) {
+    return true;
+  }
+
+  NSMutableData* json = [NSMutableData dataWithCapacity:contents.length * 2];
+
+  for (id section in FIRCLSFileReadSections(path, false, nil)) {
+    NSData* data = [NSJSONSerialization dataWithJSONObject:section options:0 error:nil];
+    if (!data) {
+      continue;
+    }
+
+    [json appendData:data];
+    [json appendBytes:"\n" length:1];
+  }
+
+  if (![json writeToFile:pathString atomically:YES]) {
+    FIRCLSSDKLog("Unable to rewrite binary records in %s\n", path);
+    return false;
+  }
+
+  return true;
+}
+
 NSString* FIRCLSFileHexEncodeString(const char* string) {
-  size_t length = strlen(string);
+  return FIRCLSFileHexEncodeBytes((const uint8_t*)string, strlen(string));
+}
+
+static NSString* FIRCLSFileHexEncodeBytes(const uint8_t* bytes, size_t length) {
   char* encodedBuffer = malloc(length * 2 + 1);
 
   if (!encodedBuffer) {
@@ -658,7 +1043,7 @@ NSString* FIRCLSFileHexEncodeString(const char* string) {
 
   int bufferIndex = 0;
   for (int i = 0; i < length; ++i) {
-    FIRCLSHexFromByte(string[i], &encodedBuffer[bufferIndex]);
+    FIRCLSHexFromByte(bytes[i], &encodedBuffer[bufferIndex]);
 
     bufferIndex += 2;  // 1 char => 2 hex values at a time
   }
@@ -15,26 +15,35 @@
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSProfiling.h"
 
 #include <mach/mach_time.h>
+#include <stdatomic.h>
 #include <stdio.h>
 
+static _Atomic uint64_t _firclsStartupPhaseNanoseconds[FIRCLSStartupPhaseCount];
+
 FIRCLSProfileMark FIRCLSProfilingStart(void) {
   return mach_absolute_time();
 }
 
-double FIRCLSProfileEnd(FIRCLSProfileMark mark) {
+static uint64_t FIRCLSProfileNanosecondsSince(FIRCLSProfileMark mark) {
   uint64_t duration = mach_absolute_time() - mark;
 
   mach_timebase_info_data_t info;
   mach_timebase_info(&info);
 
   if (info.denom == 0) {
-    return 0.0;
+    return 0;
   }
 
   // Convert to nanoseconds
   duration *= info.numer;
   duration /= info.denom;
 
+  return duration;
+}
+
+double FIRCLSProfileEnd(FIRCLSProfileMark mark) {
+  uint64_t duration = FIRCLSProfileNanosecondsSince(mark);
+
   return (double)duration / (double)NSEC_PER_MSEC;  // return time in milliseconds
 }
 
@@ -45,3 +54,44 @@ void FIRCLSProfileBlock(const char* label, void (^block)(void)) {
 
   fprintf(stderr, "[Profile] %s: %f ms\n", label, FIRCLSProfileEnd(mark));
 }
+
+void FIRCLSProfileRecordStartupPhase(FIRCLSStartupPhase phase, FIRCLSProfileMark mark) {
+  if ((unsigned)phase >= FIRCLSStartupPhaseCount) {
+    return;
+  }
+
+  atomic_fetch_add_explicit(&_firclsStartupPhaseNanoseconds[phase],
+                            FIRCLSProfileNanosecondsSince(mark), memory_order_relaxed);
+}
+
+double FIRCLSProfileStartupPhaseDuration(FIRCLSStartupPhase phase) {
+  if ((unsigned)phase >= FIRCLSStartupPhaseCount) {
+    return 0.0;
+  }
+
+  uint64_t duration =
+      atomic_load_explicit(&_firclsStartupPhaseNanoseconds[phase], memory_order_relaxed);
+
+  return (double)duration / (double)NSEC_PER_MSEC;
+}
+
+const char* FIRCLSProfileStartupPhaseName(FIRCLSStartupPhase phase) {
+  switch (phase) {
+    case FIRCLSStartupPhaseContextInit:
+      return "context init";
+    case FIRCLSStartupPhaseBinaryImageRegistration:
+      return "binary image registration";
+    case FIRCLSStartupPhaseSignalHandlers:
+      return "signal handlers";
+    case FIRCLSStartupPhaseMachExceptionHandler:
+      return "mach exception handler";
+    case FIRCLSStartupPhaseExceptionHandler:
+      return "exception handler";
+    case FIRCLSStartupPhaseReportProcessing:
+      return "report processing";
+    case FIRCLSStartupPhaseCount:
+      break;
+  }
+
+  return "unknown";
+}
@@ -18,6 +18,17 @@
 
 typedef uint64_t FIRCLSProfileMark;
 
+// The phases of starting Crashlytics that are timed, see FIRCLSProfileRecordStartupPhase.
+typedef enum {
+  FIRCLSStartupPhaseContextInit,
+  FIRCLSStartupPhaseBinaryImageRegistration,
+  FIRCLSStartupPhaseSignalHandlers,
+  FIRCLSStartupPhaseMachExceptionHandler,
+  FIRCLSStartupPhaseExceptionHandler,
+  FIRCLSStartupPhaseReportProcessing,
+  FIRCLSStartupPhaseCount
+} FIRCLSStartupPhase;
+
 __BEGIN_DECLS
 
 // high-resolution timing, returning the results in seconds
@@ -26,4 +37,12 @@ double FIRCLSProfileEnd(FIRCLSProfileMark mark);
 
 void FIRCLSProfileBlock(const char* label, void (^block)(void));
 
+// Adds the time since mark to the total of the phase. Phases can run concurrently, and a phase that
+// runs more than once, like processing each report, accumulates. Safe to call from any thread.
+void FIRCLSProfileRecordStartupPhase(FIRCLSStartupPhase phase, FIRCLSProfileMark mark);
+
+// The total time recorded for the phase so far, in milliseconds.
+double FIRCLSProfileStartupPhaseDuration(FIRCLSStartupPhase phase);
+const char* FIRCLSProfileStartupPhaseName(FIRCLSStartupPhase phase);
+
 __END_DECLS
@@ -28,6 +28,7 @@ extern NSString *const FIRCLSReportErrorAFile;
 extern NSString *const FIRCLSReportErrorBFile;
 extern NSString *const FIRCLSReportLogAFile;
 extern NSString *const FIRCLSReportLogBFile;
+extern NSString *const FIRCLSReportLogRingFile;
 extern NSString *const FIRCLSReportMetadataFile;
 extern NSString *const FIRCLSReportInternalIncrementalKVFile;
 extern NSString *const FIRCLSReportInternalCompactedKVFile;
@@ -34,6 +34,8 @@ NSString *const FIRCLSReportErrorAFile = @"errors_a.clsrecord";
 NSString *const FIRCLSReportErrorBFile = @"errors_b.clsrecord";
 NSString *const FIRCLSReportLogAFile = @"log_a.clsrecord";
 NSString *const FIRCLSReportLogBFile = @"log_b.clsrecord";
+// Not a .clsrecord, so that it's never uploaded as is. See FIRCLSUserLoggingRing.h.
+NSString *const FIRCLSReportLogRingFile = @"log_ring.clsring";
 NSString *const FIRCLSReportInternalIncrementalKVFile = @"internal_incremental_kv.clsrecord";
 NSString *const FIRCLSReportInternalCompactedKVFile = @"internal_compacted_kv.clsrecord";
 NSString *const FIRCLSReportUserIncrementalKVFile = @"user_incremental_kv.clsrecord";
@@ -18,6 +18,7 @@
 #import "Crashlytics/Crashlytics/Models/Record/FIRCLSReportAdapter_Private.h"
 
 #import "Crashlytics/Crashlytics/Helpers/FIRCLSLogger.h"
+#import "Crashlytics/Crashlytics/Helpers/FIRCLSProfiling.h"
 #import "Crashlytics/Crashlytics/Models/FIRCLSInternalReport.h"
 
 #import "Crashlytics/Crashlytics/Components/FIRCLSUserLogging.h"
@@ -44,16 +45,10 @@
     _installIDModel = installIDModel;
 
     [self loadMetaDataFile];
-
-    _report = [self protoReport];
   }
   return self;
 }
 
-- (void)dealloc {
-  pb_release(google_crashlytics_Report_fields, &_report);
-}
-
 //
 // MARK: Load from persisted crash files
 //
@@ -121,11 +116,17 @@
 // MARK: GDTCOREventDataObject
 //
 
+/// The report is only built from the files here, and released as soon as it is encoded, so the
+/// contents of a report's files are only held in memory while it is being handed over to
+/// GoogleDataTransport, which compresses it when uploading.
 - (NSData *)transportBytes {
+  FIRCLSProfileMark mark = FIRCLSProfilingStart();
+  google_crashlytics_Report report = [self protoReport];
+
   pb_ostream_t sizestream = PB_OSTREAM_SIZING;
 
   // Encode 1 time to determine the size.
-  if (!pb_encode(&sizestream, google_crashlytics_Report_fields, &_report)) {
+  if (!pb_encode(&sizestream, google_crashlytics_Report_fields, &report)) {
     FIRCLSErrorLog(@"Error in nanopb encoding for size: %s", PB_GET_ERROR(&sizestream));
   }
 
@@ -134,10 +135,22 @@
   CFMutableDataRef dataRef = CFDataCreateMutable(CFAllocatorGetDefault(), bufferSize);
   CFDataSetLength(dataRef, bufferSize);
   pb_ostream_t ostream = pb_ostream_from_buffer((void *)CFDataGetBytePtr(dataRef), bufferSize);
-  if (!pb_encode(&ostream, google_crashlytics_Report_fields, &_report)) {
+  if (!pb_encode(&ostream, google_crashlytics_Report_fields, &report)) {
     FIRCLSErrorLog(@"Error in nanopb encoding for bytes: %s", PB_GET_ERROR(&ostream));
   }
 
+  size_t filesSize = 0;
+  for (pb_size_t i = 0; i < report.apple_payload.files_count; i++) {
+    if (report.apple_payload.files[i].contents) {
+      filesSize += report.apple_payload.files[i].contents->size;
+    }
+  }
+
+  pb_release(google_crashlytics_Report_fields, &report);
+
+  FIRCLSDebugLog(@"Encoded %zu bytes of report files from %@ into %zu bytes in %.3f ms", filesSize,
+                 self.folderPath.lastPathComponent, bufferSize, FIRCLSProfileEnd(mark));
+
   return CFBridgingRelease(dataRef);
 }
 
@@ -172,12 +185,16 @@
     google_crashlytics_FilesPayload_File file = google_crashlytics_FilesPayload_File_init_default;
     file.filename = FIRCLSEncodeString(clsRecords[i].lastPathComponent);
 
-    NSError *error;
-    file.contents = FIRCLSEncodeData([NSData dataWithContentsOfFile:clsRecords[i]
-                                                            options:0
-                                                              error:&error]);
-    if (error) {
-      FIRCLSErrorLog(@"Failed to read from %@ with error: %@", clsRecords[i], error);
+    // Map the file rather than reading it, and drop the mapping before the next file, so the
+    // encoded copy is the only one of each file on the heap.
+    @autoreleasepool {
+      NSError *error;
+      file.contents = FIRCLSEncodeData([NSData dataWithContentsOfFile:clsRecords[i]
+                                                              options:NSDataReadingMappedIfSafe
+                                                                error:&error]);
+      if (error) {
+        FIRCLSErrorLog(@"Failed to read from %@ with error: %@", clsRecords[i], error);
+      }
     }
 
     files[i] = file;
@@ -35,8 +35,6 @@ pb_bytes_array_t *FIRCLSEncodeData(NSData *data);
 @property(nonatomic, strong) FIRCLSRecordHost *host;
 @property(nonatomic, strong) FIRCLSRecordApplication *application;
 
-@property(nonatomic) google_crashlytics_Report report;
-
 - (google_crashlytics_Report)protoReport;
 - (NSArray<NSString *> *)clsRecordFilePaths;
 
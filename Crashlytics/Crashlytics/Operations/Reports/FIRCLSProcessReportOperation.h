@@ -27,4 +27,9 @@
 @property(nonatomic, readonly) FIRCLSSymbolResolver *symbolResolver;
 @property(nonatomic, readonly) FIRCLSInternalReport *report;
 
+// Rewrites the report's crash files recorded in the binary FIRCLSFile encoding, and its user log
+// ring, as JSON text, the format they are uploaded in. This is done as part of processing, and
+// must be called directly for reports that are uploaded without processing.
++ (void)convertBinaryRecordsInReport:(FIRCLSInternalReport *)report;
+
 @end
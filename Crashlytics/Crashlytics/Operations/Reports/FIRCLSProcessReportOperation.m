@@ -14,7 +14,9 @@
 
 #import "Crashlytics/Crashlytics/Operations/Reports/FIRCLSProcessReportOperation.h"
 
+#import "Crashlytics/Crashlytics/Components/FIRCLSUserLoggingRing.h"
 #import "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
+#import "Crashlytics/Crashlytics/Helpers/FIRCLSLogger.h"
 #import "Crashlytics/Crashlytics/Models/FIRCLSInternalReport.h"
 #import "Crashlytics/Crashlytics/Models/FIRCLSSymbolResolver.h"
 #import "Crashlytics/Crashlytics/Operations/Symbolication/FIRCLSDemangleOperation.h"
@@ -100,7 +102,31 @@
   return YES;
 }
 
++ (void)convertBinaryRecordsInReport:(FIRCLSInternalReport *)report {
+  NSFileManager *manager = [NSFileManager defaultManager];
+
+  [report enumerateSymbolicatableFilesInContent:^(NSString *path) {
+    if (![manager fileExistsAtPath:path]) {
+      return;
+    }
+
+    if (!FIRCLSFileConvertBinaryRecordsToJSON([path fileSystemRepresentation])) {
+      FIRCLSErrorLog(@"Unable to convert binary records in %@", path.lastPathComponent);
+    }
+  }];
+
+  NSString *ringPath = [report pathForContentFile:FIRCLSReportLogRingFile];
+  NSString *logPath = [report pathForContentFile:FIRCLSReportLogAFile];
+  if (!FIRCLSUserLoggingRingConvertToLogFile([ringPath fileSystemRepresentation],
+                                             [logPath fileSystemRepresentation])) {
+    FIRCLSErrorLog(@"Unable to convert the user log ring");
+  }
+}
+
 - (void)main {
+  // Convert first, so the crash files are in the upload format even if they can't be symbolicated
+  [FIRCLSProcessReportOperation convertBinaryRecordsInReport:self.report];
+
   if (![self.symbolResolver loadBinaryImagesFromFile:self.binaryImagePath]) {
     return;
   }
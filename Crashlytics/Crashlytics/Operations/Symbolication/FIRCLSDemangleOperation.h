@@ -19,6 +19,10 @@
 + (NSString *)demangleSymbol:(const char *)symbol;
 + (NSString *)demangleCppSymbol:(const char *)symbol;
 
+// Like demangleSymbol:, but remembers the result for the rest of the process, so a symbol that
+// appears in several frames or reports is only demangled once.
++ (NSString *)cachedDemangledSymbol:(NSString *)symbol;
+
 - (NSString *)demangleSymbol:(const char *)symbol;
 
 @end
@@ -17,6 +17,9 @@
 
 #import <cxxabi.h>
 
+// Enough for the distinct symbols of a batch of reports, which mostly share their frames.
+static const NSUInteger FIRCLSDemangledSymbolCacheCountLimit = 4096;
+
 @implementation FIRCLSDemangleOperation
 
 + (NSString *)demangleSymbol:(const char *)symbol {
@@ -79,13 +82,41 @@
   return result;
 }
 
++ (NSCache<NSString *, id> *)demangledSymbolCache {
+  static NSCache<NSString *, id> *cache;
+  static dispatch_once_t onceToken;
+
+  dispatch_once(&onceToken, ^{
+    cache = [[NSCache alloc] init];
+    cache.countLimit = FIRCLSDemangledSymbolCacheCountLimit;
+  });
+
+  return cache;
+}
+
++ (NSString *)cachedDemangledSymbol:(NSString *)symbol {
+  if (!symbol) {
+    return nil;
+  }
+
+  NSCache<NSString *, id> *cache = [self demangledSymbolCache];
+  id demangledSymbol = [cache objectForKey:symbol];
+
+  if (!demangledSymbol) {
+    demangledSymbol = [self demangleSymbol:[symbol UTF8String]] ?: [NSNull null];
+    [cache setObject:demangledSymbol forKey:symbol];
+  }
+
+  return demangledSymbol == [NSNull null] ? nil : demangledSymbol;
+}
+
 - (NSString *)demangleSymbol:(const char *)symbol {
   return [[self class] demangleSymbol:symbol];
 }
 
 - (void)main {
   [self enumerateFramesWithBlock:^(FIRStackFrame *frame) {
-    NSString *demangedSymbol = [self demangleSymbol:[[frame rawSymbol] UTF8String]];
+    NSString *demangedSymbol = [[self class] cachedDemangledSymbol:[frame rawSymbol]];
 
     if (demangedSymbol) {
       [frame setSymbol:demangedSymbol];
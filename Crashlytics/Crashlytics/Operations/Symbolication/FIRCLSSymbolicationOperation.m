@@ -15,12 +15,34 @@
 #import "Crashlytics/Crashlytics/Operations/Symbolication/FIRCLSSymbolicationOperation.h"
 
 #import "Crashlytics/Crashlytics/Models/FIRCLSSymbolResolver.h"
+#import "Crashlytics/Crashlytics/Private/FIRStackFrame_Private.h"
 
 @implementation FIRCLSSymbolicationOperation
 
 - (void)main {
+  // The threads of a report share most of their outer frames, so each address is only looked up
+  // once and the other frames at it are copied from the first.
+  NSMutableDictionary<NSNumber *, id> *resolvedFrames = [NSMutableDictionary dictionary];
+
   [self enumerateFramesWithBlock:^(FIRStackFrame *frame) {
-    [self.symbolResolver updateStackFrame:frame];
+    NSNumber *address = @(frame.address);
+    id resolvedFrame = [resolvedFrames objectForKey:address];
+
+    if (!resolvedFrame) {
+      BOOL resolved = [self.symbolResolver updateStackFrame:frame];
+      [resolvedFrames setObject:resolved ? frame : [NSNull null] forKey:address];
+      return;
+    }
+
+    if (resolvedFrame == [NSNull null]) {
+      return;
+    }
+
+    FIRStackFrame *sourceFrame = resolvedFrame;
+    [frame setSymbol:sourceFrame.symbol];
+    [frame setRawSymbol:sourceFrame.rawSymbol];
+    [frame setLibrary:sourceFrame.library];
+    [frame setOffset:sourceFrame.offset];
   }];
 }
 
@@ -124,19 +124,33 @@ bool FIRCLSCompactUnwindLookupFirstLevel(FIRCLSCompactUnwindContext* context, ui
 
   address -= context->loadAddress;  // search relative to zero
 
-  // minus one because of the extra entry - see comment above
-  for (uint32_t index = 0; index < indexCount - 1; ++index) {
-    uint32_t value = indexEntries[index].functionOffset;
-    uint32_t nextValue = indexEntries[index + 1].functionOffset;
-
-    if (address >= value && address < nextValue) {
-      context->firstLevelNextFunctionOffset = nextValue;
-      context->indexHeader = indexEntries[index];
-      return true;
+  // The entries are sorted by function offset, so binary search for the last one that starts at
+  // or before the address. Minus one because of the extra entry - see comment above. Large
+  // binaries have thousands of entries, and this runs for every frame of every thread.
+  uint32_t low = 0;
+  uint32_t high = indexCount - 1;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (indexEntries[middle].functionOffset <= address) {
+      low = middle + 1;
+    } else {
+      high = middle;
     }
   }
 
-  return false;
+  if (low == 0) {
+    return false;
+  }
+
+  uint32_t index = low - 1;
+  uint32_t nextValue = indexEntries[index + 1].functionOffset;
+  if (address >= nextValue) {
+    return false;
+  }
+
+  context->firstLevelNextFunctionOffset = nextValue;
+  context->indexHeader = indexEntries[index];
+  return true;
 }
 
 uint32_t FIRCLSCompactUnwindGetSecondLevelPageKind(FIRCLSCompactUnwindContext* context) {
@@ -244,10 +244,15 @@ static bool FIRCLSUnwindWithCompactUnwindInfo(FIRCLSUnwindContext* context) {
     return false;
   }
 
-  if (!FIRCLSCompactUnwindInit(&context->compactUnwindState, image.unwindInfo, image.ehFrame,
-                               (uintptr_t)image.baseAddress)) {
-    FIRCLSSDKLogError("Unable to read unwind info\n");
-    return false;
+  // Consecutive frames are usually in the same image, so only read its unwind info header when
+  // the image changes. A failed init leaves unwindInfo unset, so it is retried.
+  if (context->compactUnwindState.unwindInfo != image.unwindInfo ||
+      context->compactUnwindState.loadAddress != (uintptr_t)image.baseAddress) {
+    if (!FIRCLSCompactUnwindInit(&context->compactUnwindState, image.unwindInfo, image.ehFrame,
+                                 (uintptr_t)image.baseAddress)) {
+      FIRCLSSDKLogError("Unable to read unwind info\n");
+      return false;
+    }
   }
 
   // this function will actually attempt to find compact unwind info for the current PC,
@@ -55,6 +55,16 @@
   XCTAssertNil([self demangle:"__Zinvalid_block_invoke"], @"Invalid Cpp symbol");
 }
 
+- (void)testCachedDemangledSymbol {
+  XCTAssertEqualObjects([FIRCLSDemangleOperation cachedDemangledSymbol:@"_Z7monitorP8NSStringlS0_"],
+                        @"monitor(NSString*, long, NSString*)", @"");
+  XCTAssertEqualObjects([FIRCLSDemangleOperation cachedDemangledSymbol:@"_Z7monitorP8NSStringlS0_"],
+                        @"monitor(NSString*, long, NSString*)", @"");
+  XCTAssertNil([FIRCLSDemangleOperation cachedDemangledSymbol:@"unmangledSymbol"], @"");
+  XCTAssertNil([FIRCLSDemangleOperation cachedDemangledSymbol:@"unmangledSymbol"], @"");
+  XCTAssertNil([FIRCLSDemangleOperation cachedDemangledSymbol:nil], @"");
+}
+
 - (void)testOperation {
   NSMutableArray *frameArray = [[NSMutableArray alloc] init];
   [frameArray addObject:[FIRStackFrame stackFrameWithSymbol:@"_Z7monitorP8NSStringlS0_"]];
@@ -427,4 +427,133 @@
   free(input);
 }
 
+#pragma mark -
+
+- (void)testBinaryRecords {
+  _unbufferedFile.binary = true;
+  _bufferedFile.binary = true;
+
+  [self binaryRecordsWithFile:&_unbufferedFile filePath:self.unbufferedPath buffered:NO];
+  [self binaryRecordsWithFile:&_bufferedFile filePath:self.bufferedPath buffered:YES];
+}
+
+- (void)binaryRecordsWithFile:(FIRCLSFile *)file
+                     filePath:(NSString *)filePath
+                     buffered:(BOOL)buffered {
+  FIRCLSFileWriteSectionStart(file, "values");
+  FIRCLSFileWriteHashStart(file);
+  FIRCLSFileWriteHashEntryInt64(file, "negative", INT64_MIN);
+  FIRCLSFileWriteHashEntryUint64(file, "big", 0xFFFFFFFFFFFFFFFF);
+  FIRCLSFileWriteHashEntryString(file, "name", "abc");
+  FIRCLSFileWriteHashEntryString(file, "missing", NULL);
+  FIRCLSFileWriteHashEntryHexEncodedString(file, "hex", "a\"b");
+  FIRCLSFileWriteHashEntryBoolean(file, "flag", true);
+  FIRCLSFileWriteHashKey(file, "list");
+  FIRCLSFileWriteArrayStart(file);
+  FIRCLSFileWriteArrayEntryUint64(file, 1);
+  FIRCLSFileWriteArrayEntryString(file, "two");
+  FIRCLSFileWriteArrayEntryHexEncodedString(file, "3");
+  FIRCLSFileWriteArrayEnd(file);
+  FIRCLSFileWriteHashEnd(file);
+  FIRCLSFileWriteSectionEnd(file);
+
+  FIRCLSFileWriteSectionStart(file, "empty");
+  FIRCLSFileWriteHashStart(file);
+  FIRCLSFileWriteHashEnd(file);
+  FIRCLSFileWriteSectionEnd(file);
+
+  if (buffered) {
+    FIRCLSFileFlushWriteBuffer(file);
+  }
+
+  NSArray *sections = FIRCLSFileReadSections([filePath fileSystemRepresentation], false, nil);
+  NSDictionary *values = @{
+    @"negative" : @(INT64_MIN),
+    @"big" : @(UINT64_MAX),
+    @"name" : @"abc",
+    @"missing" : [NSNull null],
+    @"hex" : @"612262",
+    @"flag" : @YES,
+    @"list" : @[ @1, @"two", @"33" ]
+  };
+  NSArray *expected = @[ @{@"values" : values}, @{@"empty" : @{}} ];
+  XCTAssertEqualObjects(
+      sections, expected,
+      @"Binary records read back from file do not match input in %@buffered case",
+      buffered ? @"" : @"un");
+}
+
+- (void)testReadingBinaryRecordsAfterJSON {
+  FIRCLSFileWriteSectionStart(&_unbufferedFile, "text");
+  FIRCLSFileWriteHashStart(&_unbufferedFile);
+  FIRCLSFileWriteHashEntryUint64(&_unbufferedFile, "value", 1);
+  FIRCLSFileWriteHashEnd(&_unbufferedFile);
+  FIRCLSFileWriteSectionEnd(&_unbufferedFile);
+
+  _unbufferedFile.binary = true;
+  FIRCLSFileWriteSectionStart(&_unbufferedFile, "binary");
+  FIRCLSFileWriteHashStart(&_unbufferedFile);
+  FIRCLSFileWriteHashEntryUint64(&_unbufferedFile, "value", 2);
+  FIRCLSFileWriteHashEnd(&_unbufferedFile);
+  FIRCLSFileWriteSectionEnd(&_unbufferedFile);
+
+  NSArray *sections =
+      FIRCLSFileReadSections([self.unbufferedPath fileSystemRepresentation], false, nil);
+  NSArray *expected = @[ @{@"text" : @{@"value" : @1}}, @{@"binary" : @{@"value" : @2}} ];
+  XCTAssertEqualObjects(sections, expected);
+}
+
+- (void)testConvertingBinaryRecordsToJSON {
+  _unbufferedFile.binary = true;
+  FIRCLSFileWriteSectionStart(&_unbufferedFile, "signal");
+  FIRCLSFileWriteHashStart(&_unbufferedFile);
+  FIRCLSFileWriteHashEntryUint64(&_unbufferedFile, "number", 11);
+  FIRCLSFileWriteHashEnd(&_unbufferedFile);
+  FIRCLSFileWriteSectionEnd(&_unbufferedFile);
+
+  XCTAssertNotEqualObjects([self contentsOfFileAtPath:self.unbufferedPath],
+                           @"{\"signal\":{\"number\":11}}\n");
+
+  XCTAssertTrue(
+      FIRCLSFileConvertBinaryRecordsToJSON([self.unbufferedPath fileSystemRepresentation]));
+  XCTAssertEqualObjects([self contentsOfFileAtPath:self.unbufferedPath],
+                        @"{\"signal\":{\"number\":11}}\n");
+
+  // converting JSON text leaves it unchanged
+  XCTAssertTrue(
+      FIRCLSFileConvertBinaryRecordsToJSON([self.unbufferedPath fileSystemRepresentation]));
+  XCTAssertEqualObjects([self contentsOfFileAtPath:self.unbufferedPath],
+                        @"{\"signal\":{\"number\":11}}\n");
+}
+
+#pragma mark -
+
+- (void)testCrashRecordWritesThroughBuffer {
+  NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"crash_record_test"];
+  [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+
+  char *buffer = malloc(CLS_FILE_CRASH_RECORD_BUFFER_SIZE);
+  FIRCLSFile file;
+  XCTAssertTrue(FIRCLSFileInitCrashRecordWithPath(&file, [path fileSystemRepresentation], buffer,
+                                                  CLS_FILE_CRASH_RECORD_BUFFER_SIZE));
+
+  FIRCLSFileWriteSectionStart(&file, "threads");
+  FIRCLSFileWriteArrayStart(&file);
+  for (uint64_t i = 0; i < 1000; ++i) {
+    FIRCLSFileWriteArrayEntryUint64(&file, i);
+  }
+  FIRCLSFileWriteArrayEnd(&file);
+  FIRCLSFileWriteSectionEnd(&file);
+
+  XCTAssertEqual(file.writeCount, 1, @"A section smaller than the buffer should take one write");
+
+  XCTAssertTrue(FIRCLSFileClose(&file));
+  free(buffer);
+
+  NSArray *sections = FIRCLSFileReadSections([path fileSystemRepresentation], false, nil);
+  XCTAssertEqual(sections.count, 1);
+  XCTAssertEqual([sections[0][@"threads"] count], 1000);
+  XCTAssertEqualObjects(sections[0][@"threads"][999], @999);
+}
+
 @end
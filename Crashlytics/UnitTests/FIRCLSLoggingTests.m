@@ -360,6 +360,36 @@
                         @"");  // "some value 1905"
 }
 
+- (void)testUserLogRing {
+  NSString* ringPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"log.clsring"];
+  FIRCLSUserLoggingRing* ring = &_firclsContext.readonly->logging.logRing;
+
+  XCTAssertTrue(FIRCLSUserLoggingRingOpen(ring, [ringPath fileSystemRepresentation], 1024));
+  _firclsContext.readonly->logging.logStorage.ring = ring;
+
+  // more than fits, so the oldest messages are overwritten
+  for (int i = 0; i < 100; ++i) {
+    FIRCLSLog(@"some value %d", i);
+  }
+
+  _firclsContext.readonly->logging.logStorage.ring = NULL;
+  FIRCLSUserLoggingRingClose(ring);
+
+  XCTAssertEqual([[self logAContents] count], 0, @"Logs should only be written to the ring");
+
+  XCTAssertTrue(FIRCLSUserLoggingRingConvertToLogFile([ringPath fileSystemRepresentation],
+                                                      [self.logAPath fileSystemRepresentation]));
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:ringPath]);
+
+  // a 1024 byte ring holds the last 10 messages, one per slot
+  NSArray* logA = [self logAContents];
+  XCTAssertEqual([logA count], 10, @"");
+  XCTAssertEqualObjects(logA[0][@"log"][@"msg"], @"736f6d652076616c7565203930",
+                        @"");  // "some value 90"
+  XCTAssertEqualObjects(logA[9][@"log"][@"msg"], @"736f6d652076616c7565203939",
+                        @"");  // "some value 99"
+}
+
 - (void)testLoggedError {
   NSError* error = [NSError errorWithDomain:@"My Custom Domain"
                                        code:-1
@@ -26,6 +26,7 @@
 #import "Crashlytics/UnitTests/Mocks/FIRMockInstallations.h"
 
 #import <GoogleDataTransport/GoogleDataTransport.h>
+#import <nanopb/pb_decode.h>
 
 @interface FIRCLSReportAdapterTests : XCTestCase
 @property(nonatomic, strong) FIRCLSInstallIdentifierModel *installIDModel;
@@ -140,6 +141,24 @@
   }
 }
 
+- (void)testTransportBytesContainFiles {
+  FIRCLSReportAdapter *adapter = [self adapterForAllCrashes];
+  NSData *data = adapter.transportBytes;
+
+  google_crashlytics_Report report = google_crashlytics_Report_init_default;
+  pb_istream_t istream = pb_istream_from_buffer(data.bytes, data.length);
+  XCTAssertTrue(pb_decode(&istream, google_crashlytics_Report_fields, &report));
+
+  NSArray<NSString *> *clsRecords = adapter.clsRecordFilePaths;
+  XCTAssertEqual(report.apple_payload.files_count, clsRecords.count);
+  for (NSUInteger i = 0; i < clsRecords.count; i++) {
+    NSData *fileData = [NSData dataWithContentsOfFile:clsRecords[i] options:0 error:nil];
+    XCTAssertTrue([self isPBData:report.apple_payload.files[i].contents equalToData:fileData]);
+  }
+
+  pb_release(google_crashlytics_Report_fields, &report);
+}
+
 // Helper functions
 #pragma mark - Helper Functions
 
@@ -71,4 +71,35 @@
   XCTAssertEqual([((FIRStackFrame*)frameArray[1]) offset], 20, @"");
 }
 
+- (void)testOperationWithRepeatedAddresses {
+  FIRCLSMockSymbolResolver* resolver = [[FIRCLSMockSymbolResolver alloc] init];
+
+  FIRStackFrame* frame = [FIRStackFrame stackFrameWithSymbol:@"testSymbolA"];
+  [frame setLibrary:@"libA"];
+  [frame setOffset:10];
+
+  [resolver addMockFrame:frame atAddress:100];
+
+  NSMutableArray* frameArrayA = [[NSMutableArray alloc] init];
+  [frameArrayA addObject:[FIRStackFrame stackFrameWithAddress:100]];
+  [frameArrayA addObject:[FIRStackFrame stackFrameWithAddress:300]];
+
+  NSMutableArray* frameArrayB = [[NSMutableArray alloc] init];
+  [frameArrayB addObject:[FIRStackFrame stackFrameWithAddress:300]];
+  [frameArrayB addObject:[FIRStackFrame stackFrameWithAddress:100]];
+
+  FIRCLSSymbolicationOperation* op = [[FIRCLSSymbolicationOperation alloc] init];
+
+  [op setSymbolResolver:resolver];
+  [op setThreadArray:@[ frameArrayA, frameArrayB ]];
+
+  [op start];
+
+  XCTAssertEqualObjects([frameArrayB[1] symbol], @"testSymbolA", @"");
+  XCTAssertEqualObjects([frameArrayB[1] library], @"libA", @"");
+  XCTAssertEqual([((FIRStackFrame*)frameArrayB[1]) offset], 10, @"");
+  XCTAssertNil([frameArrayA[1] symbol], @"");
+  XCTAssertNil([frameArrayB[0] symbol], @"");
+}
+
 @end
@@ -222,9 +222,22 @@
 }
 
 + (FCompoundHash *)fromNode:(id<FNode>)node {
-    return [FCompoundHash
-             fromNode:node
-        splitStrategy:[FCompoundHash simpleSizeSplitStrategyForNode:node]];
+    if ([node isEmpty] || [node isLeafNode]) {
+        return [FCompoundHash
+                 fromNode:node
+            splitStrategy:[FCompoundHash simpleSizeSplitStrategyForNode:node]];
+    }
+
+    // The hash only depends on the node, so it is memoized on the node:
+    // listening again to an unchanged tree, e.g. after reconnecting, doesn't
+    // walk it again.
+    FChildrenNode *childrenNode = (FChildrenNode *)node;
+    if (childrenNode.lazyCompoundHash == nil) {
+        childrenNode.lazyCompoundHash = [FCompoundHash
+                 fromNode:node
+            splitStrategy:[FCompoundHash simpleSizeSplitStrategyForNode:node]];
+    }
+    return childrenNode.lazyCompoundHash;
 }
 
 + (FCompoundHash *)fromNode:(id<FNode>)node
@@ -21,6 +21,7 @@
 #import "FirebaseDatabase/Sources/Core/Utilities/FPath.h"
 #import "FirebaseDatabase/Sources/Core/View/FCacheNode.h"
 #import "FirebaseDatabase/Sources/FIndex.h"
+#import "FirebaseDatabase/Sources/FKeyIndex.h"
 #import "FirebaseDatabase/Sources/FNamedNode.h"
 #import "FirebaseDatabase/Sources/Snapshot/FChildrenNode.h"
 #import "FirebaseDatabase/Sources/Snapshot/FCompoundWrite.h"
@@ -430,6 +431,25 @@
         return nil;
     }
 
+    if ([index isEqual:[FKeyIndex keyIndex]] &&
+        [toIterate isKindOfClass:[FChildrenNode class]]) {
+        // Children are sorted by key, so the next child can be looked up
+        // directly instead of comparing against every child
+        FImmutableSortedDictionary *children =
+            ((FChildrenNode *)toIterate).children;
+        NSEnumerator *enumerator =
+            reverse ? [children reverseKeyEnumeratorFrom:post.name]
+                    : [children keyEnumeratorFrom:post.name];
+        NSString *nextKey = [enumerator nextObject];
+        if (nextKey != nil && [nextKey isEqualToString:post.name]) {
+            nextKey = [enumerator nextObject];
+        }
+        return nextKey != nil
+                   ? [FNamedNode nodeWithName:nextKey
+                                         node:[children get:nextKey]]
+                   : nil;
+    }
+
     __block NSString *currentNextKey = nil;
     __block id<FNode> currentNextNode = nil;
     [toIterate enumerateChildrenUsingBlock:^(NSString *key, id<FNode> node,
@@ -42,8 +42,8 @@
     return self;
 }
 
-- (void)fireEventOnQueue:(dispatch_queue_t)queue {
-    [self.eventRegistration fireEvent:self queue:queue];
+- (fbt_void_void)callback {
+    return [self.eventRegistration callbackForEvent:self];
 }
 
 - (BOOL)isCancelEvent {
@@ -67,8 +67,8 @@
     }
 }
 
-- (void)fireEventOnQueue:(dispatch_queue_t)queue {
-    [self.eventRegistration fireEvent:self queue:queue];
+- (fbt_void_void)callback {
+    return [self.eventRegistration callbackForEvent:self];
 }
 
 - (BOOL)isCancelEvent {
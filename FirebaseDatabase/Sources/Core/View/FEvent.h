@@ -15,13 +15,14 @@
  */
 
 #import "FirebaseDatabase/Sources/Public/FirebaseDatabase/FIRDataEventType.h"
+#import "FirebaseDatabase/Sources/Utilities/FTypedefs.h"
 #import <Foundation/Foundation.h>
 
 @class FPath;
 
 @protocol FEvent <NSObject>
 - (FPath *)path;
-- (void)fireEventOnQueue:(dispatch_queue_t)queue;
+- (fbt_void_void)callback;
 - (BOOL)isCancelEvent;
 - (NSString *)description;
 @end
@@ -50,9 +50,24 @@
 }
 
 - (void)raiseEvents:(NSArray *)eventDataList {
+    NSMutableArray *callbacks =
+        [NSMutableArray arrayWithCapacity:eventDataList.count];
     for (id<FEvent> event in eventDataList) {
-        [event fireEventOnQueue:self.queue];
+        fbt_void_void callback = [event callback];
+        if (callback != nil) {
+            [callbacks addObject:callback];
+        }
     }
+    if (callbacks.count == 0) {
+        return;
+    }
+    // Call all of the callbacks of an update from a single block, so a large
+    // update doesn't flood the queue with a block per event
+    dispatch_async(self.queue, ^{
+      for (fbt_void_void callback in callbacks) {
+          callback();
+      }
+    });
 }
 
 - (void)raiseCallback:(fbt_void_void)callback {
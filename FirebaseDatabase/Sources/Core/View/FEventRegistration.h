@@ -16,6 +16,7 @@
 
 #import "FirebaseDatabase/Sources/Core/View/FChange.h"
 #import "FirebaseDatabase/Sources/Public/FirebaseDatabase/FIRDataEventType.h"
+#import "FirebaseDatabase/Sources/Utilities/FTypedefs.h"
 #import <Foundation/Foundation.h>
 
 @protocol FEvent;
@@ -26,7 +27,11 @@
 @protocol FEventRegistration <NSObject>
 - (BOOL)responseTo:(FIRDataEventType)eventType;
 - (FDataEvent *)createEventFrom:(FChange *)change query:(FQuerySpec *)query;
-- (void)fireEvent:(id<FEvent>)event queue:(dispatch_queue_t)queue;
+/**
+ * Returns the block that calls the user's callback for the event, or nil if
+ * there's nothing to call.
+ */
+- (fbt_void_void)callbackForEvent:(id<FEvent>)event;
 - (FCancelEvent *)createCancelEventFromError:(NSError *)error
                                         path:(FPath *)path;
 /**
@@ -63,24 +63,25 @@
     return eventData;
 }
 
-- (void)fireEvent:(id<FEvent>)event queue:(dispatch_queue_t)queue {
+- (fbt_void_void)callbackForEvent:(id<FEvent>)event {
     if ([event isCancelEvent]) {
         FCancelEvent *cancelEvent = event;
         FFLog(@"I-RDB065001", @"Raising cancel value event on %@", event.path);
         NSAssert(
             self.cancelCallback != nil,
             @"Raising a cancel event on a listener with no cancel callback");
-        dispatch_async(queue, ^{
+        return ^{
           self.cancelCallback(cancelEvent.error);
-        });
+        };
     } else if (self.callback != nil) {
         FDataEvent *dataEvent = event;
         FFLog(@"I-RDB065002", @"Raising value event on %@",
               dataEvent.snapshot.key);
-        dispatch_async(queue, ^{
+        return ^{
           self.callback(dataEvent.snapshot);
-        });
+        };
     }
+    return nil;
 }
 
 - (FCancelEvent *)createCancelEventFromError:(NSError *)error
@@ -218,9 +218,11 @@
         filtered = [FIndexedNode indexedNodeWithNode:[FEmptyNode emptyNode]
                                                index:self.index];
     } else {
-        filtered = newSnap;
-        // Don't support priorities on queries.
-        filtered = [filtered updatePriority:[FEmptyNode emptyNode]];
+        // Start from an empty node and only add the children in the window,
+        // rather than removing every child outside of it from `newSnap`.
+        // Priorities aren't supported on queries, so none is set.
+        filtered = [FIndexedNode indexedNodeWithNode:[FEmptyNode emptyNode]
+                                               index:self.index];
         FNamedNode *startPost = nil;
         FNamedNode *endPost = nil;
         if (self.reverse) {
@@ -246,21 +248,25 @@
                                 // Start adding
                                 foundStartPost = YES;
                             }
-                            BOOL inRange = foundStartPost && count < self.limit;
-                            inRange = inRange &&
-                                      [self.index compareKey:childKey
-                                                     andNode:childNode
-                                                  toOtherKey:endPost.name
-                                                     andNode:endPost.node
-                                                     reverse:self.reverse] <=
-                                          NSOrderedSame;
-                            if (inRange) {
-                                count++;
-                            } else {
-                                filtered = [filtered
-                                     updateChild:childKey
-                                    withNewChild:[FEmptyNode emptyNode]];
+                            if (!foundStartPost) {
+                                return;
+                            }
+                            // Children are enumerated in order, so none of the
+                            // remaining ones are in the window once it's full
+                            // or past `endPost`
+                            if (count >= self.limit ||
+                                [self.index compareKey:childKey
+                                               andNode:childNode
+                                            toOtherKey:endPost.name
+                                               andNode:endPost.node
+                                               reverse:self.reverse] >
+                                    NSOrderedSame) {
+                                *stop = YES;
+                                return;
                             }
+                            count++;
+                            filtered = [filtered updateChild:childKey
+                                                withNewChild:childNode];
                           }];
     }
     return [self.indexedFilter updateFullNode:oldSnap
@@ -20,4 +20,6 @@
 
 @interface FPathIndex : NSObject <FIndex>
 - (id)initWithPath:(FPath *)path;
+
+@property(nonatomic, strong, readonly) FPath *path;
 @end
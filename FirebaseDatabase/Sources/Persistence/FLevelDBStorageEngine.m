@@ -25,6 +25,7 @@
 #import "FirebaseDatabase/Sources/Persistence/FPruneForest.h"
 #import "FirebaseDatabase/Sources/Persistence/FTrackedQuery.h"
 #import "FirebaseDatabase/Sources/Snapshot/FEmptyNode.h"
+#import "FirebaseDatabase/Sources/Snapshot/FLeafNode.h"
 #import "FirebaseDatabase/Sources/Snapshot/FSnapshotUtilities.h"
 #import "FirebaseDatabase/Sources/Utilities/FUtilities.h"
 #import "FirebaseDatabase/Sources/third_party/Wrap-leveldb/APLevelDB.h"
@@ -34,6 +35,15 @@
 @property(nonatomic, strong) NSString *basePath;
 @property(nonatomic, strong) APLevelDB *writesDB;
 @property(nonatomic, strong) APLevelDB *serverCacheDB;
+// The tracked keys of all tracked queries by query id, loaded from disk with a
+// single scan the first time they're needed. nil until then.
+@property(nonatomic, strong)
+    NSMutableDictionary<NSNumber *, NSMutableSet<NSString *> *>
+        *trackedQueryKeys;
+// The total size of the server cache rows, computed with a single scan the
+// first time it's needed and then kept up to date by each write.
+@property(nonatomic) NSUInteger serverCacheSize;
+@property(nonatomic) BOOL serverCacheSizeLoaded;
 
 @end
 
@@ -66,6 +76,17 @@ static NSString *const kFTrackedQueryKeysPrefix = @"/tracked_query_keys/";
 // deserializing
 static const NSInteger kFNanFailureCode = 3840;
 
+// Server cache leaves that are strings or booleans are stored as one of these
+// tags, followed by the UTF-8 bytes of the string. Numbers are still stored
+// as JSON, which is also how every leaf was stored before. A JSON primitive
+// always starts with a printable character, so the first byte of a row tells
+// the two apart.
+typedef NS_ENUM(uint8_t, FServerCacheTag) {
+    FServerCacheTagString = 0x01,
+    FServerCacheTagTrue = 0x02,
+    FServerCacheTagFalse = 0x03,
+};
+
 static NSString *writeRecordKey(NSUInteger writeId) {
     return [NSString stringWithFormat:@"%lu", (unsigned long)(writeId)];
 }
@@ -231,6 +252,8 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
 - (void)openDatabases {
     self.serverCacheDB = [self createDB:kFServerDBPath];
     self.writesDB = [self createDB:kFWritesDBPath];
+    self.trackedQueryKeys = nil;
+    self.serverCacheSizeLoaded = NO;
 }
 
 - (void)purgeDatabase:(NSString *)dbPath {
@@ -311,9 +334,9 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
     return db;
 }
 
-- (void)saveUserOverwrite:(id<FNode>)node
-                   atPath:(FPath *)path
-                  writeId:(NSUInteger)writeId {
+- (NSData *)serializedUserOverwrite:(id<FNode>)node
+                             atPath:(FPath *)path
+                            writeId:(NSUInteger)writeId {
     NSDictionary *write = @{
         kFUserWriteId : @(writeId),
         kFUserWritePath : [path toStringWithTrailingSlash],
@@ -325,12 +348,12 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
                                                      error:&error];
     NSAssert(data, @"Failed to serialize user overwrite: %@, (Error: %@)",
              write, error);
-    [self.writesDB setData:data forKey:writeRecordKey(writeId)];
+    return data;
 }
 
-- (void)saveUserMerge:(FCompoundWrite *)merge
-               atPath:(FPath *)path
-              writeId:(NSUInteger)writeId {
+- (NSData *)serializedUserMerge:(FCompoundWrite *)merge
+                         atPath:(FPath *)path
+                        writeId:(NSUInteger)writeId {
     NSDictionary *write = @{
         kFUserWriteId : @(writeId),
         kFUserWritePath : [path toStringWithTrailingSlash],
@@ -342,7 +365,49 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
                                                      error:&error];
     NSAssert(data, @"Failed to serialize user merge: %@ (Error: %@)", write,
              error);
-    [self.writesDB setData:data forKey:writeRecordKey(writeId)];
+    return data;
+}
+
+- (void)saveUserOverwrite:(id<FNode>)node
+                   atPath:(FPath *)path
+                  writeId:(NSUInteger)writeId {
+    [self.writesDB setData:[self serializedUserOverwrite:node
+                                                  atPath:path
+                                                 writeId:writeId]
+                    forKey:writeRecordKey(writeId)];
+}
+
+- (void)saveUserMerge:(FCompoundWrite *)merge
+               atPath:(FPath *)path
+              writeId:(NSUInteger)writeId {
+    [self.writesDB setData:[self serializedUserMerge:merge
+                                              atPath:path
+                                             writeId:writeId]
+                    forKey:writeRecordKey(writeId)];
+}
+
+- (void)saveUserWrites:(NSArray<FWriteRecord *> *)writes {
+    NSDate *start = [NSDate date];
+    id<APLevelDBWriteBatch> batch = [self.writesDB beginWriteBatch];
+    for (FWriteRecord *write in writes) {
+        NSData *data =
+            [write isOverwrite]
+                ? [self serializedUserOverwrite:write.overwrite
+                                         atPath:write.path
+                                        writeId:(NSUInteger)write.writeId]
+                : [self serializedUserMerge:write.merge
+                                     atPath:write.path
+                                    writeId:(NSUInteger)write.writeId];
+        [batch setData:data forKey:writeRecordKey((NSUInteger)write.writeId)];
+    }
+    BOOL success = [batch commit];
+    if (!success) {
+        FFWarn(@"I-RDB076039", @"Failed to save user writes on disk!");
+    } else {
+        FFDebug(@"I-RDB076040", @"Saved %lu user writes in %fms",
+                (unsigned long)writes.count,
+                [start timeIntervalSinceNow] * -1000);
+    }
 }
 
 - (void)removeUserWrite:(NSUInteger)writeId {
@@ -455,14 +520,73 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
     return node;
 }
 
+- (id<FNode>)serverCacheIndexValuesAtPath:(FPath *)path
+                             forIndexPath:(FPath *)indexPath {
+    NSDate *start = [NSDate date];
+    NSString *baseKey = serverCacheKey(path);
+    // Stands in for children without a value at the index path, which sort
+    // as null.
+    id<FNode> placeholder = [[FLeafNode alloc] initWithValue:@YES];
+    id<FNode> node = [FEmptyNode emptyNode];
+    NSMutableArray<NSString *> *childKeys = [NSMutableArray array];
+
+    @autoreleasepool {
+        APLevelDBIterator *iter =
+            [APLevelDBIterator iteratorWithLevelDB:self.serverCacheDB];
+        [iter seekToKey:baseKey];
+        if ([iter.key isEqualToString:baseKey]) {
+            // The location itself is a leaf, there are no children to skip.
+            return [self serverCacheAtPath:path];
+        }
+        // Only visit the first row of each child, then seek past all of its
+        // rows without reading them.
+        while (iter.key != nil && [iter.key hasPrefix:baseKey]) {
+            NSString *rest = [iter.key substringFromIndex:baseKey.length];
+            NSRange slash = [rest rangeOfString:@"/"];
+            if (slash.location == NSNotFound) {
+                FFWarn(@"I-RDB076041", @"Malformed server cache key: %@",
+                       iter.key);
+                [iter nextKey];
+                continue;
+            }
+            NSString *childKey = [rest substringToIndex:slash.location];
+            [childKeys addObject:childKey];
+            // '0' sorts right after '/', so this is past every row of the
+            // child.
+            [iter seekToKey:[NSString stringWithFormat:@"%@%@0", baseKey,
+                                                       childKey]];
+        }
+    }
+
+    for (NSString *childKey in childKeys) {
+        FPath *childPath = [path childFromString:childKey];
+        id data = [self internalNestedDataForPath:[childPath child:indexPath]];
+        id<FNode> child = placeholder;
+        if (data != nil) {
+            child = [[FEmptyNode emptyNode]
+                updateChild:indexPath
+               withNewChild:[FSnapshotUtilities nodeFrom:data]];
+        }
+        node = [node updateImmediateChild:childKey withNewChild:child];
+    }
+    FFDebug(@"I-RDB076042",
+            @"Loaded index values of %d children at %@ in %fms",
+            [node numChildren], path, [start timeIntervalSinceNow] * -1000);
+    return node;
+}
+
 - (void)updateServerCache:(id<FNode>)node
                    atPath:(FPath *)path
                     merge:(BOOL)merge {
     NSDate *start = [NSDate date];
     id<APLevelDBWriteBatch> batch = [self.serverCacheDB beginWriteBatch];
+    NSMutableDictionary *removedRowSizes = [self removedRowSizesForBatch];
     // Remove any leaf nodes that might be higher up
-    [self removeAllLeafNodesOnPath:path batch:batch];
+    [self removeAllLeafNodesOnPath:path
+                             batch:batch
+                   removedRowSizes:removedRowSizes];
     __block NSUInteger counter = 0;
+    __block NSUInteger bytes = 0;
     if (merge) {
         // remove any children that exist
         [node enumerateChildrenUsingBlock:^(NSString *childKey,
@@ -470,23 +594,31 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
           FPath *childPath = [path childFromString:childKey];
           [self removeAllWithPrefix:serverCacheKey(childPath)
                               batch:batch
-                           database:self.serverCacheDB];
+                    removedRowSizes:removedRowSizes];
           [self saveNodeInternal:childNode
                           atPath:childPath
                            batch:batch
-                         counter:&counter];
+                         counter:&counter
+                           bytes:&bytes];
         }];
     } else {
         // remove everything
         [self removeAllWithPrefix:serverCacheKey(path)
                             batch:batch
-                         database:self.serverCacheDB];
-        [self saveNodeInternal:node atPath:path batch:batch counter:&counter];
+                  removedRowSizes:removedRowSizes];
+        [self saveNodeInternal:node
+                        atPath:path
+                         batch:batch
+                       counter:&counter
+                         bytes:&bytes];
     }
     BOOL success = [batch commit];
     if (!success) {
         FFWarn(@"I-RDB076017", @"Failed to update server cache on disk!");
+        self.serverCacheSizeLoaded = NO;
     } else {
+        [self updateServerCacheSizeWithRemovedRowSizes:removedRowSizes
+                                            addedBytes:bytes];
         FFDebug(@"I-RDB076018", @"Saved %lu leaf nodes for overwrite in %fms",
                 (unsigned long)counter, [start timeIntervalSinceNow] * -1000);
     }
@@ -496,23 +628,31 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
                             atPath:(FPath *)path {
     NSDate *start = [NSDate date];
     __block NSUInteger counter = 0;
+    __block NSUInteger bytes = 0;
     id<APLevelDBWriteBatch> batch = [self.serverCacheDB beginWriteBatch];
+    NSMutableDictionary *removedRowSizes = [self removedRowSizesForBatch];
     // Remove any leaf nodes that might be higher up
-    [self removeAllLeafNodesOnPath:path batch:batch];
+    [self removeAllLeafNodesOnPath:path
+                             batch:batch
+                   removedRowSizes:removedRowSizes];
     [merge enumerateWrites:^(FPath *relativePath, id<FNode> node, BOOL *stop) {
       FPath *childPath = [path child:relativePath];
       [self removeAllWithPrefix:serverCacheKey(childPath)
                           batch:batch
-                       database:self.serverCacheDB];
+                removedRowSizes:removedRowSizes];
       [self saveNodeInternal:node
                       atPath:childPath
                        batch:batch
-                     counter:&counter];
+                     counter:&counter
+                       bytes:&bytes];
     }];
     BOOL success = [batch commit];
     if (!success) {
         FFWarn(@"I-RDB076019", @"Failed to update server cache on disk!");
+        self.serverCacheSizeLoaded = NO;
     } else {
+        [self updateServerCacheSizeWithRemovedRowSizes:removedRowSizes
+                                            addedBytes:bytes];
         FFDebug(@"I-RDB076020", @"Saved %lu leaf nodes for merge in %fms",
                 (unsigned long)counter, [start timeIntervalSinceNow] * -1000);
     }
@@ -521,52 +661,72 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
 - (void)saveNodeInternal:(id<FNode>)node
                   atPath:(FPath *)path
                    batch:(id<APLevelDBWriteBatch>)batch
-                 counter:(NSUInteger *)counter {
+                 counter:(NSUInteger *)counter
+                   bytes:(NSUInteger *)bytes {
     id data = [node valForExport:YES];
     if (data != nil && ![data isKindOfClass:[NSNull class]]) {
         [self internalSetNestedData:data
                              forKey:serverCacheKey(path)
                           withBatch:batch
-                            counter:counter];
+                            counter:counter
+                              bytes:bytes];
     }
 }
 
 - (NSUInteger)serverCacheEstimatedSizeInBytes {
-    // Use the exact size, because for pruning the approximate size can lead to
-    // weird situations where we prune everything because no compaction is ever
-    // run
-    return [self.serverCacheDB exactSizeFrom:kFServerCachePrefix
-                                          to:kFServerCacheRangeEnd];
+    if (!self.serverCacheSizeLoaded) {
+        // Use the exact size, because for pruning the approximate size can
+        // lead to weird situations where we prune everything because no
+        // compaction is ever run
+        NSDate *start = [NSDate date];
+        self.serverCacheSize =
+            [self.serverCacheDB exactSizeFrom:kFServerCachePrefix
+                                           to:kFServerCacheRangeEnd];
+        self.serverCacheSizeLoaded = YES;
+        FFDebug(@"I-RDB076038", @"Computed server cache size in %fms",
+                [start timeIntervalSinceNow] * -1000);
+    }
+    return self.serverCacheSize;
 }
 
 - (void)pruneCache:(FPruneForest *)pruneForest atPath:(FPath *)path {
-    // TODO: be more intelligent, don't scan entire database...
-
     __block NSUInteger pruned = 0;
     __block NSUInteger kept = 0;
     NSDate *start = [NSDate date];
 
     NSString *prefix = serverCacheKey(path);
     id<APLevelDBWriteBatch> batch = [self.serverCacheDB beginWriteBatch];
-
-    [self.serverCacheDB
-        enumerateKeysWithPrefix:prefix
-                     usingBlock:^(NSString *dbKey, BOOL *stop) {
-                       NSString *pathStr =
-                           [dbKey substringFromIndex:prefix.length];
-                       FPath *relativePath = [[FPath alloc] initWith:pathStr];
-                       if ([pruneForest shouldPruneUnkeptDescendantsAtPath:
-                                            relativePath]) {
-                           pruned++;
-                           [batch removeKey:dbKey];
-                       } else {
-                           kept++;
-                       }
-                     }];
+    NSMutableDictionary *removedRowSizes = [self removedRowSizesForBatch];
+
+    // Only the subtrees that are pruned need to be scanned, everything else
+    // is kept anyway
+    [pruneForest enumeratePrunedSubtreesUsingBlock:^(FPath *prunedPath) {
+      [self.serverCacheDB
+          enumerateKeysWithPrefix:serverCacheKey([path child:prunedPath])
+                           asData:^(NSString *dbKey, NSData *data,
+                                    BOOL *stop) {
+                             NSString *pathStr =
+                                 [dbKey substringFromIndex:prefix.length];
+                             FPath *relativePath =
+                                 [[FPath alloc] initWith:pathStr];
+                             if ([pruneForest
+                                     shouldPruneUnkeptDescendantsAtPath:
+                                         relativePath]) {
+                                 pruned++;
+                                 [batch removeKey:dbKey];
+                                 removedRowSizes[dbKey] = @(data.length);
+                             } else {
+                                 kept++;
+                             }
+                           }];
+    }];
     BOOL success = [batch commit];
     if (!success) {
         FFWarn(@"I-RDB076021", @"Failed to prune cache on disk!");
+        self.serverCacheSizeLoaded = NO;
     } else {
+        [self updateServerCacheSizeWithRemovedRowSizes:removedRowSizes
+                                            addedBytes:0];
         FFDebug(@"I-RDB076022", @"Pruned %lu paths, kept %lu paths in %fms",
                 (unsigned long)pruned, (unsigned long)kept,
                 [start timeIntervalSinceNow] * -1000);
@@ -653,21 +813,20 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
     NSDate *start = [NSDate date];
     id<APLevelDBWriteBatch> batch = [self.serverCacheDB beginWriteBatch];
     [batch removeKey:trackedQueryKey(queryId)];
-    __block NSUInteger keyCount = 0;
-    [self.serverCacheDB
-        enumerateKeysWithPrefix:trackedQueryKeysKeyPrefix(queryId)
-                     usingBlock:^(NSString *key, BOOL *stop) {
-                       [batch removeKey:key];
-                       keyCount++;
-                     }];
+    NSSet *keys = [self loadedTrackedQueryKeys][@(queryId)];
+    [keys enumerateObjectsUsingBlock:^(NSString *key, BOOL *stop) {
+      [batch removeKey:trackedQueryKeysKey(queryId, key)];
+    }];
 
     BOOL success = [batch commit];
     if (!success) {
         FFWarn(@"I-RDB076026", @"Failed to remove tracked query on disk!");
+        self.trackedQueryKeys = nil;
     } else {
+        [self.trackedQueryKeys removeObjectForKey:@(queryId)];
         FFDebug(@"I-RDB076027",
                 @"Removed query with id %lu (and removed %lu keys) in %fms",
-                (unsigned long)queryId, (unsigned long)keyCount,
+                (unsigned long)queryId, (unsigned long)keys.count,
                 [start timeIntervalSinceNow] * -1000);
     }
 }
@@ -694,43 +853,35 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
 
 - (void)setTrackedQueryKeys:(NSSet *)keys forQueryId:(NSUInteger)queryId {
     NSDate *start = [NSDate date];
-    __block NSUInteger removed = 0;
-    __block NSUInteger added = 0;
     id<APLevelDBWriteBatch> batch = [self.serverCacheDB beginWriteBatch];
-    NSMutableSet *seenKeys = [NSMutableSet set];
-    // First, delete any keys that might be stored and are not part of the
-    // current keys
-    [self.serverCacheDB
-        enumerateKeysWithPrefix:trackedQueryKeysKeyPrefix(queryId)
-                      asStrings:^(NSString *dbKey, NSString *actualKey,
-                                  BOOL *stop) {
-                        if ([keys containsObject:actualKey]) {
-                            // Already in DB
-                            [seenKeys addObject:actualKey];
-                        } else {
-                            // Not part of set, delete key
-                            [batch removeKey:dbKey];
-                            removed++;
-                        }
-                      }];
+    NSSet *storedKeys = [self loadedTrackedQueryKeys][@(queryId)];
+    // First, delete any keys that are stored and are not part of the current
+    // keys
+    NSMutableSet *removed = [storedKeys mutableCopy];
+    [removed minusSet:keys];
+    [removed enumerateObjectsUsingBlock:^(NSString *key, BOOL *stop) {
+      [batch removeKey:trackedQueryKeysKey(queryId, key)];
+    }];
 
     // Next add any keys that are missing in the database
-    [keys enumerateObjectsUsingBlock:^(NSString *childKey, BOOL *stop) {
-      if (![seenKeys containsObject:childKey]) {
-          [batch setString:childKey
-                    forKey:trackedQueryKeysKey(queryId, childKey)];
-          added++;
-      }
+    NSMutableSet *added = [keys mutableCopy];
+    if (storedKeys != nil) {
+        [added minusSet:storedKeys];
+    }
+    [added enumerateObjectsUsingBlock:^(NSString *key, BOOL *stop) {
+      [batch setString:key forKey:trackedQueryKeysKey(queryId, key)];
     }];
     BOOL success = [batch commit];
     if (!success) {
         FFWarn(@"I-RDB076029", @"Failed to set tracked queries on disk!");
+        self.trackedQueryKeys = nil;
     } else {
+        self.trackedQueryKeys[@(queryId)] = [keys mutableCopy];
         FFDebug(@"I-RDB076030",
                 @"Set %lu tracked keys (%lu added, %lu removed) for query %lu "
                 @"in %fms",
-                (unsigned long)keys.count, (unsigned long)added,
-                (unsigned long)removed, (unsigned long)queryId,
+                (unsigned long)keys.count, (unsigned long)added.count,
+                (unsigned long)removed.count, (unsigned long)queryId,
                 [start timeIntervalSinceNow] * -1000);
     }
 }
@@ -749,7 +900,19 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
     BOOL success = [batch commit];
     if (!success) {
         FFWarn(@"I-RDB076031", @"Failed to update tracked queries on disk!");
+        self.trackedQueryKeys = nil;
     } else {
+        // Only keep the cache up to date if it was already loaded, it'll pick
+        // up these keys from disk otherwise.
+        if (self.trackedQueryKeys != nil) {
+            NSMutableSet *keys = self.trackedQueryKeys[@(queryId)];
+            if (keys == nil) {
+                keys = [NSMutableSet set];
+                self.trackedQueryKeys[@(queryId)] = keys;
+            }
+            [keys minusSet:removed];
+            [keys unionSet:added];
+        }
         FFDebug(@"I-RDB076032",
                 @"Added %lu tracked keys, removed %lu for query %lu in %fms",
                 (unsigned long)added.count, (unsigned long)removed.count,
@@ -758,41 +921,125 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
 }
 
 - (NSSet *)trackedQueryKeysForQuery:(NSUInteger)queryId {
+    NSSet *keys = [self loadedTrackedQueryKeys][@(queryId)];
+    return keys != nil ? [keys copy] : [NSSet set];
+}
+
+#pragma mark - Internal methods
+
+- (NSMutableDictionary<NSNumber *, NSMutableSet<NSString *> *> *)
+    loadedTrackedQueryKeys {
+    if (self.trackedQueryKeys != nil) {
+        return self.trackedQueryKeys;
+    }
     NSDate *start = [NSDate date];
-    NSMutableSet *set = [NSMutableSet set];
+    NSMutableDictionary *trackedQueryKeys = [NSMutableDictionary dictionary];
+    __block NSUInteger count = 0;
+    NSUInteger prefixLength = kFTrackedQueryKeysPrefix.length;
     [self.serverCacheDB
-        enumerateKeysWithPrefix:trackedQueryKeysKeyPrefix(queryId)
+        enumerateKeysWithPrefix:kFTrackedQueryKeysPrefix
                       asStrings:^(NSString *dbKey, NSString *actualKey,
                                   BOOL *stop) {
-                        [set addObject:actualKey];
+                        // Keys are of the form
+                        // /tracked_query_keys/<query id>/<key>
+                        NSRange idRange = NSMakeRange(
+                            prefixLength, dbKey.length - prefixLength);
+                        NSRange slash = [dbKey rangeOfString:@"/"
+                                                     options:0
+                                                       range:idRange];
+                        if (slash.location == NSNotFound) {
+                            FFWarn(@"I-RDB076037",
+                                   @"Ignoring malformed tracked key %@",
+                                   dbKey);
+                            return;
+                        }
+                        idRange.length = slash.location - prefixLength;
+                        NSNumber *queryId = @((NSUInteger)[[dbKey
+                            substringWithRange:idRange] longLongValue]);
+                        NSMutableSet *keys = trackedQueryKeys[queryId];
+                        if (keys == nil) {
+                            keys = [NSMutableSet set];
+                            trackedQueryKeys[queryId] = keys;
+                        }
+                        [keys addObject:actualKey];
+                        count++;
                       }];
-    FFDebug(@"I-RDB076033", @"Loaded %lu tracked keys for query %lu in %fms",
-            (unsigned long)set.count, (unsigned long)queryId,
+    FFDebug(@"I-RDB076033",
+            @"Loaded %lu tracked keys for %lu queries in %fms",
+            (unsigned long)count, (unsigned long)trackedQueryKeys.count,
             [start timeIntervalSinceNow] * -1000);
-    return set;
+    self.trackedQueryKeys = trackedQueryKeys;
+    return trackedQueryKeys;
 }
 
-#pragma mark - Internal methods
+// Returns the dictionary to collect the sizes of the server cache rows removed
+// by a write batch in, or nil if the server cache size isn't tracked yet.
+- (NSMutableDictionary<NSString *, NSNumber *> *)removedRowSizesForBatch {
+    return self.serverCacheSizeLoaded ? [NSMutableDictionary dictionary] : nil;
+}
+
+- (void)updateServerCacheSizeWithRemovedRowSizes:
+            (NSDictionary<NSString *, NSNumber *> *)removedRowSizes
+                                      addedBytes:(NSUInteger)addedBytes {
+    if (!self.serverCacheSizeLoaded) {
+        return;
+    }
+    __block NSUInteger removedBytes = 0;
+    [removedRowSizes enumerateKeysAndObjectsUsingBlock:^(
+                         NSString *key, NSNumber *size, BOOL *stop) {
+      removedBytes += size.unsignedIntegerValue;
+    }];
+    NSUInteger size = self.serverCacheSize + addedBytes;
+    self.serverCacheSize = size > removedBytes ? size - removedBytes : 0;
+}
+
+- (void)removeServerCacheKey:(NSString *)key
+                       batch:(id<APLevelDBWriteBatch>)batch
+             removedRowSizes:(NSMutableDictionary *)removedRowSizes {
+    [batch removeKey:key];
+    if (removedRowSizes != nil && removedRowSizes[key] == nil) {
+        NSData *data = [self.serverCacheDB dataForKey:key];
+        if (data != nil) {
+            removedRowSizes[key] = @(data.length);
+        }
+    }
+}
 
 - (void)removeAllLeafNodesOnPath:(FPath *)path
-                           batch:(id<APLevelDBWriteBatch>)batch {
+                           batch:(id<APLevelDBWriteBatch>)batch
+                 removedRowSizes:(NSMutableDictionary *)removedRowSizes {
     while (!path.isEmpty) {
-        [batch removeKey:serverCacheKey(path)];
+        [self removeServerCacheKey:serverCacheKey(path)
+                             batch:batch
+                   removedRowSizes:removedRowSizes];
         path = [path parent];
     }
     // Make sure to delete any nodes at the root
-    [batch removeKey:serverCacheKey([FPath empty])];
+    [self removeServerCacheKey:serverCacheKey([FPath empty])
+                         batch:batch
+               removedRowSizes:removedRowSizes];
 }
 
 - (void)removeAllWithPrefix:(NSString *)prefix
                       batch:(id<APLevelDBWriteBatch>)batch
-                   database:(APLevelDB *)database {
+            removedRowSizes:(NSMutableDictionary *)removedRowSizes {
     assert(prefix != nil);
 
-    [database enumerateKeysWithPrefix:prefix
-                           usingBlock:^(NSString *key, BOOL *stop) {
-                             [batch removeKey:key];
-                           }];
+    if (removedRowSizes == nil) {
+        [self.serverCacheDB
+            enumerateKeysWithPrefix:prefix
+                         usingBlock:^(NSString *key, BOOL *stop) {
+                           [batch removeKey:key];
+                         }];
+    } else {
+        [self.serverCacheDB
+            enumerateKeysWithPrefix:prefix
+                             asData:^(NSString *key, NSData *data,
+                                      BOOL *stop) {
+                               [batch removeKey:key];
+                               removedRowSizes[key] = @(data.length);
+                             }];
+    }
 }
 
 #pragma mark - Internal helper methods
@@ -800,7 +1047,8 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
 - (void)internalSetNestedData:(id)value
                        forKey:(NSString *)key
                     withBatch:(id<APLevelDBWriteBatch>)batch
-                      counter:(NSUInteger *)counter {
+                      counter:(NSUInteger *)counter
+                        bytes:(NSUInteger *)bytes {
     if ([value isKindOfClass:[NSDictionary class]]) {
         NSDictionary *dictionary = value;
         [dictionary enumerateKeysAndObjectsUsingBlock:^(id childKey, id obj,
@@ -811,12 +1059,14 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
           [self internalSetNestedData:obj
                                forKey:childPath
                             withBatch:batch
-                              counter:counter];
+                              counter:counter
+                                bytes:bytes];
         }];
     } else {
         NSData *data = [self serializePrimitive:value];
         [batch setData:data forKey:key];
         (*counter)++;
+        (*bytes) += data.length;
     }
 }
 
@@ -842,6 +1092,9 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
     }
 }
 
+// Builds the nested data in a single pass over the rows, which are sorted so
+// that a leaf row comes before any rows below it. A later row below a leaf
+// replaces that leaf with its children.
 - (id)internalNestedDataFromIterator:(APLevelDBIterator *)iterator
                         andKeyPrefix:(NSString *)prefix {
     NSString *key = iterator.key;
@@ -850,27 +1103,57 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
         id result = [self deserializePrimitive:iterator.valueAsData];
         [iterator nextKey];
         return result;
-    } else {
-        NSMutableDictionary *dict = [[NSMutableDictionary alloc] init];
-        while (key != nil && [key hasPrefix:prefix]) {
-            NSString *relativePath = [key substringFromIndex:prefix.length];
-            NSArray *pathPieces =
-                [relativePath componentsSeparatedByString:@"/"];
-            assert(pathPieces.count > 0);
-            NSString *childName = pathPieces[0];
-            NSString *childPath =
-                [NSString stringWithFormat:@"%@%@/", prefix, childName];
-            id childValue = [self internalNestedDataFromIterator:iterator
-                                                    andKeyPrefix:childPath];
-            [dict setValue:childValue forKey:childName];
-
-            key = iterator.key;
+    }
+
+    NSMutableDictionary *root = [[NSMutableDictionary alloc] init];
+    while (key != nil && [key hasPrefix:prefix]) {
+        NSString *relativePath = [key substringFromIndex:prefix.length];
+        NSArray *pathPieces = [relativePath componentsSeparatedByString:@"/"];
+        // Keys end with a slash, so the last piece is always empty.
+        assert(pathPieces.count > 1);
+        NSUInteger depth = pathPieces.count - 1;
+
+        NSMutableDictionary *dict = root;
+        for (NSUInteger i = 0; i + 1 < depth; i++) {
+            NSString *childName = pathPieces[i];
+            id child = dict[childName];
+            if (![child isKindOfClass:[NSMutableDictionary class]]) {
+                child = [[NSMutableDictionary alloc] init];
+                dict[childName] = child;
+            }
+            dict = child;
         }
-        return dict;
+
+        id value = [self deserializePrimitive:iterator.valueAsData];
+        [dict setValue:value forKey:pathPieces[depth - 1]];
+
+        key = [iterator nextKey];
     }
+    return root;
 }
 
 - (NSData *)serializePrimitive:(id)value {
+    FServerCacheTag tag;
+    if ([value isKindOfClass:[NSString class]]) {
+        tag = FServerCacheTagString;
+        NSData *utf8 = [value dataUsingEncoding:NSUTF8StringEncoding];
+        NSMutableData *data =
+            [NSMutableData dataWithCapacity:utf8.length + 1];
+        [data appendBytes:&tag length:1];
+        [data appendData:utf8];
+        return data;
+    } else if (value == (id)kCFBooleanTrue) {
+        tag = FServerCacheTagTrue;
+        return [NSData dataWithBytes:&tag length:1];
+    } else if (value == (id)kCFBooleanFalse) {
+        tag = FServerCacheTagFalse;
+        return [NSData dataWithBytes:&tag length:1];
+    }
+
+    return [self serializeJSONPrimitive:value];
+}
+
+- (NSData *)serializeJSONPrimitive:(id)value {
     // HACK: The built-in serialization only works on dicts and arrays.  So we
     // create an array and then strip off the leading / trailing byte (the [ and
     // ]).
@@ -944,6 +1227,26 @@ static NSString *trackedQueryKeysKey(NSUInteger trackedQueryId, NSString *key) {
 }
 
 - (id)deserializePrimitive:(NSData *)data {
+    if (data.length > 0) {
+        const uint8_t *bytes = data.bytes;
+        switch (bytes[0]) {
+            case FServerCacheTagString:
+                return [[NSString alloc] initWithBytes:bytes + 1
+                                                length:data.length - 1
+                                              encoding:NSUTF8StringEncoding];
+            case FServerCacheTagTrue:
+                return @YES;
+            case FServerCacheTagFalse:
+                return @NO;
+            default:
+                break;
+        }
+    }
+
+    return [self deserializeJSONPrimitive:data];
+}
+
+- (id)deserializeJSONPrimitive:(NSData *)data {
     NSError *error = nil;
     id result =
         [NSJSONSerialization JSONObjectWithData:data
@@ -16,12 +16,17 @@
 
 #import "FirebaseDatabase/Sources/Persistence/FPersistenceManager.h"
 #import "FirebaseCore/Sources/Private/FirebaseCoreInternal.h"
+#import "FirebaseDatabase/Sources/Api/Private/FIRDatabaseQuery_Private.h"
+#import "FirebaseDatabase/Sources/Core/FWriteRecord.h"
 #import "FirebaseDatabase/Sources/Core/View/FCacheNode.h"
+#import "FirebaseDatabase/Sources/Core/View/Filter/FNodeFilter.h"
 #import "FirebaseDatabase/Sources/FClock.h"
+#import "FirebaseDatabase/Sources/FPathIndex.h"
 #import "FirebaseDatabase/Sources/Persistence/FLevelDBStorageEngine.h"
 #import "FirebaseDatabase/Sources/Persistence/FPruneForest.h"
 #import "FirebaseDatabase/Sources/Persistence/FTrackedQuery.h"
 #import "FirebaseDatabase/Sources/Persistence/FTrackedQueryManager.h"
+#import "FirebaseDatabase/Sources/Snapshot/FEmptyNode.h"
 #import "FirebaseDatabase/Sources/Snapshot/FIndexedNode.h"
 #import "FirebaseDatabase/Sources/Utilities/FUtilities.h"
 
@@ -31,6 +36,11 @@
 @property(nonatomic, strong) id<FCachePolicy> cachePolicy;
 @property(nonatomic, strong) FTrackedQueryManager *trackedQueryManager;
 @property(nonatomic) NSUInteger serverCacheUpdatesSinceLastPruneCheck;
+/**
+ * User writes that are saved together once the writes queued on the database
+ * queue have run, rather than one by one.
+ */
+@property(nonatomic, strong) NSMutableArray<FWriteRecord *> *pendingUserWrites;
 
 @end
 
@@ -45,11 +55,13 @@
         self->_trackedQueryManager = [[FTrackedQueryManager alloc]
             initWithStorageEngine:self.storageEngine
                             clock:[FSystemClock clock]];
+        self->_pendingUserWrites = [NSMutableArray array];
     }
     return self;
 }
 
 - (void)close {
+    [self savePendingUserWrites];
     [self.storageEngine close];
     self.storageEngine = nil;
     self.trackedQueryManager = nil;
@@ -58,24 +70,51 @@
 - (void)saveUserOverwrite:(id<FNode>)node
                    atPath:(FPath *)path
                   writeId:(NSUInteger)writeId {
-    [self.storageEngine saveUserOverwrite:node atPath:path writeId:writeId];
+    [self addPendingUserWrite:[[FWriteRecord alloc] initWithPath:path
+                                                       overwrite:node
+                                                         writeId:writeId
+                                                         visible:YES]];
 }
 
 - (void)saveUserMerge:(FCompoundWrite *)merge
                atPath:(FPath *)path
               writeId:(NSUInteger)writeId {
-    [self.storageEngine saveUserMerge:merge atPath:path writeId:writeId];
+    [self addPendingUserWrite:[[FWriteRecord alloc] initWithPath:path
+                                                           merge:merge
+                                                         writeId:writeId]];
+}
+
+- (void)addPendingUserWrite:(FWriteRecord *)write {
+    [self.pendingUserWrites addObject:write];
+    if (self.pendingUserWrites.count == 1) {
+        // Any writes that were already queued run before this block, so
+        // they're saved in the same batch
+        dispatch_async([FIRDatabaseQuery sharedQueue], ^{
+          [self savePendingUserWrites];
+        });
+    }
+}
+
+- (void)savePendingUserWrites {
+    if (self.pendingUserWrites.count > 0) {
+        NSArray<FWriteRecord *> *writes = self.pendingUserWrites;
+        self.pendingUserWrites = [NSMutableArray array];
+        [self.storageEngine saveUserWrites:writes];
+    }
 }
 
 - (void)removeUserWrite:(NSUInteger)writeId {
+    [self savePendingUserWrites];
     [self.storageEngine removeUserWrite:writeId];
 }
 
 - (void)removeAllUserWrites {
+    [self savePendingUserWrites];
     [self.storageEngine removeAllUserWrites];
 }
 
 - (NSArray *)userWrites {
+    [self savePendingUserWrites];
     return [self.storageEngine userWrites];
 }
 
@@ -101,9 +140,14 @@
     }
 
     id<FNode> node;
+    BOOL filtered = (trackedKeys != nil);
     if (trackedKeys != nil) {
         node = [self.storageEngine serverCacheForKeys:trackedKeys
                                                atPath:query.path];
+    } else if (query.params.limitSet &&
+               [query.index isKindOfClass:[FPathIndex class]]) {
+        node = [self serverCacheInWindowOfQuery:query];
+        filtered = YES;
     } else {
         node = [self.storageEngine serverCacheAtPath:query.path];
     }
@@ -112,7 +156,34 @@
                                                             index:query.index];
     return [[FCacheNode alloc] initWithIndexedNode:indexedNode
                                 isFullyInitialized:complete
-                                        isFiltered:(trackedKeys != nil)];
+                                        isFiltered:filtered];
+}
+
+/**
+ * Loads only the children of a complete location that are in the window of a
+ * limited query ordered by child. The children are first ordered by their
+ * values at the index path alone, so the data of the other children is never
+ * read.
+ */
+- (id<FNode>)serverCacheInWindowOfQuery:(FQuerySpec *)query {
+    FPath *indexPath = ((FPathIndex *)query.index).path;
+    id<FNode> indexValues =
+        [self.storageEngine serverCacheIndexValuesAtPath:query.path
+                                            forIndexPath:indexPath];
+    FIndexedNode *empty =
+        [FIndexedNode indexedNodeWithNode:[FEmptyNode emptyNode]
+                                    index:query.index];
+    FIndexedNode *window = [query.params.nodeFilter
+        updateFullNode:empty
+           withNewNode:[FIndexedNode indexedNodeWithNode:indexValues
+                                                   index:query.index]
+           accumulator:nil];
+    NSMutableSet *keys = [NSMutableSet set];
+    [window.node enumerateChildrenUsingBlock:^(
+                     NSString *key, id<FNode> node, BOOL *stop) {
+      [keys addObject:key];
+    }];
+    return [self.storageEngine serverCacheForKeys:keys atPath:query.path];
 }
 
 - (void)updateServerCacheWithNode:(id<FNode>)node forQuery:(FQuerySpec *)query {
@@ -35,4 +35,10 @@
 
 - (void)enumarateKeptNodesUsingBlock:(void (^)(FPath *path))block;
 
+/**
+ * Calls block with the root-most path of each pruned subtree. Nothing outside
+ * of these subtrees is pruned.
+ */
+- (void)enumeratePrunedSubtreesUsingBlock:(void (^)(FPath *path))block;
+
 @end
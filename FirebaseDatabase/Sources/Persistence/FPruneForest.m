@@ -191,4 +191,26 @@ static BOOL (^kFKeepPredicate)(id) = ^BOOL(NSNumber *pruneValue) {
     }];
 }
 
+- (void)enumeratePrunedSubtreesUsingBlock:(void (^)(FPath *))block {
+    [self enumeratePrunedSubtreesOfTree:self.pruneForest
+                                 atPath:[FPath empty]
+                             usingBlock:block];
+}
+
+- (void)enumeratePrunedSubtreesOfTree:(FImmutableTree *)tree
+                               atPath:(FPath *)path
+                           usingBlock:(void (^)(FPath *))block {
+    if (tree.value != nil && [tree.value boolValue]) {
+        block(path);
+        return;
+    }
+    [tree.children enumerateKeysAndObjectsUsingBlock:^(
+                       NSString *childKey, FImmutableTree *childTree,
+                       BOOL *stop) {
+      [self enumeratePrunedSubtreesOfTree:childTree
+                                   atPath:[path childFromString:childKey]
+                               usingBlock:block];
+    }];
+}
+
 @end
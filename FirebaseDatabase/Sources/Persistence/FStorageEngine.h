@@ -22,6 +22,7 @@
 @class FCompoundWrite;
 @class FQuerySpec;
 @class FTrackedQuery;
+@class FWriteRecord;
 
 @protocol FStorageEngine <NSObject>
 
@@ -33,12 +34,22 @@
 - (void)saveUserMerge:(FCompoundWrite *)merge
                atPath:(FPath *)path
               writeId:(NSUInteger)writeId;
+/**
+ * Saves the given user writes, overwrites and merges, in a single batch.
+ */
+- (void)saveUserWrites:(NSArray<FWriteRecord *> *)writes;
 - (void)removeUserWrite:(NSUInteger)writeId;
 - (void)removeAllUserWrites;
 - (NSArray *)userWrites;
 
 - (id<FNode>)serverCacheAtPath:(FPath *)path;
 - (id<FNode>)serverCacheForKeys:(NSSet *)keys atPath:(FPath *)path;
+/**
+ * Returns the children at path with only their data at indexPath, which is
+ * enough to order them by that path without loading all of their data.
+ */
+- (id<FNode>)serverCacheIndexValuesAtPath:(FPath *)path
+                             forIndexPath:(FPath *)indexPath;
 - (void)updateServerCache:(id<FNode>)node
                    atPath:(FPath *)path
                     merge:(BOOL)merge;
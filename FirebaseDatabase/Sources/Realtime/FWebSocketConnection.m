@@ -40,7 +40,7 @@ static NSString *const kUserAgentHeader = @"User-Agent";
 static NSString *const kGoogleAppIDHeader = @"X-Firebase-GMPID";
 
 @interface FWebSocketConnection () {
-    NSMutableString *frame;
+    NSMutableData *frame;
     BOOL everConnected;
     BOOL isClosed;
     NSTimer *keepAlive;
@@ -267,14 +267,16 @@ static NSString *const kGoogleAppIDHeader = @"X-Firebase-GMPID";
 
 - (void)handleNewFrameCount:(int)numFrames {
     self.totalFrames = numFrames;
-    frame = [[NSMutableString alloc] initWithString:@""];
+    frame = [[NSMutableData alloc] init];
     FFLog(@"I-RDB083006", @"(wsc:%@) handleNewFrameCount: %d",
           self.connectionId, self.totalFrames);
 }
 
-- (NSString *)extractFrameCount:(NSString *)message {
+- (NSData *)extractFrameCount:(NSData *)message {
     if ([message length] <= 4) {
-        int frameCount = [message intValue];
+        NSString *count = [[NSString alloc] initWithData:message
+                                                encoding:NSUTF8StringEncoding];
+        int frameCount = [count intValue];
         if (frameCount > 0) {
             [self handleNewFrameCount:frameCount];
             return nil;
@@ -284,16 +286,20 @@ static NSString *const kGoogleAppIDHeader = @"X-Firebase-GMPID";
     return message;
 }
 
-- (void)appendFrame:(NSString *)message {
-    [frame appendString:message];
+- (void)appendFrame:(NSData *)message {
     self.totalFrames = self.totalFrames - 1;
+    // Most messages fit in a single frame, which can be parsed without
+    // copying it into the buffer
+    NSData *data = message;
+    if (self.totalFrames > 0 || frame.length > 0) {
+        [frame appendData:message];
+        data = frame;
+    }
 
     if (self.totalFrames == 0) {
-        // Call delegate and pass an immutable version of the frame
-        NSDictionary *json = [NSJSONSerialization
-            JSONObjectWithData:[frame dataUsingEncoding:NSUTF8StringEncoding]
-                       options:kNilOptions
-                         error:nil];
+        NSDictionary *json = [NSJSONSerialization JSONObjectWithData:data
+                                                             options:kNilOptions
+                                                               error:nil];
         frame = nil;
         FFLog(@"I-RDB083007",
               @"(wsc:%@) handleIncomingFrame sending complete frame: %d",
@@ -305,12 +311,12 @@ static NSString *const kGoogleAppIDHeader = @"X-Firebase-GMPID";
     }
 }
 
-- (void)handleIncomingFrame:(NSString *)message {
+- (void)handleIncomingFrame:(NSData *)message {
     [self resetKeepAlive];
     if (self.buffering) {
         [self appendFrame:message];
     } else {
-        NSString *remaining = [self extractFrameCount:message];
+        NSData *remaining = [self extractFrameCount:message];
         if (remaining) {
             [self appendFrame:remaining];
         }
@@ -347,7 +353,11 @@ static NSString *const kGoogleAppIDHeader = @"X-Firebase-GMPID";
       }
 
       if (message) {
-          [strongSelf handleIncomingFrame:message.string];
+          NSData *data =
+              message.type == NSURLSessionWebSocketMessageTypeData
+                  ? message.data
+                  : [message.string dataUsingEncoding:NSUTF8StringEncoding];
+          [strongSelf handleIncomingFrame:data];
       } else if (error && !strongSelf->isClosed) {
           FFWarn(@"I-RDB083020",
                  @"Error received from web socket, closing the connection. %@",
@@ -364,6 +374,11 @@ static NSString *const kGoogleAppIDHeader = @"X-Firebase-GMPID";
 
 #pragma mark SRWebSocketDelegate implementation
 
+- (BOOL)webSocketShouldConvertTextFrameToString:(FSRWebSocket *)webSocket {
+    // Messages are parsed as JSON straight from their UTF-8 data
+    return NO;
+}
+
 - (void)webSocket:(FSRWebSocket *)webSocket didReceiveMessage:(id)message {
     [self handleIncomingFrame:message];
 }
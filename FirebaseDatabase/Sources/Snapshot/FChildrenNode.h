@@ -20,6 +20,7 @@
 #import "FirebaseDatabase/Sources/third_party/FImmutableSortedDictionary/FImmutableSortedDictionary/FImmutableSortedDictionary.h"
 #import <Foundation/Foundation.h>
 
+@class FCompoundHash;
 @class FNamedNode;
 
 @interface FChildrenNode : NSObject <FNode>
@@ -39,4 +40,11 @@
 @property(nonatomic, strong) FImmutableSortedDictionary *children;
 @property(nonatomic, strong) id<FNode> priorityNode;
 
+// Computed on demand by FCompoundHash and FSnapshotUtilities and kept on the
+// node, since nodes are immutable. An updated tree shares its unchanged
+// subtrees with the old one, so only the changed subtrees have to be walked
+// again. A lazyEstimatedSize of 0 means it hasn't been computed yet.
+@property(nonatomic, strong) FCompoundHash *lazyCompoundHash;
+@property(nonatomic) NSUInteger lazyEstimatedSize;
+
 @end
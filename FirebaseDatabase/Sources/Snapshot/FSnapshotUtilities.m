@@ -176,22 +176,39 @@
         }
     } else if ([value isKindOfClass:[NSArray class]]) {
         NSArray *aval = (NSArray *)value;
-        NSMutableDictionary *children =
-            [NSMutableDictionary dictionaryWithCapacity:aval.count];
+        // The indexes are already in key order, so the children don't need to
+        // be sorted
+        NSMutableArray *keys = [NSMutableArray arrayWithCapacity:aval.count];
+        NSMutableArray *children =
+            [NSMutableArray arrayWithCapacity:aval.count];
+        BOOL canHaveLeafChildren = depth + 1 <= kFirebaseMaxObjectDepth;
 
         for (int i = 0; i < [aval count]; i++) {
             NSString *key = [NSString stringWithFormat:@"%i", i];
+            id element = [aval objectAtIndex:i];
             [path addObject:key];
-            id<FNode> childNode =
-                [FSnapshotUtilities nodeFrom:[aval objectAtIndex:i]
-                                    priority:nil
-                          withValidationFrom:fn
-                                     atDepth:depth + 1
-                                        path:path];
+            id<FNode> childNode;
+            if (canHaveLeafChildren &&
+                ([element isKindOfClass:[NSNumber class]] ||
+                 [element isKindOfClass:[NSString class]]) &&
+                [FValidation validateFrom:fn
+                         isValidLeafValue:element
+                                 withPath:path]) {
+                // Primitive elements, like those of numeric arrays, don't
+                // need the full conversion
+                childNode = [[FLeafNode alloc] initWithValue:element];
+            } else {
+                childNode = [FSnapshotUtilities nodeFrom:element
+                                                priority:nil
+                                      withValidationFrom:fn
+                                                 atDepth:depth + 1
+                                                    path:path];
+            }
             [path removeLastObject];
 
             if (![childNode isEmpty]) {
-                children[key] = childNode;
+                [keys addObject:key];
+                [children addObject:childNode];
             }
         }
 
@@ -200,7 +217,8 @@
         } else {
             FImmutableSortedDictionary *childrenDict =
                 [FImmutableSortedDictionary
-                    fromDictionary:children
+                    fromSortedKeys:keys
+                            values:children
                     withComparator:[FUtilities keyComparator]];
             return [[FChildrenNode alloc] initWithPriority:priority
                                                   children:childrenDict];
@@ -378,15 +396,19 @@
     } else {
         NSAssert([node isKindOfClass:[FChildrenNode class]],
                  @"Unexpected node type: %@", [node class]);
+        FChildrenNode *childrenNode = (FChildrenNode *)node;
+        if (childrenNode.lazyEstimatedSize > 0) {
+            return childrenNode.lazyEstimatedSize;
+        }
         __block NSUInteger sum = 1; // opening brackets
-        [((FChildrenNode *)node) enumerateChildrenAndPriorityUsingBlock:^(
-                                     NSString *key, id<FNode> child,
-                                     BOOL *stop) {
+        [childrenNode enumerateChildrenAndPriorityUsingBlock:^(
+                          NSString *key, id<FNode> child, BOOL *stop) {
           sum += key.length;
           sum +=
               4; // quotes around key and colon and (comma or closing bracket)
           sum += [FSnapshotUtilities estimateSerializedNodeSize:child];
         }];
+        childrenNode.lazyEstimatedSize = sum;
         return sum;
     }
 }
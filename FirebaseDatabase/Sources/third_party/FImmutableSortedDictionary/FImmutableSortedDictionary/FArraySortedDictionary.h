@@ -10,6 +10,7 @@
 @interface FArraySortedDictionary : FImmutableSortedDictionary
 
 + (FArraySortedDictionary *)fromDictionary:(NSDictionary *)dictionary withComparator:(NSComparator)comparator;
++ (FArraySortedDictionary *)fromSortedKeys:(NSArray *)keys values:(NSArray *)values withComparator:(NSComparator)comparator;
 
 - (id)initWithComparator:(NSComparator)comparator;
 
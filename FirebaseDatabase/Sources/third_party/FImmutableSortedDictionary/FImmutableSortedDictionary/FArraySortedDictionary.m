@@ -79,6 +79,11 @@
     return [[FArraySortedDictionary alloc] initWithComparator:comparator keys:keys values:values];
 }
 
++ (FArraySortedDictionary *)fromSortedKeys:(NSArray *)keys values:(NSArray *)values withComparator:(NSComparator)comparator
+{
+    return [[FArraySortedDictionary alloc] initWithComparator:comparator keys:[keys copy] values:[values copy]];
+}
+
 - (id)initWithComparator:(NSComparator)comparator
 {
     self = [super init];
@@ -26,6 +26,8 @@
 
 + (FImmutableSortedDictionary *)dictionaryWithComparator:(NSComparator)comparator;
 + (FImmutableSortedDictionary *)fromDictionary:(NSDictionary *)dictionary withComparator:(NSComparator)comparator;
+// Like fromDictionary:withComparator:, but the keys must already be in ascending order, which saves sorting them.
++ (FImmutableSortedDictionary *)fromSortedKeys:(NSArray *)keys values:(NSArray *)values withComparator:(NSComparator)comparator;
 
 - (FImmutableSortedDictionary *) insertKey:(id)aKey withValue:(id)aValue;
 - (FImmutableSortedDictionary *) removeKey:(id)aKey;
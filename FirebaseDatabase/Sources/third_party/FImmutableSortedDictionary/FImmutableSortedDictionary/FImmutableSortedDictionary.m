@@ -24,6 +24,16 @@
     }
 }
 
++ (FImmutableSortedDictionary *)fromSortedKeys:(NSArray *)keys values:(NSArray *)values withComparator:(NSComparator)comparator
+{
+    NSAssert(keys.count == values.count, @"Need as many keys as values");
+    if (keys.count <= SORTED_DICTIONARY_ARRAY_TO_RB_TREE_SIZE_THRESHOLD) {
+        return [FArraySortedDictionary fromSortedKeys:keys values:values withComparator:comparator];
+    } else {
+        return [FTreeSortedDictionary fromSortedKeys:keys values:values withComparator:comparator];
+    }
+}
+
 - (FImmutableSortedDictionary *) insertKey:(id)aKey withValue:(id)aValue {
     THROW_ABSTRACT_METHOD_EXCEPTION(@selector(insertKey:withValue:));
 }
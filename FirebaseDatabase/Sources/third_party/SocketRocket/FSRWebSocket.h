@@ -81,6 +81,11 @@ extern NSString *const FSRWebSocketErrorDomain;
 
 @optional
 
+// Return NO to receive text messages as their UTF-8 NSData rather than as an
+// NSString, which saves decoding messages that are parsed from data anyway.
+// Defaults to YES.
+- (BOOL)webSocketShouldConvertTextFrameToString:(FSRWebSocket *)webSocket;
+
 // Exclude the `webSocket` argument since it isn't used in this codebase and it allows for better
 // code sharing with watchOS.
 - (void)webSocketDidOpen;
@@ -886,6 +886,12 @@ static inline BOOL closeCodeIsValid(int closeCode) {
 
     switch (opcode) {
         case SROpCodeTextFrame: {
+            if ([self.delegate respondsToSelector:@selector(webSocketShouldConvertTextFrameToString:)] &&
+                ![self.delegate webSocketShouldConvertTextFrameToString:self]) {
+                // The frame data is reused for the next frame
+                [self _handleMessage:[frameData copy]];
+                break;
+            }
             NSString *str = [[NSString alloc] initWithData:frameData encoding:NSUTF8StringEncoding];
             if (str == nil && frameData) {
                 [self closeWithCode:SRStatusCodeInvalidUTF8 reason:@"Text frames must be valid UTF-8"];
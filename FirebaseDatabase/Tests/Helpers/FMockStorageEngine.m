@@ -63,6 +63,12 @@
   self.userWritesDict[@(writeId)] = writeRecord;
 }
 
+- (void)saveUserWrites:(NSArray<FWriteRecord *> *)writes {
+  for (FWriteRecord *write in writes) {
+    self.userWritesDict[@(write.writeId)] = write;
+  }
+}
+
 - (void)removeUserWrite:(NSUInteger)writeId {
   [self.userWritesDict removeObjectForKey:@(writeId)];
 }
@@ -98,6 +104,11 @@
   return children;
 }
 
+- (id<FNode>)serverCacheIndexValuesAtPath:(FPath *)path
+                             forIndexPath:(FPath *)indexPath {
+  return [self serverCacheAtPath:path];
+}
+
 - (void)updateServerCache:(id<FNode>)node atPath:(FPath *)path merge:(BOOL)merge {
   if (merge) {
     [node enumerateChildrenUsingBlock:^(NSString *key, id<FNode> childNode, BOOL *stop) {
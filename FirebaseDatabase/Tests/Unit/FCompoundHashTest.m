@@ -155,4 +155,19 @@ static FCompoundHashSplitStrategy NEVER_SPLIT_STRATEGY = ^BOOL(FCompoundHashBuil
   XCTAssertEqualWithAccuracy(hash1M.hashes.count, 150, 10);
 }
 
+- (void)testCompoundHashIsMemoizedOnNode {
+  id<FNode> node = NODE((@{@"foo" : @{@"bar" : @"baz"}, @"qux" : @"quu"}));
+  FCompoundHash *hash = [FCompoundHash fromNode:node];
+  XCTAssertEqual([FCompoundHash fromNode:node], hash);
+
+  id<FNode> updated = [node updateChild:PATH(@"qux") withNewChild:NODE(@"changed")];
+  FCompoundHash *updatedHash = [FCompoundHash fromNode:updated];
+  XCTAssertNotEqual(updatedHash, hash);
+  XCTAssertNotEqualObjects(updatedHash.hashes, hash.hashes);
+  XCTAssertEqualObjects(updatedHash.hashes,
+                        [FCompoundHash fromNode:NODE((@{@"foo" : @{@"bar" : @"baz"},
+                                                        @"qux" : @"changed"}))]
+                            .hashes);
+}
+
 @end
@@ -20,9 +20,11 @@
 #import "FirebaseDatabase/Sources/Core/FWriteRecord.h"
 #import "FirebaseDatabase/Sources/FPathIndex.h"
 #import "FirebaseDatabase/Sources/Persistence/FLevelDBStorageEngine.h"
+#import "FirebaseDatabase/Sources/Persistence/FPruneForest.h"
 #import "FirebaseDatabase/Sources/Persistence/FTrackedQuery.h"
 #import "FirebaseDatabase/Sources/Snapshot/FEmptyNode.h"
 #import "FirebaseDatabase/Sources/Snapshot/FSnapshotUtilities.h"
+#import "FirebaseDatabase/Sources/third_party/Wrap-leveldb/APLevelDB.h"
 #import "FirebaseDatabase/Tests/Helpers/FTestHelpers.h"
 
 @interface FLevelDBStorageEngineTests : XCTestCase
@@ -563,9 +565,96 @@
   XCTAssertEqual(CFNumberGetType((CFNumberRef)actualDouble), kCFNumberSInt64Type);
 }
 
+- (void)testJSONLeafRowsAreStillLoaded {
+  FLevelDBStorageEngine *engine = [self cleanStorageEngine];
+  APLevelDB *serverCacheDB = [engine valueForKey:@"serverCacheDB"];
+  [serverCacheDB setString:@"\"legacy\"" forKey:@"/server_cache/foo/string/"];
+  [serverCacheDB setString:@"true" forKey:@"/server_cache/foo/bool/"];
+  [serverCacheDB setString:@"2.47" forKey:@"/server_cache/foo/double/"];
+
+  XCTAssertEqualObjects([engine serverCacheAtPath:PATH(@"foo")],
+                        NODE((@{@"string" : @"legacy", @"bool" : @YES, @"double" : @2.47})));
+}
+
+- (void)testLargeServerCacheIsSavedAndLoaded {
+  FLevelDBStorageEngine *engine = [self cleanStorageEngine];
+
+  NSMutableDictionary *data = [NSMutableDictionary dictionary];
+  for (NSUInteger i = 0; i < 200; i++) {
+    NSMutableDictionary *child = [NSMutableDictionary dictionary];
+    for (NSUInteger j = 0; j < 50; j++) {
+      child[[NSString stringWithFormat:@"key-%lu", (unsigned long)j]] = @{
+        @"name" : [NSString stringWithFormat:@"name-%lu-%lu", (unsigned long)i, (unsigned long)j],
+        @"count" : @(j),
+        @"flag" : @(j % 2 == 0)
+      };
+    }
+    data[[NSString stringWithFormat:@"child-%lu", (unsigned long)i]] = child;
+  }
+  id<FNode> node = NODE(data);
+
+  [engine updateServerCache:node atPath:PATH(@"foo") merge:NO];
+
+  XCTAssertEqualObjects([engine serverCacheAtPath:PATH(@"foo")], node);
+  XCTAssertEqualObjects([engine serverCacheAtPath:PATH(@"foo/child-199/key-49")],
+                        [node getChild:PATH(@"child-199/key-49")]);
+}
+
 // TODO[offline]: Somehow test estimated server size?
 // TODO[offline]: Test pruning!
 
+- (void)testServerCacheSizeIsKeptUpToDate {
+  NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"test-db"];
+  FLevelDBStorageEngine *engine = [self cleanStorageEngine];
+  XCTAssertEqual([engine serverCacheEstimatedSizeInBytes], 0);
+
+  [engine updateServerCache:NODE((@{@"a" : @{@"aa" : @"value", @"ab" : @YES}, @"b" : @1}))
+                     atPath:PATH(@"foo")
+                      merge:NO];
+  [engine updateServerCache:NODE(@"leaf") atPath:PATH(@"foo/a/aa/deep") merge:NO];
+  [engine updateServerCache:NODE((@{@"b" : @"merged", @"c" : @2.5}))
+                     atPath:PATH(@"foo")
+                      merge:YES];
+  [engine updateServerCacheWithMerge:[FCompoundWrite compoundWriteWithValueDictionary:@{
+            @"a/ab" : @"longer value",
+            @"d" : @{@"x" : @"y"}
+          }]
+                              atPath:PATH(@"foo")];
+  [engine updateServerCache:NODE(@"replaced") atPath:PATH(@"foo/a") merge:NO];
+  FPruneForest *pruneForest = [[[FPruneForest empty] prunePath:PATH(@"foo")]
+      keepPath:PATH(@"foo/d")];
+  [engine pruneCache:pruneForest atPath:[FPath empty]];
+  NSUInteger size = [engine serverCacheEstimatedSizeInBytes];
+  XCTAssertGreaterThan(size, 0);
+  [engine close];
+
+  FLevelDBStorageEngine *reopened = [[FLevelDBStorageEngine alloc] initWithPath:path];
+  XCTAssertEqual([reopened serverCacheEstimatedSizeInBytes], size);
+  [reopened close];
+}
+
+- (void)testServerCacheIndexValuesOnlyLoadIndexPath {
+  FLevelDBStorageEngine *engine = [self cleanStorageEngine];
+  [engine updateServerCache:NODE((@{
+            @"a" : @{@"order" : @{@"x" : @2}, @"other" : @"a"},
+            @"b" : @{@"order" : @{@"x" : @1, @"y" : @"ignored"}},
+            @"c" : @{@"other" : @"no index value"},
+            @"d" : @"leaf"
+          }))
+                     atPath:PATH(@"foo")
+                      merge:NO];
+
+  id<FNode> node = [engine serverCacheIndexValuesAtPath:PATH(@"foo")
+                                           forIndexPath:PATH(@"order/x")];
+  XCTAssertEqual([node numChildren], 4);
+  XCTAssertEqualObjects([node getChild:PATH(@"a")],
+                        NODE((@{@"order" : @{@"x" : @2}})));
+  XCTAssertEqualObjects([node getChild:PATH(@"b")],
+                        NODE((@{@"order" : @{@"x" : @1}})));
+  XCTAssertTrue([[node getChild:PATH(@"c/order/x")] isEmpty]);
+  XCTAssertTrue([[node getChild:PATH(@"d/order/x")] isEmpty]);
+}
+
 - (void)testSaveAndLoadTrackedQueries {
   FLevelDBStorageEngine *engine = [self cleanStorageEngine];
 
@@ -675,6 +764,28 @@
                         ([NSSet setWithArray:@[ @"c", @"d", @"e" ]]));
 }
 
+- (void)testTrackedQueryKeysAreLoadedByNewEngine {
+  FLevelDBStorageEngine *engine = [self cleanStorageEngine];
+  [engine setTrackedQueryKeys:[NSSet setWithArray:@[ @"a", @"b", @"c" ]] forQueryId:1];
+  [engine setTrackedQueryKeys:[NSSet setWithArray:@[ @"d" ]] forQueryId:12];
+  [engine updateTrackedQueryKeysWithAddedKeys:[NSSet setWithArray:@[ @"e" ]]
+                                  removedKeys:[NSSet setWithArray:@[ @"a" ]]
+                                   forQueryId:1];
+  [engine updateTrackedQueryKeysWithAddedKeys:[NSSet setWithArray:@[ @"f" ]]
+                                  removedKeys:[NSSet set]
+                                   forQueryId:2];
+  [engine close];
+
+  NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"test-db"];
+  FLevelDBStorageEngine *reopened = [[FLevelDBStorageEngine alloc] initWithPath:path];
+  XCTAssertEqualObjects([reopened trackedQueryKeysForQuery:1],
+                        ([NSSet setWithArray:@[ @"b", @"c", @"e" ]]));
+  XCTAssertEqualObjects([reopened trackedQueryKeysForQuery:2], [NSSet setWithObject:@"f"]);
+  XCTAssertEqualObjects([reopened trackedQueryKeysForQuery:12], [NSSet setWithObject:@"d"]);
+  XCTAssertEqualObjects([reopened trackedQueryKeysForQuery:3], [NSSet set]);
+  [reopened close];
+}
+
 - (void)testRemoveTrackedQueryRemovesTrackedQueryKeys {
   FLevelDBStorageEngine *engine = [self cleanStorageEngine];
   FTrackedQuery *query1 =
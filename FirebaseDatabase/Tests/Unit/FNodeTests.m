@@ -189,4 +189,26 @@
   XCTAssertTrue([[empty2 getPriority] isEmpty]);
 }
 
+- (void)testArrayNodeEqualsDictionaryNode {
+  NSMutableArray *array = [NSMutableArray array];
+  NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+  for (int i = 0; i < 1000; i++) {
+    id value = i % 7 == 0 ? [NSNull null] : (i % 5 == 0 ? @{@"nested" : @(i)} : @(i * 0.5));
+    [array addObject:value];
+    dictionary[[NSString stringWithFormat:@"%i", i]] = value;
+  }
+
+  id<FNode> arrayNode = [FSnapshotUtilities nodeFrom:array];
+  id<FNode> dictionaryNode = [FSnapshotUtilities nodeFrom:dictionary];
+  XCTAssertEqualObjects(arrayNode, dictionaryNode);
+  XCTAssertEqual(arrayNode.hash, dictionaryNode.hash);
+  __block int previous = -1;
+  [arrayNode enumerateChildrenUsingBlock:^(NSString *key, id<FNode> node, BOOL *stop) {
+    XCTAssertGreaterThan(key.intValue, previous);
+    previous = key.intValue;
+  }];
+  XCTAssertTrue([[arrayNode getImmediateChild:@"7"] isEmpty]);
+  XCTAssertEqualObjects([arrayNode getImmediateChild:@"3"].val, @1.5);
+}
+
 @end
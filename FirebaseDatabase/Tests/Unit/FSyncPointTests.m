@@ -87,8 +87,9 @@ typedef NSDictionary * (^fbt_nsdictionary_void)(void);
   }
 }
 
-- (void)fireEvent:(id<FEvent>)event queue:(dispatch_queue_t)queue {
+- (fbt_void_void)callbackForEvent:(id<FEvent>)event {
   [NSException raise:@"NotImplementedError" format:@"Method not implemented."];
+  return nil;
 }
 - (FCancelEvent *)createCancelEventFromError:(NSError *)error path:(FPath *)path {
   [NSException raise:@"NotImplementedError" format:@"Method not implemented."];
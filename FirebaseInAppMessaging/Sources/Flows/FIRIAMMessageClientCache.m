@@ -34,6 +34,10 @@
 @property(nonatomic) NSMutableArray<FIRIAMMessageDefinition *> *testMessages;
 @property(nonatomic, weak) id<FIRIAMCacheDataObserver> observer;
 @property(nonatomic) NSMutableSet<NSString *> *firebaseAnalyticEventsToWatch;
+// regular messages keyed by the Firebase Analytics event names that trigger them, each list
+// kept in the same order as regularMessages
+@property(nonatomic) NSMutableDictionary<NSString *, NSMutableArray<FIRIAMMessageDefinition *> *>
+    *messagesByEventName;
 @property(nonatomic) id<FIRIAMBookKeeper> bookKeeper;
 @property(readonly, nonatomic) FIRIAMFetchResponseParser *responseParser;
 
@@ -99,11 +103,24 @@
 // on analytics event based on current fiam message set
 - (void)setupAnalyticsEventListening {
   self.firebaseAnalyticEventsToWatch = [[NSMutableSet alloc] init];
+  self.messagesByEventName = [[NSMutableDictionary alloc] init];
   for (FIRIAMMessageDefinition *nextMessage in self.regularMessages) {
-    // if it's event based triggering, add it to the watch set
+    // if it's event based triggering, add it to the watch set and index it by the event name
     for (FIRIAMDisplayTriggerDefinition *nextTrigger in nextMessage.renderTriggers) {
       if (nextTrigger.triggerType == FIRIAMRenderTriggerOnFirebaseAnalyticsEvent) {
-        [self.firebaseAnalyticEventsToWatch addObject:nextTrigger.firebaseEventName];
+        NSString *eventName = nextTrigger.firebaseEventName;
+        [self.firebaseAnalyticEventsToWatch addObject:eventName];
+
+        NSMutableArray<FIRIAMMessageDefinition *> *eventMessages =
+            self.messagesByEventName[eventName];
+        if (!eventMessages) {
+          eventMessages = [[NSMutableArray alloc] init];
+          self.messagesByEventName[eventName] = eventMessages;
+        }
+        // a message may have several triggers on the same event
+        if (eventMessages.lastObject != nextMessage) {
+          [eventMessages addObject:nextMessage];
+        }
       }
     }
   }
@@ -182,12 +199,11 @@
   NSSet<NSString *> *impressionSet =
       [NSSet setWithArray:[self.bookKeeper getMessageIDsFromImpressions]];
   @synchronized(self) {
-    for (FIRIAMMessageDefinition *next in self.regularMessages) {
-      // message being active and message not impressed yet and the contextual trigger condition
-      // match
+    // only the messages triggered by this event need to be checked, in display priority order
+    for (FIRIAMMessageDefinition *next in self.messagesByEventName[eventName]) {
+      // message being active and message not impressed yet
       if ([next messageHasStarted] && ![next messageHasExpired] &&
-          ![impressionSet containsObject:next.renderData.messageID] &&
-          [next messageRenderedOnAnalyticsEvent:eventName]) {
+          ![impressionSet containsObject:next.renderData.messageID]) {
         return next;
       }
     }
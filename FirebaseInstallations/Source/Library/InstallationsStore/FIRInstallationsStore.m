@@ -37,6 +37,10 @@ NSString *const kFIRInstallationsStoreUserDefaultsID = @"com.firebase.FIRInstall
 @property(nonatomic, readonly, nullable) NSString *accessGroup;
 @property(nonatomic, readonly) dispatch_queue_t queue;
 @property(nonatomic, readonly) GULUserDefaults *userDefaults;
+/// Installations read from or written to the keychain by this store keyed by the item identifier.
+/// Must be accessed on `queue` only.
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSString *, FIRInstallationsStoredItem *> *storedItemsCache;
 @end
 
 @implementation FIRInstallationsStore
@@ -51,6 +55,7 @@ NSString *const kFIRInstallationsStoreUserDefaultsID = @"com.firebase.FIRInstall
 
     NSString *userDefaultsSuiteName = _accessGroup ?: kFIRInstallationsStoreUserDefaultsID;
     _userDefaults = [[GULUserDefaults alloc] initWithSuiteName:userDefaultsSuiteName];
+    _storedItemsCache = [[NSMutableDictionary alloc] init];
   }
   return self;
 }
@@ -60,9 +65,21 @@ NSString *const kFIRInstallationsStoreUserDefaultsID = @"com.firebase.FIRInstall
   NSString *itemID = [FIRInstallationsItem identifierWithAppID:appID appName:appName];
   return [self installationExistsForAppID:appID appName:appName]
       .then(^id(id result) {
+        return [self cachedStoredItemWithIdentifier:itemID];
+      })
+      .then(^id(FIRInstallationsStoredItem *_Nullable cachedItem) {
+        if (cachedItem) {
+          return cachedItem;
+        }
+
+        // Read the keychain only once per installation, the subsequent requests are served from
+        // the memory.
         return [self.secureStorage getObjectForKey:itemID
                                        objectClass:[FIRInstallationsStoredItem class]
-                                       accessGroup:self.accessGroup];
+                                       accessGroup:self.accessGroup]
+            .then(^id(FIRInstallationsStoredItem *_Nullable storedItem) {
+              return [self cacheStoredItem:storedItem withIdentifier:itemID];
+            });
       })
       .then(^id(FIRInstallationsStoredItem *_Nullable storedItem) {
         if (storedItem == nil) {
@@ -80,21 +97,47 @@ NSString *const kFIRInstallationsStoreUserDefaultsID = @"com.firebase.FIRInstall
   FIRInstallationsStoredItem *storedItem = [installationItem storedItem];
   NSString *identifier = [installationItem identifier];
 
-  return
-      [self.secureStorage setObject:storedItem forKey:identifier accessGroup:self.accessGroup].then(
-          ^id(id result) {
-            return [self setInstallationExists:YES forItemWithIdentifier:identifier];
-          });
+  return [self.secureStorage setObject:storedItem forKey:identifier accessGroup:self.accessGroup]
+      .then(^id(id result) {
+        return [self cacheStoredItem:storedItem withIdentifier:identifier];
+      })
+      .then(^id(id result) {
+        return [self setInstallationExists:YES forItemWithIdentifier:identifier];
+      });
 }
 
 - (FBLPromise<NSNull *> *)removeInstallationForAppID:(NSString *)appID appName:(NSString *)appName {
   NSString *identifier = [FIRInstallationsItem identifierWithAppID:appID appName:appName];
-  return [self.secureStorage removeObjectForKey:identifier accessGroup:self.accessGroup].then(
-      ^id(id result) {
+  return [self.secureStorage removeObjectForKey:identifier accessGroup:self.accessGroup]
+      .then(^id(id result) {
+        return [self cacheStoredItem:nil withIdentifier:identifier];
+      })
+      .then(^id(id result) {
         return [self setInstallationExists:NO forItemWithIdentifier:identifier];
       });
 }
 
+#pragma mark - In-memory cache
+
+- (FBLPromise<FIRInstallationsStoredItem *> *)cachedStoredItemWithIdentifier:
+    (NSString *)identifier {
+  return [FBLPromise onQueue:self.queue
+                          do:^id _Nullable {
+                            return self.storedItemsCache[identifier];
+                          }];
+}
+
+/// Updates the cache and resolves with the passed item. Passing `nil` removes the cached item.
+- (FBLPromise<FIRInstallationsStoredItem *> *)cacheStoredItem:
+                                                  (nullable FIRInstallationsStoredItem *)storedItem
+                                               withIdentifier:(NSString *)identifier {
+  return [FBLPromise onQueue:self.queue
+                          do:^id _Nullable {
+                            self.storedItemsCache[identifier] = storedItem;
+                            return storedItem;
+                          }];
+}
+
 #pragma mark - User defaults
 
 - (FBLPromise<NSNull *> *)installationExistsForAppID:(NSString *)appID appName:(NSString *)appName {
@@ -101,6 +101,42 @@
   OCMVerifyAll(self.mockSecureStorage);
 }
 
+- (void)testInstallationID_WhenRequestedTwice_ThenKeychainIsReadOnce {
+  NSString *appID = @"123";
+  NSString *appName = @"name";
+  NSString *itemID = [self itemIDWithAppID:appID appName:appName];
+
+  [self.userDefaults setObject:@(YES) forKey:itemID];
+
+  FIRInstallationsStoredItem *storedItem = [self createValidStoredItem];
+
+  OCMExpect([self.mockSecureStorage getObjectForKey:itemID
+                                        objectClass:[FIRInstallationsStoredItem class]
+                                        accessGroup:self.accessGroup])
+      .andReturn([FBLPromise resolvedWith:storedItem]);
+
+  FBLPromise<FIRInstallationsItem *> *itemPromise = [self.store installationForAppID:appID
+                                                                             appName:appName];
+  XCTAssert(FBLWaitForPromisesWithTimeout(0.5));
+  XCTAssertTrue(itemPromise.isFulfilled);
+  OCMVerifyAll(self.mockSecureStorage);
+
+  // The second request must be served from the memory.
+  OCMReject([self.mockSecureStorage getObjectForKey:[OCMArg any]
+                                        objectClass:[OCMArg any]
+                                        accessGroup:[OCMArg any]]);
+
+  FBLPromise<FIRInstallationsItem *> *secondItemPromise =
+      [self.store installationForAppID:appID appName:appName];
+  XCTAssert(FBLWaitForPromisesWithTimeout(0.5));
+
+  XCTAssertTrue(secondItemPromise.isFulfilled);
+  XCTAssertNotEqual(secondItemPromise.value, itemPromise.value);
+  [self assertStoredItem:storedItem correspondsToItem:secondItemPromise.value];
+
+  OCMVerifyAll(self.mockSecureStorage);
+}
+
 - (void)testInstallationID_WhenThereIsUserDefaultsAndNoKeychain_ThenNotFound {
   NSString *appID = @"123";
   NSString *appName = @"name";
@@ -113,9 +113,10 @@ NSSet<NSString *> *GetSystemDenyListURLStrings(void) {
  */
 - (FPRURLAllowlistStatus)isURLAllowed:(NSString *)URL {
   if (self.allowlistDomains && !self.disablePlist) {
+    // Parse the URL once rather than for every allowlisted domain.
+    NSString *host = [[NSURLComponents alloc] initWithString:URL].host;
     for (NSString *allowlistDomain in self.allowlistDomains) {
-      NSURLComponents *components = [[NSURLComponents alloc] initWithString:URL];
-      if ([components.host containsString:allowlistDomain]) {
+      if ([host containsString:allowlistDomain]) {
         return FPRURLAllowlistStatusAllowed;
       }
     }
@@ -20,7 +20,6 @@
 
 #import "FirebasePerformance/Sources/FPRConsoleLogger.h"
 
-#import <assert.h>
 #import <mach/mach.h>
 
 @interface FPRCPUGaugeCollector ()
@@ -39,64 +38,44 @@
 /**
  * Fetches the CPU metric and returns an instance of FPRCPUGaugeData.
  *
- * This implementation is inspired by the following references:
- * http://web.mit.edu/darwin/src/modules/xnu/osfmk/man/thread_basic_info.html
+ * The CPU time of the threads that have terminated comes from the basic task info, and the CPU time
+ * of the live threads from the thread times task info, which the kernel sums up in a single call
+ * instead of the threads having to be listed and queried one by one.
+ *
+ * References:
+ * http://web.mit.edu/darwin/src/modules/xnu/osfmk/man/task_info.html
  * https://stackoverflow.com/a/8382889
  *
  * @return Instance of FPRCPUGaugeData.
  */
 FPRCPUGaugeData *fprCollectCPUMetric() {
   kern_return_t kernelReturnValue;
-  mach_msg_type_number_t task_info_count;
-  task_info_data_t taskInfo;
-  thread_array_t threadList;
-  mach_msg_type_number_t threadCount;
-  task_basic_info_t taskBasicInfo;
-  thread_basic_info_t threadBasicInfo;
-
   NSDate *collectionTime = [NSDate date];
+
   // Get the task info to find out the CPU time used by terminated threads.
-  task_info_count = TASK_BASIC_INFO_COUNT;
-  kernelReturnValue =
-      task_info(mach_task_self(), TASK_BASIC_INFO, (task_info_t)taskInfo, &task_info_count);
+  struct task_basic_info taskBasicInfo;
+  mach_msg_type_number_t taskBasicInfoCount = TASK_BASIC_INFO_COUNT;
+  kernelReturnValue = task_info(mach_task_self(), TASK_BASIC_INFO, (task_info_t)&taskBasicInfo,
+                                &taskBasicInfoCount);
   if (kernelReturnValue != KERN_SUCCESS) {
     return nil;
   }
-  taskBasicInfo = (task_basic_info_t)taskInfo;
 
-  // Get the current set of threads and find their CPU time.
-  kernelReturnValue = task_threads(mach_task_self(), &threadList, &threadCount);
+  // Get the CPU time used by the live threads.
+  struct task_thread_times_info threadTimesInfo;
+  mach_msg_type_number_t threadTimesInfoCount = TASK_THREAD_TIMES_INFO_COUNT;
+  kernelReturnValue = task_info(mach_task_self(), TASK_THREAD_TIMES_INFO,
+                                (task_info_t)&threadTimesInfo, &threadTimesInfoCount);
   if (kernelReturnValue != KERN_SUCCESS) {
     return nil;
   }
 
   uint64_t totalUserTimeUsec =
-      taskBasicInfo->user_time.seconds * USEC_PER_SEC + taskBasicInfo->user_time.microseconds;
+      taskBasicInfo.user_time.seconds * USEC_PER_SEC + taskBasicInfo.user_time.microseconds +
+      threadTimesInfo.user_time.seconds * USEC_PER_SEC + threadTimesInfo.user_time.microseconds;
   uint64_t totalSystemTimeUsec =
-      taskBasicInfo->system_time.seconds * USEC_PER_SEC + taskBasicInfo->system_time.microseconds;
-  thread_info_data_t threadInfo;
-  mach_msg_type_number_t threadInfoCount;
-
-  for (int i = 0; i < (int)threadCount; i++) {
-    threadInfoCount = THREAD_INFO_MAX;
-    kernelReturnValue =
-        thread_info(threadList[i], THREAD_BASIC_INFO, (thread_info_t)threadInfo, &threadInfoCount);
-    if (kernelReturnValue != KERN_SUCCESS) {
-      return nil;
-    }
-
-    threadBasicInfo = (thread_basic_info_t)threadInfo;
-    if (!(threadBasicInfo->flags & TH_FLAGS_IDLE)) {
-      totalUserTimeUsec += threadBasicInfo->user_time.seconds * USEC_PER_SEC +
-                           threadBasicInfo->user_time.microseconds;
-      totalSystemTimeUsec += threadBasicInfo->system_time.seconds * USEC_PER_SEC +
-                             threadBasicInfo->system_time.microseconds;
-    }
-  }
-
-  kernelReturnValue =
-      vm_deallocate(mach_task_self(), (vm_offset_t)threadList, threadCount * sizeof(thread_t));
-  assert(kernelReturnValue == KERN_SUCCESS);
+      taskBasicInfo.system_time.seconds * USEC_PER_SEC + taskBasicInfo.system_time.microseconds +
+      threadTimesInfo.system_time.seconds * USEC_PER_SEC + threadTimesInfo.system_time.microseconds;
 
   FPRCPUGaugeData *gaugeData = [[FPRCPUGaugeData alloc] initWithCollectionTime:collectionTime
                                                                     systemTime:totalSystemTimeUsec
@@ -73,7 +73,8 @@ NSString *const kFPRNetworkTracePropertyName = @"fpr_networkTrace";
   // Fail early instead of creating a trace here.
   // IMPORTANT: Order is important here. This check needs to be done before looking up on remote
   // config. Reference bug: b/141861005.
-  if (![[FPRURLFilter sharedInstance] shouldInstrumentURL:URLRequest.URL.absoluteString]) {
+  NSString *URLString = URLRequest.URL.absoluteString;
+  if (![[FPRURLFilter sharedInstance] shouldInstrumentURL:URLString]) {
     return nil;
   }
 
@@ -95,7 +96,7 @@ NSString *const kFPRNetworkTracePropertyName = @"fpr_networkTrace";
     return nil;
   }
 
-  if (![URLRequest.URL.absoluteString isEqualToString:trimmedURLString]) {
+  if (![URLString isEqualToString:trimmedURLString]) {
     FPRLogInfo(kFPRNetworkTraceURLLengthTruncation,
                @"URL length exceeds limits, truncating recorded URL - %@.", trimmedURLString);
   }
@@ -335,9 +336,7 @@ NSString *const kFPRNetworkTracePropertyName = @"fpr_networkTrace";
   }
 
   // Check the URL begins with http or https.
-  NSURLComponents *components = [NSURLComponents componentsWithURL:URLRequest.URL
-                                           resolvingAgainstBaseURL:NO];
-  NSString *scheme = components.scheme;
+  NSString *scheme = URLRequest.URL.scheme;
   if (!scheme || !([scheme caseInsensitiveCompare:@"HTTP"] == NSOrderedSame ||
                    [scheme caseInsensitiveCompare:@"HTTPS"] == NSOrderedSame)) {
     FPRLogError(kFPRNetworkTraceInvalidInputs, @"Invalid URL - %@, returning nil.", URLRequest.URL);
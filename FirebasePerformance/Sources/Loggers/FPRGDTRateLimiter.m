@@ -89,16 +89,23 @@
     }
   }
 
-  CGFloat rate = [self resolvedTraceRate];
-  NSInteger eventCount = self.allowedTraceEventsCount;
-  NSInteger eventBurstSize = self.traceEventBurstSize;
+  // Only the rate of the event's own type is resolved, since that reads the configurations.
+  BOOL isNetworkEvent = [self isNetworkEvent:logEvent];
   NSDate *currentTime = [self.date now];
-  NSTimeInterval interval = [currentTime timeIntervalSinceDate:self.lastTraceEventTime];
-  if ([self isNetworkEvent:logEvent]) {
+  CGFloat rate;
+  NSInteger eventCount;
+  NSInteger eventBurstSize;
+  NSTimeInterval interval;
+  if (isNetworkEvent) {
     rate = [self resolvedNetworkRate];
     interval = [currentTime timeIntervalSinceDate:self.lastNetworkEventTime];
     eventCount = self.allowedNetworkEventsCount;
     eventBurstSize = self.networkEventburstSize;
+  } else {
+    rate = [self resolvedTraceRate];
+    interval = [currentTime timeIntervalSinceDate:self.lastTraceEventTime];
+    eventCount = self.allowedTraceEventsCount;
+    eventBurstSize = self.traceEventBurstSize;
   }
 
   eventCount = [self numberOfAllowedEvents:eventCount
@@ -108,7 +115,7 @@
 
   // Dispatch events only if the allowedEventCount is greater than zero, else drop the event.
   if (eventCount > 0) {
-    if ([self isNetworkEvent:logEvent]) {
+    if (isNetworkEvent) {
       self.allowedNetworkEventsCount = --eventCount;
       self.lastNetworkEventTime = currentTime;
     } else {
@@ -121,7 +128,7 @@
   // Find the type of the log event.
   FPRAppActivityTracker *appActivityTracker = [FPRAppActivityTracker sharedInstance];
   NSString *counterName = kFPRAppCounterNameTraceEventsRateLimited;
-  if ([self isNetworkEvent:logEvent]) {
+  if (isNetworkEvent) {
     counterName = kFPRAppCounterNameNetworkTraceEventsRateLimited;
   }
   [appActivityTracker.activeTrace incrementMetric:counterName byInt:1];
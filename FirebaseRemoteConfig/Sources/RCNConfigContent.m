@@ -113,6 +113,7 @@ static const NSTimeInterval kDatabaseLoadTimeoutSecs = 30.0;
   NSAssert(!_isDatabaseLoadAlreadyInitiated, @"Database load has already been initiated");
   _isDatabaseLoadAlreadyInitiated = true;
 
+  NSDate *loadStart = [NSDate date];
   [_DBManager
       loadMainWithBundleIdentifier:_bundleIdentifier
                  completionHandler:^(BOOL success, NSDictionary *fetchedConfig,
@@ -120,6 +121,9 @@ static const NSTimeInterval kDatabaseLoadTimeoutSecs = 30.0;
                    self->_fetchedConfig = [fetchedConfig mutableCopy];
                    self->_activeConfig = [activeConfig mutableCopy];
                    self->_defaultConfig = [defaultConfig mutableCopy];
+                   FIRLogDebug(kFIRLoggerRemoteConfig, @"I-RCN000076",
+                               @"Loaded config from database in %.1fms.",
+                               [loadStart timeIntervalSinceNow] * -1000);
                    dispatch_semaphore_signal(self->_configLoadFromDBSemaphore);
                  }];
 
@@ -133,10 +137,13 @@ static const NSTimeInterval kDatabaseLoadTimeoutSecs = 30.0;
 }
 
 /// Update the current config result to main table.
-/// @param values Values in a row to write to the table.
+/// @param rows Values of the rows to write to the table, which are written in a single transaction.
 /// @param source The source the config data is coming from. It determines which table to write to.
-- (void)updateMainTableWithValues:(NSArray *)values fromSource:(RCNDBSource)source {
-  [_DBManager insertMainTableWithValues:values fromSource:source completionHandler:nil];
+- (void)updateMainTableWithRows:(NSArray<NSArray *> *)rows fromSource:(RCNDBSource)source {
+  if (rows.count == 0) {
+    return;
+  }
+  [_DBManager insertMainTableWithRows:rows fromSource:source completionHandler:nil];
 }
 
 #pragma mark - update
@@ -182,6 +189,7 @@ static const NSTimeInterval kDatabaseLoadTimeoutSecs = 30.0;
 
   toDict[FIRNamespace] = [[NSMutableDictionary alloc] init];
   NSDictionary *config = fromDict[FIRNamespace];
+  NSMutableArray<NSArray *> *rows = [NSMutableArray arrayWithCapacity:config.count];
   for (NSString *key in config) {
     if (DBSource == FIRRemoteConfigSourceDefault) {
       NSObject *value = config[key];
@@ -203,16 +211,15 @@ static const NSTimeInterval kDatabaseLoadTimeoutSecs = 30.0;
       }
       toDict[FIRNamespace][key] = [[FIRRemoteConfigValue alloc] initWithData:valueData
                                                                       source:source];
-      NSArray *values = @[ _bundleIdentifier, FIRNamespace, key, valueData ];
-      [self updateMainTableWithValues:values fromSource:DBSource];
+      [rows addObject:@[ _bundleIdentifier, FIRNamespace, key, valueData ]];
     } else {
       FIRRemoteConfigValue *value = config[key];
       toDict[FIRNamespace][key] = [[FIRRemoteConfigValue alloc] initWithData:value.dataValue
                                                                       source:source];
-      NSArray *values = @[ _bundleIdentifier, FIRNamespace, key, value.dataValue ];
-      [self updateMainTableWithValues:values fromSource:DBSource];
+      [rows addObject:@[ _bundleIdentifier, FIRNamespace, key, value.dataValue ]];
     }
   }
+  [self updateMainTableWithRows:rows fromSource:DBSource];
 }
 
 - (void)updateConfigContentWithResponse:(NSDictionary *)response
@@ -304,6 +311,7 @@ static const NSTimeInterval kDatabaseLoadTimeoutSecs = 30.0;
   }
 
   // Store the fetched config values.
+  NSMutableArray<NSArray *> *rows = [NSMutableArray arrayWithCapacity:entries.count];
   for (NSString *key in entries) {
     NSData *valueData = [entries[key] dataUsingEncoding:NSUTF8StringEncoding];
     if (!valueData) {
@@ -311,9 +319,9 @@ static const NSTimeInterval kDatabaseLoadTimeoutSecs = 30.0;
     }
     _fetchedConfig[currentNamespace][key] =
         [[FIRRemoteConfigValue alloc] initWithData:valueData source:FIRRemoteConfigSourceRemote];
-    NSArray *values = @[ _bundleIdentifier, currentNamespace, key, valueData ];
-    [self updateMainTableWithValues:values fromSource:RCNDBSourceFetched];
+    [rows addObject:@[ _bundleIdentifier, currentNamespace, key, valueData ]];
   }
+  [self updateMainTableWithRows:rows fromSource:RCNDBSourceFetched];
 }
 
 - (void)handleUpdatePersonalization:(NSDictionary *)metadata {
@@ -89,6 +89,11 @@ typedef void (^RCNDBLoadCompletion)(BOOL success,
 - (void)insertMainTableWithValues:(NSArray *)values
                        fromSource:(RCNDBSource)source
                 completionHandler:(RCNDBCompletion)handler;
+/// Insert records in main table in a single transaction.
+/// @param rows Values of each record to be inserted.
+- (void)insertMainTableWithRows:(NSArray<NSArray *> *)rows
+                     fromSource:(RCNDBSource)source
+              completionHandler:(RCNDBCompletion)handler;
 /// Insert a record in internal metadata table.
 /// @param values Values to be inserted.
 - (void)insertInternalMetadataTableWithValues:(NSArray *)values
@@ -463,6 +463,35 @@ static NSArray *RemoteConfigMetadataTableColumnsInOrder() {
   return YES;
 }
 
+- (void)insertMainTableWithRows:(NSArray<NSArray *> *)rows
+                     fromSource:(RCNDBSource)source
+              completionHandler:(RCNDBCompletion)handler {
+  __weak RCNConfigDBManager *weakSelf = self;
+  dispatch_async(_databaseOperationQueue, ^{
+    BOOL success = [weakSelf insertMainTableWithRows:rows fromSource:source];
+    if (handler) {
+      dispatch_async(dispatch_get_main_queue(), ^{
+        handler(success, nil);
+      });
+    }
+  });
+}
+
+/// Inserts all the rows in one transaction, so the database is only written to disk once rather
+/// than once for every row. A row that fails to insert doesn't prevent the others from being
+/// inserted, as when they are inserted one by one.
+- (BOOL)insertMainTableWithRows:(NSArray<NSArray *> *)rows fromSource:(RCNDBSource)source {
+  RCN_MUST_NOT_BE_MAIN_THREAD();
+  if (![self executeQuery:"BEGIN TRANSACTION"]) {
+    return NO;
+  }
+  BOOL success = YES;
+  for (NSArray *values in rows) {
+    success = [self insertMainTableWithValues:values fromSource:source] && success;
+  }
+  return [self executeQuery:"COMMIT TRANSACTION"] && success;
+}
+
 - (void)insertInternalMetadataTableWithValues:(NSArray *)values
                             completionHandler:(RCNDBCompletion)handler {
   __weak RCNConfigDBManager *weakSelf = self;
@@ -154,6 +154,43 @@
                                }];
 }
 
+- (void)testWriteAndLoadMainTableRows {
+  XCTestExpectation *loadConfigContentExpectation =
+      [self expectationWithDescription:@"Write rows in a transaction and read them in database"];
+  NSString *namespace_p = @"namespace_1";
+  NSString *bundleIdentifier = [NSBundle mainBundle].bundleIdentifier;
+  NSMutableArray<NSArray *> *rows = [NSMutableArray array];
+  for (int i = 0; i <= 100; ++i) {
+    NSString *value = [NSString stringWithFormat:@"value%d", i];
+    NSString *key = [NSString stringWithFormat:@"key%d", i];
+    [rows addObject:@[
+      bundleIdentifier, namespace_p, key, [value dataUsingEncoding:NSUTF8StringEncoding]
+    ]];
+  }
+  RCNDBCompletion insertCompletion = ^void(BOOL success, NSDictionary *result) {
+    XCTAssertTrue(success);
+    [self->_DBManager loadMainWithBundleIdentifier:bundleIdentifier
+                                 completionHandler:^(BOOL success, NSDictionary *fetchedConfig,
+                                                     NSDictionary *activeConfig,
+                                                     NSDictionary *defaultConfig) {
+                                   XCTAssertTrue(success);
+                                   XCTAssertEqual([fetchedConfig[namespace_p] count], 101U);
+                                   FIRRemoteConfigValue *value =
+                                       fetchedConfig[namespace_p][@"key100"];
+                                   XCTAssertEqualObjects(value.stringValue, @"value100");
+                                   [loadConfigContentExpectation fulfill];
+                                 }];
+  };
+  [_DBManager insertMainTableWithRows:rows
+                           fromSource:RCNDBSourceFetched
+                    completionHandler:insertCompletion];
+
+  [self waitForExpectationsWithTimeout:_expectionTimeout
+                               handler:^(NSError *error) {
+                                 XCTAssertNil(error);
+                               }];
+}
+
 - (void)testWriteAndLoadInternalMetadataResult {
   XCTestExpectation *loadConfigContentExpectation = [self
       expectationWithDescription:@"Write and read internal metadata in database successfully"];
@@ -32,8 +32,12 @@
 #else
 #import <GTMSessionFetcher/GTMSessionFetcher.h>
 #import <GTMSessionFetcher/GTMSessionFetcherLogging.h>
+#import <GTMSessionFetcher/GTMSessionUploadFetcher.h>
 #endif
 
+// Resumable uploads must be sent in chunks that are a multiple of this size, except for the last.
+static const int64_t kFIRStorageUploadChunkSizeGranularity = 256 * 1024;
+
 static NSMutableDictionary<
     NSString * /* app name */,
     NSMutableDictionary<NSString * /* bucket */, GTMSessionFetcherService *> *> *_fetcherServiceMap;
@@ -46,6 +50,7 @@ static GTMSessionFetcherRetryBlock _retryWhenOffline;
   NSTimeInterval _maxUploadRetryTime;
   NSTimeInterval _maxDownloadRetryTime;
   NSTimeInterval _maxOperationRetryTime;
+  int64_t _uploadChunkSizeBytes;
 }
 @end
 
@@ -174,6 +179,7 @@ static GTMSessionFetcherRetryBlock _retryWhenOffline;
     _maxUploadRetryTime = 600.0;
     _maxUploadRetryInterval =
         [FIRStorageUtils computeRetryIntervalFromRetryTime:_maxUploadRetryTime];
+    _uploadChunkSizeBytes = kGTMSessionUploadFetcherStandardChunkSize;
   }
   return self;
 }
@@ -268,6 +274,28 @@ static GTMSessionFetcherRetryBlock _retryWhenOffline;
   }
 }
 
+#pragma mark - Upload chunk size
+
+- (void)setUploadChunkSizeBytes:(int64_t)uploadChunkSizeBytes {
+  @synchronized(self) {
+    if (uploadChunkSizeBytes <= 0 ||
+        uploadChunkSizeBytes > kGTMSessionUploadFetcherStandardChunkSize -
+                                   kFIRStorageUploadChunkSizeGranularity) {
+      _uploadChunkSizeBytes = kGTMSessionUploadFetcherStandardChunkSize;
+      return;
+    }
+    int64_t chunks = (uploadChunkSizeBytes + kFIRStorageUploadChunkSizeGranularity - 1) /
+                     kFIRStorageUploadChunkSizeGranularity;
+    _uploadChunkSizeBytes = chunks * kFIRStorageUploadChunkSizeGranularity;
+  }
+}
+
+- (int64_t)uploadChunkSizeBytes {
+  @synchronized(self) {
+    return _uploadChunkSizeBytes;
+  }
+}
+
 #pragma mark - Public methods
 
 - (FIRStorageReference *)reference {
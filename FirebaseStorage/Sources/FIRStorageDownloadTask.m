@@ -20,7 +20,10 @@
 #import "FirebaseStorage/Sources/FIRStorageTask_Private.h"
 #import "FirebaseStorage/Sources/FIRStorage_Private.h"
 
-@implementation FIRStorageDownloadTask
+@implementation FIRStorageDownloadTask {
+  // The file that downloads to memory are written to, nil for downloads to a file.
+  NSURL *_Nullable _temporaryFileURL;
+}
 
 @synthesize progress = _progress;
 @synthesize fetcher = _fetcher;
@@ -40,6 +43,9 @@
 
 - (void)dealloc {
   [_fetcher stopFetching];
+  if (_temporaryFileURL) {
+    [[NSFileManager defaultManager] removeItemAtURL:_temporaryFileURL error:NULL];
+  }
 }
 
 - (void)enqueue {
@@ -83,36 +89,32 @@
 
     fetcher.maxRetryInterval = strongSelf.reference.storage.maxDownloadRetryInterval;
 
-    if (strongSelf->_fileURL) {
-      // Handle file downloads
-      [fetcher setDestinationFileURL:strongSelf->_fileURL];
-      [fetcher setDownloadProgressBlock:^(int64_t bytesWritten, int64_t totalBytesWritten,
-                                          int64_t totalBytesExpectedToWrite) {
-        weakSelf.state = FIRStorageTaskStateProgress;
-        weakSelf.progress.completedUnitCount = totalBytesWritten;
-        weakSelf.progress.totalUnitCount = totalBytesExpectedToWrite;
-        FIRStorageTaskSnapshot *snapshot = weakSelf.snapshot;
-        [weakSelf fireHandlersForStatus:FIRStorageTaskStatusProgress snapshot:snapshot];
-        weakSelf.state = FIRStorageTaskStateRunning;
-      }];
-    } else {
-      // Handle data downloads
-      [fetcher setReceivedProgressBlock:^(int64_t bytesWritten, int64_t totalBytesWritten) {
-        weakSelf.state = FIRStorageTaskStateProgress;
-        weakSelf.progress.completedUnitCount = totalBytesWritten;
-        int64_t totalLength = [[weakSelf.fetcher response] expectedContentLength];
-        weakSelf.progress.totalUnitCount = totalLength;
-        FIRStorageTaskSnapshot *snapshot = weakSelf.snapshot;
-        [weakSelf fireHandlersForStatus:FIRStorageTaskStatusProgress snapshot:snapshot];
-        weakSelf.state = FIRStorageTaskStateRunning;
-      }];
-    }
+    // Downloads to memory are written to a temporary file as well, so the bytes aren't held in
+    // memory while downloading and a paused download resumes from where it stopped. The file is
+    // mapped into memory once the download completes.
+    NSURL *destinationFileURL = strongSelf->_fileURL ?: [strongSelf temporaryFileURL];
+    [fetcher setDestinationFileURL:destinationFileURL];
+    [fetcher setDownloadProgressBlock:^(int64_t bytesWritten, int64_t totalBytesWritten,
+                                        int64_t totalBytesExpectedToWrite) {
+      weakSelf.state = FIRStorageTaskStateProgress;
+      weakSelf.progress.completedUnitCount = totalBytesWritten;
+      weakSelf.progress.totalUnitCount = totalBytesExpectedToWrite;
+      FIRStorageTaskSnapshot *snapshot = weakSelf.snapshot;
+      [weakSelf fireHandlersForStatus:FIRStorageTaskStatusProgress snapshot:snapshot];
+      weakSelf.state = FIRStorageTaskStateRunning;
+    }];
 
     strongSelf->_fetcher = fetcher;
     strongSelf->_fetcherCompletion = ^(NSData *data, NSError *error) {
       // Fire last progress updates
       [self fireHandlersForStatus:FIRStorageTaskStatusProgress snapshot:self.snapshot];
 
+      if (!error && !data && self->_temporaryFileURL) {
+        NSError *readError;
+        data = [self dataFromTemporaryFile:&readError];
+        error = readError;
+      }
+
       // Handle potential issues with download
       if (error) {
         self.state = FIRStorageTaskStateFailed;
@@ -145,6 +147,32 @@
   }];
 }
 
+/**
+ * Returns the temporary file that a download to memory is written to, creating its URL if needed.
+ */
+- (NSURL *)temporaryFileURL {
+  if (!_temporaryFileURL) {
+    NSString *fileName =
+        [NSString stringWithFormat:@"FIRStorageDownload-%@", [[NSUUID UUID] UUIDString]];
+    _temporaryFileURL =
+        [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:fileName]];
+  }
+  return _temporaryFileURL;
+}
+
+/**
+ * Maps the completed temporary file into memory and removes it. The mapping stays valid after the
+ * file is removed, and its pages can be dropped and read again as needed instead of being dirty
+ * memory.
+ */
+- (nullable NSData *)dataFromTemporaryFile:(NSError **)outError {
+  NSData *data = [NSData dataWithContentsOfURL:_temporaryFileURL
+                                       options:NSDataReadingMappedIfSafe
+                                         error:outError];
+  [[NSFileManager defaultManager] removeItemAtURL:_temporaryFileURL error:NULL];
+  return data;
+}
+
 #pragma mark - Download Management
 
 - (void)cancel {
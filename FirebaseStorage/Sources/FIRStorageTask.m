@@ -55,6 +55,9 @@
   @synchronized(self) {
     NSProgress *progress = [NSProgress progressWithTotalUnitCount:self.progress.totalUnitCount];
     progress.completedUnitCount = self.progress.completedUnitCount;
+    for (NSString *key in @[ NSProgressThroughputKey, NSProgressEstimatedTimeRemainingKey ]) {
+      [progress setUserInfoObject:self.progress.userInfo[key] forKey:key];
+    }
     FIRStorageTaskSnapshot *snapshot =
         [[FIRStorageTaskSnapshot alloc] initWithTask:self
                                                state:self.state
@@ -27,7 +27,12 @@
 #import <GTMSessionFetcher/GTMSessionUploadFetcher.h>
 #endif
 
-@implementation FIRStorageUploadTask
+@implementation FIRStorageUploadTask {
+  // When and how far into the upload the throughput is measured from, nil until the first progress
+  // update since the upload was started or last resumed.
+  NSDate *_Nullable _throughputStartDate;
+  int64_t _throughputStartBytes;
+}
 
 @synthesize progress = _progress;
 @synthesize fetcherCompletion = _fetcherCompletion;
@@ -115,10 +120,11 @@
     [components setPercentEncodedQuery:[FIRStorageUtils queryStringForDictionary:queryParams]];
     request.URL = components.URL;
 
+    int64_t chunkSize = strongSelf.reference.storage.uploadChunkSizeBytes;
     GTMSessionUploadFetcher *uploadFetcher =
         [GTMSessionUploadFetcher uploadFetcherWithRequest:request
                                            uploadMIMEType:strongSelf->_uploadMetadata.contentType
-                                                chunkSize:kGTMSessionUploadFetcherStandardChunkSize
+                                                chunkSize:chunkSize
                                            fetcherService:self.fetcherService];
 
     if (strongSelf->_uploadData) {
@@ -136,12 +142,14 @@
       weakSelf.state = FIRStorageTaskStateProgress;
       weakSelf.progress.completedUnitCount = totalBytesSent;
       weakSelf.progress.totalUnitCount = totalBytesExpectedToSend;
+      [weakSelf updateThroughputWithTotalBytesSent:totalBytesSent];
       weakSelf.metadata = self->_uploadMetadata;
       [weakSelf fireHandlersForStatus:FIRStorageTaskStatusProgress snapshot:weakSelf.snapshot];
       weakSelf.state = FIRStorageTaskStateRunning;
     }];
 
     strongSelf->_uploadFetcher = uploadFetcher;
+    [strongSelf restartThroughputMeasurement];
 
     // Process fetches
     strongSelf.state = FIRStorageTaskStateRunning;
@@ -186,6 +194,34 @@
   }];
 }
 
+- (void)restartThroughputMeasurement {
+  _throughputStartDate = nil;
+}
+
+/**
+ * Records the average rate the upload was sent at since it was started or last resumed in the
+ * progress, along with the time it would take to send the rest at that rate.
+ */
+- (void)updateThroughputWithTotalBytesSent:(int64_t)totalBytesSent {
+  NSDate *now = [NSDate date];
+  if (!_throughputStartDate) {
+    _throughputStartDate = now;
+    _throughputStartBytes = totalBytesSent;
+    return;
+  }
+
+  NSTimeInterval elapsed = [now timeIntervalSinceDate:_throughputStartDate];
+  if (elapsed <= 0) {
+    return;
+  }
+  double throughput = (totalBytesSent - _throughputStartBytes) / elapsed;
+  [self.progress setUserInfoObject:@((NSUInteger)throughput) forKey:NSProgressThroughputKey];
+  if (throughput > 0) {
+    NSTimeInterval remaining = (self.progress.totalUnitCount - totalBytesSent) / throughput;
+    [self.progress setUserInfoObject:@(remaining) forKey:NSProgressEstimatedTimeRemainingKey];
+  }
+}
+
 - (void)finishTaskWithStatus:(FIRStorageTaskStatus)status
                     snapshot:(FIRStorageTaskSnapshot *)snapshot {
   [self fireHandlersForStatus:status snapshot:self.snapshot];
@@ -257,6 +293,8 @@
 
   [self dispatchAsync:^() {
     weakSelf.state = FIRStorageTaskStateResuming;
+    // The time spent paused doesn't count towards the throughput.
+    [weakSelf restartThroughputMeasurement];
     [weakSelf.uploadFetcher resumeFetching];
     if (weakSelf.state != FIRStorageTaskStateSuccess) {
       weakSelf.metadata = weakSelf.uploadMetadata;
@@ -91,6 +91,13 @@ NS_SWIFT_NAME(Storage)
  */
 @property NSTimeInterval maxOperationRetryTime;
 
+/**
+ * Size in bytes of the chunks that uploads are sent in, rounded up to a multiple of 256 KiB.
+ * Smaller chunks mean less data is sent again when an upload is interrupted, at the cost of a
+ * request for every chunk. Defaults to sending each upload in a single request.
+ */
+@property int64_t uploadChunkSizeBytes;
+
 /**
  * Queue that all developer callbacks are fired on. Defaults to the main queue.
  */
@@ -48,7 +48,9 @@ NS_SWIFT_NAME(StorageTaskSnapshot)
 @property(readonly, copy, nonatomic) FIRStorageReference *reference;
 
 /**
- * NSProgress object which tracks the progress of an upload or download.
+ * NSProgress object which tracks the progress of an upload or download. For uploads, the
+ * `NSProgressThroughputKey` and `NSProgressEstimatedTimeRemainingKey` entries of its `userInfo`
+ * hold the upload rate since it was started or last resumed.
  */
 @property(readonly, strong, nonatomic, nullable) NSProgress *progress;
 
@@ -102,6 +102,19 @@
   XCTAssertNotNil(storage.fetcherServiceForApp);
 }
 
+- (void)testUploadChunkSizeIsRoundedUp {
+  FIRStorage *storage = [FIRStorage storageForApp:self.app];
+  int64_t defaultChunkSize = storage.uploadChunkSizeBytes;
+  storage.uploadChunkSizeBytes = 1;
+  XCTAssertEqual(storage.uploadChunkSizeBytes, 256 * 1024);
+  storage.uploadChunkSizeBytes = 512 * 1024;
+  XCTAssertEqual(storage.uploadChunkSizeBytes, 512 * 1024);
+  storage.uploadChunkSizeBytes = 512 * 1024 + 1;
+  XCTAssertEqual(storage.uploadChunkSizeBytes, 768 * 1024);
+  storage.uploadChunkSizeBytes = 0;
+  XCTAssertEqual(storage.uploadChunkSizeBytes, defaultChunkSize);
+}
+
 - (void)testStorageCustomApp {
   id mockOptions = OCMClassMock([FIROptions class]);
   OCMStub([mockOptions storageBucket]).andReturn(@"bucket");
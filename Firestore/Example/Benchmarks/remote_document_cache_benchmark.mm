@@ -193,4 +193,31 @@ void BM_QueryAll(benchmark::State& state) {
 
 BENCHMARK(BM_QueryAll)->Unit(benchmark::kMicrosecond)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
 
+// Measures a cold start: the time from creating a Firestore instance over an existing cache to the
+// first snapshot served from that cache.
+void BM_TimeToFirstCachedSnapshot(benchmark::State& state) {
+  int64_t total_docs = state.range(0);
+
+  FIRFirestore* db = OpenFirestore();
+  NSString* path = MakeNSString("docs-" + CreateAutoId());
+  WriteDocs([db collectionWithPath:path], total_docs, /*match=*/true);
+  Shutdown(db);
+
+  for (auto _ : state) {
+    db = OpenFirestore();
+    auto docs = GetDocumentsFromCache([db collectionWithPath:path]);
+    (void)docs;
+
+    state.PauseTiming();
+    Shutdown(db);
+    state.ResumeTiming();
+  }
+}
+
+BENCHMARK(BM_TimeToFirstCachedSnapshot)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1)
+    ->Arg(100)
+    ->Arg(1000);
+
 }  // namespace
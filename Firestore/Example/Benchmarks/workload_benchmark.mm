@@ -0,0 +1,297 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <FirebaseFirestore/FirebaseFirestore.h>
+#import "FirebaseCore/Sources/Private/FirebaseCoreInternal.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdlib>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Firestore/core/src/util/autoid.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/string_apple.h"
+#include "Firestore/core/test/unit/testutil/app_testing.h"
+#include "benchmark/benchmark.h"
+
+// Drives workloads shaped like production traffic through the whole SDK against the emulator, so
+// that an SDK upgrade can be checked for regressions before it's rolled out. Start the emulator
+// before running these, and set FIRESTORE_EMULATOR_HOST if it isn't on localhost:8080.
+
+namespace {
+
+using firebase::firestore::testutil::AppForUnitTesting;
+using firebase::firestore::util::CreateAutoId;
+using firebase::firestore::util::MakeNSString;
+using firebase::firestore::util::MakeString;
+
+using Clock = std::chrono::steady_clock;
+
+/** The number of documents written in each iteration. */
+constexpr int kWritesPerIteration = 100;
+
+FIRFirestore* OpenFirestore() {
+  FIRApp* app = AppForUnitTesting();
+  auto db = [FIRFirestore firestoreForApp:app];
+  auto settings = db.settings;
+
+  const char* host = std::getenv("FIRESTORE_EMULATOR_HOST");
+  settings.host = host ? MakeNSString(host) : @"localhost:8080";
+  settings.sslEnabled = NO;
+
+  // The default is the main queue and this deadlocks because the benchmark does not start an event
+  // loop and just runs on the main thread.
+  settings.dispatchQueue = dispatch_queue_create("results", DISPATCH_QUEUE_SERIAL);
+  db.settings = settings;
+
+  return db;
+}
+
+void Shutdown(FIRFirestore* db) {
+  dispatch_semaphore_t done = dispatch_semaphore_create(0);
+  [db terminateWithCompletion:^(NSError*) {
+    dispatch_semaphore_signal(done);
+  }];
+  dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+}
+
+void SetNetworkEnabled(FIRFirestore* db, bool enabled) {
+  dispatch_semaphore_t done = dispatch_semaphore_create(0);
+  void (^completion)(NSError*) = ^(NSError*) {
+    dispatch_semaphore_signal(done);
+  };
+  if (enabled) {
+    [db enableNetworkWithCompletion:completion];
+  } else {
+    [db disableNetworkWithCompletion:completion];
+  }
+  dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+}
+
+double ToMillis(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/** Returns the value that the given fraction of the sorted `values` don't exceed. */
+double Percentile(const std::vector<double>& values, double fraction) {
+  if (values.empty()) return 0;
+  auto index = static_cast<size_t>(fraction * static_cast<double>(values.size() - 1));
+  return values[index];
+}
+
+/** The CPU time the process has used so far, in user and system mode. */
+Clock::duration CpuTime() {
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  auto seconds = std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec);
+  auto micros = std::chrono::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+  return std::chrono::duration_cast<Clock::duration>(seconds + micros);
+}
+
+/**
+ * Tracks the writes of a workload until they've been acknowledged and every listener has seen
+ * them committed. Writes are started on the benchmark thread, and acknowledged and observed on
+ * the results queue.
+ */
+class WorkloadTracker {
+ public:
+  explicit WorkloadTracker(int listener_count)
+      : listener_count_(listener_count), group_(dispatch_group_create()) {
+  }
+
+  /** Records that `doc_id` is about to be written. */
+  void StartWrite(const std::string& doc_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Pending& pending = pending_[doc_id];
+    pending.start = Clock::now();
+    pending.remaining_listeners = listener_count_;
+    // One for the acknowledgement, and one for the listeners.
+    dispatch_group_enter(group_);
+    if (listener_count_ > 0) dispatch_group_enter(group_);
+  }
+
+  void HandleAcknowledged(const std::string& doc_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = pending_.find(doc_id);
+    ack_latencies_.push_back(ToMillis(Clock::now() - found->second.start));
+    found->second.acknowledged = true;
+    if (found->second.remaining_listeners == 0) pending_.erase(found);
+    dispatch_group_leave(group_);
+  }
+
+  /** Records that the listener with the given index saw `doc_id` without pending writes. */
+  void HandleCommitted(int listener, const std::string& doc_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = pending_.find(doc_id);
+    if (found == pending_.end() || found->second.remaining_listeners == 0 ||
+        !found->second.seen_by.insert(listener).second) {
+      return;
+    }
+
+    if (--found->second.remaining_listeners == 0) {
+      snapshot_latencies_.push_back(ToMillis(Clock::now() - found->second.start));
+      if (found->second.acknowledged) pending_.erase(found);
+      dispatch_group_leave(group_);
+    }
+  }
+
+  /** Waits until all the writes started so far have been acknowledged and observed. */
+  void Wait() {
+    dispatch_group_wait(group_, DISPATCH_TIME_FOREVER);
+  }
+
+  void Report(benchmark::State& state) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::sort(ack_latencies_.begin(), ack_latencies_.end());
+    std::sort(snapshot_latencies_.begin(), snapshot_latencies_.end());
+    state.counters["ack_p50_ms"] = Percentile(ack_latencies_, 0.5);
+    state.counters["ack_p99_ms"] = Percentile(ack_latencies_, 0.99);
+    state.counters["snapshot_p50_ms"] = Percentile(snapshot_latencies_, 0.5);
+    state.counters["snapshot_p99_ms"] = Percentile(snapshot_latencies_, 0.99);
+  }
+
+ private:
+  struct Pending {
+    Clock::time_point start;
+    int remaining_listeners = 0;
+    bool acknowledged = false;
+    std::unordered_set<int> seen_by;
+  };
+
+  const int listener_count_;
+  dispatch_group_t group_;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Pending> pending_;
+  std::vector<double> ack_latencies_;
+  std::vector<double> snapshot_latencies_;
+};
+
+/**
+ * Writes documents into a collection that range(0) listeners are listening to, at range(1) writes
+ * per second (or as fast as possible if it's 0), each with a field of range(2) bytes. If range(3)
+ * is nonzero, the second half of each iteration's writes is made offline, and sent once the
+ * network is enabled again.
+ *
+ * Reports writes per second, the latency of the write acknowledgements, the latency until every
+ * listener has seen a write committed, the CPU the SDK used, and the peak memory.
+ */
+void BM_Workload(benchmark::State& state) {
+  auto listener_count = static_cast<int>(state.range(0));
+  int64_t writes_per_second = state.range(1);
+  auto document_size = static_cast<size_t>(state.range(2));
+  bool toggle_network = state.range(3) != 0;
+
+  FIRFirestore* db = OpenFirestore();
+  auto collection = [db collectionWithPath:MakeNSString("docs-" + CreateAutoId())];
+  NSDictionary<NSString*, id>* data = @{@"payload" : MakeNSString(std::string(document_size, 'a'))};
+
+  WorkloadTracker tracker(listener_count);
+  WorkloadTracker* tracker_ptr = &tracker;
+  NSMutableArray<id<FIRListenerRegistration>>* registrations = [NSMutableArray array];
+  dispatch_group_t listening = dispatch_group_create();
+  for (int i = 0; i < listener_count; ++i) {
+    __block bool first = true;
+    dispatch_group_enter(listening);
+    auto listener = ^(FIRQuerySnapshot* snapshot, NSError* error) {
+      HARD_ASSERT(error == nil, "Listen failed: %s", MakeString([error description]));
+      for (FIRDocumentChange* change in snapshot.documentChanges) {
+        if (!change.document.metadata.hasPendingWrites) {
+          tracker_ptr->HandleCommitted(i, MakeString(change.document.documentID));
+        }
+      }
+      if (first) {
+        first = false;
+        dispatch_group_leave(listening);
+      }
+    };
+    [registrations addObject:[collection addSnapshotListenerWithIncludeMetadataChanges:YES
+                                                                              listener:listener]];
+  }
+  dispatch_group_wait(listening, DISPATCH_TIME_FOREVER);
+
+  Clock::duration interval = Clock::duration::zero();
+  if (writes_per_second > 0) {
+    interval = std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) /
+               writes_per_second;
+  }
+  int64_t writes = 0;
+  Clock::time_point wall_start = Clock::now();
+  Clock::duration cpu_start = CpuTime();
+  for (auto _ : state) {
+    Clock::time_point next_write = Clock::now();
+    for (int i = 0; i < kWritesPerIteration; ++i) {
+      if (toggle_network && i == kWritesPerIteration / 2) {
+        SetNetworkEnabled(db, false);
+      }
+
+      std::this_thread::sleep_until(next_write);
+      next_write += interval;
+
+      std::string doc_id = CreateAutoId();
+      tracker.StartWrite(doc_id);
+      [[collection documentWithPath:MakeNSString(doc_id)]
+                setData:data
+             completion:^(NSError* error) {
+               HARD_ASSERT(error == nil, "Write failed: %s", MakeString([error description]));
+               tracker_ptr->HandleAcknowledged(doc_id);
+             }];
+    }
+
+    if (toggle_network) {
+      SetNetworkEnabled(db, true);
+    }
+    tracker.Wait();
+    writes += kWritesPerIteration;
+  }
+  Clock::duration wall_time = Clock::now() - wall_start;
+  Clock::duration cpu_time = CpuTime() - cpu_start;
+
+  for (id<FIRListenerRegistration> registration in registrations) {
+    [registration remove];
+  }
+  Shutdown(db);
+
+  state.SetItemsProcessed(writes);
+  tracker.Report(state);
+  state.counters["cpu_percent"] = 100 * ToMillis(cpu_time) / ToMillis(wall_time);
+
+  // Apple platforms report the peak resident set size in bytes.
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  state.counters["peak_rss_mb"] = static_cast<double>(usage.ru_maxrss) / (1024 * 1024);
+}
+
+// Arguments: listeners, writes per second (0 for unthrottled), document size, toggle network.
+BENCHMARK(BM_Workload)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->Args({1, 0, 1024, 0})
+    ->Args({10, 0, 1024, 0})
+    ->Args({100, 0, 1024, 0})
+    ->Args({10, 50, 1024, 0})
+    ->Args({10, 0, 100 * 1024, 0})
+    ->Args({10, 0, 1024, 1});
+
+}  // namespace
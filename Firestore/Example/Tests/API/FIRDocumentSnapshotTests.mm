@@ -54,6 +54,20 @@ NS_ASSUME_NONNULL_BEGIN
   XCTAssertNotEqual([base hash], [fromCache hash]);
 }
 
+- (void)testDataConvertsNestedFields {
+  NSDictionary<NSString *, id> *data =
+      @{@"a" : @1, @"b" : @{@"c" : @"string", @"d" : @[ @YES, @{@"e" : [NSNull null]} ]}};
+  FIRDocumentSnapshot *snapshot = FSTTestDocSnapshot("rooms/foo", 1, data, NO, NO);
+  NSDictionary<NSString *, id> *result = [snapshot data];
+  XCTAssertEqual(result.count, 2);
+  XCTAssertEqualObjects(result[@"b"][@"c"], @"string");
+  XCTAssertNil(result[@"missing"]);
+  XCTAssertEqualObjects(result, data);
+  XCTAssertEqualObjects([result.allKeys sortedArrayUsingSelector:@selector(compare:)],
+                        (@[ @"a", @"b" ]));
+  XCTAssertEqualObjects([result mutableCopy], data);
+}
+
 @end
 
 NS_ASSUME_NONNULL_END
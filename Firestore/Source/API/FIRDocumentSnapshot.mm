@@ -27,6 +27,7 @@
 #import "Firestore/Source/API/FIRGeoPoint+Internal.h"
 #import "Firestore/Source/API/FIRSnapshotMetadata+Internal.h"
 #import "Firestore/Source/API/FIRTimestamp+Internal.h"
+#import "Firestore/Source/API/FSTLazyDictionary.h"
 #import "Firestore/Source/API/converters.h"
 
 #include "Firestore/core/src/api/document_reference.h"
@@ -286,14 +287,13 @@ ServerTimestampBehavior InternalServerTimestampBehavior(FIRServerTimestampBehavi
 
 - (NSDictionary<NSString *, id> *)convertedObject:(const FieldValue::Map &)objectValue
                                           options:(const FieldValueOptions &)options {
-  NSMutableDictionary *result = [NSMutableDictionary dictionary];
-  for (const auto &kv : objectValue) {
-    const std::string &key = kv.first;
-    const FieldValue &value = kv.second;
-
-    result[util::MakeNSString(key)] = [self convertedValue:value options:options];
-  }
-  return result;
+  // Fields are only converted once they're read, so wide documents that are only partly read
+  // don't pay for converting every field.
+  FieldValueOptions capturedOptions = options;
+  return [[FSTLazyDictionary alloc] initWithMap:objectValue
+                                      converter:^id(const FieldValue &value) {
+                                        return [self convertedValue:value options:capturedOptions];
+                                      }];
 }
 
 @end
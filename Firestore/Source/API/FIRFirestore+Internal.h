@@ -76,6 +76,16 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (const std::shared_ptr<util::AsyncQueue> &)workerQueue;
 
+/**
+ * Loads the bundle downloaded with the given request, parsing it while it downloads so that it's
+ * never held in memory in full.
+ */
+- (FIRLoadBundleTask *)
+    loadBundleFromRequest:(NSURLRequest *)request
+            configuration:(NSURLSessionConfiguration *)configuration
+               completion:(nullable void (^)(FIRLoadBundleTaskProgress *_Nullable progress,
+                                             NSError *_Nullable error))completion;
+
 @property(nonatomic, assign, readonly) std::shared_ptr<api::Firestore> wrapped;
 
 @property(nonatomic, assign, readonly) const model::DatabaseId &databaseID;
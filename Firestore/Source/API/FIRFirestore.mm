@@ -20,6 +20,10 @@
 #include <string>
 #include <utility>
 
+#if TARGET_OS_IOS || TARGET_OS_TV
+#import <UIKit/UIKit.h>
+#endif
+
 #import "FIRFirestoreSettings+Internal.h"
 
 #import "FirebaseCore/Sources/Private/FirebaseCoreInternal.h"
@@ -31,6 +35,7 @@
 #import "Firestore/Source/API/FIRTransaction+Internal.h"
 #import "Firestore/Source/API/FIRWriteBatch+Internal.h"
 #import "Firestore/Source/API/FSTFirestoreComponent.h"
+#import "Firestore/Source/API/FSTURLSessionByteStream.h"
 #import "Firestore/Source/API/FSTUserDataConverter.h"
 
 #include "Firestore/core/src/api/collection_reference.h"
@@ -53,6 +58,7 @@
 #include "Firestore/core/src/util/executor_libdispatch.h"
 #include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/log.h"
+#include "Firestore/core/src/util/memory_pressure.h"
 #include "Firestore/core/src/util/status.h"
 #include "Firestore/core/src/util/statusor.h"
 #include "Firestore/core/src/util/string_apple.h"
@@ -91,12 +97,21 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property(nonatomic, strong, readonly) FSTUserDataConverter *dataConverter;
 
+/** Loads the bundle read from `stream`. */
+- (FIRLoadBundleTask *)
+    loadBundleByteStream:(std::unique_ptr<util::ByteStream>)stream
+              completion:(nullable void (^)(FIRLoadBundleTaskProgress *_Nullable progress,
+                                            NSError *_Nullable error))completion;
+
 @end
 
 @implementation FIRFirestore {
   std::shared_ptr<Firestore> _firestore;
   FIRFirestoreSettings *_settings;
   __weak id<FSTFirestoreInstanceRegistry> _registry;
+#if TARGET_OS_IOS || TARGET_OS_TV
+  id<NSObject> _memoryWarningObserver;
+#endif
 }
 
 + (void)initialize {
@@ -166,10 +181,32 @@ NS_ASSUME_NONNULL_BEGIN
                                                          preConverter:block];
     // Use the property setter so the default settings get plumbed into _firestoreClient.
     self.settings = [[FIRFirestoreSettings alloc] init];
+
+#if TARGET_OS_IOS || TARGET_OS_TV
+    // The observer must not keep the instance alive, and a warning received after the instance
+    // is gone has nothing to release.
+    std::weak_ptr<Firestore> weakFirestore = _firestore;
+    _memoryWarningObserver = [[NSNotificationCenter defaultCenter]
+        addObserverForName:UIApplicationDidReceiveMemoryWarningNotification
+                    object:nil
+                     queue:[NSOperationQueue mainQueue]
+                usingBlock:^(NSNotification *note) {
+                  std::shared_ptr<Firestore> firestore = weakFirestore.lock();
+                  if (firestore) {
+                    firestore->HandleMemoryPressure(util::MemoryPressure::Critical);
+                  }
+                }];
+#endif
   }
   return self;
 }
 
+- (void)dealloc {
+#if TARGET_OS_IOS || TARGET_OS_TV
+  [[NSNotificationCenter defaultCenter] removeObserver:_memoryWarningObserver];
+#endif
+}
+
 - (FIRFirestoreSettings *)settings {
   // Disallow mutation of our internal settings
   return [_settings copy];
@@ -406,7 +443,24 @@ NS_ASSUME_NONNULL_BEGIN
                              completion:
                                  (nullable void (^)(FIRLoadBundleTaskProgress *_Nullable progress,
                                                     NSError *_Nullable error))completion {
-  auto stream = absl::make_unique<ByteStreamApple>(bundleStream);
+  return [self loadBundleByteStream:absl::make_unique<ByteStreamApple>(bundleStream)
+                         completion:completion];
+}
+
+- (FIRLoadBundleTask *)
+    loadBundleFromRequest:(NSURLRequest *)request
+            configuration:(NSURLSessionConfiguration *)configuration
+               completion:(nullable void (^)(FIRLoadBundleTaskProgress *_Nullable progress,
+                                             NSError *_Nullable error))completion {
+  return [self loadBundleByteStream:[FSTURLSessionByteStream streamWithRequest:request
+                                                                 configuration:configuration]
+                         completion:completion];
+}
+
+- (FIRLoadBundleTask *)
+    loadBundleByteStream:(std::unique_ptr<util::ByteStream>)stream
+              completion:(nullable void (^)(FIRLoadBundleTaskProgress *_Nullable progress,
+                                            NSError *_Nullable error))completion {
   std::shared_ptr<api::LoadBundleTask> task = _firestore->LoadBundle(std::move(stream));
   auto callback = [completion](api::LoadBundleTaskProgress progress) {
     if (!completion) {
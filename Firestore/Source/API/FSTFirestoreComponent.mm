@@ -97,7 +97,9 @@ NS_ASSUME_NONNULL_BEGIN
         absl::StrAppend(&queue_name, ".", util::MakeString(self.app.name));
       }
 
-      auto executor = Executor::CreateSerial(queue_name.c_str());
+      // Write acknowledgements and snapshots are raised from the worker queue.
+      auto executor =
+          Executor::CreateSerial(queue_name.c_str(), Executor::Priority::UserInitiated);
       auto workerQueue = AsyncQueue::Create(std::move(executor));
 
       id<FIRAuthInterop> auth = FIR_COMPONENT(FIRAuthInterop, self.app.container);
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#include "Firestore/core/src/model/field_value.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Converts a field value into the Objective-C object handed to the user. */
+typedef id _Nonnull (^FSTFieldValueConverter)(const firebase::firestore::model::FieldValue &value);
+
+/**
+ * An immutable NSDictionary backed by the fields of a `FieldValue::Map`. Each field is only
+ * converted into its Objective-C object the first time it's read, then cached, so snapshot data
+ * that is only partly read is never converted in full.
+ */
+@interface FSTLazyDictionary : NSDictionary<NSString *, id>
+
+- (instancetype)initWithMap:(const firebase::firestore::model::FieldValue::Map &)map
+                  converter:(FSTFieldValueConverter)converter;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "Firestore/Source/API/FSTLazyDictionary.h"
+
+#include <string>
+
+#include "Firestore/core/src/util/string_apple.h"
+
+namespace util = firebase::firestore::util;
+using firebase::firestore::model::FieldValue;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@implementation FSTLazyDictionary {
+  FieldValue::Map _map;
+  FSTFieldValueConverter _converter;
+
+  // The values converted so far and the keys, once enumerated. Guarded by @synchronized(self)
+  // since an immutable NSDictionary can be read from any thread.
+  NSMutableDictionary<NSString *, id> *_convertedValues;
+  NSArray<NSString *> *_Nullable _keys;
+}
+
+- (instancetype)initWithMap:(const FieldValue::Map &)map
+                  converter:(FSTFieldValueConverter)converter {
+  if (self = [super init]) {
+    _map = map;
+    _converter = converter;
+    _convertedValues = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+- (NSUInteger)count {
+  return _map.size();
+}
+
+- (nullable id)objectForKey:(id)key {
+  if (![key isKindOfClass:[NSString class]]) return nil;
+
+  @synchronized(self) {
+    id converted = _convertedValues[key];
+    if (converted) return converted;
+
+    auto found = _map.find(util::MakeString(key));
+    if (found == _map.end()) return nil;
+
+    converted = _converter(found->second);
+    _convertedValues[key] = converted;
+    return converted;
+  }
+}
+
+- (NSEnumerator *)keyEnumerator {
+  @synchronized(self) {
+    if (!_keys) {
+      NSMutableArray<NSString *> *keys = [NSMutableArray arrayWithCapacity:_map.size()];
+      for (const auto &kv : _map) {
+        [keys addObject:util::MakeNSString(kv.first)];
+      }
+      _keys = keys;
+    }
+    return [_keys objectEnumerator];
+  }
+}
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+  return self;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#include <memory>
+
+#include "Firestore/core/src/util/byte_stream.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Downloads the body of a URL request with an NSURLSession data task into a `ByteStream` that
+ * can be read while the download is in progress, so that a bundle is parsed as it arrives rather
+ * than after it's been held in memory in full. The data task is suspended while the stream's
+ * buffer is full, and cancelled if the stream is destroyed before the download is done.
+ */
+@interface FSTURLSessionByteStream : NSObject <NSURLSessionDataDelegate>
+
+/**
+ * Starts downloading `request` in a session with the given configuration, and returns the stream
+ * that the response body is written to. A failed request or a response with an HTTP status other
+ * than 2xx fails the stream.
+ */
++ (std::unique_ptr<firebase::firestore::util::ByteStream>)
+    streamWithRequest:(NSURLRequest *)request
+        configuration:(NSURLSessionConfiguration *)configuration;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
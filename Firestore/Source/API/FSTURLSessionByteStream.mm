@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "Firestore/Source/API/FSTURLSessionByteStream.h"
+
+#include <utility>
+
+#include "Firestore/core/src/util/byte_stream_pipe.h"
+#include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/string_format.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+
+using firebase::firestore::Error;
+using firebase::firestore::util::ByteStream;
+using firebase::firestore::util::ByteStreamPipe;
+using firebase::firestore::util::Status;
+using firebase::firestore::util::StringFormat;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface FSTURLSessionByteStream ()
+
+- (instancetype)initWithWriter:(std::shared_ptr<ByteStreamPipe::Writer>)writer
+    NS_DESIGNATED_INITIALIZER;
+
+@end
+
+@implementation FSTURLSessionByteStream {
+  std::shared_ptr<ByteStreamPipe::Writer> _writer;
+}
+
++ (std::unique_ptr<ByteStream>)streamWithRequest:(NSURLRequest *)request
+                                   configuration:(NSURLSessionConfiguration *)configuration {
+  auto stream = absl::make_unique<ByteStreamPipe>();
+  FSTURLSessionByteStream *delegate =
+      [[FSTURLSessionByteStream alloc] initWithWriter:stream->writer()];
+
+  // The session keeps its delegate alive until it's invalidated once the task completes.
+  NSURLSession *session = [NSURLSession sessionWithConfiguration:configuration
+                                                        delegate:delegate
+                                                   delegateQueue:nil];
+  NSURLSessionDataTask *task = [session dataTaskWithRequest:request];
+
+  // Suspending and resuming a task doesn't call back into the stream, so it's safe to do while the
+  // stream is locked, which keeps the task's state in step with the stream's buffer.
+  __weak NSURLSessionDataTask *weakTask = task;
+  stream->writer()->SetPauseCallback([weakTask](bool paused) {
+    if (paused) {
+      [weakTask suspend];
+    } else {
+      [weakTask resume];
+    }
+  });
+
+  [task resume];
+  return std::move(stream);
+}
+
+- (instancetype)initWithWriter:(std::shared_ptr<ByteStreamPipe::Writer>)writer {
+  if (self = [super init]) {
+    _writer = std::move(writer);
+  }
+  return self;
+}
+
+- (void)URLSession:(NSURLSession *)session
+              dataTask:(NSURLSessionDataTask *)dataTask
+    didReceiveResponse:(NSURLResponse *)response
+     completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler {
+  if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+    NSInteger statusCode = ((NSHTTPURLResponse *)response).statusCode;
+    if (statusCode < 200 || statusCode >= 300) {
+      _writer->Finish(Status(Error::kErrorUnavailable,
+                             StringFormat("Downloading the bundle failed with HTTP status %s",
+                                          statusCode)));
+      completionHandler(NSURLSessionResponseCancel);
+      return;
+    }
+  }
+  completionHandler(NSURLSessionResponseAllow);
+}
+
+- (void)URLSession:(NSURLSession *)session
+          dataTask:(NSURLSessionDataTask *)dataTask
+    didReceiveData:(NSData *)data {
+  // `data` may consist of several noncontiguous chunks, which are written without being copied
+  // into one.
+  __block bool wanted = true;
+  std::shared_ptr<ByteStreamPipe::Writer> writer = _writer;
+  [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+    wanted = writer->Write(absl::string_view(static_cast<const char *>(bytes), byteRange.length));
+    *stop = !wanted;
+  }];
+
+  // The stream was destroyed, so the rest of the bundle isn't needed.
+  if (!wanted) {
+    [dataTask cancel];
+  }
+}
+
+- (void)URLSession:(NSURLSession *)session
+                    task:(NSURLSessionTask *)task
+    didCompleteWithError:(nullable NSError *)error {
+  _writer->Finish(error ? Status::FromNSError(error) : Status::OK());
+  [session finishTasksAndInvalidate];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -265,9 +265,7 @@ NS_ASSUME_NONNULL_BEGIN
   } else {
     // If context path is unset we are already inside an array and we don't support field mask paths
     // more granular than the top-level array.
-    if (context.path()) {
-      context.AddToFieldMask(*context.path());
-    }
+    context.AddPathToFieldMask();
 
     if ([input isKindOfClass:[NSArray class]]) {
       // TODO(b/34871131): Include the path containing the array in the error message.
@@ -289,22 +287,24 @@ NS_ASSUME_NONNULL_BEGIN
   if (dict.count == 0) {
     const FieldPath *path = context.path();
     if (path && !path->empty()) {
-      context.AddToFieldMask(*path);
+      context.AddPathToFieldMask();
     }
     return ObjectValue::Empty().AsFieldValue();
   } else {
-    __block ObjectValue result = ObjectValue::Empty();
+    // Collect the fields and build the map once instead of copying the object for every field.
+    __block FieldValue::Map::Builder result;
+    result.reserve(dict.count);
 
     [dict enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *) {
-      absl::optional<FieldValue> parsedValue =
-          [self parseData:value context:context.ChildContext(util::MakeString(key))];
+      std::string fieldName = util::MakeString(key);
+      absl::optional<FieldValue> parsedValue = [self parseData:value
+                                                       context:context.ChildContext(fieldName)];
       if (parsedValue) {
-        FieldPath path = FieldPath{util::MakeString(key)};
-        result = result.Set(path, *parsedValue);
+        result.insert(std::move(fieldName), *std::move(parsedValue));
       }
     }];
 
-    return result;
+    return ObjectValue::FromMap(result.Build()).AsFieldValue();
   }
 }
 
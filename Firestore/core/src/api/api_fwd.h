@@ -17,8 +17,10 @@
 #ifndef FIRESTORE_CORE_SRC_API_API_FWD_H_
 #define FIRESTORE_CORE_SRC_API_API_FWD_H_
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "absl/types/optional.h"
 
@@ -33,6 +35,7 @@ class Query;
 
 namespace api {
 
+class BulkWriter;
 class CollectionReference;
 class DocumentChange;
 class DocumentReference;
@@ -45,14 +48,21 @@ class Settings;
 class SnapshotMetadata;
 class WriteBatch;
 
+struct BulkWriterOptions;
+
 enum class Source;
 
 using DocumentSnapshotListener =
     std::unique_ptr<core::EventListener<DocumentSnapshot>>;
 
+using DocumentSnapshotsListener =
+    std::unique_ptr<core::EventListener<std::vector<DocumentSnapshot>>>;
+
 using QuerySnapshotListener =
     std::unique_ptr<core::EventListener<QuerySnapshot>>;
 
+using CountListener = std::unique_ptr<core::EventListener<int64_t>>;
+
 using QueryCallback = std::function<void(absl::optional<core::Query>)>;
 
 }  // namespace api
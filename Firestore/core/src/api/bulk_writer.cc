@@ -0,0 +1,362 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/api/bulk_writer.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstddef>
+
+#include "Firestore/core/src/api/document_reference.h"
+#include "Firestore/core/src/api/firestore.h"
+#include "Firestore/core/src/core/firestore_client.h"
+#include "Firestore/core/src/core/user_data.h"
+#include "Firestore/core/src/model/delete_mutation.h"
+#include "Firestore/core/src/remote/datastore.h"
+#include "Firestore/core/src/util/async_queue.h"
+#include "Firestore/core/src/util/exception.h"
+#include "Firestore/core/src/util/status.h"
+
+namespace firebase {
+namespace firestore {
+namespace api {
+
+using model::DeleteMutation;
+using model::Mutation;
+using model::Precondition;
+using remote::Datastore;
+using remote::RateLimiter;
+using util::Executor;
+using util::Status;
+using util::StatusCallback;
+using util::ThrowIllegalState;
+using util::ThrowInvalidArgument;
+using util::TimerId;
+
+namespace {
+
+/** The most writes the backend accepts in a single commit. */
+const int kMaxWritesPerCommit = 500;
+
+/** How much the rate limit grows every `kRateLimitPeriod`. */
+const double kRateLimitMultiplier = 1.5;
+const std::chrono::minutes kRateLimitPeriod{5};
+
+const Executor::Milliseconds kBackoffInitialDelay{1000};
+const Executor::Milliseconds kBackoffMaxDelay{60 * 1000};
+
+const Executor::Tag kTimerTag = static_cast<Executor::Tag>(TimerId::BulkWriter);
+
+}  // namespace
+
+struct BulkWriter::Write {
+  Write(int64_t id, Mutation mutation, StatusCallback callback)
+      : id{id}, mutation{std::move(mutation)}, callback{std::move(callback)} {
+  }
+
+  int64_t id = 0;
+  Mutation mutation;
+  StatusCallback callback;
+  int attempts = 0;
+  /**
+   * Whether the write must be committed in a request of its own, because the
+   * request it was in failed and it's not known which of its writes caused
+   * that.
+   */
+  bool solo = false;
+};
+
+BulkWriter::BulkWriter(std::shared_ptr<Firestore> firestore,
+                       BulkWriterOptions options)
+    : firestore_{std::move(firestore)},
+      options_{options},
+      rate_limiter_{
+          static_cast<double>(std::max(options.initial_ops_per_second, 1)),
+          kRateLimitMultiplier, kRateLimitPeriod,
+          static_cast<double>(options.max_ops_per_second),
+          RateLimiter::Clock::now()} {
+}
+
+void BulkWriter::SetData(const DocumentReference& reference,
+                         core::ParsedSetData&& set_data,
+                         StatusCallback callback) {
+  AddWrite(reference,
+           std::move(set_data).ToMutation(reference.key(),
+                                          Precondition::None()),
+           std::move(callback));
+}
+
+void BulkWriter::UpdateData(const DocumentReference& reference,
+                            core::ParsedUpdateData&& update_data,
+                            StatusCallback callback) {
+  AddWrite(reference,
+           std::move(update_data)
+               .ToMutation(reference.key(), Precondition::Exists(true)),
+           std::move(callback));
+}
+
+void BulkWriter::DeleteData(const DocumentReference& reference,
+                            StatusCallback callback) {
+  AddWrite(reference, DeleteMutation(reference.key(), Precondition::None()),
+           std::move(callback));
+}
+
+void BulkWriter::Flush(StatusCallback callback) {
+  VerifyNotClosed();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushes_.emplace_back(next_write_id_, std::move(callback));
+    NotifyFlushes();
+    SendReadyWrites();
+  }
+  CallCompletedCallbacks();
+}
+
+void BulkWriter::Close(StatusCallback callback) {
+  Flush(std::move(callback));
+  closed_ = true;
+}
+
+void BulkWriter::AddWrite(const DocumentReference& reference,
+                          Mutation mutation,
+                          StatusCallback callback) {
+  VerifyNotClosed();
+  ValidateReference(reference);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto write = std::make_shared<Write>(next_write_id_++, std::move(mutation),
+                                         std::move(callback));
+    unfinished_.insert(write->id);
+
+    auto waiting = waiting_.find(reference.key());
+    if (waiting != waiting_.end()) {
+      waiting->second.push_back(std::move(write));
+    } else {
+      waiting_.emplace(reference.key(), std::deque<WritePtr>{});
+      ready_.push_back(std::move(write));
+      SendReadyWrites();
+    }
+  }
+  CallCompletedCallbacks();
+}
+
+void BulkWriter::SendReadyWrites() {
+  while (!ready_.empty() &&
+         commits_in_flight_ < std::max(options_.max_concurrent_commits, 1)) {
+    RateLimiter::Clock::time_point now = RateLimiter::Clock::now();
+    size_t capacity = static_cast<size_t>(std::max(
+        std::min(kMaxWritesPerCommit, rate_limiter_.GetMaximumCapacity(now)),
+        1));
+
+    size_t count = 1;
+    if (!ready_.front()->solo) {
+      while (count < ready_.size() && count < capacity &&
+             !ready_[count]->solo) {
+        ++count;
+      }
+    }
+
+    // While other requests are in flight, writes accumulate until they fill a
+    // request, unless they're being flushed.
+    bool full = count == capacity || count < ready_.size();
+    if (!full && commits_in_flight_ > 0 && flushes_.empty()) {
+      return;
+    }
+
+    int operations = static_cast<int>(count);
+    if (!rate_limiter_.TryMakeRequest(operations, now)) {
+      ScheduleSend(rate_limiter_.GetNextRequestDelay(operations, now));
+      return;
+    }
+
+    auto end = ready_.begin() + static_cast<std::ptrdiff_t>(count);
+    std::vector<WritePtr> writes(ready_.begin(), end);
+    ready_.erase(ready_.begin(), end);
+    Commit(std::move(writes));
+  }
+}
+
+void BulkWriter::Commit(std::vector<WritePtr> writes) {
+  std::vector<Mutation> mutations;
+  mutations.reserve(writes.size());
+  for (const WritePtr& write : writes) {
+    mutations.push_back(write->mutation);
+    ++write->attempts;
+  }
+
+  ++commits_in_flight_;
+  auto shared_this = shared_from_this();
+  auto on_commit = [shared_this, writes](Status status) {
+    {
+      std::lock_guard<std::mutex> lock(shared_this->mutex_);
+      --shared_this->commits_in_flight_;
+      shared_this->HandleCommitResult(writes, status);
+      shared_this->SendReadyWrites();
+    }
+    shared_this->CallCompletedCallbacks();
+  };
+
+  if (options_.durable) {
+    firestore_->client()->WriteMutations(std::move(mutations),
+                                         std::move(on_commit));
+  } else {
+    firestore_->client()->CommitMutations(std::move(mutations),
+                                          std::move(on_commit));
+  }
+}
+
+void BulkWriter::HandleCommitResult(const std::vector<WritePtr>& writes,
+                                    const Status& status) {
+  if (status.ok()) {
+    for (const WritePtr& write : writes) {
+      Finish(write, status);
+    }
+    return;
+  }
+
+  // Rejected writes aren't retried by the write stream, while direct commits
+  // can fail for transient reasons too.
+  bool permanent =
+      options_.durable || Datastore::IsPermanentWriteError(status);
+  if (permanent && writes.size() > 1) {
+    // One bad write fails the whole request; commit them one by one to find
+    // out which.
+    for (auto it = writes.rbegin(); it != writes.rend(); ++it) {
+      (*it)->solo = true;
+      --(*it)->attempts;
+      ready_.push_front(*it);
+    }
+    return;
+  }
+
+  for (const WritePtr& write : writes) {
+    if (!permanent && write->attempts < options_.max_attempts) {
+      RetryLater(write, status);
+    } else {
+      Finish(write, status);
+    }
+  }
+}
+
+void BulkWriter::RetryLater(WritePtr write, const Status& status) {
+  Executor::Milliseconds base = kBackoffMaxDelay;
+  if (status.code() != Error::kErrorResourceExhausted &&
+      write->attempts <= 16) {
+    base = std::min(kBackoffInitialDelay * (1 << (write->attempts - 1)),
+                    kBackoffMaxDelay);
+  }
+  // Full jitter keeps the retries of a failed request from arriving together.
+  Executor::Milliseconds delay{static_cast<Executor::Milliseconds::rep>(
+      secure_random_.Uniform(static_cast<uint32_t>(base.count()) + 1))};
+
+  auto shared_this = shared_from_this();
+  firestore_->client()->user_executor()->Schedule(
+      delay, kTimerTag, [shared_this, write] {
+        {
+          std::lock_guard<std::mutex> lock(shared_this->mutex_);
+          shared_this->ready_.push_back(write);
+          shared_this->SendReadyWrites();
+        }
+        shared_this->CallCompletedCallbacks();
+      });
+}
+
+void BulkWriter::Finish(const WritePtr& write, const Status& status) {
+  if (write->callback) {
+    completed_.emplace_back(write->callback, status);
+  }
+  unfinished_.erase(write->id);
+
+  auto waiting = waiting_.find(write->mutation.key());
+  if (waiting->second.empty()) {
+    waiting_.erase(waiting);
+  } else {
+    ready_.push_back(std::move(waiting->second.front()));
+    waiting->second.pop_front();
+  }
+
+  NotifyFlushes();
+}
+
+void BulkWriter::NotifyFlushes() {
+  int64_t first_unfinished =
+      unfinished_.empty() ? next_write_id_ : *unfinished_.begin();
+  auto done = std::stable_partition(
+      flushes_.begin(), flushes_.end(),
+      [first_unfinished](const std::pair<int64_t, StatusCallback>& flush) {
+        return flush.first > first_unfinished;
+      });
+  for (auto it = done; it != flushes_.end(); ++it) {
+    if (it->second) {
+      completed_.emplace_back(std::move(it->second), Status::OK());
+    }
+  }
+  flushes_.erase(done, flushes_.end());
+}
+
+void BulkWriter::ScheduleSend(Executor::Milliseconds delay) {
+  if (send_scheduled_) {
+    return;
+  }
+
+  send_scheduled_ = true;
+  auto shared_this = shared_from_this();
+  send_timer_ = firestore_->client()->user_executor()->Schedule(
+      delay, kTimerTag, [shared_this] {
+        {
+          std::lock_guard<std::mutex> lock(shared_this->mutex_);
+          shared_this->send_scheduled_ = false;
+          shared_this->SendReadyWrites();
+        }
+        shared_this->CallCompletedCallbacks();
+      });
+}
+
+void BulkWriter::CallCompletedCallbacks() {
+  std::vector<std::pair<StatusCallback, Status>> completed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed.swap(completed_);
+  }
+
+  const std::shared_ptr<Executor>& user_executor =
+      firestore_->client()->user_executor();
+  for (auto& entry : completed) {
+    StatusCallback callback = std::move(entry.first);
+    Status status = std::move(entry.second);
+    user_executor->Execute([callback, status] { callback(status); });
+  }
+}
+
+void BulkWriter::VerifyNotClosed() const {
+  if (closed_) {
+    ThrowIllegalState(
+        "A bulk writer can no longer be used after close has been called.");
+  }
+}
+
+void BulkWriter::ValidateReference(const DocumentReference& reference) const {
+  if (reference.firestore() != firestore_) {
+    ThrowInvalidArgument(
+        "Provided document reference is from a different "
+        "Firestore instance.");
+  }
+}
+
+}  // namespace api
+}  // namespace firestore
+}  // namespace firebase
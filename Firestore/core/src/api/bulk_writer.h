@@ -0,0 +1,162 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_API_BULK_WRITER_H_
+#define FIRESTORE_CORE_SRC_API_BULK_WRITER_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/api/api_fwd.h"
+#include "Firestore/core/src/core/core_fwd.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/mutation.h"
+#include "Firestore/core/src/remote/rate_limiter.h"
+#include "Firestore/core/src/util/executor.h"
+#include "Firestore/core/src/util/secure_random.h"
+#include "Firestore/core/src/util/status_fwd.h"
+
+namespace firebase {
+namespace firestore {
+namespace api {
+
+struct BulkWriterOptions {
+  /** How many requests may be in flight at once. */
+  int max_concurrent_commits = 10;
+  int initial_ops_per_second = 500;
+  int max_ops_per_second = 10000;
+  /** How many times a write is tried before its error is reported. */
+  int max_attempts = 10;
+  /** Whether writes go through the local mutation queue; see `BulkWriter`. */
+  bool durable = true;
+};
+
+/**
+ * Writes large numbers of documents without the atomicity of a `WriteBatch`:
+ * each write succeeds or fails on its own and has its own callback.
+ *
+ * Writes are committed in requests of up to 500 writes, several of which may
+ * be in flight at once. The number of writes sent per second starts at
+ * `initial_ops_per_second` and grows by 50% every five minutes, up to
+ * `max_ops_per_second`, so that the backend can scale up to the load. Writes
+ * that fail with a transient error are retried with backoff. Writes to a
+ * document that already has a write in progress wait for that write to finish,
+ * so that writes to each document are applied in order.
+ *
+ * By default writes go through the local mutation queue like any other write:
+ * they show up in the local cache right away and survive restarts, but they
+ * share the single write stream with all other writes. With `durable` off,
+ * each request is committed directly instead, bypassing the local store: the
+ * writes don't appear locally until listeners receive them from the backend,
+ * and writes that haven't been committed are lost when the app stops. This
+ * suits imports that can simply be restarted.
+ *
+ * Like `WriteBatch`, a `BulkWriter` must not be used from several threads at
+ * the same time. Callbacks are invoked on the user executor.
+ */
+class BulkWriter : public std::enable_shared_from_this<BulkWriter> {
+ public:
+  BulkWriter(std::shared_ptr<Firestore> firestore, BulkWriterOptions options);
+
+  void SetData(const DocumentReference& reference,
+               core::ParsedSetData&& set_data,
+               util::StatusCallback callback);
+  void UpdateData(const DocumentReference& reference,
+                  core::ParsedUpdateData&& update_data,
+                  util::StatusCallback callback);
+  void DeleteData(const DocumentReference& reference,
+                  util::StatusCallback callback);
+
+  /**
+   * Sends all writes added so far without waiting for more writes to fill up
+   * their requests, and calls `callback` once all of them have finished,
+   * whether they succeeded or not.
+   */
+  void Flush(util::StatusCallback callback);
+
+  /**
+   * Like `Flush`, but the writer can no longer be used afterwards.
+   */
+  void Close(util::StatusCallback callback);
+
+  const std::shared_ptr<Firestore>& firestore() const {
+    return firestore_;
+  }
+
+ private:
+  struct Write;
+  using WritePtr = std::shared_ptr<Write>;
+
+  void AddWrite(const DocumentReference& reference,
+                model::Mutation mutation,
+                util::StatusCallback callback);
+
+  // The methods below must be called with `mutex_` held.
+  void SendReadyWrites();
+  void Commit(std::vector<WritePtr> writes);
+  void HandleCommitResult(const std::vector<WritePtr>& writes,
+                          const util::Status& status);
+  void RetryLater(WritePtr write, const util::Status& status);
+  void Finish(const WritePtr& write, const util::Status& status);
+  void ScheduleSend(util::Executor::Milliseconds delay);
+  void NotifyFlushes();
+
+  void CallCompletedCallbacks();
+
+  void VerifyNotClosed() const;
+  void ValidateReference(const DocumentReference& reference) const;
+
+  std::shared_ptr<Firestore> firestore_;
+  const BulkWriterOptions options_;
+  bool closed_ = false;
+
+  std::mutex mutex_;
+  int64_t next_write_id_ = 0;
+  /** Writes that may be sent, in order. */
+  std::deque<WritePtr> ready_;
+  /**
+   * Writes waiting for an earlier write to the same document to finish, by
+   * document. Every document with a write that hasn't finished has an entry.
+   */
+  std::unordered_map<model::DocumentKey,
+                     std::deque<WritePtr>,
+                     model::DocumentKeyHash>
+      waiting_;
+  /** The IDs of the writes that haven't finished. */
+  std::set<int64_t> unfinished_;
+  int commits_in_flight_ = 0;
+  /** Callbacks of `Flush`, with the ID of the first write added after each. */
+  std::vector<std::pair<int64_t, util::StatusCallback>> flushes_;
+  /** User callbacks to call once `mutex_` is released. */
+  std::vector<std::pair<util::StatusCallback, util::Status>> completed_;
+
+  remote::RateLimiter rate_limiter_;
+  util::DelayedOperation send_timer_;
+  bool send_scheduled_ = false;
+  util::SecureRandom secure_random_;
+};
+
+}  // namespace api
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_API_BULK_WRITER_H_
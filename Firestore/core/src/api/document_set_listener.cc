@@ -0,0 +1,152 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/api/document_set_listener.h"
+
+#include <utility>
+
+#include "Firestore/core/src/api/document_reference.h"
+#include "Firestore/core/src/api/firestore.h"
+#include "Firestore/core/src/api/query_core.h"
+#include "Firestore/core/src/api/query_snapshot.h"
+#include "Firestore/core/src/core/event_listener.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/util/exception.h"
+#include "absl/memory/memory.h"
+
+namespace firebase {
+namespace firestore {
+namespace api {
+
+using core::EventListener;
+using core::ListenOptions;
+using model::DocumentKey;
+using util::StatusOr;
+using util::ThrowInvalidArgument;
+
+namespace {
+
+/**
+ * Forwards the snapshots of each successive listen to the listener shared by
+ * all of them.
+ */
+class ForwardingListener : public EventListener<QuerySnapshot> {
+ public:
+  explicit ForwardingListener(
+      std::shared_ptr<EventListener<QuerySnapshot>> listener)
+      : listener_(std::move(listener)) {
+  }
+
+  void OnEvent(StatusOr<QuerySnapshot> maybe_snapshot) override {
+    listener_->OnEvent(std::move(maybe_snapshot));
+  }
+
+ private:
+  std::shared_ptr<EventListener<QuerySnapshot>> listener_;
+};
+
+}  // namespace
+
+DocumentSetListener::DocumentSetListener(std::shared_ptr<Firestore> firestore,
+                                         ListenOptions options,
+                                         QuerySnapshotListener&& listener)
+    : firestore_(std::move(firestore)),
+      options_(std::move(options)),
+      user_listener_(std::move(listener)) {
+}
+
+void DocumentSetListener::AddDocuments(
+    const std::vector<DocumentReference>& documents) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (removed_) return;
+
+  // Validate all the documents before changing the set so that a rejected
+  // call leaves it as it was.
+  for (const DocumentReference& document : documents) {
+    if (document.firestore() != firestore_) {
+      ThrowInvalidArgument(
+          "Provided document reference is from a different Cloud Firestore "
+          "instance.");
+    }
+    const DocumentKey& first =
+        keys_.empty() ? documents.front().key() : *keys_.begin();
+    if (document.key().path().PopLast() != first.path().PopLast()) {
+      ThrowInvalidArgument(
+          "Invalid document reference. All the documents listened to together "
+          "must belong to the same collection, but %s is not in %s.",
+          document.key().ToString(),
+          first.path().PopLast().CanonicalString());
+    }
+  }
+
+  size_t size = keys_.size();
+  for (const DocumentReference& document : documents) {
+    keys_.insert(document.key());
+  }
+  if (keys_.size() != size) {
+    Relisten();
+  }
+}
+
+void DocumentSetListener::RemoveDocuments(
+    const std::vector<DocumentReference>& documents) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (removed_) return;
+
+  size_t size = keys_.size();
+  for (const DocumentReference& document : documents) {
+    keys_.erase(document.key());
+  }
+  if (keys_.size() != size) {
+    Relisten();
+  }
+}
+
+void DocumentSetListener::Remove() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (removed_) return;
+
+  removed_ = true;
+  if (registration_) {
+    registration_->Remove();
+    registration_.reset();
+  }
+  keys_.clear();
+  firestore_.reset();
+}
+
+void DocumentSetListener::Relisten() {
+  std::unique_ptr<ListenerRegistration> previous = std::move(registration_);
+
+  // Listen to the new set before removing the previous listen so that the
+  // documents both have in common stay in the cache and the first snapshot of
+  // the new listen can be raised from it.
+  if (!keys_.empty()) {
+    std::vector<DocumentKey> keys(keys_.begin(), keys_.end());
+    Query query(core::Query::ForDocuments(firestore_->database_id(), keys),
+                firestore_);
+    registration_ = query.AddSnapshotListener(
+        options_, absl::make_unique<ForwardingListener>(user_listener_));
+  }
+
+  if (previous) {
+    previous->Remove();
+  }
+}
+
+}  // namespace api
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_API_DOCUMENT_SET_LISTENER_H_
+#define FIRESTORE_CORE_SRC_API_DOCUMENT_SET_LISTENER_H_
+
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
+#include <vector>
+
+#include "Firestore/core/src/api/api_fwd.h"
+#include "Firestore/core/src/api/listener_registration.h"
+#include "Firestore/core/src/core/listen_options.h"
+#include "Firestore/core/src/model/document_key.h"
+
+namespace firebase {
+namespace firestore {
+namespace api {
+
+/**
+ * Listens to a set of documents of one collection as a single query, so that
+ * all of them share one QueryListener, one target in persistence and one
+ * DocumentsTarget on the watch stream, and delivers their changes as a single
+ * stream of QuerySnapshots.
+ *
+ * Adding or removing documents replaces the listen with one for the new set.
+ * While the set is empty nothing is listened to.
+ *
+ * This class is thread-safe.
+ */
+class DocumentSetListener : public ListenerRegistration {
+ public:
+  DocumentSetListener(std::shared_ptr<Firestore> firestore,
+                      core::ListenOptions options,
+                      QuerySnapshotListener&& listener);
+
+  /**
+   * Adds the given documents to the set. Throws an invalid argument exception
+   * if a document belongs to another Firestore instance or to a different
+   * collection than the documents already in the set.
+   */
+  void AddDocuments(const std::vector<DocumentReference>& documents);
+
+  /** Removes the given documents from the set, if present. */
+  void RemoveDocuments(const std::vector<DocumentReference>& documents);
+
+  /**
+   * Stops listening. After the initial call, subsequent calls and changes to
+   * the set have no effect.
+   */
+  void Remove() override;
+
+ private:
+  /** Replaces the current listen with one for `keys_`. */
+  void Relisten();
+
+  std::mutex mutex_;
+  std::shared_ptr<Firestore> firestore_;
+  core::ListenOptions options_;
+  std::shared_ptr<core::EventListener<QuerySnapshot>> user_listener_;
+
+  std::set<model::DocumentKey> keys_;
+  std::unique_ptr<ListenerRegistration> registration_;
+  bool removed_ = false;
+};
+
+}  // namespace api
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_API_DOCUMENT_SET_LISTENER_H_
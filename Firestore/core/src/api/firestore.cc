@@ -18,6 +18,7 @@
 
 #include <utility>
 
+#include "Firestore/core/src/api/bulk_writer.h"
 #include "Firestore/core/src/api/collection_reference.h"
 #include "Firestore/core/src/api/document_reference.h"
 #include "Firestore/core/src/api/listener_registration.h"
@@ -34,6 +35,7 @@
 #include "Firestore/core/src/remote/firebase_metadata_provider.h"
 #include "Firestore/core/src/remote/grpc_connection.h"
 #include "Firestore/core/src/util/async_queue.h"
+#include "Firestore/core/src/util/exception.h"
 #include "Firestore/core/src/util/executor.h"
 #include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/status.h"
@@ -57,6 +59,7 @@ using util::AsyncQueue;
 using util::Empty;
 using util::Executor;
 using util::Status;
+using util::ThrowInvalidArgument;
 
 Firestore::Firestore(
     model::DatabaseId database_id,
@@ -138,6 +141,28 @@ WriteBatch Firestore::GetBatch() {
   return WriteBatch(shared_from_this());
 }
 
+void Firestore::GetAll(std::vector<DocumentReference> documents,
+                       Source source,
+                       DocumentSnapshotsListener&& callback) {
+  EnsureClientConfigured();
+
+  for (const DocumentReference& document : documents) {
+    if (document.firestore().get() != this) {
+      ThrowInvalidArgument(
+          "Provided document reference is from a different Cloud Firestore "
+          "instance.");
+    }
+  }
+
+  client_->GetAllDocuments(std::move(documents), source, std::move(callback));
+}
+
+std::shared_ptr<BulkWriter> Firestore::GetBulkWriter(
+    const BulkWriterOptions& options) {
+  EnsureClientConfigured();
+  return std::make_shared<BulkWriter>(shared_from_this(), options);
+}
+
 core::Query Firestore::GetCollectionGroup(std::string collection_id) {
   EnsureClientConfigured();
 
@@ -154,6 +179,20 @@ void Firestore::RunTransaction(
                        std::move(result_callback));
 }
 
+void Firestore::RunTransaction(
+    std::vector<DocumentKey> prefetch_keys,
+    core::TransactionUpdateCallback update_callback,
+    core::TransactionResultCallback result_callback) {
+  auto prefetching_callback =
+      [prefetch_keys, update_callback](
+          std::shared_ptr<Transaction> transaction,
+          core::TransactionResultCallback callback) {
+        transaction->Prefetch(prefetch_keys);
+        update_callback(std::move(transaction), std::move(callback));
+      };
+  RunTransaction(std::move(prefetching_callback), std::move(result_callback));
+}
+
 void Firestore::Terminate(util::StatusCallback callback) {
   // The client must be initialized to ensure that all subsequent API usage
   // throws an exception.
@@ -198,6 +237,14 @@ void Firestore::DisableNetwork(util::StatusCallback callback) {
   client_->DisableNetwork(std::move(callback));
 }
 
+void Firestore::HandleMemoryPressure(util::MemoryPressure pressure,
+                                     core::MemoryReleaseCallback callback) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  // Starting the client would only use more memory.
+  if (!client_) return;
+  client_->HandleMemoryPressure(pressure, std::move(callback));
+}
+
 void Firestore::SetClientLanguage(std::string language_token) {
   GrpcConnection::SetClientLanguage(std::move(language_token));
 }
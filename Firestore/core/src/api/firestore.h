@@ -20,13 +20,16 @@
 #include <memory>
 #include <mutex>  // NOLINT(build/c++11)
 #include <string>
+#include <vector>
 
 #include "Firestore/core/src/api/api_fwd.h"
 #include "Firestore/core/src/api/load_bundle_task.h"
 #include "Firestore/core/src/api/settings.h"
 #include "Firestore/core/src/core/core_fwd.h"
 #include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/util/byte_stream.h"
+#include "Firestore/core/src/util/memory_pressure.h"
 #include "Firestore/core/src/util/status_fwd.h"
 
 namespace firebase {
@@ -89,11 +92,36 @@ class Firestore : public std::enable_shared_from_this<Firestore> {
   CollectionReference GetCollection(const std::string& collection_path);
   DocumentReference GetDocument(const std::string& document_path);
   WriteBatch GetBatch();
+
+  /**
+   * Reads the given documents, delivering their snapshots in the order the
+   * references are given, with one snapshot per reference.
+   *
+   * @param source indicates whether the documents should be read from the
+   *     cache only (`Source::Cache`), the server only (`Source::Server`), or
+   *     from the server, falling back to the cache when it isn't reachable
+   *     (`Source::Default`). Server reads fetch all the documents in batched
+   *     lookups instead of one request per document.
+   */
+  void GetAll(std::vector<DocumentReference> documents,
+              Source source,
+              DocumentSnapshotsListener&& callback);
+  std::shared_ptr<BulkWriter> GetBulkWriter(const BulkWriterOptions& options);
   core::Query GetCollectionGroup(std::string collection_id);
 
   void RunTransaction(core::TransactionUpdateCallback update_callback,
                       core::TransactionResultCallback result_callback);
 
+  /**
+   * Like `RunTransaction` above, but each attempt starts reading all of the
+   * given documents in a single batched lookup before the update callback is
+   * invoked, so the callback's reads of these documents don't each cost a
+   * round trip.
+   */
+  void RunTransaction(std::vector<model::DocumentKey> prefetch_keys,
+                      core::TransactionUpdateCallback update_callback,
+                      core::TransactionResultCallback result_callback);
+
   void Terminate(util::StatusCallback callback);
   void ClearPersistence(util::StatusCallback callback);
   void WaitForPendingWrites(util::StatusCallback callback);
@@ -103,6 +131,18 @@ class Firestore : public std::enable_shared_from_this<Firestore> {
   void EnableNetwork(util::StatusCallback callback);
   void DisableNetwork(util::StatusCallback callback);
 
+  /**
+   * Sheds memory that Firestore can rebuild on demand: caches of persisted
+   * data and, under critical pressure, the views kept for queries that are no
+   * longer listened to. Does nothing if the client hasn't started or has been
+   * terminated, so it's safe to call from a system memory warning handler.
+   *
+   * @param callback If not null, passed an estimate of the bytes released by
+   *     the caches.
+   */
+  void HandleMemoryPressure(util::MemoryPressure pressure,
+                            core::MemoryReleaseCallback callback = nullptr);
+
   std::shared_ptr<api::LoadBundleTask> LoadBundle(
       std::unique_ptr<util::ByteStream> bundle_data);
   void GetNamedQuery(const std::string& name, api::QueryCallback callback);
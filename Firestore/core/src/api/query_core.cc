@@ -16,7 +16,6 @@
 
 #include "Firestore/core/src/api/query_core.h"
 
-#include <future>  // NOLINT(build/c++11)
 #include <memory>
 #include <utility>
 #include <vector>
@@ -31,6 +30,7 @@
 #include "Firestore/core/src/core/firestore_client.h"
 #include "Firestore/core/src/core/listen_options.h"
 #include "Firestore/core/src/core/operator.h"
+#include "Firestore/core/src/model/field_mask.h"
 #include "Firestore/core/src/model/field_value.h"
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/util/exception.h"
@@ -53,10 +53,10 @@ using core::ListenOptions;
 using core::QueryListener;
 using core::ViewSnapshot;
 using model::DocumentKey;
+using model::FieldMask;
 using model::FieldPath;
 using model::FieldValue;
 using model::ResourcePath;
-using util::Status;
 using util::StatusOr;
 using util::ThrowInvalidArgument;
 
@@ -109,6 +109,27 @@ size_t Query::Hash() const {
   return util::Hash(firestore_.get(), query());
 }
 
+void Query::Count(Source source, CountListener&& callback) const {
+  firestore_->client()->RunCountQuery(query_, source, std::move(callback));
+}
+
+void Query::LoadPartitioned(int32_t partition_count,
+                            util::StatusCallback callback) const {
+  if (partition_count < 1) {
+    ThrowInvalidArgument(
+        "Invalid partition count. The count must be at least 1, but was %s.",
+        partition_count);
+  }
+  if (!query_.CanBePartitioned()) {
+    ThrowInvalidArgument(
+        "Invalid query. Only queries for a collection without a limit, "
+        "cursors, field selection, inequality filters or orders other than by "
+        "document ID can be partitioned.");
+  }
+  firestore_->client()->LoadPartitionedQuery(
+      query_, static_cast<size_t>(partition_count), std::move(callback));
+}
+
 void Query::GetDocuments(Source source, QuerySnapshotListener&& callback) {
   ValidateHasExplicitOrderByForLimitToLast();
   if (source == Source::Cache) {
@@ -116,61 +137,19 @@ void Query::GetDocuments(Source source, QuerySnapshotListener&& callback) {
                                                      std::move(callback));
     return;
   }
+  if (source == Source::Default &&
+      firestore_->client()->HasRecentlySyncedResults(query_)) {
+    // A listen to this query was in sync moments ago, so the cached results
+    // stand in for the backend's.
+    firestore_->client()->GetRecentlySyncedDocuments(*this,
+                                                     std::move(callback));
+    return;
+  }
 
-  ListenOptions options(
-      /*include_query_metadata_changes=*/true,
-      /*include_document_metadata_changes=*/true,
-      /*wait_for_sync_when_online=*/true);
-
-  class ListenOnce : public EventListener<QuerySnapshot> {
-   public:
-    ListenOnce(Source source, QuerySnapshotListener&& listener)
-        : source_(source), listener_(std::move(listener)) {
-    }
-
-    void OnEvent(StatusOr<QuerySnapshot> maybe_snapshot) override {
-      if (!maybe_snapshot.ok()) {
-        listener_->OnEvent(std::move(maybe_snapshot));
-        return;
-      }
-
-      QuerySnapshot snapshot = std::move(maybe_snapshot).ValueOrDie();
-
-      // Remove query first before passing event to user to avoid user actions
-      // affecting the now stale query.
-      std::unique_ptr<ListenerRegistration> registration =
-          registration_promise_.get_future().get();
-      registration->Remove();
-
-      if (snapshot.metadata().from_cache() && source_ == Source::Server) {
-        listener_->OnEvent(Status{
-            Error::kErrorUnavailable,
-            "Failed to get documents from server. (However, these documents "
-            "may exist in the local cache. Run again without setting source to "
-            "FirestoreSourceServer to retrieve the cached documents.)"});
-      } else {
-        listener_->OnEvent(std::move(snapshot));
-      }
-    };
-
-    void Resolve(std::unique_ptr<ListenerRegistration> registration) {
-      registration_promise_.set_value(std::move(registration));
-    }
-
-   private:
-    Source source_;
-    QuerySnapshotListener listener_;
-
-    std::promise<std::unique_ptr<ListenerRegistration>> registration_promise_;
-  };
-
-  auto listener = absl::make_unique<ListenOnce>(source, std::move(callback));
-  auto listener_unowned = listener.get();
-
-  std::unique_ptr<ListenerRegistration> registration =
-      AddSnapshotListener(std::move(options), std::move(listener));
-
-  listener_unowned->Resolve(std::move(registration));
+  // A single RunQuery call doesn't allocate a target or go through the watch
+  // stream, unlike listening until the results are in sync.
+  firestore_->client()->GetDocumentsFromServer(*this, source,
+                                               std::move(callback));
 }
 
 std::unique_ptr<ListenerRegistration> Query::AddSnapshotListener(
@@ -301,6 +280,10 @@ Query Query::EndAt(Bound bound) const {
   return Wrap(query_.EndingAt(std::move(bound)));
 }
 
+Query Query::Select(std::vector<FieldPath> fields) const {
+  return Wrap(query_.WithProjection(FieldMask(fields.begin(), fields.end())));
+}
+
 void Query::ValidateNewFilter(const class Filter& filter) const {
   if (filter.IsAFieldFilter()) {
     FieldFilter field_filter(filter);
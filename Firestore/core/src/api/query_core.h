@@ -20,11 +20,13 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/api/api_fwd.h"
 #include "Firestore/core/src/core/core_fwd.h"
 #include "Firestore/core/src/core/filter.h"
 #include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/util/status_fwd.h"
 
 namespace firebase {
 namespace firestore {
@@ -66,6 +68,36 @@ class Query {
    */
   void GetDocuments(Source source, QuerySnapshotListener&& callback);
 
+  /**
+   * Counts the documents matching this query, up to its limit if it has one,
+   * without reading them.
+   *
+   * @param source indicates whether the documents should be counted in the
+   *     cache only (`Source::Cache`), by the server only (`Source::Server`), or
+   *     by the server, falling back to the cache when it isn't reachable
+   *     (`Source::Default`). Documents with pending writes are only counted in
+   *     the cache.
+   * @param callback a callback to execute once the documents have been
+   *     counted.
+   */
+  void Count(Source source, CountListener&& callback) const;
+
+  /**
+   * Reads the documents matching this query from the backend into the local
+   * cache, splitting the query into ranges of document IDs that are read
+   * concurrently. Meant for loading large collections, whose results would
+   * otherwise arrive through a single stream.
+   *
+   * The query must be for a collection, without a limit, bounds, projection,
+   * inequality filters or orders other than by ascending document ID.
+   *
+   * @param partition_count the number of ranges to read concurrently.
+   * @param callback a callback to execute once all the documents are in the
+   *     cache, or with the first error.
+   */
+  void LoadPartitioned(int32_t partition_count,
+                       util::StatusCallback callback) const;
+
   /**
    * Attaches a listener for QuerySnapshot events.
    *
@@ -163,6 +195,18 @@ class Query {
    */
   Query EndAt(core::Bound bound) const;
 
+  /**
+   * Creates and returns a new `Query` whose snapshots only include the given
+   * fields of the matching documents. Reads of the new query with a source
+   * other than `Source::Cache` run once against the backend, which only sends
+   * those fields; listeners keep only those fields in memory.
+   *
+   * @param fields The fields to include in the results of the query.
+   *
+   * @return The created `Query`.
+   */
+  Query Select(std::vector<model::FieldPath> fields) const;
+
   /**
    * Creates a new `Query` with the given internal query.
    */
@@ -16,6 +16,9 @@
 
 #include "Firestore/core/src/api/query_snapshot.h"
 
+#include <algorithm>
+#include <iterator>
+#include <mutex>  // NOLINT(build/c++11)
 #include <utility>
 
 #include "Firestore/core/src/api/document_change.h"
@@ -36,9 +39,17 @@ using core::DocumentViewChange;
 using core::ViewSnapshot;
 using model::Document;
 using model::DocumentComparator;
+using model::DocumentKey;
+using model::DocumentKeySet;
 using model::DocumentSet;
 using util::ThrowInvalidArgument;
 
+struct QuerySnapshot::ChangesCache {
+  std::mutex mutex;
+  // Indexed by whether metadata changes are included.
+  absl::optional<std::vector<DocumentChange>> changes[2];
+};
+
 QuerySnapshot::QuerySnapshot(std::shared_ptr<Firestore> firestore,
                              core::Query query,
                              core::ViewSnapshot&& snapshot,
@@ -46,7 +57,8 @@ QuerySnapshot::QuerySnapshot(std::shared_ptr<Firestore> firestore,
     : firestore_(std::move(firestore)),
       internal_query_(std::move(query)),
       snapshot_(std::move(snapshot)),
-      metadata_(std::move(metadata)) {
+      metadata_(std::move(metadata)),
+      changes_cache_(std::make_shared<ChangesCache>()) {
 }
 
 Query QuerySnapshot::query() const {
@@ -98,12 +110,106 @@ static DocumentChange::Type DocumentChangeTypeForChange(
 void QuerySnapshot::ForEachChange(
     bool include_metadata_changes,
     const std::function<void(DocumentChange)>& callback) const {
-  if (include_metadata_changes && snapshot_.excludes_metadata_changes()) {
-    ThrowInvalidArgument(
-        "To include metadata changes with your document "
-        "changes, you must call "
-        "addSnapshotListener(includeMetadataChanges:true).");
+  for (const DocumentChange& change :
+       DocumentChanges(include_metadata_changes)) {
+    callback(change);
+  }
+}
+
+const std::vector<DocumentChange>& QuerySnapshot::DocumentChanges(
+    bool include_metadata_changes) const {
+  ValidateIncludeMetadataChanges(include_metadata_changes);
+
+  std::lock_guard<std::mutex> lock(changes_cache_->mutex);
+  absl::optional<std::vector<DocumentChange>>& changes =
+      changes_cache_->changes[include_metadata_changes ? 1 : 0];
+  if (!changes) {
+    changes = CalculateDocumentChanges(include_metadata_changes);
+  }
+  // The changes are never modified once computed.
+  return *changes;
+}
+
+std::vector<DocumentChange> QuerySnapshot::DocumentChangesSince(
+    const QuerySnapshot& earlier, bool include_metadata_changes) const {
+  ValidateIncludeMetadataChanges(include_metadata_changes);
+  HARD_ASSERT(earlier.internal_query_ == internal_query_,
+              "Can only diff snapshots of the same query");
+
+  const DocumentSet& old_documents = earlier.snapshot_.documents();
+  const DocumentSet& new_documents = snapshot_.documents();
+  DocumentKeySet old_mutated_keys = earlier.snapshot_.mutated_keys();
+  DocumentKeySet new_mutated_keys = snapshot_.mutated_keys();
+  auto pending_writes_changed = [&](const DocumentKey& key) {
+    return old_mutated_keys.contains(key) != new_mutated_keys.contains(key);
+  };
+
+  std::vector<DocumentChange> result;
+  auto add_change = [&](DocumentChange::Type type, const Document& doc) {
+    SnapshotMetadata metadata(
+        /*pending_writes=*/new_mutated_keys.contains(doc.key()),
+        /*from_cache=*/snapshot_.from_cache());
+    auto document =
+        DocumentSnapshot::FromDocument(firestore_, doc, std::move(metadata));
+    size_t old_index = type == DocumentChange::Type::Added
+                           ? DocumentChange::npos
+                           : old_documents.IndexOf(doc.key());
+    size_t new_index = type == DocumentChange::Type::Removed
+                           ? DocumentChange::npos
+                           : new_documents.IndexOf(doc.key());
+    result.emplace_back(type, std::move(document), old_index, new_index);
+  };
+
+  // A document that is in both snapshots unchanged can still have a
+  // metadata-only change if its pending writes were acknowledged. Such keys
+  // are few, so they're found by comparing the mutated keys directly.
+  std::vector<DocumentKey> metadata_candidates;
+  if (include_metadata_changes) {
+    std::set_symmetric_difference(
+        old_mutated_keys.begin(), old_mutated_keys.end(),
+        new_mutated_keys.begin(), new_mutated_keys.end(),
+        std::back_inserter(metadata_candidates));
   }
+  auto candidate = metadata_candidates.begin();
+  auto add_metadata_changes_before = [&](const DocumentKey* key) {
+    for (; candidate != metadata_candidates.end() &&
+           (!key || *candidate < *key);
+         ++candidate) {
+      absl::optional<Document> doc = new_documents.GetDocument(*candidate);
+      if (doc && old_documents.ContainsKey(*candidate)) {
+        add_change(DocumentChange::Type::Modified, *doc);
+      }
+    }
+    if (key && candidate != metadata_candidates.end() && *candidate == *key) {
+      ++candidate;
+    }
+  };
+
+  DocumentSet::Diff(
+      old_documents, new_documents,
+      [&](const absl::optional<Document>& old_doc,
+          const absl::optional<Document>& new_doc) {
+        const DocumentKey& key = old_doc ? old_doc->key() : new_doc->key();
+        add_metadata_changes_before(&key);
+
+        if (!new_doc) {
+          add_change(DocumentChange::Type::Removed, *old_doc);
+        } else if (!old_doc) {
+          add_change(DocumentChange::Type::Added, *new_doc);
+        } else if (old_doc->data() != new_doc->data() ||
+                   (include_metadata_changes && pending_writes_changed(key))) {
+          add_change(DocumentChange::Type::Modified, *new_doc);
+        }
+      });
+  add_metadata_changes_before(nullptr);
+
+  return result;
+}
+
+std::vector<DocumentChange> QuerySnapshot::CalculateDocumentChanges(
+    bool include_metadata_changes) const {
+  std::vector<DocumentChange> result;
+  result.reserve(snapshot_.document_changes().size());
 
   if (snapshot_.old_documents().empty()) {
     // Special case the first snapshot because index calculation is easy and
@@ -126,8 +232,8 @@ void QuerySnapshot::ForEachChange(
                                         *last_document, change.document())),
                   "Got added events in wrong order");
 
-      callback(DocumentChange(DocumentChange::Type::Added, std::move(document),
-                              DocumentChange::npos, index++));
+      result.emplace_back(DocumentChange::Type::Added, std::move(document),
+                          DocumentChange::npos, index++);
       last_document = doc;
     }
 
@@ -161,9 +267,20 @@ void QuerySnapshot::ForEachChange(
       }
 
       DocumentChange::Type type = DocumentChangeTypeForChange(change);
-      callback(DocumentChange(type, std::move(document), old_index, new_index));
+      result.emplace_back(type, std::move(document), old_index, new_index);
     }
   }
+  return result;
+}
+
+void QuerySnapshot::ValidateIncludeMetadataChanges(
+    bool include_metadata_changes) const {
+  if (include_metadata_changes && snapshot_.excludes_metadata_changes()) {
+    ThrowInvalidArgument(
+        "To include metadata changes with your document "
+        "changes, you must call "
+        "addSnapshotListener(includeMetadataChanges:true).");
+  }
 }
 
 }  // namespace api
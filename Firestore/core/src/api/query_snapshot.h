@@ -20,6 +20,7 @@
 #include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/api/api_fwd.h"
 #include "Firestore/core/src/api/snapshot_metadata.h"
@@ -82,13 +83,43 @@ class QuerySnapshot {
   void ForEachChange(bool include_metadata_changes,
                      const std::function<void(DocumentChange)>& callback) const;
 
+  /**
+   * Returns the `DocumentChanges` representing the changes between the prior
+   * snapshot and this one. The changes and their indices are only computed
+   * the first time they're requested; copies of this snapshot share them.
+   */
+  const std::vector<DocumentChange>& DocumentChanges(
+      bool include_metadata_changes) const;
+
+  /**
+   * Returns the `DocumentChanges` that turn `earlier`, a snapshot previously
+   * raised by the same listener, into this one, ordered by document key. Old
+   * indices are positions in `earlier` and new indices positions in this
+   * snapshot.
+   *
+   * The two snapshots are compared directly rather than by replaying the
+   * changes of the snapshots in between. Documents that weren't changed in
+   * between are shared by both snapshots and are skipped, so this takes time
+   * proportional to the number of changed documents.
+   */
+  std::vector<DocumentChange> DocumentChangesSince(
+      const QuerySnapshot& earlier, bool include_metadata_changes) const;
+
   friend bool operator==(const QuerySnapshot& lhs, const QuerySnapshot& rhs);
 
  private:
+  struct ChangesCache;
+
+  std::vector<DocumentChange> CalculateDocumentChanges(
+      bool include_metadata_changes) const;
+
+  void ValidateIncludeMetadataChanges(bool include_metadata_changes) const;
+
   std::shared_ptr<Firestore> firestore_;
   core::Query internal_query_;
   core::ViewSnapshot snapshot_;
   SnapshotMetadata metadata_;
+  std::shared_ptr<ChangesCache> changes_cache_;
 };
 
 using QuerySnapshotListener =
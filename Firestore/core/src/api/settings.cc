@@ -27,16 +27,73 @@ constexpr bool Settings::DefaultSslEnabled;
 constexpr bool Settings::DefaultPersistenceEnabled;
 constexpr int64_t Settings::DefaultCacheSizeBytes;
 constexpr int64_t Settings::MinimumCacheSizeBytes;
+constexpr int64_t Settings::LevelDbPlatformDefault;
 
 size_t Settings::Hash() const {
   return util::Hash(host_, ssl_enabled_, persistence_enabled_,
-                    cache_size_bytes_);
+                    cache_size_bytes_, leveldb_block_cache_size_bytes_,
+                    leveldb_write_buffer_size_bytes_,
+                    leveldb_bloom_filter_bits_per_key_,
+                    write_coalescing_enabled_, group_commit_enabled_,
+                    sync_user_writes_, approximate_lru_enabled_,
+                    compact_memory_cache_enabled_,
+                    memory_snapshot_interval_seconds_,
+                    grpc_completion_queue_count_, write_pipeline_depth_,
+                    adaptive_write_pipeline_enabled_,
+                    max_batches_per_write_request_, limbo_lookup_batch_size_,
+                    max_concurrent_limbo_lookups_, write_squashing_enabled_,
+                    ack_coalescing_enabled_,
+                    static_cast<int>(message_compression_),
+                    connection_warm_up_enabled_, stream_idle_timeout_seconds_,
+                    adaptive_stream_idle_timeout_enabled_,
+                    keepalive_time_seconds_, keepalive_without_calls_enabled_,
+                    full_jitter_backoff_enabled_, query_result_cache_seconds_,
+                    target_release_grace_period_ms_);
 }
 
 bool operator==(const Settings& lhs, const Settings& rhs) {
   return lhs.host_ == rhs.host_ && lhs.ssl_enabled_ == rhs.ssl_enabled_ &&
          lhs.persistence_enabled_ == rhs.persistence_enabled_ &&
-         lhs.cache_size_bytes_ == rhs.cache_size_bytes_;
+         lhs.cache_size_bytes_ == rhs.cache_size_bytes_ &&
+         lhs.leveldb_block_cache_size_bytes_ ==
+             rhs.leveldb_block_cache_size_bytes_ &&
+         lhs.leveldb_write_buffer_size_bytes_ ==
+             rhs.leveldb_write_buffer_size_bytes_ &&
+         lhs.leveldb_bloom_filter_bits_per_key_ ==
+             rhs.leveldb_bloom_filter_bits_per_key_ &&
+         lhs.write_coalescing_enabled_ == rhs.write_coalescing_enabled_ &&
+         lhs.group_commit_enabled_ == rhs.group_commit_enabled_ &&
+         lhs.sync_user_writes_ == rhs.sync_user_writes_ &&
+         lhs.approximate_lru_enabled_ == rhs.approximate_lru_enabled_ &&
+         lhs.compact_memory_cache_enabled_ ==
+             rhs.compact_memory_cache_enabled_ &&
+         lhs.memory_snapshot_interval_seconds_ ==
+             rhs.memory_snapshot_interval_seconds_ &&
+         lhs.grpc_completion_queue_count_ ==
+             rhs.grpc_completion_queue_count_ &&
+         lhs.write_pipeline_depth_ == rhs.write_pipeline_depth_ &&
+         lhs.adaptive_write_pipeline_enabled_ ==
+             rhs.adaptive_write_pipeline_enabled_ &&
+         lhs.max_batches_per_write_request_ ==
+             rhs.max_batches_per_write_request_ &&
+         lhs.limbo_lookup_batch_size_ == rhs.limbo_lookup_batch_size_ &&
+         lhs.max_concurrent_limbo_lookups_ ==
+             rhs.max_concurrent_limbo_lookups_ &&
+         lhs.write_squashing_enabled_ == rhs.write_squashing_enabled_ &&
+         lhs.ack_coalescing_enabled_ == rhs.ack_coalescing_enabled_ &&
+         lhs.message_compression_ == rhs.message_compression_ &&
+         lhs.connection_warm_up_enabled_ == rhs.connection_warm_up_enabled_ &&
+         lhs.stream_idle_timeout_seconds_ ==
+             rhs.stream_idle_timeout_seconds_ &&
+         lhs.adaptive_stream_idle_timeout_enabled_ ==
+             rhs.adaptive_stream_idle_timeout_enabled_ &&
+         lhs.keepalive_time_seconds_ == rhs.keepalive_time_seconds_ &&
+         lhs.keepalive_without_calls_enabled_ ==
+             rhs.keepalive_without_calls_enabled_ &&
+         lhs.full_jitter_backoff_enabled_ == rhs.full_jitter_backoff_enabled_ &&
+         lhs.query_result_cache_seconds_ == rhs.query_result_cache_seconds_ &&
+         lhs.target_release_grace_period_ms_ ==
+             rhs.target_release_grace_period_ms_;
 }
 
 }  // namespace api
@@ -40,6 +40,11 @@ class Settings {
   static constexpr int64_t DefaultCacheSizeBytes = 100 * 1024 * 1024;
   static constexpr int64_t MinimumCacheSizeBytes = 1 * 1024 * 1024;
   static constexpr int64_t CacheSizeUnlimited = -1;
+  /**
+   * Value of the LevelDB tuning settings that selects the default for the
+   * current platform.
+   */
+  static constexpr int64_t LevelDbPlatformDefault = -1;
 
   Settings() = default;
 
@@ -74,6 +79,337 @@ class Settings {
     return cache_size_bytes_ != CacheSizeUnlimited;
   }
 
+  /**
+   * The capacity of the LevelDB block cache, in bytes, or
+   * `LevelDbPlatformDefault`.
+   */
+  void set_leveldb_block_cache_size_bytes(int64_t value) {
+    leveldb_block_cache_size_bytes_ = value;
+  }
+  int64_t leveldb_block_cache_size_bytes() const {
+    return leveldb_block_cache_size_bytes_;
+  }
+
+  /**
+   * The size of the LevelDB write buffer, in bytes, or
+   * `LevelDbPlatformDefault`.
+   */
+  void set_leveldb_write_buffer_size_bytes(int64_t value) {
+    leveldb_write_buffer_size_bytes_ = value;
+  }
+  int64_t leveldb_write_buffer_size_bytes() const {
+    return leveldb_write_buffer_size_bytes_;
+  }
+
+  /**
+   * The number of bits per key of the LevelDB bloom filter, 0 to disable the
+   * bloom filter, or `LevelDbPlatformDefault`.
+   */
+  void set_leveldb_bloom_filter_bits_per_key(int64_t value) {
+    leveldb_bloom_filter_bits_per_key_ = value;
+  }
+  int64_t leveldb_bloom_filter_bits_per_key() const {
+    return leveldb_bloom_filter_bits_per_key_;
+  }
+
+  /**
+   * Sets whether consecutive writes that are processed in the same turn of the
+   * worker queue are committed to the local store together, in a single
+   * transaction that also recomputes the affected views only once. Each write
+   * still becomes its own batch and completes individually.
+   */
+  void set_write_coalescing_enabled(bool value) {
+    write_coalescing_enabled_ = value;
+  }
+  bool write_coalescing_enabled() const {
+    return write_coalescing_enabled_;
+  }
+
+  /**
+   * Sets whether the LevelDB commits of cache updates (remote documents,
+   * targets, write acknowledgements) that run back to back on the worker queue
+   * are merged into a single LevelDB write. Commits of new local writes are
+   * never deferred.
+   */
+  void set_group_commit_enabled(bool value) {
+    group_commit_enabled_ = value;
+  }
+  bool group_commit_enabled() const {
+    return group_commit_enabled_;
+  }
+
+  /**
+   * Sets whether commits of new local writes wait for LevelDB to sync its log
+   * to disk, so that writes survive an operating system crash before they
+   * reach the backend. Other commits only update state that can be recovered
+   * from the backend, and are never synced.
+   */
+  void set_sync_user_writes(bool value) {
+    sync_user_writes_ = value;
+  }
+  bool sync_user_writes() const {
+    return sync_user_writes_;
+  }
+
+  /**
+   * Sets whether LRU garbage collection estimates which sequence numbers to
+   * collect from a summary saved by the previous collection, rather than
+   * reading every cached document's sequence number first. Collections may
+   * then remove somewhat fewer documents.
+   */
+  void set_approximate_lru_enabled(bool value) {
+    approximate_lru_enabled_ = value;
+  }
+  bool approximate_lru_enabled() const {
+    return approximate_lru_enabled_;
+  }
+
+  /**
+   * Sets whether memory persistence keeps cached documents encoded and only
+   * decodes them when they are read. This lets it hold several times more
+   * documents in the same memory, at the cost of decoding them on each read
+   * that misses a small cache of recently read documents. Has no effect when
+   * persistence is enabled.
+   */
+  void set_compact_memory_cache_enabled(bool value) {
+    compact_memory_cache_enabled_ = value;
+  }
+  bool compact_memory_cache_enabled() const {
+    return compact_memory_cache_enabled_;
+  }
+
+  /**
+   * Sets how often, in seconds, memory persistence writes a snapshot of its
+   * cache and pending writes to disk, which the next start of the app loads.
+   * Snapshots are also written when the app enters the background. This keeps
+   * the cheap writes of memory persistence without downloading everything
+   * again on each cold start, but writes made after the last snapshot are lost
+   * if the app is terminated. Zero (the default) disables snapshots. Has no
+   * effect when persistence is enabled.
+   */
+  void set_memory_snapshot_interval_seconds(int value) {
+    memory_snapshot_interval_seconds_ = value;
+  }
+  int memory_snapshot_interval_seconds() const {
+    return memory_snapshot_interval_seconds_;
+  }
+
+  /**
+   * Sets the number of gRPC completion queues that network calls are spread
+   * across, each polled by its own thread. More queues can reduce latency when
+   * many calls are active at once.
+   */
+  void set_grpc_completion_queue_count(int value) {
+    grpc_completion_queue_count_ = value;
+  }
+  int grpc_completion_queue_count() const {
+    return grpc_completion_queue_count_;
+  }
+
+  /**
+   * Sets how many write batches may be sent to the backend before the first
+   * of them is acknowledged. A deeper pipeline increases write throughput over
+   * high-latency connections.
+   */
+  void set_write_pipeline_depth(int value) {
+    write_pipeline_depth_ = value;
+  }
+  int write_pipeline_depth() const {
+    return write_pipeline_depth_;
+  }
+
+  /**
+   * Sets whether the write pipeline depth adapts to the connection, growing
+   * while writes are acknowledged quickly and shrinking when acknowledgements
+   * slow down or the write stream fails. The configured depth is the starting
+   * point.
+   */
+  void set_adaptive_write_pipeline_enabled(bool value) {
+    adaptive_write_pipeline_enabled_ = value;
+  }
+  bool adaptive_write_pipeline_enabled() const {
+    return adaptive_write_pipeline_enabled_;
+  }
+
+  /**
+   * Sets how many consecutive write batches may be sent to the backend in a
+   * single request, which is committed atomically. Batches rejected together
+   * are retried one by one.
+   */
+  void set_max_batches_per_write_request(int value) {
+    max_batches_per_write_request_ = value;
+  }
+  int max_batches_per_write_request() const {
+    return max_batches_per_write_request_;
+  }
+
+  /**
+   * Sets how many documents in limbo (cached documents that a query's results
+   * from the backend no longer include) are fetched from the backend together
+   * to find out whether they were deleted. If 0, which is the default, each
+   * such document is resolved by a separate listen instead.
+   */
+  void set_limbo_lookup_batch_size(int value) {
+    limbo_lookup_batch_size_ = value;
+  }
+  int limbo_lookup_batch_size() const {
+    return limbo_lookup_batch_size_;
+  }
+
+  /**
+   * Sets how many fetches of documents in limbo may be in flight at once. Has
+   * no effect unless `limbo_lookup_batch_size` is positive.
+   */
+  void set_max_concurrent_limbo_lookups(int value) {
+    max_concurrent_limbo_lookups_ = value;
+  }
+  int max_concurrent_limbo_lookups() const {
+    return max_concurrent_limbo_lookups_;
+  }
+
+  /**
+   * Whether a write to a single document replaces the newest pending write to
+   * the same document while that write is still waiting to be sent, so that
+   * bursts of updates to one document are sent as a single write. Combined
+   * writes are committed or rejected together.
+   */
+  void set_write_squashing_enabled(bool value) {
+    write_squashing_enabled_ = value;
+  }
+  bool write_squashing_enabled() const {
+    return write_squashing_enabled_;
+  }
+
+  /**
+   * Whether write acknowledgements that arrive in quick succession are
+   * applied together, in a single transaction and a single round of snapshot
+   * updates, rather than one at a time.
+   */
+  void set_ack_coalescing_enabled(bool value) {
+    ack_coalescing_enabled_ = value;
+  }
+  bool ack_coalescing_enabled() const {
+    return ack_coalescing_enabled_;
+  }
+
+  /** Algorithms for compressing the messages sent to the backend. */
+  enum class MessageCompression {
+    None,
+    Gzip,
+    Deflate,
+  };
+
+  /**
+   * Sets how the messages of streams and calls to the backend are compressed.
+   * Whether responses are compressed is up to the backend. Compression trades
+   * CPU time for bandwidth, so it pays off for large, text-heavy documents.
+   */
+  void set_message_compression(MessageCompression value) {
+    message_compression_ = value;
+  }
+  MessageCompression message_compression() const {
+    return message_compression_;
+  }
+
+  /**
+   * Whether the client starts connecting to the backend and fetches an auth
+   * token as soon as it starts, rather than when the first listen or write
+   * needs them. This takes the TLS handshake and the token fetch off the
+   * latency of the first operation.
+   */
+  void set_connection_warm_up_enabled(bool value) {
+    connection_warm_up_enabled_ = value;
+  }
+  bool connection_warm_up_enabled() const {
+    return connection_warm_up_enabled_;
+  }
+
+  /**
+   * Sets how many seconds the listen and write streams stay open once they have
+   * nothing to do. Reopening a closed stream costs a round trip and resending
+   * the active listens, so apps that write or listen at a steady cadence
+   * slightly longer than the timeout benefit from a longer one.
+   */
+  void set_stream_idle_timeout_seconds(int value) {
+    stream_idle_timeout_seconds_ = value;
+  }
+  int stream_idle_timeout_seconds() const {
+    return stream_idle_timeout_seconds_;
+  }
+
+  /**
+   * Whether each stream stretches its idle timeout (up to five minutes) to
+   * cover the idle periods it recently observed before being used again.
+   */
+  void set_adaptive_stream_idle_timeout_enabled(bool value) {
+    adaptive_stream_idle_timeout_enabled_ = value;
+  }
+  bool adaptive_stream_idle_timeout_enabled() const {
+    return adaptive_stream_idle_timeout_enabled_;
+  }
+
+  /** Sets how many seconds apart HTTP/2 keepalive pings are sent. */
+  void set_keepalive_time_seconds(int value) {
+    keepalive_time_seconds_ = value;
+  }
+  int keepalive_time_seconds() const {
+    return keepalive_time_seconds_;
+  }
+
+  /**
+   * Whether keepalive pings are also sent while no stream is open, which keeps
+   * the connection alive across idle stream closes. The backend may close
+   * connections that ping too often while idle.
+   */
+  void set_keepalive_without_calls_enabled(bool value) {
+    keepalive_without_calls_enabled_ = value;
+  }
+  bool keepalive_without_calls_enabled() const {
+    return keepalive_without_calls_enabled_;
+  }
+
+  /**
+   * Whether the streams back off after errors with "full jitter", i.e. wait for
+   * a random time between zero and the backoff delay rather than for the delay
+   * plus or minus half of it. This spreads out the reconnections of clients
+   * that lost their streams at the same time.
+   */
+  void set_full_jitter_backoff_enabled(bool value) {
+    full_jitter_backoff_enabled_ = value;
+  }
+  bool full_jitter_backoff_enabled() const {
+    return full_jitter_backoff_enabled_;
+  }
+
+  /**
+   * Sets for how many seconds after a listen to a query stopped while in sync
+   * with the backend, one-shot gets of the same query read the results from
+   * the local cache instead of listening again. Such results are reported as
+   * not from cache, although changes made on the backend in the meantime are
+   * missed. Zero (the default) disables this. Requires persistence, since the
+   * memory cache drops the documents once the listen stops.
+   */
+  void set_query_result_cache_seconds(int value) {
+    query_result_cache_seconds_ = value;
+  }
+  int query_result_cache_seconds() const {
+    return query_result_cache_seconds_;
+  }
+
+  /**
+   * Sets for how many milliseconds the target of a query stays active after
+   * its last listener is removed. Listening to the query again within that
+   * time reuses its results right away, without querying the local cache or
+   * resuming the target on the backend. Zero (the default) releases targets
+   * immediately.
+   */
+  void set_target_release_grace_period_ms(int value) {
+    target_release_grace_period_ms_ = value;
+  }
+  int target_release_grace_period_ms() const {
+    return target_release_grace_period_ms_;
+  }
+
   friend bool operator==(const Settings& lhs, const Settings& rhs);
 
   size_t Hash() const;
@@ -83,6 +419,32 @@ class Settings {
   bool ssl_enabled_ = DefaultSslEnabled;
   bool persistence_enabled_ = DefaultPersistenceEnabled;
   int64_t cache_size_bytes_ = DefaultCacheSizeBytes;
+  int64_t leveldb_block_cache_size_bytes_ = LevelDbPlatformDefault;
+  int64_t leveldb_write_buffer_size_bytes_ = LevelDbPlatformDefault;
+  int64_t leveldb_bloom_filter_bits_per_key_ = LevelDbPlatformDefault;
+  bool write_coalescing_enabled_ = false;
+  bool group_commit_enabled_ = false;
+  bool sync_user_writes_ = false;
+  bool approximate_lru_enabled_ = false;
+  bool compact_memory_cache_enabled_ = false;
+  int memory_snapshot_interval_seconds_ = 0;
+  int grpc_completion_queue_count_ = 1;
+  int write_pipeline_depth_ = 10;
+  bool adaptive_write_pipeline_enabled_ = false;
+  int max_batches_per_write_request_ = 1;
+  int limbo_lookup_batch_size_ = 0;
+  int max_concurrent_limbo_lookups_ = 4;
+  bool write_squashing_enabled_ = false;
+  bool ack_coalescing_enabled_ = false;
+  MessageCompression message_compression_ = MessageCompression::None;
+  bool connection_warm_up_enabled_ = false;
+  int stream_idle_timeout_seconds_ = 60;
+  bool adaptive_stream_idle_timeout_enabled_ = false;
+  int keepalive_time_seconds_ = 30;
+  bool keepalive_without_calls_enabled_ = false;
+  bool full_jitter_backoff_enabled_ = false;
+  int query_result_cache_seconds_ = 0;
+  int target_release_grace_period_ms_ = 0;
 };
 
 }  // namespace api
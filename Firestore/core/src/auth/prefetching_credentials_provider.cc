@@ -0,0 +1,130 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/auth/prefetching_credentials_provider.h"
+
+#include <utility>
+
+namespace firebase {
+namespace firestore {
+namespace auth {
+
+constexpr std::chrono::seconds
+    PrefetchingCredentialsProvider::kMaxPrefetchedTokenAge;
+
+PrefetchingCredentialsProvider::PrefetchingCredentialsProvider(
+    std::shared_ptr<CredentialsProvider> provider)
+    : provider_(std::move(provider)) {
+}
+
+void PrefetchingCredentialsProvider::Prefetch() {
+  int generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_prefetching_) return;
+
+    is_prefetching_ = true;
+    prefetched_token_.reset();
+    generation = generation_;
+  }
+
+  std::weak_ptr<PrefetchingCredentialsProvider> weak_this = shared_from_this();
+  provider_->GetToken([weak_this, generation](util::StatusOr<Token> result) {
+    auto shared_this = weak_this.lock();
+    if (shared_this) {
+      shared_this->OnPrefetched(generation, result);
+    }
+  });
+}
+
+void PrefetchingCredentialsProvider::OnPrefetched(
+    int generation, const util::StatusOr<Token>& result) {
+  std::vector<TokenListener> waiting_listeners;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_prefetching_ = false;
+    std::swap(waiting_listeners, waiting_listeners_);
+
+    // The token goes to the requests that were waiting for it; only keep it for
+    // a later request if nobody was waiting and it's still valid.
+    if (waiting_listeners.empty() && result.ok() && generation == generation_) {
+      prefetched_token_.emplace(result.ValueOrDie());
+      prefetched_time_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  for (const TokenListener& listener : waiting_listeners) {
+    listener(result);
+  }
+}
+
+void PrefetchingCredentialsProvider::GetToken(TokenListener completion) {
+  absl::optional<Token> token;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_prefetching_) {
+      waiting_listeners_.push_back(std::move(completion));
+      return;
+    }
+
+    auto age = std::chrono::steady_clock::now() - prefetched_time_;
+    if (prefetched_token_ && age <= kMaxPrefetchedTokenAge) {
+      token.emplace(std::move(prefetched_token_).value());
+    }
+    prefetched_token_.reset();
+  }
+
+  if (token) {
+    if (completion) {
+      completion(std::move(token).value());
+    }
+  } else {
+    provider_->GetToken(std::move(completion));
+  }
+}
+
+void PrefetchingCredentialsProvider::InvalidateToken() {
+  DropPrefetchedToken();
+  provider_->InvalidateToken();
+}
+
+void PrefetchingCredentialsProvider::SetCredentialChangeListener(
+    CredentialChangeListener change_listener) {
+  if (!change_listener) {
+    provider_->SetCredentialChangeListener(nullptr);
+    return;
+  }
+
+  std::weak_ptr<PrefetchingCredentialsProvider> weak_this = shared_from_this();
+  provider_->SetCredentialChangeListener(
+      [weak_this, change_listener](User user) {
+        auto shared_this = weak_this.lock();
+        if (shared_this) {
+          shared_this->DropPrefetchedToken();
+        }
+        change_listener(std::move(user));
+      });
+}
+
+void PrefetchingCredentialsProvider::DropPrefetchedToken() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  prefetched_token_.reset();
+  ++generation_;
+}
+
+}  // namespace auth
+}  // namespace firestore
+}  // namespace firebase
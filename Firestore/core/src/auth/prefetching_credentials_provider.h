@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_AUTH_PREFETCHING_CREDENTIALS_PROVIDER_H_
+#define FIRESTORE_CORE_SRC_AUTH_PREFETCHING_CREDENTIALS_PROVIDER_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "Firestore/core/src/auth/credentials_provider.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+namespace auth {
+
+/**
+ * `PrefetchingCredentialsProvider` wraps another `CredentialsProvider` and can
+ * fetch a token ahead of time (via `Prefetch`), so that the first RPC or stream
+ * doesn't have to wait for it.
+ *
+ * A prefetched token is handed out to a single `GetToken` request, and only if
+ * it's recent and neither a credential change nor `InvalidateToken` happened
+ * since it was fetched. `GetToken` requests made while a prefetch is in flight
+ * wait for it instead of issuing a fetch of their own. All other requests are
+ * forwarded to the wrapped provider.
+ *
+ * Must be owned by a `std::shared_ptr`.
+ */
+class PrefetchingCredentialsProvider
+    : public CredentialsProvider,
+      public std::enable_shared_from_this<PrefetchingCredentialsProvider> {
+ public:
+  /** How long a prefetched token may be held before it's dropped. */
+  static constexpr std::chrono::seconds kMaxPrefetchedTokenAge{60};
+
+  explicit PrefetchingCredentialsProvider(
+      std::shared_ptr<CredentialsProvider> provider);
+
+  /**
+   * Requests a token from the wrapped provider and holds on to it for the next
+   * `GetToken` request. Does nothing if a prefetch is already in flight.
+   */
+  void Prefetch();
+
+  void GetToken(TokenListener completion) override;
+  void InvalidateToken() override;
+  void SetCredentialChangeListener(
+      CredentialChangeListener change_listener) override;
+
+ private:
+  void OnPrefetched(int generation, const util::StatusOr<Token>& result);
+  void DropPrefetchedToken();
+
+  std::shared_ptr<CredentialsProvider> provider_;
+
+  std::mutex mutex_;
+  bool is_prefetching_ = false;
+  std::vector<TokenListener> waiting_listeners_;
+  absl::optional<Token> prefetched_token_;
+  std::chrono::steady_clock::time_point prefetched_time_;
+
+  // Incremented whenever any prefetched token becomes unusable, including one
+  // still in flight.
+  int generation_ = 0;
+};
+
+}  // namespace auth
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_AUTH_PREFETCHING_CREDENTIALS_PROVIDER_H_
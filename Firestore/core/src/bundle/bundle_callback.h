@@ -35,8 +35,16 @@ class BundleCallback {
   virtual ~BundleCallback() = default;
 
   /**
-   * Applies the documents from a bundle to the "ground-state" (remote)
-   * documents.
+   * Prepares to apply the documents from the given bundle, dissociating the
+   * documents from any previous load of the same bundle. Must be called before
+   * the first call to `ApplyBundledDocuments()` for the bundle.
+   */
+  virtual void StartBundledDocuments(const std::string& bundle_id) = 0;
+
+  /**
+   * Applies a chunk of the documents from a bundle to the "ground-state"
+   * (remote) documents, and returns the resulting document changes. Large
+   * bundles are applied over several calls, each in its own transaction.
    *
    * Local documents are re-calculated if there are remaining mutations in the
    * queue.
@@ -45,6 +53,14 @@ class BundleCallback {
       const model::MaybeDocumentMap& documents,
       const std::string& bundle_id) = 0;
 
+  /**
+   * Associates documents from a bundle that were not decoded, because the
+   * local cache already had the same or a newer version of them, with the
+   * bundle, like `ApplyBundledDocuments()` does for the documents it applies.
+   */
+  virtual void RetainBundledDocuments(const model::DocumentKeySet& keys,
+                                      const std::string& bundle_id) = 0;
+
   /** Saves the given NamedQuery to local persistence. */
   virtual void SaveNamedQuery(const NamedQuery& query,
                               const model::DocumentKeySet& keys) = 0;
@@ -34,6 +34,14 @@ class BundleDocument : public BundleElement {
       : document_(std::move(document)) {
   }
 
+  /**
+   * Creates a bundle document that only carries the key and version of the
+   * document, if `fields_skipped` is true.
+   */
+  BundleDocument(model::Document document, bool fields_skipped)
+      : document_(std::move(document)), fields_skipped_(fields_skipped) {
+  }
+
   Type element_type() const override {
     return Type::Document;
   }
@@ -48,8 +56,17 @@ class BundleDocument : public BundleElement {
     return document_;
   }
 
+  /**
+   * Returns true if the fields of the document weren't decoded, because the
+   * local cache already had the same or a newer version of it.
+   */
+  bool fields_skipped() const {
+    return fields_skipped_;
+  }
+
  private:
   model::Document document_;
+  bool fields_skipped_ = false;
 };
 
 inline bool operator==(const BundleDocument& lhs, const BundleDocument& rhs) {
@@ -26,6 +26,7 @@
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/model_fwd.h"
 #include "Firestore/core/src/model/no_document.h"
+#include "Firestore/core/src/util/hard_assert.h"
 
 namespace firebase {
 namespace firestore {
@@ -34,12 +35,22 @@ namespace bundle {
 using firestore::Error;
 using firestore::api::LoadBundleTaskProgress;
 using firestore::api::LoadBundleTaskState;
+using model::DocumentKey;
 using model::DocumentKeySet;
 using model::MaybeDocumentMap;
 using model::NoDocument;
 using util::Status;
 using util::StatusOr;
 
+constexpr size_t BundleLoader::kDefaultMaxChunkDocuments;
+constexpr uint64_t BundleLoader::kDefaultMaxChunkBytes;
+
+void BundleLoader::SetChunkLimits(size_t max_documents, uint64_t max_bytes) {
+  HARD_ASSERT(max_documents > 0, "Chunks must hold at least one document.");
+  max_chunk_documents_ = max_documents;
+  max_chunk_bytes_ = max_bytes;
+}
+
 Status BundleLoader::AddElementInternal(const BundleElement& element) {
   HARD_ASSERT(element.element_type() != BundleElement::Type::Metadata,
               "Unexpected bundle metadata element.");
@@ -75,7 +86,11 @@ Status BundleLoader::AddElementInternal(const BundleElement& element) {
             "The document being added does not match the stored metadata.")};
       }
 
-      documents_ = documents_.insert(document.key(), document.document());
+      if (document.fields_skipped()) {
+        skipped_documents_ = skipped_documents_.insert(document.key());
+      } else {
+        documents_ = documents_.insert(document.key(), document.document());
+      }
       current_document_ = absl::nullopt;
       break;
     }
@@ -94,7 +109,7 @@ StatusOr<absl::optional<LoadBundleTaskProgress>> BundleLoader::AddElement(
   HARD_ASSERT(element_ptr->element_type() != BundleElement::Type::Metadata,
               "Unexpected bundle metadata element.");
 
-  auto before_count = documents_.size();
+  auto before_count = loaded_documents();
 
   auto result = AddElementInternal(*element_ptr);
   if (!result.ok()) {
@@ -102,14 +117,18 @@ StatusOr<absl::optional<LoadBundleTaskProgress>> BundleLoader::AddElement(
   }
 
   bytes_loaded_ += byte_size;
+  absl::optional<DocumentKey> document_key = DocumentKeyOf(*element_ptr);
+  if (document_key) {
+    document_sizes_[*document_key] += byte_size;
+  }
 
   // Document has only been partially loaded, no progress to report.
-  if (before_count == documents_.size()) {
+  if (before_count == loaded_documents()) {
     return {absl::nullopt};
   }
 
   LoadBundleTaskProgress progress{
-      documents_.size(), metadata_.total_documents(), bytes_loaded_,
+      loaded_documents(), metadata_.total_documents(), bytes_loaded_,
       metadata_.total_bytes(), LoadBundleTaskState::kInProgress};
   return {absl::make_optional(std::move(progress))};
 }
@@ -121,14 +140,45 @@ StatusOr<MaybeDocumentMap> BundleLoader::ApplyChanges() {
                "Bundled documents end with a document metadata "
                "element instead of a document."));
   }
-  if (metadata_.total_documents() != documents_.size()) {
+  if (metadata_.total_documents() != loaded_documents()) {
     return StatusOr<MaybeDocumentMap>(
         Status(Error::kErrorInvalidArgument,
                "Loaded documents count is not the same as in metadata."));
   }
 
-  auto changes =
-      callback_->ApplyBundledDocuments(documents_, metadata_.bundle_id());
+  callback_->StartBundledDocuments(metadata_.bundle_id());
+
+  MaybeDocumentMap changes;
+  MaybeDocumentMap chunk;
+  uint64_t chunk_bytes = 0;
+  auto apply_chunk = [&] {
+    MaybeDocumentMap chunk_changes =
+        callback_->ApplyBundledDocuments(chunk, metadata_.bundle_id());
+    for (const auto& entry : chunk_changes) {
+      changes = changes.insert(entry.first, entry.second);
+    }
+    chunk = MaybeDocumentMap{};
+    chunk_bytes = 0;
+  };
+
+  for (const auto& entry : documents_) {
+    uint64_t document_bytes = document_sizes_[entry.first];
+    if (!chunk.empty() && chunk_bytes + document_bytes > max_chunk_bytes_) {
+      apply_chunk();
+    }
+    chunk = chunk.insert(entry.first, entry.second);
+    chunk_bytes += document_bytes;
+    if (chunk.size() >= max_chunk_documents_) {
+      apply_chunk();
+    }
+  }
+  if (!chunk.empty()) {
+    apply_chunk();
+  }
+  if (!skipped_documents_.empty()) {
+    callback_->RetainBundledDocuments(skipped_documents_,
+                                      metadata_.bundle_id());
+  }
   auto query_document_map = GetQueryDocumentMapping();
   for (const auto& named_query : queries_) {
     const auto& matching_keys = query_document_map[named_query.query_name()];
@@ -140,6 +190,18 @@ StatusOr<MaybeDocumentMap> BundleLoader::ApplyChanges() {
   return changes;
 }
 
+absl::optional<DocumentKey> BundleLoader::DocumentKeyOf(
+    const BundleElement& element) {
+  switch (element.element_type()) {
+    case BundleElement::Type::DocumentMetadata:
+      return static_cast<const BundledDocumentMetadata&>(element).key();
+    case BundleElement::Type::Document:
+      return static_cast<const BundleDocument&>(element).key();
+    default:
+      return absl::nullopt;
+  }
+}
+
 std::unordered_map<std::string, DocumentKeySet>
 BundleLoader::GetQueryDocumentMapping() {
   std::unordered_map<std::string, DocumentKeySet> result;
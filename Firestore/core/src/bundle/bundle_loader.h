@@ -16,6 +16,7 @@
 #ifndef FIRESTORE_CORE_SRC_BUNDLE_BUNDLE_LOADER_H_
 #define FIRESTORE_CORE_SRC_BUNDLE_BUNDLE_LOADER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -28,6 +29,7 @@
 #include "Firestore/core/src/bundle/bundle_element.h"
 #include "Firestore/core/src/bundle/bundled_document_metadata.h"
 #include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/document_map.h"
 #include "Firestore/core/src/util/statusor.h"
 #include "absl/types/optional.h"
@@ -54,10 +56,34 @@ class BundleLoader {
   using AddElementResult =
       util::StatusOr<absl::optional<api::LoadBundleTaskProgress>>;
 
+  /**
+   * The default maximum number of documents applied to local store in one
+   * transaction.
+   */
+  static constexpr size_t kDefaultMaxChunkDocuments = 1000;
+
+  /**
+   * The default maximum number of bundle bytes whose documents are applied to
+   * local store in one transaction.
+   */
+  static constexpr uint64_t kDefaultMaxChunkBytes = 4 * 1024 * 1024;
+
   BundleLoader(BundleCallback* callback, BundleMetadata metadata)
       : callback_(callback), metadata_(std::move(metadata)) {
   }
 
+  /**
+   * Sets how many documents `ApplyChanges()` applies per transaction. Chunks
+   * are cut at `max_documents` documents, or before they would exceed
+   * `max_bytes`; a single document larger than `max_bytes` gets a chunk of its
+   * own.
+   */
+  void SetChunkLimits(size_t max_documents, uint64_t max_bytes);
+
+  const BundleMetadata& metadata() const {
+    return metadata_;
+  }
+
   /**
    * Adds an element from the bundle to the loader.
    *
@@ -71,6 +97,10 @@ class BundleLoader {
   /**
    * Applies the loaded documents and queries to local store. Returns the
    * document view changes. If an error occurred, returns a not `ok()` status.
+   *
+   * Documents are applied in chunks, each in its own transaction, to bound the
+   * size of the transactions; see `SetChunkLimits()`. The returned changes
+   * cover all chunks, so that views are only recomputed once.
    */
   util::StatusOr<model::MaybeDocumentMap> ApplyChanges();
 
@@ -88,6 +118,15 @@ class BundleLoader {
    */
   util::Status AddElementInternal(const BundleElement& element);
 
+  /** Returns the number of documents loaded so far, including skipped ones. */
+  uint32_t loaded_documents() const {
+    return documents_.size() + skipped_documents_.size();
+  }
+
+  /** Returns the key of the document the given element belongs to, if any. */
+  static absl::optional<model::DocumentKey> DocumentKeyOf(
+      const BundleElement& element);
+
   BundleCallback* callback_ = nullptr;
   BundleMetadata metadata_;
   std::vector<NamedQuery> queries_;
@@ -96,6 +135,18 @@ class BundleLoader {
                      model::DocumentKeyHash>
       documents_metadata_;
   model::MaybeDocumentMap documents_;
+  /**
+   * The documents whose fields were skipped, because the local cache already
+   * had the same or a newer version of them. They count as loaded, but are
+   * only retained, not applied.
+   */
+  model::DocumentKeySet skipped_documents_;
+  /** The bundle bytes of each document, including its metadata. */
+  std::unordered_map<model::DocumentKey, uint64_t, model::DocumentKeyHash>
+      document_sizes_;
+
+  size_t max_chunk_documents_ = kDefaultMaxChunkDocuments;
+  uint64_t max_chunk_bytes_ = kDefaultMaxChunkBytes;
 
   uint64_t bytes_loaded_ = 0;
   absl::optional<model::DocumentKey> current_document_;
@@ -28,10 +28,23 @@ namespace bundle {
 
 using nlohmann::json;
 using util::ByteStream;
+using util::StatusOr;
 using util::StreamReadResult;
 
 namespace {
 
+/** The size of the first read of an element. */
+constexpr size_t kInitialReadChunkSize = 4 * 1024;
+
+/** The largest read of an element. */
+constexpr size_t kMaxReadChunkSize = 1024 * 1024;
+
+/**
+ * The longest varint length prefix of binary bundle elements; 10 bytes encode
+ * any 64-bit value.
+ */
+constexpr size_t kMaxVarintSize = 10;
+
 json Parse(absl::string_view s) {
   return json::parse(s.begin(), s.end(), /*callback=*/nullptr,
                      /*allow_exception=*/false);
@@ -68,32 +81,121 @@ std::unique_ptr<BundleElement> BundleReader::GetNextElement() {
 }
 
 std::unique_ptr<BundleElement> BundleReader::ReadNextElement() {
-  auto length_prefix = ReadLengthPrefix();
-  if (!length_prefix.has_value()) {
+  if (!ReadNextElementToBuffer()) {
     return nullptr;
   }
 
+  auto result = DecodeElement(serializer_, format_, json_reader_, buffer_);
+  reader_status_.Update(json_reader_.status());
+
+  return result;
+}
+
+absl::optional<std::string> BundleReader::GetNextEncodedElement() {
+  GetBundleMetadata();
+  if (!reader_status_.ok() || !ReadNextElementToBuffer()) {
+    return absl::nullopt;
+  }
+
+  std::string result;
+  result.swap(buffer_);
+  return result;
+}
+
+bool BundleReader::ReadNextElementToBuffer() {
+  if (!format_detected_ && !DetectFormat()) {
+    return false;
+  }
+
+  auto length_prefix = format_ == BundleFormat::kBinary ? ReadVarintPrefix()
+                                                        : ReadLengthPrefix();
+  if (!length_prefix.has_value()) {
+    return false;
+  }
+
   size_t prefix_value = 0;
-  auto ok = absl::SimpleAtoi<size_t>(length_prefix.value(), &prefix_value);
-  if (!ok) {
-    Fail("Prefix string is not a valid number");
-    return nullptr;
+  if (format_ == BundleFormat::kBinary) {
+    uint64_t varint = 0;
+    for (size_t i = 0; i < length_prefix->size(); ++i) {
+      varint |= static_cast<uint64_t>((*length_prefix)[i] & 0x7F) << (7 * i);
+    }
+    prefix_value = static_cast<size_t>(varint);
+  } else {
+    auto ok = absl::SimpleAtoi<size_t>(length_prefix.value(), &prefix_value);
+    if (!ok) {
+      Fail("Prefix string is not a valid number");
+      return false;
+    }
   }
 
   buffer_.clear();
-  ReadJsonToBuffer(prefix_value);
+  ReadElementToBuffer(prefix_value);
   if (!reader_status_.ok()) {
-    return nullptr;
+    return false;
   }
 
+  position_ += length_prefix.value().size() + buffer_.size();
   // metadata's size does not count in `bytes_read_`.
   if (metadata_loaded_) {
     bytes_read_ += length_prefix.value().size() + buffer_.size();
   }
-  auto result = DecodeBundleElementFromBuffer();
-  reader_status_.Update(json_reader_.status());
+  return true;
+}
 
-  return result;
+bool BundleReader::DetectFormat() {
+  StreamReadResult first = input_->Read(1);
+  if (!first.ok()) {
+    reader_status_.Update(first.status());
+    return false;
+  }
+  if (first.ValueOrDie().empty()) {
+    return false;
+  }
+
+  format_detected_ = true;
+  if (first.ValueOrDie()[0] != kBinaryBundleMagic[0]) {
+    // JSON bundles start with the length prefix of their first element.
+    format_ = BundleFormat::kJson;
+    detected_prefix_ = std::move(first).ValueOrDie();
+    return true;
+  }
+
+  StreamReadResult rest = input_->Read(kBinaryBundleMagic.size() - 1);
+  if (!rest.ok()) {
+    reader_status_.Update(rest.status());
+    return false;
+  }
+  if (rest.ValueOrDie() != kBinaryBundleMagic.substr(1)) {
+    Fail("Unrecognized bundle format");
+    return false;
+  }
+
+  format_ = BundleFormat::kBinary;
+  position_ += kBinaryBundleMagic.size();
+  return true;
+}
+
+absl::optional<std::string> BundleReader::ReadVarintPrefix() {
+  std::string prefix;
+  while (prefix.empty() || (prefix.back() & 0x80) != 0) {
+    if (prefix.size() == kMaxVarintSize) {
+      Fail("Length prefix is not a valid varint");
+      return absl::nullopt;
+    }
+
+    StatusOr<size_t> read = input_->ReadAppend(1, &prefix);
+    if (!read.ok()) {
+      reader_status_.Update(read.status());
+      return absl::nullopt;
+    }
+    if (read.ValueOrDie() == 0) {
+      if (!prefix.empty()) {
+        Fail("Bundle ends in the middle of a length prefix");
+      }
+      return absl::nullopt;
+    }
+  }
+  return prefix;
 }
 
 absl::optional<std::string> BundleReader::ReadLengthPrefix() {
@@ -105,33 +207,39 @@ absl::optional<std::string> BundleReader::ReadLengthPrefix() {
     return absl::nullopt;
   }
 
+  std::string prefix = std::move(detected_prefix_);
+  detected_prefix_.clear();
+  prefix.append(result.ValueOrDie());
+
   // Underlying stream is closed, and there happens to be no more data to
   // process.
-  if (result.eof() && result.ValueOrDie().empty()) {
+  if (result.eof() && prefix.empty()) {
     return absl::nullopt;
   }
 
-  return absl::make_optional(std::move(result).ValueOrDie());
+  return absl::make_optional(std::move(prefix));
 }
 
-void BundleReader::ReadJsonToBuffer(size_t required_size) {
+void BundleReader::ReadElementToBuffer(size_t required_size) {
   if (!reader_status_.ok()) {
     return;
   }
+  // Start with small reads and grow them geometrically as data arrives, so
+  // that a corrupt length prefix leading to a large `required_size` can't make
+  // us allocate a huge buffer up front, while large elements still take only a
+  // few reads.
+  size_t chunk_size = kInitialReadChunkSize;
   while (buffer_.size() < required_size) {
-    // Read at most 1024 bytes every time, to avoid allocating a huge buffer
-    // when corruption leads to large `required_size`.
-    auto size = std::min<size_t>(1024ul, required_size - buffer_.size());
-    StreamReadResult result = input_->Read(size);
-    if (!result.ok()) {
-      reader_status_.Update(result.status());
+    size_t size = std::min(chunk_size, required_size - buffer_.size());
+    StatusOr<size_t> read = input_->ReadAppend(size, &buffer_);
+    if (!read.ok()) {
+      reader_status_.Update(read.status());
       return;
     }
-    bool eof = result.eof();
-    buffer_.append(std::move(result).ValueOrDie());
-    if (eof) {
+    if (read.ValueOrDie() == 0) {
       break;
     }
+    chunk_size = std::min(chunk_size * 2, kMaxReadChunkSize);
   }
 
   if (buffer_.size() < required_size) {
@@ -139,29 +247,48 @@ void BundleReader::ReadJsonToBuffer(size_t required_size) {
   }
 }
 
-std::unique_ptr<BundleElement> BundleReader::DecodeBundleElementFromBuffer() {
-  auto json_object = Parse(buffer_);
+std::unique_ptr<BundleElement> BundleReader::DecodeElement(
+    const BundleSerializer& serializer,
+    BundleFormat format,
+    JsonReader& context,
+    absl::string_view element) {
+  if (format == BundleFormat::kBinary) {
+    return serializer.DecodeBinaryElement(context, element);
+  }
+
+  // Documents make up the bulk of bundles, so they are decoded without
+  // building a JSON tree first.
+  absl::optional<BundleDocument> document =
+      serializer.DecodeDocumentElement(context, element);
+  if (document) {
+    return absl::make_unique<BundleDocument>(std::move(*document));
+  }
+  if (!context.ok()) {
+    return nullptr;
+  }
+
+  auto json_object = Parse(element);
   if (json_object.is_discarded()) {
-    Fail("Failed to parse string into json");
+    context.Fail("Failed to parse string into json");
     return nullptr;
   }
 
   if (json_object.contains("metadata")) {
-    return absl::make_unique<BundleMetadata>(serializer_.DecodeBundleMetadata(
-        json_reader_, json_object.at("metadata")));
+    return absl::make_unique<BundleMetadata>(serializer.DecodeBundleMetadata(
+        context, json_object.at("metadata")));
   } else if (json_object.contains("namedQuery")) {
-    auto q = serializer_.DecodeNamedQuery(json_reader_,
-                                          json_object.at("namedQuery"));
+    auto q =
+        serializer.DecodeNamedQuery(context, json_object.at("namedQuery"));
     return absl::make_unique<NamedQuery>(std::move(q));
   } else if (json_object.contains("documentMetadata")) {
     return absl::make_unique<BundledDocumentMetadata>(
-        serializer_.DecodeDocumentMetadata(json_reader_,
-                                           json_object.at("documentMetadata")));
+        serializer.DecodeDocumentMetadata(context,
+                                          json_object.at("documentMetadata")));
   } else if (json_object.contains("document")) {
     return absl::make_unique<BundleDocument>(
-        serializer_.DecodeDocument(json_reader_, json_object.at("document")));
+        serializer.DecodeDocument(context, json_object.at("document")));
   } else {
-    Fail("Unrecognized BundleElement");
+    context.Fail("Unrecognized BundleElement");
     return nullptr;
   }
 }
@@ -24,14 +24,39 @@
 #include "Firestore/core/src/bundle/bundle_metadata.h"
 #include "Firestore/core/src/bundle/bundle_serializer.h"
 #include "Firestore/core/src/util/byte_stream.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
 namespace bundle {
 
+/** The encodings of bundle streams understood by `BundleReader`. */
+enum class BundleFormat {
+  /**
+   * Elements are JSON objects, each prefixed with its length in bytes as a
+   * decimal string.
+   */
+  kJson,
+
+  /**
+   * The stream starts with `kBinaryBundleMagic`, and is followed by serialized
+   * `firestore.BundleElement` messages, each prefixed with its length in bytes
+   * as a varint (like protobuf's delimited message streams).
+   */
+  kBinary,
+};
+
+/**
+ * The bytes binary bundles start with. The first byte isn't valid ASCII, so it
+ * can never start a JSON bundle.
+ */
+constexpr absl::string_view kBinaryBundleMagic{"\x89" "FSB", 4};
+
 /**
- * Reads the length-prefixed JSON stream for Bundles.
+ * Reads the length-prefixed stream for Bundles, in either of the formats
+ * described by `BundleFormat`. The format is detected from the first bytes of
+ * the stream.
  *
  * The class takes a bundle stream and presents abstractions to read bundled
  * elements out of the underlying content.
@@ -59,6 +84,37 @@ class BundleReader {
    */
   std::unique_ptr<BundleElement> GetNextElement();
 
+  /**
+   * Like `GetNextElement`, but returns the encoding of the next element, in
+   * `format()`, without decoding it, so that callers can decode elements
+   * elsewhere, e.g. in parallel, with `DecodeElement`. Returns nullopt when
+   * there is no more element to return or reading failed.
+   */
+  absl::optional<std::string> GetNextEncodedElement();
+
+  /**
+   * Decodes a bundle element encoded in the given format, failing `context` if
+   * it's invalid. Doesn't depend on any reader state, so different elements
+   * can be decoded concurrently, each with its own `context`.
+   */
+  static std::unique_ptr<BundleElement> DecodeElement(
+      const BundleSerializer& serializer,
+      BundleFormat format,
+      JsonReader& context,
+      absl::string_view element);
+
+  const BundleSerializer& serializer() const {
+    return serializer_;
+  }
+
+  /**
+   * The format of the bundle. Only meaningful once the metadata has been read
+   * with `GetBundleMetadata()`.
+   */
+  BundleFormat format() const {
+    return format_;
+  }
+
   /** Returns whether this instance is in good state. */
   const util::Status& reader_status() const {
     return reader_status_;
@@ -74,11 +130,19 @@ class BundleReader {
     return bytes_read_;
   }
 
+  /**
+   * The offset in the bundle stream at which the next element starts. Unlike
+   * `bytes_read()`, this counts the metadata element.
+   */
+  int64_t position() const {
+    return position_;
+  }
+
  private:
   /**
    * Reads from the head of internal buffer, pulls more data from underlying
    * stream until a complete element is found (including the prefixed length and
-   * the JSON string).
+   * the encoded element).
    *
    * Once a complete element is read, it is dropped from internal buffer.
    *
@@ -87,6 +151,24 @@ class BundleReader {
    */
   std::unique_ptr<BundleElement> ReadNextElement();
 
+  /**
+   * Reads the next complete element into `buffer_`. Returns false at the end
+   * of the stream or if reading failed.
+   */
+  bool ReadNextElementToBuffer();
+
+  /**
+   * Detects the format of the bundle from its first bytes. Returns false if
+   * the stream is empty or reading failed.
+   */
+  bool DetectFormat();
+
+  /**
+   * Reads the varint length prefix of a binary bundle element. Returns
+   * `nullopt` when at the end of stream or if reading failed.
+   */
+  absl::optional<std::string> ReadVarintPrefix();
+
   /**
    * Reads the length prefix string from bundle stream. Returns `nullopt` when
    * at the end of stream.
@@ -100,15 +182,7 @@ class BundleReader {
   /**
    * Reads `length` number of chars from stream into internal `buffer_`.
    */
-  void ReadJsonToBuffer(size_t length);
-
-  /**
-   * Decodes internal `buffer_` into a `BundleElement`, returned as a unique_ptr
-   * pointing to the element. Returns nullptr if fails.
-   *
-   * Note this method will leave `buffer_` unchanged.
-   */
-  std::unique_ptr<BundleElement> DecodeBundleElementFromBuffer();
+  void ReadElementToBuffer(size_t length);
 
   BundleSerializer serializer_;
   JsonReader json_reader_;
@@ -116,6 +190,13 @@ class BundleReader {
   // Input stream holding bundle data.
   std::unique_ptr<util::ByteStream> input_;
 
+  BundleFormat format_ = BundleFormat::kJson;
+  bool format_detected_ = false;
+
+  // Bytes consumed while detecting the format that belong to the first length
+  // prefix of a JSON bundle.
+  std::string detected_prefix_;
+
   // Cached bundle metadata.
   BundleMetadata metadata_;
   bool metadata_loaded_ = false;
@@ -125,6 +206,7 @@ class BundleReader {
 
   util::Status reader_status_;
   int64_t bytes_read_ = 0;
+  int64_t position_ = 0;
 };
 
 }  // namespace bundle
@@ -17,6 +17,8 @@
 #include "Firestore/core/src/bundle/bundle_serializer.h"
 
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "Firestore/core/src/core/bound.h"
@@ -31,9 +33,13 @@
 #include "Firestore/core/src/model/field_value.h"
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/nanopb/byte_string.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/nanopb/reader.h"
 #include "Firestore/core/src/timestamp_internal.h"
+#include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/statusor.h"
 #include "Firestore/core/src/util/string_util.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/numbers.h"
 #include "absl/time/time.h"
@@ -699,7 +705,7 @@ FieldValue BundleSerializer::DecodeMapValue(JsonReader& reader,
     return {};
   }
 
-  immutable::SortedMap<std::string, FieldValue> field_values;
+  FieldValue::Map field_values;
   for (auto it = fields.begin(); it != fields.end(); ++it) {
     field_values =
         field_values.insert(it.key(), DecodeValue(reader, it.value()));
@@ -783,6 +789,595 @@ BundleDocument BundleSerializer::DecodeDocument(JsonReader& reader,
                                  model::DocumentState::kSynced));
 }
 
+// Mark: Binary bundle elements
+
+std::unique_ptr<BundleElement> BundleSerializer::DecodeBinaryElement(
+    JsonReader& context, absl::string_view element) const {
+  nanopb::StringReader reader(element);
+  auto proto = nanopb::Message<firestore_BundleElement>::TryParse(&reader);
+  if (!reader.ok()) {
+    context.Fail("Failed to parse bundle element: " +
+                 reader.status().error_message());
+    return nullptr;
+  }
+
+  std::unique_ptr<BundleElement> result;
+  switch (proto->which_element_type) {
+    case firestore_BundleElement_metadata_tag:
+      result = absl::make_unique<BundleMetadata>(
+          DecodeBundleMetadata(&context, proto->metadata));
+      break;
+    case firestore_BundleElement_named_query_tag:
+      result = absl::make_unique<NamedQuery>(
+          DecodeNamedQuery(&context, proto->named_query));
+      break;
+    case firestore_BundleElement_document_metadata_tag:
+      result = absl::make_unique<BundledDocumentMetadata>(
+          DecodeDocumentMetadata(&context, proto->document_metadata));
+      break;
+    case firestore_BundleElement_document_tag:
+      result = absl::make_unique<BundleDocument>(
+          DecodeDocument(&context, proto->document));
+      break;
+    default:
+      context.Fail("Unrecognized BundleElement");
+      return nullptr;
+  }
+
+  if (!context.ok()) return nullptr;
+  return result;
+}
+
+BundleMetadata BundleSerializer::DecodeBundleMetadata(
+    ReadContext* context, const firestore_BundleMetadata& proto) const {
+  return BundleMetadata(remote::Serializer::DecodeString(proto.id),
+                        proto.version,
+                        remote::Serializer::DecodeVersion(context,
+                                                          proto.create_time),
+                        proto.total_documents, proto.total_bytes);
+}
+
+NamedQuery BundleSerializer::DecodeNamedQuery(
+    ReadContext* context, const firestore_NamedQuery& proto) const {
+  const firestore_BundledQuery& query = proto.bundled_query;
+  // The QueryTarget oneof only has a single valid value.
+  if (query.which_query_type != firestore_BundledQuery_structured_query_tag) {
+    context->Fail("Bundled query is not a structured query");
+    return {};
+  }
+
+  Target target = rpc_serializer_.DecodeStructuredQuery(
+      context, query.parent, query.structured_query);
+  LimitType limit_type =
+      query.limit_type == firestore_BundledQuery_LimitType_FIRST
+          ? LimitType::First
+          : LimitType::Last;
+  return NamedQuery(remote::Serializer::DecodeString(proto.name),
+                    BundledQuery(std::move(target), limit_type),
+                    remote::Serializer::DecodeVersion(context,
+                                                      proto.read_time));
+}
+
+BundledDocumentMetadata BundleSerializer::DecodeDocumentMetadata(
+    ReadContext* context,
+    const firestore_BundledDocumentMetadata& proto) const {
+  DocumentKey key = rpc_serializer_.DecodeKey(context, proto.name);
+  SnapshotVersion read_time =
+      remote::Serializer::DecodeVersion(context, proto.read_time);
+
+  std::vector<std::string> queries;
+  queries.reserve(proto.queries_count);
+  for (pb_size_t i = 0; i < proto.queries_count; ++i) {
+    queries.push_back(remote::Serializer::DecodeString(proto.queries[i]));
+  }
+
+  return BundledDocumentMetadata(std::move(key), read_time, proto.exists,
+                                 std::move(queries));
+}
+
+BundleDocument BundleSerializer::DecodeDocument(
+    ReadContext* context, const google_firestore_v1_Document& proto) const {
+  DocumentKey key = rpc_serializer_.DecodeKey(context, proto.name);
+  ObjectValue value =
+      rpc_serializer_.DecodeFields(context, proto.fields_count, proto.fields);
+  SnapshotVersion update_time =
+      remote::Serializer::DecodeVersion(context, proto.update_time);
+
+  return BundleDocument(Document(std::move(value), std::move(key), update_time,
+                                 model::DocumentState::kSynced));
+}
+
+// Mark: StreamingDocumentDecoder
+
+/**
+ * Decodes a document element from nlohmann::json SAX events, keeping only a
+ * stack of partially decoded values instead of a JSON tree.
+ *
+ * Every JSON object or array being read has a frame on the stack. When a
+ * frame's container ends, its decoded value is handed to the frame below it.
+ * Containers the decoder doesn't care about are skipped with a single frame
+ * that counts their nesting depth.
+ */
+class BundleSerializer::StreamingDocumentDecoder {
+ public:
+  StreamingDocumentDecoder(const BundleSerializer& serializer,
+                           JsonReader& reader,
+                           bool skip_fields = false)
+      : serializer_(serializer), reader_(reader), skip_fields_(skip_fields) {
+  }
+
+  absl::optional<BundleDocument> Decode(absl::string_view element) {
+    bool parsed = json::sax_parse(element.begin(), element.end(), this);
+    if (not_document_) {
+      return absl::nullopt;
+    }
+    if (!parsed || !reader_.ok()) {
+      return BundleDocument();
+    }
+
+    if (!path_) {
+      reader_.Fail("Missing child 'name'");
+    } else if (!update_time_) {
+      reader_.Fail("Missing child 'updateTime'");
+    } else if (!fields_ && !skip_fields_) {
+      reader_.Fail("mapValue is not a valid map");
+    }
+    if (!reader_.ok()) {
+      return BundleDocument();
+    }
+
+    if (skip_fields_) {
+      return BundleDocument(
+          Document(ObjectValue{}, DocumentKey(std::move(*path_)),
+                   *update_time_, model::DocumentState::kSynced),
+          /*fields_skipped=*/true);
+    }
+    return BundleDocument(
+        Document(ObjectValue::FromMap(fields_->object_value()),
+                 DocumentKey(std::move(*path_)), *update_time_,
+                 model::DocumentState::kSynced));
+  }
+
+  // nlohmann::json SAX interface.
+
+  bool null() {
+    return Scalar(json(nullptr));
+  }
+
+  bool boolean(bool value) {
+    return Scalar(json(value));
+  }
+
+  bool number_integer(json::number_integer_t value) {
+    return Scalar(json(value));
+  }
+
+  bool number_unsigned(json::number_unsigned_t value) {
+    return Scalar(json(value));
+  }
+
+  bool number_float(json::number_float_t value, const std::string&) {
+    return Scalar(json(value));
+  }
+
+  bool string(std::string& value) {
+    return Scalar(json(std::move(value)));
+  }
+
+  bool binary(json::binary_t&) {
+    // Only produced by binary formats, never by JSON text.
+    return Fail("Unexpected binary value");
+  }
+
+  bool key(std::string& key) {
+    Frame& top = stack_.back();
+    if (top.type == FrameType::kSkip) {
+      return true;
+    }
+    if (top.type == FrameType::kElement && key != "document") {
+      return NotDocument();
+    }
+    top.key = std::move(key);
+    return true;
+  }
+
+  bool start_object(std::size_t) {
+    if (stack_.empty()) {
+      return Push(FrameType::kElement);
+    }
+
+    Frame& top = stack_.back();
+    switch (top.type) {
+      case FrameType::kSkip:
+        ++top.depth;
+        return true;
+      case FrameType::kElement:
+        return Push(FrameType::kDocument);
+      case FrameType::kDocument:
+        if (top.key == "fields") {
+          return Push(skip_fields_ ? FrameType::kSkip : FrameType::kFields);
+        }
+        if (top.key == "updateTime") return Push(FrameType::kTimestamp);
+        return Push(FrameType::kSkip);
+      case FrameType::kFields:
+      case FrameType::kValues:
+        return Push(FrameType::kValue);
+      case FrameType::kValue:
+        if (top.key == "mapValue") return Push(FrameType::kMapValue);
+        if (top.key == "arrayValue") return Push(FrameType::kArrayValue);
+        if (top.key == "geoPointValue") return Push(FrameType::kGeoPoint);
+        if (top.key == "timestampValue") return Push(FrameType::kTimestamp);
+        if (IsScalarValueType(top.key)) return FailInvalidValue(top.key);
+        return Push(FrameType::kSkip);
+      case FrameType::kMapValue:
+        if (top.key == "fields") return Push(FrameType::kFields);
+        return Push(FrameType::kSkip);
+      case FrameType::kArrayValue:
+        if (top.key == "values") {
+          return Fail("'values' is missing or is not an array");
+        }
+        return Push(FrameType::kSkip);
+      case FrameType::kGeoPoint:
+      case FrameType::kTimestamp:
+        if (IsComponent(top)) return FailInvalidValue(top.key);
+        return Push(FrameType::kSkip);
+    }
+    UNREACHABLE();
+  }
+
+  bool end_object() {
+    Frame& top = stack_.back();
+    if (top.type == FrameType::kSkip && top.depth > 0) {
+      --top.depth;
+      return true;
+    }
+
+    Frame frame = std::move(top);
+    stack_.pop_back();
+    switch (frame.type) {
+      case FrameType::kSkip:
+      case FrameType::kElement:
+      case FrameType::kDocument:
+        return true;
+      case FrameType::kFields:
+        return Deliver(FieldValue::FromMap(std::move(frame.fields)));
+      case FrameType::kValue:
+        if (!frame.value) {
+          return Fail("Failed to decode value, no type is recognized");
+        }
+        return Deliver(std::move(*frame.value));
+      case FrameType::kMapValue:
+        if (!frame.value) return Fail("mapValue is not a valid map");
+        return Deliver(std::move(*frame.value));
+      case FrameType::kArrayValue:
+        if (!frame.value) return Fail("'values' is missing or is not an array");
+        return Deliver(std::move(*frame.value));
+      case FrameType::kGeoPoint:
+        return Deliver(FieldValue::FromGeoPoint(
+            GeoPoint(frame.latitude, frame.longitude)));
+      case FrameType::kTimestamp:
+        return DeliverTimestamp(frame);
+      case FrameType::kValues:
+        break;
+    }
+    HARD_FAIL("Unbalanced end of JSON object");
+  }
+
+  bool start_array(std::size_t) {
+    if (stack_.empty()) {
+      return NotDocument();
+    }
+
+    Frame& top = stack_.back();
+    switch (top.type) {
+      case FrameType::kSkip:
+        ++top.depth;
+        return true;
+      case FrameType::kElement:
+        return NotDocument();
+      case FrameType::kDocument:
+      case FrameType::kMapValue:
+        if (top.key == "fields") {
+          return Fail("mapValue's 'field' is not a valid map");
+        }
+        if (top.type == FrameType::kDocument && top.key == "updateTime") {
+          return FailInvalidValue(top.key);
+        }
+        return Push(FrameType::kSkip);
+      case FrameType::kFields:
+      case FrameType::kValues:
+        return Fail("'value' is not encoded as JSON object");
+      case FrameType::kValue:
+        if (IsValueType(top.key)) return FailInvalidValue(top.key);
+        return Push(FrameType::kSkip);
+      case FrameType::kArrayValue:
+        if (top.key == "values") return Push(FrameType::kValues);
+        return Push(FrameType::kSkip);
+      case FrameType::kGeoPoint:
+      case FrameType::kTimestamp:
+        if (IsComponent(top)) return FailInvalidValue(top.key);
+        return Push(FrameType::kSkip);
+    }
+    UNREACHABLE();
+  }
+
+  bool end_array() {
+    Frame& top = stack_.back();
+    if (top.type == FrameType::kSkip && top.depth > 0) {
+      --top.depth;
+      return true;
+    }
+
+    Frame frame = std::move(top);
+    stack_.pop_back();
+    if (frame.type == FrameType::kSkip) {
+      return true;
+    }
+    HARD_ASSERT(frame.type == FrameType::kValues,
+                "Unbalanced end of JSON array");
+    return Deliver(FieldValue::FromArray(std::move(frame.values)));
+  }
+
+  bool parse_error(std::size_t,
+                   const std::string&,
+                   const nlohmann::detail::exception&) {
+    return Fail("Failed to parse string into json");
+  }
+
+ private:
+  enum class FrameType {
+    /** The element object, `{"document": ...}`. */
+    kElement,
+    /** The document object. */
+    kDocument,
+    /** The `fields` object of a document or map value. */
+    kFields,
+    /** An encoded value, e.g. `{"stringValue": ...}`. */
+    kValue,
+    /** The object of a `mapValue`. */
+    kMapValue,
+    /** The object of an `arrayValue`. */
+    kArrayValue,
+    /** The `values` array of an `arrayValue`. */
+    kValues,
+    /** The object of a `geoPointValue`. */
+    kGeoPoint,
+    /** A timestamp encoded as an object with seconds and nanos. */
+    kTimestamp,
+    /** A container whose contents are ignored. */
+    kSkip,
+  };
+
+  struct Frame {
+    explicit Frame(FrameType type) : type(type) {
+    }
+
+    FrameType type;
+
+    /** The most recently read key, if this frame is an object. */
+    std::string key;
+
+    /** The decoded value of kValue, kMapValue and kArrayValue frames. */
+    absl::optional<FieldValue> value;
+
+    /** The fields read so far by a kFields frame. */
+    FieldValue::Map fields;
+
+    /** The values read so far by a kValues frame. */
+    std::vector<FieldValue> values;
+
+    double latitude = 0;
+    double longitude = 0;
+
+    absl::optional<int64_t> seconds;
+    absl::optional<int32_t> nanos;
+
+    /** The nesting depth of containers inside a kSkip frame. */
+    int depth = 0;
+  };
+
+  static bool IsScalarValueType(const std::string& key) {
+    return key == "nullValue" || key == "booleanValue" ||
+           key == "integerValue" || key == "doubleValue" ||
+           key == "stringValue" || key == "bytesValue" ||
+           key == "referenceValue";
+  }
+
+  static bool IsValueType(const std::string& key) {
+    return IsScalarValueType(key) || key == "mapValue" ||
+           key == "arrayValue" || key == "geoPointValue" ||
+           key == "timestampValue";
+  }
+
+  static bool IsComponent(const Frame& frame) {
+    if (frame.type == FrameType::kGeoPoint) {
+      return frame.key == "latitude" || frame.key == "longitude";
+    }
+    return frame.key == "seconds" || frame.key == "nanos";
+  }
+
+  bool Push(FrameType type) {
+    stack_.emplace_back(type);
+    return true;
+  }
+
+  bool Fail(const char* message) {
+    reader_.Fail(message);
+    return false;
+  }
+
+  bool FailInvalidValue(const std::string& key) {
+    reader_.Fail("'%s' is not encoded as a valid value", key);
+    return false;
+  }
+
+  bool NotDocument() {
+    not_document_ = true;
+    return false;
+  }
+
+  bool Scalar(json value) {
+    if (stack_.empty()) {
+      return NotDocument();
+    }
+
+    Frame& top = stack_.back();
+    switch (top.type) {
+      case FrameType::kSkip:
+        return true;
+      case FrameType::kElement:
+        return NotDocument();
+      case FrameType::kDocument:
+        if (top.key == "name") {
+          ResourcePath path = serializer_.DecodeName(reader_, value);
+          if (reader_.ok()) path_ = std::move(path);
+        } else if (top.key == "updateTime") {
+          update_time_ = DecodeSnapshotVersion(reader_, value);
+        } else if (top.key == "fields") {
+          return Fail("mapValue's 'field' is not a valid map");
+        }
+        return reader_.ok();
+      case FrameType::kFields:
+      case FrameType::kValues:
+        return Fail("'value' is not encoded as JSON object");
+      case FrameType::kValue:
+        if (IsValueType(top.key)) {
+          top.value = DecodeScalarValue(top.key, value);
+        }
+        return reader_.ok();
+      case FrameType::kMapValue:
+        if (top.key == "fields") return Fail("mapValue is not a valid map");
+        return true;
+      case FrameType::kArrayValue:
+        if (top.key == "values") {
+          return Fail("'values' is missing or is not an array");
+        }
+        return true;
+      case FrameType::kGeoPoint:
+        if (top.key == "latitude") {
+          top.latitude = reader_.DecodeDouble(value);
+        } else if (top.key == "longitude") {
+          top.longitude = reader_.DecodeDouble(value);
+        }
+        return reader_.ok();
+      case FrameType::kTimestamp:
+        if (top.key == "seconds") {
+          top.seconds = ParseInt<int64_t>(value, reader_);
+        } else if (top.key == "nanos") {
+          top.nanos = ParseInt<int32_t>(value, reader_);
+        }
+        return reader_.ok();
+    }
+    UNREACHABLE();
+  }
+
+  FieldValue DecodeScalarValue(const std::string& key, json& value) {
+    if (key == "nullValue") {
+      return FieldValue::Null();
+    } else if (key == "booleanValue") {
+      if (!value.is_boolean()) {
+        reader_.Fail("'booleanValue' is not encoded as a valid boolean");
+        return {};
+      }
+      return FieldValue::FromBoolean(value.get<bool>());
+    } else if (key == "integerValue") {
+      return FieldValue::FromInteger(ParseInt<int64_t>(value, reader_));
+    } else if (key == "doubleValue") {
+      if (!value.is_number() && !value.is_string()) {
+        reader_.Fail("'doubleValue' is missing or is not a double");
+        return {};
+      }
+      return FieldValue::FromDouble(reader_.DecodeDouble(value));
+    } else if (key == "timestampValue") {
+      return FieldValue::FromTimestamp(DecodeTimestamp(reader_, value));
+    }
+
+    if (!value.is_string()) {
+      FailInvalidValue(key);
+      return {};
+    }
+    std::string& string_value = value.get_ref<std::string&>();
+    if (key == "stringValue") {
+      return FieldValue::FromString(std::move(string_value));
+    } else if (key == "bytesValue") {
+      return DecodeBytesValue(reader_, string_value);
+    } else if (key == "referenceValue") {
+      return serializer_.DecodeReferenceValue(reader_, string_value);
+    }
+
+    // `mapValue`, `arrayValue` and `geoPointValue` must be objects.
+    FailInvalidValue(key);
+    return {};
+  }
+
+  /** Hands the value of a finished container to the frame below it. */
+  bool Deliver(FieldValue value) {
+    Frame& parent = stack_.back();
+    switch (parent.type) {
+      case FrameType::kDocument:
+        fields_ = std::move(value);
+        return true;
+      case FrameType::kFields:
+        parent.fields = parent.fields.insert(parent.key, std::move(value));
+        return true;
+      case FrameType::kValues:
+        parent.values.push_back(std::move(value));
+        return true;
+      case FrameType::kValue:
+      case FrameType::kMapValue:
+      case FrameType::kArrayValue:
+        parent.value = std::move(value);
+        return true;
+      default:
+        break;
+    }
+    HARD_FAIL("Unexpected value in JSON frame");
+  }
+
+  bool DeliverTimestamp(const Frame& frame) {
+    if (!frame.seconds) return Fail("'seconds' is missing or is not a double");
+    if (!frame.nanos) return Fail("'nanos' is missing or is not a double");
+
+    StatusOr<Timestamp> decoded =
+        TimestampInternal::FromUntrustedSecondsAndNanos(*frame.seconds,
+                                                        *frame.nanos);
+    if (!decoded.ok()) {
+      reader_.Fail(
+          "Failed to decode json into valid protobuf Timestamp with error '%s'",
+          decoded.status().error_message());
+      return false;
+    }
+
+    if (stack_.back().type == FrameType::kDocument) {
+      update_time_ = SnapshotVersion(decoded.ValueOrDie());
+      return true;
+    }
+    return Deliver(FieldValue::FromTimestamp(decoded.ValueOrDie()));
+  }
+
+  const BundleSerializer& serializer_;
+  JsonReader& reader_;
+  bool skip_fields_ = false;
+
+  std::vector<Frame> stack_;
+  bool not_document_ = false;
+
+  absl::optional<ResourcePath> path_;
+  absl::optional<SnapshotVersion> update_time_;
+  absl::optional<FieldValue> fields_;
+};
+
+absl::optional<BundleDocument> BundleSerializer::DecodeDocumentElement(
+    JsonReader& reader, absl::string_view element) const {
+  return StreamingDocumentDecoder(*this, reader).Decode(element);
+}
+
+absl::optional<BundleDocument> BundleSerializer::DecodeDocumentElementHeader(
+    JsonReader& reader, absl::string_view element) const {
+  return StreamingDocumentDecoder(*this, reader, /*skip_fields=*/true)
+      .Decode(element);
+}
+
 }  // namespace bundle
 }  // namespace firestore
 }  // namespace firebase
@@ -17,11 +17,14 @@
 #ifndef FIRESTORE_CORE_SRC_BUNDLE_BUNDLE_SERIALIZER_H_
 #define FIRESTORE_CORE_SRC_BUNDLE_BUNDLE_SERIALIZER_H_
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "Firestore/Protos/nanopb/firestore/bundle.nanopb.h"
 #include "Firestore/core/src/bundle/bundle_document.h"
+#include "Firestore/core/src/bundle/bundle_element.h"
 #include "Firestore/core/src/bundle/bundle_metadata.h"
 #include "Firestore/core/src/bundle/bundled_document_metadata.h"
 #include "Firestore/core/src/bundle/named_query.h"
@@ -31,6 +34,8 @@
 #include "Firestore/core/src/remote/serializer.h"
 #include "Firestore/core/src/util/read_context.h"
 #include "Firestore/third_party/nlohmann_json/json.hpp"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
@@ -83,7 +88,10 @@ class JsonReader : public util::ReadContext {
                            const nlohmann::json& json_object,
                            bool default_value = false);
 
- private:
+  /**
+   * Reads a number, or a string holding a number, into a double. Fails the
+   * reader if a string can't be parsed.
+   */
   double DecodeDouble(const nlohmann::json& value);
 };
 
@@ -105,7 +113,50 @@ class BundleSerializer {
   BundleDocument DecodeDocument(JsonReader& context,
                                 const nlohmann::json& document) const;
 
+  /**
+   * Decodes a document element, `{"document": {...}}`, directly from its JSON
+   * text, without building a JSON tree for it. This is considerably cheaper
+   * than parsing the element and calling `DecodeDocument` for bundles with
+   * many or large documents.
+   *
+   * Returns nullopt without failing `context` if `element` is not a document
+   * element. If decoding fails, `context` is failed and the returned document
+   * should be discarded.
+   */
+  absl::optional<BundleDocument> DecodeDocumentElement(
+      JsonReader& context, absl::string_view element) const;
+
+  /**
+   * Like `DecodeDocumentElement()`, but skips the fields of the document, so
+   * that only its key and version are decoded. The returned document has no
+   * fields and `fields_skipped()` set.
+   */
+  absl::optional<BundleDocument> DecodeDocumentElementHeader(
+      JsonReader& context, absl::string_view element) const;
+
+  /**
+   * Decodes a bundle element from its protocol buffer encoding, a serialized
+   * `firestore.BundleElement` message, as found in binary bundles.
+   *
+   * If decoding fails, `context` is failed and null is returned.
+   */
+  std::unique_ptr<BundleElement> DecodeBinaryElement(
+      JsonReader& context, absl::string_view element) const;
+
  private:
+  class StreamingDocumentDecoder;
+
+  BundleMetadata DecodeBundleMetadata(
+      util::ReadContext* context, const firestore_BundleMetadata& proto) const;
+  NamedQuery DecodeNamedQuery(util::ReadContext* context,
+                              const firestore_NamedQuery& proto) const;
+  BundledDocumentMetadata DecodeDocumentMetadata(
+      util::ReadContext* context,
+      const firestore_BundledDocumentMetadata& proto) const;
+  BundleDocument DecodeDocument(
+      util::ReadContext* context,
+      const google_firestore_v1_Document& proto) const;
+
   BundledQuery DecodeBundledQuery(JsonReader& context,
                                   const nlohmann::json& query) const;
   core::FilterList DecodeWhere(JsonReader& context,
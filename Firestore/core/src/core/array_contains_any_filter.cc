@@ -17,18 +17,16 @@
 #include "Firestore/core/src/core/array_contains_any_filter.h"
 
 #include <memory>
+#include <unordered_set>
 #include <utility>
 
-#include "Firestore/core/src/model/document.h"
-#include "absl/algorithm/container.h"
-
 namespace firebase {
 namespace firestore {
 namespace core {
 
-using model::Document;
 using model::FieldPath;
 using model::FieldValue;
+using model::FieldValueHash;
 
 using Operator = Filter::Operator;
 
@@ -36,14 +34,20 @@ class ArrayContainsAnyFilter::Rep : public FieldFilter::Rep {
  public:
   Rep(FieldPath field, FieldValue value)
       : FieldFilter::Rep(
-            std::move(field), Operator::ArrayContainsAny, std::move(value)) {
+            std::move(field), Operator::ArrayContainsAny, std::move(value)),
+        values_(this->value().array_value().begin(),
+                this->value().array_value().end()) {
   }
 
   Type type() const override {
     return Type::kArrayContainsAnyFilter;
   }
 
-  bool Matches(const model::Document& doc) const override;
+  bool MatchesValue(const FieldValue& lhs) const override;
+
+ private:
+  /** The elements of the filter's array value, for fast lookup. */
+  std::unordered_set<FieldValue, FieldValueHash> values_;
 };
 
 ArrayContainsAnyFilter::ArrayContainsAnyFilter(FieldPath field,
@@ -51,16 +55,11 @@ ArrayContainsAnyFilter::ArrayContainsAnyFilter(FieldPath field,
     : FieldFilter(std::make_shared<Rep>(std::move(field), std::move(value))) {
 }
 
-bool ArrayContainsAnyFilter::Rep::Matches(const Document& doc) const {
-  const FieldValue::Array& array_value = value().array_value();
-  absl::optional<FieldValue> maybe_lhs = doc.field(field());
-  if (!maybe_lhs) return false;
-
-  const FieldValue& lhs = *maybe_lhs;
+bool ArrayContainsAnyFilter::Rep::MatchesValue(const FieldValue& lhs) const {
   if (lhs.type() != FieldValue::Type::Array) return false;
 
   for (const auto& val : lhs.array_value()) {
-    if (absl::c_linear_search(array_value, val)) {
+    if (values_.count(val) > 0) {
       return true;
     }
   }
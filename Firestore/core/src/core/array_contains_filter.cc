@@ -19,14 +19,12 @@
 #include <memory>
 #include <utility>
 
-#include "Firestore/core/src/model/document.h"
 #include "absl/algorithm/container.h"
 
 namespace firebase {
 namespace firestore {
 namespace core {
 
-using model::Document;
 using model::FieldPath;
 using model::FieldValue;
 
@@ -43,7 +41,7 @@ class ArrayContainsFilter::Rep : public FieldFilter::Rep {
     return Type::kArrayContainsFilter;
   }
 
-  bool Matches(const model::Document& doc) const override;
+  bool MatchesValue(const FieldValue& lhs) const override;
 };
 
 ArrayContainsFilter::ArrayContainsFilter(FieldPath field, FieldValue value)
@@ -51,11 +49,7 @@ ArrayContainsFilter::ArrayContainsFilter(FieldPath field, FieldValue value)
           std::make_shared<const Rep>(std::move(field), std::move(value))) {
 }
 
-bool ArrayContainsFilter::Rep::Matches(const Document& doc) const {
-  absl::optional<FieldValue> maybe_lhs = doc.field(field());
-  if (!maybe_lhs) return false;
-
-  const FieldValue& lhs = *maybe_lhs;
+bool ArrayContainsFilter::Rep::MatchesValue(const FieldValue& lhs) const {
   if (lhs.type() != FieldValue::Type::Array) return false;
 
   const FieldValue::Array& contents = lhs.array_value();
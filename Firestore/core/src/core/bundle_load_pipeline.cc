@@ -0,0 +1,277 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/core/bundle_load_pipeline.h"
+
+#include <utility>
+
+#include "Firestore/core/src/api/load_bundle_task.h"
+#include "Firestore/core/src/bundle/bundle_reader.h"
+#include "Firestore/core/src/bundle/bundle_serializer.h"
+#include "Firestore/core/src/core/sync_engine.h"
+#include "Firestore/core/src/local/local_store.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/model_fwd.h"
+#include "Firestore/core/src/util/log.h"
+#include "absl/memory/memory.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+
+using bundle::BundleDocument;
+using bundle::BundleElement;
+using bundle::BundleFormat;
+using bundle::BundleMetadata;
+using bundle::BundleReader;
+using bundle::JsonReader;
+using model::DocumentKeySet;
+using model::DocumentVersionMap;
+using util::AsyncQueue;
+using util::Status;
+
+constexpr size_t BundleLoadPipeline::kBatchSize;
+constexpr size_t BundleLoadPipeline::kMaxBatchesInFlight;
+
+BundleLoadPipeline::BundleLoadPipeline(
+    std::shared_ptr<BundleReader> reader,
+    SyncEngine* sync_engine,
+    local::LocalStore* local_store,
+    std::shared_ptr<AsyncQueue> worker_queue,
+    util::Executor* executor,
+    std::shared_ptr<api::LoadBundleTask> result_task)
+    : reader_(std::move(reader)),
+      sync_engine_(sync_engine),
+      local_store_(local_store),
+      worker_queue_(std::move(worker_queue)),
+      executor_(executor),
+      result_task_(std::move(result_task)) {
+}
+
+void BundleLoadPipeline::Start() {
+  auto self = shared_from_this();
+  executor_->Execute([self] { self->ReadBundle(); });
+}
+
+void BundleLoadPipeline::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  decoding_finished_.notify_all();
+}
+
+bool BundleLoadPipeline::cancelled() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cancelled_;
+}
+
+void BundleLoadPipeline::ReadBundle() {
+  auto self = shared_from_this();
+
+  BundleMetadata metadata = reader_->GetBundleMetadata();
+  Status status = reader_->reader_status();
+  if (!RunOnWorkerQueue(
+          [self, metadata, status] { self->StartLoad(metadata, status); }) ||
+      !status.ok()) {
+    return;
+  }
+
+  int64_t bytes_read = reader_->bytes_read();
+  for (size_t index = 0; !cancelled(); ++index) {
+    auto batch = std::make_shared<Batch>();
+    while (batch->encoded_elements.size() < kBatchSize) {
+      absl::optional<std::string> encoded = reader_->GetNextEncodedElement();
+      if (!encoded) break;
+
+      batch->encoded_elements.push_back(std::move(*encoded));
+      batch->byte_sizes.push_back(reader_->bytes_read() - bytes_read);
+      bytes_read = reader_->bytes_read();
+    }
+    // A short batch means the stream ended, or reading it failed.
+    batch->status = reader_->reader_status();
+    batch->last = batch->encoded_elements.size() < kBatchSize;
+
+    if (!WaitForDecodingSlot()) return;
+    executor_->Execute(
+        [self, index, batch] { self->DecodeBatch(index, batch); });
+
+    if (batch->last) return;
+  }
+}
+
+bool BundleLoadPipeline::WaitForDecodingSlot() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  decoding_finished_.wait(lock, [this] {
+    return cancelled_ || batches_in_flight_ < kMaxBatchesInFlight;
+  });
+  if (cancelled_) return false;
+
+  ++batches_in_flight_;
+  return true;
+}
+
+void BundleLoadPipeline::DecodeBatch(size_t index,
+                                     const std::shared_ptr<Batch>& batch) {
+  std::unordered_map<size_t, BundleDocument> stale = FindStaleDocuments(*batch);
+
+  JsonReader context;
+  for (size_t i = 0; i < batch->encoded_elements.size(); ++i) {
+    if (cancelled()) break;
+
+    std::unique_ptr<BundleElement> element;
+    auto found = stale.find(i);
+    if (found != stale.end()) {
+      element = absl::make_unique<BundleDocument>(std::move(found->second));
+    } else {
+      element = BundleReader::DecodeElement(reader_->serializer(),
+                                            reader_->format(), context,
+                                            batch->encoded_elements[i]);
+    }
+    if (!context.ok()) {
+      // Elements after an invalid one are never added.
+      batch->status = context.status();
+      batch->last = true;
+      break;
+    }
+    batch->elements.push_back(std::move(element));
+  }
+  batch->encoded_elements.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --batches_in_flight_;
+    ready_batches_.emplace(index, batch);
+    decoding_finished_.notify_all();
+  }
+
+  auto self = shared_from_this();
+  RunOnWorkerQueue([self] { self->AddReadyBatches(); });
+}
+
+std::unordered_map<size_t, BundleDocument>
+BundleLoadPipeline::FindStaleDocuments(const Batch& batch) {
+  std::unordered_map<size_t, BundleDocument> result;
+  // The documents of binary bundles are parsed in full by nanopb before their
+  // version is known, so only the fields of JSON documents can be skipped.
+  if (!local_store_ || !local_store_->supports_concurrent_reads() ||
+      reader_->format() != BundleFormat::kJson) {
+    return result;
+  }
+
+  DocumentVersionMap versions;
+  std::unordered_map<size_t, BundleDocument> headers;
+  for (size_t i = 0; i < batch.encoded_elements.size(); ++i) {
+    // Elements that fail to decode here are decoded in full, which reports
+    // the error.
+    JsonReader context;
+    absl::optional<BundleDocument> header =
+        reader_->serializer().DecodeDocumentElementHeader(
+            context, batch.encoded_elements[i]);
+    if (!header || !context.ok()) continue;
+
+    versions[header->key()] = header->document().version();
+    headers.emplace(i, *std::move(header));
+  }
+  if (versions.empty()) return result;
+
+  DocumentKeySet stale =
+      local_store_->FindStaleBundledDocumentsFromSnapshot(versions);
+  for (auto& entry : headers) {
+    if (stale.contains(entry.second.key())) {
+      result.emplace(entry.first, std::move(entry.second));
+    }
+  }
+  return result;
+}
+
+void BundleLoadPipeline::StartLoad(const BundleMetadata& metadata,
+                                   const Status& status) {
+  if (!status.ok()) {
+    LOG_WARN("Failed to GetBundleMetadata() for bundle with error %s",
+             status.error_message());
+    Fail(status);
+    return;
+  }
+
+  loader_ = sync_engine_->StartBundleLoad(metadata, *result_task_);
+  if (!loader_) {
+    // The bundle was loaded before.
+    done_ = true;
+    Cancel();
+  }
+}
+
+void BundleLoadPipeline::AddReadyBatches() {
+  while (!done_) {
+    std::shared_ptr<Batch> batch;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto found = ready_batches_.find(next_batch_);
+      if (found == ready_batches_.end()) return;
+
+      batch = std::move(found->second);
+      ready_batches_.erase(found);
+    }
+    ++next_batch_;
+
+    for (size_t i = 0; i < batch->elements.size(); ++i) {
+      if (!sync_engine_->AddBundleElement(*loader_,
+                                          std::move(batch->elements[i]),
+                                          batch->byte_sizes[i],
+                                          *result_task_)) {
+        // `AddBundleElement` has already failed the task.
+        done_ = true;
+        Cancel();
+        return;
+      }
+    }
+
+    if (!batch->status.ok()) {
+      LOG_WARN("Failed to read bundle element with error %s",
+               batch->status.error_message());
+      Fail(batch->status);
+      return;
+    }
+
+    if (batch->last) {
+      sync_engine_->FinishBundleLoad(*loader_, *result_task_);
+      done_ = true;
+      return;
+    }
+  }
+}
+
+void BundleLoadPipeline::Fail(const Status& status) {
+  result_task_->SetError(status);
+  done_ = true;
+  Cancel();
+}
+
+bool BundleLoadPipeline::RunOnWorkerQueue(
+    const AsyncQueue::Operation& operation) {
+  // The worker queue no longer accepts operations once the client is being
+  // terminated, so there's no point in reading further. Nobody waits on the
+  // individual steps, so they yield to interactive operations.
+  if (!worker_queue_->EnqueueRelaxed(operation,
+                                     AsyncQueue::Priority::kBackground)) {
+    Cancel();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
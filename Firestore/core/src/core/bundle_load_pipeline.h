@@ -0,0 +1,174 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_CORE_BUNDLE_LOAD_PIPELINE_H_
+#define FIRESTORE_CORE_SRC_CORE_BUNDLE_LOAD_PIPELINE_H_
+
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Firestore/core/src/bundle/bundle_document.h"
+#include "Firestore/core/src/bundle/bundle_element.h"
+#include "Firestore/core/src/bundle/bundle_loader.h"
+#include "Firestore/core/src/bundle/bundle_metadata.h"
+#include "Firestore/core/src/util/async_queue.h"
+#include "Firestore/core/src/util/executor.h"
+#include "Firestore/core/src/util/status.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+
+namespace api {
+class LoadBundleTask;
+}  // namespace api
+
+namespace bundle {
+class BundleReader;
+}  // namespace bundle
+
+namespace local {
+class LocalStore;
+}  // namespace local
+
+namespace core {
+
+class SyncEngine;
+
+/**
+ * Loads a bundle in three stages, so that the worker queue only does the
+ * bookkeeping:
+ *
+ *   1. One task on `executor` reads the stream and splits it into batches
+ *      of encoded elements.
+ *   2. Each batch is decoded by its own task on `executor`, so batches are
+ *      decoded in parallel. If the local store supports concurrent reads,
+ *      the fields of documents that the local cache already has the same or
+ *      a newer version of are not decoded, since applying them would be a
+ *      no-op.
+ *   3. Decoded batches are handed to `SyncEngine` on the worker queue, in
+ *      bundle order, which adds them to a `BundleLoader` and reports progress
+ *      on the `LoadBundleTask`.
+ *
+ * At most `kMaxBatchesInFlight` batches are decoded at a time, which bounds
+ * the memory used when reading is faster than decoding. `executor` must be
+ * able to run at least two tasks concurrently, since the reading task waits
+ * for decoding tasks to finish.
+ */
+class BundleLoadPipeline
+    : public std::enable_shared_from_this<BundleLoadPipeline> {
+ public:
+  /** The number of elements decoded by each decoding task. */
+  static constexpr size_t kBatchSize = 64;
+
+  /** The number of batches that may be decoded at the same time. */
+  static constexpr size_t kMaxBatchesInFlight = 8;
+
+  /**
+   * Creates a pipeline that loads the bundle read by `reader` with
+   * `sync_engine`. `sync_engine` must stay valid for as long as operations can
+   * run on `worker_queue`, and `local_store` for as long as tasks can run on
+   * `executor`.
+   */
+  BundleLoadPipeline(std::shared_ptr<bundle::BundleReader> reader,
+                     SyncEngine* sync_engine,
+                     local::LocalStore* local_store,
+                     std::shared_ptr<util::AsyncQueue> worker_queue,
+                     util::Executor* executor,
+                     std::shared_ptr<api::LoadBundleTask> result_task);
+
+  /** Starts reading the bundle. */
+  void Start();
+
+  /**
+   * Stops reading and decoding the bundle as soon as possible, without
+   * completing the `LoadBundleTask`. Can be called from any thread.
+   */
+  void Cancel();
+
+ private:
+  /** A batch of consecutive elements. */
+  struct Batch {
+    std::vector<std::string> encoded_elements;
+    std::vector<int64_t> byte_sizes;
+    std::vector<std::unique_ptr<bundle::BundleElement>> elements;
+
+    /** An error to report after adding `elements`. */
+    util::Status status;
+
+    /** Whether this is the last batch of the bundle. */
+    bool last = false;
+  };
+
+  // Stage 1, runs on `executor_`.
+  void ReadBundle();
+  bool WaitForDecodingSlot();
+
+  // Stage 2, runs on `executor_`.
+  void DecodeBatch(size_t index, const std::shared_ptr<Batch>& batch);
+
+  /**
+   * Returns the documents of the batch, by element index, that the local
+   * cache already has the same or a newer version of, decoded without their
+   * fields.
+   */
+  std::unordered_map<size_t, bundle::BundleDocument> FindStaleDocuments(
+      const Batch& batch);
+
+  // Stage 3, runs on the worker queue.
+  void StartLoad(const bundle::BundleMetadata& metadata,
+                 const util::Status& status);
+  void AddReadyBatches();
+  void Fail(const util::Status& status);
+
+  /** Enqueues `operation` on the worker queue, or cancels the pipeline. */
+  bool RunOnWorkerQueue(const util::AsyncQueue::Operation& operation);
+
+  bool cancelled() const;
+
+  std::shared_ptr<bundle::BundleReader> reader_;
+  SyncEngine* sync_engine_ = nullptr;
+  local::LocalStore* local_store_ = nullptr;
+  std::shared_ptr<util::AsyncQueue> worker_queue_;
+  util::Executor* executor_ = nullptr;
+  std::shared_ptr<api::LoadBundleTask> result_task_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable decoding_finished_;
+  bool cancelled_ = false;
+  size_t batches_in_flight_ = 0;
+
+  /** Decoded batches waiting to be added to the loader, by index. */
+  std::map<size_t, std::shared_ptr<Batch>> ready_batches_;
+
+  // Only accessed on the worker queue.
+  absl::optional<bundle::BundleLoader> loader_;
+  size_t next_batch_ = 0;
+  bool done_ = false;
+};
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_CORE_BUNDLE_LOAD_PIPELINE_H_
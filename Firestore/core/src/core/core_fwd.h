@@ -17,6 +17,7 @@
 #ifndef FIRESTORE_CORE_SRC_CORE_CORE_FWD_H_
 #define FIRESTORE_CORE_SRC_CORE_CORE_FWD_H_
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
@@ -40,6 +41,7 @@ using StatusCallback = std::function<void(Status)>;
 namespace core {
 
 class Bound;
+class BundleLoadPipeline;
 class DatabaseInfo;
 class Direction;
 class EventManager;
@@ -52,8 +54,10 @@ class ParsedSetData;
 class ParsedUpdateData;
 class Query;
 class QueryListener;
+class QueryMatcher;
 class SyncEngine;
 class SyncEngineCallback;
+class SyncedQueryTracker;
 class Target;
 class TargetIdGenerator;
 class Transaction;
@@ -76,6 +80,8 @@ using FilterList = immutable::AppendOnlyList<Filter>;
 
 using OrderByList = immutable::AppendOnlyList<OrderBy>;
 
+using MemoryReleaseCallback = std::function<void(size_t bytes_released)>;
+
 using TransactionResultCallback = util::StatusCallback;
 
 using TransactionUpdateCallback = std::function<void(
@@ -24,6 +24,7 @@
 #include "Firestore/core/src/util/executor.h"
 #include "Firestore/core/src/util/status_fwd.h"
 #include "Firestore/core/src/util/statusor.h"
+#include "Firestore/core/src/util/trace.h"
 #include "absl/memory/memory.h"
 
 namespace firebase {
@@ -141,6 +142,7 @@ void AsyncEventListener<T>::OnEvent(util::StatusOr<T> maybe_value) {
   std::shared_ptr<AsyncEventListener<T>> shared_this = this->shared_from_this();
 
   executor_->Execute([shared_this, maybe_value]() {
+    FIRESTORE_TRACE_SPAN("AsyncEventListener::OnEvent");
     std::lock_guard<std::recursive_mutex> lock(shared_this->mutex_);
     if (!shared_this->muted_) {
       shared_this->delegate_->OnEvent(std::move(maybe_value));
@@ -20,7 +20,9 @@
 
 #include "Firestore/core/src/core/query_listener.h"
 #include "Firestore/core/src/core/sync_engine.h"
+#include "Firestore/core/src/core/synced_query_tracker.h"
 #include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/trace.h"
 #include "absl/algorithm/container.h"
 
 namespace firebase {
@@ -55,6 +57,9 @@ model::TargetId EventManager::AddQueryListener(
       RaiseSnapshotsInSyncEvent();
     }
   }
+  if (!listener->raised_initial_event()) {
+    listeners_awaiting_initial_event_.insert(listener);
+  }
 
   if (first_listen) {
     query_info.target_id = query_event_source_->Listen(query);
@@ -66,6 +71,7 @@ void EventManager::RemoveQueryListener(
     std::shared_ptr<core::QueryListener> listener) {
   const Query& query = listener->query();
   bool last_listen = false;
+  listeners_awaiting_initial_event_.erase(listener);
 
   auto found_iter = queries_.find(query);
   if (found_iter != queries_.end()) {
@@ -75,6 +81,11 @@ void EventManager::RemoveQueryListener(
   }
 
   if (last_listen) {
+    const absl::optional<ViewSnapshot>& snapshot =
+        found_iter->second.view_snapshot();
+    if (synced_query_tracker_ && snapshot && !snapshot->from_cache()) {
+      synced_query_tracker_->RecordSynced(query);
+    }
     queries_.erase(found_iter);
     query_event_source_->StopListening(query);
   }
@@ -95,12 +106,16 @@ void EventManager::HandleOnlineStateChange(model::OnlineState online_state) {
   bool raised_event = false;
   online_state_ = online_state;
 
-  for (auto&& kv : queries_) {
-    QueryListenersInfo& info = kv.second;
-    for (auto&& listener : info.listeners) {
-      if (listener->OnOnlineStateChanged(online_state_)) {
-        raised_event = true;
-      }
+  for (auto it = listeners_awaiting_initial_event_.begin();
+       it != listeners_awaiting_initial_event_.end();) {
+    const std::shared_ptr<QueryListener>& listener = *it;
+    if (listener->OnOnlineStateChanged(online_state_)) {
+      raised_event = true;
+    }
+    if (listener->raised_initial_event()) {
+      it = listeners_awaiting_initial_event_.erase(it);
+    } else {
+      ++it;
     }
   }
   if (raised_event) {
@@ -117,6 +132,7 @@ void EventManager::RaiseSnapshotsInSyncEvent() {
 
 void EventManager::OnViewSnapshots(
     std::vector<core::ViewSnapshot>&& snapshots) {
+  FIRESTORE_TRACE_SPAN("EventManager::OnViewSnapshots");
   bool raised_event = false;
   for (ViewSnapshot& snapshot : snapshots) {
     const Query& query = snapshot.query();
@@ -124,9 +140,13 @@ void EventManager::OnViewSnapshots(
     if (found_iter != queries_.end()) {
       QueryListenersInfo& query_info = found_iter->second;
       for (const auto& listener : query_info.listeners) {
+        bool awaiting_initial_event = !listener->raised_initial_event();
         if (listener->OnViewSnapshot(snapshot)) {
           raised_event = true;
         }
+        if (awaiting_initial_event && listener->raised_initial_event()) {
+          listeners_awaiting_initial_event_.erase(listener);
+        }
       }
       query_info.set_view_snapshot(std::move(snapshot));
     }
@@ -146,6 +166,7 @@ void EventManager::OnError(const core::Query& query,
   QueryListenersInfo& query_info = found_iter->second;
   for (const auto& listener : query_info.listeners) {
     listener->OnError(error);
+    listeners_awaiting_initial_event_.erase(listener);
   }
 
   // Remove all listeners. NOTE: We don't need to call
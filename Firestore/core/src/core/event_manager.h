@@ -36,6 +36,7 @@ namespace core {
 
 class QueryEventSource;
 class QueryListener;
+class SyncedQueryTracker;
 
 /**
  * EventManager is responsible for mapping queries to query event listeners.
@@ -63,6 +64,14 @@ class EventManager : public SyncEngineCallback {
    */
   void RemoveQueryListener(std::shared_ptr<core::QueryListener> listener);
 
+  /**
+   * Makes the manager record in `tracker` the queries whose last listener is
+   * removed while they're in sync with the backend.
+   */
+  void set_synced_query_tracker(SyncedQueryTracker* tracker) {
+    synced_query_tracker_ = tracker;
+  }
+
   void AddSnapshotsInSyncListener(
       const std::shared_ptr<EventListener<util::Empty>>& listener);
   void RemoveSnapshotsInSyncListener(
@@ -104,8 +113,17 @@ class EventManager : public SyncEngineCallback {
   };
 
   QueryEventSource* query_event_source_ = nullptr;
+  SyncedQueryTracker* synced_query_tracker_ = nullptr;
   model::OnlineState online_state_ = model::OnlineState::Unknown;
   std::unordered_map<core::Query, QueryListenersInfo> queries_;
+
+  /**
+   * The listeners that haven't raised their initial event yet. Only these
+   * depend on the online state, so only these are told when it changes.
+   */
+  std::unordered_set<std::shared_ptr<QueryListener>>
+      listeners_awaiting_initial_event_;
+
   std::unordered_set<std::shared_ptr<EventListener<util::Empty>>>
       snapshots_in_sync_listeners_;
 };
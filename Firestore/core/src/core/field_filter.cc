@@ -125,7 +125,12 @@ FieldFilter::FieldFilter(std::shared_ptr<const Filter::Rep> rep)
 }
 
 FieldFilter::Rep::Rep(FieldPath field, Operator op, FieldValue value_rhs)
-    : field_(std::move(field)), op_(op), value_rhs_(std::move(value_rhs)) {
+    : field_(std::move(field)),
+      op_(op),
+      value_rhs_(std::move(value_rhs)),
+      canonical_id_(absl::StrCat(
+          field_.CanonicalString(), CanonicalName(op_), value_rhs_.ToString())),
+      hash_(util::Hash(field_, op_, value_rhs_)) {
 }
 
 bool FieldFilter::Rep::IsInequality() const {
@@ -136,10 +141,10 @@ bool FieldFilter::Rep::IsInequality() const {
 
 bool FieldFilter::Rep::Matches(const model::Document& doc) const {
   absl::optional<FieldValue> maybe_lhs = doc.field(field_);
-  if (!maybe_lhs) return false;
-
-  const FieldValue& lhs = *maybe_lhs;
+  return maybe_lhs && MatchesValue(*maybe_lhs);
+}
 
+bool FieldFilter::Rep::MatchesValue(const FieldValue& lhs) const {
   // Types do not have to match in NotEqual filters.
   if (op_ == Operator::NotEqual) {
     return MatchesComparison(lhs.CompareTo(value_rhs_));
@@ -171,20 +176,11 @@ bool FieldFilter::Rep::MatchesComparison(ComparisonResult comparison) const {
   }
 }
 
-std::string FieldFilter::Rep::CanonicalId() const {
-  return absl::StrCat(field_.CanonicalString(), CanonicalName(op_),
-                      value_rhs_.ToString());
-}
-
 std::string FieldFilter::Rep::ToString() const {
   return util::StringFormat("%s %s %s", field_.CanonicalString(),
                             CanonicalName(op_), value_rhs_.ToString());
 }
 
-size_t FieldFilter::Rep::Hash() const {
-  return util::Hash(field_, op_, value_rhs_);
-}
-
 bool FieldFilter::Rep::Equals(const Filter::Rep& other) const {
   if (type() != other.type()) return false;
 
@@ -60,6 +60,16 @@ class FieldFilter : public Filter {
     return field_filter_rep().value_rhs_;
   }
 
+  /**
+   * Returns true if a document whose `field()` has the value `lhs` matches the
+   * filter. This allows callers that already looked up the field to avoid
+   * looking it up again. Must not be called on filters on the document key,
+   * which match against the key rather than a field value.
+   */
+  bool MatchesValue(const model::FieldValue& lhs) const {
+    return field_filter_rep().MatchesValue(lhs);
+  }
+
  protected:
   class Rep : public Filter::Rep {
    public:
@@ -85,13 +95,24 @@ class FieldFilter : public Filter {
       return value_rhs_;
     }
 
+    /**
+     * Looks up `field()` in the document and matches it with `MatchesValue`.
+     * Documents that don't contain the field never match.
+     */
     bool Matches(const model::Document& doc) const override;
 
-    std::string CanonicalId() const override;
+    /** Returns true if a document with the given field value matches. */
+    virtual bool MatchesValue(const model::FieldValue& lhs) const;
+
+    const std::string& CanonicalId() const override {
+      return canonical_id_;
+    }
 
     std::string ToString() const override;
 
-    size_t Hash() const override;
+    size_t Hash() const override {
+      return hash_;
+    }
 
    protected:
     /**
@@ -113,8 +134,6 @@ class FieldFilter : public Filter {
 
     bool Equals(const Filter::Rep& other) const override;
 
-    bool MatchesValue(const model::FieldValue& lhs) const;
-
     /** The left hand side of the relation. A path into a document field. */
     model::FieldPath field_;
 
@@ -123,6 +142,11 @@ class FieldFilter : public Filter {
 
     /** The right hand side of the relation. A constant value to compare to. */
     model::FieldValue value_rhs_;
+
+    // Filters are immutable, and their canonical IDs and hashes are needed
+    // every time a query is looked up by target, so compute them up front.
+    std::string canonical_id_;
+    size_t hash_ = 0;
   };
 
   explicit FieldFilter(std::shared_ptr<const Filter::Rep> rep);
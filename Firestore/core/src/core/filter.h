@@ -97,7 +97,7 @@ class Filter {
   }
 
   /** A unique ID identifying the filter; used when serializing queries. */
-  std::string CanonicalId() const {
+  const std::string& CanonicalId() const {
     return rep_->CanonicalId();
   }
 
@@ -134,7 +134,7 @@ class Filter {
     virtual bool Matches(const model::Document& doc) const = 0;
 
     /** A unique ID identifying the filter; used when serializing queries. */
-    virtual std::string CanonicalId() const = 0;
+    virtual const std::string& CanonicalId() const = 0;
 
     virtual bool Equals(const Rep& other) const = 0;
 
@@ -16,35 +16,56 @@
 
 #include "Firestore/core/src/core/firestore_client.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
 #include <functional>
 #include <future>  // NOLINT(build/c++11)
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/api/document_reference.h"
 #include "Firestore/core/src/api/document_snapshot.h"
 #include "Firestore/core/src/api/query_core.h"
 #include "Firestore/core/src/api/query_snapshot.h"
 #include "Firestore/core/src/api/settings.h"
+#include "Firestore/core/src/api/source.h"
 #include "Firestore/core/src/auth/credentials_provider.h"
+#include "Firestore/core/src/auth/prefetching_credentials_provider.h"
 #include "Firestore/core/src/bundle/bundle_reader.h"
 #include "Firestore/core/src/core/database_info.h"
+#include "Firestore/core/src/core/bundle_load_pipeline.h"
 #include "Firestore/core/src/core/event_manager.h"
 #include "Firestore/core/src/core/query_listener.h"
+#include "Firestore/core/src/core/query_matcher.h"
 #include "Firestore/core/src/core/sync_engine.h"
+#include "Firestore/core/src/core/synced_query_tracker.h"
 #include "Firestore/core/src/core/view.h"
+#include "Firestore/core/src/local/bundle_document_source.h"
+#include "Firestore/core/src/local/index_manager.h"
 #include "Firestore/core/src/local/leveldb_opener.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_remote_document_cache.h"
 #include "Firestore/core/src/local/local_documents_view.h"
 #include "Firestore/core/src/local/local_serializer.h"
 #include "Firestore/core/src/local/local_store.h"
+#include "Firestore/core/src/local/lru_garbage_collector.h"
 #include "Firestore/core/src/local/memory_persistence.h"
+#include "Firestore/core/src/local/memory_snapshot.h"
+#include "Firestore/core/src/local/proto_sizer.h"
 #include "Firestore/core/src/local/query_engine.h"
 #include "Firestore/core/src/local/query_result.h"
 #include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/document_map.h"
 #include "Firestore/core/src/model/document_set.h"
 #include "Firestore/core/src/model/mutation.h"
+#include "Firestore/core/src/model/snapshot_version.h"
+#include "Firestore/core/src/nanopb/byte_string.h"
 #include "Firestore/core/src/remote/connectivity_monitor.h"
 #include "Firestore/core/src/remote/datastore.h"
 #include "Firestore/core/src/remote/firebase_metadata_provider.h"
@@ -64,36 +85,55 @@ namespace firebase {
 namespace firestore {
 namespace core {
 
+using api::CountListener;
 using api::DocumentReference;
 using api::DocumentSnapshot;
 using api::DocumentSnapshotListener;
+using api::DocumentSnapshotsListener;
 using api::ListenerRegistration;
 using api::QuerySnapshot;
 using api::QuerySnapshotListener;
 using api::Settings;
 using api::SnapshotMetadata;
+using api::Source;
 using auth::CredentialsProvider;
+using auth::PrefetchingCredentialsProvider;
 using auth::User;
 using firestore::Error;
+using local::BundleDocumentSource;
 using local::LevelDbOpener;
+using local::LevelDbOptions;
 using local::LocalSerializer;
 using local::LocalStore;
 using local::LruParams;
+using local::LruResults;
 using local::MemoryPersistence;
+using local::MemorySnapshot;
+using local::ProtoSizer;
 using local::QueryEngine;
 using local::QueryResult;
 using model::DatabaseId;
 using model::Document;
+using model::DocumentKey;
+using model::DocumentKeyHash;
 using model::DocumentKeySet;
 using model::DocumentMap;
+using model::DocumentSet;
 using model::MaybeDocument;
+using model::MaybeDocumentMap;
 using model::Mutation;
 using model::OnlineState;
+using model::OptionalMaybeDocumentMap;
+using model::ResourcePath;
+using model::SnapshotVersion;
 using remote::ConnectivityMonitor;
 using remote::Datastore;
+using remote::ExponentialBackoff;
 using remote::FirebaseMetadataProvider;
 using remote::RemoteStore;
 using remote::Serializer;
+using remote::StreamIdleTimeout;
+using remote::WritePipelineDepth;
 using util::AsyncQueue;
 using util::DelayedConstructor;
 using util::DelayedOperation;
@@ -109,6 +149,152 @@ using util::TimerId;
 
 static const size_t kMaxConcurrentLimboResolutions = 100;
 
+// Stored next to where LevelDB would keep the data of this instance, so that
+// clearing persistence removes it too.
+static const char* const kMemorySnapshotFileName = "memory_snapshot";
+
+// The number of documents returned for a one-shot query that are written to
+// the cache per transaction, so that large results don't hold up the worker
+// queue in a single task.
+static const size_t kMaxQueryResultsBatchSize = 100;
+
+// The number of documents `GetAllDocuments` looks up per BatchGetDocuments
+// call, so that the response to each call stays reasonably small.
+static const size_t kMaxLookupBatchSize = 100;
+
+using SteadyClock = std::chrono::steady_clock;
+
+/** Returns the number of milliseconds elapsed since `start`. */
+static std::chrono::milliseconds::rep MillisecondsSince(
+    SteadyClock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             SteadyClock::now() - start)
+      .count();
+}
+
+static grpc_compression_algorithm ToGrpcCompression(
+    Settings::MessageCompression compression) {
+  switch (compression) {
+    case Settings::MessageCompression::None:
+      return GRPC_COMPRESS_NONE;
+    case Settings::MessageCompression::Gzip:
+      return GRPC_COMPRESS_GZIP;
+    case Settings::MessageCompression::Deflate:
+      return GRPC_COMPRESS_DEFLATE;
+  }
+  UNREACHABLE();
+}
+
+/** Applies the LevelDB tuning settings over the platform defaults. */
+static LevelDbOptions MakeLevelDbOptions(const Settings& settings) {
+  LevelDbOptions options = LevelDbOptions::Default();
+  if (settings.leveldb_block_cache_size_bytes() !=
+      Settings::LevelDbPlatformDefault) {
+    options.block_cache_size_bytes =
+        static_cast<size_t>(settings.leveldb_block_cache_size_bytes());
+  }
+  if (settings.leveldb_write_buffer_size_bytes() !=
+      Settings::LevelDbPlatformDefault) {
+    options.write_buffer_size_bytes =
+        static_cast<size_t>(settings.leveldb_write_buffer_size_bytes());
+  }
+  if (settings.leveldb_bloom_filter_bits_per_key() !=
+      Settings::LevelDbPlatformDefault) {
+    options.bloom_filter_bits_per_key =
+        static_cast<int>(settings.leveldb_bloom_filter_bits_per_key());
+  }
+  return options;
+}
+
+/**
+ * Builds the snapshot of a one-shot query run on the backend, given the local
+ * view of its results and the keys of the documents the backend returned.
+ */
+static QuerySnapshot MakeServerQuerySnapshot(const api::Query& query,
+                                             const MaybeDocumentMap& docs,
+                                             DocumentKeySet remote_keys) {
+  // The results are complete as of the read, so the view is synced.
+  View view(query.query(), DocumentKeySet{});
+  ViewChange view_change = view.ApplyChanges(
+      view.ComputeDocumentChanges(docs),
+      remote::TargetChange(nanopb::ByteString{}, /* current= */ true,
+                           std::move(remote_keys), DocumentKeySet{},
+                           DocumentKeySet{}));
+  HARD_ASSERT(view_change.snapshot().has_value(), "Expected a snapshot");
+
+  ViewSnapshot snapshot = std::move(view_change.snapshot()).value();
+  SnapshotMetadata metadata(snapshot.has_pending_writes(),
+                            snapshot.from_cache());
+  return QuerySnapshot(query.firestore(), query.query(), std::move(snapshot),
+                       std::move(metadata));
+}
+
+/**
+ * Converts a document read from the local cache into a snapshot, or returns an
+ * error if the cache doesn't know whether the document exists.
+ */
+static StatusOr<DocumentSnapshot> MakeCachedDocumentSnapshot(
+    const DocumentReference& doc,
+    const absl::optional<MaybeDocument>& maybe_document) {
+  if (maybe_document && maybe_document->is_document()) {
+    Document document(*maybe_document);
+    return DocumentSnapshot::FromDocument(
+        doc.firestore(), document,
+        SnapshotMetadata{
+            /*has_pending_writes=*/document.has_local_mutations(),
+            /*from_cache=*/true});
+  } else if (maybe_document && maybe_document->is_no_document()) {
+    return DocumentSnapshot::FromNoDocument(
+        doc.firestore(), doc.key(),
+        SnapshotMetadata{/*has_pending_writes=*/false,
+                         /*from_cache=*/true});
+  } else {
+    return Status{
+        Error::kErrorUnavailable,
+        "Failed to get document from cache. (However, this document "
+        "may exist on the server. Run again without setting source to "
+        "FirestoreSourceCache to attempt to retrieve the document "};
+  }
+}
+
+/**
+ * Builds the snapshot of a cache read from the documents the local store
+ * found for `query`. A read has no previous snapshot to diff against and no
+ * target to track, so instead of running the documents through a `View` this
+ * only sorts them and applies the query's limit.
+ */
+static ViewSnapshot MakeLocalReadSnapshot(const Query& query,
+                                          const DocumentMap& results,
+                                          bool from_cache) {
+  QueryMatcher matcher(query);
+  DocumentSet documents(query.Comparator());
+  DocumentKeySet mutated_keys;
+  for (const auto& kv : results.underlying_map()) {
+    Document doc(kv.second);
+    if (!matcher.Matches(doc)) continue;
+
+    if (doc.has_local_mutations()) {
+      mutated_keys = mutated_keys.insert(doc.key());
+    }
+    documents = documents.insert(std::move(doc));
+  }
+
+  if (query.limit_type() != LimitType::None) {
+    auto limit = static_cast<size_t>(query.limit());
+    while (documents.size() > limit) {
+      absl::optional<Document> dropped = query.has_limit_to_first()
+                                             ? documents.GetLastDocument()
+                                             : documents.GetFirstDocument();
+      documents = documents.erase(dropped->key());
+      mutated_keys = mutated_keys.erase(dropped->key());
+    }
+  }
+
+  return ViewSnapshot::FromInitialDocuments(
+      query, std::move(documents), std::move(mutated_keys), from_cache,
+      /*excludes_metadata_changes=*/false);
+}
+
 std::shared_ptr<FirestoreClient> FirestoreClient::Create(
     const DatabaseInfo& database_info,
     const api::Settings& settings,
@@ -116,11 +302,25 @@ std::shared_ptr<FirestoreClient> FirestoreClient::Create(
     std::shared_ptr<Executor> user_executor,
     std::shared_ptr<AsyncQueue> worker_queue,
     std::unique_ptr<FirebaseMetadataProvider> firebase_metadata_provider) {
+  std::shared_ptr<PrefetchingCredentialsProvider> prefetching_provider;
+  if (settings.connection_warm_up_enabled()) {
+    prefetching_provider = std::make_shared<PrefetchingCredentialsProvider>(
+        std::move(credentials_provider));
+    credentials_provider = prefetching_provider;
+  }
+
   // Have to use `new` because `make_shared` cannot access private constructor.
   std::shared_ptr<FirestoreClient> shared_client(new FirestoreClient(
       database_info, std::move(credentials_provider), std::move(user_executor),
       std::move(worker_queue), std::move(firebase_metadata_provider)));
 
+  if (settings.persistence_enabled() &&
+      settings.query_result_cache_seconds() > 0) {
+    shared_client->synced_query_tracker_ =
+        absl::make_unique<SyncedQueryTracker>(
+            std::chrono::seconds(settings.query_result_cache_seconds()));
+  }
+
   std::weak_ptr<FirestoreClient> weak_client(shared_client);
   auto credential_change_listener = [weak_client, settings](User user) mutable {
     auto shared_client = weak_client.lock();
@@ -141,6 +341,8 @@ std::shared_ptr<FirestoreClient> FirestoreClient::Create(
         shared_client->worker_queue_->VerifyIsCurrentQueue();
 
         LOG_DEBUG("Credential Changed. Current user: %s", user.uid());
+        shared_client->FlushCoalescedWrites();
+        shared_client->AwaitLocalReads();
         shared_client->sync_engine_->HandleCredentialChange(user);
       });
     }
@@ -153,6 +355,10 @@ std::shared_ptr<FirestoreClient> FirestoreClient::Create(
       shared_client->credentials_initialized_,
       "CredentialChangeListener not invoked during client initialization");
 
+  if (prefetching_provider) {
+    prefetching_provider->Prefetch();
+  }
+
   return shared_client;
 }
 
@@ -177,11 +383,17 @@ void FirestoreClient::Initialize(const User& user, const Settings& settings) {
   // Note: The initialization work must all be synchronous (we can't dispatch
   // more work) since external write/listen operations could get queued to run
   // before that subsequent work completes.
+  write_coalescing_enabled_ = settings.write_coalescing_enabled();
+
+  SteadyClock::time_point start = SteadyClock::now();
   if (settings.persistence_enabled()) {
     LevelDbOpener opener(database_info_);
 
-    auto created =
-        opener.Create(LruParams::WithCacheSize(settings.cache_size_bytes()));
+    LruParams lru_params =
+        LruParams::WithCacheSize(settings.cache_size_bytes());
+    lru_params.approximate_sequence_numbers =
+        settings.approximate_lru_enabled();
+    auto created = opener.Create(lru_params, MakeLevelDbOptions(settings));
     // If leveldb fails to start then just throw up our hands: the error is
     // unrecoverable. There's nothing an end-user can do and nearly all
     // failures indicate the developer is doing something grossly wrong so we
@@ -191,41 +403,134 @@ void FirestoreClient::Initialize(const User& user, const Settings& settings) {
 
     auto ldb = std::move(created).ValueOrDie();
     lru_delegate_ = ldb->reference_delegate();
+    leveldb_document_cache_ = ldb->remote_document_cache();
+    ldb->set_sync_user_writes(settings.sync_user_writes());
+    if (settings.group_commit_enabled()) {
+      // Transactions already on the queue run before the flush, so their
+      // commits join the group.
+      std::weak_ptr<FirestoreClient> weak_this = shared_from_this();
+      ldb->EnableGroupCommit([weak_this](std::function<void()> flush) {
+        auto shared_this = weak_this.lock();
+        if (!shared_this) return;
+
+        shared_this->worker_queue_->EnqueueRelaxed([weak_this, flush] {
+          auto client = weak_this.lock();
+          if (!client) return;
+          flush();
+        });
+      });
+    }
+
+    if (settings.gc_enabled()) {
+      ldb->EnableBackgroundCompaction(
+          Executor::CreateSerial("com.google.firebase.firestore.compaction",
+                                 Executor::Priority::Utility));
+    }
 
     persistence_ = std::move(ldb);
     if (settings.gc_enabled()) {
       ScheduleLruGarbageCollection();
     }
+    ScheduleResumeTokenPersistence();
   } else {
-    persistence_ = MemoryPersistence::WithEagerGarbageCollector();
+    auto memory = MemoryPersistence::WithEagerGarbageCollector();
+    if (settings.compact_memory_cache_enabled()) {
+      memory->remote_document_cache()->EnableCompactStorage(LocalSerializer(
+          remote::Serializer(database_info_.database_id())));
+    }
+    if (settings.memory_snapshot_interval_seconds() > 0) {
+      EnableMemorySnapshots(
+          memory.get(),
+          std::chrono::seconds(settings.memory_snapshot_interval_seconds()));
+    }
+    persistence_ = std::move(memory);
   }
+  LOG_DEBUG("Opened persistence in %sms", MillisecondsSince(start));
+  persistence_->set_transaction_stats(transaction_stats_);
 
+  query_sizer_ = absl::make_unique<ProtoSizer>(
+      LocalSerializer(remote::Serializer(database_info_.database_id())));
   query_engine_ = absl::make_unique<QueryEngine>();
+  query_engine_->SetSizer(query_sizer_.get());
   local_store_ = absl::make_unique<LocalStore>(persistence_.get(),
                                                query_engine_.get(), user);
+  if (local_store_->supports_concurrent_reads()) {
+    reader_executor_ =
+        Executor::CreateSerial("com.google.firebase.firestore.reader",
+                               Executor::Priority::UserInitiated);
+  }
   connectivity_monitor_ = ConnectivityMonitor::Create(worker_queue_);
+  if (settings.persistence_enabled()) {
+    // The app may be terminated without warning while in the background.
+    connectivity_monitor_->AddBackgroundCallback(
+        [this] { local_store_->PersistResumeTokens(); });
+  }
+  if (memory_snapshot_) {
+    connectivity_monitor_->AddBackgroundCallback(
+        [this] { WriteMemorySnapshot(); });
+  }
   auto datastore = std::make_shared<Datastore>(
       database_info_, worker_queue_, credentials_provider_,
-      connectivity_monitor_.get(), firebase_metadata_provider_.get());
+      connectivity_monitor_.get(), firebase_metadata_provider_.get(),
+      std::max(settings.grpc_completion_queue_count(), 1));
+  datastore->set_compression_algorithm(
+      ToGrpcCompression(settings.message_compression()));
+  datastore->set_keepalive(
+      std::chrono::seconds(std::max(settings.keepalive_time_seconds(), 1)),
+      settings.keepalive_without_calls_enabled());
+  datastore->set_backoff_jitter(settings.full_jitter_backoff_enabled()
+                                    ? ExponentialBackoff::Jitter::Full
+                                    : ExponentialBackoff::Jitter::Proportional);
+  if (settings.connection_warm_up_enabled()) {
+    datastore->WarmUpConnection();
+  }
 
   remote_store_ = absl::make_unique<RemoteStore>(
       local_store_.get(), std::move(datastore), worker_queue_,
       connectivity_monitor_.get(), [this](OnlineState online_state) {
         sync_engine_->HandleOnlineStateChange(online_state);
       });
+  remote_store_->set_write_pipeline_depth(
+      WritePipelineDepth(settings.write_pipeline_depth(),
+                         settings.adaptive_write_pipeline_enabled()));
+  remote_store_->set_max_batches_per_write_request(
+      settings.max_batches_per_write_request());
+  if (settings.ack_coalescing_enabled()) {
+    remote_store_->EnableAckCoalescing(worker_queue_);
+  }
+  remote_store_->set_stream_idle_timeout(StreamIdleTimeout(
+      std::chrono::seconds(settings.stream_idle_timeout_seconds()),
+      settings.adaptive_stream_idle_timeout_enabled()));
 
   sync_engine_ =
       absl::make_unique<SyncEngine>(local_store_.get(), remote_store_.get(),
                                     user, kMaxConcurrentLimboResolutions);
 
+  if (settings.limbo_lookup_batch_size() > 0) {
+    sync_engine_->EnableLimboLookups(
+        static_cast<size_t>(settings.limbo_lookup_batch_size()),
+        static_cast<size_t>(
+            std::max(settings.max_concurrent_limbo_lookups(), 1)));
+  }
+  sync_engine_->set_write_squashing_enabled(
+      settings.write_squashing_enabled());
+  if (settings.target_release_grace_period_ms() > 0) {
+    sync_engine_->EnableReleaseGracePeriod(
+        worker_queue_,
+        std::chrono::milliseconds(settings.target_release_grace_period_ms()));
+  }
+
   event_manager_ = absl::make_unique<EventManager>(sync_engine_.get());
+  event_manager_->set_synced_query_tracker(synced_query_tracker_.get());
 
   // Setup wiring for remote store.
   remote_store_->set_sync_engine(sync_engine_.get());
 
   // NOTE: RemoteStore depends on LocalStore (for persisting stream tokens,
   // refilling mutation queue, etc.) so must be started after LocalStore.
+  start = SteadyClock::now();
   local_store_->Start();
+  LOG_DEBUG("Started local store in %sms", MillisecondsSince(start));
   remote_store_->Start();
 }
 
@@ -278,17 +583,40 @@ void FirestoreClient::TerminateAsync(StatusCallback callback) {
 void FirestoreClient::TerminateInternal() {
   if (!remote_store_) return;
 
+  FlushCoalescedWrites();
+  AwaitLocalReads();
+  reader_executor_.reset();
+
+  // Stop loading bundles before the executor waits for its tasks.
+  for (const auto& weak_pipeline : bundle_pipelines_) {
+    if (auto pipeline = weak_pipeline.lock()) {
+      pipeline->Cancel();
+    }
+  }
+  bundle_pipelines_.clear();
+  bundle_executor_.reset();
+
   credentials_provider_->SetCredentialChangeListener(nullptr);
   credentials_provider_.reset();
 
-  // If we've scheduled LRU garbage collection, cancel it.
+  // If we've scheduled LRU garbage collection or persisting resume tokens,
+  // cancel it.
   lru_callback_.Cancel();
+  resume_token_callback_.Cancel();
+  memory_snapshot_callback_.Cancel();
+
+  // Save the final state, and wait for the write before the executor goes.
+  if (memory_snapshot_) {
+    WriteMemorySnapshot();
+    snapshot_executor_.reset();
+  }
 
   remote_store_->Shutdown();
   persistence_->Shutdown();
 
   local_store_.reset();
   query_engine_.reset();
+  query_sizer_.reset();
   event_manager_.reset();
 
   // Clear the remote store to indicate terminate is complete.
@@ -304,13 +632,85 @@ void FirestoreClient::ScheduleLruGarbageCollection() {
       gc_has_run_ ? regular_gc_delay_ : initial_gc_delay_;
 
   lru_callback_ = worker_queue_->EnqueueAfterDelay(
-      delay, TimerId::GarbageCollectionDelay, [this] {
-        local_store_->CollectGarbage(lru_delegate_->garbage_collector());
-        gc_has_run_ = true;
-        ScheduleLruGarbageCollection();
+      delay, TimerId::GarbageCollectionDelay,
+      [this] { RunLruGarbageCollectionSlice(); });
+}
+
+void FirestoreClient::RunLruGarbageCollectionSlice() {
+  LruResults results = local_store_->CollectGarbageSlice(
+      lru_delegate_->garbage_collector(), gc_slice_budget_);
+  if (!results.finished) {
+    // Queue the next slice behind the work that piled up during this one.
+    lru_callback_ = worker_queue_->EnqueueAfterDelay(
+        std::chrono::milliseconds(0), TimerId::GarbageCollectionDelay,
+        [this] { RunLruGarbageCollectionSlice(); });
+    return;
+  }
+
+  gc_has_run_ = true;
+  ScheduleLruGarbageCollection();
+}
+
+void FirestoreClient::ScheduleResumeTokenPersistence() {
+  resume_token_callback_ = worker_queue_->EnqueueAfterDelay(
+      resume_token_persistence_delay_, TimerId::ResumeTokenPersistence,
+      [this] {
+        size_t count = local_store_->PersistResumeTokens();
+        LOG_DEBUG("Persisted the resume tokens of %s targets", count);
+        ScheduleResumeTokenPersistence();
       });
 }
 
+void FirestoreClient::EnableMemorySnapshots(MemoryPersistence* persistence,
+                                            std::chrono::seconds interval) {
+  StatusOr<Path> data_dir = LevelDbOpener(database_info_).LevelDbDataDir();
+  if (!data_dir.ok()) {
+    LOG_WARN("Memory snapshots are disabled: %s",
+             data_dir.status().ToString());
+    return;
+  }
+
+  memory_snapshot_path_ =
+      data_dir.ValueOrDie().AppendUtf8(kMemorySnapshotFileName);
+  memory_snapshot_ = absl::make_unique<MemorySnapshot>(
+      LocalSerializer(remote::Serializer(database_info_.database_id())));
+
+  Status loaded = memory_snapshot_->Load(memory_snapshot_path_, persistence);
+  if (!loaded.ok() && loaded.code() != Error::kErrorNotFound) {
+    LOG_WARN("Failed to load the memory snapshot: %s", loaded.ToString());
+  }
+
+  memory_persistence_ = persistence;
+  memory_snapshot_delay_ = interval;
+  snapshot_executor_ = Executor::CreateSerial(
+      "com.google.firebase.firestore.snapshot", Executor::Priority::Utility);
+  ScheduleMemorySnapshot();
+}
+
+void FirestoreClient::ScheduleMemorySnapshot() {
+  memory_snapshot_callback_ = worker_queue_->EnqueueAfterDelay(
+      memory_snapshot_delay_, TimerId::MemorySnapshot, [this] {
+        WriteMemorySnapshot();
+        ScheduleMemorySnapshot();
+      });
+}
+
+void FirestoreClient::WriteMemorySnapshot() {
+  // Resume tokens are only written to the target cache periodically, and the
+  // snapshot should include the latest ones.
+  local_store_->PersistResumeTokens();
+
+  auto data = std::make_shared<std::string>(
+      memory_snapshot_->Encode(memory_persistence_));
+  Path path = memory_snapshot_path_;
+  snapshot_executor_->Execute([path, data] {
+    Status status = MemorySnapshot::Write(path, *data);
+    if (!status.ok()) {
+      LOG_WARN("Failed to write the memory snapshot: %s", status.ToString());
+    }
+  });
+}
+
 void FirestoreClient::DisableNetwork(StatusCallback callback) {
   VerifyNotTerminated();
 
@@ -333,6 +733,15 @@ void FirestoreClient::EnableNetwork(StatusCallback callback) {
   });
 }
 
+void FirestoreClient::RecordWatchStream(
+    std::shared_ptr<remote::WatchStreamRecorder> recorder) {
+  VerifyNotTerminated();
+
+  worker_queue_->Enqueue([this, recorder] {
+    remote_store_->set_watch_stream_recorder(recorder);
+  });
+}
+
 void FirestoreClient::WaitForPendingWrites(StatusCallback callback) {
   VerifyNotTerminated();
 
@@ -344,10 +753,33 @@ void FirestoreClient::WaitForPendingWrites(StatusCallback callback) {
   };
 
   worker_queue_->Enqueue([this, async_callback] {
+    FlushCoalescedWrites();
     sync_engine_->RegisterPendingWritesCallback(std::move(async_callback));
   });
 }
 
+void FirestoreClient::HandleMemoryPressure(util::MemoryPressure pressure,
+                                           MemoryReleaseCallback callback) {
+  // Memory warnings may arrive at any time, so this doesn't throw once the
+  // client is terminated. The local store is gone by the time the task would
+  // run anyway.
+  if (is_terminated()) return;
+
+  worker_queue_->Enqueue([this, pressure, callback] {
+    size_t bytes_released = local_store_->ReleaseMemory(pressure);
+    size_t views_released = 0;
+    if (pressure == util::MemoryPressure::Critical) {
+      views_released = sync_engine_->ReleaseLingeringQueries();
+    }
+    LOG_DEBUG("Released %s bytes of caches and %s idle views", bytes_released,
+              views_released);
+
+    if (callback) {
+      user_executor_->Execute([=] { callback(bytes_released); });
+    }
+  });
+}
+
 void FirestoreClient::VerifyNotTerminated() {
   if (is_terminated()) {
     ThrowIllegalState("The client has already been terminated.");
@@ -367,10 +799,12 @@ std::shared_ptr<QueryListener> FirestoreClient::ListenToQuery(
     Query query, ListenOptions options, ViewSnapshotSharedListener&& listener) {
   VerifyNotTerminated();
 
-  auto query_listener = QueryListener::Create(
-      std::move(query), std::move(options), std::move(listener));
+  auto query_listener =
+      QueryListener::Create(std::move(query), std::move(options),
+                            std::move(listener), worker_queue_);
 
   worker_queue_->Enqueue([this, query_listener] {
+    FlushCoalescedWrites();
     event_manager_->AddQueryListener(std::move(query_listener));
   });
 
@@ -394,38 +828,152 @@ void FirestoreClient::GetDocumentFromLocalCache(
 
   // TODO(c++14): move `callback` into lambda.
   auto shared_callback = absl::ShareUniquePtr(std::move(callback));
-  worker_queue_->Enqueue([this, doc, shared_callback] {
+  auto read = [this, doc, shared_callback](bool from_snapshot) {
     absl::optional<MaybeDocument> maybe_document =
-        local_store_->ReadDocument(doc.key());
-    StatusOr<DocumentSnapshot> maybe_snapshot;
-
-    if (maybe_document && maybe_document->is_document()) {
-      Document document(*maybe_document);
-      maybe_snapshot = DocumentSnapshot::FromDocument(
-          doc.firestore(), document,
-          SnapshotMetadata{
-              /*has_pending_writes=*/document.has_local_mutations(),
-              /*from_cache=*/true});
-    } else if (maybe_document && maybe_document->is_no_document()) {
-      maybe_snapshot = DocumentSnapshot::FromNoDocument(
-          doc.firestore(), doc.key(),
-          SnapshotMetadata{/*has_pending_writes=*/false,
-                           /*from_cache=*/true});
-    } else {
-      maybe_snapshot =
-          Status{Error::kErrorUnavailable,
-                 "Failed to get document from cache. (However, this document "
-                 "may exist on the server. Run again without setting source to "
-                 "FirestoreSourceCache to attempt to retrieve the document "};
-    }
+        from_snapshot ? local_store_->ReadDocumentFromSnapshot(doc.key())
+                      : local_store_->ReadDocument(doc.key());
+    StatusOr<DocumentSnapshot> maybe_snapshot =
+        MakeCachedDocumentSnapshot(doc, maybe_document);
 
     if (shared_callback) {
       user_executor_->Execute(
           [=] { shared_callback->OnEvent(std::move(maybe_snapshot)); });
     }
+  };
+
+  worker_queue_->Enqueue([this, read] {
+    FlushCoalescedWrites();
+    RunLocalRead(read);
   });
 }
 
+void FirestoreClient::GetAllDocuments(std::vector<DocumentReference> docs,
+                                      Source source,
+                                      DocumentSnapshotsListener&& callback) {
+  VerifyNotTerminated();
+
+  // TODO(c++14): move `callback` into lambda.
+  auto shared_callback = absl::ShareUniquePtr(std::move(callback));
+  auto deliver = [this, shared_callback](
+                     StatusOr<std::vector<DocumentSnapshot>> result) {
+    if (shared_callback) {
+      user_executor_->Execute(
+          [=] { shared_callback->OnEvent(std::move(result)); });
+    }
+  };
+
+  DocumentKeySet keys;
+  for (const DocumentReference& doc : docs) {
+    keys = keys.insert(doc.key());
+  }
+
+  auto read_locally = [this, docs, keys, deliver] {
+    FlushCoalescedWrites();
+    RunLocalRead([this, docs, keys, deliver](bool from_snapshot) {
+      OptionalMaybeDocumentMap found =
+          from_snapshot ? local_store_->ReadDocumentsFromSnapshot(keys)
+                        : local_store_->ReadDocuments(keys);
+
+      std::vector<DocumentSnapshot> snapshots;
+      snapshots.reserve(docs.size());
+      for (const DocumentReference& doc : docs) {
+        auto entry = found.find(doc.key());
+        StatusOr<DocumentSnapshot> maybe_snapshot = MakeCachedDocumentSnapshot(
+            doc, entry != found.end() ? entry->second
+                                      : absl::optional<MaybeDocument>());
+        if (!maybe_snapshot.ok()) {
+          deliver(maybe_snapshot.status());
+          return;
+        }
+        snapshots.push_back(std::move(maybe_snapshot).ValueOrDie());
+      }
+      deliver(std::move(snapshots));
+    });
+  };
+
+  worker_queue_->Enqueue([this, docs, keys, source, deliver, read_locally] {
+    if (source == Source::Cache ||
+        (source == Source::Default && !remote_store_->CanUseNetwork())) {
+      read_locally();
+      return;
+    }
+    LookupAllDocuments(docs, keys, source, deliver, read_locally);
+  });
+}
+
+void FirestoreClient::LookupAllDocuments(
+    const std::vector<DocumentReference>& docs,
+    const DocumentKeySet& keys,
+    Source source,
+    const StatusOrCallback<std::vector<DocumentSnapshot>>& deliver,
+    const std::function<void()>& read_locally) {
+  // The results of all the lookups, gathered on the worker queue.
+  struct Lookup {
+    size_t pending_batches = 0;
+    bool failed = false;
+    std::unordered_map<DocumentKey, MaybeDocument, DocumentKeyHash> found;
+  };
+  auto lookup = std::make_shared<Lookup>();
+
+  auto finish = [docs, lookup, deliver] {
+    std::vector<DocumentSnapshot> snapshots;
+    snapshots.reserve(docs.size());
+    for (const DocumentReference& doc : docs) {
+      auto entry = lookup->found.find(doc.key());
+      SnapshotMetadata metadata{/*has_pending_writes=*/false,
+                                /*from_cache=*/false};
+      if (entry != lookup->found.end() && entry->second.is_document()) {
+        snapshots.push_back(DocumentSnapshot::FromDocument(
+            doc.firestore(), Document(entry->second), std::move(metadata)));
+      } else {
+        snapshots.push_back(DocumentSnapshot::FromNoDocument(
+            doc.firestore(), doc.key(), std::move(metadata)));
+      }
+    }
+    deliver(std::move(snapshots));
+  };
+
+  std::vector<std::vector<DocumentKey>> batches;
+  for (const DocumentKey& key : keys) {
+    if (batches.empty() || batches.back().size() == kMaxLookupBatchSize) {
+      batches.emplace_back();
+    }
+    batches.back().push_back(key);
+  }
+  if (batches.empty()) {
+    finish();
+    return;
+  }
+
+  lookup->pending_batches = batches.size();
+  for (const std::vector<DocumentKey>& batch : batches) {
+    remote_store_->LookupDocuments(
+        batch, [lookup, source, deliver, read_locally, finish](
+                   const StatusOr<std::vector<MaybeDocument>>& result) {
+          if (lookup->failed) return;
+
+          if (!result.ok()) {
+            // Report the first failure only, and ignore the other batches.
+            lookup->failed = true;
+            if (source == Source::Default &&
+                result.status().code() == Error::kErrorUnavailable) {
+              read_locally();
+            } else {
+              deliver(result.status());
+            }
+            return;
+          }
+
+          for (const MaybeDocument& doc : result.ValueOrDie()) {
+            lookup->found.emplace(doc.key(), doc);
+          }
+          if (--lookup->pending_batches == 0) {
+            finish();
+          }
+        });
+  }
+}
+
 void FirestoreClient::GetDocumentsFromLocalCache(
     const api::Query& query, QuerySnapshotListener&& callback) {
   VerifyNotTerminated();
@@ -433,33 +981,265 @@ void FirestoreClient::GetDocumentsFromLocalCache(
   // TODO(c++14): move `callback` into lambda.
   auto shared_callback = absl::ShareUniquePtr(std::move(callback));
   worker_queue_->Enqueue([this, query, shared_callback] {
-    QueryResult query_result = local_store_->ExecuteQuery(
-        query.query(), /* use_previous_results= */ true);
+    ReadDocumentsFromLocalCache(query, shared_callback);
+  });
+}
 
-    View view(query.query(), query_result.remote_keys());
-    ViewDocumentChanges view_doc_changes =
-        view.ComputeDocumentChanges(query_result.documents().underlying_map());
-    ViewChange view_change = view.ApplyChanges(view_doc_changes);
-    HARD_ASSERT(
-        view_change.limbo_changes().empty(),
-        "View returned limbo documents during local-only query execution.");
+bool FirestoreClient::HasRecentlySyncedResults(const Query& query) const {
+  return synced_query_tracker_ && synced_query_tracker_->IsFresh(query);
+}
 
-    HARD_ASSERT(view_change.snapshot().has_value(), "Expected a snapshot");
+void FirestoreClient::GetRecentlySyncedDocuments(
+    const api::Query& query, QuerySnapshotListener&& callback) {
+  VerifyNotTerminated();
 
-    ViewSnapshot snapshot = std::move(view_change.snapshot()).value();
+  // TODO(c++14): move `callback` into lambda.
+  auto shared_callback = absl::ShareUniquePtr(std::move(callback));
+  worker_queue_->Enqueue([this, query, shared_callback] {
+    ReadDocumentsFromLocalCache(query, shared_callback, /*from_cache=*/false);
+  });
+}
+
+void FirestoreClient::ReadDocumentsFromLocalCache(
+    const api::Query& query,
+    const std::shared_ptr<EventListener<QuerySnapshot>>& callback,
+    bool from_cache) {
+  auto read = [this, query, callback, from_cache](bool from_snapshot) {
+    QueryResult query_result =
+        from_snapshot
+            ? local_store_->ExecuteQueryFromSnapshot(query.query())
+            : local_store_->ExecuteQuery(query.query(),
+                                         /* use_previous_results= */ true);
+
+    ViewSnapshot snapshot = MakeLocalReadSnapshot(
+        query.query(), query_result.documents(), from_cache);
     SnapshotMetadata metadata(snapshot.has_pending_writes(),
                               snapshot.from_cache());
 
     QuerySnapshot result(query.firestore(), query.query(), std::move(snapshot),
                          std::move(metadata));
 
+    if (callback) {
+      user_executor_->Execute([=] { callback->OnEvent(std::move(result)); });
+    }
+  };
+
+  FlushCoalescedWrites();
+  RunLocalRead(read);
+}
+
+void FirestoreClient::GetDocumentsFromServer(const api::Query& query,
+                                             Source source,
+                                             QuerySnapshotListener&& callback) {
+  VerifyNotTerminated();
+
+  // TODO(c++14): move `callback` into lambda.
+  auto shared_callback = absl::ShareUniquePtr(std::move(callback));
+  auto deliver = [this, shared_callback](StatusOr<QuerySnapshot> result) {
     if (shared_callback) {
       user_executor_->Execute(
           [=] { shared_callback->OnEvent(std::move(result)); });
     }
+  };
+  auto on_result = [this, query, source, shared_callback, deliver](
+                       const StatusOr<Datastore::RunQueryResult>& result) {
+    if (!result.ok()) {
+      if (source == Source::Default &&
+          result.status().code() == Error::kErrorUnavailable) {
+        ReadDocumentsFromLocalCache(query, shared_callback);
+      } else {
+        deliver(result.status());
+      }
+      return;
+    }
+
+    auto documents = std::make_shared<const std::vector<Document>>(
+        result.ValueOrDie().documents);
+    DocumentKeySet keys;
+    for (const Document& doc : *documents) {
+      keys = keys.insert(doc.key());
+    }
+
+    if (query.query().projection()) {
+      // Projected documents are partial, so they can't be cached or have local
+      // writes applied to them.
+      MaybeDocumentMap docs;
+      for (const Document& doc : *documents) {
+        docs = docs.insert(doc.key(), doc);
+      }
+      deliver(MakeServerQuerySnapshot(query, docs, std::move(keys)));
+      return;
+    }
+
+    auto on_applied = [this, query, documents, keys, deliver] {
+      FlushCoalescedWrites();
+      MaybeDocumentMap docs =
+          local_store_->GetLocalViewOfQueryResults(query.query(), *documents);
+      deliver(MakeServerQuerySnapshot(query, docs, keys));
+    };
+    ApplyQueryResults(documents, result.ValueOrDie().read_time, 0, on_applied);
+  };
+
+  worker_queue_->Enqueue([this, query, source, shared_callback, on_result] {
+    if (source == Source::Default && !remote_store_->CanUseNetwork()) {
+      ReadDocumentsFromLocalCache(query, shared_callback);
+      return;
+    }
+    remote_store_->RunQuery(query.query(), on_result);
   });
 }
 
+void FirestoreClient::LoadPartitionedQuery(const Query& query,
+                                           size_t partition_count,
+                                           StatusCallback callback) {
+  VerifyNotTerminated();
+
+  std::vector<Query> partitions =
+      query.Partition(database_info_.database_id(), partition_count);
+
+  // Only touched on the worker queue.
+  struct Progress {
+    size_t remaining;
+    Status status;
+  };
+  auto progress = std::make_shared<Progress>(Progress{partitions.size(), {}});
+  auto on_loaded = [this, progress, callback](const Status& status) {
+    if (progress->status.ok()) {
+      progress->status = status;
+    }
+    if (--progress->remaining == 0 && callback) {
+      Status result = progress->status;
+      user_executor_->Execute([=] { callback(result); });
+    }
+  };
+  auto on_result = [this, on_loaded](
+                       const StatusOr<Datastore::RunQueryResult>& result) {
+    if (!result.ok()) {
+      on_loaded(result.status());
+      return;
+    }
+    auto documents = std::make_shared<const std::vector<Document>>(
+        result.ValueOrDie().documents);
+    ApplyQueryResults(documents, result.ValueOrDie().read_time, 0,
+                      [on_loaded] { on_loaded(Status::OK()); });
+  };
+
+  worker_queue_->Enqueue([this, partitions, on_result] {
+    // The calls run concurrently, and each partition is written to the cache
+    // in batches as soon as its results are in.
+    for (const Query& partition : partitions) {
+      remote_store_->RunQuery(partition, on_result);
+    }
+  });
+}
+
+void FirestoreClient::ApplyQueryResults(
+    const std::shared_ptr<const std::vector<Document>>& documents,
+    const SnapshotVersion& read_time,
+    size_t offset,
+    const std::function<void()>& on_applied) {
+  size_t end = std::min(offset + kMaxQueryResultsBatchSize, documents->size());
+  if (offset != end) {
+    sync_engine_->ApplyQueryResults(
+        std::vector<Document>(documents->begin() + offset,
+                              documents->begin() + end),
+        read_time);
+  }
+
+  if (end == documents->size()) {
+    on_applied();
+    return;
+  }
+
+  // Let other work run between the batches.
+  worker_queue_->EnqueueRelaxed([this, documents, read_time, end, on_applied] {
+    ApplyQueryResults(documents, read_time, end, on_applied);
+  });
+}
+
+void FirestoreClient::RunCountQuery(const Query& query,
+                                    Source source,
+                                    CountListener&& callback) {
+  VerifyNotTerminated();
+
+  // TODO(c++14): move `callback` into lambda.
+  auto shared_callback = absl::ShareUniquePtr(std::move(callback));
+  auto deliver = [this, shared_callback](StatusOr<int64_t> result) {
+    if (shared_callback) {
+      user_executor_->Execute(
+          [=] { shared_callback->OnEvent(std::move(result)); });
+    }
+  };
+  auto count_locally = [this, query, deliver] {
+    FlushCoalescedWrites();
+    RunLocalRead([this, query, deliver](bool) {
+      deliver(local_store_->CountQuery(query));
+    });
+  };
+
+  worker_queue_->Enqueue([this, query, source, deliver, count_locally] {
+    if (source == Source::Cache ||
+        (source == Source::Default && !remote_store_->CanUseNetwork())) {
+      count_locally();
+      return;
+    }
+
+    remote_store_->RunCountQuery(
+        query, [source, deliver, count_locally](
+                   const StatusOr<int64_t>& result) {
+          if (!result.ok() && source == Source::Default &&
+              result.status().code() == Error::kErrorUnavailable) {
+            count_locally();
+          } else {
+            deliver(result);
+          }
+        });
+  });
+}
+
+void FirestoreClient::PrefetchQueries(std::vector<Query> queries) {
+  VerifyNotTerminated();
+
+  worker_queue_->Enqueue([this, queries] {
+    if (!reader_executor_) return;
+
+    FlushCoalescedWrites();
+    uint64_t version = local_store_->query_results_version();
+    RunLocalRead([this, queries, version](bool) {
+      for (const Query& query : queries) {
+        QueryResult result = local_store_->ExecuteQueryFromSnapshot(query);
+        // Results that arrive after a change to the cache are dropped.
+        worker_queue_->EnqueueRelaxed([this, query, result, version] {
+          local_store_->AddPrefetchedResult(query, result, version);
+        });
+      }
+    });
+  });
+}
+
+void FirestoreClient::RunLocalRead(std::function<void(bool)> read) {
+  worker_queue_->VerifyIsCurrentQueue();
+
+  if (reader_executor_) {
+    // The read takes its snapshot when it starts running, so it still sees
+    // all writes committed before it was scheduled, once they're written out.
+    persistence_->FlushDeferredCommits();
+    reader_executor_->Execute([read] { read(/* from_snapshot= */ true); });
+  } else {
+    read(/* from_snapshot= */ false);
+  }
+}
+
+void FirestoreClient::AwaitLocalReads() {
+  worker_queue_->VerifyIsCurrentQueue();
+
+  if (reader_executor_) {
+    // The reader executor is serial, so this returns once all earlier reads
+    // have completed.
+    reader_executor_->ExecuteBlocking([] {});
+  }
+}
+
 void FirestoreClient::WriteMutations(std::vector<Mutation>&& mutations,
                                      StatusCallback callback) {
   VerifyNotTerminated();
@@ -471,17 +1251,57 @@ void FirestoreClient::WriteMutations(std::vector<Mutation>&& mutations,
         user_executor_->Execute([=] { callback(Status::OK()); });
       }
     } else {
-      sync_engine_->WriteMutations(
-          std::move(mutations), [this, callback](Status error) {
-            // Dispatch the result back onto the user dispatch queue.
-            if (callback) {
-              user_executor_->Execute([=] { callback(std::move(error)); });
-            }
-          });
+      auto async_callback = [this, callback](Status error) {
+        // Dispatch the result back onto the user dispatch queue.
+        if (callback) {
+          user_executor_->Execute([=] { callback(std::move(error)); });
+        }
+      };
+      if (write_coalescing_enabled_) {
+        CoalesceWrite(std::move(mutations), std::move(async_callback));
+      } else {
+        sync_engine_->WriteMutations(std::move(mutations),
+                                     std::move(async_callback));
+      }
     }
   });
 }
 
+void FirestoreClient::CommitMutations(std::vector<Mutation>&& mutations,
+                                      StatusCallback callback) {
+  VerifyNotTerminated();
+
+  // TODO(c++14): move `mutations` into lambda (C++14).
+  worker_queue_->Enqueue([this, mutations, callback] {
+    remote_store_->CommitMutations(mutations, [this, callback](Status status) {
+      // Dispatch the result back onto the user dispatch queue.
+      if (callback) {
+        user_executor_->Execute([=] { callback(std::move(status)); });
+      }
+    });
+  });
+}
+
+void FirestoreClient::CoalesceWrite(std::vector<Mutation>&& mutations,
+                                    StatusCallback callback) {
+  coalesced_batches_.push_back(std::move(mutations));
+  coalesced_callbacks_.push_back(std::move(callback));
+  if (coalesced_batches_.size() == 1) {
+    // Writes that are already enqueued run before this flush and join it.
+    worker_queue_->EnqueueRelaxed([this] { FlushCoalescedWrites(); });
+  }
+}
+
+void FirestoreClient::FlushCoalescedWrites() {
+  if (coalesced_batches_.empty()) return;
+
+  std::vector<std::vector<Mutation>> batches;
+  std::vector<StatusCallback> callbacks;
+  std::swap(batches, coalesced_batches_);
+  std::swap(callbacks, coalesced_callbacks_);
+  sync_engine_->WriteMutations(std::move(batches), std::move(callbacks));
+}
+
 void FirestoreClient::Transaction(int retries,
                                   TransactionUpdateCallback update_callback,
                                   TransactionResultCallback result_callback) {
@@ -495,6 +1315,7 @@ void FirestoreClient::Transaction(int retries,
   };
 
   worker_queue_->Enqueue([this, retries, update_callback, async_callback] {
+    FlushCoalescedWrites();
     sync_engine_->Transaction(retries, worker_queue_,
                               std::move(update_callback),
                               std::move(async_callback));
@@ -515,6 +1336,45 @@ void FirestoreClient::RemoveSnapshotsInSyncListener(
   });
 }
 
+void FirestoreClient::AttachBundle(const Path& path,
+                                   StatusCallback callback) {
+  VerifyNotTerminated();
+
+  worker_queue_->Enqueue([this, path, callback] {
+    Status status;
+    if (!leveldb_document_cache_) {
+      status = Status{Error::kErrorFailedPrecondition,
+                      "Attaching bundles requires persistence to be enabled"};
+    } else {
+      StatusOr<std::unique_ptr<BundleDocumentSource>> opened =
+          BundleDocumentSource::Open(
+              path, bundle::BundleSerializer(
+                        remote::Serializer(database_info_.database_id())));
+      status = opened.status();
+      if (status.ok()) {
+        std::unique_ptr<BundleDocumentSource> source =
+            std::move(opened).ValueOrDie();
+        // Collection group queries find collections through the collection
+        // parent index.
+        persistence_->Run("Attach bundle", [&] {
+          for (const ResourcePath& collection_path :
+               source->GetCollectionPaths()) {
+            persistence_->index_manager()->AddToCollectionParentIndex(
+                collection_path);
+          }
+        });
+
+        AwaitLocalReads();
+        leveldb_document_cache_->AttachBundleDocumentSource(std::move(source));
+      }
+    }
+
+    if (callback) {
+      user_executor_->Execute([=] { callback(status); });
+    }
+  });
+}
+
 void FirestoreClient::LoadBundle(
     std::unique_ptr<util::ByteStream> bundle_data,
     std::shared_ptr<api::LoadBundleTask> result_task) {
@@ -525,7 +1385,27 @@ void FirestoreClient::LoadBundle(
   auto reader = std::make_shared<bundle::BundleReader>(
       std::move(bundle_serializer), std::move(bundle_data));
   worker_queue_->Enqueue([this, reader, result_task] {
-    sync_engine_->LoadBundle(std::move(reader), std::move(result_task));
+    FlushCoalescedWrites();
+
+    if (!bundle_executor_) {
+      // The reading task occupies one thread, so use at least two.
+      auto threads = std::max(std::thread::hardware_concurrency(), 2u);
+      bundle_executor_ = Executor::CreateConcurrent(
+          "com.google.firebase.firestore.bundle", static_cast<int>(threads),
+          Executor::Priority::Utility);
+    }
+
+    auto pipeline = std::make_shared<BundleLoadPipeline>(
+        reader, sync_engine_.get(), local_store_.get(), worker_queue_,
+        bundle_executor_.get(), result_task);
+    bundle_pipelines_.erase(
+        std::remove_if(bundle_pipelines_.begin(), bundle_pipelines_.end(),
+                       [](const std::weak_ptr<BundleLoadPipeline>& weak) {
+                         return weak.expired();
+                       }),
+        bundle_pipelines_.end());
+    bundle_pipelines_.push_back(pipeline);
+    pipeline->Start();
   });
 }
 
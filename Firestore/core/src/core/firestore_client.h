@@ -17,6 +17,7 @@
 #ifndef FIRESTORE_CORE_SRC_CORE_FIRESTORE_CLIENT_H_
 #define FIRESTORE_CORE_SRC_CORE_FIRESTORE_CLIENT_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,13 +27,17 @@
 #include "Firestore/core/src/bundle/bundle_serializer.h"
 #include "Firestore/core/src/core/core_fwd.h"
 #include "Firestore/core/src/core/database_info.h"
+#include "Firestore/core/src/local/transaction_stats.h"
 #include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/model_fwd.h"
 #include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/byte_stream.h"
 #include "Firestore/core/src/util/delayed_constructor.h"
 #include "Firestore/core/src/util/empty.h"
 #include "Firestore/core/src/util/executor.h"
+#include "Firestore/core/src/util/memory_pressure.h"
 #include "Firestore/core/src/util/nullability.h"
+#include "Firestore/core/src/util/path.h"
 #include "Firestore/core/src/util/status_fwd.h"
 
 namespace firebase {
@@ -44,10 +49,14 @@ class User;
 }  // namespace auth
 
 namespace local {
+class LevelDbRemoteDocumentCache;
 class LocalStore;
 class LruDelegate;
+class MemoryPersistence;
+class MemorySnapshot;
 class Persistence;
 class QueryEngine;
+class Sizer;
 }  // namespace local
 
 namespace model {
@@ -58,6 +67,7 @@ namespace remote {
 class ConnectivityMonitor;
 class FirebaseMetadataProvider;
 class RemoteStore;
+class WatchStreamRecorder;
 }  // namespace remote
 
 namespace core {
@@ -107,12 +117,26 @@ class FirestoreClient : public std::enable_shared_from_this<FirestoreClient> {
    */
   void WaitForPendingWrites(util::StatusCallback callback);
 
+  /**
+   * Discards caches of persisted data and, under critical pressure, the views
+   * kept for queries that are no longer listened to. The callback, if any, is
+   * passed an estimate of the bytes released by the caches.
+   */
+  void HandleMemoryPressure(util::MemoryPressure pressure,
+                            core::MemoryReleaseCallback callback);
+
   /** Disables the network connection. Pending operations will not complete. */
   void DisableNetwork(util::StatusCallback callback);
 
   /** Enables the network connection and requeues all pending operations. */
   void EnableNetwork(util::StatusCallback callback);
 
+  /**
+   * Records the messages of the watch stream into `recorder` from now on, so
+   * that they can be replayed in benchmarks, or stops recording if it's null.
+   */
+  void RecordWatchStream(std::shared_ptr<remote::WatchStreamRecorder> recorder);
+
   /** Starts listening to a query. */
   std::shared_ptr<QueryListener> ListenToQuery(
       Query query,
@@ -129,6 +153,18 @@ class FirestoreClient : public std::enable_shared_from_this<FirestoreClient> {
   void GetDocumentFromLocalCache(const api::DocumentReference& doc,
                                  api::DocumentSnapshotListener&& callback);
 
+  /**
+   * Retrieves the given documents via the indicated callback, in the order
+   * they are given. Server reads look the documents up in batched
+   * BatchGetDocuments calls, and return them as stored on the backend, without
+   * the local writes pending for them. Cache reads look all of them up at
+   * once, and fail if any of them isn't cached. With `Source::Default`, the
+   * documents are read from the cache if the network is unavailable.
+   */
+  void GetAllDocuments(std::vector<api::DocumentReference> docs,
+                       api::Source source,
+                       api::DocumentSnapshotsListener&& callback);
+
   /**
    * Retrieves a (possibly empty) set of documents from the cache via the
    * indicated callback.
@@ -136,6 +172,65 @@ class FirestoreClient : public std::enable_shared_from_this<FirestoreClient> {
   void GetDocumentsFromLocalCache(const api::Query& query,
                                   api::QuerySnapshotListener&& callback);
 
+  /**
+   * Returns true if a listen to `query` stopped while in sync with the backend
+   * recently enough for `GetRecentlySyncedDocuments` to serve a one-shot get
+   * of it. Always false unless the query result cache is enabled in the
+   * settings. Can be called from any thread.
+   */
+  bool HasRecentlySyncedResults(const core::Query& query) const;
+
+  /**
+   * Retrieves the documents of a recently synced query from the cache via the
+   * indicated callback, reporting them as not from cache.
+   */
+  void GetRecentlySyncedDocuments(const api::Query& query,
+                                  api::QuerySnapshotListener&& callback);
+
+  /**
+   * Counts the documents matching the query via the indicated callback. With
+   * `Source::Default`, the count comes from the backend, unless the network is
+   * unavailable, in which case the documents are counted in the local cache
+   * instead.
+   */
+  void RunCountQuery(const core::Query& query,
+                     api::Source source,
+                     api::CountListener&& callback);
+
+  /**
+   * Runs the query against the backend once with a streaming RunQuery call,
+   * without listening to it, and delivers the results via the indicated
+   * callback, with pending local writes applied. The results are written to
+   * the local cache in batches, except for projected queries, for which the
+   * backend only sends the needed fields. With `Source::Default`, the results
+   * come from the local cache instead if the network is unavailable.
+   */
+  void GetDocumentsFromServer(const api::Query& query,
+                              api::Source source,
+                              api::QuerySnapshotListener&& callback);
+
+  /**
+   * Reads the results of the query from the backend into the local cache,
+   * split into `partition_count` ranges of document IDs that are read with
+   * concurrent RunQuery calls. callback will be notified once the results of
+   * all the ranges are in the cache, or with the first error.
+   */
+  void LoadPartitionedQuery(const core::Query& query,
+                            size_t partition_count,
+                            util::StatusCallback callback);
+
+  /**
+   * Computes the results of the given queries from the local cache ahead of
+   * time, so that the first listener for each of them gets its initial
+   * snapshot without executing the query. Meant to be called right after the
+   * client is created, with the queries the app listens to on startup.
+   *
+   * The results are computed off the worker queue, and are dropped if the
+   * cache changes before they're used. If the local store doesn't support
+   * concurrent reads, this does nothing.
+   */
+  void PrefetchQueries(std::vector<core::Query> queries);
+
   /**
    * Write mutations. callback will be notified when it's written to the
    * backend.
@@ -143,6 +238,15 @@ class FirestoreClient : public std::enable_shared_from_this<FirestoreClient> {
   void WriteMutations(std::vector<model::Mutation>&& mutations,
                       util::StatusCallback callback);
 
+  /**
+   * Commits the mutations to the backend in a single request without adding
+   * them to the local store: they don't show up locally until the backend
+   * sends them, and they're lost if the request fails. callback will be
+   * notified with the result of the request.
+   */
+  void CommitMutations(std::vector<model::Mutation>&& mutations,
+                       util::StatusCallback callback);
+
   /**
    * Tries to execute the transaction in update_callback up to retries times.
    */
@@ -176,11 +280,31 @@ class FirestoreClient : public std::enable_shared_from_this<FirestoreClient> {
     return user_executor_;
   }
 
+  /**
+   * Attaches the bundle file at the given path as a read-only source of
+   * documents behind the LevelDB cache, so that its documents can be queried
+   * without loading the bundle. Documents the client receives from the backend
+   * shadow the attached ones. Requires persistence to be enabled.
+   *
+   * Listeners and prefetched queries don't see the attached documents until
+   * the affected documents next change, so this should be called before they're
+   * set up.
+   */
+  void AttachBundle(const util::Path& path, util::StatusCallback callback);
+
   void LoadBundle(std::unique_ptr<util::ByteStream> bundle_data,
                   std::shared_ptr<api::LoadBundleTask> result_task);
 
   void GetNamedQuery(const std::string& name, api::QueryCallback callback);
 
+  /**
+   * Durations and counters of the local store's transactions, by label. Can be
+   * read from any thread.
+   */
+  std::shared_ptr<const local::TransactionStats> transaction_stats() const {
+    return transaction_stats_;
+  }
+
   /** For usage in this class and testing only. */
   const std::shared_ptr<util::AsyncQueue>& worker_queue() const {
     return worker_queue_;
@@ -202,8 +326,100 @@ class FirestoreClient : public std::enable_shared_from_this<FirestoreClient> {
 
   void TerminateInternal();
 
+  /**
+   * Queues the given write to be committed together with the other writes
+   * queued during the current turn of the worker queue.
+   */
+  void CoalesceWrite(std::vector<model::Mutation>&& mutations,
+                     util::StatusCallback callback);
+
+  /**
+   * Commits the writes queued by `CoalesceWrite`, if any. Operations that
+   * depend on earlier writes having been applied locally call this first.
+   */
+  void FlushCoalescedWrites();
+
+  /**
+   * Runs a read of the local cache. If the local store supports concurrent
+   * reads, the read runs on `reader_executor_` against a snapshot of the cache
+   * (and `read` is passed true), so that long reads don't hold up the worker
+   * queue. Otherwise it runs immediately.
+   */
+  void RunLocalRead(std::function<void(bool)> read);
+
+  /**
+   * Reads the documents matching the query from the local cache and delivers
+   * them via the indicated callback, with the given `from_cache` metadata.
+   * Must be called on the worker queue.
+   */
+  void ReadDocumentsFromLocalCache(
+      const api::Query& query,
+      const std::shared_ptr<EventListener<api::QuerySnapshot>>& callback,
+      bool from_cache = true);
+
+  /**
+   * Applies the documents returned for a one-shot query from `offset` on to
+   * the local store, in batches that each run as a separate worker queue task,
+   * then calls `on_applied`. Must be called on the worker queue.
+   */
+  void ApplyQueryResults(
+      const std::shared_ptr<const std::vector<model::Document>>& documents,
+      const model::SnapshotVersion& read_time,
+      size_t offset,
+      const std::function<void()>& on_applied);
+
+  /**
+   * Looks up the server versions of `keys`, the keys of `docs`, in batches,
+   * and delivers the snapshots of `docs` once all the batches are done. If a
+   * batch fails, reads the documents locally instead when `source` allows it.
+   * Must be called on the worker queue.
+   */
+  void LookupAllDocuments(
+      const std::vector<api::DocumentReference>& docs,
+      const model::DocumentKeySet& keys,
+      api::Source source,
+      const util::StatusOrCallback<std::vector<api::DocumentSnapshot>>& deliver,
+      const std::function<void()>& read_locally);
+
+  /**
+   * Waits for all reads started by `RunLocalRead` to complete. Must be called
+   * before any operation that would invalidate the state they read.
+   */
+  void AwaitLocalReads();
+
   void ScheduleLruGarbageCollection();
 
+  /**
+   * Schedules a callback that persists the resume tokens of active targets.
+   * Reschedules itself after it has run.
+   */
+  void ScheduleResumeTokenPersistence();
+
+  /**
+   * Restores memory persistence from its last snapshot and sets up writing
+   * a new snapshot every `interval`.
+   */
+  void EnableMemorySnapshots(local::MemoryPersistence* persistence,
+                             std::chrono::seconds interval);
+
+  /**
+   * Schedules a callback that writes a snapshot of memory persistence.
+   * Reschedules itself after it has run.
+   */
+  void ScheduleMemorySnapshot();
+
+  /**
+   * Encodes memory persistence on the worker queue and writes the snapshot
+   * on `snapshot_executor_`.
+   */
+  void WriteMemorySnapshot();
+
+  /**
+   * Runs a slice of garbage collection, and schedules the next slice or, once
+   * the collection is finished, the next collection.
+   */
+  void RunLruGarbageCollectionSlice();
+
   DatabaseInfo database_info_;
   std::shared_ptr<auth::CredentialsProvider> credentials_provider_;
   /**
@@ -216,22 +432,66 @@ class FirestoreClient : public std::enable_shared_from_this<FirestoreClient> {
   std::shared_ptr<util::AsyncQueue> worker_queue_;
   std::shared_ptr<util::Executor> user_executor_;
 
+  /**
+   * Serial executor for reads of the local cache that run concurrently with
+   * the worker queue, or null if persistence doesn't support concurrent reads.
+   */
+  std::unique_ptr<util::Executor> reader_executor_;
+
+  /**
+   * Concurrent executor that reads and decodes bundles, created on the first
+   * bundle load. Only accessed on the worker queue.
+   */
+  std::unique_ptr<util::Executor> bundle_executor_;
+  std::vector<std::weak_ptr<BundleLoadPipeline>> bundle_pipelines_;
+
   std::unique_ptr<remote::FirebaseMetadataProvider> firebase_metadata_provider_;
 
   std::unique_ptr<local::Persistence> persistence_;
+  const std::shared_ptr<local::TransactionStats> transaction_stats_ =
+      std::make_shared<local::TransactionStats>();
   std::unique_ptr<local::LocalStore> local_store_;
+  // Sizes documents for the query planner; outlives `query_engine_`.
+  std::unique_ptr<local::Sizer> query_sizer_;
   std::unique_ptr<local::QueryEngine> query_engine_;
   std::unique_ptr<remote::ConnectivityMonitor> connectivity_monitor_;
   std::unique_ptr<remote::RemoteStore> remote_store_;
   std::unique_ptr<SyncEngine> sync_engine_;
   std::unique_ptr<EventManager> event_manager_;
 
+  // The queries recently in sync, if one-shot gets may reuse their results.
+  // Set before the client is shared, then only read.
+  std::unique_ptr<SyncedQueryTracker> synced_query_tracker_;
+
   std::chrono::milliseconds initial_gc_delay_ = std::chrono::minutes(1);
   std::chrono::milliseconds regular_gc_delay_ = std::chrono::minutes(5);
+  // The work done by each slice of garbage collection, between which other
+  // work on the worker queue gets to run.
+  std::chrono::milliseconds gc_slice_budget_ = std::chrono::milliseconds(20);
   bool gc_has_run_ = false;
   bool credentials_initialized_ = false;
+
+  bool write_coalescing_enabled_ = false;
+  std::vector<std::vector<model::Mutation>> coalesced_batches_;
+  std::vector<util::StatusCallback> coalesced_callbacks_;
+
   local::LruDelegate* _Nullable lru_delegate_;
+  local::LevelDbRemoteDocumentCache* _Nullable leveldb_document_cache_ =
+      nullptr;
   util::DelayedOperation lru_callback_;
+
+  std::chrono::milliseconds resume_token_persistence_delay_ =
+      std::chrono::minutes(1);
+  util::DelayedOperation resume_token_callback_;
+
+  // Only set if memory persistence is saved to periodic snapshots.
+  local::MemoryPersistence* _Nullable memory_persistence_ = nullptr;
+  std::unique_ptr<local::MemorySnapshot> memory_snapshot_;
+  util::Path memory_snapshot_path_;
+  std::chrono::milliseconds memory_snapshot_delay_{0};
+  util::DelayedOperation memory_snapshot_callback_;
+  // Serial executor that writes the snapshots off the worker queue.
+  std::unique_ptr<util::Executor> snapshot_executor_;
 };
 
 }  // namespace core
@@ -17,32 +17,36 @@
 #include "Firestore/core/src/core/in_filter.h"
 
 #include <memory>
+#include <unordered_set>
 #include <utility>
 
-#include "Firestore/core/src/model/document.h"
-#include "absl/algorithm/container.h"
-
 namespace firebase {
 namespace firestore {
 namespace core {
 
-using model::Document;
 using model::FieldPath;
 using model::FieldValue;
+using model::FieldValueHash;
 
 using Operator = Filter::Operator;
 
 class InFilter::Rep : public FieldFilter::Rep {
  public:
   Rep(FieldPath field, FieldValue value)
-      : FieldFilter::Rep(std::move(field), Operator::In, std::move(value)) {
+      : FieldFilter::Rep(std::move(field), Operator::In, std::move(value)),
+        values_(this->value().array_value().begin(),
+                this->value().array_value().end()) {
   }
 
   Type type() const override {
     return Type::kInFilter;
   }
 
-  bool Matches(const model::Document& doc) const override;
+  bool MatchesValue(const FieldValue& lhs) const override;
+
+ private:
+  /** The elements of the filter's array value, for fast lookup. */
+  std::unordered_set<FieldValue, FieldValueHash> values_;
 };
 
 InFilter::InFilter(FieldPath field, FieldValue value)
@@ -50,11 +54,8 @@ InFilter::InFilter(FieldPath field, FieldValue value)
           std::make_shared<const Rep>(std::move(field), std::move(value))) {
 }
 
-bool InFilter::Rep::Matches(const Document& doc) const {
-  const FieldValue::Array& array_value = value().array_value();
-  absl::optional<FieldValue> maybe_lhs = doc.field(field());
-  if (!maybe_lhs) return false;
-  return absl::c_linear_search(array_value, *maybe_lhs);
+bool InFilter::Rep::MatchesValue(const FieldValue& lhs) const {
+  return values_.count(lhs) > 0;
 }
 
 }  // namespace core
@@ -17,6 +17,8 @@
 #ifndef FIRESTORE_CORE_SRC_CORE_LISTEN_OPTIONS_H_
 #define FIRESTORE_CORE_SRC_CORE_LISTEN_OPTIONS_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+
 namespace firebase {
 namespace firestore {
 namespace core {
@@ -78,10 +80,36 @@ class ListenOptions {
     return wait_for_sync_when_online_;
   }
 
+  /**
+   * Returns a copy of these options that coalesces snapshots: the snapshots
+   * raised within `window` of each other are merged and delivered as a single
+   * snapshot at the end of the window. A window of about one display frame
+   * makes UI work scale with the frame rate rather than the rate of remote
+   * events. The initial snapshot is still raised as soon as it's available.
+   * Snapshots-in-sync listeners don't wait for coalesced snapshots.
+   *
+   * A zero window, the default, raises every snapshot immediately.
+   */
+  ListenOptions WithSnapshotCoalescingWindow(
+      std::chrono::milliseconds window) const {
+    ListenOptions result = *this;
+    result.snapshot_coalescing_window_ = window;
+    return result;
+  }
+
+  std::chrono::milliseconds snapshot_coalescing_window() const {
+    return snapshot_coalescing_window_;
+  }
+
+  bool coalesces_snapshots() const {
+    return snapshot_coalescing_window_.count() > 0;
+  }
+
  private:
   bool include_query_metadata_changes_ = false;
   bool include_document_metadata_changes_ = false;
   bool wait_for_sync_when_online_ = false;
+  std::chrono::milliseconds snapshot_coalescing_window_{0};
 };
 
 }  // namespace core
@@ -17,32 +17,38 @@
 #include "Firestore/core/src/core/not_in_filter.h"
 
 #include <memory>
+#include <unordered_set>
 #include <utility>
 
-#include "Firestore/core/src/model/document.h"
-#include "absl/algorithm/container.h"
-
 namespace firebase {
 namespace firestore {
 namespace core {
 
-using model::Document;
 using model::FieldPath;
 using model::FieldValue;
+using model::FieldValueHash;
 
 using Operator = Filter::Operator;
 
 class NotInFilter::Rep : public FieldFilter::Rep {
  public:
   Rep(FieldPath field, FieldValue value)
-      : FieldFilter::Rep(std::move(field), Operator::NotIn, std::move(value)) {
+      : FieldFilter::Rep(std::move(field), Operator::NotIn, std::move(value)),
+        values_(this->value().array_value().begin(),
+                this->value().array_value().end()),
+        contains_null_(values_.count(FieldValue::Null()) > 0) {
   }
 
   Type type() const override {
     return Type::kNotInFilter;
   }
 
-  bool Matches(const model::Document& doc) const override;
+  bool MatchesValue(const FieldValue& lhs) const override;
+
+ private:
+  /** The elements of the filter's array value, for fast lookup. */
+  std::unordered_set<FieldValue, FieldValueHash> values_;
+  bool contains_null_ = false;
 };
 
 NotInFilter::NotInFilter(FieldPath field, FieldValue value)
@@ -50,13 +56,8 @@ NotInFilter::NotInFilter(FieldPath field, FieldValue value)
           std::make_shared<const Rep>(std::move(field), std::move(value))) {
 }
 
-bool NotInFilter::Rep::Matches(const Document& doc) const {
-  const FieldValue::Array& array_value = value().array_value();
-  if (absl::c_linear_search(array_value, FieldValue::Null())) {
-    return false;
-  }
-  absl::optional<FieldValue> maybe_lhs = doc.field(field());
-  return maybe_lhs && !absl::c_linear_search(array_value, *maybe_lhs);
+bool NotInFilter::Rep::MatchesValue(const FieldValue& lhs) const {
+  return !contains_null_ && values_.count(lhs) == 0;
 }
 
 }  // namespace core
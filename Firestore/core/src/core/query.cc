@@ -17,15 +17,23 @@
 #include "Firestore/core/src/core/query.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <ostream>
+#include <string>
+#include <vector>
 
 #include "Firestore/core/src/core/bound.h"
 #include "Firestore/core/src/core/field_filter.h"
+#include "Firestore/core/src/core/key_field_in_filter.h"
 #include "Firestore/core/src/core/operator.h"
+#include "Firestore/core/src/local/index_value_writer.h"
+#include "Firestore/core/src/model/database_id.h"
 #include "Firestore/core/src/model/document.h"
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/document_set.h"
+#include "Firestore/core/src/model/field_mask.h"
 #include "Firestore/core/src/model/field_path.h"
+#include "Firestore/core/src/model/field_value.h"
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/util/equality.h"
 #include "Firestore/core/src/util/hard_assert.h"
@@ -43,16 +51,95 @@ using Type = Filter::Type;
 using model::Document;
 using model::DocumentComparator;
 using model::DocumentKey;
+using model::FieldMask;
 using model::FieldPath;
+using model::FieldValue;
 using model::ResourcePath;
 using util::ComparisonResult;
 
+namespace {
+
+/**
+ * Returns true if no other value that compares differently from `value` can
+ * share its index value encoding. Integers are encoded as doubles, so the only
+ * values at risk are integers that a double can't represent exactly.
+ */
+bool IsExactlyEncoded(const FieldValue& value) {
+  constexpr int64_t kMaxExactInteger = int64_t{1} << 53;
+  switch (value.type()) {
+    case FieldValue::Type::Integer:
+      return value.integer_value() >= -kMaxExactInteger &&
+             value.integer_value() <= kMaxExactInteger;
+    case FieldValue::Type::Array:
+      return absl::c_all_of(value.array_value(), IsExactlyEncoded);
+    case FieldValue::Type::Object:
+      for (const auto& entry : value.object_value()) {
+        if (!IsExactlyEncoded(entry.second)) return false;
+      }
+      return true;
+    default:
+      return true;
+  }
+}
+
+/**
+ * Concatenates the index value encodings of the document's values for each
+ * order by, with the bytes of descending ones complemented. Since the
+ * encodings are order preserving and none is a prefix of another, comparing
+ * two sort keys gives the same result as comparing the documents field by
+ * field.
+ *
+ * Returns an empty string if the document lacks one of the fields or has a
+ * value whose encoding isn't exact, in which case the document can only be
+ * compared field by field.
+ */
+std::string EncodeSortKey(const OrderByList& ordering, const Document& doc) {
+  std::string sort_key;
+  std::string segment;
+  for (const OrderBy& order_by : ordering) {
+    segment.clear();
+    if (order_by.field() == FieldPath::KeyFieldPath()) {
+      local::WriteIndexDocumentKey(doc.key(), &segment);
+    } else {
+      absl::optional<FieldValue> value = doc.field(order_by.field());
+      if (!value || !IsExactlyEncoded(*value)) return "";
+      local::WriteIndexValue(*value, &segment);
+    }
+
+    if (!order_by.ascending()) {
+      for (char& c : segment) c = static_cast<char>(~c);
+    }
+    sort_key += segment;
+  }
+  return sort_key;
+}
+
+}  // namespace
+
 Query::Query(ResourcePath path, std::string collection_group)
     : path_(std::move(path)),
       collection_group_(
           std::make_shared<const std::string>(std::move(collection_group))) {
 }
 
+Query Query::ForDocuments(const model::DatabaseId& database_id,
+                          const std::vector<DocumentKey>& keys) {
+  HARD_ASSERT(!keys.empty(), "A query for documents needs at least one key");
+  ResourcePath collection = keys.front().path().PopLast();
+
+  FieldValue::Array references;
+  for (const DocumentKey& key : keys) {
+    HARD_ASSERT(key.path().PopLast() == collection,
+                "Document %s is not in collection %s", key.ToString(),
+                collection.CanonicalString());
+    references.push_back(FieldValue::FromReference(database_id, key));
+  }
+
+  KeyFieldInFilter filter(FieldPath::KeyFieldPath(),
+                          FieldValue::FromArray(std::move(references)));
+  return Query(std::move(collection)).AddingFilter(std::move(filter));
+}
+
 // MARK: - Accessors
 
 bool Query::IsDocumentQuery() const {
@@ -68,6 +155,17 @@ bool Query::MatchesAllDocuments() const {
            explicit_order_bys_.front().field().IsKeyFieldPath()));
 }
 
+bool Query::CanBePartitioned() const {
+  if (collection_group_ || DocumentKey::IsDocumentKey(path_)) return false;
+  if (limit_ != Target::kNoLimit || start_at_ || end_at_ || projection_) {
+    return false;
+  }
+
+  const OrderByList& orders = order_bys();
+  return orders.size() == 1 && orders.front().field().IsKeyFieldPath() &&
+         orders.front().ascending();
+}
+
 const FieldPath* Query::InequalityFilterField() const {
   for (const auto& filter : filters_) {
     if (filter.IsInequality()) {
@@ -175,7 +273,8 @@ Query Query::AddingFilter(Filter filter) const {
   // TODO(rsgowman): ensure first orderby must match inequality field
 
   return Query(path_, collection_group_, filters_.push_back(std::move(filter)),
-               explicit_order_bys_, limit_, limit_type_, start_at_, end_at_);
+               explicit_order_bys_, limit_, limit_type_, start_at_, end_at_,
+               projection_);
 }
 
 Query Query::AddingOrderBy(OrderBy order_by) const {
@@ -189,33 +288,76 @@ Query Query::AddingOrderBy(OrderBy order_by) const {
 
   return Query(path_, collection_group_, filters_,
                explicit_order_bys_.push_back(std::move(order_by)), limit_,
-               limit_type_, start_at_, end_at_);
+               limit_type_, start_at_, end_at_, projection_);
 }
 
 Query Query::WithLimitToFirst(int32_t limit) const {
   return Query(path_, collection_group_, filters_, explicit_order_bys_, limit,
-               LimitType::First, start_at_, end_at_);
+               LimitType::First, start_at_, end_at_, projection_);
 }
 
 Query Query::WithLimitToLast(int32_t limit) const {
   return Query(path_, collection_group_, filters_, explicit_order_bys_, limit,
-               LimitType::Last, start_at_, end_at_);
+               LimitType::Last, start_at_, end_at_, projection_);
 }
 
 Query Query::StartingAt(Bound bound) const {
   return Query(path_, collection_group_, filters_, explicit_order_bys_, limit_,
-               limit_type_, std::make_shared<Bound>(std::move(bound)), end_at_);
+               limit_type_, std::make_shared<Bound>(std::move(bound)), end_at_,
+               projection_);
 }
 
 Query Query::EndingAt(Bound bound) const {
   return Query(path_, collection_group_, filters_, explicit_order_bys_, limit_,
                limit_type_, start_at_,
-               std::make_shared<Bound>(std::move(bound)));
+               std::make_shared<Bound>(std::move(bound)), projection_);
+}
+
+Query Query::WithProjection(FieldMask fields) const {
+  return Query(path_, collection_group_, filters_, explicit_order_bys_, limit_,
+               limit_type_, start_at_, end_at_,
+               std::make_shared<const FieldMask>(std::move(fields)));
 }
 
 Query Query::AsCollectionQueryAtPath(ResourcePath path) const {
   return Query(path, /*collection_group=*/nullptr, filters_,
-               explicit_order_bys_, limit_, limit_type_, start_at_, end_at_);
+               explicit_order_bys_, limit_, limit_type_, start_at_, end_at_,
+               projection_);
+}
+
+std::vector<Query> Query::Partition(const model::DatabaseId& database_id,
+                                    size_t partition_count) const {
+  HARD_ASSERT(CanBePartitioned(), "Query %s can't be partitioned", ToString());
+
+  // The characters of automatically generated IDs in the order IDs sort in.
+  // Splitting at two-character IDs spreads random IDs evenly across ranges.
+  static const char kIdAlphabet[] =
+      "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+  const size_t alphabet_size = sizeof(kIdAlphabet) - 1;
+  const size_t split_points = alphabet_size * alphabet_size;
+  partition_count = std::min(std::max<size_t>(partition_count, 1),
+                             split_points);
+
+  std::vector<Query> partitions;
+  partitions.reserve(partition_count);
+  std::shared_ptr<Bound> start;
+  for (size_t i = 1; i <= partition_count; ++i) {
+    std::shared_ptr<Bound> end;
+    if (i < partition_count) {
+      size_t split = i * split_points / partition_count;
+      std::string id{kIdAlphabet[split / alphabet_size],
+                     kIdAlphabet[split % alphabet_size]};
+      DocumentKey key(path_.Append(id));
+      end = std::make_shared<Bound>(
+          std::vector<FieldValue>{FieldValue::FromReference(database_id, key)},
+          /*is_before=*/true);
+    }
+    partitions.push_back(Query(path_, collection_group_, filters_,
+                               explicit_order_bys_, limit_, limit_type_, start,
+                               end, projection_));
+    start = end;
+  }
+  return partitions;
 }
 
 // MARK: - Matching
@@ -291,15 +433,27 @@ model::DocumentComparator Query::Comparator() const {
           if (!util::Same(comp)) return comp;
         }
         return ComparisonResult::Same;
-      });
+      },
+      [ordering](const Document& doc) { return EncodeSortKey(ordering, doc); });
 }
 
-const std::string Query::CanonicalId() const {
-  if (limit_type_ != LimitType::None) {
-    return absl::StrCat(ToTarget().CanonicalId(),
-                        "|lt:", (limit_type_ == LimitType::Last) ? "l" : "f");
+const std::string& Query::CanonicalId() const {
+  if (limit_type_ == LimitType::None && !projection_) {
+    return ToTarget().CanonicalId();
+  }
+
+  if (memoized_canonical_id_.empty()) {
+    memoized_canonical_id_ = ToTarget().CanonicalId();
+    if (limit_type_ != LimitType::None) {
+      absl::StrAppend(&memoized_canonical_id_, "|lt:",
+                      (limit_type_ == LimitType::Last) ? "l" : "f");
+    }
+    if (projection_) {
+      absl::StrAppend(&memoized_canonical_id_, "|sel:",
+                      projection_->ToString());
+    }
   }
-  return ToTarget().CanonicalId();
+  return memoized_canonical_id_;
 }
 
 size_t Query::Hash() const {
@@ -351,7 +505,8 @@ std::ostream& operator<<(std::ostream& os, const Query& query) {
 
 bool operator==(const Query& lhs, const Query& rhs) {
   return (lhs.limit_type_ == rhs.limit_type_) &&
-         (lhs.ToTarget() == rhs.ToTarget());
+         (lhs.ToTarget() == rhs.ToTarget()) &&
+         util::Equals(lhs.projection_, rhs.projection_);
 }
 
 }  // namespace core
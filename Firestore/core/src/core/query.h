@@ -67,7 +67,8 @@ class Query {
         int32_t limit,
         LimitType limit_type,
         std::shared_ptr<Bound> start_at,
-        std::shared_ptr<Bound> end_at)
+        std::shared_ptr<Bound> end_at,
+        std::shared_ptr<const model::FieldMask> projection = nullptr)
       : path_(std::move(path)),
         collection_group_(std::move(collection_group)),
         filters_(std::move(filters)),
@@ -75,11 +76,21 @@ class Query {
         limit_(limit),
         limit_type_(limit_type),
         start_at_(std::move(start_at)),
-        end_at_(std::move(end_at)) {
+        end_at_(std::move(end_at)),
+        projection_(std::move(projection)) {
   }
 
   Query(model::ResourcePath path, std::string collection_group);
 
+  /**
+   * Creates a Query for the given documents, which must all be direct children
+   * of the same collection. For two or more documents the Query's Target is
+   * listened to as a single DocumentsTarget; see
+   * `Target::IsMultiDocumentQuery()`.
+   */
+  static Query ForDocuments(const model::DatabaseId& database_id,
+                            const std::vector<model::DocumentKey>& keys);
+
   // MARK: - Accessors
 
   /** The base path of the query. */
@@ -106,6 +117,13 @@ class Query {
    */
   bool MatchesAllDocuments() const;
 
+  /**
+   * Returns true if this query can be split with `Partition()`: it's a query
+   * for the documents of a collection that's only ordered by key ascending,
+   * without a limit, bounds or projection.
+   */
+  bool CanBePartitioned() const;
+
   /** The filters on the documents returned by the query. */
   const FilterList& filters() const {
     return filters_;
@@ -166,6 +184,17 @@ class Query {
     return end_at_;
   }
 
+  /**
+   * The fields the results of this query are projected to, or nullptr if the
+   * results include all the fields of the matching documents.
+   *
+   * The projection doesn't change which documents match, so it isn't part of
+   * the target of the query.
+   */
+  const std::shared_ptr<const model::FieldMask>& projection() const {
+    return projection_;
+  }
+
   // MARK: - Builder methods
 
   /**
@@ -211,6 +240,23 @@ class Query {
    */
   Query EndingAt(Bound bound) const;
 
+  /**
+   * Returns a copy of this Query whose results only include the given fields
+   * of the matching documents.
+   */
+  Query WithProjection(model::FieldMask fields) const;
+
+  /**
+   * Splits this query into at most `partition_count` queries over consecutive
+   * ranges of document IDs, which together match exactly the documents this
+   * query matches. The ranges are chosen so that automatically generated IDs
+   * spread evenly across them; other IDs still match exactly one partition.
+   *
+   * The query must satisfy `CanBePartitioned()`.
+   */
+  std::vector<Query> Partition(const model::DatabaseId& database_id,
+                               size_t partition_count) const;
+
   // MARK: - Matching
 
   /**
@@ -230,7 +276,7 @@ class Query {
    */
   model::DocumentComparator Comparator() const;
 
-  const std::string CanonicalId() const;
+  const std::string& CanonicalId() const;
 
   std::string ToString() const;
 
@@ -273,8 +319,14 @@ class Query {
   std::shared_ptr<Bound> start_at_;
   std::shared_ptr<Bound> end_at_;
 
+  std::shared_ptr<const model::FieldMask> projection_;
+
   // The corresponding Target of this Query instance.
   mutable std::shared_ptr<const Target> memoized_target;
+
+  // The memoized canonical ID of limited and projected queries, which differs
+  // from the ID of their target. Used to hash and look up queries.
+  mutable std::string memoized_canonical_id_;
 };
 
 bool operator==(const Query& lhs, const Query& rhs);
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "Firestore/core/src/model/document_set.h"
+#include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/status.h"
 #include "absl/types/optional.h"
@@ -30,12 +31,44 @@ namespace core {
 
 using model::OnlineState;
 using model::TargetId;
+using util::AsyncQueue;
 using util::Status;
+using util::TimerId;
+
+namespace {
+
+/** Merges two consecutive snapshots of a query as if they were one. */
+ViewSnapshot MergeSnapshots(const ViewSnapshot& older,
+                            const ViewSnapshot& newer) {
+  DocumentViewChangeSet changes;
+  for (const DocumentViewChange& change : older.document_changes()) {
+    changes.AddChange(DocumentViewChange{change});
+  }
+  for (const DocumentViewChange& change : newer.document_changes()) {
+    changes.AddChange(DocumentViewChange{change});
+  }
+
+  return ViewSnapshot{
+      newer.query(),
+      newer.documents(),
+      older.old_documents(),
+      changes.GetSortedChanges(newer.documents().comparator()),
+      newer.mutated_keys(),
+      newer.from_cache(),
+      older.sync_state_changed() || newer.sync_state_changed(),
+      newer.excludes_metadata_changes()};
+}
+
+}  // namespace
 
 std::shared_ptr<QueryListener> QueryListener::Create(
-    Query query, ListenOptions options, ViewSnapshotSharedListener&& listener) {
+    Query query,
+    ListenOptions options,
+    ViewSnapshotSharedListener&& listener,
+    std::shared_ptr<AsyncQueue> worker_queue) {
   return std::make_shared<QueryListener>(std::move(query), std::move(options),
-                                         std::move(listener));
+                                         std::move(listener),
+                                         std::move(worker_queue));
 }
 
 std::shared_ptr<QueryListener> QueryListener::Create(
@@ -62,10 +95,14 @@ std::shared_ptr<QueryListener> QueryListener::Create(
 
 QueryListener::QueryListener(Query query,
                              ListenOptions options,
-                             ViewSnapshotSharedListener&& listener)
+                             ViewSnapshotSharedListener&& listener,
+                             std::shared_ptr<AsyncQueue> worker_queue)
     : query_(std::move(query)),
       options_(std::move(options)),
-      listener_(std::move(listener)) {
+      listener_(std::move(listener)),
+      worker_queue_(std::move(worker_queue)) {
+  HARD_ASSERT(!options_.coalesces_snapshots() || worker_queue_,
+              "Coalescing snapshots requires a worker queue");
 }
 
 bool QueryListener::OnViewSnapshot(ViewSnapshot snapshot) {
@@ -97,6 +134,8 @@ bool QueryListener::OnViewSnapshot(ViewSnapshot snapshot) {
       RaiseInitialEvent(snapshot);
       raised_event = true;
     }
+  } else if (options_.coalesces_snapshots()) {
+    CoalesceSnapshot(snapshot);
   } else if (ShouldRaiseEvent(snapshot)) {
     listener_->OnEvent(snapshot);
     raised_event = true;
@@ -107,6 +146,8 @@ bool QueryListener::OnViewSnapshot(ViewSnapshot snapshot) {
 }
 
 void QueryListener::OnError(Status error) {
+  pending_delivery_.Cancel();
+  pending_snapshot_.reset();
   listener_->OnEvent(std::move(error));
 }
 
@@ -183,6 +224,47 @@ void QueryListener::RaiseInitialEvent(const ViewSnapshot& snapshot) {
   listener_->OnEvent(std::move(modified_snapshot));
 }
 
+void QueryListener::CoalesceSnapshot(const ViewSnapshot& snapshot) {
+  bool should_raise = ShouldRaiseEvent(snapshot);
+  bool metadata_changed = should_raise && snapshot.document_changes().empty();
+
+  if (pending_snapshot_) {
+    // Snapshots that wouldn't raise an event on their own are merged too, so
+    // that the coalesced snapshot reflects the latest state.
+    pending_snapshot_ = MergeSnapshots(*pending_snapshot_, snapshot);
+    pending_metadata_changed_ = pending_metadata_changed_ || metadata_changed;
+    return;
+  }
+
+  if (!should_raise) return;
+
+  pending_snapshot_ = snapshot;
+  pending_metadata_changed_ = metadata_changed;
+
+  std::weak_ptr<QueryListener> weak_this = shared_from_this();
+  pending_delivery_ = worker_queue_->EnqueueAfterDelay(
+      options_.snapshot_coalescing_window(), TimerId::SnapshotCoalescing,
+      [weak_this] {
+        if (auto strong_this = weak_this.lock()) {
+          strong_this->RaiseCoalescedSnapshot();
+        }
+      });
+}
+
+void QueryListener::RaiseCoalescedSnapshot() {
+  if (!pending_snapshot_) return;
+
+  ViewSnapshot snapshot = std::move(*pending_snapshot_);
+  pending_snapshot_.reset();
+
+  // Changes within the window may cancel out, e.g. a document that was added
+  // and then removed again.
+  if (!snapshot.document_changes().empty() || pending_metadata_changed_) {
+    listener_->OnEvent(std::move(snapshot));
+  }
+  pending_metadata_changed_ = false;
+}
+
 }  // namespace core
 }  // namespace firestore
 }  // namespace firebase
@@ -24,23 +24,35 @@
 #include "Firestore/core/src/core/query.h"
 #include "Firestore/core/src/core/view_snapshot.h"
 #include "Firestore/core/src/model/types.h"
+#include "Firestore/core/src/util/executor.h"
 #include "Firestore/core/src/util/status_fwd.h"
 #include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
+
+namespace util {
+class AsyncQueue;
+}  // namespace util
+
 namespace core {
 
 /**
  * QueryListener takes a series of internal view snapshots and determines when
  * to raise user-facing events.
  */
-class QueryListener {
+class QueryListener : public std::enable_shared_from_this<QueryListener> {
  public:
+  /**
+   * Creates a QueryListener. If `options` coalesce snapshots, coalesced
+   * snapshots are delivered on `worker_queue`, which must be the queue the
+   * listener receives snapshots on.
+   */
   static std::shared_ptr<QueryListener> Create(
       Query query,
       ListenOptions options,
-      ViewSnapshotSharedListener&& listener);
+      ViewSnapshotSharedListener&& listener,
+      std::shared_ptr<util::AsyncQueue> worker_queue = nullptr);
 
   static std::shared_ptr<QueryListener> Create(
       Query query, ViewSnapshotSharedListener&& listener);
@@ -55,7 +67,8 @@ class QueryListener {
 
   QueryListener(Query query,
                 ListenOptions options,
-                ViewSnapshotSharedListener&& listener);
+                ViewSnapshotSharedListener&& listener,
+                std::shared_ptr<util::AsyncQueue> worker_queue = nullptr);
 
   virtual ~QueryListener() = default;
 
@@ -63,6 +76,14 @@ class QueryListener {
     return query_;
   }
 
+  /**
+   * Whether this listener has raised its first event. Until it has, its
+   * initial event may depend on the online state.
+   */
+  bool raised_initial_event() const {
+    return raised_initial_event_;
+  }
+
   /** The last received view snapshot. */
   const absl::optional<ViewSnapshot>& snapshot() const {
     return snapshot_;
@@ -87,6 +108,13 @@ class QueryListener {
   bool ShouldRaiseEvent(const ViewSnapshot& snapshot) const;
   void RaiseInitialEvent(const ViewSnapshot& snapshot);
 
+  /**
+   * Merges the snapshot into the pending coalesced snapshot, scheduling its
+   * delivery if this starts a new coalescing window.
+   */
+  void CoalesceSnapshot(const ViewSnapshot& snapshot);
+  void RaiseCoalescedSnapshot();
+
   Query query_;
   ListenOptions options_;
 
@@ -107,6 +135,22 @@ class QueryListener {
   model::OnlineState online_state_ = model::OnlineState::Unknown;
 
   absl::optional<ViewSnapshot> snapshot_;
+
+  /** The queue coalesced snapshots are delivered on, if any. */
+  std::shared_ptr<util::AsyncQueue> worker_queue_;
+
+  /**
+   * The snapshots received in the current coalescing window, merged into one.
+   */
+  absl::optional<ViewSnapshot> pending_snapshot_;
+
+  /**
+   * Whether the snapshots in the current coalescing window changed query
+   * metadata that should be raised even if their document changes cancel out.
+   */
+  bool pending_metadata_changed_ = false;
+
+  util::DelayedOperation pending_delivery_;
 };
 
 }  // namespace core
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/core/query_matcher.h"
+
+#include <utility>
+
+#include "Firestore/core/src/core/bound.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+
+using model::Document;
+using model::DocumentKey;
+using model::FieldPath;
+using model::FieldValue;
+
+QueryMatcher::QueryMatcher(const Query& query)
+    : path_(query.path()),
+      collection_group_(query.collection_group()),
+      order_bys_(query.order_bys()),
+      start_at_(query.start_at()),
+      end_at_(query.end_at()) {
+  if (collection_group_) {
+    path_match_ = PathMatch::kCollectionGroup;
+  } else if (DocumentKey::IsDocumentKey(path_)) {
+    path_match_ = PathMatch::kDocument;
+  } else {
+    path_match_ = PathMatch::kCollection;
+  }
+
+  auto step_for = [this](const FieldPath& field) -> FieldStep& {
+    for (FieldStep& step : field_steps_) {
+      if (step.field == field) return step;
+    }
+    field_steps_.push_back(FieldStep{field, {}});
+    return field_steps_.back();
+  };
+
+  // Documents must contain every field they are ordered by, except the key.
+  for (const OrderBy& order_by : query.explicit_order_bys()) {
+    if (!order_by.field().IsKeyFieldPath()) {
+      step_for(order_by.field());
+    }
+  }
+
+  for (const Filter& filter : query.filters()) {
+    if (filter.IsAFieldFilter() && !filter.field().IsKeyFieldPath()) {
+      step_for(filter.field()).filters.push_back(FieldFilter(filter));
+    } else {
+      document_filters_.push_back(filter);
+    }
+  }
+}
+
+bool QueryMatcher::Matches(const Document& doc) const {
+  if (!MatchesPath(doc.key())) return false;
+
+  for (const Filter& filter : document_filters_) {
+    if (!filter.Matches(doc)) return false;
+  }
+
+  for (const FieldStep& step : field_steps_) {
+    absl::optional<FieldValue> value = doc.field(step.field);
+    if (!value) return false;
+
+    for (const FieldFilter& filter : step.filters) {
+      if (!filter.MatchesValue(*value)) return false;
+    }
+  }
+
+  return MatchesBounds(doc);
+}
+
+bool QueryMatcher::MatchesPath(const DocumentKey& key) const {
+  const model::ResourcePath& doc_path = key.path();
+  switch (path_match_) {
+    case PathMatch::kCollectionGroup:
+      return key.HasCollectionId(*collection_group_) &&
+             path_.IsPrefixOf(doc_path);
+    case PathMatch::kDocument:
+      return path_ == doc_path;
+    case PathMatch::kCollection:
+      return path_.IsImmediateParentOf(doc_path);
+  }
+  UNREACHABLE();
+}
+
+bool QueryMatcher::MatchesBounds(const Document& doc) const {
+  if (start_at_ && !start_at_->SortsBeforeDocument(order_bys_, doc)) {
+    return false;
+  }
+  if (end_at_ && end_at_->SortsBeforeDocument(order_bys_, doc)) {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_CORE_QUERY_MATCHER_H_
+#define FIRESTORE_CORE_SRC_CORE_QUERY_MATCHER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/core/field_filter.h"
+#include "Firestore/core/src/core/filter.h"
+#include "Firestore/core/src/core/order_by.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/model/field_path.h"
+#include "Firestore/core/src/model/model_fwd.h"
+#include "Firestore/core/src/model/resource_path.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+
+/**
+ * A Query compiled into a flat program for matching many documents.
+ *
+ * `Query::Matches` re-derives everything it needs from the query for each
+ * document, and looks a field up once for every filter and order by that uses
+ * it. A QueryMatcher does that work once: it resolves how document paths are
+ * matched, groups the filters by the field they read so that each distinct
+ * field is looked up and type-checked at most once per document, and evaluates
+ * document key filters directly against the key.
+ *
+ * A QueryMatcher matches exactly the documents `Query::Matches` does. It is
+ * immutable and can be used from several threads at once.
+ */
+class QueryMatcher {
+ public:
+  explicit QueryMatcher(const Query& query);
+
+  /** Returns true if the document matches the constraints of the query. */
+  bool Matches(const model::Document& doc) const;
+
+ private:
+  enum class PathMatch {
+    /** The document is in the collection group, under the query path. */
+    kCollectionGroup,
+    /** The document is the one named by the query path. */
+    kDocument,
+    /** The document is in the collection named by the query path. */
+    kCollection,
+  };
+
+  /** A field the query reads, and the filters that apply to it. */
+  struct FieldStep {
+    model::FieldPath field;
+    std::vector<FieldFilter> filters;
+  };
+
+  bool MatchesPath(const model::DocumentKey& key) const;
+  bool MatchesBounds(const model::Document& doc) const;
+
+  PathMatch path_match_ = PathMatch::kCollection;
+  model::ResourcePath path_;
+  std::shared_ptr<const std::string> collection_group_;
+
+  /** Filters that match against the document as a whole, such as its key. */
+  std::vector<Filter> document_filters_;
+
+  /**
+   * The fields read by the query, in the order they are first needed. A
+   * document that is missing any of them doesn't match: fields are only read
+   * to be ordered by, which requires them to exist, or to be filtered on, which
+   * fails for missing fields.
+   */
+  std::vector<FieldStep> field_steps_;
+
+  OrderByList order_bys_;
+  std::shared_ptr<Bound> start_at_;
+  std::shared_ptr<Bound> end_at_;
+};
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_CORE_QUERY_MATCHER_H_
@@ -16,6 +16,11 @@
 
 #include "Firestore/core/src/core/sync_engine.h"
 
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "Firestore/core/include/firebase/firestore/firestore_errors.h"
 #include "Firestore/core/src/bundle/bundle_element.h"
 #include "Firestore/core/src/bundle/bundle_loader.h"
@@ -28,6 +33,7 @@
 #include "Firestore/core/src/local/local_write_result.h"
 #include "Firestore/core/src/local/query_result.h"
 #include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/document.h"
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/document_map.h"
@@ -37,6 +43,7 @@
 #include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/log.h"
 #include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/trace.h"
 
 namespace firebase {
 namespace firestore {
@@ -57,14 +64,17 @@ using local::QueryPurpose;
 using local::QueryResult;
 using local::TargetData;
 using model::BatchId;
+using model::Document;
 using model::DocumentKey;
 using model::DocumentKeySet;
 using model::DocumentMap;
 using model::DocumentUpdateMap;
 using model::kBatchIdUnknown;
 using model::ListenSequenceNumber;
+using model::MaybeDocument;
 using model::MaybeDocumentMap;
 using model::NoDocument;
+using model::ResourcePath;
 using model::SnapshotVersion;
 using model::TargetId;
 using remote::RemoteEvent;
@@ -72,11 +82,22 @@ using remote::TargetChange;
 using util::AsyncQueue;
 using util::Status;
 using util::StatusCallback;
+using util::StatusOr;
 
 // Limbo documents don't use persistence, and are eagerly GC'd. So, listens for
 // them don't need real sequence numbers.
 const ListenSequenceNumber kIrrelevantSequenceNumber = -1;
 
+/**
+ * Returns the canonical path of the collection whose documents the given
+ * query, which must not be a collection group query, can match.
+ */
+std::string CollectionOf(const Query& query) {
+  const ResourcePath& path = query.path();
+  return DocumentKey::IsDocumentKey(path) ? path.PopLast().CanonicalString()
+                                          : path.CanonicalString();
+}
+
 bool ErrorIsInteresting(const Status& error) {
   bool missing_index =
       (error.code() == Error::kErrorFailedPrecondition &&
@@ -98,6 +119,12 @@ SyncEngine::SyncEngine(LocalStore* local_store,
       max_concurrent_limbo_resolutions_(max_concurrent_limbo_resolutions) {
 }
 
+SyncEngine::~SyncEngine() {
+  for (auto& entry : lingering_queries_) {
+    entry.second.Cancel();
+  }
+}
+
 void SyncEngine::AssertCallbackExists(absl::string_view source) {
   HARD_ASSERT(sync_engine_callback_,
               "Tried to call '%s' before callback was registered.", source);
@@ -106,6 +133,10 @@ void SyncEngine::AssertCallbackExists(absl::string_view source) {
 TargetId SyncEngine::Listen(Query query) {
   AssertCallbackExists("Listen");
 
+  if (lingering_queries_.find(query) != lingering_queries_.end()) {
+    return ResumeLingeringQuery(query);
+  }
+
   HARD_ASSERT(query_views_by_query_.find(query) == query_views_by_query_.end(),
               "We already listen to query: %s", query.ToString());
 
@@ -122,6 +153,24 @@ TargetId SyncEngine::Listen(Query query) {
   return target_data.target_id();
 }
 
+TargetId SyncEngine::ResumeLingeringQuery(const Query& query) {
+  auto lingering = lingering_queries_.find(query);
+  lingering->second.Cancel();
+  lingering_queries_.erase(lingering);
+
+  // The view kept up with all changes, so it only needs to be raised again as
+  // if it were new.
+  const auto& query_view = query_views_by_query_.at(query);
+  const View& view = query_view->view();
+  std::vector<ViewSnapshot> snapshots;
+  snapshots.push_back(ViewSnapshot::FromInitialDocuments(
+      query, view.document_set(), view.mutated_keys(),
+      /*from_cache=*/view.sync_state() != SyncState::Synced,
+      /*excludes_metadata_changes=*/false));
+  sync_engine_callback_->OnViewSnapshots(std::move(snapshots));
+  return query_view->target_id();
+}
+
 ViewSnapshot SyncEngine::InitializeViewAndComputeSnapshot(const Query& query,
                                                           TargetId target_id) {
   QueryResult query_result =
@@ -146,9 +195,7 @@ ViewSnapshot SyncEngine::InitializeViewAndComputeSnapshot(const Query& query,
       view.ApplyChanges(view_doc_changes, synthesized_current_change);
   UpdateTrackedLimboDocuments(view_change.limbo_changes(), target_id);
 
-  auto query_view =
-      std::make_shared<QueryView>(query, target_id, std::move(view));
-  query_views_by_query_[query] = query_view;
+  AddQueryView(std::make_shared<QueryView>(query, target_id, std::move(view)));
 
   queries_by_target_[target_id].push_back(query);
 
@@ -161,10 +208,39 @@ ViewSnapshot SyncEngine::InitializeViewAndComputeSnapshot(const Query& query,
 void SyncEngine::StopListening(const Query& query) {
   AssertCallbackExists("StopListening");
 
+  if (release_grace_period_.count() > 0) {
+    HARD_ASSERT(query_views_by_query_.count(query) > 0,
+                "Trying to stop listening to a query not found");
+    lingering_queries_[query] = worker_queue_->EnqueueAfterDelay(
+        release_grace_period_, util::TimerId::ReleaseGracePeriod,
+        [this, query] {
+          lingering_queries_.erase(query);
+          ReleaseQuery(query);
+        });
+    return;
+  }
+  ReleaseQuery(query);
+}
+
+size_t SyncEngine::ReleaseLingeringQueries() {
+  size_t released = 0;
+  while (!lingering_queries_.empty()) {
+    auto lingering = lingering_queries_.begin();
+    lingering->second.Cancel();
+    Query query = lingering->first;
+    lingering_queries_.erase(lingering);
+
+    ReleaseQuery(query);
+    ++released;
+  }
+  return released;
+}
+
+void SyncEngine::ReleaseQuery(const Query& query) {
   auto query_view = query_views_by_query_[query];
   HARD_ASSERT(query_view, "Trying to stop listening to a query not found");
 
-  query_views_by_query_.erase(query);
+  RemoveQueryView(query);
 
   TargetId target_id = query_view->target_id();
   auto& queries = queries_by_target_[target_id];
@@ -177,9 +253,48 @@ void SyncEngine::StopListening(const Query& query) {
   }
 }
 
+void SyncEngine::AddQueryView(const std::shared_ptr<QueryView>& query_view) {
+  const Query& query = query_view->query();
+  query_views_by_query_[query] = query_view;
+  if (query.IsCollectionGroupQuery()) {
+    query_views_by_collection_group_[*query.collection_group()].push_back(
+        query_view);
+  } else {
+    query_views_by_collection_[CollectionOf(query)].push_back(query_view);
+  }
+}
+
+void SyncEngine::RemoveQueryView(const Query& query) {
+  auto found = query_views_by_query_.find(query);
+  if (found == query_views_by_query_.end()) return;
+
+  std::shared_ptr<QueryView> query_view = std::move(found->second);
+  query_views_by_query_.erase(found);
+
+  auto& index = query.IsCollectionGroupQuery()
+                    ? query_views_by_collection_group_
+                    : query_views_by_collection_;
+  auto entry = index.find(query.IsCollectionGroupQuery()
+                              ? *query.collection_group()
+                              : CollectionOf(query));
+  HARD_ASSERT(entry != index.end(), "QueryView for %s is not indexed",
+              query.ToString());
+  auto& views = entry->second;
+  views.erase(std::remove(views.begin(), views.end(), query_view),
+              views.end());
+  if (views.empty()) {
+    index.erase(entry);
+  }
+}
+
 void SyncEngine::RemoveAndCleanupTarget(TargetId target_id, Status status) {
   for (const Query& query : queries_by_target_.at(target_id)) {
-    query_views_by_query_.erase(query);
+    RemoveQueryView(query);
+    auto lingering = lingering_queries_.find(query);
+    if (lingering != lingering_queries_.end()) {
+      lingering->second.Cancel();
+      lingering_queries_.erase(lingering);
+    }
     if (!status.ok()) {
       sync_engine_callback_->OnError(query, status);
       if (ErrorIsInteresting(status)) {
@@ -204,14 +319,75 @@ void SyncEngine::WriteMutations(std::vector<model::Mutation>&& mutations,
                                 StatusCallback callback) {
   AssertCallbackExists("WriteMutations");
 
-  LocalWriteResult result = local_store_->WriteLocally(std::move(mutations));
-  mutation_callbacks_[current_user_].insert(
-      std::make_pair(result.batch_id(), std::move(callback)));
+  LocalWriteResult result =
+      local_store_->WriteLocally(std::move(mutations), SquashableAfter());
+  AddMutationCallback(result, std::move(callback));
 
   EmitNewSnapshotsAndNotifyLocalStore(result.changes(), absl::nullopt);
   remote_store_->FillWritePipeline();
 }
 
+void SyncEngine::WriteMutations(
+    std::vector<std::vector<model::Mutation>>&& batches,
+    std::vector<StatusCallback>&& callbacks) {
+  AssertCallbackExists("WriteMutations");
+  HARD_ASSERT(batches.size() == callbacks.size(),
+              "Expected one callback per batch");
+  if (batches.empty()) return;
+
+  std::vector<LocalWriteResult> results =
+      local_store_->WriteLocally(std::move(batches), SquashableAfter());
+  MaybeDocumentMap changes;
+  for (size_t i = 0; i < results.size(); ++i) {
+    AddMutationCallback(results[i], std::move(callbacks[i]));
+    // Later writes to the same document include the effects of earlier ones.
+    for (const auto& entry : results[i].changes()) {
+      changes = changes.insert(entry.first, entry.second);
+    }
+  }
+
+  EmitNewSnapshotsAndNotifyLocalStore(changes, absl::nullopt);
+  remote_store_->FillWritePipeline();
+}
+
+absl::optional<BatchId> SyncEngine::SquashableAfter() const {
+  if (!write_squashing_enabled_) return absl::nullopt;
+  return remote_store_->last_batch_id_in_write_pipeline();
+}
+
+void SyncEngine::AddMutationCallback(const LocalWriteResult& result,
+                                     StatusCallback callback) {
+  auto& callbacks_by_batch = mutation_callbacks_[current_user_];
+  BatchId squashed_batch_id = result.squashed_batch_id();
+  if (squashed_batch_id != kBatchIdUnknown) {
+    auto squashed = callbacks_by_batch.find(squashed_batch_id);
+    if (squashed != callbacks_by_batch.end()) {
+      StatusCallback first = std::move(squashed->second);
+      callbacks_by_batch.erase(squashed);
+      StatusCallback second = std::move(callback);
+      callback = [first, second](Status status) {
+        if (first) first(status);
+        if (second) second(status);
+      };
+    }
+
+    // Callbacks waiting for the squashed batch now wait for the new one.
+    auto pending = pending_writes_callbacks_.find(squashed_batch_id);
+    if (pending != pending_writes_callbacks_.end() &&
+        squashed_batch_id != result.batch_id()) {
+      std::vector<StatusCallback> waiting = std::move(pending->second);
+      pending_writes_callbacks_.erase(pending);
+      auto& moved_to = pending_writes_callbacks_[result.batch_id()];
+      for (StatusCallback& pending_callback : waiting) {
+        moved_to.push_back(std::move(pending_callback));
+      }
+    }
+  }
+
+  callbacks_by_batch.insert(
+      std::make_pair(result.batch_id(), std::move(callback)));
+}
+
 void SyncEngine::RegisterPendingWritesCallback(StatusCallback callback) {
   if (!remote_store_->CanUseNetwork()) {
     LOG_DEBUG(
@@ -249,6 +425,9 @@ void SyncEngine::Transaction(int retries,
 }
 
 void SyncEngine::HandleCredentialChange(const auth::User& user) {
+  // Acknowledgements apply to the mutation queue of the previous user.
+  remote_store_->FlushWriteAcknowledgements();
+
   bool user_changed = (current_user_ != user);
   current_user_ = user;
 
@@ -266,7 +445,30 @@ void SyncEngine::HandleCredentialChange(const auth::User& user) {
   remote_store_->HandleCredentialChange();
 }
 
+void SyncEngine::ApplyQueryResults(const std::vector<Document>& documents,
+                                   const SnapshotVersion& read_time) {
+  AssertCallbackExists("ApplyQueryResults");
+
+  MaybeDocumentMap changes =
+      local_store_->ApplyQueryResults(documents, read_time);
+  EmitNewSnapshotsAndNotifyLocalStore(changes, absl::nullopt);
+}
+
+void SyncEngine::EnableLimboLookups(size_t batch_size,
+                                    size_t max_concurrent_lookups) {
+  limbo_lookup_batch_size_ = batch_size;
+  max_concurrent_limbo_lookups_ = std::max(max_concurrent_lookups, size_t{1});
+}
+
+void SyncEngine::EnableReleaseGracePeriod(
+    std::shared_ptr<AsyncQueue> worker_queue,
+    AsyncQueue::Milliseconds grace_period) {
+  worker_queue_ = std::move(worker_queue);
+  release_grace_period_ = grace_period;
+}
+
 void SyncEngine::ApplyRemoteEvent(const RemoteEvent& remote_event) {
+  FIRESTORE_TRACE_SPAN("SyncEngine::ApplyRemoteEvent");
   AssertCallbackExists("HandleRemoteEvent");
 
   // Update received document as appropriate for any limbo targets.
@@ -362,6 +564,25 @@ void SyncEngine::HandleSuccessfulWrite(
   EmitNewSnapshotsAndNotifyLocalStore(changes, absl::nullopt);
 }
 
+void SyncEngine::HandleSuccessfulWrites(
+    const std::vector<model::MutationBatchResult>& batch_results) {
+  AssertCallbackExists("HandleSuccessfulWrites");
+  if (batch_results.size() == 1) {
+    HandleSuccessfulWrite(batch_results.front());
+    return;
+  }
+
+  // As in `HandleSuccessfulWrite`, user callbacks are raised before listen
+  // events.
+  for (const model::MutationBatchResult& batch_result : batch_results) {
+    NotifyUser(batch_result.batch().batch_id(), Status::OK());
+    TriggerPendingWriteCallbacks(batch_result.batch().batch_id());
+  }
+
+  MaybeDocumentMap changes = local_store_->AcknowledgeBatches(batch_results);
+  EmitNewSnapshotsAndNotifyLocalStore(changes, absl::nullopt);
+}
+
 void SyncEngine::HandleRejectedWrite(
     firebase::firestore::model::BatchId batch_id, Status error) {
   AssertCallbackExists("HandleRejectedWrite");
@@ -388,19 +609,25 @@ void SyncEngine::HandleRejectedWrite(
 void SyncEngine::HandleOnlineStateChange(model::OnlineState online_state) {
   AssertCallbackExists("HandleOnlineStateChange");
 
+  // Views only react to going offline, which marks the current ones as from
+  // cache; views that already are don't produce a snapshot.
   std::vector<ViewSnapshot> new_view_snapshot;
-  for (const auto& entry : query_views_by_query_) {
-    const auto& query_view = entry.second;
-    ViewChange view_change =
-        query_view->view().ApplyOnlineStateChange(online_state);
-    HARD_ASSERT(view_change.limbo_changes().empty(),
-                "OnlineState should not affect limbo documents.");
-    if (view_change.snapshot().has_value()) {
-      new_view_snapshot.push_back(*std::move(view_change).snapshot());
+  if (online_state == model::OnlineState::Offline) {
+    for (const auto& entry : query_views_by_query_) {
+      const auto& query_view = entry.second;
+      ViewChange view_change =
+          query_view->view().ApplyOnlineStateChange(online_state);
+      HARD_ASSERT(view_change.limbo_changes().empty(),
+                  "OnlineState should not affect limbo documents.");
+      if (view_change.snapshot().has_value()) {
+        new_view_snapshot.push_back(*std::move(view_change).snapshot());
+      }
     }
   }
 
-  sync_engine_callback_->OnViewSnapshots(std::move(new_view_snapshot));
+  if (!new_view_snapshot.empty()) {
+    sync_engine_callback_->OnViewSnapshots(std::move(new_view_snapshot));
+  }
   sync_engine_callback_->HandleOnlineStateChange(online_state);
 }
 
@@ -465,49 +692,113 @@ void SyncEngine::FailOutstandingPendingWriteCallbacks(
 void SyncEngine::EmitNewSnapshotsAndNotifyLocalStore(
     const MaybeDocumentMap& changes,
     const absl::optional<RemoteEvent>& maybe_remote_event) {
+  FIRESTORE_TRACE_SPAN("SyncEngine::EmitNewSnapshotsAndNotifyLocalStore");
   std::vector<ViewSnapshot> new_snapshots;
   std::vector<LocalViewChanges> document_changes_in_all_views;
 
-  for (const auto& entry : query_views_by_query_) {
-    const auto& query_view = entry.second;
-    View& view = query_view->view();
-    ViewDocumentChanges view_doc_changes = view.ComputeDocumentChanges(changes);
-    if (view_doc_changes.needs_refill()) {
-      // The query has a limit and some docs were removed/updated, so we need to
-      // re-run the query against the local store to make sure we didn't lose
-      // any good docs that had been past the limit.
-      QueryResult query_result = local_store_->ExecuteQuery(
-          query_view->query(), /* use_previous_results= */ false);
-      view_doc_changes = view.ComputeDocumentChanges(
-          query_result.documents().underlying_map(), view_doc_changes);
+  // A view can only be affected by changes to documents of the collection(s)
+  // its query reads from, or by changes to its target. Views without either
+  // would compute an empty change, so they are skipped.
+  std::unordered_map<std::string, MaybeDocumentMap> changes_by_collection;
+  std::unordered_map<std::string, MaybeDocumentMap> changes_by_collection_group;
+  for (const auto& entry : changes) {
+    const ResourcePath& path = entry.first.path();
+    ResourcePath collection_path = path.PopLast();
+    auto& collection_changes =
+        changes_by_collection[collection_path.CanonicalString()];
+    collection_changes = collection_changes.insert(entry.first, entry.second);
+    if (!query_views_by_collection_group_.empty()) {
+      auto& group_changes =
+          changes_by_collection_group[collection_path.last_segment()];
+      group_changes = group_changes.insert(entry.first, entry.second);
+    }
+  }
+
+  std::vector<std::pair<QueryView*, const MaybeDocumentMap*>> affected_views;
+  std::unordered_set<const QueryView*> seen_views;
+  auto add_view = [&](QueryView* query_view,
+                      const MaybeDocumentMap* view_changes) {
+    if (!seen_views.insert(query_view).second) return;
+    affected_views.emplace_back(query_view, view_changes);
+  };
+
+  for (const auto& entry : changes_by_collection) {
+    auto found = query_views_by_collection_.find(entry.first);
+    if (found == query_views_by_collection_.end()) continue;
+    for (const auto& query_view : found->second) {
+      add_view(query_view.get(), &entry.second);
     }
+  }
+  for (const auto& entry : changes_by_collection_group) {
+    auto found = query_views_by_collection_group_.find(entry.first);
+    if (found == query_views_by_collection_group_.end()) continue;
+    for (const auto& query_view : found->second) {
+      add_view(query_view.get(), &entry.second);
+    }
+  }
 
-    absl::optional<TargetChange> target_changes;
-    if (maybe_remote_event.has_value()) {
-      const RemoteEvent& remote_event = maybe_remote_event.value();
-      auto it = remote_event.target_changes().find(query_view->target_id());
-      if (it != remote_event.target_changes().end()) {
-        target_changes = it->second;
+  const MaybeDocumentMap no_changes;
+  if (maybe_remote_event) {
+    for (const auto& entry : maybe_remote_event->target_changes()) {
+      auto queries = queries_by_target_.find(entry.first);
+      if (queries == queries_by_target_.end()) continue;
+      for (const Query& query : queries->second) {
+        auto found = query_views_by_query_.find(query);
+        if (found != query_views_by_query_.end()) {
+          add_view(found->second.get(), &no_changes);
+        }
       }
     }
-    ViewChange view_change =
-        view.ApplyChanges(view_doc_changes, target_changes);
-
-    UpdateTrackedLimboDocuments(view_change.limbo_changes(),
-                                query_view->target_id());
+  }
 
-    if (view_change.snapshot().has_value()) {
-      new_snapshots.push_back(*view_change.snapshot());
-      LocalViewChanges doc_changes = LocalViewChanges::FromViewSnapshot(
-          *view_change.snapshot(), query_view->target_id());
-      document_changes_in_all_views.push_back(std::move(doc_changes));
-    }
+  for (const auto& entry : affected_views) {
+    UpdateQueryView(*entry.first, *entry.second, maybe_remote_event,
+                    &new_snapshots, &document_changes_in_all_views);
   }
 
   sync_engine_callback_->OnViewSnapshots(std::move(new_snapshots));
   local_store_->NotifyLocalViewChanges(document_changes_in_all_views);
 }
 
+void SyncEngine::UpdateQueryView(
+    QueryView& query_view,
+    const MaybeDocumentMap& changes,
+    const absl::optional<RemoteEvent>& maybe_remote_event,
+    std::vector<ViewSnapshot>* new_snapshots,
+    std::vector<LocalViewChanges>* document_changes) {
+  View& view = query_view.view();
+  ViewDocumentChanges view_doc_changes = view.ComputeDocumentChanges(changes);
+  if (view_doc_changes.needs_refill()) {
+    // The query has a limit and some docs were removed/updated, so we need to
+    // re-run the query against the local store to make sure we didn't lose
+    // any good docs that had been past the limit.
+    QueryResult query_result = local_store_->ExecuteQuery(
+        query_view.query(), /* use_previous_results= */ false);
+    view_doc_changes = view.ComputeDocumentChanges(
+        query_result.documents().underlying_map(), view_doc_changes);
+  }
+
+  absl::optional<TargetChange> target_changes;
+  if (maybe_remote_event.has_value()) {
+    const RemoteEvent& remote_event = maybe_remote_event.value();
+    auto it = remote_event.target_changes().find(query_view.target_id());
+    if (it != remote_event.target_changes().end()) {
+      target_changes = it->second;
+    }
+  }
+  ViewChange view_change = view.ApplyChanges(view_doc_changes, target_changes);
+
+  UpdateTrackedLimboDocuments(view_change.limbo_changes(),
+                              query_view.target_id());
+
+  if (view_change.snapshot().has_value()) {
+    new_snapshots->push_back(*view_change.snapshot());
+    LocalViewChanges doc_changes = LocalViewChanges::FromViewSnapshot(
+        *view_change.snapshot(), query_view.target_id());
+    document_changes->push_back(std::move(doc_changes));
+  }
+}
+
 void SyncEngine::UpdateTrackedLimboDocuments(
     const std::vector<LimboDocumentChange>& limbo_changes, TargetId target_id) {
   for (const LimboDocumentChange& limbo_change : limbo_changes) {
@@ -537,6 +828,7 @@ void SyncEngine::TrackLimboChange(const LimboDocumentChange& limbo_change) {
   const DocumentKey& key = limbo_change.key();
   if (active_limbo_targets_by_key_.find(key) ==
           active_limbo_targets_by_key_.end() &&
+      !active_limbo_lookup_keys_.contains(key) &&
       enqueued_limbo_resolutions_.push_back(key)) {
     LOG_DEBUG("New document in limbo: %s", key.ToString());
     PumpEnqueuedLimboResolutions();
@@ -544,23 +836,113 @@ void SyncEngine::TrackLimboChange(const LimboDocumentChange& limbo_change) {
 }
 
 void SyncEngine::PumpEnqueuedLimboResolutions() {
-  while (!enqueued_limbo_resolutions_.empty() &&
-         active_limbo_targets_by_key_.size() <
-             max_concurrent_limbo_resolutions_) {
+  while (!enqueued_limbo_resolutions_.empty()) {
     DocumentKey key = enqueued_limbo_resolutions_.front();
-    enqueued_limbo_resolutions_.pop_front();
-    TargetId limbo_target_id = target_id_generator_.NextId();
-    active_limbo_resolutions_by_target_.emplace(limbo_target_id,
-                                                LimboResolution{key});
-    active_limbo_targets_by_key_.emplace(key, limbo_target_id);
-    remote_store_->Listen(TargetData(Query(key.path()).ToTarget(),
-                                     limbo_target_id, kIrrelevantSequenceNumber,
-                                     QueryPurpose::LimboResolution));
+
+    if (limbo_lookup_batch_size_ == 0 || limbo_keys_to_listen_.contains(key)) {
+      if (active_limbo_targets_by_key_.size() >=
+          max_concurrent_limbo_resolutions_) {
+        break;
+      }
+      enqueued_limbo_resolutions_.pop_front();
+      limbo_keys_to_listen_ = limbo_keys_to_listen_.erase(key);
+      StartLimboListen(key);
+      continue;
+    }
+
+    if (active_limbo_lookup_count_ >= max_concurrent_limbo_lookups_) {
+      break;
+    }
+    std::vector<DocumentKey> keys;
+    while (!enqueued_limbo_resolutions_.empty() &&
+           keys.size() < limbo_lookup_batch_size_ &&
+           !limbo_keys_to_listen_.contains(
+               enqueued_limbo_resolutions_.front())) {
+      keys.push_back(enqueued_limbo_resolutions_.front());
+      enqueued_limbo_resolutions_.pop_front();
+    }
+    StartLimboLookup(std::move(keys));
+  }
+}
+
+void SyncEngine::StartLimboListen(const DocumentKey& key) {
+  TargetId limbo_target_id = target_id_generator_.NextId();
+  active_limbo_resolutions_by_target_.emplace(limbo_target_id,
+                                              LimboResolution{key});
+  active_limbo_targets_by_key_.emplace(key, limbo_target_id);
+  remote_store_->Listen(TargetData(Query(key.path()).ToTarget(),
+                                   limbo_target_id, kIrrelevantSequenceNumber,
+                                   QueryPurpose::LimboResolution));
+}
+
+void SyncEngine::StartLimboLookup(std::vector<DocumentKey> keys) {
+  ++active_limbo_lookup_count_;
+  for (const DocumentKey& key : keys) {
+    active_limbo_lookup_keys_ = active_limbo_lookup_keys_.insert(key);
+  }
+
+  // TODO(c++14): move into lambda.
+  remote_store_->LookupDocuments(
+      keys, [this, keys](const StatusOr<std::vector<MaybeDocument>>& result) {
+        HandleLimboLookupResult(keys, result);
+      });
+}
+
+void SyncEngine::HandleLimboLookupResult(
+    const std::vector<DocumentKey>& keys,
+    const StatusOr<std::vector<MaybeDocument>>& result) {
+  --active_limbo_lookup_count_;
+
+  // Documents may have left limbo while they were being fetched.
+  DocumentKeySet limbo_documents;
+  for (const DocumentKey& key : keys) {
+    active_limbo_lookup_keys_ = active_limbo_lookup_keys_.erase(key);
+    if (limbo_document_refs_.ContainsKey(key)) {
+      limbo_documents = limbo_documents.insert(key);
+    }
+  }
+
+  DocumentUpdateMap document_updates;
+  if (result.ok()) {
+    for (const MaybeDocument& doc : result.ValueOrDie()) {
+      if (limbo_documents.contains(doc.key())) {
+        document_updates.emplace(doc.key(), doc);
+      }
+    }
+  } else if (remote::Datastore::IsPermanentError(result.status())) {
+    LOG_DEBUG("Limbo lookup of %s documents failed: %s", keys.size(),
+              result.status().ToString());
+    // Like a rejected limbo listen, treat the documents as deleted.
+    for (const DocumentKey& key : limbo_documents) {
+      document_updates.emplace(
+          key, NoDocument(key, SnapshotVersion::None(),
+                          /* has_committed_mutations= */ false));
+    }
+  } else {
+    // The watch stream keeps retrying listens until they succeed.
+    for (const DocumentKey& key : limbo_documents) {
+      limbo_keys_to_listen_ = limbo_keys_to_listen_.insert(key);
+      enqueued_limbo_resolutions_.push_back(key);
+    }
+    limbo_documents = DocumentKeySet{};
+  }
+
+  PumpEnqueuedLimboResolutions();
+
+  if (!document_updates.empty()) {
+    // See `HandleRejectedListen` for why these are instantiated explicitly.
+    RemoteEvent::TargetChangeMap target_changes;
+    RemoteEvent::TargetSet target_mismatches;
+    RemoteEvent event{SnapshotVersion::None(), std::move(target_changes),
+                      std::move(target_mismatches), std::move(document_updates),
+                      std::move(limbo_documents)};
+    ApplyRemoteEvent(event);
   }
 }
 
 void SyncEngine::RemoveLimboTarget(const DocumentKey& key) {
   enqueued_limbo_resolutions_.remove(key);
+  limbo_keys_to_listen_ = limbo_keys_to_listen_.erase(key);
   auto it = active_limbo_targets_by_key_.find(key);
   if (it == active_limbo_targets_by_key_.end()) {
     // This target already got removed, because the query failed.
@@ -574,11 +956,9 @@ void SyncEngine::RemoveLimboTarget(const DocumentKey& key) {
   PumpEnqueuedLimboResolutions();
 }
 
-absl::optional<BundleLoader> SyncEngine::ReadIntoLoader(
-    const bundle::BundleMetadata& metadata,
-    bundle::BundleReader& reader,
-    api::LoadBundleTask& result_task) {
-  BundleLoader loader(local_store_, metadata);
+bool SyncEngine::ReadIntoLoader(BundleLoader& loader,
+                                bundle::BundleReader& reader,
+                                api::LoadBundleTask& result_task) {
   int64_t current_bytes_read = 0;
   // Breaks when either error happened, or when there is no more element to
   // read.
@@ -588,7 +968,7 @@ absl::optional<BundleLoader> SyncEngine::ReadIntoLoader(
       LOG_WARN("Failed to GetNextElement() from bundle with error %s",
                reader.reader_status().error_message());
       result_task.SetError(reader.reader_status());
-      return absl::nullopt;
+      return false;
     }
 
     // No more elements from reader.
@@ -598,21 +978,13 @@ absl::optional<BundleLoader> SyncEngine::ReadIntoLoader(
 
     int64_t old_bytes_read = current_bytes_read;
     current_bytes_read = reader.bytes_read();
-    auto maybe_progress = loader.AddElement(
-        std::move(element), current_bytes_read - old_bytes_read);
-    if (!maybe_progress.ok()) {
-      LOG_WARN("Failed to AddElement() to bundle loader with error %s",
-               maybe_progress.status().error_message());
-      result_task.SetError(maybe_progress.status());
-      return absl::nullopt;
-    }
-
-    if (maybe_progress.ValueOrDie().has_value()) {
-      result_task.UpdateProgress(maybe_progress.ConsumeValueOrDie().value());
+    if (!AddBundleElement(loader, std::move(element),
+                          current_bytes_read - old_bytes_read, result_task)) {
+      return false;
     }
   }
 
-  return loader;
+  return true;
 }
 
 void SyncEngine::LoadBundle(std::shared_ptr<bundle::BundleReader> reader,
@@ -625,33 +997,66 @@ void SyncEngine::LoadBundle(std::shared_ptr<bundle::BundleReader> reader,
     return;
   }
 
-  bool has_newer_bundle = local_store_->HasNewerBundle(bundle_metadata);
-  if (has_newer_bundle) {
-    result_task->SetSuccess(SuccessProgress(bundle_metadata));
+  absl::optional<BundleLoader> loader =
+      StartBundleLoad(bundle_metadata, *result_task);
+  if (!loader) {
     return;
   }
 
-  result_task->UpdateProgress(InitialProgress(bundle_metadata));
-  auto maybe_loader = ReadIntoLoader(bundle_metadata, *reader, *result_task);
-  if (!maybe_loader.has_value()) {
+  if (!ReadIntoLoader(*loader, *reader, *result_task)) {
     // `ReadIntoLoader` would call `result_task.SetError` should there be an
     // error, so we do not need set it here.
     return;
   }
 
-  util::StatusOr<MaybeDocumentMap> changes =
-      maybe_loader.value().ApplyChanges();
+  FinishBundleLoad(*loader, *result_task);
+}
+
+absl::optional<BundleLoader> SyncEngine::StartBundleLoad(
+    const bundle::BundleMetadata& metadata, api::LoadBundleTask& result_task) {
+  bool has_newer_bundle = local_store_->HasNewerBundle(metadata);
+  if (has_newer_bundle) {
+    result_task.SetSuccess(SuccessProgress(metadata));
+    return absl::nullopt;
+  }
+
+  result_task.UpdateProgress(InitialProgress(metadata));
+  return BundleLoader(local_store_, metadata);
+}
+
+bool SyncEngine::AddBundleElement(
+    BundleLoader& loader,
+    std::unique_ptr<bundle::BundleElement> element,
+    int64_t byte_size,
+    api::LoadBundleTask& result_task) {
+  auto maybe_progress = loader.AddElement(std::move(element), byte_size);
+  if (!maybe_progress.ok()) {
+    LOG_WARN("Failed to AddElement() to bundle loader with error %s",
+             maybe_progress.status().error_message());
+    result_task.SetError(maybe_progress.status());
+    return false;
+  }
+
+  if (maybe_progress.ValueOrDie().has_value()) {
+    result_task.UpdateProgress(maybe_progress.ConsumeValueOrDie().value());
+  }
+  return true;
+}
+
+void SyncEngine::FinishBundleLoad(BundleLoader& loader,
+                                  api::LoadBundleTask& result_task) {
+  util::StatusOr<MaybeDocumentMap> changes = loader.ApplyChanges();
   if (!changes.ok()) {
     LOG_WARN("Failed to ApplyChanges() for bundle elements with error %s",
              changes.status().error_message());
-    result_task->SetError(changes.status());
+    result_task.SetError(changes.status());
     return;
   }
 
   EmitNewSnapshotsAndNotifyLocalStore(changes.ConsumeValueOrDie(),
                                       absl::nullopt);
 
-  result_task->SetSuccess(SuccessProgress(bundle_metadata));
+  result_task.SetSuccess(SuccessProgress(loader.metadata()));
 }
 
 }  // namespace core
@@ -33,17 +33,23 @@
 #include "Firestore/core/src/core/target_id_generator.h"
 #include "Firestore/core/src/core/view.h"
 #include "Firestore/core/src/local/reference_set.h"
+#include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/model_fwd.h"
 #include "Firestore/core/src/remote/remote_store.h"
+#include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/random_access_queue.h"
 #include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
 
 namespace local {
 class LocalStore;
+class LocalViewChanges;
+class LocalWriteResult;
 class TargetData;
 }  // namespace local
 
@@ -99,6 +105,8 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
              const auth::User& initial_user,
              size_t max_concurrent_limbo_resolutions);
 
+  ~SyncEngine();
+
   // Implements `QueryEventSource`.
   void SetCallback(SyncEngineCallback* callback) override {
     sync_engine_callback_ = callback;
@@ -116,6 +124,15 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
   void WriteMutations(std::vector<model::Mutation>&& mutations,
                       util::StatusCallback callback);
 
+  /**
+   * Initiates the writes of several local mutation batches like
+   * `WriteMutations` above, but adds all of them to the mutation queue in a
+   * single transaction and raises events only once. `callbacks[i]` is called
+   * once `batches[i]` has been acked or rejected.
+   */
+  void WriteMutations(std::vector<std::vector<model::Mutation>>&& batches,
+                      std::vector<util::StatusCallback>&& callbacks);
+
   /**
    * Registers a user callback that is called when all pending mutations at the
    * moment of calling are acknowledged .
@@ -140,12 +157,58 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
 
   void HandleCredentialChange(const auth::User& user);
 
+  /**
+   * Applies documents the backend returned for a one-shot query, read at
+   * `read_time`, to the local store, and raises snapshots for the views whose
+   * documents changed.
+   */
+  void ApplyQueryResults(const std::vector<model::Document>& documents,
+                         const model::SnapshotVersion& read_time);
+
+  /**
+   * Makes documents in limbo be resolved by fetching them from the backend in
+   * batches of up to `batch_size` documents, with up to
+   * `max_concurrent_lookups` batches in flight, rather than by listening to a
+   * separate target for each document. Documents whose lookup fails with a
+   * transient error are resolved with a listen instead.
+   */
+  void EnableLimboLookups(size_t batch_size, size_t max_concurrent_lookups);
+
+  /**
+   * Keeps the view and target of a query that is no longer listened to for
+   * `grace_period`, still updated from the local store and the watch stream.
+   * Listening to the query again within that time reuses the view, without
+   * allocating the target, running the query against the local store or
+   * resuming the target on the watch stream.
+   */
+  void EnableReleaseGracePeriod(std::shared_ptr<util::AsyncQueue> worker_queue,
+                                util::AsyncQueue::Milliseconds grace_period);
+
+  /**
+   * Releases the views and targets kept for queries that are no longer
+   * listened to without waiting for their grace period to end, and returns how
+   * many views were released.
+   */
+  size_t ReleaseLingeringQueries();
+
+  /**
+   * Makes a write to a single document replace the newest pending write to the
+   * same document, if that write hasn't been sent yet and the two can be
+   * combined; see `LocalStore::WriteLocally`. The callbacks of both writes are
+   * then called once the combined write is committed or rejected.
+   */
+  void set_write_squashing_enabled(bool enabled) {
+    write_squashing_enabled_ = enabled;
+  }
+
   // Implements `RemoteStoreCallback`
   void ApplyRemoteEvent(const remote::RemoteEvent& remote_event) override;
   void HandleRejectedListen(model::TargetId target_id,
                             util::Status error) override;
   void HandleSuccessfulWrite(
       const model::MutationBatchResult& batch_result) override;
+  void HandleSuccessfulWrites(
+      const std::vector<model::MutationBatchResult>& batch_results) override;
   void HandleRejectedWrite(model::BatchId batch_id,
                            util::Status error) override;
   void HandleOnlineStateChange(model::OnlineState online_state) override;
@@ -154,6 +217,34 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
   void LoadBundle(std::shared_ptr<bundle::BundleReader> reader,
                   std::shared_ptr<api::LoadBundleTask> result_task);
 
+  // The steps of `LoadBundle`, for callers that read and decode the bundle
+  // elsewhere, e.g. `BundleLoadPipeline`.
+
+  /**
+   * Starts loading a bundle with the given metadata, reporting the initial
+   * progress. Returns nullopt if the bundle doesn't need to be loaded because
+   * it was loaded before, after completing `result_task`.
+   */
+  absl::optional<bundle::BundleLoader> StartBundleLoad(
+      const bundle::BundleMetadata& metadata,
+      api::LoadBundleTask& result_task);
+
+  /**
+   * Adds an element read from the bundle to `loader`, reporting progress.
+   * Returns false after failing `result_task` if the element is invalid.
+   */
+  bool AddBundleElement(bundle::BundleLoader& loader,
+                        std::unique_ptr<bundle::BundleElement> element,
+                        int64_t byte_size,
+                        api::LoadBundleTask& result_task);
+
+  /**
+   * Applies the elements added to `loader` and raises snapshots for the
+   * changed documents, then completes `result_task`.
+   */
+  void FinishBundleLoad(bundle::BundleLoader& loader,
+                        api::LoadBundleTask& result_task);
+
   // For tests only
   std::map<model::DocumentKey, model::TargetId>
   GetActiveLimboDocumentResolutions() const {
@@ -231,6 +322,21 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
   ViewSnapshot InitializeViewAndComputeSnapshot(const Query& query,
                                                 model::TargetId target_id);
 
+  /**
+   * Listens to `query` again by reusing the view it kept after it stopped
+   * being listened to.
+   */
+  model::TargetId ResumeLingeringQuery(const Query& query);
+
+  /** Removes the view of `query`, releasing its target if no query uses it. */
+  void ReleaseQuery(const Query& query);
+
+  /** Registers the view of an active query, indexing it by collection. */
+  void AddQueryView(const std::shared_ptr<QueryView>& query_view);
+
+  /** Unregisters the view of `query`, if any. */
+  void RemoveQueryView(const Query& query);
+
   void RemoveAndCleanupTarget(model::TargetId target_id, util::Status status);
 
   void RemoveLimboTarget(const model::DocumentKey& key);
@@ -239,6 +345,18 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
       const model::MaybeDocumentMap& changes,
       const absl::optional<remote::RemoteEvent>& maybe_remote_event);
 
+  /**
+   * Applies `changes` to the given view, appending the resulting snapshot (if
+   * any) to `new_snapshots` and the resulting local view changes to
+   * `document_changes`.
+   */
+  void UpdateQueryView(
+      QueryView& query_view,
+      const model::MaybeDocumentMap& changes,
+      const absl::optional<remote::RemoteEvent>& maybe_remote_event,
+      std::vector<ViewSnapshot>* new_snapshots,
+      std::vector<local::LocalViewChanges>* document_changes);
+
   /** Updates the limbo document state for the given target_id. */
   void UpdateTrackedLimboDocuments(
       const std::vector<LimboDocumentChange>& limbo_changes,
@@ -259,6 +377,16 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
    */
   void PumpEnqueuedLimboResolutions();
 
+  /** Starts listening to a target that resolves the given limbo document. */
+  void StartLimboListen(const model::DocumentKey& key);
+
+  /** Starts fetching the given limbo documents from the backend. */
+  void StartLimboLookup(std::vector<model::DocumentKey> keys);
+
+  void HandleLimboLookupResult(
+      const std::vector<model::DocumentKey>& keys,
+      const util::StatusOr<std::vector<model::MaybeDocument>>& result);
+
   void NotifyUser(model::BatchId batch_id, util::Status status);
 
   /**
@@ -266,12 +394,21 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
    * server, if there are any.
    */
   void TriggerPendingWriteCallbacks(model::BatchId batch_id);
+
+  /**
+   * Registers the callback of a write that was just added, taking over the
+   * callbacks of the batch it was squashed into, if any.
+   */
+  void AddMutationCallback(const local::LocalWriteResult& result,
+                           util::StatusCallback callback);
+
+  /** The batch after which new writes may be squashed, if enabled. */
+  absl::optional<model::BatchId> SquashableAfter() const;
   void FailOutstandingPendingWriteCallbacks(const std::string& message);
 
-  absl::optional<bundle::BundleLoader> ReadIntoLoader(
-      const bundle::BundleMetadata& metadata,
-      bundle::BundleReader& reader,
-      api::LoadBundleTask& result_task);
+  bool ReadIntoLoader(bundle::BundleLoader& loader,
+                      bundle::BundleReader& reader,
+                      api::LoadBundleTask& result_task);
 
   /** The local store, used to persist mutations and cached documents. */
   local::LocalStore* local_store_ = nullptr;
@@ -303,6 +440,18 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
   /** QueryViews for all active queries, indexed by query. */
   std::unordered_map<Query, std::shared_ptr<QueryView>> query_views_by_query_;
 
+  /**
+   * QueryViews for all active non-collection-group queries, indexed by the
+   * canonical path of the collection their query reads from. Document changes
+   * are only dispatched to the views of their collection.
+   */
+  std::unordered_map<std::string, std::vector<std::shared_ptr<QueryView>>>
+      query_views_by_collection_;
+
+  /** QueryViews for all active collection group queries, indexed by ID. */
+  std::unordered_map<std::string, std::vector<std::shared_ptr<QueryView>>>
+      query_views_by_collection_group_;
+
   /** Queries mapped to Targets, indexed by target ID. */
   std::unordered_map<model::TargetId, std::vector<Query>> queries_by_target_;
 
@@ -330,6 +479,35 @@ class SyncEngine : public remote::RemoteStoreCallback, public QueryEventSource {
 
   /** Used to track any documents that are currently in limbo. */
   local::ReferenceSet limbo_document_refs_;
+
+  /**
+   * The maximum number of documents fetched by a single limbo lookup, or 0 if
+   * limbo documents are resolved with listens.
+   */
+  size_t limbo_lookup_batch_size_ = 0;
+  size_t max_concurrent_limbo_lookups_ = 0;
+
+  bool write_squashing_enabled_ = false;
+  size_t active_limbo_lookup_count_ = 0;
+
+  /** The queue release timers run on, if there's a release grace period. */
+  std::shared_ptr<util::AsyncQueue> worker_queue_;
+  util::AsyncQueue::Milliseconds release_grace_period_{0};
+
+  /**
+   * Queries that are no longer listened to but whose views are kept until
+   * their release timer fires.
+   */
+  std::unordered_map<Query, util::DelayedOperation> lingering_queries_;
+
+  /** The limbo documents that are currently being fetched. */
+  model::DocumentKeySet active_limbo_lookup_keys_;
+
+  /**
+   * Limbo documents whose lookup failed with a transient error, which are
+   * resolved with listens instead.
+   */
+  model::DocumentKeySet limbo_keys_to_listen_;
 };
 
 }  // namespace core
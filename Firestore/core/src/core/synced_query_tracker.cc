@@ -0,0 +1,65 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/core/synced_query_tracker.h"
+
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/core/target.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+namespace {
+
+// Stale entries are only swept once the map grows past this size, so that
+// recording a query is usually a single insertion.
+const size_t kMaxEntriesBeforeSweep = 100;
+
+}  // namespace
+
+void SyncedQueryTracker::RecordSynced(const Query& query) {
+  std::string canonical_id = query.ToTarget().CanonicalId();
+  Clock::time_point now = Clock::now();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  synced_at_[std::move(canonical_id)] = now;
+  if (synced_at_.size() > kMaxEntriesBeforeSweep) {
+    RemoveStaleLocked(now - freshness_);
+  }
+}
+
+bool SyncedQueryTracker::IsFresh(const Query& query) const {
+  std::string canonical_id = query.ToTarget().CanonicalId();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = synced_at_.find(canonical_id);
+  return found != synced_at_.end() &&
+         Clock::now() - found->second < freshness_;
+}
+
+void SyncedQueryTracker::RemoveStaleLocked(Clock::time_point cutoff) {
+  for (auto it = synced_at_.begin(); it != synced_at_.end();) {
+    if (it->second < cutoff) {
+      it = synced_at_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_CORE_SYNCED_QUERY_TRACKER_H_
+#define FIRESTORE_CORE_SRC_CORE_SYNCED_QUERY_TRACKER_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <mutex>   // NOLINT(build/c++11)
+#include <string>
+#include <unordered_map>
+
+namespace firebase {
+namespace firestore {
+namespace core {
+
+class Query;
+
+/**
+ * Remembers the queries whose listens stopped while they were in sync with the
+ * backend, so that one-shot gets repeated shortly after can read the results
+ * from the local cache instead of listening to the query again.
+ *
+ * Queries are identified by the canonical ID of their target. The tracker is
+ * updated on the worker queue, but can be queried from any thread.
+ */
+class SyncedQueryTracker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param freshness How long after its listen stopped a query's cached
+   *     results are considered as fresh as the backend's.
+   */
+  explicit SyncedQueryTracker(Clock::duration freshness)
+      : freshness_(freshness) {
+  }
+
+  /** Records that the listen to `query` stopped while it was in sync. */
+  void RecordSynced(const Query& query);
+
+  /**
+   * Returns true if a listen to `query` stopped while in sync less than the
+   * freshness duration ago.
+   */
+  bool IsFresh(const Query& query) const;
+
+ private:
+  /** Drops the entries last synced before `cutoff`. */
+  void RemoveStaleLocked(Clock::time_point cutoff);
+
+  Clock::duration freshness_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Clock::time_point> synced_at_;
+};
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_CORE_SYNCED_QUERY_TRACKER_H_
@@ -17,11 +17,13 @@
 #include "Firestore/core/src/core/target.h"
 
 #include <ostream>
+#include <vector>
 
 #include "Firestore/core/src/core/field_filter.h"
 #include "Firestore/core/src/core/operator.h"
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/field_path.h"
+#include "Firestore/core/src/model/field_value.h"
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/util/equality.h"
 #include "Firestore/core/src/util/hard_assert.h"
@@ -34,6 +36,7 @@ namespace core {
 
 using model::DocumentKey;
 using model::FieldPath;
+using model::FieldValue;
 
 // MARK: - Accessors
 
@@ -42,6 +45,50 @@ bool Target::IsDocumentQuery() const {
          filters_.empty();
 }
 
+bool Target::IsMultiDocumentQuery() const {
+  if (collection_group_ || DocumentKey::IsDocumentKey(path_) ||
+      filters_.size() != 1 || limit_ != kNoLimit || start_at_ || end_at_) {
+    return false;
+  }
+
+  if (filters_.front().type() != Filter::Type::kKeyFieldInFilter) {
+    return false;
+  }
+
+  for (const OrderBy& order_by : order_bys_) {
+    if (!order_by.field().IsKeyFieldPath() || !order_by.ascending()) {
+      return false;
+    }
+  }
+
+  // Documents outside of the target's collection never match it and can't be
+  // listed in the DocumentsTarget.
+  FieldFilter filter(filters_.front());
+  const FieldValue::Array& references = filter.value().array_value();
+  if (references.size() < 2) return false;
+  for (const FieldValue& reference : references) {
+    if (reference.reference_value().key().path().PopLast() != path_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<DocumentKey> Target::GetDocumentKeys() const {
+  if (IsDocumentQuery()) {
+    return {DocumentKey{path_}};
+  }
+
+  HARD_ASSERT(IsMultiDocumentQuery(), "Target %s is not for documents",
+              CanonicalId());
+  FieldFilter filter(filters_.front());
+  std::vector<DocumentKey> keys;
+  for (const FieldValue& reference : filter.value().array_value()) {
+    keys.push_back(reference.reference_value().key());
+  }
+  return keys;
+}
+
 const std::string& Target::CanonicalId() const {
   if (!canonical_id_.empty()) return canonical_id_;
 
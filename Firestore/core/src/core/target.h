@@ -22,11 +22,13 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/core/bound.h"
 #include "Firestore/core/src/core/filter.h"
 #include "Firestore/core/src/core/order_by.h"
 #include "Firestore/core/src/immutable/append_only_list.h"
+#include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/remote/serializer.h"
 
@@ -67,6 +69,20 @@ class Target {
   /** Returns true if this Target is for a specific document. */
   bool IsDocumentQuery() const;
 
+  /**
+   * Returns true if this Target is for an explicit set of at least two
+   * documents in one collection: a collection query whose only constraint is a
+   * `__name__ in [...]` filter on references to documents in that collection.
+   * Such targets are sent to the backend as a single DocumentsTarget.
+   */
+  bool IsMultiDocumentQuery() const;
+
+  /**
+   * Returns the keys of the documents this Target is for, in the order they
+   * are listed. Must only be called on document and multi-document queries.
+   */
+  std::vector<model::DocumentKey> GetDocumentKeys() const;
+
   /** The filters on the documents returned by the target. */
   const FilterList& filters() const {
     return filters_;
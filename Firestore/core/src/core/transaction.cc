@@ -17,6 +17,8 @@
 #include "Firestore/core/src/core/transaction.h"
 
 #include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <unordered_set>
 #include <utility>
 
@@ -46,6 +48,12 @@ namespace firebase {
 namespace firestore {
 namespace core {
 
+struct Transaction::Read {
+  absl::optional<StatusOr<MaybeDocument>> result;
+  // Invoked once `result` is available.
+  std::vector<std::function<void()>> waiters;
+};
+
 Transaction::Transaction(Datastore* datastore)
     : datastore_{NOT_NULL(datastore)} {
 }
@@ -63,9 +71,9 @@ Status Transaction::RecordVersion(const MaybeDocument& doc) {
     HARD_FAIL("Unexpected document type in transaction: %s", doc.type());
   }
 
-  absl::optional<SnapshotVersion> existing_version = GetVersion(doc.key());
-  if (existing_version.has_value()) {
-    if (doc_version != existing_version.value()) {
+  auto existing_version = read_versions_.find(doc.key());
+  if (existing_version != read_versions_.end()) {
+    if (doc_version != existing_version->second) {
       // This transaction will fail no matter what.
       return Status{Error::kErrorAborted,
                     "Document version changed between two reads."};
@@ -89,27 +97,130 @@ void Transaction::Lookup(const std::vector<DocumentKey>& keys,
     return;
   }
 
-  datastore_->LookupDocuments(
-      keys, [this, callback](
-                const StatusOr<std::vector<MaybeDocument>>& maybe_documents) {
-        if (!maybe_documents.ok()) {
-          callback(maybe_documents.status());
-          return;
-        }
+  std::vector<std::shared_ptr<Read>> reads = StartReads(keys);
+  if (reads.empty()) {
+    callback(std::vector<MaybeDocument>{});
+    return;
+  }
+
+  // Invoked once per read; the last one to finish delivers the documents.
+  auto remaining = std::make_shared<std::atomic<size_t>>(reads.size());
+  auto on_read = [reads, remaining, callback] {
+    if (remaining->fetch_sub(1) != 1) {
+      return;
+    }
+
+    std::vector<MaybeDocument> documents;
+    documents.reserve(reads.size());
+    for (const std::shared_ptr<Read>& read : reads) {
+      if (!read->result->ok()) {
+        callback(read->result->status());
+        return;
+      }
+      documents.push_back(read->result->ValueOrDie());
+    }
+    callback(std::move(documents));
+  };
+
+  size_t finished = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::shared_ptr<Read>& read : reads) {
+      if (read->result.has_value()) {
+        ++finished;
+      } else {
+        read->waiters.push_back(on_read);
+      }
+    }
+  }
+
+  for (size_t i = 0; i != finished; ++i) {
+    on_read();
+  }
+}
+
+void Transaction::Prefetch(const std::vector<DocumentKey>& keys) {
+  EnsureCommitNotCalled();
+  if (mutations_.empty()) {
+    StartReads(keys);
+  }
+}
+
+std::vector<std::shared_ptr<Transaction::Read>> Transaction::StartReads(
+    const std::vector<DocumentKey>& keys) {
+  std::vector<std::shared_ptr<Read>> reads;
+  reads.reserve(keys.size());
+  std::vector<DocumentKey> to_fetch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const DocumentKey& key : keys) {
+      std::shared_ptr<Read>& read = reads_[key];
+      if (!read) {
+        read = std::make_shared<Read>();
+        to_fetch.push_back(key);
+      }
+      reads.push_back(read);
+    }
+  }
 
-        const auto& documents = maybe_documents.ValueOrDie();
-        for (const MaybeDocument& doc : documents) {
-          Status record_error = RecordVersion(doc);
-          if (!record_error.ok()) {
-            callback(record_error);
-            return;
-          }
+  if (!to_fetch.empty()) {
+    datastore_->LookupDocuments(
+        to_fetch,
+        [this, to_fetch](
+            const StatusOr<std::vector<MaybeDocument>>& maybe_documents) {
+          FinishReads(to_fetch, maybe_documents);
+        });
+  }
+  return reads;
+}
+
+void Transaction::FinishReads(
+    const std::vector<DocumentKey>& keys,
+    const StatusOr<std::vector<MaybeDocument>>& maybe_documents) {
+  std::vector<std::function<void()>> waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto finish = [&](const DocumentKey& key, StatusOr<MaybeDocument> result) {
+      auto found = reads_.find(key);
+      if (found == reads_.end() || found->second->result.has_value()) {
+        return;
+      }
+      const std::shared_ptr<Read>& read = found->second;
+      read->result = std::move(result);
+      std::move(read->waiters.begin(), read->waiters.end(),
+                std::back_inserter(waiters));
+      read->waiters.clear();
+      if (!read->result->ok()) {
+        // Let a later lookup retry the read.
+        reads_.erase(found);
+      }
+    };
+
+    if (maybe_documents.ok()) {
+      for (const MaybeDocument& doc : maybe_documents.ValueOrDie()) {
+        Status record_error = RecordVersion(doc);
+        if (record_error.ok()) {
+          finish(doc.key(), doc);
+        } else {
+          finish(doc.key(), record_error);
         }
+      }
+    }
 
-        // TODO(varconst): see if `maybe_documents` can be moved into the
-        // callback.
-        callback(maybe_documents);
-      });
+    Status missing_error =
+        maybe_documents.ok()
+            ? Status{Error::kErrorInternal,
+                     "BatchGetDocumentsRequest returned no result for a "
+                     "requested document"}
+            : maybe_documents.status();
+    for (const DocumentKey& key : keys) {
+      finish(key, missing_error);
+    }
+  }
+
+  for (const std::function<void()>& waiter : waiters) {
+    waiter();
+  }
 }
 
 void Transaction::WriteMutations(std::vector<Mutation>&& mutations) {
@@ -224,6 +335,7 @@ void Transaction::EnsureCommitNotCalled() {
 
 absl::optional<SnapshotVersion> Transaction::GetVersion(
     const DocumentKey& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto found = read_versions_.find(key);
   if (found != read_versions_.end()) {
     return found->second;
@@ -19,6 +19,7 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -57,11 +58,25 @@ class Transaction {
 
   /**
    * Takes a set of keys and asynchronously attempts to fetch all the documents
-   * from the backend, ignoring any local changes.
+   * from the backend, ignoring any local changes. The documents are passed to
+   * the callback in the order of `keys`.
+   *
+   * Each document is fetched at most once per transaction: keys that were
+   * already read, prefetched or are still being fetched by an earlier lookup
+   * are served from that read instead of a new `BatchGetDocuments` call, and
+   * only the remaining keys are requested, all in one call.
    */
   void Lookup(const std::vector<model::DocumentKey>& keys,
               LookupCallback&& callback);
 
+  /**
+   * Starts fetching all the given documents in a single `BatchGetDocuments`
+   * call without waiting for the result, so that subsequent `Lookup`s of these
+   * keys don't each cost a round trip. Errors are not reported; a failed
+   * prefetch is retried by the next `Lookup` of the affected keys.
+   */
+  void Prefetch(const std::vector<model::DocumentKey>& keys);
+
   /**
    * Stores mutation for the given key and set data, to be committed when
    * `Commit` is called.
@@ -104,9 +119,26 @@ class Transaction {
    * If we read two different versions of the same document, this will return an
    * error. When the transaction is committed, the versions recorded will be set
    * as preconditions on the writes sent to the backend.
+   *
+   * Must be called with `mutex_` held.
    */
   util::Status RecordVersion(const model::MaybeDocument& doc);
 
+  /** The outcome of reading a single document, shared by all its lookups. */
+  struct Read;
+
+  /**
+   * Returns the reads for the given keys, creating the ones that don't exist
+   * yet and issuing a single backend lookup for them.
+   */
+  std::vector<std::shared_ptr<Read>> StartReads(
+      const std::vector<model::DocumentKey>& keys);
+
+  /** Resolves the reads of `keys` with the result of a backend lookup. */
+  void FinishReads(
+      const std::vector<model::DocumentKey>& keys,
+      const util::StatusOr<std::vector<model::MaybeDocument>>& maybe_documents);
+
   /** Stores mutations to be written when `Commit` is called. */
   void WriteMutations(std::vector<model::Mutation>&& mutations);
 
@@ -148,6 +180,15 @@ class Transaction {
    */
   std::unordered_set<model::DocumentKey, model::DocumentKeyHash> written_docs_;
 
+  // Guards `reads_` and `read_versions_`, which are updated on the worker
+  // queue when lookups finish.
+  mutable std::mutex mutex_;
+
+  std::unordered_map<model::DocumentKey,
+                     std::shared_ptr<Read>,
+                     model::DocumentKeyHash>
+      reads_;
+
   std::unordered_map<model::DocumentKey,
                      model::SnapshotVersion,
                      model::DocumentKeyHash>
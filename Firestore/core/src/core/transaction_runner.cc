@@ -16,6 +16,7 @@
 
 #include "Firestore/core/src/core/transaction_runner.h"
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <utility>
 
 #include "Firestore/core/src/remote/exponential_backoff.h"
@@ -26,6 +27,7 @@ namespace firestore {
 namespace core {
 namespace {
 
+using remote::ExponentialBackoff;
 using remote::RemoteStore;
 using util::AsyncQueue;
 using util::Status;
@@ -34,6 +36,14 @@ using util::TimerId;
 /** Maximum number of times a transaction can be retried before failing. */
 constexpr int kRetryCount = 5;
 
+/**
+ * Transactions back off twice as long after each failed attempt, so that the
+ * clients contending for the same documents spread out quickly.
+ */
+constexpr double kBackoffFactor = 2.0;
+constexpr std::chrono::milliseconds kBackoffInitialDelay{1000};
+constexpr std::chrono::milliseconds kBackoffMaxDelay{60 * 1000};
+
 bool IsRetryableTransactionError(const util::Status& error) {
   // In transactions, the backend will fail outdated reads with
   // FAILED_PRECONDITION and non-matching document versions with ABORTED. These
@@ -43,6 +53,22 @@ bool IsRetryableTransactionError(const util::Status& error) {
          code == Error::kErrorFailedPrecondition ||
          !remote::Datastore::IsPermanentError(error);
 }
+
+void RecordError(remote::TransactionMetrics& metrics, const Status& error) {
+  switch (error.code()) {
+    case Error::kErrorAborted:
+      metrics.RecordAborted();
+      break;
+    case Error::kErrorFailedPrecondition:
+      metrics.RecordFailedPrecondition();
+      break;
+    default:
+      if (!remote::Datastore::IsPermanentError(error)) {
+        metrics.RecordRetryableError();
+      }
+      break;
+  }
+}
 }  // namespace
 
 TransactionRunner::TransactionRunner(const std::shared_ptr<AsyncQueue>& queue,
@@ -53,7 +79,8 @@ TransactionRunner::TransactionRunner(const std::shared_ptr<AsyncQueue>& queue,
       remote_store_{remote_store},
       update_callback_{std::move(update_callback)},
       result_callback_{std::move(result_callback)},
-      backoff_{queue_, TimerId::RetryTransaction},
+      backoff_{queue_, TimerId::RetryTransaction, kBackoffFactor,
+               kBackoffInitialDelay, kBackoffMaxDelay},
       retries_left_{kRetryCount} {
 }
 
@@ -64,6 +91,7 @@ void TransactionRunner::Run() {
   backoff_.BackoffAndRun([shared_this] {
     std::shared_ptr<Transaction> transaction =
         shared_this->remote_store_->CreateTransaction();
+    shared_this->remote_store_->transaction_metrics().RecordAttempt();
     shared_this->update_callback_(
         transaction, [transaction, shared_this](const util::Status& status) {
           shared_this->queue_->Enqueue([transaction, shared_this, status] {
@@ -88,6 +116,7 @@ void TransactionRunner::ContinueCommit(
 void TransactionRunner::DispatchResult(
     const std::shared_ptr<Transaction>& transaction, Status status) {
   if (status.ok()) {
+    remote_store_->transaction_metrics().RecordCommit();
     result_callback_(std::move(status));
   } else {
     HandleTransactionError(transaction, std::move(status));
@@ -96,11 +125,22 @@ void TransactionRunner::DispatchResult(
 
 void TransactionRunner::HandleTransactionError(
     const std::shared_ptr<Transaction>& transaction, Status status) {
+  remote::TransactionMetrics& metrics = remote_store_->transaction_metrics();
+  RecordError(metrics, status);
+
   if (retries_left_ > 0 && IsRetryableTransactionError(status) &&
       !transaction->IsPermanentlyFailed()) {
     retries_left_ -= 1;
+    // An aborted transaction lost a race with another one for the same
+    // documents. Picking the delay anywhere between zero and the base delay
+    // keeps the contending clients from retrying in lockstep and aborting each
+    // other again.
+    backoff_.set_jitter(status.code() == Error::kErrorAborted
+                            ? ExponentialBackoff::Jitter::Full
+                            : ExponentialBackoff::Jitter::Proportional);
     Run();
   } else {
+    metrics.RecordFailure();
     result_callback_(std::move(status));
   }
 }
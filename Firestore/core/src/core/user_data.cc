@@ -51,10 +51,11 @@ ParseContext ParseAccumulator::RootContext() {
 }
 
 bool ParseAccumulator::Contains(const FieldPath& field_path) const {
-  for (const FieldPath& field : field_mask_) {
-    if (field_path.IsPrefixOf(field)) {
-      return true;
-    }
+  // Paths compare segment by segment, so the paths that start with
+  // `field_path` sort right after it.
+  auto candidate = field_mask_.lower_bound(field_path);
+  if (candidate != field_mask_.end() && field_path.IsPrefixOf(*candidate)) {
+    return true;
   }
 
   for (const FieldTransform& field_transform : field_transforms_) {
@@ -67,7 +68,9 @@ bool ParseAccumulator::Contains(const FieldPath& field_path) const {
 }
 
 void ParseAccumulator::AddToFieldMask(FieldPath field_path) {
-  field_mask_.insert(std::move(field_path));
+  if (tracks_field_mask()) {
+    field_mask_.insert(std::move(field_path));
+  }
 }
 
 void ParseAccumulator::AddToFieldTransforms(
@@ -112,25 +115,50 @@ const char* RESERVED_FIELD_DESIGNATOR = "__";
 
 }  // namespace
 
+ParseContext::ParseContext(ParseAccumulator* accumulator,
+                           const ParseContext* parent,
+                           std::string segment)
+    : accumulator_{accumulator},
+      parent_{parent},
+      segment_{std::move(segment)},
+      has_path_{true} {
+}
+
+const FieldPath* ParseContext::path() const {
+  if (!has_path_) {
+    return nullptr;
+  }
+  if (!path_) {
+    path_ = absl::make_unique<FieldPath>(parent_->path()->Append(segment_));
+  }
+  return path_.get();
+}
+
 ParseContext ParseContext::ChildContext(const std::string& field_name) {
-  std::unique_ptr<FieldPath> path;
-  if (path_) {
-    path = absl::make_unique<FieldPath>(path_->Append(field_name));
+  if (!has_path_) {
+    ParseContext context{accumulator_, /* path= */ nullptr,
+                         /* array_element= */ false};
+    context.ValidatePathSegment(field_name);
+    return context;
   }
 
-  ParseContext context{accumulator_, std::move(path), false};
+  ParseContext context{accumulator_, this, field_name};
   context.ValidatePathSegment(field_name);
   return context;
 }
 
 ParseContext ParseContext::ChildContext(const FieldPath& field_path) {
   std::unique_ptr<FieldPath> path;
-  if (path_) {
-    path = absl::make_unique<FieldPath>(path_->Append(field_path));
+  if (has_path_) {
+    path = absl::make_unique<FieldPath>(this->path()->Append(field_path));
   }
 
   ParseContext context{accumulator_, std::move(path), false};
-  context.ValidatePath();
+  // Only the new segments need validating; the ones of this context already
+  // were.
+  for (const std::string& segment : field_path) {
+    context.ValidatePathSegment(segment);
+  }
   return context;
 }
 
@@ -147,7 +175,7 @@ ParseContext ParseContext::ChildContext(size_t array_index) {
 std::string ParseContext::FieldDescription() const {
   // TODO(b/34871131): Remove nullptr check once we have proper paths for fields
   // within arrays.
-  if (!path_ || path_->empty()) {
+  if (!has_path_ || path()->empty()) {
     return "";
   } else {
     return util::StringFormat(" (found in field %s)", path_->CanonicalString());
@@ -169,17 +197,6 @@ bool ParseContext::write() const {
   }
 }
 
-void ParseContext::ValidatePath() const {
-  // TODO(b/34871131): Remove nullptr check once we have proper paths for fields
-  // within arrays.
-  if (!path_) {
-    return;
-  }
-  for (const std::string& segment : *path_) {
-    ValidatePathSegment(segment);
-  }
-}
-
 void ParseContext::ValidatePathSegment(absl::string_view segment) const {
   absl::string_view designator{RESERVED_FIELD_DESIGNATOR};
   if (segment.empty()) {
@@ -198,6 +215,12 @@ void ParseContext::AddToFieldMask(FieldPath field_path) {
   accumulator_->AddToFieldMask(std::move(field_path));
 }
 
+void ParseContext::AddPathToFieldMask() {
+  if (has_path_ && accumulator_->tracks_field_mask()) {
+    accumulator_->AddToFieldMask(*path());
+  }
+}
+
 void ParseContext::AddToFieldTransforms(
     FieldPath field_path, TransformOperation transform_operation) {
   accumulator_->AddToFieldTransforms(std::move(field_path),
@@ -112,6 +112,16 @@ class ParseAccumulator {
    */
   bool Contains(const model::FieldPath& field_path) const;
 
+  /**
+   * Whether the result of parsing uses the accumulated field mask. Only merges
+   * and updates do; for all other sources, `AddToFieldMask` discards its
+   * argument.
+   */
+  bool tracks_field_mask() const {
+    return data_source_ == UserDataSource::MergeSet ||
+           data_source_ == UserDataSource::Update;
+  }
+
   /**
    * Adds the given `field_path` to the accumulated FieldMask.
    */
@@ -183,6 +193,12 @@ class ParseAccumulator {
  * location in a user-supplied document. Instances are created and passed around
  * while traversing user data during parsing in order to conveniently accumulate
  * data in the ParseAccumulator.
+ *
+ * A child context doesn't copy the path of its parent; it only stores its own
+ * segment and builds its full path the first time `path()` is called. The
+ * parent must therefore outlive the child and stay where it is while the child
+ * is in use, which is the case when contexts are passed down the recursion
+ * that traverses the user data.
  */
 class ParseContext {
  public:
@@ -203,6 +219,7 @@ class ParseContext {
                std::unique_ptr<model::FieldPath> path,
                bool array_element)
       : accumulator_{accumulator},
+        has_path_{path != nullptr},
         path_{std::move(path)},
         array_element_{array_element} {
   }
@@ -221,9 +238,11 @@ class ParseContext {
     return accumulator_->data_source_;
   }
 
-  const model::FieldPath* path() const {
-    return path_.get();
-  }
+  /**
+   * The path of this context within the data being parsed, or null if the
+   * context is within an array.
+   */
+  const model::FieldPath* path() const;
 
   /**
    * Returns true for the non-query parse contexts (Set, MergeSet and Update).
@@ -239,19 +258,37 @@ class ParseContext {
 
   void AddToFieldMask(model::FieldPath field_path);
 
+  /**
+   * Adds the path of this context, if there is one, to the field mask. Doesn't
+   * build the path if the field mask isn't used.
+   */
+  void AddPathToFieldMask();
+
   void AddToFieldTransforms(model::FieldPath field_path,
                             model::TransformOperation transform_operation);
 
  private:
-  void ValidatePath() const;
   void ValidatePathSegment(absl::string_view segment) const;
 
+  ParseContext(ParseAccumulator* accumulator,
+               const ParseContext* parent,
+               std::string segment);
+
   ParseAccumulator* accumulator_;  // Non owning
 
-  /** The current path being parsed. */
-  // TODO(b/34871131): path should never be nullptr, but we don't support array
+  /**
+   * The parent of a context created by `ChildContext(const std::string&)`,
+   * whose path is the path of the parent followed by `segment_`.
+   */
+  const ParseContext* parent_ = nullptr;  // Non owning
+  std::string segment_;
+
+  // TODO(b/34871131): path should never be missing, but we don't support array
   // paths right now.
-  std::unique_ptr<model::FieldPath> path_;
+  bool has_path_ = false;
+
+  /** The current path being parsed, built lazily for child contexts. */
+  mutable std::unique_ptr<model::FieldPath> path_;
 
   bool array_element_ = false;
 };
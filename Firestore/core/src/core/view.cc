@@ -16,11 +16,14 @@
 
 #include "Firestore/core/src/core/view.h"
 
+#include <set>
 #include <utility>
 
 #include "Firestore/core/src/core/target.h"
 #include "Firestore/core/src/model/document_set.h"
+#include "Firestore/core/src/model/field_path.h"
 #include "Firestore/core/src/model/field_value.h"
+#include "Firestore/core/src/util/trace.h"
 
 namespace firebase {
 namespace firestore {
@@ -30,12 +33,49 @@ using model::Document;
 using model::DocumentKey;
 using model::DocumentKeySet;
 using model::DocumentSet;
+using model::FieldMask;
+using model::FieldPath;
+using model::FieldValue;
 using model::MaybeDocument;
 using model::MaybeDocumentMap;
+using model::ObjectValue;
 using model::OnlineState;
 using remote::TargetChange;
 using util::ComparisonResult;
 
+namespace {
+
+absl::optional<FieldMask> RetainedFields(const Query& query) {
+  if (!query.projection()) return absl::nullopt;
+
+  std::set<FieldPath> fields(query.projection()->begin(),
+                             query.projection()->end());
+  for (const OrderBy& order_by : query.order_bys()) {
+    if (!order_by.field().IsKeyFieldPath()) {
+      fields.insert(order_by.field());
+    }
+  }
+  return FieldMask(std::move(fields));
+}
+
+/**
+ * Returns a copy of `doc` with only the given fields. Lazily decoded documents
+ * only decode these fields.
+ */
+Document ProjectDocument(const Document& doc, const FieldMask& fields) {
+  ObjectValue::Builder builder(ObjectValue::Empty());
+  for (const FieldPath& field : fields) {
+    absl::optional<FieldValue> value = doc.field(field);
+    if (value) {
+      builder.Set(field, *std::move(value));
+    }
+  }
+  return Document(builder.Build(), doc.key(), doc.version(),
+                  doc.document_state());
+}
+
+}  // namespace
+
 // MARK: - LimboDocumentChange
 
 LimboDocumentChange::LimboDocumentChange(
@@ -63,29 +103,10 @@ ViewDocumentChanges::ViewDocumentChanges(model::DocumentSet new_documents,
 
 // MARK: - View
 
-namespace {
-
-int GetDocumentViewChangeTypePosition(DocumentViewChange::Type change_type) {
-  switch (change_type) {
-    case DocumentViewChange::Type::Removed:
-      return 0;
-    case DocumentViewChange::Type::Added:
-      return 1;
-    case DocumentViewChange::Type::Modified:
-      return 2;
-    case DocumentViewChange::Type::Metadata:
-      // A metadata change is converted to a modified change at the public API
-      // layer. Since we sort by document key and then change type, metadata and
-      // modified changes must be sorted equivalently.
-      return 2;
-  }
-  HARD_FAIL("Unknown DocumentViewChange::Type %s", change_type);
-}
-
-}  // namespace
-
 View::View(Query query, DocumentKeySet remote_documents)
     : query_(std::move(query)),
+      matcher_(query_),
+      retained_fields_(RetainedFields(query_)),
       document_set_(query_.Comparator()),
       synced_documents_(std::move(remote_documents)) {
 }
@@ -97,6 +118,16 @@ ComparisonResult View::Compare(const Document& lhs, const Document& rhs) const {
 ViewDocumentChanges View::ComputeDocumentChanges(
     const MaybeDocumentMap& doc_changes,
     const absl::optional<ViewDocumentChanges>& previous_changes) const {
+  FIRESTORE_TRACE_SPAN("View::ComputeDocumentChanges");
+  // Listeners frequently receive updates to one document at a time; most of
+  // them modify a document without moving it.
+  if (!previous_changes && doc_changes.size() == 1) {
+    const auto& change = *doc_changes.begin();
+    absl::optional<ViewDocumentChanges> in_place =
+        ComputeInPlaceChange(change.first, change.second);
+    if (in_place) return *std::move(in_place);
+  }
+
   DocumentViewChangeSet change_set;
   if (previous_changes) {
     change_set = previous_changes->change_set();
@@ -143,8 +174,10 @@ ViewDocumentChanges View::ComputeDocumentChanges(
       HARD_ASSERT(key == new_doc->key(),
                   "Mismatching key in document changes: %s != %s",
                   key.ToString(), new_doc->key().ToString());
-      if (!query_.Matches(*new_doc)) {
+      if (!matcher_.Matches(*new_doc)) {
         new_doc = absl::nullopt;
+      } else if (retained_fields_) {
+        new_doc = ProjectDocument(*new_doc, *retained_fields_);
       }
     }
 
@@ -244,6 +277,55 @@ ViewDocumentChanges View::ComputeDocumentChanges(
                              new_mutated_keys, needs_refill);
 }
 
+absl::optional<ViewDocumentChanges> View::ComputeInPlaceChange(
+    const DocumentKey& key, const MaybeDocument& maybe_new_doc) const {
+  if (!maybe_new_doc.is_document()) return absl::nullopt;
+
+  absl::optional<Document> old_doc = document_set_.GetDocument(key);
+  if (!old_doc) return absl::nullopt;
+
+  Document new_doc(maybe_new_doc);
+  HARD_ASSERT(key == new_doc.key(),
+              "Mismatching key in document changes: %s != %s", key.ToString(),
+              new_doc.key().ToString());
+  if (!matcher_.Matches(new_doc) ||
+      !util::Same(Compare(new_doc, *old_doc))) {
+    return absl::nullopt;
+  }
+  if (retained_fields_) {
+    new_doc = ProjectDocument(new_doc, *retained_fields_);
+  }
+
+  // The document keeps its position, so it stays within the limit and neither
+  // displaces nor admits other documents. Otherwise this matches the general
+  // case in ComputeDocumentChanges.
+  bool old_doc_had_pending_mutations = mutated_keys_.contains(key);
+  bool new_doc_has_pending_mutations =
+      new_doc.has_local_mutations() ||
+      (old_doc_had_pending_mutations && new_doc.has_committed_mutations());
+
+  DocumentViewChangeSet change_set;
+  bool docs_equal = old_doc->data() == new_doc.data();
+  if (!docs_equal && !ShouldWaitForSyncedDocument(new_doc, *old_doc)) {
+    change_set.AddChange(
+        DocumentViewChange{new_doc, DocumentViewChange::Type::Modified});
+  } else if (docs_equal &&
+             old_doc_had_pending_mutations != new_doc_has_pending_mutations) {
+    change_set.AddChange(
+        DocumentViewChange{new_doc, DocumentViewChange::Type::Metadata});
+  } else {
+    return ViewDocumentChanges(document_set_, std::move(change_set),
+                               mutated_keys_, /*needs_refill=*/false);
+  }
+
+  DocumentKeySet new_mutated_keys = new_doc.has_local_mutations()
+                                        ? mutated_keys_.insert(key)
+                                        : mutated_keys_.erase(key);
+  return ViewDocumentChanges(document_set_.insert(new_doc),
+                             std::move(change_set), std::move(new_mutated_keys),
+                             /*needs_refill=*/false);
+}
+
 bool View::ShouldWaitForSyncedDocument(const Document& new_doc,
                                        const Document& old_doc) const {
   // We suppress the initial change event for documents that were modified as
@@ -264,6 +346,7 @@ ViewChange View::ApplyChanges(const ViewDocumentChanges& doc_changes) {
 ViewChange View::ApplyChanges(
     const ViewDocumentChanges& doc_changes,
     const absl::optional<TargetChange>& target_change) {
+  FIRESTORE_TRACE_SPAN("View::ApplyChanges");
   HARD_ASSERT(!doc_changes.needs_refill(),
               "Cannot apply changes that need a refill");
 
@@ -273,17 +356,7 @@ ViewChange View::ApplyChanges(
 
   // Sort changes based on type and query comparator.
   std::vector<DocumentViewChange> changes =
-      doc_changes.change_set().GetChanges();
-  std::sort(
-      changes.begin(), changes.end(),
-      [this](const DocumentViewChange& lhs, const DocumentViewChange& rhs) {
-        int pos1 = GetDocumentViewChangeTypePosition(lhs.type());
-        int pos2 = GetDocumentViewChangeTypePosition(rhs.type());
-        if (pos1 != pos2) {
-          return pos1 < pos2;
-        }
-        return util::Ascending(Compare(lhs.document(), rhs.document()));
-      });
+      doc_changes.change_set().GetSortedChanges(document_set_.comparator());
 
   ApplyTargetChange(target_change);
   std::vector<LimboDocumentChange> limbo_changes = UpdateLimboDocuments();
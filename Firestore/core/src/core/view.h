@@ -20,9 +20,11 @@
 #include <utility>
 #include <vector>
 
+#include "Firestore/core/src/core/query_matcher.h"
 #include "Firestore/core/src/core/view_snapshot.h"
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/document_set.h"
+#include "Firestore/core/src/model/field_mask.h"
 #include "Firestore/core/src/model/types.h"
 #include "Firestore/core/src/remote/remote_event.h"
 
@@ -137,6 +139,16 @@ class View {
  public:
   View(Query query, model::DocumentKeySet remote_documents);
 
+  /** The documents currently in the view. */
+  const model::DocumentSet& document_set() const {
+    return document_set_;
+  }
+
+  /** The keys of the documents in the view that have pending writes. */
+  const model::DocumentKeySet& mutated_keys() const {
+    return mutated_keys_;
+  }
+
   /**
    * The set of remote documents that the server has told us belongs to the
    * target associated with this view.
@@ -196,6 +208,16 @@ class View {
   util::ComparisonResult Compare(const model::Document& lhs,
                                  const model::Document& rhs) const;
 
+  /**
+   * Computes the changes for an update of a single document that is already
+   * in the view and stays at the same position, which can neither change the
+   * limit nor require a refill. Returns nullopt if the update is of any other
+   * kind.
+   */
+  absl::optional<core::ViewDocumentChanges> ComputeInPlaceChange(
+      const model::DocumentKey& key,
+      const model::MaybeDocument& maybe_new_doc) const;
+
   bool ShouldBeInLimbo(const model::DocumentKey& key) const;
 
   bool ShouldWaitForSyncedDocument(const model::Document& new_doc,
@@ -208,6 +230,15 @@ class View {
 
   Query query_;
 
+  /** The query compiled for matching the documents of incoming changes. */
+  QueryMatcher matcher_;
+
+  /**
+   * The fields the view keeps of the documents of a projected query: the
+   * projection, plus the fields the documents are sorted by.
+   */
+  absl::optional<model::FieldMask> retained_fields_;
+
   model::DocumentSet document_set_;
 
   /** Documents included in the remote target. */
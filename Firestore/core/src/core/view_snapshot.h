@@ -84,6 +84,13 @@ class DocumentViewChangeSet {
   /** Returns the set of all changes tracked in this set. */
   std::vector<DocumentViewChange> GetChanges() const;
 
+  /**
+   * Returns the changes in the order they are delivered in snapshots: removals
+   * first, then additions, then modifications, each sorted by `comparator`.
+   */
+  std::vector<DocumentViewChange> GetSortedChanges(
+      const model::DocumentComparator& comparator) const;
+
   std::string ToString() const;
 
  private:
@@ -49,12 +49,14 @@ namespace impl {
  * to a FixedArray.
  *
  * @tparam T The type of an element in the array.
+ * @tparam FixedSize The capacity of the array.
  */
-template <typename T>
+template <typename T,
+          SortedMapBase::size_type FixedSize = SortedMapBase::kFixedSize>
 class FixedArray {
  public:
   using size_type = SortedMapBase::size_type;
-  using array_type = std::array<T, SortedMapBase::kFixedSize>;
+  using array_type = std::array<T, FixedSize>;
   using iterator = typename array_type::iterator;
   using const_iterator = typename array_type::const_iterator;
 
@@ -74,7 +76,7 @@ class FixedArray {
   void append(SourceIterator src_begin, SourceIterator src_end) {
     auto appending = static_cast<size_type>(src_end - src_begin);
     auto new_size = size_ + appending;
-    HARD_ASSERT(new_size <= SortedMapBase::kFixedSize);
+    HARD_ASSERT(new_size <= FixedSize);
 
     std::copy(src_begin, src_end, end());
     size_ = new_size;
@@ -85,7 +87,7 @@ class FixedArray {
    */
   void append(T&& value) {
     size_type new_size = size_ + 1;
-    HARD_ASSERT(new_size <= SortedMapBase::kFixedSize);
+    HARD_ASSERT(new_size <= FixedSize);
 
     *end() = std::move(value);
     size_ = new_size;
@@ -119,10 +121,18 @@ class FixedArray {
 /**
  * ArraySortedMap is a value type containing a map. It is immutable, but has
  * methods to efficiently create new maps that are mutations of it.
+ *
+ * @tparam FixedSize The maximum number of entries in the map.
  */
-template <typename K, typename V, typename C = util::Comparator<K>>
+template <typename K,
+          typename V,
+          typename C = util::Comparator<K>,
+          SortedMapBase::size_type FixedSize = SortedMapBase::kFixedSize>
 class ArraySortedMap : public SortedMapBase {
  public:
+  /** The maximum size of this map, which hides SortedMapBase::kFixedSize. */
+  static constexpr size_type kFixedSize = FixedSize;
+
   /**
    * The type of the entries stored in the map.
    */
@@ -131,7 +141,7 @@ class ArraySortedMap : public SortedMapBase {
   /**
    * The type of the fixed-size array containing entries of value_type.
    */
-  using array_type = FixedArray<value_type>;
+  using array_type = FixedArray<value_type, FixedSize>;
   using const_iterator = typename array_type::const_iterator;
   using const_key_iterator = util::iterator_first<const_iterator>;
 
@@ -152,6 +162,25 @@ class ArraySortedMap : public SortedMapBase {
       : array_{SortedArray(entries, comparator)}, comparator_{comparator} {
   }
 
+  /**
+   * Creates an ArraySortedMap from a range of at most kFixedSize pairs whose
+   * keys are in strictly ascending order.
+   */
+  template <typename Iterator>
+  static ArraySortedMap FromSortedRange(Iterator begin,
+                                        Iterator end,
+                                        const C& comparator) {
+    if (begin == end) {
+      return ArraySortedMap{comparator};
+    }
+
+    auto array = std::make_shared<array_type>();
+    for (; begin != end; ++begin) {
+      array->append(value_type(*begin));
+    }
+    return ArraySortedMap{std::move(array), comparator};
+  }
+
   /** Returns true if the map contains no elements. */
   bool empty() const {
     return size() == 0;
@@ -239,9 +268,11 @@ class ArraySortedMap : public SortedMapBase {
    *     not found.
    */
   const_iterator find(const K& key) const {
-    return std::find_if(begin(), end(), [&](const std::pair<K, V>& kv) {
-      return util::Same(comparator_.Compare(key, kv.first));
-    });
+    const_iterator found = lower_bound(key);
+    if (found != end() && util::Same(comparator_.Compare(key, found->first))) {
+      return found;
+    }
+    return end();
   }
 
   /**
@@ -255,6 +286,16 @@ class ArraySortedMap : public SortedMapBase {
     return found == end() ? npos : static_cast<size_type>(found - begin());
   }
 
+  /**
+   * Returns the entry at the given position in the order of the map.
+   *
+   * @param index The index of the entry, which must be less than `size()`.
+   */
+  const value_type& at_index(size_type index) const {
+    HARD_ASSERT(index < size(), "Index %s out of range", index);
+    return *(begin() + index);
+  }
+
   /**
    * Finds the first entry in the map containing a key greater than or equal
    * to the given key.
@@ -356,6 +397,9 @@ class ArraySortedMap : public SortedMapBase {
   C comparator_;
 };
 
+template <typename K, typename V, typename C, SortedMapBase::size_type N>
+constexpr SortedMapBase::size_type ArraySortedMap<K, V, C, N>::kFixedSize;
+
 }  // namespace impl
 }  // namespace immutable
 }  // namespace firestore
@@ -17,10 +17,14 @@
 #ifndef FIRESTORE_CORE_SRC_IMMUTABLE_LLRB_NODE_H_
 #define FIRESTORE_CORE_SRC_IMMUTABLE_LLRB_NODE_H_
 
-#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <utility>
 
 #include "Firestore/core/src/immutable/llrb_node_iterator.h"
+#include "Firestore/core/src/immutable/node_allocator.h"
 #include "Firestore/core/src/immutable/sorted_container.h"
 #include "Firestore/core/src/util/comparison.h"
 
@@ -55,7 +59,36 @@ class LlrbNode : public SortedMapBase {
   /**
    * Constructs an empty node.
    */
-  LlrbNode() : LlrbNode{EmptyRep()} {
+  LlrbNode() : rep_{EmptyRep()} {
+  }
+
+  LlrbNode(const LlrbNode& other) : rep_{other.rep_} {
+    Retain();
+  }
+
+  LlrbNode(LlrbNode&& other) noexcept : rep_{other.rep_} {
+    other.rep_ = nullptr;
+  }
+
+  ~LlrbNode() {
+    Release();
+  }
+
+  LlrbNode& operator=(const LlrbNode& other) {
+    if (rep_ != other.rep_) {
+      LlrbNode copy{other};
+      std::swap(rep_, copy.rep_);
+    }
+    return *this;
+  }
+
+  LlrbNode& operator=(LlrbNode&& other) noexcept {
+    if (this != &other) {
+      Release();
+      rep_ = other.rep_;
+      other.rep_ = nullptr;
+    }
+    return *this;
   }
 
   /** Returns true if this is an empty node--a leaf node in the tree. */
@@ -92,6 +125,24 @@ class LlrbNode : public SortedMapBase {
     return rep_->right_;
   }
 
+  /**
+   * Returns true if this and `other` are the same node, shared by the trees
+   * that contain them. Shared nodes hold identical subtrees.
+   */
+  bool shares_node_with(const LlrbNode& other) const {
+    return rep_ == other.rep_;
+  }
+
+  /**
+   * Builds a balanced tree from the `size` entries starting at `begin`, which
+   * must be in strictly ascending key order.
+   *
+   * This runs in O(n) and allocates each node exactly once, whereas building
+   * the same tree by repeated insertion copies the path to each new entry.
+   */
+  template <typename Iterator>
+  static LlrbNode FromSortedRange(Iterator begin, size_type size);
+
   /** Returns a tree node with the given key-value pair set/updated. */
   template <typename Comparator>
   LlrbNode insert(const K& key,
@@ -118,6 +169,14 @@ class LlrbNode : public SortedMapBase {
   }
 
  private:
+  /**
+   * The contents of a node, shared by all the trees that contain it.
+   *
+   * Reps are reference counted intrusively rather than through a shared_ptr:
+   * this halves the size of each child link and saves the control block, and
+   * lets the shared empty Rep skip reference counting altogether. Reps are
+   * allocated through NodeAllocator, which recycles the memory of freed nodes.
+   */
   struct Rep {
     Rep(value_type&& entry,
         size_type color,
@@ -139,41 +198,86 @@ class LlrbNode : public SortedMapBase {
           right_{std::move(right)} {
     }
 
+    Rep(const Rep& other)
+        : entry_{other.entry_},
+          color_{other.color_},
+          size_{other.size_},
+          left_{other.left_},
+          right_{other.right_} {
+    }
+
+    Rep(Rep&& other) noexcept
+        : entry_{std::move(other.entry_)},
+          color_{other.color_},
+          size_{other.size_},
+          left_{std::move(other.left_)},
+          right_{std::move(other.right_)} {
+    }
+
     value_type entry_;
 
     // Store the color in the high bit of the size to save memory.
     size_type color_ : 1;
     size_type size_ : 31;
 
+    std::atomic<uint32_t> ref_count_{1};
+
     LlrbNode left_;
     LlrbNode right_;
   };
 
-  explicit LlrbNode(Rep rep) : rep_{std::make_shared<Rep>(std::move(rep))} {
+  explicit LlrbNode(Rep&& rep) : rep_{NewRep(std::move(rep))} {
+  }
+
+  /** Takes ownership of a reference to the given Rep. */
+  explicit LlrbNode(Rep* rep) : rep_{rep} {
   }
 
-  explicit LlrbNode(const std::shared_ptr<Rep>& rep) : rep_{rep} {
+  template <typename... Args>
+  static Rep* NewRep(Args&&... args) {
+    static_assert(alignof(Rep) <= alignof(std::max_align_t),
+                  "NodeAllocator only guarantees fundamental alignment");
+    void* memory = NodeAllocator::Allocate(sizeof(Rep));
+    return new (memory) Rep(std::forward<Args>(args)...);
   }
 
-  explicit LlrbNode(std::shared_ptr<Rep>&& rep) : rep_{std::move(rep)} {
+  static void DeleteRep(Rep* rep) {
+    rep->~Rep();
+    NodeAllocator::Deallocate(rep, sizeof(Rep));
   }
 
   /**
    * Returns a shared Empty node, to cut down on allocations in the base case.
+   * The empty Rep is never freed, so it's not reference counted.
    */
-  static const std::shared_ptr<Rep>& EmptyRep() {
-    static const std::shared_ptr<Rep>* empty_rep = [] {
+  static Rep* EmptyRep() {
+    static Rep* empty_rep = [] {
       auto rep = new Rep{std::pair<K, V>{}, Color::Black,
                          /* size= */ 0u, LlrbNode{nullptr}, LlrbNode{nullptr}};
-      auto empty = new std::shared_ptr<Rep>{rep};
 
       // Set up the empty Rep such that you can traverse infinitely down left
       // and right links.
-      (*empty)->left_.rep_ = *empty;
-      (*empty)->right_.rep_ = *empty;
-      return empty;
+      rep->left_.rep_ = rep;
+      rep->right_.rep_ = rep;
+      return rep;
     }();
-    return *empty_rep;
+    return empty_rep;
+  }
+
+  // Only the empty Rep has size zero, so checking the size avoids touching the
+  // reference count of the empty Rep, which is shared by all threads.
+  void Retain() const {
+    if (rep_ && rep_->size_ != 0) {
+      rep_->ref_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void Release() {
+    if (rep_ && rep_->size_ != 0 &&
+        rep_->ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      DeleteRep(rep_);
+    }
+    rep_ = nullptr;
   }
 
   /**
@@ -181,7 +285,7 @@ class LlrbNode : public SortedMapBase {
    * duplicating the left_ and right_ children.
    */
   LlrbNode Clone() const {
-    return LlrbNode{*rep_};
+    return LlrbNode{NewRep(*rep_)};
   }
 
   void set_size(size_type size) {
@@ -213,6 +317,11 @@ class LlrbNode : public SortedMapBase {
     rep_->right_ = std::move(right);
   }
 
+  template <typename Iterator>
+  static LlrbNode BuildBalanced(Iterator* it,
+                                uint64_t size,
+                                int black_height);
+
   template <typename Comparator>
   LlrbNode InnerInsert(const K& key,
                        const V& value,
@@ -236,9 +345,81 @@ class LlrbNode : public SortedMapBase {
     return rep_->color_ == Color::Red ? Color::Black : Color::Red;
   }
 
-  std::shared_ptr<Rep> rep_;
+  Rep* rep_ = nullptr;
 };
 
+template <typename K, typename V>
+template <typename Iterator>
+LlrbNode<K, V> LlrbNode<K, V>::FromSortedRange(Iterator begin,
+                                               size_type size) {
+  // Use the greatest black height that a tree of this size can have if all
+  // its nodes are 2-nodes. BuildBalanced merges entries into 3-nodes (a black
+  // node with a red left child) as needed to absorb the remainder.
+  int black_height = 0;
+  while ((uint64_t{2} << black_height) - 1 <= size) {
+    ++black_height;
+  }
+  return BuildBalanced(&begin, size, black_height);
+}
+
+/**
+ * Builds a left-leaning red-black tree of the next `size` entries from `it`,
+ * in which every path from the root to a leaf passes through exactly
+ * `black_height` black nodes.
+ *
+ * Viewed as a 2-3 tree, such a tree can hold between 2^h - 1 entries (all
+ * 2-nodes) and 3^h - 1 entries (all 3-nodes), and `size` must be in that
+ * range. The root is a 2-node if the remaining entries fit in two subtrees of
+ * black height h - 1 and a 3-node otherwise; in either case the remaining
+ * entries are split evenly between the subtrees, which keeps them in range
+ * too.
+ */
+template <typename K, typename V>
+template <typename Iterator>
+LlrbNode<K, V> LlrbNode<K, V>::BuildBalanced(Iterator* it,
+                                             uint64_t size,
+                                             int black_height) {
+  if (black_height == 0) {
+    return LlrbNode{};
+  }
+
+  uint64_t max_subtree_size = 1;
+  for (int i = 1; i < black_height; ++i) {
+    max_subtree_size *= 3;
+  }
+  max_subtree_size -= 1;
+
+  if (size <= 2 * max_subtree_size + 1) {
+    uint64_t right_size = (size - 1) / 2;
+    uint64_t left_size = size - 1 - right_size;
+
+    LlrbNode left = BuildBalanced(it, left_size, black_height - 1);
+    value_type entry(**it);
+    ++*it;
+    LlrbNode right = BuildBalanced(it, right_size, black_height - 1);
+
+    return LlrbNode{
+        Rep{std::move(entry), Color::Black, std::move(left), std::move(right)}};
+  }
+
+  uint64_t right_size = (size - 2) / 3;
+  uint64_t middle_size = (size - 2 - right_size) / 2;
+  uint64_t left_size = size - 2 - right_size - middle_size;
+
+  LlrbNode left = BuildBalanced(it, left_size, black_height - 1);
+  value_type red_entry(**it);
+  ++*it;
+  LlrbNode middle = BuildBalanced(it, middle_size, black_height - 1);
+  value_type black_entry(**it);
+  ++*it;
+  LlrbNode right = BuildBalanced(it, right_size, black_height - 1);
+
+  LlrbNode red_left{Rep{std::move(red_entry), Color::Red, std::move(left),
+                        std::move(middle)}};
+  return LlrbNode{Rep{std::move(black_entry), Color::Black,
+                      std::move(red_left), std::move(right)}};
+}
+
 template <typename K, typename V>
 template <typename Comparator>
 LlrbNode<K, V> LlrbNode<K, V>::insert(const K& key,
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/immutable/node_allocator.h"
+
+#include <cstdint>
+#include <new>
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace impl {
+namespace {
+
+/** Blocks are rounded up to a multiple of this size. */
+constexpr size_t kSizeClassGranularity = 16;
+
+/** Blocks larger than kSizeClassCount * granularity bytes aren't cached. */
+constexpr size_t kSizeClassCount = 16;
+
+/** The maximum number of free blocks cached per size class and thread. */
+constexpr uint32_t kMaxCachedBlocks = 256;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+/**
+ * The free lists of a thread. Every block in the free list for size class `i`
+ * is `(i + 1) * kSizeClassGranularity` bytes long.
+ */
+class ThreadCache {
+ public:
+  ThreadCache() = default;
+
+  ~ThreadCache();
+
+  FreeBlock* free_lists[kSizeClassCount] = {};
+  uint32_t free_counts[kSizeClassCount] = {};
+};
+
+// Set once the calling thread's cache has been destroyed, so that nodes freed
+// later during thread exit (e.g. by other thread-local destructors) go back to
+// the global allocator. This is trivially destructible, so it remains usable
+// for the entire lifetime of the thread.
+thread_local bool thread_cache_destroyed = false;
+
+ThreadCache::~ThreadCache() {
+  thread_cache_destroyed = true;
+  for (FreeBlock* block : free_lists) {
+    while (block) {
+      FreeBlock* next = block->next;
+      ::operator delete(block);
+      block = next;
+    }
+  }
+}
+
+ThreadCache* GetThreadCache() {
+  if (thread_cache_destroyed) {
+    return nullptr;
+  }
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+size_t SizeClass(size_t size) {
+  return (size + kSizeClassGranularity - 1) / kSizeClassGranularity - 1;
+}
+
+}  // namespace
+
+void* NodeAllocator::Allocate(size_t size) {
+  size_t size_class = SizeClass(size);
+  if (size_class >= kSizeClassCount) {
+    return ::operator new(size);
+  }
+
+  ThreadCache* cache = GetThreadCache();
+  if (cache) {
+    FreeBlock* block = cache->free_lists[size_class];
+    if (block) {
+      cache->free_lists[size_class] = block->next;
+      --cache->free_counts[size_class];
+      return block;
+    }
+  }
+
+  // Allocate the whole size class so that the block can be reused for any
+  // size that maps to it.
+  return ::operator new((size_class + 1) * kSizeClassGranularity);
+}
+
+void NodeAllocator::Deallocate(void* block, size_t size) {
+  size_t size_class = SizeClass(size);
+  if (size_class < kSizeClassCount) {
+    ThreadCache* cache = GetThreadCache();
+    if (cache && cache->free_counts[size_class] < kMaxCachedBlocks) {
+      auto free_block = static_cast<FreeBlock*>(block);
+      free_block->next = cache->free_lists[size_class];
+      cache->free_lists[size_class] = free_block;
+      ++cache->free_counts[size_class];
+      return;
+    }
+  }
+
+  ::operator delete(block);
+}
+
+}  // namespace impl
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
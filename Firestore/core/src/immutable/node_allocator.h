@@ -0,0 +1,58 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_IMMUTABLE_NODE_ALLOCATOR_H_
+#define FIRESTORE_CORE_SRC_IMMUTABLE_NODE_ALLOCATOR_H_
+
+#include <cstddef>
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace impl {
+
+/**
+ * Allocates the nodes of immutable trees.
+ *
+ * Persistent trees allocate a node for every node on the path to each entry
+ * they insert or erase, and free the old path as soon as the previous version
+ * of the tree is dropped. NodeAllocator serves these short-lived, same-sized
+ * blocks from a per-thread cache of recently freed blocks, grouped into size
+ * classes, and only falls back to the global allocator when the cache for the
+ * requested size class is empty (or full, when deallocating).
+ *
+ * Blocks may be freed on a different thread than the one that allocated them.
+ * Each thread caches a bounded number of blocks, which are returned to the
+ * global allocator when the thread exits.
+ */
+class NodeAllocator {
+ public:
+  /** Allocates a block of at least `size` bytes. */
+  static void* Allocate(size_t size);
+
+  /**
+   * Frees a block previously returned by `Allocate()`. `size` must be the size
+   * that was passed to `Allocate()`.
+   */
+  static void Deallocate(void* block, size_t size);
+};
+
+}  // namespace impl
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_IMMUTABLE_NODE_ALLOCATOR_H_
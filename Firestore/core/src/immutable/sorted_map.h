@@ -17,7 +17,10 @@
 #ifndef FIRESTORE_CORE_SRC_IMMUTABLE_SORTED_MAP_H_
 #define FIRESTORE_CORE_SRC_IMMUTABLE_SORTED_MAP_H_
 
+#include <algorithm>
+#include <iterator>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/immutable/array_sorted_map.h"
 #include "Firestore/core/src/immutable/keys_view.h"
@@ -35,20 +38,35 @@ namespace immutable {
 /**
  * SortedMap is a value type containing a map. It is immutable, but
  * has methods to efficiently create new maps that are mutations of it.
+ *
+ * Maps of up to `FixedSize` entries are stored in a sorted array, and larger
+ * maps in a balanced tree. Arrays are faster to search and iterate, but each
+ * insertion or removal copies the whole array (and each array allocates room
+ * for `FixedSize` entries), so the best threshold depends on the size of the
+ * entries and on how the map is used; see `sorted_map_benchmark.cc`.
  */
-template <typename K, typename V, typename C = util::Comparator<K>>
+template <typename K,
+          typename V,
+          typename C = util::Comparator<K>,
+          SortedMapBase::size_type FixedSize = SortedMapBase::kFixedSize>
 class SortedMap : public SortedMapBase {
  public:
+  /**
+   * The size above which this map is stored as a tree. Hides
+   * SortedMapBase::kFixedSize.
+   */
+  static constexpr size_type kFixedSize = FixedSize;
+
   using key_type = K;
   using mapped_type = V;
   /** The type of the entries stored in the map. */
   using value_type = std::pair<K, V>;
-  using array_type = impl::ArraySortedMap<K, V, C>;
+  using array_type = impl::ArraySortedMap<K, V, C, FixedSize>;
   using tree_type = impl::TreeSortedMap<K, V, C>;
 
   using const_iterator = impl::SortedMapIterator<
       value_type,
-      typename impl::FixedArray<value_type>::const_iterator,
+      typename impl::FixedArray<value_type, FixedSize>::const_iterator,
       typename impl::LlrbNode<K, V>::const_iterator>;
 
   using const_key_iterator = util::iterator_first<const_iterator>;
@@ -73,6 +91,25 @@ class SortedMap : public SortedMapBase {
     }
   }
 
+  /**
+   * Creates a SortedMap from a range of pairs whose keys are in strictly
+   * ascending order, such as the results of a LevelDB scan. This takes linear
+   * time, while inserting the same entries one by one takes O(n log n) and
+   * copies the path to every new entry.
+   */
+  template <typename Iterator>
+  static SortedMap FromSortedRange(Iterator begin,
+                                   Iterator end,
+                                   const C& comparator = {}) {
+    if (static_cast<size_type>(std::distance(begin, end)) <= kFixedSize) {
+      return SortedMap{array_type::FromSortedRange(begin, end, comparator)};
+    } else {
+      return SortedMap{tree_type::FromSortedRange(begin, end, comparator)};
+    }
+  }
+
+  class Builder;
+
   SortedMap(const SortedMap& other) : tag_{other.tag_} {
     switch (tag_) {
       case Tag::Array:
@@ -265,6 +302,21 @@ class SortedMap : public SortedMapBase {
     UNREACHABLE();
   }
 
+  /**
+   * Returns the entry at the given position in the order of the map.
+   *
+   * @param index The index of the entry, which must be less than `size()`.
+   */
+  const value_type& at_index(size_type index) const {
+    switch (tag_) {
+      case Tag::Array:
+        return array_.at_index(index);
+      case Tag::Tree:
+        return tree_.at_index(index);
+    }
+    UNREACHABLE();
+  }
+
   absl::optional<V> get(const K& key) const {
     auto found = find(key);
     if (found != end()) {
@@ -366,6 +418,50 @@ class SortedMap : public SortedMapBase {
     return impl::KeysViewIn(*this, start_key, end_key, comparator());
   }
 
+  /**
+   * Calls `callback(before_entry, after_entry)`, in key order, for entries
+   * that may differ between the two maps. Either pointer is null if the key is
+   * only in the other map; if both are set, the values may still be equal.
+   *
+   * When both maps are trees, subtrees they share are skipped without being
+   * visited (see `TreeSortedMap::Diff`), so diffing a map against one derived
+   * from it takes time proportional to the number of changes rather than to
+   * the size of the maps. Otherwise every entry of both maps is visited.
+   */
+  template <typename Callback>
+  static void Diff(const SortedMap& before,
+                   const SortedMap& after,
+                   const Callback& callback) {
+    if (before.tag_ == Tag::Tree && after.tag_ == Tag::Tree) {
+      tree_type::Diff(before.tree_, after.tree_, callback);
+      return;
+    }
+
+    const C& comparator = before.comparator();
+    auto lhs = before.begin();
+    auto rhs = after.begin();
+    while (lhs != before.end() && rhs != after.end()) {
+      util::ComparisonResult cmp = comparator.Compare(lhs->first, rhs->first);
+      if (cmp == util::ComparisonResult::Ascending) {
+        callback(&*lhs, nullptr);
+        ++lhs;
+      } else if (cmp == util::ComparisonResult::Descending) {
+        callback(nullptr, &*rhs);
+        ++rhs;
+      } else {
+        callback(&*lhs, &*rhs);
+        ++lhs;
+        ++rhs;
+      }
+    }
+    for (; lhs != before.end(); ++lhs) {
+      callback(&*lhs, nullptr);
+    }
+    for (; rhs != after.end(); ++rhs) {
+      callback(nullptr, &*rhs);
+    }
+  }
+
  private:
   explicit SortedMap(array_type&& array)
       : tag_{Tag::Array}, array_{std::move(array)} {
@@ -387,6 +483,87 @@ class SortedMap : public SortedMapBase {
   };
 };
 
+/**
+ * Accumulates entries in a mutable buffer and builds a SortedMap from them in
+ * one step, which avoids creating (and path-copying) an intermediate map for
+ * every entry.
+ *
+ * Entries may be inserted in any order, but building is cheapest if they are
+ * inserted in ascending key order. If the same key is inserted more than once,
+ * the last value wins, as it would with repeated calls to `SortedMap::insert`.
+ */
+template <typename K, typename V, typename C, SortedMapBase::size_type N>
+constexpr SortedMapBase::size_type SortedMap<K, V, C, N>::kFixedSize;
+
+template <typename K, typename V, typename C, SortedMapBase::size_type N>
+class SortedMap<K, V, C, N>::Builder {
+ public:
+  explicit Builder(const C& comparator = {}) : comparator_{comparator} {
+  }
+
+  void reserve(size_t size) {
+    entries_.reserve(size);
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  void insert(K key, V value) {
+    if (sorted_ && !entries_.empty() &&
+        !util::Ascending(comparator_.Compare(entries_.back().first, key))) {
+      sorted_ = false;
+    }
+    entries_.emplace_back(std::move(key), std::move(value));
+  }
+
+  /**
+   * Builds a SortedMap from the entries inserted so far and resets this
+   * builder to its empty state.
+   */
+  SortedMap Build() {
+    if (!sorted_) {
+      SortAndDeduplicate();
+    }
+
+    SortedMap result = SortedMap::FromSortedRange(
+        std::make_move_iterator(entries_.begin()),
+        std::make_move_iterator(entries_.end()), comparator_);
+    entries_.clear();
+    sorted_ = true;
+    return result;
+  }
+
+ private:
+  void SortAndDeduplicate() {
+    const C& comparator = comparator_;
+    std::stable_sort(
+        entries_.begin(), entries_.end(),
+        [&comparator](const value_type& lhs, const value_type& rhs) {
+          return util::Ascending(comparator.Compare(lhs.first, rhs.first));
+        });
+
+    // Keep the last of each run of equal keys, since it was inserted last.
+    auto out = entries_.begin();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      auto next = std::next(it);
+      if (next != entries_.end() &&
+          util::Same(comparator.Compare(it->first, next->first))) {
+        continue;
+      }
+      if (out != it) {
+        *out = std::move(*it);
+      }
+      ++out;
+    }
+    entries_.erase(out, entries_.end());
+  }
+
+  std::vector<value_type> entries_;
+  C comparator_;
+  bool sorted_ = true;
+};
+
 }  // namespace immutable
 }  // namespace firestore
 }  // namespace firebase
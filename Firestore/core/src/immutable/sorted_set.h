@@ -107,6 +107,14 @@ class SortedSet : public SortedContainer {
     return map_.find_index(key);
   }
 
+  /**
+   * Returns the element at the given position in the order of the set, which
+   * must be less than `size()`.
+   */
+  const K& at_index(size_type index) const {
+    return map_.at_index(index).first;
+  }
+
   const_iterator min() const {
     return const_iterator{map_.min()};
   }
@@ -20,14 +20,17 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/immutable/keys_view.h"
 #include "Firestore/core/src/immutable/llrb_node.h"
 #include "Firestore/core/src/immutable/sorted_container.h"
 #include "Firestore/core/src/util/comparison.h"
 #include "Firestore/core/src/util/compressed_member.h"
+#include "Firestore/core/src/util/hard_assert.h"
 
 namespace firebase {
 namespace firestore {
@@ -74,6 +77,32 @@ class TreeSortedMap : public SortedMapBase, private util::CompressedMember<C> {
     return TreeSortedMap{std::move(node), comparator};
   }
 
+  /**
+   * Creates a TreeSortedMap from a range of pairs whose keys are in strictly
+   * ascending order, in linear time.
+   */
+  template <typename Iterator>
+  static TreeSortedMap FromSortedRange(Iterator begin,
+                                       Iterator end,
+                                       const C& comparator) {
+    auto size = static_cast<size_type>(std::distance(begin, end));
+    return TreeSortedMap{node_type::FromSortedRange(begin, size), comparator};
+  }
+
+  /**
+   * Calls `callback(before_entry, after_entry)`, in key order, for each key
+   * not in a subtree shared by both maps. Either pointer is null if the key
+   * is only in the other map. If both are set, the values may still be equal.
+   *
+   * Subtrees shared by both maps are skipped as a whole, so comparing a map
+   * with one derived from it by a few insertions and removals takes time
+   * proportional to the number of changes times the depth of the trees.
+   */
+  template <typename Callback>
+  static void Diff(const TreeSortedMap& before,
+                   const TreeSortedMap& after,
+                   const Callback& callback);
+
   /** Returns true if the map contains no elements. */
   bool empty() const {
     return root_.empty();
@@ -178,6 +207,29 @@ class TreeSortedMap : public SortedMapBase, private util::CompressedMember<C> {
     return npos;
   }
 
+  /**
+   * Returns the entry at the given position in the order of the map, using
+   * the subtree sizes kept in the nodes to find it in logarithmic time.
+   *
+   * @param index The index of the entry, which must be less than `size()`.
+   */
+  const value_type& at_index(size_type index) const {
+    HARD_ASSERT(index < size(), "Index %s out of range", index);
+
+    const node_type* node = &root_;
+    while (true) {
+      size_type left_size = node->left().size();
+      if (index < left_size) {
+        node = &node->left();
+      } else if (index == left_size) {
+        return node->entry();
+      } else {
+        index -= left_size + 1;
+        node = &node->right();
+      }
+    }
+  }
+
   /**
    * Finds the first entry in the map containing a key greater than or equal
    * to the given key.
@@ -261,6 +313,136 @@ class TreeSortedMap : public SortedMapBase, private util::CompressedMember<C> {
   node_type root_;
 };
 
+namespace internal {
+
+/**
+ * The part of a tree not yet visited by `TreeSortedMap::Diff`, in key order:
+ * each pending item is either a whole subtree or just the entry of a node.
+ */
+template <typename K, typename V>
+class DiffCursor {
+ public:
+  using node_type = LlrbNode<K, V>;
+
+  explicit DiffCursor(const node_type& root) {
+    Push(root);
+  }
+
+  bool done() const {
+    return pending_.empty();
+  }
+
+  const node_type& node() const {
+    return *pending_.back().first;
+  }
+
+  /** Whether the next item is just the entry of `node()`. */
+  bool at_entry() const {
+    return pending_.back().second;
+  }
+
+  void Pop() {
+    pending_.pop_back();
+  }
+
+  /** Replaces the subtree at `node()` by its left subtree, entry and right. */
+  void Expand() {
+    const node_type* node = pending_.back().first;
+    pending_.pop_back();
+    Push(node->right());
+    pending_.emplace_back(node, true);
+    Push(node->left());
+  }
+
+  /** Expands subtrees until the next item is an entry. */
+  void Descend() {
+    while (!at_entry()) {
+      Expand();
+    }
+  }
+
+ private:
+  void Push(const node_type& node) {
+    if (!node.empty()) {
+      pending_.emplace_back(&node, false);
+    }
+  }
+
+  std::vector<std::pair<const node_type*, bool>> pending_;
+};
+
+}  // namespace internal
+
+template <typename K, typename V, typename C>
+template <typename Callback>
+void TreeSortedMap<K, V, C>::Diff(const TreeSortedMap& before,
+                                  const TreeSortedMap& after,
+                                  const Callback& callback) {
+  const C& comparator = before.comparator();
+  internal::DiffCursor<K, V> lhs{before.root_};
+  internal::DiffCursor<K, V> rhs{after.root_};
+
+  while (!lhs.done() && !rhs.done()) {
+    if (!lhs.at_entry() && !rhs.at_entry()) {
+      if (lhs.node().shares_node_with(rhs.node())) {
+        lhs.Pop();
+        rhs.Pop();
+      } else if (lhs.node().size() >= rhs.node().size()) {
+        lhs.Expand();
+      } else {
+        rhs.Expand();
+      }
+      continue;
+    }
+
+    // At least one side is at an entry. A subtree on the other side only
+    // needs to be expanded if the entry doesn't precede all of its keys.
+    if (!lhs.at_entry()) {
+      if (util::Ascending(
+              comparator.Compare(rhs.node().key(), lhs.node().min().key()))) {
+        callback(nullptr, &rhs.node().entry());
+        rhs.Pop();
+      } else {
+        lhs.Expand();
+      }
+      continue;
+    }
+    if (!rhs.at_entry()) {
+      if (util::Ascending(
+              comparator.Compare(lhs.node().key(), rhs.node().min().key()))) {
+        callback(&lhs.node().entry(), nullptr);
+        lhs.Pop();
+      } else {
+        rhs.Expand();
+      }
+      continue;
+    }
+
+    util::ComparisonResult cmp =
+        comparator.Compare(lhs.node().key(), rhs.node().key());
+    if (cmp == util::ComparisonResult::Ascending) {
+      callback(&lhs.node().entry(), nullptr);
+      lhs.Pop();
+    } else if (cmp == util::ComparisonResult::Descending) {
+      callback(nullptr, &rhs.node().entry());
+      rhs.Pop();
+    } else {
+      callback(&lhs.node().entry(), &rhs.node().entry());
+      lhs.Pop();
+      rhs.Pop();
+    }
+  }
+
+  for (; !lhs.done(); lhs.Pop()) {
+    lhs.Descend();
+    callback(&lhs.node().entry(), nullptr);
+  }
+  for (; !rhs.done(); rhs.Pop()) {
+    rhs.Descend();
+    callback(nullptr, &rhs.node().entry());
+  }
+}
+
 }  // namespace impl
 }  // namespace immutable
 }  // namespace firestore
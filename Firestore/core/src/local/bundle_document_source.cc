@@ -0,0 +1,244 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/bundle_document_source.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "Firestore/core/src/bundle/bundle_document.h"
+#include "Firestore/core/src/bundle/bundle_element.h"
+#include "Firestore/core/src/bundle/bundle_reader.h"
+#include "Firestore/core/src/bundle/bundled_document_metadata.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/no_document.h"
+#include "Firestore/core/src/util/byte_stream_cpp.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/string_format.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using bundle::BundleDocument;
+using bundle::BundleElement;
+using bundle::BundleFormat;
+using bundle::BundleReader;
+using bundle::BundleSerializer;
+using bundle::BundledDocumentMetadata;
+using model::Document;
+using model::DocumentKey;
+using model::MaybeDocument;
+using model::NoDocument;
+using model::ResourcePath;
+using util::ByteStreamCpp;
+using util::Path;
+using util::Status;
+using util::StatusOr;
+using util::StringFormat;
+
+StatusOr<std::unique_ptr<BundleDocumentSource>> BundleDocumentSource::Open(
+    const Path& path, BundleSerializer serializer) {
+  auto input =
+      absl::make_unique<std::ifstream>(path.native_value(), std::ios::binary);
+  if (!*input) {
+    return Status{Error::kErrorNotFound,
+                  StringFormat("Bundle at path '%s' cannot be opened",
+                               path.ToUtf8String())};
+  }
+
+  BundleReader reader(serializer,
+                      absl::make_unique<ByteStreamCpp>(std::move(input)));
+  reader.GetBundleMetadata();
+
+  std::vector<Entry> entries;
+  while (reader.reader_status().ok()) {
+    int64_t offset = reader.position();
+    std::unique_ptr<BundleElement> element = reader.GetNextElement();
+    if (!element) break;
+
+    if (element->element_type() == BundleElement::Type::DocumentMetadata) {
+      const auto& metadata =
+          static_cast<const BundledDocumentMetadata&>(*element);
+      entries.push_back(Entry{metadata.key(), metadata.read_time(), -1});
+
+    } else if (element->element_type() == BundleElement::Type::Document) {
+      // As in BundleLoader, a document must follow its metadata.
+      const auto& document = static_cast<const BundleDocument&>(*element);
+      if (entries.empty() || entries.back().key != document.key()) {
+        return Status{Error::kErrorDataLoss,
+                      StringFormat("The document %s in bundle '%s' has no "
+                                   "metadata",
+                                   document.key().ToString(),
+                                   path.ToUtf8String())};
+      }
+      entries.back().offset = offset;
+    }
+  }
+  if (!reader.reader_status().ok()) {
+    return reader.reader_status();
+  }
+
+  // If a document appears more than once, the last occurrence wins, as it
+  // would when loading the bundle.
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const Entry& lhs, const Entry& rhs) { return lhs.key < rhs.key; });
+  std::vector<Entry> unique_entries;
+  unique_entries.reserve(entries.size());
+  for (Entry& entry : entries) {
+    if (!unique_entries.empty() && unique_entries.back().key == entry.key) {
+      unique_entries.back() = std::move(entry);
+    } else {
+      unique_entries.push_back(std::move(entry));
+    }
+  }
+
+  return absl::WrapUnique(
+      new BundleDocumentSource(path, std::move(serializer), reader.format(),
+                               std::move(unique_entries)));
+}
+
+BundleDocumentSource::BundleDocumentSource(const Path& path,
+                                           BundleSerializer serializer,
+                                           BundleFormat format,
+                                           std::vector<Entry> entries)
+    : serializer_(std::move(serializer)),
+      format_(format),
+      entries_(std::move(entries)),
+      file_(path.native_value(), std::ios::binary) {
+}
+
+absl::optional<MaybeDocument> BundleDocumentSource::Get(
+    const DocumentKey& key) {
+  auto found =
+      std::lower_bound(entries_.begin(), entries_.end(), key,
+                       [](const Entry& entry, const DocumentKey& key) {
+                         return entry.key < key;
+                       });
+  if (found == entries_.end() || found->key != key) {
+    return absl::nullopt;
+  }
+
+  if (found->offset < 0) {
+    return NoDocument(key, found->read_time,
+                      /* has_committed_mutations= */ false);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  absl::optional<Document> document = ReadDocumentLocked(found->offset);
+  HARD_ASSERT(document,
+              "Failed to read document %s from bundle; was the bundle file "
+              "modified?",
+              key.ToString());
+  return *document;
+}
+
+void BundleDocumentSource::EnumerateKeys(const ResourcePath& collection_path,
+                                         const KeyVisitor& visitor) const {
+  size_t immediate_children_path_length = collection_path.size() + 1;
+
+  auto it =
+      std::lower_bound(entries_.begin(), entries_.end(), collection_path,
+                       [](const Entry& entry, const ResourcePath& path) {
+                         return entry.key.path() < path;
+                       });
+  for (; it != entries_.end() && collection_path.IsPrefixOf(it->key.path());
+       ++it) {
+    // Documents in subcollections sort between the collection's documents.
+    if (it->key.path().size() != immediate_children_path_length) continue;
+
+    if (!visitor(it->key, it->read_time)) return;
+  }
+}
+
+std::vector<ResourcePath> BundleDocumentSource::GetCollectionPaths() const {
+  std::set<ResourcePath> paths;
+  for (const Entry& entry : entries_) {
+    paths.insert(entry.key.path().PopLast());
+  }
+  return std::vector<ResourcePath>(paths.begin(), paths.end());
+}
+
+absl::optional<Document> BundleDocumentSource::ReadDocumentLocked(
+    int64_t offset) {
+  file_.clear();
+  file_.seekg(offset);
+
+  if (format_ == BundleFormat::kBinary) {
+    return ReadBinaryDocumentLocked();
+  }
+
+  // Elements are a decimal length prefix followed by a JSON object of that
+  // length, see BundleReader.
+  std::string length_prefix;
+  std::getline(file_, length_prefix, '{');
+  size_t length = 0;
+  if (!file_ || !absl::SimpleAtoi(length_prefix, &length) || length == 0) {
+    return absl::nullopt;
+  }
+
+  std::string element(length, '{');
+  file_.read(&element[1], static_cast<std::streamsize>(length - 1));
+  if (!file_) {
+    return absl::nullopt;
+  }
+
+  bundle::JsonReader reader;
+  absl::optional<BundleDocument> document =
+      serializer_.DecodeDocumentElement(reader, element);
+  if (!document || !reader.ok()) {
+    return absl::nullopt;
+  }
+  return document->document();
+}
+
+absl::optional<Document> BundleDocumentSource::ReadBinaryDocumentLocked() {
+  // Elements are a varint length prefix followed by a serialized
+  // `firestore.BundleElement` of that length, see BundleReader.
+  uint64_t length = 0;
+  for (int shift = 0;; shift += 7) {
+    int byte = file_.get();
+    if (!file_ || shift >= 64) {
+      return absl::nullopt;
+    }
+    length |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) break;
+  }
+
+  std::string element(length, '\0');
+  file_.read(&element[0], static_cast<std::streamsize>(length));
+  if (!file_) {
+    return absl::nullopt;
+  }
+
+  bundle::JsonReader reader;
+  std::unique_ptr<BundleElement> decoded =
+      serializer_.DecodeBinaryElement(reader, element);
+  if (!decoded || decoded->element_type() != BundleElement::Type::Document) {
+    return absl::nullopt;
+  }
+  return static_cast<const BundleDocument&>(*decoded).document();
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_BUNDLE_DOCUMENT_SOURCE_H_
+#define FIRESTORE_CORE_SRC_LOCAL_BUNDLE_DOCUMENT_SOURCE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "Firestore/core/src/bundle/bundle_reader.h"
+#include "Firestore/core/src/bundle/bundle_serializer.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/maybe_document.h"
+#include "Firestore/core/src/model/resource_path.h"
+#include "Firestore/core/src/model/snapshot_version.h"
+#include "Firestore/core/src/util/path.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/**
+ * A read-only source of documents backed by a bundle file, used to query large
+ * static datasets without importing them into the cache.
+ *
+ * Opening the source reads the bundle once to build a sorted in-memory index
+ * of its documents, holding only their keys, read times and offsets in the
+ * file. Documents are read from the file and decoded when they're requested.
+ * Named queries in the bundle are ignored.
+ *
+ * This class is thread-safe.
+ */
+class BundleDocumentSource {
+ public:
+  /**
+   * Receives the key and read time of an indexed document. Returns false to
+   * stop the enumeration.
+   */
+  using KeyVisitor = std::function<bool(const model::DocumentKey&,
+                                        const model::SnapshotVersion&)>;
+
+  /**
+   * Opens the bundle file at the given path and indexes its documents.
+   * Returns an error if the file can't be read or isn't a valid bundle.
+   */
+  static util::StatusOr<std::unique_ptr<BundleDocumentSource>> Open(
+      const util::Path& path, bundle::BundleSerializer serializer);
+
+  /**
+   * Returns the document with the given key, a NoDocument if the bundle
+   * records it as missing, or nullopt if the bundle doesn't contain it.
+   */
+  absl::optional<model::MaybeDocument> Get(const model::DocumentKey& key);
+
+  /**
+   * Visits the keys of the documents that are immediate children of the given
+   * collection, in key order.
+   */
+  void EnumerateKeys(const model::ResourcePath& collection_path,
+                     const KeyVisitor& visitor) const;
+
+  /** Returns the paths of the collections that contain indexed documents. */
+  std::vector<model::ResourcePath> GetCollectionPaths() const;
+
+  /** The number of indexed documents. */
+  size_t size() const {
+    return entries_.size();
+  }
+
+ private:
+  struct Entry {
+    model::DocumentKey key;
+    model::SnapshotVersion read_time;
+
+    /** The offset of the document element, or -1 for missing documents. */
+    int64_t offset;
+  };
+
+  BundleDocumentSource(const util::Path& path,
+                       bundle::BundleSerializer serializer,
+                       bundle::BundleFormat format,
+                       std::vector<Entry> entries);
+
+  /** Reads the document element at `offset`. Requires `mutex_` to be held. */
+  absl::optional<model::Document> ReadDocumentLocked(int64_t offset);
+
+  /**
+   * Reads the binary document element at the current position of `file_`.
+   * Requires `mutex_` to be held.
+   */
+  absl::optional<model::Document> ReadBinaryDocumentLocked();
+
+  bundle::BundleSerializer serializer_;
+  bundle::BundleFormat format_;
+
+  /** The indexed documents, sorted by key. */
+  std::vector<Entry> entries_;
+
+  std::mutex mutex_;
+  std::ifstream file_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_BUNDLE_DOCUMENT_SOURCE_H_
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/decoded_document_cache.h"
+
+#include <iterator>
+#include <string>
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::DocumentKey;
+using model::MaybeDocument;
+
+namespace {
+
+/**
+ * Estimates the memory used by an entry. Decoded documents are assumed to be
+ * about as large as their encoding, which is kept alongside them.
+ */
+size_t EstimateByteSize(absl::string_view encoded) {
+  return 2 * encoded.size() + sizeof(MaybeDocument);
+}
+
+}  // namespace
+
+constexpr size_t DecodedDocumentCache::kDefaultMaxBytes;
+
+absl::optional<MaybeDocument> DecodedDocumentCache::Get(
+    const DocumentKey& key, absl::string_view encoded) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto found = index_.find(key);
+  if (found == index_.end() || found->second->encoded != encoded) {
+    ++misses_;
+    return absl::nullopt;
+  }
+
+  ++hits_;
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return found->second->document;
+}
+
+void DecodedDocumentCache::Put(const MaybeDocument& document,
+                               absl::string_view encoded) {
+  size_t byte_size = EstimateByteSize(encoded);
+  if (byte_size > max_bytes_) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto found = index_.find(document.key());
+  if (found != index_.end()) {
+    EraseLocked(found->second);
+  }
+
+  entries_.push_front(Entry{document, std::string(encoded), byte_size});
+  index_.emplace(document.key(), entries_.begin());
+  byte_size_ += byte_size;
+
+  while (byte_size_ > max_bytes_) {
+    EraseLocked(std::prev(entries_.end()));
+  }
+}
+
+void DecodedDocumentCache::Remove(const DocumentKey& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    EraseLocked(found->second);
+  }
+}
+
+size_t DecodedDocumentCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t released = byte_size_;
+  entries_.clear();
+  index_.clear();
+  byte_size_ = 0;
+  return released;
+}
+
+size_t DecodedDocumentCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+size_t DecodedDocumentCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+size_t DecodedDocumentCache::byte_size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return byte_size_;
+}
+
+void DecodedDocumentCache::EraseLocked(EntryList::iterator it) {
+  byte_size_ -= it->byte_size;
+  index_.erase(it->document.key());
+  entries_.erase(it);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
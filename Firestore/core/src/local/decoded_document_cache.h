@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_DECODED_DOCUMENT_CACHE_H_
+#define FIRESTORE_CORE_SRC_LOCAL_DECODED_DOCUMENT_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <unordered_map>
+
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/maybe_document.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/**
+ * A byte-budgeted LRU cache of decoded remote documents, used to avoid
+ * re-parsing the same hot documents every time they are read from LevelDB.
+ *
+ * Entries remember the encoded bytes they were decoded from, and a lookup only
+ * hits if the bytes read from LevelDB are identical. Entries therefore can
+ * never be stale: documents rewritten by a transaction that was later rolled
+ * back, or by another instance of the cache, simply miss. Callers should still
+ * `Remove()` entries they overwrite so that the memory is released early.
+ *
+ * This class is thread-safe.
+ */
+class DecodedDocumentCache {
+ public:
+  /** The default byte budget of the cache. */
+  static constexpr size_t kDefaultMaxBytes = 4 * 1024 * 1024;
+
+  explicit DecodedDocumentCache(size_t max_bytes = kDefaultMaxBytes)
+      : max_bytes_(max_bytes) {
+  }
+
+  /**
+   * Returns the cached decoding of `encoded` for the given key, or nullopt if
+   * the document isn't cached or was cached from different bytes.
+   */
+  absl::optional<model::MaybeDocument> Get(const model::DocumentKey& key,
+                                           absl::string_view encoded);
+
+  /**
+   * Caches `document` as the decoding of `encoded`, evicting the least
+   * recently used entries if the cache grows past its byte budget.
+   */
+  void Put(const model::MaybeDocument& document, absl::string_view encoded);
+
+  /** Removes the entry for the given key, if any. */
+  void Remove(const model::DocumentKey& key);
+
+  /**
+   * Removes all entries and returns the estimated memory they used, in bytes.
+   * Does not reset the hit and miss counters.
+   */
+  size_t Clear();
+
+  /** The number of lookups that returned a cached document. */
+  size_t hits() const;
+
+  /** The number of lookups that did not return a cached document. */
+  size_t misses() const;
+
+  /** The estimated memory used by the cached entries, in bytes. */
+  size_t byte_size() const;
+
+ private:
+  struct Entry {
+    model::MaybeDocument document;
+    std::string encoded;
+    size_t byte_size = 0;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  /** Removes the entry at `it`. Requires `mutex_` to be held. */
+  void EraseLocked(EntryList::iterator it);
+
+  const size_t max_bytes_;
+
+  mutable std::mutex mutex_;
+
+  /** Entries in order of recency of use, most recently used first. */
+  EntryList entries_;
+  std::unordered_map<model::DocumentKey,
+                     EntryList::iterator,
+                     model::DocumentKeyHash>
+      index_;
+
+  size_t byte_size_ = 0;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_DECODED_DOCUMENT_CACHE_H_
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/document_access_log.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::DocumentKey;
+
+constexpr size_t DocumentAccessLog::kMaxRecordedDocuments;
+
+void DocumentAccessLog::Record(const DocumentKey& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (keys_.size() < kMaxRecordedDocuments) {
+    keys_.insert(key);
+  }
+}
+
+std::set<DocumentKey> DocumentAccessLog::Take() {
+  std::set<DocumentKey> keys;
+  std::lock_guard<std::mutex> lock(mutex_);
+  keys.swap(keys_);
+  return keys;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
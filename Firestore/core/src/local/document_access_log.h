@@ -0,0 +1,60 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_DOCUMENT_ACCESS_LOG_H_
+#define FIRESTORE_CORE_SRC_LOCAL_DOCUMENT_ACCESS_LOG_H_
+
+#include <cstddef>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
+
+#include "Firestore/core/src/model/document_key.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/**
+ * Collects the documents read from the cache since the LRU delegate last
+ * updated their sequence numbers, so that reads don't need to write to
+ * persistence.
+ *
+ * This class is thread-safe.
+ */
+class DocumentAccessLog {
+ public:
+  /**
+   * The number of documents recorded before further reads are dropped until
+   * the next `Take()`.
+   */
+  static constexpr size_t kMaxRecordedDocuments = 10000;
+
+  /** Records that the document with the given key was read. */
+  void Record(const model::DocumentKey& key);
+
+  /** Returns the documents recorded so far, in key order, and forgets them. */
+  std::set<model::DocumentKey> Take();
+
+ private:
+  std::mutex mutex_;
+  std::set<model::DocumentKey> keys_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_DOCUMENT_ACCESS_LOG_H_
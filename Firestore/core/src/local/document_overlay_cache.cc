@@ -0,0 +1,67 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/document_overlay_cache.h"
+
+#include <utility>
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::BatchId;
+using model::MaybeDocument;
+using model::SnapshotVersion;
+
+DocumentOverlay::DocumentOverlay(
+    const absl::optional<MaybeDocument>& base_document,
+    std::vector<BatchId> batch_ids,
+    absl::optional<MaybeDocument> local_view)
+    : batch_ids_(std::move(batch_ids)), local_view_(std::move(local_view)) {
+  if (base_document) {
+    base_type_ = base_document->type();
+    base_version_ = base_document->version();
+    base_has_pending_writes_ = base_document->has_pending_writes();
+  }
+}
+
+DocumentOverlay::DocumentOverlay(MaybeDocument::Type base_type,
+                                 SnapshotVersion base_version,
+                                 bool base_has_pending_writes,
+                                 std::vector<BatchId> batch_ids,
+                                 absl::optional<MaybeDocument> local_view)
+    : base_type_(base_type),
+      base_version_(base_version),
+      base_has_pending_writes_(base_has_pending_writes),
+      batch_ids_(std::move(batch_ids)),
+      local_view_(std::move(local_view)) {
+}
+
+bool DocumentOverlay::IsValidFor(
+    const absl::optional<MaybeDocument>& base_document,
+    const std::vector<BatchId>& batch_ids) const {
+  if (batch_ids != batch_ids_) return false;
+
+  if (!base_document) return base_type_ == MaybeDocument::Type::Invalid;
+
+  return base_document->type() == base_type_ &&
+         base_document->version() == base_version_ &&
+         base_document->has_pending_writes() == base_has_pending_writes_;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_DOCUMENT_OVERLAY_CACHE_H_
+#define FIRESTORE_CORE_SRC_LOCAL_DOCUMENT_OVERLAY_CACHE_H_
+
+#include <vector>
+
+#include "Firestore/core/src/model/maybe_document.h"
+#include "Firestore/core/src/model/snapshot_version.h"
+#include "Firestore/core/src/model/types.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+
+namespace model {
+class DocumentKey;
+}  // namespace model
+
+namespace local {
+
+/**
+ * The local view of a document with pending mutations, together with what it
+ * was computed from: the remote document and the IDs of the batches applied
+ * to it, in order.
+ *
+ * Only the type, version and pending writes of the remote document are
+ * recorded. Remote documents with the same version have the same contents.
+ */
+class DocumentOverlay {
+ public:
+  DocumentOverlay(const absl::optional<model::MaybeDocument>& base_document,
+                  std::vector<model::BatchId> batch_ids,
+                  absl::optional<model::MaybeDocument> local_view);
+
+  DocumentOverlay(model::MaybeDocument::Type base_type,
+                  model::SnapshotVersion base_version,
+                  bool base_has_pending_writes,
+                  std::vector<model::BatchId> batch_ids,
+                  absl::optional<model::MaybeDocument> local_view);
+
+  /**
+   * Returns true if the overlay was computed by applying the batches with
+   * the given IDs to `base_document`.
+   */
+  bool IsValidFor(const absl::optional<model::MaybeDocument>& base_document,
+                  const std::vector<model::BatchId>& batch_ids) const;
+
+  /** The type of the remote document, or `Invalid` if there was none. */
+  model::MaybeDocument::Type base_type() const {
+    return base_type_;
+  }
+
+  const model::SnapshotVersion& base_version() const {
+    return base_version_;
+  }
+
+  bool base_has_pending_writes() const {
+    return base_has_pending_writes_;
+  }
+
+  const std::vector<model::BatchId>& batch_ids() const {
+    return batch_ids_;
+  }
+
+  const absl::optional<model::MaybeDocument>& local_view() const {
+    return local_view_;
+  }
+
+ private:
+  model::MaybeDocument::Type base_type_ = model::MaybeDocument::Type::Invalid;
+  model::SnapshotVersion base_version_;
+  bool base_has_pending_writes_ = false;
+  std::vector<model::BatchId> batch_ids_;
+  absl::optional<model::MaybeDocument> local_view_;
+};
+
+/**
+ * Caches the local view of documents that are mutated by several of the
+ * current user's pending batches, so that they don't need to be recomputed
+ * every time they are read.
+ *
+ * The mutation queue removes a document's overlay whenever a batch mutating
+ * the document is added or removed. Changes to the remote document are
+ * detected by `DocumentOverlay::IsValidFor()`.
+ */
+class DocumentOverlayCache {
+ public:
+  virtual ~DocumentOverlayCache() = default;
+
+  /** Returns the cached overlay of the given document, if any. */
+  virtual absl::optional<DocumentOverlay> Get(
+      const model::DocumentKey& key) = 0;
+
+  /**
+   * Caches the overlay of the given document, replacing any previous one.
+   * Implementations may drop overlays saved in read-only transactions.
+   */
+  virtual void Save(const model::DocumentKey& key,
+                    const DocumentOverlay& overlay) = 0;
+
+  /** Removes the cached overlay of the given document, if any. */
+  virtual void Remove(const model::DocumentKey& key) = 0;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_DOCUMENT_OVERLAY_CACHE_H_
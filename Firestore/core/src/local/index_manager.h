@@ -20,10 +20,17 @@
 #include <string>
 #include <vector>
 
+#include "Firestore/core/src/model/model_fwd.h"
+
 namespace firebase {
 namespace firestore {
 
+namespace core {
+class Query;
+}  // namespace core
+
 namespace model {
+class FieldIndex;
 class ResourcePath;
 }  // namespace model
 
@@ -32,8 +39,11 @@ namespace local {
 /**
  * Represents a set of indexes that are used to execute queries efficiently.
  *
- * Currently the only index is a [collection id] => [parent path] index, used
- * to execute Collection Group queries.
+ * There is always a [collection id] => [parent path] index, used to execute
+ * Collection Group queries. Additionally, field indexes can be configured to
+ * order the documents of a collection group by the values of some of their
+ * fields, which allows filtered queries to be executed as index range scans
+ * rather than by matching every document in a collection.
  */
 class IndexManager {
  public:
@@ -58,6 +68,46 @@ class IndexManager {
    */
   virtual std::vector<model::ResourcePath> GetCollectionParents(
       const std::string& collection_id) = 0;
+
+  /**
+   * Adds a field index and indexes all documents already in the remote
+   * document cache that belong to the index's collection group. Adding an
+   * index that is already configured is a no-op.
+   */
+  virtual void AddFieldIndex(const model::FieldIndex& index) = 0;
+
+  /** Removes the given field index and all of its entries. */
+  virtual void DeleteFieldIndex(const model::FieldIndex& index) = 0;
+
+  /**
+   * Returns the field indexes configured for the given collection group, with
+   * their assigned index IDs.
+   */
+  virtual std::vector<model::FieldIndex> GetFieldIndexes(
+      const std::string& collection_group) = 0;
+
+  /**
+   * Updates the entries of all field indexes that apply to the given document.
+   * Documents that don't exist or that lack any of the indexed fields are
+   * removed from the corresponding index.
+   */
+  virtual void UpdateIndexEntries(const model::MaybeDocument& document) = 0;
+
+  /** Removes the given document from all field indexes. */
+  virtual void RemoveIndexEntries(const model::DocumentKey& key) = 0;
+
+  /**
+   * Returns the keys of the cached remote documents that may match the given
+   * collection or collection group query, using a field index to narrow down
+   * the candidates.
+   *
+   * The result is a superset of the matching remote documents; callers must
+   * still apply the query to the documents. Returns nullopt if no configured
+   * index can serve the query, in which case the caller must fall back to
+   * scanning the collection.
+   */
+  virtual absl::optional<model::DocumentKeySet> GetDocumentsMatchingQuery(
+      const core::Query& query) = 0;
 };
 
 }  // namespace local
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/index_value_writer.h"
+
+#include <cmath>
+#include <string>
+
+#include "Firestore/core/include/firebase/firestore/geo_point.h"
+#include "Firestore/core/src/model/resource_path.h"
+#include "Firestore/core/src/nanopb/byte_string.h"
+#include "Firestore/core/src/nanopb/nanopb_util.h"
+#include "Firestore/core/src/util/comparison.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/ordered_code.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using model::FieldValue;
+using nanopb::MakeStringView;
+using util::OrderedCode;
+
+/**
+ * Labels written before each encoded value. Values of types that are
+ * comparable to each other (e.g. integers and doubles) share a range of
+ * labels, and the ranges are ordered the same way FieldValue orders types.
+ */
+enum class IndexLabel {
+  /** Terminates an array, a map or a reference path. */
+  End = 0,
+
+  /** Precedes each map entry and each path segment of a reference. */
+  Entry = 1,
+
+  Null = 5,
+  Boolean = 10,
+  NaN = 13,
+  Number = 15,
+  Timestamp = 20,
+  ServerTimestamp = 21,
+  String = 25,
+  Blob = 30,
+  Reference = 35,
+  GeoPoint = 40,
+  Array = 45,
+  Object = 50,
+
+  /** Sorts after any encoded value. */
+  MaxValue = 55,
+};
+
+void WriteLabel(IndexLabel label, std::string* dest) {
+  OrderedCode::WriteSignedNumIncreasing(dest, static_cast<int64_t>(label));
+}
+
+/**
+ * Writes a finite double such that the unsigned comparison of the written
+ * bits matches the numeric comparison of the doubles.
+ */
+void WriteSortableDouble(double value, std::string* dest) {
+  // -0.0 and 0.0 compare the same, so they must share an encoding.
+  if (value == 0.0) value = 0.0;
+
+  uint64_t bits = util::DoubleBits(value);
+  constexpr uint64_t kSignBit = uint64_t{1} << 63;
+  if (bits & kSignBit) {
+    bits = ~bits;
+  } else {
+    bits |= kSignBit;
+  }
+  OrderedCode::WriteNumIncreasing(dest, bits);
+}
+
+void WriteNumber(double value, std::string* dest) {
+  if (std::isnan(value)) {
+    WriteLabel(IndexLabel::NaN, dest);
+  } else {
+    WriteLabel(IndexLabel::Number, dest);
+    WriteSortableDouble(value, dest);
+  }
+}
+
+void WriteTimestamp(const firebase::Timestamp& timestamp, std::string* dest) {
+  OrderedCode::WriteSignedNumIncreasing(dest, timestamp.seconds());
+  OrderedCode::WriteSignedNumIncreasing(dest, timestamp.nanoseconds());
+}
+
+IndexLabel LowerBoundLabel(FieldValue::Type type) {
+  switch (type) {
+    case FieldValue::Type::Null:
+      return IndexLabel::Null;
+    case FieldValue::Type::Boolean:
+      return IndexLabel::Boolean;
+    case FieldValue::Type::Integer:
+    case FieldValue::Type::Double:
+      return IndexLabel::NaN;
+    case FieldValue::Type::Timestamp:
+    case FieldValue::Type::ServerTimestamp:
+      return IndexLabel::Timestamp;
+    case FieldValue::Type::String:
+      return IndexLabel::String;
+    case FieldValue::Type::Blob:
+      return IndexLabel::Blob;
+    case FieldValue::Type::Reference:
+      return IndexLabel::Reference;
+    case FieldValue::Type::GeoPoint:
+      return IndexLabel::GeoPoint;
+    case FieldValue::Type::Array:
+      return IndexLabel::Array;
+    case FieldValue::Type::Object:
+      return IndexLabel::Object;
+  }
+  UNREACHABLE();
+}
+
+IndexLabel UpperBoundLabel(FieldValue::Type type) {
+  switch (type) {
+    case FieldValue::Type::Null:
+      return IndexLabel::Boolean;
+    case FieldValue::Type::Boolean:
+      return IndexLabel::NaN;
+    case FieldValue::Type::Integer:
+    case FieldValue::Type::Double:
+      return IndexLabel::Timestamp;
+    case FieldValue::Type::Timestamp:
+    case FieldValue::Type::ServerTimestamp:
+      return IndexLabel::String;
+    case FieldValue::Type::String:
+      return IndexLabel::Blob;
+    case FieldValue::Type::Blob:
+      return IndexLabel::Reference;
+    case FieldValue::Type::Reference:
+      return IndexLabel::GeoPoint;
+    case FieldValue::Type::GeoPoint:
+      return IndexLabel::Array;
+    case FieldValue::Type::Array:
+      return IndexLabel::Object;
+    case FieldValue::Type::Object:
+      return IndexLabel::MaxValue;
+  }
+  UNREACHABLE();
+}
+
+}  // namespace
+
+void WriteIndexValue(const FieldValue& value, std::string* dest) {
+  switch (value.type()) {
+    case FieldValue::Type::Null:
+      WriteLabel(IndexLabel::Null, dest);
+      return;
+
+    case FieldValue::Type::Boolean:
+      WriteLabel(IndexLabel::Boolean, dest);
+      OrderedCode::WriteNumIncreasing(dest, value.boolean_value() ? 1 : 0);
+      return;
+
+    case FieldValue::Type::Integer:
+      // Integers and doubles compare with each other, so integers are widened
+      // to share the double encoding. This may lose precision for very large
+      // integers, which is acceptable since index scans are re-filtered.
+      WriteNumber(static_cast<double>(value.integer_value()), dest);
+      return;
+
+    case FieldValue::Type::Double:
+      WriteNumber(value.double_value(), dest);
+      return;
+
+    case FieldValue::Type::Timestamp:
+      WriteLabel(IndexLabel::Timestamp, dest);
+      WriteTimestamp(value.timestamp_value(), dest);
+      return;
+
+    case FieldValue::Type::ServerTimestamp:
+      WriteLabel(IndexLabel::ServerTimestamp, dest);
+      WriteTimestamp(value.server_timestamp_value().local_write_time(), dest);
+      return;
+
+    case FieldValue::Type::String:
+      WriteLabel(IndexLabel::String, dest);
+      OrderedCode::WriteString(dest, value.string_value());
+      return;
+
+    case FieldValue::Type::Blob:
+      WriteLabel(IndexLabel::Blob, dest);
+      OrderedCode::WriteString(dest, MakeStringView(value.blob_value()));
+      return;
+
+    case FieldValue::Type::Reference: {
+      const FieldValue::Reference& reference = value.reference_value();
+      WriteLabel(IndexLabel::Reference, dest);
+      OrderedCode::WriteString(dest, reference.database_id().project_id());
+      OrderedCode::WriteString(dest, reference.database_id().database_id());
+      WriteIndexDocumentKey(reference.key(), dest);
+      return;
+    }
+
+    case FieldValue::Type::GeoPoint: {
+      const GeoPoint& geo_point = value.geo_point_value();
+      WriteLabel(IndexLabel::GeoPoint, dest);
+      WriteSortableDouble(geo_point.latitude(), dest);
+      WriteSortableDouble(geo_point.longitude(), dest);
+      return;
+    }
+
+    case FieldValue::Type::Array:
+      WriteLabel(IndexLabel::Array, dest);
+      for (const FieldValue& element : value.array_value()) {
+        WriteIndexValue(element, dest);
+      }
+      WriteLabel(IndexLabel::End, dest);
+      return;
+
+    case FieldValue::Type::Object:
+      WriteLabel(IndexLabel::Object, dest);
+      for (const auto& entry : value.object_value()) {
+        WriteLabel(IndexLabel::Entry, dest);
+        OrderedCode::WriteString(dest, entry.first);
+        WriteIndexValue(entry.second, dest);
+      }
+      WriteLabel(IndexLabel::End, dest);
+      return;
+  }
+
+  UNREACHABLE();
+}
+
+void WriteIndexDocumentKey(const model::DocumentKey& key, std::string* dest) {
+  for (const std::string& segment : key.path()) {
+    WriteLabel(IndexLabel::Entry, dest);
+    OrderedCode::WriteString(dest, segment);
+  }
+  WriteLabel(IndexLabel::End, dest);
+}
+
+void WriteIndexValueLowerBound(FieldValue::Type type, std::string* dest) {
+  WriteLabel(LowerBoundLabel(type), dest);
+}
+
+void WriteIndexValueUpperBound(FieldValue::Type type, std::string* dest) {
+  WriteLabel(UpperBoundLabel(type), dest);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
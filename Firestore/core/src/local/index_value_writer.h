@@ -0,0 +1,73 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_INDEX_VALUE_WRITER_H_
+#define FIRESTORE_CORE_SRC_LOCAL_INDEX_VALUE_WRITER_H_
+
+#include <string>
+
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/field_value.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+// Utilities for encoding FieldValues into strings that sort the same way the
+// values do. The encoding is used by field index entries, where it allows
+// LevelDB range scans to stand in for evaluating filters one document at a
+// time.
+//
+// The encoding is order-preserving but not necessarily injective: all numbers
+// are encoded as doubles, so distinct integers that can't be represented
+// exactly as doubles may share an encoding. Consumers must therefore treat a
+// range scan over encoded values as a superset of the matching documents and
+// re-apply the query filters to the results.
+
+/**
+ * Appends the order-preserving encoding of `value` to `dest`.
+ *
+ * For any two values `a` and `b`, if `a.CompareTo(b)` is `Ascending` then the
+ * encoding of `a` sorts no later than the encoding of `b`.
+ */
+void WriteIndexValue(const model::FieldValue& value, std::string* dest);
+
+/**
+ * Appends an encoding of `key` to `dest` that sorts the same way keys do. No
+ * two distinct keys share an encoding, and no encoding is a prefix of another.
+ */
+void WriteIndexDocumentKey(const model::DocumentKey& key, std::string* dest);
+
+/**
+ * Appends a string to `dest` that sorts before the encoding of every value
+ * that is comparable to values of the given type.
+ */
+void WriteIndexValueLowerBound(model::FieldValue::Type type,
+                               std::string* dest);
+
+/**
+ * Appends a string to `dest` that sorts after the encoding of every value that
+ * is comparable to values of the given type (and before the encoding of any
+ * value of a later type).
+ */
+void WriteIndexValueUpperBound(model::FieldValue::Type type,
+                               std::string* dest);
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_INDEX_VALUE_WRITER_H_
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/leveldb_collection_dictionary.h"
+
+#include <string>
+
+#include "Firestore/core/src/local/leveldb_key.h"
+#include "Firestore/core/src/local/leveldb_transaction.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "leveldb/status.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::ResourcePath;
+
+absl::optional<int32_t> LevelDbCollectionDictionary::Find(
+    LevelDbTransaction* transaction, const ResourcePath& collection_path) {
+  {
+    std::lock_guard<std::mutex> lock(numbers_mutex_);
+    auto found = numbers_.find(collection_path);
+    if (found != numbers_.end()) {
+      return found->second;
+    }
+  }
+
+  std::string value;
+  leveldb::Status status = transaction->Get(
+      LevelDbCollectionDictionaryKey::Key(collection_path), &value);
+  if (status.IsNotFound()) {
+    return absl::nullopt;
+  }
+  HARD_ASSERT(status.ok(), "Failed to read collection number of %s: %s",
+              collection_path.CanonicalString(), status.ToString());
+
+  int32_t number = 0;
+  HARD_ASSERT(LevelDbCollectionDictionaryKey::DecodeValue(value, &number),
+              "Failed to decode collection number of %s",
+              collection_path.CanonicalString());
+  std::lock_guard<std::mutex> lock(numbers_mutex_);
+  numbers_.emplace(collection_path, number);
+  return number;
+}
+
+int32_t LevelDbCollectionDictionary::FindOrAssign(
+    LevelDbTransaction* transaction, const ResourcePath& collection_path) {
+  absl::optional<int32_t> existing = Find(transaction, collection_path);
+  if (existing) {
+    return *existing;
+  }
+
+  if (!next_number_) {
+    std::string value;
+    leveldb::Status status =
+        transaction->Get(LevelDbCollectionDictionaryGlobalKey::Key(), &value);
+    int32_t next_number = 0;
+    if (status.ok()) {
+      HARD_ASSERT(
+          LevelDbCollectionDictionaryKey::DecodeValue(value, &next_number),
+          "Failed to decode the next collection number");
+    } else {
+      HARD_ASSERT(status.IsNotFound(),
+                  "Failed to read the next collection number: %s",
+                  status.ToString());
+    }
+    next_number_ = next_number;
+  }
+
+  int32_t number = *next_number_;
+  HARD_ASSERT(number < INT32_MAX, "Ran out of collection numbers");
+  next_number_ = number + 1;
+
+  transaction->Put(LevelDbCollectionDictionaryKey::Key(collection_path),
+                   LevelDbCollectionDictionaryKey::EncodeValue(number));
+  transaction->Put(LevelDbCollectionDictionaryGlobalKey::Key(),
+                   LevelDbCollectionDictionaryKey::EncodeValue(*next_number_));
+  std::lock_guard<std::mutex> lock(numbers_mutex_);
+  numbers_.emplace(collection_path, number);
+  return number;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
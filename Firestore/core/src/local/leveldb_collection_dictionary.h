@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_LEVELDB_COLLECTION_DICTIONARY_H_
+#define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_COLLECTION_DICTIONARY_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>  // NOLINT(build/c++11)
+
+#include "Firestore/core/src/model/resource_path.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+class LevelDbTransaction;
+
+/**
+ * Assigns compact numbers to collection paths, so that the keys of the
+ * collection documents table don't have to repeat the path of each document's
+ * collection. See `LevelDbCollectionDictionaryKey`.
+ *
+ * Numbers are assigned in the order collections are first written and are
+ * never reassigned, so they're remembered once they've been read.
+ * Transactions are always committed, so a number assigned in a transaction
+ * can be remembered before it commits.
+ *
+ * `Find` is also called from read-only transactions, which run concurrently
+ * with the worker queue, so the remembered numbers are guarded by a mutex.
+ */
+class LevelDbCollectionDictionary {
+ public:
+  /**
+   * Returns the number assigned to the given collection, or nullopt if it
+   * hasn't been assigned one.
+   */
+  absl::optional<int32_t> Find(LevelDbTransaction* transaction,
+                               const model::ResourcePath& collection_path);
+
+  /**
+   * Returns the number assigned to the given collection, assigning it the next
+   * unused one in `transaction` if needed.
+   */
+  int32_t FindOrAssign(LevelDbTransaction* transaction,
+                       const model::ResourcePath& collection_path);
+
+ private:
+  std::mutex numbers_mutex_;
+  std::map<model::ResourcePath, int32_t> numbers_;
+
+  // Only used by `FindOrAssign`, which runs on the worker queue.
+  absl::optional<int32_t> next_number_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_LEVELDB_COLLECTION_DICTIONARY_H_
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/leveldb_document_overlay_cache.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Firestore/Protos/nanopb/firestore/local/maybe_document.nanopb.h"
+#include "Firestore/core/include/firebase/firestore/timestamp.h"
+#include "Firestore/core/src/auth/user.h"
+#include "Firestore/core/src/local/leveldb_key.h"
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_transaction.h"
+#include "Firestore/core/src/local/local_serializer.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/nanopb/nanopb_util.h"
+#include "Firestore/core/src/nanopb/reader.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/ordered_code.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+namespace {
+
+using auth::User;
+using model::BatchId;
+using model::Document;
+using model::DocumentKey;
+using model::DocumentState;
+using model::MaybeDocument;
+using model::SnapshotVersion;
+using nanopb::MakeStdString;
+using nanopb::Message;
+using nanopb::StringReader;
+using util::OrderedCode;
+
+// The encoding of the base document types. MaybeDocument::Type isn't used
+// directly so that its values can change without invalidating stored rows.
+enum class BaseType : int64_t {
+  None = 0,
+  Document = 1,
+  NoDocument = 2,
+  UnknownDocument = 3,
+};
+
+BaseType EncodeBaseType(MaybeDocument::Type type) {
+  switch (type) {
+    case MaybeDocument::Type::Invalid:
+      return BaseType::None;
+    case MaybeDocument::Type::Document:
+      return BaseType::Document;
+    case MaybeDocument::Type::NoDocument:
+      return BaseType::NoDocument;
+    case MaybeDocument::Type::UnknownDocument:
+      return BaseType::UnknownDocument;
+  }
+  UNREACHABLE();
+}
+
+absl::optional<MaybeDocument::Type> DecodeBaseType(int64_t type) {
+  switch (static_cast<BaseType>(type)) {
+    case BaseType::None:
+      return MaybeDocument::Type::Invalid;
+    case BaseType::Document:
+      return MaybeDocument::Type::Document;
+    case BaseType::NoDocument:
+      return MaybeDocument::Type::NoDocument;
+    case BaseType::UnknownDocument:
+      return MaybeDocument::Type::UnknownDocument;
+  }
+  return absl::nullopt;
+}
+
+}  // namespace
+
+LevelDbDocumentOverlayCache::LevelDbDocumentOverlayCache(
+    const User& user, LevelDbPersistence* db, LocalSerializer* serializer)
+    : db_(NOT_NULL(db)),
+      serializer_(NOT_NULL(serializer)),
+      user_id_(user.is_authenticated() ? user.uid() : "") {
+}
+
+absl::optional<DocumentOverlay> LevelDbDocumentOverlayCache::Get(
+    const DocumentKey& key) {
+  std::string value;
+  leveldb::Status status = db_->current_transaction()->Get(
+      LevelDbDocumentOverlayKey::Key(user_id_, key), &value);
+  if (!status.ok()) return absl::nullopt;
+
+  return DecodeOverlay(value, key);
+}
+
+void LevelDbDocumentOverlayCache::Save(const DocumentKey& key,
+                                       const DocumentOverlay& overlay) {
+  if (db_->in_read_only_transaction()) return;
+
+  db_->current_transaction()->Put(LevelDbDocumentOverlayKey::Key(user_id_, key),
+                                  EncodeOverlay(overlay));
+}
+
+void LevelDbDocumentOverlayCache::Remove(const DocumentKey& key) {
+  db_->current_transaction()->Delete(
+      LevelDbDocumentOverlayKey::Key(user_id_, key));
+}
+
+// An overlay is encoded as the base document's type, version and pending
+// writes, the number of batches followed by their IDs, and whether there is a
+// local view, all as OrderedCode signed numbers. The local view then follows
+// as an encoded MaybeDocument, preceded by whether it has local mutations,
+// which the MaybeDocument encoding doesn't keep.
+std::string LevelDbDocumentOverlayCache::EncodeOverlay(
+    const DocumentOverlay& overlay) {
+  std::string result;
+  OrderedCode::WriteSignedNumIncreasing(
+      &result, static_cast<int64_t>(EncodeBaseType(overlay.base_type())));
+  const Timestamp& base_version = overlay.base_version().timestamp();
+  OrderedCode::WriteSignedNumIncreasing(&result, base_version.seconds());
+  OrderedCode::WriteSignedNumIncreasing(&result, base_version.nanoseconds());
+  OrderedCode::WriteSignedNumIncreasing(&result,
+                                        overlay.base_has_pending_writes());
+
+  OrderedCode::WriteSignedNumIncreasing(&result, overlay.batch_ids().size());
+  for (BatchId batch_id : overlay.batch_ids()) {
+    OrderedCode::WriteSignedNumIncreasing(&result, batch_id);
+  }
+
+  const absl::optional<MaybeDocument>& local_view = overlay.local_view();
+  OrderedCode::WriteSignedNumIncreasing(&result, local_view.has_value());
+  if (local_view) {
+    bool has_local_mutations = local_view->is_document() &&
+                               Document(*local_view).has_local_mutations();
+    OrderedCode::WriteSignedNumIncreasing(&result, has_local_mutations);
+    result += MakeStdString(serializer_->EncodeMaybeDocument(*local_view));
+  }
+  return result;
+}
+
+absl::optional<DocumentOverlay> LevelDbDocumentOverlayCache::DecodeOverlay(
+    absl::string_view encoded, const DocumentKey& key) {
+  // Overlays are only a cache, so anything that fails to decode is ignored and
+  // recomputed.
+  int64_t base_type = 0;
+  int64_t seconds = 0;
+  int64_t nanoseconds = 0;
+  int64_t base_has_pending_writes = 0;
+  int64_t batch_count = 0;
+  if (!OrderedCode::ReadSignedNumIncreasing(&encoded, &base_type) ||
+      !OrderedCode::ReadSignedNumIncreasing(&encoded, &seconds) ||
+      !OrderedCode::ReadSignedNumIncreasing(&encoded, &nanoseconds) ||
+      !OrderedCode::ReadSignedNumIncreasing(&encoded,
+                                            &base_has_pending_writes) ||
+      !OrderedCode::ReadSignedNumIncreasing(&encoded, &batch_count) ||
+      batch_count < 0) {
+    return absl::nullopt;
+  }
+
+  absl::optional<MaybeDocument::Type> decoded_base_type =
+      DecodeBaseType(base_type);
+  if (!decoded_base_type || nanoseconds < 0 || nanoseconds >= 1000000000) {
+    return absl::nullopt;
+  }
+
+  std::vector<BatchId> batch_ids;
+  for (int64_t i = 0; i < batch_count; ++i) {
+    int64_t batch_id = 0;
+    if (!OrderedCode::ReadSignedNumIncreasing(&encoded, &batch_id)) {
+      return absl::nullopt;
+    }
+    batch_ids.push_back(static_cast<BatchId>(batch_id));
+  }
+
+  int64_t has_local_view = 0;
+  if (!OrderedCode::ReadSignedNumIncreasing(&encoded, &has_local_view)) {
+    return absl::nullopt;
+  }
+
+  absl::optional<MaybeDocument> local_view;
+  if (has_local_view) {
+    int64_t has_local_mutations = 0;
+    if (!OrderedCode::ReadSignedNumIncreasing(&encoded,
+                                              &has_local_mutations)) {
+      return absl::nullopt;
+    }
+
+    StringReader reader{encoded};
+    auto message = Message<firestore_client_MaybeDocument>::TryParse(&reader);
+    MaybeDocument maybe_document =
+        serializer_->DecodeMaybeDocument(&reader, *message);
+    if (!reader.ok() || maybe_document.key() != key) return absl::nullopt;
+
+    if (has_local_mutations && maybe_document.is_document()) {
+      Document doc(maybe_document);
+      maybe_document = Document(doc.data(), doc.key(), doc.version(),
+                                DocumentState::kLocalMutations);
+    }
+    local_view = std::move(maybe_document);
+  }
+
+  SnapshotVersion base_version{
+      Timestamp(seconds, static_cast<int32_t>(nanoseconds))};
+  return DocumentOverlay(*decoded_base_type, base_version,
+                         base_has_pending_writes != 0, std::move(batch_ids),
+                         std::move(local_view));
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_LEVELDB_DOCUMENT_OVERLAY_CACHE_H_
+#define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_DOCUMENT_OVERLAY_CACHE_H_
+
+#include <string>
+
+#include "Firestore/core/src/local/document_overlay_cache.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+
+namespace auth {
+class User;
+}  // namespace auth
+
+namespace local {
+
+class LevelDbPersistence;
+class LocalSerializer;
+
+class LevelDbDocumentOverlayCache : public DocumentOverlayCache {
+ public:
+  /** Creates a new overlay cache for the given user in the given LevelDB. */
+  LevelDbDocumentOverlayCache(const auth::User& user,
+                              LevelDbPersistence* db,
+                              LocalSerializer* serializer);
+
+  absl::optional<DocumentOverlay> Get(const model::DocumentKey& key) override;
+
+  /** Drops overlays saved in read-only transactions, which can't write. */
+  void Save(const model::DocumentKey& key,
+            const DocumentOverlay& overlay) override;
+
+  void Remove(const model::DocumentKey& key) override;
+
+ private:
+  std::string EncodeOverlay(const DocumentOverlay& overlay);
+
+  /** Returns nullopt if `encoded` isn't a valid overlay. */
+  absl::optional<DocumentOverlay> DecodeOverlay(absl::string_view encoded,
+                                                const model::DocumentKey& key);
+
+  // The LevelDbDocumentOverlayCache is owned by LevelDbPersistence.
+  LevelDbPersistence* db_ = nullptr;
+  // Owned by LevelDbPersistence.
+  LocalSerializer* serializer_ = nullptr;
+
+  /**
+   * The normalized user_id (i.e. after converting null to empty) as used in our
+   * LevelDB keys.
+   */
+  std::string user_id_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_LEVELDB_DOCUMENT_OVERLAY_CACHE_H_
@@ -16,21 +16,300 @@
 
 #include "Firestore/core/src/local/leveldb_index_manager.h"
 
+#include <algorithm>
+#include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "Firestore/core/src/core/bound.h"
+#include "Firestore/core/src/core/field_filter.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/local/index_value_writer.h"
 #include "Firestore/core/src/local/leveldb_key.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
 #include "Firestore/core/src/local/memory_index_manager.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/document_map.h"
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/log.h"
+#include "Firestore/core/src/util/ordered_code.h"
+#include "Firestore/core/src/util/string_util.h"
 #include "absl/strings/match.h"
 
 namespace firebase {
 namespace firestore {
 namespace local {
 
+using core::Bound;
+using core::Direction;
+using core::FieldFilter;
+using core::Filter;
+using core::OrderBy;
+using core::Query;
+using leveldb::Status;
+using model::Document;
+using model::DocumentKey;
+using model::DocumentKeySet;
+using model::FieldIndex;
+using model::FieldPath;
+using model::MaybeDocument;
 using model::ResourcePath;
+using model::SnapshotVersion;
+using util::OrderedCode;
+
+namespace {
+
+/**
+ * Encodes the collection group and fields of a field index for storage as the
+ * value of a LevelDbFieldIndexKey row.
+ */
+std::string EncodeFieldIndex(const FieldIndex& index) {
+  std::string result;
+  OrderedCode::WriteString(&result, index.collection_group());
+  for (const FieldPath& field : index.fields()) {
+    OrderedCode::WriteSignedNumIncreasing(&result, field.size());
+    for (const std::string& segment : field) {
+      OrderedCode::WriteString(&result, segment);
+    }
+  }
+  return result;
+}
+
+absl::optional<FieldIndex> DecodeFieldIndex(int32_t index_id,
+                                            absl::string_view encoded) {
+  std::string collection_group;
+  if (!OrderedCode::ReadString(&encoded, &collection_group)) {
+    return absl::nullopt;
+  }
+
+  std::vector<FieldPath> fields;
+  while (!encoded.empty()) {
+    int64_t segment_count = 0;
+    if (!OrderedCode::ReadSignedNumIncreasing(&encoded, &segment_count) ||
+        segment_count <= 0) {
+      return absl::nullopt;
+    }
+
+    std::vector<std::string> segments;
+    for (int64_t i = 0; i < segment_count; ++i) {
+      std::string segment;
+      if (!OrderedCode::ReadString(&encoded, &segment)) {
+        return absl::nullopt;
+      }
+      segments.push_back(std::move(segment));
+    }
+    fields.push_back(FieldPath::FromSegments(std::move(segments)));
+  }
+
+  return FieldIndex(index_id, std::move(collection_group), std::move(fields));
+}
+
+/**
+ * Returns the encoded values of the indexed fields of the given document, or
+ * nullopt if the document doesn't exist or lacks any of the fields.
+ */
+absl::optional<std::string> EncodeIndexValues(const FieldIndex& index,
+                                              const MaybeDocument& document) {
+  if (!document.is_document()) return absl::nullopt;
+
+  Document doc(document);
+  std::string result;
+  for (const FieldPath& field : index.fields()) {
+    absl::optional<model::FieldValue> value = doc.field(field);
+    if (!value) return absl::nullopt;
+    WriteIndexValue(*value, &result);
+  }
+  return result;
+}
+
+bool IsLowerBound(Filter::Operator op) {
+  return op == Filter::Operator::GreaterThan ||
+         op == Filter::Operator::GreaterThanOrEqual;
+}
+
+bool IsUpperBound(Filter::Operator op) {
+  return op == Filter::Operator::LessThan ||
+         op == Filter::Operator::LessThanOrEqual;
+}
+
+/**
+ * A range of index_values in a single field index, computed from the filters
+ * of a query. `upper` is exclusive; an empty `upper` means the range extends
+ * to the end of the index.
+ *
+ * Strict inequalities are widened to their inclusive counterparts: the
+ * encoding of numbers is lossy, so an exclusive bound could skip documents
+ * that actually match.
+ */
+struct IndexRange {
+  int32_t index_id = FieldIndex::kUnknownId;
+  std::string lower;
+  std::string upper;
+
+  /**
+   * How many of the leading index fields are constrained by the range: each
+   * equality counts twice, a trailing inequality once.
+   */
+  int score = 0;
+};
+
+/**
+ * Narrows the range of encoded values that follow `prefix` by the query's
+ * start and end bounds, if the query is ordered by `field` first. Paging
+ * through the query with cursors then only scans the requested page.
+ *
+ * The first value of a bound constrains `field` inclusively whether the bound
+ * is just before or just after it; the query itself decides which of the
+ * documents at the bound match.
+ *
+ * @return true if either end of the range was narrowed.
+ */
+bool NarrowByBounds(const Query& query,
+                    const FieldPath& field,
+                    const std::string& prefix,
+                    absl::optional<std::string>* lower_value,
+                    absl::optional<std::string>* upper_value) {
+  const core::OrderByList& order_bys = query.order_bys();
+  if (order_bys.empty() || order_bys.front().field() != field) return false;
+
+  bool ascending = order_bys.front().direction() == Direction::Ascending;
+  const std::shared_ptr<Bound>& lower_bound =
+      ascending ? query.start_at() : query.end_at();
+  const std::shared_ptr<Bound>& upper_bound =
+      ascending ? query.end_at() : query.start_at();
+  bool has_lower = lower_bound && !lower_bound->position().empty();
+  bool has_upper = upper_bound && !upper_bound->position().empty();
+  if (!has_lower && !has_upper) return false;
+
+  if (!*lower_value) {
+    *lower_value = prefix;
+    *upper_value = util::PrefixSuccessor(prefix);
+  }
+
+  if (has_lower) {
+    std::string value = prefix;
+    WriteIndexValue(lower_bound->position().front(), &value);
+    if (value > **lower_value) {
+      *lower_value = std::move(value);
+    }
+  }
+  if (has_upper) {
+    std::string value = prefix;
+    WriteIndexValue(upper_bound->position().front(), &value);
+    value = util::PrefixSuccessor(value);
+    if ((*upper_value)->empty() || value < **upper_value) {
+      *upper_value = std::move(value);
+    }
+  }
+  return true;
+}
+
+/**
+ * Computes the range of the given index to scan for the query, or nullopt if
+ * the index can't serve the query.
+ */
+absl::optional<IndexRange> ComputeIndexRange(const FieldIndex& index,
+                                             const Query& query) {
+  // Only documents with values for all indexed fields have index entries, so
+  // the index can only be used if the query excludes documents without those
+  // fields. Every field filter and every order by has this property.
+  std::set<FieldPath> constrained_fields;
+  for (const Filter& filter : query.filters()) {
+    if (filter.IsAFieldFilter() && !filter.field().IsKeyFieldPath()) {
+      constrained_fields.insert(filter.field());
+    }
+  }
+  for (const OrderBy& order_by : query.order_bys()) {
+    if (!order_by.field().IsKeyFieldPath()) {
+      constrained_fields.insert(order_by.field());
+    }
+  }
+  for (const FieldPath& field : index.fields()) {
+    if (constrained_fields.find(field) == constrained_fields.end()) {
+      return absl::nullopt;
+    }
+  }
+
+  IndexRange range;
+  range.index_id = index.index_id();
+
+  std::string prefix;
+  absl::optional<std::string> lower_value;
+  absl::optional<std::string> upper_value;
+  for (const FieldPath& field : index.fields()) {
+    absl::optional<model::FieldValue> equal_value;
+    absl::optional<model::FieldValue> lower;
+    absl::optional<model::FieldValue> upper;
+    for (const Filter& filter : query.filters()) {
+      if (filter.type() != Filter::Type::kFieldFilter ||
+          filter.field() != field) {
+        continue;
+      }
+
+      FieldFilter field_filter(filter);
+      if (field_filter.op() == Filter::Operator::Equal) {
+        equal_value = field_filter.value();
+      } else if (IsLowerBound(field_filter.op())) {
+        if (!lower || field_filter.value() > *lower) {
+          lower = field_filter.value();
+        }
+      } else if (IsUpperBound(field_filter.op())) {
+        if (!upper || field_filter.value() < *upper) {
+          upper = field_filter.value();
+        }
+      }
+    }
+
+    if (equal_value) {
+      WriteIndexValue(*equal_value, &prefix);
+      range.score += 2;
+      continue;
+    }
+
+    if (lower || upper) {
+      range.score += 1;
+      lower_value = prefix;
+      upper_value = prefix;
+      if (lower) {
+        WriteIndexValue(*lower, &*lower_value);
+      } else {
+        WriteIndexValueLowerBound(upper->type(), &*lower_value);
+      }
+      if (upper) {
+        WriteIndexValue(*upper, &*upper_value);
+        *upper_value = util::PrefixSuccessor(*upper_value);
+      } else {
+        WriteIndexValueUpperBound(lower->type(), &*upper_value);
+      }
+    }
+
+    if (NarrowByBounds(query, field, prefix, &lower_value, &upper_value)) {
+      range.score += 1;
+    }
+    break;
+  }
+
+  if (range.score == 0) {
+    // The index would only filter out documents that lack the indexed fields,
+    // which is unlikely to beat a collection scan.
+    return absl::nullopt;
+  }
+
+  if (lower_value) {
+    range.lower = std::move(*lower_value);
+    range.upper = std::move(*upper_value);
+  } else {
+    range.lower = prefix;
+    range.upper = util::PrefixSuccessor(prefix);
+  }
+  return range;
+}
+
+}  // namespace
 
 LevelDbIndexManager::LevelDbIndexManager(LevelDbPersistence* db) : db_(db) {
 }
@@ -39,6 +318,7 @@ void LevelDbIndexManager::AddToCollectionParentIndex(
     const ResourcePath& collection_path) {
   HARD_ASSERT(collection_path.size() % 2 == 1, "Expected a collection path.");
 
+  EnsureCollectionParentsLoaded();
   if (collection_parents_cache_.Add(collection_path)) {
     std::string collection_id = collection_path.last_segment();
     ResourcePath parent_path = collection_path.PopLast();
@@ -52,6 +332,48 @@ void LevelDbIndexManager::AddToCollectionParentIndex(
 
 std::vector<ResourcePath> LevelDbIndexManager::GetCollectionParents(
     const std::string& collection_id) {
+  if (db_->in_read_only_transaction()) {
+    // Read-only transactions may run concurrently with writes to the index,
+    // so they must not touch the in-memory copy.
+    return ReadCollectionParents(collection_id);
+  }
+
+  EnsureCollectionParentsLoaded();
+  return collection_parents_cache_.GetEntries(collection_id);
+}
+
+size_t LevelDbIndexManager::ReleaseMemory() {
+  if (!collection_parents_loaded_) return 0;
+
+  // The field index configuration is kept: it's small, and the index entries
+  // written by every transaction depend on it.
+  size_t released = collection_parents_cache_.byte_size();
+  collection_parents_cache_.Clear();
+  collection_parents_loaded_ = false;
+  return released;
+}
+
+void LevelDbIndexManager::EnsureCollectionParentsLoaded() {
+  if (collection_parents_loaded_) return;
+  collection_parents_loaded_ = true;
+
+  auto index_iterator = db_->current_transaction()->NewIterator();
+  std::string index_prefix = LevelDbCollectionParentKey::KeyPrefix();
+  LevelDbCollectionParentKey row_key;
+  for (index_iterator->Seek(index_prefix); index_iterator->Valid();
+       index_iterator->Next()) {
+    if (!absl::StartsWith(index_iterator->key(), index_prefix) ||
+        !row_key.Decode(index_iterator->key())) {
+      break;
+    }
+
+    collection_parents_cache_.Add(
+        row_key.parent().Append(row_key.collection_id()));
+  }
+}
+
+std::vector<ResourcePath> LevelDbIndexManager::ReadCollectionParents(
+    const std::string& collection_id) {
   std::vector<ResourcePath> results;
 
   auto index_iterator = db_->current_transaction()->NewIterator();
@@ -71,6 +393,219 @@ std::vector<ResourcePath> LevelDbIndexManager::GetCollectionParents(
   return results;
 }
 
+void LevelDbIndexManager::AddFieldIndex(const FieldIndex& index) {
+  HARD_ASSERT(!index.fields().empty(), "Field indexes must index a field");
+
+  EnsureFieldIndexesLoaded();
+  std::vector<FieldIndex>& indexes = field_indexes_[index.collection_group()];
+  if (std::find(indexes.begin(), indexes.end(), index) != indexes.end()) {
+    return;
+  }
+
+  FieldIndex persisted = index.WithIndexId(next_index_id_++);
+  db_->current_transaction()->Put(
+      LevelDbFieldIndexKey::Key(persisted.index_id()),
+      EncodeFieldIndex(persisted));
+  indexes.push_back(persisted);
+
+  // Backfill the new index from the documents that are already cached.
+  const std::string& collection_group = persisted.collection_group();
+  for (const ResourcePath& parent : GetCollectionParents(collection_group)) {
+    Query collection_query(parent.Append(collection_group));
+    model::DocumentMap documents =
+        db_->remote_document_cache()->GetMatching(collection_query,
+                                                  SnapshotVersion::None());
+    for (const auto& kv : documents.underlying_map()) {
+      UpdateIndexEntry(persisted, kv.first,
+                       EncodeIndexValues(persisted, kv.second));
+    }
+  }
+}
+
+void LevelDbIndexManager::DeleteFieldIndex(const FieldIndex& index) {
+  EnsureFieldIndexesLoaded();
+  std::vector<FieldIndex>& indexes = field_indexes_[index.collection_group()];
+  auto found = std::find(indexes.begin(), indexes.end(), index);
+  if (found == indexes.end()) {
+    return;
+  }
+
+  int32_t index_id = found->index_id();
+  indexes.erase(found);
+
+  LevelDbTransaction* transaction = db_->current_transaction();
+  transaction->Delete(LevelDbFieldIndexKey::Key(index_id));
+
+  for (const std::string& prefix :
+       {LevelDbIndexEntryKey::KeyPrefix(index_id),
+        LevelDbIndexDocumentKey::KeyPrefix(index_id)}) {
+    auto it = transaction->NewIterator();
+    for (it->Seek(prefix); it->Valid() && absl::StartsWith(it->key(), prefix);
+         it->Next()) {
+      transaction->Delete(it->key());
+    }
+  }
+}
+
+std::vector<FieldIndex> LevelDbIndexManager::GetFieldIndexes(
+    const std::string& collection_group) {
+  const std::vector<FieldIndex>* indexes = FieldIndexesFor(collection_group);
+  if (!indexes) return {};
+  return *indexes;
+}
+
+void LevelDbIndexManager::UpdateIndexEntries(const MaybeDocument& document) {
+  const DocumentKey& key = document.key();
+  const std::vector<FieldIndex>* indexes =
+      FieldIndexesFor(key.path().PopLast().last_segment());
+  if (!indexes) return;
+
+  for (const FieldIndex& index : *indexes) {
+    UpdateIndexEntry(index, key, EncodeIndexValues(index, document));
+  }
+}
+
+void LevelDbIndexManager::RemoveIndexEntries(const DocumentKey& key) {
+  const std::vector<FieldIndex>* indexes =
+      FieldIndexesFor(key.path().PopLast().last_segment());
+  if (!indexes) return;
+
+  for (const FieldIndex& index : *indexes) {
+    UpdateIndexEntry(index, key, absl::nullopt);
+  }
+}
+
+absl::optional<DocumentKeySet> LevelDbIndexManager::GetDocumentsMatchingQuery(
+    const Query& query) {
+  if (query.IsDocumentQuery()) {
+    return absl::nullopt;
+  }
+
+  const ResourcePath& collection_path = query.path();
+  const std::string& collection_group =
+      query.IsCollectionGroupQuery() ? *query.collection_group()
+                                     : collection_path.last_segment();
+  const std::vector<FieldIndex>* indexes = nullptr;
+  std::vector<FieldIndex> snapshot_indexes;
+  if (db_->in_read_only_transaction()) {
+    // Read-only transactions may run concurrently with changes to the index
+    // configuration, so they must only use the indexes in their snapshot.
+    for (FieldIndex& index : ReadFieldIndexes()) {
+      if (index.collection_group() == collection_group) {
+        snapshot_indexes.push_back(std::move(index));
+      }
+    }
+    if (!snapshot_indexes.empty()) indexes = &snapshot_indexes;
+  } else {
+    indexes = FieldIndexesFor(collection_group);
+  }
+  if (!indexes) return absl::nullopt;
+
+  absl::optional<IndexRange> best;
+  for (const FieldIndex& index : *indexes) {
+    absl::optional<IndexRange> range = ComputeIndexRange(index, query);
+    if (range && (!best || range->score > best->score)) {
+      best = std::move(range);
+    }
+  }
+  if (!best) return absl::nullopt;
+
+  LOG_DEBUG("Using field index %s to execute query: %s", best->index_id,
+            query.ToString());
+
+  DocumentKeySet result;
+  std::string index_prefix = LevelDbIndexEntryKey::KeyPrefix(best->index_id);
+  auto it = db_->current_transaction()->NewIterator();
+  LevelDbIndexEntryKey entry_key;
+  for (it->Seek(LevelDbIndexEntryKey::KeyPrefix(best->index_id, best->lower));
+       it->Valid(); it->Next()) {
+    if (!absl::StartsWith(it->key(), index_prefix) ||
+        !entry_key.Decode(it->key()) ||
+        (!best->upper.empty() && entry_key.index_values() >= best->upper)) {
+      break;
+    }
+
+    // The index spans the whole collection group, so a group query reads all
+    // of its parents in a single scan.
+    const DocumentKey& document_key = entry_key.document_key();
+    if (query.IsCollectionGroupQuery() ||
+        collection_path.IsImmediateParentOf(document_key.path())) {
+      result = result.insert(document_key);
+    }
+  }
+  return result;
+}
+
+void LevelDbIndexManager::EnsureFieldIndexesLoaded() {
+  if (field_indexes_loaded_) return;
+  field_indexes_loaded_ = true;
+
+  for (FieldIndex& index : ReadFieldIndexes()) {
+    next_index_id_ = std::max(next_index_id_, index.index_id() + 1);
+    field_indexes_[index.collection_group()].push_back(std::move(index));
+  }
+}
+
+std::vector<FieldIndex> LevelDbIndexManager::ReadFieldIndexes() {
+  std::vector<FieldIndex> result;
+
+  std::string table_prefix = LevelDbFieldIndexKey::KeyPrefix();
+  auto it = db_->current_transaction()->NewIterator();
+  LevelDbFieldIndexKey row_key;
+  for (it->Seek(table_prefix); it->Valid(); it->Next()) {
+    if (!absl::StartsWith(it->key(), table_prefix) ||
+        !row_key.Decode(it->key())) {
+      break;
+    }
+
+    absl::optional<FieldIndex> index =
+        DecodeFieldIndex(row_key.index_id(), it->value());
+    HARD_ASSERT(index, "Failed to decode field index %s", row_key.index_id());
+    result.push_back(std::move(*index));
+  }
+  return result;
+}
+
+const std::vector<FieldIndex>* LevelDbIndexManager::FieldIndexesFor(
+    const std::string& collection_group) {
+  EnsureFieldIndexesLoaded();
+  auto found = field_indexes_.find(collection_group);
+  if (found == field_indexes_.end() || found->second.empty()) {
+    return nullptr;
+  }
+  return &found->second;
+}
+
+void LevelDbIndexManager::UpdateIndexEntry(
+    const FieldIndex& index,
+    const DocumentKey& key,
+    const absl::optional<std::string>& index_values) {
+  LevelDbTransaction* transaction = db_->current_transaction();
+  std::string document_key =
+      LevelDbIndexDocumentKey::Key(index.index_id(), key);
+
+  std::string previous_values;
+  Status status = transaction->Get(document_key, &previous_values);
+  if (status.ok()) {
+    if (index_values && *index_values == previous_values) {
+      return;
+    }
+    transaction->Delete(
+        LevelDbIndexEntryKey::Key(index.index_id(), previous_values, key));
+  } else if (!status.IsNotFound()) {
+    HARD_FAIL("Fetch index entry for key (%s) failed with status: %s",
+              key.ToString(), status.ToString());
+  }
+
+  if (index_values) {
+    transaction->Put(
+        LevelDbIndexEntryKey::Key(index.index_id(), *index_values, key), "");
+    transaction->Put(std::move(document_key), *index_values);
+  } else if (status.ok()) {
+    transaction->Delete(document_key);
+  }
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
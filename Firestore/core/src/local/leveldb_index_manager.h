@@ -18,10 +18,13 @@
 #define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_INDEX_MANAGER_H_
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Firestore/core/src/local/index_manager.h"
 #include "Firestore/core/src/local/memory_index_manager.h"
+#include "Firestore/core/src/model/field_index.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
@@ -40,18 +43,80 @@ class LevelDbIndexManager : public IndexManager {
   std::vector<model::ResourcePath> GetCollectionParents(
       const std::string& collection_id) override;
 
+  void AddFieldIndex(const model::FieldIndex& index) override;
+
+  void DeleteFieldIndex(const model::FieldIndex& index) override;
+
+  std::vector<model::FieldIndex> GetFieldIndexes(
+      const std::string& collection_group) override;
+
+  void UpdateIndexEntries(const model::MaybeDocument& document) override;
+
+  void RemoveIndexEntries(const model::DocumentKey& key) override;
+
+  absl::optional<model::DocumentKeySet> GetDocumentsMatchingQuery(
+      const core::Query& query) override;
+
+  /**
+   * Drops the in-memory copy of the collection parent index, which is read
+   * again when next needed, and returns the estimated memory it released, in
+   * bytes. Must be called outside of any transaction.
+   */
+  size_t ReleaseMemory();
+
  private:
+  /** Reads the collection parent index, if not already loaded. */
+  void EnsureCollectionParentsLoaded();
+
+  /** Reads the parents of the given collection from the current transaction. */
+  std::vector<model::ResourcePath> ReadCollectionParents(
+      const std::string& collection_id);
+
+  /** Reads the field index configurations, if not already loaded. */
+  void EnsureFieldIndexesLoaded();
+
+  /** Reads all field index configurations from the current transaction. */
+  std::vector<model::FieldIndex> ReadFieldIndexes();
+
+  /**
+   * Returns the field indexes that apply to documents in the given collection
+   * group, or nullptr if there are none.
+   */
+  const std::vector<model::FieldIndex>* FieldIndexesFor(
+      const std::string& collection_group);
+
+  /**
+   * Replaces the entry for `key` in `index` with one encoding the given
+   * values, or removes the entry if `index_values` is nullopt.
+   */
+  void UpdateIndexEntry(const model::FieldIndex& index,
+                        const model::DocumentKey& key,
+                        const absl::optional<std::string>& index_values);
+
   // The LevelDbIndexManager is owned by LevelDbPersistence.
   LevelDbPersistence* db_;
 
   /**
-   * An in-memory copy of the index entries we've already written since the SDK
-   * launched. Used to avoid re-writing the same entry repeatedly.
+   * A complete copy of the persisted collection parent index once loaded,
+   * kept up to date as entries are added. Used to avoid re-writing the same
+   * entry repeatedly and to answer `GetCollectionParents` without reading
+   * LevelDB.
    *
-   * This is *NOT* a complete cache of what's in persistence and so can never
-   * be used to satisfy reads.
+   * Entries are only added, so the copy may at worst list parents whose
+   * write was rolled back, which only costs an empty collection scan.
    */
   MemoryCollectionParentIndex collection_parents_cache_;
+  bool collection_parents_loaded_ = false;
+
+  /**
+   * The configured field indexes, keyed by collection group. Like
+   * `collection_parents_cache_` this is a complete copy of the persisted
+   * configuration once loaded.
+   */
+  std::unordered_map<std::string, std::vector<model::FieldIndex>>
+      field_indexes_;
+  bool field_indexes_loaded_ = false;
+  int32_t next_index_id_ = 1;
 };
 
 }  // namespace local
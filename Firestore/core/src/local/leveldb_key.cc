@@ -16,6 +16,7 @@
 
 #include "Firestore/core/src/local/leveldb_key.h"
 
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -24,6 +25,7 @@
 #include "Firestore/core/src/util/ordered_code.h"
 #include "absl/base/attributes.h"
 #include "absl/strings/escaping.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 
 using firebase::firestore::model::DocumentKey;
@@ -39,17 +41,30 @@ namespace {
 const char* kVersionGlobalTable = "version";
 const char* kMutationsTable = "mutation";
 const char* kDocumentMutationsTable = "document_mutation";
+const char* kCollectionMutationsTable = "collection_mutation";
+const char* kDocumentOverlaysTable = "document_overlay";
 const char* kMutationQueuesTable = "mutation_queue";
 const char* kTargetGlobalTable = "target_global";
 const char* kTargetsTable = "target";
+const char* kTargetStatesTable = "target_state";
 const char* kQueryTargetsTable = "query_target";
 const char* kTargetDocumentsTable = "target_document";
+const char* kTargetDocumentBlocksTable = "target_document_block";
 const char* kDocumentTargetsTable = "document_target";
 const char* kRemoteDocumentsTable = "remote_document";
+const char* kCollectionDictionaryTable = "collection_dictionary";
+const char* kCollectionDictionaryGlobalTable = "collection_dictionary_global";
+const char* kCollectionDocumentsTable = "collection_document";
 const char* kCollectionParentsTable = "collection_parent";
 const char* kRemoteDocumentReadTimeTable = "remote_document_read_time";
 const char* kBundlesTable = "bundles";
 const char* kNamedQueriesTable = "named_queries";
+const char* kFieldIndexesTable = "field_index";
+const char* kIndexEntriesTable = "index_entry";
+const char* kIndexDocumentsTable = "index_document";
+const char* kSizeCountersTable = "size_counters";
+const char* kSequenceNumberHistogramTable = "sequence_number_histogram";
+const char* kMigrationCursorTable = "migration_cursor";
 
 /**
  * Labels for the components of keys. These serve to make keys self-describing.
@@ -115,6 +130,21 @@ enum ComponentLabel {
   /** A component containing the name of a named query. */
   QueryName = 18,
 
+  /** A component containing the ID of a field index. */
+  IndexId = 19,
+
+  /** A component containing the encoded values of indexed fields. */
+  IndexValues = 20,
+
+  /** A component containing the ID of a block of a target's document keys. */
+  BlockId = 21,
+
+  /**
+   * A component containing the number the collection dictionary assigned to a
+   * collection.
+   */
+  CollectionNumber = 22,
+
   /**
    * A path segment describes just a single segment in a resource path. Path
    * segments that occur sequentially in a key represent successive segments in
@@ -135,6 +165,32 @@ enum ComponentLabel {
   Unknown = 63,
 };
 
+/**
+ * Reads a string encoded by OrderedCode::WriteString from `src` and returns
+ * whether it's equal to `expected`. Unless `expected` contains bytes that need
+ * escaping, this compares the encoded bytes directly rather than decoding the
+ * string.
+ *
+ * If the read is unsuccessful or the strings differ, returns false and leaves
+ * `src` in an unspecified state.
+ */
+bool ReadStringMatching(absl::string_view* src, absl::string_view expected) {
+  static const absl::string_view kSpecialBytes{"\0\xff", 2};
+  if (expected.find_first_of(kSpecialBytes) != absl::string_view::npos) {
+    std::string decoded;
+    return OrderedCode::ReadString(src, &decoded) && decoded == expected;
+  }
+
+  // Strings without special bytes are encoded as themselves followed by a
+  // separator.
+  static const absl::string_view kSeparator{"\0\1", 2};
+  if (!absl::StartsWith(*src, expected)) return false;
+  src->remove_prefix(expected.size());
+  if (!absl::StartsWith(*src, kSeparator)) return false;
+  src->remove_prefix(kSeparator.size());
+  return true;
+}
+
 /**
  * A helper for reading through the string form of a LevelDB key, as written
  * by Writer.
@@ -201,6 +257,22 @@ class Reader {
     return ReadLabeledString(ComponentLabel::QueryName);
   }
 
+  int32_t ReadIndexId() {
+    return ReadLabeledInt32(ComponentLabel::IndexId);
+  }
+
+  int32_t ReadBlockId() {
+    return ReadLabeledInt32(ComponentLabel::BlockId);
+  }
+
+  int32_t ReadCollectionNumber() {
+    return ReadLabeledInt32(ComponentLabel::CollectionNumber);
+  }
+
+  std::string ReadIndexValues() {
+    return ReadLabeledString(ComponentLabel::IndexValues);
+  }
+
   /**
    * Reads a snapshot version, encoded as a component label and a pair of
    * seconds (int64) and nanoseconds (int32).
@@ -228,6 +300,15 @@ class Reader {
    */
   DocumentKey ReadDocumentKey();
 
+  /**
+   * Like ReadDocumentKey, but skips over the path segments and returns a view
+   * of their encoding instead of decoding them.
+   *
+   * If the read is unsuccessful or the document key is invalid, returns an
+   * empty view and fails the Reader.
+   */
+  LevelDbDocumentKeyView ReadDocumentKeyView();
+
   /**
    * Reads a terminator component from the key.
    *
@@ -274,6 +355,22 @@ class Reader {
     return "";
   }
 
+  /**
+   * OrderedCode::ReadString adapted to leveldb::Slice, skipping over the string
+   * instead of decoding it.
+   */
+  void SkipString() {
+    if (ok_) {
+      absl::string_view tmp = MakeStringView(src_);
+      if (OrderedCode::ReadString(&tmp, nullptr)) {
+        src_ = MakeSlice(tmp);
+        return;
+      }
+    }
+
+    Fail();
+  }
+
   /**
    * Reads a component label from the key.
    *
@@ -402,10 +499,23 @@ class Reader {
   ABSL_MUST_USE_RESULT
   bool ReadLabeledStringMatching(ComponentLabel expected_label,
                                  const char* expected_value) {
-    std::string value = ReadLabeledString(expected_label);
+    if (!ReadComponentLabelMatching(expected_label)) {
+      Fail();
+    }
     if (ok_) {
-      // Value mismatch does not constitute a failure:
-      return value == expected_value;
+      absl::string_view tmp = MakeStringView(src_);
+      if (ReadStringMatching(&tmp, expected_value)) {
+        src_ = MakeSlice(tmp);
+        return true;
+      }
+
+      // Value mismatch does not constitute a failure, unless the string can't
+      // be read at all.
+      tmp = MakeStringView(src_);
+      if (OrderedCode::ReadString(&tmp, nullptr)) {
+        src_ = MakeSlice(tmp);
+        return false;
+      }
     }
 
     Fail();
@@ -457,6 +567,33 @@ DocumentKey Reader::ReadDocumentKey() {
   return DocumentKey{};
 }
 
+LevelDbDocumentKeyView Reader::ReadDocumentKeyView() {
+  const char* begin = src_.data();
+  size_t segment_count = 0;
+  while (!empty()) {
+    leveldb::Slice saved_position = src_;
+    if (!ReadComponentLabelMatching(ComponentLabel::PathSegment)) {
+      src_ = saved_position;
+      break;
+    }
+
+    SkipString();
+    if (!ok_) break;
+
+    ++segment_count;
+  }
+
+  // Same validity checks as ReadDocumentKey.
+  if (ok_ && segment_count > 0 && segment_count % 2 == 0) {
+    absl::string_view encoded_path{
+        begin, static_cast<size_t>(src_.data() - begin)};
+    return LevelDbDocumentKeyView{encoded_path, segment_count};
+  }
+
+  Fail();
+  return LevelDbDocumentKeyView{};
+}
+
 model::SnapshotVersion Reader::ReadSnapshotVersion() {
   if (!ReadComponentLabelMatching(ComponentLabel::SnapshotVersion)) {
     Fail();
@@ -567,6 +704,28 @@ std::string Reader::Describe() {
       if (ok_) {
         absl::StrAppend(&description, " query_name=", query_name);
       }
+    } else if (label == ComponentLabel::IndexId) {
+      int32_t index_id = ReadIndexId();
+      if (ok_) {
+        absl::StrAppend(&description, " index_id=", index_id);
+      }
+    } else if (label == ComponentLabel::BlockId) {
+      int32_t block_id = ReadBlockId();
+      if (ok_) {
+        absl::StrAppend(&description, " block_id=", block_id);
+      }
+    } else if (label == ComponentLabel::CollectionNumber) {
+      int32_t collection_number = ReadCollectionNumber();
+      if (ok_) {
+        absl::StrAppend(&description,
+                        " collection_number=", collection_number);
+      }
+    } else if (label == ComponentLabel::IndexValues) {
+      std::string index_values = ReadIndexValues();
+      if (ok_) {
+        absl::StrAppend(&description,
+                        " index_values=", absl::CHexEscape(index_values));
+      }
     } else {
       absl::StrAppend(&description, " unknown label=", static_cast<int>(label));
       Fail();
@@ -638,6 +797,22 @@ class Writer {
     WriteLabeledString(ComponentLabel::QueryName, query_name);
   }
 
+  void WriteIndexId(int32_t index_id) {
+    WriteLabeledInt32(ComponentLabel::IndexId, index_id);
+  }
+
+  void WriteBlockId(int32_t block_id) {
+    WriteLabeledInt32(ComponentLabel::BlockId, block_id);
+  }
+
+  void WriteCollectionNumber(int32_t collection_number) {
+    WriteLabeledInt32(ComponentLabel::CollectionNumber, collection_number);
+  }
+
+  void WriteIndexValues(absl::string_view index_values) {
+    WriteLabeledString(ComponentLabel::IndexValues, index_values);
+  }
+
   /**
    * For each segment in the given resource path writes a
    * ComponentLabel::PathSegment component label and a string containing the
@@ -695,6 +870,27 @@ std::string DescribeKey(const char* key) {
   return DescribeKey(leveldb::Slice{key});
 }
 
+bool LevelDbDocumentKeyView::Equals(const DocumentKey& key) const {
+  const ResourcePath& path = key.path();
+  if (path.size() != segment_count_) return false;
+
+  absl::string_view src = encoded_path_;
+  for (const std::string& segment : path) {
+    // The labels were already checked when the view was decoded.
+    int64_t label = 0;
+    if (!OrderedCode::ReadSignedNumIncreasing(&src, &label) ||
+        !ReadStringMatching(&src, segment)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+DocumentKey LevelDbDocumentKeyView::ToDocumentKey() const {
+  Reader reader{encoded_path_};
+  return reader.ReadDocumentKey();
+}
+
 std::string LevelDbVersionKey::Key() {
   Writer writer;
   writer.WriteTableName(kVersionGlobalTable);
@@ -778,6 +974,78 @@ bool LevelDbDocumentMutationKey::Decode(absl::string_view key) {
   return reader.ok();
 }
 
+std::string LevelDbCollectionMutationKey::KeyPrefix() {
+  Writer writer;
+  writer.WriteTableName(kCollectionMutationsTable);
+  return writer.result();
+}
+
+std::string LevelDbCollectionMutationKey::KeyPrefix(
+    absl::string_view user_id) {
+  Writer writer;
+  writer.WriteTableName(kCollectionMutationsTable);
+  writer.WriteUserId(user_id);
+  return writer.result();
+}
+
+std::string LevelDbCollectionMutationKey::KeyPrefix(
+    absl::string_view user_id, const ResourcePath& collection_path) {
+  Writer writer;
+  writer.WriteTableName(kCollectionMutationsTable);
+  writer.WriteUserId(user_id);
+  writer.WriteResourcePath(collection_path);
+  return writer.result();
+}
+
+std::string LevelDbCollectionMutationKey::Key(
+    absl::string_view user_id,
+    const ResourcePath& collection_path,
+    model::BatchId batch_id) {
+  Writer writer;
+  writer.WriteTableName(kCollectionMutationsTable);
+  writer.WriteUserId(user_id);
+  writer.WriteResourcePath(collection_path);
+  writer.WriteBatchId(batch_id);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbCollectionMutationKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kCollectionMutationsTable);
+  user_id_ = reader.ReadUserId();
+  collection_path_ = reader.ReadResourcePath();
+  batch_id_ = reader.ReadBatchId();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbDocumentOverlayKey::KeyPrefix(absl::string_view user_id) {
+  Writer writer;
+  writer.WriteTableName(kDocumentOverlaysTable);
+  writer.WriteUserId(user_id);
+  return writer.result();
+}
+
+std::string LevelDbDocumentOverlayKey::Key(absl::string_view user_id,
+                                           const DocumentKey& document_key) {
+  Writer writer;
+  writer.WriteTableName(kDocumentOverlaysTable);
+  writer.WriteUserId(user_id);
+  writer.WriteResourcePath(document_key.path());
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbDocumentOverlayKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kDocumentOverlaysTable);
+  user_id_ = reader.ReadUserId();
+  document_key_ = reader.ReadDocumentKey();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
 std::string LevelDbMutationQueueKey::KeyPrefix() {
   Writer writer;
   writer.WriteTableName(kMutationQueuesTable);
@@ -836,6 +1104,28 @@ bool LevelDbTargetKey::Decode(leveldb::Slice key) {
   return reader.ok();
 }
 
+std::string LevelDbTargetStateKey::KeyPrefix() {
+  Writer writer;
+  writer.WriteTableName(kTargetStatesTable);
+  return writer.result();
+}
+
+std::string LevelDbTargetStateKey::Key(model::TargetId target_id) {
+  Writer writer;
+  writer.WriteTableName(kTargetStatesTable);
+  writer.WriteTargetId(target_id);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbTargetStateKey::Decode(leveldb::Slice key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kTargetStatesTable);
+  target_id_ = reader.ReadTargetId();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
 std::string LevelDbQueryTargetKey::KeyPrefix() {
   Writer writer;
   writer.WriteTableName(kQueryTargetsTable);
@@ -900,6 +1190,99 @@ bool LevelDbTargetDocumentKey::Decode(absl::string_view key) {
   return reader.ok();
 }
 
+constexpr int32_t LevelDbTargetDocumentBlockKey::kBlockCount;
+
+std::string LevelDbTargetDocumentBlockKey::KeyPrefix() {
+  Writer writer;
+  writer.WriteTableName(kTargetDocumentBlocksTable);
+  return writer.result();
+}
+
+std::string LevelDbTargetDocumentBlockKey::KeyPrefix(
+    model::TargetId target_id) {
+  Writer writer;
+  writer.WriteTableName(kTargetDocumentBlocksTable);
+  writer.WriteTargetId(target_id);
+  return writer.result();
+}
+
+std::string LevelDbTargetDocumentBlockKey::Key(model::TargetId target_id,
+                                               int32_t block_id) {
+  Writer writer;
+  writer.WriteTableName(kTargetDocumentBlocksTable);
+  writer.WriteTargetId(target_id);
+  writer.WriteBlockId(block_id);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+int32_t LevelDbTargetDocumentBlockKey::BlockIdFor(
+    const DocumentKey& document_key) {
+  // 32-bit FNV-1a over the path, since the assignment is persisted and must
+  // not depend on the platform's std::hash.
+  uint32_t hash = 2166136261u;
+  for (const std::string& segment : document_key.path()) {
+    for (char c : segment) {
+      hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    hash = (hash ^ static_cast<uint8_t>('/')) * 16777619u;
+  }
+  return static_cast<int32_t>(hash % static_cast<uint32_t>(kBlockCount));
+}
+
+bool LevelDbTargetDocumentBlockKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kTargetDocumentBlocksTable);
+  target_id_ = reader.ReadTargetId();
+  block_id_ = reader.ReadBlockId();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbTargetDocumentBlockKey::EncodeValue(
+    const std::vector<DocumentKey>& document_keys) {
+  std::string encoded;
+  std::string previous;
+  for (const DocumentKey& document_key : document_keys) {
+    std::string path = document_key.path().CanonicalString();
+    size_t shared = 0;
+    while (shared < previous.size() && shared < path.size() &&
+           previous[shared] == path[shared]) {
+      ++shared;
+    }
+    OrderedCode::WriteNumIncreasing(&encoded, shared);
+    OrderedCode::WriteString(&encoded, absl::string_view(path).substr(shared));
+    previous = std::move(path);
+  }
+  return encoded;
+}
+
+bool LevelDbTargetDocumentBlockKey::DecodeValue(
+    absl::string_view value, std::vector<DocumentKey>* document_keys) {
+  document_keys->clear();
+  std::string path;
+  while (!value.empty()) {
+    uint64_t shared = 0;
+    std::string suffix;
+    if (!OrderedCode::ReadNumIncreasing(&value, &shared) ||
+        shared > path.size() || !OrderedCode::ReadString(&value, &suffix)) {
+      return false;
+    }
+    path.resize(shared);
+    path += suffix;
+    if (path.find("//") != std::string::npos) {
+      return false;
+    }
+
+    ResourcePath resource_path = ResourcePath::FromString(path);
+    if (!DocumentKey::IsDocumentKey(resource_path)) {
+      return false;
+    }
+    document_keys->emplace_back(std::move(resource_path));
+  }
+  return true;
+}
+
 std::string LevelDbDocumentTargetKey::KeyPrefix() {
   Writer writer;
   writer.WriteTableName(kDocumentTargetsTable);
@@ -954,6 +1337,15 @@ bool LevelDbDocumentTargetKey::Decode(absl::string_view key) {
   return reader.ok();
 }
 
+bool LevelDbDocumentTargetKeyView::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kDocumentTargetsTable);
+  document_key_ = reader.ReadDocumentKeyView();
+  target_id_ = reader.ReadTargetId();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
 std::string LevelDbRemoteDocumentKey::KeyPrefix() {
   Writer writer;
   writer.WriteTableName(kRemoteDocumentsTable);
@@ -984,6 +1376,102 @@ bool LevelDbRemoteDocumentKey::Decode(absl::string_view key) {
   return reader.ok();
 }
 
+bool LevelDbRemoteDocumentKeyView::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kRemoteDocumentsTable);
+  document_key_ = reader.ReadDocumentKeyView();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbCollectionDictionaryKey::KeyPrefix() {
+  Writer writer;
+  writer.WriteTableName(kCollectionDictionaryTable);
+  return writer.result();
+}
+
+std::string LevelDbCollectionDictionaryKey::Key(
+    const ResourcePath& collection_path) {
+  Writer writer;
+  writer.WriteTableName(kCollectionDictionaryTable);
+  writer.WriteResourcePath(collection_path);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbCollectionDictionaryKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kCollectionDictionaryTable);
+  collection_path_ = reader.ReadResourcePath();
+  reader.ReadTerminator();
+  return reader.ok() && collection_path_.size() % 2 == 1;
+}
+
+std::string LevelDbCollectionDictionaryKey::EncodeValue(
+    int32_t collection_number) {
+  std::string encoded;
+  OrderedCode::WriteSignedNumIncreasing(&encoded, collection_number);
+  return encoded;
+}
+
+bool LevelDbCollectionDictionaryKey::DecodeValue(absl::string_view value,
+                                                 int32_t* collection_number) {
+  int64_t decoded = 0;
+  if (!OrderedCode::ReadSignedNumIncreasing(&value, &decoded) ||
+      !value.empty() || decoded < 0 || decoded > INT32_MAX) {
+    return false;
+  }
+  *collection_number = static_cast<int32_t>(decoded);
+  return true;
+}
+
+std::string LevelDbCollectionDictionaryGlobalKey::Key() {
+  Writer writer;
+  writer.WriteTableName(kCollectionDictionaryGlobalTable);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbCollectionDictionaryGlobalKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kCollectionDictionaryGlobalTable);
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbCollectionDocumentKey::KeyPrefix() {
+  Writer writer;
+  writer.WriteTableName(kCollectionDocumentsTable);
+  return writer.result();
+}
+
+std::string LevelDbCollectionDocumentKey::KeyPrefix(
+    int32_t collection_number) {
+  Writer writer;
+  writer.WriteTableName(kCollectionDocumentsTable);
+  writer.WriteCollectionNumber(collection_number);
+  return writer.result();
+}
+
+std::string LevelDbCollectionDocumentKey::Key(int32_t collection_number,
+                                              absl::string_view document_id) {
+  Writer writer;
+  writer.WriteTableName(kCollectionDocumentsTable);
+  writer.WriteCollectionNumber(collection_number);
+  writer.WriteDocumentId(document_id);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbCollectionDocumentKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kCollectionDocumentsTable);
+  collection_number_ = reader.ReadCollectionNumber();
+  document_id_ = reader.ReadDocumentId();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
 std::string LevelDbCollectionParentKey::KeyPrefix() {
   Writer writer;
   writer.WriteTableName(kCollectionParentsTable);
@@ -1094,6 +1582,176 @@ bool LevelDbNamedQueryKey::Decode(absl::string_view key) {
   return reader.ok();
 }
 
+std::string LevelDbFieldIndexKey::KeyPrefix() {
+  Writer writer;
+  writer.WriteTableName(kFieldIndexesTable);
+  return writer.result();
+}
+
+std::string LevelDbFieldIndexKey::Key(int32_t index_id) {
+  Writer writer;
+  writer.WriteTableName(kFieldIndexesTable);
+  writer.WriteIndexId(index_id);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbFieldIndexKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kFieldIndexesTable);
+  index_id_ = reader.ReadIndexId();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbIndexEntryKey::KeyPrefix(int32_t index_id) {
+  Writer writer;
+  writer.WriteTableName(kIndexEntriesTable);
+  writer.WriteIndexId(index_id);
+  return writer.result();
+}
+
+std::string LevelDbIndexEntryKey::KeyPrefix(int32_t index_id,
+                                            absl::string_view index_values) {
+  Writer writer;
+  writer.WriteTableName(kIndexEntriesTable);
+  writer.WriteIndexId(index_id);
+  writer.WriteIndexValues(index_values);
+  return writer.result();
+}
+
+std::string LevelDbIndexEntryKey::Key(int32_t index_id,
+                                      absl::string_view index_values,
+                                      const DocumentKey& document_key) {
+  Writer writer;
+  writer.WriteTableName(kIndexEntriesTable);
+  writer.WriteIndexId(index_id);
+  writer.WriteIndexValues(index_values);
+  writer.WriteResourcePath(document_key.path());
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbIndexEntryKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kIndexEntriesTable);
+  index_id_ = reader.ReadIndexId();
+  index_values_ = reader.ReadIndexValues();
+  document_key_ = reader.ReadDocumentKey();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbIndexDocumentKey::KeyPrefix(int32_t index_id) {
+  Writer writer;
+  writer.WriteTableName(kIndexDocumentsTable);
+  writer.WriteIndexId(index_id);
+  return writer.result();
+}
+
+std::string LevelDbIndexDocumentKey::Key(int32_t index_id,
+                                         const DocumentKey& document_key) {
+  Writer writer;
+  writer.WriteTableName(kIndexDocumentsTable);
+  writer.WriteIndexId(index_id);
+  writer.WriteResourcePath(document_key.path());
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbIndexDocumentKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kIndexDocumentsTable);
+  index_id_ = reader.ReadIndexId();
+  document_key_ = reader.ReadDocumentKey();
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbSizeCountersKey::Key() {
+  Writer writer;
+  writer.WriteTableName(kSizeCountersTable);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbSizeCountersKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kSizeCountersTable);
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbSizeCountersKey::EncodeValue(
+    const std::vector<int64_t>& byte_sizes) {
+  std::string encoded;
+  for (int64_t byte_size : byte_sizes) {
+    OrderedCode::WriteSignedNumIncreasing(&encoded, byte_size);
+  }
+  return encoded;
+}
+
+bool LevelDbSizeCountersKey::DecodeValue(absl::string_view value,
+                                         std::vector<int64_t>* byte_sizes) {
+  byte_sizes->clear();
+  while (!value.empty()) {
+    int64_t byte_size = 0;
+    if (!OrderedCode::ReadSignedNumIncreasing(&value, &byte_size)) {
+      return false;
+    }
+    byte_sizes->push_back(byte_size);
+  }
+  return true;
+}
+
+std::string LevelDbSequenceNumberHistogramKey::Key() {
+  Writer writer;
+  writer.WriteTableName(kSequenceNumberHistogramTable);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbSequenceNumberHistogramKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kSequenceNumberHistogramTable);
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbMigrationCursorKey::Key() {
+  Writer writer;
+  writer.WriteTableName(kMigrationCursorTable);
+  writer.WriteTerminator();
+  return writer.result();
+}
+
+bool LevelDbMigrationCursorKey::Decode(absl::string_view key) {
+  Reader reader{key};
+  reader.ReadTableNameMatching(kMigrationCursorTable);
+  reader.ReadTerminator();
+  return reader.ok();
+}
+
+std::string LevelDbMigrationCursorKey::EncodeValue(int32_t version,
+                                                   absl::string_view last_key) {
+  std::string encoded;
+  OrderedCode::WriteSignedNumIncreasing(&encoded, version);
+  OrderedCode::WriteString(&encoded, last_key);
+  return encoded;
+}
+
+bool LevelDbMigrationCursorKey::DecodeValue(absl::string_view value,
+                                            int32_t* version,
+                                            std::string* last_key) {
+  int64_t decoded_version = 0;
+  if (!OrderedCode::ReadSignedNumIncreasing(&value, &decoded_version) ||
+      !OrderedCode::ReadString(&value, last_key) || !value.empty()) {
+    return false;
+  }
+  *version = static_cast<int32_t>(decoded_version);
+  return true;
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
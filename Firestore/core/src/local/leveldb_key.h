@@ -17,7 +17,10 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_LEVELDB_KEY_H_
 #define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_KEY_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/mutation_batch.h"
@@ -75,10 +78,22 @@ namespace local {
 //   - path: ResourcePath
 //   - target_id: model::TargetId
 //
-// remote_documents:
+// remote_documents (legacy, see migration 10):
 //   - table_name: string = "remote_document"
 //   - path: ResourcePath
 //
+// collection_dictionary:
+//   - table_name: string = "collection_dictionary"
+//   - collection: ResourcePath
+//
+// collection_dictionary_global:
+//   - table_name: string = "collection_dictionary_global"
+//
+// collection_documents:
+//   - table_name: string = "collection_document"
+//   - collection_number: int32_t
+//   - document_id: string
+//
 // collection_parents:
 //   - table_name: string = "collection_parent"
 //   - collectionId: string
@@ -97,6 +112,21 @@ namespace local {
 // named_queries:
 //   - table_name: string = "named_queries"
 //   - name: string
+//
+// field_indexes:
+//   - table_name: string = "field_index"
+//   - index_id: int32_t
+//
+// index_entries:
+//   - table_name: string = "index_entry"
+//   - index_id: int32_t
+//   - index_values: string
+//   - path: ResourcePath
+//
+// index_documents:
+//   - table_name: string = "index_document"
+//   - index_id: int32_t
+//   - path: ResourcePath
 
 /**
  * Parses the given key and returns a human readable description of its
@@ -228,6 +258,115 @@ class LevelDbDocumentMutationKey {
   model::BatchId batch_id_ = model::kBatchIdUnknown;
 };
 
+/**
+ * A key in the collection mutations index, which stores the batches in which
+ * documents in each collection are mutated. Rows for a collection sort before
+ * the rows for its subcollections.
+ */
+class LevelDbCollectionMutationKey {
+ public:
+  /**
+   * Creates a key prefix that points just before the first key in the table.
+   */
+  static std::string KeyPrefix();
+
+  /**
+   * Creates a key prefix that points just before the first key for the given
+   * user_id.
+   */
+  static std::string KeyPrefix(absl::string_view user_id);
+
+  /**
+   * Creates a key prefix that points just before the first key for the user_id
+   * and collection path. Keys with this prefix also include the rows of
+   * subcollections, since they follow the rows of the collection itself.
+   */
+  static std::string KeyPrefix(absl::string_view user_id,
+                               const model::ResourcePath& collection_path);
+
+  /**
+   * Creates a complete key that points to a specific user_id, collection path,
+   * and batch_id.
+   */
+  static std::string Key(absl::string_view user_id,
+                         const model::ResourcePath& collection_path,
+                         model::BatchId batch_id);
+
+  /**
+   * Decodes the given complete key, storing the decoded values in this
+   * instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** The user that owns the mutation batches. */
+  const std::string& user_id() const {
+    return user_id_;
+  }
+
+  /** The path to the collection, as encoded in the key. */
+  const model::ResourcePath& collection_path() const {
+    return collection_path_;
+  }
+
+  /** The batch_id that mutates documents in the collection. */
+  model::BatchId batch_id() const {
+    return batch_id_;
+  }
+
+ private:
+  std::string user_id_;
+  model::ResourcePath collection_path_;
+  model::BatchId batch_id_ = model::kBatchIdUnknown;
+};
+
+/**
+ * A key in the document_overlays table, which caches the local view of
+ * documents mutated by several of a user's pending batches. The row value is
+ * encoded by `LevelDbDocumentOverlayCache`.
+ */
+class LevelDbDocumentOverlayKey {
+ public:
+  /**
+   * Creates a key prefix that points just before the first key for the given
+   * user_id.
+   */
+  static std::string KeyPrefix(absl::string_view user_id);
+
+  /** Creates a complete key that points to a specific user and document. */
+  static std::string Key(absl::string_view user_id,
+                         const model::DocumentKey& document_key);
+
+  /**
+   * Decodes the given complete key, storing the decoded values in this
+   * instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** The user whose mutations are applied in the overlay. */
+  const std::string& user_id() const {
+    return user_id_;
+  }
+
+  /** The path to the document, as encoded in the key. */
+  const model::DocumentKey& document_key() const {
+    return document_key_;
+  }
+
+ private:
+  std::string user_id_;
+  model::DocumentKey document_key_;
+};
+
 /**
  * A key in the mutation_queues table.
  *
@@ -314,6 +453,42 @@ class LevelDbTargetKey {
   model::TargetId target_id_ = 0;
 };
 
+/**
+ * A key in the target_state table, which holds the parts of each target that
+ * change while it's listened to: its sequence number, snapshot versions and
+ * resume token. The row, if present, overrides those fields of the target's
+ * row in the targets table, so that updating a target doesn't rewrite its
+ * query.
+ */
+class LevelDbTargetStateKey {
+ public:
+  /**
+   * Creates a key prefix that points just before the first key in the table.
+   */
+  static std::string KeyPrefix();
+
+  /** Creates a complete key that points to the state of a specific target. */
+  static std::string Key(model::TargetId target_id);
+
+  /**
+   * Decodes the contents of a target state key, storing the decoded values in
+   * this instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(leveldb::Slice key);
+
+  model::TargetId target_id() {
+    return target_id_;
+  }
+
+ private:
+  model::TargetId target_id_ = 0;
+};
+
 /**
  * A key in the query targets table, an index of canonical_ids to the targets
  * they may match. This is not a unique mapping because canonical_id does not
@@ -413,6 +588,122 @@ class LevelDbTargetDocumentKey {
   model::DocumentKey document_key_;
 };
 
+/**
+ * A key in the target document blocks table, which stores the documents that
+ * match each target in a fixed number of blocks. Documents are assigned to
+ * blocks by a hash of their key, so that a small change to a large target only
+ * rewrites the blocks of the changed documents.
+ *
+ * The row value is the sorted list of document keys in the block, with each
+ * key encoded as the length of the prefix it shares with the previous key
+ * followed by the remainder of its path.
+ */
+class LevelDbTargetDocumentBlockKey {
+ public:
+  /** The number of blocks a target's documents are spread over. */
+  static constexpr int32_t kBlockCount = 64;
+
+  /**
+   * Creates a key that contains just the target document blocks table prefix
+   * and points just before the first key.
+   */
+  static std::string KeyPrefix();
+
+  /** Creates a key that points to the first block of a target_id. */
+  static std::string KeyPrefix(model::TargetId target_id);
+
+  /** Creates a key that points to a specific block of a target. */
+  static std::string Key(model::TargetId target_id, int32_t block_id);
+
+  /** Returns the ID of the block that holds the given document. */
+  static int32_t BlockIdFor(const model::DocumentKey& document_key);
+
+  /**
+   * Decodes the contents of a target document block key, storing the decoded
+   * values in this instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** Encodes the given sorted document keys as a block row value. */
+  static std::string EncodeValue(
+      const std::vector<model::DocumentKey>& document_keys);
+
+  /**
+   * Decodes a block row value into `document_keys`, in sorted order.
+   *
+   * @return true if the value successfully decoded, false otherwise.
+   */
+  ABSL_MUST_USE_RESULT
+  static bool DecodeValue(absl::string_view value,
+                          std::vector<model::DocumentKey>* document_keys);
+
+  /** The target_id identifying a target. */
+  model::TargetId target_id() const {
+    return target_id_;
+  }
+
+  /** The ID of the block within the target. */
+  int32_t block_id() const {
+    return block_id_;
+  }
+
+ private:
+  model::TargetId target_id_ = 0;
+  int32_t block_id_ = 0;
+};
+
+/**
+ * A non-owning view of a document key encoded in a LevelDB key, as decoded by
+ * the `...KeyView` classes below. The path segments stay encoded, so decoding
+ * a key doesn't allocate, and comparing the view to a `DocumentKey` only
+ * compares bytes.
+ *
+ * The view refers to the bytes of the LevelDB key it was decoded from, which
+ * must outlive it.
+ */
+class LevelDbDocumentKeyView {
+ public:
+  LevelDbDocumentKeyView() = default;
+
+  /**
+   * Creates a view of the given encoded path segments, which must hold
+   * `segment_count` components, each a path segment label and string.
+   */
+  LevelDbDocumentKeyView(absl::string_view encoded_path, size_t segment_count)
+      : encoded_path_(encoded_path), segment_count_(segment_count) {
+  }
+
+  /** The number of segments in the path of the document key. */
+  size_t segment_count() const {
+    return segment_count_;
+  }
+
+  /** Returns true if the view refers to the given document key. */
+  bool Equals(const model::DocumentKey& key) const;
+
+  /** Decodes the document key, allocating its path segments. */
+  model::DocumentKey ToDocumentKey() const;
+
+ private:
+  absl::string_view encoded_path_;
+  size_t segment_count_ = 0;
+};
+
+inline bool operator==(const LevelDbDocumentKeyView& lhs,
+                       const model::DocumentKey& rhs) {
+  return lhs.Equals(rhs);
+}
+
+inline bool operator!=(const LevelDbDocumentKeyView& lhs,
+                       const model::DocumentKey& rhs) {
+  return !lhs.Equals(rhs);
+}
+
 /**
  * A key in the document targets table, an index from documents to the targets
  * that contain them.
@@ -492,7 +783,53 @@ class LevelDbDocumentTargetKey {
   model::DocumentKey document_key_;
 };
 
-/** A key in the remote documents table. */
+/**
+ * Like `LevelDbDocumentTargetKey`, but decodes the document key into a
+ * `LevelDbDocumentKeyView` instead of allocating a copy of its path.
+ */
+class LevelDbDocumentTargetKeyView {
+ public:
+  /**
+   * Decodes a document target key into this instance, which refers to `key`
+   * until the next call to `Decode()`.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** The target_id identifying a target. */
+  model::TargetId target_id() const {
+    return target_id_;
+  }
+
+  /**
+   * Returns true if the target_id in this row is a sentintel target ID.
+   */
+  bool IsSentinel() const {
+    // Sentinel rows use the invalid target ID 0, as in
+    // `LevelDbDocumentTargetKey`.
+    return target_id_ == 0;
+  }
+
+  /** The path to the document, as encoded in the key. */
+  const LevelDbDocumentKeyView& document_key() const {
+    return document_key_;
+  }
+
+ private:
+  // Deliberately uninitialized: will be assigned in Decode
+  model::TargetId target_id_;
+  LevelDbDocumentKeyView document_key_;
+};
+
+/**
+ * A key in the legacy remote documents table, which repeats the full document
+ * path in every key. Migration 10 moves these rows into the collection
+ * documents table; only migrations still read them.
+ */
 class LevelDbRemoteDocumentKey {
  public:
   /**
@@ -538,6 +875,149 @@ class LevelDbRemoteDocumentKey {
   model::DocumentKey document_key_;
 };
 
+/**
+ * Like `LevelDbRemoteDocumentKey`, but decodes the document key into a
+ * `LevelDbDocumentKeyView` instead of allocating a copy of its path.
+ */
+class LevelDbRemoteDocumentKeyView {
+ public:
+  /**
+   * Decodes a complete remote document key into this instance, which refers to
+   * `key` until the next call to `Decode()`.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** The path to the document, as encoded in the key. */
+  const LevelDbDocumentKeyView& document_key() const {
+    return document_key_;
+  }
+
+ private:
+  LevelDbDocumentKeyView document_key_;
+};
+
+/**
+ * A key in the collection dictionary, which assigns a compact number to each
+ * collection path that has documents in the collection documents table. The
+ * row value is the encoded collection number. Numbers are never reused, and a
+ * collection keeps its number once all of its documents are removed.
+ */
+class LevelDbCollectionDictionaryKey {
+ public:
+  /**
+   * Creates a key that contains just the collection dictionary table prefix
+   * and points just before the first key.
+   */
+  static std::string KeyPrefix();
+
+  /** Creates a complete key that points to the number of a collection. */
+  static std::string Key(const model::ResourcePath& collection_path);
+
+  /**
+   * Decodes the contents of a collection dictionary key, storing the decoded
+   * values in this instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** Encodes the given collection number as a row value. */
+  static std::string EncodeValue(int32_t collection_number);
+
+  /**
+   * Decodes a row value into `collection_number`.
+   *
+   * @return true if the value successfully decoded, false otherwise.
+   */
+  ABSL_MUST_USE_RESULT
+  static bool DecodeValue(absl::string_view value, int32_t* collection_number);
+
+  /** The path of the collection, as encoded in the key. */
+  const model::ResourcePath& collection_path() const {
+    return collection_path_;
+  }
+
+ private:
+  model::ResourcePath collection_path_;
+};
+
+/**
+ * A key in the collection_dictionary_global table, the single row holding the
+ * next collection number to assign. The row value is encoded like the values
+ * of `LevelDbCollectionDictionaryKey`.
+ */
+class LevelDbCollectionDictionaryGlobalKey {
+ public:
+  /** Creates a key that points to the single collection dictionary row. */
+  static std::string Key();
+
+  /**
+   * Decodes the contents of a collection dictionary global key, essentially
+   * just verifying that the key has the correct table name.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+};
+
+/**
+ * A key in the collection documents table, which stores the cached remote
+ * documents. Documents are keyed by the number the collection dictionary
+ * assigned to their collection and their document ID, so keys don't repeat the
+ * collection path, and the documents of a collection, without those of its
+ * subcollections, make up a contiguous range of keys in document key order.
+ */
+class LevelDbCollectionDocumentKey {
+ public:
+  /**
+   * Creates a key that contains just the collection documents table prefix and
+   * points just before the first key.
+   */
+  static std::string KeyPrefix();
+
+  /**
+   * Creates a key prefix that points just before the first document of a
+   * collection.
+   */
+  static std::string KeyPrefix(int32_t collection_number);
+
+  /** Creates a complete key that points to a specific document. */
+  static std::string Key(int32_t collection_number,
+                         absl::string_view document_id);
+
+  /**
+   * Decodes the contents of a collection document key, storing the decoded
+   * values in this instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** The number of the document's collection, as encoded in the key. */
+  int32_t collection_number() const {
+    return collection_number_;
+  }
+
+  /** The ID of the document within its collection, as encoded in the key. */
+  const std::string& document_id() const {
+    return document_id_;
+  }
+
+ private:
+  int32_t collection_number_ = 0;
+  std::string document_id_;
+};
+
 /**
  * A key in the collection parents index, which stores an association between a
  * Collection ID (e.g. 'messages') to a parent path (e.g. '/chats/123') that
@@ -713,6 +1193,222 @@ class LevelDbNamedQueryKey {
   std::string name_;
 };
 
+/**
+ * A key in the field_index table, storing the configuration of each field
+ * index. The row value is the encoded collection group and field paths.
+ */
+class LevelDbFieldIndexKey {
+ public:
+  /**
+   * Creates a key prefix that points just before the first key of the table.
+   */
+  static std::string KeyPrefix();
+
+  /** Creates a key that points to the configuration of the given index. */
+  static std::string Key(int32_t index_id);
+
+  /**
+   * Decodes the given complete key, storing the decoded values in this
+   * instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** The index ID for this entry. */
+  int32_t index_id() const {
+    return index_id_;
+  }
+
+ private:
+  int32_t index_id_ = 0;
+};
+
+/**
+ * A key in the index_entry table, an index of documents ordered by the values
+ * of the indexed fields. `index_values` is the concatenation of the
+ * order-preserving encodings of each indexed field (see
+ * index_value_writer.h), so that scanning a range of keys returns the
+ * documents whose values fall in the corresponding range.
+ */
+class LevelDbIndexEntryKey {
+ public:
+  /**
+   * Creates a key prefix that points just before the first entry of the given
+   * index.
+   */
+  static std::string KeyPrefix(int32_t index_id);
+
+  /**
+   * Creates a key prefix that points just before the first entry of the given
+   * index whose index_values are greater than or equal to `index_values`.
+   */
+  static std::string KeyPrefix(int32_t index_id,
+                               absl::string_view index_values);
+
+  /** Creates a key that points to a specific index entry. */
+  static std::string Key(int32_t index_id,
+                         absl::string_view index_values,
+                         const model::DocumentKey& document_key);
+
+  /**
+   * Decodes the given complete key, storing the decoded values in this
+   * instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** The index ID for this entry. */
+  int32_t index_id() const {
+    return index_id_;
+  }
+
+  /** The encoded values of the indexed fields. */
+  const std::string& index_values() const {
+    return index_values_;
+  }
+
+  /** The document this entry points to. */
+  const model::DocumentKey& document_key() const {
+    return document_key_;
+  }
+
+ private:
+  int32_t index_id_ = 0;
+  std::string index_values_;
+  model::DocumentKey document_key_;
+};
+
+/**
+ * A key in the index_document table, the reverse of the index_entry table. The
+ * row value is the index_values of the document's current entry, which allows
+ * stale entries to be removed without decoding the previous version of the
+ * document.
+ */
+class LevelDbIndexDocumentKey {
+ public:
+  /**
+   * Creates a key prefix that points just before the first row of the given
+   * index.
+   */
+  static std::string KeyPrefix(int32_t index_id);
+
+  /** Creates a key that points to the row for a specific document. */
+  static std::string Key(int32_t index_id,
+                         const model::DocumentKey& document_key);
+
+  /**
+   * Decodes the given complete key, storing the decoded values in this
+   * instance.
+   *
+   * @return true if the key successfully decoded, false otherwise. If false is
+   * returned, this instance is in an undefined state until the next call to
+   * `Decode()`.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** The index ID for this entry. */
+  int32_t index_id() const {
+    return index_id_;
+  }
+
+  /** The path to the document, as encoded in the key. */
+  const model::DocumentKey& document_key() const {
+    return document_key_;
+  }
+
+ private:
+  int32_t index_id_ = 0;
+  model::DocumentKey document_key_;
+};
+
+/**
+ * A key in the size_counters table, the single row holding the byte sizes of
+ * the tables tracked by `LevelDbSizeCounters`.
+ */
+class LevelDbSizeCountersKey {
+ public:
+  /** Creates a key that points to the single size counters row. */
+  static std::string Key();
+
+  /**
+   * Decodes the contents of a size counters key, essentially just verifying
+   * that the key has the correct table name.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** Encodes the given byte sizes as a size counters row value. */
+  static std::string EncodeValue(const std::vector<int64_t>& byte_sizes);
+
+  /**
+   * Decodes a size counters row value into `byte_sizes`.
+   *
+   * @return true if the value successfully decoded, false otherwise.
+   */
+  ABSL_MUST_USE_RESULT
+  static bool DecodeValue(absl::string_view value,
+                          std::vector<int64_t>* byte_sizes);
+};
+
+/**
+ * A key in the sequence_number_histogram table, the single row holding the
+ * distribution of orphaned document sequence numbers recorded by the last LRU
+ * garbage collection. The row value is an encoded `SequenceNumberHistogram`.
+ */
+class LevelDbSequenceNumberHistogramKey {
+ public:
+  /** Creates a key that points to the single histogram row. */
+  static std::string Key();
+
+  /**
+   * Decodes the contents of a histogram key, essentially just verifying that
+   * the key has the correct table name.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+};
+
+/**
+ * A key in the migration_cursor table, the single row recording the progress
+ * of a schema migration that runs in batches. The row value holds the version
+ * of the migration and the last key it processed, so that an interrupted
+ * migration resumes after that key instead of starting over.
+ */
+class LevelDbMigrationCursorKey {
+ public:
+  /** Creates a key that points to the single migration cursor row. */
+  static std::string Key();
+
+  /**
+   * Decodes the contents of a migration cursor key, essentially just verifying
+   * that the key has the correct table name.
+   */
+  ABSL_MUST_USE_RESULT
+  bool Decode(absl::string_view key);
+
+  /** Encodes a migration cursor row value. */
+  static std::string EncodeValue(int32_t version, absl::string_view last_key);
+
+  /**
+   * Decodes a migration cursor row value into `version` and `last_key`.
+   *
+   * @return true if the value successfully decoded, false otherwise.
+   */
+  ABSL_MUST_USE_RESULT
+  static bool DecodeValue(absl::string_view value,
+                          int32_t* version,
+                          std::string* last_key);
+};
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
@@ -16,9 +16,12 @@
 
 #include "Firestore/core/src/local/leveldb_lru_reference_delegate.h"
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <initializer_list>
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/local/leveldb_key.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
@@ -28,8 +31,10 @@
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/model/types.h"
 #include "Firestore/core/src/util/statusor.h"
+#include "Firestore/core/src/util/string_util.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/match.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
@@ -37,9 +42,18 @@ namespace local {
 
 using model::DocumentKey;
 using model::ListenSequenceNumber;
-using model::ResourcePath;
 using util::StatusOr;
 
+namespace {
+
+/**
+ * The number of orphaned documents that are checked for pins together while
+ * removing them.
+ */
+const size_t kPinCheckBatchSize = 100;
+
+}  // namespace
+
 LevelDbLruReferenceDelegate::LevelDbLruReferenceDelegate(
     LevelDbPersistence* persistence, LruParams lru_params)
     : db_(persistence) {
@@ -85,6 +99,10 @@ void LevelDbLruReferenceDelegate::UpdateLimboDocument(const DocumentKey& key) {
   WriteSentinel(key);
 }
 
+void LevelDbLruReferenceDelegate::RecordDocumentAccess(const DocumentKey& key) {
+  access_log_.Record(key);
+}
+
 ListenSequenceNumber LevelDbLruReferenceDelegate::current_sequence_number()
     const {
   HARD_ASSERT(current_sequence_number_ != kListenSequenceNumberInvalid,
@@ -99,6 +117,7 @@ void LevelDbLruReferenceDelegate::OnTransactionStarted(absl::string_view) {
 }
 
 void LevelDbLruReferenceDelegate::OnTransactionCommitted() {
+  FlushSentinels();
   current_sequence_number_ = kListenSequenceNumberInvalid;
 }
 
@@ -107,7 +126,10 @@ LruGarbageCollector* LevelDbLruReferenceDelegate::garbage_collector() {
 }
 
 StatusOr<int64_t> LevelDbLruReferenceDelegate::CalculateByteSize() {
-  return db_->CalculateByteSize();
+  // The counters leave out LevelDB's own overhead and the space of deleted
+  // rows that hasn't been compacted yet, but unlike the size on disk they are
+  // known without touching the filesystem.
+  return db_->size_counters()->total_byte_size();
 }
 
 size_t LevelDbLruReferenceDelegate::GetSequenceNumberCount() {
@@ -129,64 +151,202 @@ void LevelDbLruReferenceDelegate::EnumerateOrphanedDocuments(
   db_->target_cache()->EnumerateOrphanedDocuments(callback);
 }
 
+void LevelDbLruReferenceDelegate::FlushDocumentAccesses() {
+  std::set<DocumentKey> accessed = access_log_.Take();
+  if (accessed.empty()) return;
+
+  // Write the sentinels right away rather than on commit, so that the rest of
+  // the collection sees the new sequence numbers.
+  for (const DocumentKey& key : accessed) {
+    WriteSentinel(key);
+  }
+  FlushSentinels();
+}
+
 int LevelDbLruReferenceDelegate::RemoveOrphanedDocuments(
     ListenSequenceNumber upper_bound) {
+  absl::optional<DocumentKey> cursor;
+  return RemoveOrphanedDocumentsUntil(
+      upper_bound, std::chrono::steady_clock::time_point::max(), &cursor,
+      /* retained= */ nullptr);
+}
+
+int LevelDbLruReferenceDelegate::RemoveOrphanedDocumentsUntil(
+    ListenSequenceNumber upper_bound,
+    std::chrono::steady_clock::time_point deadline,
+    absl::optional<DocumentKey>* cursor,
+    SequenceNumberHistogram* retained) {
   int count = 0;
-  db_->target_cache()->EnumerateOrphanedDocuments(
+  absl::optional<DocumentKey> first_removed;
+  absl::optional<DocumentKey> last_removed;
+  // Documents are stored by collection number, so the rows of the removed
+  // documents aren't necessarily in the order of their keys.
+  absl::optional<std::string> lowest_removed_row;
+  absl::optional<std::string> highest_removed_row;
+
+  // Candidates for removal are collected in key order and checked for pins in
+  // batches, so that each batch takes a single pass over the mutation index.
+  std::vector<DocumentKey> candidates;
+  std::vector<ListenSequenceNumber> candidate_sequence_numbers;
+  auto remove_unpinned = [&] {
+    std::vector<bool> pinned = FindPinned(candidates);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      const DocumentKey& key = candidates[i];
+      if (pinned[i]) {
+        if (retained) retained->Add(candidate_sequence_numbers[i]);
+        continue;
+      }
+
+      count++;
+      absl::optional<std::string> row_key =
+          db_->remote_document_cache()->DocumentRowKey(key);
+      if (row_key) {
+        if (!lowest_removed_row || *row_key < *lowest_removed_row) {
+          lowest_removed_row = *row_key;
+        }
+        if (!highest_removed_row || *row_key > *highest_removed_row) {
+          highest_removed_row = *row_key;
+        }
+      }
+      db_->remote_document_cache()->Remove(key);
+      RemoveSentinel(key);
+      if (!first_removed) first_removed = key;
+      last_removed = key;
+    }
+    candidates.clear();
+    candidate_sequence_numbers.clear();
+  };
+
+  absl::optional<DocumentKey> start_after = std::move(*cursor);
+  *cursor = absl::nullopt;
+  db_->target_cache()->EnumerateOrphanedDocumentsAfter(
+      start_after,
       [&](const DocumentKey& key, ListenSequenceNumber sequence_number) {
         if (sequence_number <= upper_bound) {
-          if (!IsPinned(key)) {
-            count++;
-            db_->remote_document_cache()->Remove(key);
-            RemoveSentinel(key);
-          }
+          candidates.push_back(key);
+          candidate_sequence_numbers.push_back(sequence_number);
+          if (candidates.size() == kPinCheckBatchSize) remove_unpinned();
+        } else if (retained) {
+          retained->Add(sequence_number);
         }
+
+        if (std::chrono::steady_clock::now() >= deadline) {
+          *cursor = key;
+          return false;
+        }
+        return true;
       });
+  remove_unpinned();
+
+  if (lowest_removed_row) {
+    db_->CompactRangeAfterCommit(std::move(*lowest_removed_row),
+                                 std::move(*highest_removed_row));
+  }
+  if (count > 0) {
+    db_->CompactRangeAfterCommit(
+        LevelDbDocumentTargetKey::SentinelKey(*first_removed),
+        LevelDbDocumentTargetKey::SentinelKey(*last_removed));
+  }
   return count;
 }
 
+void LevelDbLruReferenceDelegate::SaveOrphanedDocumentHistogram(
+    const SequenceNumberHistogram& histogram) {
+  db_->current_transaction()->Put(LevelDbSequenceNumberHistogramKey::Key(),
+                                  histogram.Encode());
+}
+
+absl::optional<SequenceNumberHistogram>
+LevelDbLruReferenceDelegate::LoadOrphanedDocumentHistogram() {
+  std::string encoded;
+  leveldb::Status status = db_->current_transaction()->Get(
+      LevelDbSequenceNumberHistogramKey::Key(), &encoded);
+  if (!status.ok()) return absl::nullopt;
+
+  return SequenceNumberHistogram::Decode(encoded);
+}
+
 int LevelDbLruReferenceDelegate::RemoveTargets(
     ListenSequenceNumber sequence_number, const LiveQueryMap& live_queries) {
-  return static_cast<int>(
+  int count = static_cast<int>(
       db_->target_cache()->RemoveTargets(sequence_number, live_queries));
-}
 
-bool LevelDbLruReferenceDelegate::IsPinned(const DocumentKey& key) {
-  if (additional_references_->ContainsKey(key)) {
-    return true;
+  if (count > 0) {
+    // Removed targets are spread across the target tables, which are small
+    // compared to the document tables.
+    for (const std::string& prefix :
+         {LevelDbTargetKey::KeyPrefix(), LevelDbTargetStateKey::KeyPrefix(),
+          LevelDbTargetDocumentBlockKey::KeyPrefix(),
+          LevelDbQueryTargetKey::KeyPrefix()}) {
+      db_->CompactRangeAfterCommit(prefix, util::PrefixSuccessor(prefix));
+    }
   }
-  return MutationQueuesContainKey(key);
+  return count;
 }
 
-bool LevelDbLruReferenceDelegate::MutationQueuesContainKey(
-    const DocumentKey& key) {
-  const std::set<std::string>& users = db_->users();
-  const ResourcePath& path = key.path();
-  std::string buffer;
+std::vector<bool> LevelDbLruReferenceDelegate::FindPinned(
+    const std::vector<DocumentKey>& keys) {
+  std::vector<bool> pinned(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    pinned[i] = additional_references_->ContainsKey(keys[i]);
+  }
+
+  // Each user's document mutation index is in key order, so a single forward
+  // pass over it finds the mutated keys among `keys`. The iterator only needs
+  // to seek when it is behind the next key; otherwise the key can't have any
+  // mutations.
   auto it = db_->current_transaction()->NewIterator();
-  // For each user, if there is any batch that contains this document in any
-  // batch, we know it's pinned.
-  for (const std::string& user : users) {
-    std::string mutation_key =
-        LevelDbDocumentMutationKey::KeyPrefix(user, path);
-    it->Seek(mutation_key);
-    if (it->Valid() && absl::StartsWith(it->key(), mutation_key)) {
-      return true;
+  for (const std::string& user : db_->users()) {
+    std::string user_prefix = LevelDbDocumentMutationKey::KeyPrefix(user);
+    bool positioned = false;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (pinned[i]) continue;
+
+      std::string mutation_prefix =
+          LevelDbDocumentMutationKey::KeyPrefix(user, keys[i].path());
+      if (!positioned || it->key() < mutation_prefix) {
+        it->Seek(mutation_prefix);
+        positioned = true;
+      }
+      if (!it->Valid() || !absl::StartsWith(it->key(), user_prefix)) {
+        // None of the remaining keys are in this user's queue.
+        break;
+      }
+      if (absl::StartsWith(it->key(), mutation_prefix)) {
+        pinned[i] = true;
+      }
     }
   }
-  return false;
+  return pinned;
 }
 
 void LevelDbLruReferenceDelegate::RemoveSentinel(const DocumentKey& key) {
+  // A pending write must not bring back the sentinel of a removed document.
+  pending_sentinels_.erase(key);
   db_->current_transaction()->Delete(
       LevelDbDocumentTargetKey::SentinelKey(key));
 }
 
 void LevelDbLruReferenceDelegate::WriteSentinel(const DocumentKey& key) {
-  std::string sentinel_key = LevelDbDocumentTargetKey::SentinelKey(key);
+  HARD_ASSERT(current_sequence_number_ != kListenSequenceNumberInvalid,
+              "Writing a sentinel outside of a transaction");
+  pending_sentinels_.insert(key);
+}
+
+void LevelDbLruReferenceDelegate::FlushSentinels() {
+  if (pending_sentinels_.empty()) {
+    return;
+  }
+
+  // All the sentinels written in a transaction share its sequence number.
   std::string encoded_sequence_number =
       LevelDbDocumentTargetKey::EncodeSentinelValue(current_sequence_number());
-  db_->current_transaction()->Put(sentinel_key, encoded_sequence_number);
+  LevelDbTransaction* transaction = db_->current_transaction();
+  for (const DocumentKey& key : pending_sentinels_) {
+    transaction->Put(LevelDbDocumentTargetKey::SentinelKey(key),
+                     encoded_sequence_number);
+  }
+  pending_sentinels_.clear();
 }
 
 }  // namespace local
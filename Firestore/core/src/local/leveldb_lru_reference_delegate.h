@@ -18,7 +18,10 @@
 #define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_LRU_REFERENCE_DELEGATE_H_
 
 #include <memory>
+#include <set>
+#include <vector>
 
+#include "Firestore/core/src/local/document_access_log.h"
 #include "Firestore/core/src/local/lru_garbage_collector.h"
 
 namespace firebase {
@@ -49,6 +52,7 @@ class LevelDbLruReferenceDelegate : public LruDelegate {
   void RemoveTarget(const local::TargetData& target_data) override;
 
   void UpdateLimboDocument(const model::DocumentKey& key) override;
+  void RecordDocumentAccess(const model::DocumentKey& key) override;
 
   void OnTransactionStarted(absl::string_view label) override;
   void OnTransactionCommitted() override;
@@ -66,17 +70,35 @@ class LevelDbLruReferenceDelegate : public LruDelegate {
       const OrphanedDocumentCallback& callback) override;
 
   int RemoveOrphanedDocuments(model::ListenSequenceNumber upper_bound) override;
+  int RemoveOrphanedDocumentsUntil(
+      model::ListenSequenceNumber upper_bound,
+      std::chrono::steady_clock::time_point deadline,
+      absl::optional<model::DocumentKey>* cursor,
+      SequenceNumberHistogram* retained) override;
+  void SaveOrphanedDocumentHistogram(
+      const SequenceNumberHistogram& histogram) override;
+  absl::optional<SequenceNumberHistogram> LoadOrphanedDocumentHistogram()
+      override;
   int RemoveTargets(model::ListenSequenceNumber sequence_number,
                     const LiveQueryMap& live_queries) override;
+  void FlushDocumentAccesses() override;
 
  private:
-  bool IsPinned(const model::DocumentKey& key);
-
-  bool MutationQueuesContainKey(const model::DocumentKey& key);
+  /**
+   * Returns, for each of the given keys, which must be sorted, whether the
+   * document is pinned in memory or by a mutation of any user.
+   */
+  std::vector<bool> FindPinned(const std::vector<model::DocumentKey>& keys);
 
   void RemoveSentinel(const model::DocumentKey& key);
   void WriteSentinel(const model::DocumentKey& key);
 
+  /**
+   * Writes the sentinel rows of the keys collected by `WriteSentinel` in the
+   * current transaction.
+   */
+  void FlushSentinels();
+
   std::unique_ptr<LruGarbageCollector> gc_;
 
   // Persistence instances are owned by FirestoreClient
@@ -93,6 +115,15 @@ class LevelDbLruReferenceDelegate : public LruDelegate {
   // transaction is active, resets back to kListenSequenceNumberInvalid.
   model::ListenSequenceNumber current_sequence_number_ =
       kListenSequenceNumberInvalid;
+
+  // The documents whose sentinel rows need to be updated to the current
+  // sequence number when the active transaction commits. A document is
+  // usually touched several times in a transaction, but its sentinel only
+  // needs to be written once.
+  std::set<model::DocumentKey> pending_sentinels_;
+
+  // The documents read since the last garbage collection.
+  DocumentAccessLog access_log_;
 };
 
 }  // namespace local
@@ -16,19 +16,31 @@
 
 #include "Firestore/core/src/local/leveldb_migrations.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Firestore/Protos/nanopb/firestore/local/mutation.nanopb.h"
 #include "Firestore/Protos/nanopb/firestore/local/target.nanopb.h"
+#include "Firestore/core/src/local/leveldb_collection_dictionary.h"
 #include "Firestore/core/src/local/leveldb_key.h"
+#include "Firestore/core/src/local/leveldb_util.h"
 #include "Firestore/core/src/local/memory_index_manager.h"
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/types.h"
 #include "Firestore/core/src/nanopb/message.h"
 #include "Firestore/core/src/nanopb/reader.h"
 #include "Firestore/core/src/nanopb/writer.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/log.h"
 #include "absl/strings/match.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
@@ -44,6 +56,10 @@ using model::ResourcePath;
 using nanopb::Message;
 using nanopb::StringReader;
 using nanopb::Writer;
+using ReadProfile = LevelDbTransaction::ReadProfile;
+
+using Millis = std::chrono::milliseconds;
+using SteadyClock = std::chrono::steady_clock;
 
 /**
  * Schema version for the iOS client.
@@ -65,8 +81,14 @@ using nanopb::Writer;
  *     has a sentinel row with a sequence number.
  *   * Migration 5 drops held write acks.
  *   * Migration 6 populates the collection_parents index.
+ *   * Migration 7 computes the size counters.
+ *   * Migration 8 populates the collection_mutation index.
+ *   * Migration 9 moves target documents into target_document_block rows.
+ *   * Migration 10 moves remote documents into collection_document rows.
+ *   * Migration 11 drops the target_state rows, which may be stale after a
+ *     downgrade.
  */
-const LevelDbMigrations::SchemaVersion kSchemaVersion = 6;
+const LevelDbMigrations::SchemaVersion kSchemaVersion = 11;
 
 /**
  * Save the given version number as the current version of the schema of the
@@ -81,11 +103,119 @@ void SaveVersion(LevelDbMigrations::SchemaVersion version,
   transaction->Put(key, version_string);
 }
 
+/**
+ * The number of rows a batched migration processes in each transaction. This
+ * bounds the memory used by a migration and the work lost if it's interrupted.
+ */
+const size_t kMigrationBatchSize = 1000;
+
+/**
+ * Processes a single row of a batched migration scan, buffering its writes in
+ * the given transaction.
+ */
+using RowProcessor = std::function<void(
+    LevelDbTransaction*, absl::string_view key, absl::string_view value)>;
+
+/** Completes a batch of a batched migration before it's committed. */
+using BatchFinisher = std::function<void(LevelDbTransaction*)>;
+
+/**
+ * Returns the last key processed by an interrupted run of the given migration,
+ * or nullopt if the migration hasn't committed any batches.
+ *
+ * A cursor left behind by a migration that was interrupted and then followed
+ * by a downgrade can't be told apart from one that wasn't, so rows an older
+ * client wrote before the cursor position won't be visited when the migration
+ * resumes. Interrupted upgrades immediately followed by a downgrade aren't
+ * expected in practice.
+ */
+absl::optional<std::string> ReadMigrationCursor(
+    leveldb::DB* db, LevelDbMigrations::SchemaVersion version) {
+  LevelDbTransaction transaction(db, "Read migration cursor");
+  std::string value;
+  if (!transaction.Get(LevelDbMigrationCursorKey::Key(), &value).ok()) {
+    return absl::nullopt;
+  }
+
+  int32_t cursor_version = 0;
+  std::string last_key;
+  if (!LevelDbMigrationCursorKey::DecodeValue(value, &cursor_version,
+                                              &last_key) ||
+      cursor_version != version) {
+    return absl::nullopt;
+  }
+  return last_key;
+}
+
+/**
+ * Calls `process` for every row whose key starts with `prefix`, committing
+ * every `kMigrationBatchSize` rows along with a cursor recording the last key
+ * processed. If `cursor` is set, rows up to and including it are skipped; it's
+ * updated as rows are processed. If given, `finish_batch` is called before
+ * each batch is committed.
+ *
+ * A migration that scans several tables must scan them in key order, since the
+ * cursor is a single key.
+ */
+void ProcessRowsInBatches(leveldb::DB* db,
+                          LevelDbMigrations::SchemaVersion version,
+                          const std::string& prefix,
+                          absl::optional<std::string>* cursor,
+                          const RowProcessor& process,
+                          const BatchFinisher& finish_batch = nullptr) {
+  bool more_rows = true;
+  while (more_rows) {
+    LevelDbTransaction transaction(db, "Run batched migration");
+    auto it = transaction.NewIterator(ReadProfile::BackgroundScan);
+    if (*cursor && **cursor > prefix) {
+      it->Seek(**cursor);
+      if (it->Valid() && it->key() == **cursor) {
+        it->Next();
+      }
+    } else {
+      it->Seek(prefix);
+    }
+
+    more_rows = false;
+    size_t rows = 0;
+    for (; it->Valid() && absl::StartsWith(it->key(), prefix); it->Next()) {
+      if (rows == kMigrationBatchSize) {
+        more_rows = true;
+        break;
+      }
+      process(&transaction, it->key(), it->value());
+      *cursor = std::string(it->key());
+      ++rows;
+    }
+
+    if (rows > 0) {
+      if (finish_batch) {
+        finish_batch(&transaction);
+      }
+      transaction.Put(LevelDbMigrationCursorKey::Key(),
+                      LevelDbMigrationCursorKey::EncodeValue(version,
+                                                             **cursor));
+    }
+    transaction.Commit();
+  }
+}
+
+/**
+ * Completes a batched migration, saving its version and dropping its cursor
+ * along with any other writes already buffered in `transaction`.
+ */
+void FinishBatchedMigration(LevelDbMigrations::SchemaVersion version,
+                            LevelDbTransaction* transaction) {
+  transaction->Delete(LevelDbMigrationCursorKey::Key());
+  SaveVersion(version, transaction);
+  transaction->Commit();
+}
+
 void DeleteEverythingWithPrefix(const std::string& prefix, leveldb::DB* db) {
   bool more_deletes = true;
   while (more_deletes) {
     LevelDbTransaction transaction(db, "Delete everything with prefix");
-    auto it = transaction.NewIterator();
+    auto it = transaction.NewIterator(ReadProfile::BackgroundScan);
 
     more_deletes = false;
     for (it->Seek(prefix); it->Valid() && absl::StartsWith(it->key(), prefix);
@@ -132,7 +262,7 @@ void RemoveMutationDocuments(LevelDbTransaction* transaction,
   LevelDbDocumentMutationKey doc_key;
   std::string prefix = LevelDbDocumentMutationKey::KeyPrefix(user_id);
 
-  auto it = transaction->NewIterator();
+  auto it = transaction->NewIterator(ReadProfile::BackgroundScan);
   it->Seek(prefix);
   for (; it->Valid() && absl::StartsWith(it->key(), prefix); it->Next()) {
     HARD_ASSERT(doc_key.Decode(it->key()),
@@ -153,7 +283,7 @@ void RemoveMutationBatches(LevelDbTransaction* transaction,
   std::string mutations_key = LevelDbMutationKey::KeyPrefix(user_id);
   std::string last_key =
       LevelDbMutationKey::Key(user_id, last_acknowledged_batch_id);
-  auto it = transaction->NewIterator();
+  auto it = transaction->NewIterator(ReadProfile::BackgroundScan);
   it->Seek(mutations_key);
   for (; it->Valid() && it->key() <= last_key; it->Next()) {
     transaction->Delete(it->key());
@@ -167,7 +297,7 @@ void RemoveAcknowledgedMutations(leveldb::DB* db) {
 
   LevelDbMutationQueueKey key;
 
-  auto it = transaction.NewIterator();
+  auto it = transaction.NewIterator(ReadProfile::BackgroundScan);
   it->Seek(mutation_queue_start);
   for (; it->Valid() && absl::StartsWith(it->key(), mutation_queue_start);
        it->Next()) {
@@ -221,27 +351,29 @@ void EnsureSentinelRow(LevelDbTransaction* transaction,
  * sentinel row in the document target index.
  */
 void EnsureSentinelRows(leveldb::DB* db) {
-  LevelDbTransaction transaction(db, "Ensure sentinel rows");
-
-  // Get the value we'll use for anything that's missing a row.
-  model::ListenSequenceNumber sequence_number =
-      GetHighestSequenceNumber(&transaction);
-  std::string sentinel_value =
-      LevelDbDocumentTargetKey::EncodeSentinelValue(sequence_number);
+  std::string sentinel_value;
+  {
+    LevelDbTransaction transaction(db, "Read highest sequence number");
+    // Get the value we'll use for anything that's missing a row.
+    model::ListenSequenceNumber sequence_number =
+        GetHighestSequenceNumber(&transaction);
+    sentinel_value =
+        LevelDbDocumentTargetKey::EncodeSentinelValue(sequence_number);
+  }
 
-  std::string documents_prefix = LevelDbRemoteDocumentKey::KeyPrefix();
-  auto it = transaction.NewIterator();
-  it->Seek(documents_prefix);
+  absl::optional<std::string> cursor = ReadMigrationCursor(db, 4);
   LevelDbRemoteDocumentKey document_key;
-  for (; it->Valid() && absl::StartsWith(it->key(), documents_prefix);
-       it->Next()) {
-    HARD_ASSERT(document_key.Decode(it->key()),
-                "Failed to decode document key");
-    EnsureSentinelRow(&transaction, document_key.document_key(),
-                      sentinel_value);
-  }
-  SaveVersion(4, &transaction);
-  transaction.Commit();
+  ProcessRowsInBatches(
+      db, 4, LevelDbRemoteDocumentKey::KeyPrefix(), &cursor,
+      [&](LevelDbTransaction* transaction, absl::string_view key,
+          absl::string_view) {
+        HARD_ASSERT(document_key.Decode(key), "Failed to decode document key");
+        EnsureSentinelRow(transaction, document_key.document_key(),
+                          sentinel_value);
+      });
+
+  LevelDbTransaction transaction(db, "Ensure sentinel rows");
+  FinishBatchedMigration(4, &transaction);
 }
 
 // Helper to add an index entry iff we haven't already written it (as determined
@@ -268,41 +400,300 @@ void EnsureCollectionParentRow(LevelDbTransaction* transaction,
  * of documents in the remote document cache and mutation queue.
  */
 void EnsureCollectionParentsIndex(leveldb::DB* db) {
-  LevelDbTransaction transaction(db, "Ensure Collection Parents Index");
-
   MemoryCollectionParentIndex cache;
+  absl::optional<std::string> cursor = ReadMigrationCursor(db, 6);
+
+  // Index existing mutations. The document_mutation table sorts before the
+  // remote_document table, so it must be scanned first.
+  LevelDbDocumentMutationKey key;
+  ProcessRowsInBatches(
+      db, 6, LevelDbDocumentMutationKey::KeyPrefix(), &cursor,
+      [&](LevelDbTransaction* transaction, absl::string_view row_key,
+          absl::string_view) {
+        HARD_ASSERT(key.Decode(row_key),
+                    "Failed to decode document-mutation key");
+        EnsureCollectionParentRow(transaction, &cache, key.document_key());
+      });
 
   // Index existing remote documents.
-  std::string documents_prefix = LevelDbRemoteDocumentKey::KeyPrefix();
-  auto it = transaction.NewIterator();
-  it->Seek(documents_prefix);
   LevelDbRemoteDocumentKey document_key;
-  for (; it->Valid() && absl::StartsWith(it->key(), documents_prefix);
-       it->Next()) {
-    HARD_ASSERT(document_key.Decode(it->key()),
-                "Failed to decode document key");
+  ProcessRowsInBatches(
+      db, 6, LevelDbRemoteDocumentKey::KeyPrefix(), &cursor,
+      [&](LevelDbTransaction* transaction, absl::string_view row_key,
+          absl::string_view) {
+        HARD_ASSERT(document_key.Decode(row_key),
+                    "Failed to decode document key");
+        EnsureCollectionParentRow(transaction, &cache,
+                                  document_key.document_key());
+      });
+
+  LevelDbTransaction transaction(db, "Ensure Collection Parents Index");
+  FinishBatchedMigration(6, &transaction);
+}
 
-    EnsureCollectionParentRow(&transaction, &cache,
-                              document_key.document_key());
+/** Returns the total size of the keys and values of the rows in a table. */
+int64_t CalculateTableSize(LevelDbTransaction* transaction,
+                           const std::string& table_prefix) {
+  int64_t byte_size = 0;
+  auto it = transaction->NewIterator(ReadProfile::BackgroundScan);
+  for (it->Seek(table_prefix);
+       it->Valid() && absl::StartsWith(it->key(), table_prefix); it->Next()) {
+    byte_size += static_cast<int64_t>(it->key().size() + it->value().size());
+  }
+  return byte_size;
+}
+
+/**
+ * Migration 7.
+ *
+ * Computes the size counters maintained by LevelDbSizeCounters from the
+ * current contents of the tables. This rewrites them when upgrading after a
+ * downgrade, during which they weren't maintained.
+ */
+void ComputeSizeCounters(leveldb::DB* db) {
+  LevelDbTransaction transaction(db, "Compute size counters");
+
+  // In the order of `SizedTable`.
+  std::vector<int64_t> byte_sizes = {
+      CalculateTableSize(&transaction, LevelDbRemoteDocumentKey::KeyPrefix()),
+      CalculateTableSize(&transaction, LevelDbTargetKey::KeyPrefix()),
+      CalculateTableSize(&transaction, LevelDbMutationKey::KeyPrefix()),
+  };
+  transaction.Put(LevelDbSizeCountersKey::Key(),
+                  LevelDbSizeCountersKey::EncodeValue(byte_sizes));
+
+  SaveVersion(7, &transaction);
+  transaction.Commit();
+}
+
+/**
+ * Migration 8.
+ *
+ * Rebuilds the collection_mutation index from the document_mutation index.
+ * Existing rows are dropped first, since they may be stale after a downgrade
+ * during which the index wasn't maintained. A resumed migration has already
+ * dropped them.
+ */
+void RebuildCollectionMutationIndex(leveldb::DB* db) {
+  absl::optional<std::string> cursor = ReadMigrationCursor(db, 8);
+  if (!cursor) {
+    DeleteEverythingWithPrefix(LevelDbCollectionMutationKey::KeyPrefix(), db);
   }
 
-  // Index existing mutations.
-  std::string mutations_prefix = LevelDbDocumentMutationKey::KeyPrefix();
-  it = transaction.NewIterator();
-  it->Seek(mutations_prefix);
   LevelDbDocumentMutationKey key;
-  for (; it->Valid() && absl::StartsWith(it->key(), mutations_prefix);
-       it->Next()) {
-    HARD_ASSERT(key.Decode(it->key()),
-                "Failed to decode document-mutation key");
+  std::string empty_buffer;
+  ProcessRowsInBatches(
+      db, 8, LevelDbDocumentMutationKey::KeyPrefix(), &cursor,
+      [&](LevelDbTransaction* transaction, absl::string_view row_key,
+          absl::string_view) {
+        HARD_ASSERT(key.Decode(row_key),
+                    "Failed to decode document-mutation key");
+        transaction->Put(LevelDbCollectionMutationKey::Key(
+                             key.user_id(), key.document_key().path().PopLast(),
+                             key.batch_id()),
+                         empty_buffer);
+      });
+
+  LevelDbTransaction transaction(db, "Rebuild collection mutation index");
+  FinishBatchedMigration(8, &transaction);
+}
 
-    EnsureCollectionParentRow(&transaction, &cache, key.document_key());
+/**
+ * Adds the given document keys to the block rows they belong to, merging them
+ * with the keys already written by earlier batches.
+ */
+void AddToTargetDocumentBlocks(
+    LevelDbTransaction* transaction,
+    std::map<std::pair<model::TargetId, int32_t>, std::vector<DocumentKey>>*
+        blocks) {
+  for (auto& entry : *blocks) {
+    std::string block_key = LevelDbTargetDocumentBlockKey::Key(
+        entry.first.first, entry.first.second);
+    std::vector<DocumentKey>& document_keys = entry.second;
+
+    std::string existing_value;
+    if (transaction->Get(block_key, &existing_value).ok()) {
+      std::vector<DocumentKey> existing;
+      HARD_ASSERT(
+          LevelDbTargetDocumentBlockKey::DecodeValue(existing_value, &existing),
+          "Failed to decode target document block");
+      document_keys.insert(document_keys.end(), existing.begin(),
+                           existing.end());
+    }
+
+    std::sort(document_keys.begin(), document_keys.end());
+    document_keys.erase(
+        std::unique(document_keys.begin(), document_keys.end()),
+        document_keys.end());
+    transaction->Put(std::move(block_key),
+                     LevelDbTargetDocumentBlockKey::EncodeValue(document_keys));
   }
+  blocks->clear();
+}
 
-  SaveVersion(6, &transaction);
+/**
+ * Migration 9.
+ *
+ * Rebuilds the target_document_block rows from the document_target index and
+ * drops the per-document target_document rows they replace. The
+ * document_target index is maintained by every schema version, so this is
+ * correct even after a downgrade. Rows of targets that no longer exist, which
+ * a downgraded client may have left behind, are dropped.
+ */
+void BuildTargetDocumentBlocks(leveldb::DB* db) {
+  absl::optional<std::string> cursor = ReadMigrationCursor(db, 9);
+  if (!cursor) {
+    DeleteEverythingWithPrefix(LevelDbTargetDocumentKey::KeyPrefix(), db);
+    DeleteEverythingWithPrefix(LevelDbTargetDocumentBlockKey::KeyPrefix(), db);
+  }
+
+  std::set<model::TargetId> target_ids;
+  {
+    LevelDbTransaction transaction(db, "Read target ids");
+    std::string targets_prefix = LevelDbTargetKey::KeyPrefix();
+    auto it = transaction.NewIterator(ReadProfile::BackgroundScan);
+    LevelDbTargetKey target_key;
+    for (it->Seek(targets_prefix);
+         it->Valid() && absl::StartsWith(it->key(), targets_prefix);
+         it->Next()) {
+      HARD_ASSERT(target_key.Decode(MakeSlice(it->key())),
+                  "Failed to decode target key");
+      target_ids.insert(target_key.target_id());
+    }
+  }
+
+  // The blocks of the current batch, written out before it's committed.
+  std::map<std::pair<model::TargetId, int32_t>, std::vector<DocumentKey>>
+      blocks;
+  LevelDbDocumentTargetKey document_target_key;
+  ProcessRowsInBatches(
+      db, 9, LevelDbDocumentTargetKey::KeyPrefix(), &cursor,
+      [&](LevelDbTransaction* transaction, absl::string_view key,
+          absl::string_view) {
+        HARD_ASSERT(document_target_key.Decode(key),
+                    "Failed to decode document-target key");
+        if (!document_target_key.IsSentinel()) {
+          model::TargetId target_id = document_target_key.target_id();
+          if (target_ids.find(target_id) == target_ids.end()) {
+            transaction->Delete(key);
+          } else {
+            const DocumentKey& document_key =
+                document_target_key.document_key();
+            int32_t block_id =
+                LevelDbTargetDocumentBlockKey::BlockIdFor(document_key);
+            blocks[{target_id, block_id}].push_back(document_key);
+          }
+        }
+      },
+      [&](LevelDbTransaction* transaction) {
+        AddToTargetDocumentBlocks(transaction, &blocks);
+      });
+
+  LevelDbTransaction transaction(db, "Build target document blocks");
+  FinishBatchedMigration(9, &transaction);
+}
+
+/**
+ * Migration 10.
+ *
+ * Moves the rows of the remote_document table into the collection_document
+ * table, numbering their collections in the collection dictionary, and
+ * recomputes the size of the remote documents.
+ *
+ * A client downgraded past this migration only sees the remote_document rows,
+ * so the rows it writes replace any collection_document rows left over from
+ * before the downgrade: a migration that isn't resumed drops them along with
+ * the dictionary. The downgraded client starts with an empty document cache.
+ */
+void MoveRemoteDocumentsToCollections(leveldb::DB* db) {
+  absl::optional<std::string> cursor = ReadMigrationCursor(db, 10);
+  if (!cursor) {
+    DeleteEverythingWithPrefix(LevelDbCollectionDocumentKey::KeyPrefix(), db);
+    DeleteEverythingWithPrefix(LevelDbCollectionDictionaryKey::KeyPrefix(),
+                               db);
+    DeleteEverythingWithPrefix(LevelDbCollectionDictionaryGlobalKey::Key(),
+                               db);
+  }
+
+  LevelDbCollectionDictionary dictionary;
+  LevelDbRemoteDocumentKey document_key;
+  ProcessRowsInBatches(
+      db, 10, LevelDbRemoteDocumentKey::KeyPrefix(), &cursor,
+      [&](LevelDbTransaction* transaction, absl::string_view key,
+          absl::string_view value) {
+        HARD_ASSERT(document_key.Decode(key), "Failed to decode document key");
+        const ResourcePath& path = document_key.document_key().path();
+        int32_t collection_number =
+            dictionary.FindOrAssign(transaction, path.PopLast());
+
+        std::string contents(value);
+        transaction->Delete(key);
+        transaction->Put(LevelDbCollectionDocumentKey::Key(collection_number,
+                                                           path.last_segment()),
+                         std::move(contents));
+      });
+
+  LevelDbTransaction transaction(db, "Move remote documents to collections");
+  std::string counters_value;
+  std::vector<int64_t> byte_sizes;
+  if (transaction.Get(LevelDbSizeCountersKey::Key(), &counters_value).ok() &&
+      LevelDbSizeCountersKey::DecodeValue(counters_value, &byte_sizes) &&
+      !byte_sizes.empty()) {
+    // The remote documents come first, in the order of `SizedTable`.
+    byte_sizes[0] = CalculateTableSize(
+        &transaction, LevelDbCollectionDocumentKey::KeyPrefix());
+    transaction.Put(LevelDbSizeCountersKey::Key(),
+                    LevelDbSizeCountersKey::EncodeValue(byte_sizes));
+  }
+  FinishBatchedMigration(10, &transaction);
+}
+
+/**
+ * Migration 11.
+ *
+ * Drops the target_state rows and recomputes the size of the targets. A client
+ * downgraded past this migration writes updated targets to the targets table
+ * in full and leaves the target_state rows, which would otherwise override
+ * them, behind. New clients have no target_state rows yet.
+ */
+void DropTargetStates(leveldb::DB* db) {
+  DeleteEverythingWithPrefix(LevelDbTargetStateKey::KeyPrefix(), db);
+
+  LevelDbTransaction transaction(db, "Drop target states");
+  std::string counters_value;
+  std::vector<int64_t> byte_sizes;
+  if (transaction.Get(LevelDbSizeCountersKey::Key(), &counters_value).ok() &&
+      LevelDbSizeCountersKey::DecodeValue(counters_value, &byte_sizes) &&
+      byte_sizes.size() > 1) {
+    // The targets come second, in the order of `SizedTable`.
+    byte_sizes[1] =
+        CalculateTableSize(&transaction, LevelDbTargetKey::KeyPrefix());
+    transaction.Put(LevelDbSizeCountersKey::Key(),
+                    LevelDbSizeCountersKey::EncodeValue(byte_sizes));
+  }
+  SaveVersion(11, &transaction);
   transaction.Commit();
 }
 
+/**
+ * Runs the given migration if the database is being upgraded past its version,
+ * logging how long it took.
+ */
+void RunMigration(leveldb::DB* db,
+                  LevelDbMigrations::SchemaVersion from_version,
+                  LevelDbMigrations::SchemaVersion to_version,
+                  LevelDbMigrations::SchemaVersion version,
+                  const char* name,
+                  void (*migration)(leveldb::DB*)) {
+  if (from_version >= version || to_version < version) return;
+
+  SteadyClock::time_point start = SteadyClock::now();
+  migration(db);
+  LOG_DEBUG("LevelDB migration %s (%s) took %sms", version, name,
+            std::chrono::duration_cast<Millis>(SteadyClock::now() - start)
+                .count());
+}
+
 }  // namespace
 
 LevelDbMigrations::SchemaVersion LevelDbMigrations::ReadSchemaVersion(
@@ -333,6 +724,7 @@ void LevelDbMigrations::RunMigrations(leveldb::DB* db,
   // data migrations.
   if (from_version > to_version) {
     LevelDbTransaction transaction(db, "Save downgrade version");
+    transaction.Delete(LevelDbMigrationCursorKey::Key());
     SaveVersion(to_version, &transaction);
     transaction.Commit();
     return;
@@ -341,21 +733,26 @@ void LevelDbMigrations::RunMigrations(leveldb::DB* db,
   // This must run unconditionally because schema migrations were added to iOS
   // after the first release. There may be clients that have never run any
   // migrations that have existing targets.
-  if (from_version < 3 && to_version >= 3) {
-    ClearQueryCache(db);
-  }
-
-  if (from_version < 4 && to_version >= 4) {
-    EnsureSentinelRows(db);
-  }
-
-  if (from_version < 5 && to_version >= 5) {
-    RemoveAcknowledgedMutations(db);
-  }
-
-  if (from_version < 6 && to_version >= 6) {
-    EnsureCollectionParentsIndex(db);
-  }
+  RunMigration(db, from_version, to_version, 3, "clear query cache",
+               ClearQueryCache);
+  RunMigration(db, from_version, to_version, 4, "ensure sentinel rows",
+               EnsureSentinelRows);
+  RunMigration(db, from_version, to_version, 5,
+               "remove acknowledged mutations", RemoveAcknowledgedMutations);
+  RunMigration(db, from_version, to_version, 6,
+               "ensure collection parents index", EnsureCollectionParentsIndex);
+  RunMigration(db, from_version, to_version, 7, "compute size counters",
+               ComputeSizeCounters);
+  RunMigration(db, from_version, to_version, 8,
+               "rebuild collection mutation index",
+               RebuildCollectionMutationIndex);
+  RunMigration(db, from_version, to_version, 9,
+               "build target document blocks", BuildTargetDocumentBlocks);
+  RunMigration(db, from_version, to_version, 10,
+               "move remote documents to collections",
+               MoveRemoteDocumentsToCollections);
+  RunMigration(db, from_version, to_version, 11, "drop target states",
+               DropTargetStates);
 }
 
 }  // namespace local
@@ -22,6 +22,7 @@
 #include "Firestore/core/src/core/query.h"
 #include "Firestore/core/src/local/leveldb_key.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_size_counters.h"
 #include "Firestore/core/src/local/leveldb_transaction.h"
 #include "Firestore/core/src/local/leveldb_util.h"
 #include "Firestore/core/src/local/local_serializer.h"
@@ -52,6 +53,7 @@ using model::Mutation;
 using model::MutationBatch;
 using model::ResourcePath;
 using nanopb::ByteString;
+using nanopb::MakeStdString;
 using nanopb::Message;
 using nanopb::StringReader;
 
@@ -133,8 +135,33 @@ LevelDbMutationQueue::LevelDbMutationQueue(const User& user,
 }
 
 void LevelDbMutationQueue::Start() {
-  next_batch_id_ = LoadNextBatchIdFromDb(db_->ptr());
+  // Loading the next batch ID and the document-mutation index both scan
+  // LevelDB, so they're deferred until they're needed to keep startup fast.
+  next_batch_id_ = kBatchIdUnknown;
   metadata_ = MetadataForKey(mutation_queue_key());
+
+  index_loaded_ = false;
+  batches_by_document_key_ = DocumentKeyReferenceSet{};
+  batch_cache_.clear();
+}
+
+void LevelDbMutationQueue::EnsureIndexLoaded() {
+  if (index_loaded_) return;
+  index_loaded_ = true;
+
+  std::string index_prefix = LevelDbDocumentMutationKey::KeyPrefix(user_id_);
+  auto index_iterator = db_->current_transaction()->NewIterator();
+  LevelDbDocumentMutationKey row_key;
+  for (index_iterator->Seek(index_prefix);
+       index_iterator->Valid() &&
+       absl::StartsWith(index_iterator->key(), index_prefix);
+       index_iterator->Next()) {
+    HARD_ASSERT(row_key.Decode(index_iterator->key()),
+                "Failed to decode document-mutation key %s",
+                DescribeKey(index_iterator));
+    batches_by_document_key_ = batches_by_document_key_.insert(
+        DocumentKeyReference{row_key.document_key(), row_key.batch_id()});
+  }
 }
 
 bool LevelDbMutationQueue::IsEmpty() {
@@ -159,13 +186,18 @@ MutationBatch LevelDbMutationQueue::AddMutationBatch(
     const Timestamp& local_write_time,
     std::vector<Mutation>&& base_mutations,
     std::vector<Mutation>&& mutations) {
+  if (next_batch_id_ == kBatchIdUnknown) {
+    next_batch_id_ = LoadNextBatchIdFromDb(db_->ptr());
+  }
   BatchId batch_id = next_batch_id_;
   next_batch_id_++;
 
   MutationBatch batch(batch_id, local_write_time, std::move(base_mutations),
                       std::move(mutations));
   std::string key = mutation_batch_key(batch_id);
-  db_->current_transaction()->Put(key, serializer_->EncodeMutationBatch(batch));
+  std::string encoded = MakeStdString(serializer_->EncodeMutationBatch(batch));
+  db_->size_counters()->RecordPut(SizedTable::Mutations, key, encoded.size());
+  db_->current_transaction()->Put(key, std::move(encoded));
 
   // Store an empty value in the index which is equivalent to serializing a
   // GPBEmpty message. In the future if we wanted to store some other kind of
@@ -176,11 +208,23 @@ MutationBatch LevelDbMutationQueue::AddMutationBatch(
   for (const Mutation& mutation : batch.mutations()) {
     key = LevelDbDocumentMutationKey::Key(user_id_, mutation.key(), batch_id);
     db_->current_transaction()->Put(key, empty_buffer);
+    // An index that isn't loaded yet will read this row when it's loaded.
+    if (index_loaded_) {
+      batches_by_document_key_ = batches_by_document_key_.insert(
+          DocumentKeyReference{mutation.key(), batch_id});
+    }
+    db_->current_transaction()->Delete(
+        LevelDbDocumentOverlayKey::Key(user_id_, mutation.key()));
+
+    ResourcePath collection_path = mutation.key().path().PopLast();
+    key = LevelDbCollectionMutationKey::Key(user_id_, collection_path,
+                                            batch_id);
+    db_->current_transaction()->Put(key, empty_buffer);
 
-    db_->index_manager()->AddToCollectionParentIndex(
-        mutation.key().path().PopLast());
+    db_->index_manager()->AddToCollectionParentIndex(collection_path);
   }
 
+  batch_cache_.emplace(batch_id, batch);
   return batch;
 }
 
@@ -200,11 +244,22 @@ void LevelDbMutationQueue::RemoveMutationBatch(const MutationBatch& batch) {
               "Mutation batch %s not found; found %s", DescribeKey(key),
               DescribeKey(check_iterator->key()));
 
+  db_->size_counters()->RecordDelete(SizedTable::Mutations, key,
+                                     check_iterator->value().size());
   db_->current_transaction()->Delete(key);
+  batch_cache_.erase(batch_id);
 
   for (const Mutation& mutation : batch.mutations()) {
     key = LevelDbDocumentMutationKey::Key(user_id_, mutation.key(), batch_id);
     db_->current_transaction()->Delete(key);
+    if (index_loaded_) {
+      batches_by_document_key_ = batches_by_document_key_.erase(
+          DocumentKeyReference{mutation.key(), batch_id});
+    }
+    db_->current_transaction()->Delete(
+        LevelDbDocumentOverlayKey::Key(user_id_, mutation.key()));
+    db_->current_transaction()->Delete(LevelDbCollectionMutationKey::Key(
+        user_id_, mutation.key().path().PopLast(), batch_id));
     db_->reference_delegate()->RemoveMutationReference(mutation.key());
   }
 }
@@ -229,6 +284,20 @@ LevelDbMutationQueue::AllMutationBatchesAffectingDocumentKeys(
   // one key.
   std::set<BatchId> batch_ids;
 
+  if (UseInMemoryState()) {
+    EnsureIndexLoaded();
+    for (const DocumentKey& document_key : document_keys) {
+      DocumentKeyReference start{document_key, 0};
+      for (const auto& reference :
+           batches_by_document_key_.values_from(start)) {
+        if (document_key != reference.key()) break;
+
+        batch_ids.insert(reference.ref_id());
+      }
+    }
+    return AllMutationBatchesWithIds(batch_ids);
+  }
+
   auto index_iterator = db_->current_transaction()->NewIterator();
   LevelDbDocumentMutationKey row_key;
   for (const DocumentKey& document_key : document_keys) {
@@ -274,57 +343,29 @@ LevelDbMutationQueue::AllMutationBatchesAffectingQuery(const Query& query) {
       !query.IsCollectionGroupQuery(),
       "CollectionGroup queries should be handled in LocalDocumentsView");
 
-  const ResourcePath& query_path = query.path();
-  size_t immediate_children_path_length = query_path.size() + 1;
-
-  // TODO(mcg): Actually implement a single-collection query
-  //
-  // This is actually executing an ancestor query, traversing the whole subtree
-  // below the collection which can be horrifically inefficient for some
-  // structures. The right way to solve this is to implement the full value
-  // index, but that's not in the cards in the near future so this is the best
-  // we can do for the moment.
-  //
   // Since we don't yet index the actual properties in the mutations, our
   // current approach is to just return all mutation batches that affect
-  // documents in the collection being queried.
-  //
-  // Unlike AllMutationBatchesAffectingDocumentKey, this iteration will scan the
-  // document-mutation index for more than a single document so the associated
-  // batch_ids will be neither necessarily unique nor in order. This means an
-  // efficient simultaneous scan isn't possible.
+  // documents in the collection being queried. These are found with a scan of
+  // the collection-mutation index, which stops at the first row of a
+  // subcollection.
+  const ResourcePath& query_path = query.path();
   std::string index_prefix =
-      LevelDbDocumentMutationKey::KeyPrefix(user_id_, query_path);
+      LevelDbCollectionMutationKey::KeyPrefix(user_id_, query_path);
   auto index_iterator = db_->current_transaction()->NewIterator();
   index_iterator->Seek(index_prefix);
 
-  LevelDbDocumentMutationKey row_key;
+  LevelDbCollectionMutationKey row_key;
 
-  // Collect up unique batch_ids encountered during a scan of the index. Use a
-  // set<BatchId> to accumulate the IDs so they can be traversed in order in a
-  // scan of the main table.
-  //
-  // This method is faster than performing lookups of the keys with _db->Get and
-  // keeping a hash of batch_ids that have already been looked up. The
-  // performance difference is minor for small numbers of keys but > 30% faster
-  // for larger numbers of keys.
+  // Rows are ordered by batch_id, but collect them in a set<BatchId> anyway to
+  // match what AllMutationBatchesWithIds expects.
   std::set<BatchId> unique_batch_ids;
   for (; index_iterator->Valid(); index_iterator->Next()) {
     if (!absl::StartsWith(index_iterator->key(), index_prefix) ||
-        !row_key.Decode(index_iterator->key())) {
+        !row_key.Decode(index_iterator->key()) ||
+        row_key.collection_path() != query_path) {
       break;
     }
 
-    // Rows with document keys more than one segment longer than the query path
-    // can't be matches. For example, a query on 'rooms' can't match the
-    // document /rooms/abc/messages/xyx.
-    // TODO(mcg): we'll need a different scanner when we implement ancestor
-    // queries.
-    if (row_key.document_key().path().size() !=
-        immediate_children_path_length) {
-      continue;
-    }
-
     unique_batch_ids.insert(row_key.batch_id());
   }
 
@@ -333,6 +374,12 @@ LevelDbMutationQueue::AllMutationBatchesAffectingQuery(const Query& query) {
 
 absl::optional<MutationBatch> LevelDbMutationQueue::LookupMutationBatch(
     model::BatchId batch_id) {
+  bool use_cache = UseInMemoryState();
+  if (use_cache) {
+    auto found = batch_cache_.find(batch_id);
+    if (found != batch_cache_.end()) return found->second;
+  }
+
   std::string key = mutation_batch_key(batch_id);
 
   std::string value;
@@ -345,7 +392,9 @@ absl::optional<MutationBatch> LevelDbMutationQueue::LookupMutationBatch(
               batch_id, status.ToString());
   }
 
-  return ParseMutationBatch(value);
+  MutationBatch batch = ParseMutationBatch(value);
+  if (use_cache) batch_cache_.emplace(batch_id, batch);
+  return batch;
 }
 
 absl::optional<MutationBatch>
@@ -430,14 +479,27 @@ void LevelDbMutationQueue::SetLastStreamToken(ByteString stream_token) {
   db_->current_transaction()->Put(mutation_queue_key(), metadata_);
 }
 
+bool LevelDbMutationQueue::UseInMemoryState() const {
+  return !db_->in_read_only_transaction();
+}
+
 std::vector<MutationBatch> LevelDbMutationQueue::AllMutationBatchesWithIds(
     const std::set<BatchId>& batch_ids) {
   std::vector<MutationBatch> result;
+  bool use_cache = UseInMemoryState();
 
   // Given an ordered set of unique batch_ids perform a skipping scan over the
-  // main table to find the mutation batches.
+  // main table to find the mutation batches that aren't cached.
   auto mutation_iterator = db_->current_transaction()->NewIterator();
   for (BatchId batch_id : batch_ids) {
+    if (use_cache) {
+      auto found = batch_cache_.find(batch_id);
+      if (found != batch_cache_.end()) {
+        result.push_back(found->second);
+        continue;
+      }
+    }
+
     std::string mutation_key = mutation_batch_key(batch_id);
     mutation_iterator->Seek(mutation_key);
     if (!mutation_iterator->Valid() ||
@@ -449,6 +511,7 @@ std::vector<MutationBatch> LevelDbMutationQueue::AllMutationBatchesWithIds(
     }
 
     result.push_back(ParseMutationBatch(mutation_iterator->value()));
+    if (use_cache) batch_cache_.emplace(batch_id, result.back());
   }
 
   return result;
@@ -19,11 +19,15 @@
 
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Firestore/Protos/nanopb/firestore/local/mutation.nanopb.h"
+#include "Firestore/core/src/immutable/sorted_set.h"
+#include "Firestore/core/src/local/document_key_reference.h"
 #include "Firestore/core/src/local/mutation_queue.h"
 #include "Firestore/core/src/model/model_fwd.h"
+#include "Firestore/core/src/model/mutation_batch.h"
 #include "Firestore/core/src/model/types.h"
 #include "Firestore/core/src/nanopb/message.h"
 #include "absl/strings/string_view.h"
@@ -95,6 +99,20 @@ class LevelDbMutationQueue : public MutationQueue {
   void SetLastStreamToken(nanopb::ByteString stream_token) override;
 
  private:
+  using DocumentKeyReferenceSet =
+      immutable::SortedSet<DocumentKeyReference, DocumentKeyReference::ByKey>;
+
+  /**
+   * Returns true if the in-memory copies of the document-mutation index and of
+   * the parsed batches can be used. They reflect the transaction started by
+   * `Run()`, so read-only transactions, which see an older snapshot, must read
+   * LevelDB instead.
+   */
+  bool UseInMemoryState() const;
+
+  /** Loads `batches_by_document_key_` if it hasn't been loaded yet. */
+  void EnsureIndexLoaded();
+
   /**
    * Constructs a vector of matching batches, sorted by batch_id to ensure that
    * multiple mutations affecting the same document key are applied in order.
@@ -130,13 +148,28 @@ class LevelDbMutationQueue : public MutationQueue {
    * NOTE: There can only be one LevelDbMutationQueue for a given db at a time,
    * hence it is safe to track next_batch_id_ as an instance-level property.
    * Should we ever relax this constraint we'll need to revisit this.
+   *
+   * `kBatchIdUnknown` until the first batch is added.
    */
-  model::BatchId next_batch_id_;
+  model::BatchId next_batch_id_ = model::kBatchIdUnknown;
 
   /**
    * A write-through cache copy of the metadata describing the current queue.
    */
   nanopb::Message<firestore_client_MutationQueue> metadata_;
+
+  /**
+   * An in-memory copy of this user's document-mutation index, loaded when
+   * it's first used and kept up to date as batches are added and removed.
+   */
+  DocumentKeyReferenceSet batches_by_document_key_;
+  bool index_loaded_ = false;
+
+  /**
+   * Parsed batches of this user, by batch ID. Batches never change once added,
+   * so entries only need to be dropped when their batch is removed.
+   */
+  std::unordered_map<model::BatchId, model::MutationBatch> batch_cache_;
 };
 
 }  // namespace local
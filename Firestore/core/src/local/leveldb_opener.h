@@ -20,6 +20,7 @@
 #include <memory>
 
 #include "Firestore/core/src/core/database_info.h"
+#include "Firestore/core/src/local/leveldb_options.h"
 #include "Firestore/core/src/util/path.h"
 #include "absl/types/optional.h"
 
@@ -73,10 +74,12 @@ class LevelDbOpener {
    *   * Actually opening the LevelDB database.
    *
    * @param lru_params The LRU GC configuration to use for the instance.
+   * @param options The LevelDB tuning options to use for the instance.
    * @return A pointer to the created instance or Status indicating what failed.
    */
   util::StatusOr<std::unique_ptr<LevelDbPersistence>> Create(
-      const LruParams& lru_params);
+      const LruParams& lru_params,
+      const LevelDbOptions& options = LevelDbOptions::Default());
 
   /**
    * Finds a suitable directory to serve as the root of all Firestore local
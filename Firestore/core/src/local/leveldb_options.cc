@@ -0,0 +1,43 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/leveldb_options.h"
+
+#if defined(__APPLE__)
+#include <TargetConditionals.h>
+#endif  // defined(__APPLE__)
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+LevelDbOptions LevelDbOptions::Default() {
+#if defined(__APPLE__) && TARGET_OS_IPHONE
+  // Mobile devices are memory constrained, so use smaller buffers than
+  // LevelDB's defaults.
+  return LevelDbOptions{/* block_cache_size_bytes= */ 4 * 1024 * 1024,
+                        /* write_buffer_size_bytes= */ 2 * 1024 * 1024,
+                        /* bloom_filter_bits_per_key= */ 10};
+#else
+  return LevelDbOptions{/* block_cache_size_bytes= */ 8 * 1024 * 1024,
+                        /* write_buffer_size_bytes= */ 4 * 1024 * 1024,
+                        /* bloom_filter_bits_per_key= */ 10};
+#endif
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
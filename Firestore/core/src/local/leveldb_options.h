@@ -0,0 +1,52 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_LEVELDB_OPTIONS_H_
+#define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_OPTIONS_H_
+
+#include <cstddef>
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/** Tuning options for the LevelDB database used by `LevelDbPersistence`. */
+struct LevelDbOptions {
+  /** Returns the default options for the current platform. */
+  static LevelDbOptions Default();
+
+  /** The capacity of the cache of uncompressed table blocks, in bytes. */
+  size_t block_cache_size_bytes;
+
+  /**
+   * The amount of data kept in memory before it's written out to a table file,
+   * in bytes. Larger buffers speed up bulk writes at the cost of memory and of
+   * a longer recovery when the database is reopened.
+   */
+  size_t write_buffer_size_bytes;
+
+  /**
+   * The number of bits per key of the bloom filter that lets lookups skip
+   * table files which don't contain the key, or 0 to not use a bloom filter.
+   */
+  int bloom_filter_bits_per_key;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_LEVELDB_OPTIONS_H_
@@ -16,8 +16,10 @@
 
 #include "Firestore/core/src/local/leveldb_persistence.h"
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <limits>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/auth/user.h"
 #include "Firestore/core/src/core/database_info.h"
@@ -51,6 +53,14 @@ using util::Status;
 using util::StatusOr;
 using util::StringFormat;
 
+/**
+ * The read-only transaction running on the current thread, if any, and the
+ * persistence that started it. Read-only transactions may run on any thread,
+ * so unlike the read-write transaction they can't be a member.
+ */
+thread_local const LevelDbPersistence* read_only_transaction_owner = nullptr;
+thread_local LevelDbTransaction* read_only_transaction = nullptr;
+
 /**
  * Finds all user ids in the database based on the existence of a mutation
  * queue.
@@ -77,7 +87,10 @@ std::set<std::string> CollectUserSet(LevelDbTransaction* transaction) {
 }  // namespace
 
 StatusOr<std::unique_ptr<LevelDbPersistence>> LevelDbPersistence::Create(
-    util::Path dir, LocalSerializer serializer, const LruParams& lru_params) {
+    util::Path dir,
+    LocalSerializer serializer,
+    const LruParams& lru_params,
+    const LevelDbOptions& options) {
   auto* fs = Filesystem::Default();
   Status status = EnsureDirectory(dir);
   if (!status.ok()) return status;
@@ -85,7 +98,20 @@ StatusOr<std::unique_ptr<LevelDbPersistence>> LevelDbPersistence::Create(
   status = fs->ExcludeFromBackups(dir);
   if (!status.ok()) return status;
 
-  StatusOr<std::unique_ptr<DB>> created = OpenDb(dir);
+  std::unique_ptr<leveldb::Cache> block_cache(
+      leveldb::NewLRUCache(options.block_cache_size_bytes));
+  std::unique_ptr<const leveldb::FilterPolicy> filter_policy;
+  if (options.bloom_filter_bits_per_key > 0) {
+    filter_policy.reset(
+        leveldb::NewBloomFilterPolicy(options.bloom_filter_bits_per_key));
+  }
+
+  leveldb::Options leveldb_options;
+  leveldb_options.block_cache = block_cache.get();
+  leveldb_options.write_buffer_size = options.write_buffer_size_bytes;
+  leveldb_options.filter_policy = filter_policy.get();
+
+  StatusOr<std::unique_ptr<DB>> created = OpenDb(dir, leveldb_options);
   if (!created.ok()) return created.status();
 
   std::unique_ptr<DB> db = std::move(created).ValueOrDie();
@@ -97,17 +123,24 @@ StatusOr<std::unique_ptr<LevelDbPersistence>> LevelDbPersistence::Create(
 
   // Explicit conversion is required to allow the StatusOr to be created.
   std::unique_ptr<LevelDbPersistence> result(
-      new LevelDbPersistence(std::move(db), std::move(dir), std::move(users),
-                             std::move(serializer), lru_params));
+      new LevelDbPersistence(std::move(db), std::move(block_cache),
+                             std::move(filter_policy), std::move(dir),
+                             std::move(users), std::move(serializer),
+                             lru_params));
   return {std::move(result)};
 }
 
-LevelDbPersistence::LevelDbPersistence(std::unique_ptr<leveldb::DB> db,
-                                       util::Path directory,
-                                       std::set<std::string> users,
-                                       LocalSerializer serializer,
-                                       const LruParams& lru_params)
-    : db_(std::move(db)),
+LevelDbPersistence::LevelDbPersistence(
+    std::unique_ptr<leveldb::DB> db,
+    std::unique_ptr<leveldb::Cache> block_cache,
+    std::unique_ptr<const leveldb::FilterPolicy> filter_policy,
+    util::Path directory,
+    std::set<std::string> users,
+    LocalSerializer serializer,
+    const LruParams& lru_params)
+    : block_cache_(std::move(block_cache)),
+      filter_policy_(std::move(filter_policy)),
+      db_(std::move(db)),
       directory_(std::move(directory)),
       users_(std::move(users)),
       serializer_(std::move(serializer)) {
@@ -118,10 +151,12 @@ LevelDbPersistence::LevelDbPersistence(std::unique_ptr<leveldb::DB> db,
   reference_delegate_ =
       absl::make_unique<LevelDbLruReferenceDelegate>(this, lru_params);
   bundle_cache_ = absl::make_unique<LevelDbBundleCache>(this, &serializer_);
+  size_counters_ = absl::make_unique<LevelDbSizeCounters>(this);
 
   // TODO(gsoltis): set up a leveldb transaction for these operations.
   target_cache_->Start();
   reference_delegate_->Start();
+  size_counters_->Start();
   started_ = true;
 }
 
@@ -142,8 +177,8 @@ Status LevelDbPersistence::EnsureDirectory(const Path& dir) {
   return Status::OK();
 }
 
-StatusOr<std::unique_ptr<DB>> LevelDbPersistence::OpenDb(const Path& dir) {
-  leveldb::Options options;
+StatusOr<std::unique_ptr<DB>> LevelDbPersistence::OpenDb(
+    const Path& dir, leveldb::Options options) {
   options.create_if_missing = true;
 
   DB* database = nullptr;
@@ -161,11 +196,19 @@ StatusOr<std::unique_ptr<DB>> LevelDbPersistence::OpenDb(const Path& dir) {
 // MARK: - LevelDB utilities
 
 LevelDbTransaction* LevelDbPersistence::current_transaction() {
+  if (in_read_only_transaction()) {
+    return read_only_transaction;
+  }
+
   HARD_ASSERT(transaction_ != nullptr,
               "Attempting to access transaction before one has started");
   return transaction_.get();
 }
 
+bool LevelDbPersistence::in_read_only_transaction() const {
+  return read_only_transaction_owner == this;
+}
+
 util::Status LevelDbPersistence::ClearPersistence(
     const core::DatabaseInfo& database_info) {
   LevelDbOpener opener(database_info);
@@ -180,6 +223,88 @@ util::Status LevelDbPersistence::ClearPersistence(
 }
 
 StatusOr<int64_t> LevelDbPersistence::CalculateByteSize() {
+  if (!compaction_executor_) return CalculateDirectorySize();
+
+  {
+    std::lock_guard<std::mutex> lock(byte_size_mutex_);
+    if (directory_size_ >= 0) {
+      int64_t estimate = directory_size_ + bytes_written_;
+      compaction_executor_->Execute([this] { RefreshByteSize(); });
+      return estimate;
+    }
+  }
+
+  // Nothing to estimate from yet.
+  StatusOr<int64_t> maybe_size = CalculateDirectorySize();
+  if (maybe_size.ok()) {
+    std::lock_guard<std::mutex> lock(byte_size_mutex_);
+    directory_size_ = maybe_size.ValueOrDie();
+    bytes_written_ = 0;
+  }
+  return maybe_size;
+}
+
+void LevelDbPersistence::EnableBackgroundCompaction(
+    std::unique_ptr<util::Executor> executor) {
+  compaction_executor_ = std::move(executor);
+}
+
+void LevelDbPersistence::CompactRangeAfterCommit(std::string begin,
+                                                 std::string end) {
+  HARD_ASSERT(transaction_ != nullptr,
+              "Requesting a compaction outside of a transaction");
+  if (!compaction_executor_) return;
+
+  pending_compactions_.push_back(KeyRange{std::move(begin), std::move(end)});
+}
+
+void LevelDbPersistence::CommitTransaction(
+    LevelDbTransaction* transaction,
+    const leveldb::WriteOptions& write_options) {
+  size_t bytes_written = transaction->Commit(write_options);
+  if (!compaction_executor_) return;
+
+  {
+    std::lock_guard<std::mutex> lock(byte_size_mutex_);
+    bytes_written_ += static_cast<int64_t>(bytes_written);
+  }
+
+  if (pending_compactions_.empty()) return;
+
+  std::vector<KeyRange> ranges;
+  ranges.swap(pending_compactions_);
+  compaction_executor_->Execute([this, ranges] {
+    for (const KeyRange& range : ranges) {
+      leveldb::Slice begin(range.begin);
+      leveldb::Slice end(range.end);
+      db_->CompactRange(&begin, &end);
+    }
+    RefreshByteSize();
+  });
+}
+
+void LevelDbPersistence::RefreshByteSize() {
+  int64_t bytes_written_before;
+  {
+    std::lock_guard<std::mutex> lock(byte_size_mutex_);
+    bytes_written_before = bytes_written_;
+  }
+
+  // LevelDB may delete files while they're being sized, in which case the
+  // previous estimate remains in effect until the next refresh.
+  StatusOr<int64_t> maybe_size = CalculateDirectorySize();
+  if (!maybe_size.ok()) {
+    LOG_DEBUG("Failed to refresh the LevelDB size estimate: %s",
+              maybe_size.status().ToString());
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(byte_size_mutex_);
+  directory_size_ = maybe_size.ValueOrDie();
+  bytes_written_ -= bytes_written_before;
+}
+
+StatusOr<int64_t> LevelDbPersistence::CalculateDirectorySize() const {
   auto* fs = Filesystem::Default();
 
   // Accumulate the total size in an unsigned integer to avoid undefined
@@ -221,7 +346,11 @@ model::ListenSequenceNumber LevelDbPersistence::current_sequence_number()
 
 void LevelDbPersistence::Shutdown() {
   HARD_ASSERT(started_, "LevelDbPersistence shutdown without start!");
+  FlushDeferredCommits();
   started_ = false;
+
+  // Finishes the running compaction, if any, and drops the pending ones.
+  compaction_executor_.reset();
   db_.reset();
 }
 
@@ -233,6 +362,13 @@ LevelDbMutationQueue* LevelDbPersistence::GetMutationQueueForUser(
   return current_mutation_queue_.get();
 }
 
+LevelDbDocumentOverlayCache* LevelDbPersistence::GetDocumentOverlayCacheForUser(
+    const auth::User& user) {
+  current_overlay_cache_ =
+      absl::make_unique<LevelDbDocumentOverlayCache>(user, this, &serializer_);
+  return current_overlay_cache_.get();
+}
+
 LevelDbTargetCache* LevelDbPersistence::target_cache() {
   return target_cache_.get();
 }
@@ -254,18 +390,108 @@ LevelDbBundleCache* LevelDbPersistence::bundle_cache() {
 }
 
 void LevelDbPersistence::RunInternal(absl::string_view label,
+                                     TransactionClass transaction_class,
                                      std::function<void()> block) {
   HARD_ASSERT(transaction_ == nullptr,
               "Starting a transaction while one is already in progress");
 
-  transaction_ = absl::make_unique<LevelDbTransaction>(db_.get(), label);
+  auto start = std::chrono::steady_clock::now();
+  if (deferred_transaction_) {
+    transaction_ = std::move(deferred_transaction_);
+    transaction_->Continue(label);
+  } else {
+    transaction_ = absl::make_unique<LevelDbTransaction>(db_.get(), label);
+  }
   reference_delegate_->OnTransactionStarted(label);
+  // A continued transaction carries the counters of the ones before it.
+  TransactionCounters counters_at_start = transaction_->counters();
 
   block();
 
+  size_counters_->SaveIfChanged();
   reference_delegate_->OnTransactionCommitted();
-  transaction_->Commit();
+  if (schedule_flush_ && transaction_class == TransactionClass::Cache) {
+    deferred_transaction_ = std::move(transaction_);
+    if (!flush_scheduled_) {
+      flush_scheduled_ = true;
+      schedule_flush_([this] {
+        flush_scheduled_ = false;
+        FlushDeferredCommits();
+      });
+    }
+    RecordTransaction(label, start,
+                      deferred_transaction_->counters() - counters_at_start);
+    return;
+  }
+
+  leveldb::WriteOptions write_options =
+      LevelDbTransaction::DefaultWriteOptions();
+  write_options.sync =
+      sync_user_writes_ && transaction_class == TransactionClass::UserWrite;
+  TransactionCounters counters = transaction_->counters() - counters_at_start;
+  CommitTransaction(transaction_.get(), write_options);
   transaction_.reset();
+  RecordTransaction(label, start, counters);
+}
+
+void LevelDbPersistence::EnableGroupCommit(FlushScheduler schedule_flush) {
+  schedule_flush_ = std::move(schedule_flush);
+}
+
+void LevelDbPersistence::FlushDeferredCommits() {
+  HARD_ASSERT(transaction_ == nullptr,
+              "Flushing deferred commits while a transaction is in progress");
+  if (!deferred_transaction_) return;
+
+  CommitTransaction(deferred_transaction_.get(),
+                    LevelDbTransaction::DefaultWriteOptions());
+  deferred_transaction_.reset();
+}
+
+size_t LevelDbPersistence::ReleaseMemory() {
+  HARD_ASSERT(transaction_ == nullptr,
+              "Releasing memory while a transaction is in progress");
+
+  size_t released =
+      document_cache_->ReleaseMemory() + index_manager_->ReleaseMemory();
+
+  // Pruning only drops the blocks no iterator or read is using, so this is
+  // safe while read-only transactions run on other threads.
+  size_t block_cache_size = block_cache_->TotalCharge();
+  block_cache_->Prune();
+  size_t block_cache_pruned = block_cache_->TotalCharge();
+  if (block_cache_pruned < block_cache_size) {
+    released += block_cache_size - block_cache_pruned;
+  }
+
+  return released;
+}
+
+void LevelDbPersistence::RunReadOnlyInternal(absl::string_view label,
+                                             std::function<void()> block) {
+  HARD_ASSERT(read_only_transaction_owner == nullptr,
+              "Starting a read-only transaction while one is already in "
+              "progress on this thread");
+
+  auto start = std::chrono::steady_clock::now();
+  // The snapshot pins the state of the database as of now, so writes committed
+  // by other threads while the block runs aren't visible to it.
+  const leveldb::Snapshot* snapshot = db_->GetSnapshot();
+  leveldb::ReadOptions read_options = StandardReadOptions();
+  read_options.snapshot = snapshot;
+
+  LevelDbTransaction transaction(db_.get(), label, read_options);
+  read_only_transaction_owner = this;
+  read_only_transaction = &transaction;
+
+  block();
+
+  read_only_transaction = nullptr;
+  read_only_transaction_owner = nullptr;
+  HARD_ASSERT(transaction.changed_keys() == 0,
+              "Read-only transaction made changes: %s", transaction.ToString());
+  db_->ReleaseSnapshot(snapshot);
+  RecordTransaction(label, start, transaction.counters());
 }
 
 leveldb::ReadOptions StandardReadOptions() {
@@ -18,21 +18,29 @@
 #define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_PERSISTENCE_H_
 
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <set>
 #include <string>
+#include <vector>
 
 #include "Firestore/core/src/auth/user.h"
 #include "Firestore/core/src/local/leveldb_bundle_cache.h"
+#include "Firestore/core/src/local/leveldb_document_overlay_cache.h"
 #include "Firestore/core/src/local/leveldb_index_manager.h"
 #include "Firestore/core/src/local/leveldb_lru_reference_delegate.h"
 #include "Firestore/core/src/local/leveldb_mutation_queue.h"
+#include "Firestore/core/src/local/leveldb_options.h"
 #include "Firestore/core/src/local/leveldb_remote_document_cache.h"
+#include "Firestore/core/src/local/leveldb_size_counters.h"
 #include "Firestore/core/src/local/leveldb_target_cache.h"
 #include "Firestore/core/src/local/leveldb_transaction.h"
 #include "Firestore/core/src/local/local_serializer.h"
 #include "Firestore/core/src/local/persistence.h"
+#include "Firestore/core/src/util/executor.h"
 #include "Firestore/core/src/util/path.h"
 #include "Firestore/core/src/util/statusor.h"
+#include "leveldb/cache.h"
+#include "leveldb/filter_policy.h"
 
 namespace firebase {
 namespace firestore {
@@ -52,14 +60,30 @@ class LevelDbPersistence : public Persistence {
   /**
    * Creates a LevelDB in the given directory and returns it or a Status object
    * containing details of the failure.
+   *
+   * @param options The LevelDB tuning options to open the database with.
    */
   static util::StatusOr<std::unique_ptr<LevelDbPersistence>> Create(
-      util::Path dir, LocalSerializer serializer, const LruParams& lru_params);
+      util::Path dir,
+      LocalSerializer serializer,
+      const LruParams& lru_params,
+      const LevelDbOptions& options = LevelDbOptions::Default());
 
   ~LevelDbPersistence();
 
+  /**
+   * Returns the transaction running on the current thread: the read-only
+   * transaction started by `RunReadOnly()` if one is running on this thread,
+   * otherwise the transaction started by `Run()`.
+   */
   LevelDbTransaction* current_transaction();
 
+  /**
+   * Returns true if the current thread is running a read-only transaction of
+   * this persistence.
+   */
+  bool in_read_only_transaction() const;
+
   leveldb::DB* ptr() {
     return db_.get();
   }
@@ -70,8 +94,67 @@ class LevelDbPersistence : public Persistence {
 
   static util::Status ClearPersistence(const core::DatabaseInfo& database_info);
 
+  /**
+   * The byte sizes of the remote documents, targets and mutations tables,
+   * maintained as rows are written.
+   */
+  LevelDbSizeCounters* size_counters() {
+    return size_counters_.get();
+  }
+
+  /**
+   * Returns the approximate size of the database on disk, in bytes.
+   *
+   * With background compaction enabled, this is the size found by the last
+   * scan of the database directory plus the bytes written since then, and the
+   * directory is rescanned in the background. Otherwise, the directory is
+   * scanned on every call.
+   */
   util::StatusOr<int64_t> CalculateByteSize();
 
+  /**
+   * Enables background compaction: the key ranges requested with
+   * `CompactRangeAfterCommit()` are compacted on `executor` once the
+   * transaction that requested them has been written out, so the space of the
+   * rows it deleted is reclaimed promptly rather than whenever LevelDB gets to
+   * compacting them.
+   */
+  void EnableBackgroundCompaction(std::unique_ptr<util::Executor> executor);
+
+  /**
+   * Requests that the keys from `begin` to `end`, inclusive, be compacted in
+   * the background after the current transaction has been written out. Does
+   * nothing unless background compaction is enabled.
+   */
+  void CompactRangeAfterCommit(std::string begin, std::string end);
+
+  /**
+   * A function that schedules the given flush to run on the thread running
+   * transactions, after the work that's already pending there.
+   */
+  using FlushScheduler = std::function<void(std::function<void()>)>;
+
+  /**
+   * Enables group commit: the commits of `TransactionClass::Cache`
+   * transactions are deferred, and merged with those of subsequent
+   * transactions until the flush scheduled with `schedule_flush` runs. This
+   * turns a burst of small transactions run back to back into a single
+   * LevelDB write.
+   *
+   * Deferred changes are visible to subsequent transactions, but not to
+   * read-only ones, which read only changes that have been written out, nor
+   * to other processes. `FlushDeferredCommits()` writes them out early.
+   */
+  void EnableGroupCommit(FlushScheduler schedule_flush);
+
+  /**
+   * Sets whether commits of `TransactionClass::UserWrite` transactions wait
+   * for LevelDB to sync its log to disk.
+   */
+  void set_sync_user_writes(bool sync_user_writes) {
+    sync_user_writes_ = sync_user_writes;
+  }
+
   // MARK: Persistence overrides
 
   model::ListenSequenceNumber current_sequence_number() const override;
@@ -83,6 +166,9 @@ class LevelDbPersistence : public Persistence {
   LevelDbMutationQueue* GetMutationQueueForUser(
       const auth::User& user) override;
 
+  LevelDbDocumentOverlayCache* GetDocumentOverlayCacheForUser(
+      const auth::User& user) override;
+
   LevelDbTargetCache* target_cache() override;
 
   LevelDbRemoteDocumentCache* remote_document_cache() override;
@@ -91,16 +177,31 @@ class LevelDbPersistence : public Persistence {
 
   LevelDbLruReferenceDelegate* reference_delegate() override;
 
+  bool supports_concurrent_reads() const override {
+    return true;
+  }
+
+  void FlushDeferredCommits() override;
+
+  size_t ReleaseMemory() override;
+
  protected:
   void RunInternal(absl::string_view label,
+                   TransactionClass transaction_class,
                    std::function<void()> block) override;
 
+  void RunReadOnlyInternal(absl::string_view label,
+                           std::function<void()> block) override;
+
  private:
-  LevelDbPersistence(std::unique_ptr<leveldb::DB> db,
-                     util::Path directory,
-                     std::set<std::string> users,
-                     LocalSerializer serializer,
-                     const LruParams& lru_params);
+  LevelDbPersistence(
+      std::unique_ptr<leveldb::DB> db,
+      std::unique_ptr<leveldb::Cache> block_cache,
+      std::unique_ptr<const leveldb::FilterPolicy> filter_policy,
+      util::Path directory,
+      std::set<std::string> users,
+      LocalSerializer serializer,
+      const LruParams& lru_params);
 
   /**
    * Ensures that the given directory exists.
@@ -109,8 +210,30 @@ class LevelDbPersistence : public Persistence {
 
   /** Opens the database within the given directory. */
   static util::StatusOr<std::unique_ptr<leveldb::DB>> OpenDb(
-      const util::Path& dir);
+      const util::Path& dir, leveldb::Options options);
+
+  /** A range of keys, from `begin` to `end` inclusive. */
+  struct KeyRange {
+    std::string begin;
+    std::string end;
+  };
+
+  /** Returns the total size of the files in the database directory. */
+  util::StatusOr<int64_t> CalculateDirectorySize() const;
 
+  /**
+   * Commits the given transaction and updates the byte size estimate and
+   * pending compactions accordingly.
+   */
+  void CommitTransaction(LevelDbTransaction* transaction,
+                         const leveldb::WriteOptions& write_options);
+
+  /** Rescans the database directory. Runs on the compaction executor. */
+  void RefreshByteSize();
+
+  // The block cache and filter policy are used by `db_` and must outlive it.
+  std::unique_ptr<leveldb::Cache> block_cache_;
+  std::unique_ptr<const leveldb::FilterPolicy> filter_policy_;
   std::unique_ptr<leveldb::DB> db_;
 
   util::Path directory_;
@@ -120,12 +243,34 @@ class LevelDbPersistence : public Persistence {
 
   std::unique_ptr<LevelDbBundleCache> bundle_cache_;
   std::unique_ptr<LevelDbMutationQueue> current_mutation_queue_;
+  std::unique_ptr<LevelDbDocumentOverlayCache> current_overlay_cache_;
   std::unique_ptr<LevelDbTargetCache> target_cache_;
   std::unique_ptr<LevelDbRemoteDocumentCache> document_cache_;
   std::unique_ptr<LevelDbIndexManager> index_manager_;
   std::unique_ptr<LevelDbLruReferenceDelegate> reference_delegate_;
+  std::unique_ptr<LevelDbSizeCounters> size_counters_;
 
   std::unique_ptr<LevelDbTransaction> transaction_;
+
+  FlushScheduler schedule_flush_;
+  bool sync_user_writes_ = false;
+
+  // A committed transaction whose changes haven't been written yet, and
+  // whether a flush that writes them is scheduled.
+  std::unique_ptr<LevelDbTransaction> deferred_transaction_;
+  bool flush_scheduled_ = false;
+
+  // The size found by the last scan of the database directory, or -1 if it
+  // hasn't been scanned yet, and the bytes written since the scan started.
+  std::mutex byte_size_mutex_;
+  int64_t directory_size_ = -1;
+  int64_t bytes_written_ = 0;
+
+  // Declared after `db_` and the byte size state so that it's destroyed, and
+  // its pending compactions and rescans are finished or dropped, before the
+  // database is closed and the state they update goes away.
+  std::unique_ptr<util::Executor> compaction_executor_;
+  std::vector<KeyRange> pending_compactions_;
 };
 
 /** Returns a standard set of read options. */
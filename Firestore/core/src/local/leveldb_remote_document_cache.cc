@@ -16,14 +16,24 @@
 
 #include "Firestore/core/src/local/leveldb_remote_document_cache.h"
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <utility>
+#include <vector>
 
 #include "Firestore/Protos/nanopb/firestore/local/maybe_document.nanopb.h"
+#include "Firestore/core/src/core/bound.h"
 #include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/core/query_matcher.h"
+#include "Firestore/core/src/local/bundle_document_source.h"
 #include "Firestore/core/src/local/leveldb_key.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_size_counters.h"
 #include "Firestore/core/src/local/local_serializer.h"
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/document_map.h"
@@ -31,8 +41,10 @@
 #include "Firestore/core/src/nanopb/reader.h"
 #include "Firestore/core/src/util/background_queue.h"
 #include "Firestore/core/src/util/executor.h"
+#include "Firestore/core/src/util/parallel_collector.h"
 #include "Firestore/core/src/util/status.h"
 #include "Firestore/core/src/util/string_util.h"
+#include "absl/strings/match.h"
 #include "leveldb/db.h"
 
 namespace firebase {
@@ -40,12 +52,15 @@ namespace firestore {
 namespace local {
 namespace {
 
+using core::Bound;
+using core::Direction;
 using core::Query;
 using leveldb::Status;
 using model::Document;
 using model::DocumentKey;
 using model::DocumentKeySet;
 using model::DocumentMap;
+using model::FieldValue;
 using model::MaybeDocument;
 using model::MaybeDocumentMap;
 using model::OptionalMaybeDocumentMap;
@@ -58,49 +73,171 @@ using util::BackgroundQueue;
 using util::Executor;
 
 /**
- * An accumulator for results produced asynchronously. This accumulates
- * values in a vector to avoid contention caused by accumulating into more
- * complex structures like immutable::SortedMap.
+ * The number of documents decoded by each background task. Large enough to
+ * amortize task scheduling, small enough to spread the work of typical queries
+ * across cores.
+ */
+constexpr size_t kDecodeChunkSize = 32;
+
+/**
+ * The number of documents encoded by each background task when adding a batch
+ * of documents. Batches no larger than this are encoded on the calling thread.
+ */
+constexpr size_t kEncodeChunkSize = 32;
+
+/**
+ * A batch of encoded documents awaiting decoding.
+ *
+ * LevelDB only guarantees that the bytes an iterator points to stay valid until
+ * the iterator moves, so documents have to be copied before they can be decoded
+ * on another thread. A chunk copies them all into a single buffer, so that
+ * filling it costs one allocation per chunk rather than one per document, and
+ * hands out views into that buffer for decoding.
+ */
+class EncodedChunk {
+ public:
+  EncodedChunk() {
+    entries_.reserve(kDecodeChunkSize);
+  }
+
+  void Add(const DocumentKey& key, absl::string_view contents) {
+    entries_.push_back(Entry{key, buffer_.size(), contents.size()});
+    buffer_.append(contents.data(), contents.size());
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  const DocumentKey& key(size_t i) const {
+    return entries_[i].key;
+  }
+
+  absl::string_view contents(size_t i) const {
+    return absl::string_view(buffer_).substr(entries_[i].offset,
+                                             entries_[i].size);
+  }
+
+ private:
+  struct Entry {
+    DocumentKey key;
+    size_t offset;
+    size_t size;
+  };
+
+  std::vector<Entry> entries_;
+  std::string buffer_;
+};
+
+/**
+ * Collects encoded documents read from LevelDB and hands them to a decode
+ * function on a BackgroundQueue, one chunk of documents per task.
+ *
+ * Each task writes its results to its own shard of a ParallelCollector, so
+ * decoding threads never contend on a lock, and the results come out in the
+ * order the documents were added.
  */
 template <typename T>
-class AsyncResults {
+class ChunkedDecoder {
  public:
-  void Insert(T&& value) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    values_.push_back(std::move(value));
+  using Chunk = EncodedChunk;
+  using DecodeFunction = std::function<void(const Chunk&, std::vector<T>*)>;
+
+  /**
+   * Creates a decoder that runs `decode` on `tasks`. The decode function
+   * appends its results for a chunk to the given vector.
+   */
+  ChunkedDecoder(BackgroundQueue* tasks, DecodeFunction decode)
+      : tasks_(tasks), decode_(std::move(decode)) {
   }
 
-  void Insert(const T& value) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    values_.push_back(value);
+  void Add(const DocumentKey& key, absl::string_view contents) {
+    if (!chunk_) {
+      chunk_ = std::make_shared<Chunk>();
+    }
+    chunk_->Add(key, contents);
+    if (chunk_->size() == kDecodeChunkSize) {
+      Flush();
+    }
   }
 
   /**
-   * Returns the accumulated result, moving it out of AsyncResults. The
-   * AsyncResults object should not be reused.
+   * Decodes any remaining documents, waits for all decoding to finish and
+   * returns the decoded values in the order their documents were added.
    */
-  std::vector<T> Result() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return std::move(values_);
+  std::vector<T> AwaitResult() {
+    Flush();
+    tasks_->AwaitAll();
+    return results_.Result();
   }
 
  private:
-  std::vector<T> values_;
-  std::mutex mutex_;
+  void Flush() {
+    if (!chunk_) return;
+
+    std::shared_ptr<Chunk> chunk = std::move(chunk_);
+    chunk_.reset();
+
+    std::vector<T>* shard = results_.NewShard();
+    shard->reserve(chunk->size());
+    tasks_->Execute([this, chunk, shard] { decode_(*chunk, shard); });
+  }
+
+  BackgroundQueue* tasks_ = nullptr;
+  DecodeFunction decode_;
+  std::shared_ptr<Chunk> chunk_;
+  util::ParallelCollector<T> results_;
 };
 
+/**
+ * Returns the executor that decodes documents for all caches in the process,
+ * so that several Firestore instances share one bounded set of threads. The
+ * executor is released once no cache uses it.
+ */
+std::shared_ptr<Executor> SharedQueryExecutor() {
+  static auto* mutex = new std::mutex();
+  static auto* shared = new std::weak_ptr<Executor>();
+
+  std::lock_guard<std::mutex> lock(*mutex);
+  std::shared_ptr<Executor> executor = shared->lock();
+  if (!executor) {
+    auto hw_concurrency = std::thread::hardware_concurrency();
+    if (hw_concurrency == 0) {
+      // If the standard library doesn't know, guess something reasonable.
+      hw_concurrency = 4;
+    }
+    // The worker queue waits for the decoded documents.
+    executor = Executor::CreateConcurrent("com.google.firebase.firestore.query",
+                                          static_cast<int>(hw_concurrency),
+                                          Executor::Priority::UserInitiated);
+    *shared = executor;
+  }
+  return executor;
+}
+
+/**
+ * Returns the ID of the document in the given collection that the given bound
+ * starts or ends at, or nullopt if the bound doesn't name one.
+ */
+absl::optional<std::string> BoundDocumentId(
+    const std::shared_ptr<Bound>& bound, const ResourcePath& collection_path) {
+  if (!bound || bound->position().empty()) return absl::nullopt;
+
+  const FieldValue& value = bound->position().front();
+  if (!value.is_reference()) return absl::nullopt;
+
+  const ResourcePath& path = value.reference_value().key().path();
+  if (!collection_path.IsImmediateParentOf(path)) return absl::nullopt;
+  return path.last_segment();
+}
+
 }  // namespace
 
 LevelDbRemoteDocumentCache::LevelDbRemoteDocumentCache(
     LevelDbPersistence* db, LocalSerializer* serializer)
-    : db_(db), serializer_(NOT_NULL(serializer)) {
-  auto hw_concurrency = std::thread::hardware_concurrency();
-  if (hw_concurrency == 0) {
-    // If the standard library doesn't know, guess something reasonable.
-    hw_concurrency = 4;
-  }
-  executor_ = Executor::CreateConcurrent("com.google.firebase.firestore.query",
-                                         static_cast<int>(hw_concurrency));
+    : db_(db),
+      serializer_(NOT_NULL(serializer)),
+      executor_(SharedQueryExecutor()) {
 }
 
 // Out of line because of unique_ptrs to incomplete types.
@@ -108,35 +245,92 @@ LevelDbRemoteDocumentCache::~LevelDbRemoteDocumentCache() = default;
 
 void LevelDbRemoteDocumentCache::Add(const MaybeDocument& document,
                                      const SnapshotVersion& read_time) {
+  AddEncoded(document, read_time,
+             serializer_->EncodeMaybeDocumentToString(document));
+}
+
+void LevelDbRemoteDocumentCache::AddAll(
+    const std::vector<DocumentReadTime>& documents) {
+  // Encoding dominates the cost of adding a document and only depends on the
+  // document, so it runs on the executor. The rows are still written on this
+  // thread and in order, since the transaction isn't thread-safe.
+  std::vector<std::string> encoded;
+  if (documents.size() <= kEncodeChunkSize) {
+    encoded.reserve(documents.size());
+    for (const auto& entry : documents) {
+      encoded.push_back(serializer_->EncodeMaybeDocumentToString(entry.first));
+    }
+  } else {
+    BackgroundQueue tasks(executor_.get());
+    util::ParallelCollector<std::string> results;
+    for (size_t begin = 0; begin < documents.size();
+         begin += kEncodeChunkSize) {
+      size_t end = std::min(begin + kEncodeChunkSize, documents.size());
+      std::vector<std::string>* shard = results.NewShard();
+      shard->reserve(end - begin);
+      tasks.Execute([this, &documents, begin, end, shard] {
+        for (size_t i = begin; i < end; ++i) {
+          shard->push_back(
+              serializer_->EncodeMaybeDocumentToString(documents[i].first));
+        }
+      });
+    }
+    tasks.AwaitAll();
+    encoded = results.Result();
+  }
+
+  for (size_t i = 0; i < documents.size(); ++i) {
+    AddEncoded(documents[i].first, documents[i].second,
+               std::move(encoded[i]));
+  }
+}
+
+void LevelDbRemoteDocumentCache::AddEncoded(const MaybeDocument& document,
+                                            const SnapshotVersion& read_time,
+                                            std::string encoded) {
   const DocumentKey& key = document.key();
   const ResourcePath& path = key.path();
-
-  std::string ldb_document_key = LevelDbRemoteDocumentKey::Key(key);
-  db_->current_transaction()->Put(ldb_document_key,
-                                  serializer_->EncodeMaybeDocument(document));
+  ResourcePath collection_path = path.PopLast();
+
+  int32_t collection_number = collection_dictionary_.FindOrAssign(
+      db_->current_transaction(), collection_path);
+  std::string ldb_document_key =
+      LevelDbCollectionDocumentKey::Key(collection_number, path.last_segment());
+  db_->size_counters()->RecordPut(SizedTable::RemoteDocuments,
+                                  ldb_document_key, encoded.size());
+  db_->current_transaction()->Put(std::move(ldb_document_key),
+                                  std::move(encoded));
+  decoded_document_cache_.Remove(key);
 
   std::string ldb_read_time_key = LevelDbRemoteDocumentReadTimeKey::Key(
-      path.PopLast(), read_time, path.last_segment());
+      collection_path, read_time, path.last_segment());
   db_->current_transaction()->Put(ldb_read_time_key, "");
 
-  db_->index_manager()->AddToCollectionParentIndex(
-      document.key().path().PopLast());
+  db_->index_manager()->AddToCollectionParentIndex(collection_path);
+  db_->index_manager()->UpdateIndexEntries(document);
 }
 
 void LevelDbRemoteDocumentCache::Remove(const DocumentKey& key) {
-  std::string ldb_key = LevelDbRemoteDocumentKey::Key(key);
-  db_->current_transaction()->Delete(ldb_key);
+  absl::optional<std::string> ldb_key = DocumentRowKey(key);
+  if (ldb_key) {
+    db_->size_counters()->RecordDelete(SizedTable::RemoteDocuments, *ldb_key);
+    db_->current_transaction()->Delete(*ldb_key);
+  }
+  decoded_document_cache_.Remove(key);
+
+  db_->index_manager()->RemoveIndexEntries(key);
 }
 
 absl::optional<MaybeDocument> LevelDbRemoteDocumentCache::Get(
     const DocumentKey& key) {
-  std::string ldb_key = LevelDbRemoteDocumentKey::Key(key);
+  absl::optional<std::string> ldb_key = DocumentRowKey(key);
   std::string value;
-  Status status = db_->current_transaction()->Get(ldb_key, &value);
+  Status status = ldb_key ? db_->current_transaction()->Get(*ldb_key, &value)
+                          : Status::NotFound(key.ToString());
   if (status.IsNotFound()) {
-    return absl::nullopt;
+    return bundle_source_ ? bundle_source_->Get(key) : absl::nullopt;
   } else if (status.ok()) {
-    return DecodeMaybeDocument(value, key);
+    return DecodeMaybeDocumentCached(value, key);
   } else {
     HARD_FAIL("Fetch document for key (%s) failed with status: %s",
               key.ToString(), status.ToString());
@@ -145,59 +339,173 @@ absl::optional<MaybeDocument> LevelDbRemoteDocumentCache::Get(
 
 OptionalMaybeDocumentMap LevelDbRemoteDocumentCache::GetAll(
     const DocumentKeySet& keys) {
+  using Entry = std::pair<DocumentKey, absl::optional<MaybeDocument>>;
+
   BackgroundQueue tasks(executor_.get());
-  AsyncResults<std::pair<DocumentKey, absl::optional<MaybeDocument>>> results;
+  ChunkedDecoder<Entry> decoder(
+      &tasks, [this](const ChunkedDecoder<Entry>::Chunk& chunk,
+                     std::vector<Entry>* decoded) {
+        for (size_t i = 0; i < chunk.size(); ++i) {
+          decoded->emplace_back(
+              chunk.key(i), DecodeMaybeDocumentCached(chunk.contents(i),
+                                                      chunk.key(i)));
+        }
+      });
+
+  std::vector<Entry> missing;
 
-  LevelDbRemoteDocumentKey current_key;
   auto it = db_->current_transaction()->NewIterator();
 
   for (const DocumentKey& key : keys) {
-    it->Seek(LevelDbRemoteDocumentKey::Key(key));
-    if (!it->Valid() || !current_key.Decode(it->key()) ||
-        current_key.document_key() != key) {
-      results.Insert(std::make_pair(key, absl::nullopt));
+    absl::optional<std::string> ldb_key = DocumentRowKey(key);
+    if (ldb_key) {
+      it->Seek(*ldb_key);
+    }
+    if (!ldb_key || !it->Valid() || it->key() != *ldb_key) {
+      missing.emplace_back(key, bundle_source_ ? bundle_source_->Get(key)
+                                               : absl::nullopt);
     } else {
-      const std::string& contents = it->value();
-      tasks.Execute([this, &results, &key, contents] {
-        results.Insert(std::make_pair(key, DecodeMaybeDocument(contents, key)));
-      });
+      decoder.Add(key, it->value());
     }
   }
 
-  tasks.AwaitAll();
-
-  OptionalMaybeDocumentMap map;
-  for (const auto& entry : results.Result()) {
-    map = map.insert(entry.first, entry.second);
-  }
-  return map;
+  // Both the missing and the decoded entries are in key order, so they can be
+  // merged and the map built without any rebalancing.
+  std::vector<Entry> found = decoder.AwaitResult();
+  std::vector<Entry> entries;
+  entries.reserve(missing.size() + found.size());
+  std::merge(std::make_move_iterator(missing.begin()),
+             std::make_move_iterator(missing.end()),
+             std::make_move_iterator(found.begin()),
+             std::make_move_iterator(found.end()), std::back_inserter(entries),
+             [](const Entry& lhs, const Entry& rhs) {
+               return lhs.first < rhs.first;
+             });
+  return OptionalMaybeDocumentMap::FromSortedRange(
+      std::make_move_iterator(entries.begin()),
+      std::make_move_iterator(entries.end()));
 }
 
 DocumentMap LevelDbRemoteDocumentCache::GetAllExisting(
     const DocumentKeySet& keys) {
-  DocumentMap results;
+  DocumentMap::Builder results;
 
   OptionalMaybeDocumentMap docs = LevelDbRemoteDocumentCache::GetAll(keys);
   for (const auto& kv : docs) {
     const DocumentKey& key = kv.first;
     const auto& maybe_doc = kv.second;
     if (maybe_doc && maybe_doc->is_document()) {
-      results = results.insert(key, Document(*maybe_doc));
+      results.insert(key, Document(*maybe_doc));
     }
   }
 
-  return results;
+  return results.Build();
+}
+
+void LevelDbRemoteDocumentCache::AttachBundleDocumentSource(
+    std::unique_ptr<BundleDocumentSource> source) {
+  bundle_source_ = std::move(source);
 }
 
 DocumentMap LevelDbRemoteDocumentCache::GetMatching(
     const Query& query, const SnapshotVersion& since_read_time) {
+  DocumentMap results = GetMatchingInLevelDb(query, since_read_time);
+  if (bundle_source_) {
+    results = AddBundleSourceDocuments(query, since_read_time,
+                                       std::move(results));
+  }
+  return results;
+}
+
+DocumentMap LevelDbRemoteDocumentCache::GetMatchingInCollections(
+    const Query& query,
+    const std::vector<ResourcePath>& collection_paths,
+    const SnapshotVersion& since_read_time) {
+  // A field index spans the whole collection group, so a single scan of it
+  // yields the candidates in all the collections, and they're decoded in
+  // parallel by `GetAllExisting`.
+  absl::optional<DocumentKeySet> indexed_keys;
+  if (since_read_time == SnapshotVersion::None()) {
+    indexed_keys = db_->index_manager()->GetDocumentsMatchingQuery(query);
+  }
+  if (indexed_keys) {
+    DocumentMap results = GetAllExisting(*indexed_keys);
+    if (bundle_source_) {
+      for (const ResourcePath& collection_path : collection_paths) {
+        results = AddBundleSourceDocuments(
+            query.AsCollectionQueryAtPath(collection_path), since_read_time,
+            std::move(results));
+      }
+    }
+    return results;
+  }
+
+  // Otherwise each collection is a separate range of rows. The scans share
+  // the transaction, so they run one after another.
+  DocumentMap::Builder results;
+  for (const ResourcePath& collection_path : collection_paths) {
+    DocumentMap collection_results = GetMatching(
+        query.AsCollectionQueryAtPath(collection_path), since_read_time);
+    for (const auto& kv : collection_results.underlying_map()) {
+      results.insert(kv.first, Document(kv.second));
+    }
+  }
+  return results.Build();
+}
+
+DocumentMap LevelDbRemoteDocumentCache::GetMatchingCandidates(
+    const Query& query, const DocumentKeySet& candidate_keys) {
+  DocumentMap results = GetAllExisting(candidate_keys);
+  if (bundle_source_) {
+    results = AddBundleSourceDocuments(query, SnapshotVersion::None(),
+                                       std::move(results));
+  }
+  return results;
+}
+
+DocumentMap LevelDbRemoteDocumentCache::AddBundleSourceDocuments(
+    const Query& query,
+    const SnapshotVersion& since_read_time,
+    DocumentMap results) {
+  // Field indexes don't cover the attached documents, so the whole collection
+  // is matched against the query.
+  core::QueryMatcher matcher(query);
+  auto it = db_->current_transaction()->NewIterator();
+  bundle_source_->EnumerateKeys(
+      query.path(),
+      [&](const DocumentKey& key, const SnapshotVersion& read_time) {
+        if (since_read_time != SnapshotVersion::None() &&
+            read_time <= since_read_time) {
+          return true;
+        }
+
+        absl::optional<std::string> ldb_key = DocumentRowKey(key);
+        if (ldb_key) {
+          it->Seek(*ldb_key);
+          if (it->Valid() && it->key() == *ldb_key) {
+            return true;
+          }
+        }
+
+        absl::optional<MaybeDocument> maybe_doc = bundle_source_->Get(key);
+        if (maybe_doc && maybe_doc->is_document()) {
+          Document doc(std::move(*maybe_doc));
+          if (matcher.Matches(doc)) {
+            results = results.insert(key, std::move(doc));
+          }
+        }
+        return true;
+      });
+  return results;
+}
+
+DocumentMap LevelDbRemoteDocumentCache::GetMatchingInLevelDb(
+    const Query& query, const SnapshotVersion& since_read_time) {
   HARD_ASSERT(
       !query.IsCollectionGroupQuery(),
       "CollectionGroup queries should be handled in LocalDocumentsView");
 
-  // Use the query path as a prefix for testing if a document matches the query.
   const ResourcePath& query_path = query.path();
-  size_t immediate_children_path_length = query_path.size() + 1;
 
   if (since_read_time != SnapshotVersion::None()) {
     // Execute an index-free query and filter by read time. This is safe since
@@ -226,51 +534,156 @@ DocumentMap LevelDbRemoteDocumentCache::GetMatching(
     }
 
     return LevelDbRemoteDocumentCache::GetAllExisting(remote_keys);
+  }
+
+  // If a field index covers the query, only the documents in the matching
+  // index range need to be read.
+  absl::optional<DocumentKeySet> indexed_keys =
+      db_->index_manager()->GetDocumentsMatchingQuery(query);
+  if (indexed_keys) {
+    return LevelDbRemoteDocumentCache::GetAllExisting(*indexed_keys);
   } else {
+    absl::optional<int32_t> collection_number =
+        collection_dictionary_.Find(db_->current_transaction(), query_path);
+    if (!collection_number) {
+      return DocumentMap{};
+    }
+
+    // Documents are matched against the query while they're decoded, and
+    // only the fields the query reads are decoded until a document matches.
+    // Documents that don't match are dropped: LocalDocumentsView reads the
+    // base documents of local patches separately, so it doesn't need them.
+    core::QueryMatcher matcher(query);
+
     BackgroundQueue tasks(executor_.get());
-    AsyncResults<Document> results;
+    ChunkedDecoder<Document> decoder(
+        &tasks, [this, &matcher](const ChunkedDecoder<Document>::Chunk& chunk,
+                                 std::vector<Document>* decoded) {
+          for (size_t i = 0; i < chunk.size(); ++i) {
+            MaybeDocument maybe_doc =
+                DecodeMaybeDocumentLazily(chunk.contents(i), chunk.key(i));
+            if (!maybe_doc.is_document()) continue;
+
+            Document doc(std::move(maybe_doc));
+            if (matcher.Matches(doc)) {
+              // Finish decoding on this thread rather than the caller's.
+              doc.data();
+              decoded->push_back(std::move(doc));
+            }
+          }
+        });
+
+    // The documents of the collection, and only those, are stored under its
+    // number in document key order, so documents in subcollections never
+    // have to be skipped.
+    std::string start_key =
+        LevelDbCollectionDocumentKey::KeyPrefix(*collection_number);
+
+    // Rows are in document ID order, so the bounds of a query ordered by key
+    // first turn into the first and last rows to scan: paging through the
+    // collection with cursors reads only the requested page. Both ends are
+    // inclusive; the matcher decides about the documents at the bounds.
+    absl::optional<std::string> first_id;
+    absl::optional<std::string> last_id;
+    if (query.order_bys().front().field().IsKeyFieldPath()) {
+      bool ascending =
+          query.order_bys().front().direction() == Direction::Ascending;
+      first_id = BoundDocumentId(
+          ascending ? query.start_at() : query.end_at(), query_path);
+      last_id = BoundDocumentId(ascending ? query.end_at() : query.start_at(),
+                                query_path);
+    }
 
-    // Documents are ordered by key, so we can use a prefix scan to narrow down
-    // the documents we need to match the query against.
-    std::string start_key = LevelDbRemoteDocumentKey::KeyPrefix(query_path);
     auto it = db_->current_transaction()->NewIterator();
-    it->Seek(start_key);
+    it->Seek(first_id ? LevelDbCollectionDocumentKey::Key(*collection_number,
+                                                          *first_id)
+                      : start_key);
+
+    LevelDbCollectionDocumentKey current_key;
+    for (; it->Valid() && absl::StartsWith(it->key(), start_key) &&
+           current_key.Decode(it->key());
+         it->Next()) {
+      if (last_id && current_key.document_id() > *last_id) break;
+
+      decoder.Add(DocumentKey{query_path.Append(current_key.document_id())},
+                  it->value());
+    }
 
-    LevelDbRemoteDocumentKey current_key;
-    for (; it->Valid() && current_key.Decode(it->key()); it->Next()) {
-      // The query is actually returning any path that starts with the query
-      // path prefix which may include documents in subcollections. For example,
-      // a query on 'rooms' will return rooms/abc/messages/xyx but we shouldn't
-      // match it. Fix this by discarding rows with document keys more than one
-      // segment longer than the query path.
-      const DocumentKey& document_key = current_key.document_key();
-      if (document_key.path().size() != immediate_children_path_length) {
-        continue;
-      }
+    // Decoded documents come back in key order, so the builder doesn't need to
+    // sort them.
+    DocumentMap::Builder map;
+    for (const Document& doc : decoder.AwaitResult()) {
+      map.insert(doc.key(), doc);
+    }
+    return map.Build();
+  }
+}
 
-      if (!query_path.IsPrefixOf(document_key.path())) {
-        break;
-      }
+void LevelDbRemoteDocumentCache::EnumerateMatching(
+    const Query& query, const DocumentVisitor& visitor) {
+  HARD_ASSERT(
+      !query.IsCollectionGroupQuery(),
+      "CollectionGroup queries should be handled in LocalDocumentsView");
 
-      const std::string& contents = it->value();
-      tasks.Execute([this, &results, document_key, contents] {
-        MaybeDocument maybe_doc = DecodeMaybeDocument(contents, document_key);
-        if (maybe_doc.is_document()) {
-          results.Insert(Document(maybe_doc));
-        }
-      });
+  // Merging the attached documents into the scan isn't worth it; they're
+  // matched in full anyway.
+  if (bundle_source_) {
+    DocumentMap results = GetMatching(query, SnapshotVersion::None());
+    for (const auto& entry : results.underlying_map()) {
+      if (!visitor(Document(entry.second))) return;
     }
+    return;
+  }
 
-    tasks.AwaitAll();
+  // Index candidates are sorted by key, so they can be read lazily as well.
+  absl::optional<DocumentKeySet> indexed_keys =
+      db_->index_manager()->GetDocumentsMatchingQuery(query);
+  if (indexed_keys) {
+    for (const DocumentKey& key : *indexed_keys) {
+      absl::optional<MaybeDocument> maybe_doc = Get(key);
+      if (maybe_doc && maybe_doc->is_document() &&
+          !visitor(Document(*maybe_doc))) {
+        return;
+      }
+    }
+    return;
+  }
 
-    DocumentMap map;
-    for (const Document& doc : results.Result()) {
-      map = map.insert(doc.key(), doc);
+  const ResourcePath& query_path = query.path();
+  absl::optional<int32_t> collection_number =
+      collection_dictionary_.Find(db_->current_transaction(), query_path);
+  if (!collection_number) return;
+
+  std::string start_key =
+      LevelDbCollectionDocumentKey::KeyPrefix(*collection_number);
+  auto it = db_->current_transaction()->NewIterator();
+  it->Seek(start_key);
+
+  LevelDbCollectionDocumentKey current_key;
+  for (; it->Valid() && absl::StartsWith(it->key(), start_key) &&
+         current_key.Decode(it->key());
+       it->Next()) {
+    DocumentKey document_key{query_path.Append(current_key.document_id())};
+    MaybeDocument maybe_doc =
+        DecodeMaybeDocumentLazily(it->value(), document_key);
+    if (maybe_doc.is_document() && !visitor(Document(maybe_doc))) {
+      return;
     }
-    return map;
   }
 }
 
+absl::optional<std::string> LevelDbRemoteDocumentCache::DocumentRowKey(
+    const DocumentKey& key) {
+  const ResourcePath& path = key.path();
+  absl::optional<int32_t> collection_number =
+      collection_dictionary_.Find(db_->current_transaction(), path.PopLast());
+  if (!collection_number) {
+    return absl::nullopt;
+  }
+  return LevelDbCollectionDocumentKey::Key(*collection_number,
+                                           path.last_segment());
+}
+
 MaybeDocument LevelDbRemoteDocumentCache::DecodeMaybeDocument(
     absl::string_view encoded, const DocumentKey& key) {
   StringReader reader{encoded};
@@ -290,6 +703,38 @@ MaybeDocument LevelDbRemoteDocumentCache::DecodeMaybeDocument(
   return maybe_document;
 }
 
+MaybeDocument LevelDbRemoteDocumentCache::DecodeMaybeDocumentLazily(
+    absl::string_view encoded, const DocumentKey& key) {
+  StringReader reader{encoded};
+
+  auto message = Message<firestore_client_MaybeDocument>::TryParse(&reader);
+  MaybeDocument maybe_document =
+      serializer_->DecodeMaybeDocumentLazily(&reader, std::move(message));
+
+  if (!reader.ok()) {
+    HARD_FAIL("MaybeDocument proto failed to parse: %s",
+              reader.status().ToString());
+  }
+  HARD_ASSERT(maybe_document.key() == key,
+              "Read document has key (%s) instead of expected key (%s).",
+              maybe_document.key().ToString(), key.ToString());
+
+  return maybe_document;
+}
+
+MaybeDocument LevelDbRemoteDocumentCache::DecodeMaybeDocumentCached(
+    absl::string_view encoded, const DocumentKey& key) {
+  absl::optional<MaybeDocument> cached =
+      decoded_document_cache_.Get(key, encoded);
+  if (cached) {
+    return std::move(*cached);
+  }
+
+  MaybeDocument maybe_document = DecodeMaybeDocument(encoded, key);
+  decoded_document_cache_.Put(maybe_document, encoded);
+  return maybe_document;
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
@@ -18,13 +18,17 @@
 #define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_REMOTE_DOCUMENT_CACHE_H_
 
 #include <memory>
+#include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
+#include "Firestore/core/src/local/decoded_document_cache.h"
+#include "Firestore/core/src/local/leveldb_collection_dictionary.h"
 #include "Firestore/core/src/local/remote_document_cache.h"
 #include "Firestore/core/src/model/model_fwd.h"
 #include "Firestore/core/src/model/types.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
@@ -35,6 +39,7 @@ class Executor;
 
 namespace local {
 
+class BundleDocumentSource;
 class LevelDbPersistence;
 class LocalSerializer;
 
@@ -47,6 +52,7 @@ class LevelDbRemoteDocumentCache : public RemoteDocumentCache {
 
   void Add(const model::MaybeDocument& document,
            const model::SnapshotVersion& read_time) override;
+  void AddAll(const std::vector<DocumentReadTime>& documents) override;
   void Remove(const model::DocumentKey& key) override;
 
   absl::optional<model::MaybeDocument> Get(
@@ -56,23 +62,105 @@ class LevelDbRemoteDocumentCache : public RemoteDocumentCache {
   model::DocumentMap GetMatching(
       const core::Query& query,
       const model::SnapshotVersion& since_read_time) override;
+  model::DocumentMap GetMatchingInCollections(
+      const core::Query& query,
+      const std::vector<model::ResourcePath>& collection_paths,
+      const model::SnapshotVersion& since_read_time) override;
+  model::DocumentMap GetMatchingCandidates(
+      const core::Query& query,
+      const model::DocumentKeySet& candidate_keys) override;
+
+  void EnumerateMatching(const core::Query& query,
+                         const DocumentVisitor& visitor) override;
+
+  /**
+   * Attaches a read-only source of documents that is consulted for documents
+   * missing from LevelDB. Documents in LevelDB, including NoDocuments, take
+   * precedence over the attached ones, so updates from the backend shadow the
+   * static data. Replaces any previously attached source.
+   *
+   * Must not be called concurrently with reads of the cache.
+   */
+  void AttachBundleDocumentSource(
+      std::unique_ptr<BundleDocumentSource> source);
+
+  /**
+   * Returns the LevelDB key of the row that stores the given document, or
+   * nullopt if no document of its collection has been stored.
+   */
+  absl::optional<std::string> DocumentRowKey(const model::DocumentKey& key);
+
+  /**
+   * Empties the cache of decoded documents and returns the estimated memory it
+   * released, in bytes.
+   */
+  size_t ReleaseMemory() {
+    return decoded_document_cache_.Clear();
+  }
+
+  /** The cache of decoded documents used by `Get()` and `GetAll()`. */
+  const DecodedDocumentCache& decoded_document_cache() const {
+    return decoded_document_cache_;
+  }
 
  private:
+  /** Writes the rows of a document that has already been encoded. */
+  void AddEncoded(const model::MaybeDocument& document,
+                  const model::SnapshotVersion& read_time,
+                  std::string encoded);
+
   /**
    * Looks up a set of entries in the cache, returning only existing entries of
    * Type::Document.
    */
   model::DocumentMap GetAllExisting(const model::DocumentKeySet& keys);
 
+  /** Executes a query against the documents in LevelDB only. */
+  model::DocumentMap GetMatchingInLevelDb(
+      const core::Query& query, const model::SnapshotVersion& since_read_time);
+
+  /**
+   * Adds the documents of the attached source that match the query and aren't
+   * shadowed by LevelDB to `results`.
+   */
+  model::DocumentMap AddBundleSourceDocuments(
+      const core::Query& query,
+      const model::SnapshotVersion& since_read_time,
+      model::DocumentMap results);
+
   model::MaybeDocument DecodeMaybeDocument(absl::string_view encoded,
                                            const model::DocumentKey& key);
 
+  /**
+   * Like `DecodeMaybeDocument`, but only decodes the fields of a Document once
+   * they are read. Used by streaming scans, where most documents are only
+   * read to be matched against the query.
+   */
+  model::MaybeDocument DecodeMaybeDocumentLazily(
+      absl::string_view encoded, const model::DocumentKey& key);
+
+  /**
+   * Like `DecodeMaybeDocument`, but consults and populates the decoded
+   * document cache. Used for point lookups, where the same hot documents tend
+   * to be read repeatedly. Scans bypass the cache so that a single large
+   * query can't evict everything else.
+   */
+  model::MaybeDocument DecodeMaybeDocumentCached(absl::string_view encoded,
+                                                 const model::DocumentKey& key);
+
   // The LevelDbRemoteDocumentCache instance is owned by LevelDbPersistence.
   LevelDbPersistence* db_;
   // Owned by LevelDbPersistence.
   LocalSerializer* serializer_ = nullptr;
 
-  std::unique_ptr<util::Executor> executor_;
+  // Shared by all caches in the process.
+  std::shared_ptr<util::Executor> executor_;
+
+  DecodedDocumentCache decoded_document_cache_;
+
+  LevelDbCollectionDictionary collection_dictionary_;
+
+  std::unique_ptr<BundleDocumentSource> bundle_source_;
 };
 
 }  // namespace local
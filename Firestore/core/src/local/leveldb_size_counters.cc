@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/leveldb_size_counters.h"
+
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/local/leveldb_key.h"
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "leveldb/db.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+constexpr size_t LevelDbSizeCounters::kTableCount;
+
+LevelDbSizeCounters::LevelDbSizeCounters(LevelDbPersistence* db)
+    : db_(NOT_NULL(db)) {
+  for (std::atomic<int64_t>& byte_size : byte_sizes_) {
+    byte_size = 0;
+  }
+}
+
+void LevelDbSizeCounters::Start() {
+  // Like the target cache metadata, this is read before any transaction
+  // exists.
+  std::string value;
+  leveldb::Status status = db_->ptr()->Get(
+      StandardReadOptions(), LevelDbSizeCountersKey::Key(), &value);
+  if (status.IsNotFound()) return;
+  HARD_ASSERT(status.ok(), "Failed to read size counters: %s",
+              status.ToString());
+
+  std::vector<int64_t> byte_sizes;
+  HARD_ASSERT(LevelDbSizeCountersKey::DecodeValue(value, &byte_sizes),
+              "Failed to decode size counters");
+  // Tables added after the counters were saved start out empty.
+  for (size_t i = 0; i < byte_sizes.size() && i < kTableCount; ++i) {
+    byte_sizes_[i] = byte_sizes[i];
+  }
+}
+
+void LevelDbSizeCounters::RecordPut(SizedTable table,
+                                    absl::string_view key,
+                                    size_t value_size) {
+  int64_t delta = static_cast<int64_t>(value_size);
+  int64_t current_size = CurrentValueSize(key);
+  if (current_size < 0) {
+    delta += static_cast<int64_t>(key.size());
+  } else {
+    delta -= current_size;
+  }
+  Add(table, delta);
+}
+
+void LevelDbSizeCounters::RecordDelete(SizedTable table,
+                                       absl::string_view key) {
+  int64_t current_size = CurrentValueSize(key);
+  if (current_size < 0) return;
+
+  RecordDelete(table, key, static_cast<size_t>(current_size));
+}
+
+void LevelDbSizeCounters::RecordDelete(SizedTable table,
+                                       absl::string_view key,
+                                       size_t value_size) {
+  Add(table, -static_cast<int64_t>(key.size() + value_size));
+}
+
+void LevelDbSizeCounters::SaveIfChanged() {
+  if (!changed_) return;
+
+  std::vector<int64_t> byte_sizes;
+  for (const std::atomic<int64_t>& byte_size : byte_sizes_) {
+    byte_sizes.push_back(byte_size);
+  }
+  db_->current_transaction()->Put(
+      LevelDbSizeCountersKey::Key(),
+      LevelDbSizeCountersKey::EncodeValue(byte_sizes));
+  changed_ = false;
+}
+
+int64_t LevelDbSizeCounters::byte_size(SizedTable table) const {
+  return byte_sizes_[static_cast<size_t>(table)];
+}
+
+int64_t LevelDbSizeCounters::total_byte_size() const {
+  int64_t total = 0;
+  for (const std::atomic<int64_t>& byte_size : byte_sizes_) {
+    total += byte_size;
+  }
+  return total;
+}
+
+int64_t LevelDbSizeCounters::CurrentValueSize(absl::string_view key) {
+  std::string value;
+  leveldb::Status status = db_->current_transaction()->Get(key, &value);
+  if (status.IsNotFound()) return -1;
+  HARD_ASSERT(status.ok(), "Failed to read %s: %s", DescribeKey(key),
+              status.ToString());
+  return static_cast<int64_t>(value.size());
+}
+
+void LevelDbSizeCounters::Add(SizedTable table, int64_t delta) {
+  if (delta == 0) return;
+
+  byte_sizes_[static_cast<size_t>(table)] += delta;
+  changed_ = true;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_LEVELDB_SIZE_COUNTERS_H_
+#define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_SIZE_COUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+class LevelDbPersistence;
+
+/** The tables whose byte sizes are tracked by `LevelDbSizeCounters`. */
+enum class SizedTable {
+  /** The collection_document table, which stores the remote documents. */
+  RemoteDocuments = 0,
+
+  /** The target table. */
+  Targets,
+
+  /** The mutation table, across all users. */
+  Mutations,
+};
+
+/**
+ * Maintains the total byte size, keys and values included, of the rows of the
+ * tables that make up most of the LevelDB cache.
+ *
+ * The counters are updated by the caches as they write rows, and saved as part
+ * of the same transaction, so that they stay in sync with the tables without
+ * ever having to scan them. Migration 7 computes them for existing databases.
+ *
+ * Updates must happen on the thread running read-write transactions. The
+ * sizes may be read from any thread.
+ */
+class LevelDbSizeCounters {
+ public:
+  explicit LevelDbSizeCounters(LevelDbPersistence* db);
+
+  /** Loads the counters saved in the database. */
+  void Start();
+
+  /**
+   * Accounts for the row at `key` being set to a value of `value_size` bytes,
+   * replacing its current value, if any. Call this before writing the row.
+   */
+  void RecordPut(SizedTable table, absl::string_view key, size_t value_size);
+
+  /**
+   * Accounts for the row at `key` being deleted, if it exists. Call this
+   * before deleting the row.
+   */
+  void RecordDelete(SizedTable table, absl::string_view key);
+
+  /**
+   * Accounts for the row at `key`, whose current value is known to be
+   * `value_size` bytes, being deleted.
+   */
+  void RecordDelete(SizedTable table,
+                    absl::string_view key,
+                    size_t value_size);
+
+  /** Writes the counters to the current transaction if they have changed. */
+  void SaveIfChanged();
+
+  /** Returns the byte size of the given table. */
+  int64_t byte_size(SizedTable table) const;
+
+  /** Returns the byte size of all tracked tables. */
+  int64_t total_byte_size() const;
+
+ private:
+  static constexpr size_t kTableCount = 3;
+
+  /** Returns the value size of the row at `key`, or -1 if it doesn't exist. */
+  int64_t CurrentValueSize(absl::string_view key);
+
+  void Add(SizedTable table, int64_t delta);
+
+  // Not owned.
+  LevelDbPersistence* db_;
+
+  std::array<std::atomic<int64_t>, kTableCount> byte_sizes_;
+  bool changed_ = false;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_LEVELDB_SIZE_COUNTERS_H_
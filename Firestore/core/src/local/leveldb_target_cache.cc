@@ -16,12 +16,17 @@
 
 #include "Firestore/core/src/local/leveldb_target_cache.h"
 
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <string>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/local/leveldb_key.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_size_counters.h"
 #include "Firestore/core/src/local/leveldb_util.h"
 #include "Firestore/core/src/local/local_serializer.h"
 #include "Firestore/core/src/local/reference_delegate.h"
@@ -30,6 +35,7 @@
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/nanopb/byte_string.h"
 #include "Firestore/core/src/nanopb/reader.h"
+#include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/log.h"
 #include "Firestore/core/src/util/string_apple.h"
 #include "absl/strings/match.h"
@@ -46,9 +52,25 @@ using model::ListenSequenceNumber;
 using model::SnapshotVersion;
 using model::TargetId;
 using nanopb::ByteString;
+using nanopb::MakeStdString;
 using nanopb::Message;
 using nanopb::StringReader;
 
+namespace {
+
+using KeysByBlock = std::map<int32_t, std::vector<DocumentKey>>;
+
+/** Groups the given keys by block, keeping each group sorted. */
+KeysByBlock GroupByBlock(const DocumentKeySet& keys) {
+  KeysByBlock result;
+  for (const DocumentKey& key : keys) {
+    result[LevelDbTargetDocumentBlockKey::BlockIdFor(key)].push_back(key);
+  }
+  return result;
+}
+
+}  // namespace
+
 absl::optional<Message<firestore_client_TargetGlobal>>
 LevelDbTargetCache::TryReadMetadata(leveldb::DB* db) {
   std::string key = LevelDbTargetGlobalKey::Key();
@@ -109,13 +131,17 @@ void LevelDbTargetCache::AddTarget(const TargetData& target_data) {
   std::string empty_buffer;
   db_->current_transaction()->Put(index_key, empty_buffer);
 
+  CacheTarget(target_data);
+
   metadata_->target_count++;
   UpdateMetadata(target_data);
   SaveMetadata();
 }
 
 void LevelDbTargetCache::UpdateTarget(const TargetData& target_data) {
-  Save(target_data);
+  // The target itself doesn't change, so only its state is rewritten.
+  SaveState(target_data);
+  CacheTarget(target_data);
 
   if (UpdateMetadata(target_data)) {
     SaveMetadata();
@@ -128,21 +154,63 @@ void LevelDbTargetCache::RemoveTarget(const TargetData& target_data) {
   RemoveMatchingKeysForTarget(target_id);
 
   std::string key = LevelDbTargetKey::Key(target_id);
+  db_->size_counters()->RecordDelete(SizedTable::Targets, key);
   db_->current_transaction()->Delete(key);
+  RemoveState(target_id);
 
-  std::string index_key =
-      LevelDbQueryTargetKey::Key(target_data.target().CanonicalId(), target_id);
+  const std::string& canonical_id = target_data.target().CanonicalId();
+  std::string index_key = LevelDbQueryTargetKey::Key(canonical_id, target_id);
   db_->current_transaction()->Delete(index_key);
 
+  auto found = targets_by_canonical_id_.find(canonical_id);
+  if (found != targets_by_canonical_id_.end()) {
+    std::vector<TargetData>& cached = found->second;
+    cached.erase(std::remove_if(cached.begin(), cached.end(),
+                                [&](const TargetData& candidate) {
+                                  return candidate.target_id() == target_id;
+                                }),
+                 cached.end());
+    if (cached.empty()) {
+      targets_by_canonical_id_.erase(found);
+    }
+  }
+
   metadata_->target_count--;
   SaveMetadata();
 }
 
 absl::optional<TargetData> LevelDbTargetCache::GetTarget(const Target& target) {
+  const std::string& canonical_id = target.CanonicalId();
+  if (db_->in_read_only_transaction()) {
+    // Read-only transactions may run concurrently with target changes on the
+    // worker queue, so they must not touch the in-memory copy.
+    return FindTarget(ReadTargets(canonical_id), target);
+  }
+
+  auto found = targets_by_canonical_id_.find(canonical_id);
+  if (found == targets_by_canonical_id_.end()) {
+    std::vector<TargetData> targets = ReadTargets(canonical_id);
+    found = targets_by_canonical_id_.emplace(canonical_id, std::move(targets))
+                .first;
+  }
+  return FindTarget(found->second, target);
+}
+
+absl::optional<TargetData> LevelDbTargetCache::FindTarget(
+    const std::vector<TargetData>& candidates, const Target& target) {
+  for (const TargetData& target_data : candidates) {
+    if (target_data.target() == target) {
+      return target_data;
+    }
+  }
+  return absl::nullopt;
+}
+
+std::vector<TargetData> LevelDbTargetCache::ReadTargets(
+    const std::string& canonical_id) {
   // Scan the query-target index starting with a prefix starting with the given
-  // target's canonical_id. Note that this is a scan rather than a get because
+  // canonical_id. Note that this is a scan rather than a get because
   // canonical_ids are not required to be unique per target.
-  const std::string& canonical_id = target.CanonicalId();
   auto index_iterator = db_->current_transaction()->NewIterator();
   std::string index_prefix = LevelDbQueryTargetKey::KeyPrefix(canonical_id);
   index_iterator->Seek(index_prefix);
@@ -154,6 +222,7 @@ absl::optional<TargetData> LevelDbTargetCache::GetTarget(const Target& target) {
   std::string target_prefix = LevelDbTargetKey::KeyPrefix();
   auto target_iterator = db_->current_transaction()->NewIterator();
 
+  std::vector<TargetData> result;
   LevelDbQueryTargetKey row_key;
   for (; index_iterator->Valid(); index_iterator->Next()) {
     // Only consider rows matching exactly the specific canonical_id of
@@ -178,27 +247,46 @@ absl::optional<TargetData> LevelDbTargetCache::GetTarget(const Target& target) {
       continue;
     }
 
-    // Finally after finding a potential match, check that the target is
-    // actually equal to the requested target.
-    TargetData target_data = DecodeTarget(target_iterator->value());
-    if (target_data.target() == target) {
-      return target_data;
-    }
+    result.push_back(ReadState(DecodeTarget(target_iterator->value())));
   }
 
-  return absl::nullopt;
+  return result;
+}
+
+void LevelDbTargetCache::CacheTarget(const TargetData& target_data) {
+  auto found =
+      targets_by_canonical_id_.find(target_data.target().CanonicalId());
+  if (found == targets_by_canonical_id_.end()) {
+    return;
+  }
+
+  for (TargetData& cached : found->second) {
+    if (cached.target_id() == target_data.target_id()) {
+      cached = target_data;
+      return;
+    }
+  }
+  found->second.push_back(target_data);
 }
 
 void LevelDbTargetCache::EnumerateSequenceNumbers(
     const SequenceNumberCallback& callback) {
   // Enumerate all targets, give their sequence numbers.
   std::string target_prefix = LevelDbTargetKey::KeyPrefix();
-  auto it = db_->current_transaction()->NewIterator();
+  auto it = db_->current_transaction()->NewIterator(
+      LevelDbTransaction::ReadProfile::BackgroundScan);
   it->Seek(target_prefix);
+  auto state_it = db_->current_transaction()->NewIterator(
+      LevelDbTransaction::ReadProfile::BackgroundScan);
+  state_it->Seek(LevelDbTargetStateKey::KeyPrefix());
   for (; it->Valid() && absl::StartsWith(it->key(), target_prefix);
        it->Next()) {
     StringReader reader{it->value()};
     auto target_proto = DecodeTargetProto(&reader);
+    if (SeekState(state_it.get(), target_proto->target_id)) {
+      StringReader state_reader{state_it->value()};
+      target_proto = DecodeTargetProto(&state_reader);
+    }
     callback(target_proto->last_listen_sequence_number);
   }
 }
@@ -207,8 +295,12 @@ size_t LevelDbTargetCache::RemoveTargets(
     ListenSequenceNumber upper_bound,
     const std::unordered_map<model::TargetId, TargetData>& live_targets) {
   std::string target_prefix = LevelDbTargetKey::KeyPrefix();
-  auto it = db_->current_transaction()->NewIterator();
+  auto it = db_->current_transaction()->NewIterator(
+      LevelDbTransaction::ReadProfile::BackgroundScan);
   it->Seek(target_prefix);
+  auto state_it = db_->current_transaction()->NewIterator(
+      LevelDbTransaction::ReadProfile::BackgroundScan);
+  state_it->Seek(LevelDbTargetStateKey::KeyPrefix());
 
   std::unordered_set<TargetId> removed_targets;
 
@@ -220,14 +312,29 @@ size_t LevelDbTargetCache::RemoveTargets(
        it->Next()) {
     StringReader reader{it->value()};
     auto target_proto = DecodeTargetProto(&reader);
-    if (target_proto->last_listen_sequence_number <= upper_bound &&
-        live_targets.find(target_proto->target_id) == live_targets.end()) {
-      TargetId target_id = target_proto->target_id;
+    TargetId target_id = target_proto->target_id;
+    ListenSequenceNumber sequence_number =
+        target_proto->last_listen_sequence_number;
+    bool has_state = SeekState(state_it.get(), target_id);
+    if (has_state) {
+      StringReader state_reader{state_it->value()};
+      sequence_number =
+          DecodeTargetProto(&state_reader)->last_listen_sequence_number;
+    }
 
+    if (sequence_number <= upper_bound &&
+        live_targets.find(target_id) == live_targets.end()) {
       // Remove the DocumentKey to TargetId mapping
       RemoveMatchingKeysForTarget(target_id);
       // Remove the TargetId to Target mapping
+      db_->size_counters()->RecordDelete(SizedTable::Targets, it->key(),
+                                         it->value().size());
       db_->current_transaction()->Delete(it->key());
+      if (has_state) {
+        db_->size_counters()->RecordDelete(
+            SizedTable::Targets, state_it->key(), state_it->value().size());
+        db_->current_transaction()->Delete(state_it->key());
+      }
 
       removed_targets.insert(target_id);
     }
@@ -250,9 +357,16 @@ void LevelDbTargetCache::AddMatchingKeys(const DocumentKeySet& keys,
   // buffer (and the parser will see all default values).
   std::string empty_buffer;
 
+  for (const auto& entry : GroupByBlock(keys)) {
+    std::vector<DocumentKey> existing = ReadBlock(target_id, entry.first);
+    std::vector<DocumentKey> merged;
+    merged.reserve(existing.size() + entry.second.size());
+    std::set_union(existing.begin(), existing.end(), entry.second.begin(),
+                   entry.second.end(), std::back_inserter(merged));
+    WriteBlock(target_id, entry.first, merged);
+  }
+
   for (const DocumentKey& key : keys) {
-    db_->current_transaction()->Put(
-        LevelDbTargetDocumentKey::Key(target_id, key), empty_buffer);
     db_->current_transaction()->Put(
         LevelDbDocumentTargetKey::Key(key, target_id), empty_buffer);
     db_->reference_delegate()->AddReference(key);
@@ -261,9 +375,15 @@ void LevelDbTargetCache::AddMatchingKeys(const DocumentKeySet& keys,
 
 void LevelDbTargetCache::RemoveMatchingKeys(const DocumentKeySet& keys,
                                             TargetId target_id) {
+  for (const auto& entry : GroupByBlock(keys)) {
+    std::vector<DocumentKey> existing = ReadBlock(target_id, entry.first);
+    std::vector<DocumentKey> remaining;
+    std::set_difference(existing.begin(), existing.end(), entry.second.begin(),
+                        entry.second.end(), std::back_inserter(remaining));
+    WriteBlock(target_id, entry.first, remaining);
+  }
+
   for (const DocumentKey& key : keys) {
-    db_->current_transaction()->Delete(
-        LevelDbTargetDocumentKey::Key(target_id, key));
     db_->current_transaction()->Delete(
         LevelDbDocumentTargetKey::Key(key, target_id));
     db_->reference_delegate()->RemoveReference(key);
@@ -271,11 +391,13 @@ void LevelDbTargetCache::RemoveMatchingKeys(const DocumentKeySet& keys,
 }
 
 void LevelDbTargetCache::RemoveMatchingKeysForTarget(TargetId target_id) {
-  std::string index_prefix = LevelDbTargetDocumentKey::KeyPrefix(target_id);
+  std::string index_prefix =
+      LevelDbTargetDocumentBlockKey::KeyPrefix(target_id);
   auto index_iterator = db_->current_transaction()->NewIterator();
   index_iterator->Seek(index_prefix);
 
-  LevelDbTargetDocumentKey row_key;
+  LevelDbTargetDocumentBlockKey row_key;
+  std::vector<DocumentKey> document_keys;
   for (; index_iterator->Valid(); index_iterator->Next()) {
     absl::string_view index_key = index_iterator->key();
 
@@ -283,12 +405,17 @@ void LevelDbTargetCache::RemoveMatchingKeysForTarget(TargetId target_id) {
     if (!row_key.Decode(index_key) || row_key.target_id() != target_id) {
       break;
     }
-    const DocumentKey& document_key = row_key.document_key();
+    HARD_ASSERT(LevelDbTargetDocumentBlockKey::DecodeValue(
+                    index_iterator->value(), &document_keys),
+                "Failed to decode target document block %s",
+                DescribeKey(index_iterator));
 
-    // Delete both index rows
+    // Delete the block and the reverse index rows of its documents.
     db_->current_transaction()->Delete(index_key);
-    db_->current_transaction()->Delete(
-        LevelDbDocumentTargetKey::Key(document_key, target_id));
+    for (const DocumentKey& document_key : document_keys) {
+      db_->current_transaction()->Delete(
+          LevelDbDocumentTargetKey::Key(document_key, target_id));
+    }
   }
 }
 
@@ -306,31 +433,72 @@ void LevelDbTargetCache::RemoveQueryTargetKeyForTargets(
 
     if (target_ids.find(row_key.target_id()) != target_ids.end()) {
       db_->current_transaction()->Delete(index_iterator->key());
+      // The remaining targets of the canonical ID are read again on the next
+      // lookup.
+      targets_by_canonical_id_.erase(row_key.canonical_id());
     }
   }
 }
 
 DocumentKeySet LevelDbTargetCache::GetMatchingKeys(TargetId target_id) {
-  std::string index_prefix = LevelDbTargetDocumentKey::KeyPrefix(target_id);
+  std::string index_prefix =
+      LevelDbTargetDocumentBlockKey::KeyPrefix(target_id);
   auto index_iterator = db_->current_transaction()->NewIterator();
   index_iterator->Seek(index_prefix);
 
   DocumentKeySet result;
-  LevelDbTargetDocumentKey row_key;
+  LevelDbTargetDocumentBlockKey row_key;
+  std::vector<DocumentKey> document_keys;
   for (; index_iterator->Valid(); index_iterator->Next()) {
-    // TODO(gsoltis): could we use a StartsWith instead?
     // Only consider rows matching this specific target_id.
     if (!row_key.Decode(index_iterator->key()) ||
         row_key.target_id() != target_id) {
       break;
     }
+    HARD_ASSERT(LevelDbTargetDocumentBlockKey::DecodeValue(
+                    index_iterator->value(), &document_keys),
+                "Failed to decode target document block %s",
+                DescribeKey(index_iterator));
 
-    result = result.insert(row_key.document_key());
+    for (const DocumentKey& document_key : document_keys) {
+      result = result.insert(document_key);
+    }
   }
 
   return result;
 }
 
+std::vector<DocumentKey> LevelDbTargetCache::ReadBlock(TargetId target_id,
+                                                       int32_t block_id) {
+  std::string key = LevelDbTargetDocumentBlockKey::Key(target_id, block_id);
+  std::string value;
+  std::vector<DocumentKey> document_keys;
+  Status status = db_->current_transaction()->Get(key, &value);
+  if (status.ok()) {
+    HARD_ASSERT(
+        LevelDbTargetDocumentBlockKey::DecodeValue(value, &document_keys),
+        "Failed to decode target document block %s", DescribeKey(key));
+  } else if (!status.IsNotFound()) {
+    HARD_FAIL("Failed to read target document block %s: %s", DescribeKey(key),
+              status.ToString());
+  }
+  return document_keys;
+}
+
+void LevelDbTargetCache::WriteBlock(
+    TargetId target_id,
+    int32_t block_id,
+    const std::vector<DocumentKey>& document_keys) {
+  std::string key = LevelDbTargetDocumentBlockKey::Key(target_id, block_id);
+  if (document_keys.empty()) {
+    db_->current_transaction()->Delete(key);
+  } else {
+    db_->current_transaction()->Put(
+        std::move(key),
+        LevelDbTargetDocumentBlockKey::EncodeValue(document_keys));
+  }
+}
+
 bool LevelDbTargetCache::Contains(const DocumentKey& key) {
   // ignore sentinel rows when determining if a key belongs to a target.
   // Sentinel row just says the document exists, not that it's a member of any
@@ -342,7 +510,7 @@ bool LevelDbTargetCache::Contains(const DocumentKey& key) {
   for (; index_iterator->Valid() &&
          absl::StartsWith(index_iterator->key(), index_prefix);
        index_iterator->Next()) {
-    LevelDbDocumentTargetKey row_key;
+    LevelDbDocumentTargetKeyView row_key;
     if (row_key.Decode(index_iterator->key()) && !row_key.IsSentinel() &&
         row_key.document_key() == key) {
       return true;
@@ -366,12 +534,37 @@ void LevelDbTargetCache::SetLastRemoteSnapshotVersion(SnapshotVersion version) {
 
 void LevelDbTargetCache::EnumerateOrphanedDocuments(
     const OrphanedDocumentCallback& callback) {
+  EnumerateOrphanedDocumentsAfter(
+      absl::nullopt,
+      [&](const DocumentKey& key, ListenSequenceNumber sequence_number) {
+        callback(key, sequence_number);
+        return true;
+      });
+}
+
+void LevelDbTargetCache::EnumerateOrphanedDocumentsAfter(
+    const absl::optional<DocumentKey>& start_after,
+    const std::function<bool(const DocumentKey&, ListenSequenceNumber)>&
+        callback) {
   std::string document_target_prefix = LevelDbDocumentTargetKey::KeyPrefix();
-  auto it = db_->current_transaction()->NewIterator();
-  it->Seek(document_target_prefix);
+  auto it = db_->current_transaction()->NewIterator(
+      LevelDbTransaction::ReadProfile::BackgroundScan);
+  LevelDbDocumentTargetKey key;
+  if (start_after) {
+    // The rows of a document are contiguous, starting with its sentinel.
+    it->Seek(LevelDbDocumentTargetKey::SentinelKey(*start_after));
+    for (; it->Valid() && absl::StartsWith(it->key(), document_target_prefix);
+         it->Next()) {
+      HARD_ASSERT(key.Decode(it->key()),
+                  "Failed to decode DocumentTarget key");
+      if (key.document_key() != *start_after) break;
+    }
+  } else {
+    it->Seek(document_target_prefix);
+  }
+
   ListenSequenceNumber next_to_report = 0;
   DocumentKey key_to_report;
-  LevelDbDocumentTargetKey key;
 
   for (; it->Valid() && absl::StartsWith(it->key(), document_target_prefix);
        it->Next()) {
@@ -379,8 +572,8 @@ void LevelDbTargetCache::EnumerateOrphanedDocuments(
     if (key.IsSentinel()) {
       // if next_to_report is non-zero, report it, this is a new key so the last
       // one must be not be a member of any targets.
-      if (next_to_report != 0) {
-        callback(key_to_report, next_to_report);
+      if (next_to_report != 0 && !callback(key_to_report, next_to_report)) {
+        return;
       }
       // set next_to_report to be this sequence number. It's the next one we
       // might report, if we don't find any targets for this document.
@@ -403,8 +596,54 @@ void LevelDbTargetCache::EnumerateOrphanedDocuments(
 void LevelDbTargetCache::Save(const TargetData& target_data) {
   TargetId target_id = target_data.target_id();
   std::string key = LevelDbTargetKey::Key(target_id);
-  db_->current_transaction()->Put(key,
-                                  serializer_->EncodeTargetData(target_data));
+  std::string encoded =
+      MakeStdString(serializer_->EncodeTargetData(target_data));
+  db_->size_counters()->RecordPut(SizedTable::Targets, key, encoded.size());
+  db_->current_transaction()->Put(std::move(key), std::move(encoded));
+  RemoveState(target_id);
+}
+
+void LevelDbTargetCache::SaveState(const TargetData& target_data) {
+  std::string key = LevelDbTargetStateKey::Key(target_data.target_id());
+  std::string encoded =
+      MakeStdString(serializer_->EncodeTargetState(target_data));
+  db_->size_counters()->RecordPut(SizedTable::Targets, key, encoded.size());
+  db_->current_transaction()->Put(std::move(key), std::move(encoded));
+}
+
+void LevelDbTargetCache::RemoveState(TargetId target_id) {
+  std::string key = LevelDbTargetStateKey::Key(target_id);
+  db_->size_counters()->RecordDelete(SizedTable::Targets, key);
+  db_->current_transaction()->Delete(key);
+}
+
+TargetData LevelDbTargetCache::ReadState(TargetData target_data) {
+  std::string value;
+  Status status = db_->current_transaction()->Get(
+      LevelDbTargetStateKey::Key(target_data.target_id()), &value);
+  if (status.IsNotFound()) {
+    return target_data;
+  }
+  HARD_ASSERT(status.ok(), "Failed to read target state: %s",
+              status.ToString());
+
+  StringReader reader{value};
+  auto message = DecodeTargetProto(&reader);
+  auto result = serializer_->DecodeTargetState(&reader, *message, target_data);
+  if (!reader.ok()) {
+    HARD_FAIL("Target state failed to parse: %s, message: %s",
+              reader.status().ToString(), message.ToString());
+  }
+  return result;
+}
+
+bool LevelDbTargetCache::SeekState(LevelDbTransaction::Iterator* state_iterator,
+                                   TargetId target_id) {
+  std::string state_key = LevelDbTargetStateKey::Key(target_id);
+  while (state_iterator->Valid() && state_iterator->key() < state_key) {
+    state_iterator->Next();
+  }
+  return state_iterator->Valid() && state_iterator->key() == state_key;
 }
 
 bool LevelDbTargetCache::UpdateMetadata(const TargetData& target_data) {
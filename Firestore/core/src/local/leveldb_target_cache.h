@@ -17,11 +17,17 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_LEVELDB_TARGET_CACHE_H_
 #define FIRESTORE_CORE_SRC_LOCAL_LEVELDB_TARGET_CACHE_H_
 
+#include <functional>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "Firestore/Protos/nanopb/firestore/local/target.nanopb.h"
+#include "Firestore/core/src/local/leveldb_transaction.h"
 #include "Firestore/core/src/local/target_cache.h"
+#include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/model_fwd.h"
 #include "Firestore/core/src/model/snapshot_version.h"
 #include "Firestore/core/src/nanopb/message.h"
@@ -35,7 +41,6 @@ namespace local {
 
 class LevelDbPersistence;
 class LocalSerializer;
-class TargetData;
 
 /** Cached Queries backed by LevelDB. */
 class LevelDbTargetCache : public TargetCache {
@@ -125,8 +130,44 @@ class LevelDbTargetCache : public TargetCache {
 
   void EnumerateOrphanedDocuments(const OrphanedDocumentCallback& callback);
 
+  /**
+   * Enumerates the orphaned documents like `EnumerateOrphanedDocuments()`, but
+   * only those after `start_after`, if given. The enumeration stops as soon as
+   * `callback` returns false.
+   */
+  void EnumerateOrphanedDocumentsAfter(
+      const absl::optional<model::DocumentKey>& start_after,
+      const std::function<bool(const model::DocumentKey&,
+                               model::ListenSequenceNumber)>& callback);
+
  private:
+  /**
+   * Writes the given target in full to the targets table, dropping any
+   * target_state row that would override it.
+   */
   void Save(const TargetData& target_data);
+
+  /**
+   * Writes only the parts of the given target that change while it's listened
+   * to, to the target_state table.
+   */
+  void SaveState(const TargetData& target_data);
+
+  /** Deletes the target_state row of the given target, if it has one. */
+  void RemoveState(model::TargetId target_id);
+
+  /**
+   * Returns the given target, decoded from the targets table, updated with its
+   * target_state row, if it has one.
+   */
+  TargetData ReadState(TargetData target_data);
+
+  /**
+   * Advances `state_iterator`, which scans the target_state table in target ID
+   * order, to the row of the given target and returns whether there is one.
+   */
+  bool SeekState(LevelDbTransaction::Iterator* state_iterator,
+                 model::TargetId target_id);
   bool UpdateMetadata(const TargetData& target_data);
   void SaveMetadata();
 
@@ -140,10 +181,38 @@ class LevelDbTargetCache : public TargetCache {
    */
   TargetData DecodeTarget(absl::string_view encoded);
 
+  /**
+   * Reads all the targets with the given canonical ID from the query-target
+   * index.
+   */
+  std::vector<TargetData> ReadTargets(const std::string& canonical_id);
+
+  /** Returns the target data in `candidates` that's for `target`, if any. */
+  static absl::optional<TargetData> FindTarget(
+      const std::vector<TargetData>& candidates, const core::Target& target);
+
+  /**
+   * Adds or replaces the given target in `targets_by_canonical_id_` if its
+   * canonical ID has an entry.
+   */
+  void CacheTarget(const TargetData& target_data);
+
   /** Removes the given targets from the query to target mapping. */
   void RemoveQueryTargetKeyForTargets(
       const std::unordered_set<model::TargetId>& target_id);
 
+  /** Reads the sorted document keys in the given block of a target. */
+  std::vector<model::DocumentKey> ReadBlock(model::TargetId target_id,
+                                            int32_t block_id);
+
+  /**
+   * Replaces the given block of a target with the given sorted document keys,
+   * deleting the block if there are none.
+   */
+  void WriteBlock(model::TargetId target_id,
+                  int32_t block_id,
+                  const std::vector<model::DocumentKey>& document_keys);
+
   // The LevelDbTargetCache is owned by LevelDbPersistence.
   LevelDbPersistence* db_;
   // Owned by LevelDbPersistence.
@@ -153,6 +222,15 @@ class LevelDbTargetCache : public TargetCache {
   nanopb::Message<firestore_client_TargetGlobal> metadata_;
 
   model::SnapshotVersion last_remote_snapshot_version_;
+
+  /**
+   * A write-through cache of the targets of the canonical IDs that were looked
+   * up by `GetTarget`. An entry is always complete: it holds every stored
+   * target with its canonical ID. Canonical IDs without an entry are read from
+   * LevelDB on their next lookup.
+   */
+  std::unordered_map<std::string, std::vector<TargetData>>
+      targets_by_canonical_id_;
 };
 
 }  // namespace local
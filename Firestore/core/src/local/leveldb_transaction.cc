@@ -17,6 +17,7 @@
 #include "Firestore/core/src/local/leveldb_transaction.h"
 
 #include "Firestore/core/src/local/leveldb_key.h"
+#include "Firestore/core/src/local/leveldb_util.h"
 #include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/log.h"
 #include "absl/memory/memory.h"
@@ -34,12 +35,12 @@ namespace firebase {
 namespace firestore {
 namespace local {
 
-LevelDbTransaction::Iterator::Iterator(LevelDbTransaction* txn)
-    : db_iter_(txn->db_->NewIterator(txn->read_options_)),
+LevelDbTransaction::Iterator::Iterator(LevelDbTransaction* txn,
+                                       ReadProfile profile)
+    : db_iter_(txn->db_->NewIterator(txn->ReadOptionsFor(profile))),
       last_version_(txn->version_),
       txn_(txn),
-      mutations_iter_(txn->mutations_.begin()),
-      current_(),
+      changes_iter_(txn->changes_.begin()),
       is_mutation_(false),
       // Iterator doesn't really point to anything yet, so is
       // invalid
@@ -47,92 +48,88 @@ LevelDbTransaction::Iterator::Iterator(LevelDbTransaction* txn)
 }
 
 void LevelDbTransaction::Iterator::UpdateCurrent() {
-  bool mutation_is_valid = mutations_iter_ != txn_->mutations_.end();
-  is_valid_ = mutation_is_valid || db_iter_->Valid();
+  for (;;) {
+    bool change_is_valid = changes_iter_ != txn_->changes_.end();
+    if (!change_is_valid) {
+      is_valid_ = db_iter_->Valid();
+      is_mutation_ = false;
+      break;
+    }
 
-  if (is_valid_) {
-    if (!mutation_is_valid) {
+    int comparison =
+        db_iter_->Valid() ? db_iter_->key().compare(changes_iter_->first) : 1;
+    if (comparison < 0) {
+      // The committed entry comes first and isn't shadowed by any change.
+      is_valid_ = true;
       is_mutation_ = false;
-    } else if (!db_iter_->Valid()) {
+      break;
+    }
+
+    if (!changes_iter_->second.is_delete) {
+      // The change either comes first or shadows the committed entry.
+      is_valid_ = true;
       is_mutation_ = true;
-    } else {
-      // Both iterators are valid. If the leveldb key is equal to or greater
-      // than the current mutation key, we are looking at a mutation next. It's
-      // either sooner in the iteration or directly shadowing the underlying
-      // committed value in leveldb.
-      is_mutation_ = db_iter_->key().compare(mutations_iter_->first) >= 0;
+      break;
     }
-    if (is_mutation_) {
-      current_ = *mutations_iter_;
-    } else {
-      current_ = {db_iter_->key().ToString(), db_iter_->value().ToString()};
+
+    // Skip the deletion, along with the committed entry it deletes.
+    if (comparison == 0) {
+      db_iter_->Next();
     }
+    ++changes_iter_;
   }
+
+  HARD_ASSERT(db_iter_->status().ok(), "leveldb iterator reported an error: %s",
+              db_iter_->status().ToString());
 }
 
 void LevelDbTransaction::Iterator::Seek(const std::string& key) {
+  txn_->counters_.seeks++;
   db_iter_->Seek(key);
-  HARD_ASSERT(db_iter_->status().ok(), "leveldb iterator reported an error: %s",
-              db_iter_->status().ToString());
-  for (; db_iter_->Valid() && IsDeleted(db_iter_->key()); db_iter_->Next()) {
-  }
-  HARD_ASSERT(db_iter_->status().ok(), "leveldb iterator reported an error: %s",
-              db_iter_->status().ToString());
-  mutations_iter_ = txn_->mutations_.lower_bound(key);
+  changes_iter_ = txn_->changes_.lower_bound(key);
   UpdateCurrent();
   last_version_ = txn_->version_;
 }
 
-const std::string& LevelDbTransaction::Iterator::key() const {
+absl::string_view LevelDbTransaction::Iterator::key() const {
   HARD_ASSERT(Valid(), "key() called on invalid iterator");
-  return current_.first;
+  if (is_mutation_) {
+    return changes_iter_->first;
+  } else {
+    return MakeStringView(db_iter_->key());
+  }
 }
 
-const std::string& LevelDbTransaction::Iterator::value() const {
+absl::string_view LevelDbTransaction::Iterator::value() const {
   HARD_ASSERT(Valid(), "value() called on invalid iterator");
-  return current_.second;
-}
-
-bool LevelDbTransaction::Iterator::IsDeleted(leveldb::Slice slice) {
-  return txn_->deletions_.find(slice.ToString()) != txn_->deletions_.end();
-}
-
-bool LevelDbTransaction::Iterator::SyncToTransaction() {
-  if (last_version_ < txn_->version_) {
-    // Intentionally copying here since Seek() may update current_. We need the
-    // copy to do the comparison below.
-    const std::string current_key = current_.first;
-    Seek(current_key);
-    // If we advanced, we don't need to advance again.
-    return is_valid_ && current_.first > current_key;
+  if (is_mutation_) {
+    return changes_iter_->second.value;
   } else {
-    return false;
+    return MakeStringView(db_iter_->value());
   }
 }
 
-void LevelDbTransaction::Iterator::AdvanceLDB() {
-  do {
-    db_iter_->Next();
-  } while (db_iter_->Valid() && IsDeleted(db_iter_->key()));
-  HARD_ASSERT(db_iter_->status().ok(), "leveldb iterator reported an error: %s",
-              db_iter_->status().ToString());
-}
-
 void LevelDbTransaction::Iterator::Next() {
   HARD_ASSERT(Valid(), "Next() called on invalid iterator");
-  bool advanced = SyncToTransaction();
-  if (!advanced && is_valid_) {
-    if (is_mutation_) {
-      // A mutation might be shadowing leveldb. If so, advance both.
-      if (db_iter_->Valid() && db_iter_->key() == mutations_iter_->first) {
-        AdvanceLDB();
-      }
-      ++mutations_iter_;
-    } else {
-      AdvanceLDB();
+  if (is_mutation_) {
+    // The change might be shadowing leveldb. If so, advance both. Any changes
+    // made after the current key since the last step are picked up by
+    // advancing in the map.
+    if (db_iter_->Valid() && db_iter_->key() == changes_iter_->first) {
+      db_iter_->Next();
+    }
+    ++changes_iter_;
+  } else {
+    if (last_version_ != txn_->version_) {
+      // Changes may have been made between the current key and the change
+      // changes_iter_ points to. Changes to the current key itself don't
+      // matter since the iterator is moving past it.
+      changes_iter_ = txn_->changes_.upper_bound(db_iter_->key().ToString());
+      last_version_ = txn_->version_;
     }
-    UpdateCurrent();
+    db_iter_->Next();
   }
+  UpdateCurrent();
 }
 
 LevelDbTransaction::LevelDbTransaction(DB* db,
@@ -161,67 +158,113 @@ const WriteOptions& LevelDbTransaction::DefaultWriteOptions() {
   return options;
 }
 
+ReadOptions LevelDbTransaction::ReadOptionsFor(ReadProfile profile) const {
+  ReadOptions options = read_options_;
+  switch (profile) {
+    case ReadProfile::PointRead:
+    case ReadProfile::ForegroundScan:
+      break;
+
+    case ReadProfile::BackgroundScan:
+      options.verify_checksums = false;
+      options.fill_cache = false;
+      break;
+  }
+  return options;
+}
+
 void LevelDbTransaction::Put(std::string key, std::string value) {
-  deletions_.erase(key);
-  mutations_[std::move(key)] = std::move(value);
+  auto iter = changes_.lower_bound(key);
+  if (iter == changes_.end() || iter->first != key) {
+    iter = changes_.emplace_hint(iter, std::move(key), Change{});
+  }
+  iter->second.is_delete = false;
+  iter->second.value = std::move(value);
   version_++;
+  counters_.writes++;
+  counters_.bytes_written +=
+      static_cast<int64_t>(iter->first.size() + iter->second.value.size());
 }
 
-std::unique_ptr<LevelDbTransaction::Iterator>
-LevelDbTransaction::NewIterator() {
-  return absl::make_unique<LevelDbTransaction::Iterator>(this);
+std::unique_ptr<LevelDbTransaction::Iterator> LevelDbTransaction::NewIterator(
+    ReadProfile profile) {
+  return absl::make_unique<LevelDbTransaction::Iterator>(this, profile);
 }
 
 Status LevelDbTransaction::Get(absl::string_view key, std::string* value) {
+  counters_.reads++;
   std::string key_string(key);
-  if (deletions_.find(key_string) != deletions_.end()) {
+  Changes::iterator iter{changes_.find(key_string)};
+  if (iter == changes_.end()) {
+    Status status =
+        db_->Get(ReadOptionsFor(ReadProfile::PointRead), key_string, value);
+    if (status.ok()) {
+      counters_.bytes_read += static_cast<int64_t>(value->size());
+    }
+    return status;
+  } else if (iter->second.is_delete) {
     return Status::NotFound(key_string + " is not present in the transaction");
   } else {
-    Mutations::iterator iter{mutations_.find(key_string)};
-    if (iter != mutations_.end()) {
-      *value = iter->second;
-      return Status::OK();
-    } else {
-      return db_->Get(read_options_, key_string, value);
-    }
+    *value = iter->second.value;
+    counters_.bytes_read += static_cast<int64_t>(value->size());
+    return Status::OK();
   }
 }
 
 void LevelDbTransaction::Delete(absl::string_view key) {
   std::string to_delete(key);
-  deletions_.insert(to_delete);
-  mutations_.erase(to_delete);
+  auto iter = changes_.lower_bound(to_delete);
+  if (iter == changes_.end() || iter->first != to_delete) {
+    iter = changes_.emplace_hint(iter, std::move(to_delete), Change{});
+  }
+  // Don't release the value: an iterator may be pointing to it.
+  iter->second.is_delete = true;
   version_++;
+  counters_.writes++;
 }
 
 void LevelDbTransaction::Commit() {
-  WriteBatch batch;
-  for (const auto& deletion : deletions_) {
-    batch.Delete(deletion);
-  }
+  Commit(write_options_);
+}
 
-  for (const auto& entry : mutations_) {
-    batch.Put(entry.first, entry.second);
+size_t LevelDbTransaction::Commit(const WriteOptions& write_options) {
+  // Changes are already sorted by key, which is the order in which leveldb
+  // applies them most efficiently.
+  WriteBatch batch;
+  for (const auto& entry : changes_) {
+    if (entry.second.is_delete) {
+      batch.Delete(entry.first);
+    } else {
+      batch.Put(entry.first, entry.second.value);
+    }
   }
 
   LOG_DEBUG("Committing transaction: %s", ToString());
 
-  Status status = db_->Write(write_options_, &batch);
+  Status status = db_->Write(write_options, &batch);
   HARD_ASSERT(status.ok(), "Failed to commit transaction:\n%s\n Failed: %s",
               ToString(), status.ToString());
+  return batch.ApproximateSize();
+}
+
+void LevelDbTransaction::Continue(absl::string_view label) {
+  absl::StrAppend(&label_, " + ", label);
 }
 
 std::string LevelDbTransaction::ToString() {
   std::string dest = absl::StrCat("<LevelDbTransaction ", label_, ": ");
-  size_t changes = deletions_.size() + mutations_.size();
+  size_t changes = changes_.size();
   size_t bytes = 0;  // accumulator for size of individual mutations.
   dest += std::to_string(changes) + " changes ";
   std::string items;  // accumulator for individual changes.
-  for (const auto& deletion : deletions_) {
-    absl::StrAppend(&items, "\n  - Delete ", DescribeKey(deletion));
+  for (const auto& entry : changes_) {
+    if (entry.second.is_delete) {
+      absl::StrAppend(&items, "\n  - Delete ", DescribeKey(entry.first));
+    }
   }
-  for (const auto& entry : mutations_) {
-    size_t change_bytes = entry.second.size();
+  for (const auto& entry : changes_) {
+    if (entry.second.is_delete) continue;
+    size_t change_bytes = entry.second.value.size();
     bytes += change_bytes;
     absl::StrAppend(&items, "\n  - Put ", DescribeKey(entry.first), " (",
                     change_bytes, " bytes)");
@@ -20,10 +20,10 @@
 #include <cstdint>
 #include <map>
 #include <memory>
-#include <set>
 #include <string>
 #include <utility>
 
+#include "Firestore/core/src/local/transaction_stats.h"
 #include "Firestore/core/src/nanopb/byte_string.h"
 #include "Firestore/core/src/nanopb/message.h"
 #include "Firestore/core/src/nanopb/writer.h"
@@ -40,17 +40,53 @@ namespace local {
  * changes and committed values.
  */
 class LevelDbTransaction {
-  using Deletions = std::set<std::string>;
-  using Mutations = std::map<std::string, std::string>;
+  /**
+   * A pending change to a single key: either a new value, or a deletion.
+   * Deletions are kept in the same map as new values, so that each change
+   * costs a single map node and the iterator can merge both kinds of changes
+   * with leveldb in one pass.
+   */
+  struct Change {
+    bool is_delete = false;
+    std::string value;
+  };
+
+  using Changes = std::map<std::string, Change>;
 
  public:
+  /**
+   * Describes how a read uses the data it reads, which determines whether
+   * checksums are verified and whether the blocks read are cached.
+   */
+  enum class ReadProfile {
+    /** Reads of individual keys, e.g. looking up a document by key. */
+    PointRead,
+
+    /**
+     * Scans done on behalf of a user-visible operation, e.g. executing a
+     * query. Their blocks are likely to be read again soon, so they fill the
+     * block cache.
+     */
+    ForegroundScan,
+
+    /**
+     * Scans over large ranges that are unlikely to be repeated soon, e.g. by
+     * garbage collection or schema migrations. They don't fill the block cache
+     * so that they don't evict the working set of foreground reads, and skip
+     * checksum verification since the data they read is also read (and
+     * verified) by foreground reads before it's surfaced.
+     */
+    BackgroundScan,
+  };
+
   /**
    * Iterator iterates over a merged view of pending changes from the
    * transaction and any unchanged values in the underlying leveldb instance.
    */
   class Iterator {
    public:
-    explicit Iterator(LevelDbTransaction* txn);
+    explicit Iterator(LevelDbTransaction* txn,
+                      ReadProfile profile = ReadProfile::ForegroundScan);
 
     /**
      * Returns true if this iterator points to an entry
@@ -71,38 +107,23 @@ class LevelDbTransaction {
     void Next();
 
     /**
-     * Returns the key of the current entry
+     * Returns the key of the current entry. The returned view remains valid
+     * until the next call to Seek() or Next(), even if the entry is deleted in
+     * the meantime.
      */
-    const std::string& key() const;
+    absl::string_view key() const;
 
     /**
-     * Returns the value of the current entry
+     * Returns the value of the current entry. The returned view remains valid
+     * until the next call to Seek() or Next(), or until the current key is
+     * written to again by the transaction.
      */
-    const std::string& value() const;
+    absl::string_view value() const;
 
    private:
     /**
-     * Advances to the next non-deleted key in leveldb.
-     */
-    void AdvanceLDB();
-
-    /**
-     * Returns true if the given slice matches a key present in the deletions_
-     * set.
-     */
-    bool IsDeleted(leveldb::Slice slice);
-
-    /**
-     * Syncs with the underlying transaction. If the transaction has been
-     * updated, the mutation iterator may need to be reset. Returns true if this
-     * resulted in moving to a new underlying entry (i.e. the entry represented
-     * by current_ was deleted).
-     */
-    bool SyncToTransaction();
-
-    /**
-     * Given the current state of the internal iterators, set is_valid_,
-     * is_mutation_, and current_.
+     * Given the current state of the internal iterators, skips over deleted
+     * entries and sets is_valid_ and is_mutation_.
      */
     void UpdateCurrent();
 
@@ -112,13 +133,13 @@ class LevelDbTransaction {
     int32_t last_version_;
     // The underlying transaction.
     LevelDbTransaction* txn_;
-    Mutations::iterator mutations_iter_;
-    // We save the current key and value so that once an iterator is Valid(), it
-    // remains so at least until the next call to Seek() or Next(), even if the
-    // underlying data is deleted.
-    std::pair<std::string, std::string> current_;
-    // True if current_ represents an entry in the mutations_ map, rather than
-    // committed data.
+    // Points to the first pending change whose key is equal to or greater than
+    // the current key. Entries of the changes_ map are never erased while the
+    // transaction is live (deletions are recorded in place), so this iterator
+    // is never invalidated.
+    Changes::iterator changes_iter_;
+    // True if the current entry is the one pointed to by changes_iter_, rather
+    // than committed data.
     bool is_mutation_;
     // True if the iterator pointed to a valid entry the last time Next() or
     // Seek() was called.
@@ -145,8 +166,22 @@ class LevelDbTransaction {
    */
   static const leveldb::WriteOptions& DefaultWriteOptions();
 
+  /**
+   * Returns the ReadOptions of this transaction, adjusted for reads with the
+   * given profile.
+   */
+  leveldb::ReadOptions ReadOptionsFor(ReadProfile profile) const;
+
   size_t changed_keys() const {
-    return mutations_.size() + deletions_.size();
+    return changes_.size();
+  }
+
+  /**
+   * The reads, writes and seeks made through this transaction so far,
+   * including those made before it was continued with `Continue`.
+   */
+  const TransactionCounters& counters() const {
+    return counters_;
   }
 
   /**
@@ -182,7 +217,8 @@ class LevelDbTransaction {
    * Returns a new Iterator over the pending changes in this transaction, merged
    * with the existing values already in leveldb.
    */
-  std::unique_ptr<Iterator> NewIterator();
+  std::unique_ptr<Iterator> NewIterator(
+      ReadProfile profile = ReadProfile::ForegroundScan);
 
   /**
    * Commits the transaction. All pending changes are written. The transaction
@@ -190,16 +226,31 @@ class LevelDbTransaction {
    */
   void Commit();
 
+  /**
+   * Commits the transaction like `Commit()`, but with the given options rather
+   * than those the transaction was created with.
+   *
+   * @return The approximate number of bytes written to LevelDB.
+   */
+  size_t Commit(const leveldb::WriteOptions& write_options);
+
+  /**
+   * Reopens a transaction whose commit was deferred, so that it continues as
+   * the transaction with the given label. The changes of both are committed
+   * together.
+   */
+  void Continue(absl::string_view label);
+
   std::string ToString();
 
  private:
   leveldb::DB* db_ = nullptr;
-  Mutations mutations_;
-  Deletions deletions_;
+  Changes changes_;
   leveldb::ReadOptions read_options_;
   leveldb::WriteOptions write_options_;
   int32_t version_ = 0;
   std::string label_;
+  TransactionCounters counters_;
 };
 
 /**
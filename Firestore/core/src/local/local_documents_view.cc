@@ -16,10 +16,17 @@
 
 #include "Firestore/core/src/local/local_documents_view.h"
 
+#include <algorithm>
+#include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/core/query_matcher.h"
+#include "Firestore/core/src/core/target.h"
+#include "Firestore/core/src/local/document_overlay_cache.h"
 #include "Firestore/core/src/local/mutation_queue.h"
 #include "Firestore/core/src/local/remote_document_cache.h"
 #include "Firestore/core/src/model/document.h"
@@ -37,8 +44,10 @@ namespace firestore {
 namespace local {
 
 using core::Query;
+using model::BatchId;
 using model::Document;
 using model::DocumentKey;
+using model::DocumentKeyHash;
 using model::DocumentKeySet;
 using model::DocumentMap;
 using model::MaybeDocument;
@@ -50,6 +59,37 @@ using model::OptionalMaybeDocumentMap;
 using model::ResourcePath;
 using model::SnapshotVersion;
 
+namespace {
+
+/**
+ * The number of batches that must mutate a document before its local view is
+ * cached as an overlay. Applying fewer batches is cheaper than reading and
+ * decoding the overlay.
+ */
+const size_t kMinBatchesForOverlay = 3;
+
+bool MutatesDocument(const MutationBatch& batch, const DocumentKey& key) {
+  for (const Mutation& mutation : batch.mutations()) {
+    if (mutation.key() == key) return true;
+  }
+  return false;
+}
+
+/**
+ * Returns true if `query` only needs the first `limit` matching documents in
+ * key order, which can be read without visiting the rest of the collection.
+ */
+bool IsKeyOrderedLimit(const Query& query) {
+  if (query.limit_type() != core::LimitType::First) {
+    return false;
+  }
+  const core::OrderByList& order_bys = query.order_bys();
+  return order_bys.size() == 1 && order_bys[0].field().IsKeyFieldPath() &&
+         order_bys[0].ascending();
+}
+
+}  // namespace
+
 absl::optional<MaybeDocument> LocalDocumentsView::GetDocument(
     const DocumentKey& key) {
   std::vector<MutationBatch> batches =
@@ -59,28 +99,77 @@ absl::optional<MaybeDocument> LocalDocumentsView::GetDocument(
 
 absl::optional<MaybeDocument> LocalDocumentsView::GetDocument(
     const DocumentKey& key, const std::vector<MutationBatch>& batches) {
-  absl::optional<MaybeDocument> document = remote_document_cache_->Get(key);
-  for (const MutationBatch& batch : batches) {
-    document = batch.ApplyToLocalDocument(document, key);
-  }
-
-  return document;
+  return ApplyLocalMutationsToDocument(key, remote_document_cache_->Get(key),
+                                       batches);
 }
 
 OptionalMaybeDocumentMap LocalDocumentsView::ApplyLocalMutationsToDocuments(
     const OptionalMaybeDocumentMap& docs,
     const std::vector<MutationBatch>& batches) {
-  OptionalMaybeDocumentMap results;
+  // Bucket the batches by the documents they mutate, so that each document
+  // only visits its own batches instead of all of them. This keeps views of
+  // many documents mutated by large queues (e.g. after a user change) linear.
+  std::unordered_map<DocumentKey, std::vector<MutationBatch>, DocumentKeyHash>
+      batches_by_key;
+  for (const MutationBatch& batch : batches) {
+    for (const std::vector<Mutation>* mutations :
+         {&batch.base_mutations(), &batch.mutations()}) {
+      for (const Mutation& mutation : *mutations) {
+        std::vector<MutationBatch>& key_batches =
+            batches_by_key[mutation.key()];
+        if (key_batches.empty() ||
+            key_batches.back().batch_id() != batch.batch_id()) {
+          key_batches.push_back(batch);
+        }
+      }
+    }
+  }
 
+  OptionalMaybeDocumentMap::Builder results;
+  results.reserve(docs.size());
+
+  const std::vector<MutationBatch> no_batches;
   for (const auto& kv : docs) {
     const DocumentKey& key = kv.first;
-    absl::optional<MaybeDocument> local_view = kv.second;
-    for (const MutationBatch& batch : batches) {
-      local_view = batch.ApplyToLocalDocument(local_view, key);
+    auto found = batches_by_key.find(key);
+    results.insert(key, ApplyLocalMutationsToDocument(
+                            key, kv.second,
+                            found != batches_by_key.end() ? found->second
+                                                          : no_batches));
+  }
+  return results.Build();
+}
+
+absl::optional<MaybeDocument> LocalDocumentsView::ApplyLocalMutationsToDocument(
+    const DocumentKey& key,
+    absl::optional<MaybeDocument> remote_doc,
+    const std::vector<MutationBatch>& batches) {
+  std::vector<BatchId> batch_ids;
+  for (const MutationBatch& batch : batches) {
+    if (MutatesDocument(batch, key)) {
+      batch_ids.push_back(batch.batch_id());
     }
-    results = results.insert(key, local_view);
   }
-  return results;
+
+  bool use_overlay =
+      overlay_cache_ && batch_ids.size() >= kMinBatchesForOverlay;
+  if (use_overlay) {
+    absl::optional<DocumentOverlay> overlay = overlay_cache_->Get(key);
+    if (overlay && overlay->IsValidFor(remote_doc, batch_ids)) {
+      return overlay->local_view();
+    }
+  }
+
+  absl::optional<MaybeDocument> local_view = remote_doc;
+  for (const MutationBatch& batch : batches) {
+    local_view = batch.ApplyToLocalDocument(std::move(local_view), key);
+  }
+
+  if (use_overlay) {
+    overlay_cache_->Save(
+        key, DocumentOverlay(remote_doc, std::move(batch_ids), local_view));
+  }
+  return local_view;
 }
 
 MaybeDocumentMap LocalDocumentsView::GetDocuments(const DocumentKeySet& keys) {
@@ -88,6 +177,19 @@ MaybeDocumentMap LocalDocumentsView::GetDocuments(const DocumentKeySet& keys) {
   return GetLocalViewOfDocuments(docs);
 }
 
+MaybeDocumentMap LocalDocumentsView::GetDocuments(
+    const DocumentKeySet& keys, const std::vector<MutationBatch>& batches) {
+  return BuildLocalView(remote_document_cache_->GetAll(keys), batches);
+}
+
+OptionalMaybeDocumentMap LocalDocumentsView::GetDocumentsIfCached(
+    const DocumentKeySet& keys) {
+  std::vector<MutationBatch> batches =
+      mutation_queue_->AllMutationBatchesAffectingDocumentKeys(keys);
+  return ApplyLocalMutationsToDocuments(remote_document_cache_->GetAll(keys),
+                                        batches);
+}
+
 MaybeDocumentMap LocalDocumentsView::GetLocalViewOfDocuments(
     const OptionalMaybeDocumentMap& base_docs) {
   DocumentKeySet all_keys;
@@ -96,11 +198,17 @@ MaybeDocumentMap LocalDocumentsView::GetLocalViewOfDocuments(
   }
   std::vector<MutationBatch> batches =
       mutation_queue_->AllMutationBatchesAffectingDocumentKeys(all_keys);
+  return BuildLocalView(base_docs, batches);
+}
 
+MaybeDocumentMap LocalDocumentsView::BuildLocalView(
+    const OptionalMaybeDocumentMap& base_docs,
+    const std::vector<MutationBatch>& batches) {
   OptionalMaybeDocumentMap docs =
       ApplyLocalMutationsToDocuments(base_docs, batches);
 
-  MaybeDocumentMap results;
+  MaybeDocumentMap::Builder results;
+  results.reserve(docs.size());
   for (const auto& kv : docs) {
     const DocumentKey& key = kv.first;
     absl::optional<MaybeDocument> maybe_doc = kv.second;
@@ -110,16 +218,18 @@ MaybeDocumentMap LocalDocumentsView::GetLocalViewOfDocuments(
       maybe_doc = NoDocument(key, SnapshotVersion::None(),
                              /* has_committed_mutations= */ false);
     }
-    results = results.insert(key, *maybe_doc);
+    results.insert(key, *maybe_doc);
   }
 
-  return results;
+  return results.Build();
 }
 
 DocumentMap LocalDocumentsView::GetDocumentsMatchingQuery(
     const Query& query, const model::SnapshotVersion& since_read_time) {
   if (query.IsDocumentQuery()) {
     return GetDocumentsMatchingDocumentQuery(query.path());
+  } else if (query.ToTarget().IsMultiDocumentQuery()) {
+    return GetDocumentsMatchingMultiDocumentQuery(query);
   } else if (query.IsCollectionGroupQuery()) {
     return GetDocumentsMatchingCollectionGroupQuery(query, since_read_time);
   } else {
@@ -127,6 +237,112 @@ DocumentMap LocalDocumentsView::GetDocumentsMatchingQuery(
   }
 }
 
+DocumentMap LocalDocumentsView::GetDocumentsMatchingCandidates(
+    const Query& query, const DocumentKeySet& candidate_keys) {
+  // Document lookups are cheaper than any candidates.
+  if (query.IsDocumentQuery() || query.ToTarget().IsMultiDocumentQuery()) {
+    return GetDocumentsMatchingQuery(query, SnapshotVersion::None());
+  }
+
+  if (!query.IsCollectionGroupQuery()) {
+    return ApplyMutationsToQueryResults(
+        query, mutation_queue_->AllMutationBatchesAffectingQuery(query),
+        remote_document_cache_->GetMatchingCandidates(query, candidate_keys));
+  }
+
+  // The index of a collection group spans all its collections, so the
+  // candidates are split by collection to overlay each collection's mutations.
+  const std::string& collection_id = *query.collection_group();
+  std::map<ResourcePath, DocumentKeySet> candidates_by_collection;
+  for (const ResourcePath& parent :
+       index_manager_->GetCollectionParents(collection_id)) {
+    candidates_by_collection[parent.Append(collection_id)];
+  }
+  for (const DocumentKey& key : candidate_keys) {
+    DocumentKeySet& keys = candidates_by_collection[key.path().PopLast()];
+    keys = keys.insert(key);
+  }
+
+  DocumentMap::Builder results;
+  for (const auto& entry : candidates_by_collection) {
+    Query collection_query = query.AsCollectionQueryAtPath(entry.first);
+    DocumentMap collection_results = ApplyMutationsToQueryResults(
+        collection_query,
+        mutation_queue_->AllMutationBatchesAffectingQuery(collection_query),
+        remote_document_cache_->GetMatchingCandidates(collection_query,
+                                                      entry.second));
+    for (const auto& kv : collection_results.underlying_map()) {
+      results.insert(kv.first, Document(kv.second));
+    }
+  }
+  return results.Build();
+}
+
+int64_t LocalDocumentsView::CountDocumentsMatchingQuery(const Query& query) {
+  int64_t limit = query.limit_type() == core::LimitType::None
+                      ? core::Target::kNoLimit
+                      : query.limit();
+
+  if (query.IsDocumentQuery()) {
+    absl::optional<MaybeDocument> doc =
+        GetDocument(DocumentKey{query.path()});
+    return doc && doc->is_document() ? 1 : 0;
+  }
+
+  if (!query.IsCollectionGroupQuery()) {
+    return CountDocumentsMatchingCollectionQuery(query, limit);
+  }
+
+  const std::string& collection_id = *query.collection_group();
+  int64_t count = 0;
+  for (const ResourcePath& parent :
+       index_manager_->GetCollectionParents(collection_id)) {
+    if (count >= limit) break;
+
+    Query collection_query =
+        query.AsCollectionQueryAtPath(parent.Append(collection_id));
+    count +=
+        CountDocumentsMatchingCollectionQuery(collection_query, limit - count);
+  }
+  return count;
+}
+
+int64_t LocalDocumentsView::CountDocumentsMatchingCollectionQuery(
+    const Query& query, int64_t limit) {
+  DocumentKeySet mutated_keys;
+  for (const MutationBatch& batch :
+       mutation_queue_->AllMutationBatchesAffectingQuery(query)) {
+    for (const Mutation& mutation : batch.mutations()) {
+      if (query.path().IsImmediateParentOf(mutation.key().path())) {
+        mutated_keys = mutated_keys.insert(mutation.key());
+      }
+    }
+  }
+
+  // Documents without pending mutations match as they are in the cache.
+  int64_t count = 0;
+  core::QueryMatcher matcher(query);
+  remote_document_cache_->EnumerateMatching(query, [&](const Document& doc) {
+    if (!mutated_keys.contains(doc.key()) && matcher.Matches(doc)) {
+      ++count;
+    }
+    return count < limit;
+  });
+
+  // The mutated documents match depending on their local view, whether or not
+  // they are in the cache.
+  if (count < limit && !mutated_keys.empty()) {
+    for (const auto& kv : GetDocuments(mutated_keys)) {
+      const MaybeDocument& maybe_doc = kv.second;
+      if (maybe_doc.is_document() && matcher.Matches(Document(maybe_doc))) {
+        ++count;
+      }
+    }
+  }
+
+  return std::min(count, limit);
+}
+
 DocumentMap LocalDocumentsView::GetDocumentsMatchingDocumentQuery(
     const ResourcePath& doc_path) {
   DocumentMap result;
@@ -138,6 +354,23 @@ DocumentMap LocalDocumentsView::GetDocumentsMatchingDocumentQuery(
   return result;
 }
 
+DocumentMap LocalDocumentsView::GetDocumentsMatchingMultiDocumentQuery(
+    const Query& query) {
+  DocumentKeySet keys;
+  for (const DocumentKey& key : query.ToTarget().GetDocumentKeys()) {
+    keys = keys.insert(key);
+  }
+
+  DocumentMap result;
+  for (const auto& kv : GetDocuments(keys)) {
+    const MaybeDocument& maybe_doc = kv.second;
+    if (maybe_doc.is_document()) {
+      result = result.insert(kv.first, Document(maybe_doc));
+    }
+  }
+  return result;
+}
+
 model::DocumentMap LocalDocumentsView::GetDocumentsMatchingCollectionGroupQuery(
     const Query& query, const SnapshotVersion& since_read_time) {
   HARD_ASSERT(
@@ -147,32 +380,79 @@ model::DocumentMap LocalDocumentsView::GetDocumentsMatchingCollectionGroupQuery(
   const std::string& collection_id = *query.collection_group();
   std::vector<ResourcePath> parents =
       index_manager_->GetCollectionParents(collection_id);
-  DocumentMap results;
-
-  // Perform a collection query against each parent that contains the
-  // collection_id and aggregate the results.
+  std::vector<ResourcePath> collection_paths;
+  collection_paths.reserve(parents.size());
   for (const ResourcePath& parent : parents) {
-    Query collection_query =
-        query.AsCollectionQueryAtPath(parent.Append(collection_id));
-    DocumentMap collection_results =
-        GetDocumentsMatchingCollectionQuery(collection_query, since_read_time);
+    collection_paths.push_back(parent.Append(collection_id));
+  }
+
+  DocumentMap::Builder results;
+  auto add_results = [&results](const DocumentMap& collection_results) {
     for (const auto& kv : collection_results.underlying_map()) {
-      const DocumentKey& key = kv.first;
-      results = results.insert(key, Document(kv.second));
+      results.insert(kv.first, Document(kv.second));
+    }
+  };
+
+  // Key-ordered limits stop reading each collection early, which a read of
+  // all the collections at once can't do.
+  if (since_read_time == SnapshotVersion::None() && IsKeyOrderedLimit(query)) {
+    for (const ResourcePath& collection_path : collection_paths) {
+      add_results(GetDocumentsMatchingCollectionQuery(
+          query.AsCollectionQueryAtPath(collection_path), since_read_time));
     }
+    return results.Build();
   }
-  return results;
+
+  // Read the remote documents of all the collections together, then split
+  // them by collection to overlay each collection's mutations.
+  DocumentMap remote_documents =
+      remote_document_cache_->GetMatchingInCollections(query, collection_paths,
+                                                       since_read_time);
+  std::map<ResourcePath, DocumentMap::Builder> remote_by_collection;
+  for (const auto& kv : remote_documents.underlying_map()) {
+    const DocumentKey& key = kv.first;
+    remote_by_collection[key.path().PopLast()].insert(key, Document(kv.second));
+  }
+
+  for (const ResourcePath& collection_path : collection_paths) {
+    Query collection_query = query.AsCollectionQueryAtPath(collection_path);
+    std::vector<MutationBatch> matching_batches =
+        mutation_queue_->AllMutationBatchesAffectingQuery(collection_query);
+
+    DocumentMap collection_documents;
+    auto found = remote_by_collection.find(collection_path);
+    if (found != remote_by_collection.end()) {
+      collection_documents = found->second.Build();
+    }
+    add_results(ApplyMutationsToQueryResults(
+        collection_query, matching_batches, std::move(collection_documents)));
+  }
+  return results.Build();
 }
 
 DocumentMap LocalDocumentsView::GetDocumentsMatchingCollectionQuery(
     const Query& query, const SnapshotVersion& since_read_time) {
-  DocumentMap results =
-      remote_document_cache_->GetMatching(query, since_read_time);
   // Get locally persisted mutation batches.
   std::vector<MutationBatch> matching_batches =
       mutation_queue_->AllMutationBatchesAffectingQuery(query);
 
-  results = AddMissingBaseDocuments(matching_batches, std::move(results));
+  DocumentMap results;
+  if (since_read_time == SnapshotVersion::None() && IsKeyOrderedLimit(query)) {
+    results = GetRemoteDocumentsUpToLimit(query, matching_batches);
+  } else {
+    results = remote_document_cache_->GetMatching(query, since_read_time);
+  }
+
+  return ApplyMutationsToQueryResults(query, matching_batches,
+                                      std::move(results));
+}
+
+DocumentMap LocalDocumentsView::ApplyMutationsToQueryResults(
+    const Query& query,
+    const std::vector<MutationBatch>& matching_batches,
+    DocumentMap remote_documents) {
+  DocumentMap results =
+      AddMissingBaseDocuments(matching_batches, std::move(remote_documents));
 
   for (const MutationBatch& batch : matching_batches) {
     for (const Mutation& mutation : batch.mutations()) {
@@ -203,10 +483,11 @@ DocumentMap LocalDocumentsView::GetDocumentsMatchingCollectionQuery(
   // deallocating the initial unfiltered results while we're iterating over
   // them.
   DocumentMap unfiltered = results;
+  core::QueryMatcher matcher(query);
   for (const auto& kv : unfiltered.underlying_map()) {
     const DocumentKey& key = kv.first;
     Document doc(kv.second);
-    if (!query.Matches(doc)) {
+    if (!matcher.Matches(doc)) {
       results = results.erase(key);
     }
   }
@@ -214,6 +495,43 @@ DocumentMap LocalDocumentsView::GetDocumentsMatchingCollectionQuery(
   return results;
 }
 
+DocumentMap LocalDocumentsView::GetRemoteDocumentsUpToLimit(
+    const Query& query, const std::vector<MutationBatch>& matching_batches) {
+  DocumentKeySet mutated_keys;
+  for (const MutationBatch& batch : matching_batches) {
+    for (const Mutation& mutation : batch.mutations()) {
+      if (query.path().IsImmediateParentOf(mutation.key().path())) {
+        mutated_keys = mutated_keys.insert(mutation.key());
+      }
+    }
+  }
+
+  DocumentMap results;
+  int32_t remaining = query.limit();
+  core::QueryMatcher matcher(query);
+  remote_document_cache_->EnumerateMatching(query, [&](const Document& doc) {
+    if (mutated_keys.contains(doc.key())) {
+      results = results.insert(doc.key(), doc);
+      mutated_keys = mutated_keys.erase(doc.key());
+    } else if (matcher.Matches(doc)) {
+      results = results.insert(doc.key(), doc);
+      --remaining;
+    }
+    return remaining > 0;
+  });
+
+  // Mutated documents past the limit still need their base documents.
+  OptionalMaybeDocumentMap base_docs =
+      remote_document_cache_->GetAll(mutated_keys);
+  for (const auto& kv : base_docs) {
+    const absl::optional<MaybeDocument>& maybe_doc = kv.second;
+    if (maybe_doc && maybe_doc->is_document()) {
+      results = results.insert(kv.first, Document(*maybe_doc));
+    }
+  }
+  return results;
+}
+
 DocumentMap LocalDocumentsView::AddMissingBaseDocuments(
     const std::vector<MutationBatch>& matching_batches,
     DocumentMap existing_docs) {
@@ -17,8 +17,10 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_LOCAL_DOCUMENTS_VIEW_H_
 #define FIRESTORE_CORE_SRC_LOCAL_LOCAL_DOCUMENTS_VIEW_H_
 
+#include <cstdint>
 #include <vector>
 
+#include "Firestore/core/src/local/document_overlay_cache.h"
 #include "Firestore/core/src/local/index_manager.h"
 #include "Firestore/core/src/local/mutation_queue.h"
 #include "Firestore/core/src/local/remote_document_cache.h"
@@ -43,9 +45,11 @@ class LocalDocumentsView {
  public:
   LocalDocumentsView(RemoteDocumentCache* remote_document_cache,
                      MutationQueue* mutation_queue,
+                     DocumentOverlayCache* overlay_cache,
                      IndexManager* index_manager)
       : remote_document_cache_{remote_document_cache},
         mutation_queue_{mutation_queue},
+        overlay_cache_{overlay_cache},
         index_manager_{index_manager} {
   }
 
@@ -68,6 +72,22 @@ class LocalDocumentsView {
    */
   model::MaybeDocumentMap GetDocuments(const model::DocumentKeySet& keys);
 
+  /**
+   * Like `GetDocuments`, but applies the given `batches` instead of reading
+   * the batches that affect `keys` from the mutation queue. `batches` must
+   * include every batch that affects any of the documents in `keys`.
+   */
+  model::MaybeDocumentMap GetDocuments(
+      const model::DocumentKeySet& keys,
+      const std::vector<model::MutationBatch>& batches);
+
+  /**
+   * Like `GetDocuments`, but maps the keys of documents without cached state
+   * to `nullopt`, like `GetDocument` does, instead of to a NoDocument.
+   */
+  model::OptionalMaybeDocumentMap GetDocumentsIfCached(
+      const model::DocumentKeySet& keys);
+
   /**
    * Similar to `GetDocuments`, but creates the local view from the given
    * `base_docs` without retrieving documents from the local store.
@@ -86,6 +106,33 @@ class LocalDocumentsView {
   virtual model::DocumentMap GetDocumentsMatchingQuery(
       const core::Query& query, const model::SnapshotVersion& since_read_time);
 
+  /**
+   * Like `GetDocumentsMatchingQuery` without a read time, but only reads the
+   * remote documents with the given keys instead of looking up the candidates
+   * for the query again.
+   *
+   * @param query The collection or collection group query to match documents
+   *     against.
+   * @param candidate_keys The keys `index_manager()` returned for the query.
+   */
+  model::DocumentMap GetDocumentsMatchingCandidates(
+      const core::Query& query, const model::DocumentKeySet& candidate_keys);
+
+  /**
+   * Counts the documents in the local view that match the query, up to its
+   * limit if it has one.
+   *
+   * Unlike `GetDocumentsMatchingQuery`, this only materializes the documents
+   * affected by pending mutations; the remote documents are visited one at a
+   * time and the enumeration stops once the limit is reached.
+   */
+  int64_t CountDocumentsMatchingQuery(const core::Query& query);
+
+  /** The index manager that serves the queries against this view. */
+  IndexManager* index_manager() {
+    return index_manager_;
+  }
+
  private:
   friend class CountingQueryEngine;  // For testing
 
@@ -94,6 +141,14 @@ class LocalDocumentsView {
       const model::DocumentKey& key,
       const std::vector<model::MutationBatch>& batches);
 
+  /**
+   * Returns the local view of the given `base_docs` after applying the given
+   * `batches`, with a NoDocument for each document that doesn't exist.
+   */
+  model::MaybeDocumentMap BuildLocalView(
+      const model::OptionalMaybeDocumentMap& base_docs,
+      const std::vector<model::MutationBatch>& batches);
+
   /**
    * Returns the view of the given `docs` as they would appear after applying
    * all mutations in the given `batches`.
@@ -102,17 +157,62 @@ class LocalDocumentsView {
       const model::OptionalMaybeDocumentMap& docs,
       const std::vector<model::MutationBatch>& batches);
 
+  /**
+   * Returns the view of the given remote document as it would appear after
+   * applying all mutations to it in the given `batches`.
+   *
+   * Documents mutated by several batches are looked up in, and saved to, the
+   * overlay cache instead of being recomputed every time.
+   */
+  absl::optional<model::MaybeDocument> ApplyLocalMutationsToDocument(
+      const model::DocumentKey& key,
+      absl::optional<model::MaybeDocument> remote_doc,
+      const std::vector<model::MutationBatch>& batches);
+
   /** Performs a simple document lookup for the given path. */
   model::DocumentMap GetDocumentsMatchingDocumentQuery(
       const model::ResourcePath& doc_path);
 
+  /**
+   * Looks up the documents of a multi-document query by key instead of
+   * scanning their collection.
+   */
+  model::DocumentMap GetDocumentsMatchingMultiDocumentQuery(
+      const core::Query& query);
+
   model::DocumentMap GetDocumentsMatchingCollectionGroupQuery(
       const core::Query& query, const model::SnapshotVersion& since_read_time);
 
+  /**
+   * Counts the documents matching a collection query, stopping once `limit`
+   * documents have been found.
+   */
+  int64_t CountDocumentsMatchingCollectionQuery(const core::Query& query,
+                                                int64_t limit);
+
   /** Queries the remote documents and overlays mutations. */
   model::DocumentMap GetDocumentsMatchingCollectionQuery(
       const core::Query& query, const model::SnapshotVersion& since_read_time);
 
+  /**
+   * Overlays the given mutation batches on the remote documents of a
+   * collection query, and drops the documents that don't match the query.
+   */
+  model::DocumentMap ApplyMutationsToQueryResults(
+      const core::Query& query,
+      const std::vector<model::MutationBatch>& matching_batches,
+      model::DocumentMap remote_documents);
+
+  /**
+   * Reads the remote documents for a limit query ordered by key, stopping as
+   * soon as `query.limit()` documents that aren't affected by the given
+   * batches match the query. Documents affected by the batches are always
+   * included, since their local view may or may not match.
+   */
+  model::DocumentMap GetRemoteDocumentsUpToLimit(
+      const core::Query& query,
+      const std::vector<model::MutationBatch>& matching_batches);
+
   /**
    * It is possible that a `PatchMutation` can make a document match a query,
    * even if the version in the `RemoteDocumentCache` is not a match yet
@@ -134,13 +234,14 @@ class LocalDocumentsView {
     return mutation_queue_;
   }
 
-  IndexManager* index_manager() {
-    return index_manager_;
+  DocumentOverlayCache* overlay_cache() {
+    return overlay_cache_;
   }
 
  private:
   RemoteDocumentCache* remote_document_cache_;
   MutationQueue* mutation_queue_;
+  DocumentOverlayCache* overlay_cache_;
   IndexManager* index_manager_;
 };
 
@@ -32,6 +32,7 @@
 #include "Firestore/core/src/core/query.h"
 #include "Firestore/core/src/local/target_data.h"
 #include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/field_path.h"
 #include "Firestore/core/src/model/field_value.h"
 #include "Firestore/core/src/model/mutation_batch.h"
 #include "Firestore/core/src/model/no_document.h"
@@ -40,6 +41,7 @@
 #include "Firestore/core/src/nanopb/byte_string.h"
 #include "Firestore/core/src/nanopb/message.h"
 #include "Firestore/core/src/nanopb/nanopb_util.h"
+#include "Firestore/core/src/nanopb/writer.h"
 #include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/string_format.h"
 
@@ -53,27 +55,110 @@ using bundle::BundleMetadata;
 using bundle::NamedQuery;
 using core::Target;
 using model::Document;
+using model::DocumentKey;
 using model::DocumentState;
+using model::FieldPath;
 using model::FieldTransform;
 using model::FieldValue;
 using model::MaybeDocument;
 using model::Mutation;
 using model::MutationBatch;
 using model::NoDocument;
+using model::LazyDocumentData;
 using model::ObjectValue;
 using model::SnapshotVersion;
 using model::UnknownDocument;
 using nanopb::ByteString;
+using nanopb::CalculateEncodedSize;
 using nanopb::CheckedSize;
 using nanopb::CopyBytesArray;
 using nanopb::MakeArray;
+using nanopb::MakeStdString;
 using nanopb::Message;
 using nanopb::Reader;
 using nanopb::SafeReadBoolean;
+using nanopb::StringWriter;
 using nanopb::Writer;
+using util::ReadContext;
 using util::Status;
 using util::StringFormat;
 
+/**
+ * Returns the value of the entry named `name` among the given map entries, or
+ * nullptr if there is no such entry. Works for both document fields and map
+ * values, whose entries have distinct types but the same shape.
+ */
+template <typename Entry>
+const google_firestore_v1_Value* FindEntry(const Entry* entries,
+                                           pb_size_t count,
+                                           const std::string& name) {
+  for (pb_size_t i = 0; i < count; ++i) {
+    if (nanopb::MakeStringView(entries[i].key) == name) {
+      return &entries[i].value;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * The fields of a locally stored Document, kept in their parsed nanopb form
+ * and only converted to FieldValues once they are read.
+ */
+class LazyDocumentFields : public LazyDocumentData {
+ public:
+  LazyDocumentFields(std::shared_ptr<const remote::Serializer> serializer,
+                     Message<firestore_client_MaybeDocument> message)
+      : serializer_(std::move(serializer)), message_(std::move(message)) {
+  }
+
+  ObjectValue Decode() const override {
+    const google_firestore_v1_Document& proto = message_->document;
+
+    ReadContext context;
+    ObjectValue result =
+        serializer_->DecodeFields(&context, proto.fields_count, proto.fields);
+    CheckDecoded(context);
+    return result;
+  }
+
+  absl::optional<FieldValue> DecodeField(
+      const FieldPath& path) const override {
+    if (path.empty()) {
+      return Decode().Get(path);
+    }
+
+    const google_firestore_v1_Document& proto = message_->document;
+    const google_firestore_v1_Value* value =
+        FindEntry(proto.fields, proto.fields_count, path.first_segment());
+    for (size_t i = 1; value && i < path.size(); ++i) {
+      if (value->which_value_type != google_firestore_v1_Value_map_value_tag) {
+        return absl::nullopt;
+      }
+      const google_firestore_v1_MapValue& map = value->map_value;
+      value = FindEntry(map.fields, map.fields_count, path[i]);
+    }
+    if (!value) {
+      return absl::nullopt;
+    }
+
+    ReadContext context;
+    FieldValue result = serializer_->DecodeFieldValue(&context, *value);
+    CheckDecoded(context);
+    return result;
+  }
+
+ private:
+  static void CheckDecoded(const ReadContext& context) {
+    if (!context.ok()) {
+      HARD_FAIL("Document fields failed to decode: %s",
+                context.status().ToString());
+    }
+  }
+
+  std::shared_ptr<const remote::Serializer> serializer_;
+  Message<firestore_client_MaybeDocument> message_;
+};
+
 }  // namespace
 
 Message<firestore_client_MaybeDocument> LocalSerializer::EncodeMaybeDocument(
@@ -84,9 +169,6 @@ Message<firestore_client_MaybeDocument> LocalSerializer::EncodeMaybeDocument(
     case MaybeDocument::Type::Document: {
       result->which_document_type = firestore_client_MaybeDocument_document_tag;
       Document doc(maybe_doc);
-      // TODO(b/142956770): other platforms check for whether the `Document`
-      // contains a memoized proto and use it if available instead of
-      // re-encoding.
       result->document = EncodeDocument(doc);
       result->has_committed_mutations = doc.has_committed_mutations();
       return result;
@@ -116,6 +198,30 @@ Message<firestore_client_MaybeDocument> LocalSerializer::EncodeMaybeDocument(
   UNREACHABLE();
 }
 
+std::string LocalSerializer::EncodeMaybeDocumentToString(
+    const MaybeDocument& maybe_doc) const {
+  if (maybe_doc.type() == MaybeDocument::Type::Document) {
+    Document doc(maybe_doc);
+    std::shared_ptr<const google_firestore_v1_Document> proto =
+        doc.TakeProto();
+    if (proto) {
+      // `result` only borrows the memoized proto, so it must not be released.
+      firestore_client_MaybeDocument result{};
+      result.which_document_type = firestore_client_MaybeDocument_document_tag;
+      result.document = *proto;
+      result.has_committed_mutations = doc.has_committed_mutations();
+
+      StringWriter writer;
+      writer.Reserve(
+          CalculateEncodedSize(firestore_client_MaybeDocument_fields, &result));
+      writer.Write(firestore_client_MaybeDocument_fields, &result);
+      return writer.Release();
+    }
+  }
+
+  return MakeStdString(EncodeMaybeDocument(maybe_doc));
+}
+
 MaybeDocument LocalSerializer::DecodeMaybeDocument(
     Reader* reader, const firestore_client_MaybeDocument& proto) const {
   if (!reader->status().ok()) return {};
@@ -145,6 +251,30 @@ MaybeDocument LocalSerializer::DecodeMaybeDocument(
   UNREACHABLE();
 }
 
+MaybeDocument LocalSerializer::DecodeMaybeDocumentLazily(
+    Reader* reader, Message<firestore_client_MaybeDocument> message) const {
+  if (!reader->status().ok()) return {};
+  if (message->which_document_type !=
+      firestore_client_MaybeDocument_document_tag) {
+    return DecodeMaybeDocument(reader, *message);
+  }
+
+  // Only the fields are decoded lazily: the key and version are needed right
+  // away and cheap to decode.
+  const google_firestore_v1_Document& proto = message->document;
+  DocumentKey key = rpc_serializer_.DecodeKey(reader->context(), proto.name);
+  SnapshotVersion version =
+      rpc_serializer_.DecodeVersion(reader->context(), proto.update_time);
+  DocumentState state = SafeReadBoolean(message->has_committed_mutations)
+                            ? DocumentState::kCommittedMutations
+                            : DocumentState::kSynced;
+  if (!reader->status().ok()) return {};
+
+  auto fields = std::make_shared<LazyDocumentFields>(lazy_rpc_serializer_,
+                                                     std::move(message));
+  return Document(std::move(fields), std::move(key), version, state);
+}
+
 google_firestore_v1_Document LocalSerializer::EncodeDocument(
     const Document& doc) const {
   google_firestore_v1_Document result{};
@@ -228,6 +358,22 @@ UnknownDocument LocalSerializer::DecodeUnknownDocument(
 
 Message<firestore_client_Target> LocalSerializer::EncodeTargetData(
     const TargetData& target_data) const {
+  Message<firestore_client_Target> result = EncodeTargetState(target_data);
+
+  const Target& target = target_data.target();
+  if (target.IsDocumentQuery() || target.IsMultiDocumentQuery()) {
+    result->which_target_type = firestore_client_Target_documents_tag;
+    result->documents = rpc_serializer_.EncodeDocumentsTarget(target);
+  } else {
+    result->which_target_type = firestore_client_Target_query_tag;
+    result->query = rpc_serializer_.EncodeQueryTarget(target);
+  }
+
+  return result;
+}
+
+Message<firestore_client_Target> LocalSerializer::EncodeTargetState(
+    const TargetData& target_data) const {
   HARD_ASSERT(target_data.purpose() == QueryPurpose::Listen,
               "Only queries with purpose %s may be stored, got %s",
               QueryPurpose::Listen, target_data.purpose());
@@ -243,18 +389,35 @@ Message<firestore_client_Target> LocalSerializer::EncodeTargetData(
 
   // Force a copy because pb_release would otherwise double-free.
   result->resume_token =
-      nanopb::CopyBytesArray(target_data.resume_token().get());
+      nanopb::CopyBytesArray(target_data.resume_token());
 
-  const Target& target = target_data.target();
-  if (target.IsDocumentQuery()) {
-    result->which_target_type = firestore_client_Target_documents_tag;
-    result->documents = rpc_serializer_.EncodeDocumentsTarget(target);
-  } else {
-    result->which_target_type = firestore_client_Target_query_tag;
-    result->query = rpc_serializer_.EncodeQueryTarget(target);
+  return result;
+}
+
+TargetData LocalSerializer::DecodeTargetState(
+    Reader* reader,
+    const firestore_client_Target& proto,
+    const TargetData& target_data) const {
+  if (!reader->status().ok()) return TargetData();
+
+  if (proto.target_id != target_data.target_id()) {
+    reader->Fail(StringFormat("Target state of target %s found for target %s",
+                              proto.target_id, target_data.target_id()));
+    return TargetData();
   }
 
-  return result;
+  SnapshotVersion version =
+      rpc_serializer_.DecodeVersion(reader->context(), proto.snapshot_version);
+  SnapshotVersion last_limbo_free_snapshot_version =
+      rpc_serializer_.DecodeVersion(reader->context(),
+                                    proto.last_limbo_free_snapshot_version);
+  if (!reader->status().ok()) return TargetData();
+
+  return target_data
+      .WithSequenceNumber(static_cast<model::ListenSequenceNumber>(
+          proto.last_listen_sequence_number))
+      .WithResumeToken(ByteString(proto.resume_token), version)
+      .WithLastLimboFreeSnapshotVersion(last_limbo_free_snapshot_version);
 }
 
 TargetData LocalSerializer::DecodeTargetData(
@@ -79,7 +79,9 @@ class TargetData;
 class LocalSerializer {
  public:
   explicit LocalSerializer(remote::Serializer rpc_serializer)
-      : rpc_serializer_(std::move(rpc_serializer)) {
+      : rpc_serializer_(std::move(rpc_serializer)),
+        lazy_rpc_serializer_(
+            std::make_shared<remote::Serializer>(rpc_serializer_)) {
   }
 
   /**
@@ -89,6 +91,16 @@ class LocalSerializer {
   nanopb::Message<firestore_client_MaybeDocument> EncodeMaybeDocument(
       const model::MaybeDocument& maybe_doc) const;
 
+  /**
+   * @brief Encodes a MaybeDocument model to its serialized form for local
+   * storage. Equivalent to `MakeStdString(EncodeMaybeDocument(maybe_doc))`,
+   * except that documents received from the backend are encoded from the
+   * proto they were decoded from instead of being re-encoded from their
+   * fields.
+   */
+  std::string EncodeMaybeDocumentToString(
+      const model::MaybeDocument& maybe_doc) const;
+
   /**
    * @brief Decodes nanopb proto representing a MaybeDocument proto to the
    * equivalent model.
@@ -97,6 +109,18 @@ class LocalSerializer {
       nanopb::Reader* reader,
       const firestore_client_MaybeDocument& proto) const;
 
+  /**
+   * @brief Decodes a MaybeDocument like `DecodeMaybeDocument`, but keeps the
+   * fields of a Document in `message` and only decodes them once they are
+   * read (see `model::LazyDocumentData`).
+   *
+   * Errors in the fields are therefore only detected once they are read, and
+   * are fatal.
+   */
+  model::MaybeDocument DecodeMaybeDocumentLazily(
+      nanopb::Reader* reader,
+      nanopb::Message<firestore_client_MaybeDocument> message) const;
+
   /**
    * @brief Encodes a TargetData to the equivalent nanopb proto, representing a
    * ::firestore::proto::Target, for local storage.
@@ -111,6 +135,22 @@ class LocalSerializer {
   TargetData DecodeTargetData(nanopb::Reader* reader,
                               const firestore_client_Target& proto) const;
 
+  /**
+   * @brief Encodes the parts of a TargetData that change while its target is
+   * listened to (the sequence number, snapshot versions and resume token) to a
+   * ::firestore::proto::Target without a target_type.
+   */
+  nanopb::Message<firestore_client_Target> EncodeTargetState(
+      const TargetData& target_data) const;
+
+  /**
+   * @brief Returns `target_data` updated with the state decoded from a proto
+   * encoded by `EncodeTargetState`.
+   */
+  TargetData DecodeTargetState(nanopb::Reader* reader,
+                               const firestore_client_Target& proto,
+                               const TargetData& target_data) const;
+
   /**
    * @brief Encodes a MutationBatch to the equivalent nanopb proto, representing
    * a ::firestore::client::WriteBatch, for local storage in the mutation queue.
@@ -172,6 +212,9 @@ class LocalSerializer {
       nanopb::Reader* reader, const firestore_BundledQuery& query) const;
 
   remote::Serializer rpc_serializer_;
+
+  // Shared by lazily decoded Documents, which may outlive this serializer.
+  std::shared_ptr<const remote::Serializer> lazy_rpc_serializer_;
 };
 
 }  // namespace local
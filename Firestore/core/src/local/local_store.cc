@@ -16,10 +16,13 @@
 
 #include "Firestore/core/src/local/local_store.h"
 
+#include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/local/bundle_cache.h"
+#include "Firestore/core/src/local/index_manager.h"
 #include "Firestore/core/src/local/local_documents_view.h"
 #include "Firestore/core/src/local/local_view_changes.h"
 #include "Firestore/core/src/local/local_write_result.h"
@@ -29,12 +32,17 @@
 #include "Firestore/core/src/local/query_result.h"
 #include "Firestore/core/src/local/reference_delegate.h"
 #include "Firestore/core/src/local/target_cache.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/field_index.h"
 #include "Firestore/core/src/model/mutation_batch.h"
 #include "Firestore/core/src/model/mutation_batch_result.h"
 #include "Firestore/core/src/model/patch_mutation.h"
+#include "Firestore/core/src/model/set_mutation.h"
 #include "Firestore/core/src/remote/remote_event.h"
+#include "Firestore/core/src/util/allocation_tracker.h"
 #include "Firestore/core/src/util/log.h"
 #include "Firestore/core/src/util/to_string.h"
+#include "Firestore/core/src/util/trace.h"
 
 namespace firebase {
 namespace firestore {
@@ -46,11 +54,14 @@ using core::Query;
 using core::Target;
 using core::TargetIdGenerator;
 using model::BatchId;
+using model::Document;
 using model::DocumentKey;
 using model::DocumentKeySet;
 using model::DocumentMap;
 using model::DocumentUpdateMap;
 using model::DocumentVersionMap;
+using model::FieldMask;
+using model::FieldPath;
 using model::ListenSequenceNumber;
 using model::MaybeDocument;
 using model::MaybeDocumentMap;
@@ -62,6 +73,7 @@ using model::OptionalMaybeDocumentMap;
 using model::PatchMutation;
 using model::Precondition;
 using model::ResourcePath;
+using model::SetMutation;
 using model::SnapshotVersion;
 using model::TargetId;
 using nanopb::ByteString;
@@ -75,6 +87,114 @@ using remote::TargetChange;
  */
 const int64_t kResumeTokenMaxAgeSeconds = 5 * 60;  // 5 minutes
 
+/** Whether the document exists once a mutation with `precondition` applied. */
+bool RequiresExisting(const Precondition& precondition) {
+  return precondition.type() == Precondition::Type::Exists &&
+         precondition.exists();
+}
+
+/**
+ * Whether a remote document of the given version replaces the version of it in
+ * the remote document cache, if any. A document with pending writes is also
+ * replaced by the same version, which clears the pending writes.
+ */
+bool IsNewerThanCached(const SnapshotVersion& version,
+                       const absl::optional<MaybeDocument>& cached) {
+  return !cached || version > cached->version() ||
+         (version == cached->version() && cached->has_pending_writes());
+}
+
+ObjectValue ApplyPatch(ObjectValue value, const PatchMutation& patch) {
+  ObjectValue::Builder builder{std::move(value)};
+  for (const FieldPath& path : patch.mask()) {
+    absl::optional<model::FieldValue> new_value = patch.value().Get(path);
+    if (new_value) {
+      builder.Set(path, *std::move(new_value));
+    } else {
+      builder.Delete(path);
+    }
+  }
+  return builder.Build();
+}
+
+/**
+ * Returns the union of the given masks without the paths that another path in
+ * the union already covers.
+ */
+FieldMask MergeMasks(const FieldMask& first, const FieldMask& second) {
+  std::set<FieldPath> all{first.begin(), first.end()};
+  all.insert(second.begin(), second.end());
+
+  std::set<FieldPath> merged;
+  for (const FieldPath& path : all) {
+    // Paths sort right after their prefixes.
+    if (merged.empty() || !merged.rbegin()->IsPrefixOf(path)) {
+      merged.insert(merged.end(), path);
+    }
+  }
+  return FieldMask{std::move(merged)};
+}
+
+/**
+ * Returns a single mutation with the effect of applying `first` and then
+ * `second` to the same document, or `nullopt` if there's no such mutation that
+ * also fails whenever either of them would; see `LocalStore::WriteLocally`.
+ */
+absl::optional<Mutation> SquashMutations(const Mutation& first,
+                                         const Mutation& second) {
+  if (first.key() != second.key() || !first.field_transforms().empty() ||
+      !second.field_transforms().empty()) {
+    return absl::nullopt;
+  }
+
+  const Precondition& first_precondition = first.precondition();
+  const Precondition& second_precondition = second.precondition();
+  switch (second.type()) {
+    case Mutation::Type::Set:
+      // A set replaces whatever the first mutation did, whether or not it
+      // applied.
+      if (second_precondition.is_none() &&
+          (first.type() == Mutation::Type::Set ||
+           first.type() == Mutation::Type::Patch)) {
+        return SetMutation(second.key(), SetMutation(second).value(),
+                           Precondition::None());
+      }
+      return absl::nullopt;
+
+    case Mutation::Type::Patch: {
+      // Once the first mutation applied, the document exists.
+      if (!second_precondition.is_none() &&
+          !RequiresExisting(second_precondition)) {
+        return absl::nullopt;
+      }
+
+      PatchMutation patch(second);
+      if (first.type() == Mutation::Type::Set &&
+          first_precondition.is_none()) {
+        return SetMutation(second.key(),
+                           ApplyPatch(SetMutation(first).value(), patch),
+                           Precondition::None());
+      }
+
+      // If the first patch requires the document to exist, the second one must
+      // too, so that both fail if it doesn't.
+      if (first.type() == Mutation::Type::Patch &&
+          (first_precondition.is_none() ||
+           RequiresExisting(second_precondition))) {
+        PatchMutation first_patch(first);
+        return PatchMutation(second.key(),
+                             ApplyPatch(first_patch.value(), patch),
+                             MergeMasks(first_patch.mask(), patch.mask()),
+                             first_precondition);
+      }
+      return absl::nullopt;
+    }
+
+    default:
+      return absl::nullopt;
+  }
+}
+
 }  // namespace
 
 LocalStore::LocalStore(Persistence* persistence,
@@ -82,6 +202,8 @@ LocalStore::LocalStore(Persistence* persistence,
                        const User& initial_user)
     : persistence_(persistence),
       mutation_queue_(persistence->GetMutationQueueForUser(initial_user)),
+      overlay_cache_(
+          persistence->GetDocumentOverlayCacheForUser(initial_user)),
       remote_document_cache_(persistence->remote_document_cache()),
       target_cache_(persistence->target_cache()),
       bundle_cache_(persistence->bundle_cache()),
@@ -89,6 +211,7 @@ LocalStore::LocalStore(Persistence* persistence,
       local_documents_(
           absl::make_unique<LocalDocumentsView>(remote_document_cache_,
                                                 mutation_queue_,
+                                                overlay_cache_,
                                                 persistence->index_manager())) {
   persistence->reference_delegate()->AddInMemoryPins(&local_view_references_);
   target_id_generator_ = TargetIdGenerator::TargetCacheTargetIdGenerator(0);
@@ -109,14 +232,24 @@ void LocalStore::StartMutationQueue() {
 }
 
 MaybeDocumentMap LocalStore::HandleUserChange(const User& user) {
-  // Swap out the mutation queue, grabbing the pending mutation batches before
-  // and after.
-  std::vector<MutationBatch> old_batches = persistence_->Run(
-      "OldBatches", [&] { return mutation_queue_->AllMutationBatches(); });
+  InvalidatePrefetchedResults();
+  // Swap out the mutation queue, grabbing the keys changed by the pending
+  // mutation batches before and the batches after. Only the keys of the old
+  // batches are needed, so the batches themselves aren't kept around.
+  DocumentKeySet changed_keys = persistence_->Run("OldBatches", [&] {
+    DocumentKeySet old_keys;
+    for (const MutationBatch& batch : mutation_queue_->AllMutationBatches()) {
+      for (const Mutation& mutation : batch.mutations()) {
+        old_keys = old_keys.insert(mutation.key());
+      }
+    }
+    return old_keys;
+  });
 
   // The old one has a reference to the mutation queue, so null it out first.
   local_documents_.reset();
   mutation_queue_ = persistence_->GetMutationQueueForUser(user);
+  overlay_cache_ = persistence_->GetDocumentOverlayCacheForUser(user);
 
   StartMutationQueue();
 
@@ -126,69 +259,150 @@ MaybeDocumentMap LocalStore::HandleUserChange(const User& user) {
 
     // Recreate our LocalDocumentsView using the new MutationQueue.
     local_documents_ = absl::make_unique<LocalDocumentsView>(
-        remote_document_cache_, mutation_queue_, persistence_->index_manager());
+        remote_document_cache_, mutation_queue_, overlay_cache_,
+        persistence_->index_manager());
     query_engine_->SetLocalDocumentsView(local_documents_.get());
 
     // Union the old/new changed keys.
-    DocumentKeySet changed_keys;
-    for (const std::vector<MutationBatch>* batches :
-         {&old_batches, &new_batches}) {
-      for (const MutationBatch& batch : *batches) {
-        for (const Mutation& mutation : batch.mutations()) {
-          changed_keys = changed_keys.insert(mutation.key());
-        }
+    for (const MutationBatch& batch : new_batches) {
+      for (const Mutation& mutation : batch.mutations()) {
+        changed_keys = changed_keys.insert(mutation.key());
       }
     }
 
     // Return the set of all (potentially) changed documents as the result of
-    // the user change.
-    return local_documents_->GetDocuments(changed_keys);
+    // the user change. The new batches are all the batches that affect them,
+    // so they're applied as they are instead of being read again, and the
+    // remote documents are read in a single `GetAll`.
+    return local_documents_->GetDocuments(changed_keys, new_batches);
   });
 }
 
-LocalWriteResult LocalStore::WriteLocally(std::vector<Mutation>&& mutations) {
+LocalWriteResult LocalStore::WriteLocally(
+    std::vector<Mutation>&& mutations,
+    absl::optional<BatchId> squashable_after) {
+  FIRESTORE_ALLOCATION_TAG("WriteLocally");
+  InvalidatePrefetchedResults();
   Timestamp local_write_time = Timestamp::Now();
   DocumentKeySet keys;
   for (const Mutation& mutation : mutations) {
     keys = keys.insert(mutation.key());
   }
 
-  return persistence_->Run("Locally write mutations", [&] {
-    // Load and apply all existing mutations. This lets us compute the current
-    // base state for all non-idempotent transforms before applying any
-    // additional user-provided writes.
-    MaybeDocumentMap existing_documents = local_documents_->GetDocuments(keys);
-
-    // For non-idempotent mutations (such as `FieldValue.increment()`), we
-    // record the base state in a separate patch mutation. This is later used to
-    // guarantee consistent values and prevents flicker even if the backend
-    // sends us an update that already includes our transform.
-    std::vector<Mutation> base_mutations;
+  return persistence_->Run(
+      "Locally write mutations", TransactionClass::UserWrite, [&] {
+        // Load and apply all existing mutations. This lets us compute the
+        // current base state for all non-idempotent transforms before applying
+        // any additional user-provided writes.
+        MaybeDocumentMap documents = local_documents_->GetDocuments(keys);
+        BatchId squashed_batch_id = model::kBatchIdUnknown;
+        BatchId batch_id = AddLocalMutationBatch(
+            local_write_time, std::move(mutations), &documents,
+            squashable_after, &squashed_batch_id);
+        return LocalWriteResult{batch_id, std::move(documents),
+                                squashed_batch_id};
+      });
+}
+
+std::vector<LocalWriteResult> LocalStore::WriteLocally(
+    std::vector<std::vector<Mutation>>&& batches,
+    absl::optional<BatchId> squashable_after) {
+  InvalidatePrefetchedResults();
+  Timestamp local_write_time = Timestamp::Now();
+  DocumentKeySet keys;
+  for (const std::vector<Mutation>& mutations : batches) {
     for (const Mutation& mutation : mutations) {
-      absl::optional<MaybeDocument> base_document =
-          existing_documents.get(mutation.key());
-
-      absl::optional<ObjectValue> base_value =
-          mutation.ExtractTransformBaseValue(base_document);
-      if (base_value) {
-        // NOTE: The base state should only be applied if there's some existing
-        // document to override, so use a Precondition of exists=true
-        base_mutations.push_back(PatchMutation(mutation.key(), *base_value,
-                                               base_value->ToFieldMask(),
-                                               Precondition::Exists(true)));
+      keys = keys.insert(mutation.key());
+    }
+  }
+
+  return persistence_->Run(
+      "Locally write mutation batches", TransactionClass::UserWrite, [&] {
+        // The documents are read once for all writes. Each write then applies
+        // on top of the ones before it, as if they had been written one by one.
+        MaybeDocumentMap documents = local_documents_->GetDocuments(keys);
+        std::vector<LocalWriteResult> results;
+        results.reserve(batches.size());
+        for (std::vector<Mutation>& mutations : batches) {
+          DocumentKeySet batch_keys;
+          for (const Mutation& mutation : mutations) {
+            batch_keys = batch_keys.insert(mutation.key());
+          }
+
+          BatchId squashed_batch_id = model::kBatchIdUnknown;
+          BatchId batch_id = AddLocalMutationBatch(
+              local_write_time, std::move(mutations), &documents,
+              squashable_after, &squashed_batch_id);
+          MaybeDocumentMap changes;
+          for (const DocumentKey& key : batch_keys) {
+            auto found = documents.find(key);
+            if (found != documents.end()) {
+              changes = changes.insert(key, found->second);
+            }
+          }
+          results.emplace_back(batch_id, std::move(changes),
+                               squashed_batch_id);
+        }
+        return results;
+      });
+}
+
+BatchId LocalStore::AddLocalMutationBatch(
+    const Timestamp& local_write_time,
+    std::vector<Mutation>&& mutations,
+    MaybeDocumentMap* documents,
+    absl::optional<BatchId> squashable_after,
+    BatchId* squashed_batch_id) {
+  BatchId newest_batch_id = mutation_queue_->GetHighestUnacknowledgedBatchId();
+  if (squashable_after && mutations.size() == 1 &&
+      newest_batch_id != model::kBatchIdUnknown &&
+      newest_batch_id > *squashable_after) {
+    absl::optional<MutationBatch> newest_batch =
+        mutation_queue_->LookupMutationBatch(newest_batch_id);
+    if (newest_batch && newest_batch->base_mutations().empty() &&
+        newest_batch->mutations().size() == 1) {
+      absl::optional<Mutation> squashed =
+          SquashMutations(newest_batch->mutations().front(), mutations.front());
+      if (squashed) {
+        // `documents` already reflects the newest batch, and applying the
+        // squashed mutation on top of it has the same result as applying it
+        // instead of that batch.
+        mutation_queue_->RemoveMutationBatch(*newest_batch);
+        *squashed_batch_id = newest_batch_id;
+        mutations = {*std::move(squashed)};
       }
     }
+  }
 
-    MutationBatch batch = mutation_queue_->AddMutationBatch(
-        local_write_time, std::move(base_mutations), std::move(mutations));
-    MaybeDocumentMap changed_documents =
-        batch.ApplyToLocalDocumentSet(existing_documents);
-    return LocalWriteResult{batch.batch_id(), std::move(changed_documents)};
-  });
+  // For non-idempotent mutations (such as `FieldValue.increment()`), we record
+  // the base state in a separate patch mutation. This is later used to
+  // guarantee consistent values and prevents flicker even if the backend sends
+  // us an update that already includes our transform.
+  std::vector<Mutation> base_mutations;
+  for (const Mutation& mutation : mutations) {
+    absl::optional<MaybeDocument> base_document =
+        documents->get(mutation.key());
+
+    absl::optional<ObjectValue> base_value =
+        mutation.ExtractTransformBaseValue(base_document);
+    if (base_value) {
+      // NOTE: The base state should only be applied if there's some existing
+      // document to override, so use a Precondition of exists=true
+      base_mutations.push_back(PatchMutation(mutation.key(), *base_value,
+                                             base_value->ToFieldMask(),
+                                             Precondition::Exists(true)));
+    }
+  }
+
+  MutationBatch batch = mutation_queue_->AddMutationBatch(
+      local_write_time, std::move(base_mutations), std::move(mutations));
+  *documents = batch.ApplyToLocalDocumentSet(*documents);
+  return batch.batch_id();
 }
 
 MaybeDocumentMap LocalStore::AcknowledgeBatch(
     const MutationBatchResult& batch_result) {
+  InvalidatePrefetchedResults();
   return persistence_->Run("Acknowledge batch", [&] {
     const MutationBatch& batch = batch_result.batch();
     mutation_queue_->AcknowledgeBatch(batch, batch_result.stream_token());
@@ -199,6 +413,27 @@ MaybeDocumentMap LocalStore::AcknowledgeBatch(
   });
 }
 
+MaybeDocumentMap LocalStore::AcknowledgeBatches(
+    const std::vector<MutationBatchResult>& batch_results) {
+  InvalidatePrefetchedResults();
+  return persistence_->Run("Acknowledge batches", [&] {
+    DocumentKeySet keys;
+    for (const MutationBatchResult& batch_result : batch_results) {
+      const MutationBatch& batch = batch_result.batch();
+      mutation_queue_->AcknowledgeBatch(batch, batch_result.stream_token());
+      ApplyBatchResult(batch_result);
+      for (const DocumentKey& key : batch.keys()) {
+        keys = keys.insert(key);
+      }
+    }
+    mutation_queue_->PerformConsistencyCheck();
+
+    // Read the documents once all the batches are applied, so that documents
+    // written by several of them are only read once.
+    return local_documents_->GetDocuments(keys);
+  });
+}
+
 void LocalStore::ApplyBatchResult(const MutationBatchResult& batch_result) {
   const MutationBatch& batch = batch_result.batch();
   DocumentKeySet doc_keys = batch.keys();
@@ -231,6 +466,7 @@ void LocalStore::ApplyBatchResult(const MutationBatchResult& batch_result) {
 }
 
 MaybeDocumentMap LocalStore::RejectBatch(BatchId batch_id) {
+  InvalidatePrefetchedResults();
   return persistence_->Run("Reject batch", [&] {
     absl::optional<MutationBatch> to_reject =
         mutation_queue_->LookupMutationBatch(batch_id);
@@ -258,6 +494,9 @@ const SnapshotVersion& LocalStore::GetLastRemoteSnapshotVersion() const {
 
 model::MaybeDocumentMap LocalStore::ApplyRemoteEvent(
     const remote::RemoteEvent& remote_event) {
+  FIRESTORE_TRACE_SPAN("LocalStore::ApplyRemoteEvent");
+  FIRESTORE_ALLOCATION_TAG("ApplyRemoteEvent");
+  InvalidatePrefetchedResults();
   const SnapshotVersion& last_remote_version =
       target_cache_->GetLastRemoteSnapshotVersion();
 
@@ -300,6 +539,9 @@ model::MaybeDocumentMap LocalStore::ApplyRemoteEvent(
         // time has passed since the last update).
         if (ShouldPersistTargetData(new_target_data, old_target_data, change)) {
           target_cache_->UpdateTarget(new_target_data);
+          targets_with_unpersisted_data_.erase(target_id);
+        } else {
+          targets_with_unpersisted_data_.insert(target_id);
         }
       }
     }
@@ -415,8 +657,50 @@ absl::optional<MutationBatch> LocalStore::GetNextMutationBatch(
 }
 
 absl::optional<MaybeDocument> LocalStore::ReadDocument(const DocumentKey& key) {
-  return persistence_->Run("ReadDocument",
-                           [&] { return local_documents_->GetDocument(key); });
+  absl::optional<MaybeDocument> document = persistence_->Run(
+      "ReadDocument", [&] { return local_documents_->GetDocument(key); });
+  if (document) {
+    persistence_->reference_delegate()->RecordDocumentAccess(key);
+  }
+  return document;
+}
+
+absl::optional<MaybeDocument> LocalStore::ReadDocumentFromSnapshot(
+    const DocumentKey& key) {
+  absl::optional<MaybeDocument> document = persistence_->RunReadOnly(
+      "ReadDocumentFromSnapshot",
+      [&] { return local_documents_->GetDocument(key); });
+  if (document) {
+    persistence_->reference_delegate()->RecordDocumentAccess(key);
+  }
+  return document;
+}
+
+OptionalMaybeDocumentMap LocalStore::ReadDocuments(const DocumentKeySet& keys) {
+  OptionalMaybeDocumentMap documents = persistence_->Run("ReadDocuments", [&] {
+    return local_documents_->GetDocumentsIfCached(keys);
+  });
+  RecordDocumentAccesses(documents);
+  return documents;
+}
+
+OptionalMaybeDocumentMap LocalStore::ReadDocumentsFromSnapshot(
+    const DocumentKeySet& keys) {
+  OptionalMaybeDocumentMap documents =
+      persistence_->RunReadOnly("ReadDocumentsFromSnapshot", [&] {
+        return local_documents_->GetDocumentsIfCached(keys);
+      });
+  RecordDocumentAccesses(documents);
+  return documents;
+}
+
+void LocalStore::RecordDocumentAccesses(
+    const OptionalMaybeDocumentMap& documents) {
+  for (const auto& kv : documents) {
+    if (kv.second) {
+      persistence_->reference_delegate()->RecordDocumentAccess(kv.first);
+    }
+  }
 }
 
 BatchId LocalStore::GetHighestUnacknowledgedBatchId() {
@@ -450,6 +734,7 @@ TargetData LocalStore::AllocateTarget(Target target) {
 }
 
 void LocalStore::ReleaseTarget(TargetId target_id) {
+  InvalidatePrefetchedResults();
   persistence_->Run("Release target", [&] {
     auto found = target_data_by_target_.find(target_id);
     HARD_ASSERT(found != target_data_by_target_.end(),
@@ -471,11 +756,37 @@ void LocalStore::ReleaseTarget(TargetId target_id) {
     persistence_->reference_delegate()->RemoveTarget(target_data);
     target_data_by_target_.erase(target_id);
     target_id_by_target_.erase(target_data.target());
+    targets_with_unpersisted_data_.erase(target_id);
+  });
+}
+
+size_t LocalStore::PersistResumeTokens() {
+  if (targets_with_unpersisted_data_.empty()) return 0;
+
+  return persistence_->Run("Persist resume tokens", [&] {
+    size_t count = 0;
+    for (TargetId target_id : targets_with_unpersisted_data_) {
+      auto found = target_data_by_target_.find(target_id);
+      if (found != target_data_by_target_.end()) {
+        target_cache_->UpdateTarget(found->second);
+        ++count;
+      }
+    }
+    targets_with_unpersisted_data_.clear();
+    return count;
   });
 }
 
 QueryResult LocalStore::ExecuteQuery(const Query& query,
                                      bool use_previous_results) {
+  FIRESTORE_ALLOCATION_TAG("ExecuteQuery");
+  auto prefetched = prefetched_results_.find(query);
+  if (prefetched != prefetched_results_.end()) {
+    QueryResult result = std::move(prefetched->second);
+    prefetched_results_.erase(prefetched);
+    return result;
+  }
+
   return persistence_->Run("ExecuteQuery", [&] {
     absl::optional<TargetData> target_data = GetTargetData(query.ToTarget());
     SnapshotVersion last_limbo_free_snapshot_version;
@@ -496,6 +807,48 @@ QueryResult LocalStore::ExecuteQuery(const Query& query,
   });
 }
 
+QueryResult LocalStore::ExecuteQueryFromSnapshot(const Query& query) {
+  return persistence_->RunReadOnly("ExecuteQueryFromSnapshot", [&] {
+    // Read the target from persistence rather than from the in-memory target
+    // maps, which may be changing concurrently.
+    absl::optional<TargetData> target_data =
+        target_cache_->GetTarget(query.ToTarget());
+    DocumentKeySet remote_keys;
+    if (target_data) {
+      remote_keys = target_cache_->GetMatchingKeys(target_data->target_id());
+    }
+
+    // The query engine keeps per-query state, so match against all local
+    // documents directly.
+    model::DocumentMap documents = local_documents_->GetDocumentsMatchingQuery(
+        query, SnapshotVersion::None());
+    return QueryResult(std::move(documents), std::move(remote_keys));
+  });
+}
+
+int64_t LocalStore::CountQuery(const Query& query) {
+  return persistence_->RunReadOnly("CountQuery", [&] {
+    return local_documents_->CountDocumentsMatchingQuery(query);
+  });
+}
+
+void LocalStore::AddPrefetchedResult(const Query& query,
+                                     QueryResult result,
+                                     uint64_t version) {
+  if (version != query_results_version_) return;
+
+  prefetched_results_[query] = std::move(result);
+}
+
+void LocalStore::InvalidatePrefetchedResults() {
+  ++query_results_version_;
+  prefetched_results_.clear();
+}
+
+bool LocalStore::supports_concurrent_reads() const {
+  return persistence_->supports_concurrent_reads();
+}
+
 DocumentKeySet LocalStore::GetRemoteDocumentKeys(TargetId target_id) {
   return persistence_->Run("RemoteDocumentKeysForTarget", [&] {
     return target_cache_->GetMatchingKeys(target_id);
@@ -503,11 +856,20 @@ DocumentKeySet LocalStore::GetRemoteDocumentKeys(TargetId target_id) {
 }
 
 LruResults LocalStore::CollectGarbage(LruGarbageCollector* garbage_collector) {
+  InvalidatePrefetchedResults();
   return persistence_->Run("Collect garbage", [&] {
     return garbage_collector->Collect(target_data_by_target_);
   });
 }
 
+LruResults LocalStore::CollectGarbageSlice(
+    LruGarbageCollector* garbage_collector, std::chrono::milliseconds budget) {
+  InvalidatePrefetchedResults();
+  return persistence_->Run("Collect garbage slice", [&] {
+    return garbage_collector->CollectSlice(target_data_by_target_, budget);
+  });
+}
+
 bool LocalStore::HasNewerBundle(const bundle::BundleMetadata& metadata) {
   return persistence_->Run("Has newer bundle", [&] {
     absl::optional<bundle::BundleMetadata> cached_metadata =
@@ -522,11 +884,21 @@ void LocalStore::SaveBundle(const bundle::BundleMetadata& metadata) {
       "Save bundle", [&] { bundle_cache_->SaveBundleMetadata(metadata); });
 }
 
-MaybeDocumentMap LocalStore::ApplyBundledDocuments(
-    const MaybeDocumentMap& bundled_documents, const std::string& bundle_id) {
+void LocalStore::StartBundledDocuments(const std::string& bundle_id) {
   // Allocates a target to hold all document keys from the bundle, such that
   // they will not get garbage collected right away.
   TargetData umbrella_target = AllocateTarget(NewUmbrellaTarget(bundle_id));
+  persistence_->Run("Start bundle documents", [&] {
+    target_cache_->RemoveMatchingKeysForTarget(umbrella_target.target_id());
+  });
+}
+
+MaybeDocumentMap LocalStore::ApplyBundledDocuments(
+    const MaybeDocumentMap& bundled_documents, const std::string& bundle_id) {
+  InvalidatePrefetchedResults();
+  // The umbrella target was allocated by `StartBundledDocuments()`, so this
+  // only looks it up.
+  TargetData umbrella_target = AllocateTarget(NewUmbrellaTarget(bundle_id));
   return persistence_->Run("Apply bundle documents", [&] {
     DocumentKeySet keys;
     DocumentUpdateMap document_updates;
@@ -542,7 +914,6 @@ MaybeDocumentMap LocalStore::ApplyBundledDocuments(
       versions.emplace(key, doc.version());
     }
 
-    target_cache_->RemoveMatchingKeysForTarget(umbrella_target.target_id());
     target_cache_->AddMatchingKeys(keys, umbrella_target.target_id());
 
     auto changed_docs = PopulateDocumentChanges(document_updates, versions,
@@ -551,6 +922,89 @@ MaybeDocumentMap LocalStore::ApplyBundledDocuments(
   });
 }
 
+MaybeDocumentMap LocalStore::ApplyQueryResults(
+    const std::vector<Document>& documents, const SnapshotVersion& read_time) {
+  InvalidatePrefetchedResults();
+  return persistence_->Run("Apply query results", [&] {
+    DocumentUpdateMap document_updates;
+    DocumentVersionMap versions;
+    for (const Document& doc : documents) {
+      document_updates.emplace(doc.key(), doc);
+      // Responses should always report their read time, but the version of a
+      // document is a safe lower bound for it.
+      versions.emplace(doc.key(), read_time != SnapshotVersion::None()
+                                      ? read_time
+                                      : doc.version());
+
+      // The documents may not belong to any target, so they're tracked for
+      // garbage collection like limbo documents.
+      persistence_->reference_delegate()->UpdateLimboDocument(doc.key());
+    }
+
+    auto changed_docs = PopulateDocumentChanges(document_updates, versions,
+                                                SnapshotVersion::None());
+    return local_documents_->GetLocalViewOfDocuments(changed_docs);
+  });
+}
+
+MaybeDocumentMap LocalStore::GetLocalViewOfQueryResults(
+    const Query& query, const std::vector<Document>& documents) {
+  return persistence_->Run("Get local view of query results", [&] {
+    OptionalMaybeDocumentMap base_docs;
+    for (const Document& doc : documents) {
+      base_docs = base_docs.insert(doc.key(), doc);
+    }
+
+    // Documents with pending writes may match locally even though the backend
+    // didn't return them, so they are looked up in the cache.
+    std::vector<MutationBatch> batches =
+        query.IsCollectionGroupQuery()
+            ? mutation_queue_->AllMutationBatches()
+            : mutation_queue_->AllMutationBatchesAffectingQuery(query);
+    DocumentKeySet mutated_keys;
+    for (const MutationBatch& batch : batches) {
+      for (const Mutation& mutation : batch.mutations()) {
+        if (!base_docs.contains(mutation.key())) {
+          mutated_keys = mutated_keys.insert(mutation.key());
+        }
+      }
+    }
+    for (const auto& kv : remote_document_cache_->GetAll(mutated_keys)) {
+      base_docs = base_docs.insert(kv.first, kv.second);
+    }
+
+    return local_documents_->GetLocalViewOfDocuments(base_docs);
+  });
+}
+
+void LocalStore::RetainBundledDocuments(const DocumentKeySet& keys,
+                                        const std::string& bundle_id) {
+  TargetData umbrella_target = AllocateTarget(NewUmbrellaTarget(bundle_id));
+  persistence_->Run("Retain bundle documents", [&] {
+    target_cache_->AddMatchingKeys(keys, umbrella_target.target_id());
+  });
+}
+
+DocumentKeySet LocalStore::FindStaleBundledDocumentsFromSnapshot(
+    const DocumentVersionMap& versions) {
+  return persistence_->RunReadOnly("FindStaleBundledDocuments", [&] {
+    DocumentKeySet keys;
+    for (const auto& kv : versions) {
+      keys = keys.insert(kv.first);
+    }
+
+    DocumentKeySet stale;
+    OptionalMaybeDocumentMap existing_docs =
+        remote_document_cache_->GetAll(keys);
+    for (const auto& kv : existing_docs) {
+      if (!IsNewerThanCached(versions.at(kv.first), kv.second)) {
+        stale = stale.insert(kv.first);
+      }
+    }
+    return stale;
+  });
+}
+
 void LocalStore::SaveNamedQuery(const bundle::NamedQuery& query,
                                 const model::DocumentKeySet& keys) {
   // Allocate a target for the named query such that it can be resumed from
@@ -584,6 +1038,33 @@ absl::optional<bundle::NamedQuery> LocalStore::GetNamedQuery(
                            [&] { return bundle_cache_->GetNamedQuery(query); });
 }
 
+void LocalStore::AddFieldIndexes(
+    const std::vector<model::FieldIndex>& indexes) {
+  persistence_->Run("Add field indexes", [&] {
+    for (const model::FieldIndex& index : indexes) {
+      persistence_->index_manager()->AddFieldIndex(index);
+    }
+  });
+}
+
+void LocalStore::DeleteFieldIndexes(
+    const std::vector<model::FieldIndex>& indexes) {
+  persistence_->Run("Delete field indexes", [&] {
+    for (const model::FieldIndex& index : indexes) {
+      persistence_->index_manager()->DeleteFieldIndex(index);
+    }
+  });
+}
+
+size_t LocalStore::ReleaseMemory(util::MemoryPressure pressure) {
+  size_t released = persistence_->ReleaseMemory();
+
+  if (pressure == util::MemoryPressure::Critical) {
+    InvalidatePrefetchedResults();
+  }
+  return released;
+}
+
 Target LocalStore::NewUmbrellaTarget(const std::string& bundle_id) {
   // It is OK that the path used for the query is not valid, because this will
   // not be read and queried.
@@ -595,7 +1076,7 @@ OptionalMaybeDocumentMap LocalStore::PopulateDocumentChanges(
     const DocumentUpdateMap& documents,
     const DocumentVersionMap& document_versions,
     const SnapshotVersion& global_version) {
-  OptionalMaybeDocumentMap changed_docs;
+  OptionalMaybeDocumentMap::Builder changed_docs;
 
   DocumentKeySet updated_keys;
   for (const auto& kv : documents) {
@@ -606,6 +1087,9 @@ OptionalMaybeDocumentMap LocalStore::PopulateDocumentChanges(
   OptionalMaybeDocumentMap existing_docs =
       remote_document_cache_->GetAll(updated_keys);
 
+  // Added documents are collected and written at the end, so that the cache
+  // can encode them in parallel.
+  std::vector<DocumentReadTime> added_docs;
   for (const auto& kv : documents) {
     const DocumentKey& key = kv.first;
     const MaybeDocument& doc = kv.second;
@@ -627,14 +1111,12 @@ OptionalMaybeDocumentMap LocalStore::PopulateDocumentChanges(
       // NoDocuments with SnapshotVersion::None are used in manufactured
       // events. We remove these documents from cache since we lost access.
       remote_document_cache_->Remove(key);
-      changed_docs = changed_docs.insert(key, doc);
-    } else if (!existing_doc || doc.version() > existing_doc->version() ||
-               (doc.version() == existing_doc->version() &&
-                existing_doc->has_pending_writes())) {
+      changed_docs.insert(key, doc);
+    } else if (IsNewerThanCached(doc.version(), existing_doc)) {
       HARD_ASSERT(read_time != SnapshotVersion::None(),
                   "Cannot add a document when the remote version is zero");
-      remote_document_cache_->Add(doc, read_time);
-      changed_docs = changed_docs.insert(key, doc);
+      added_docs.emplace_back(doc, read_time);
+      changed_docs.insert(key, doc);
     } else {
       LOG_DEBUG(
           "LocalStore Ignoring outdated update for %s. "
@@ -643,7 +1125,8 @@ OptionalMaybeDocumentMap LocalStore::PopulateDocumentChanges(
           doc.version().ToString());
     }
   }
-  return changed_docs;
+  remote_document_cache_->AddAll(added_docs);
+  return changed_docs.Build();
 }
 
 }  // namespace local
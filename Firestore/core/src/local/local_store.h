@@ -17,18 +17,24 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_LOCAL_STORE_H_
 #define FIRESTORE_CORE_SRC_LOCAL_LOCAL_STORE_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "Firestore/core/src/bundle/bundle_callback.h"
 #include "Firestore/core/src/bundle/bundle_metadata.h"
 #include "Firestore/core/src/bundle/named_query.h"
+#include "Firestore/core/src/core/query.h"
 #include "Firestore/core/src/core/target_id_generator.h"
+#include "Firestore/core/src/local/query_result.h"
 #include "Firestore/core/src/local/reference_set.h"
 #include "Firestore/core/src/local/target_data.h"
 #include "Firestore/core/src/model/model_fwd.h"
+#include "Firestore/core/src/util/memory_pressure.h"
 #include "absl/types/optional.h"
 
 namespace firebase {
@@ -38,10 +44,6 @@ namespace auth {
 class User;
 }  // namespace auth
 
-namespace core {
-class Query;
-}  // namespace core
-
 namespace remote {
 class RemoteEvent;
 class TargetChange;
@@ -50,6 +52,7 @@ class TargetChange;
 namespace local {
 
 class BundleCache;
+class DocumentOverlayCache;
 class LocalDocumentsView;
 class LocalViewChanges;
 class LocalWriteResult;
@@ -57,7 +60,6 @@ class LruGarbageCollector;
 class MutationQueue;
 class Persistence;
 class QueryEngine;
-class QueryResult;
 class RemoteDocumentCache;
 class TargetCache;
 
@@ -122,8 +124,35 @@ class LocalStore : public bundle::BundleCallback {
    */
   model::MaybeDocumentMap HandleUserChange(const auth::User& user);
 
-  /** Accepts locally generated Mutations and commits them to storage. */
-  LocalWriteResult WriteLocally(std::vector<model::Mutation>&& mutations);
+  /**
+   * Accepts locally generated Mutations and commits them to storage.
+   *
+   * If `squashable_after` is set, a write of a single set or patch mutation
+   * may be squashed into the newest batch in the queue instead of becoming a
+   * batch of its own: if that batch has an ID greater than `squashable_after`
+   * (meaning it hasn't been sent to the backend yet) and consists of a single
+   * set or patch of the same document, it is replaced by a new batch with one
+   * mutation that has the effect of both and fails whenever either would. The
+   * squashed writes then commit or fail together. Deletes, writes with
+   * transforms and writes with preconditions other than "exists" are never
+   * squashed.
+   */
+  LocalWriteResult WriteLocally(
+      std::vector<model::Mutation>&& mutations,
+      absl::optional<model::BatchId> squashable_after = absl::nullopt);
+
+  /**
+   * Accepts several groups of locally generated Mutations and commits them to
+   * storage in a single transaction. Each group becomes its own mutation batch,
+   * as if it had been passed to `WriteLocally` on its own.
+   *
+   * @return The result of each write, in order. The changes of each result
+   *     are the documents it affects, including the effects of earlier
+   *     writes to the same documents.
+   */
+  std::vector<LocalWriteResult> WriteLocally(
+      std::vector<std::vector<model::Mutation>>&& batches,
+      absl::optional<model::BatchId> squashable_after = absl::nullopt);
 
   /**
    * Returns the current value of a document with a given key, or `nullopt` if
@@ -132,6 +161,30 @@ class LocalStore : public bundle::BundleCallback {
   absl::optional<model::MaybeDocument> ReadDocument(
       const model::DocumentKey& key);
 
+  /**
+   * Like `ReadDocument()`, but reads from a snapshot of the local cache.
+   *
+   * If `supports_concurrent_reads()` is true, this may be called from any
+   * thread, concurrently with other LocalStore methods, except for
+   * `HandleUserChange()` and the destruction of the LocalStore.
+   */
+  absl::optional<model::MaybeDocument> ReadDocumentFromSnapshot(
+      const model::DocumentKey& key);
+
+  /**
+   * Returns the current values of the documents with the given keys, in a
+   * single lookup. Documents that are not found map to `nullopt`.
+   */
+  model::OptionalMaybeDocumentMap ReadDocuments(
+      const model::DocumentKeySet& keys);
+
+  /**
+   * Like `ReadDocuments()`, but reads from a snapshot of the local cache, with
+   * the same threading requirements as `ReadDocumentFromSnapshot()`.
+   */
+  model::OptionalMaybeDocumentMap ReadDocumentsFromSnapshot(
+      const model::DocumentKeySet& keys);
+
   /**
    * Acknowledges the given batch.
    *
@@ -149,6 +202,15 @@ class LocalStore : public bundle::BundleCallback {
   model::MaybeDocumentMap AcknowledgeBatch(
       const model::MutationBatchResult& batch_result);
 
+  /**
+   * Acknowledges several batches, in order, in a single transaction, as if by
+   * calling `AcknowledgeBatch` for each.
+   *
+   * @return The documents modified by any of the batches.
+   */
+  model::MaybeDocumentMap AcknowledgeBatches(
+      const std::vector<model::MutationBatchResult>& batch_results);
+
   /**
    * Removes mutations from the MutationQueue for the specified batch.
    * LocalDocuments will be recalculated.
@@ -207,6 +269,13 @@ class LocalStore : public bundle::BundleCallback {
    */
   void ReleaseTarget(model::TargetId target_id);
 
+  /**
+   * Persists the latest resume tokens of active targets that `ApplyRemoteEvent`
+   * only kept in memory, so that listens resumed after a restart don't receive
+   * the same documents again. Returns the number of targets persisted.
+   */
+  size_t PersistResumeTokens();
+
   /**
    * Runs the specified query against the local store and returns the results,
    * potentially taking advantage of target data from previous executions (such
@@ -217,6 +286,53 @@ class LocalStore : public bundle::BundleCallback {
    */
   QueryResult ExecuteQuery(const core::Query& query, bool use_previous_results);
 
+  /**
+   * Runs the specified query against a snapshot of the local cache. Unlike
+   * `ExecuteQuery()`, this never uses results from previous executions, since
+   * those are tracked in memory by the thread running the SyncEngine.
+   *
+   * If `supports_concurrent_reads()` is true, this may be called from any
+   * thread, concurrently with other LocalStore methods, except for
+   * `HandleUserChange()` and the destruction of the LocalStore.
+   */
+  QueryResult ExecuteQueryFromSnapshot(const core::Query& query);
+
+  /**
+   * Counts the documents in the local view that match the query, up to its
+   * limit if it has one, without materializing the results. Like
+   * `ExecuteQueryFromSnapshot()`, this reads a snapshot of the local cache and
+   * may be called from any thread if `supports_concurrent_reads()` is true.
+   */
+  int64_t CountQuery(const core::Query& query);
+
+  /**
+   * Returns a counter that changes whenever the results of local queries may
+   * change, e.g. because of a write or a remote event.
+   */
+  uint64_t query_results_version() const {
+    return query_results_version_;
+  }
+
+  /**
+   * Saves `result`, the result of executing `query` against the local cache
+   * while `query_results_version()` was `version`, to be returned by the next
+   * `ExecuteQuery()` of the query instead of executing it again. The result is
+   * dropped if the local cache changed since it was computed.
+   *
+   * This lets clients compute the results of the queries they expect to
+   * listen to ahead of time, e.g. with `ExecuteQueryFromSnapshot()` on another
+   * thread while starting up.
+   */
+  void AddPrefetchedResult(const core::Query& query,
+                           QueryResult result,
+                           uint64_t version);
+
+  /**
+   * Returns true if the `*FromSnapshot()` methods may be called concurrently
+   * with other LocalStore methods.
+   */
+  bool supports_concurrent_reads() const;
+
   /**
    * Notify the local store of the changed views to locally pin / unpin
    * documents.
@@ -243,6 +359,13 @@ class LocalStore : public bundle::BundleCallback {
 
   LruResults CollectGarbage(LruGarbageCollector* garbage_collector);
 
+  /**
+   * Runs one slice of garbage collection, in its own transaction, with roughly
+   * the given time budget. See `LruGarbageCollector::CollectSlice()`.
+   */
+  LruResults CollectGarbageSlice(LruGarbageCollector* garbage_collector,
+                                 std::chrono::milliseconds budget);
+
   /**
    * Returns whether the given bundle has already been loaded and its create
    * time is newer or equal to the currently loading bundle.
@@ -253,8 +376,14 @@ class LocalStore : public bundle::BundleCallback {
   void SaveBundle(const bundle::BundleMetadata& metadata) override;
 
   /**
-   * Applies the documents from a bundle to the "ground-state" (remote)
-   * documents.
+   * Allocates the umbrella target that holds the documents of the given bundle
+   * and clears the documents it was previously holding.
+   */
+  void StartBundledDocuments(const std::string& bundle_id) override;
+
+  /**
+   * Applies a chunk of the documents from a bundle to the "ground-state"
+   * (remote) documents, adding them to the bundle's umbrella target.
    *
    * Local documents are re-calculated if there are remaining mutations in the
    * queue.
@@ -263,6 +392,38 @@ class LocalStore : public bundle::BundleCallback {
       const model::MaybeDocumentMap& documents,
       const std::string& bundle_id) override;
 
+  /**
+   * Applies documents the backend returned for a one-shot query, read at
+   * `read_time`, to the "ground-state" (remote) documents. Documents the cache
+   * already has the same or a newer version of are left alone.
+   *
+   * Returns the local view of the documents that changed.
+   */
+  model::MaybeDocumentMap ApplyQueryResults(
+      const std::vector<model::Document>& documents,
+      const model::SnapshotVersion& read_time);
+
+  /**
+   * Returns the local view of the results the backend returned for a one-shot
+   * query, together with the documents that pending local writes may have made
+   * match the query. The latter need to be matched against the query.
+   */
+  model::MaybeDocumentMap GetLocalViewOfQueryResults(
+      const core::Query& query, const std::vector<model::Document>& documents);
+
+  /** Adds the given documents to the bundle's umbrella target. */
+  void RetainBundledDocuments(const model::DocumentKeySet& keys,
+                              const std::string& bundle_id) override;
+
+  /**
+   * Returns the keys of the bundled documents, given by their versions, that
+   * `ApplyBundledDocuments()` would ignore because the remote document cache
+   * already has the same or a newer version of them. Reads a snapshot of the
+   * local cache, like `ReadDocumentFromSnapshot()`.
+   */
+  model::DocumentKeySet FindStaleBundledDocumentsFromSnapshot(
+      const model::DocumentVersionMap& versions);
+
   /** Saves the given `NamedQuery` to local persistence. */
   void SaveNamedQuery(const bundle::NamedQuery& query,
                       const model::DocumentKeySet& keys) override;
@@ -273,12 +434,48 @@ class LocalStore : public bundle::BundleCallback {
   absl::optional<bundle::NamedQuery> GetNamedQuery(
       const std::string& query_name);
 
+  /**
+   * Configures the given field indexes, indexing all cached documents of their
+   * collection groups. Queries that filter or order on the indexed fields are
+   * then executed as index range scans instead of collection scans.
+   */
+  void AddFieldIndexes(const std::vector<model::FieldIndex>& indexes);
+
+  /** Removes the given field indexes and their entries. */
+  void DeleteFieldIndexes(const std::vector<model::FieldIndex>& indexes);
+
+  /**
+   * Discards the in-memory caches of persisted documents and, under critical
+   * pressure, the prefetched query results. Returns an estimate of the bytes
+   * released.
+   */
+  size_t ReleaseMemory(util::MemoryPressure pressure);
+
  private:
   friend class LocalStoreTest;  // for `GetTargetData()`
 
   void StartMutationQueue();
+  void InvalidatePrefetchedResults();
   void ApplyBatchResult(const model::MutationBatchResult& batch_result);
 
+  /** Records the reads of the documents that were found for the LRU GC. */
+  void RecordDocumentAccesses(const model::OptionalMaybeDocumentMap& documents);
+
+  /**
+   * Adds a mutation batch for a local write to the mutation queue and applies
+   * it to `documents`, which must contain the local view of all documents
+   * affected by the write. Must be called within a transaction.
+   *
+   * See `WriteLocally` for `squashable_after`. If the write is squashed into an
+   * earlier batch, the ID of that batch is stored in `squashed_batch_id`.
+   */
+  model::BatchId AddLocalMutationBatch(
+      const Timestamp& local_write_time,
+      std::vector<model::Mutation>&& mutations,
+      model::MaybeDocumentMap* documents,
+      absl::optional<model::BatchId> squashable_after,
+      model::BatchId* squashed_batch_id);
+
   /**
    * Returns true if the new_target_data should be persisted during an update of
    * an active target. TargetData should always be persisted when a target is
@@ -339,6 +536,9 @@ class LocalStore : public bundle::BundleCallback {
    */
   MutationQueue* mutation_queue_ = nullptr;
 
+  /** The cached local views of the documents mutated by `mutation_queue_`. */
+  DocumentOverlayCache* overlay_cache_ = nullptr;
+
   /** The set of all cached remote documents. */
   RemoteDocumentCache* remote_document_cache_ = nullptr;
 
@@ -366,8 +566,20 @@ class LocalStore : public bundle::BundleCallback {
   /** Maps target ids to data about their queries. */
   std::unordered_map<model::TargetId, TargetData> target_data_by_target_;
 
+  /**
+   * The active targets whose data in `target_data_by_target_` is newer than
+   * the data in the target cache.
+   */
+  std::unordered_set<model::TargetId> targets_with_unpersisted_data_;
+
   /** Maps a target to its targetID. */
   std::unordered_map<core::Target, model::TargetId> target_id_by_target_;
+
+  /** Incremented whenever the results of local queries may change. */
+  uint64_t query_results_version_ = 0;
+
+  /** Results saved by `AddPrefetchedResult()`, until they're executed. */
+  std::unordered_map<core::Query, QueryResult> prefetched_results_;
 };
 
 }  // namespace local
@@ -20,6 +20,7 @@
 #include <utility>
 
 #include "Firestore/core/src/model/document_map.h"
+#include "Firestore/core/src/model/mutation_batch.h"
 #include "Firestore/core/src/model/types.h"
 
 namespace firebase {
@@ -29,8 +30,12 @@ namespace local {
 /** The result of a write to the local store. */
 class LocalWriteResult {
  public:
-  LocalWriteResult(model::BatchId batch_id, model::MaybeDocumentMap&& changes)
-      : batch_id_(batch_id), changes_(std::move(changes)) {
+  LocalWriteResult(model::BatchId batch_id,
+                   model::MaybeDocumentMap&& changes,
+                   model::BatchId squashed_batch_id = model::kBatchIdUnknown)
+      : batch_id_(batch_id),
+        changes_(std::move(changes)),
+        squashed_batch_id_(squashed_batch_id) {
   }
 
   LocalWriteResult() = default;
@@ -45,9 +50,18 @@ class LocalWriteResult {
     return changes_;
   }
 
+  /**
+   * The ID of the earlier batch whose writes were squashed into this one and
+   * that no longer exists, or `kBatchIdUnknown` if the write wasn't squashed.
+   */
+  model::BatchId squashed_batch_id() const {
+    return squashed_batch_id_;
+  }
+
  private:
   model::BatchId batch_id_;
   model::MaybeDocumentMap changes_;
+  model::BatchId squashed_batch_id_ = model::kBatchIdUnknown;
 };
 
 }  // namespace local
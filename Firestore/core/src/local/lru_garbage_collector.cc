@@ -25,6 +25,7 @@
 #include "Firestore/core/src/api/settings.h"
 #include "Firestore/core/src/local/target_data.h"
 #include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/log.h"
 #include "Firestore/core/src/util/statusor.h"
 
@@ -40,6 +41,10 @@ using model::TargetId;
 using util::StatusOr;
 
 using Millis = std::chrono::milliseconds;
+using SteadyClock = std::chrono::steady_clock;
+
+/** The number of buckets in the histograms of kept orphaned documents. */
+const int kHistogramBuckets = 1024;
 
 static Millis::rep MillisecondsBetween(const Timestamp& start,
                                        const Timestamp& end) {
@@ -92,11 +97,13 @@ class RollingSequenceNumberBuffer {
 const ListenSequenceNumber kListenSequenceNumberInvalid = -1;
 
 LruParams LruParams::Default() {
-  return LruParams{100 * 1024 * 1024, 10, 1000};
+  return LruParams{100 * 1024 * 1024, 10, 1000,
+                   /* approximate_sequence_numbers= */ false};
 }
 
 LruParams LruParams::Disabled() {
-  return LruParams{api::Settings::CacheSizeUnlimited, 0, 0};
+  return LruParams{api::Settings::CacheSizeUnlimited, 0, 0,
+                   /* approximate_sequence_numbers= */ false};
 }
 
 LruParams LruParams::WithCacheSize(int64_t cache_size) {
@@ -115,9 +122,73 @@ StatusOr<int64_t> LruGarbageCollector::CalculateByteSize() const {
 }
 
 LruResults LruGarbageCollector::Collect(const LiveQueryMap& live_targets) {
+  pending_ = absl::nullopt;
+  delegate_->FlushDocumentAccesses();
+  if (!ShouldCollect()) return LruResults::DidNotRun();
+
+  return RunGarbageCollection(live_targets);
+}
+
+LruResults LruGarbageCollector::CollectSlice(const LiveQueryMap& live_targets,
+                                             std::chrono::milliseconds budget) {
+  SteadyClock::time_point deadline = SteadyClock::now() + budget;
+  // Documents read since the previous slice must not be removed by this one.
+  delegate_->FlushDocumentAccesses();
+  if (pending_) {
+    return ContinueCollection(deadline);
+  }
+
+  if (!ShouldCollect()) return LruResults::DidNotRun();
+
+  Timestamp start = Timestamp::Now();
+  int sequence_numbers = 0;
+  PendingCollection pending;
+  pending.upper_bound = DetermineUpperBound(&sequence_numbers);
+  pending.retained = NewRetainedHistogram();
+  pending.results = LruResults{/* did_run= */ true, sequence_numbers,
+                               RemoveTargets(pending.upper_bound, live_targets),
+                               0, /* finished= */ false};
+  LOG_DEBUG(
+      "LRU Garbage Collection: determined least recently used %s sequence "
+      "numbers and removed %s targets in %sms",
+      sequence_numbers, pending.results.targets_removed,
+      MillisecondsBetween(start, Timestamp::Now()));
+
+  pending_ = std::move(pending);
+  return ContinueCollection(deadline);
+}
+
+LruResults LruGarbageCollector::ContinueCollection(
+    SteadyClock::time_point deadline) {
+  HARD_ASSERT(pending_, "No garbage collection in progress");
+
+  SequenceNumberHistogram* retained =
+      pending_->retained ? &*pending_->retained : nullptr;
+  int documents_removed = delegate_->RemoveOrphanedDocumentsUntil(
+      pending_->upper_bound, deadline, &pending_->cursor, retained);
+  pending_->results.documents_removed += documents_removed;
+
+  LruResults results = pending_->results;
+  if (pending_->cursor) {
+    LOG_DEBUG("LRU Garbage Collection: removed %s documents so far",
+              results.documents_removed);
+    return results;
+  }
+
+  LOG_DEBUG("LRU Garbage Collection: removed %s documents in total",
+            results.documents_removed);
+  if (retained) {
+    delegate_->SaveOrphanedDocumentHistogram(*retained);
+  }
+  pending_ = absl::nullopt;
+  results.finished = true;
+  return results;
+}
+
+bool LruGarbageCollector::ShouldCollect() {
   if (params_.min_bytes_threshold == Settings::CacheSizeUnlimited) {
     LOG_DEBUG("Garbage collection skipped; disabled");
-    return LruResults::DidNotRun();
+    return false;
   }
 
   StatusOr<int64_t> maybe_current_size = CalculateByteSize();
@@ -126,7 +197,7 @@ LruResults LruGarbageCollector::Collect(const LiveQueryMap& live_targets) {
         "Garbage collection skipped; failed to estimate the size of the "
         "cache: %s",
         maybe_current_size.status().ToString());
-    return LruResults::DidNotRun();
+    return false;
   }
 
   int64_t current_size = maybe_current_size.ValueOrDie();
@@ -135,41 +206,40 @@ LruResults LruGarbageCollector::Collect(const LiveQueryMap& live_targets) {
     LOG_DEBUG(
         "Garbage collection skipped; Cache size %s is lower than threshold %s",
         current_size, params_.min_bytes_threshold);
-    return LruResults::DidNotRun();
+    return false;
   }
 
   LOG_DEBUG("Running garbage collection on cache of size: %s", current_size);
-  return RunGarbageCollection(live_targets);
+  return true;
 }
 
 LruResults LruGarbageCollector::RunGarbageCollection(
     const LiveQueryMap& live_targets) {
   Timestamp start = Timestamp::Now();
 
-  // Cap at the configured max
-  int sequence_numbers = QueryCountForPercentile(params_.percentile_to_collect);
-  if (sequence_numbers > params_.maximum_sequence_numbers_to_collect) {
-    sequence_numbers = params_.maximum_sequence_numbers_to_collect;
-  }
-  Timestamp counted_targets = Timestamp::Now();
-
-  ListenSequenceNumber upper_bound =
-      SequenceNumberForQueryCount(sequence_numbers);
+  int sequence_numbers = 0;
+  ListenSequenceNumber upper_bound = DetermineUpperBound(&sequence_numbers);
   Timestamp found_upper_bound = Timestamp::Now();
 
   int num_targets_removed = RemoveTargets(upper_bound, live_targets);
   Timestamp removed_targets = Timestamp::Now();
 
-  int num_documents_removed = RemoveOrphanedDocuments(upper_bound);
+  int num_documents_removed = 0;
+  absl::optional<SequenceNumberHistogram> retained = NewRetainedHistogram();
+  if (retained) {
+    absl::optional<DocumentKey> cursor;
+    num_documents_removed = delegate_->RemoveOrphanedDocumentsUntil(
+        upper_bound, SteadyClock::time_point::max(), &cursor, &*retained);
+    delegate_->SaveOrphanedDocumentHistogram(*retained);
+  } else {
+    num_documents_removed = RemoveOrphanedDocuments(upper_bound);
+  }
   Timestamp removed_documents = Timestamp::Now();
 
   std::string desc = "LRU Garbage Collection:\n";
-  absl::StrAppend(&desc, "\tCounted targets in ",
-                  MillisecondsBetween(start, counted_targets), "ms\n");
   absl::StrAppend(&desc, "\tDetermined least recently used ", sequence_numbers,
                   " sequence numbers in ",
-                  MillisecondsBetween(counted_targets, found_upper_bound),
-                  "ms\n");
+                  MillisecondsBetween(start, found_upper_bound), "ms\n");
   absl::StrAppend(&desc, "\tRemoved ", num_targets_removed, " targets in ",
                   MillisecondsBetween(found_upper_bound, removed_targets),
                   "ms\n");
@@ -181,7 +251,51 @@ LruResults LruGarbageCollector::RunGarbageCollection(
   LOG_DEBUG(desc.c_str());
 
   return LruResults{/* did_run= */ true, sequence_numbers, num_targets_removed,
-                    num_documents_removed};
+                    num_documents_removed, /* finished= */ true};
+}
+
+ListenSequenceNumber LruGarbageCollector::DetermineUpperBound(
+    int* sequence_numbers) {
+  absl::optional<SequenceNumberHistogram> histogram;
+  if (params_.approximate_sequence_numbers) {
+    histogram = delegate_->LoadOrphanedDocumentHistogram();
+  }
+
+  if (!histogram) {
+    // Cap at the configured max
+    *sequence_numbers = QueryCountForPercentile(params_.percentile_to_collect);
+    if (*sequence_numbers > params_.maximum_sequence_numbers_to_collect) {
+      *sequence_numbers = params_.maximum_sequence_numbers_to_collect;
+    }
+    return SequenceNumberForQueryCount(*sequence_numbers);
+  }
+
+  // Targets are few enough to count exactly. The histogram may still count
+  // documents that have since been referenced again, and misses documents
+  // orphaned since it was saved, which all have higher sequence numbers. Both
+  // only make the estimated upper bound lower than the exact one.
+  delegate_->EnumerateTargetSequenceNumbers(
+      [&histogram](ListenSequenceNumber sequence_number) {
+        histogram->Add(sequence_number);
+      });
+
+  *sequence_numbers = static_cast<int>(
+      (params_.percentile_to_collect / 100.0f) * histogram->count());
+  if (*sequence_numbers > params_.maximum_sequence_numbers_to_collect) {
+    *sequence_numbers = params_.maximum_sequence_numbers_to_collect;
+  }
+  if (*sequence_numbers == 0) {
+    return kListenSequenceNumberInvalid;
+  }
+  return histogram->EstimateNth(*sequence_numbers);
+}
+
+absl::optional<SequenceNumberHistogram>
+LruGarbageCollector::NewRetainedHistogram() {
+  if (!params_.approximate_sequence_numbers) return absl::nullopt;
+
+  return SequenceNumberHistogram::ForRange(
+      delegate_->current_sequence_number(), kHistogramBuckets);
 }
 
 int LruGarbageCollector::QueryCountForPercentile(int percentile) {
@@ -17,13 +17,17 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_LRU_GARBAGE_COLLECTOR_H_
 #define FIRESTORE_CORE_SRC_LOCAL_LRU_GARBAGE_COLLECTOR_H_
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <unordered_map>
 
 #include "Firestore/core/src/local/reference_delegate.h"
+#include "Firestore/core/src/local/sequence_number_histogram.h"
 #include "Firestore/core/src/local/target_cache.h"
 #include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/types.h"
 #include "Firestore/core/src/util/status_fwd.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
@@ -45,17 +49,30 @@ struct LruParams {
   int64_t min_bytes_threshold;
   int percentile_to_collect;
   int maximum_sequence_numbers_to_collect;
+
+  /**
+   * Whether to determine the sequence numbers to collect from the histogram
+   * saved by the previous collection instead of enumerating every orphaned
+   * document.
+   */
+  bool approximate_sequence_numbers;
 };
 
 struct LruResults {
   static LruResults DidNotRun() {
-    return LruResults{/* did_run= */ false, 0, 0, 0};
+    return LruResults{/* did_run= */ false, 0, 0, 0, /* finished= */ true};
   }
 
   bool did_run;
   int sequence_numbers_collected;
   int targets_removed;
   int documents_removed;
+
+  /**
+   * False if the collection was run with `CollectSlice()` and needs further
+   * slices to finish, in which case the counts cover the slices so far.
+   */
+  bool finished;
 };
 
 using LiveQueryMap = std::unordered_map<model::TargetId, TargetData>;
@@ -98,6 +115,46 @@ class LruDelegate : public ReferenceDelegate {
   virtual int RemoveOrphanedDocuments(
       model::ListenSequenceNumber sequence_number) = 0;
 
+  /**
+   * Removes unreferenced documents like `RemoveOrphanedDocuments()`, but
+   * resumably: only the documents after `*cursor` (or all documents, if it's
+   * empty) are examined, in key order, and the examination stops once
+   * `deadline` has passed. `*cursor` is then set to the last document
+   * examined, or to nullopt if there are no more documents to examine.
+   *
+   * If `retained` is not null, the sequence numbers of the examined documents
+   * that are kept are added to it.
+   *
+   * Delegates that can't resume remove all documents at once, and don't
+   * record the kept documents.
+   */
+  virtual int RemoveOrphanedDocumentsUntil(
+      model::ListenSequenceNumber sequence_number,
+      std::chrono::steady_clock::time_point /* deadline */,
+      absl::optional<model::DocumentKey>* cursor,
+      SequenceNumberHistogram* /* retained */) {
+    *cursor = absl::nullopt;
+    return RemoveOrphanedDocuments(sequence_number);
+  }
+
+  /**
+   * Saves the distribution of orphaned document sequence numbers left by a
+   * collection, for use by `LoadOrphanedDocumentHistogram()`. Delegates that
+   * can't enumerate their orphaned documents cheaply should implement this.
+   */
+  virtual void SaveOrphanedDocumentHistogram(
+      const SequenceNumberHistogram& /* histogram */) {
+  }
+
+  /**
+   * Returns the histogram last saved with `SaveOrphanedDocumentHistogram()`,
+   * if any.
+   */
+  virtual absl::optional<SequenceNumberHistogram>
+  LoadOrphanedDocumentHistogram() {
+    return absl::nullopt;
+  }
+
   /**
    * Removes all targets that are not currently being listened to and have a
    * sequence number less than or equal to the given sequence number. Returns
@@ -105,6 +162,13 @@ class LruDelegate : public ReferenceDelegate {
    */
   virtual int RemoveTargets(model::ListenSequenceNumber sequence_number,
                             const LiveQueryMap& live_queries) = 0;
+
+  /**
+   * Updates the sequence numbers of the orphaned documents recorded by
+   * `RecordDocumentAccess()` to the current one, so that documents the user
+   * keeps reading are collected last.
+   */
+  virtual void FlushDocumentAccesses() = 0;
 };
 
 /**
@@ -147,13 +211,66 @@ class LruGarbageCollector {
 
   local::LruResults Collect(const LiveQueryMap& live_targets);
 
+  /**
+   * Like `Collect()`, but does the work in slices of roughly `budget` each, so
+   * that a large collection doesn't hold up other work for long. Each call
+   * runs one slice, and must run in its own transaction.
+   *
+   * The first slice determines what to collect and removes the targets, and
+   * each slice removes orphaned documents, resuming where the previous one
+   * stopped. Until the collection is finished, the returned results have
+   * `finished` set to false, and the caller should call again.
+   */
+  local::LruResults CollectSlice(const LiveQueryMap& live_targets,
+                                 std::chrono::milliseconds budget);
+
  private:
+  /** The state of a collection run with `CollectSlice()`. */
+  struct PendingCollection {
+    model::ListenSequenceNumber upper_bound = kListenSequenceNumberInvalid;
+    absl::optional<model::DocumentKey> cursor;
+    LruResults results;
+
+    // The documents kept so far, if approximate sequence numbers are enabled.
+    absl::optional<SequenceNumberHistogram> retained;
+  };
+
   LruResults RunGarbageCollection(const LiveQueryMap& live_targets);
 
+  /**
+   * Returns false if collection shouldn't run: if it's disabled, or the cache
+   * is below the size threshold.
+   */
+  bool ShouldCollect();
+
+  /**
+   * Determines the number of sequence numbers to collect and the upper bound
+   * of the sequence numbers to collect, and returns the upper bound.
+   *
+   * If approximate sequence numbers are enabled and a histogram was saved by
+   * a previous collection, both are estimated from it. Otherwise all targets
+   * and orphaned documents are enumerated.
+   */
+  model::ListenSequenceNumber DetermineUpperBound(int* sequence_numbers);
+
+  /**
+   * Returns a histogram to record the documents kept by a collection in, or
+   * nullopt if approximate sequence numbers are disabled.
+   */
+  absl::optional<SequenceNumberHistogram> NewRetainedHistogram();
+
+  /**
+   * Removes orphaned documents from `pending_` until either they are all
+   * removed or `deadline` has passed.
+   */
+  LruResults ContinueCollection(std::chrono::steady_clock::time_point deadline);
+
   // Delegate owns the LruGarbageCollector; this is a back pointer.
   LruDelegate* delegate_;
 
   LruParams params_ = LruParams::Default();
+
+  absl::optional<PendingCollection> pending_;
 };
 
 }  // namespace local
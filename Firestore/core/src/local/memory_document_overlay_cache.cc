@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/memory_document_overlay_cache.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::DocumentKey;
+
+absl::optional<DocumentOverlay> MemoryDocumentOverlayCache::Get(
+    const DocumentKey& key) {
+  auto found = overlays_.find(key);
+  if (found == overlays_.end()) return absl::nullopt;
+  return found->second;
+}
+
+void MemoryDocumentOverlayCache::Save(const DocumentKey& key,
+                                      const DocumentOverlay& overlay) {
+  auto found = overlays_.find(key);
+  if (found == overlays_.end()) {
+    overlays_.emplace(key, overlay);
+  } else {
+    found->second = overlay;
+  }
+}
+
+void MemoryDocumentOverlayCache::Remove(const DocumentKey& key) {
+  overlays_.erase(key);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_MEMORY_DOCUMENT_OVERLAY_CACHE_H_
+#define FIRESTORE_CORE_SRC_LOCAL_MEMORY_DOCUMENT_OVERLAY_CACHE_H_
+
+#include <unordered_map>
+
+#include "Firestore/core/src/local/document_overlay_cache.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+class MemoryDocumentOverlayCache : public DocumentOverlayCache {
+ public:
+  absl::optional<DocumentOverlay> Get(const model::DocumentKey& key) override;
+
+  void Save(const model::DocumentKey& key,
+            const DocumentOverlay& overlay) override;
+
+  void Remove(const model::DocumentKey& key) override;
+
+ private:
+  std::unordered_map<model::DocumentKey,
+                     DocumentOverlay,
+                     model::DocumentKeyHash>
+      overlays_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_MEMORY_DOCUMENT_OVERLAY_CACHE_H_
@@ -21,6 +21,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/field_index.h"
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/util/hard_assert.h"
 
@@ -28,6 +30,10 @@ namespace firebase {
 namespace firestore {
 namespace local {
 
+using model::DocumentKey;
+using model::DocumentKeySet;
+using model::FieldIndex;
+using model::MaybeDocument;
 using model::ResourcePath;
 
 bool MemoryCollectionParentIndex::Add(const ResourcePath& collection_path) {
@@ -52,6 +58,20 @@ std::vector<ResourcePath> MemoryCollectionParentIndex::GetEntries(
   return result;
 }
 
+size_t MemoryCollectionParentIndex::byte_size() const {
+  size_t result = 0;
+  for (const auto& entry : index_) {
+    result += entry.first.size();
+    for (const ResourcePath& parent_path : entry.second) {
+      result += sizeof(parent_path);
+      for (const std::string& segment : parent_path) {
+        result += sizeof(segment) + segment.size();
+      }
+    }
+  }
+  return result;
+}
+
 void MemoryIndexManager::AddToCollectionParentIndex(
     const ResourcePath& collection_path) {
   collection_parents_index_.Add(collection_path);
@@ -62,6 +82,37 @@ std::vector<ResourcePath> MemoryIndexManager::GetCollectionParents(
   return collection_parents_index_.GetEntries(collection_id);
 }
 
+void MemoryIndexManager::AddFieldIndex(const FieldIndex& index) {
+  std::vector<FieldIndex>& indexes = field_indexes_[index.collection_group()];
+  if (std::find(indexes.begin(), indexes.end(), index) == indexes.end()) {
+    indexes.push_back(index.WithIndexId(next_index_id_++));
+  }
+}
+
+void MemoryIndexManager::DeleteFieldIndex(const FieldIndex& index) {
+  std::vector<FieldIndex>& indexes = field_indexes_[index.collection_group()];
+  indexes.erase(std::remove(indexes.begin(), indexes.end(), index),
+                indexes.end());
+}
+
+std::vector<FieldIndex> MemoryIndexManager::GetFieldIndexes(
+    const std::string& collection_group) {
+  auto found = field_indexes_.find(collection_group);
+  if (found == field_indexes_.end()) return {};
+  return found->second;
+}
+
+void MemoryIndexManager::UpdateIndexEntries(const MaybeDocument&) {
+}
+
+void MemoryIndexManager::RemoveIndexEntries(const DocumentKey&) {
+}
+
+absl::optional<DocumentKeySet> MemoryIndexManager::GetDocumentsMatchingQuery(
+    const core::Query&) {
+  return absl::nullopt;
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
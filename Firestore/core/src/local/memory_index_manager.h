@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "Firestore/core/src/local/index_manager.h"
+#include "Firestore/core/src/model/field_index.h"
 
 namespace firebase {
 namespace firestore {
@@ -41,11 +42,24 @@ class MemoryCollectionParentIndex {
   std::vector<model::ResourcePath> GetEntries(
       const std::string& collection_id) const;
 
+  /** An estimate of the memory used by the entries, in bytes. */
+  size_t byte_size() const;
+
+  void Clear() {
+    index_.clear();
+  }
+
  private:
   std::unordered_map<std::string, std::set<model::ResourcePath>> index_;
 };
 
-/** An in-memory implementation of IndexManager. */
+/**
+ * An in-memory implementation of IndexManager.
+ *
+ * Field index configurations are recorded, but no index entries are
+ * maintained: memory persistence already holds decoded documents, so scanning
+ * a collection is cheap and GetDocumentsMatchingQuery always defers to it.
+ */
 class MemoryIndexManager : public IndexManager {
  public:
   void AddToCollectionParentIndex(
@@ -54,8 +68,26 @@ class MemoryIndexManager : public IndexManager {
   std::vector<model::ResourcePath> GetCollectionParents(
       const std::string& collection_id) override;
 
+  void AddFieldIndex(const model::FieldIndex& index) override;
+
+  void DeleteFieldIndex(const model::FieldIndex& index) override;
+
+  std::vector<model::FieldIndex> GetFieldIndexes(
+      const std::string& collection_group) override;
+
+  void UpdateIndexEntries(const model::MaybeDocument& document) override;
+
+  void RemoveIndexEntries(const model::DocumentKey& key) override;
+
+  absl::optional<model::DocumentKeySet> GetDocumentsMatchingQuery(
+      const core::Query& query) override;
+
  private:
   MemoryCollectionParentIndex collection_parents_index_;
+
+  std::unordered_map<std::string, std::vector<model::FieldIndex>>
+      field_indexes_;
+  int32_t next_index_id_ = 1;
 };
 
 }  // namespace local
@@ -16,6 +16,7 @@
 
 #include "Firestore/core/src/local/memory_lru_reference_delegate.h"
 
+#include <set>
 #include <vector>
 
 #include "Firestore/core/src/local/listen_sequence.h"
@@ -78,6 +79,20 @@ void MemoryLruReferenceDelegate::UpdateLimboDocument(
   sequence_numbers_[key] = current_sequence_number_;
 }
 
+void MemoryLruReferenceDelegate::RecordDocumentAccess(const DocumentKey& key) {
+  access_log_.Record(key);
+}
+
+void MemoryLruReferenceDelegate::FlushDocumentAccesses() {
+  for (const DocumentKey& key : access_log_.Take()) {
+    // Only documents that are still cached have a sequence number.
+    auto found = sequence_numbers_.find(key);
+    if (found != sequence_numbers_.end()) {
+      found->second = current_sequence_number_;
+    }
+  }
+}
+
 void MemoryLruReferenceDelegate::OnTransactionStarted(absl::string_view) {
   current_sequence_number_ = listen_sequence_->Next();
 }
@@ -176,9 +191,9 @@ bool MemoryLruReferenceDelegate::IsPinnedAtSequenceNumber(
 
 StatusOr<int64_t> MemoryLruReferenceDelegate::CalculateByteSize() {
   // Note that this method is only used for testing because this delegate is
-  // only used for testing. The algorithm here (loop through everything,
-  // serialize it and count bytes) is inefficient and inexact, but won't run in
-  // production.
+  // only used for testing. The algorithm here (serialize everything and count
+  // bytes) is inexact, but won't run in production. The remote document cache,
+  // by far the largest, only sizes the documents changed since the last call.
   int64_t count = 0;
   count += persistence_->target_cache()->CalculateByteSize(*sizer_);
   count += persistence_->remote_document_cache()->CalculateByteSize(*sizer_);
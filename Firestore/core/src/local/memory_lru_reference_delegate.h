@@ -21,6 +21,7 @@
 #include <unordered_map>
 #include <utility>
 
+#include "Firestore/core/src/local/document_access_log.h"
 #include "Firestore/core/src/local/lru_garbage_collector.h"
 #include "Firestore/core/src/local/reference_delegate.h"
 #include "Firestore/core/src/model/document_key.h"
@@ -57,6 +58,7 @@ class MemoryLruReferenceDelegate : public LruDelegate {
   void RemoveTarget(const TargetData& target_data) override;
 
   void UpdateLimboDocument(const model::DocumentKey& key) override;
+  void RecordDocumentAccess(const model::DocumentKey& key) override;
 
   void OnTransactionStarted(absl::string_view label) override;
   void OnTransactionCommitted() override;
@@ -76,6 +78,7 @@ class MemoryLruReferenceDelegate : public LruDelegate {
   int RemoveOrphanedDocuments(model::ListenSequenceNumber upper_bound) override;
   int RemoveTargets(model::ListenSequenceNumber sequence_number,
                     const LiveQueryMap& live_queries) override;
+  void FlushDocumentAccesses() override;
 
  private:
   bool MutationQueuesContainKey(const model::DocumentKey& key) const;
@@ -94,6 +97,9 @@ class MemoryLruReferenceDelegate : public LruDelegate {
                      model::DocumentKeyHash>
       sequence_numbers_;
 
+  // The documents read since the last garbage collection.
+  DocumentAccessLog access_log_;
+
   // This ReferenceSet is owned by LocalStore.
   ReferenceSet* additional_references_ = nullptr;
 
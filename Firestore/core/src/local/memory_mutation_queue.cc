@@ -98,6 +98,7 @@ MutationBatch MemoryMutationQueue::AddMutationBatch(
   for (const Mutation& mutation : batch.mutations()) {
     batches_by_document_key_ = batches_by_document_key_.insert(
         DocumentKeyReference{mutation.key(), batch_id});
+    overlay_cache_.Remove(mutation.key());
 
     persistence_->index_manager()->AddToCollectionParentIndex(
         mutation.key().path().PopLast());
@@ -107,13 +108,20 @@ MutationBatch MemoryMutationQueue::AddMutationBatch(
 }
 
 void MemoryMutationQueue::RemoveMutationBatch(const MutationBatch& batch) {
-  // Can only remove the first batch
+  // Can only remove the first or the last batch
   HARD_ASSERT(!queue_.empty(), "Trying to remove batch from empty queue");
-  const MutationBatch& head = queue_.front();
-  HARD_ASSERT(head.batch_id() == batch.batch_id(),
-              "Can only remove the first entry of the mutation queue");
-
-  queue_.erase(queue_.begin());
+  if (queue_.back().batch_id() == batch.batch_id() && queue_.size() > 1) {
+    // Batch IDs index into the queue, so reuse the ID of a squashed batch to
+    // keep them contiguous.
+    queue_.pop_back();
+    next_batch_id_ = batch.batch_id();
+  } else {
+    const MutationBatch& head = queue_.front();
+    HARD_ASSERT(head.batch_id() == batch.batch_id(),
+                "Can only remove the first or the last entry of the mutation "
+                "queue");
+    queue_.erase(queue_.begin());
+  }
 
   // Remove entries from the index too.
   for (const Mutation& mutation : batch.mutations()) {
@@ -122,6 +130,7 @@ void MemoryMutationQueue::RemoveMutationBatch(const MutationBatch& batch) {
 
     DocumentKeyReference reference{key, batch.batch_id()};
     batches_by_document_key_ = batches_by_document_key_.erase(reference);
+    overlay_cache_.Remove(key);
   }
 }
 
@@ -23,6 +23,7 @@
 #include "Firestore/core/include/firebase/firestore/timestamp.h"
 #include "Firestore/core/src/immutable/sorted_set.h"
 #include "Firestore/core/src/local/document_key_reference.h"
+#include "Firestore/core/src/local/memory_document_overlay_cache.h"
 #include "Firestore/core/src/local/mutation_queue.h"
 #include "Firestore/core/src/model/model_fwd.h"
 #include "Firestore/core/src/model/mutation_batch.h"
@@ -84,6 +85,11 @@ class MemoryMutationQueue : public MutationQueue {
   nanopb::ByteString GetLastStreamToken() override;
   void SetLastStreamToken(nanopb::ByteString token) override;
 
+  /** The overlays of the documents mutated by this queue's batches. */
+  MemoryDocumentOverlayCache* overlay_cache() {
+    return &overlay_cache_;
+  }
+
  private:
   using DocumentKeyReferenceSet =
       immutable::SortedSet<DocumentKeyReference, DocumentKeyReference::ByKey>;
@@ -140,6 +146,8 @@ class MemoryMutationQueue : public MutationQueue {
 
   /** An ordered mapping between documents and the mutation batch IDs. */
   DocumentKeyReferenceSet batches_by_document_key_;
+
+  MemoryDocumentOverlayCache overlay_cache_;
 };
 
 }  // namespace local
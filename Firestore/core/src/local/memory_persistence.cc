@@ -16,6 +16,8 @@
 
 #include "Firestore/core/src/local/memory_persistence.h"
 
+#include <chrono>  // NOLINT(build/c++11)
+
 #include "Firestore/core/src/auth/user.h"
 #include "Firestore/core/src/local/listen_sequence.h"
 #include "Firestore/core/src/local/lru_garbage_collector.h"
@@ -90,6 +92,11 @@ MemoryMutationQueue* MemoryPersistence::GetMutationQueueForUser(
   }
 }
 
+MemoryDocumentOverlayCache* MemoryPersistence::GetDocumentOverlayCacheForUser(
+    const User& user) {
+  return GetMutationQueueForUser(user)->overlay_cache();
+}
+
 MemoryTargetCache* MemoryPersistence::target_cache() {
   return &target_cache_;
 }
@@ -111,10 +118,14 @@ ReferenceDelegate* MemoryPersistence::reference_delegate() {
 }
 
 void MemoryPersistence::RunInternal(absl::string_view label,
+                                    TransactionClass,
                                     std::function<void()> block) {
-  TransactionGuard guard(reference_delegate_.get(), label);
-
-  block();
+  auto start = std::chrono::steady_clock::now();
+  {
+    TransactionGuard guard(reference_delegate_.get(), label);
+    block();
+  }
+  RecordTransaction(label, start);
 }
 
 }  // namespace local
@@ -76,6 +76,9 @@ class MemoryPersistence : public Persistence {
 
   MemoryMutationQueue* GetMutationQueueForUser(const auth::User& user) override;
 
+  MemoryDocumentOverlayCache* GetDocumentOverlayCacheForUser(
+      const auth::User& user) override;
+
   MemoryTargetCache* target_cache() override;
 
   MemoryBundleCache* bundle_cache() override;
@@ -86,8 +89,13 @@ class MemoryPersistence : public Persistence {
 
   ReferenceDelegate* reference_delegate() override;
 
+  size_t ReleaseMemory() override {
+    return remote_document_cache_.ReleaseMemory();
+  }
+
  protected:
   void RunInternal(absl::string_view label,
+                   TransactionClass transaction_class,
                    std::function<void()> block) override;
 
  private:
@@ -16,12 +16,20 @@
 
 #include "Firestore/core/src/local/memory_remote_document_cache.h"
 
+#include <utility>
+
+#include "Firestore/Protos/nanopb/firestore/local/maybe_document.nanopb.h"
 #include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/core/query_matcher.h"
 #include "Firestore/core/src/local/memory_lru_reference_delegate.h"
 #include "Firestore/core/src/local/memory_persistence.h"
 #include "Firestore/core/src/local/sizer.h"
 #include "Firestore/core/src/model/document_map.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/nanopb/nanopb_util.h"
+#include "Firestore/core/src/nanopb/reader.h"
 #include "Firestore/core/src/util/hard_assert.h"
+#include "absl/memory/memory.h"
 
 namespace firebase {
 namespace firestore {
@@ -36,29 +44,68 @@ using model::ListenSequenceNumber;
 using model::MaybeDocument;
 using model::MaybeDocumentMap;
 using model::OptionalMaybeDocumentMap;
+using model::ResourcePath;
 using model::SnapshotVersion;
+using nanopb::Message;
+using nanopb::StringReader;
 
 MemoryRemoteDocumentCache::MemoryRemoteDocumentCache(
     MemoryPersistence* persistence) {
   persistence_ = persistence;
 }
 
+void MemoryRemoteDocumentCache::EnableCompactStorage(
+    LocalSerializer serializer) {
+  HARD_ASSERT(docs_.empty(),
+              "Compact storage must be enabled before adding documents");
+  serializer_ = absl::make_unique<LocalSerializer>(std::move(serializer));
+}
+
 void MemoryRemoteDocumentCache::Add(const MaybeDocument& document,
                                     const model::SnapshotVersion& read_time) {
-  docs_ = docs_.insert(document.key(), std::make_pair(document, read_time));
+  RemoveFromReadTimeIndex(document.key());
+  read_times_.insert(MakeReadTimeKey(document.key(), read_time));
+
+  RemoveByteSize(document.key());
+  if (serializer_) {
+    std::string encoded = serializer_->EncodeMaybeDocumentToString(document);
+    SetByteSize(document.key(), static_cast<int64_t>(encoded.size()));
+    // Recently written documents are likely to be read soon, e.g. to raise
+    // snapshots.
+    decoded_documents_.Put(document, encoded);
+    docs_ = docs_.insert(document.key(),
+                         Entry{absl::nullopt, std::move(encoded),
+                               document.type(), read_time});
+  } else {
+    unsized_documents_.insert(document.key());
+    docs_ = docs_.insert(document.key(), Entry{document, std::string(),
+                                               document.type(), read_time});
+  }
 
   persistence_->index_manager()->AddToCollectionParentIndex(
       document.key().path().PopLast());
 }
 
+void MemoryRemoteDocumentCache::AddAll(
+    const std::vector<DocumentReadTime>& documents) {
+  for (const auto& entry : documents) {
+    Add(entry.first, entry.second);
+  }
+}
+
 void MemoryRemoteDocumentCache::Remove(const DocumentKey& key) {
+  RemoveFromReadTimeIndex(key);
+  RemoveByteSize(key);
   docs_ = docs_.erase(key);
+  if (serializer_) {
+    decoded_documents_.Remove(key);
+  }
 }
 
 absl::optional<MaybeDocument> MemoryRemoteDocumentCache::Get(
     const DocumentKey& key) {
   const auto& entry = docs_.get(key);
-  return entry ? entry->first : absl::optional<MaybeDocument>();
+  return entry ? GetDocument(key, *entry) : absl::optional<MaybeDocument>();
 }
 
 OptionalMaybeDocumentMap MemoryRemoteDocumentCache::GetAll(
@@ -79,34 +126,122 @@ DocumentMap MemoryRemoteDocumentCache::GetMatching(
       !query.IsCollectionGroupQuery(),
       "CollectionGroup queries should be handled in LocalDocumentsView");
 
+  if (since_read_time != SnapshotVersion::None()) {
+    return GetMatchingSince(query, since_read_time);
+  }
+
   DocumentMap results;
 
   // Documents are ordered by key, so we can use a prefix scan to narrow down
   // the documents we need to match the query against.
   DocumentKey prefix{query.path().Append("")};
+  core::QueryMatcher matcher(query);
   for (auto it = docs_.lower_bound(prefix); it != docs_.end(); ++it) {
     const DocumentKey& key = it->first;
     if (!query.path().IsPrefixOf(key.path())) {
       break;
     }
-    const MaybeDocument& maybe_doc = it->second.first;
-    if (!maybe_doc.is_document()) {
+    const Entry& entry = it->second;
+    if (entry.type != MaybeDocument::Type::Document ||
+        entry.read_time <= since_read_time) {
       continue;
     }
 
-    const SnapshotVersion& read_time = it->second.second;
-    if (read_time <= since_read_time) {
+    Document doc(GetDocument(key, entry));
+    if (matcher.Matches(doc)) {
+      results = results.insert(key, std::move(doc));
+    }
+  }
+  return results;
+}
+
+DocumentMap MemoryRemoteDocumentCache::GetMatchingCandidates(
+    const Query&, const DocumentKeySet& candidate_keys) {
+  DocumentMap results;
+  for (const DocumentKey& key : candidate_keys) {
+    const auto& entry = docs_.get(key);
+    if (entry && entry->type == MaybeDocument::Type::Document) {
+      results = results.insert(key, Document(GetDocument(key, *entry)));
+    }
+  }
+  return results;
+}
+
+DocumentMap MemoryRemoteDocumentCache::GetMatchingInCollections(
+    const Query& query,
+    const std::vector<ResourcePath>& collection_paths,
+    const SnapshotVersion& since_read_time) {
+  // Each collection is a separate range of `docs_`, so they're read one by
+  // one.
+  DocumentMap::Builder results;
+  for (const ResourcePath& collection_path : collection_paths) {
+    Query collection_query = query.AsCollectionQueryAtPath(collection_path);
+    DocumentMap collection_results =
+        GetMatching(collection_query, since_read_time);
+    for (const auto& kv : collection_results.underlying_map()) {
+      results.insert(kv.first, Document(kv.second));
+    }
+  }
+  return results.Build();
+}
+
+DocumentMap MemoryRemoteDocumentCache::GetMatchingSince(
+    const Query& query, const SnapshotVersion& since_read_time) {
+  DocumentMap results;
+
+  // Only the documents read after `since_read_time` can have changed, so the
+  // cost is proportional to the number of changes rather than to the size of
+  // the collection.
+  const ResourcePath& collection_path = query.path();
+  core::QueryMatcher matcher(query);
+  auto it = read_times_.upper_bound(
+      ReadTimeKey{collection_path, since_read_time, std::string()});
+  for (; it != read_times_.end() && it->collection_path == collection_path;
+       ++it) {
+    if (it->read_time == since_read_time) {
       continue;
     }
 
-    Document doc(maybe_doc);
-    if (query.Matches(doc)) {
+    DocumentKey key{collection_path.Append(it->document_id)};
+    const auto& entry = docs_.get(key);
+    HARD_ASSERT(entry, "Read-time index refers to missing document %s",
+                key.ToString());
+    if (entry->type != MaybeDocument::Type::Document) {
+      continue;
+    }
+
+    Document doc(GetDocument(key, *entry));
+    if (matcher.Matches(doc)) {
       results = results.insert(key, std::move(doc));
     }
   }
   return results;
 }
 
+void MemoryRemoteDocumentCache::EnumerateMatching(
+    const Query& query, const DocumentVisitor& visitor) {
+  HARD_ASSERT(
+      !query.IsCollectionGroupQuery(),
+      "CollectionGroup queries should be handled in LocalDocumentsView");
+
+  DocumentKey prefix{query.path().Append("")};
+  for (auto it = docs_.lower_bound(prefix); it != docs_.end(); ++it) {
+    const DocumentKey& key = it->first;
+    if (!query.path().IsPrefixOf(key.path())) {
+      break;
+    }
+    const Entry& entry = it->second;
+    if (entry.type != MaybeDocument::Type::Document ||
+        !query.path().IsImmediateParentOf(key.path())) {
+      continue;
+    }
+
+    if (!visitor(Document(GetDocument(key, entry)))) {
+      break;
+    }
+  }
+}
+
 std::vector<DocumentKey> MemoryRemoteDocumentCache::RemoveOrphanedDocuments(
     MemoryLruReferenceDelegate* reference_delegate,
     ListenSequenceNumber upper_bound) {
@@ -115,7 +250,12 @@ std::vector<DocumentKey> MemoryRemoteDocumentCache::RemoveOrphanedDocuments(
   for (const auto& kv : docs_) {
     const DocumentKey& key = kv.first;
     if (!reference_delegate->IsPinnedAtSequenceNumber(upper_bound, key)) {
+      read_times_.erase(MakeReadTimeKey(key, kv.second.read_time));
+      RemoveByteSize(key);
       updated_docs = updated_docs.erase(key);
+      if (serializer_) {
+        decoded_documents_.Remove(key);
+      }
       removed.push_back(key);
     }
   }
@@ -123,13 +263,94 @@ std::vector<DocumentKey> MemoryRemoteDocumentCache::RemoveOrphanedDocuments(
   return removed;
 }
 
-int64_t MemoryRemoteDocumentCache::CalculateByteSize(const Sizer& sizer) {
-  int64_t count = 0;
+void MemoryRemoteDocumentCache::EnumerateEncoded(
+    const LocalSerializer& serializer,
+    const std::function<void(absl::string_view, const SnapshotVersion&)>&
+        callback) const {
   for (const auto& kv : docs_) {
-    const MaybeDocument& maybe_doc = kv.second.first;
-    count += sizer.CalculateByteSize(maybe_doc);
+    const Entry& entry = kv.second;
+    if (entry.document) {
+      callback(serializer.EncodeMaybeDocumentToString(*entry.document),
+               entry.read_time);
+    } else {
+      callback(entry.encoded, entry.read_time);
+    }
+  }
+}
+
+int64_t MemoryRemoteDocumentCache::CalculateByteSize(const Sizer& sizer) {
+  if (&sizer != sizer_) {
+    // Sizes calculated by another sizer aren't comparable. Encoded documents
+    // are always measured by their encoding.
+    if (!serializer_) {
+      for (const auto& kv : docs_) {
+        unsized_documents_.insert(kv.first);
+      }
+    }
+    sizer_ = &sizer;
   }
-  return count;
+
+  // Only the documents that changed since the last call need to be sized.
+  for (const DocumentKey& key : unsized_documents_) {
+    const auto& entry = docs_.get(key);
+    HARD_ASSERT(entry && entry->document, "Unsized document %s not found",
+                key.ToString());
+    SetByteSize(key, sizer.CalculateByteSize(*entry->document));
+  }
+  unsized_documents_.clear();
+  return byte_size_;
+}
+
+void MemoryRemoteDocumentCache::SetByteSize(const DocumentKey& key,
+                                            int64_t byte_size) {
+  int64_t& current = byte_sizes_[key];
+  byte_size_ += byte_size - current;
+  current = byte_size;
+}
+
+void MemoryRemoteDocumentCache::RemoveByteSize(const DocumentKey& key) {
+  unsized_documents_.erase(key);
+  auto found = byte_sizes_.find(key);
+  if (found != byte_sizes_.end()) {
+    byte_size_ -= found->second;
+    byte_sizes_.erase(found);
+  }
+}
+
+MemoryRemoteDocumentCache::ReadTimeKey
+MemoryRemoteDocumentCache::MakeReadTimeKey(const DocumentKey& key,
+                                           const SnapshotVersion& read_time) {
+  const ResourcePath& path = key.path();
+  return ReadTimeKey{path.PopLast(), read_time, path.last_segment()};
+}
+
+void MemoryRemoteDocumentCache::RemoveFromReadTimeIndex(
+    const DocumentKey& key) {
+  const auto& entry = docs_.get(key);
+  if (entry) {
+    read_times_.erase(MakeReadTimeKey(key, entry->read_time));
+  }
+}
+
+MaybeDocument MemoryRemoteDocumentCache::GetDocument(const DocumentKey& key,
+                                                     const Entry& entry) {
+  if (entry.document) {
+    return *entry.document;
+  }
+
+  absl::optional<MaybeDocument> cached =
+      decoded_documents_.Get(key, entry.encoded);
+  if (cached) {
+    return std::move(*cached);
+  }
+
+  StringReader reader{entry.encoded};
+  auto message = Message<firestore_client_MaybeDocument>::TryParse(&reader);
+  MaybeDocument document = serializer_->DecodeMaybeDocument(&reader, *message);
+  HARD_ASSERT(reader.ok(), "Failed to decode cached document %s: %s",
+              key.ToString(), reader.status().ToString());
+  decoded_documents_.Put(document, entry.encoded);
+  return document;
 }
 
 }  // namespace local
@@ -17,15 +17,26 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_MEMORY_REMOTE_DOCUMENT_CACHE_H_
 #define FIRESTORE_CORE_SRC_LOCAL_MEMORY_REMOTE_DOCUMENT_CACHE_H_
 
-#include <utility>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "Firestore/core/src/immutable/sorted_map.h"
+#include "Firestore/core/src/local/decoded_document_cache.h"
+#include "Firestore/core/src/local/local_serializer.h"
 #include "Firestore/core/src/local/remote_document_cache.h"
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/maybe_document.h"
 #include "Firestore/core/src/model/model_fwd.h"
+#include "Firestore/core/src/model/resource_path.h"
+#include "Firestore/core/src/model/snapshot_version.h"
 #include "Firestore/core/src/model/types.h"
+#include "absl/strings/string_view.h"
 
 namespace firebase {
 namespace firestore {
@@ -39,8 +50,18 @@ class MemoryRemoteDocumentCache : public RemoteDocumentCache {
  public:
   explicit MemoryRemoteDocumentCache(MemoryPersistence* persistence);
 
+  /**
+   * Makes the cache store documents in their encoded form and decode them when
+   * they are read, keeping the most recently read ones decoded. Encoded
+   * documents take several times less memory, at the cost of decoding.
+   *
+   * Must be called before any documents are added.
+   */
+  void EnableCompactStorage(LocalSerializer serializer);
+
   void Add(const model::MaybeDocument& document,
            const model::SnapshotVersion& read_time) override;
+  void AddAll(const std::vector<DocumentReadTime>& documents) override;
   void Remove(const model::DocumentKey& key) override;
 
   absl::optional<model::MaybeDocument> Get(
@@ -50,6 +71,16 @@ class MemoryRemoteDocumentCache : public RemoteDocumentCache {
   model::DocumentMap GetMatching(
       const core::Query& query,
       const model::SnapshotVersion& since_read_time) override;
+  model::DocumentMap GetMatchingInCollections(
+      const core::Query& query,
+      const std::vector<model::ResourcePath>& collection_paths,
+      const model::SnapshotVersion& since_read_time) override;
+  model::DocumentMap GetMatchingCandidates(
+      const core::Query& query,
+      const model::DocumentKeySet& candidate_keys) override;
+
+  void EnumerateMatching(const core::Query& query,
+                         const DocumentVisitor& visitor) override;
 
   std::vector<model::DocumentKey> RemoveOrphanedDocuments(
       MemoryLruReferenceDelegate* reference_delegate,
@@ -57,11 +88,105 @@ class MemoryRemoteDocumentCache : public RemoteDocumentCache {
 
   int64_t CalculateByteSize(const Sizer& sizer);
 
+  /**
+   * Calls `callback` with the encoding of each document in the cache and its
+   * read time. Documents stored encoded are passed as they are stored, others
+   * are encoded with `serializer`.
+   */
+  void EnumerateEncoded(
+      const LocalSerializer& serializer,
+      const std::function<void(absl::string_view encoded,
+                               const model::SnapshotVersion& read_time)>&
+          callback) const;
+
+  /**
+   * Empties the cache of decoded documents, which is only used if documents
+   * are stored encoded, and returns the estimated memory it released, in
+   * bytes.
+   */
+  size_t ReleaseMemory() {
+    return decoded_documents_.Clear();
+  }
+
  private:
+  struct Entry {
+    /** The document, unless the cache uses compact storage. */
+    absl::optional<model::MaybeDocument> document;
+
+    /** The encoded document, if the cache uses compact storage. */
+    std::string encoded;
+
+    model::MaybeDocument::Type type;
+    model::SnapshotVersion read_time;
+
+    friend bool operator==(const Entry& lhs, const Entry& rhs) {
+      return lhs.document == rhs.document && lhs.encoded == rhs.encoded &&
+             lhs.type == rhs.type && lhs.read_time == rhs.read_time;
+    }
+  };
+
+  /**
+   * An entry of the read-time index, which orders the documents of each
+   * collection by the time they were read, like the
+   * remote_document_read_time table of the LevelDB cache.
+   */
+  struct ReadTimeKey {
+    model::ResourcePath collection_path;
+    model::SnapshotVersion read_time;
+    std::string document_id;
+
+    friend bool operator<(const ReadTimeKey& lhs, const ReadTimeKey& rhs) {
+      return std::tie(lhs.collection_path, lhs.read_time, lhs.document_id) <
+             std::tie(rhs.collection_path, rhs.read_time, rhs.document_id);
+    }
+  };
+
+  static ReadTimeKey MakeReadTimeKey(const model::DocumentKey& key,
+                                     const model::SnapshotVersion& read_time);
+
+  /** Removes the given document, if present, from the read-time index. */
+  void RemoveFromReadTimeIndex(const model::DocumentKey& key);
+
+  /**
+   * Executes a query against the documents read after `since_read_time`,
+   * which are found through the read-time index.
+   */
+  model::DocumentMap GetMatchingSince(
+      const core::Query& query, const model::SnapshotVersion& since_read_time);
+
+  /** Records the byte size of the given document. */
+  void SetByteSize(const model::DocumentKey& key, int64_t byte_size);
+
+  /** Forgets the byte size of the given document, which has changed. */
+  void RemoveByteSize(const model::DocumentKey& key);
+
+  /** Returns the document stored in the given entry, decoding it if needed. */
+  model::MaybeDocument GetDocument(const model::DocumentKey& key,
+                                   const Entry& entry);
+
   /** Underlying cache of documents and their read times. */
-  immutable::SortedMap<model::DocumentKey,
-                       std::pair<model::MaybeDocument, model::SnapshotVersion>>
-      docs_;
+  immutable::SortedMap<model::DocumentKey, Entry> docs_;
+
+  /** The keys of all documents in `docs_`, ordered by read time. */
+  std::set<ReadTimeKey> read_times_;
+
+  /** Set if documents are stored encoded. */
+  std::unique_ptr<LocalSerializer> serializer_;
+
+  /** The most recently read documents, if documents are stored encoded. */
+  DecodedDocumentCache decoded_documents_;
+
+  /**
+   * The byte sizes of the documents, known from their encoding or calculated
+   * by `sizer_` the last time `CalculateByteSize` ran, and their total. The
+   * documents added since then are in `unsized_documents_`.
+   */
+  std::unordered_map<model::DocumentKey, int64_t, model::DocumentKeyHash>
+      byte_sizes_;
+  std::unordered_set<model::DocumentKey, model::DocumentKeyHash>
+      unsized_documents_;
+  int64_t byte_size_ = 0;
+  const Sizer* sizer_ = nullptr;
 
   // This instance is owned by MemoryPersistence; avoid a retain cycle.
   MemoryPersistence* persistence_;
@@ -0,0 +1,446 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/memory_snapshot.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/auth/user.h"
+#include "Firestore/core/src/local/memory_mutation_queue.h"
+#include "Firestore/core/src/local/memory_persistence.h"
+#include "Firestore/core/src/local/memory_remote_document_cache.h"
+#include "Firestore/core/src/local/memory_target_cache.h"
+#include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/maybe_document.h"
+#include "Firestore/core/src/model/mutation_batch.h"
+#include "Firestore/core/src/model/resource_path.h"
+#include "Firestore/core/src/model/snapshot_version.h"
+#include "Firestore/core/src/nanopb/byte_string.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/nanopb/nanopb_util.h"
+#include "Firestore/core/src/nanopb/reader.h"
+#include "Firestore/core/src/util/filesystem.h"
+#include "Firestore/core/src/util/mapped_file.h"
+#include "Firestore/core/src/util/path.h"
+#include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "absl/strings/str_cat.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using auth::User;
+using model::DocumentKey;
+using model::DocumentKeySet;
+using model::MaybeDocument;
+using model::Mutation;
+using model::MutationBatch;
+using model::ResourcePath;
+using model::SnapshotVersion;
+using model::TargetId;
+using nanopb::ByteString;
+using nanopb::MakeStdString;
+using nanopb::Message;
+using nanopb::StringReader;
+using util::Filesystem;
+using util::MappedFile;
+using util::Path;
+using util::Status;
+using util::StatusOr;
+
+/**
+ * Identifies the file as a snapshot. Followed by the format version, and then
+ * by records, each a one-byte `RecordType`, the length of its payload as a
+ * fixed32 and the payload. Integers are little-endian.
+ */
+constexpr char kMagic[] = {'F', 'S', 'M', 'S'};
+constexpr uint32_t kFormatVersion = 1;
+
+enum class RecordType : uint8_t {
+  /** fixed64 seconds and fixed32 nanos of the read time, then the document. */
+  Document = 1,
+
+  /** A `firestore_client_Target`, including its resume token. */
+  Target = 2,
+
+  /** fixed32 target ID, then fixed32-prefixed paths of its matching keys. */
+  TargetKeys = 3,
+
+  /** fixed64 seconds and fixed32 nanos of the last remote snapshot version. */
+  LastRemoteSnapshotVersion = 4,
+
+  /**
+   * One byte that is 1 if the user is authenticated, then the fixed32-prefixed
+   * UID and last stream token. The batches of the queue follow.
+   */
+  MutationQueue = 5,
+
+  /** A `firestore_client_WriteBatch` of the last mutation queue. */
+  MutationBatch = 6,
+};
+
+void PutFixed32(std::string* out, uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out->push_back(static_cast<char>((value >> shift) & 0xff));
+  }
+}
+
+void PutFixed64(std::string* out, uint64_t value) {
+  PutFixed32(out, static_cast<uint32_t>(value));
+  PutFixed32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void PutBytes(std::string* out, absl::string_view bytes) {
+  PutFixed32(out, static_cast<uint32_t>(bytes.size()));
+  out->append(bytes.data(), bytes.size());
+}
+
+void PutVersion(std::string* out, const google_protobuf_Timestamp& version) {
+  PutFixed64(out, static_cast<uint64_t>(version.seconds));
+  PutFixed32(out, static_cast<uint32_t>(version.nanos));
+}
+
+void PutRecord(std::string* out, RecordType type, absl::string_view payload) {
+  out->push_back(static_cast<char>(type));
+  PutBytes(out, payload);
+}
+
+absl::string_view ToStringView(const ByteString& bytes) {
+  return absl::string_view(reinterpret_cast<const char*>(bytes.data()),
+                           bytes.size());
+}
+
+/** Reads the fields of records, failing once there aren't enough bytes. */
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(absl::string_view data) : data_(data) {
+  }
+
+  bool empty() const {
+    return data_.empty();
+  }
+
+  bool ok() const {
+    return ok_;
+  }
+
+  uint8_t ReadByte() {
+    absl::string_view bytes = ReadRaw(1);
+    return bytes.empty() ? 0 : static_cast<uint8_t>(bytes[0]);
+  }
+
+  uint32_t ReadFixed32() {
+    absl::string_view bytes = ReadRaw(4);
+    uint32_t result = 0;
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      result |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[i]))
+                << (8 * i);
+    }
+    return result;
+  }
+
+  uint64_t ReadFixed64() {
+    uint64_t low = ReadFixed32();
+    uint64_t high = ReadFixed32();
+    return low | (high << 32);
+  }
+
+  google_protobuf_Timestamp ReadVersion() {
+    google_protobuf_Timestamp result{};
+    result.seconds = static_cast<int64_t>(ReadFixed64());
+    result.nanos = static_cast<int32_t>(ReadFixed32());
+    return result;
+  }
+
+  /** Reads a fixed32 length and that many bytes. */
+  absl::string_view ReadBytes() {
+    return ReadRaw(ReadFixed32());
+  }
+
+  /** Reads all of the remaining bytes. */
+  absl::string_view ReadRest() {
+    return ReadRaw(data_.size());
+  }
+
+  absl::string_view ReadRaw(size_t size) {
+    if (!ok_ || size > data_.size()) {
+      ok_ = false;
+      return {};
+    }
+    absl::string_view result = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return result;
+  }
+
+ private:
+  absl::string_view data_;
+  bool ok_ = true;
+};
+
+struct DecodedQueue {
+  User user;
+  ByteString last_stream_token;
+  std::vector<MutationBatch> batches;
+};
+
+/** The decoded contents of a snapshot, applied once all of it is valid. */
+struct DecodedSnapshot {
+  std::vector<std::pair<MaybeDocument, SnapshotVersion>> documents;
+  std::vector<TargetData> targets;
+  std::vector<std::pair<TargetId, DocumentKeySet>> target_keys;
+  SnapshotVersion last_remote_snapshot_version;
+  std::vector<DecodedQueue> queues;
+};
+
+Status Corrupted(absl::string_view reason) {
+  return Status{Error::kErrorDataLoss,
+                absl::StrCat("Invalid memory persistence snapshot: ", reason)};
+}
+
+}  // namespace
+
+std::string MemorySnapshot::Encode(MemoryPersistence* persistence) const {
+  std::string result(kMagic, sizeof(kMagic));
+  PutFixed32(&result, kFormatVersion);
+
+  std::string payload;
+  persistence->remote_document_cache()->EnumerateEncoded(
+      serializer_,
+      [&](absl::string_view encoded, const SnapshotVersion& read_time) {
+        payload.clear();
+        PutVersion(&payload, serializer_.EncodeVersion(read_time));
+        payload.append(encoded.data(), encoded.size());
+        PutRecord(&result, RecordType::Document, payload);
+      });
+
+  MemoryTargetCache* target_cache = persistence->target_cache();
+  target_cache->EnumerateTargets([&](const TargetData& target_data) {
+    PutRecord(&result, RecordType::Target,
+              MakeStdString(serializer_.EncodeTargetData(target_data)));
+
+    payload.clear();
+    PutFixed32(&payload, static_cast<uint32_t>(target_data.target_id()));
+    for (const DocumentKey& key :
+         target_cache->GetMatchingKeys(target_data.target_id())) {
+      PutBytes(&payload, key.path().CanonicalString());
+    }
+    PutRecord(&result, RecordType::TargetKeys, payload);
+  });
+
+  payload.clear();
+  PutVersion(&payload, serializer_.EncodeVersion(
+                           target_cache->GetLastRemoteSnapshotVersion()));
+  PutRecord(&result, RecordType::LastRemoteSnapshotVersion, payload);
+
+  for (const auto& entry : persistence->mutation_queues()) {
+    const User& user = entry.first;
+    MemoryMutationQueue* queue = entry.second.get();
+
+    payload.clear();
+    payload.push_back(user.is_authenticated() ? 1 : 0);
+    PutBytes(&payload, user.uid());
+    PutBytes(&payload, ToStringView(queue->GetLastStreamToken()));
+    PutRecord(&result, RecordType::MutationQueue, payload);
+
+    for (const MutationBatch& batch : queue->AllMutationBatches()) {
+      PutRecord(&result, RecordType::MutationBatch,
+                MakeStdString(serializer_.EncodeMutationBatch(batch)));
+    }
+  }
+
+  return result;
+}
+
+Status MemorySnapshot::Decode(absl::string_view data,
+                              MemoryPersistence* persistence) const {
+  SnapshotReader input{data};
+  if (input.ReadRaw(sizeof(kMagic)) !=
+      absl::string_view(kMagic, sizeof(kMagic))) {
+    return Corrupted("not a snapshot");
+  }
+  uint32_t format_version = input.ReadFixed32();
+  if (format_version != kFormatVersion) {
+    return Corrupted(
+        absl::StrCat("unsupported format version ", format_version));
+  }
+
+  // Nothing is applied until the whole snapshot has been decoded, so that an
+  // invalid snapshot leaves the persistence empty.
+  DecodedSnapshot snapshot;
+  while (input.ok() && !input.empty()) {
+    auto type = static_cast<RecordType>(input.ReadByte());
+    SnapshotReader record{input.ReadBytes()};
+    if (!input.ok()) break;
+
+    // Collects the errors of decoding the versions of this record.
+    StringReader reader;
+    switch (type) {
+      case RecordType::Document: {
+        SnapshotVersion read_time =
+            serializer_.DecodeVersion(&reader, record.ReadVersion());
+        StringReader document_reader{record.ReadRest()};
+        auto message =
+            Message<firestore_client_MaybeDocument>::TryParse(&document_reader);
+        MaybeDocument document =
+            serializer_.DecodeMaybeDocument(&document_reader, *message);
+        if (!document_reader.ok()) return document_reader.status();
+        snapshot.documents.emplace_back(std::move(document), read_time);
+        break;
+      }
+
+      case RecordType::Target: {
+        StringReader target_reader{record.ReadRest()};
+        auto message =
+            Message<firestore_client_Target>::TryParse(&target_reader);
+        TargetData target_data =
+            serializer_.DecodeTargetData(&target_reader, *message);
+        if (!target_reader.ok()) return target_reader.status();
+        snapshot.targets.push_back(std::move(target_data));
+        break;
+      }
+
+      case RecordType::TargetKeys: {
+        auto target_id = static_cast<TargetId>(record.ReadFixed32());
+        DocumentKeySet keys;
+        while (record.ok() && !record.empty()) {
+          absl::string_view key_path = record.ReadBytes();
+          if (key_path.find("//") != absl::string_view::npos) {
+            return Corrupted("invalid document key");
+          }
+          ResourcePath path = ResourcePath::FromString(std::string(key_path));
+          if (!DocumentKey::IsDocumentKey(path)) {
+            return Corrupted("invalid document key");
+          }
+          keys = keys.insert(DocumentKey(std::move(path)));
+        }
+        snapshot.target_keys.emplace_back(target_id, std::move(keys));
+        break;
+      }
+
+      case RecordType::LastRemoteSnapshotVersion:
+        snapshot.last_remote_snapshot_version =
+            serializer_.DecodeVersion(&reader, record.ReadVersion());
+        break;
+
+      case RecordType::MutationQueue: {
+        bool authenticated = record.ReadByte() != 0;
+        std::string uid(record.ReadBytes());
+        ByteString last_stream_token(record.ReadBytes());
+        if (authenticated && uid.empty()) {
+          return Corrupted("authenticated user without a UID");
+        }
+        snapshot.queues.push_back(
+            DecodedQueue{authenticated ? User(std::move(uid)) : User(),
+                         std::move(last_stream_token),
+                         {}});
+        break;
+      }
+
+      case RecordType::MutationBatch: {
+        if (snapshot.queues.empty()) {
+          return Corrupted("mutation batch outside of a mutation queue");
+        }
+        StringReader batch_reader{record.ReadRest()};
+        auto message =
+            Message<firestore_client_WriteBatch>::TryParse(&batch_reader);
+        MutationBatch batch =
+            serializer_.DecodeMutationBatch(&batch_reader, *message);
+        if (!batch_reader.ok()) return batch_reader.status();
+        snapshot.queues.back().batches.push_back(std::move(batch));
+        break;
+      }
+
+      default:
+        return Corrupted(
+            absl::StrCat("unknown record type ", static_cast<int>(type)));
+    }
+
+    if (!reader.ok()) return reader.status();
+    if (!record.ok()) return Corrupted("truncated record");
+  }
+  if (!input.ok()) return Corrupted("truncated file");
+
+  persistence->Run("Load snapshot", [&] {
+    MemoryRemoteDocumentCache* document_cache =
+        persistence->remote_document_cache();
+    for (const auto& entry : snapshot.documents) {
+      document_cache->Add(entry.first, entry.second);
+    }
+
+    MemoryTargetCache* target_cache = persistence->target_cache();
+    for (const TargetData& target_data : snapshot.targets) {
+      target_cache->AddTarget(target_data);
+    }
+    for (const auto& entry : snapshot.target_keys) {
+      target_cache->AddMatchingKeys(entry.second, entry.first);
+    }
+    target_cache->SetLastRemoteSnapshotVersion(
+        snapshot.last_remote_snapshot_version);
+
+    // The batches are renumbered from the start of the queue, keeping their
+    // order. Nothing else that's restored refers to batch IDs.
+    for (DecodedQueue& decoded : snapshot.queues) {
+      MemoryMutationQueue* queue =
+          persistence->GetMutationQueueForUser(decoded.user);
+      queue->Start();
+      for (const MutationBatch& batch : decoded.batches) {
+        std::vector<Mutation> base_mutations = batch.base_mutations();
+        std::vector<Mutation> mutations = batch.mutations();
+        queue->AddMutationBatch(batch.local_write_time(),
+                                std::move(base_mutations),
+                                std::move(mutations));
+      }
+      queue->SetLastStreamToken(std::move(decoded.last_stream_token));
+    }
+  });
+  return Status::OK();
+}
+
+Status MemorySnapshot::Load(const Path& path,
+                            MemoryPersistence* persistence) const {
+  // Stat the file first so that a missing snapshot is reported as NotFound on
+  // all platforms.
+  Status exists = Filesystem::Default()->FileSize(path).status();
+  if (!exists.ok()) return exists;
+
+  StatusOr<std::unique_ptr<MappedFile>> file = MappedFile::Open(path);
+  if (!file.ok()) return file.status();
+  return Decode(file.ValueOrDie()->data(), persistence);
+}
+
+Status MemorySnapshot::Write(const Path& path, absl::string_view data) {
+  Filesystem* fs = Filesystem::Default();
+  Status status = fs->RecursivelyCreateDir(path.Dirname());
+  if (!status.ok()) return status;
+
+  Path temp_path = Path::FromUtf8(absl::StrCat(path.ToUtf8String(), ".tmp"));
+  status = fs->WriteFile(temp_path, data);
+  if (!status.ok()) return status;
+  return fs->Rename(temp_path, path);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
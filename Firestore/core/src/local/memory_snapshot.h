@@ -0,0 +1,90 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_MEMORY_SNAPSHOT_H_
+#define FIRESTORE_CORE_SRC_LOCAL_MEMORY_SNAPSHOT_H_
+
+#include <string>
+#include <utility>
+
+#include "Firestore/core/src/local/local_serializer.h"
+#include "absl/strings/string_view.h"
+
+namespace firebase {
+namespace firestore {
+
+namespace util {
+class Path;
+class Status;
+}  // namespace util
+
+namespace local {
+
+class MemoryPersistence;
+
+/**
+ * Saves the contents of a `MemoryPersistence` to a single file and restores
+ * them, so that memory persistence can start from the cache of the previous
+ * run instead of downloading everything again.
+ *
+ * A snapshot holds the remote documents with their read times, the targets
+ * with their resume tokens and matching keys, and the mutation queues of all
+ * users. Bundles, overlays and field index configurations aren't saved.
+ */
+class MemorySnapshot {
+ public:
+  explicit MemorySnapshot(LocalSerializer serializer)
+      : serializer_(std::move(serializer)) {
+  }
+
+  /**
+   * Encodes the contents of `persistence`. Must be called on the thread
+   * running its transactions, outside of any transaction.
+   */
+  std::string Encode(MemoryPersistence* persistence) const;
+
+  /**
+   * Restores the contents encoded in `data` into `persistence`, which must be
+   * empty. If `data` is not a valid snapshot, returns an error and leaves
+   * `persistence` unchanged.
+   */
+  util::Status Decode(absl::string_view data,
+                      MemoryPersistence* persistence) const;
+
+  /**
+   * Maps the snapshot file at `path` and restores it into `persistence` like
+   * `Decode()`. Returns a NotFound error if there is no snapshot.
+   */
+  util::Status Load(const util::Path& path,
+                    MemoryPersistence* persistence) const;
+
+  /**
+   * Replaces the snapshot file at `path` with `data`, creating its directory
+   * if needed. The file is replaced atomically, so a snapshot that's being
+   * loaded is never overwritten and an interrupted write leaves the previous
+   * snapshot in place. Can be called on any thread.
+   */
+  static util::Status Write(const util::Path& path, absl::string_view data);
+
+ private:
+  LocalSerializer serializer_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_MEMORY_SNAPSHOT_H_
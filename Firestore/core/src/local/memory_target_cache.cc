@@ -75,6 +75,13 @@ void MemoryTargetCache::EnumerateSequenceNumbers(
   }
 }
 
+void MemoryTargetCache::EnumerateTargets(
+    const std::function<void(const TargetData&)>& callback) const {
+  for (const auto& kv : targets_) {
+    callback(kv.second);
+  }
+}
+
 size_t MemoryTargetCache::RemoveTargets(
     model::ListenSequenceNumber upper_bound,
     const std::unordered_map<TargetId, TargetData>& live_targets) {
@@ -18,6 +18,7 @@
 #define FIRESTORE_CORE_SRC_LOCAL_MEMORY_TARGET_CACHE_H_
 
 #include <cstdint>
+#include <functional>
 #include <unordered_map>
 #include <utility>
 
@@ -72,6 +73,10 @@ class MemoryTargetCache : public TargetCache {
   // Other methods and accessors
   int64_t CalculateByteSize(const Sizer& sizer);
 
+  /** Calls `callback` with each target in the cache. */
+  void EnumerateTargets(
+      const std::function<void(const TargetData&)>& callback) const;
+
   size_t size() const override {
     return targets_.size();
   }
@@ -76,6 +76,7 @@ class MutationQueue {
    *
    * + Removing applied mutations from the head of the queue
    * + Removing rejected mutations from anywhere in the queue
+   * + Removing the newest batch when a new write is squashed into it
    */
   virtual void RemoveMutationBatch(const model::MutationBatch& batch) = 0;
 
@@ -17,9 +17,13 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_PERSISTENCE_H_
 #define FIRESTORE_CORE_SRC_LOCAL_PERSISTENCE_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstddef>
 #include <functional>
+#include <memory>
 #include <utility>
 
+#include "Firestore/core/src/local/transaction_stats.h"
 #include "Firestore/core/src/model/types.h"
 #include "absl/strings/string_view.h"
 
@@ -34,12 +38,32 @@ class User;
 namespace local {
 
 class BundleCache;
+class DocumentOverlayCache;
 class IndexManager;
 class MutationQueue;
 class ReferenceDelegate;
 class RemoteDocumentCache;
 class TargetCache;
 
+/**
+ * The class of a transaction, which determines how durably its changes are
+ * committed.
+ */
+enum class TransactionClass {
+  /**
+   * Transactions that only update state that can be recovered from the
+   * backend, e.g. cached documents, targets and acknowledgements of writes.
+   * Their commits may be deferred and grouped with later transactions.
+   */
+  Cache,
+
+  /**
+   * Transactions that add new local writes, which are lost for good if they
+   * are lost before they reach the backend.
+   */
+  UserWrite,
+};
+
 /**
  * Persistence is the lowest-level shared interface to data storage in
  * Firestore.
@@ -95,6 +119,16 @@ class Persistence {
    */
   virtual MutationQueue* GetMutationQueueForUser(const auth::User& user) = 0;
 
+  /**
+   * Returns a DocumentOverlayCache holding the local views of the documents
+   * mutated by the given user's pending batches.
+   *
+   * Like the mutation queue, the returned instance must no longer be used once
+   * this is called again for a different user.
+   */
+  virtual DocumentOverlayCache* GetDocumentOverlayCacheForUser(
+      const auth::User& user) = 0;
+
   /** Returns a TargetCache representing the persisted cache of queries. */
   virtual TargetCache* target_cache() = 0;
 
@@ -124,14 +158,16 @@ class Persistence {
    * block has executed.
    *
    * @param label A semi-unique name for the transaction, for logging.
+   * @param transaction_class The class of the transaction, which determines
+   *     how durably it is committed.
    * @param block A void-returning function to be executed within the
    *     transaction.
    */
   template <typename F>
-  auto Run(absl::string_view label, F block) ->
-      typename std::enable_if<std::is_same<void, decltype(block())>::value,
-                              void>::type {
-    RunInternal(label, std::forward<F>(block));
+  auto Run(absl::string_view label, TransactionClass transaction_class, F block)
+      -> typename std::enable_if<std::is_same<void, decltype(block())>::value,
+                                 void>::type {
+    RunInternal(label, transaction_class, std::forward<F>(block));
   }
 
   /**
@@ -140,25 +176,140 @@ class Persistence {
    * block has executed.
    *
    * @param label A semi-unique name for the transaction, for logging.
+   * @param transaction_class The class of the transaction, which determines
+   *     how durably it is committed.
    * @param block A function to be executed within the transaction whose return
    *     value will be the result of the transaction. The type of the return
    *     value must be default constructible and copy- or move-assignable.
    * @return The value returned from the invocation of `block`.
    */
   template <typename F>
-  auto Run(absl::string_view label, F block) ->
+  auto Run(absl::string_view label, TransactionClass transaction_class, F block)
+      -> typename std::enable_if<!std::is_same<void, decltype(block())>::value,
+                                 decltype(block())>::type {
+    decltype(block()) result;
+
+    RunInternal(label, transaction_class,
+                [&]() mutable { result = block(); });
+
+    return result;
+  }
+
+  /**
+   * Runs the given function within a transaction of class
+   * `TransactionClass::Cache`.
+   */
+  template <typename F>
+  auto Run(absl::string_view label, F block) -> decltype(block()) {
+    return Run(label, TransactionClass::Cache, std::forward<F>(block));
+  }
+
+  /**
+   * Accepts a function and runs it within a read-only transaction. The block
+   * sees a consistent snapshot of the persisted state as of the start of the
+   * transaction, and must not make any changes.
+   *
+   * If `supports_concurrent_reads()` is true, read-only transactions may run on
+   * any thread, concurrently with each other and with transactions started by
+   * `Run()`. Otherwise they are subject to the same threading rules as `Run()`.
+   *
+   * @param label A semi-unique name for the transaction, for logging.
+   * @param block A function to be executed within the transaction whose return
+   *     value, if any, will be the result of the transaction.
+   */
+  template <typename F>
+  auto RunReadOnly(absl::string_view label, F block) ->
+      typename std::enable_if<std::is_same<void, decltype(block())>::value,
+                              void>::type {
+    RunReadOnlyInternal(label, std::forward<F>(block));
+  }
+
+  template <typename F>
+  auto RunReadOnly(absl::string_view label, F block) ->
       typename std::enable_if<!std::is_same<void, decltype(block())>::value,
                               decltype(block())>::type {
     decltype(block()) result;
 
-    RunInternal(label, [&]() mutable { result = block(); });
+    RunReadOnlyInternal(label, [&]() mutable { result = block(); });
 
     return result;
   }
 
+  /**
+   * Returns true if read-only transactions may run concurrently with other
+   * transactions, on threads other than the one running `Run()`.
+   */
+  virtual bool supports_concurrent_reads() const {
+    return false;
+  }
+
+  /**
+   * Writes out the changes of transactions whose commits were deferred to be
+   * grouped with later transactions, if any. Read-only transactions only see
+   * changes that have been written out.
+   *
+   * Must be called on the thread running `Run()`, outside of any transaction.
+   */
+  virtual void FlushDeferredCommits() {
+  }
+
+  /**
+   * Discards the in-memory caches of persisted data, which are refilled as the
+   * data is read again, and returns an estimate of the bytes released.
+   *
+   * Must be called on the thread running `Run()`, outside of any transaction.
+   */
+  virtual size_t ReleaseMemory() {
+    return 0;
+  }
+
+  /**
+   * Durations and counters of the transactions run so far, by label. Updated
+   * regardless of the log level; can be read from any thread.
+   */
+  const std::shared_ptr<TransactionStats>& transaction_stats() const {
+    return transaction_stats_;
+  }
+
+  /**
+   * Makes this persistence record its transactions in the given stats rather
+   * than its own, so that they can be read without holding on to it.
+   */
+  void set_transaction_stats(std::shared_ptr<TransactionStats> stats) {
+    transaction_stats_ = std::move(stats);
+  }
+
+ protected:
+  /**
+   * Records a transaction with the given label that started at `start` and
+   * has just finished.
+   */
+  void RecordTransaction(absl::string_view label,
+                         std::chrono::steady_clock::time_point start,
+                         const TransactionCounters& counters = {}) {
+    transaction_stats_->Record(
+        label,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start),
+        counters);
+  }
+
  private:
   virtual void RunInternal(absl::string_view label,
+                           TransactionClass transaction_class,
                            std::function<void()> block) = 0;
+
+  /**
+   * Runs a read-only transaction. By default, read-only transactions are
+   * ordinary transactions that happen not to write anything.
+   */
+  virtual void RunReadOnlyInternal(absl::string_view label,
+                                   std::function<void()> block) {
+    RunInternal(label, TransactionClass::Cache, std::move(block));
+  }
+
+  std::shared_ptr<TransactionStats> transaction_stats_ =
+      std::make_shared<TransactionStats>();
 };
 
 }  // namespace local
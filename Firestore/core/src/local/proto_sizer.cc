@@ -21,7 +21,6 @@
 #include "Firestore/Protos/nanopb/firestore/local/maybe_document.nanopb.h"
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/maybe_document.h"
-#include "Firestore/core/src/nanopb/byte_string.h"
 #include "Firestore/core/src/nanopb/message.h"
 
 namespace firebase {
@@ -30,27 +29,22 @@ namespace local {
 
 using model::DocumentKey;
 using model::MaybeDocument;
-using nanopb::ByteString;
-using nanopb::Message;
+using nanopb::EncodedSize;
 
 ProtoSizer::ProtoSizer(LocalSerializer serializer)
     : serializer_(std::move(serializer)) {
 }
 
 int64_t ProtoSizer::CalculateByteSize(const MaybeDocument& maybe_doc) const {
-  // TODO(varconst): implement a version of `nanopb::Writer` that only
-  // calculates sizes without actually doing the encoding (to the extent
-  // possible). This isn't high priority as long as `ProtoSizer` is only used in
-  // tests.
-  return MakeByteString(serializer_.EncodeMaybeDocument(maybe_doc)).size();
+  return EncodedSize(serializer_.EncodeMaybeDocument(maybe_doc));
 }
 
 int64_t ProtoSizer::CalculateByteSize(const model::MutationBatch& batch) const {
-  return MakeByteString(serializer_.EncodeMutationBatch(batch)).size();
+  return EncodedSize(serializer_.EncodeMutationBatch(batch));
 }
 
 int64_t ProtoSizer::CalculateByteSize(const TargetData& target_data) const {
-  return MakeByteString(serializer_.EncodeTargetData(target_data)).size();
+  return EncodedSize(serializer_.EncodeTargetData(target_data));
 }
 
 }  // namespace local
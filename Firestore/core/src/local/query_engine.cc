@@ -19,9 +19,13 @@
 #include <utility>
 
 #include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/core/query_matcher.h"
 #include "Firestore/core/src/core/target.h"
+#include "Firestore/core/src/local/index_manager.h"
 #include "Firestore/core/src/local/local_documents_view.h"
 #include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/document_map.h"
 #include "Firestore/core/src/model/document_set.h"
 #include "Firestore/core/src/model/maybe_document.h"
 #include "Firestore/core/src/model/snapshot_version.h"
@@ -52,13 +56,28 @@ DocumentMap QueryEngine::GetDocumentsMatchingQuery(
   // lookups. It is more efficient to scan all documents in a collection, rather
   // than to perform individual lookups.
   if (query.MatchesAllDocuments()) {
-    return ExecuteFullCollectionScan(query);
+    return ExecuteFullCollectionScan(
+        query, absl::nullopt,
+        planner_.PlanCollectionScan(query, absl::nullopt));
   }
 
+  // The index only yields keys, which is cheap compared to reading documents.
+  absl::optional<DocumentKeySet> index_candidates =
+      local_documents_view_->index_manager()->GetDocumentsMatchingQuery(query);
+  QueryPlan collection_scan_plan =
+      planner_.PlanCollectionScan(query, index_candidates);
+
   // Queries that have never seen a snapshot without limbo free documents should
   // also be run as a full collection scan.
   if (last_limbo_free_snapshot_version == SnapshotVersion::None()) {
-    return ExecuteFullCollectionScan(query);
+    return ExecuteFullCollectionScan(query, index_candidates,
+                                     std::move(collection_scan_plan));
+  }
+
+  QueryPlan index_free_plan = planner_.PlanIndexFree(query, remote_keys);
+  if (collection_scan_plan.estimated_cost < index_free_plan.estimated_cost) {
+    return ExecuteFullCollectionScan(query, index_candidates,
+                                     std::move(collection_scan_plan));
   }
 
   MaybeDocumentMap documents = local_documents_view_->GetDocuments(remote_keys);
@@ -67,7 +86,8 @@ DocumentMap QueryEngine::GetDocumentsMatchingQuery(
   if (query.limit_type() != LimitType::None &&
       NeedsRefill(query.limit_type(), previous_results, remote_keys,
                   last_limbo_free_snapshot_version)) {
-    return ExecuteFullCollectionScan(query);
+    return ExecuteFullCollectionScan(query, index_candidates,
+                                     std::move(collection_scan_plan));
   }
 
   LOG_DEBUG("Re-using previous result from %s to execute query: %s",
@@ -78,6 +98,8 @@ DocumentMap QueryEngine::GetDocumentsMatchingQuery(
   DocumentMap updated_results =
       local_documents_view_->GetDocumentsMatchingQuery(
           query, last_limbo_free_snapshot_version);
+  index_free_plan.actual_documents_read =
+      static_cast<int64_t>(documents.size() + updated_results.size());
 
   // We merge `previous_results` into `update_results`, since `update_results`
   // is already a DocumentMap. If a document is contained in both lists, then
@@ -86,6 +108,9 @@ DocumentMap QueryEngine::GetDocumentsMatchingQuery(
     updated_results = updated_results.insert(result.key(), result);
   }
 
+  last_query_plan_ = std::move(index_free_plan);
+  LOG_DEBUG("Executed query %s with %s", query.ToString(),
+            last_query_plan_.ToString());
   return updated_results;
 }
 
@@ -94,12 +119,13 @@ DocumentSet QueryEngine::ApplyQuery(const Query& query,
   // Sort the documents and re-apply the query filter since previously matching
   // documents do not necessarily still match the query.
   DocumentSet query_results(query.Comparator());
+  core::QueryMatcher matcher(query);
 
   for (const auto& document_entry : documents) {
     const MaybeDocument& maybe_doc = document_entry.second;
     if (maybe_doc.is_document()) {
       Document doc(maybe_doc);
-      if (query.Matches(doc)) {
+      if (matcher.Matches(doc)) {
         query_results = query_results.insert(std::move(doc));
       }
     }
@@ -138,11 +164,27 @@ bool QueryEngine::NeedsRefill(
          document_at_limit_edge->version() > limbo_free_snapshot_version;
 }
 
-DocumentMap QueryEngine::ExecuteFullCollectionScan(const Query& query) {
+DocumentMap QueryEngine::ExecuteFullCollectionScan(
+    const Query& query,
+    const absl::optional<DocumentKeySet>& index_candidates,
+    QueryPlan plan) {
   LOG_DEBUG("Using full collection scan to execute query: %s",
             query.ToString());
-  return local_documents_view_->GetDocumentsMatchingQuery(
-      query, SnapshotVersion::None());
+  DocumentMap results =
+      index_candidates
+          ? local_documents_view_->GetDocumentsMatchingCandidates(
+                query, *index_candidates)
+          : local_documents_view_->GetDocumentsMatchingQuery(
+                query, SnapshotVersion::None());
+  planner_.RecordCollectionScan(query, results);
+
+  // The remote document cache filters out documents that don't exist, so the
+  // result size is a lower bound of the documents read.
+  plan.actual_documents_read = static_cast<int64_t>(results.size());
+  last_query_plan_ = std::move(plan);
+  LOG_DEBUG("Executed query %s with %s", query.ToString(),
+            last_query_plan_.ToString());
+  return results;
 }
 
 }  // namespace local
@@ -17,7 +17,9 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_QUERY_ENGINE_H_
 #define FIRESTORE_CORE_SRC_LOCAL_QUERY_ENGINE_H_
 
+#include "Firestore/core/src/local/query_planner.h"
 #include "Firestore/core/src/model/model_fwd.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
@@ -46,6 +48,11 @@ class LocalDocumentsView;
  * - Limit queries where a document edit may cause the document to sort below
  *   another document that is in the local cache.
  * - Queries that have never been CURRENT or free of limbo documents.
+ *
+ * When index-free execution is possible, a QueryPlanner compares its cost to
+ * the cost of scanning the collection (or the field index that serves the
+ * query) and the cheaper plan is used. The plan of the last executed query is
+ * available through `last_query_plan()`.
  */
 class QueryEngine {
  public:
@@ -67,6 +74,29 @@ class QueryEngine {
       const model::SnapshotVersion& last_limbo_free_snapshot_version,
       const model::DocumentKeySet& remote_keys);
 
+  /**
+   * Sets the Sizer the planner uses to estimate document sizes.
+   *
+   * The caller owns the Sizer and must ensure that it outlives the
+   * QueryEngine.
+   */
+  void SetSizer(const Sizer* sizer) {
+    planner_.SetSizer(sizer);
+  }
+
+  /**
+   * Returns the plan used by the most recent call to
+   * `GetDocumentsMatchingQuery()`, including the number of documents it read.
+   * Intended for debugging and tuning.
+   */
+  const QueryPlan& last_query_plan() const {
+    return last_query_plan_;
+  }
+
+  const QueryPlanner& planner() const {
+    return planner_;
+  }
+
  private:
   /** Applies the query filter and sorting to the provided documents. */
   model::DocumentSet ApplyQuery(const core::Query& query,
@@ -90,9 +120,20 @@ class QueryEngine {
       const model::DocumentKeySet& remote_keys,
       const model::SnapshotVersion& limbo_free_snapshot_version) const;
 
-  model::DocumentMap ExecuteFullCollectionScan(const core::Query& query);
+  /**
+   * Executes a full collection scan, which reads only the given
+   * `index_candidates` instead of the whole collection if a field index can
+   * serve the query.
+   */
+  model::DocumentMap ExecuteFullCollectionScan(
+      const core::Query& query,
+      const absl::optional<model::DocumentKeySet>& index_candidates,
+      QueryPlan plan);
 
   LocalDocumentsView* local_documents_view_ = nullptr;
+
+  QueryPlanner planner_;
+  QueryPlan last_query_plan_;
 };
 
 }  // namespace local
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/query_planner.h"
+
+#include <limits>
+#include <ostream>
+
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/local/sizer.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/document_map.h"
+#include "Firestore/core/src/model/maybe_document.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "absl/strings/str_cat.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using core::Query;
+using model::DocumentKeySet;
+using model::DocumentMap;
+using model::ResourcePath;
+
+/**
+ * The relative cost of reading one document as part of a sequential scan over
+ * a collection.
+ */
+constexpr double kScanCostPerDocument = 1.0;
+
+/**
+ * The relative cost of reading one document by key. Point lookups have to
+ * seek, which costs more than advancing an iterator.
+ */
+constexpr double kLookupCostPerDocument = 2.0;
+
+/** The relative cost of decoding one byte of a document. */
+constexpr double kCostPerByte = 1.0 / 512;
+
+/**
+ * The number of documents per collection scan passed to the Sizer. Sizing
+ * requires re-encoding the document, so only a sample is sized.
+ */
+constexpr size_t kSizeSampleCount = 10;
+
+constexpr double kUnknownCost = std::numeric_limits<double>::infinity();
+
+const char* ToString(QueryStrategy strategy) {
+  switch (strategy) {
+    case QueryStrategy::FullCollectionScan:
+      return "FullCollectionScan";
+    case QueryStrategy::IndexFree:
+      return "IndexFree";
+    case QueryStrategy::IndexScan:
+      return "IndexScan";
+  }
+  UNREACHABLE();
+}
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os, QueryStrategy strategy) {
+  return os << ToString(strategy);
+}
+
+std::string QueryPlan::ToString() const {
+  return absl::StrCat("QueryPlan(strategy=", local::ToString(strategy),
+                      ", estimated_documents_read=", estimated_documents_read,
+                      ", estimated_cost=", estimated_cost,
+                      ", actual_documents_read=", actual_documents_read, ")");
+}
+
+std::ostream& operator<<(std::ostream& os, const QueryPlan& plan) {
+  return os << plan.ToString();
+}
+
+QueryPlan QueryPlanner::PlanCollectionScan(
+    const Query& query,
+    const absl::optional<DocumentKeySet>& index_candidates) const {
+  QueryPlan plan;
+  if (index_candidates) {
+    // Index candidates are read with point lookups.
+    plan.strategy = QueryStrategy::IndexScan;
+    plan.estimated_documents_read =
+        static_cast<int64_t>(index_candidates->size());
+    plan.estimated_cost = plan.estimated_documents_read *
+                          CostPerDocument(query, kLookupCostPerDocument);
+    return plan;
+  }
+
+  plan.strategy = QueryStrategy::FullCollectionScan;
+  absl::optional<CollectionStats> stats = GetCollectionStats(query.path());
+  if (stats && !query.IsCollectionGroupQuery()) {
+    plan.estimated_documents_read = stats->document_count;
+    plan.estimated_cost = plan.estimated_documents_read *
+                          CostPerDocument(query, kScanCostPerDocument);
+  } else {
+    plan.estimated_cost = kUnknownCost;
+  }
+  return plan;
+}
+
+QueryPlan QueryPlanner::PlanIndexFree(const Query& query,
+                                      const DocumentKeySet& remote_keys) const {
+  // Documents that changed since the last limbo-free snapshot are read too,
+  // but there is no cheap way to count them. They are usually few.
+  QueryPlan plan;
+  plan.strategy = QueryStrategy::IndexFree;
+  plan.estimated_documents_read = static_cast<int64_t>(remote_keys.size());
+  plan.estimated_cost = plan.estimated_documents_read *
+                        CostPerDocument(query, kLookupCostPerDocument);
+  return plan;
+}
+
+void QueryPlanner::RecordCollectionScan(const Query& query,
+                                        const DocumentMap& results) {
+  if (!query.MatchesAllDocuments() || query.IsCollectionGroupQuery() ||
+      query.IsDocumentQuery()) {
+    return;
+  }
+
+  CollectionStats& stats = collection_stats_[query.path().CanonicalString()];
+  stats.document_count = static_cast<int64_t>(results.size());
+
+  if (sizer_ && !results.empty()) {
+    int64_t total_size = 0;
+    size_t sampled = 0;
+    for (const auto& kv : results.underlying_map()) {
+      if (sampled == kSizeSampleCount) break;
+      total_size += sizer_->CalculateByteSize(kv.second);
+      ++sampled;
+    }
+    stats.average_document_size = total_size / static_cast<int64_t>(sampled);
+  }
+}
+
+absl::optional<QueryPlanner::CollectionStats> QueryPlanner::GetCollectionStats(
+    const ResourcePath& collection_path) const {
+  auto found = collection_stats_.find(collection_path.CanonicalString());
+  if (found == collection_stats_.end()) {
+    return absl::nullopt;
+  }
+  return found->second;
+}
+
+double QueryPlanner::CostPerDocument(const Query& query,
+                                     double per_document_overhead) const {
+  absl::optional<CollectionStats> stats = GetCollectionStats(query.path());
+  int64_t document_size = stats ? stats->average_document_size : 0;
+  return per_document_overhead + document_size * kCostPerByte;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_QUERY_PLANNER_H_
+#define FIRESTORE_CORE_SRC_LOCAL_QUERY_PLANNER_H_
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+
+#include "Firestore/core/src/model/model_fwd.h"
+#include "Firestore/core/src/model/resource_path.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+
+namespace core {
+class Query;
+}  // namespace core
+
+namespace local {
+
+class Sizer;
+
+/** The ways in which QueryEngine can read the documents for a query. */
+enum class QueryStrategy {
+  /** Reads every cached document in the queried collection. */
+  FullCollectionScan,
+
+  /**
+   * Reads the documents that matched the query at its last limbo-free
+   * snapshot, plus the documents that changed since.
+   */
+  IndexFree,
+
+  /** Reads the candidate documents found in a field index. */
+  IndexScan,
+};
+
+std::ostream& operator<<(std::ostream& os, QueryStrategy strategy);
+
+/** Describes how a query was (or would be) executed. */
+struct QueryPlan {
+  QueryStrategy strategy = QueryStrategy::FullCollectionScan;
+
+  /**
+   * The number of documents the strategy is expected to read, or -1 if there
+   * are no statistics to base an estimate on.
+   */
+  int64_t estimated_documents_read = -1;
+
+  /**
+   * The relative cost of the plan. Only comparable to the cost of other plans
+   * for the same query. Unknown costs are infinite.
+   */
+  double estimated_cost = 0;
+
+  /**
+   * The number of documents the plan produced once executed, or -1 if the
+   * plan has not been executed.
+   */
+  int64_t actual_documents_read = -1;
+
+  std::string ToString() const;
+
+  friend std::ostream& operator<<(std::ostream& os, const QueryPlan& plan);
+};
+
+/**
+ * Estimates the cost of the strategies available to QueryEngine, based on
+ * statistics gathered from previously executed queries.
+ *
+ * The planner only ever sees the results QueryEngine sees, so the document
+ * count of a collection is only learned from queries that match all of its
+ * documents. Until then, collection scans have an unknown (infinite) cost and
+ * index-free execution is preferred whenever it is allowed.
+ */
+class QueryPlanner {
+ public:
+  /** Statistics about the cached documents in a single collection. */
+  struct CollectionStats {
+    int64_t document_count = 0;
+
+    /** The average size of a document in bytes, or 0 if unknown. */
+    int64_t average_document_size = 0;
+  };
+
+  /**
+   * Sets the Sizer used to estimate document sizes. Without one, plans are
+   * costed by document count alone.
+   *
+   * The caller owns the Sizer and must ensure that it outlives the planner.
+   */
+  void SetSizer(const Sizer* sizer) {
+    sizer_ = sizer;
+  }
+
+  /**
+   * Returns the plan for executing `query` by scanning its collection. If a
+   * field index can serve the query, `index_candidates` holds the keys the
+   * index narrows the scan down to.
+   */
+  QueryPlan PlanCollectionScan(
+      const core::Query& query,
+      const absl::optional<model::DocumentKeySet>& index_candidates) const;
+
+  /**
+   * Returns the plan for executing `query` from the keys that matched at its
+   * last limbo-free snapshot.
+   */
+  QueryPlan PlanIndexFree(const core::Query& query,
+                          const model::DocumentKeySet& remote_keys) const;
+
+  /**
+   * Updates the statistics of the queried collection from the results of a
+   * collection scan. Only queries that match all documents are recorded.
+   */
+  void RecordCollectionScan(const core::Query& query,
+                            const model::DocumentMap& results);
+
+  /** Returns the statistics for the given collection, if any. */
+  absl::optional<CollectionStats> GetCollectionStats(
+      const model::ResourcePath& collection_path) const;
+
+ private:
+  /** Returns the cost of reading one document of the queried collection. */
+  double CostPerDocument(const core::Query& query,
+                         double per_document_overhead) const;
+
+  const Sizer* sizer_ = nullptr;
+
+  /** Collection statistics keyed by canonical collection path. */
+  std::unordered_map<std::string, CollectionStats> collection_stats_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_QUERY_PLANNER_H_
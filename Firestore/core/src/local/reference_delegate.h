@@ -83,6 +83,14 @@ class ReferenceDelegate {
    */
   virtual void UpdateLimboDocument(const model::DocumentKey& key) = 0;
 
+  /**
+   * Notifies the delegate that the user read the given document from the
+   * cache. Unlike the other notifications, this may be called from any thread
+   * and outside of a transaction.
+   */
+  virtual void RecordDocumentAccess(const model::DocumentKey&) {
+  }
+
   /**
    * Lifecycle hook that notifies the delegate that a transaction has started.
    */
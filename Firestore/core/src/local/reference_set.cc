@@ -16,9 +16,11 @@
 
 #include "Firestore/core/src/local/reference_set.h"
 
-#include "Firestore/core/src/immutable/sorted_set.h"
-#include "Firestore/core/src/local/document_key_reference.h"
+#include <algorithm>
+#include <vector>
+
 #include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/document_key_set.h"
 
 namespace firebase {
 namespace firestore {
@@ -28,73 +30,94 @@ using model::DocumentKey;
 using model::DocumentKeySet;
 
 void ReferenceSet::AddReference(const DocumentKey& key, int id) {
-  DocumentKeyReference reference{key, id};
-  by_key_ = by_key_.insert(reference);
-  by_id_ = by_id_.insert(reference);
+  if (keys_by_id_[id].insert(key).second) {
+    ++id_counts_by_key_[key];
+    ++size_;
+  }
 }
 
 void ReferenceSet::AddReferences(const DocumentKeySet& keys, int id) {
+  KeySet& id_keys = keys_by_id_[id];
+  id_keys.reserve(id_keys.size() + keys.size());
   for (const DocumentKey& key : keys) {
-    AddReference(key, id);
+    if (id_keys.insert(key).second) {
+      ++id_counts_by_key_[key];
+      ++size_;
+    }
   }
 }
 
 void ReferenceSet::RemoveReference(const DocumentKey& key, int id) {
-  RemoveReference(DocumentKeyReference{key, id});
+  auto found = keys_by_id_.find(id);
+  if (found == keys_by_id_.end() || found->second.erase(key) == 0) return;
+
+  if (found->second.empty()) {
+    keys_by_id_.erase(found);
+  }
+  ReleaseKey(key);
 }
 
-void ReferenceSet::RemoveReferences(
-    const firebase::firestore::model::DocumentKeySet& keys, int id) {
+void ReferenceSet::RemoveReferences(const DocumentKeySet& keys, int id) {
+  auto found = keys_by_id_.find(id);
+  if (found == keys_by_id_.end()) return;
+
+  KeySet& id_keys = found->second;
   for (const DocumentKey& key : keys) {
-    RemoveReference(key, id);
+    if (id_keys.erase(key) != 0) {
+      ReleaseKey(key);
+    }
+  }
+  if (id_keys.empty()) {
+    keys_by_id_.erase(found);
   }
 }
 
 DocumentKeySet ReferenceSet::RemoveReferences(int id) {
-  DocumentKeyReference start{DocumentKey::Empty(), id};
-  DocumentKeyReference end{DocumentKey::Empty(), id + 1};
-
-  DocumentKeySet removed{};
+  auto found = keys_by_id_.find(id);
+  if (found == keys_by_id_.end()) return DocumentKeySet{};
 
-  auto initial = by_id_;
-  for (const auto& reference : initial.values_in(start, end)) {
-    RemoveReference(reference);
-    removed = removed.insert(reference.key());
+  KeySet id_keys = std::move(found->second);
+  keys_by_id_.erase(found);
+  for (const DocumentKey& key : id_keys) {
+    ReleaseKey(key);
   }
-  return removed;
+  return ToSortedSet(id_keys);
 }
 
 void ReferenceSet::RemoveAllReferences() {
-  auto initial = by_key_;
-  for (const DocumentKeyReference& reference : initial) {
-    RemoveReference(reference);
-  }
+  keys_by_id_.clear();
+  id_counts_by_key_.clear();
+  size_ = 0;
 }
 
-void ReferenceSet::RemoveReference(const DocumentKeyReference& reference) {
-  by_key_ = by_key_.erase(reference);
-  by_id_ = by_id_.erase(reference);
+DocumentKeySet ReferenceSet::ReferencedKeys(int id) {
+  auto found = keys_by_id_.find(id);
+  if (found == keys_by_id_.end()) return DocumentKeySet{};
+  return ToSortedSet(found->second);
 }
 
-DocumentKeySet ReferenceSet::ReferencedKeys(int id) {
-  DocumentKeyReference start{DocumentKey::Empty(), id};
-  DocumentKeyReference end{DocumentKey::Empty(), id + 1};
+bool ReferenceSet::ContainsKey(const DocumentKey& key) {
+  return id_counts_by_key_.find(key) != id_counts_by_key_.end();
+}
 
-  DocumentKeySet keys;
-  for (const auto& reference : by_id_.values_in(start, end)) {
-    keys = keys.insert(reference.key());
+void ReferenceSet::ReleaseKey(const DocumentKey& key) {
+  auto found = id_counts_by_key_.find(key);
+  if (--found->second == 0) {
+    id_counts_by_key_.erase(found);
   }
-  return keys;
+  --size_;
 }
 
-bool ReferenceSet::ContainsKey(const DocumentKey& key) {
-  // Create a reference with a zero ID as the start position to find any
-  // document reference with this key.
-  DocumentKeyReference start{key, 0};
+DocumentKeySet ReferenceSet::ToSortedSet(const KeySet& keys) {
+  // Inserting in order keeps each insertion at the right edge of the tree.
+  std::vector<DocumentKey> sorted(keys.begin(), keys.end());
+  std::sort(sorted.begin(), sorted.end());
 
-  auto range = by_key_.values_from(start);
-  auto begin = range.begin();
-  return begin != range.end() && begin->key() == key;
+  DocumentKeySet result;
+  for (const DocumentKey& key : sorted) {
+    result = result.insert(key);
+  }
+  return result;
 }
 
 }  // namespace local
@@ -17,9 +17,12 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_REFERENCE_SET_H_
 #define FIRESTORE_CORE_SRC_LOCAL_REFERENCE_SET_H_
 
-#include "Firestore/core/src/immutable/sorted_set.h"
-#include "Firestore/core/src/local/document_key_reference.h"
-#include "Firestore/core/src/model/model_fwd.h"
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/document_key_set.h"
 
 namespace firebase {
 namespace firestore {
@@ -30,25 +33,21 @@ namespace local {
  * (either a TargetId or BatchId). As references are added to or removed from
  * the set corresponding events are emitted to a registered garbage collector.
  *
- * Each reference is represented by a DocumentKeyReference object. Each of them
- * contains enough information to uniquely identify the reference. They are all
- * stored primarily in a set sorted by key. A document is considered garbage if
- * there's no references in that set (this can be efficiently checked thanks to
- * sorting by key).
- *
- * ReferenceSet also keeps a secondary set that contains references sorted by
- * Id. This one is used to efficiently implement removal of all references by
- * some TargetId.
+ * The references are stored in hash tables rather than sorted immutable sets,
+ * since listeners add and remove thousands of references at a time. The keys
+ * referenced by each Id are kept per Id, which makes removing all references
+ * by some TargetId cheap, and each key keeps a count of the Ids referencing
+ * it. A document is considered garbage if no Id references it.
  */
 class ReferenceSet {
  public:
   /** Returns true if the reference set contains no references. */
   bool empty() const {
-    return by_key_.empty();
+    return size_ == 0;
   }
 
   size_t size() const {
-    return by_key_.size();
+    return size_;
   }
 
   /** Adds a reference to the given document key for the given Id. */
@@ -80,11 +79,19 @@ class ReferenceSet {
   bool ContainsKey(const model::DocumentKey& key);
 
  private:
-  void RemoveReference(const DocumentKeyReference& reference);
+  using KeySet =
+      std::unordered_set<model::DocumentKey, model::DocumentKeyHash>;
+
+  /** Decrements the count of Ids referencing `key`. */
+  void ReleaseKey(const model::DocumentKey& key);
+
+  /** Returns the given keys as a sorted set. */
+  static model::DocumentKeySet ToSortedSet(const KeySet& keys);
 
-  immutable::SortedSet<DocumentKeyReference, DocumentKeyReference::ByKey>
-      by_key_;
-  immutable::SortedSet<DocumentKeyReference, DocumentKeyReference::ById> by_id_;
+  std::unordered_map<int, KeySet> keys_by_id_;
+  std::unordered_map<model::DocumentKey, int, model::DocumentKeyHash>
+      id_counts_by_key_;
+  size_t size_ = 0;
 };
 
 }  // namespace local
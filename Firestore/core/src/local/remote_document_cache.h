@@ -17,6 +17,10 @@
 #ifndef FIRESTORE_CORE_SRC_LOCAL_REMOTE_DOCUMENT_CACHE_H_
 #define FIRESTORE_CORE_SRC_LOCAL_REMOTE_DOCUMENT_CACHE_H_
 
+#include <functional>
+#include <utility>
+#include <vector>
+
 #include "Firestore/core/src/model/model_fwd.h"
 
 namespace firebase {
@@ -28,6 +32,16 @@ class Query;
 
 namespace local {
 
+/**
+ * A callback for RemoteDocumentCache::EnumerateMatching. Returning false stops
+ * the enumeration.
+ */
+using DocumentVisitor = std::function<bool(const model::Document&)>;
+
+/** A document to add to the cache, paired with its read time. */
+using DocumentReadTime =
+    std::pair<model::MaybeDocument, model::SnapshotVersion>;
+
 /**
  * Represents cached documents received from the remote backend.
  *
@@ -52,6 +66,16 @@ class RemoteDocumentCache {
   virtual void Add(const model::MaybeDocument& document,
                    const model::SnapshotVersion& read_time) = 0;
 
+  /**
+   * Adds or replaces several entries in the cache, as if by calling `Add()`
+   * for each of them in order. Implementations may prepare the entries, e.g.
+   * encode them, in parallel.
+   *
+   * @param documents Documents to put in the cache, each paired with the time
+   *     at which it was read. Keys must be distinct.
+   */
+  virtual void AddAll(const std::vector<DocumentReadTime>& documents) = 0;
+
   /** Removes the cached entry for the given key (no-op if no entry exists). */
   virtual void Remove(const model::DocumentKey& key) = 0;
 
@@ -91,6 +115,58 @@ class RemoteDocumentCache {
   virtual model::DocumentMap GetMatching(
       const core::Query& query,
       const model::SnapshotVersion& since_read_time) = 0;
+
+  /**
+   * Executes a collection group query against the cached Document entries in
+   * the given collections, each of which is the query's collection group under
+   * one of its parents.
+   *
+   * This lets implementations read all the collections at once rather than
+   * one by one. As with `GetMatching`, extra documents may be returned,
+   * including documents of the collection group outside `collection_paths`,
+   * and must be re-filtered by the consumer.
+   *
+   * @param query The collection group query to match documents against.
+   * @param collection_paths The collections to read.
+   * @param since_read_time If not set to SnapshotVersion::None(), return only
+   * documents that have been read since this snapshot version (exclusive).
+   */
+  virtual model::DocumentMap GetMatchingInCollections(
+      const core::Query& query,
+      const std::vector<model::ResourcePath>& collection_paths,
+      const model::SnapshotVersion& since_read_time) = 0;
+
+  /**
+   * Executes a collection query against the cached Document entries with the
+   * given keys instead of looking up the candidates again, which must include
+   * every document covered by a field index that may match the query, e.g. the
+   * keys `IndexManager::GetDocumentsMatchingQuery` returned for it.
+   *
+   * Documents that field indexes don't cover are matched as by `GetMatching`.
+   * As with `GetMatching`, extra documents may be returned, and must be
+   * re-filtered by the consumer.
+   *
+   * @param query The collection query to match documents against.
+   * @param candidate_keys The keys of the candidates for the query.
+   */
+  virtual model::DocumentMap GetMatchingCandidates(
+      const core::Query& query,
+      const model::DocumentKeySet& candidate_keys) = 0;
+
+  /**
+   * Visits the cached Document entries that may match the query in key order,
+   * one at a time, until `visitor` returns false.
+   *
+   * Unlike `GetMatching`, this lets callers that only need the first few
+   * matches in key order (e.g. limit queries) stop reading early instead of
+   * materializing every matching document. As with `GetMatching`, extra
+   * documents may be visited and must be re-filtered by the consumer.
+   *
+   * @param query The collection query to match documents against.
+   * @param visitor Called once for each visited document.
+   */
+  virtual void EnumerateMatching(const core::Query& query,
+                                 const DocumentVisitor& visitor) = 0;
 };
 
 }  // namespace local
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/sequence_number_histogram.h"
+
+#include <algorithm>
+
+#include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/ordered_code.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::ListenSequenceNumber;
+using util::OrderedCode;
+
+SequenceNumberHistogram::SequenceNumberHistogram(
+    ListenSequenceNumber bucket_width)
+    : bucket_width_(std::max<ListenSequenceNumber>(bucket_width, 1)) {
+}
+
+SequenceNumberHistogram SequenceNumberHistogram::ForRange(
+    ListenSequenceNumber max_value, int max_buckets) {
+  HARD_ASSERT(max_buckets > 0, "A histogram needs buckets");
+  return SequenceNumberHistogram(max_value / max_buckets + 1);
+}
+
+void SequenceNumberHistogram::Add(ListenSequenceNumber sequence_number) {
+  ++buckets_[sequence_number / bucket_width_];
+  ++count_;
+}
+
+ListenSequenceNumber SequenceNumberHistogram::EstimateNth(int64_t n) const {
+  HARD_ASSERT(n >= 1 && n <= count_, "%s is out of range for %s entries", n,
+              count_);
+
+  int64_t counted = 0;
+  for (const auto& bucket : buckets_) {
+    if (counted + bucket.second < n) {
+      counted += bucket.second;
+      continue;
+    }
+
+    // Where in the bucket its sequence numbers lie isn't known, so only the
+    // whole bucket can safely be included.
+    ListenSequenceNumber lower_bound = bucket.first * bucket_width_;
+    if (counted + bucket.second == n) {
+      return lower_bound + bucket_width_ - 1;
+    }
+    return lower_bound - 1;
+  }
+
+  HARD_FAIL("Failed to find the %sth entry of %s", n, count_);
+}
+
+std::string SequenceNumberHistogram::Encode() const {
+  std::string encoded;
+  OrderedCode::WriteSignedNumIncreasing(&encoded, bucket_width_);
+  for (const auto& bucket : buckets_) {
+    OrderedCode::WriteSignedNumIncreasing(&encoded, bucket.first);
+    OrderedCode::WriteSignedNumIncreasing(&encoded, bucket.second);
+  }
+  return encoded;
+}
+
+absl::optional<SequenceNumberHistogram> SequenceNumberHistogram::Decode(
+    absl::string_view encoded) {
+  int64_t bucket_width = 0;
+  if (!OrderedCode::ReadSignedNumIncreasing(&encoded, &bucket_width) ||
+      bucket_width < 1) {
+    return absl::nullopt;
+  }
+
+  SequenceNumberHistogram result(bucket_width);
+  while (!encoded.empty()) {
+    int64_t index = 0;
+    int64_t count = 0;
+    if (!OrderedCode::ReadSignedNumIncreasing(&encoded, &index) ||
+        !OrderedCode::ReadSignedNumIncreasing(&encoded, &count) ||
+        count < 1) {
+      return absl::nullopt;
+    }
+    result.buckets_[index] += count;
+    result.count_ += count;
+  }
+  return result;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_SEQUENCE_NUMBER_HISTOGRAM_H_
+#define FIRESTORE_CORE_SRC_LOCAL_SEQUENCE_NUMBER_HISTOGRAM_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "Firestore/core/src/model/types.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/**
+ * An approximate distribution of sequence numbers: the number of sequence
+ * numbers that fall into each of a series of equally wide buckets.
+ *
+ * The LRU garbage collector uses it to estimate the nth smallest sequence
+ * number without enumerating all of them.
+ */
+class SequenceNumberHistogram {
+ public:
+  explicit SequenceNumberHistogram(model::ListenSequenceNumber bucket_width);
+
+  /**
+   * Creates a histogram with a bucket width that keeps the number of buckets
+   * down to about `max_buckets` for sequence numbers up to `max_value`.
+   */
+  static SequenceNumberHistogram ForRange(model::ListenSequenceNumber max_value,
+                                          int max_buckets);
+
+  void Add(model::ListenSequenceNumber sequence_number);
+
+  /** The number of sequence numbers added. */
+  int64_t count() const {
+    return count_;
+  }
+
+  /**
+   * Estimates the nth smallest sequence number added, for 1 <= n <= count().
+   * The estimate errs on the low side, by up to a bucket width: no more than n
+   * of the sequence numbers added are less than or equal to it.
+   */
+  model::ListenSequenceNumber EstimateNth(int64_t n) const;
+
+  std::string Encode() const;
+
+  static absl::optional<SequenceNumberHistogram> Decode(
+      absl::string_view encoded);
+
+ private:
+  model::ListenSequenceNumber bucket_width_ = 1;
+
+  // The number of sequence numbers in each non-empty bucket, by bucket index.
+  std::map<int64_t, int64_t> buckets_;
+  int64_t count_ = 0;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_SEQUENCE_NUMBER_HISTOGRAM_H_
@@ -26,6 +26,7 @@
 #include "Firestore/core/src/model/snapshot_version.h"
 #include "Firestore/core/src/model/types.h"
 #include "Firestore/core/src/nanopb/byte_string.h"
+#include "absl/types/optional.h"
 
 namespace firebase {
 namespace firestore {
@@ -142,6 +143,16 @@ class TargetData {
     return resume_token_;
   }
 
+  /**
+   * The number of documents that the client believes match the target as of
+   * the resume token, sent to the backend so that it can reply with a bloom
+   * filter if the count turns out to differ. Not persisted; only set on the
+   * copies of the target data used to build watch requests.
+   */
+  const absl::optional<int32_t>& expected_count() const {
+    return expected_count_;
+  }
+
   /** Creates a new target data instance with an updated sequence number. */
   TargetData WithSequenceNumber(
       model::ListenSequenceNumber sequence_number) const;
@@ -160,6 +171,9 @@ class TargetData {
   TargetData WithLastLimboFreeSnapshotVersion(
       model::SnapshotVersion last_limbo_free_snapshot_version) const;
 
+  /** Creates a new target data instance with the given expected count. */
+  TargetData WithExpectedCount(int32_t expected_count) const;
+
   friend bool operator==(const TargetData& lhs, const TargetData& rhs);
 
   size_t Hash() const;
@@ -176,6 +190,7 @@ class TargetData {
   model::SnapshotVersion snapshot_version_;
   model::SnapshotVersion last_limbo_free_snapshot_version_;
   nanopb::ByteString resume_token_;
+  absl::optional<int32_t> expected_count_;
 };
 
 inline bool operator!=(const TargetData& lhs, const TargetData& rhs) {
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/transaction_stats.h"
+
+#include "absl/memory/memory.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+TransactionCounters operator-(const TransactionCounters& lhs,
+                              const TransactionCounters& rhs) {
+  TransactionCounters result;
+  result.reads = lhs.reads - rhs.reads;
+  result.writes = lhs.writes - rhs.writes;
+  result.bytes_read = lhs.bytes_read - rhs.bytes_read;
+  result.bytes_written = lhs.bytes_written - rhs.bytes_written;
+  result.seeks = lhs.seeks - rhs.seeks;
+  return result;
+}
+
+void TransactionStats::LabelStats::Record(
+    std::chrono::microseconds duration, const TransactionCounters& counters) {
+  duration_.Record(duration);
+  reads_.fetch_add(counters.reads, std::memory_order_relaxed);
+  writes_.fetch_add(counters.writes, std::memory_order_relaxed);
+  bytes_read_.fetch_add(counters.bytes_read, std::memory_order_relaxed);
+  bytes_written_.fetch_add(counters.bytes_written, std::memory_order_relaxed);
+  seeks_.fetch_add(counters.seeks, std::memory_order_relaxed);
+}
+
+TransactionCounters TransactionStats::LabelStats::totals() const {
+  TransactionCounters result;
+  result.reads = reads_.load(std::memory_order_relaxed);
+  result.writes = writes_.load(std::memory_order_relaxed);
+  result.bytes_read = bytes_read_.load(std::memory_order_relaxed);
+  result.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+  result.seeks = seeks_.load(std::memory_order_relaxed);
+  return result;
+}
+
+void TransactionStats::Record(absl::string_view label,
+                              std::chrono::microseconds duration,
+                              const TransactionCounters& counters) {
+  LabelStats* stats = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<LabelStats>& entry = stats_[std::string(label)];
+    if (!entry) entry = absl::make_unique<LabelStats>();
+    stats = entry.get();
+  }
+  stats->Record(duration, counters);
+}
+
+const TransactionStats::LabelStats* TransactionStats::Get(
+    absl::string_view label) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = stats_.find(std::string(label));
+  return found != stats_.end() ? found->second.get() : nullptr;
+}
+
+std::vector<std::string> TransactionStats::labels() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> result;
+  result.reserve(stats_.size());
+  for (const auto& entry : stats_) {
+    result.push_back(entry.first);
+  }
+  return result;
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
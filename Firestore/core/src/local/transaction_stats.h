@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_LOCAL_TRANSACTION_STATS_H_
+#define FIRESTORE_CORE_SRC_LOCAL_TRANSACTION_STATS_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/remote/network_metrics.h"
+#include "absl/strings/string_view.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+/** The work a single transaction did against the underlying storage. */
+struct TransactionCounters {
+  /** The number of point reads, including those served by pending changes. */
+  int64_t reads = 0;
+  /** The number of keys put or deleted. */
+  int64_t writes = 0;
+  /** The size of the values returned by point reads. */
+  int64_t bytes_read = 0;
+  /** The size of the keys and values put. */
+  int64_t bytes_written = 0;
+  /** The number of times an iterator was positioned with `Seek`. */
+  int64_t seeks = 0;
+};
+
+TransactionCounters operator-(const TransactionCounters& lhs,
+                              const TransactionCounters& rhs);
+
+/**
+ * Durations and counters of the transactions run by `Persistence::Run` and
+ * `Persistence::RunReadOnly`, aggregated by the label each transaction was run
+ * with.
+ *
+ * This class is thread-safe.
+ */
+class TransactionStats {
+ public:
+  /** The aggregate of all the transactions run with one label. */
+  class LabelStats {
+   public:
+    void Record(std::chrono::microseconds duration,
+                const TransactionCounters& counters);
+
+    /** How long the transactions took, including their commits. */
+    const remote::LatencyHistogram& duration() const {
+      return duration_;
+    }
+
+    /** The number of transactions run with this label. */
+    int64_t count() const {
+      return duration_.count();
+    }
+
+    /** The sums of the counters of all the transactions. */
+    TransactionCounters totals() const;
+
+   private:
+    remote::LatencyHistogram duration_;
+    std::atomic<int64_t> reads_{0};
+    std::atomic<int64_t> writes_{0};
+    std::atomic<int64_t> bytes_read_{0};
+    std::atomic<int64_t> bytes_written_{0};
+    std::atomic<int64_t> seeks_{0};
+  };
+
+  void Record(absl::string_view label,
+              std::chrono::microseconds duration,
+              const TransactionCounters& counters);
+
+  /**
+   * Returns the stats of the transactions run with the given label, or null if
+   * there weren't any. The returned stats stay valid, and keep being updated,
+   * for as long as this object lives.
+   */
+  const LabelStats* Get(absl::string_view label) const;
+
+  /** The labels of all the transactions recorded so far, in sorted order. */
+  std::vector<std::string> labels() const;
+
+ private:
+  mutable std::mutex mutex_;
+  // Entries are never removed, so pointers to them stay valid.
+  std::map<std::string, std::unique_ptr<LabelStats>> stats_;
+};
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_LOCAL_TRANSACTION_STATS_H_
@@ -16,6 +16,9 @@
 
 #include "Firestore/core/src/model/document.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <ostream>
 #include <sstream>
 #include <utility>
@@ -51,15 +54,38 @@ class Document::Rep : public MaybeDocument::Rep {
       DocumentKey&& key,
       SnapshotVersion version,
       DocumentState document_state,
-      absl::any proto)
+      std::shared_ptr<const google_firestore_v1_Document>&& proto)
       : Rep(std::move(data), std::move(key), version, document_state) {
     proto_ = std::move(proto);
   }
 
+  Rep(std::shared_ptr<const LazyDocumentData>&& lazy_data,
+      DocumentKey&& key,
+      SnapshotVersion version,
+      DocumentState document_state)
+      : MaybeDocument::Rep(Type::Document, std::move(key), version),
+        document_state_(document_state),
+        lazy_data_(std::move(lazy_data)),
+        decoded_(false) {
+  }
+
   const ObjectValue& data() const {
+    if (!decoded_.load(std::memory_order_acquire)) {
+      std::call_once(decode_once_, [this] {
+        data_ = lazy_data_->Decode();
+        decoded_.store(true, std::memory_order_release);
+      });
+    }
     return data_;
   }
 
+  absl::optional<FieldValue> field(const FieldPath& path) const {
+    if (!decoded_.load(std::memory_order_acquire)) {
+      return lazy_data_->DecodeField(path);
+    }
+    return data_.Get(path);
+  }
+
   DocumentState document_state() const {
     return document_state_;
   }
@@ -81,25 +107,36 @@ class Document::Rep : public MaybeDocument::Rep {
 
     const auto& other_rep = static_cast<const Rep&>(other);
     return document_state_ == other_rep.document_state_ &&
-           data_ == other_rep.data_;
+           data() == other_rep.data();
   }
 
   size_t Hash() const override {
-    return util::Hash(MaybeDocument::Rep::Hash(), data_, document_state_);
+    return util::Hash(MaybeDocument::Rep::Hash(), data(), document_state_);
   }
 
   std::string ToString() const override {
     return absl::StrCat(
         "Document(key=", key().ToString(), ", version=", version().ToString(),
-        ", document_state=", document_state_, ", data=", data_.ToString(), ")");
+        ", document_state=", document_state_, ", data=", data().ToString(),
+        ")");
   }
 
  private:
   friend class Document;
 
-  ObjectValue data_;
+  // Lazily decoded Documents fill in `data_` from `lazy_data_` the first time
+  // all of their fields are read. `lazy_data_` is kept afterwards, since
+  // concurrent calls to `field()` may still be reading from it.
+  mutable ObjectValue data_;
   DocumentState document_state_;
-  absl::any proto_;
+
+  // Only accessed through `std::atomic_*` functions, since `TakeProto()` may
+  // be called concurrently on copies sharing this Rep.
+  mutable std::shared_ptr<const google_firestore_v1_Document> proto_;
+
+  std::shared_ptr<const LazyDocumentData> lazy_data_;
+  mutable std::once_flag decode_once_;
+  mutable std::atomic<bool> decoded_{true};
 };
 
 Document::Document(ObjectValue data,
@@ -114,7 +151,7 @@ Document::Document(ObjectValue data,
                    DocumentKey key,
                    SnapshotVersion version,
                    DocumentState document_state,
-                   absl::any proto)
+                   std::shared_ptr<const google_firestore_v1_Document> proto)
     : MaybeDocument(std::make_shared<Rep>(std::move(data),
                                           std::move(key),
                                           version,
@@ -122,6 +159,14 @@ Document::Document(ObjectValue data,
                                           std::move(proto))) {
 }
 
+Document::Document(std::shared_ptr<const LazyDocumentData> data,
+                   DocumentKey key,
+                   SnapshotVersion version,
+                   DocumentState document_state)
+    : MaybeDocument(std::make_shared<Rep>(
+          std::move(data), std::move(key), version, document_state)) {
+}
+
 Document::Document(const MaybeDocument& document) : MaybeDocument(document) {
   HARD_ASSERT(type() == Type::Document);
 }
@@ -131,7 +176,7 @@ const ObjectValue& Document::data() const {
 }
 
 absl::optional<FieldValue> Document::field(const FieldPath& path) const {
-  return data().Get(path);
+  return doc_rep().field(path);
 }
 
 DocumentState Document::document_state() const {
@@ -146,8 +191,11 @@ bool Document::has_committed_mutations() const {
   return doc_rep().has_committed_mutations();
 }
 
-const absl::any& Document::proto() const {
-  return doc_rep().proto_;
+std::shared_ptr<const google_firestore_v1_Document> Document::TakeProto()
+    const {
+  return std::atomic_exchange(
+      &doc_rep().proto_,
+      std::shared_ptr<const google_firestore_v1_Document>());
 }
 
 const Document::Rep& Document::doc_rep() const {
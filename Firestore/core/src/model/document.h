@@ -22,7 +22,6 @@
 #include <string>
 
 #include "Firestore/core/src/model/maybe_document.h"
-#include "absl/types/any.h"
 #include "absl/types/optional.h"
 
 namespace firebase {
@@ -76,6 +75,27 @@ enum class DocumentState {
 
 std::ostream& operator<<(std::ostream& os, DocumentState state);
 
+/**
+ * The still-encoded fields of a Document, decoded only once they are read.
+ *
+ * Implementations must be safe to call from multiple threads, and must fail
+ * hard if the encoded fields turn out to be invalid.
+ */
+class LazyDocumentData {
+ public:
+  virtual ~LazyDocumentData() = default;
+
+  /** Decodes all of the fields of the document. */
+  virtual ObjectValue Decode() const = 0;
+
+  /**
+   * Decodes only the field at the given path, or returns nullopt if the
+   * document doesn't contain it. Equivalent to `Decode().Get(path)`.
+   */
+  virtual absl::optional<FieldValue> DecodeField(
+      const FieldPath& path) const = 0;
+};
+
 /**
  * Represents a document in Firestore with a key, version, data and whether the
  * data has local mutations applied to it.
@@ -87,6 +107,16 @@ class Document : public MaybeDocument {
            SnapshotVersion version,
            DocumentState document_state);
 
+  /**
+   * Creates a Document whose fields are decoded from `data` on demand:
+   * `field()` only decodes the requested field, and the first call to `data()`
+   * decodes all of them.
+   */
+  Document(std::shared_ptr<const LazyDocumentData> data,
+           DocumentKey key,
+           SnapshotVersion version,
+           DocumentState document_state);
+
  private:
   // TODO(b/146372592): Make this public once we can use Abseil across
   // iOS/public C++ library boundaries.
@@ -97,7 +127,7 @@ class Document : public MaybeDocument {
            DocumentKey key,
            SnapshotVersion version,
            DocumentState document_state,
-           absl::any proto);
+           std::shared_ptr<const google_firestore_v1_Document> proto);
 
  public:
   /**
@@ -119,7 +149,15 @@ class Document : public MaybeDocument {
 
   bool has_committed_mutations() const;
 
-  const absl::any& proto() const;
+  /**
+   * Returns the proto this document was decoded from, if it was received from
+   * the backend and hasn't been persisted yet. The proto is forgotten once
+   * taken, so that it is only kept in memory until the document is stored.
+   *
+   * Persisting the returned proto avoids re-encoding the document from its
+   * decoded fields.
+   */
+  std::shared_ptr<const google_firestore_v1_Document> TakeProto() const;
 
   /** Compares against another Document. */
   friend bool operator==(const Document& lhs, const Document& rhs);
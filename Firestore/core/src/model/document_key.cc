@@ -36,17 +36,37 @@ void AssertValidPath(const ResourcePath& path) {
 
 }  // namespace
 
-DocumentKey::DocumentKey() : path_{std::make_shared<ResourcePath>()} {
+struct DocumentKey::Rep {
+  explicit Rep(ResourcePath&& path)
+      : path{std::move(path)}, hash{util::Hash(this->path)} {
+  }
+
+  ResourcePath path;
+  size_t hash = 0;
+};
+
+DocumentKey::DocumentKey() : rep_{EmptyRep()} {
 }
 
 DocumentKey::DocumentKey(const ResourcePath& path)
-    : path_{std::make_shared<ResourcePath>(path)} {
-  AssertValidPath(*path_);
+    : rep_{std::make_shared<Rep>(ResourcePath{path})} {
+  AssertValidPath(rep_->path);
 }
 
 DocumentKey::DocumentKey(ResourcePath&& path)
-    : path_{std::make_shared<ResourcePath>(std::move(path))} {
-  AssertValidPath(*path_);
+    : rep_{std::make_shared<Rep>(std::move(path))} {
+  AssertValidPath(rep_->path);
+}
+
+const std::shared_ptr<const DocumentKey::Rep>& DocumentKey::EmptyRep() {
+  static const auto* empty =
+      new std::shared_ptr<const Rep>{std::make_shared<Rep>(ResourcePath{})};
+  return *empty;
+}
+
+const DocumentKey::Rep& DocumentKey::rep() const {
+  // A moved-from key has no Rep.
+  return rep_ ? *rep_ : *EmptyRep();
 }
 
 DocumentKey DocumentKey::FromPathString(const std::string& path) {
@@ -67,11 +87,19 @@ bool DocumentKey::IsDocumentKey(const ResourcePath& path) {
 }
 
 util::ComparisonResult DocumentKey::CompareTo(const DocumentKey& other) const {
+  if (rep_ == other.rep_) {
+    return util::ComparisonResult::Same;
+  }
   return path().CompareTo(other.path());
 }
 
 bool operator==(const DocumentKey& lhs, const DocumentKey& rhs) {
-  return lhs.path() == rhs.path();
+  if (lhs.rep_ == rhs.rep_) {
+    return true;
+  }
+  const DocumentKey::Rep& lhs_rep = lhs.rep();
+  const DocumentKey::Rep& rhs_rep = rhs.rep();
+  return lhs_rep.hash == rhs_rep.hash && lhs_rep.path == rhs_rep.path;
 }
 
 bool operator<(const DocumentKey& lhs, const DocumentKey& rhs) {
@@ -82,7 +110,7 @@ bool operator>(const DocumentKey& lhs, const DocumentKey& rhs) {
 }
 
 size_t DocumentKey::Hash() const {
-  return util::Hash(ToString());
+  return rep().hash;
 }
 
 std::string DocumentKey::ToString() const {
@@ -94,7 +122,7 @@ std::ostream& operator<<(std::ostream& os, const DocumentKey& key) {
 }
 
 const ResourcePath& DocumentKey::path() const {
-  return path_ ? *path_ : Empty().path();
+  return rep().path;
 }
 
 /** Returns true if the document is in the specified collection_id. */
@@ -104,7 +132,7 @@ bool DocumentKey::HasCollectionId(const std::string& collection_id) const {
 }
 
 size_t DocumentKeyHash::operator()(const DocumentKey& key) const {
-  return util::Hash(key.path());
+  return key.Hash();
 }
 
 }  // namespace model
@@ -80,9 +80,17 @@ class DocumentKey {
   bool HasCollectionId(const std::string& collection_id) const;
 
  private:
+  struct Rep;
+
+  static const std::shared_ptr<const Rep>& EmptyRep();
+
+  const Rep& rep() const;
+
   // This is an optimization to make passing DocumentKey around cheaper (it's
-  // copied often).
-  std::shared_ptr<const ResourcePath> path_;
+  // copied often). The Rep also caches the hash of the path, which makes
+  // hashing keys cheap and lets most unequal keys be told apart without
+  // comparing their paths.
+  std::shared_ptr<const Rep> rep_;
 };
 
 inline bool operator!=(const DocumentKey& lhs, const DocumentKey& rhs) {
@@ -17,6 +17,7 @@
 #ifndef FIRESTORE_CORE_SRC_MODEL_DOCUMENT_MAP_H_
 #define FIRESTORE_CORE_SRC_MODEL_DOCUMENT_MAP_H_
 
+#include <cstddef>
 #include <utility>
 
 #include "Firestore/core/src/immutable/sorted_map.h"
@@ -60,6 +61,27 @@ class DocumentMap {
   using key_type = DocumentKey;
   using mapped_type = Document;
 
+  /**
+   * Builds a DocumentMap in one step. See `immutable::SortedMap::Builder`.
+   */
+  class Builder {
+   public:
+    void reserve(size_t size) {
+      builder_.reserve(size);
+    }
+
+    void insert(const DocumentKey& key, const Document& value) {
+      builder_.insert(key, value);
+    }
+
+    DocumentMap Build() {
+      return DocumentMap{builder_.Build()};
+    }
+
+   private:
+    MaybeDocumentMap::Builder builder_;
+  };
+
   DocumentMap() = default;
 
   ABSL_MUST_USE_RESULT DocumentMap insert(const DocumentKey& key,
@@ -18,6 +18,7 @@
 
 #include <ostream>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/immutable/sorted_set.h"
 #include "Firestore/core/src/model/document_key.h"
@@ -44,16 +45,24 @@ DocumentComparator DocumentComparator::ByKey() {
   });
 }
 
+util::ComparisonResult DocumentSet::EntryComparator::Compare(
+    const Entry& lhs, const Entry& rhs) const {
+  if (lhs.second && rhs.second) {
+    return util::Compare(*lhs.second, *rhs.second);
+  }
+  return comparator_.Compare(lhs.first, rhs.first);
+}
+
 DocumentSet::DocumentSet(DocumentComparator&& comparator)
-    : index_{}, sorted_set_{std::move(comparator)} {
+    : index_{}, sorted_set_{EntryComparator{std::move(comparator)}} {
 }
 
 bool operator==(const DocumentSet& lhs, const DocumentSet& rhs) {
-  return absl::c_equal(lhs.sorted_set_, rhs.sorted_set_);
+  return absl::c_equal(lhs, rhs);
 }
 
 std::string DocumentSet::ToString() const {
-  return util::ToString(sorted_set_);
+  return util::ToString(std::vector<Document>(begin(), end()));
 }
 
 std::ostream& operator<<(std::ostream& os, const DocumentSet& set) {
@@ -61,7 +70,11 @@ std::ostream& operator<<(std::ostream& os, const DocumentSet& set) {
 }
 
 size_t DocumentSet::Hash() const {
-  return util::Hash(sorted_set_);
+  size_t result = 0;
+  for (const Document& document : *this) {
+    result = util::Hash(result, document);
+  }
+  return result;
 }
 
 bool DocumentSet::ContainsKey(const DocumentKey& key) const {
@@ -77,17 +90,43 @@ absl::optional<Document> DocumentSet::GetDocument(
 
 absl::optional<Document> DocumentSet::GetFirstDocument() const {
   auto result = sorted_set_.min();
-  return result != sorted_set_.end() ? *result : none();
+  return result != sorted_set_.end() ? result->first : none();
 }
 
 absl::optional<Document> DocumentSet::GetLastDocument() const {
   auto result = sorted_set_.max();
-  return result != sorted_set_.end() ? *result : none();
+  return result != sorted_set_.end() ? result->first : none();
+}
+
+void DocumentSet::Diff(
+    const DocumentSet& before,
+    const DocumentSet& after,
+    const std::function<void(const absl::optional<Document>&,
+                             const absl::optional<Document>&)>& callback) {
+  using Entry = MaybeDocumentMap::value_type;
+  MaybeDocumentMap::Diff(
+      before.index_.underlying_map(), after.index_.underlying_map(),
+      [&](const Entry* lhs, const Entry* rhs) {
+        if (lhs && rhs && lhs->second == rhs->second) {
+          return;
+        }
+        callback(lhs ? Document(lhs->second) : none(),
+                 rhs ? Document(rhs->second) : none());
+      });
 }
 
 size_t DocumentSet::IndexOf(const DocumentKey& key) const {
   absl::optional<Document> doc = GetDocument(key);
-  return doc ? sorted_set_.find_index(*doc) : npos;
+  return doc ? sorted_set_.find_index(MakeEntry(*doc)) : npos;
+}
+
+DocumentSet::Entry DocumentSet::MakeEntry(const Document& document) const {
+  std::string sort_key = comparator().SortKey(document);
+  if (sort_key.empty()) {
+    return Entry(document, nullptr);
+  }
+  return Entry(document,
+               std::make_shared<const std::string>(std::move(sort_key)));
 }
 
 DocumentSet DocumentSet::insert(
@@ -103,7 +142,7 @@ DocumentSet DocumentSet::insert(
   DocumentSet removed = erase(key);
 
   DocumentMap index = removed.index_.insert(key, *document);
-  SetType set = removed.sorted_set_.insert(*document);
+  SetType set = removed.sorted_set_.insert(MakeEntry(*document));
   return {std::move(index), std::move(set)};
 }
 
@@ -114,7 +153,7 @@ DocumentSet DocumentSet::erase(const DocumentKey& key) const {
   }
 
   DocumentMap index = index_.erase(key);
-  SetType set = sorted_set_.erase(*doc);
+  SetType set = sorted_set_.erase(MakeEntry(*doc));
   return {std::move(index), std::move(set)};
 }
 
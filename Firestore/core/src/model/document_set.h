@@ -17,7 +17,9 @@
 #ifndef FIRESTORE_CORE_SRC_MODEL_DOCUMENT_SET_H_
 #define FIRESTORE_CORE_SRC_MODEL_DOCUMENT_SET_H_
 
+#include <functional>
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -27,6 +29,7 @@
 #include "Firestore/core/src/model/document.h"
 #include "Firestore/core/src/model/document_map.h"
 #include "Firestore/core/src/util/comparison.h"
+#include "Firestore/core/src/util/iterator_adaptors.h"
 
 namespace firebase {
 namespace firestore {
@@ -34,14 +37,38 @@ namespace model {
 
 class DocumentComparator : public util::FunctionComparator<Document> {
  public:
+  /**
+   * Encodes a document as a string whose bytewise order matches the order of
+   * the comparator, or returns an empty string if the document can't be
+   * encoded that way.
+   */
+  using SortKeyFunction = std::function<std::string(const Document&)>;
+
   using FunctionComparator<Document>::FunctionComparator;
 
+  DocumentComparator(ComparisonFunction&& function,
+                     SortKeyFunction&& sort_key_function)
+      : FunctionComparator<Document>(std::move(function)),
+        sort_key_function_(std::move(sort_key_function)) {
+  }
+
   static DocumentComparator ByKey();
 
   // TODO(wilhuff): Remove this using statement
   // This exists to put these two overloads on equal footing. Once the overload
   // below is gone, this using statement can be removed as well.
   using FunctionComparator<Document>::Compare;
+
+  /**
+   * Returns the sort key of the given document, or an empty string if the
+   * comparator has no sort keys or the document can't be encoded.
+   */
+  std::string SortKey(const Document& document) const {
+    return sort_key_function_ ? sort_key_function_(document) : std::string();
+  }
+
+ private:
+  SortKeyFunction sort_key_function_;
 };
 
 /**
@@ -51,16 +78,44 @@ class DocumentComparator : public util::FunctionComparator<Document> {
  * the key.
  */
 class DocumentSet : public immutable::SortedContainer {
+ private:
+  /**
+   * A document in the set along with its sort key, if the comparator produced
+   * one. The key is encoded once, when the document is added, so that most
+   * comparisons reduce to comparing bytes.
+   */
+  using Entry = std::pair<Document, std::shared_ptr<const std::string>>;
+
+  /**
+   * Orders entries by their sort keys when both have one, and by the document
+   * comparator otherwise.
+   */
+  class EntryComparator {
+   public:
+    explicit EntryComparator(DocumentComparator&& comparator)
+        : comparator_(std::move(comparator)) {
+    }
+
+    util::ComparisonResult Compare(const Entry& lhs, const Entry& rhs) const;
+
+    const DocumentComparator& document_comparator() const {
+      return comparator_;
+    }
+
+   private:
+    DocumentComparator comparator_;
+  };
+
  public:
   /**
    * The type of the main collection of documents in an DocumentSet.
    * @see sorted_set_.
    */
-  using SetType = immutable::SortedSet<Document, DocumentComparator>;
+  using SetType = immutable::SortedSet<Entry, EntryComparator>;
 
   // STL container types
   using value_type = Document;
-  using const_iterator = SetType::const_iterator;
+  using const_iterator = util::iterator_first<SetType::const_iterator>;
 
   /**
    * Creates a new, empty DocumentSet sorted by the given comparator, then by
@@ -81,13 +136,13 @@ class DocumentSet : public immutable::SortedContainer {
   bool ContainsKey(const DocumentKey& key) const;
 
   const DocumentComparator& comparator() const {
-    return sorted_set_.comparator();
+    return sorted_set_.comparator().document_comparator();
   }
 
-  SetType::const_iterator begin() const {
+  const_iterator begin() const {
     return sorted_set_.begin();
   }
-  SetType::const_iterator end() const {
+  const_iterator end() const {
     return sorted_set_.end();
   }
 
@@ -115,6 +170,14 @@ class DocumentSet : public immutable::SortedContainer {
    */
   size_t IndexOf(const DocumentKey& key) const;
 
+  /**
+   * Returns the document at the given index in the document set, in
+   * logarithmic time. The index must be less than `size()`.
+   */
+  const Document& At(size_t index) const {
+    return sorted_set_.at_index(index).first;
+  }
+
   /** Returns a new DocumentSet that contains the given document. */
   DocumentSet insert(const absl::optional<Document>& document) const;
 
@@ -124,6 +187,21 @@ class DocumentSet : public immutable::SortedContainer {
    */
   DocumentSet erase(const DocumentKey& key) const;
 
+  /**
+   * Calls `callback(before_document, after_document)`, in key order, for each
+   * document that differs between the two sets. The document is missing on one
+   * side if it was added or removed.
+   *
+   * Documents that `after` shares with `before`, as it does when it was
+   * derived from `before` by `insert` and `erase`, are skipped without being
+   * compared, so this takes time proportional to the number of changes.
+   */
+  static void Diff(
+      const DocumentSet& before,
+      const DocumentSet& after,
+      const std::function<void(const absl::optional<Document>&,
+                               const absl::optional<Document>&)>& callback);
+
   friend bool operator==(const DocumentSet& lhs, const DocumentSet& rhs);
 
   std::string ToString() const;
@@ -136,6 +214,9 @@ class DocumentSet : public immutable::SortedContainer {
       : index_(std::move(index)), sorted_set_(std::move(sorted_set)) {
   }
 
+  /** Pairs the given document with the sort key the comparator gives it. */
+  Entry MakeEntry(const Document& document) const;
+
   /**
    * An index of the documents in the DocumentSet, indexed by document key.
    * The index exists to guarantee the uniqueness of document keys in the set
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/model/field_index.h"
+
+#include <ostream>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+
+namespace firebase {
+namespace firestore {
+namespace model {
+
+constexpr int32_t FieldIndex::kUnknownId;
+
+std::string FieldIndex::ToString() const {
+  return absl::StrCat(
+      "FieldIndex(id=", index_id_, ", collection_group=", collection_group_,
+      ", fields=[",
+      absl::StrJoin(fields_, ", ",
+                    [](std::string* out, const FieldPath& field) {
+                      absl::StrAppend(out, field.CanonicalString());
+                    }),
+      "])");
+}
+
+std::ostream& operator<<(std::ostream& os, const FieldIndex& index) {
+  return os << index.ToString();
+}
+
+bool operator==(const FieldIndex& lhs, const FieldIndex& rhs) {
+  return lhs.collection_group() == rhs.collection_group() &&
+         lhs.fields() == rhs.fields();
+}
+
+}  // namespace model
+}  // namespace firestore
+}  // namespace firebase
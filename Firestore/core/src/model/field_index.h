@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_MODEL_FIELD_INDEX_H_
+#define FIRESTORE_CORE_SRC_MODEL_FIELD_INDEX_H_
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/model/field_path.h"
+
+namespace firebase {
+namespace firestore {
+namespace model {
+
+/**
+ * A composite index over one or more fields of all documents in a collection
+ * group.
+ *
+ * Index entries order documents by the values of `fields()`, compared in the
+ * order the fields are listed. A document only has an entry in the index if it
+ * contains a value for every indexed field.
+ */
+class FieldIndex {
+ public:
+  /** An index_id that has not yet been assigned by persistence. */
+  static constexpr int32_t kUnknownId = -1;
+
+  FieldIndex() = default;
+
+  FieldIndex(std::string collection_group, std::vector<FieldPath> fields)
+      : collection_group_(std::move(collection_group)),
+        fields_(std::move(fields)) {
+  }
+
+  FieldIndex(int32_t index_id,
+             std::string collection_group,
+             std::vector<FieldPath> fields)
+      : index_id_(index_id),
+        collection_group_(std::move(collection_group)),
+        fields_(std::move(fields)) {
+  }
+
+  /**
+   * The persistence-assigned identifier of this index, or `kUnknownId` if the
+   * index has not been persisted.
+   */
+  int32_t index_id() const {
+    return index_id_;
+  }
+
+  /** The collection ID of the collection group this index applies to. */
+  const std::string& collection_group() const {
+    return collection_group_;
+  }
+
+  /** The indexed fields, most significant first. */
+  const std::vector<FieldPath>& fields() const {
+    return fields_;
+  }
+
+  /** Returns a copy of this index with the given index_id. */
+  FieldIndex WithIndexId(int32_t index_id) const {
+    return FieldIndex(index_id, collection_group_, fields_);
+  }
+
+  std::string ToString() const;
+
+  friend std::ostream& operator<<(std::ostream& os, const FieldIndex& index);
+
+ private:
+  int32_t index_id_ = kUnknownId;
+  std::string collection_group_;
+  std::vector<FieldPath> fields_;
+};
+
+/**
+ * Two FieldIndexes are equal if they index the same fields of the same
+ * collection group, regardless of their index_id.
+ */
+bool operator==(const FieldIndex& lhs, const FieldIndex& rhs);
+
+inline bool operator!=(const FieldIndex& lhs, const FieldIndex& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace model
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_MODEL_FIELD_INDEX_H_
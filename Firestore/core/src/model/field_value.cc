@@ -17,8 +17,10 @@
 #include "Firestore/core/src/model/field_value.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <new>
 #include <set>
@@ -58,37 +60,6 @@ const T& Cast(const BaseValue& rep) {
   return static_cast<const T&>(rep);
 }
 
-class NullValue : public FieldValue::BaseValue {
- public:
-  Type type() const override {
-    return Type::Null;
-  }
-
-  std::string ToString() const override {
-    return util::ToString(nullptr);
-  }
-
-  bool Equals(const BaseValue& other) const override {
-    if (type() != other.type()) return false;
-
-    // NullValue is the only instance of itself
-    return true;
-  }
-
-  ComparisonResult CompareTo(const BaseValue& other) const override {
-    ComparisonResult cmp = CompareTypes(other);
-    if (!util::Same(cmp)) return cmp;
-
-    // Null is only comparable with itself and is defined to be the same.
-    return ComparisonResult::Same;
-  }
-
-  size_t Hash() const override {
-    // std::hash is not defined for nullptr_t.
-    return util::Hash(static_cast<void*>(nullptr));
-  }
-};
-
 /**
  * A base class for implementing a "simple" field value type. Simple field
  * values:
@@ -138,76 +109,6 @@ class SimpleFieldValue : public FieldValue::BaseValue {
   ValueType value_;
 };
 
-class BooleanValue : public SimpleFieldValue<Type::Boolean, bool> {
- public:
-  using SimpleFieldValue::SimpleFieldValue;
-};
-
-template <Type type_enum, typename ValueType>
-class NumberValue : public SimpleFieldValue<type_enum, ValueType> {
- public:
-  using SimpleFieldValue<type_enum, ValueType>::SimpleFieldValue;
-
-  ComparisonResult CompareTo(const BaseValue& other) const override;
-};
-
-class IntegerValue : public NumberValue<Type::Integer, int64_t> {
- public:
-  using NumberValue<Type::Integer, int64_t>::NumberValue;
-};
-
-int64_t Integer(const BaseValue& rep) {
-  return Cast<IntegerValue>(rep).value();
-}
-
-class DoubleValue : public NumberValue<Type::Double, double> {
- public:
-  using NumberValue<Type::Double, double>::NumberValue;
-
-  bool Equals(const BaseValue& other) const override {
-    if (type() != other.type()) return false;
-
-    auto& other_value = Cast<DoubleValue>(other);
-    return util::DoubleBitwiseEquals(value(), other_value.value());
-  }
-
-  size_t Hash() const override {
-    return util::DoubleBitwiseHash(value());
-  }
-};
-
-double Double(const BaseValue& rep) {
-  return Cast<DoubleValue>(rep).value();
-}
-
-template <Type type_enum, typename ValueType>
-ComparisonResult NumberValue<type_enum, ValueType>::CompareTo(
-    const BaseValue& other) const {
-  ComparisonResult cmp = this->CompareTypes(other);
-  if (!util::Same(cmp)) return cmp;
-
-  Type this_type = this->type();
-  Type other_type = other.type();
-
-  if (this_type == other_type) {
-    if (this_type == Type::Integer) {
-      return Compare(Integer(*this), Integer(other));
-    } else {
-      return Compare(Double(*this), Double(other));
-    }
-
-  } else {
-    if (this_type == Type::Integer) {
-      // CompareMixedNumber only takes (double, int64_t) so reverse the argument
-      // order and then reverse the result.
-      return util::ReverseOrder(
-          util::CompareMixedNumber(Double(other), Integer(*this)));
-    } else {
-      return util::CompareMixedNumber(Double(*this), Integer(other));
-    }
-  }
-}
-
 // TODO(wilhuff): Use SimpleFieldValue as a base once we migrate to absl::Hash.
 //
 // This can't extend SimpleFieldValue because `util::Hash` is undefined for
@@ -425,6 +326,31 @@ class GeoPointValue : public BaseValue {
   GeoPoint value_;
 };
 
+/**
+ * The lazily computed hash of an immutable container value, which would
+ * otherwise be rehashed element by element every time, e.g. whenever a filter
+ * holding a large `in` array is hashed.
+ *
+ * Values may be hashed on several threads at once. Since they all compute the
+ * same hash, racing to store it is benign. A hash of zero is indistinguishable
+ * from "not computed yet", and is just recomputed.
+ */
+class MemoizedHash {
+ public:
+  template <typename Compute>
+  size_t Get(const Compute& compute) const {
+    size_t hash = hash_.load(std::memory_order_relaxed);
+    if (hash == 0) {
+      hash = compute();
+      hash_.store(hash, std::memory_order_relaxed);
+    }
+    return hash;
+  }
+
+ private:
+  mutable std::atomic<size_t> hash_{0};
+};
+
 class ArrayContents : public FieldValue::BaseValue {
  public:
   explicit ArrayContents(FieldValue::Array value) : value_(std::move(value)) {
@@ -454,7 +380,7 @@ class ArrayContents : public FieldValue::BaseValue {
   }
 
   size_t Hash() const override {
-    return util::Hash(value_);
+    return hash_.Get([this] { return util::Hash(value_); });
   }
 
   const FieldValue::Array& value() const {
@@ -463,6 +389,7 @@ class ArrayContents : public FieldValue::BaseValue {
 
  private:
   FieldValue::Array value_;
+  MemoizedHash hash_;
 };
 
 class MapContents : public FieldValue::BaseValue {
@@ -494,11 +421,13 @@ class MapContents : public FieldValue::BaseValue {
   }
 
   size_t Hash() const override {
-    size_t result = 0;
-    for (auto&& entry : value_) {
-      result = util::Hash(result, entry.first, entry.second);
-    }
-    return result;
+    return hash_.Get([this] {
+      size_t result = 0;
+      for (auto&& entry : value_) {
+        result = util::Hash(result, entry.first, entry.second);
+      }
+      return result;
+    });
   }
 
   const FieldValue::Map& value() const {
@@ -507,11 +436,14 @@ class MapContents : public FieldValue::BaseValue {
 
  private:
   FieldValue::Map value_;
+  MemoizedHash hash_;
 };
 
 }  // namespace
 
-FieldValue::FieldValue() : FieldValue(std::make_shared<NullValue>()) {
+FieldValue::FieldValue(std::unique_ptr<BaseValue> rep) : type_(rep->type()) {
+  HARD_ASSERT(!IsInline(type_));
+  value_.rep = rep.release();
 }
 
 bool FieldValue::Comparable(Type lhs, Type rhs) {
@@ -529,57 +461,57 @@ bool FieldValue::Comparable(Type lhs, Type rhs) {
 
 bool FieldValue::boolean_value() const {
   HARD_ASSERT(type() == Type::Boolean);
-  return Cast<BooleanValue>(*rep_).value();
+  return value_.boolean;
 }
 
 int64_t FieldValue::integer_value() const {
   HARD_ASSERT(type() == Type::Integer);
-  return Cast<IntegerValue>(*rep_).value();
+  return value_.integer;
 }
 
 double FieldValue::double_value() const {
   HARD_ASSERT(type() == Type::Double);
-  return Cast<DoubleValue>(*rep_).value();
+  return value_.number;
 }
 
 Timestamp FieldValue::timestamp_value() const {
   HARD_ASSERT(type() == Type::Timestamp);
-  return Cast<TimestampValue>(*rep_).value();
+  return Cast<TimestampValue>(*value_.rep).value();
 }
 
 const ServerTimestamp& FieldValue::server_timestamp_value() const {
   HARD_ASSERT(type() == Type::ServerTimestamp);
-  return Cast<ServerTimestampValue>(*rep_).value();
+  return Cast<ServerTimestampValue>(*value_.rep).value();
 }
 
 const std::string& FieldValue::string_value() const {
   HARD_ASSERT(type() == Type::String);
-  return Cast<StringValue>(*rep_).value();
+  return Cast<StringValue>(*value_.rep).value();
 }
 
 const ByteString& FieldValue::blob_value() const {
   HARD_ASSERT(type() == Type::Blob);
-  return Cast<BlobValue>(*rep_).value();
+  return Cast<BlobValue>(*value_.rep).value();
 }
 
 const Reference& FieldValue::reference_value() const {
   HARD_ASSERT(type() == Type::Reference);
-  return Cast<ReferenceValue>(*rep_).value();
+  return Cast<ReferenceValue>(*value_.rep).value();
 }
 
 const GeoPoint& FieldValue::geo_point_value() const {
   HARD_ASSERT(type() == Type::GeoPoint);
-  return Cast<GeoPointValue>(*rep_).value();
+  return Cast<GeoPointValue>(*value_.rep).value();
 }
 
 const FieldValue::Array& FieldValue::array_value() const {
   HARD_ASSERT(type() == Type::Array);
-  return Cast<ArrayContents>(*rep_).value();
+  return Cast<ArrayContents>(*value_.rep).value();
 }
 
 const FieldValue::Map& FieldValue::object_value() const {
   HARD_ASSERT(type() == Type::Object);
-  return Cast<MapContents>(*rep_).value();
+  return Cast<MapContents>(*value_.rep).value();
 }
 
 // TODO(rsgowman): Reorder this file to match its header.
@@ -681,20 +613,172 @@ ObjectValue ObjectValue::SetChild(const std::string& child_name,
   return ObjectValue::FromMap(fv_.object_value().insert(child_name, value));
 }
 
+// MARK: - ObjectValue::Builder
+
+/** The pending changes to one field, and to the fields nested in it. */
+struct ObjectValue::Builder::Node {
+  void Reset() {
+    value.reset();
+    removed = false;
+    creates_object = false;
+    children.clear();
+  }
+
+  /**
+   * The new value of the field, before `children` are applied. If unset, the
+   * field keeps its current value, unless `removed`.
+   */
+  absl::optional<FieldValue> value;
+  bool removed = false;
+
+  /**
+   * Whether a `Set` of a nested field went through this field, which makes it
+   * an object even if it wasn't one before.
+   */
+  bool creates_object = false;
+
+  std::map<std::string, std::unique_ptr<Node>> children;
+};
+
+FieldValue::Map ObjectValue::Builder::ApplyChildren(
+    const FieldValue::Map& entries, const Node& node) {
+  // Updating a map entry by entry copies the path to each entry (or the whole
+  // array, for small maps), so once a sizeable share of the entries changes,
+  // rebuilding the map in one pass is cheaper.
+  bool rebuild = entries.size() <= FieldValue::Map::kFixedSize ||
+                 node.children.size() * 8 >= entries.size();
+
+  if (!rebuild) {
+    FieldValue::Map result = entries;
+    for (const auto& child : node.children) {
+      auto current = entries.find(child.first);
+      absl::optional<FieldValue> value = ResolveField(
+          *child.second, current != entries.end() ? &current->second : nullptr);
+      if (value) {
+        result = result.insert(child.first, *std::move(value));
+      } else {
+        result = result.erase(child.first);
+      }
+    }
+    return result;
+  }
+
+  // Merge the sorted entries with the sorted changes.
+  FieldValue::Map::Builder result;
+  result.reserve(entries.size() + node.children.size());
+  auto entry = entries.begin();
+  auto child = node.children.begin();
+  while (entry != entries.end() || child != node.children.end()) {
+    if (child == node.children.end() ||
+        (entry != entries.end() && entry->first < child->first)) {
+      result.insert(entry->first, entry->second);
+      ++entry;
+      continue;
+    }
+
+    const FieldValue* current = nullptr;
+    if (entry != entries.end() && entry->first == child->first) {
+      current = &entry->second;
+      ++entry;
+    }
+    absl::optional<FieldValue> value = ResolveField(*child->second, current);
+    if (value) {
+      result.insert(child->first, *std::move(value));
+    }
+    ++child;
+  }
+  return result.Build();
+}
+
+absl::optional<FieldValue> ObjectValue::Builder::ResolveField(
+    const Node& node, const FieldValue* current) {
+  const FieldValue* base = nullptr;
+  if (!node.removed) {
+    base = node.value ? &*node.value : current;
+  }
+
+  bool base_is_object = base && base->type() == Type::Object;
+  if (node.children.empty() || (!base_is_object && !node.creates_object)) {
+    // Deleting a nested field doesn't change a field that isn't an object.
+    return base ? absl::make_optional(*base) : absl::nullopt;
+  }
+
+  static const FieldValue::Map* empty = new FieldValue::Map();
+  const FieldValue::Map& entries =
+      base_is_object ? base->object_value() : *empty;
+  return FieldValue::FromMap(ApplyChildren(entries, node));
+}
+
+ObjectValue::Builder::Builder(ObjectValue base)
+    : base_{std::move(base)}, root_{absl::make_unique<Node>()} {
+}
+
+ObjectValue::Builder::~Builder() = default;
+
+ObjectValue::Builder::Builder(Builder&& other) noexcept = default;
+
+ObjectValue::Builder& ObjectValue::Builder::operator=(
+    Builder&& other) noexcept = default;
+
+void ObjectValue::Builder::Set(const FieldPath& field_path, FieldValue value) {
+  HARD_ASSERT(!field_path.empty(),
+              "Cannot set field for empty path on FieldValue");
+  ResetLeaf(field_path, /* creates_objects= */ true)->value = std::move(value);
+}
+
+void ObjectValue::Builder::Delete(const FieldPath& field_path) {
+  HARD_ASSERT(!field_path.empty(),
+              "Cannot delete field for empty path on FieldValue");
+  ResetLeaf(field_path, /* creates_objects= */ false)->removed = true;
+}
+
+ObjectValue ObjectValue::Builder::Build() const {
+  if (root_->children.empty()) {
+    return base_;
+  }
+  return ObjectValue::FromMap(ApplyChildren(base_.GetInternalValue(), *root_));
+}
+
+ObjectValue::Builder::Node* ObjectValue::Builder::ResetLeaf(
+    const FieldPath& field_path, bool creates_objects) {
+  Node* node = root_.get();
+  for (size_t i = 0; i + 1 < field_path.size(); ++i) {
+    std::unique_ptr<Node>& child = node->children[field_path[i]];
+    if (!child) {
+      child = absl::make_unique<Node>();
+    }
+    if (creates_objects) {
+      child->creates_object = true;
+    }
+    node = child.get();
+  }
+
+  std::unique_ptr<Node>& leaf = node->children[field_path.last_segment()];
+  if (leaf) {
+    leaf->Reset();
+  } else {
+    leaf = absl::make_unique<Node>();
+  }
+  return leaf.get();
+}
+
 FieldValue FieldValue::Null() {
   return FieldValue();
 }
 
 FieldValue FieldValue::True() {
-  return FieldValue(std::make_shared<BooleanValue>(true));
+  return FromBoolean(true);
 }
 
 FieldValue FieldValue::False() {
-  return FieldValue(std::make_shared<BooleanValue>(false));
+  return FromBoolean(false);
 }
 
 FieldValue FieldValue::FromBoolean(bool value) {
-  return value ? True() : False();
+  FieldValue result;
+  result.type_ = Type::Boolean;
+  result.value_.boolean = value;
+  return result;
 }
 
 FieldValue FieldValue::Nan() {
@@ -706,7 +790,10 @@ FieldValue FieldValue::EmptyObject() {
 }
 
 FieldValue FieldValue::FromInteger(int64_t value) {
-  return FieldValue(std::make_shared<IntegerValue>(value));
+  FieldValue result;
+  result.type_ = Type::Integer;
+  result.value_.integer = value;
+  return result;
 }
 
 // We use a canonical NaN bit pattern that's common for both Objective-C and
@@ -728,11 +815,14 @@ FieldValue FieldValue::FromDouble(double value) {
     value = canonical_nan;
   }
 
-  return FieldValue(std::make_shared<DoubleValue>(value));
+  FieldValue result;
+  result.type_ = Type::Double;
+  result.value_.number = value;
+  return result;
 }
 
 FieldValue FieldValue::FromTimestamp(const Timestamp& value) {
-  return FieldValue(std::make_shared<TimestampValue>(value));
+  return FieldValue(absl::make_unique<TimestampValue>(value));
 }
 
 FieldValue FieldValue::FromServerTimestamp(const Timestamp& local_write_time) {
@@ -742,53 +832,135 @@ FieldValue FieldValue::FromServerTimestamp(const Timestamp& local_write_time) {
 FieldValue FieldValue::FromServerTimestamp(
     const Timestamp& local_write_time,
     absl::optional<FieldValue> previous_value) {
-  return FieldValue(std::make_shared<ServerTimestampValue>(
+  return FieldValue(absl::make_unique<ServerTimestampValue>(
       ServerTimestamp(local_write_time, std::move(previous_value))));
 }
 
 FieldValue FieldValue::FromString(const char* value) {
-  return FieldValue(std::make_shared<StringValue>(value));
+  return FieldValue(absl::make_unique<StringValue>(value));
 }
 
 FieldValue FieldValue::FromString(const std::string& value) {
-  return FieldValue(std::make_shared<StringValue>(value));
+  return FieldValue(absl::make_unique<StringValue>(value));
 }
 
 FieldValue FieldValue::FromString(std::string&& value) {
-  return FieldValue(std::make_shared<StringValue>(std::move(value)));
+  return FieldValue(absl::make_unique<StringValue>(std::move(value)));
 }
 
 FieldValue FieldValue::FromBlob(ByteString blob) {
-  return FieldValue(std::make_shared<BlobValue>(std::move(blob)));
+  return FieldValue(absl::make_unique<BlobValue>(std::move(blob)));
 }
 
 FieldValue FieldValue::FromReference(DatabaseId database_id, DocumentKey key) {
-  return FieldValue(std::make_shared<ReferenceValue>(
+  return FieldValue(absl::make_unique<ReferenceValue>(
       Reference(std::move(database_id), std::move(key))));
 }
 
 FieldValue FieldValue::FromGeoPoint(const GeoPoint& value) {
-  return FieldValue(std::make_shared<GeoPointValue>(value));
+  return FieldValue(absl::make_unique<GeoPointValue>(value));
 }
 
 FieldValue FieldValue::FromArray(const Array& value) {
-  return FieldValue(std::make_shared<ArrayContents>(value));
+  return FieldValue(absl::make_unique<ArrayContents>(value));
 }
 
 FieldValue FieldValue::FromArray(Array&& value) {
-  return FieldValue(std::make_shared<ArrayContents>(std::move(value)));
+  return FieldValue(absl::make_unique<ArrayContents>(std::move(value)));
 }
 
 FieldValue FieldValue::FromMap(const Map& value) {
-  return FieldValue(std::make_shared<MapContents>(value));
+  return FieldValue(absl::make_unique<MapContents>(value));
 }
 
 FieldValue FieldValue::FromMap(FieldValue::Map&& value) {
-  return FieldValue(std::make_shared<MapContents>(std::move(value)));
+  return FieldValue(absl::make_unique<MapContents>(std::move(value)));
+}
+
+size_t FieldValue::Hash() const {
+  switch (type_) {
+    case Type::Null:
+      // std::hash is not defined for nullptr_t.
+      return util::Hash(static_cast<void*>(nullptr));
+    case Type::Boolean:
+      return util::Hash(value_.boolean);
+    case Type::Integer:
+      return util::Hash(value_.integer);
+    case Type::Double:
+      return util::DoubleBitwiseHash(value_.number);
+    default:
+      return value_.rep->Hash();
+  }
+}
+
+ComparisonResult FieldValue::CompareTo(const FieldValue& rhs) const {
+  // Inline types are only comparable with inline types, so other types can
+  // leave mixed comparisons to their BaseValue.
+  if (!IsInline(type_) && !IsInline(rhs.type_)) {
+    return value_.rep->CompareTo(*rhs.value_.rep);
+  }
+
+  if (!Comparable(type_, rhs.type_)) {
+    // Otherwise, the types themselves are defined in order.
+    return Compare(type_, rhs.type_);
+  }
+
+  switch (type_) {
+    case Type::Null:
+      // Null is only comparable with itself and is defined to be the same.
+      return ComparisonResult::Same;
+    case Type::Boolean:
+      return Compare(value_.boolean, rhs.value_.boolean);
+    case Type::Integer:
+      if (rhs.type_ == Type::Integer) {
+        return Compare(value_.integer, rhs.value_.integer);
+      }
+      // CompareMixedNumber only takes (double, int64_t) so reverse the argument
+      // order and then reverse the result.
+      return util::ReverseOrder(
+          util::CompareMixedNumber(rhs.value_.number, value_.integer));
+    case Type::Double:
+      if (rhs.type_ == Type::Double) {
+        return Compare(value_.number, rhs.value_.number);
+      }
+      return util::CompareMixedNumber(value_.number, rhs.value_.integer);
+    default:
+      UNREACHABLE();
+  }
+}
+
+std::string FieldValue::ToString() const {
+  switch (type_) {
+    case Type::Null:
+      return util::ToString(nullptr);
+    case Type::Boolean:
+      return util::ToString(value_.boolean);
+    case Type::Integer:
+      return util::ToString(value_.integer);
+    case Type::Double:
+      return util::ToString(value_.number);
+    default:
+      return value_.rep->ToString();
+  }
 }
 
 bool operator==(const FieldValue& lhs, const FieldValue& rhs) {
-  return lhs.rep_->Equals(*rhs.rep_);
+  if (lhs.type_ != rhs.type_) return false;
+
+  switch (lhs.type_) {
+    case Type::Null:
+      return true;
+    case Type::Boolean:
+      return lhs.value_.boolean == rhs.value_.boolean;
+    case Type::Integer:
+      return lhs.value_.integer == rhs.value_.integer;
+    case Type::Double:
+      return util::DoubleBitwiseEquals(lhs.value_.number, rhs.value_.number);
+    default:
+      // Copies of a value share its rep.
+      return lhs.value_.rep == rhs.value_.rep ||
+             lhs.value_.rep->Equals(*rhs.value_.rep);
+  }
 }
 
 std::ostream& operator<<(std::ostream& os, const FieldValue& value) {
@@ -17,6 +17,7 @@
 #ifndef FIRESTORE_CORE_SRC_MODEL_FIELD_VALUE_H_
 #define FIRESTORE_CORE_SRC_MODEL_FIELD_VALUE_H_
 
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <iosfwd>
@@ -56,7 +57,12 @@ class FieldValue {
   class Reference;
   class ServerTimestamp;
   using Array = std::vector<FieldValue>;
-  using Map = immutable::SortedMap<std::string, FieldValue>;
+
+  // Most documents have a few dozen fields at most, and arrays are both faster
+  // to search and much faster to iterate than trees at these sizes (see
+  // sorted_map_benchmark.cc), so store maps of up to 32 fields as arrays.
+  using Map = immutable::
+      SortedMap<std::string, FieldValue, util::Comparator<std::string>, 32>;
 
   /**
    * All the different kinds of values that can be stored in fields in
@@ -82,13 +88,21 @@ class FieldValue {
     // position instead, see the doc comment above.
   };
 
-  FieldValue();
+  FieldValue() = default;
 
   FieldValue(const ObjectValue& object);  // NOLINT(runtime/explicit)
 
+  FieldValue(const FieldValue& other);
+  FieldValue(FieldValue&& other) noexcept;
+
+  ~FieldValue();
+
+  FieldValue& operator=(const FieldValue& other);
+  FieldValue& operator=(FieldValue&& other) noexcept;
+
   /** Returns the true type for this value. */
   Type type() const {
-    return rep_->type();
+    return type_;
   }
 
   bool is_boolean() const {
@@ -219,13 +233,9 @@ class FieldValue {
   static FieldValue FromMap(const Map& value);
   static FieldValue FromMap(Map&& value);
 
-  size_t Hash() const {
-    return rep_->Hash();
-  }
+  size_t Hash() const;
 
-  util::ComparisonResult CompareTo(const FieldValue& rhs) const {
-    return rep_->CompareTo(*rhs.rep_);
-  }
+  util::ComparisonResult CompareTo(const FieldValue& rhs) const;
 
   /**
    * Checks if the two values are equal, returning false if the value is
@@ -248,9 +258,7 @@ class FieldValue {
    */
   friend bool operator==(const FieldValue& lhs, const FieldValue& rhs);
 
-  std::string ToString() const {
-    return rep_->ToString();
-  }
+  std::string ToString() const;
 
   friend std::ostream& operator<<(std::ostream& os, const FieldValue& value);
 
@@ -271,18 +279,93 @@ class FieldValue {
 
    protected:
     util::ComparisonResult CompareTypes(const BaseValue& other) const;
+
+   private:
+    friend class FieldValue;
+
+    // The number of FieldValues sharing this value.
+    mutable std::atomic<int32_t> ref_count_{1};
   };
 
  private:
-  explicit FieldValue(std::shared_ptr<BaseValue> rep) : rep_(std::move(rep)) {
+  /** Takes ownership of a newly created value of a heap-allocated type. */
+  explicit FieldValue(std::unique_ptr<BaseValue> rep);
+
+  /**
+   * Returns true if values of the given type are stored inline, rather than in
+   * a shared, heap-allocated BaseValue. These are the first types in `Type`.
+   */
+  static bool IsInline(Type type) {
+    return type <= Type::Double;
   }
 
-  std::shared_ptr<BaseValue> rep_;
+  void Retain() const {
+    if (!IsInline(type_)) {
+      value_.rep->ref_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void Release() {
+    if (!IsInline(type_) &&
+        value_.rep->ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete value_.rep;
+    }
+  }
+
+  // Documents are full of small numbers and flags, so null, booleans, integers
+  // and doubles are stored inline, without any allocation. All other values
+  // are immutable and shared by FieldValues through an intrusive reference
+  // count, which keeps FieldValue to two words.
+  union Storage {
+    BaseValue* rep;
+    bool boolean;
+    int64_t integer;
+    double number;
+  };
+
+  Type type_ = Type::Null;
+  Storage value_{};
 };
 
+inline FieldValue::FieldValue(const FieldValue& other)
+    : type_(other.type_), value_(other.value_) {
+  Retain();
+}
+
+inline FieldValue::FieldValue(FieldValue&& other) noexcept
+    : type_(other.type_), value_(other.value_) {
+  // Moved-from values are left null.
+  other.type_ = Type::Null;
+}
+
+inline FieldValue::~FieldValue() {
+  Release();
+}
+
+inline FieldValue& FieldValue::operator=(const FieldValue& other) {
+  // Retain first, in case of self-assignment.
+  other.Retain();
+  Release();
+  type_ = other.type_;
+  value_ = other.value_;
+  return *this;
+}
+
+inline FieldValue& FieldValue::operator=(FieldValue&& other) noexcept {
+  if (this != &other) {
+    Release();
+    type_ = other.type_;
+    value_ = other.value_;
+    other.type_ = Type::Null;
+  }
+  return *this;
+}
+
 /** A structured object value stored in Firestore. */
 class ObjectValue : public util::Comparable<ObjectValue> {
  public:
+  class Builder;
+
   // Default constructible to make using this easy, though prefer
   // ObjectValue::Empty() to make intentions clear to readers.
   ObjectValue();
@@ -363,6 +446,55 @@ class ObjectValue : public util::Comparable<ObjectValue> {
   FieldValue fv_;
 };
 
+/**
+ * Applies a sequence of `Set` and `Delete` operations to an `ObjectValue`,
+ * with the same result as calling `ObjectValue::Set` and `ObjectValue::Delete`
+ * one after the other, but rebuilding each nested map that changes only once,
+ * in `Build`. Calling `ObjectValue::Set` for many fields instead copies the
+ * path from the root to every field it sets.
+ */
+class ObjectValue::Builder {
+ public:
+  explicit Builder(ObjectValue base);
+  ~Builder();
+
+  Builder(Builder&& other) noexcept;
+  Builder& operator=(Builder&& other) noexcept;
+
+  /** Sets the field at the given non-empty path, like `ObjectValue::Set`. */
+  void Set(const FieldPath& field_path, FieldValue value);
+
+  /**
+   * Deletes the field at the given non-empty path, like `ObjectValue::Delete`.
+   */
+  void Delete(const FieldPath& field_path);
+
+  /** Returns the base object with all the operations so far applied. */
+  ObjectValue Build() const;
+
+ private:
+  struct Node;
+
+  Node* ResetLeaf(const FieldPath& field_path, bool creates_objects);
+
+  /**
+   * Applies the changes to the children of `node` to `entries`, the current
+   * fields of the object `node` describes.
+   */
+  static FieldValue::Map ApplyChildren(const FieldValue::Map& entries,
+                                       const Node& node);
+
+  /**
+   * Returns the new value of the field described by `node`, whose current
+   * value is `current`, or `nullopt` if the field ends up absent.
+   */
+  static absl::optional<FieldValue> ResolveField(const Node& node,
+                                                 const FieldValue* current);
+
+  ObjectValue base_;
+  std::unique_ptr<Node> root_;
+};
+
 class FieldValue::Reference {
  public:
   Reference(DatabaseId database_id, DocumentKey key)
@@ -431,6 +563,16 @@ inline bool operator>=(const FieldValue& lhs, const FieldValue& rhs) {
   return !(lhs < rhs);
 }
 
+/**
+ * Hashes FieldValues consistently with their `operator==`, for use in
+ * unordered containers.
+ */
+struct FieldValueHash {
+  size_t operator()(const FieldValue& value) const {
+    return value.Hash();
+  }
+};
+
 // A bit pattern for our canonical NaN value. Exposed here for testing.
 ABSL_CONST_INIT extern const uint64_t kCanonicalNanBits;
 
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <unordered_map>
 
+#include "Firestore/core/src/immutable/sorted_container.h"
 #include "absl/types/optional.h"
 
 namespace firebase {
@@ -39,7 +40,10 @@ struct Comparator;
 
 namespace immutable {
 
-template <typename K, typename V, typename C>
+template <typename K,
+          typename V,
+          typename C,
+          SortedMapBase::size_type FixedSize>
 class SortedMap;
 
 template <typename K, typename C>
@@ -56,6 +60,7 @@ class DocumentComparator;
 class DocumentKey;
 class DocumentMap;
 class DocumentSet;
+class FieldIndex;
 class FieldMask;
 class FieldPath;
 class FieldTransform;
@@ -69,6 +74,7 @@ class NoDocument;
 class ObjectValue;
 class PatchMutation;
 class Precondition;
+class ResourcePath;
 class SetMutation;
 class SnapshotVersion;
 class TransformOperation;
@@ -87,13 +93,17 @@ using TargetId = int32_t;
 using DocumentKeySet =
     immutable::SortedSet<DocumentKey, util::Comparator<DocumentKey>>;
 
-using MaybeDocumentMap = immutable::
-    SortedMap<DocumentKey, MaybeDocument, util::Comparator<DocumentKey>>;
+using MaybeDocumentMap =
+    immutable::SortedMap<DocumentKey,
+                         MaybeDocument,
+                         util::Comparator<DocumentKey>,
+                         immutable::SortedMapBase::kFixedSize>;
 
 using OptionalMaybeDocumentMap =
     immutable::SortedMap<DocumentKey,
                          absl::optional<MaybeDocument>,
-                         util::Comparator<DocumentKey>>;
+                         util::Comparator<DocumentKey>,
+                         immutable::SortedMapBase::kFixedSize>;
 
 using DocumentVersionMap =
     std::unordered_map<DocumentKey, SnapshotVersion, DocumentKeyHash>;
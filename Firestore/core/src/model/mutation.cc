@@ -133,6 +133,7 @@ std::vector<FieldValue> Mutation::Rep::ServerTransformResults(
               server_transform_results.size(), field_transforms_.size());
 
   std::vector<FieldValue> transform_results;
+  transform_results.reserve(field_transforms_.size());
   for (size_t i = 0; i < server_transform_results.size(); i++) {
     const FieldTransform& field_transform = field_transforms_[i];
     const TransformOperation& transform = field_transform.transformation();
@@ -152,6 +153,7 @@ std::vector<FieldValue> Mutation::Rep::LocalTransformResults(
     const absl::optional<MaybeDocument>& maybe_doc,
     const Timestamp& local_write_time) const {
   std::vector<FieldValue> transform_results;
+  transform_results.reserve(field_transforms_.size());
   for (const FieldTransform& field_transform : field_transforms_) {
     const TransformOperation& transform = field_transform.transformation();
 
@@ -172,12 +174,16 @@ ObjectValue Mutation::Rep::TransformObject(
   HARD_ASSERT(transform_results.size() == field_transforms_.size(),
               "Transform results size mismatch.");
 
+  if (field_transforms_.empty()) {
+    return object_value;
+  }
+
+  ObjectValue::Builder builder{std::move(object_value)};
   for (size_t i = 0; i < field_transforms_.size(); i++) {
     const FieldTransform& field_transform = field_transforms_[i];
-    const FieldPath& field_path = field_transform.path();
-    object_value = object_value.Set(field_path, transform_results[i]);
+    builder.Set(field_transform.path(), transform_results[i]);
   }
-  return object_value;
+  return builder.Build();
 }
 
 bool operator==(const Mutation& lhs, const Mutation& rhs) {
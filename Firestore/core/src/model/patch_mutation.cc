@@ -131,17 +131,18 @@ ObjectValue PatchMutation::Rep::PatchDocument(
 }
 
 ObjectValue PatchMutation::Rep::PatchObject(ObjectValue obj) const {
+  ObjectValue::Builder builder{std::move(obj)};
   for (const FieldPath& path : mask_) {
     if (!path.empty()) {
       absl::optional<FieldValue> new_value = value_.Get(path);
       if (!new_value) {
-        obj = obj.Delete(path);
+        builder.Delete(path);
       } else {
-        obj = obj.Set(path, *new_value);
+        builder.Set(path, *std::move(new_value));
       }
     }
   }
-  return obj;
+  return builder.Build();
 }
 
 bool PatchMutation::Rep::Equals(const Mutation::Rep& other) const {
@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <ostream>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -155,14 +156,6 @@ class ArrayTransform::Rep : public TransformOperation::Rep {
  private:
   friend class ArrayTransform;
 
-  /**
-   * Inspects the provided value, returning a mutable copy of the internal array
-   * if it's of type Array and an empty mutable array if it's nil or any other
-   * type of FieldValue.
-   */
-  static std::vector<model::FieldValue> CoercedFieldValuesArray(
-      const absl::optional<model::FieldValue>& value);
-
   model::FieldValue Apply(
       const absl::optional<model::FieldValue>& previous_value) const;
 
@@ -176,6 +169,14 @@ constexpr bool IsArrayTransform(Type type) {
   return type == Type::ArrayUnion || type == Type::ArrayRemove;
 }
 
+/**
+ * Up to how many element comparisons an array transform does by scanning
+ * arrays, rather than by hashing the elements.
+ */
+constexpr size_t kMaxLinearScanComparisons = 64;
+
+using FieldValueSet = std::unordered_set<FieldValue, FieldValueHash>;
+
 }  // namespace
 
 ArrayTransform::ArrayTransform(Type type,
@@ -230,35 +231,70 @@ std::string ArrayTransform::Rep::ToString() const {
   return absl::StrCat(name, "(", util::ToString(elements_), ")");
 }
 
-FieldValue::Array ArrayTransform::Rep::CoercedFieldValuesArray(
-    const absl::optional<model::FieldValue>& value) {
-  if (value && value->type() == FieldValue::Type::Array) {
-    return value->array_value();
-  } else {
-    // coerce to empty array.
-    return {};
-  }
-}
-
 FieldValue ArrayTransform::Rep::Apply(
     const absl::optional<FieldValue>& previous_value) const {
-  FieldValue::Array result = CoercedFieldValuesArray(previous_value);
-  for (const FieldValue& element : elements_) {
-    auto pos = absl::c_find(result, element);
-    if (type_ == Type::ArrayUnion) {
-      if (pos == result.end()) {
-        result.push_back(element);
+  bool is_array =
+      previous_value && previous_value->type() == FieldValue::Type::Array;
+  const FieldValue::Array empty;
+  const FieldValue::Array& previous =
+      is_array ? previous_value->array_value() : empty;
+
+  // Hashing pays off once both arrays are long; scanning avoids hashing every
+  // element of the previous value for the common single-element transforms.
+  bool use_hashing =
+      previous.size() * elements_.size() > kMaxLinearScanComparisons;
+
+  if (type_ == Type::ArrayUnion) {
+    std::vector<const FieldValue*> added;
+    if (use_hashing) {
+      FieldValueSet seen(previous.begin(), previous.end());
+      for (const FieldValue& element : elements_) {
+        if (seen.insert(element).second) {
+          added.push_back(&element);
+        }
       }
     } else {
-      HARD_ASSERT(type_ == Type::ArrayRemove);
-      for (size_t i = 0; i < result.size();) {
-        if (element == result.at(i)) {
-          result.erase(result.cbegin() + i);
-        } else {
-          ++i;
+      for (const FieldValue& element : elements_) {
+        if (!absl::c_linear_search(previous, element) &&
+            !absl::c_any_of(added, [&element](const FieldValue* other) {
+              return *other == element;
+            })) {
+          added.push_back(&element);
         }
       }
     }
+
+    if (is_array && added.empty()) {
+      return *previous_value;
+    }
+    FieldValue::Array result;
+    result.reserve(previous.size() + added.size());
+    result.insert(result.end(), previous.begin(), previous.end());
+    for (const FieldValue* element : added) {
+      result.push_back(*element);
+    }
+    return FieldValue::FromArray(std::move(result));
+  }
+
+  HARD_ASSERT(type_ == Type::ArrayRemove);
+  FieldValueSet removed;
+  if (use_hashing) {
+    removed.insert(elements_.begin(), elements_.end());
+  }
+  auto is_removed = [&](const FieldValue& value) {
+    return use_hashing ? removed.count(value) > 0
+                       : absl::c_linear_search(elements_, value);
+  };
+
+  if (is_array && absl::c_none_of(previous, is_removed)) {
+    return *previous_value;
+  }
+  FieldValue::Array result;
+  result.reserve(previous.size());
+  for (const FieldValue& value : previous) {
+    if (!is_removed(value)) {
+      result.push_back(value);
+    }
   }
   return FieldValue::FromArray(std::move(result));
 }
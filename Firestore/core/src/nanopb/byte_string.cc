@@ -24,6 +24,7 @@
 #include <sstream>
 
 #include "Firestore/core/src/nanopb/nanopb_util.h"
+#include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/hashing.h"
 #include "Firestore/core/src/util/range.h"
 #include "absl/strings/escaping.h"
@@ -32,14 +33,20 @@ namespace firebase {
 namespace firestore {
 namespace nanopb {
 
-ByteString::ByteString(const pb_bytes_array_t* bytes) {
-  if (bytes != nullptr) {
-    bytes_ = MakeBytesArray(bytes->bytes, bytes->size);
-  }
+namespace {
+
+void FreeBytesArray(pb_bytes_array_t* bytes) {
+  std::free(bytes);
+}
+
+}  // namespace
+
+ByteString::ByteString(const pb_bytes_array_t* bytes)
+    : ByteString(CopyBytesArray(bytes), 0) {
 }
 
 ByteString::ByteString(const void* value, size_t size)
-    : bytes_(MakeBytesArray(value, size)) {
+    : ByteString(MakeBytesArray(value, size), 0) {
 }
 
 ByteString::ByteString(absl::string_view value)
@@ -50,32 +57,35 @@ ByteString::ByteString(std::initializer_list<uint8_t> value)
     : ByteString(value.begin(), value.size()) {
 }
 
-ByteString::ByteString(const ByteString& other)
-    : ByteString(other.data(), other.size()) {
+ByteString::ByteString(pb_bytes_array_t* bytes, int) {
+  if (bytes != nullptr) {
+    bytes_ = std::shared_ptr<const pb_bytes_array_t>(bytes, FreeBytesArray);
+    size_ = bytes->size;
+  }
 }
 
-ByteString::ByteString(ByteString&& other) noexcept {
-  bytes_ = other.bytes_;
-  other.bytes_ = nullptr;
-}
+ByteString::ByteString(const ByteString& other) = default;
 
-ByteString::~ByteString() {
-  std::free(bytes_);
+ByteString::ByteString(ByteString&& other) noexcept
+    : bytes_(std::move(other.bytes_)),
+      offset_(other.offset_),
+      size_(other.size_) {
+  other.offset_ = 0;
+  other.size_ = 0;
 }
 
-ByteString& ByteString::operator=(const ByteString& other) {
-  if (bytes_ != other.bytes_) {
-    std::free(bytes_);
-    bytes_ = MakeBytesArray(other.data(), other.size());
-  }
-  return *this;
-}
+ByteString::~ByteString() = default;
+
+ByteString& ByteString::operator=(const ByteString& other) = default;
 
 ByteString& ByteString::operator=(ByteString&& other) noexcept {
-  if (bytes_ != other.bytes_) {
-    std::free(bytes_);
-    bytes_ = other.bytes_;
-    other.bytes_ = nullptr;
+  if (this != &other) {
+    bytes_ = std::move(other.bytes_);
+    offset_ = other.offset_;
+    size_ = other.size_;
+    other.bytes_.reset();
+    other.offset_ = 0;
+    other.size_ = 0;
   }
   return *this;
 }
@@ -86,20 +96,46 @@ ByteString& ByteString::operator=(ByteString&& other) noexcept {
 
 const uint8_t* ByteString::data() const {
   static const uint8_t kEmpty[] = "";
-  return bytes_ ? bytes_->bytes : kEmpty;
+  return bytes_ ? bytes_->bytes + offset_ : kEmpty;
+}
+
+ByteString ByteString::Slice(size_t offset, size_t size) const {
+  HARD_ASSERT(offset <= size_ && size <= size_ - offset,
+              "Slice [%s, %s) out of bounds of a ByteString of size %s",
+              offset, offset + size, size_);
+  ByteString result;
+  if (size > 0) {
+    result.bytes_ = bytes_;
+    result.offset_ = offset_ + offset;
+    result.size_ = size;
+  }
+  return result;
+}
+
+const pb_bytes_array_t* ByteString::get() const {
+  HARD_ASSERT(!bytes_ || (offset_ == 0 && size_ == bytes_->size),
+              "Cannot get the byte array of a slice of a ByteString");
+  return bytes_.get();
 }
 
 pb_bytes_array_t* ByteString::release() {
-  pb_bytes_array_t* result = bytes_;
-  bytes_ = nullptr;
+  pb_bytes_array_t* result = MakeBytesArray(data(), size());
+  *this = ByteString();
   return result;
 }
 
 void swap(ByteString& lhs, ByteString& rhs) noexcept {
-  std::swap(lhs.bytes_, rhs.bytes_);
+  using std::swap;
+  swap(lhs.bytes_, rhs.bytes_);
+  swap(lhs.offset_, rhs.offset_);
+  swap(lhs.size_, rhs.size_);
 }
 
 util::ComparisonResult ByteString::CompareTo(const ByteString& rhs) const {
+  // Copies share their backing byte array, so they can be compared cheaply.
+  if (bytes_ == rhs.bytes_ && offset_ == rhs.offset_ && size_ == rhs.size_) {
+    return util::ComparisonResult::Same;
+  }
   return util::Compare(MakeStringView(*this), MakeStringView(rhs));
 }
 
@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <initializer_list>
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -35,8 +36,9 @@ namespace nanopb {
 
 /**
  * An immutable string-like object backed by a nanopb byte array. `ByteString`
- * owns its memory, has deep copy semantics, and creates a copy of any input
- * given to its constructors.
+ * creates a copy of any input given to its constructors, but the backing byte
+ * array is reference-counted and never modified, so copies of a `ByteString`
+ * and slices of it made with `Slice()` share the same memory.
  *
  * `ByteString` is similar in spirit to `com.google.protobuf.ByteString`. It
  * serves mostly the same purpose: it's a holder of a byte array that's
@@ -92,15 +94,17 @@ class ByteString : public util::Comparable<ByteString> {
   /**
    * Returns a pointer to the character data backing this `ByteString`. The
    * returned buffer is always non-null, even if the nanopb byte array is null.
+   * Unlike the byte arrays created by `MakeBytesArray`, the data of a slice is
+   * not necessarily null-terminated.
    */
   const uint8_t* data() const;
 
   size_t size() const {
-    return bytes_ ? bytes_->size : 0;
+    return size_;
   }
 
   bool empty() const {
-    return bytes_ == nullptr || bytes_->size == 0;
+    return size_ == 0;
   }
 
   const uint8_t* begin() const {
@@ -112,7 +116,16 @@ class ByteString : public util::Comparable<ByteString> {
   }
 
   /**
-   * Returns a const view of the raw underlying byte array pointer.
+   * Returns a `ByteString` of `size` bytes of this one, starting at `offset`.
+   * The result shares the backing byte array with this `ByteString` instead of
+   * copying it.
+   */
+  ByteString Slice(size_t offset, size_t size) const;
+
+  /**
+   * Returns a const view of the raw underlying byte array pointer. Slices
+   * don't have a byte array of their own, so this must not be called on a
+   * `ByteString` that covers only part of its backing byte array.
    *
    * This value may be null because nanopb (and protobuf generally) treat null
    * and empty byte arrays as equivalent.
@@ -120,13 +133,12 @@ class ByteString : public util::Comparable<ByteString> {
    * For actually reading the data in the buffer, prefer `data()` and `size()`
    * or `begin()` and `end()`, which handle this nullability for you.
    */
-  const pb_bytes_array_t* get() const {
-    return bytes_;
-  }
+  const pb_bytes_array_t* get() const;
 
   /**
-   * Releases ownership of the backing byte array, and returns it to the caller.
-   * The backing byte array is set to null.
+   * Returns a byte array owned by the caller with the contents of this
+   * `ByteString`, and sets this `ByteString` to empty. Since the backing byte
+   * array may be shared, this copies it.
    *
    * This value may be null because nanopb (and protobuf generally) treat null
    * and empty byte arrays as equivalent. Assigning a null value to a nanopb
@@ -151,14 +163,18 @@ class ByteString : public util::Comparable<ByteString> {
 
  private:
   /**
-   * Private constructor directly assigns to bytes_. The extra integer tag
+   * Private constructor that takes ownership of `bytes`. The extra integer tag
    * helps disambiguate this constructor from the public constructor that takes
    * `const pb_bytes_array_t*`.
    */
-  explicit ByteString(pb_bytes_array_t* bytes, int) : bytes_{bytes} {
-  }
+  ByteString(pb_bytes_array_t* bytes, int);
+
+  // The backing byte array, shared by copies and slices. Null if empty.
+  std::shared_ptr<const pb_bytes_array_t> bytes_;
 
-  pb_bytes_array_t* bytes_ = nullptr;
+  // The range of `bytes_` this `ByteString` covers.
+  size_t offset_ = 0;
+  size_t size_ = 0;
 };
 
 }  // namespace nanopb
@@ -91,6 +91,11 @@ inline const pb_field_t* FieldsArray<google_firestore_v1_CommitResponse>() {
   return google_firestore_v1_CommitResponse_fields;
 }
 
+template <>
+inline const pb_field_t* FieldsArray<google_firestore_v1_Document>() {
+  return google_firestore_v1_Document_fields;
+}
+
 template <>
 inline const pb_field_t* FieldsArray<google_firestore_v1_ListenRequest>() {
   return google_firestore_v1_ListenRequest_fields;
@@ -106,6 +111,11 @@ inline const pb_field_t* FieldsArray<google_firestore_v1_RunQueryRequest>() {
   return google_firestore_v1_RunQueryRequest_fields;
 }
 
+template <>
+inline const pb_field_t* FieldsArray<google_firestore_v1_RunQueryResponse>() {
+  return google_firestore_v1_RunQueryResponse_fields;
+}
+
 template <>
 inline const pb_field_t*
 FieldsArray<google_firestore_v1_StructuredQuery_Filter>() {
@@ -163,11 +173,21 @@ inline const pb_field_t* FieldsArray<firestore_NamedQuery>() {
   return firestore_NamedQuery_fields;
 }
 
+template <>
+inline const pb_field_t* FieldsArray<firestore_BundleElement>() {
+  return firestore_BundleElement_fields;
+}
+
 template <>
 inline const pb_field_t* FieldsArray<google_protobuf_Empty>() {
   return google_protobuf_Empty_fields;
 }
 
+template <>
+inline const pb_field_t* FieldsArray<google_rpc_Status>() {
+  return google_rpc_Status_fields;
+}
+
 }  // namespace nanopb
 }  // namespace firestore
 }  // namespace firebase
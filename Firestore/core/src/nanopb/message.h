@@ -200,11 +200,15 @@ Message<T> Message<T>::TryParse(Reader* reader) {
 /**
  * Serializes the given `message` into a `ByteString`.
  *
+ * The message is sized first, so that it's encoded into a single allocation
+ * of exactly the right size.
+ *
  * The lifetime of the return value is entirely independent of the `message`.
  */
 template <typename T>
 ByteString MakeByteString(const Message<T>& message) {
   ByteStringWriter writer;
+  writer.Reserve(CalculateEncodedSize(message.fields(), message.get()));
   writer.Write(message.fields(), message.get());
   return writer.Release();
 }
@@ -212,15 +216,25 @@ ByteString MakeByteString(const Message<T>& message) {
 /**
  * Serializes the given `message` into a `std::string`.
  *
+ * The message is sized first, so that it's encoded into a single allocation
+ * of exactly the right size.
+ *
  * The lifetime of the return value is entirely independent of the `message`.
  */
 template <typename T>
 std::string MakeStdString(const Message<T>& message) {
   StringWriter writer;
+  writer.Reserve(CalculateEncodedSize(message.fields(), message.get()));
   writer.Write(message.fields(), message.get());
   return writer.Release();
 }
 
+/** Returns the number of bytes the given `message` encodes to. */
+template <typename T>
+size_t EncodedSize(const Message<T>& message) {
+  return CalculateEncodedSize(message.fields(), message.get());
+}
+
 }  // namespace nanopb
 }  // namespace firestore
 }  // namespace firebase
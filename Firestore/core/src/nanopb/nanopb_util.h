@@ -53,6 +53,15 @@ pb_bytes_array_t* _Nullable CopyBytesArray(
 pb_bytes_array_t* _Nullable MakeBytesArray(const void* _Nullable data,
                                            size_t size);
 
+/**
+ * Creates a new, null-terminated byte array that's a copy of the given
+ * `ByteString`, or of the slice of its byte array it covers. Returns a null
+ * instance if the given bytes are empty.
+ */
+inline pb_bytes_array_t* _Nullable CopyBytesArray(const ByteString& bytes) {
+  return MakeBytesArray(bytes.data(), bytes.size());
+}
+
 /**
  * Creates a new, null-terminated byte array that's a copy of the given bytes.
  * Returns a null instance if the size of the given vector is zero.
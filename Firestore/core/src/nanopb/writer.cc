@@ -39,6 +39,14 @@ bool AppendToBytesArray(pb_ostream_t* stream,
 
 }  // namespace
 
+size_t CalculateEncodedSize(const pb_field_t* fields, const void* src_struct) {
+  size_t size = 0;
+  if (!pb_get_encoded_size(&size, fields, src_struct)) {
+    HARD_FAIL("Failed to calculate the encoded size of a proto");
+  }
+  return size;
+}
+
 void Writer::Write(const pb_field_t fields[], const void* src_struct) {
   if (!pb_encode(&stream_, fields, src_struct)) {
     HARD_FAIL(PB_GET_ERROR(&stream_));
@@ -31,6 +31,12 @@ namespace firebase {
 namespace firestore {
 namespace nanopb {
 
+/**
+ * Returns the number of bytes the given Nanopb proto encodes to, without
+ * encoding it. This essentially wraps Nanopb's `pb_get_encoded_size()`.
+ */
+size_t CalculateEncodedSize(const pb_field_t* fields, const void* src_struct);
+
 /**
  * Docs TODO(rsgowman). But currently, this just wraps the underlying Nanopb
  * `pb_ostream_t`. All errors are considered fatal.
@@ -130,6 +136,11 @@ class StringWriter : public Writer {
  public:
   StringWriter();
 
+  /** Reserves the given number of bytes of total capacity. */
+  void Reserve(size_t capacity) {
+    buffer_.reserve(capacity);
+  }
+
   /**
    * Returns the string backing this `StringWriter`, taking ownership of its
    * contents.
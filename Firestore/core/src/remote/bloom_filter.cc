@@ -0,0 +1,117 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/bloom_filter.h"
+
+#include <utility>
+
+#include "Firestore/core/src/util/md5.h"
+#include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "Firestore/core/src/util/string_format.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+using util::Md5Digest;
+using util::Status;
+using util::StatusOr;
+using util::StringFormat;
+
+namespace {
+
+uint64_t LoadLittleEndian64(const uint8_t* p) {
+  uint64_t result = 0;
+  for (int i = 7; i >= 0; --i) {
+    result = (result << 8) | p[i];
+  }
+  return result;
+}
+
+}  // namespace
+
+StatusOr<BloomFilter> BloomFilter::Create(std::vector<uint8_t> bitmap,
+                                          int32_t padding,
+                                          int32_t hash_count) {
+  if (padding < 0 || padding >= 8) {
+    return Status(Error::kErrorInvalidArgument,
+                  StringFormat("Invalid padding: %s", padding));
+  }
+  if (hash_count < 0) {
+    return Status(Error::kErrorInvalidArgument,
+                  StringFormat("Invalid hash count: %s", hash_count));
+  }
+  if (bitmap.empty()) {
+    if (padding != 0) {
+      return Status(Error::kErrorInvalidArgument,
+                    StringFormat("Invalid padding when bitmap length is 0: %s",
+                                 padding));
+    }
+  } else if (hash_count == 0) {
+    // Only an empty bloom filter can have 0 hashes.
+    return Status(Error::kErrorInvalidArgument,
+                  StringFormat("Invalid hash count for non-empty bitmap: %s",
+                               hash_count));
+  }
+
+  size_t bit_count = bitmap.size() * 8 - static_cast<size_t>(padding);
+  if (bit_count > static_cast<size_t>(INT32_MAX)) {
+    return Status(Error::kErrorInvalidArgument,
+                  StringFormat("Bitmap too large: %s bytes", bitmap.size()));
+  }
+
+  return BloomFilter(std::move(bitmap), static_cast<int32_t>(bit_count),
+                     hash_count);
+}
+
+BloomFilter::BloomFilter(std::vector<uint8_t> bitmap,
+                         int32_t bit_count,
+                         int32_t hash_count)
+    : bitmap_(std::move(bitmap)),
+      bit_count_(bit_count),
+      hash_count_(hash_count) {
+}
+
+bool BloomFilter::MightContain(absl::string_view value) const {
+  if (bit_count_ == 0) return false;
+
+  Md5Digest digest = util::CalculateMd5Digest(value);
+  uint64_t h1 = LoadLittleEndian64(digest.data());
+  uint64_t h2 = LoadLittleEndian64(digest.data() + 8);
+
+  // Unsigned arithmetic wraps around modulo 2^64, as the backend expects.
+  auto bit_count = static_cast<uint64_t>(bit_count_);
+  for (int32_t i = 0; i < hash_count_; ++i) {
+    uint64_t index = (h1 + static_cast<uint64_t>(i) * h2) % bit_count;
+    if (!IsBitSet(index)) return false;
+  }
+  return true;
+}
+
+bool BloomFilter::IsBitSet(uint64_t index) const {
+  uint8_t byte = bitmap_[index / 8];
+  return (byte & (0x01 << (index % 8))) != 0;
+}
+
+bool operator==(const BloomFilter& lhs, const BloomFilter& rhs) {
+  return lhs.bit_count_ == rhs.bit_count_ &&
+         lhs.hash_count_ == rhs.hash_count_ && lhs.bitmap_ == rhs.bitmap_;
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_REMOTE_BLOOM_FILTER_H_
+#define FIRESTORE_CORE_SRC_REMOTE_BLOOM_FILTER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Firestore/core/src/util/status_fwd.h"
+#include "absl/strings/string_view.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+/**
+ * A bloom filter sent by the backend as part of an existence filter, listing
+ * the documents of a target that have not changed since the resume token.
+ *
+ * Entries are hashed with MD5, and the 128-bit digest is treated as two 64-bit
+ * little-endian unsigned integers `h1` and `h2`. The `i`th bit tested for an
+ * entry is `(h1 + i * h2) % bit_count`, for `i` in `[0, hash_count)`.
+ */
+class BloomFilter {
+ public:
+  /**
+   * Creates a bloom filter from the bits of `bitmap`, ignoring the `padding`
+   * most significant bits of its last byte. Returns an error if the parameters
+   * are inconsistent.
+   */
+  static util::StatusOr<BloomFilter> Create(std::vector<uint8_t> bitmap,
+                                            int32_t padding,
+                                            int32_t hash_count);
+
+  /**
+   * Returns true if `value` might have been added to the filter, false if it
+   * definitely wasn't. An empty filter never contains anything.
+   */
+  bool MightContain(absl::string_view value) const;
+
+  int32_t bit_count() const {
+    return bit_count_;
+  }
+
+  int32_t hash_count() const {
+    return hash_count_;
+  }
+
+  friend bool operator==(const BloomFilter& lhs, const BloomFilter& rhs);
+
+ private:
+  BloomFilter(std::vector<uint8_t> bitmap,
+              int32_t bit_count,
+              int32_t hash_count);
+
+  bool IsBitSet(uint64_t index) const;
+
+  std::vector<uint8_t> bitmap_;
+  int32_t bit_count_ = 0;
+  int32_t hash_count_ = 0;
+};
+
+bool operator==(const BloomFilter& lhs, const BloomFilter& rhs);
+
+inline bool operator!=(const BloomFilter& lhs, const BloomFilter& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_REMOTE_BLOOM_FILTER_H_
@@ -44,6 +44,12 @@ void ConnectivityMonitor::InvokeCallbacks(NetworkStatus new_status) {
   }
 }
 
+void ConnectivityMonitor::InvokeBackgroundCallbacks() {
+  for (auto& callback : background_callbacks_) {
+    callback();
+  }
+}
+
 }  // namespace remote
 }  // namespace firestore
 }  // namespace firebase
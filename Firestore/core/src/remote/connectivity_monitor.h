@@ -47,6 +47,7 @@ class ConnectivityMonitor {
   };
 
   using Callback = std::function<void(NetworkStatus)>;
+  using BackgroundCallback = std::function<void()>;
 
   /** Creates a platform-specific connectivity monitor. */
   static std::unique_ptr<ConnectivityMonitor> Create(
@@ -64,6 +65,14 @@ class ConnectivityMonitor {
   }
   // TODO(varconst): RemoveCallback.
 
+  /**
+   * Adds a callback invoked on the worker queue when the app moves to the
+   * background, on platforms that report it.
+   */
+  void AddBackgroundCallback(BackgroundCallback&& callback) {
+    background_callbacks_.push_back(std::move(callback));
+  }
+
  protected:
   // The status may be retrieved asynchronously.
   void SetInitialStatus(NetworkStatus new_status);
@@ -74,6 +83,9 @@ class ConnectivityMonitor {
   // Invokes callbacks and sets net status to `new_status`.
   void InvokeCallbacks(NetworkStatus new_status);
 
+  // Invokes the callbacks added with `AddBackgroundCallback`.
+  void InvokeBackgroundCallbacks();
+
   const std::shared_ptr<util::AsyncQueue>& queue() {
     return worker_queue_;
   }
@@ -81,6 +93,7 @@ class ConnectivityMonitor {
  private:
   std::shared_ptr<util::AsyncQueue> worker_queue_;
   std::vector<Callback> callbacks_;
+  std::vector<BackgroundCallback> background_callbacks_;
   absl::optional<NetworkStatus> status_;
 };
 
@@ -120,12 +120,21 @@ class ConnectivityMonitorApple : public ConnectivityMonitor {
                 usingBlock:^(NSNotification* note) {
                   this->OnEnteredForeground();
                 }];
+    this->background_observer_ = [[NSNotificationCenter defaultCenter]
+        addObserverForName:UIApplicationDidEnterBackgroundNotification
+                    object:nil
+                     queue:[NSOperationQueue mainQueue]
+                usingBlock:^(NSNotification* note) {
+                  queue()->Enqueue([this] { InvokeBackgroundCallbacks(); });
+                }];
 #endif
   }
 
   ~ConnectivityMonitorApple() {
 #if TARGET_OS_IOS || TARGET_OS_TV
     [[NSNotificationCenter defaultCenter] removeObserver:this->observer_];
+    [[NSNotificationCenter defaultCenter]
+        removeObserver:this->background_observer_];
 #endif
 
     if (reachability_) {
@@ -169,6 +178,7 @@ class ConnectivityMonitorApple : public ConnectivityMonitor {
   SCNetworkReachabilityRef reachability_ = nil;
 #if TARGET_OS_IOS || TARGET_OS_TV
   id<NSObject> observer_ = nil;
+  id<NSObject> background_observer_ = nil;
 #endif
 };
 
@@ -16,6 +16,8 @@
 
 #include "Firestore/core/src/remote/datastore.h"
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <set>
 #include <unordered_set>
 #include <utility>
 
@@ -23,8 +25,13 @@
 #include "Firestore/core/src/auth/credentials_provider.h"
 #include "Firestore/core/src/auth/token.h"
 #include "Firestore/core/src/core/database_info.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/core/target.h"
 #include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/document.h"
 #include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/field_mask.h"
+#include "Firestore/core/src/model/field_path.h"
 #include "Firestore/core/src/model/mutation.h"
 #include "Firestore/core/src/remote/connectivity_monitor.h"
 #include "Firestore/core/src/remote/firebase_metadata_provider.h"
@@ -51,7 +58,11 @@ namespace {
 using auth::CredentialsProvider;
 using auth::Token;
 using core::DatabaseInfo;
+using core::Query;
+using model::Document;
 using model::DocumentKey;
+using model::FieldMask;
+using model::FieldPath;
 using model::MaybeDocument;
 using model::Mutation;
 using util::AsyncQueue;
@@ -62,9 +73,33 @@ using util::StatusOr;
 
 const auto kRpcNameCommit = "/google.firestore.v1.Firestore/Commit";
 const auto kRpcNameLookup = "/google.firestore.v1.Firestore/BatchGetDocuments";
+const auto kRpcNameRunQuery = "/google.firestore.v1.Firestore/RunQuery";
 
-std::unique_ptr<Executor> CreateExecutor() {
-  return Executor::CreateSerial("com.google.firebase.firestore.rpc");
+std::vector<std::unique_ptr<Executor>> CreateExecutors(int count) {
+  std::vector<std::unique_ptr<Executor>> result;
+  for (int i = 0; i < count; ++i) {
+    result.push_back(Executor::CreateSerial("com.google.firebase.firestore.rpc",
+                                            Executor::Priority::UserInitiated));
+  }
+  return result;
+}
+
+std::vector<std::unique_ptr<grpc::CompletionQueue>> CreateGrpcQueues(
+    int count) {
+  std::vector<std::unique_ptr<grpc::CompletionQueue>> result;
+  for (int i = 0; i < count; ++i) {
+    result.push_back(absl::make_unique<grpc::CompletionQueue>());
+  }
+  return result;
+}
+
+std::vector<grpc::CompletionQueue*> GetPointers(
+    const std::vector<std::unique_ptr<grpc::CompletionQueue>>& queues) {
+  std::vector<grpc::CompletionQueue*> result;
+  for (const auto& queue : queues) {
+    result.push_back(queue.get());
+  }
+  return result;
 }
 
 std::string MakeString(grpc::string_ref grpc_str) {
@@ -93,21 +128,28 @@ Datastore::Datastore(const DatabaseInfo& database_info,
                      const std::shared_ptr<AsyncQueue>& worker_queue,
                      std::shared_ptr<CredentialsProvider> credentials,
                      ConnectivityMonitor* connectivity_monitor,
-                     FirebaseMetadataProvider* firebase_metadata_provider)
+                     FirebaseMetadataProvider* firebase_metadata_provider,
+                     int grpc_queue_count)
     : worker_queue_{NOT_NULL(worker_queue)},
       credentials_{std::move(credentials)},
-      rpc_executor_{CreateExecutor()},
+      rpc_executors_{CreateExecutors(grpc_queue_count)},
+      grpc_queues_{CreateGrpcQueues(grpc_queue_count)},
+      completion_stats_{std::make_shared<GrpcCompletionStats>()},
       connectivity_monitor_{connectivity_monitor},
-      grpc_connection_{database_info, worker_queue, &grpc_queue_,
+      grpc_connection_{database_info, worker_queue, GetPointers(grpc_queues_),
                        connectivity_monitor_, firebase_metadata_provider},
       datastore_serializer_{database_info} {
+  HARD_ASSERT(grpc_queue_count > 0, "Invalid gRPC queue count: %s",
+              grpc_queue_count);
   if (!database_info.ssl_enabled()) {
     GrpcConnection::UseInsecureChannel(database_info.host());
   }
 }
 
 void Datastore::Start() {
-  rpc_executor_->Execute([this] { PollGrpcQueue(); });
+  for (size_t i = 0; i != rpc_executors_.size(); ++i) {
+    rpc_executors_[i]->Execute([this, i] { PollGrpcQueue(i); });
+  }
 }
 
 void Datastore::Shutdown() {
@@ -120,42 +162,66 @@ void Datastore::Shutdown() {
 
   // `grpc::CompletionQueue::Next` will only return `false` once `Shutdown` has
   // been called and all submitted tags have been extracted. Without this call,
-  // `rpc_executor_` will never finish.
-  grpc_queue_.Shutdown();
-  // Drain the executor to make sure it extracted all the operations from gRPC
-  // completion queue.
-  rpc_executor_->ExecuteBlocking([] {});
+  // `rpc_executors_` will never finish.
+  for (const auto& grpc_queue : grpc_queues_) {
+    grpc_queue->Shutdown();
+  }
+  // Drain the executors to make sure they extracted all the operations from the
+  // gRPC completion queues.
+  for (const auto& rpc_executor : rpc_executors_) {
+    rpc_executor->ExecuteBlocking([] {});
+  }
+
+  int64_t count = completion_stats_->count();
+  if (count > 0) {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    const GrpcCompletionStats& stats = *completion_stats_;
+    auto total = duration_cast<microseconds>(stats.total_latency());
+    auto max = duration_cast<microseconds>(stats.max_latency());
+    LOG_DEBUG(
+        "Processed %s gRPC completions, waiting %sus on average and at most "
+        "%sus for the worker queue",
+        count, total.count() / count, max.count());
+  }
 }
 
-void Datastore::PollGrpcQueue() {
-  HARD_ASSERT(rpc_executor_->IsCurrentExecutor(),
+void Datastore::PollGrpcQueue(size_t index) {
+  HARD_ASSERT(rpc_executors_[index]->IsCurrentExecutor(),
               "PollGrpcQueue should only be called on the "
               "dedicated Datastore executor");
 
+  grpc::CompletionQueue* grpc_queue = grpc_queues_[index].get();
   void* tag = nullptr;
   bool ok = false;
-  while (grpc_queue_.Next(&tag, &ok)) {
+  while (grpc_queue->Next(&tag, &ok)) {
     auto completion = static_cast<GrpcCompletion*>(tag);
     // While it's valid in principle, we never deliberately pass a null pointer
     // to gRPC completion queue and expect it back. This assertion might be
     // relaxed if necessary.
     HARD_ASSERT(tag, "gRPC queue returned a null tag");
-    completion->Complete(ok);
+    completion->Complete(ok, completion_stats_);
   }
 }
 
 std::shared_ptr<WatchStream> Datastore::CreateWatchStream(
     WatchStreamCallback* callback) {
-  return std::make_shared<WatchStream>(worker_queue_, credentials_,
-                                       datastore_serializer_.serializer(),
-                                       &grpc_connection_, callback);
+  auto stream = std::make_shared<WatchStream>(
+      worker_queue_, credentials_, datastore_serializer_.serializer(),
+      &grpc_connection_, callback);
+  stream->set_metrics(
+      std::shared_ptr<StreamMetrics>(metrics_, &metrics_->watch_stream()));
+  return stream;
 }
 
 std::shared_ptr<WriteStream> Datastore::CreateWriteStream(
     WriteStreamCallback* callback) {
-  return std::make_shared<WriteStream>(worker_queue_, credentials_,
-                                       datastore_serializer_.serializer(),
-                                       &grpc_connection_, callback);
+  auto stream = std::make_shared<WriteStream>(
+      worker_queue_, credentials_, datastore_serializer_.serializer(),
+      &grpc_connection_, callback);
+  stream->set_metrics(
+      std::shared_ptr<StreamMetrics>(metrics_, &metrics_->write_stream()));
+  return stream;
 }
 
 void Datastore::CommitMutations(const std::vector<Mutation>& mutations,
@@ -249,6 +315,103 @@ void Datastore::OnLookupDocumentsResponse(
   callback(datastore_serializer_.MergeLookupResponses(responses));
 }
 
+void Datastore::RunCountQuery(const Query& query, CountCallback&& callback) {
+  ResumeRpcWithCredentials(
+      // TODO(c++14): move into lambda.
+      [this, query, callback](
+          const StatusOr<Token>& maybe_credentials) mutable {
+        if (!maybe_credentials.ok()) {
+          callback(maybe_credentials.status());
+          return;
+        }
+        RunQueryWithCredentials(
+            maybe_credentials.ValueOrDie(), query.ToTarget(),
+            FieldMask{FieldPath::KeyFieldPath()},
+            [this, callback](
+                const StatusOr<std::vector<grpc::ByteBuffer>>& result) {
+              if (result.ok()) {
+                callback(datastore_serializer_.CountQueryResponses(
+                    result.ValueOrDie()));
+              } else {
+                callback(result.status());
+              }
+            });
+      });
+}
+
+void Datastore::RunQuery(const Query& query, RunQueryCallback&& callback) {
+  // Without a projection, ask for all the fields.
+  std::set<FieldPath> fields;
+  if (query.projection()) {
+    fields.insert(query.projection()->begin(), query.projection()->end());
+    for (const core::Filter& filter : query.filters()) {
+      fields.insert(filter.field());
+    }
+    for (const core::OrderBy& order_by : query.order_bys()) {
+      fields.insert(order_by.field());
+    }
+    fields.erase(FieldPath::KeyFieldPath());
+  }
+
+  ResumeRpcWithCredentials(
+      // TODO(c++14): move into lambda.
+      [this, query, fields, callback](
+          const StatusOr<Token>& maybe_credentials) mutable {
+        if (!maybe_credentials.ok()) {
+          callback(maybe_credentials.status());
+          return;
+        }
+        RunQueryWithCredentials(
+            maybe_credentials.ValueOrDie(), query.ToTarget(),
+            FieldMask{std::move(fields)},
+            [this, callback](
+                const StatusOr<std::vector<grpc::ByteBuffer>>& result) {
+              if (!result.ok()) {
+                callback(result.status());
+                return;
+              }
+
+              RunQueryResult query_result;
+              StatusOr<std::vector<Document>> documents =
+                  datastore_serializer_.DecodeRunQueryResponses(
+                      result.ValueOrDie(), &query_result.read_time);
+              if (!documents.ok()) {
+                callback(documents.status());
+                return;
+              }
+              query_result.documents = std::move(documents).ValueOrDie();
+              callback(std::move(query_result));
+            });
+      });
+}
+
+void Datastore::RunQueryWithCredentials(
+    const Token& token,
+    const core::Target& target,
+    const FieldMask& projection,
+    std::function<void(const StatusOr<std::vector<grpc::ByteBuffer>>&)>
+        on_responses) {
+  grpc::ByteBuffer message = MakeByteBuffer(
+      datastore_serializer_.EncodeRunQueryRequest(target, projection));
+
+  std::unique_ptr<GrpcStreamingReader> call_owning =
+      grpc_connection_.CreateStreamingReader(kRpcNameRunQuery, token,
+                                             std::move(message));
+  GrpcStreamingReader* call = call_owning.get();
+  active_calls_.push_back(std::move(call_owning));
+
+  // TODO(c++14): move into lambda.
+  call->Start([this, call, on_responses](
+                  const StatusOr<std::vector<grpc::ByteBuffer>>& result) {
+    LogGrpcCallFinished("RunQuery", call, result.status());
+    HandleCallStatus(result.status());
+
+    on_responses(result);
+
+    RemoveGrpcCall(call);
+  });
+}
+
 void Datastore::ResumeRpcWithCredentials(const OnCredentials& on_credentials) {
   // Auth may outlive Firestore
   std::weak_ptr<Datastore> weak_this{shared_from_this()};
@@ -17,6 +17,8 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_DATASTORE_H_
 #define FIRESTORE_CORE_SRC_REMOTE_DATASTORE_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -25,9 +27,14 @@
 #include "Firestore/core/src/auth/credentials_provider.h"
 #include "Firestore/core/src/auth/token.h"
 #include "Firestore/core/src/core/core_fwd.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/document.h"
 #include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/snapshot_version.h"
 #include "Firestore/core/src/remote/grpc_call.h"
+#include "Firestore/core/src/remote/grpc_completion.h"
 #include "Firestore/core/src/remote/grpc_connection.h"
+#include "Firestore/core/src/remote/network_metrics.h"
 #include "Firestore/core/src/remote/remote_objc_bridge.h"
 #include "Firestore/core/src/remote/watch_stream.h"
 #include "Firestore/core/src/remote/write_stream.h"
@@ -65,18 +72,67 @@ class Datastore : public std::enable_shared_from_this<Datastore> {
   using LookupCallback = std::function<void(
       const util::StatusOr<std::vector<model::MaybeDocument>>&)>;
   using CommitCallback = std::function<void(const util::Status&)>;
+  using CountCallback = std::function<void(const util::StatusOr<int64_t>&)>;
+  /** The documents returned by a `RunQuery` call. */
+  struct RunQueryResult {
+    std::vector<model::Document> documents;
 
+    /** The time the backend read the documents at. */
+    model::SnapshotVersion read_time;
+  };
+
+  using RunQueryCallback =
+      std::function<void(const util::StatusOr<RunQueryResult>&)>;
+
+  /**
+   * @param grpc_queue_count The number of gRPC completion queues to spread
+   *     calls across, each polled by its own thread.
+   */
   Datastore(const core::DatabaseInfo& database_info,
             const std::shared_ptr<util::AsyncQueue>& worker_queue,
             std::shared_ptr<auth::CredentialsProvider> credentials,
             ConnectivityMonitor* connectivity_monitor,
-            FirebaseMetadataProvider* firebase_metadata_provider);
+            FirebaseMetadataProvider* firebase_metadata_provider,
+            int grpc_queue_count = 1);
 
   virtual ~Datastore() = default;
 
-  /** Starts polling the gRPC completion queue. */
+  /**
+   * Sets the algorithm used to compress the messages sent to the backend. Call
+   * before `Start`.
+   */
+  void set_compression_algorithm(grpc_compression_algorithm algorithm) {
+    grpc_connection_.set_compression_algorithm(algorithm);
+  }
+
+  /**
+   * Configures HTTP/2 keepalive pings on the channel. Call before `Start`. See
+   * `GrpcConnection::set_keepalive`.
+   */
+  void set_keepalive(std::chrono::milliseconds keepalive_time,
+                     bool keepalive_without_calls) {
+    grpc_connection_.set_keepalive(keepalive_time, keepalive_without_calls);
+  }
+
+  /**
+   * Sets the jitter used when the streams back off after errors. Call before
+   * creating any streams.
+   */
+  void set_backoff_jitter(ExponentialBackoff::Jitter jitter) {
+    grpc_connection_.set_backoff_jitter(jitter);
+  }
+
+  /**
+   * Starts connecting to the backend ahead of the first call. See
+   * `GrpcConnection::WarmUp`.
+   */
+  void WarmUpConnection() {
+    grpc_connection_.WarmUp();
+  }
+
+  /** Starts polling the gRPC completion queues. */
   void Start();
-  /** Cancels any pending gRPC calls and drains the gRPC completion queue. */
+  /** Cancels any pending gRPC calls and drains the gRPC completion queues. */
   void Shutdown();
 
   /**
@@ -97,6 +153,19 @@ class Datastore : public std::enable_shared_from_this<Datastore> {
   void LookupDocuments(const std::vector<model::DocumentKey>& keys,
                        LookupCallback&& callback);
 
+  /**
+   * Counts the documents on the backend that match the given query, taking its
+   * limit into account.
+   */
+  void RunCountQuery(const core::Query& query, CountCallback&& callback);
+
+  /**
+   * Runs the given query on the backend once, without listening to it. The
+   * backend only sends the fields of a projected query that are needed to
+   * match and sort its results.
+   */
+  void RunQuery(const core::Query& query, RunQueryCallback&& callback);
+
   /** Returns true if the given error is a gRPC ABORTED error. */
   static bool IsAbortedError(const util::Status& status);
 
@@ -126,6 +195,27 @@ class Datastore : public std::enable_shared_from_this<Datastore> {
   static std::string GetAllowlistedHeadersAsString(
       const GrpcCall::Metadata& headers);
 
+  /**
+   * Statistics about how long gRPC completions wait to be processed on the
+   * worker queue once they're taken off their completion queue.
+   */
+  const GrpcCompletionStats& completion_stats() const {
+    return *completion_stats_;
+  }
+
+  /**
+   * Metrics about the network activity of this datastore, updated regardless
+   * of the log level. Can be read from any thread.
+   */
+  const std::shared_ptr<NetworkMetrics>& metrics() const {
+    return metrics_;
+  }
+
+  /** The database this datastore connects to. */
+  const model::DatabaseId& database_id() const {
+    return datastore_serializer_.serializer().database_id();
+  }
+
   Datastore(const Datastore& other) = delete;
   Datastore(Datastore&& other) = delete;
   Datastore& operator=(const Datastore& other) = delete;
@@ -134,7 +224,7 @@ class Datastore : public std::enable_shared_from_this<Datastore> {
  protected:
   /** Test-only method */
   grpc::CompletionQueue* grpc_queue() {
-    return &grpc_queue_;
+    return grpc_queues_.front().get();
   }
   /** Test-only method */
   GrpcCall* LastCall() {
@@ -147,7 +237,7 @@ class Datastore : public std::enable_shared_from_this<Datastore> {
   }
 
  private:
-  void PollGrpcQueue();
+  void PollGrpcQueue(size_t index);
 
   void CommitMutationsWithCredentials(
       const auth::Token& token,
@@ -162,6 +252,17 @@ class Datastore : public std::enable_shared_from_this<Datastore> {
       const util::StatusOr<std::vector<grpc::ByteBuffer>>& result,
       const LookupCallback& callback);
 
+  /**
+   * Runs the query with a streaming read of `RunQuery` and passes the encoded
+   * responses to `on_responses`.
+   */
+  void RunQueryWithCredentials(
+      const auth::Token& token,
+      const core::Target& target,
+      const model::FieldMask& projection,
+      std::function<void(const util::StatusOr<std::vector<grpc::ByteBuffer>>&)>
+          on_responses);
+
   using OnCredentials = std::function<void(const util::StatusOr<auth::Token>&)>;
   void ResumeRpcWithCredentials(const OnCredentials& on_token);
 
@@ -179,10 +280,13 @@ class Datastore : public std::enable_shared_from_this<Datastore> {
   std::shared_ptr<util::AsyncQueue> worker_queue_;
   std::shared_ptr<auth::CredentialsProvider> credentials_;
 
-  // A separate executor dedicated to polling gRPC completion queue (which is
-  // shared for all spawned gRPC streams and calls).
-  std::unique_ptr<util::Executor> rpc_executor_;
-  grpc::CompletionQueue grpc_queue_;
+  // Separate executors dedicated to polling the gRPC completion queues (which
+  // are shared by all spawned gRPC streams and calls), one for each queue.
+  std::vector<std::unique_ptr<util::Executor>> rpc_executors_;
+  std::vector<std::unique_ptr<grpc::CompletionQueue>> grpc_queues_;
+  std::shared_ptr<GrpcCompletionStats> completion_stats_;
+  std::shared_ptr<NetworkMetrics> metrics_ =
+      std::make_shared<NetworkMetrics>();
   ConnectivityMonitor* connectivity_monitor_ = nullptr;
   GrpcConnection grpc_connection_;
 
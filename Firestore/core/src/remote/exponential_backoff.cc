@@ -91,6 +91,20 @@ void ExponentialBackoff::BackoffAndRun(AsyncQueue::Operation&& operation) {
   auto remaining_delay =
       std::max(Milliseconds::zero(), desired_delay_with_jitter - delay_so_far);
 
+  remaining_delay = std::max(remaining_delay, minimum_next_delay_);
+  minimum_next_delay_ = Milliseconds::zero();
+
+  if (shared_state_) {
+    auto now = chr::steady_clock::now();
+    auto shared_delay = chr::duration_cast<Milliseconds>(
+        shared_state_->next_attempt_time - now);
+    remaining_delay = std::max(remaining_delay, shared_delay);
+    if (remaining_delay.count() > 0) {
+      shared_state_->next_attempt_time =
+          std::max(shared_state_->next_attempt_time, now + remaining_delay);
+    }
+  }
+
   if (current_base_.count() > 0) {
     LOG_DEBUG(
         "Backing off for %s ms "
@@ -116,7 +130,8 @@ void ExponentialBackoff::BackoffAndRun(AsyncQueue::Operation&& operation) {
 Milliseconds ExponentialBackoff::GetDelayWithJitter() {
   std::uniform_real_distribution<double> distribution;
   double random_double = distribution(secure_random_);
-  return chr::duration_cast<Milliseconds>((random_double - 0.5) *
+  double offset = jitter_ == Jitter::Full ? 1.0 : 0.5;
+  return chr::duration_cast<Milliseconds>((random_double - offset) *
                                           current_base_);
 }
 
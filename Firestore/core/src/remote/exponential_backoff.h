@@ -19,6 +19,7 @@
 
 #include <chrono>  // NOLINT(build/c++11)
 #include <memory>
+#include <utility>
 
 #include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/secure_random.h"
@@ -38,9 +39,30 @@ namespace remote {
  * added to the base delay. This prevents clients from accidentally
  * synchronizing their delays causing spikes of load to the backend.
  *
+ * Backoffs that retry connections over the same channel can share a
+ * `SharedState`, so that an attempt by one never happens before the delay
+ * another has already chosen; they would otherwise all reconnect right away
+ * after a backend blip, only to fail again.
+ *
  */
 class ExponentialBackoff {
  public:
+  /** How the random part of each delay is chosen. */
+  enum class Jitter {
+    /** The base delay, plus or minus up to half of it. */
+    Proportional,
+    /**
+     * Anywhere between zero and the base delay ("full jitter"), which spreads
+     * out the retries of many clients that failed at the same time the most.
+     */
+    Full,
+  };
+
+  /** The earliest time a retry of any of the sharing backoffs may happen. */
+  struct SharedState {
+    std::chrono::steady_clock::time_point next_attempt_time;
+  };
+
   /**
    * @param queue The queue to run operations on.
    * @param timer_id The id to use when scheduling backoff operations on the
@@ -86,6 +108,22 @@ class ExponentialBackoff {
     current_base_ = max_delay_;
   }
 
+  void set_jitter(Jitter jitter) {
+    jitter_ = jitter;
+  }
+
+  void set_shared_state(std::shared_ptr<SharedState> shared_state) {
+    shared_state_ = std::move(shared_state);
+  }
+
+  /**
+   * Makes the next `BackoffAndRun` wait for at least `delay`, e.g. because the
+   * backend asked to be retried no sooner than that.
+   */
+  void SetMinimumNextDelay(util::AsyncQueue::Milliseconds delay) {
+    minimum_next_delay_ = delay;
+  }
+
   /**
    * Waits for `current_base` seconds (which may be zero), increases the delay
    * and runs the specified operation. If there was a pending operation waiting
@@ -100,7 +138,8 @@ class ExponentialBackoff {
 
  private:
   using Milliseconds = util::AsyncQueue::Milliseconds;
-  // Returns a random value in the range [-current_base_/2, current_base_/2].
+  // Returns a random value in the range [-current_base_/2, current_base_/2], or
+  // in the range [-current_base_, 0] with full jitter.
   Milliseconds GetDelayWithJitter();
   Milliseconds ClampDelay(Milliseconds delay) const;
 
@@ -114,6 +153,10 @@ class ExponentialBackoff {
   const Milliseconds max_delay_;
   util::SecureRandom secure_random_;
   std::chrono::steady_clock::time_point last_attempt_time_;
+
+  Jitter jitter_ = Jitter::Proportional;
+  std::shared_ptr<SharedState> shared_state_;
+  Milliseconds minimum_next_delay_{0};
 };
 
 }  // namespace remote
@@ -25,6 +25,17 @@ namespace remote {
 
 using util::AsyncQueue;
 
+void GrpcCompletionStats::Record(std::chrono::nanoseconds latency) {
+  int64_t nanos = latency.count();
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_latency_nanos_.fetch_add(nanos, std::memory_order_relaxed);
+
+  int64_t max = max_latency_nanos_.load(std::memory_order_relaxed);
+  while (nanos > max && !max_latency_nanos_.compare_exchange_weak(
+                            max, nanos, std::memory_order_relaxed)) {
+  }
+}
+
 std::shared_ptr<GrpcCompletion> GrpcCompletion::Create(
     Type type,
     const std::shared_ptr<util::AsyncQueue>& worker_queue,
@@ -79,22 +90,35 @@ void GrpcCompletion::EnsureValidFuture() {
   }
 }
 
-void GrpcCompletion::Complete(bool ok) {
+void GrpcCompletion::Complete(
+    bool ok, const std::shared_ptr<GrpcCompletionStats>& stats) {
   // This mechanism allows `GrpcStream` to know when the completion is off the
   // gRPC completion queue (and thus no longer requires the underlying gRPC
   // objects to be valid).
   off_queue_.set_value();
 
+  // Decode here, off the worker queue. The decoder only reads `message_`,
+  // which this completion owns, so this doesn't need the gRPC objects either.
+  if (ok && decoder_) {
+    decoded_message_ = decoder_(message_);
+  }
+
   // The queued operation needs to also retain this completion. It's possible
   // for Complete to fire, shutdown to start, and then have this queued
   // operation run. If this weren't a retain that ordering would have the
   // callback use after free.
   auto shared_this = grpc_ownership_;
-  worker_queue_->Enqueue([shared_this, ok] {
-    if (shared_this->callback_) {
-      shared_this->callback_(ok, shared_this);
-    }
-  });
+  auto completed_at = std::chrono::steady_clock::now();
+  worker_queue_->Enqueue(
+      [shared_this, ok, stats, completed_at] {
+        if (stats) {
+          stats->Record(std::chrono::steady_clock::now() - completed_at);
+        }
+        if (shared_this->callback_) {
+          shared_this->callback_(ok, shared_this);
+        }
+      },
+      AsyncQueue::Priority::kNetwork);
 
   // Having called Complete, gRPC has released its ownership interest in this
   // object. Once the queued operation completes the `GrpcCompletion` will be
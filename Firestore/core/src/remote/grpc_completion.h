@@ -17,7 +17,9 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_GRPC_COMPLETION_H_
 #define FIRESTORE_CORE_SRC_REMOTE_GRPC_COMPLETION_H_
 
+#include <atomic>
 #include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
 #include <functional>
 #include <future>  // NOLINT(build/c++11)
 #include <memory>
@@ -31,6 +33,56 @@ namespace firebase {
 namespace firestore {
 namespace remote {
 
+/**
+ * Statistics about how long completions taken off a gRPC completion queue wait
+ * for their callbacks to start running on the worker queue.
+ *
+ * This class is thread-safe.
+ */
+class GrpcCompletionStats {
+ public:
+  void Record(std::chrono::nanoseconds latency);
+
+  /** The number of completions recorded. */
+  int64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  /** The sum of the latencies of all recorded completions. */
+  std::chrono::nanoseconds total_latency() const {
+    return std::chrono::nanoseconds(
+        total_latency_nanos_.load(std::memory_order_relaxed));
+  }
+
+  /** The highest latency of any recorded completion. */
+  std::chrono::nanoseconds max_latency() const {
+    return std::chrono::nanoseconds(
+        max_latency_nanos_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  std::atomic<int64_t> count_{0};
+  std::atomic<int64_t> total_latency_nanos_{0};
+  std::atomic<int64_t> max_latency_nanos_{0};
+};
+
+/**
+ * The result of decoding a message read from a gRPC stream. Subclasses hold
+ * whatever the code that reads the stream decodes the message into.
+ */
+class GrpcDecodedMessage {
+ public:
+  virtual ~GrpcDecodedMessage() = default;
+};
+
+/**
+ * Decodes a message read from a gRPC stream. Decoders run on the thread polling
+ * the gRPC completion queue rather than the worker queue, so they must not
+ * touch any state owned by the worker queue.
+ */
+using GrpcMessageDecoder = std::function<std::unique_ptr<GrpcDecodedMessage>(
+    const grpc::ByteBuffer& message)>;
+
 /**
  * A completion for a gRPC asynchronous operation that runs an arbitrary
  * callback.
@@ -87,12 +139,33 @@ class GrpcCompletion : public std::enable_shared_from_this<GrpcCompletion> {
    *
    * This function deletes the `GrpcCompletion`.
    *
+   * If `stats` is given, the time between this call and the callback starting
+   * to run on the worker queue is recorded in it.
+   *
    * Must be called outside of Firestore async queue.
    */
-  void Complete(bool ok);
+  void Complete(bool ok,
+                const std::shared_ptr<GrpcCompletionStats>& stats = nullptr);
 
   void Cancel();
 
+  /**
+   * Sets a decoder that `Complete` runs on the message read by a successful
+   * operation, before scheduling the callback. Must be called before the
+   * completion is submitted to gRPC.
+   */
+  void SetDecoder(GrpcMessageDecoder decoder) {
+    decoder_ = std::move(decoder);
+  }
+
+  /**
+   * Returns the result of the decoder given to `SetDecoder`, or null if there
+   * was no decoder or the operation failed.
+   */
+  std::unique_ptr<GrpcDecodedMessage> TakeDecodedMessage() {
+    return std::move(decoded_message_);
+  }
+
   /**
    * Blocks until the `GrpcCompletion` comes back from the gRPC completion
    * queue. It is important to only call this function when the `GrpcCompletion`
@@ -152,6 +225,9 @@ class GrpcCompletion : public std::enable_shared_from_this<GrpcCompletion> {
   grpc::ByteBuffer message_;
   grpc::Status status_;
 
+  GrpcMessageDecoder decoder_;
+  std::unique_ptr<GrpcDecodedMessage> decoded_message_;
+
   std::promise<void> off_queue_;
   std::future<void> off_queue_future_;
 
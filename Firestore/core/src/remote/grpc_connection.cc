@@ -19,8 +19,12 @@
 #include <cstdlib>
 
 #include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <functional>
+#include <memory>
 #include <mutex>  // NOLINT(build/c++11)
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "Firestore/core/include/firebase/firestore/firestore_errors.h"
@@ -72,6 +76,25 @@ std::shared_ptr<grpc::ChannelCredentials> CreateSslCredentials(
   return grpc::SslCredentials(options);
 }
 
+/**
+ * Returns the credentials for connecting to the backend with the embedded root
+ * certificates. The certificates are a few hundred kilobytes of PEM, so they
+ * are loaded only once per process, the first time a channel needs them.
+ * Sharing one credentials object between channels also lets gRPC versions that
+ * cache the parsed certificates in it parse them only once.
+ */
+std::shared_ptr<grpc::ChannelCredentials> DefaultSslCredentials() {
+  static std::shared_ptr<grpc::ChannelCredentials> credentials = [] {
+    auto start = std::chrono::steady_clock::now();
+    auto result = CreateSslCredentials(LoadGrpcRootCertificate());
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    LOG_DEBUG("Loaded gRPC root certificates in %s us", elapsed.count());
+    return result;
+  }();
+  return credentials;
+}
+
 class HostConfig {
   using Guard = std::lock_guard<std::mutex>;
 
@@ -159,6 +182,57 @@ HostConfigMap& Config() {
   return *config_by_host;
 }
 
+/**
+ * The gRPC channels in use in the process, keyed by their target and
+ * configuration. Connections to the same backend, e.g. of several Firestore
+ * instances, share one channel and thus one set of TCP/TLS connections.
+ * Channels are released once no connection uses them anymore.
+ */
+class ChannelPool {
+  using Guard = std::lock_guard<std::mutex>;
+
+ public:
+  /**
+   * Returns the live channel for the given key, calling `create` to open one
+   * if there's none.
+   */
+  std::shared_ptr<grpc::Channel> Get(
+      const std::string& key,
+      const std::function<std::shared_ptr<grpc::Channel>()>& create) {
+    Guard guard(mutex_);
+    std::weak_ptr<grpc::Channel>& entry = channels_[key];
+    std::shared_ptr<grpc::Channel> channel = entry.lock();
+    if (!channel ||
+        channel->GetState(/*try_to_connect=*/false) == GRPC_CHANNEL_SHUTDOWN) {
+      channel = create();
+      entry = channel;
+    }
+    return channel;
+  }
+
+  /**
+   * Stops handing out `channel` for the given key, so the next `Get` opens a
+   * new one. Connections still using `channel` are unaffected.
+   */
+  void Evict(const std::string& key,
+             const std::shared_ptr<grpc::Channel>& channel) {
+    Guard guard(mutex_);
+    auto found = channels_.find(key);
+    if (found != channels_.end() && found->second.lock() == channel) {
+      channels_.erase(found);
+    }
+  }
+
+ private:
+  std::unordered_map<std::string, std::weak_ptr<grpc::Channel>> channels_;
+  std::mutex mutex_;
+};
+
+ChannelPool& Channels() {
+  static auto* channels = new ChannelPool();
+  return *channels;
+}
+
 std::string GetCppLanguageToken() {
   const char* cpp_version = [] {
     switch (__cplusplus) {
@@ -234,11 +308,25 @@ GrpcConnection::GrpcConnection(
     grpc::CompletionQueue* grpc_queue,
     ConnectivityMonitor* connectivity_monitor,
     FirebaseMetadataProvider* firebase_metadata_provider)
+    : GrpcConnection(database_info,
+                     worker_queue,
+                     std::vector<grpc::CompletionQueue*>{NOT_NULL(grpc_queue)},
+                     connectivity_monitor,
+                     firebase_metadata_provider) {
+}
+
+GrpcConnection::GrpcConnection(
+    const DatabaseInfo& database_info,
+    const std::shared_ptr<util::AsyncQueue>& worker_queue,
+    std::vector<grpc::CompletionQueue*> grpc_queues,
+    ConnectivityMonitor* connectivity_monitor,
+    FirebaseMetadataProvider* firebase_metadata_provider)
     : database_info_{&database_info},
       worker_queue_{NOT_NULL(worker_queue)},
-      grpc_queue_{NOT_NULL(grpc_queue)},
+      grpc_queues_{std::move(grpc_queues)},
       connectivity_monitor_{NOT_NULL(connectivity_monitor)},
       firebase_metadata_provider_{NOT_NULL(firebase_metadata_provider)} {
+  HARD_ASSERT(!grpc_queues_.empty(), "GrpcConnection needs a gRPC queue");
   RegisterConnectivityMonitor();
 }
 
@@ -251,6 +339,11 @@ void GrpcConnection::Shutdown() {
   }
 }
 
+void GrpcConnection::WarmUp() {
+  EnsureActiveStub();
+  grpc_channel_->GetState(/*try_to_connect=*/true);
+}
+
 std::unique_ptr<grpc::ClientContext> GrpcConnection::CreateContext(
     const Token& credential) const {
   absl::string_view token = credential.user().is_authenticated()
@@ -265,6 +358,10 @@ std::unique_ptr<grpc::ClientContext> GrpcConnection::CreateContext(
   AddCloudApiHeader(*context);
   firebase_metadata_provider_->UpdateMetadata(*context);
 
+  if (compression_algorithm_ != GRPC_COMPRESS_NONE) {
+    context->set_compression_algorithm(compression_algorithm_);
+  }
+
   // This header is used to improve routing and project isolation by the
   // backend.
   const DatabaseId& db_id = database_info_->database_id();
@@ -280,25 +377,39 @@ void GrpcConnection::EnsureActiveStub() {
   if (!grpc_channel_ || grpc_channel_->GetState(/*try_to_connect=*/false) ==
                             GRPC_CHANNEL_SHUTDOWN) {
     LOG_DEBUG("Creating Firestore stub.");
-    grpc_channel_ = CreateChannel();
+    grpc_channel_ =
+        Channels().Get(ChannelKey(), [this] { return CreateChannel(); });
     grpc_stub_ = absl::make_unique<grpc::GenericStub>(grpc_channel_);
   }
 }
 
+std::string GrpcConnection::ChannelKey() const {
+  const std::string& host = database_info_->host();
+  std::string key = absl::StrCat(host, "|", keepalive_time_.count(), "|",
+                                 keepalive_without_calls_);
+
+  const HostConfig* host_config = Config().find(host);
+  if (host_config) {
+    absl::StrAppend(&key, "|", host_config->use_insecure_channel(), "|",
+                    host_config->certificate_path().ToUtf8String(), "|",
+                    host_config->target_name());
+  }
+  return key;
+}
+
 std::shared_ptr<grpc::Channel> GrpcConnection::CreateChannel() const {
   const std::string& host = database_info_->host();
 
   grpc::ChannelArguments args;
-  // Ensure gRPC recovers from a dead connection. (Not typically necessary, as
-  // the OS will usually notify gRPC when a connection dies. But not always.
-  // This acts as a failsafe.)
-  args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, 30 * 1000);
+  args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS,
+              static_cast<int>(keepalive_time_.count()));
+  if (keepalive_without_calls_) {
+    args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+  }
 
   const HostConfig* host_config = Config().find(host);
   if (!host_config) {
-    std::string root_certificate = LoadGrpcRootCertificate();
-    return grpc::CreateCustomChannel(
-        host, CreateSslCredentials(root_certificate), args);
+    return grpc::CreateCustomChannel(host, DefaultSslCredentials(), args);
   }
 
   // For the case when `Settings.set_ssl_enabled(false)`.
@@ -329,7 +440,7 @@ std::unique_ptr<GrpcStream> GrpcConnection::CreateStream(
 
   auto context = CreateContext(token);
   auto call =
-      grpc_stub_->PrepareCall(context.get(), MakeString(rpc_name), grpc_queue_);
+      grpc_stub_->PrepareCall(context.get(), MakeString(rpc_name), NextQueue());
   return absl::make_unique<GrpcStream>(std::move(context), std::move(call),
                                        worker_queue_, this, observer);
 }
@@ -342,7 +453,7 @@ std::unique_ptr<GrpcUnaryCall> GrpcConnection::CreateUnaryCall(
 
   auto context = CreateContext(token);
   auto call = grpc_stub_->PrepareUnaryCall(context.get(), MakeString(rpc_name),
-                                           message, grpc_queue_);
+                                           message, NextQueue());
   return absl::make_unique<GrpcUnaryCall>(std::move(context), std::move(call),
                                           worker_queue_, this, message);
 }
@@ -355,11 +466,17 @@ std::unique_ptr<GrpcStreamingReader> GrpcConnection::CreateStreamingReader(
 
   auto context = CreateContext(token);
   auto call =
-      grpc_stub_->PrepareCall(context.get(), MakeString(rpc_name), grpc_queue_);
+      grpc_stub_->PrepareCall(context.get(), MakeString(rpc_name), NextQueue());
   return absl::make_unique<GrpcStreamingReader>(
       std::move(context), std::move(call), worker_queue_, this, message);
 }
 
+grpc::CompletionQueue* GrpcConnection::NextQueue() {
+  grpc::CompletionQueue* queue = grpc_queues_[next_queue_];
+  next_queue_ = (next_queue_ + 1) % grpc_queues_.size();
+  return queue;
+}
+
 void GrpcConnection::RegisterConnectivityMonitor() {
   connectivity_monitor_->AddCallback(
       [this](ConnectivityMonitor::NetworkStatus /*ignored*/) {
@@ -374,6 +491,11 @@ void GrpcConnection::RegisterConnectivityMonitor() {
         // connection before eventually failing. Note that gRPC Objective-C
         // client does the same thing:
         // https://github.com/grpc/grpc/blob/fe11db09575f2dfbe1f88cd44bd417acc168e354/src/objective-c/GRPCClient/private/GRPCHost.m#L309-L314
+        // Other connections sharing the channel drop it when they're notified
+        // in turn.
+        if (grpc_channel_) {
+          Channels().Evict(ChannelKey(), grpc_channel_);
+        }
         grpc_channel_.reset();
       });
 }
@@ -17,6 +17,7 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_GRPC_CONNECTION_H_
 #define FIRESTORE_CORE_SRC_REMOTE_GRPC_CONNECTION_H_
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -25,6 +26,7 @@
 #include "Firestore/core/src/auth/token.h"
 #include "Firestore/core/src/core/database_info.h"
 #include "Firestore/core/src/remote/connectivity_monitor.h"
+#include "Firestore/core/src/remote/exponential_backoff.h"
 #include "Firestore/core/src/remote/grpc_call.h"
 #include "Firestore/core/src/remote/grpc_stream.h"
 #include "Firestore/core/src/remote/grpc_stream_observer.h"
@@ -63,8 +65,68 @@ class GrpcConnection {
                  ConnectivityMonitor* connectivity_monitor,
                  FirebaseMetadataProvider* firebase_metadata_provider);
 
+  /**
+   * Creates a connection whose calls are spread across the given completion
+   * queues, round-robin. All operations of any one call go through the same
+   * queue.
+   */
+  GrpcConnection(const core::DatabaseInfo& database_info,
+                 const std::shared_ptr<util::AsyncQueue>& worker_queue,
+                 std::vector<grpc::CompletionQueue*> grpc_queues,
+                 ConnectivityMonitor* connectivity_monitor,
+                 FirebaseMetadataProvider* firebase_metadata_provider);
+
   void Shutdown();
 
+  /**
+   * Creates the gRPC channel, if it doesn't exist yet, and asks it to start
+   * connecting (name resolution and the TCP and TLS handshakes) without waiting
+   * for the first call to need it.
+   */
+  void WarmUp();
+
+  /**
+   * Sets the algorithm used to compress the messages sent by calls created
+   * from now on. Whether responses are compressed is up to the backend; the
+   * client always advertises the algorithms it supports.
+   */
+  void set_compression_algorithm(grpc_compression_algorithm algorithm) {
+    compression_algorithm_ = algorithm;
+  }
+
+  /**
+   * Sets how often gRPC sends HTTP/2 keepalive pings on the channel, and
+   * whether it keeps sending them while no streams or calls are active. Pinging
+   * an idle channel keeps the connection (and its TLS session) alive across
+   * idle stream closes, at the cost of some traffic; the backend may close
+   * connections that ping too often. Takes effect for channels created from
+   * now on.
+   */
+  void set_keepalive(std::chrono::milliseconds keepalive_time,
+                     bool keepalive_without_calls) {
+    keepalive_time_ = keepalive_time;
+    keepalive_without_calls_ = keepalive_without_calls;
+  }
+
+  /**
+   * Sets the jitter used by the backoffs of the streams created from now on.
+   */
+  void set_backoff_jitter(ExponentialBackoff::Jitter jitter) {
+    backoff_jitter_ = jitter;
+  }
+  ExponentialBackoff::Jitter backoff_jitter() const {
+    return backoff_jitter_;
+  }
+
+  /**
+   * The state shared by the backoffs of all streams on this connection, which
+   * keeps them from reconnecting before any of them has decided to.
+   */
+  const std::shared_ptr<ExponentialBackoff::SharedState>& backoff_state()
+      const {
+    return backoff_state_;
+  }
+
   /**
    * Creates a stream to the given stream RPC endpoint. The resulting stream
    * needs to be `Start`ed before it can be used.
@@ -107,14 +169,23 @@ class GrpcConnection {
  private:
   std::unique_ptr<grpc::ClientContext> CreateContext(
       const auth::Token& credential) const;
+  /**
+   * Identifies the configuration of the channel this connection uses, so that
+   * connections with the same configuration share a channel.
+   */
+  std::string ChannelKey() const;
   std::shared_ptr<grpc::Channel> CreateChannel() const;
   void EnsureActiveStub();
 
   void RegisterConnectivityMonitor();
 
+  /** Returns the completion queue to use for the next call. */
+  grpc::CompletionQueue* NextQueue();
+
   const core::DatabaseInfo* database_info_ = nullptr;
   std::shared_ptr<util::AsyncQueue> worker_queue_;
-  grpc::CompletionQueue* grpc_queue_ = nullptr;
+  std::vector<grpc::CompletionQueue*> grpc_queues_;
+  size_t next_queue_ = 0;
 
   std::shared_ptr<grpc::Channel> grpc_channel_;
   std::unique_ptr<grpc::GenericStub> grpc_stub_;
@@ -123,6 +194,19 @@ class GrpcConnection {
   std::vector<GrpcCall*> active_calls_;
 
   FirebaseMetadataProvider* firebase_metadata_provider_ = nullptr;
+
+  grpc_compression_algorithm compression_algorithm_ = GRPC_COMPRESS_NONE;
+
+  // Ensure gRPC recovers from a dead connection. (Not typically necessary, as
+  // the OS will usually notify gRPC when a connection dies. But not always.
+  // This acts as a failsafe.)
+  std::chrono::milliseconds keepalive_time_{30 * 1000};
+  bool keepalive_without_calls_ = false;
+
+  ExponentialBackoff::Jitter backoff_jitter_ =
+      ExponentialBackoff::Jitter::Proportional;
+  std::shared_ptr<ExponentialBackoff::SharedState> backoff_state_ =
+      std::make_shared<ExponentialBackoff::SharedState>();
 };
 
 }  // namespace remote
@@ -21,6 +21,7 @@
 #include "Firestore/core/include/firebase/firestore/firestore_errors.h"
 #include "Firestore/core/src/nanopb/writer.h"
 #include "Firestore/core/src/remote/grpc_util.h"
+#include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/status.h"
 #include "grpcpp/support/status.h"
 
@@ -33,6 +34,11 @@ using nanopb::ByteStringWriter;
 using util::Status;
 
 ByteBufferReader::ByteBufferReader(const grpc::ByteBuffer& buffer) {
+  if (buffer.TrySingleSlice(&slice_).ok()) {
+    stream_ = pb_istream_from_buffer(slice_.begin(), slice_.size());
+    return;
+  }
+
   std::vector<grpc::Slice> slices;
   grpc::Status status = buffer.Dump(&slices);
   // Conversion may fail if compression is used and gRPC tries to decompress an
@@ -87,6 +93,22 @@ grpc::ByteBuffer ByteBufferWriter::Release() {
   return result;
 }
 
+grpc::ByteBuffer MakeByteBuffer(const pb_field_t* fields,
+                                const void* src_struct) {
+  // Encoding straight into one slice avoids the slice per write that
+  // `ByteBufferWriter` creates.
+  size_t size = nanopb::CalculateEncodedSize(fields, src_struct);
+  grpc_slice bytes = grpc_slice_malloc(size);
+  grpc::Slice slice{bytes, grpc::Slice::STEAL_REF};
+
+  pb_ostream_t stream =
+      pb_ostream_from_buffer(GRPC_SLICE_START_PTR(bytes), size);
+  if (!pb_encode(&stream, fields, src_struct)) {
+    HARD_FAIL(PB_GET_ERROR(&stream));
+  }
+  return grpc::ByteBuffer{&slice, 1};
+}
+
 }  // namespace remote
 }  // namespace firestore
 }  // namespace firebase
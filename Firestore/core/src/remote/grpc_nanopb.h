@@ -27,6 +27,7 @@
 #include "Firestore/core/src/nanopb/reader.h"
 #include "Firestore/core/src/nanopb/writer.h"
 #include "grpcpp/support/byte_buffer.h"
+#include "grpcpp/support/slice.h"
 
 namespace firebase {
 namespace firestore {
@@ -36,15 +37,19 @@ namespace remote {
 class ByteBufferReader : public nanopb::Reader {
  public:
   /**
-   * Copies the given `buffer` and associates the resulting stream with this
+   * Associates the contents of the given `buffer` with this
    * `ByteBufferReader`.
+   *
+   * Buffers backed by a single slice, which is how most responses arrive, are
+   * decoded in place; the reader shares ownership of the slice. Other buffers
+   * are copied into contiguous memory first.
    */
-  // TODO(varconst): avoid copying the buffer.
   explicit ByteBufferReader(const grpc::ByteBuffer& buffer);
 
   void Read(const pb_field_t* fields, void* dest_struct) override;
 
  private:
+  grpc::Slice slice_;
   nanopb::ByteString bytes_;
   pb_istream_t stream_{};
 };
@@ -60,6 +65,13 @@ class ByteBufferWriter : public nanopb::Writer {
   std::vector<grpc::Slice> buffer_;
 };
 
+/**
+ * Serializes the given Nanopb proto into a `grpc::ByteBuffer` backed by a
+ * single slice of exactly the encoded size.
+ */
+grpc::ByteBuffer MakeByteBuffer(const pb_field_t* fields,
+                                const void* src_struct);
+
 /**
  * Serializes the given `message` into a `grpc::ByteBuffer`.
  *
@@ -67,9 +79,7 @@ class ByteBufferWriter : public nanopb::Writer {
  */
 template <typename T>
 grpc::ByteBuffer MakeByteBuffer(const nanopb::Message<T>& message) {
-  ByteBufferWriter writer;
-  writer.Write(message.fields(), message.get());
-  return writer.Release();
+  return MakeByteBuffer(message.fields(), message.get());
 }
 
 }  // namespace remote
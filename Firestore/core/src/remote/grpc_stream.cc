@@ -131,8 +131,11 @@ void GrpcStream::Read() {
 
   auto completion = NewCompletion(
       Type::Read, [this](const std::shared_ptr<GrpcCompletion>& completion) {
-        OnRead(*completion->message());
+        OnRead(completion.get());
       });
+  if (message_decoder_) {
+    completion->SetDecoder(message_decoder_);
+  }
   call_->Read(completion->message(), completion.get());
 }
 
@@ -156,6 +159,8 @@ void GrpcStream::MaybeWrite(absl::optional<BufferedWrite> maybe_write) {
       Type::Write,
       [this](const std::shared_ptr<GrpcCompletion>&) { OnWrite(); });
   *completion->message() = write.message;
+  bytes_written_ += write.message.Length();
+  metrics_->RecordMessageSent(write.message.Length());
 
   call_->Write(*completion->message(), write.options, completion.get());
 }
@@ -184,6 +189,8 @@ void GrpcStream::FinishAndNotify(const Status& status) {
 void GrpcStream::Shutdown() {
   LOG_DEBUG("GrpcStream('%s'): shutting down; completions: %s, is finished: %s",
             this, completions_.size(), is_grpc_call_finished_);
+  LOG_DEBUG("GrpcStream('%s'): wrote %s and read %s bytes of messages", this,
+            bytes_written_, bytes_read_);
 
   MaybeUnregister();
 
@@ -272,6 +279,8 @@ bool GrpcStream::TryLastWrite(grpc::ByteBuffer&& message) {
   BufferedWrite last_write = std::move(maybe_write).value();
   auto completion = NewCompletion(Type::Write, {});
   *completion->message() = last_write.message;
+  bytes_written_ += last_write.message.Length();
+  metrics_->RecordMessageSent(last_write.message.Length());
   call_->WriteLast(*completion->message(), grpc::WriteOptions{},
                    completion.get());
 
@@ -292,14 +301,20 @@ GrpcStream::Metadata GrpcStream::GetResponseHeaders() const {
 
 // Callbacks
 
-void GrpcStream::OnRead(const grpc::ByteBuffer& message) {
+void GrpcStream::OnRead(GrpcCompletion* completion) {
+  bytes_read_ += completion->message()->Length();
+  metrics_->RecordMessageReceived(completion->message()->Length());
   if (observer_) {
     // Continue waiting for new messages indefinitely as long as there is an
     // interested observer.
     // Order is important here -- any call to observer can potentially end this
     // stream's lifetime, so call `Read` before notifying.
     Read();
-    observer_->OnStreamRead(message);
+    if (message_decoder_) {
+      observer_->OnStreamDecodedRead(completion->TakeDecodedMessage());
+    } else {
+      observer_->OnStreamRead(*completion->message());
+    }
   }
 }
 
@@ -319,6 +334,7 @@ void GrpcStream::OnOperationFailed() {
 
   FinishGrpcCall([this](const std::shared_ptr<GrpcCompletion>& completion) {
     Status status = ConvertStatus(*completion->status());
+    retry_delay_ = GetRetryDelay(*completion->status());
     FinishAndNotify(status);
   });
 }
@@ -17,6 +17,8 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_GRPC_STREAM_H_
 #define FIRESTORE_CORE_SRC_REMOTE_GRPC_STREAM_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstddef>
 #include <functional>
 #include <map>
 #include <memory>
@@ -28,6 +30,7 @@
 #include "Firestore/core/src/remote/grpc_call.h"
 #include "Firestore/core/src/remote/grpc_completion.h"
 #include "Firestore/core/src/remote/grpc_stream_observer.h"
+#include "Firestore/core/src/remote/network_metrics.h"
 #include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/status_fwd.h"
 #include "Firestore/core/src/util/warnings.h"
@@ -71,6 +74,13 @@ struct BufferedWrite {
  *
  * This class exists to help Firestore streams adhere to the gRPC requirement
  * that only one write operation may be active at any given time.
+ *
+ * Queued writes are deliberately not issued with the buffer hint
+ * (`grpc::WriteOptions::set_buffer_hint`, also known as "corked" writes). gRPC
+ * may hold a hinted write until a later write flushes it and only completes
+ * it then, yet the later write can't be issued until the hinted one completes.
+ * Each message is a separate gRPC message on the wire, so queued writes can't
+ * be merged either.
  */
 class BufferedWriter {
  public:
@@ -131,6 +141,24 @@ class GrpcStream : public GrpcCall {
 
   void Start();
 
+  /**
+   * Makes the stream decode the messages it reads on the thread polling the
+   * gRPC completion queue, and deliver them to the observer's
+   * `OnStreamDecodedRead` instead of `OnStreamRead`. Messages are still
+   * delivered in the order they were read. Must be called before `Start`.
+   */
+  void SetMessageDecoder(GrpcMessageDecoder decoder) {
+    message_decoder_ = std::move(decoder);
+  }
+
+  /**
+   * Makes the stream count the messages it writes and reads in the given
+   * metrics, in addition to its own `bytes_written` and `bytes_read`.
+   */
+  void SetMetrics(std::shared_ptr<StreamMetrics> metrics) {
+    metrics_ = std::move(metrics);
+  }
+
   // Can only be called once the stream has opened.
   void Write(grpc::ByteBuffer&& message);
 
@@ -176,6 +204,30 @@ class GrpcStream : public GrpcCall {
    */
   Metadata GetResponseHeaders() const override;
 
+  /**
+   * The total size of the messages written to the stream so far, before any
+   * compression.
+   */
+  size_t bytes_written() const {
+    return bytes_written_;
+  }
+
+  /**
+   * The total size of the messages read from the stream so far, after any
+   * decompression.
+   */
+  size_t bytes_read() const {
+    return bytes_read_;
+  }
+
+  /**
+   * How long the backend asked to wait before retrying, if the stream failed
+   * with an error that says so.
+   */
+  const absl::optional<std::chrono::milliseconds>& retry_delay() const {
+    return retry_delay_;
+  }
+
   /** For tests only */
   grpc::ClientContext* context() override {
     return context_.get();
@@ -193,7 +245,7 @@ class GrpcStream : public GrpcCall {
   void MaybeUnregister();
 
   void OnStart();
-  void OnRead(const grpc::ByteBuffer& message);
+  void OnRead(GrpcCompletion* completion);
   void OnWrite();
   void OnOperationFailed();
   void RemoveCompletion(const std::shared_ptr<GrpcCompletion>& to_remove);
@@ -233,12 +285,18 @@ class GrpcStream : public GrpcCall {
   GrpcConnection* grpc_connection_ = nullptr;
 
   GrpcStreamObserver* observer_ = nullptr;
+  GrpcMessageDecoder message_decoder_;
   internal::BufferedWriter buffered_writer_;
 
   std::vector<std::shared_ptr<GrpcCompletion>> completions_;
 
   // gRPC asserts that a call is finished exactly once.
   bool is_grpc_call_finished_ = false;
+
+  size_t bytes_written_ = 0;
+  size_t bytes_read_ = 0;
+  absl::optional<std::chrono::milliseconds> retry_delay_;
+  std::shared_ptr<StreamMetrics> metrics_ = std::make_shared<StreamMetrics>();
 };
 
 }  // namespace remote
@@ -17,6 +17,9 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_GRPC_STREAM_OBSERVER_H_
 #define FIRESTORE_CORE_SRC_REMOTE_GRPC_STREAM_OBSERVER_H_
 
+#include <memory>
+
+#include "Firestore/core/src/remote/grpc_completion.h"
 #include "Firestore/core/src/util/status_fwd.h"
 #include "grpcpp/support/byte_buffer.h"
 
@@ -33,6 +36,13 @@ class GrpcStreamObserver {
   virtual void OnStreamStart() = 0;
   // A message has been received from the server.
   virtual void OnStreamRead(const grpc::ByteBuffer& message) = 0;
+
+  // A message has been received from the server and decoded off the worker
+  // queue by the decoder given to `GrpcStream::SetMessageDecoder`. Only called
+  // if the stream has a decoder.
+  virtual void OnStreamDecodedRead(
+      std::unique_ptr<GrpcDecodedMessage> message) {
+  }
   // Connection has been broken, perhaps by the server.
   virtual void OnStreamFinish(const util::Status& status) = 0;
 };
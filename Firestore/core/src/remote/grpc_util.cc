@@ -16,15 +16,79 @@
 
 #include "Firestore/core/src/remote/grpc_util.h"
 
+#include <pb_decode.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "Firestore/Protos/nanopb/google/protobuf/timestamp.nanopb.h"
+#include "Firestore/Protos/nanopb/google/rpc/status.nanopb.h"
+#include "Firestore/core/src/nanopb/fields_array.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/nanopb/nanopb_util.h"
+#include "Firestore/core/src/nanopb/reader.h"
 #include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/status.h"
 
 namespace firebase {
 namespace firestore {
 namespace remote {
+namespace {
+
+namespace chr = std::chrono;
 
+using nanopb::MakeStringView;
+using nanopb::Message;
+using nanopb::StringReader;
 using util::Status;
 
+const char* const kRetryInfoTypeUrl =
+    "type.googleapis.com/google.rpc.RetryInfo";
+
+/**
+ * Decodes the `retry_delay` of a serialized `google.rpc.RetryInfo`.
+ *
+ * `RetryInfo` isn't among the generated protos. It consists of a single
+ * `google.protobuf.Duration retry_delay = 1`, and `Duration` has the same
+ * fields as `Timestamp`, so the outer message is decoded by hand.
+ */
+absl::optional<chr::milliseconds> DecodeRetryInfo(
+    const pb_bytes_array_t* bytes) {
+  if (!bytes) return absl::nullopt;
+
+  pb_istream_t stream = pb_istream_from_buffer(bytes->bytes, bytes->size);
+  pb_wire_type_t wire_type;
+  uint32_t tag = 0;
+  bool eof = false;
+  while (pb_decode_tag(&stream, &wire_type, &tag, &eof)) {
+    if (tag != 1 || wire_type != PB_WT_STRING) {
+      if (!pb_skip_field(&stream, wire_type)) break;
+      continue;
+    }
+
+    uint64_t length = 0;
+    if (!pb_decode_varint(&stream, &length) || length > stream.bytes_left) {
+      break;
+    }
+    size_t offset = bytes->size - stream.bytes_left;
+    pb_istream_t duration_stream = pb_istream_from_buffer(
+        bytes->bytes + offset, static_cast<size_t>(length));
+
+    google_protobuf_Timestamp duration{};
+    if (!pb_decode(&duration_stream, google_protobuf_Timestamp_fields,
+                   &duration)) {
+      break;
+    }
+    auto delay = chr::duration_cast<chr::milliseconds>(
+        chr::seconds(duration.seconds) + chr::nanoseconds(duration.nanos));
+    return std::max(delay, chr::milliseconds::zero());
+  }
+  return absl::nullopt;
+}
+
+}  // namespace
+
 Status ConvertStatus(const grpc::Status& from) {
   if (from.ok()) {
     return Status::OK();
@@ -43,6 +107,23 @@ Status ConvertStatus(const grpc::Status& from) {
   return {static_cast<Error>(error_code), from.error_message()};
 }
 
+absl::optional<chr::milliseconds> GetRetryDelay(const grpc::Status& status) {
+  const std::string& details = status.error_details();
+  if (status.ok() || details.empty()) return absl::nullopt;
+
+  StringReader reader(details);
+  auto proto = Message<google_rpc_Status>::TryParse(&reader);
+  if (!reader.ok()) return absl::nullopt;
+
+  for (pb_size_t i = 0; i != proto->details_count; ++i) {
+    const google_protobuf_Any& detail = proto->details[i];
+    if (MakeStringView(detail.type_url) == kRetryInfoTypeUrl) {
+      return DecodeRetryInfo(detail.value);
+    }
+  }
+  return absl::nullopt;
+}
+
 }  // namespace remote
 }  // namespace firestore
 }  // namespace firebase
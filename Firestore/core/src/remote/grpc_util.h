@@ -17,7 +17,10 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_GRPC_UTIL_H_
 #define FIRESTORE_CORE_SRC_REMOTE_GRPC_UTIL_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+
 #include "Firestore/core/src/util/status_fwd.h"
+#include "absl/types/optional.h"
 #include "grpcpp/support/status.h"
 
 namespace firebase {
@@ -26,6 +29,13 @@ namespace remote {
 
 util::Status ConvertStatus(const grpc::Status& from);
 
+/**
+ * Returns how long the backend asked the client to wait before retrying, if
+ * the details of the given error contain a `google.rpc.RetryInfo`.
+ */
+absl::optional<std::chrono::milliseconds> GetRetryDelay(
+    const grpc::Status& status);
+
 }  // namespace remote
 }  // namespace firestore
 }  // namespace firebase
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/network_metrics.h"
+
+#include <algorithm>
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+constexpr size_t LatencyHistogram::kBucketCount;
+
+void LatencyHistogram::Record(Duration duration) {
+  int64_t micros = std::max<int64_t>(duration.count(), 0);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_micros_.fetch_add(micros, std::memory_order_relaxed);
+
+  size_t bucket = 0;
+  while (bucket + 1 < kBucketCount && micros >= (int64_t{1} << bucket)) {
+    ++bucket;
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Duration LatencyHistogram::BucketUpperBound(size_t bucket) {
+  if (bucket + 1 >= kBucketCount) return Duration::max();
+  return Duration(int64_t{1} << bucket);
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
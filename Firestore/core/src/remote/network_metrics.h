@@ -0,0 +1,328 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_REMOTE_NETWORK_METRICS_H_
+#define FIRESTORE_CORE_SRC_REMOTE_NETWORK_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstddef>
+#include <cstdint>
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+/**
+ * A histogram of durations with power-of-two buckets: bucket `i` counts the
+ * durations shorter than `2^i` microseconds that didn't fit in any earlier
+ * bucket, and the last bucket counts everything longer.
+ *
+ * This class is thread-safe.
+ */
+class LatencyHistogram {
+ public:
+  using Duration = std::chrono::microseconds;
+
+  static constexpr size_t kBucketCount = 32;
+
+  void Record(Duration duration);
+
+  /** The number of durations recorded. */
+  int64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  /** The sum of all recorded durations. */
+  Duration total() const {
+    return Duration(total_micros_.load(std::memory_order_relaxed));
+  }
+
+  /** The number of recorded durations that fell into the given bucket. */
+  int64_t bucket_count(size_t bucket) const {
+    return buckets_[bucket].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The exclusive upper bound of the given bucket. The last bucket has no upper
+   * bound; `Duration::max()` is returned for it.
+   */
+  static Duration BucketUpperBound(size_t bucket);
+
+ private:
+  std::atomic<int64_t> count_{0};
+  std::atomic<int64_t> total_micros_{0};
+  std::array<std::atomic<int64_t>, kBucketCount> buckets_{};
+};
+
+/**
+ * Counters for one kind of stream (watch or write), accumulated over all the
+ * connections it made.
+ *
+ * This class is thread-safe.
+ */
+class StreamMetrics {
+ public:
+  void RecordMessageSent(size_t bytes) {
+    messages_sent_.fetch_add(1, std::memory_order_relaxed);
+    bytes_sent_.fetch_add(static_cast<int64_t>(bytes),
+                          std::memory_order_relaxed);
+  }
+
+  void RecordMessageReceived(size_t bytes) {
+    messages_received_.fetch_add(1, std::memory_order_relaxed);
+    bytes_received_.fetch_add(static_cast<int64_t>(bytes),
+                              std::memory_order_relaxed);
+  }
+
+  void RecordOpen() {
+    opens_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void RecordError() {
+    errors_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void RecordBackoff() {
+    backoffs_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /** The number of messages written to the stream. */
+  int64_t messages_sent() const {
+    return messages_sent_.load(std::memory_order_relaxed);
+  }
+
+  /** The number of messages read from the stream. */
+  int64_t messages_received() const {
+    return messages_received_.load(std::memory_order_relaxed);
+  }
+
+  /** The size of the messages written, before compression. */
+  int64_t bytes_sent() const {
+    return bytes_sent_.load(std::memory_order_relaxed);
+  }
+
+  /** The size of the messages read, after decompression. */
+  int64_t bytes_received() const {
+    return bytes_received_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The number of times the stream opened. Every open after the first is a
+   * reconnect.
+   */
+  int64_t opens() const {
+    return opens_.load(std::memory_order_relaxed);
+  }
+
+  /** The number of times the stream closed with an error. */
+  int64_t errors() const {
+    return errors_.load(std::memory_order_relaxed);
+  }
+
+  /** The number of times the stream backed off before restarting. */
+  int64_t backoffs() const {
+    return backoffs_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * How long decoding each message read from the stream took, for streams that
+   * decode their messages off the worker queue.
+   */
+  LatencyHistogram& decode_time() {
+    return decode_time_;
+  }
+  const LatencyHistogram& decode_time() const {
+    return decode_time_;
+  }
+
+ private:
+  std::atomic<int64_t> messages_sent_{0};
+  std::atomic<int64_t> messages_received_{0};
+  std::atomic<int64_t> bytes_sent_{0};
+  std::atomic<int64_t> bytes_received_{0};
+  std::atomic<int64_t> opens_{0};
+  std::atomic<int64_t> errors_{0};
+  std::atomic<int64_t> backoffs_{0};
+  LatencyHistogram decode_time_;
+};
+
+/**
+ * Counters for the transactions run against one `Datastore`, to show how much
+ * they contend with each other.
+ *
+ * This class is thread-safe.
+ */
+class TransactionMetrics {
+ public:
+  void RecordAttempt() {
+    attempts_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void RecordCommit() {
+    commits_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void RecordFailure() {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void RecordAborted() {
+    aborted_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void RecordFailedPrecondition() {
+    failed_preconditions_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void RecordRetryableError() {
+    retryable_errors_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * The number of times an update callback was run, including the first run of
+   * each transaction.
+   */
+  int64_t attempts() const {
+    return attempts_.load(std::memory_order_relaxed);
+  }
+
+  /** The number of transactions that committed successfully. */
+  int64_t commits() const {
+    return commits_.load(std::memory_order_relaxed);
+  }
+
+  /** The number of transactions that failed after their last attempt. */
+  int64_t failures() const {
+    return failures_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The number of attempts that failed with ABORTED, which is how the backend
+   * reports contention with another transaction.
+   */
+  int64_t aborted() const {
+    return aborted_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The number of attempts that failed with FAILED_PRECONDITION, which is how
+   * the backend rejects writes based on outdated reads.
+   */
+  int64_t failed_preconditions() const {
+    return failed_preconditions_.load(std::memory_order_relaxed);
+  }
+
+  /** The number of attempts that failed with any other transient error. */
+  int64_t retryable_errors() const {
+    return retryable_errors_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> attempts_{0};
+  std::atomic<int64_t> commits_{0};
+  std::atomic<int64_t> failures_{0};
+  std::atomic<int64_t> aborted_{0};
+  std::atomic<int64_t> failed_preconditions_{0};
+  std::atomic<int64_t> retryable_errors_{0};
+};
+
+/**
+ * Metrics about the network activity of one `Datastore` and the `RemoteStore`
+ * using it. The counters are updated as the activity happens, regardless of the
+ * log level, so they can be polled from any thread and exported to any
+ * telemetry system.
+ *
+ * This class is thread-safe.
+ */
+class NetworkMetrics {
+ public:
+  StreamMetrics& watch_stream() {
+    return watch_stream_;
+  }
+  const StreamMetrics& watch_stream() const {
+    return watch_stream_;
+  }
+
+  StreamMetrics& write_stream() {
+    return write_stream_;
+  }
+  const StreamMetrics& write_stream() const {
+    return write_stream_;
+  }
+
+  TransactionMetrics& transactions() {
+    return transactions_;
+  }
+  const TransactionMetrics& transactions() const {
+    return transactions_;
+  }
+
+  /**
+   * How long after the server's `read_time` of each consistent snapshot the
+   * snapshot was handed to the sync engine. This is measured against the
+   * device clock, so clock skew between the device and the backend shows up as
+   * an offset; durations that come out negative are recorded as zero.
+   */
+  LatencyHistogram& snapshot_latency() {
+    return snapshot_latency_;
+  }
+  const LatencyHistogram& snapshot_latency() const {
+    return snapshot_latency_;
+  }
+
+  void set_active_target_count(size_t count) {
+    active_target_count_.store(static_cast<int64_t>(count),
+                               std::memory_order_relaxed);
+  }
+
+  /** The number of targets currently being listened to. */
+  int64_t active_target_count() const {
+    return active_target_count_.load(std::memory_order_relaxed);
+  }
+
+  void set_write_pipeline(size_t outstanding_batches, int depth) {
+    outstanding_write_batches_.store(static_cast<int64_t>(outstanding_batches),
+                                     std::memory_order_relaxed);
+    write_pipeline_depth_.store(depth, std::memory_order_relaxed);
+  }
+
+  /** The number of mutation batches sent but not yet acknowledged. */
+  int64_t outstanding_write_batches() const {
+    return outstanding_write_batches_.load(std::memory_order_relaxed);
+  }
+
+  /** The current maximum number of outstanding mutation batches. */
+  int write_pipeline_depth() const {
+    return write_pipeline_depth_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  StreamMetrics watch_stream_;
+  StreamMetrics write_stream_;
+  TransactionMetrics transactions_;
+  LatencyHistogram snapshot_latency_;
+  std::atomic<int64_t> active_target_count_{0};
+  std::atomic<int64_t> outstanding_write_batches_{0};
+  std::atomic<int> write_pipeline_depth_{0};
+};
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_REMOTE_NETWORK_METRICS_H_
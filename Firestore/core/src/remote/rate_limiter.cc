@@ -0,0 +1,98 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/rate_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Firestore/core/src/util/hard_assert.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+RateLimiter::RateLimiter(double initial_capacity,
+                         double multiplier,
+                         Milliseconds multiplier_period,
+                         double max_capacity,
+                         Clock::time_point start_time)
+    : initial_capacity_{initial_capacity},
+      multiplier_{multiplier},
+      multiplier_period_{multiplier_period},
+      max_capacity_{std::max(max_capacity, initial_capacity)},
+      start_time_{start_time},
+      available_tokens_{initial_capacity},
+      last_refill_time_{start_time} {
+  HARD_ASSERT(initial_capacity >= 1, "Rate limiter capacity must be positive");
+  HARD_ASSERT(multiplier >= 1, "Rate limiter capacity must not decrease");
+  HARD_ASSERT(multiplier_period.count() > 0,
+              "Rate limiter multiplier period must be positive");
+}
+
+bool RateLimiter::TryMakeRequest(int operations, Clock::time_point now) {
+  Refill(now);
+  if (operations > available_tokens_) {
+    return false;
+  }
+  available_tokens_ -= operations;
+  return true;
+}
+
+RateLimiter::Milliseconds RateLimiter::GetNextRequestDelay(
+    int operations, Clock::time_point now) {
+  Refill(now);
+  double missing = operations - available_tokens_;
+  if (missing <= 0) {
+    return Milliseconds{0};
+  }
+
+  // Assumes the refill rate doesn't go up in the meantime, which at worst
+  // makes the caller wait a little longer than necessary.
+  double millis = std::ceil(missing / CapacityAt(now) * 1000);
+  return Milliseconds{static_cast<Milliseconds::rep>(millis)};
+}
+
+int RateLimiter::GetMaximumCapacity(Clock::time_point now) const {
+  return static_cast<int>(CapacityAt(now));
+}
+
+double RateLimiter::CapacityAt(Clock::time_point now) const {
+  if (now <= start_time_) {
+    return initial_capacity_;
+  }
+  auto periods = (now - start_time_) / multiplier_period_;
+  double capacity =
+      initial_capacity_ * std::pow(multiplier_, static_cast<double>(periods));
+  return std::min(capacity, max_capacity_);
+}
+
+void RateLimiter::Refill(Clock::time_point now) {
+  if (now <= last_refill_time_) {
+    return;
+  }
+
+  double capacity = CapacityAt(now);
+  double elapsed_seconds =
+      std::chrono::duration<double>(now - last_refill_time_).count();
+  available_tokens_ =
+      std::min(capacity, available_tokens_ + elapsed_seconds * capacity);
+  last_refill_time_ = now;
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
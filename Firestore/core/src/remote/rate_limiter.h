@@ -0,0 +1,86 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_REMOTE_RATE_LIMITER_H_
+#define FIRESTORE_CORE_SRC_REMOTE_RATE_LIMITER_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+/**
+ * A token bucket that limits how many operations per second are sent to the
+ * backend, and that raises the limit over time.
+ *
+ * The bucket starts full with `initial_capacity` tokens and refills at that
+ * many tokens per second. Every `multiplier_period`, the capacity (and the
+ * refill rate with it) is multiplied by `multiplier`, up to `max_capacity`.
+ * Ramping up gradually ("500/50/5": start at 500 operations per second and
+ * increase by 50% every 5 minutes) gives the backend time to split the key
+ * ranges a bulk import writes to, rather than overloading them right away.
+ *
+ * Times are passed in by the caller, which keeps this class deterministic.
+ */
+class RateLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Milliseconds = std::chrono::milliseconds;
+
+  RateLimiter(double initial_capacity,
+              double multiplier,
+              Milliseconds multiplier_period,
+              double max_capacity,
+              Clock::time_point start_time);
+
+  /**
+   * Takes `operations` tokens from the bucket if it holds as many at `now`.
+   * Returns whether it did.
+   */
+  bool TryMakeRequest(int operations, Clock::time_point now);
+
+  /**
+   * Returns how long to wait from `now` until the bucket holds `operations`
+   * tokens, or zero if it already does.
+   */
+  Milliseconds GetNextRequestDelay(int operations, Clock::time_point now);
+
+  /**
+   * The most operations a single request may carry at `now`; larger requests
+   * would never fit the bucket.
+   */
+  int GetMaximumCapacity(Clock::time_point now) const;
+
+ private:
+  double CapacityAt(Clock::time_point now) const;
+  void Refill(Clock::time_point now);
+
+  const double initial_capacity_;
+  const double multiplier_;
+  const Milliseconds multiplier_period_;
+  const double max_capacity_;
+  const Clock::time_point start_time_;
+
+  double available_tokens_;
+  Clock::time_point last_refill_time_;
+};
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_REMOTE_RATE_LIMITER_H_
@@ -16,10 +16,13 @@
 
 #include "Firestore/core/src/remote/remote_event.h"
 
+#include <string>
 #include <utility>
 
 #include "Firestore/core/src/local/target_data.h"
 #include "Firestore/core/src/model/no_document.h"
+#include "Firestore/core/src/util/trace.h"
+#include "absl/strings/str_cat.h"
 
 namespace firebase {
 namespace firestore {
@@ -29,6 +32,7 @@ using core::DocumentViewChange;
 using core::Target;
 using local::QueryPurpose;
 using local::TargetData;
+using model::DatabaseId;
 using model::DocumentKey;
 using model::DocumentKeySet;
 using model::MaybeDocument;
@@ -238,6 +242,19 @@ void WatchChangeAggregator::HandleExistenceFilter(
     } else {
       int current_size = GetCurrentDocumentCountForTarget(target_id);
       if (current_size != expected_count) {
+        // If the backend sent a bloom filter of the unchanged documents, use it
+        // to remove just the documents that were deleted or stopped matching,
+        // which avoids re-running the whole query.
+        const absl::optional<BloomFilter>& unchanged_names =
+            existence_filter.filter().unchanged_names();
+        if (unchanged_names && unchanged_names->bit_count() > 0) {
+          int removed_count =
+              FilterRemovedDocuments(*unchanged_names, target_id);
+          if (current_size - removed_count == expected_count) {
+            return;
+          }
+        }
+
         // Existence filter mismatch: We reset the mapping and raise a new
         // snapshot with `isFromCache:true`.
         ResetTarget(target_id);
@@ -249,29 +266,41 @@ void WatchChangeAggregator::HandleExistenceFilter(
 
 RemoteEvent WatchChangeAggregator::CreateRemoteEvent(
     const SnapshotVersion& snapshot_version) {
+  FIRESTORE_TRACE_SPAN("WatchChangeAggregator::CreateRemoteEvent");
   std::unordered_map<TargetId, TargetChange> target_changes;
 
+  // Whether each target is active and not a limbo resolution, so that the
+  // target data is only looked up once per target below rather than once per
+  // document and target.
+  std::unordered_map<TargetId, bool> is_query_target;
+
   for (auto& entry : target_states_) {
     TargetId target_id = entry.first;
     TargetState& target_state = entry.second;
 
     absl::optional<TargetData> target_data =
         TargetDataForActiveTarget(target_id);
+    is_query_target[target_id] =
+        target_data && target_data->purpose() != QueryPurpose::LimboResolution;
     if (target_data) {
-      if (target_state.current() && target_data->target().IsDocumentQuery()) {
+      const Target& target = target_data->target();
+      if (target_state.current() &&
+          (target.IsDocumentQuery() || target.IsMultiDocumentQuery())) {
         // Document queries for document that don't exist can produce an empty
         // result set. To update our local cache, we synthesize a document
         // delete if we have not previously received the document. This resolves
         // the limbo state of the document, removing it from
-        // SyncEngine::limbo_document_refs_.
-        DocumentKey key{target_data->target().path()};
-        if (pending_document_updates_.find(key) ==
-                pending_document_updates_.end() &&
-            !TargetContainsDocument(target_id, key)) {
-          RemoveDocumentFromTarget(
-              target_id, key,
-              NoDocument(key, snapshot_version,
-                         /* has_committed_mutations= */ false));
+        // SyncEngine::limbo_document_refs_. Multi-document queries do the same
+        // for each of their documents.
+        for (const DocumentKey& key : target.GetDocumentKeys()) {
+          if (pending_document_updates_.find(key) ==
+                  pending_document_updates_.end() &&
+              !TargetContainsDocument(target_id, key)) {
+            RemoveDocumentFromTarget(
+                target_id, key,
+                NoDocument(key, snapshot_version,
+                           /* has_committed_mutations= */ false));
+          }
         }
       }
 
@@ -292,10 +321,18 @@ RemoteEvent WatchChangeAggregator::CreateRemoteEvent(
     bool is_only_limbo_target = true;
 
     for (TargetId target_id : entry.second) {
-      absl::optional<TargetData> target_data =
-          TargetDataForActiveTarget(target_id);
-      if (target_data &&
-          target_data->purpose() != QueryPurpose::LimboResolution) {
+      auto found = is_query_target.find(target_id);
+      if (found == is_query_target.end()) {
+        // The target was removed after the document was mapped to it.
+        absl::optional<TargetData> target_data =
+            TargetDataForActiveTarget(target_id);
+        found = is_query_target
+                    .emplace(target_id,
+                             target_data && target_data->purpose() !=
+                                                QueryPurpose::LimboResolution)
+                    .first;
+      }
+      if (found->second) {
         is_only_limbo_target = false;
         break;
       }
@@ -316,6 +353,7 @@ RemoteEvent WatchChangeAggregator::CreateRemoteEvent(
   pending_document_updates_.clear();
   pending_document_target_mappings_.clear();
   pending_target_resets_.clear();
+  remote_keys_by_target_.clear();
 
   return remote_event;
 }
@@ -335,7 +373,7 @@ void WatchChangeAggregator::AddDocumentToTarget(TargetId target_id,
   target_state.AddDocumentChange(document.key(), change_type);
 
   pending_document_updates_[document.key()] = document;
-  pending_document_target_mappings_[document.key()].insert(target_id);
+  pending_document_target_mappings_[document.key()].push_back(target_id);
 }
 
 void WatchChangeAggregator::RemoveDocumentFromTarget(
@@ -354,7 +392,7 @@ void WatchChangeAggregator::RemoveDocumentFromTarget(
     // snapshot, so we can just ignore the change.
     target_state.RemoveDocumentChange(key);
   }
-  pending_document_target_mappings_[key].insert(target_id);
+  pending_document_target_mappings_[key].push_back(target_id);
 
   if (updated_document) {
     pending_document_updates_[key] = *updated_document;
@@ -363,13 +401,40 @@ void WatchChangeAggregator::RemoveDocumentFromTarget(
 
 void WatchChangeAggregator::RemoveTarget(TargetId target_id) {
   target_states_.erase(target_id);
+  remote_keys_by_target_.erase(target_id);
+}
+
+int WatchChangeAggregator::FilterRemovedDocuments(
+    const BloomFilter& bloom_filter, TargetId target_id) {
+  const DatabaseId& database_id = target_metadata_provider_->GetDatabaseId();
+  std::string prefix = absl::StrCat("projects/", database_id.project_id(),
+                                    "/databases/", database_id.database_id(),
+                                    "/documents/");
+
+  // Collect the keys first, since removing documents from the target may
+  // update the set of keys being iterated over.
+  std::vector<DocumentKey> removed_keys;
+  const DocumentKeySet existing_keys = GetRemoteKeysForTarget(target_id);
+  std::string document_name;
+  for (const DocumentKey& key : existing_keys) {
+    document_name = prefix;
+    document_name += key.path().CanonicalString();
+    if (!bloom_filter.MightContain(document_name)) {
+      removed_keys.push_back(key);
+    }
+  }
+
+  for (const DocumentKey& key : removed_keys) {
+    RemoveDocumentFromTarget(target_id, key, absl::nullopt);
+  }
+  return static_cast<int>(removed_keys.size());
 }
 
 int WatchChangeAggregator::GetCurrentDocumentCountForTarget(
     TargetId target_id) {
   TargetState& target_state = EnsureTargetState(target_id);
   TargetChange target_change = target_state.ToTargetChange();
-  return target_metadata_provider_->GetRemoteKeysForTarget(target_id).size() +
+  return GetRemoteKeysForTarget(target_id).size() +
          target_change.added_documents().size() -
          target_change.removed_documents().size();
 }
@@ -378,6 +443,7 @@ void WatchChangeAggregator::RecordPendingTargetRequest(TargetId target_id) {
   // For each request we get we need to record we need a response for it.
   TargetState& target_state = EnsureTargetState(target_id);
   target_state.RecordPendingTargetRequest();
+  remote_keys_by_target_.erase(target_id);
 }
 
 TargetState& WatchChangeAggregator::EnsureTargetState(TargetId target_id) {
@@ -408,8 +474,7 @@ void WatchChangeAggregator::ResetTarget(TargetId target_id) {
   // Trigger removal for any documents currently mapped to this target. These
   // removals will be part of the initial snapshot if Watch does not resend
   // these documents.
-  DocumentKeySet existing_keys =
-      target_metadata_provider_->GetRemoteKeysForTarget(target_id);
+  DocumentKeySet existing_keys = GetRemoteKeysForTarget(target_id);
 
   for (const DocumentKey& key : existing_keys) {
     RemoveDocumentFromTarget(target_id, key, absl::nullopt);
@@ -418,9 +483,20 @@ void WatchChangeAggregator::ResetTarget(TargetId target_id) {
 
 bool WatchChangeAggregator::TargetContainsDocument(TargetId target_id,
                                                    const DocumentKey& key) {
-  const DocumentKeySet& existing_keys =
-      target_metadata_provider_->GetRemoteKeysForTarget(target_id);
-  return existing_keys.contains(key);
+  return GetRemoteKeysForTarget(target_id).contains(key);
+}
+
+const DocumentKeySet& WatchChangeAggregator::GetRemoteKeysForTarget(
+    TargetId target_id) {
+  auto found = remote_keys_by_target_.find(target_id);
+  if (found == remote_keys_by_target_.end()) {
+    found = remote_keys_by_target_
+                .emplace(target_id,
+                         target_metadata_provider_->GetRemoteKeysForTarget(
+                             target_id))
+                .first;
+  }
+  return found->second;
 }
 
 }  // namespace remote
@@ -17,13 +17,13 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_REMOTE_EVENT_H_
 #define FIRESTORE_CORE_SRC_REMOTE_REMOTE_EVENT_H_
 
-#include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "Firestore/core/src/core/view_snapshot.h"
+#include "Firestore/core/src/model/database_id.h"
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/maybe_document.h"
@@ -62,6 +62,9 @@ class TargetMetadataProvider {
    */
   virtual absl::optional<local::TargetData> GetTargetDataForTarget(
       model::TargetId target_id) const = 0;
+
+  /** Returns the database to which the targets belong. */
+  virtual const model::DatabaseId& GetDatabaseId() const = 0;
 };
 
 /**
@@ -367,6 +370,14 @@ class WatchChangeAggregator {
       const model::DocumentKey& key,
       const absl::optional<model::MaybeDocument>& updated_document);
 
+  /**
+   * Removes from the target the documents that the LocalStore considers to be
+   * part of it but that aren't in `bloom_filter`, and returns how many were
+   * removed.
+   */
+  int FilterRemovedDocuments(const BloomFilter& bloom_filter,
+                             model::TargetId target_id);
+
   /**
    * Returns the current count of documents in the target. This includes both
    * the number of documents that the LocalStore considers to be part of the
@@ -408,18 +419,39 @@ class WatchChangeAggregator {
   bool TargetContainsDocument(model::TargetId target_id,
                               const model::DocumentKey& key);
 
+  /**
+   * Returns the keys that the local store considers to be part of the target,
+   * asking the `TargetMetadataProvider` only once per target between remote
+   * events.
+   */
+  const model::DocumentKeySet& GetRemoteKeysForTarget(
+      model::TargetId target_id);
+
   /** The internal state of all tracked targets. */
   std::unordered_map<model::TargetId, TargetState> target_states_;
 
   /** Keeps track of the documents to update since the last raised snapshot. */
   model::DocumentUpdateMap pending_document_updates_;
 
-  /** A mapping of document keys to their set of target IDs. */
+  /**
+   * A mapping of document keys to the IDs of the targets they were sent for.
+   * The IDs are only scanned, so they are kept in arrival order and a target
+   * may appear more than once.
+   */
   std::unordered_map<model::DocumentKey,
-                     std::set<model::TargetId>,
+                     std::vector<model::TargetId>,
                      model::DocumentKeyHash>
       pending_document_target_mappings_;
 
+  /**
+   * The remote keys of the targets, as returned by the
+   * `TargetMetadataProvider`. The local store only changes them when it
+   * applies a remote event, so they're cleared once a remote event is created
+   * (and for a target whose listen changes).
+   */
+  std::unordered_map<model::TargetId, model::DocumentKeySet>
+      remote_keys_by_target_;
+
   /**
    * A list of targets with existence filter mismatches. These targets are known
    * to be inconsistent and their listens needs to be re-established by
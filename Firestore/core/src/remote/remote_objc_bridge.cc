@@ -16,10 +16,15 @@
 
 #include "Firestore/core/src/remote/remote_objc_bridge.h"
 
+#include <algorithm>
 #include <map>
 
 #include "Firestore/core/src/core/database_info.h"
+#include "Firestore/core/src/model/document.h"
 #include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/field_mask.h"
+#include "Firestore/core/src/model/field_path.h"
+#include "Firestore/core/src/model/field_value.h"
 #include "Firestore/core/src/model/maybe_document.h"
 #include "Firestore/core/src/model/mutation.h"
 #include "Firestore/core/src/model/snapshot_version.h"
@@ -40,10 +45,15 @@ namespace remote {
 
 using core::DatabaseInfo;
 using local::TargetData;
+using model::Document;
 using model::DocumentKey;
+using model::DocumentState;
+using model::FieldMask;
+using model::FieldPath;
 using model::MaybeDocument;
 using model::Mutation;
 using model::MutationResult;
+using model::ObjectValue;
 using model::SnapshotVersion;
 using model::TargetId;
 using nanopb::ByteString;
@@ -62,6 +72,7 @@ using util::StringFormat;
 
 WatchStreamSerializer::WatchStreamSerializer(Serializer serializer)
     : serializer_{std::move(serializer)} {
+  serializer_.set_validates_utf8(true);
 }
 
 Message<google_firestore_v1_ListenRequest>
@@ -108,7 +119,7 @@ WatchStreamSerializer::ParseResponse(Reader* reader) const {
 
 std::unique_ptr<WatchChange> WatchStreamSerializer::DecodeWatchChange(
     nanopb::Reader* reader,
-    const google_firestore_v1_ListenResponse& response) const {
+    google_firestore_v1_ListenResponse& response) const {
   return serializer_.DecodeWatchChange(reader->context(), response);
 }
 
@@ -123,6 +134,7 @@ SnapshotVersion WatchStreamSerializer::DecodeSnapshotVersion(
 
 WriteStreamSerializer::WriteStreamSerializer(Serializer serializer)
     : serializer_{std::move(serializer)} {
+  serializer_.set_validates_utf8(true);
 }
 
 Message<google_firestore_v1_WriteRequest>
@@ -151,7 +163,7 @@ WriteStreamSerializer::EncodeWriteMutationsRequest(
     }
   }
 
-  result->stream_token = nanopb::CopyBytesArray(last_stream_token.get());
+  result->stream_token = nanopb::CopyBytesArray(last_stream_token);
 
   return result;
 }
@@ -198,6 +210,7 @@ std::vector<MutationResult> WriteStreamSerializer::DecodeMutationResults(
 
 DatastoreSerializer::DatastoreSerializer(const DatabaseInfo& database_info)
     : serializer_{database_info.database_id()} {
+  serializer_.set_validates_utf8(true);
 }
 
 Message<google_firestore_v1_CommitRequest>
@@ -270,6 +283,101 @@ DatastoreSerializer::MergeLookupResponses(
   return result;
 }
 
+Message<google_firestore_v1_RunQueryRequest>
+DatastoreSerializer::EncodeRunQueryRequest(const core::Target& target,
+                                           const FieldMask& projection) const {
+  Message<google_firestore_v1_RunQueryRequest> result;
+
+  google_firestore_v1_Target_QueryTarget query_target =
+      serializer_.EncodeQueryTarget(target);
+  result->parent = query_target.parent;
+  result->which_query_type =
+      google_firestore_v1_RunQueryRequest_structured_query_tag;
+  result->query_type.structured_query = query_target.structured_query;
+
+  // The backend returns all the fields for an empty projection, so ask for the
+  // document names explicitly instead.
+  std::vector<FieldPath> fields(projection.begin(), projection.end());
+  if (fields.empty()) {
+    fields.push_back(FieldPath::KeyFieldPath());
+  }
+
+  google_firestore_v1_StructuredQuery_Projection& select =
+      result->query_type.structured_query.select;
+  select.fields_count = nanopb::CheckedSize(fields.size());
+  select.fields = MakeArray<google_firestore_v1_StructuredQuery_FieldReference>(
+      select.fields_count);
+  for (pb_size_t i = 0; i < select.fields_count; ++i) {
+    select.fields[i].field_path = Serializer::EncodeFieldPath(fields[i]);
+  }
+
+  return result;
+}
+
+StatusOr<std::vector<Document>> DatastoreSerializer::DecodeRunQueryResponses(
+    const std::vector<grpc::ByteBuffer>& responses,
+    SnapshotVersion* read_time) const {
+  std::vector<Document> docs;
+
+  for (const auto& response : responses) {
+    ByteBufferReader reader{response};
+    auto message =
+        Message<google_firestore_v1_RunQueryResponse>::TryParse(&reader);
+    if (!reader.ok()) {
+      return reader.status();
+    }
+
+    if (read_time) {
+      SnapshotVersion response_read_time =
+          Serializer::DecodeVersion(reader.context(), message->read_time);
+      if (!reader.ok()) {
+        return reader.status();
+      }
+      *read_time = std::max(*read_time, response_read_time);
+    }
+
+    // Responses that only report progress don't carry a document.
+    const google_firestore_v1_Document& proto = message->document;
+    if (proto.name == nullptr) continue;
+
+    DocumentKey key = serializer_.DecodeKey(reader.context(), proto.name);
+    ObjectValue value = serializer_.DecodeFields(
+        reader.context(), proto.fields_count, proto.fields);
+    SnapshotVersion version =
+        Serializer::DecodeVersion(reader.context(), proto.update_time);
+    if (!reader.ok()) {
+      return reader.status();
+    }
+
+    docs.emplace_back(std::move(value), std::move(key), version,
+                      DocumentState::kSynced);
+  }
+
+  StatusOr<std::vector<Document>> result{std::move(docs)};
+  return result;
+}
+
+StatusOr<int64_t> DatastoreSerializer::CountQueryResponses(
+    const std::vector<grpc::ByteBuffer>& responses) const {
+  int64_t count = 0;
+
+  for (const auto& response : responses) {
+    ByteBufferReader reader{response};
+    auto message =
+        Message<google_firestore_v1_RunQueryResponse>::TryParse(&reader);
+    if (!reader.ok()) {
+      return reader.status();
+    }
+
+    // Responses that only report progress don't carry a document.
+    if (message->document.name != nullptr) {
+      ++count;
+    }
+  }
+
+  return count;
+}
+
 }  // namespace remote
 }  // namespace firestore
 }  // namespace firebase
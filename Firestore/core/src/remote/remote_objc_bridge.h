@@ -17,6 +17,7 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_REMOTE_OBJC_BRIDGE_H_
 #define FIRESTORE_CORE_SRC_REMOTE_REMOTE_OBJC_BRIDGE_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -77,7 +78,7 @@ class WatchStreamSerializer {
       nanopb::Reader* reader) const;
   std::unique_ptr<WatchChange> DecodeWatchChange(
       nanopb::Reader* reader,
-      const google_firestore_v1_ListenResponse& response) const;
+      google_firestore_v1_ListenResponse& response) const;
   model::SnapshotVersion DecodeSnapshotVersion(
       nanopb::Reader* reader,
       const google_firestore_v1_ListenResponse& response) const;
@@ -127,6 +128,31 @@ class DatastoreSerializer {
   util::StatusOr<std::vector<model::MaybeDocument>> MergeLookupResponses(
       const std::vector<grpc::ByteBuffer>& responses) const;
 
+  /**
+   * Encodes a request that runs the given target and only asks for the given
+   * fields of the matching documents. An empty projection only asks for the
+   * names of the documents.
+   */
+  nanopb::Message<google_firestore_v1_RunQueryRequest> EncodeRunQueryRequest(
+      const core::Target& target, const model::FieldMask& projection) const;
+
+  /**
+   * Decodes the documents returned in the results of the streaming read of a
+   * request made with `EncodeRunQueryRequest`, in the order of the results.
+   * If `read_time` is given, it's set to the latest time the responses report
+   * the documents were read at.
+   */
+  util::StatusOr<std::vector<model::Document>> DecodeRunQueryResponses(
+      const std::vector<grpc::ByteBuffer>& responses,
+      model::SnapshotVersion* read_time = nullptr) const;
+
+  /**
+   * Counts the documents returned in the results of the streaming read of a
+   * request made with `EncodeRunQueryRequest`.
+   */
+  util::StatusOr<int64_t> CountQueryResponses(
+      const std::vector<grpc::ByteBuffer>& responses) const;
+
   const Serializer& serializer() const {
     return serializer_;
   }
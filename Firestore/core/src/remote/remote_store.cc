@@ -16,6 +16,9 @@
 
 #include "Firestore/core/src/remote/remote_store.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <string>
 #include <utility>
 
@@ -29,6 +32,7 @@
 #include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/log.h"
 #include "Firestore/core/src/util/to_string.h"
+#include "Firestore/core/src/util/trace.h"
 #include "absl/memory/memory.h"
 
 namespace firebase {
@@ -40,8 +44,10 @@ using local::LocalStore;
 using local::QueryPurpose;
 using local::TargetData;
 using model::BatchId;
+using model::DatabaseId;
 using model::DocumentKeySet;
 using model::kBatchIdUnknown;
+using model::Mutation;
 using model::MutationBatch;
 using model::MutationBatchResult;
 using model::MutationResult;
@@ -51,12 +57,9 @@ using model::TargetId;
 using nanopb::ByteString;
 using util::AsyncQueue;
 using util::Status;
+using util::TimerId;
 
-/**
- * The maximum number of pending writes to allow.
- * TODO(b/35853402): Negotiate this value with the backend.
- */
-constexpr int kMaxPendingWrites = 10;
+using SteadyClock = std::chrono::steady_clock;
 
 RemoteStore::RemoteStore(
     LocalStore* local_store,
@@ -125,6 +128,10 @@ void RemoteStore::DisableNetwork() {
 }
 
 void RemoteStore::DisableNetworkInternal() {
+  // The write pipeline is refilled from the mutation queue when the network is
+  // enabled again, so acknowledged batches must have left it by then.
+  FlushWriteAcknowledgements();
+
   watch_stream_->Stop();
   write_stream_->Stop();
 
@@ -133,10 +140,19 @@ void RemoteStore::DisableNetworkInternal() {
               write_pipeline_.size());
     write_pipeline_.clear();
   }
+  write_requests_.clear();
+  UpdateNetworkMetrics();
 
   CleanUpWatchStreamState();
 }
 
+void RemoteStore::UpdateNetworkMetrics() {
+  NetworkMetrics& metrics = *datastore_->metrics();
+  metrics.set_active_target_count(listen_targets_.size());
+  metrics.set_write_pipeline(write_pipeline_.size(),
+                             write_pipeline_depth_.depth());
+}
+
 void RemoteStore::Shutdown() {
   LOG_DEBUG("RemoteStore %s shutting down", this);
   is_network_enabled_ = false;
@@ -159,6 +175,7 @@ void RemoteStore::Listen(const TargetData& target_data) {
 
   // Mark this as something the client is currently listening for.
   listen_targets_[target_key] = target_data;
+  UpdateNetworkMetrics();
 
   if (ShouldStartWatchStream()) {
     // The listen will be sent in `OnWatchStreamOpen`
@@ -172,6 +189,7 @@ void RemoteStore::StopListening(TargetId target_id) {
   size_t num_erased = listen_targets_.erase(target_id);
   HARD_ASSERT(num_erased == 1,
               "StopListening: target not currently watched: %s", target_id);
+  UpdateNetworkMetrics();
 
   // The watch stream might not be started if we're in a disconnected state
   if (watch_stream_->IsOpen()) {
@@ -193,7 +211,16 @@ void RemoteStore::SendWatchRequest(const TargetData& target_data) {
   // We need to increment the the expected number of pending responses we're due
   // from watch so we wait for the ack to process any messages from this target.
   watch_change_aggregator_->RecordPendingTargetRequest(target_data.target_id());
-  watch_stream_->WatchQuery(target_data);
+
+  // Tell the backend how many documents we think match the target as of the
+  // resume token, so that it can send a bloom filter if it disagrees.
+  if (!target_data.resume_token().empty()) {
+    int32_t expected_count = static_cast<int32_t>(
+        GetRemoteKeysForTarget(target_data.target_id()).size());
+    watch_stream_->WatchQuery(target_data.WithExpectedCount(expected_count));
+  } else {
+    watch_stream_->WatchQuery(target_data);
+  }
 }
 
 void RemoteStore::SendUnwatchRequest(TargetId target_id) {
@@ -254,6 +281,9 @@ void RemoteStore::OnWatchStreamClose(const Status& status) {
 
 void RemoteStore::OnWatchStreamChange(const WatchChange& change,
                                       const SnapshotVersion& snapshot_version) {
+  // Keep applying remote changes in the order in which they arrived.
+  FlushWriteAcknowledgements();
+
   // Mark the connection as Online because we got a message from the server.
   online_state_tracker_.UpdateState(OnlineState::Online);
 
@@ -288,12 +318,20 @@ void RemoteStore::OnWatchStreamChange(const WatchChange& change,
 }
 
 void RemoteStore::RaiseWatchSnapshot(const SnapshotVersion& snapshot_version) {
+  FIRESTORE_TRACE_SPAN("RemoteStore::RaiseWatchSnapshot");
   HARD_ASSERT(snapshot_version != SnapshotVersion::None(),
               "Can't raise event for unknown SnapshotVersion");
 
   RemoteEvent remote_event =
       watch_change_aggregator_->CreateRemoteEvent(snapshot_version);
 
+  auto read_time = snapshot_version.timestamp()
+                       .ToTimePoint<std::chrono::system_clock,
+                                    std::chrono::microseconds>();
+  datastore_->metrics()->snapshot_latency().Record(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now() - read_time));
+
   // Update in-memory resume tokens. `LocalStore` will update the persistent
   // view of these when applying the completed `RemoteEvent`.
   for (const auto& entry : remote_event.target_changes()) {
@@ -359,6 +397,7 @@ void RemoteStore::ProcessTargetError(const WatchTargetChange& change) {
     auto found = listen_targets_.find(target_id);
     if (found != listen_targets_.end()) {
       listen_targets_.erase(found);
+      UpdateNetworkMetrics();
       watch_change_aggregator_->RemoveTarget(target_id);
       sync_engine_->HandleRejectedListen(target_id, change.cause());
     }
@@ -368,9 +407,7 @@ void RemoteStore::ProcessTargetError(const WatchTargetChange& change) {
 // Write Stream
 
 void RemoteStore::FillWritePipeline() {
-  BatchId last_batch_id_retrieved = write_pipeline_.empty()
-                                        ? kBatchIdUnknown
-                                        : write_pipeline_.back().batch_id();
+  BatchId last_batch_id_retrieved = last_batch_id_in_write_pipeline();
   while (CanAddToWritePipeline()) {
     absl::optional<MutationBatch> batch =
         local_store_->GetNextMutationBatch(last_batch_id_retrieved);
@@ -384,13 +421,19 @@ void RemoteStore::FillWritePipeline() {
     last_batch_id_retrieved = batch->batch_id();
   }
 
+  if (write_stream_->IsOpen() && write_stream_->handshake_complete()) {
+    SendPendingWrites();
+  }
+
   if (ShouldStartWriteStream()) {
     StartWriteStream();
   }
 }
 
 bool RemoteStore::CanAddToWritePipeline() const {
-  return CanUseNetwork() && write_pipeline_.size() < kMaxPendingWrites;
+  return CanUseNetwork() &&
+         write_pipeline_.size() <
+             static_cast<size_t>(write_pipeline_depth_.depth());
 }
 
 void RemoteStore::AddToWritePipeline(const MutationBatch& batch) {
@@ -398,9 +441,36 @@ void RemoteStore::AddToWritePipeline(const MutationBatch& batch) {
               "AddToWritePipeline called when pipeline is full");
 
   write_pipeline_.push_back(batch);
+  UpdateNetworkMetrics();
+}
 
-  if (write_stream_->IsOpen() && write_stream_->handshake_complete()) {
-    write_stream_->WriteMutations(batch.mutations());
+void RemoteStore::SendPendingWrites() {
+  size_t sent = 0;
+  for (const WriteRequestInfo& request : write_requests_) {
+    sent += request.batch_count;
+  }
+
+  auto max_batches =
+      static_cast<size_t>(std::max(max_batches_per_write_request_, 1));
+  while (sent < write_pipeline_.size()) {
+    size_t count = std::min(max_batches, write_pipeline_.size() - sent);
+    if (sent == 0 && isolate_first_write_) {
+      count = 1;
+    }
+
+    if (count == 1) {
+      write_stream_->WriteMutations(write_pipeline_[sent].mutations());
+    } else {
+      std::vector<Mutation> mutations;
+      for (size_t i = sent; i != sent + count; ++i) {
+        const std::vector<Mutation>& batch = write_pipeline_[i].mutations();
+        mutations.insert(mutations.end(), batch.begin(), batch.end());
+      }
+      write_stream_->WriteMutations(mutations);
+    }
+
+    write_requests_.push_back(WriteRequestInfo{count, SteadyClock::now()});
+    sent += count;
   }
 }
 
@@ -424,9 +494,8 @@ void RemoteStore::OnWriteStreamHandshakeComplete() {
   local_store_->SetLastStreamToken(write_stream_->last_stream_token());
 
   // Send the write pipeline now that the stream is established.
-  for (const MutationBatch& write : write_pipeline_) {
-    write_stream_->WriteMutations(write.mutations());
-  }
+  write_requests_.clear();
+  SendPendingWrites();
 }
 
 void RemoteStore::OnWriteStreamMutationResult(
@@ -435,21 +504,84 @@ void RemoteStore::OnWriteStreamMutationResult(
   // This is a response to a write containing mutations and should be correlated
   // to the first write in our write pipeline.
   HARD_ASSERT(!write_pipeline_.empty(), "Got result for empty write pipeline");
+  HARD_ASSERT(!write_requests_.empty(), "Got result for an unsent write");
+
+  WriteRequestInfo request = write_requests_.front();
+  write_requests_.pop_front();
+  HARD_ASSERT(request.batch_count <= write_pipeline_.size(),
+              "Write request covers more batches than the write pipeline");
+
+  bool pipeline_was_full = !CanAddToWritePipeline();
+  write_pipeline_depth_.RecordAck(SteadyClock::now() - request.sent_time,
+                                  pipeline_was_full);
+  isolate_first_write_ = false;
+
+  std::vector<MutationBatchResult> batch_results;
+  if (request.batch_count == 1) {
+    MutationBatch batch = write_pipeline_.front();
+    write_pipeline_.erase(write_pipeline_.begin());
+    UpdateNetworkMetrics();
+
+    batch_results.emplace_back(std::move(batch), commit_version,
+                               std::move(mutation_results),
+                               write_stream_->last_stream_token());
+  } else {
+    // The results of a packed request are in the order of the mutations of
+    // all its batches.
+    auto results = mutation_results.begin();
+    for (size_t i = 0; i != request.batch_count; ++i) {
+      MutationBatch batch = write_pipeline_.front();
+      write_pipeline_.erase(write_pipeline_.begin());
+      UpdateNetworkMetrics();
+
+      auto count = static_cast<std::ptrdiff_t>(batch.mutations().size());
+      HARD_ASSERT(mutation_results.end() - results >= count,
+                  "Packed write request got too few mutation results");
+      std::vector<MutationResult> batch_mutation_results(
+          std::make_move_iterator(results),
+          std::make_move_iterator(results + count));
+      results += count;
+
+      batch_results.emplace_back(std::move(batch), commit_version,
+                                 std::move(batch_mutation_results),
+                                 write_stream_->last_stream_token());
+    }
+  }
 
-  MutationBatch batch = write_pipeline_.front();
-  write_pipeline_.erase(write_pipeline_.begin());
-
-  MutationBatchResult batch_result(std::move(batch), commit_version,
-                                   std::move(mutation_results),
-                                   write_stream_->last_stream_token());
-  sync_engine_->HandleSuccessfulWrite(batch_result);
+  if (worker_queue_) {
+    // Acknowledgements that are already queued join these ones.
+    bool flush_scheduled = !pending_acknowledgements_.empty();
+    pending_acknowledgements_.insert(
+        pending_acknowledgements_.end(),
+        std::make_move_iterator(batch_results.begin()),
+        std::make_move_iterator(batch_results.end()));
+    if (!flush_scheduled) {
+      acknowledgements_callback_ = worker_queue_->EnqueueAfterDelay(
+          std::chrono::milliseconds(0), TimerId::WriteAcknowledgements,
+          [this] { FlushWriteAcknowledgements(); });
+    }
+  } else {
+    sync_engine_->HandleSuccessfulWrites(batch_results);
+  }
 
   // It's possible that with the completion of this mutation another slot has
   // freed up.
   FillWritePipeline();
 }
 
+void RemoteStore::FlushWriteAcknowledgements() {
+  acknowledgements_callback_.Cancel();
+  if (pending_acknowledgements_.empty()) return;
+
+  std::vector<MutationBatchResult> batch_results;
+  batch_results.swap(pending_acknowledgements_);
+  sync_engine_->HandleSuccessfulWrites(batch_results);
+}
+
 void RemoteStore::OnWriteStreamClose(const Status& status) {
+  // Rejections must be applied after the acknowledgements that preceded them.
+  FlushWriteAcknowledgements();
+
   if (status.ok()) {
     // Graceful stop (due to Stop() or idle timeout). Make sure that's
     // desirable.
@@ -457,14 +589,21 @@ void RemoteStore::OnWriteStreamClose(const Status& status) {
                 "Write stream was stopped gracefully while still needed.");
   }
 
+  // The error, if any, is the response to the first unacknowledged request.
+  size_t failed_batch_count =
+      write_requests_.empty() ? 1 : write_requests_.front().batch_count;
+  write_requests_.clear();
+
   // If the write stream closed due to an error, invoke the error callbacks if
   // there are pending writes.
   if (!status.ok() && !write_pipeline_.empty()) {
+    write_pipeline_depth_.RecordError();
+
     // TODO(varconst): handle UNAUTHENTICATED status, see
     // go/firestore-client-errors
     if (write_stream_->handshake_complete()) {
       // This error affects the actual writes.
-      HandleWriteError(status);
+      HandleWriteError(status, failed_batch_count);
     } else {
       // If there was an error before the handshake finished, it's possible that
       // the server is unable to process the stream token we're sending.
@@ -501,7 +640,8 @@ void RemoteStore::HandleHandshakeError(const Status& status) {
   }
 }
 
-void RemoteStore::HandleWriteError(const Status& status) {
+void RemoteStore::HandleWriteError(const Status& status,
+                                   size_t failed_batch_count) {
   HARD_ASSERT(!status.ok(), "Handling write error with status OK.");
 
   // Only handle permanent errors here. If it's transient, just let the retry
@@ -510,10 +650,22 @@ void RemoteStore::HandleWriteError(const Status& status) {
     return;
   }
 
+  // The backend rejects packed batches together, so there is no telling which
+  // one was at fault. Retry the first one on its own; if it succeeds, the next
+  // rejection of the rest narrows it down further.
+  if (failed_batch_count > 1) {
+    LOG_DEBUG("RemoteStore %s retrying the first of %s rejected batches alone",
+              this, failed_batch_count);
+    isolate_first_write_ = true;
+    write_stream_->InhibitBackoff();
+    return;
+  }
+
   // If this was a permanent error, the request itself was the problem so it's
   // not going to succeed if we resend it.
   MutationBatch batch = write_pipeline_.front();
   write_pipeline_.erase(write_pipeline_.begin());
+  UpdateNetworkMetrics();
 
   // In this case it's also unlikely that the server itself is melting
   // down--this was just a bad request so inhibit backoff on the next restart.
@@ -532,10 +684,30 @@ bool RemoteStore::CanUseNetwork() const {
   return is_network_enabled_;
 }
 
+void RemoteStore::CommitMutations(const std::vector<Mutation>& mutations,
+                                  Datastore::CommitCallback&& callback) {
+  datastore_->CommitMutations(mutations, std::move(callback));
+}
+
 std::shared_ptr<Transaction> RemoteStore::CreateTransaction() {
   return std::make_shared<Transaction>(datastore_.get());
 }
 
+void RemoteStore::LookupDocuments(const std::vector<model::DocumentKey>& keys,
+                                  Datastore::LookupCallback&& callback) {
+  datastore_->LookupDocuments(keys, std::move(callback));
+}
+
+void RemoteStore::RunCountQuery(const core::Query& query,
+                                Datastore::CountCallback&& callback) {
+  datastore_->RunCountQuery(query, std::move(callback));
+}
+
+void RemoteStore::RunQuery(const core::Query& query,
+                           Datastore::RunQueryCallback&& callback) {
+  datastore_->RunQuery(query, std::move(callback));
+}
+
 DocumentKeySet RemoteStore::GetRemoteKeysForTarget(TargetId target_id) const {
   return sync_engine_->GetRemoteKeys(target_id);
 }
@@ -547,6 +719,10 @@ absl::optional<TargetData> RemoteStore::GetTargetDataForTarget(
                                         : absl::optional<TargetData>{};
 }
 
+const DatabaseId& RemoteStore::GetDatabaseId() const {
+  return datastore_->database_id();
+}
+
 void RemoteStore::RestartNetwork() {
   is_network_enabled_ = false;
   DisableNetworkInternal();
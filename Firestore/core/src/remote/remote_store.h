@@ -17,20 +17,28 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_REMOTE_STORE_H_
 #define FIRESTORE_CORE_SRC_REMOTE_REMOTE_STORE_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <deque>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Firestore/core/src/core/transaction.h"
 #include "Firestore/core/src/local/target_data.h"
 #include "Firestore/core/src/model/model_fwd.h"
 #include "Firestore/core/src/model/mutation_batch.h"
+#include "Firestore/core/src/model/mutation_batch_result.h"
 #include "Firestore/core/src/model/types.h"
 #include "Firestore/core/src/remote/datastore.h"
+#include "Firestore/core/src/remote/network_metrics.h"
 #include "Firestore/core/src/remote/online_state_tracker.h"
 #include "Firestore/core/src/remote/remote_event.h"
+#include "Firestore/core/src/remote/stream_idle_timeout.h"
 #include "Firestore/core/src/remote/watch_change.h"
 #include "Firestore/core/src/remote/watch_stream.h"
+#include "Firestore/core/src/remote/watch_stream_recorder.h"
+#include "Firestore/core/src/remote/write_pipeline_depth.h"
 #include "Firestore/core/src/remote/write_stream.h"
 #include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/status_fwd.h"
@@ -81,6 +89,17 @@ class RemoteStoreCallback {
   virtual void HandleSuccessfulWrite(
       const model::MutationBatchResult& batch_result) = 0;
 
+  /**
+   * Applies the results of several successful writes, in order, as if by
+   * calling `HandleSuccessfulWrite` for each.
+   */
+  virtual void HandleSuccessfulWrites(
+      const std::vector<model::MutationBatchResult>& batch_results) {
+    for (const model::MutationBatchResult& batch_result : batch_results) {
+      HandleSuccessfulWrite(batch_result);
+    }
+  }
+
   /**
    * Rejects the batch, removing the batch from the mutation queue, recomputing
    * the local view of any documents affected by the batch and then, emitting
@@ -118,6 +137,85 @@ class RemoteStore : public TargetMetadataProvider,
     sync_engine_ = sync_engine;
   }
 
+  /**
+   * Sets how many mutation batches may be outstanding on the write stream.
+   * Must be called before `Start()`.
+   */
+  void set_write_pipeline_depth(WritePipelineDepth depth) {
+    write_pipeline_depth_ = depth;
+  }
+
+  /**
+   * Sets how many consecutive mutation batches may be sent in a single write
+   * request. The backend commits a request atomically, so batches that are
+   * rejected together are retried in requests of their own. Must be called
+   * before `Start()`.
+   */
+  void set_max_batches_per_write_request(int max_batches) {
+    max_batches_per_write_request_ = max_batches;
+  }
+
+  /**
+   * Defers applying write acknowledgements until the operations queued on
+   * `worker_queue` when they arrived have run, so that acknowledgements that
+   * arrive in quick succession are applied together.
+   */
+  void EnableAckCoalescing(std::shared_ptr<util::AsyncQueue> worker_queue) {
+    worker_queue_ = std::move(worker_queue);
+  }
+
+  /**
+   * Applies the write acknowledgements that haven't been applied yet. Must be
+   * called before anything that depends on the mutation queue of the current
+   * user, like switching users.
+   */
+  void FlushWriteAcknowledgements();
+
+  /**
+   * The ID of the newest mutation batch that has been handed to the write
+   * stream, or `kBatchIdUnknown` if there's none. Batches after it haven't been
+   * sent yet.
+   */
+  model::BatchId last_batch_id_in_write_pipeline() const {
+    if (!write_pipeline_.empty()) return write_pipeline_.back().batch_id();
+    // Acknowledged batches stay in the mutation queue until they're applied.
+    if (!pending_acknowledgements_.empty()) {
+      return pending_acknowledgements_.back().batch().batch_id();
+    }
+    return model::kBatchIdUnknown;
+  }
+
+  /**
+   * Metrics about the network activity of the watch and write streams and the
+   * targets and writes they carry. Can be read from any thread.
+   */
+  std::shared_ptr<const NetworkMetrics> network_metrics() const {
+    return datastore_->metrics();
+  }
+
+  /** Counters for the transactions run through this store. */
+  TransactionMetrics& transaction_metrics() {
+    return datastore_->metrics()->transactions();
+  }
+
+  /**
+   * Sets how long the watch and write streams stay open once they have nothing
+   * to do. Each stream adapts its own copy, if adaptive.
+   */
+  void set_stream_idle_timeout(StreamIdleTimeout idle_timeout) {
+    watch_stream_->set_idle_timeout(idle_timeout);
+    write_stream_->set_idle_timeout(idle_timeout);
+  }
+
+  /**
+   * Records the messages of the watch stream into `recorder`, or stops
+   * recording if it's null. See `WatchStream::set_recorder()`.
+   */
+  void set_watch_stream_recorder(
+      std::shared_ptr<WatchStreamRecorder> recorder) {
+    watch_stream_->set_recorder(std::move(recorder));
+  }
+
   /**
    * Starts up the remote store, creating streams, restoring state from
    * `LocalStore`, etc.
@@ -184,15 +282,44 @@ class RemoteStore : public TargetMetadataProvider,
    */
   void AddToWritePipeline(const model::MutationBatch& batch);
 
+  /**
+   * Commits the given mutations to the backend in a single request, bypassing
+   * the write stream. The callback is invoked on the worker queue.
+   */
+  void CommitMutations(const std::vector<model::Mutation>& mutations,
+                       Datastore::CommitCallback&& callback);
+
   /** Returns a new transaction backed by this remote store. */
   // TODO(c++14): return a plain value when it becomes possible to move
   // `Transaction` into lambdas.
   std::shared_ptr<core::Transaction> CreateTransaction();
 
+  /**
+   * Fetches the current state of the given documents from the backend. The
+   * callback is invoked on the worker queue.
+   */
+  void LookupDocuments(const std::vector<model::DocumentKey>& keys,
+                       Datastore::LookupCallback&& callback);
+
+  /**
+   * Counts the documents on the backend that match the given query. The
+   * callback is invoked on the worker queue.
+   */
+  void RunCountQuery(const core::Query& query,
+                     Datastore::CountCallback&& callback);
+
+  /**
+   * Runs the given query on the backend once, without listening to it. The
+   * callback is invoked on the worker queue.
+   */
+  void RunQuery(const core::Query& query,
+                Datastore::RunQueryCallback&& callback);
+
   model::DocumentKeySet GetRemoteKeysForTarget(
       model::TargetId target_id) const override;
   absl::optional<local::TargetData> GetTargetDataForTarget(
       model::TargetId target_id) const override;
+  const model::DatabaseId& GetDatabaseId() const override;
 
   void OnWatchStreamOpen() override;
   void OnWatchStreamChange(
@@ -210,6 +337,7 @@ class RemoteStore : public TargetMetadataProvider,
  private:
   void RestartNetwork();
   void DisableNetworkInternal();
+  void UpdateNetworkMetrics();
 
   void SendWatchRequest(const local::TargetData& target_data);
   void SendUnwatchRequest(model::TargetId target_id);
@@ -229,6 +357,12 @@ class RemoteStore : public TargetMetadataProvider,
    */
   bool CanAddToWritePipeline() const;
 
+  /**
+   * Sends the batches in the write pipeline that haven't been sent on the
+   * current write stream, packing them into as few requests as allowed.
+   */
+  void SendPendingWrites();
+
   void StartWriteStream();
 
   /**
@@ -238,7 +372,12 @@ class RemoteStore : public TargetMetadataProvider,
   bool ShouldStartWriteStream() const;
 
   void HandleHandshakeError(const util::Status& status);
-  void HandleWriteError(const util::Status& status);
+  /**
+   * Handles the failure of the first unacknowledged write request, which
+   * packed `failed_batch_count` batches.
+   */
+  void HandleWriteError(const util::Status& status,
+                        size_t failed_batch_count);
 
   void StartWatchStream();
 
@@ -287,9 +426,9 @@ class RemoteStore : public TargetMetadataProvider,
   std::unique_ptr<WatchChangeAggregator> watch_change_aggregator_;
 
   /**
-   * A list of up to `kMaxPendingWrites` writes that we have fetched from the
-   * `LocalStore` via `FillWritePipeline` and have or will send to the write
-   * stream.
+   * A list of up to `write_pipeline_depth_.depth()` writes that we have
+   * fetched from the `LocalStore` via `FillWritePipeline` and have or will
+   * send to the write stream.
    *
    * Whenever `write_pipeline_` is not empty, the `RemoteStore` will attempt to
    * start or restart the write stream. When the stream is established, the
@@ -304,6 +443,36 @@ class RemoteStore : public TargetMetadataProvider,
    * the `write_pipeline_` as we receive responses.
    */
   std::vector<model::MutationBatch> write_pipeline_;
+
+  /** A write request sent on the current write stream. */
+  struct WriteRequestInfo {
+    /** The number of batches from `write_pipeline_` packed in the request. */
+    size_t batch_count;
+    std::chrono::steady_clock::time_point sent_time;
+  };
+
+  /**
+   * The unacknowledged requests sent on the current write stream, in order.
+   * They cover a prefix of `write_pipeline_`.
+   */
+  std::deque<WriteRequestInfo> write_requests_;
+
+  WritePipelineDepth write_pipeline_depth_;
+  int max_batches_per_write_request_ = 1;
+
+  /**
+   * Set when a request packing several batches was rejected, so that the
+   * first batch of the pipeline is sent on its own to find out whether it was
+   * to blame.
+   */
+  bool isolate_first_write_ = false;
+
+  // Only set if acknowledgements are coalesced.
+  std::shared_ptr<util::AsyncQueue> worker_queue_;
+
+  /** The acknowledged batches that haven't been applied yet, in order. */
+  std::vector<model::MutationBatchResult> pending_acknowledgements_;
+  util::DelayedOperation acknowledgements_callback_;
 };
 
 }  // namespace remote
@@ -23,9 +23,11 @@
 #include <functional>
 #include <limits>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Firestore/Protos/nanopb/google/firestore/v1/document.nanopb.h"
 #include "Firestore/Protos/nanopb/google/firestore/v1/firestore.nanopb.h"
@@ -45,14 +47,17 @@
 #include "Firestore/core/src/model/set_mutation.h"
 #include "Firestore/core/src/model/verify_mutation.h"
 #include "Firestore/core/src/nanopb/byte_string.h"
+#include "Firestore/core/src/nanopb/message.h"
 #include "Firestore/core/src/nanopb/nanopb_util.h"
 #include "Firestore/core/src/nanopb/reader.h"
 #include "Firestore/core/src/nanopb/writer.h"
 #include "Firestore/core/src/timestamp_internal.h"
 #include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/log.h"
 #include "Firestore/core/src/util/status.h"
 #include "Firestore/core/src/util/statusor.h"
 #include "Firestore/core/src/util/string_format.h"
+#include "Firestore/core/src/util/string_util.h"
 #include "absl/algorithm/container.h"
 
 namespace firebase {
@@ -101,6 +106,7 @@ using nanopb::ByteString;
 using nanopb::CheckedSize;
 using nanopb::MakeArray;
 using nanopb::MakeStringView;
+using nanopb::Message;
 using nanopb::SafeReadBoolean;
 using nanopb::Writer;
 using remote::WatchChange;
@@ -117,6 +123,15 @@ std::string Serializer::DecodeString(const pb_bytes_array_t* str) {
   return nanopb::MakeString(str);
 }
 
+std::string Serializer::DecodeUtf8String(ReadContext* context,
+                                         const pb_bytes_array_t* str) const {
+  if (validates_utf8_ && !util::IsValidUtf8(MakeStringView(str))) {
+    context->Fail("Invalid message: string is not valid UTF-8");
+    return {};
+  }
+  return DecodeString(str);
+}
+
 namespace {
 
 /**
@@ -273,7 +288,7 @@ google_firestore_v1_Value Serializer::EncodeBlob(
   google_firestore_v1_Value result{};
   result.which_value_type = google_firestore_v1_Value_bytes_value_tag;
   // Copy the blob so that pb_release can do the right thing.
-  result.bytes_value = nanopb::CopyBytesArray(value.get());
+  result.bytes_value = nanopb::CopyBytesArray(value);
   return result;
 }
 
@@ -307,7 +322,7 @@ google_firestore_v1_Value Serializer::EncodeGeoPoint(
 FieldValue::Map::value_type Serializer::DecodeFieldsEntry(
     ReadContext* context,
     const google_firestore_v1_Document_FieldsEntry& fields) const {
-  std::string key = DecodeString(fields.key);
+  std::string key = DecodeUtf8String(context, fields.key);
   FieldValue value = DecodeFieldValue(context, fields.value);
 
   if (key.empty()) {
@@ -337,7 +352,7 @@ FieldValue::Map Serializer::DecodeMapValue(
   FieldValue::Map result;
 
   for (size_t i = 0; i < map_value.fields_count; i++) {
-    std::string key = DecodeString(map_value.fields[i].key);
+    std::string key = DecodeUtf8String(context, map_value.fields[i].key);
     FieldValue value = DecodeFieldValue(context, map_value.fields[i].value);
 
     result = result.insert(key, value);
@@ -372,7 +387,8 @@ FieldValue Serializer::DecodeFieldValue(
     }
 
     case google_firestore_v1_Value_string_value_tag:
-      return FieldValue::FromString(DecodeString(msg.string_value));
+      return FieldValue::FromString(
+          DecodeUtf8String(context, msg.string_value));
 
     case google_firestore_v1_Value_bytes_value_tag:
       return FieldValue::FromBlob(ByteString(msg.bytes_value));
@@ -855,7 +871,7 @@ google_firestore_v1_Target Serializer::EncodeTarget(
   google_firestore_v1_Target result{};
   const Target& target = target_data.target();
 
-  if (target.IsDocumentQuery()) {
+  if (target.IsDocumentQuery() || target.IsMultiDocumentQuery()) {
     result.which_target_type = google_firestore_v1_Target_documents_tag;
     result.target_type.documents = EncodeDocumentsTarget(target);
   } else {
@@ -867,7 +883,13 @@ google_firestore_v1_Target Serializer::EncodeTarget(
   if (!target_data.resume_token().empty()) {
     result.which_resume_type = google_firestore_v1_Target_resume_token_tag;
     result.resume_type.resume_token =
-        nanopb::CopyBytesArray(target_data.resume_token().get());
+        nanopb::CopyBytesArray(target_data.resume_token());
+
+    // The expected count is only meaningful relative to a resume token.
+    if (target_data.expected_count()) {
+      result.has_expected_count = true;
+      result.expected_count.value = *target_data.expected_count();
+    }
   }
 
   return result;
@@ -877,9 +899,12 @@ google_firestore_v1_Target_DocumentsTarget Serializer::EncodeDocumentsTarget(
     const core::Target& target) const {
   google_firestore_v1_Target_DocumentsTarget result{};
 
-  result.documents_count = 1;
+  std::vector<DocumentKey> keys = target.GetDocumentKeys();
+  result.documents_count = CheckedSize(keys.size());
   result.documents = MakeArray<pb_bytes_array_t*>(result.documents_count);
-  result.documents[0] = EncodeQueryPath(target.path());
+  for (size_t i = 0; i != keys.size(); ++i) {
+    result.documents[i] = EncodeQueryPath(keys[i].path());
+  }
 
   return result;
 }
@@ -887,16 +912,35 @@ google_firestore_v1_Target_DocumentsTarget Serializer::EncodeDocumentsTarget(
 Target Serializer::DecodeDocumentsTarget(
     ReadContext* context,
     const google_firestore_v1_Target_DocumentsTarget& proto) const {
-  if (proto.documents_count != 1) {
-    context->Fail(
-        StringFormat("DocumentsTarget contained other than 1 document %s",
-                     proto.documents_count));
+  if (proto.documents_count == 0) {
+    context->Fail("DocumentsTarget contained no documents");
     return {};
   }
 
-  ResourcePath path =
-      DecodeQueryPath(context, DecodeString(proto.documents[0]));
-  return Query(std::move(path)).ToTarget();
+  if (proto.documents_count == 1) {
+    ResourcePath path =
+        DecodeQueryPath(context, DecodeString(proto.documents[0]));
+    return Query(std::move(path)).ToTarget();
+  }
+
+  // Keep the documents in their encoded order so that the decoded Target is
+  // equal to the one that was encoded.
+  std::vector<DocumentKey> keys;
+  for (pb_size_t i = 0; i != proto.documents_count; ++i) {
+    ResourcePath path =
+        DecodeQueryPath(context, DecodeString(proto.documents[i]));
+    if (!context->status().ok()) return {};
+    if (!DocumentKey::IsDocumentKey(path) ||
+        (!keys.empty() && path.PopLast() != keys.front().path().PopLast())) {
+      context->Fail(StringFormat(
+          "DocumentsTarget contained documents of different collections %s",
+          path.CanonicalString()));
+      return {};
+    }
+    keys.emplace_back(std::move(path));
+  }
+
+  return Query::ForDocuments(database_id_, keys).ToTarget();
 }
 
 google_firestore_v1_Target_QueryTarget Serializer::EncodeQueryTarget(
@@ -1568,7 +1612,7 @@ std::string Serializer::EncodeLabel(QueryPurpose purpose) const {
 
 std::unique_ptr<WatchChange> Serializer::DecodeWatchChange(
     ReadContext* context,
-    const google_firestore_v1_ListenResponse& watch_change) const {
+    google_firestore_v1_ListenResponse& watch_change) const {
   switch (watch_change.which_response_type) {
     case google_firestore_v1_ListenResponse_target_change_tag:
       return DecodeTargetChange(context, watch_change.target_change);
@@ -1651,7 +1695,7 @@ WatchTargetChangeState Serializer::DecodeTargetChangeState(
 
 std::unique_ptr<WatchChange> Serializer::DecodeDocumentChange(
     ReadContext* context,
-    const google_firestore_v1_DocumentChange& change) const {
+    google_firestore_v1_DocumentChange& change) const {
   ObjectValue value = DecodeFields(context, change.document.fields_count,
                                    change.document.fields);
   DocumentKey key = DecodeKey(context, change.document.name);
@@ -1660,13 +1704,17 @@ std::unique_ptr<WatchChange> Serializer::DecodeDocumentChange(
               "Got a document change with no snapshot version");
   SnapshotVersion version = DecodeVersion(context, change.document.update_time);
 
-  // TODO(b/142956770): other platforms memoize `change.document` inside the
-  // `Document`. This currently cannot be implemented efficiently because it
-  // would require a reference-counted ownership model for the proto (copying it
-  // would defeat the purpose). Note, however, that even without this
-  // optimization C++ implementation is on par with the preceding Objective-C
-  // implementation.
-  Document document(std::move(value), key, version, DocumentState::kSynced);
+  // Memoize the proto inside the `Document`, so that persisting the document
+  // doesn't need to re-encode its fields. The proto is moved out of `change`
+  // rather than copied; the local cache doesn't store the create time.
+  auto proto = std::make_shared<Message<google_firestore_v1_Document>>();
+  **proto = change.document;
+  change.document = google_firestore_v1_Document{};
+  (*proto)->create_time = {};
+
+  Document document(
+      std::move(value), key, version, DocumentState::kSynced,
+      std::shared_ptr<const google_firestore_v1_Document>(proto, proto->get()));
 
   std::vector<TargetId> updated_target_ids(
       change.target_ids, change.target_ids + change.target_ids_count);
@@ -1714,7 +1762,29 @@ std::unique_ptr<WatchChange> Serializer::DecodeDocumentRemove(
 
 std::unique_ptr<WatchChange> Serializer::DecodeExistenceFilterWatchChange(
     ReadContext*, const google_firestore_v1_ExistenceFilter& filter) const {
-  ExistenceFilter existence_filter{filter.count};
+  absl::optional<BloomFilter> unchanged_names;
+  if (filter.has_unchanged_names) {
+    const google_firestore_v1_BloomFilter& bloom_filter =
+        filter.unchanged_names;
+    const pb_bytes_array_t* bitmap = bloom_filter.bits.bitmap;
+    std::vector<uint8_t> bits;
+    if (bitmap) {
+      bits.assign(bitmap->bytes, bitmap->bytes + bitmap->size);
+    }
+
+    // A malformed bloom filter isn't fatal: without it, a mismatched existence
+    // filter simply resets the target, as it did before bloom filters existed.
+    StatusOr<BloomFilter> maybe_bloom_filter = BloomFilter::Create(
+        std::move(bits), bloom_filter.bits.padding, bloom_filter.hash_count);
+    if (maybe_bloom_filter.ok()) {
+      unchanged_names = std::move(maybe_bloom_filter).ValueOrDie();
+    } else {
+      LOG_WARN("Ignoring invalid bloom filter in existence filter: %s",
+               maybe_bloom_filter.status().ToString());
+    }
+  }
+
+  ExistenceFilter existence_filter{filter.count, std::move(unchanged_names)};
   return absl::make_unique<ExistenceFilterWatchChange>(existence_filter,
                                                        filter.target_id);
 }
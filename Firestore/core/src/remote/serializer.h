@@ -84,6 +84,20 @@ class Serializer {
    */
   explicit Serializer(model::DatabaseId database_id);
 
+  const model::DatabaseId& database_id() const {
+    return database_id_;
+  }
+
+  /**
+   * Sets whether decoding fails for string values and map keys that aren't
+   * valid UTF-8. This should be enabled for data received from the backend. It
+   * is off by default, since data persisted locally may contain strings that
+   * were never validated, and failing to decode it would be fatal.
+   */
+  void set_validates_utf8(bool validates_utf8) {
+    validates_utf8_ = validates_utf8;
+  }
+
   /**
    * Encodes the string to nanopb bytes.
    *
@@ -236,7 +250,7 @@ class Serializer {
 
   std::unique_ptr<remote::WatchChange> DecodeWatchChange(
       util::ReadContext* context,
-      const google_firestore_v1_ListenResponse& watch_change) const;
+      google_firestore_v1_ListenResponse& watch_change) const;
 
   model::SnapshotVersion DecodeVersionFromListenResponse(
       util::ReadContext* context,
@@ -363,7 +377,7 @@ class Serializer {
 
   std::unique_ptr<remote::WatchChange> DecodeDocumentChange(
       util::ReadContext* context,
-      const google_firestore_v1_DocumentChange& change) const;
+      google_firestore_v1_DocumentChange& change) const;
   std::unique_ptr<remote::WatchChange> DecodeDocumentDelete(
       util::ReadContext* context,
       const google_firestore_v1_DocumentDelete& change) const;
@@ -374,7 +388,15 @@ class Serializer {
       util::ReadContext* context,
       const google_firestore_v1_ExistenceFilter& filter) const;
 
+  /**
+   * Decodes a string value or map key, failing if it must be valid UTF-8 and
+   * isn't.
+   */
+  std::string DecodeUtf8String(util::ReadContext* context,
+                               const pb_bytes_array_t* str) const;
+
   model::DatabaseId database_id_;
+  bool validates_utf8_ = false;
   // TODO(varconst): Android caches the result of calling `EncodeDatabaseName`
   // as well, consider implementing that.
 };
@@ -48,8 +48,6 @@ using util::TimerId;
 const double kBackoffFactor = 1.5;
 const AsyncQueue::Milliseconds kBackoffInitialDelay{std::chrono::seconds(1)};
 const AsyncQueue::Milliseconds kBackoffMaxDelay{std::chrono::seconds(60)};
-/** The time a stream stays open after it is marked idle. */
-const AsyncQueue::Milliseconds kIdleTimeout{std::chrono::seconds(60)};
 
 }  // namespace
 
@@ -64,6 +62,10 @@ Stream::Stream(const std::shared_ptr<AsyncQueue>& worker_queue,
       worker_queue_{worker_queue},
       grpc_connection_{grpc_connection},
       idle_timer_id_{idle_timer_id} {
+  if (grpc_connection_) {
+    backoff_.set_jitter(grpc_connection_->backoff_jitter());
+    backoff_.set_shared_state(grpc_connection_->backoff_state());
+  }
 }
 
 // Check state
@@ -135,6 +137,7 @@ void Stream::ResumeStartWithCredentials(const StatusOr<Token>& maybe_token) {
   }
 
   grpc_stream_ = CreateGrpcStream(grpc_connection_, maybe_token.ValueOrDie());
+  grpc_stream_->SetMetrics(metrics_);
   grpc_stream_->Start();
 }
 
@@ -142,6 +145,7 @@ void Stream::OnStreamStart() {
   EnsureOnQueue();
 
   state_ = State::Open;
+  metrics_->RecordOpen();
   NotifyStreamOpen();
 }
 
@@ -156,6 +160,7 @@ void Stream::BackoffAndTryRestarting() {
               "Should only perform backoff in an error case");
 
   state_ = State::Backoff;
+  metrics_->RecordBackoff();
   backoff_.BackoffAndRun([this] {
     HARD_ASSERT(state_ == State::Backoff,
                 "Backoff elapsed but state is now: %s", state_);
@@ -183,11 +188,36 @@ void Stream::MarkIdle() {
   EnsureOnQueue();
 
   if (IsOpen() && !idleness_timer_) {
+    if (!idle_since_) {
+      idle_since_ = std::chrono::steady_clock::now();
+    }
     idleness_timer_ = worker_queue_->EnqueueAfterDelay(
-        kIdleTimeout, idle_timer_id_, [this] { Stop(); });
+        idle_timeout_.timeout(), idle_timer_id_,
+        [this] { StopDueToIdleness(); });
   }
 }
 
+void Stream::StopDueToIdleness() {
+  EnsureOnQueue();
+
+  // Keep the start of the idle period across the close.
+  absl::optional<std::chrono::steady_clock::time_point> idle_since =
+      idle_since_;
+  LOG_DEBUG("%s closing after being idle for %s ms", GetDebugDescription(),
+            idle_timeout_.timeout().count());
+  Stop();
+  idle_since_ = idle_since;
+}
+
+void Stream::RecordActivity() {
+  if (!idle_since_) return;
+
+  idle_timeout_.RecordIdlePeriod(
+      std::chrono::duration_cast<StreamIdleTimeout::Duration>(
+          std::chrono::steady_clock::now() - *idle_since_));
+  idle_since_.reset();
+}
+
 void Stream::CancelIdleCheck() {
   EnsureOnQueue();
   idleness_timer_.Cancel();
@@ -200,13 +230,34 @@ void Stream::OnStreamRead(const grpc::ByteBuffer& message) {
 
   HARD_ASSERT(IsStarted(), "OnStreamRead called for a stopped stream.");
 
+  LogResponseHeaders();
+  HandleReadStatus(NotifyStreamResponse(message));
+}
+
+void Stream::OnStreamDecodedRead(std::unique_ptr<GrpcDecodedMessage> message) {
+  EnsureOnQueue();
+
+  HARD_ASSERT(IsStarted(), "OnStreamDecodedRead called for a stopped stream.");
+
+  LogResponseHeaders();
+  HandleReadStatus(NotifyDecodedStreamResponse(std::move(message)));
+}
+
+Status Stream::NotifyDecodedStreamResponse(
+    std::unique_ptr<GrpcDecodedMessage>) {
+  HARD_FAIL("%s received a decoded message without a message decoder",
+            GetDebugDescription());
+}
+
+void Stream::LogResponseHeaders() const {
   if (LogIsDebugEnabled()) {
     LOG_DEBUG("%s headers (allowlisted): %s", GetDebugDescription(),
               Datastore::GetAllowlistedHeadersAsString(
                   grpc_stream_->GetResponseHeaders()));
   }
+}
 
-  Status read_status = NotifyStreamResponse(message);
+void Stream::HandleReadStatus(const Status& read_status) {
   if (!read_status.ok()) {
     grpc_stream_->FinishImmediately();
     // Don't expect gRPC to produce status -- since the error happened on the
@@ -244,6 +295,7 @@ void Stream::Close(const Status& status) {
   // Step 2 (both): cancel any outstanding timers (they're guaranteed not to
   // execute).
   CancelIdleCheck();
+  idle_since_.reset();
   backoff_.Cancel();
 
   // Step 3 (both): increment close count, which invalidates long-lived
@@ -258,6 +310,7 @@ void Stream::Close(const Status& status) {
     // connection attempt.
     backoff_.Reset();
   } else {
+    metrics_->RecordError();
     HandleErrorStatus(status);
   }
 
@@ -296,6 +349,11 @@ void Stream::OnStreamFinish(const Status& status) {
 
   if (!status.ok()) {
     LOG_WARN("%s Stream error: '%s'", GetDebugDescription(), status.ToString());
+    if (grpc_stream_ && grpc_stream_->retry_delay()) {
+      LOG_DEBUG("%s Backend asked to retry in %s ms", GetDebugDescription(),
+                grpc_stream_->retry_delay()->count());
+      backoff_.SetMinimumNextDelay(*grpc_stream_->retry_delay());
+    }
   } else {
     LOG_DEBUG("%s Stream closing: '%s'", GetDebugDescription(),
               status.ToString());
@@ -316,6 +374,7 @@ void Stream::Write(grpc::ByteBuffer&& message) {
   HARD_ASSERT(IsOpen(), "Cannot write when the stream is not open.");
 
   CancelIdleCheck();
+  RecordActivity();
   grpc_stream_->Write(std::move(message));
 }
 
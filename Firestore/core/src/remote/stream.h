@@ -17,8 +17,10 @@
 #ifndef FIRESTORE_CORE_SRC_REMOTE_STREAM_H_
 #define FIRESTORE_CORE_SRC_REMOTE_STREAM_H_
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "Firestore/core/src/auth/credentials_provider.h"
 #include "Firestore/core/src/auth/token.h"
@@ -26,10 +28,13 @@
 #include "Firestore/core/src/remote/grpc_completion.h"
 #include "Firestore/core/src/remote/grpc_connection.h"
 #include "Firestore/core/src/remote/grpc_stream.h"
+#include "Firestore/core/src/remote/network_metrics.h"
 #include "Firestore/core/src/remote/remote_objc_bridge.h"
+#include "Firestore/core/src/remote/stream_idle_timeout.h"
 #include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/status_fwd.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "grpcpp/support/byte_buffer.h"
 
 namespace firebase {
@@ -44,7 +49,7 @@ namespace remote {
  *   - Exponential backoff on failure (independent of the gRPC mechanism)
  *   - Authentication via CredentialsProvider
  *   - Dispatching all callbacks into the shared Firestore async queue
- *   - Closing idle streams after 60 seconds of inactivity
+ *   - Closing idle streams after (by default) 60 seconds of inactivity
  *
  * Subclasses of `Stream`:
  *
@@ -167,9 +172,29 @@ class Stream : public GrpcStreamObserver,
    */
   void InhibitBackoff();
 
+  /**
+   * Sets the metrics the stream records its activity in. Call before `Start`.
+   */
+  void set_metrics(std::shared_ptr<StreamMetrics> metrics) {
+    metrics_ = std::move(metrics);
+  }
+
+  const std::shared_ptr<StreamMetrics>& metrics() const {
+    return metrics_;
+  }
+
+  /**
+   * Sets how long the stream stays open once it's marked idle. Takes effect the
+   * next time the stream is marked idle.
+   */
+  void set_idle_timeout(StreamIdleTimeout idle_timeout) {
+    idle_timeout_ = idle_timeout;
+  }
+
   /**
    * Marks this stream as idle. If no further actions are performed on the
-   * stream for one minute, the stream will automatically close itself and
+   * stream for the idle timeout (one minute unless configured otherwise, see
+   * `set_idle_timeout`), the stream will automatically close itself and
    * notify the stream's `OnClose` handler with Status::OK. The stream will then
    * be in a non-started state, requiring the caller to start the stream again
    * before further use.
@@ -189,6 +214,8 @@ class Stream : public GrpcStreamObserver,
   // `GrpcStreamObserver` interface -- do not use.
   void OnStreamStart() override;
   void OnStreamRead(const grpc::ByteBuffer& message) override;
+  void OnStreamDecodedRead(
+      std::unique_ptr<GrpcDecodedMessage> message) override;
   void OnStreamFinish(const util::Status& status) override;
 
  protected:
@@ -208,11 +235,17 @@ class Stream : public GrpcStreamObserver,
   virtual void NotifyStreamOpen() = 0;
   virtual util::Status NotifyStreamResponse(
       const grpc::ByteBuffer& message) = 0;
+  // Only needs to be implemented by streams that set a message decoder on
+  // their `GrpcStream`.
+  virtual util::Status NotifyDecodedStreamResponse(
+      std::unique_ptr<GrpcDecodedMessage> message);
   virtual void NotifyStreamClose(const util::Status& status) = 0;
   // PORTING NOTE: C++ cannot rely on RTTI, unlike other platforms.
   virtual std::string GetDebugName() const = 0;
 
   void Close(const util::Status& status);
+  void LogResponseHeaders() const;
+  void HandleReadStatus(const util::Status& read_status);
   void HandleErrorStatus(const util::Status& status);
 
   void RequestCredentials();
@@ -221,6 +254,8 @@ class Stream : public GrpcStreamObserver,
 
   void BackoffAndTryRestarting();
   void StopDueToIdleness();
+  // Ends the current idle period, if any, and records it with `idle_timeout_`.
+  void RecordActivity();
 
   State state_ = State::Initial;
 
@@ -232,6 +267,13 @@ class Stream : public GrpcStreamObserver,
 
   util::TimerId idle_timer_id_{};
   util::DelayedOperation idleness_timer_;
+  StreamIdleTimeout idle_timeout_;
+  std::shared_ptr<StreamMetrics> metrics_ = std::make_shared<StreamMetrics>();
+
+  // When the stream was marked idle, if it hasn't been used since. Kept when
+  // the stream is closed due to idleness, so that reopening it is recorded as
+  // the end of the idle period.
+  absl::optional<std::chrono::steady_clock::time_point> idle_since_;
 
   // Used to prevent auth if the stream happens to be restarted before token is
   // received.
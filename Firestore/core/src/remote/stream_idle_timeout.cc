@@ -0,0 +1,51 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/stream_idle_timeout.h"
+
+#include <algorithm>
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+constexpr StreamIdleTimeout::Duration StreamIdleTimeout::kDefaultTimeout;
+constexpr StreamIdleTimeout::Duration StreamIdleTimeout::kMaxAdaptiveTimeout;
+
+StreamIdleTimeout::StreamIdleTimeout(Duration timeout, bool adaptive)
+    : adaptive_(adaptive),
+      initial_timeout_(std::max(timeout, Duration::zero())),
+      timeout_(initial_timeout_) {
+}
+
+void StreamIdleTimeout::RecordIdlePeriod(Duration idle_time) {
+  if (!adaptive_) return;
+
+  // Decay the expectation by a quarter for every idle period, so that the
+  // timeout shrinks back once the app stops using the stream as often.
+  expected_idle_time_ -= expected_idle_time_ / 4;
+  if (idle_time <= kMaxAdaptiveTimeout) {
+    expected_idle_time_ = std::max(expected_idle_time_, idle_time);
+  }
+
+  Duration max_timeout = std::max(initial_timeout_, kMaxAdaptiveTimeout);
+  Duration with_margin = expected_idle_time_ + expected_idle_time_ / 2;
+  timeout_ = std::min(std::max(initial_timeout_, with_margin), max_timeout);
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_REMOTE_STREAM_IDLE_TIMEOUT_H_
+#define FIRESTORE_CORE_SRC_REMOTE_STREAM_IDLE_TIMEOUT_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+/**
+ * Decides how long a `Stream` stays open after it is marked idle.
+ *
+ * By default the timeout is fixed. When adaptive, the stream records how long
+ * it stayed idle before it was used again, and the timeout is stretched to
+ * cover the recent idle periods (with some margin) so that an app that uses the
+ * stream at a steady cadence slightly longer than the timeout doesn't close and
+ * reopen it every time. Idle periods longer than `kMaxAdaptiveTimeout` don't
+ * stretch the timeout, and older idle periods are gradually forgotten.
+ */
+class StreamIdleTimeout {
+ public:
+  using Duration = std::chrono::milliseconds;
+
+  /** The timeout used unless configured otherwise. */
+  static constexpr Duration kDefaultTimeout{60 * 1000};
+
+  /** The longest an adaptive timeout grows to. */
+  static constexpr Duration kMaxAdaptiveTimeout{5 * 60 * 1000};
+
+  explicit StreamIdleTimeout(Duration timeout = kDefaultTimeout,
+                             bool adaptive = false);
+
+  /** How long the stream should stay open once it's marked idle. */
+  Duration timeout() const {
+    return timeout_;
+  }
+
+  bool adaptive() const {
+    return adaptive_;
+  }
+
+  /**
+   * Records that the stream was used again `idle_time` after it was marked
+   * idle, regardless of whether it was closed in between.
+   */
+  void RecordIdlePeriod(Duration idle_time);
+
+ private:
+  bool adaptive_ = false;
+  Duration initial_timeout_ = kDefaultTimeout;
+  Duration timeout_ = kDefaultTimeout;
+  Duration expected_idle_time_{};
+};
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_REMOTE_STREAM_IDLE_TIMEOUT_H_
@@ -16,6 +16,8 @@
 
 #include "Firestore/core/src/remote/watch_stream.h"
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <string>
 #include <utility>
 
 #include "Firestore/core/src/model/mutation.h"
@@ -25,6 +27,7 @@
 #include "Firestore/core/src/util/hard_assert.h"
 #include "Firestore/core/src/util/log.h"
 #include "Firestore/core/src/util/status.h"
+#include "absl/memory/memory.h"
 
 namespace firebase {
 namespace firestore {
@@ -36,10 +39,47 @@ using local::TargetData;
 using model::TargetId;
 using nanopb::Message;
 using remote::ByteBufferReader;
+using model::SnapshotVersion;
 using util::AsyncQueue;
+using util::LogIsDebugEnabled;
 using util::Status;
 using util::TimerId;
 
+namespace {
+
+/** A `ListenResponse` decoded into a `WatchChange`. */
+class DecodedListenResponse : public GrpcDecodedMessage {
+ public:
+  Status status;
+  bool parsed = false;
+  std::unique_ptr<WatchChange> watch_change;
+  SnapshotVersion version;
+
+  // Only set if debug logging is enabled.
+  std::string description;
+};
+
+std::unique_ptr<DecodedListenResponse> DecodeListenResponse(
+    const WatchStreamSerializer& serializer, const grpc::ByteBuffer& message) {
+  auto result = absl::make_unique<DecodedListenResponse>();
+
+  ByteBufferReader reader{message};
+  auto response = serializer.ParseResponse(&reader);
+  if (reader.ok()) {
+    result->parsed = true;
+    if (LogIsDebugEnabled()) {
+      result->description = response.ToString();
+    }
+    result->watch_change = serializer.DecodeWatchChange(&reader, *response);
+    result->version = serializer.DecodeSnapshotVersion(&reader, *response);
+  }
+
+  result->status = reader.status();
+  return result;
+}
+
+}  // namespace
+
 WatchStream::WatchStream(
     const std::shared_ptr<AsyncQueue>& async_queue,
     std::shared_ptr<CredentialsProvider> credentials_provider,
@@ -48,31 +88,59 @@ WatchStream::WatchStream(
     WatchStreamCallback* callback)
     : Stream{async_queue, std::move(credentials_provider), grpc_connection,
              TimerId::ListenStreamConnectionBackoff, TimerId::ListenStreamIdle},
-      watch_serializer_{std::move(serializer)},
+      watch_serializer_{
+          std::make_shared<WatchStreamSerializer>(std::move(serializer))},
       callback_{NOT_NULL(callback)} {
 }
 
 void WatchStream::WatchQuery(const TargetData& query) {
   EnsureOnQueue();
 
-  auto request = watch_serializer_.EncodeWatchRequest(query);
+  auto request = watch_serializer_->EncodeWatchRequest(query);
   LOG_DEBUG("%s watch: %s", GetDebugDescription(), request.ToString());
-  Write(MakeByteBuffer(request));
+  WriteRequest(MakeByteBuffer(request));
 }
 
 void WatchStream::UnwatchTargetId(TargetId target_id) {
   EnsureOnQueue();
 
-  auto request = watch_serializer_.EncodeUnwatchRequest(target_id);
+  auto request = watch_serializer_->EncodeUnwatchRequest(target_id);
 
   LOG_DEBUG("%s unwatch: %s", GetDebugDescription(), request.ToString());
-  Write(MakeByteBuffer(request));
+  WriteRequest(MakeByteBuffer(request));
+}
+
+void WatchStream::WriteRequest(grpc::ByteBuffer&& message) {
+  if (recorder_) {
+    recorder_->RecordRequest(message);
+  }
+  Write(std::move(message));
 }
 
 std::unique_ptr<GrpcStream> WatchStream::CreateGrpcStream(
     GrpcConnection* grpc_connection, const Token& token) {
-  return grpc_connection->CreateStream("/google.firestore.v1.Firestore/Listen",
-                                       token, this);
+  std::unique_ptr<GrpcStream> grpc_stream = grpc_connection->CreateStream(
+      "/google.firestore.v1.Firestore/Listen", token, this);
+
+  // Decode responses on the thread polling the gRPC completion queue, since
+  // large document changes would otherwise hold up the worker queue.
+  std::shared_ptr<const WatchStreamSerializer> serializer = watch_serializer_;
+  std::shared_ptr<StreamMetrics> stream_metrics = metrics();
+  std::shared_ptr<WatchStreamRecorder> recorder = recorder_;
+  grpc_stream->SetMessageDecoder(
+      [serializer, stream_metrics, recorder](const grpc::ByteBuffer& message) {
+        if (recorder) {
+          recorder->RecordResponse(message);
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<GrpcDecodedMessage> result(
+            DecodeListenResponse(*serializer, message));
+        stream_metrics->decode_time().Record(
+            std::chrono::duration_cast<LatencyHistogram::Duration>(
+                std::chrono::steady_clock::now() - start));
+        return result;
+      });
+  return grpc_stream;
 }
 
 void WatchStream::TearDown(GrpcStream* grpc_stream) {
@@ -84,29 +152,40 @@ void WatchStream::NotifyStreamOpen() {
 }
 
 Status WatchStream::NotifyStreamResponse(const grpc::ByteBuffer& message) {
-  ByteBufferReader reader{message};
-  auto response = watch_serializer_.ParseResponse(&reader);
-  if (!reader.ok()) {
-    return reader.status();
+  if (recorder_) {
+    recorder_->RecordResponse(message);
   }
+  return NotifyDecodedStreamResponse(
+      DecodeListenResponse(*watch_serializer_, message));
+}
 
-  LOG_DEBUG("%s response: %s", GetDebugDescription(), response.ToString());
+Status WatchStream::NotifyDecodedStreamResponse(
+    std::unique_ptr<GrpcDecodedMessage> message) {
+  HARD_ASSERT(message, "Missing decoded ListenResponse");
+  auto& response = static_cast<DecodedListenResponse&>(*message);
+
+  if (!response.parsed) {
+    return response.status;
+  }
+
+  LOG_DEBUG("%s response: %s", GetDebugDescription(), response.description);
 
   // A successful response means the stream is healthy.
   backoff_.Reset();
 
-  auto watch_change = watch_serializer_.DecodeWatchChange(&reader, *response);
-  auto version = watch_serializer_.DecodeSnapshotVersion(&reader, *response);
-  if (!reader.ok()) {
-    return reader.status();
+  if (!response.status.ok()) {
+    return response.status;
   }
 
-  callback_->OnWatchStreamChange(*watch_change, version);
+  callback_->OnWatchStreamChange(*response.watch_change, response.version);
 
   return Status::OK();
 }
 
 void WatchStream::NotifyStreamClose(const Status& status) {
+  if (recorder_) {
+    recorder_->RecordClose(status);
+  }
   callback_->OnWatchStreamClose(status);
 }
 
@@ -19,12 +19,14 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "Firestore/core/src/model/model_fwd.h"
 #include "Firestore/core/src/remote/grpc_connection.h"
 #include "Firestore/core/src/remote/remote_objc_bridge.h"
 #include "Firestore/core/src/remote/stream.h"
 #include "Firestore/core/src/remote/watch_change.h"
+#include "Firestore/core/src/remote/watch_stream_recorder.h"
 #include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/status_fwd.h"
 #include "absl/strings/string_view.h"
@@ -105,21 +107,40 @@ class WatchStream : public Stream {
   virtual /*virtual for tests only*/ void UnwatchTargetId(
       model::TargetId target_id);
 
+  /**
+   * Records the requests sent and responses received from now on into
+   * `recorder`, or stops recording if it's null. Responses are recorded as
+   * they arrive, before they're decoded, starting with the next time the
+   * stream is opened.
+   */
+  void set_recorder(std::shared_ptr<WatchStreamRecorder> recorder) {
+    recorder_ = std::move(recorder);
+  }
+
  private:
+  /** Writes `message`, recording it if there's a recorder. */
+  void WriteRequest(grpc::ByteBuffer&& message);
+
   std::unique_ptr<GrpcStream> CreateGrpcStream(
       GrpcConnection* grpc_connection, const auth::Token& token) override;
   void TearDown(GrpcStream* grpc_stream) override;
 
   void NotifyStreamOpen() override;
   util::Status NotifyStreamResponse(const grpc::ByteBuffer& message) override;
+  util::Status NotifyDecodedStreamResponse(
+      std::unique_ptr<GrpcDecodedMessage> message) override;
   void NotifyStreamClose(const util::Status& status) override;
 
   std::string GetDebugName() const override {
     return "WatchStream";
   }
 
-  WatchStreamSerializer watch_serializer_;
+  // Shared with the message decoder, which runs off the worker queue. Only its
+  // const methods are used, which are thread-safe.
+  std::shared_ptr<const WatchStreamSerializer> watch_serializer_;
   WatchStreamCallback* callback_;
+
+  std::shared_ptr<WatchStreamRecorder> recorder_;
 };
 
 }  // namespace remote
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/watch_stream_recorder.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "absl/strings/strip.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+using util::Status;
+using util::StatusOr;
+
+namespace {
+
+/** Identifies recordings, and their version. */
+const char kRecordingMagic[] = "fstwatch1";
+
+void WriteVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(absl::string_view* data, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !data->empty(); shift += 7) {
+    auto byte = static_cast<uint8_t>(data->front());
+    data->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string ToString(const grpc::ByteBuffer& message) {
+  std::vector<grpc::Slice> slices;
+  std::string result;
+  if (!message.Dump(&slices).ok()) {
+    return result;
+  }
+
+  result.reserve(message.Length());
+  for (const grpc::Slice& slice : slices) {
+    result.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+  }
+  return result;
+}
+
+Status CorruptRecording() {
+  return Status(Error::kErrorDataLoss, "Watch stream recording is corrupt");
+}
+
+}  // namespace
+
+bool operator==(const RecordedWatchMessage& lhs,
+                const RecordedWatchMessage& rhs) {
+  return lhs.type == rhs.type && lhs.offset == rhs.offset &&
+         lhs.bytes == rhs.bytes && lhs.close_code == rhs.close_code;
+}
+
+void WatchStreamRecorder::RecordRequest(const grpc::ByteBuffer& message) {
+  Record(RecordedWatchMessage::Type::Request, &message, Error::kErrorOk);
+}
+
+void WatchStreamRecorder::RecordResponse(const grpc::ByteBuffer& message) {
+  Record(RecordedWatchMessage::Type::Response, &message, Error::kErrorOk);
+}
+
+void WatchStreamRecorder::RecordClose(const Status& status) {
+  Record(RecordedWatchMessage::Type::Close, nullptr, status.code());
+}
+
+void WatchStreamRecorder::Record(RecordedWatchMessage::Type type,
+                                 const grpc::ByteBuffer* message,
+                                 Error close_code) {
+  RecordedWatchMessage recorded;
+  recorded.type = type;
+  recorded.offset = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_);
+  if (message) {
+    recorded.bytes = ToString(*message);
+  }
+  recorded.close_code = close_code;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  messages_.push_back(std::move(recorded));
+}
+
+std::vector<RecordedWatchMessage> WatchStreamRecorder::messages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return messages_;
+}
+
+std::string WatchStreamRecorder::Encode() const {
+  std::string result = kRecordingMagic;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const RecordedWatchMessage& message : messages_) {
+    WriteVarint(static_cast<uint64_t>(message.type), &result);
+    WriteVarint(static_cast<uint64_t>(message.offset.count()), &result);
+    WriteVarint(static_cast<uint64_t>(message.close_code), &result);
+    WriteVarint(message.bytes.size(), &result);
+    result.append(message.bytes);
+  }
+  return result;
+}
+
+StatusOr<std::vector<RecordedWatchMessage>> WatchStreamRecorder::Decode(
+    absl::string_view data) {
+  if (!absl::ConsumePrefix(&data, kRecordingMagic)) {
+    return CorruptRecording();
+  }
+
+  std::vector<RecordedWatchMessage> messages;
+  while (!data.empty()) {
+    uint64_t type = 0;
+    uint64_t offset = 0;
+    uint64_t close_code = 0;
+    uint64_t size = 0;
+    if (!ReadVarint(&data, &type) || !ReadVarint(&data, &offset) ||
+        !ReadVarint(&data, &close_code) || !ReadVarint(&data, &size) ||
+        type > static_cast<uint64_t>(RecordedWatchMessage::Type::Close) ||
+        close_code > static_cast<uint64_t>(Error::kErrorUnauthenticated) ||
+        size > data.size()) {
+      return CorruptRecording();
+    }
+
+    RecordedWatchMessage message;
+    message.type = static_cast<RecordedWatchMessage::Type>(type);
+    message.offset = std::chrono::microseconds(static_cast<int64_t>(offset));
+    message.close_code = static_cast<Error>(close_code);
+    message.bytes = std::string(data.substr(0, size));
+    data.remove_prefix(size);
+    messages.push_back(std::move(message));
+  }
+  return messages;
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
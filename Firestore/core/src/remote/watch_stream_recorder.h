@@ -0,0 +1,98 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_REMOTE_WATCH_STREAM_RECORDER_H_
+#define FIRESTORE_CORE_SRC_REMOTE_WATCH_STREAM_RECORDER_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <mutex>   // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "Firestore/core/include/firebase/firestore/firestore_errors.h"
+#include "Firestore/core/src/util/status_fwd.h"
+#include "absl/strings/string_view.h"
+#include "grpcpp/support/byte_buffer.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+/** A message sent or received on the watch stream. */
+struct RecordedWatchMessage {
+  enum class Type { Request, Response, Close };
+
+  Type type = Type::Response;
+
+  /** How long after the recording started the message was sent or received. */
+  std::chrono::microseconds offset{0};
+
+  /**
+   * The serialized `ListenRequest` or `ListenResponse`; empty when the stream
+   * was closed.
+   */
+  std::string bytes;
+
+  /** The error the stream was closed with, if any. */
+  Error close_code = Error::kErrorOk;
+};
+
+bool operator==(const RecordedWatchMessage& lhs,
+                const RecordedWatchMessage& rhs);
+
+/**
+ * Records the raw messages of a watch stream, with the time each one was sent
+ * or received, so that real traffic can be replayed later to reproduce
+ * performance issues deterministically.
+ *
+ * Responses are recorded on the thread that decodes them, so this class is
+ * thread-safe. Recordings grow without bound, so they're only meant for
+ * debugging and testing.
+ */
+class WatchStreamRecorder {
+ public:
+  WatchStreamRecorder() : start_(std::chrono::steady_clock::now()) {
+  }
+
+  void RecordRequest(const grpc::ByteBuffer& message);
+  void RecordResponse(const grpc::ByteBuffer& message);
+  void RecordClose(const util::Status& status);
+
+  /** Returns the messages recorded so far, in the order they were recorded. */
+  std::vector<RecordedWatchMessage> messages() const;
+
+  /** Encodes the messages recorded so far into the format `Decode` reads. */
+  std::string Encode() const;
+
+  static util::StatusOr<std::vector<RecordedWatchMessage>> Decode(
+      absl::string_view data);
+
+ private:
+  void Record(RecordedWatchMessage::Type type,
+              const grpc::ByteBuffer* message,
+              Error close_code);
+
+  const std::chrono::steady_clock::time_point start_;
+
+  mutable std::mutex mutex_;
+  std::vector<RecordedWatchMessage> messages_;
+};
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_REMOTE_WATCH_STREAM_RECORDER_H_
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/write_pipeline_depth.h"
+
+#include <algorithm>
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+constexpr int WritePipelineDepth::kDefaultDepth;
+constexpr int WritePipelineDepth::kMaxAdaptiveDepth;
+constexpr int WritePipelineDepth::kSlowAckFactor;
+
+WritePipelineDepth::WritePipelineDepth(int depth, bool adaptive)
+    : adaptive_(adaptive),
+      initial_depth_(std::max(depth, 1)),
+      depth_(initial_depth_) {
+}
+
+void WritePipelineDepth::RecordAck(Duration latency, bool pipeline_was_full) {
+  if (!adaptive_) return;
+
+  if (!has_fastest_ack_ || latency < fastest_ack_) {
+    has_fastest_ack_ = true;
+    fastest_ack_ = latency;
+  }
+
+  if (latency > fastest_ack_ * kSlowAckFactor) {
+    // Back off gently: slow acknowledgements tend to arrive in runs.
+    depth_ = std::max(depth_ - 1, 1);
+  } else if (pipeline_was_full) {
+    int max_depth = std::max(initial_depth_, kMaxAdaptiveDepth);
+    depth_ = std::min(depth_ + 1, max_depth);
+  }
+}
+
+void WritePipelineDepth::RecordError() {
+  if (!adaptive_) return;
+
+  depth_ = std::max(depth_ / 2, 1);
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_REMOTE_WRITE_PIPELINE_DEPTH_H_
+#define FIRESTORE_CORE_SRC_REMOTE_WRITE_PIPELINE_DEPTH_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+/**
+ * Decides how many mutation batches `RemoteStore` may have outstanding on the
+ * write stream at once.
+ *
+ * By default the depth is fixed. When adaptive, the depth grows by one every
+ * time a write is acknowledged about as quickly as the fastest acknowledgement
+ * seen so far while the pipeline was full. It shrinks by one for every slow
+ * acknowledgement, which indicates that the backend or the link is queueing
+ * the writes, and is halved when the stream fails.
+ */
+class WritePipelineDepth {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  /** The depth used unless configured otherwise. */
+  static constexpr int kDefaultDepth = 10;
+
+  /** The largest depth an adaptive pipeline grows to. */
+  static constexpr int kMaxAdaptiveDepth = 100;
+
+  /**
+   * Acknowledgements that take more than this multiple of the fastest one
+   * observed are considered a sign of backpressure.
+   */
+  static constexpr int kSlowAckFactor = 4;
+
+  explicit WritePipelineDepth(int depth = kDefaultDepth, bool adaptive = false);
+
+  /** The current maximum number of outstanding batches. Always at least 1. */
+  int depth() const {
+    return depth_;
+  }
+
+  bool adaptive() const {
+    return adaptive_;
+  }
+
+  /**
+   * Records that a write request was acknowledged `latency` after it was sent.
+   *
+   * @param pipeline_was_full Whether the pipeline was at its current depth
+   *     when the acknowledgement arrived. The depth only grows if it was,
+   *     since otherwise it isn't what limits throughput.
+   */
+  void RecordAck(Duration latency, bool pipeline_was_full);
+
+  /** Records that the write stream failed with outstanding writes. */
+  void RecordError();
+
+ private:
+  bool adaptive_ = false;
+  int initial_depth_ = kDefaultDepth;
+  int depth_ = kDefaultDepth;
+  bool has_fastest_ack_ = false;
+  Duration fastest_ack_{};
+};
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_REMOTE_WRITE_PIPELINE_DEPTH_H_
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/allocation_tracker.h"
+
+#include <atomic>
+#include <mutex>  // NOLINT(build/c++11)
+
+namespace firebase {
+namespace firestore {
+namespace util {
+namespace {
+
+std::atomic<bool> hooks_installed{false};
+
+// The innermost counter on this thread, or null if there is none or counting
+// is suspended.
+thread_local ScopedAllocationCounter* current_counter = nullptr;
+
+struct TaggedAllocations {
+  std::mutex mutex;
+  std::map<std::string, AllocationCounts> counts;
+  std::map<std::string, int64_t> entries;
+};
+
+TaggedAllocations& Tagged() {
+  static auto* tagged = new TaggedAllocations();
+  return *tagged;
+}
+
+void Add(AllocationCounts* to, const AllocationCounts& counts) {
+  to->allocations += counts.allocations;
+  to->deallocations += counts.deallocations;
+  to->bytes_allocated += counts.bytes_allocated;
+  to->bytes_deallocated += counts.bytes_deallocated;
+}
+
+}  // namespace
+
+void RecordAllocation(size_t size) {
+  ScopedAllocationCounter* counter = current_counter;
+  if (!counter) return;
+  counter->counts_.allocations++;
+  counter->counts_.bytes_allocated += static_cast<int64_t>(size);
+}
+
+void RecordDeallocation(size_t size) {
+  ScopedAllocationCounter* counter = current_counter;
+  if (!counter) return;
+  counter->counts_.deallocations++;
+  counter->counts_.bytes_deallocated += static_cast<int64_t>(size);
+}
+
+void MarkAllocationHooksInstalled() {
+  hooks_installed.store(true, std::memory_order_relaxed);
+}
+
+bool AllocationHooksInstalled() {
+  return hooks_installed.load(std::memory_order_relaxed);
+}
+
+ScopedAllocationCounter::ScopedAllocationCounter()
+    : enclosing_(current_counter) {
+  current_counter = this;
+}
+
+ScopedAllocationCounter::~ScopedAllocationCounter() {
+  current_counter = enclosing_;
+  if (enclosing_) Add(&enclosing_->counts_, counts_);
+}
+
+ScopedAllocationTag::~ScopedAllocationTag() {
+  // Updating the totals allocates; don't count that towards any tag.
+  ScopedAllocationCounter* suspended = current_counter;
+  current_counter = nullptr;
+  {
+    TaggedAllocations& tagged = Tagged();
+    std::lock_guard<std::mutex> lock(tagged.mutex);
+    Add(&tagged.counts[tag_], counter_.counts());
+    tagged.entries[tag_]++;
+  }
+  current_counter = suspended;
+}
+
+std::map<std::string, AllocationCounts> GetTaggedAllocations() {
+  TaggedAllocations& tagged = Tagged();
+  std::lock_guard<std::mutex> lock(tagged.mutex);
+  return tagged.counts;
+}
+
+std::map<std::string, int64_t> GetTagEntryCounts() {
+  TaggedAllocations& tagged = Tagged();
+  std::lock_guard<std::mutex> lock(tagged.mutex);
+  return tagged.entries;
+}
+
+void ResetTaggedAllocations() {
+  TaggedAllocations& tagged = Tagged();
+  std::lock_guard<std::mutex> lock(tagged.mutex);
+  tagged.counts.clear();
+  tagged.entries.clear();
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_UTIL_ALLOCATION_TRACKER_H_
+#define FIRESTORE_CORE_SRC_UTIL_ALLOCATION_TRACKER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Allocation tags are compiled out unless
+// `FIRESTORE_ALLOCATION_TRACKING_ENABLED` is defined to 1, as it is for
+// benchmark builds. Counting also requires the binary to replace `operator new`
+// and `operator delete` with the hooks in
+// `test/unit/testutil/allocation_hooks.cc`; without them, all counts are zero.
+#ifndef FIRESTORE_ALLOCATION_TRACKING_ENABLED
+#define FIRESTORE_ALLOCATION_TRACKING_ENABLED 0
+#endif
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+struct AllocationCounts {
+  int64_t allocations = 0;
+  int64_t deallocations = 0;
+  int64_t bytes_allocated = 0;
+  int64_t bytes_deallocated = 0;
+};
+
+/**
+ * Called by the allocation hooks for every call to `operator new` and
+ * `operator delete`, with the size of the block. Must not allocate.
+ */
+void RecordAllocation(size_t size);
+void RecordDeallocation(size_t size);
+
+/** Called once by the allocation hooks when they're linked in. */
+void MarkAllocationHooksInstalled();
+
+/**
+ * Returns true if the binary replaced `operator new` with the allocation
+ * hooks, i.e. if allocations are actually counted.
+ */
+bool AllocationHooksInstalled();
+
+/**
+ * Counts the allocations made on the current thread for as long as it's in
+ * scope. Counters nest: when a counter goes out of scope, its counts are added
+ * to the counter enclosing it, if any.
+ */
+class ScopedAllocationCounter {
+ public:
+  ScopedAllocationCounter();
+  ~ScopedAllocationCounter();
+
+  ScopedAllocationCounter(const ScopedAllocationCounter&) = delete;
+  ScopedAllocationCounter& operator=(const ScopedAllocationCounter&) = delete;
+
+  /** The allocations counted so far. */
+  const AllocationCounts& counts() const {
+    return counts_;
+  }
+
+ private:
+  friend void RecordAllocation(size_t size);
+  friend void RecordDeallocation(size_t size);
+
+  AllocationCounts counts_;
+  ScopedAllocationCounter* enclosing_ = nullptr;
+};
+
+/**
+ * Counts the allocations made on the current thread for as long as it's in
+ * scope, and adds them to the totals for the given tag. Use
+ * `FIRESTORE_ALLOCATION_TAG` rather than creating these directly, so that the
+ * tag is compiled out when allocation tracking is disabled.
+ */
+class ScopedAllocationTag {
+ public:
+  explicit ScopedAllocationTag(const char* tag) : tag_(tag) {
+  }
+
+  ~ScopedAllocationTag();
+
+ private:
+  const char* tag_ = nullptr;
+  ScopedAllocationCounter counter_;
+};
+
+/**
+ * Returns the totals of the allocations made in each tag, and the number of
+ * times each tag was entered, since the last reset.
+ */
+std::map<std::string, AllocationCounts> GetTaggedAllocations();
+std::map<std::string, int64_t> GetTagEntryCounts();
+
+void ResetTaggedAllocations();
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#define FIRESTORE_ALLOCATION_CONCAT_INNER(a, b) a##b
+#define FIRESTORE_ALLOCATION_CONCAT(a, b) \
+  FIRESTORE_ALLOCATION_CONCAT_INNER(a, b)
+
+/**
+ * Adds the allocations made in the rest of the enclosing scope to the totals
+ * of the given tag, which must be a string literal.
+ */
+#if FIRESTORE_ALLOCATION_TRACKING_ENABLED
+#define FIRESTORE_ALLOCATION_TAG(tag)              \
+  ::firebase::firestore::util::ScopedAllocationTag \
+      FIRESTORE_ALLOCATION_CONCAT(_firestore_allocation_tag_, __LINE__)(tag)
+#else
+#define FIRESTORE_ALLOCATION_TAG(tag) \
+  do {                                \
+  } while (0)
+#endif
+
+#endif  // FIRESTORE_CORE_SRC_UTIL_ALLOCATION_TRACKER_H_
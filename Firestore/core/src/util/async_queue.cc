@@ -27,6 +27,9 @@ namespace firebase {
 namespace firestore {
 namespace util {
 
+constexpr int AsyncQueue::kLaneCount;
+constexpr int AsyncQueue::kMaxPassedOver;
+
 std::shared_ptr<AsyncQueue> AsyncQueue::Create(
     std::unique_ptr<Executor> executor) {
   // Use new because make_shared cannot access a private constructor.
@@ -57,6 +60,16 @@ void AsyncQueue::Dispose() {
   }
 
   executor_->Dispose();
+
+  // Discard the queued operations outside the lock, since their destructors
+  // may try to enqueue.
+  std::deque<QueuedOperation> discarded[kLaneCount];
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < kLaneCount; ++i) {
+      discarded[i].swap(lanes_[i]);
+    }
+  }
 }
 
 void AsyncQueue::VerifyIsCurrentExecutor() const {
@@ -90,16 +103,16 @@ void AsyncQueue::ExecuteBlocking(const Operation& operation) {
   is_operation_in_progress_ = false;
 }
 
-bool AsyncQueue::Enqueue(const Operation& operation) {
+bool AsyncQueue::Enqueue(Operation operation, Priority priority) {
   VerifySequentialOrder();
-  return EnqueueRelaxed(operation);
+  return EnqueueRelaxed(std::move(operation), priority);
 }
 
-bool AsyncQueue::EnqueueEvenWhileRestricted(const Operation& operation) {
+bool AsyncQueue::EnqueueEvenWhileRestricted(Operation operation) {
   std::lock_guard<std::mutex> lock(mutex_);
   if (mode_ == Mode::kDisposed) return false;
 
-  executor_->Execute(Wrap(operation));
+  PushLocked(std::move(operation), Priority::kUserFacing);
   return true;
 }
 
@@ -108,17 +121,67 @@ bool AsyncQueue::is_running() const {
   return mode_ == Mode::kRunning;
 }
 
-bool AsyncQueue::EnqueueRelaxed(const Operation& operation) {
+bool AsyncQueue::EnqueueRelaxed(Operation operation, Priority priority) {
   std::lock_guard<std::mutex> lock(mutex_);
   if (mode_ != Mode::kRunning) return false;
 
-  executor_->Execute(Wrap(operation));
+  PushLocked(std::move(operation), priority);
   return true;
 }
 
+void AsyncQueue::PushLocked(Operation&& operation, Priority priority) {
+  lanes_[static_cast<int>(priority)].push_back(
+      QueuedOperation{next_sequence_++, std::move(operation)});
+
+  // The executor runs exactly one operation for each one queued, but not
+  // necessarily this one.
+  executor_->Execute([this] { RunNextOperation(); });
+}
+
+void AsyncQueue::RunNextOperation() {
+  Operation operation;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    operation = PopNextOperationLocked();
+  }
+
+  if (operation) {
+    ExecuteBlocking(operation);
+  }
+}
+
+AsyncQueue::Operation AsyncQueue::PopNextOperationLocked() {
+  int chosen = -1;
+  for (int i = 0; i < kLaneCount; ++i) {
+    if (lanes_[i].empty()) continue;
+
+    if (chosen == -1) {
+      chosen = i;
+    } else if (mode_ != Mode::kRunning) {
+      // Once shutting down, keep the order in which operations were queued.
+      if (lanes_[i].front().sequence < lanes_[chosen].front().sequence) {
+        chosen = i;
+      }
+    } else if (passed_over_[i] >= kMaxPassedOver) {
+      chosen = i;
+      break;
+    }
+  }
+  if (chosen == -1) return {};
+
+  for (int i = chosen + 1; i < kLaneCount; ++i) {
+    if (!lanes_[i].empty()) ++passed_over_[i];
+  }
+  passed_over_[chosen] = 0;
+
+  Operation result = std::move(lanes_[chosen].front().operation);
+  lanes_[chosen].pop_front();
+  return result;
+}
+
 DelayedOperation AsyncQueue::EnqueueAfterDelay(Milliseconds delay,
                                                const TimerId timer_id,
-                                               const Operation& operation) {
+                                               Operation operation) {
   std::lock_guard<std::mutex> lock(mutex_);
   VerifyIsCurrentExecutor();
 
@@ -132,16 +195,34 @@ DelayedOperation AsyncQueue::EnqueueAfterDelay(Milliseconds delay,
   }
 
   auto tag = static_cast<Executor::Tag>(timer_id);
-  return executor_->Schedule(delay, tag, Wrap(operation));
+  return executor_->Schedule(delay, tag, Wrap(std::move(operation)));
 }
 
-AsyncQueue::Operation AsyncQueue::Wrap(const Operation& operation) {
+namespace {
+
+/**
+ * Calls `ExecuteBlocking` with the wrapped operation. Unlike a lambda, which
+ * can only capture by copy in C++11, the operation is moved in, so wrapping
+ * doesn't copy whatever it captured.
+ */
+struct WrappedOperation {
+  AsyncQueue* queue;
+  AsyncQueue::Operation operation;
+
+  void operator()() const {
+    queue->ExecuteBlocking(operation);
+  }
+};
+
+}  // namespace
+
+AsyncQueue::Operation AsyncQueue::Wrap(Operation&& operation) {
   // Decorator pattern: wrap `operation` into a call to `ExecuteBlocking` to
   // ensure that it doesn't spawn any nested operations.
 
   // The Executor guarantees that this operation will either execute before
   // `Dispose` completes or not at all.
-  return [this, operation] { this->ExecuteBlocking(operation); };
+  return WrappedOperation{this, std::move(operation)};
 }
 
 void AsyncQueue::VerifySequentialOrder() const {
@@ -155,9 +236,9 @@ void AsyncQueue::VerifySequentialOrder() const {
 
 // Test-only functions
 
-void AsyncQueue::EnqueueBlocking(const Operation& operation) {
+void AsyncQueue::EnqueueBlocking(Operation operation) {
   VerifySequentialOrder();
-  executor_->ExecuteBlocking(Wrap(operation));
+  executor_->ExecuteBlocking(Wrap(std::move(operation)));
 }
 
 bool AsyncQueue::IsScheduled(const TimerId timer_id) const {
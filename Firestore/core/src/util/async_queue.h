@@ -19,6 +19,8 @@
 
 #include <atomic>
 #include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>  // NOLINT(build/c++11)
@@ -66,7 +68,43 @@ enum class TimerId {
    * A timer used to retry transactions. Since there can be multiple concurrent
    * transactions, multiple of these may be in the queue at a given time.
    */
-  RetryTransaction
+  RetryTransaction,
+
+  /**
+   * A timer used by `QueryListener` to deliver coalesced snapshots. Each
+   * coalescing listener may have one of these on the queue.
+   */
+  SnapshotCoalescing,
+
+  /**
+   * A timer used to periodically persist the resume tokens of active targets.
+   */
+  ResumeTokenPersistence,
+
+  /**
+   * A timer used by `BulkWriter` to wait for its rate limit and to retry
+   * writes. Several of these may be scheduled at a given time.
+   */
+  BulkWriter,
+
+  /**
+   * A timer used by `SyncEngine` to release the target of a query that is no
+   * longer listened to once its grace period ends. Each such query has one.
+   */
+  ReleaseGracePeriod,
+
+  /**
+   * A timer used to periodically write a snapshot of memory persistence to
+   * disk.
+   */
+  MemorySnapshot,
+
+  /**
+   * A timer used by `RemoteStore` to apply the write acknowledgements that
+   * arrived since it was scheduled, once the operations queued before it have
+   * run.
+   */
+  WriteAcknowledgements
 };
 
 // A serial queue that executes given operations asynchronously, one at a time.
@@ -78,6 +116,15 @@ enum class TimerId {
 // normally cannot enqueue other operations for immediate execution (but see
 // `EnqueueRelaxed`).
 //
+// Operations enqueued for immediate execution go into one of several priority
+// lanes. Whenever the queue is ready to run the next operation, it picks the
+// oldest one from the highest-priority lane that isn't empty, so interactive
+// operations can overtake queued maintenance work. Operations are still run
+// one at a time, operations within a lane stay in FIFO order, and a lower lane
+// can only be passed over a bounded number of times in a row. Once the queue
+// leaves `Mode::kRunning`, all operations run in plain FIFO order so that
+// shutdown is sequenced after everything queued before it.
+//
 // `AsyncQueue` methods have particular expectations about whether they must be
 // invoked on the queue or not; check "preconditions" section in comments on
 // each method.
@@ -110,6 +157,21 @@ class AsyncQueue : public std::enable_shared_from_this<AsyncQueue> {
     kDisposed,
   };
 
+  /** The lanes for operations enqueued for immediate execution. */
+  enum class Priority {
+    /** Operations on behalf of user calls. The default. */
+    kUserFacing,
+
+    /** Processing of data received from the backend. */
+    kNetwork,
+
+    /**
+     * Maintenance that nobody is waiting on, such as applying the chunks of
+     * a bundle being loaded.
+     */
+    kBackground,
+  };
+
   static std::shared_ptr<AsyncQueue> Create(std::unique_ptr<Executor> executor);
 
   ~AsyncQueue();
@@ -145,7 +207,8 @@ class AsyncQueue : public std::enable_shared_from_this<AsyncQueue> {
   // @return true if the operation was successfully enqueued or false if the
   //     operation was not enqueued because the `AsyncQueue` has already entered
   //     restricted mode or been disposed.
-  bool Enqueue(const Operation& operation);
+  bool Enqueue(Operation operation,
+               Priority priority = Priority::kUserFacing);
 
   // Like `Enqueue`, but it will proceed scheduling the requested operation
   // regardless of whether the queue is in restricted mode or not.
@@ -153,10 +216,11 @@ class AsyncQueue : public std::enable_shared_from_this<AsyncQueue> {
   // @return true if the operation was successfully enqueued or false if the
   //     operation was not enqueued because the `AsyncQueue` has already been
   //     disposed.
-  bool EnqueueEvenWhileRestricted(const Operation& operation);
+  bool EnqueueEvenWhileRestricted(Operation operation);
 
   // Like `Enqueue`, but without applying any prerequisite checks.
-  bool EnqueueRelaxed(const Operation& operation);
+  bool EnqueueRelaxed(Operation operation,
+                      Priority priority = Priority::kUserFacing);
 
   // Returns true if the queue is still in the main kRunning mode (i.e. not
   // restricted or disposed).
@@ -176,7 +240,7 @@ class AsyncQueue : public std::enable_shared_from_this<AsyncQueue> {
   // queue.
   DelayedOperation EnqueueAfterDelay(Milliseconds delay,
                                      TimerId timer_id,
-                                     const Operation& operation);
+                                     Operation operation);
 
   // Direct execution
 
@@ -204,7 +268,7 @@ class AsyncQueue : public std::enable_shared_from_this<AsyncQueue> {
   // on AsyncQueue.
 
   // Like `Enqueue`, but blocks until the `operation` is complete.
-  void EnqueueBlocking(const Operation& operation);
+  void EnqueueBlocking(Operation operation);
 
   // Checks whether an operation tagged with `timer_id` is currently scheduled
   // for execution in the future.
@@ -224,7 +288,12 @@ class AsyncQueue : public std::enable_shared_from_this<AsyncQueue> {
  private:
   explicit AsyncQueue(std::unique_ptr<Executor> executor);
 
-  Operation Wrap(const Operation& operation);
+  Operation Wrap(Operation&& operation);
+
+  // Puts the operation in its lane and has the executor run the next one.
+  void PushLocked(Operation&& operation, Priority priority);
+  void RunNextOperation();
+  Operation PopNextOperationLocked();
 
   // Asserts that the current invocation happens asynchronously on the queue.
   void VerifyIsCurrentExecutor() const;
@@ -236,6 +305,20 @@ class AsyncQueue : public std::enable_shared_from_this<AsyncQueue> {
   mutable std::mutex mutex_;
   Mode mode_ = Mode::kRunning;
 
+  struct QueuedOperation {
+    uint64_t sequence;
+    Operation operation;
+  };
+
+  static constexpr int kLaneCount = 3;
+  // How many times in a row a non-empty lane may be passed over in favor of
+  // higher-priority ones.
+  static constexpr int kMaxPassedOver = 16;
+
+  std::deque<QueuedOperation> lanes_[kLaneCount];
+  int passed_over_[kLaneCount] = {};
+  uint64_t next_sequence_ = 0;
+
   std::vector<TimerId> timer_ids_to_skip_;
 };
 
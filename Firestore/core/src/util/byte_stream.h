@@ -95,6 +95,24 @@ class ByteStream {
    * stream has been reached.
    */
   virtual StreamReadResult Read(size_t max_length) = 0;
+
+  /**
+   * Reads up to `max_length` bytes and appends them to `out`, returning the
+   * number of bytes appended. Returns 0 once the end of the stream has been
+   * reached.
+   *
+   * Unlike `Read`, implementations read directly into `out`, which avoids
+   * allocating and copying an intermediate string for every read. Callers
+   * reading large amounts of data should prefer this method.
+   */
+  virtual StatusOr<size_t> ReadAppend(size_t max_length, std::string* out) {
+    StreamReadResult result = Read(max_length);
+    if (!result.ok()) {
+      return result.status();
+    }
+    out->append(result.ValueOrDie());
+    return result.ValueOrDie().size();
+  }
 };
 
 }  // namespace util
@@ -75,6 +75,29 @@ StreamReadResult ByteStreamApple::Read(size_t max_length) {
   return ConsumeBuffer();
 }
 
+StatusOr<size_t> ByteStreamApple::ReadAppend(size_t max_length,
+                                             std::string* out) {
+  // Serve the bytes left in `buffer_` by earlier peeks first.
+  size_t from_buffer = std::min(max_length, buffer_.size());
+  out->append(buffer_, 0, from_buffer);
+  buffer_.erase(0, from_buffer);
+  if (from_buffer == max_length) {
+    return from_buffer;
+  }
+
+  size_t old_size = out->size();
+  size_t wanted = max_length - from_buffer;
+  out->resize(old_size + wanted);
+  auto* data_ptr = reinterpret_cast<uint8_t*>(&(*out)[old_size]);
+  NSInteger read = [input_ read:data_ptr maxLength:wanted];
+  out->resize(old_size + static_cast<size_t>(std::max<NSInteger>(read, 0)));
+
+  if (read < 0) {
+    return Status::FromNSError(input_.streamError);
+  }
+  return from_buffer + static_cast<size_t>(read);
+}
+
 int32_t ByteStreamApple::ReadToBuffer(size_t max_length) {
   std::string result(max_length + 1, '\0');
   auto* data_ptr = reinterpret_cast<uint8_t*>(&result[0]);
@@ -40,6 +40,25 @@ StreamReadResult ByteStreamCpp::Read(size_t max_length) {
   return ToReadResult(result);
 }
 
+StatusOr<size_t> ByteStreamCpp::ReadAppend(size_t max_length,
+                                           std::string* out) {
+  size_t old_size = out->size();
+  out->resize(old_size + max_length);
+  input_->read(&(*out)[old_size], static_cast<std::streamsize>(max_length));
+  auto read_count = static_cast<size_t>(input_->gcount());
+  out->resize(old_size + read_count);
+
+  if (input_->bad()) {
+    return Status(Error::kErrorDataLoss,
+                  "Reading input stream failed with error");
+  }
+  // As in `ToReadResult`, a short read before the end is not an error.
+  if (input_->fail() && !input_->eof()) {
+    input_->clear();
+  }
+  return read_count;
+}
+
 StreamReadResult ByteStreamCpp::ToReadResult(const std::string& result) {
   if (input_->bad()) {
     return StreamReadResult(
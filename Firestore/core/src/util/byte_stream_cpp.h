@@ -35,6 +35,7 @@ class ByteStreamCpp : public ByteStream {
 
   StreamReadResult ReadUntil(char delim, size_t max_length) override;
   StreamReadResult Read(size_t max_length) override;
+  StatusOr<size_t> ReadAppend(size_t max_length, std::string* out) override;
 
  private:
   /**
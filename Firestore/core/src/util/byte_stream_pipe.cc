@@ -0,0 +1,173 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/byte_stream_pipe.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "Firestore/core/src/util/hard_assert.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+constexpr size_t ByteStreamPipe::kDefaultCapacity;
+
+bool ByteStreamPipe::Writer::Write(absl::string_view data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  HARD_ASSERT(!finished_, "Can't write to a finished stream");
+  if (cancelled_) {
+    return false;
+  }
+
+  // Dropping the bytes read so far only once they make up half of the buffer
+  // keeps the cost of dropping them proportional to the bytes written.
+  if (read_offset_ > 0 && read_offset_ >= buffer_.size() / 2) {
+    buffer_.erase(0, read_offset_);
+    read_offset_ = 0;
+  }
+  buffer_.append(data.data(), data.size());
+
+  if (!paused_ && available() >= capacity_) {
+    paused_ = true;
+    if (pause_callback_) pause_callback_(true);
+  }
+  changed_.notify_all();
+  return true;
+}
+
+void ByteStreamPipe::Writer::Finish(Status status) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  status_ = std::move(status);
+  changed_.notify_all();
+}
+
+void ByteStreamPipe::Writer::SetPauseCallback(
+    std::function<void(bool paused)> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pause_callback_ = std::move(callback);
+  if (paused_ && pause_callback_) pause_callback_(true);
+}
+
+void ByteStreamPipe::Writer::Consume(size_t size) {
+  read_offset_ += size;
+  if (read_offset_ == buffer_.size()) {
+    buffer_.clear();
+    read_offset_ = 0;
+  }
+
+  if (paused_ && available() <= capacity_ / 2) {
+    paused_ = false;
+    if (pause_callback_) pause_callback_(false);
+  }
+}
+
+void ByteStreamPipe::Writer::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  buffer_.clear();
+  read_offset_ = 0;
+
+  // A paused writer needs to resume to find out that it can stop.
+  if (paused_) {
+    paused_ = false;
+    if (pause_callback_) pause_callback_(false);
+  }
+}
+
+ByteStreamPipe::~ByteStreamPipe() {
+  writer_->Cancel();
+}
+
+StreamReadResult ByteStreamPipe::ReadUntil(char delim, size_t max_length) {
+  std::unique_lock<std::mutex> lock(writer_->mutex_);
+
+  // Only the bytes that arrived since the last check need to be searched.
+  size_t searched = 0;
+  size_t found_at = std::string::npos;
+  writer_->changed_.wait(lock, [&] {
+    size_t end = std::min(writer_->available(), max_length);
+    if (searched < end) {
+      const char* begin = writer_->data();
+      const void* found =
+          std::memchr(begin + searched, delim, end - searched);
+      if (found) {
+        found_at = static_cast<size_t>(static_cast<const char*>(found) - begin);
+        return true;
+      }
+      searched = end;
+    }
+    return end == max_length || writer_->finished_;
+  });
+
+  if (!writer_->status_.ok()) {
+    return StreamReadResult(writer_->status_, true);
+  }
+
+  size_t size = std::min({found_at, writer_->available(), max_length});
+  std::string result(writer_->data(), size);
+  writer_->Consume(size);
+  return StreamReadResult(std::move(result), eof());
+}
+
+StreamReadResult ByteStreamPipe::Read(size_t max_length) {
+  std::unique_lock<std::mutex> lock(writer_->mutex_);
+  writer_->changed_.wait(lock, [&] {
+    return writer_->available() >= max_length || writer_->finished_;
+  });
+
+  if (!writer_->status_.ok()) {
+    return StreamReadResult(writer_->status_, true);
+  }
+
+  size_t size = std::min(writer_->available(), max_length);
+  std::string result(writer_->data(), size);
+  writer_->Consume(size);
+  return StreamReadResult(std::move(result), eof());
+}
+
+StatusOr<size_t> ByteStreamPipe::ReadAppend(size_t max_length,
+                                            std::string* out) {
+  // Unlike the other reads, this one returns as soon as any bytes are in, so
+  // that callers parse them while the rest are still arriving.
+  std::unique_lock<std::mutex> lock(writer_->mutex_);
+  writer_->changed_.wait(lock, [&] {
+    return writer_->available() > 0 || max_length == 0 || writer_->finished_;
+  });
+
+  if (!writer_->status_.ok()) {
+    return writer_->status_;
+  }
+
+  size_t size = std::min(writer_->available(), max_length);
+  out->append(writer_->data(), size);
+  writer_->Consume(size);
+  return size;
+}
+
+bool ByteStreamPipe::eof() const {
+  return writer_->finished_ && writer_->available() == 0;
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_UTIL_BYTE_STREAM_PIPE_H_
+#define FIRESTORE_CORE_SRC_UTIL_BYTE_STREAM_PIPE_H_
+
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+
+#include "Firestore/core/src/util/byte_stream.h"
+#include "Firestore/core/src/util/status.h"
+#include "absl/strings/string_view.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+/**
+ * A `ByteStream` whose bytes are written by another thread while they're
+ * being read, such as the body of a network response that's still
+ * downloading. Reads block until enough bytes have arrived or the writer is
+ * done.
+ *
+ * The writer is asked to pause once `capacity` bytes are buffered, and to
+ * resume once the reader has consumed half of them, so memory stays bounded
+ * however far the writer gets ahead of the reader.
+ */
+class ByteStreamPipe : public ByteStream {
+ public:
+  /**
+   * The writing end of a `ByteStreamPipe`, which stays valid after the pipe
+   * is destroyed.
+   *
+   * This class is thread-safe.
+   */
+  class Writer {
+   public:
+    explicit Writer(size_t capacity) : capacity_(capacity) {
+    }
+
+    /**
+     * Appends `data` to the stream. Returns false if the stream has been
+     * destroyed, in which case the rest of the data isn't needed.
+     */
+    bool Write(absl::string_view data);
+
+    /**
+     * Ends the stream, with an error if `status` isn't OK. Calls after the
+     * first are ignored.
+     */
+    void Finish(Status status = Status::OK());
+
+    /**
+     * Sets the callback that's called with true when the writer should pause
+     * and with false when it should resume, or when the stream has been
+     * destroyed. It's called while the pipe is locked, so pausing and resuming
+     * happen in order, and it must not call back into the pipe.
+     */
+    void SetPauseCallback(std::function<void(bool paused)> callback);
+
+   private:
+    friend class ByteStreamPipe;
+
+    size_t available() const {
+      return buffer_.size() - read_offset_;
+    }
+
+    const char* data() const {
+      return buffer_.data() + read_offset_;
+    }
+
+    /**
+     * Drops the first `size` bytes that are available, resuming the writer if
+     * needed. Must be called with `mutex_` held.
+     */
+    void Consume(size_t size);
+
+    void Cancel();
+
+    const size_t capacity_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+
+    // The bytes before `read_offset_` have been read already; they're only
+    // dropped as the buffer grows, rather than on every read.
+    std::string buffer_;
+    size_t read_offset_ = 0;
+
+    bool finished_ = false;
+    Status status_;
+    bool paused_ = false;
+    bool cancelled_ = false;
+    std::function<void(bool paused)> pause_callback_;
+  };
+
+  /** The default number of bytes buffered before the writer should pause. */
+  static constexpr size_t kDefaultCapacity = 4 * 1024 * 1024;
+
+  explicit ByteStreamPipe(size_t capacity = kDefaultCapacity)
+      : writer_(std::make_shared<Writer>(capacity)) {
+  }
+
+  /** Cancels the writer, which is told to resume if it's paused. */
+  ~ByteStreamPipe() override;
+
+  const std::shared_ptr<Writer>& writer() const {
+    return writer_;
+  }
+
+  StreamReadResult ReadUntil(char delim, size_t max_length) override;
+  StreamReadResult Read(size_t max_length) override;
+  StatusOr<size_t> ReadAppend(size_t max_length, std::string* out) override;
+
+ private:
+  /** Returns whether the stream is finished and has nothing left to read. */
+  bool eof() const;
+
+  std::shared_ptr<Writer> writer_;
+};
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_UTIL_BYTE_STREAM_PIPE_H_
@@ -56,19 +56,34 @@ class Executor {
   using Clock = std::chrono::steady_clock;
   using TimePoint = std::chrono::time_point<Clock, Milliseconds>;
 
+  // A hint of how urgently the operations of an Executor need to run relative
+  // to other work in the process. Implementations that support it map the
+  // priority to a quality-of-service class; others ignore it.
+  enum class Priority {
+    // Work that isn't otherwise classified.
+    Default,
+    // Work the user is waiting for, e.g. acknowledging writes and raising
+    // snapshots.
+    UserInitiated,
+    // Long-running work the user isn't waiting for, e.g. garbage collection
+    // and bundle loading.
+    Utility,
+  };
+
   // Creates a new serial Executor of the platform-appropriate type, and gives
-  // it the given label, if the implementation supports it.
+  // it the given label and priority, if the implementation supports them.
   //
   // Note that this method has multiple definitions, depending on the platform.
-  static std::unique_ptr<Executor> CreateSerial(const char* label);
+  static std::unique_ptr<Executor> CreateSerial(
+      const char* label, Priority priority = Priority::Default);
 
   // Creates a new concurrent Executor of the platform-appropriate type, with
-  // at least the given number of threads, and gives it the given label, if the
-  // implementation supports it.
+  // at least the given number of threads, and gives it the given label and
+  // priority, if the implementation supports them.
   //
   // Note that this method has multiple definitions, depending on the platform.
-  static std::unique_ptr<Executor> CreateConcurrent(const char* label,
-                                                    int threads);
+  static std::unique_ptr<Executor> CreateConcurrent(
+      const char* label, int threads, Priority priority = Priority::Default);
 
   virtual ~Executor() = default;
 
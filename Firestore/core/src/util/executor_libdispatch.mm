@@ -48,6 +48,23 @@ absl::string_view GetCurrentQueueLabel() {
       dispatch_queue_get_label(DISPATCH_CURRENT_QUEUE_LABEL));
 }
 
+// Returns `attributes` with the quality-of-service class that corresponds to
+// the given priority, if any.
+dispatch_queue_attr_t AttributesWithPriority(dispatch_queue_attr_t attributes,
+                                             Executor::Priority priority) {
+  switch (priority) {
+    case Executor::Priority::Default:
+      return attributes;
+    case Executor::Priority::UserInitiated:
+      return dispatch_queue_attr_make_with_qos_class(
+          attributes, QOS_CLASS_USER_INITIATED, 0);
+    case Executor::Priority::Utility:
+      return dispatch_queue_attr_make_with_qos_class(attributes,
+                                                     QOS_CLASS_UTILITY, 0);
+  }
+  UNREACHABLE();
+}
+
 }  // namespace
 
 // MARK: - ExecutorLibdispatch
@@ -358,19 +375,22 @@ ExecutorLibdispatch::Id ExecutorLibdispatch::NextIdLocked() {
 
 // MARK: - Executor
 
-std::unique_ptr<Executor> Executor::CreateSerial(const char* label) {
-  dispatch_queue_t queue = dispatch_queue_create(label, DISPATCH_QUEUE_SERIAL);
+std::unique_ptr<Executor> Executor::CreateSerial(const char* label,
+                                                 Priority priority) {
+  dispatch_queue_t queue = dispatch_queue_create(
+      label, AttributesWithPriority(DISPATCH_QUEUE_SERIAL, priority));
   return absl::make_unique<ExecutorLibdispatch>(queue);
 }
 
 std::unique_ptr<Executor> Executor::CreateConcurrent(const char* label,
-                                                     int threads) {
+                                                     int threads,
+                                                     Priority priority) {
   HARD_ASSERT(threads > 1);
 
   // Concurrent queues auto-create enough threads to avoid deadlock so there's
   // no need to honor the threads argument.
-  dispatch_queue_t queue =
-      dispatch_queue_create(label, DISPATCH_QUEUE_CONCURRENT);
+  dispatch_queue_t queue = dispatch_queue_create(
+      label, AttributesWithPriority(DISPATCH_QUEUE_CONCURRENT, priority));
   return absl::make_unique<ExecutorLibdispatch>(queue);
 }
 
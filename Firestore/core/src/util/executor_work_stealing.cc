@@ -0,0 +1,404 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/executor_work_stealing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <deque>
+#include <future>  // NOLINT(build/c++11)
+#include <sstream>
+#include <utility>
+
+#include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/schedule.h"
+#include "Firestore/core/src/util/task.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+namespace {
+
+// Consistent with `ExecutorStd`, operations submitted for immediate execution
+// have the epoch time as their target time.
+Executor::TimePoint Immediate() {
+  return Executor::TimePoint{};
+}
+
+// The only guarantee is that different `thread_id`s will produce different
+// values.
+std::string ThreadIdToString(const std::thread::id thread_id) {
+  std::ostringstream stream;
+  stream << thread_id;
+  return stream.str();
+}
+
+// The state of the executor whose worker is running on the current thread (if
+// any), and the index of that worker. Used to put operations submitted by a
+// worker on its own run queue.
+thread_local const void* current_state = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+class ExecutorWorkStealing::SharedState {
+ public:
+  explicit SharedState(size_t workers) : run_queues_(workers) {
+  }
+
+  /**
+   * Puts the given task on the run queue of the current worker, or on the
+   * injection queue if not called from a worker. Releases the task if the
+   * executor has been shut down.
+   */
+  void Push(Task* task) {
+    RunQueue& queue = current_state == this ? run_queues_[current_worker]
+                                            : injection_queue_;
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!is_shut_down_) {
+        queue.tasks.push_back(task);
+        task = nullptr;
+      }
+    }
+
+    if (task) {
+      task->Release();
+      return;
+    }
+
+    epoch_.fetch_add(1);
+    if (idle_workers_.load() > 0) {
+      // Taking the lock ensures that a worker that has just checked the epoch
+      // is already waiting, so it can't miss the notification.
+      { std::lock_guard<std::mutex> lock(idle_mutex_); }
+      idle_cv_.notify_one();
+    }
+  }
+
+  /**
+   * Blocks until there's a task for the given worker to run and returns it, or
+   * returns null once the executor has been shut down.
+   */
+  Task* WaitForTask(size_t worker) {
+    for (;;) {
+      if (is_shut_down_) return nullptr;
+
+      // Any task pushed after the epoch was read changes the epoch, so the
+      // worker only sleeps if no task has been pushed since it last looked.
+      uint64_t epoch = epoch_.load();
+      if (Task* task = TryPop(worker)) return task;
+
+      idle_workers_.fetch_add(1);
+      Task* task = TryPop(worker);
+      if (!task) {
+        std::unique_lock<std::mutex> lock(idle_mutex_);
+        idle_cv_.wait(lock, [&] {
+          return is_shut_down_ || epoch_.load() != epoch;
+        });
+      }
+      idle_workers_.fetch_sub(1);
+
+      if (task) return task;
+    }
+  }
+
+  /**
+   * Removes and returns the first task on the run queues that satisfies the
+   * given predicate, or null if there's none.
+   */
+  template <typename Pred>
+  Task* RemoveIf(const Pred pred) {
+    for (RunQueue* queue : AllQueues()) {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      auto found = std::find_if(queue->tasks.begin(), queue->tasks.end(),
+                                [&](Task* task) { return pred(*task); });
+      if (found != queue->tasks.end()) {
+        Task* task = *found;
+        queue->tasks.erase(found);
+        return task;
+      }
+    }
+    return nullptr;
+  }
+
+  template <typename Pred>
+  bool Contains(const Pred pred) const {
+    for (RunQueue* queue : const_cast<SharedState*>(this)->AllQueues()) {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      if (std::any_of(queue->tasks.begin(), queue->tasks.end(),
+                      [&](Task* task) { return pred(*task); })) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Releases all the queued tasks, makes all subsequently pushed tasks be
+   * released, and wakes up the workers so that they exit once they finish
+   * their current task, if any.
+   */
+  void Shutdown() {
+    is_shut_down_ = true;
+
+    for (RunQueue* queue : AllQueues()) {
+      std::deque<Task*> tasks;
+      {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        tasks.swap(queue->tasks);
+      }
+      for (Task* task : tasks) {
+        task->Release();
+      }
+    }
+
+    { std::lock_guard<std::mutex> lock(idle_mutex_); }
+    idle_cv_.notify_all();
+  }
+
+  // Delayed operations until they're due. The timer thread moves them to the
+  // injection queue.
+  class Schedule timers_;
+
+ private:
+  struct RunQueue {
+    std::mutex mutex;
+    std::deque<Task*> tasks;
+  };
+
+  // Takes a task from the worker's own queue first, then from the injection
+  // queue, then from the other workers' queues, starting from the next worker
+  // to spread the stealing.
+  Task* TryPop(size_t worker) {
+    if (Task* task = PopFront(&run_queues_[worker])) return task;
+    if (Task* task = PopFront(&injection_queue_)) return task;
+
+    for (size_t i = 1; i < run_queues_.size(); ++i) {
+      size_t victim = (worker + i) % run_queues_.size();
+      if (Task* task = PopFront(&run_queues_[victim])) return task;
+    }
+    return nullptr;
+  }
+
+  static Task* PopFront(RunQueue* queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->tasks.empty()) return nullptr;
+
+    Task* task = queue->tasks.front();
+    queue->tasks.pop_front();
+    return task;
+  }
+
+  std::vector<RunQueue*> AllQueues() {
+    std::vector<RunQueue*> result;
+    result.reserve(run_queues_.size() + 1);
+    result.push_back(&injection_queue_);
+    for (RunQueue& queue : run_queues_) {
+      result.push_back(&queue);
+    }
+    return result;
+  }
+
+  std::vector<RunQueue> run_queues_;
+  RunQueue injection_queue_;
+
+  std::atomic<bool> is_shut_down_{false};
+
+  // Bumped every time a task is pushed. Idle workers wait on `idle_cv_` until
+  // it changes.
+  std::atomic<uint64_t> epoch_{0};
+  std::atomic<int> idle_workers_{0};
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+};
+
+// MARK: - ExecutorWorkStealing
+
+ExecutorWorkStealing::ExecutorWorkStealing(int threads)
+    : state_(std::make_shared<SharedState>(static_cast<size_t>(threads))) {
+  HARD_ASSERT(threads > 0);
+
+  for (int i = 0; i < threads; ++i) {
+    worker_thread_pool_.emplace_back(&ExecutorWorkStealing::WorkerThread,
+                                     state_, static_cast<size_t>(i));
+  }
+  timer_thread_ = std::thread(&ExecutorWorkStealing::TimerThread, state_);
+}
+
+ExecutorWorkStealing::~ExecutorWorkStealing() {
+  Dispose();
+}
+
+void ExecutorWorkStealing::Dispose() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Do nothing if already disposed.
+    if (state_ == nullptr) {
+      return;
+    }
+
+    // Workers finish whatever task they're currently working on and then quit.
+    // The timer thread quits once it pops the kShutdownTag task.
+    state_->timers_.Clear();
+    state_->Shutdown();
+    state_->timers_.Push(Task::Create(nullptr, Immediate(), kShutdownTag,
+                                      NextIdLocked(), [] {}));
+
+    state_ = nullptr;
+  }
+
+  // Now that `state_` has been released, join the threads while not holding
+  // the lock to avoid deadlocks where the thread tries to access the executor.
+  // If the current thread is running this destructor, it can't be joined.
+  // Instead detach it and rely on WorkerThread to exit cleanly.
+  for (std::thread& thread : worker_thread_pool_) {
+    if (std::this_thread::get_id() == thread.get_id()) {
+      thread.detach();
+    } else {
+      thread.join();
+    }
+  }
+  timer_thread_.join();
+}
+
+void ExecutorWorkStealing::Execute(Operation&& operation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!state_) return;
+
+  state_->Push(Task::Create(nullptr, Immediate(), kNoTag, NextIdLocked(),
+                            std::move(operation)));
+}
+
+DelayedOperation ExecutorWorkStealing::Schedule(const Milliseconds delay,
+                                                Tag tag,
+                                                Operation&& operation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!state_) return {};
+
+  HARD_ASSERT(delay.count() >= 0, "Schedule: delay cannot be negative");
+
+  const auto id = NextIdLocked();
+  state_->timers_.Push(Task::Create(nullptr, MakeTargetTime(delay), tag, id,
+                                    std::move(operation)));
+  return DelayedOperation(this, id);
+}
+
+void ExecutorWorkStealing::OnCompletion(Task*) {
+  // No-op in this implementation
+}
+
+void ExecutorWorkStealing::Cancel(const Id operation_id) {
+  Task* removed = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!state_) return;
+
+    // A due task might already have been moved to a run queue.
+    removed = state_->timers_.RemoveId(operation_id);
+    if (!removed) {
+      removed = state_->RemoveIf(
+          [operation_id](const Task& t) { return t.id() == operation_id; });
+    }
+  }
+
+  if (removed) {
+    // A removed task is guaranteed not to have started yet (see
+    // `ExecutorStd::Cancel`).
+    removed->Release();
+  }
+}
+
+void ExecutorWorkStealing::WorkerThread(std::shared_ptr<SharedState> state,
+                                        size_t index) {
+  current_state = state.get();
+  current_worker = index;
+
+  while (Task* task = state->WaitForTask(index)) {
+    task->ExecuteAndRelease();
+  }
+}
+
+void ExecutorWorkStealing::TimerThread(std::shared_ptr<SharedState> state) {
+  for (;;) {
+    Task* task = state->timers_.PopBlocking();
+    if (task->tag() == kShutdownTag) {
+      task->Release();
+      break;
+    }
+
+    state->Push(task);
+  }
+}
+
+ExecutorWorkStealing::Id ExecutorWorkStealing::NextIdLocked() {
+  // The wrap around is explicitly ignored, see `ExecutorStd::NextIdLocked`.
+  return current_id_++;
+}
+
+bool ExecutorWorkStealing::IsCurrentExecutor() const {
+  auto current_id = std::this_thread::get_id();
+  for (const std::thread& thread : worker_thread_pool_) {
+    if (thread.get_id() == current_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string ExecutorWorkStealing::CurrentExecutorName() const {
+  if (IsCurrentExecutor()) {
+    return Name();
+  } else {
+    return ThreadIdToString(std::this_thread::get_id());
+  }
+}
+
+std::string ExecutorWorkStealing::Name() const {
+  return ThreadIdToString(worker_thread_pool_.front().get_id());
+}
+
+void ExecutorWorkStealing::ExecuteBlocking(Operation&& operation) {
+  std::promise<void> signal_finished;
+  Execute([&] {
+    operation();
+    signal_finished.set_value();
+  });
+  signal_finished.get_future().wait();
+}
+
+bool ExecutorWorkStealing::IsTagScheduled(const Tag tag) const {
+  return state_->timers_.ContainsTag(tag) ||
+         state_->Contains([&tag](const Task& t) { return t.tag() == tag; });
+}
+
+bool ExecutorWorkStealing::IsIdScheduled(const Id id) const {
+  return state_->timers_.ContainsId(id) ||
+         state_->Contains([&id](const Task& t) { return t.id() == id; });
+}
+
+Task* ExecutorWorkStealing::PopFromSchedule() {
+  auto is_delayed = [](const Task& t) { return !t.is_immediate(); };
+  Task* task = state_->timers_.RemoveIf(is_delayed);
+  return task ? task : state_->RemoveIf(is_delayed);
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_UTIL_EXECUTOR_WORK_STEALING_H_
+#define FIRESTORE_CORE_SRC_UTIL_EXECUTOR_WORK_STEALING_H_
+
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "Firestore/core/src/util/executor.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+class Task;
+
+/**
+ * A concurrent executor that runs operations on a pool of dedicated background
+ * threads, using C++11 standard library functionality.
+ *
+ * Unlike `ExecutorStd`, whose workers all contend on a single schedule, each
+ * worker owns a run queue:
+ *
+ *   - Operations submitted from one of the workers go on that worker's queue;
+ *     operations submitted from any other thread go on a shared injection
+ *     queue.
+ *   - A worker takes operations from its own queue first, then from the
+ *     injection queue, and otherwise steals from the other workers' queues.
+ *   - Delayed operations are kept on a separate schedule, polled by a timer
+ *     thread that moves them to the injection queue once they're due.
+ *
+ * Operations submitted from the same thread are started in the order they
+ * were submitted only while there's a single worker; there's no ordering
+ * between operations submitted from different threads.
+ */
+class ExecutorWorkStealing : public Executor {
+ public:
+  static constexpr Tag kShutdownTag = -2;
+
+  explicit ExecutorWorkStealing(int threads);
+  ~ExecutorWorkStealing();
+
+  void Dispose() override;
+
+  void Execute(Operation&& operation) override;
+  void ExecuteBlocking(Operation&& operation) override;
+
+  DelayedOperation Schedule(Milliseconds delay,
+                            Tag tag,
+                            Operation&& operation) override;
+
+  bool IsCurrentExecutor() const override;
+  std::string CurrentExecutorName() const override;
+  std::string Name() const override;
+
+  bool IsTagScheduled(Tag tag) const override;
+  bool IsIdScheduled(Id id) const override;
+  Task* PopFromSchedule() override;
+
+ private:
+  class SharedState;
+
+  void OnCompletion(Task* task) override;
+  void Cancel(Id operation_id) override;
+
+  static void WorkerThread(std::shared_ptr<SharedState> state, size_t index);
+  static void TimerThread(std::shared_ptr<SharedState> state);
+  Id NextIdLocked();
+
+  // A mutex that provides mutual exclusion to users of the Executor interface.
+  // Worker threads and the timer thread do not acquire this mutex--they only
+  // operate on the SharedState.
+  std::mutex mutex_;
+
+  std::vector<std::thread> worker_thread_pool_;
+  std::thread timer_thread_;
+
+  Id current_id_ = 0;
+
+  // State shared with the threads. Note that if the Executor's destructor is
+  // called from a worker thread, this state will outlive the nominally owning
+  // Executor. `mutex_` does not protect this state.
+  std::shared_ptr<SharedState> state_;
+};
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_UTIL_EXECUTOR_WORK_STEALING_H_
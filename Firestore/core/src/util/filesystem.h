@@ -195,6 +195,12 @@ class Filesystem {
    */
   virtual StatusOr<std::string> ReadFile(const Path& path);
 
+  /**
+   * Replaces the contents of the file at the given `path`, creating it if
+   * needed, with the given bytes.
+   */
+  virtual Status WriteFile(const Path& path, absl::string_view contents);
+
  protected:
   Filesystem() = default;
 };
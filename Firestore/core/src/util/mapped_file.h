@@ -0,0 +1,70 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_UTIL_MAPPED_FILE_H_
+#define FIRESTORE_CORE_SRC_UTIL_MAPPED_FILE_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+class Path;
+
+template <typename T>
+class StatusOr;
+
+/**
+ * The read-only contents of a file, mapped into memory so that only the pages
+ * actually read are loaded. On platforms without memory mapping, the contents
+ * are read into memory instead.
+ *
+ * The file must not be modified while it's mapped; replace it by renaming a
+ * new file over it instead.
+ */
+class MappedFile {
+ public:
+  /** Maps the file at the given path. */
+  static StatusOr<std::unique_ptr<MappedFile>> Open(const Path& path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /** The contents of the file, valid for the lifetime of this object. */
+  absl::string_view data() const {
+    return data_;
+  }
+
+ private:
+  MappedFile() = default;
+
+  absl::string_view data_;
+
+  /** The contents, if they were read rather than mapped. */
+  std::string contents_;
+};
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_UTIL_MAPPED_FILE_H_
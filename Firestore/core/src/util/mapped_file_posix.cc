@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/mapped_file.h"
+
+#if !defined(_WIN32)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "Firestore/core/src/util/defer.h"
+#include "Firestore/core/src/util/path.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "Firestore/core/src/util/string_format.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+StatusOr<std::unique_ptr<MappedFile>> MappedFile::Open(const Path& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return Status::FromErrno(
+        errno, StringFormat("Failed to open file: %s", path.ToUtf8String()));
+  }
+  // The mapping stays valid after the descriptor is closed.
+  Defer cleanup([&] { ::close(fd); });
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    return Status::FromErrno(
+        errno, StringFormat("Failed to stat file: %s", path.ToUtf8String()));
+  }
+
+  std::unique_ptr<MappedFile> result(new MappedFile());
+  auto size = static_cast<size_t>(st.st_size);
+  if (size == 0) {
+    // Empty mappings are invalid.
+    return result;
+  }
+
+  void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (address == MAP_FAILED) {
+    return Status::FromErrno(
+        errno, StringFormat("Failed to map file: %s", path.ToUtf8String()));
+  }
+  result->data_ = absl::string_view(static_cast<const char*>(address), size);
+  return result;
+}
+
+MappedFile::~MappedFile() {
+  if (!data_.empty()) {
+    ::munmap(const_cast<char*>(data_.data()), data_.size());
+  }
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // !defined(_WIN32)
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/mapped_file.h"
+
+#if defined(_WIN32)
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "Firestore/core/src/util/path.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "Firestore/core/src/util/string_format.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+StatusOr<std::unique_ptr<MappedFile>> MappedFile::Open(const Path& path) {
+  // Memory mapping isn't implemented on Windows; read the contents instead.
+  std::ifstream file{path.native_value(), std::ios::binary};
+  if (!file) {
+    return Status{Error::kErrorUnknown,
+                  StringFormat("File at path '%s' cannot be opened",
+                               path.ToUtf8String())};
+  }
+
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+
+  std::unique_ptr<MappedFile> result(new MappedFile());
+  result->contents_ = buffer.str();
+  result->data_ = result->contents_;
+  return std::move(result);
+}
+
+MappedFile::~MappedFile() = default;
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // defined(_WIN32)
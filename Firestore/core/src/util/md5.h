@@ -0,0 +1,44 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_UTIL_MD5_H_
+#define FIRESTORE_CORE_SRC_UTIL_MD5_H_
+
+#include <array>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+/** An MD5 digest, as the 16 bytes of the hash in the order they're output. */
+using Md5Digest = std::array<uint8_t, 16>;
+
+/**
+ * Calculates the MD5 digest (RFC 1321) of the given data.
+ *
+ * MD5 is not cryptographically secure; this is only used where the backend
+ * prescribes it, such as for the bloom filters in existence filters.
+ */
+Md5Digest CalculateMd5Digest(absl::string_view data);
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_UTIL_MD5_H_
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_UTIL_MEMORY_PRESSURE_H_
+#define FIRESTORE_CORE_SRC_UTIL_MEMORY_PRESSURE_H_
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+/**
+ * How urgently the system wants memory back, which determines how much state
+ * that can be rebuilt on demand is discarded in response.
+ */
+enum class MemoryPressure {
+  /**
+   * Memory is getting low: discard caches of data that is also on disk.
+   */
+  Warning,
+
+  /**
+   * Memory is critically low, as when iOS sends a memory warning: in addition,
+   * discard views and query results that aren't in use.
+   */
+  Critical,
+};
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_UTIL_MEMORY_PRESSURE_H_
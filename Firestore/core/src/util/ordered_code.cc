@@ -22,6 +22,14 @@
 #include "absl/base/internal/unaligned_access.h"
 #include "absl/base/port.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FIRESTORE_ORDERED_CODE_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FIRESTORE_ORDERED_CODE_NEON 1
+#endif
+
 #if !defined(ABSL_IS_LITTLE_ENDIAN) && !defined(ABSL_IS_BIG_ENDIAN)
 #error \
     "Unsupported byte order: Either ABSL_IS_BIG_ENDIAN or " \
@@ -123,6 +131,49 @@ inline static int AdvanceIfNoSpecialBytes(uint32_t v_32, const char* p) {
   }
 }
 
+#if defined(FIRESTORE_ORDERED_CODE_SSE2) || \
+    defined(FIRESTORE_ORDERED_CODE_NEON)
+/**
+ * Scans "[start..limit)" for a special byte 16 bytes at a time with vector
+ * instructions. Returns a pointer to the first special byte found, or to the
+ * first of the fewer than 16 bytes left over if there is none before them.
+ */
+inline static const char* SkipToNextSpecialByteInVectors(const char* start,
+                                                         const char* limit) {
+  const char* p = start;
+#if defined(FIRESTORE_ORDERED_CODE_SSE2)
+  const __m128i zeros = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi8(static_cast<char>(0xff));
+  while (p + 16 <= limit) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i special =
+        _mm_or_si128(_mm_cmpeq_epi8(v, zeros), _mm_cmpeq_epi8(v, ones));
+    // One bit per byte, with the bit of the first byte lowest.
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+    if (mask != 0) {
+      return p + Bits::Log2FloorNonZero(mask & (0u - mask));
+    }
+    p += 16;
+  }
+#elif defined(FIRESTORE_ORDERED_CODE_NEON)
+  while (p + 16 <= limit) {
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    // The same (x + 1) < 2 test as in SkipToNextSpecialByte.
+    uint8x16_t special = vcltq_u8(vaddq_u8(v, vdupq_n_u8(1)), vdupq_n_u8(2));
+    // Narrowing each 16-bit lane by 4 bits leaves four bits per byte, with
+    // the bits of the first byte lowest.
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0);
+    if (mask != 0) {
+      return p + (Bits::Log2FloorNonZero64(mask & (0u - mask)) >> 2);
+    }
+    p += 16;
+  }
+#endif
+  return p;
+}
+#endif
+
 /**
  * Return a pointer to the first byte in the range "[start..limit)"
  * whose value is 0 or 255 (kEscape1 or kEscape2).  If no such byte
@@ -134,6 +185,12 @@ inline static const char* SkipToNextSpecialByte(const char* start,
   static_assert(kEscape1 == 0, "bit fiddling needs readjusting");
   static_assert((kEscape2 & 0xff) == 255, "bit fiddling needs readjusting");
   const char* p = start;
+#if defined(FIRESTORE_ORDERED_CODE_SSE2) || \
+    defined(FIRESTORE_ORDERED_CODE_NEON)
+  p = SkipToNextSpecialByteInVectors(p, limit);
+  // Unless the vector scan found a special byte, fewer than 16 bytes remain.
+  if (p + 16 <= limit) return p;
+#endif
   while (p + 8 <= limit) {
     // Find out if any of the next 8 bytes are either 0 or 255 (our
     // two characters that require special handling).  We do this using
@@ -372,9 +429,15 @@ bool OrderedCode::ReadNumIncreasing(absl::string_view* src, uint64_t* result) {
 
   if (result) {
     uint64_t tmp = 0;
-    for (size_t i = 0; i < len; i++) {
-      tmp <<= 8;
-      tmp |= static_cast<unsigned char>((*src)[1 + i]);
+    if (len > 0 && src->size() >= 9) {
+      // Load all 8 bytes that follow the length at once and drop the ones
+      // past the end of the number.
+      tmp = absl::gntohll(UNALIGNED_LOAD64(src->data() + 1)) >> (64 - 8 * len);
+    } else {
+      for (size_t i = 0; i < len; i++) {
+        tmp <<= 8;
+        tmp |= static_cast<unsigned char>((*src)[1 + i]);
+      }
     }
     *result = tmp;
   }
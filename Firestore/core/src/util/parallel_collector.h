@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_UTIL_PARALLEL_COLLECTOR_H_
+#define FIRESTORE_CORE_SRC_UTIL_PARALLEL_COLLECTOR_H_
+
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+/**
+ * Collects values produced by parallel tasks without any locking.
+ *
+ * The thread that schedules the tasks hands each task its own shard, obtained
+ * from `NewShard()`, and each task only ever appends to its own shard. Once all
+ * tasks have completed, `Result()` concatenates the shards in the order they
+ * were created. If the tasks are scheduled over consecutive slices of sorted
+ * input, the result is therefore sorted too, regardless of the order in which
+ * the tasks ran.
+ *
+ * `NewShard()` and `Result()` must be called from the scheduling thread, and
+ * the caller must wait for all tasks to complete (e.g. with
+ * `BackgroundQueue::AwaitAll()`) before calling `Result()`.
+ */
+template <typename T>
+class ParallelCollector {
+ public:
+  using Shard = std::vector<T>;
+
+  /**
+   * Creates a new empty shard. The returned pointer stays valid until the
+   * collector is destroyed; creating further shards does not invalidate it.
+   */
+  Shard* NewShard() {
+    shards_.emplace_back();
+    return &shards_.back();
+  }
+
+  /**
+   * Returns the values of all shards, in shard creation order, moving them out
+   * of the collector. The collector should not be reused.
+   */
+  std::vector<T> Result() {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+      total += shard.size();
+    }
+
+    std::vector<T> result;
+    result.reserve(total);
+    for (Shard& shard : shards_) {
+      result.insert(result.end(), std::make_move_iterator(shard.begin()),
+                    std::make_move_iterator(shard.end()));
+    }
+    shards_.clear();
+    return result;
+  }
+
+ private:
+  // A deque, since appending to it doesn't invalidate references to existing
+  // elements that tasks may be writing to concurrently.
+  std::deque<Shard> shards_;
+};
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_SRC_UTIL_PARALLEL_COLLECTOR_H_
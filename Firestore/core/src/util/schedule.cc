@@ -16,13 +16,77 @@
 
 #include "Firestore/core/src/util/schedule.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <limits>
+
 #include "Firestore/core/src/util/hard_assert.h"
-#include "Firestore/core/src/util/task.h"
-#include "absl/memory/memory.h"
 
 namespace firebase {
 namespace firestore {
 namespace util {
+namespace {
+
+constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+
+int64_t ToTick(Schedule::TimePoint time_point) {
+  return time_point.time_since_epoch().count();
+}
+
+int64_t NowTick() {
+  namespace chr = std::chrono;
+  return ToTick(
+      chr::time_point_cast<Schedule::Duration>(Schedule::Clock::now()));
+}
+
+}  // namespace
+
+// MARK: - TaskList
+
+namespace internal {
+
+void TaskList::InsertBefore(Task* position, Task* task) {
+  HARD_ASSERT(task->list_ == nullptr, "Task is already in a list");
+
+  Task* previous = position ? position->list_prev_ : tail_;
+  task->list_prev_ = previous;
+  task->list_next_ = position;
+  task->list_ = this;
+
+  (previous ? previous->list_next_ : head_) = task;
+  (position ? position->list_prev_ : tail_) = task;
+  ++size_;
+}
+
+void TaskList::Erase(Task* task) {
+  HARD_ASSERT(task->list_ == this, "Task is not in this list");
+
+  (task->list_prev_ ? task->list_prev_->list_next_ : head_) = task->list_next_;
+  (task->list_next_ ? task->list_next_->list_prev_ : tail_) = task->list_prev_;
+  task->list_prev_ = nullptr;
+  task->list_next_ = nullptr;
+  task->list_ = nullptr;
+  --size_;
+}
+
+Task* TaskList::PopFront() {
+  Task* task = head_;
+  if (task) {
+    Erase(task);
+  }
+  return task;
+}
+
+}  // namespace internal
+
+// MARK: - Schedule
+
+constexpr int Schedule::kBitsPerLevel;
+constexpr int Schedule::kSlotsPerLevel;
+constexpr int Schedule::kLevels;
+
+Schedule::Schedule() : current_tick_(NowTick()) {
+}
 
 Schedule::~Schedule() {
   Clear();
@@ -31,22 +95,46 @@ Schedule::~Schedule() {
 void Schedule::Clear() {
   std::unique_lock<std::mutex> lock{mutex_};
 
-  for (Task* task : scheduled_) {
-    task->Release();
+  auto release_all = [](TaskList* list) {
+    while (Task* task = list->PopFront()) {
+      task->Release();
+    }
+  };
+  release_all(&due_);
+  for (auto& level : wheel_) {
+    for (TaskList& slot : level) {
+      release_all(&slot);
+    }
   }
+  release_all(&overflow_);
 
-  scheduled_.clear();
+  size_ = 0;
+  delayed_.clear();
+  tag_counts_.clear();
 }
 
 void Schedule::Push(Task* task) {
-  InsertPreservingOrder(task);
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  if (!task->is_immediate()) {
+    delayed_.emplace(task->id(), task);
+    ++tag_counts_[task->tag()];
+  }
+  ++size_;
+  PlaceLocked(task);
+
+  // Callers blocked in `PopBlocking` will get to the new entry on their own
+  // unless it's due before any of them wakes up.
+  if (!wakeups_.empty() && task->target_time() < *wakeups_.begin()) {
+    cv_.notify_one();
+  }
 }
 
 Task* Schedule::PopIfDue() {
   std::lock_guard<std::mutex> lock{mutex_};
 
   if (HasDueLocked()) {
-    return ExtractLocked(scheduled_.begin());
+    return ExtractLocked(due_.front());
   }
   return nullptr;
 }
@@ -55,77 +143,189 @@ Task* Schedule::PopBlocking() {
   std::unique_lock<std::mutex> lock{mutex_};
 
   while (true) {
-    cv_.wait(lock, [this] { return !scheduled_.empty(); });
+    if (HasDueLocked()) {
+      return ExtractLocked(due_.front());
+    }
 
-    // To minimize busy waiting, sleep until either the nearest entry in the
-    // future either changes, or else becomes due.
+    // To minimize busy waiting, sleep until either the wheel has entries to
+    // move, or an entry that's due sooner than that is added.
+    int64_t next_tick = NextEventTickLocked();
+    if (next_tick == kNever) {
+      auto wakeup = wakeups_.insert(TimePoint::max());
+      cv_.wait(lock);
+      wakeups_.erase(wakeup);
+      continue;
+    }
 
+    const TimePoint until{Duration{next_tick}};
+    auto wakeup = wakeups_.insert(until);
     // Workaround for Visual Studio 2015: cast to a time point with resolution
     // that's at least as fine-grained as the clock on which `wait_until` is
     // parametrized.
-    const auto until = std::chrono::time_point_cast<Clock::duration>(
-        scheduled_.front()->target_time());
-    cv_.wait_until(lock, until, [this, until] {
-      return scheduled_.empty() || scheduled_.front()->target_time() != until;
-    });
-
-    // There are 3 possibilities why `wait_until` has returned:
-    // - `wait_until` has timed out, in which case the current time is at
-    //   least `until`, so there must be an overdue entry;
-    // - a new entry has been added which comes before `until`. It must be
-    //   either overdue (in which case `HasDueLocked` will break the cycle),
-    //   or else `until` must be reevaluated (on the next iteration of the
-    //   loop);
-    // - `until` entry has been removed (including the case where the queue
-    //   has become empty). This means `until` has to be reevaluated, similar
-    //   to #2.
+    cv_.wait_until(lock, std::chrono::time_point_cast<Clock::duration>(until));
+    wakeups_.erase(wakeup);
 
-    if (HasDueLocked()) {
-      return ExtractLocked(scheduled_.begin());
-    }
+    // Whether `wait_until` has timed out, or been notified about an entry due
+    // sooner (or woken up spuriously), the wheel is advanced to the current
+    // time on the next iteration of the loop. Removed entries don't wake up
+    // the callers: at worst, they wake up to find nothing due and go back to
+    // sleep.
   }
 }
 
 bool Schedule::empty() const {
   std::lock_guard<std::mutex> lock{mutex_};
-  return scheduled_.empty();
+  return size_ == 0;
 }
 
 size_t Schedule::size() const {
   std::lock_guard<std::mutex> lock{mutex_};
-  return scheduled_.size();
+  return size_;
 }
 
-void Schedule::InsertPreservingOrder(Task* new_entry) {
+Task* Schedule::RemoveId(Executor::Id id) {
   std::lock_guard<std::mutex> lock{mutex_};
 
-  const auto insertion_point =
-      std::upper_bound(scheduled_.begin(), scheduled_.end(), new_entry,
-                       [](Task* lhs, Task* rhs) {
-                         return lhs->target_time() < rhs->target_time();
-                       });
-  scheduled_.insert(insertion_point, new_entry);
+  auto found = delayed_.find(id);
+  if (found == delayed_.end()) {
+    return nullptr;
+  }
+  return ExtractLocked(found->second);
+}
 
-  cv_.notify_one();
+bool Schedule::ContainsId(Executor::Id id) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return delayed_.find(id) != delayed_.end();
+}
+
+bool Schedule::ContainsTag(Executor::Tag tag) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto found = tag_counts_.find(tag);
+  return found != tag_counts_.end() && found->second > 0;
+}
+
+Schedule::TaskList* Schedule::ListForTickLocked(int64_t tick) {
+  if (tick <= current_tick_) {
+    return &due_;
+  }
+
+  for (int level = 0; level < kLevels; ++level) {
+    int block_shift = kBitsPerLevel * (level + 1);
+    if ((tick >> block_shift) == (current_tick_ >> block_shift)) {
+      int slot = (tick >> (kBitsPerLevel * level)) & (kSlotsPerLevel - 1);
+      return &wheel_[level][slot];
+    }
+  }
+  return &overflow_;
+}
+
+void Schedule::PlaceLocked(Task* task) {
+  TaskList* list = ListForTickLocked(ToTick(task->target_time()));
+
+  Task* position = nullptr;
+  if (list == &due_) {
+    // Entries mostly become due in order, so search from the back.
+    Task* previous = due_.back();
+    while (previous && task->target_time() < previous->target_time()) {
+      position = previous;
+      previous = TaskList::Previous(previous);
+    }
+  }
+  list->InsertBefore(position, task);
+}
+
+void Schedule::CascadeLocked(TaskList* list) {
+  // Entries in `overflow_` may go back to it, so take them all out first.
+  TaskList pending;
+  while (Task* task = list->PopFront()) {
+    pending.PushBack(task);
+  }
+  while (Task* task = pending.PopFront()) {
+    PlaceLocked(task);
+  }
+}
+
+void Schedule::AdvanceLocked(int64_t tick) {
+  while (current_tick_ < tick) {
+    int64_t next_tick = NextEventTickLocked();
+    if (next_tick > tick) {
+      // Nothing to move before `tick`, so the wheel can jump straight to it.
+      current_tick_ = tick;
+      return;
+    }
+
+    current_tick_ = next_tick;
+
+    // Entering a new block at some level moves the entries in the slot for
+    // that block at the next level up into lower levels. Going top down, the
+    // entries moved from one level are moved further down if necessary.
+    for (int level = kLevels; level > 0; --level) {
+      int shift = kBitsPerLevel * level;
+      if ((current_tick_ & ((int64_t{1} << shift) - 1)) != 0) continue;
+
+      if (level == kLevels) {
+        CascadeLocked(&overflow_);
+      } else {
+        int slot = (current_tick_ >> shift) & (kSlotsPerLevel - 1);
+        CascadeLocked(&wheel_[level][slot]);
+      }
+    }
+    CascadeLocked(&wheel_[0][current_tick_ & (kSlotsPerLevel - 1)]);
+  }
+}
+
+int64_t Schedule::NextEventTickLocked() const {
+  if (size_ == due_.size()) {
+    return kNever;
+  }
+
+  int64_t result = kNever;
+  for (int level = 0; level < kLevels; ++level) {
+    int shift = kBitsPerLevel * level;
+    int current_slot = (current_tick_ >> shift) & (kSlotsPerLevel - 1);
+    int64_t block_start = (current_tick_ >> (shift + kBitsPerLevel))
+                          << (shift + kBitsPerLevel);
+
+    for (int slot = current_slot + 1; slot < kSlotsPerLevel; ++slot) {
+      if (!wheel_[level][slot].empty()) {
+        result = std::min(result, block_start + (int64_t{slot} << shift));
+        break;
+      }
+    }
+  }
+
+  if (!overflow_.empty()) {
+    int shift = kBitsPerLevel * kLevels;
+    result = std::min(result, ((current_tick_ >> shift) + 1) << shift);
+  }
+  return result;
 }
 
 // This function expects the mutex to be already locked.
-bool Schedule::HasDueLocked() const {
-  namespace chr = std::chrono;
-  const auto now = chr::time_point_cast<Duration>(Clock::now());
-  return !scheduled_.empty() && now >= scheduled_.front()->target_time();
+bool Schedule::HasDueLocked() {
+  AdvanceLocked(NowTick());
+  return !due_.empty();
 }
 
 // This function expects the mutex to be already locked.
-Task* Schedule::ExtractLocked(const Iterator where) {
-  HARD_ASSERT(!scheduled_.empty(),
-              "Trying to pop an entry from an empty queue.");
+Task* Schedule::ExtractLocked(Task* task) {
+  HARD_ASSERT(size_ > 0, "Trying to pop an entry from an empty queue.");
 
-  Task* result = *where;
-  scheduled_.erase(where);
-  cv_.notify_one();
+  TaskList::ListOf(task)->Erase(task);
+  --size_;
 
-  return result;
+  if (!task->is_immediate()) {
+    auto range = delayed_.equal_range(task->id());
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      if (iter->second == task) {
+        delayed_.erase(iter);
+        break;
+      }
+    }
+    --tag_counts_[task->tag()];
+  }
+
+  return task;
 }
 
 }  // namespace util
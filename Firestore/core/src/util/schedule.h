@@ -17,19 +17,68 @@
 #ifndef FIRESTORE_CORE_SRC_UTIL_SCHEDULE_H_
 #define FIRESTORE_CORE_SRC_UTIL_SCHEDULE_H_
 
-#include <algorithm>
 #include <condition_variable>  // NOLINT(build/c++11)
-#include <deque>
+#include <cstdint>
 #include <mutex>  // NOLINT(build/c++11)
-#include <vector>
+#include <set>
+#include <unordered_map>
 
 #include "Firestore/core/src/util/executor.h"
+#include "Firestore/core/src/util/task.h"
 
 namespace firebase {
 namespace firestore {
 namespace util {
+namespace internal {
 
-class Task;
+// An intrusive doubly-linked list of tasks. The links are stored in the tasks
+// themselves, so adding a task to a list doesn't allocate. A task can be in at
+// most one list at a time.
+class TaskList {
+ public:
+  TaskList() = default;
+  TaskList(const TaskList&) = delete;
+  TaskList& operator=(const TaskList&) = delete;
+
+  bool empty() const {
+    return head_ == nullptr;
+  }
+  size_t size() const {
+    return size_;
+  }
+  Task* front() const {
+    return head_;
+  }
+  Task* back() const {
+    return tail_;
+  }
+
+  static Task* Next(const Task* task) {
+    return task->list_next_;
+  }
+  static Task* Previous(const Task* task) {
+    return task->list_prev_;
+  }
+  static TaskList* ListOf(const Task* task) {
+    return task->list_;
+  }
+
+  // Inserts `task` before `position`, or at the back if `position` is null.
+  void InsertBefore(Task* position, Task* task);
+  void PushBack(Task* task) {
+    InsertBefore(nullptr, task);
+  }
+
+  void Erase(Task* task);
+  Task* PopFront();
+
+ private:
+  Task* head_ = nullptr;
+  Task* tail_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace internal
 
 // A thread-safe class similar to a priority queue where the entries are
 // prioritized by the time for which they're scheduled. Entries scheduled for
@@ -42,17 +91,32 @@ class Task;
 // The details of time management are completely concealed within the class.
 // Once an entry is scheduled, there is no way to reschedule or even retrieve
 // the time.
+//
+// Entries that aren't due yet are kept in a hierarchical timer wheel with
+// millisecond resolution, so pushing an entry and removing it by id or looking
+// it up by id or tag take constant time regardless of how many entries are
+// scheduled. `PopBlocking` only wakes up when the wheel has to be advanced, and
+// pushing an entry only wakes it up if the entry is due sooner than that.
+// Entries are linked through the tasks themselves, so pushing immediate tasks
+// doesn't allocate.
 class Schedule {
   // Internal invariants:
-  // - entries are always in sorted order, leftmost entry is always the most
-  //   due;
-  // - each operation modifying the queue notifies the condition variable `cv_`.
+  // - `due_` holds the entries scheduled for `current_tick_` or earlier, in
+  //   sorted order, leftmost entry is always the most due;
+  // - an entry scheduled for a later tick is in the wheel, at the lowest level
+  //   whose current block (of `kSlotsPerLevel` slots) contains the tick, and
+  //   in the slot for the tick at that level; it's in `overflow_` if the
+  //   top-level block doesn't contain it. Slots that `current_tick_` has
+  //   passed are empty;
+  // - `delayed_` and `tag_counts_` reflect all the entries that aren't
+  //   immediate.
  public:
   using Duration = Executor::Milliseconds;
   using Clock = Executor::Clock;
   // Entries are scheduled using absolute time.
   using TimePoint = Executor::TimePoint;
 
+  Schedule();
   ~Schedule();
 
   void Clear();
@@ -76,9 +140,21 @@ class Schedule {
 
   size_t size() const;
 
+  // Removes an entry that isn't immediate and has the given id from the queue
+  // and returns it. If no such entry exists, returns `nullptr`.
+  Task* RemoveId(Executor::Id id);
+
+  // Checks whether the queue contains an entry that isn't immediate and has
+  // the given id.
+  bool ContainsId(Executor::Id id) const;
+
+  // Checks whether the queue contains an entry that isn't immediate and has
+  // the given tag.
+  bool ContainsTag(Executor::Tag tag) const;
+
   // Removes the first entry satisfying predicate from the queue and returns it.
-  // If no such entry exists, returns `nullptr`. The predicate is applied to
-  // entries in order according to their scheduled time.
+  // If no such entry exists, returns `nullptr`. Of the entries satisfying the
+  // predicate, the one with the earliest scheduled time is removed.
   //
   // Note that this function doesn't take into account whether the removed entry
   // is past its due time.
@@ -86,41 +162,92 @@ class Schedule {
   Task* RemoveIf(const Pred pred) {
     std::lock_guard<std::mutex> lock{mutex_};
 
-    for (auto iter = scheduled_.begin(), end = scheduled_.end(); iter != end;
-         ++iter) {
-      Task* task = *iter;
-      if (pred(*task)) {
-        return ExtractLocked(iter);
+    Task* found = nullptr;
+    ForEachListLocked([&](const TaskList& list) {
+      for (Task* task = list.front(); task; task = TaskList::Next(task)) {
+        if (found && task->target_time() >= found->target_time()) {
+          continue;
+        }
+        if (pred(*task)) {
+          found = task;
+        }
       }
-    }
-    return nullptr;
+    });
+    return found ? ExtractLocked(found) : nullptr;
   }
 
   // Checks whether the queue contains an entry satisfying the given predicate.
   template <typename Pred>
   bool Contains(const Pred pred) const {
     std::lock_guard<std::mutex> lock{mutex_};
-    return std::any_of(scheduled_.begin(), scheduled_.end(),
-                       [&pred](Task* t) { return pred(*t); });
+
+    bool result = false;
+    ForEachListLocked([&](const TaskList& list) {
+      for (Task* task = list.front(); task && !result;
+           task = TaskList::Next(task)) {
+        result = pred(*task);
+      }
+    });
+    return result;
   }
 
  private:
-  // All removals are on the front, but most insertions are expected to be on
-  // the back.
-  using Container = std::deque<Task*>;
-  using Iterator = typename Container::iterator;
+  using TaskList = internal::TaskList;
+
+  static constexpr int kBitsPerLevel = 6;
+  static constexpr int kSlotsPerLevel = 1 << kBitsPerLevel;
+  static constexpr int kLevels = 4;
+
+  template <typename F>
+  void ForEachListLocked(F f) const {
+    f(due_);
+    for (const auto& level : wheel_) {
+      for (const TaskList& slot : level) {
+        f(slot);
+      }
+    }
+    f(overflow_);
+  }
+
+  // Returns the list an entry scheduled for the given tick belongs to.
+  TaskList* ListForTickLocked(int64_t tick);
+
+  // Adds the given task, which isn't in any list, to the list it belongs to.
+  void PlaceLocked(Task* task);
+
+  // Moves all the entries in the given list to the lists they belong to.
+  void CascadeLocked(TaskList* list);
 
-  void InsertPreservingOrder(Task* new_entry);
+  // Moves `current_tick_` forward to `tick`, moving the entries that become due
+  // to `due_`.
+  void AdvanceLocked(int64_t tick);
+
+  // Returns the next tick at which the wheel has entries to move, or `kNever`
+  // if the wheel is empty.
+  int64_t NextEventTickLocked() const;
 
   // This function expects the mutex to be already locked.
-  bool HasDueLocked() const;
+  bool HasDueLocked();
 
   // This function expects the mutex to be already locked.
-  Task* ExtractLocked(const Iterator where);
+  Task* ExtractLocked(Task* task);
 
   mutable std::mutex mutex_;
   std::condition_variable cv_;
-  Container scheduled_;
+
+  TaskList due_;
+  TaskList wheel_[kLevels][kSlotsPerLevel];
+  TaskList overflow_;
+  size_t size_ = 0;
+  int64_t current_tick_ = 0;
+
+  std::unordered_multimap<Executor::Id, Task*> delayed_;
+  // Entries are kept at zero rather than erased, since there are few tags.
+  std::unordered_map<Executor::Tag, int> tag_counts_;
+
+  // The times at which the callers blocked in `PopBlocking` wake up on their
+  // own.
+  std::multiset<TimePoint> wakeups_;
 };
 
 }  // namespace util
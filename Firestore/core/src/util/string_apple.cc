@@ -18,6 +18,7 @@
 
 #if defined(__APPLE__)
 
+#include <cstring>
 #include <string>
 
 #include "Firestore/core/src/util/hard_assert.h"
@@ -32,6 +33,18 @@ std::string MakeString(CFStringRef str) {
     return {};
   }
 
+  // Most strings, and field names in particular, are ASCII and stored as 8-bit
+  // characters, which CFStringGetCStringPtr exposes without any conversion. A
+  // string with an embedded null character is shorter than its length as a C
+  // string and needs the conversion below.
+  const char* c_str = CFStringGetCStringPtr(str, kCFStringEncodingUTF8);
+  if (c_str) {
+    size_t length = std::strlen(c_str);
+    if (length == static_cast<size_t>(num_chars)) {
+      return std::string(c_str, length);
+    }
+  }
+
   // In the first pass figure the size required. The size does not include the
   // null terminator.
   CFRange range{0, num_chars};
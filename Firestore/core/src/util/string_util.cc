@@ -16,6 +16,9 @@
 
 #include "Firestore/core/src/util/string_util.h"
 
+#include <cstdint>
+#include <cstring>
+
 namespace firebase {
 namespace firestore {
 namespace util {
@@ -48,6 +51,69 @@ std::string ImmediateSuccessor(absl::string_view s) {
   return out;
 }
 
+namespace {
+
+constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+
+/** Returns whether `byte` is a UTF-8 continuation byte, 0b10xxxxxx. */
+bool IsContinuation(uint8_t byte) {
+  return (byte & 0xC0) == 0x80;
+}
+
+}  // namespace
+
+bool IsValidUtf8(absl::string_view str) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(str.data());
+  size_t size = str.size();
+  size_t i = 0;
+
+  while (i < size) {
+    // Skip over runs of ASCII a word at a time.
+    uint64_t word;
+    while (size - i >= sizeof(word)) {
+      std::memcpy(&word, bytes + i, sizeof(word));
+      if ((word & kHighBits) != 0) break;
+      i += sizeof(word);
+    }
+    if (i == size) break;
+
+    uint8_t lead = bytes[i];
+    if (lead < 0x80) {
+      ++i;
+      continue;
+    }
+
+    // The valid ranges of the second byte exclude overlong encodings,
+    // surrogates (U+D800 to U+DFFF), and characters above U+10FFFF.
+    size_t length;
+    uint8_t min_second = 0x80;
+    uint8_t max_second = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+      length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      length = 3;
+      if (lead == 0xE0) min_second = 0xA0;
+      if (lead == 0xED) max_second = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      length = 4;
+      if (lead == 0xF0) min_second = 0x90;
+      if (lead == 0xF4) max_second = 0x8F;
+    } else {
+      return false;
+    }
+
+    if (size - i < length) return false;
+    uint8_t second = bytes[i + 1];
+    if (second < min_second || second > max_second) return false;
+    for (size_t j = 2; j < length; ++j) {
+      if (!IsContinuation(bytes[i + j])) return false;
+    }
+    i += length;
+  }
+
+  return true;
+}
+
 const std::string& EmptyString() {
   static auto* empty = new std::string;
   return *empty;
@@ -65,6 +65,15 @@ std::string PrefixSuccessor(absl::string_view prefix);
  */
 std::string ImmediateSuccessor(absl::string_view s);
 
+/**
+ * Returns whether `str` is well-formed UTF-8: every character is encoded in
+ * its shortest form, and no character is a surrogate or exceeds U+10FFFF.
+ *
+ * ASCII text is checked eight bytes at a time, so validating mostly-ASCII
+ * strings costs little more than reading them.
+ */
+bool IsValidUtf8(absl::string_view str);
+
 /**
  * Returns an reference to a static empty string.
  */
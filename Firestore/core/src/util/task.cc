@@ -18,7 +18,10 @@
 
 #include <chrono>  // NOLINT(build/c++11)
 #include <cstdint>
+#include <mutex>  // NOLINT(build/c++11)
+#include <new>
 #include <utility>
+#include <vector>
 
 #include "Firestore/core/src/util/defer.h"
 #include "Firestore/core/src/util/hard_assert.h"
@@ -27,6 +30,75 @@
 namespace firebase {
 namespace firestore {
 namespace util {
+namespace {
+
+/**
+ * Recycles the memory of deleted tasks, since the executors create a task for
+ * every operation. Tasks are usually deleted on a different thread than the
+ * one that created them, so the pool is shared by all threads.
+ */
+class TaskPool {
+ public:
+  static TaskPool& Instance() {
+    // Intentionally leaked, so that tasks can still be deleted during static
+    // destruction.
+    static TaskPool* pool = new TaskPool();
+    return *pool;
+  }
+
+  void* Allocate(size_t size) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_.empty()) {
+        void* result = free_.back();
+        free_.pop_back();
+        return result;
+      }
+    }
+    return ::operator new(size);
+  }
+
+  void Free(void* ptr) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_.size() < kCapacity) {
+        free_.push_back(ptr);
+        return;
+      }
+    }
+    ::operator delete(ptr);
+  }
+
+ private:
+  // Enough for bursts of operations; beyond that, memory is given back.
+  static constexpr size_t kCapacity = 256;
+
+  TaskPool() {
+    free_.reserve(kCapacity);
+  }
+
+  std::mutex mutex_;
+  std::vector<void*> free_;
+};
+
+constexpr size_t TaskPool::kCapacity;
+
+}  // namespace
+
+void* Task::operator new(size_t size) {
+  if (size != sizeof(Task)) {
+    return ::operator new(size);
+  }
+  return TaskPool::Instance().Allocate(size);
+}
+
+void Task::operator delete(void* ptr, size_t size) {
+  if (size != sizeof(Task)) {
+    ::operator delete(ptr);
+    return;
+  }
+  TaskPool::Instance().Free(ptr);
+}
 
 Task* Task::Create(Executor* executor, Executor::Operation&& operation) {
   return new Task(executor, Executor::TimePoint(), Executor::kNoTag, 0u,
@@ -19,6 +19,7 @@
 
 #include <atomic>
 #include <condition_variable>  // NOLINT(build/c++11)
+#include <cstddef>
 #include <memory>
 #include <mutex>   // NOLINT(build/c++11)
 #include <thread>  // NOLINT(build/c++11)
@@ -28,6 +29,9 @@
 namespace firebase {
 namespace firestore {
 namespace util {
+namespace internal {
+class TaskList;
+}  // namespace internal
 
 /**
  * A task for an Executor to execute, either synchronously or asynchronously,
@@ -36,6 +40,7 @@ namespace util {
  * Tasks are referenced counted, always live on the heap, must be allocated with
  * `Task::Create`, and `delete` themselves when their reference count goes to
  * zero. Use `Retain` and `Release` to manipulate the internal reference count.
+ * The memory of deleted tasks is recycled for new ones.
  *
  * Nominally Tasks are owned by an Executor, but Tasks are intended to be able
  * to outlive their owner in some special cases:
@@ -67,6 +72,11 @@ class Task {
   Task(const Task& other) = delete;
   Task& operator=(const Task& other) = delete;
 
+  // Allocates from a pool of recycled tasks. Subclasses (which are only used
+  // in tests) are allocated normally.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   /**
    * Executes the operation if the Task has not already been executed or
    * cancelled. Regardless of whether or not the operation runs, releases the
@@ -188,6 +198,9 @@ class Task {
   // Subclasses allowed for testing.
   friend class TrackingTask;
 
+  // Links tasks into the lists of a `Schedule` without allocating.
+  friend class internal::TaskList;
+
   void AwaitLocked(std::unique_lock<std::mutex>& lock);
 
   std::mutex mutex_;
@@ -203,6 +216,11 @@ class Task {
 
   std::thread::id executing_thread_;
 
+  // Guarded by the mutex of the `Schedule` that the `list_` belongs to.
+  Task* list_prev_ = nullptr;
+  Task* list_next_ = nullptr;
+  internal::TaskList* list_ = nullptr;
+
   // The operation to run, supplied by the caller. Make this the last member
   // just in case it refers to this task during its own destruction.
   Executor::Operation operation_;
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/trace.h"
+
+#include <atomic>
+
+namespace firebase {
+namespace firestore {
+namespace util {
+namespace {
+
+std::atomic<TraceSink*> trace_sink{nullptr};
+std::atomic<uint64_t> next_span_id{1};
+
+}  // namespace
+
+void SetTraceSink(TraceSink* sink) {
+  trace_sink.store(sink, std::memory_order_release);
+}
+
+TraceSink* GetTraceSink() {
+  return trace_sink.load(std::memory_order_acquire);
+}
+
+void TraceSpan::Begin() {
+  span_id_ = next_span_id.fetch_add(1, std::memory_order_relaxed);
+  start_ = std::chrono::steady_clock::now();
+  sink_->BeginSpan(name_, span_id_);
+}
+
+void TraceSpan::End() {
+  sink_->EndSpan(name_, span_id_, std::chrono::steady_clock::now() - start_);
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
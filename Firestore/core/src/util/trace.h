@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_SRC_UTIL_TRACE_H_
+#define FIRESTORE_CORE_SRC_UTIL_TRACE_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+
+// Tracing spans are compiled in unless `FIRESTORE_TRACING_ENABLED` is defined
+// to 0. When compiled in, a span costs an atomic load unless a `TraceSink` is
+// installed.
+#ifndef FIRESTORE_TRACING_ENABLED
+#define FIRESTORE_TRACING_ENABLED 1
+#endif
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+/**
+ * Receives the tracing spans recorded with `FIRESTORE_TRACE_SPAN`, e.g. to
+ * export them to Instruments signposts, Perfetto or the app's own telemetry.
+ *
+ * Spans are recorded on whichever thread does the traced work, so
+ * implementations must be thread-safe. A span always ends on the thread it
+ * began on, and spans on one thread are properly nested.
+ */
+class TraceSink {
+ public:
+  virtual ~TraceSink() = default;
+
+  /**
+   * Called when a span begins.
+   *
+   * @param name The name of the span, a string literal.
+   * @param span_id An identifier unique to this span within the process.
+   */
+  virtual void BeginSpan(const char* name, uint64_t span_id) = 0;
+
+  /** Called when the span with the given id ends, after `duration`. */
+  virtual void EndSpan(const char* name,
+                       uint64_t span_id,
+                       std::chrono::steady_clock::duration duration) = 0;
+};
+
+/**
+ * Installs the sink all spans are reported to from now on, or removes the sink
+ * if null. Spans that already began are ended on the sink they began on, so the
+ * sink must stay alive after it is replaced; sinks are expected to live until
+ * the process exits.
+ */
+void SetTraceSink(TraceSink* sink);
+
+/** Returns the installed sink, or null. */
+TraceSink* GetTraceSink();
+
+#if defined(__APPLE__)
+/**
+ * Returns a sink that reports spans as os_signpost intervals named "Firestore"
+ * in the "com.google.firebase.firestore" subsystem, where Instruments can show
+ * them. Spans are dropped on OS versions without signpost support.
+ */
+TraceSink* SignpostTraceSink();
+#endif  // defined(__APPLE__)
+
+/**
+ * Reports a span to the installed `TraceSink` for as long as it's in scope. Use
+ * `FIRESTORE_TRACE_SPAN` rather than creating these directly, so that the span
+ * is compiled out when tracing is disabled.
+ */
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name) : name_(name), sink_(GetTraceSink()) {
+    if (sink_) Begin();
+  }
+
+  ~TraceSpan() {
+    if (sink_) End();
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  void Begin();
+  void End();
+
+  const char* name_ = nullptr;
+  TraceSink* sink_ = nullptr;
+  uint64_t span_id_ = 0;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
+
+#define FIRESTORE_TRACE_CONCAT_INNER(a, b) a##b
+#define FIRESTORE_TRACE_CONCAT(a, b) FIRESTORE_TRACE_CONCAT_INNER(a, b)
+
+/**
+ * Traces the rest of the enclosing scope as a span with the given name, which
+ * must be a string literal.
+ */
+#if FIRESTORE_TRACING_ENABLED
+#define FIRESTORE_TRACE_SPAN(name)       \
+  ::firebase::firestore::util::TraceSpan \
+      FIRESTORE_TRACE_CONCAT(_firestore_trace_span_, __LINE__)(name)
+#else
+#define FIRESTORE_TRACE_SPAN(name) \
+  do {                             \
+  } while (0)
+#endif
+
+#endif  // FIRESTORE_CORE_SRC_UTIL_TRACE_H_
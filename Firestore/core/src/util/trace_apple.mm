@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/trace.h"
+
+#include <os/log.h>
+#include <os/signpost.h>
+
+namespace firebase {
+namespace firestore {
+namespace util {
+namespace {
+
+class SignpostSink : public TraceSink {
+ public:
+  SignpostSink()
+      : log_(os_log_create("com.google.firebase.firestore", "Firestore")) {
+  }
+
+  void BeginSpan(const char* name, uint64_t span_id) override {
+    if (@available(iOS 12, macOS 10.14, tvOS 12, watchOS 5, *)) {
+      os_signpost_interval_begin(log_, span_id, "Firestore", "%{public}s",
+                                 name);
+    }
+  }
+
+  void EndSpan(const char* name,
+               uint64_t span_id,
+               std::chrono::steady_clock::duration) override {
+    if (@available(iOS 12, macOS 10.14, tvOS 12, watchOS 5, *)) {
+      os_signpost_interval_end(log_, span_id, "Firestore", "%{public}s", name);
+    }
+  }
+
+ private:
+  os_log_t log_;
+};
+
+}  // namespace
+
+TraceSink* SignpostTraceSink() {
+  // Intentionally leaked: sinks live until the process exits.
+  static SignpostSink* sink = new SignpostSink();
+  return sink;
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
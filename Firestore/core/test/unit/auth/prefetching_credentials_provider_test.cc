@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/auth/prefetching_credentials_provider.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/util/statusor.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace auth {
+namespace {
+
+/** Records the token requests and lets the test complete them. */
+class FakeCredentialsProvider : public CredentialsProvider {
+ public:
+  void GetToken(TokenListener completion) override {
+    requests.push_back(std::move(completion));
+  }
+
+  void InvalidateToken() override {
+  }
+
+  void SetCredentialChangeListener(
+      CredentialChangeListener change_listener) override {
+    change_listener_ = std::move(change_listener);
+    if (change_listener_) {
+      change_listener_(User::Unauthenticated());
+    }
+  }
+
+  void ChangeUser(const std::string& uid) {
+    change_listener_(User(uid));
+  }
+
+  void CompleteRequest(size_t index, const std::string& token) {
+    requests[index](Token(token, User("alice")));
+  }
+
+  std::vector<TokenListener> requests;
+};
+
+class PrefetchingCredentialsProviderTest : public testing::Test {
+ public:
+  PrefetchingCredentialsProviderTest()
+      : fake_(std::make_shared<FakeCredentialsProvider>()),
+        provider_(std::make_shared<PrefetchingCredentialsProvider>(fake_)) {
+  }
+
+  /** Requests a token and returns the token string it got, if any. */
+  std::shared_ptr<std::string> GetToken() {
+    auto result = std::make_shared<std::string>();
+    provider_->GetToken([result](util::StatusOr<Token> token) {
+      *result = token.ValueOrDie().token();
+    });
+    return result;
+  }
+
+  std::shared_ptr<FakeCredentialsProvider> fake_;
+  std::shared_ptr<PrefetchingCredentialsProvider> provider_;
+};
+
+}  // namespace
+
+TEST_F(PrefetchingCredentialsProviderTest, HandsOutPrefetchedTokenOnce) {
+  provider_->Prefetch();
+  ASSERT_EQ(fake_->requests.size(), 1u);
+  fake_->CompleteRequest(0, "prefetched");
+
+  EXPECT_EQ(*GetToken(), "prefetched");
+  EXPECT_EQ(fake_->requests.size(), 1u);
+
+  auto second = GetToken();
+  ASSERT_EQ(fake_->requests.size(), 2u);
+  fake_->CompleteRequest(1, "fresh");
+  EXPECT_EQ(*second, "fresh");
+}
+
+TEST_F(PrefetchingCredentialsProviderTest, RequestsWaitForPrefetchInFlight) {
+  provider_->Prefetch();
+  auto first = GetToken();
+  auto second = GetToken();
+  EXPECT_EQ(fake_->requests.size(), 1u);
+
+  fake_->CompleteRequest(0, "prefetched");
+  EXPECT_EQ(*first, "prefetched");
+  EXPECT_EQ(*second, "prefetched");
+
+  // The token was already handed out, so it isn't kept.
+  GetToken();
+  EXPECT_EQ(fake_->requests.size(), 2u);
+}
+
+TEST_F(PrefetchingCredentialsProviderTest, DropsTokenOnInvalidate) {
+  provider_->Prefetch();
+  fake_->CompleteRequest(0, "prefetched");
+
+  provider_->InvalidateToken();
+  GetToken();
+  EXPECT_EQ(fake_->requests.size(), 2u);
+}
+
+TEST_F(PrefetchingCredentialsProviderTest, DropsTokenOnCredentialChange) {
+  std::vector<std::string> users;
+  provider_->SetCredentialChangeListener(
+      [&users](User user) { users.push_back(user.uid()); });
+
+  provider_->Prefetch();
+  fake_->ChangeUser("bob");
+  fake_->CompleteRequest(0, "stale");
+
+  GetToken();
+  EXPECT_EQ(fake_->requests.size(), 2u);
+  EXPECT_EQ(users, (std::vector<std::string>{"", "bob"}));
+
+  provider_->SetCredentialChangeListener(nullptr);
+}
+
+}  // namespace auth
+}  // namespace firestore
+}  // namespace firebase
@@ -53,6 +53,11 @@ class BundleLoaderTest : public ::testing::Test {
     explicit TestBundleCallback(BundleLoaderTest& parant) : parent_(parant) {
     }
 
+    void StartBundledDocuments(const std::string& bundle_id) override {
+      (void)bundle_id;
+      ++parent_.started_count_;
+    }
+
     model::MaybeDocumentMap ApplyBundledDocuments(
         const model::MaybeDocumentMap& documents,
         const std::string& bundle_id) override {
@@ -60,9 +65,16 @@ class BundleLoaderTest : public ::testing::Test {
       for (const auto& entry : documents) {
         parent_.last_documents_ = parent_.last_documents_.insert(entry.first);
       }
+      ++parent_.applied_chunk_count_;
       return MaybeDocumentMap{};
     }
 
+    void RetainBundledDocuments(const model::DocumentKeySet& keys,
+                                const std::string& bundle_id) override {
+      (void)bundle_id;
+      parent_.retained_documents_ = keys;
+    }
+
     void SaveNamedQuery(const NamedQuery& query,
                         const model::DocumentKeySet& keys) override {
       parent_.last_queries_.insert({query.query_name(), keys});
@@ -102,8 +114,11 @@ class BundleLoaderTest : public ::testing::Test {
  protected:
   std::unique_ptr<BundleCallback> callback_ = nullptr;
   DocumentKeySet last_documents_;
+  DocumentKeySet retained_documents_;
   std::unordered_map<std::string, DocumentKeySet> last_queries_;
   std::unordered_map<std::string, BundleMetadata> last_bundles_;
+  int started_count_ = 0;
+  int applied_chunk_count_ = 0;
   model::SnapshotVersion create_time_ =
       model::SnapshotVersion(Timestamp::Now());
 };
@@ -175,6 +190,60 @@ TEST_F(BundleLoaderTest, AppliesDocumentChanges) {
   EXPECT_EQ(last_bundles_["bundle-1"], CreateMetadata(1));
 }
 
+TEST_F(BundleLoaderTest, RetainsSkippedDocuments) {
+  BundleLoader loader(callback_.get(), CreateMetadata(2));
+
+  EXPECT_OK(loader.AddElement(
+      absl::make_unique<BundledDocumentMetadata>(
+          testutil::Key("coll/doc1"), create_time_,
+          /*exists=*/true, /*queries=*/std::vector<std::string>{}),
+      1));
+  EXPECT_OK(loader.AddElement(
+      absl::make_unique<BundleDocument>(testutil::Doc("coll/doc1", 1)), 9));
+  EXPECT_OK(loader.AddElement(
+      absl::make_unique<BundledDocumentMetadata>(
+          testutil::Key("coll/doc2"), create_time_,
+          /*exists=*/true, /*queries=*/std::vector<std::string>{}),
+      1));
+  auto result = loader.AddElement(
+      absl::make_unique<BundleDocument>(testutil::Doc("coll/doc2", 1),
+                                        /*fields_skipped=*/true),
+      9);
+  EXPECT_OK(result);
+  AssertProgress(result.ValueOrDie(), /*documents_loaded=*/2,
+                 /*total_documents=*/2, /*bytes_loaded=*/20,
+                 /*total_bytes=*/10, LoadBundleTaskState::kInProgress);
+  EXPECT_OK(loader.ApplyChanges());
+
+  EXPECT_EQ(last_documents_, DocumentKeySet{testutil::Key("coll/doc1")});
+  EXPECT_EQ(retained_documents_, DocumentKeySet{testutil::Key("coll/doc2")});
+}
+
+TEST_F(BundleLoaderTest, AppliesDocumentsInChunks) {
+  BundleLoader loader(callback_.get(), CreateMetadata(5));
+  loader.SetChunkLimits(/*max_documents=*/3, /*max_bytes=*/100);
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_OK(loader.AddElement(
+        absl::make_unique<BundledDocumentMetadata>(
+            testutil::Key("coll/doc" + std::to_string(i)), create_time_,
+            /*exists=*/false, /*queries=*/std::vector<std::string>{}),
+        /*byte_size=*/1));
+  }
+  // A document over the byte limit is applied in a chunk of its own.
+  EXPECT_OK(loader.AddElement(
+      absl::make_unique<BundledDocumentMetadata>(
+          testutil::Key("coll/doc4"), create_time_,
+          /*exists=*/false, /*queries=*/std::vector<std::string>{}),
+      /*byte_size=*/200));
+  EXPECT_OK(loader.ApplyChanges());
+
+  EXPECT_EQ(started_count_, 1);
+  // {doc0, doc1, doc2}, {doc3}, {doc4}.
+  EXPECT_EQ(applied_chunk_count_, 3);
+  EXPECT_EQ(last_documents_.size(), 5u);
+}
+
 TEST_F(BundleLoaderTest, AppliesNamedQueries) {
   BundleLoader loader(callback_.get(), CreateMetadata(2));
 
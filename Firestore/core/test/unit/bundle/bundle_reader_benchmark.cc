@@ -0,0 +1,204 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/resource.h>
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/bundle/bundle_element.h"
+#include "Firestore/core/src/bundle/bundle_reader.h"
+#include "Firestore/core/src/bundle/bundle_serializer.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/remote/serializer.h"
+#include "Firestore/core/src/util/byte_stream_cpp.h"
+#include "Firestore/third_party/nlohmann_json/json.hpp"
+#include "absl/memory/memory.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace bundle {
+namespace {
+
+using model::DatabaseId;
+using nlohmann::json;
+using util::ByteStreamCpp;
+
+BundleSerializer Serializer() {
+  return BundleSerializer(remote::Serializer(DatabaseId("p", "default")));
+}
+
+/**
+ * Creates a document element with `field_count` fields of mixed types, shaped
+ * like the output of the bundle builders.
+ */
+std::string DocumentElement(int64_t i, int64_t field_count) {
+  std::string name =
+      "\"projects/p/databases/default/documents/coll/doc" + std::to_string(i) +
+      "\"";
+  std::string fields;
+  for (int64_t f = 0; f < field_count; ++f) {
+    if (!fields.empty()) fields += ",";
+    std::string field = "\"field" + std::to_string(f) + "\":";
+    switch (f % 4) {
+      case 0:
+        field += "{\"integerValue\":\"" + std::to_string(i * f) + "\"}";
+        break;
+      case 1:
+        field += "{\"stringValue\":\"a moderately long string value " +
+                 std::to_string(i) + "\"}";
+        break;
+      case 2:
+        field += "{\"mapValue\":{\"fields\":{\"nested\":{\"doubleValue\":" +
+                 std::to_string(f) + ".5}}}}";
+        break;
+      default:
+        field +=
+            "{\"arrayValue\":{\"values\":[{\"booleanValue\":true},"
+            "{\"timestampValue\":\"2021-01-01T00:00:00.123456Z\"}]}}";
+        break;
+    }
+    fields += field;
+  }
+
+  return "{\"document\":{\"name\":" + name + ",\"fields\":{" + fields +
+         "},\"createTime\":\"2021-01-01T00:00:00Z\","
+         "\"updateTime\":\"2021-01-01T00:00:00Z\"}}";
+}
+
+std::vector<std::string> DocumentElements(int64_t count, int64_t field_count) {
+  std::vector<std::string> elements;
+  for (int64_t i = 0; i < count; ++i) {
+    elements.push_back(DocumentElement(i, field_count));
+  }
+  return elements;
+}
+
+std::string Bundle(const std::vector<std::string>& elements) {
+  std::string body;
+  for (const std::string& element : elements) {
+    body += std::to_string(element.size()) + element;
+  }
+  std::string metadata =
+      "{\"metadata\":{\"id\":\"bundle\",\"createTime\":"
+      "\"2021-01-01T00:00:00Z\",\"version\":1,\"totalDocuments\":" +
+      std::to_string(elements.size()) +
+      ",\"totalBytes\":" + std::to_string(body.size()) + "}}";
+  return std::to_string(metadata.size()) + metadata + body;
+}
+
+/**
+ * Reports the peak resident set size of the process so far. This is a high
+ * watermark, so run each benchmark on its own (with `--benchmark_filter`) to
+ * compare them.
+ */
+void ReportPeakRss(benchmark::State& state) {
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  double peak_bytes = static_cast<double>(usage.ru_maxrss);
+#else
+  double peak_bytes = static_cast<double>(usage.ru_maxrss) * 1024;
+#endif
+  state.counters["peak_rss_mb"] = peak_bytes / (1024 * 1024);
+}
+
+/** Reads a whole bundle of `count` documents through BundleReader. */
+void BM_BundleReaderLoadDocuments(benchmark::State& state) {
+  int64_t count = state.range(0);
+  int64_t field_count = state.range(1);
+  std::string bundle = Bundle(DocumentElements(count, field_count));
+
+  for (auto _ : state) {
+    BundleReader reader(
+        Serializer(), absl::make_unique<ByteStreamCpp>(
+                          absl::make_unique<std::stringstream>(bundle)));
+    int64_t documents = 0;
+    while (std::unique_ptr<BundleElement> element = reader.GetNextElement()) {
+      if (element->element_type() == BundleElement::Type::Document) {
+        ++documents;
+      }
+    }
+    if (!reader.reader_status().ok() || documents != count) {
+      state.SkipWithError("Failed to read bundle");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(bundle.size()));
+  ReportPeakRss(state);
+}
+BENCHMARK(BM_BundleReaderLoadDocuments)
+    ->Args({10000, 10})
+    ->Args({1000, 200})
+    ->Unit(benchmark::kMillisecond);
+
+/** Decodes document elements without building JSON trees. */
+void BM_DecodeDocumentElementStreaming(benchmark::State& state) {
+  std::vector<std::string> elements =
+      DocumentElements(state.range(0), state.range(1));
+  BundleSerializer serializer = Serializer();
+
+  for (auto _ : state) {
+    JsonReader reader;
+    for (const std::string& element : elements) {
+      benchmark::DoNotOptimize(
+          serializer.DecodeDocumentElement(reader, element));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  ReportPeakRss(state);
+}
+BENCHMARK(BM_DecodeDocumentElementStreaming)
+    ->Args({10000, 10})
+    ->Args({1000, 200})
+    ->Unit(benchmark::kMillisecond);
+
+/** Decodes document elements by parsing them into JSON trees first. */
+void BM_DecodeDocumentElementJsonTree(benchmark::State& state) {
+  std::vector<std::string> elements =
+      DocumentElements(state.range(0), state.range(1));
+  BundleSerializer serializer = Serializer();
+
+  for (auto _ : state) {
+    JsonReader reader;
+    for (const std::string& element : elements) {
+      json parsed = json::parse(element, /*callback=*/nullptr,
+                                /*allow_exception=*/false);
+      benchmark::DoNotOptimize(
+          serializer.DecodeDocument(reader, parsed.at("document")));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  ReportPeakRss(state);
+}
+BENCHMARK(BM_DecodeDocumentElementJsonTree)
+    ->Args({10000, 10})
+    ->Args({1000, 200})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace bundle
+}  // namespace firestore
+}  // namespace firebase
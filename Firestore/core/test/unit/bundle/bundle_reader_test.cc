@@ -78,6 +78,7 @@ class BundleReaderTest : public ::testing::Test {
     *element.mutable_named_query() = data;
     MessageToJsonString(element, &json);
     elements_.push_back(json);
+    binary_elements_.push_back(element.SerializeAsString());
     return json;
   }
 
@@ -87,6 +88,7 @@ class BundleReaderTest : public ::testing::Test {
     *element.mutable_document_metadata() = data;
     MessageToJsonString(element, &json);
     elements_.push_back(json);
+    binary_elements_.push_back(element.SerializeAsString());
     return json;
   }
 
@@ -96,6 +98,7 @@ class BundleReaderTest : public ::testing::Test {
     *element.mutable_document() = data;
     MessageToJsonString(element, &json);
     elements_.push_back(json);
+    binary_elements_.push_back(element.SerializeAsString());
     return json;
   }
 
@@ -127,6 +130,42 @@ class BundleReaderTest : public ::testing::Test {
     return std::to_string(metadata_str.size()) + metadata_str + bundle;
   }
 
+  /** Builds a binary bundle out of the same elements as `BuildBundle`. */
+  std::string BuildBinaryBundle(const std::string& bundle_id,
+                                model::SnapshotVersion create_time,
+                                int32_t documents) {
+    std::string bundle;
+    for (const auto& element : binary_elements_) {
+      bundle.append(Varint(element.size()));
+      bundle.append(element);
+    }
+
+    ProtoBundleElement element;
+    ProtoBundleMetadata* metadata = element.mutable_metadata();
+    metadata->set_id(bundle_id);
+    metadata->set_version(1);
+    metadata->set_total_documents(documents);
+    metadata->mutable_create_time()->set_nanos(
+        create_time.timestamp().nanoseconds());
+    metadata->mutable_create_time()->set_seconds(
+        create_time.timestamp().seconds());
+    metadata->set_total_bytes(bundle.size());
+    std::string metadata_str = element.SerializeAsString();
+
+    return std::string(kBinaryBundleMagic) + Varint(metadata_str.size()) +
+           metadata_str + bundle;
+  }
+
+  static std::string Varint(uint64_t value) {
+    std::string result;
+    while (value >= 0x80) {
+      result.push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    result.push_back(static_cast<char>(value));
+    return result;
+  }
+
   std::unique_ptr<util::ByteStream> ToByteStream(const std::string& bundle) {
     auto bundle_istream = absl::make_unique<std::stringstream>(bundle);
     return absl::make_unique<ByteStreamCpp>(
@@ -324,6 +363,7 @@ class BundleReaderTest : public ::testing::Test {
 
  private:
   std::vector<std::string> elements_;
+  std::vector<std::string> binary_elements_;
 };
 
 TEST_F(BundleReaderTest, ReadsQueryAndDocument) {
@@ -357,6 +397,128 @@ TEST_F(BundleReaderTest, ReadsQueryAndDocument) {
       *static_cast<BundleDocument*>(elements[3].get()), Document1());
 }
 
+TEST_F(BundleReaderTest, ReadsElementJsonForSeparateDecoding) {
+  AddNamedQuery(LimitQuery());
+  AddDocumentMetadata(DocumentMetadata1());
+  AddDocument(Document1());
+
+  const auto& bundle =
+      BuildBundle("bundle-1", testutil::Version(6000004000), 1);
+  BundleReader reader(bundle_serializer, ToByteStream(bundle));
+
+  std::vector<std::string> json;
+  while (absl::optional<std::string> element =
+             reader.GetNextEncodedElement()) {
+    json.push_back(std::move(*element));
+  }
+  EXPECT_OK(reader.reader_status());
+  EXPECT_EQ(reader.GetBundleMetadata().bundle_id(), "bundle-1");
+  EXPECT_EQ(reader.bytes_read(), reader.GetBundleMetadata().total_bytes());
+  ASSERT_EQ(json.size(), 3);
+
+  // Decode out of order, as parallel decoding may.
+  JsonReader context;
+  auto document = BundleReader::DecodeElement(
+      bundle_serializer, BundleFormat::kJson, context, json[2]);
+  auto query = BundleReader::DecodeElement(
+      bundle_serializer, BundleFormat::kJson, context, json[0]);
+  auto metadata = BundleReader::DecodeElement(
+      bundle_serializer, BundleFormat::kJson, context, json[1]);
+  EXPECT_OK(context.status());
+
+  VerifyNamedQueryEncodesToOriginal(*static_cast<NamedQuery*>(query.get()),
+                                    LimitQuery());
+  VerifyDocumentMetadataEquals(
+      *static_cast<BundledDocumentMetadata*>(metadata.get()),
+      DocumentMetadata1());
+  VerifyDocumentEncodesToOriginal(*static_cast<BundleDocument*>(document.get()),
+                                  Document1());
+
+  BundleReader::DecodeElement(bundle_serializer, BundleFormat::kJson, context,
+                              "{\"unknown\": {}}");
+  EXPECT_NOT_OK(context.status());
+}
+
+TEST_F(BundleReaderTest, ReadsBinaryBundle) {
+  AddNamedQuery(LimitQuery());
+  AddNamedQuery(LimitToLastQuery());
+  AddDocumentMetadata(DocumentMetadata1());
+  AddDocument(Document1());
+  AddDocumentMetadata(DeletedDocumentMetadata());
+
+  const auto& bundle =
+      BuildBinaryBundle("bundle-1", testutil::Version(6000004000), 1);
+  BundleReader reader(bundle_serializer, ToByteStream(bundle));
+
+  std::vector<std::unique_ptr<BundleElement>> elements =
+      VerifyFullBundleParsed(reader, "bundle-1", testutil::Version(6000004000));
+  EXPECT_EQ(reader.format(), BundleFormat::kBinary);
+
+  ASSERT_EQ(elements.size(), 5);
+  VerifyNamedQueryEncodesToOriginal(
+      *static_cast<NamedQuery*>(elements[0].get()), LimitQuery());
+  VerifyNamedQueryEncodesToOriginal(
+      *static_cast<NamedQuery*>(elements[1].get()), LimitToLastQuery());
+  VerifyDocumentMetadataEquals(
+      *static_cast<BundledDocumentMetadata*>(elements[2].get()),
+      DocumentMetadata1());
+  VerifyDocumentEncodesToOriginal(
+      *static_cast<BundleDocument*>(elements[3].get()), Document1());
+  VerifyDocumentMetadataEquals(
+      *static_cast<BundledDocumentMetadata*>(elements[4].get()),
+      DeletedDocumentMetadata());
+}
+
+TEST_F(BundleReaderTest, ReadsBinaryElementsForSeparateDecoding) {
+  AddDocumentMetadata(DocumentMetadata1());
+  AddDocument(Document1());
+
+  const auto& bundle =
+      BuildBinaryBundle("bundle-1", testutil::Version(6000004000), 1);
+  BundleReader reader(bundle_serializer, ToByteStream(bundle));
+
+  std::vector<std::string> encoded;
+  while (absl::optional<std::string> element =
+             reader.GetNextEncodedElement()) {
+    encoded.push_back(std::move(*element));
+  }
+  EXPECT_OK(reader.reader_status());
+  EXPECT_EQ(reader.bytes_read(), reader.GetBundleMetadata().total_bytes());
+  ASSERT_EQ(encoded.size(), 2);
+
+  JsonReader context;
+  auto document = BundleReader::DecodeElement(
+      bundle_serializer, BundleFormat::kBinary, context, encoded[1]);
+  EXPECT_OK(context.status());
+  VerifyDocumentEncodesToOriginal(*static_cast<BundleDocument*>(document.get()),
+                                  Document1());
+
+  BundleReader::DecodeElement(bundle_serializer, BundleFormat::kBinary,
+                              context, "\xff\xff");
+  EXPECT_NOT_OK(context.status());
+}
+
+TEST_F(BundleReaderTest, FailsWithBadBinaryMagic) {
+  std::string bundle =
+      BuildBinaryBundle("bundle-1", testutil::Version(6000004000), 0);
+  bundle[1] = 'X';
+  BundleReader reader(bundle_serializer, ToByteStream(bundle));
+  reader.GetBundleMetadata();
+  EXPECT_NOT_OK(reader.reader_status());
+}
+
+TEST_F(BundleReaderTest, FailsWithTruncatedBinaryElement) {
+  AddDocument(Document1());
+  std::string bundle =
+      BuildBinaryBundle("bundle-1", testutil::Version(6000004000), 1);
+  bundle.resize(bundle.size() - 1);
+  BundleReader reader(bundle_serializer, ToByteStream(bundle));
+
+  while (reader.GetNextElement()) {
+  }
+  EXPECT_NOT_OK(reader.reader_status());
+}
+
 TEST_F(BundleReaderTest, ReadsQueryAndDocumentWithUnexpectedOrder) {
   AddDocumentMetadata(DocumentMetadata1());
   AddDocument(Document1());
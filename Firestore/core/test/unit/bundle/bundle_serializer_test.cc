@@ -133,11 +133,27 @@ class BundleSerializerTest : public ::testing::Test {
     VerifyJsonStringDecodeFails(std::move(json_string));
   }
 
+  static std::string DocumentElement(const std::string& document_json) {
+    return "{\"document\":" + document_json + "}";
+  }
+
+  // Decodes the document both from a JSON tree and with the streaming decoder,
+  // and checks that the results agree.
   BundleDocument VerifyJsonStringDecodes(std::string json_string) {
     JsonReader reader;
     BundleDocument actual =
         bundle_serializer.DecodeDocument(reader, Parse(json_string));
     EXPECT_OK(reader.status());
+
+    JsonReader streaming_reader;
+    absl::optional<BundleDocument> streamed =
+        bundle_serializer.DecodeDocumentElement(streaming_reader,
+                                                DocumentElement(json_string));
+    EXPECT_OK(streaming_reader.status());
+    EXPECT_TRUE(streamed.has_value());
+    if (streamed) {
+      EXPECT_EQ(streamed->document(), actual.document());
+    }
     return actual;
   }
 
@@ -146,6 +162,11 @@ class BundleSerializerTest : public ::testing::Test {
     BundleDocument actual =
         bundle_serializer.DecodeDocument(reader, Parse(json_string));
     EXPECT_NOT_OK(reader.status());
+
+    JsonReader streaming_reader;
+    bundle_serializer.DecodeDocumentElement(streaming_reader,
+                                            DocumentElement(json_string));
+    EXPECT_NOT_OK(streaming_reader.status());
   }
 
   // 1. Take a `Query` object, put it in a `NamedQuery` and encode it to byte
@@ -385,10 +406,7 @@ TEST_F(BundleSerializerTest, DecodesIntegerValues) {
   // Protobuf.js encodes this way with 32-bit integers.
   auto json_copy = ReplacedCopy(json_string, "\"999888\"", "999888");
 
-  JsonReader reader;
-  BundleDocument actual =
-      bundle_serializer.DecodeDocument(reader, Parse(json_copy));
-  EXPECT_OK(reader.status());
+  BundleDocument actual = VerifyJsonStringDecodes(json_copy);
 
   VerifyDecodedDocumentEncodesToOriginal(actual.document(), document);
 }
@@ -449,10 +467,7 @@ TEST_F(BundleSerializerTest, DecodesNanDoubleValues) {
   std::string json_string;
   MessageToJsonString(document, &json_string);
 
-  JsonReader reader;
-  BundleDocument actual =
-      bundle_serializer.DecodeDocument(reader, Parse(json_string));
-  EXPECT_OK(reader.status());
+  BundleDocument actual = VerifyJsonStringDecodes(json_string);
   auto actual_value = actual.document().data().Get(
       model::FieldPath::FromDotSeparatedString("foo"));
   EXPECT_TRUE(actual_value->is_nan());
@@ -520,10 +535,7 @@ TEST_F(BundleSerializerTest, DecodesTimestampsEncodedAsObjects) {
         "\", \"nanos\": " + std::to_string(test_pair.first.nanos()) + "}";
     auto json_copy = ReplacedCopy(json_string, test_pair.second, replacement);
 
-    JsonReader reader;
-    BundleDocument actual =
-        bundle_serializer.DecodeDocument(reader, Parse(json_copy));
-    EXPECT_OK(reader.status());
+    BundleDocument actual = VerifyJsonStringDecodes(json_copy);
 
     VerifyDecodedDocumentEncodesToOriginal(actual.document(), document);
   }
@@ -621,6 +633,55 @@ TEST_F(BundleSerializerTest, DecodeInvalidReferenceFails) {
   VerifyJsonStringDecodeFails(json_string);
 }
 
+TEST_F(BundleSerializerTest, DecodeDocumentElementSkipsOtherElements) {
+  for (const char* element : {
+           R"({"metadata": {"id": "bundle", "version": 1}})",
+           R"({"documentMetadata": {"name": "doc", "exists": false}})",
+           R"({"document": "not an object"})",
+       }) {
+    JsonReader reader;
+    EXPECT_EQ(bundle_serializer.DecodeDocumentElement(reader, element),
+              absl::nullopt);
+    EXPECT_OK(reader.status());
+  }
+}
+
+TEST_F(BundleSerializerTest, DecodeDocumentElementIgnoresUnknownFields) {
+  ProtoValue value;
+  value.set_string_value("foo");
+  ProtoDocument document = TestDocument(value);
+
+  std::string json_string;
+  MessageToJsonString(document, &json_string);
+  auto json_copy = ReplacedCopy(
+      json_string, "\"fields\"",
+      R"("unknown": {"a": [1, {"b": {}}]}, "fields")");
+
+  BundleDocument actual = VerifyJsonStringDecodes(json_copy);
+  VerifyDecodedDocumentEncodesToOriginal(actual.document(), document);
+}
+
+TEST_F(BundleSerializerTest, DecodeDocumentElementHeaderSkipsFields) {
+  ProtoValue value;
+  value.set_string_value("foo");
+  ProtoDocument document = TestDocument(value);
+
+  std::string json_string;
+  MessageToJsonString(document, &json_string);
+  BundleDocument full = VerifyJsonStringDecodes(json_string);
+
+  JsonReader reader;
+  absl::optional<BundleDocument> header =
+      bundle_serializer.DecodeDocumentElementHeader(
+          reader, DocumentElement(json_string));
+  EXPECT_OK(reader.status());
+  ASSERT_TRUE(header.has_value());
+  EXPECT_TRUE(header->fields_skipped());
+  EXPECT_EQ(header->key(), full.key());
+  EXPECT_EQ(header->document().version(), full.document().version());
+  EXPECT_EQ(header->document().data(), model::ObjectValue{});
+}
+
 TEST_F(BundleSerializerTest, DecodesArrayValues) {
   ProtoValue elem1;
   elem1.set_string_value("testing");
@@ -16,12 +16,14 @@
 
 #include "Firestore/core/src/core/event_manager.h"
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <memory>
 #include <utility>
 #include <vector>
 
 #include "Firestore/core/src/core/query_listener.h"
 #include "Firestore/core/src/core/sync_engine.h"
+#include "Firestore/core/src/core/synced_query_tracker.h"
 #include "Firestore/core/src/core/view_snapshot.h"
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/document_set.h"
@@ -174,6 +176,56 @@ TEST(EventManagerTest, WillForwardOnlineStateChanges) {
               ElementsAre(OnlineState::Unknown, OnlineState::Online));
 }
 
+TEST(EventManagerTest, OnlyForwardsOnlineStateUntilTheInitialEvent) {
+  core::Query query = Query("foo/bar");
+
+  class FakeQueryListener : public QueryListener {
+   public:
+    explicit FakeQueryListener(core::Query query)
+        : QueryListener(std::move(query),
+                        ListenOptions::DefaultOptions(),
+                        NoopViewSnapshotHandler()) {
+    }
+
+    bool OnOnlineStateChanged(OnlineState online_state) override {
+      events.push_back(online_state);
+      return QueryListener::OnOnlineStateChanged(online_state);
+    }
+
+    std::vector<OnlineState> events;
+  };
+
+  auto fake_listener = std::make_shared<FakeQueryListener>(query);
+
+  MockEventSource mock_event_source;
+  EventManager event_manager(&mock_event_source);
+
+  event_manager.AddQueryListener(fake_listener);
+  // The snapshot isn't from cache, so it raises the initial event.
+  event_manager.OnViewSnapshots({make_empty_view_snapshot(query)});
+  ASSERT_TRUE(fake_listener->raised_initial_event());
+
+  event_manager.HandleOnlineStateChange(OnlineState::Offline);
+  ASSERT_THAT(fake_listener->events, ElementsAre(OnlineState::Unknown));
+}
+
+TEST(EventManagerTest, RecordsQueriesRemovedWhileSynced) {
+  core::Query query = Query("foo/bar");
+  auto listener = NoopQueryListener(query);
+  SyncedQueryTracker tracker(std::chrono::minutes(1));
+
+  MockEventSource mock_event_source;
+  EventManager event_manager(&mock_event_source);
+  event_manager.set_synced_query_tracker(&tracker);
+
+  event_manager.AddQueryListener(listener);
+  event_manager.OnViewSnapshots({make_empty_view_snapshot(query)});
+  EXPECT_FALSE(tracker.IsFresh(query));
+
+  event_manager.RemoveQueryListener(listener);
+  EXPECT_TRUE(tracker.IsFresh(query));
+}
+
 }  // namespace
 }  // namespace core
 }  // namespace firestore
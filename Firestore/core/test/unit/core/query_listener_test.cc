@@ -16,6 +16,7 @@
 
 #include "Firestore/core/src/core/query_listener.h"
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <future>  // NOLINT(build/c++11)
 #include <memory>
 #include <utility>
@@ -27,8 +28,10 @@
 #include "Firestore/core/src/core/view.h"
 #include "Firestore/core/src/core/view_snapshot.h"
 #include "Firestore/core/src/model/document_set.h"
+#include "Firestore/core/src/model/no_document.h"
 #include "Firestore/core/src/model/types.h"
 #include "Firestore/core/src/remote/remote_event.h"
+#include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/delayed_constructor.h"
 #include "Firestore/core/src/util/executor.h"
 #include "Firestore/core/src/util/status.h"
@@ -515,6 +518,53 @@ TEST_F(QueryListenerTest,
   ASSERT_THAT(events, ElementsAre(expected_snap));
 }
 
+TEST_F(QueryListenerTest, CoalescesSnapshotsAfterInitialEvent) {
+  std::shared_ptr<util::AsyncQueue> queue = testutil::AsyncQueueForTesting();
+  std::vector<ViewSnapshot> accum;
+
+  Query query = testutil::Query("rooms");
+  Document doc1 = Doc("rooms/Eros", 1, Map("name", "Eros"));
+  Document doc2 = Doc("rooms/Hades", 2, Map("name", "Hades"));
+  Document doc2prime =
+      Doc("rooms/Hades", 3, Map("name", "Hades", "owner", "Jonny"));
+  Document doc3 = Doc("rooms/Other", 4, Map("name", "Other"));
+
+  ListenOptions options =
+      ListenOptions::DefaultOptions().WithSnapshotCoalescingWindow(
+          std::chrono::milliseconds(1000));
+  auto listener =
+      QueryListener::Create(query, options, Accumulating(&accum), queue);
+
+  View view(query, DocumentKeySet{});
+  ViewSnapshot snap1 = ApplyChanges(&view, {doc1}, absl::nullopt).value();
+  ViewSnapshot snap2 = ApplyChanges(&view, {doc2}, absl::nullopt).value();
+  ViewSnapshot snap3 = ApplyChanges(&view, {doc2prime}, absl::nullopt).value();
+  ViewSnapshot snap4 = ApplyChanges(&view, {doc3}, absl::nullopt).value();
+  ViewSnapshot snap5 =
+      ApplyChanges(&view, {testutil::DeletedDoc("rooms/Other", 5)},
+                   absl::nullopt)
+          .value();
+
+  queue->EnqueueBlocking([&] {
+    listener->OnViewSnapshot(snap1);  // initial event, raised immediately
+    listener->OnViewSnapshot(snap2);
+    listener->OnViewSnapshot(snap3);
+    listener->OnViewSnapshot(snap4);
+    listener->OnViewSnapshot(snap5);
+  });
+  ASSERT_THAT(accum, ElementsAre(ExcludingMetadataChanges(snap1)));
+
+  queue->RunScheduledOperationsUntil(util::TimerId::SnapshotCoalescing);
+
+  ASSERT_EQ(accum.size(), 2u);
+  const ViewSnapshot& merged = accum[1];
+  EXPECT_EQ(merged.old_documents(), snap2.old_documents());
+  EXPECT_EQ(merged.documents(), snap5.documents());
+  EXPECT_THAT(merged.document_changes(),
+              ElementsAre(DocumentViewChange{
+                  doc2prime, DocumentViewChange::Type::Added}));
+}
+
 }  // namespace core
 }  // namespace firestore
 }  // namespace firebase
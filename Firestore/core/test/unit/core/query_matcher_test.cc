@@ -0,0 +1,110 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/core/query_matcher.h"
+
+#include <cmath>
+#include <vector>
+
+#include "Firestore/core/src/core/bound.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+
+using model::Document;
+using testutil::Array;
+using testutil::CollectionGroupQuery;
+using testutil::Doc;
+using testutil::Filter;
+using testutil::Map;
+using testutil::OrderBy;
+using testutil::Ref;
+using testutil::Value;
+
+namespace {
+
+std::vector<Document> TestDocuments() {
+  return {
+      Doc("coll/a", 0, Map("a", 1, "b", Map("c", 2))),
+      Doc("coll/b", 0, Map("a", 2, "b", Map("c", 3), "tags", Array("x", "y"))),
+      Doc("coll/c", 0, Map("a", 3, "b", Map("c", "str"))),
+      Doc("coll/d", 0, Map("a", nullptr, "b", Map("c", NAN))),
+      Doc("coll/e", 0, Map("b", 1, "tags", Array("z"))),
+      Doc("coll/e/sub/f", 0, Map("a", 1, "b", Map("c", 2))),
+      Doc("other/g", 0, Map("a", 1, "b", Map("c", 2))),
+  };
+}
+
+/** Expects QueryMatcher to agree with Query::Matches on all test documents. */
+void ExpectSameMatches(const Query& query) {
+  QueryMatcher matcher(query);
+  for (const Document& doc : TestDocuments()) {
+    EXPECT_EQ(matcher.Matches(doc), query.Matches(doc))
+        << query.ToString() << " on " << doc.ToString();
+  }
+}
+
+}  // namespace
+
+TEST(QueryMatcherTest, MatchesLikeQuery) {
+  ExpectSameMatches(testutil::Query("coll"));
+  ExpectSameMatches(testutil::Query("coll/a"));
+  ExpectSameMatches(testutil::Query("coll/e/sub"));
+  ExpectSameMatches(CollectionGroupQuery("sub"));
+
+  ExpectSameMatches(testutil::Query("coll").AddingFilter(Filter("a", ">", 1)));
+  ExpectSameMatches(
+      testutil::Query("coll").AddingFilter(Filter("a", "!=", nullptr)));
+  ExpectSameMatches(
+      testutil::Query("coll").AddingFilter(Filter("b.c", "in", Array(2, NAN))));
+  ExpectSameMatches(testutil::Query("coll").AddingFilter(
+      Filter("tags", "array-contains-any", Array("y", "z"))));
+  ExpectSameMatches(testutil::Query("coll").AddingFilter(
+      Filter("__name__", "==", Ref("project", "coll/b"))));
+
+  ExpectSameMatches(testutil::Query("coll").AddingOrderBy(OrderBy("a")));
+  ExpectSameMatches(testutil::Query("coll").AddingOrderBy(OrderBy("b.c")));
+}
+
+TEST(QueryMatcherTest, SharesFieldsAcrossFiltersAndOrderBys) {
+  Query query = testutil::Query("coll")
+                    .AddingFilter(Filter("b.c", ">=", 2))
+                    .AddingFilter(Filter("b.c", "<", 3))
+                    .AddingOrderBy(OrderBy("b.c"))
+                    .AddingFilter(Filter("a", "in", Array(1, 2)));
+  ExpectSameMatches(query);
+
+  QueryMatcher matcher(query);
+  EXPECT_TRUE(matcher.Matches(TestDocuments()[0]));
+  EXPECT_FALSE(matcher.Matches(TestDocuments()[1]));
+}
+
+TEST(QueryMatcherTest, MatchesBounds) {
+  Query query = testutil::Query("coll").AddingOrderBy(OrderBy("a"));
+  ExpectSameMatches(query.StartingAt(Bound({Value(2)}, /* is_before= */ true)));
+  ExpectSameMatches(query.EndingAt(Bound({Value(2)}, /* is_before= */ false)));
+  ExpectSameMatches(query.StartingAt(Bound({Value(1)}, /* is_before= */ false))
+                        .EndingAt(Bound({Value(3)}, /* is_before= */ true)));
+}
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
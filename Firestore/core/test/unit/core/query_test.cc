@@ -17,11 +17,15 @@
 #include "Firestore/core/src/core/query.h"
 
 #include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 #include "Firestore/core/src/core/bound.h"
 #include "Firestore/core/src/core/field_filter.h"
 #include "Firestore/core/src/model/document.h"
 #include "Firestore/core/src/model/document_set.h"
+#include "Firestore/core/src/model/field_mask.h"
 #include "Firestore/core/src/model/field_path.h"
 #include "Firestore/core/src/model/field_value.h"
 #include "Firestore/core/src/model/resource_path.h"
@@ -36,6 +40,7 @@ namespace core {
 using firebase::firestore::util::ComparisonResult;
 using model::Document;
 using model::DocumentComparator;
+using model::FieldMask;
 using model::FieldPath;
 using model::FieldValue;
 using model::ResourcePath;
@@ -280,6 +285,26 @@ TEST(QueryTest, InFiltersWithObjectValues) {
   EXPECT_THAT(query, Matches(doc));
 }
 
+TEST(QueryTest, InFiltersWithNumbers) {
+  auto query = testutil::Query("collection")
+                   .AddingFilter(Filter("n", "in", Array(1, 2.5, NAN)));
+
+  EXPECT_THAT(query, Matches(Doc("collection/1", 0, Map("n", 1))));
+  EXPECT_THAT(query, Matches(Doc("collection/1", 0, Map("n", 2.5))));
+  EXPECT_THAT(query, Matches(Doc("collection/1", 0, Map("n", NAN))));
+
+  // Membership uses FieldValue equality, under which integers and doubles are
+  // distinct.
+  EXPECT_THAT(query, Not(Matches(Doc("collection/1", 0, Map("n", 1.0)))));
+  EXPECT_THAT(query, Not(Matches(Doc("collection/1", 0, Map("n", 2)))));
+
+  query = testutil::Query("collection")
+              .AddingFilter(Filter("n", "array-contains-any", Array(1, NAN)));
+  EXPECT_THAT(query, Matches(Doc("collection/1", 0, Map("n", Array(3, NAN)))));
+  EXPECT_THAT(query,
+              Not(Matches(Doc("collection/1", 0, Map("n", Array(1.0))))));
+}
+
 TEST(QueryTest, NotInFilters) {
   auto query = testutil::Query("collection")
                    .AddingFilter(Filter("zip", "not-in", Array(12345)));
@@ -554,6 +579,47 @@ TEST(QueryTest, SortsDocumentsWithDescendingToo) {
   ASSERT_TRUE(CorrectComparisons(docs, query.Comparator()));
 }
 
+TEST(QueryTest, SortKeysOrderDocumentsLikeTheComparator) {
+  auto query = testutil::Query("collection")
+                   .AddingOrderBy(OrderBy("sort1", "desc"))
+                   .AddingOrderBy(OrderBy("sort2"));
+  DocumentComparator comp = query.Comparator();
+
+  // clang-format off
+  std::vector<Document> docs = {
+      Doc("collection/1", 0, Map("sort1", "b", "sort2", 1)),
+      Doc("collection/1", 0, Map("sort1", "ab", "sort2", 1)),
+      Doc("collection/1", 0, Map("sort1", "a", "sort2", 1)),
+      Doc("collection/1", 0, Map("sort1", "a", "sort2", Array(1))),
+      Doc("collection/1", 0, Map("sort1", "a", "sort2", Array(1, 2))),
+      Doc("collection/1", 0, Map("sort1", 2.5, "sort2", 1)),
+      Doc("collection/1", 0, Map("sort1", 2, "sort2", -1.5)),
+      Doc("collection/1", 0, Map("sort1", 2, "sort2", 1)),
+      Doc("collection/2", 0, Map("sort1", 2, "sort2", 1)),  // by key
+      Doc("collection/3", 0, Map("sort1", 2, "sort2", 1)),  // by key
+      Doc("collection/1", 0, Map("sort1", false, "sort2", 1)),
+      Doc("collection/1", 0, Map("sort1", nullptr, "sort2", 1)),
+  };
+  // clang-format on
+
+  for (size_t i = 0; i < docs.size(); i++) {
+    for (size_t j = 0; j < docs.size(); j++) {
+      std::string i_key = comp.SortKey(docs[i]);
+      std::string j_key = comp.SortKey(docs[j]);
+      ASSERT_FALSE(i_key.empty());
+      EXPECT_EQ(util::Compare(i_key, j_key), util::Compare(i, j))
+          << docs[i] << " to " << docs[j];
+    }
+  }
+
+  // Integers that doubles can't represent exactly have no sort key, so they
+  // are compared field by field.
+  Document large =
+      Doc("collection/1", 0, Map("sort1", int64_t{1} << 60, "sort2", 1));
+  EXPECT_EQ(comp.SortKey(large), "");
+  EXPECT_EQ(comp.SortKey(Doc("collection/1", 0, Map("sort2", 1))), "");
+}
+
 TEST(QueryTest, Equality) {
   auto q11 = testutil::Query("foo")
                  .AddingFilter(Filter("i1", "<", 2))
@@ -618,6 +684,22 @@ TEST(QueryTest, Equality) {
   ASSERT_NE(q61, q51);
 }
 
+TEST(QueryTest, ProjectionIsPartOfEqualityButNotOfTheTarget) {
+  auto query = testutil::Query("foo");
+  auto projected = query.WithProjection(FieldMask{Field("a")});
+
+  ASSERT_EQ(projected, testutil::Query("foo").WithProjection(
+                           FieldMask{Field("a")}));
+  ASSERT_NE(projected, query);
+  ASSERT_NE(projected, query.WithProjection(FieldMask{Field("b")}));
+  ASSERT_NE(projected.CanonicalId(), query.CanonicalId());
+  ASSERT_EQ(projected.ToTarget(), query.ToTarget());
+
+  // Builder methods keep the projection.
+  ASSERT_EQ(projected.WithLimitToFirst(1),
+            query.WithLimitToFirst(1).WithProjection(FieldMask{Field("a")}));
+}
+
 TEST(QueryTest, UniqueIds) {
   auto q11 = testutil::Query("foo")
                  .AddingFilter(Filter("i1", "<", 2))
@@ -783,6 +865,11 @@ TEST(QueryTest, CanonicalIDs) {
   auto limit = testutil::Query("coll").WithLimitToFirst(25);
   EXPECT_THAT(limit, HasCanonicalId("coll|f:|ob:__name__asc|l:25|lt:f"));
 
+  // Queries derived from a limited query don't reuse its canonical ID.
+  auto limit_to_last = limit.WithLimitToLast(25);
+  EXPECT_THAT(limit_to_last,
+              HasCanonicalId("coll|f:|ob:__name__desc|l:25|lt:l"));
+
   auto bounds =
       testutil::Query("airports")
           .AddingOrderBy(OrderBy("name", "asc"))
@@ -816,6 +903,67 @@ TEST(QueryTest, MatchesAllDocuments) {
   EXPECT_FALSE(query.MatchesAllDocuments());
 }
 
+TEST(QueryTest, MultiDocumentQueries) {
+  Query query = Query::ForDocuments(
+      DbId(), {testutil::Key("coll/b"), testutil::Key("coll/a")});
+  EXPECT_TRUE(query.ToTarget().IsMultiDocumentQuery());
+  EXPECT_EQ(query.ToTarget().GetDocumentKeys(),
+            (std::vector<model::DocumentKey>{testutil::Key("coll/b"),
+                                             testutil::Key("coll/a")}));
+  EXPECT_TRUE(query.Matches(Doc("coll/a", 0, Map())));
+  EXPECT_FALSE(query.Matches(Doc("coll/c", 0, Map())));
+
+  // A single document is listened to as a query.
+  EXPECT_FALSE(Query::ForDocuments(DbId(), {testutil::Key("coll/a")})
+                   .ToTarget()
+                   .IsMultiDocumentQuery());
+
+  // Any other constraint makes it a regular query.
+  EXPECT_FALSE(query.WithLimitToFirst(1).ToTarget().IsMultiDocumentQuery());
+  EXPECT_FALSE(query.AddingFilter(Filter("foo", "==", "bar"))
+                   .ToTarget()
+                   .IsMultiDocumentQuery());
+  EXPECT_FALSE(query.AddingOrderBy(OrderBy("__name__", "desc"))
+                   .ToTarget()
+                   .IsMultiDocumentQuery());
+
+  // As are documents outside of the queried collection.
+  EXPECT_FALSE(testutil::Query("coll")
+                   .AddingFilter(Filter("__name__", "in",
+                                        Array(Ref("project", "coll/a"),
+                                              Ref("project", "other/b"))))
+                   .ToTarget()
+                   .IsMultiDocumentQuery());
+}
+
+TEST(QueryTest, PartitionsCollectionQueries) {
+  Query query = testutil::Query("coll").AddingFilter(Filter("a", "==", 1));
+  EXPECT_TRUE(query.CanBePartitioned());
+  EXPECT_EQ(query.Partition(DbId(), 1), std::vector<Query>{query});
+
+  std::vector<Query> partitions = query.Partition(DbId(), 3);
+  ASSERT_EQ(partitions.size(), 3u);
+  EXPECT_EQ(partitions.front().start_at(), nullptr);
+  EXPECT_EQ(partitions.back().end_at(), nullptr);
+
+  // Every document matches exactly one partition, whatever its ID.
+  for (const char* id : {"0", "9zz", "Kx", "V", "a", "zzzz", "_id", "~"}) {
+    Document doc = Doc(std::string("coll/") + id, 0, Map("a", 1));
+    int matches = 0;
+    for (const Query& partition : partitions) {
+      if (partition.Matches(doc)) ++matches;
+    }
+    EXPECT_EQ(matches, 1) << id;
+  }
+
+  EXPECT_FALSE(testutil::Query("coll/doc").CanBePartitioned());
+  EXPECT_FALSE(CollectionGroupQuery("coll").CanBePartitioned());
+  EXPECT_FALSE(query.WithLimitToFirst(1).CanBePartitioned());
+  EXPECT_FALSE(query.AddingFilter(Filter("b", ">", 1)).CanBePartitioned());
+  EXPECT_FALSE(
+      query.AddingOrderBy(OrderBy("__name__", "desc")).CanBePartitioned());
+}
+
 }  // namespace core
 }  // namespace firestore
 }  // namespace firebase
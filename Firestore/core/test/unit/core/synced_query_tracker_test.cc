@@ -0,0 +1,54 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/core/synced_query_tracker.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+namespace {
+
+using testutil::Query;
+
+TEST(SyncedQueryTrackerTest, QueriesAreFreshOnceRecorded) {
+  SyncedQueryTracker tracker(std::chrono::minutes(1));
+  core::Query query = Query("coll");
+  EXPECT_FALSE(tracker.IsFresh(query));
+
+  tracker.RecordSynced(query);
+  EXPECT_TRUE(tracker.IsFresh(query));
+  EXPECT_TRUE(tracker.IsFresh(Query("coll")));
+  EXPECT_FALSE(tracker.IsFresh(Query("other")));
+}
+
+TEST(SyncedQueryTrackerTest, QueriesGoStale) {
+  SyncedQueryTracker tracker(std::chrono::seconds(0));
+  core::Query query = Query("coll");
+
+  tracker.RecordSynced(query);
+  EXPECT_FALSE(tracker.IsFresh(query));
+}
+
+}  // namespace
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
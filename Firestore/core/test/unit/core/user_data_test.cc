@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/core/user_data.h"
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+
+using model::FieldPath;
+
+TEST(UserDataTest, ChildContextsBuildTheirPaths) {
+  ParseAccumulator accumulator{UserDataSource::Set};
+  ParseContext root = accumulator.RootContext();
+  ParseContext child = root.ChildContext(std::string("a"));
+  ParseContext grandchild = child.ChildContext(std::string("b"));
+  ParseContext nested = grandchild.ChildContext(FieldPath{"c", "d"});
+
+  EXPECT_EQ(*root.path(), FieldPath::EmptyPath());
+  EXPECT_EQ(*grandchild.path(), (FieldPath{"a", "b"}));
+  EXPECT_EQ(*nested.path(), (FieldPath{"a", "b", "c", "d"}));
+  EXPECT_EQ(grandchild.FieldDescription(), " (found in field a.b)");
+}
+
+TEST(UserDataTest, ContextsWithinArraysHaveNoPath) {
+  ParseAccumulator accumulator{UserDataSource::Set};
+  ParseContext root = accumulator.RootContext();
+  ParseContext element = root.ChildContext(size_t{0});
+  ParseContext field = element.ChildContext(std::string("a"));
+
+  EXPECT_TRUE(element.array_element());
+  EXPECT_EQ(element.path(), nullptr);
+  EXPECT_EQ(field.path(), nullptr);
+}
+
+TEST(UserDataTest, ValidatesFieldNames) {
+  ParseAccumulator accumulator{UserDataSource::Set};
+  ParseContext root = accumulator.RootContext();
+
+  EXPECT_ANY_THROW(root.ChildContext(std::string("")));
+  EXPECT_ANY_THROW(root.ChildContext(std::string("__a__")));
+  EXPECT_ANY_THROW(root.ChildContext(FieldPath{"a", "__b__"}));
+}
+
+TEST(UserDataTest, ContainsMatchesPrefixesOfTheFieldMask) {
+  ParseAccumulator accumulator{UserDataSource::MergeSet};
+  ParseContext root = accumulator.RootContext();
+  ParseContext a = root.ChildContext(std::string("a"));
+  ParseContext ab = a.ChildContext(std::string("b"));
+  ParseContext c = root.ChildContext(std::string("c"));
+  ab.AddPathToFieldMask();
+  c.AddPathToFieldMask();
+
+  EXPECT_TRUE(accumulator.Contains(FieldPath{"a"}));
+  EXPECT_TRUE(accumulator.Contains(FieldPath{"a", "b"}));
+  EXPECT_TRUE(accumulator.Contains(FieldPath{"c"}));
+  EXPECT_FALSE(accumulator.Contains(FieldPath{"a", "c"}));
+  EXPECT_FALSE(accumulator.Contains(FieldPath{"b"}));
+}
+
+TEST(UserDataTest, SetDoesNotTrackTheFieldMask) {
+  ParseAccumulator accumulator{UserDataSource::Set};
+  ParseContext root = accumulator.RootContext();
+  ParseContext a = root.ChildContext(std::string("a"));
+  a.AddPathToFieldMask();
+
+  EXPECT_FALSE(accumulator.tracks_field_mask());
+  EXPECT_FALSE(accumulator.Contains(FieldPath{"a"}));
+}
+
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
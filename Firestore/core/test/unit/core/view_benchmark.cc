@@ -0,0 +1,143 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/core/view.h"
+#include "Firestore/core/src/core/view_snapshot.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "Firestore/core/test/unit/testutil/view_testing.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace core {
+namespace {
+
+using model::Document;
+using model::DocumentKeySet;
+using model::MaybeDocument;
+using testutil::Doc;
+using testutil::DocUpdates;
+using testutil::Map;
+using testutil::OrderBy;
+
+std::string DocPath(int64_t i) {
+  return "rooms/eros/messages/" + std::to_string(i);
+}
+
+/** Creates a view of an ordered query that contains `count` documents. */
+View MakeView(const Query& query, int64_t count) {
+  std::vector<MaybeDocument> docs;
+  for (int64_t i = 0; i < count; ++i) {
+    docs.push_back(Doc(DocPath(i), 1, Map("order", i, "count", 0)));
+  }
+
+  View view(query, DocumentKeySet{});
+  view.ApplyChanges(view.ComputeDocumentChanges(DocUpdates(docs)));
+  return view;
+}
+
+Query MessagesQuery() {
+  return testutil::Query("rooms/eros/messages").AddingOrderBy(OrderBy("order"));
+}
+
+/**
+ * Updates a field that the query doesn't order by in one document at a time,
+ * which leaves the document in place.
+ */
+void BM_ViewModifyInPlace(benchmark::State& state) {
+  int64_t count = state.range(0);
+  View view = MakeView(MessagesQuery(), count);
+
+  int64_t version = 2;
+  for (auto _ : state) {
+    int64_t i = version % count;
+    Document doc = Doc(DocPath(i), version, Map("order", i, "count", version));
+    ViewChange change =
+        view.ApplyChanges(view.ComputeDocumentChanges(DocUpdates({doc})));
+    benchmark::DoNotOptimize(change);
+    ++version;
+  }
+}
+BENCHMARK(BM_ViewModifyInPlace)->Arg(100)->Arg(1000)->Arg(5000);
+
+/** Updates one document at a time in a way that moves it in the results. */
+void BM_ViewModifyReordering(benchmark::State& state) {
+  int64_t count = state.range(0);
+  View view = MakeView(MessagesQuery(), count);
+
+  int64_t version = 2;
+  for (auto _ : state) {
+    int64_t i = version % count;
+    int64_t order = (i * 7919 + version) % count;
+    Document doc = Doc(DocPath(i), version, Map("order", order, "count", 0));
+    ViewChange change =
+        view.ApplyChanges(view.ComputeDocumentChanges(DocUpdates({doc})));
+    benchmark::DoNotOptimize(change);
+    ++version;
+  }
+}
+BENCHMARK(BM_ViewModifyReordering)->Arg(100)->Arg(1000)->Arg(5000);
+
+/** Updates one document at a time in a view of a full limit query. */
+void BM_ViewModifyInPlaceWithLimit(benchmark::State& state) {
+  int64_t count = state.range(0);
+  View view = MakeView(MessagesQuery().WithLimitToFirst(count), count);
+
+  int64_t version = 2;
+  for (auto _ : state) {
+    int64_t i = version % count;
+    Document doc = Doc(DocPath(i), version, Map("order", i, "count", version));
+    ViewChange change =
+        view.ApplyChanges(view.ComputeDocumentChanges(DocUpdates({doc})));
+    benchmark::DoNotOptimize(change);
+    ++version;
+  }
+}
+BENCHMARK(BM_ViewModifyInPlaceWithLimit)->Arg(100)->Arg(1000)->Arg(5000);
+
+/** Updates batches of documents, as a remote event for many documents does. */
+void BM_ViewModifyBatch(benchmark::State& state) {
+  int64_t count = state.range(0);
+  int64_t batch_size = state.range(1);
+  View view = MakeView(MessagesQuery(), count);
+
+  int64_t version = 2;
+  for (auto _ : state) {
+    std::vector<MaybeDocument> docs;
+    for (int64_t j = 0; j < batch_size; ++j) {
+      int64_t i = (version * batch_size + j) % count;
+      docs.push_back(
+          Doc(DocPath(i), version, Map("order", i, "count", version)));
+    }
+    ViewChange change =
+        view.ApplyChanges(view.ComputeDocumentChanges(DocUpdates(docs)));
+    benchmark::DoNotOptimize(change);
+    ++version;
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_ViewModifyBatch)->Args({5000, 10})->Args({5000, 100});
+
+}  // namespace
+}  // namespace core
+}  // namespace firestore
+}  // namespace firebase
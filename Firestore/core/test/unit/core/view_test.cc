@@ -25,6 +25,7 @@
 #include "Firestore/core/src/core/view_snapshot.h"
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/document_set.h"
+#include "Firestore/core/src/model/field_mask.h"
 #include "Firestore/core/src/model/no_document.h"
 #include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/test/unit/testutil/testutil.h"
@@ -41,6 +42,7 @@ using model::Document;
 using model::DocumentKeySet;
 using model::DocumentSet;
 using model::DocumentState;
+using model::FieldMask;
 using model::FieldValue;
 using model::ResourcePath;
 
@@ -157,6 +159,37 @@ TEST(ViewTest, ReturnsNilIfThereAreNoChanges) {
   ASSERT_FALSE(snapshot.has_value());
 }
 
+TEST(ViewTest, KeepsOnlyProjectedAndSortedFields) {
+  Query query = QueryForMessages()
+                    .AddingFilter(Filter("visible", "==", true))
+                    .AddingOrderBy(OrderBy("sort"))
+                    .WithProjection(FieldMask{Field("text")});
+  View view(query, DocumentKeySet{});
+
+  Document doc1 =
+      Doc("rooms/eros/messages/1", 0,
+          Map("text", "msg1", "sort", 2, "visible", true, "body", "long"));
+  Document doc2 =
+      Doc("rooms/eros/messages/2", 0,
+          Map("text", "msg2", "sort", 1, "visible", true, "body", "long"));
+
+  absl::optional<ViewSnapshot> snapshot =
+      ApplyChanges(&view, {doc1, doc2}, absl::nullopt);
+  ASSERT_TRUE(snapshot.has_value());
+  ASSERT_THAT(snapshot->documents(),
+              ElementsAre(Doc("rooms/eros/messages/2", 0,
+                              Map("text", "msg2", "sort", 1)),
+                          Doc("rooms/eros/messages/1", 0,
+                              Map("text", "msg1", "sort", 2))));
+
+  // Changes to fields outside of the projection aren't visible.
+  Document doc1_body_changed =
+      Doc("rooms/eros/messages/1", 0,
+          Map("text", "msg1", "sort", 2, "visible", true, "body", "longer"));
+  ASSERT_FALSE(
+      ApplyChanges(&view, {doc1_body_changed}, absl::nullopt).has_value());
+}
+
 TEST(ViewTest, DoesNotReturnNilForFirstChanges) {
   Query query = QueryForMessages();
   View view(query, DocumentKeySet{});
@@ -442,6 +475,47 @@ TEST(ViewTest, DoesntNeedRefillOnReorderWithinLimit) {
   view.ApplyChanges(changes);
 }
 
+TEST(ViewTest, UpdatesSingleDocumentInPlace) {
+  Query query =
+      QueryForMessages().AddingOrderBy(OrderBy("order")).WithLimitToFirst(2);
+  Document doc1 = Doc("rooms/eros/messages/0", 0, Map("order", 1, "a", 1));
+  Document doc2 = Doc("rooms/eros/messages/1", 0, Map("order", 2, "a", 1));
+  View view(query, DocumentKeySet{});
+  view.ApplyChanges(view.ComputeDocumentChanges(DocUpdates({doc1, doc2})));
+
+  // Modify the last doc in the limit without moving it.
+  Document new_doc2 = Doc("rooms/eros/messages/1", 1, Map("order", 2, "a", 2),
+                          DocumentState::kLocalMutations);
+  ViewDocumentChanges changes =
+      view.ComputeDocumentChanges(DocUpdates({new_doc2}));
+  ASSERT_THAT(changes.document_set(), ElementsAre(doc1, new_doc2));
+  ASSERT_THAT(changes.change_set().GetChanges(),
+              ElementsAre(DocumentViewChange{
+                  new_doc2, DocumentViewChange::Type::Modified}));
+  ASSERT_EQ(changes.mutated_keys(), DocumentKeySet{new_doc2.key()});
+  ASSERT_FALSE(changes.needs_refill());
+  view.ApplyChanges(changes);
+
+  // Watch catching up with the write only changes the metadata.
+  Document acked_doc2 = Doc("rooms/eros/messages/1", 2, Map("order", 2, "a", 2),
+                            DocumentState::kSynced);
+  changes = view.ComputeDocumentChanges(DocUpdates({acked_doc2}));
+  ASSERT_THAT(changes.change_set().GetChanges(),
+              ElementsAre(DocumentViewChange{
+                  acked_doc2, DocumentViewChange::Type::Metadata}));
+  ASSERT_EQ(changes.mutated_keys(), DocumentKeySet{});
+  view.ApplyChanges(changes);
+
+  // An identical update changes nothing.
+  changes = view.ComputeDocumentChanges(DocUpdates({acked_doc2}));
+  ASSERT_TRUE(changes.change_set().GetChanges().empty());
+
+  // Moving the doc past the limit still needs a refill.
+  Document moved_doc2 = Doc("rooms/eros/messages/1", 3, Map("order", 3));
+  changes = view.ComputeDocumentChanges(DocUpdates({moved_doc2}));
+  ASSERT_TRUE(changes.needs_refill());
+}
+
 TEST(ViewTest, DoesntNeedRefillOnReorderAfterLimitQuery) {
   Query query =
       QueryForMessages().AddingOrderBy(OrderBy("order")).WithLimitToFirst(3);
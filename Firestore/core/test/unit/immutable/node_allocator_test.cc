@@ -0,0 +1,72 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/immutable/node_allocator.h"
+
+#include <cstring>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace impl {
+
+TEST(NodeAllocatorTest, ReusesFreedBlocks) {
+  void* first = NodeAllocator::Allocate(40);
+  NodeAllocator::Deallocate(first, 40);
+
+  // Sizes in the same size class share freed blocks.
+  void* second = NodeAllocator::Allocate(48);
+  EXPECT_EQ(first, second);
+  NodeAllocator::Deallocate(second, 48);
+}
+
+TEST(NodeAllocatorTest, AllocatesUsableBlocks) {
+  std::vector<void*> blocks;
+  for (size_t size = 1; size <= 1024; size += 7) {
+    void* block = NodeAllocator::Allocate(size);
+    std::memset(block, 0xAB, size);
+    blocks.push_back(block);
+  }
+
+  size_t size = 1;
+  for (void* block : blocks) {
+    NodeAllocator::Deallocate(block, size);
+    size += 7;
+  }
+}
+
+TEST(NodeAllocatorTest, FreesBlocksFromOtherThreads) {
+  std::vector<void*> blocks;
+  for (int i = 0; i < 1000; ++i) {
+    blocks.push_back(NodeAllocator::Allocate(64));
+  }
+
+  std::thread other([&blocks] {
+    for (void* block : blocks) {
+      NodeAllocator::Deallocate(block, 64);
+    }
+  });
+  other.join();
+}
+
+}  // namespace impl
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
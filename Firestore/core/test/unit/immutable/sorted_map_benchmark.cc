@@ -0,0 +1,121 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/immutable/sorted_map.h"
+#include "Firestore/core/src/util/secure_random.h"
+#include "benchmark/benchmark.h"
+
+// Compares SortedMaps with different array-to-tree thresholds, for map sizes
+// typical of document fields (FieldValue::Map) and of query results
+// (DocumentMap, DocumentKeySet). Keys are strings and values are shared
+// pointers, which have the same sizes as the keys and values of those maps.
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace {
+
+using Value = std::shared_ptr<int>;
+
+template <SortedMapBase::size_type FixedSize>
+using StringMap =
+    SortedMap<std::string, Value, util::Comparator<std::string>, FixedSize>;
+
+std::vector<std::string> ShuffledKeys(int64_t count) {
+  std::vector<std::string> keys;
+  for (int64_t i = 0; i < count; ++i) {
+    keys.push_back("field_" + std::to_string(i));
+  }
+  util::SecureRandom rng;
+  std::shuffle(keys.begin(), keys.end(), rng);
+  return keys;
+}
+
+template <typename Map>
+Map Build(const std::vector<std::string>& keys) {
+  Value value = std::make_shared<int>(0);
+  Map map;
+  for (const std::string& key : keys) {
+    map = map.insert(key, value);
+  }
+  return map;
+}
+
+template <SortedMapBase::size_type FixedSize>
+void BM_SortedMapInsert(benchmark::State& state) {
+  std::vector<std::string> keys = ShuffledKeys(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Build<StringMap<FixedSize>>(keys));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <SortedMapBase::size_type FixedSize>
+void BM_SortedMapFind(benchmark::State& state) {
+  std::vector<std::string> keys = ShuffledKeys(state.range(0));
+  StringMap<FixedSize> map = Build<StringMap<FixedSize>>(keys);
+  for (auto _ : state) {
+    for (const std::string& key : keys) {
+      benchmark::DoNotOptimize(map.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <SortedMapBase::size_type FixedSize>
+void BM_SortedMapIterate(benchmark::State& state) {
+  StringMap<FixedSize> map =
+      Build<StringMap<FixedSize>>(ShuffledKeys(state.range(0)));
+  for (auto _ : state) {
+    size_t total = 0;
+    for (const auto& entry : map) {
+      total += entry.first.size();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void MapSizes(benchmark::internal::Benchmark* benchmark) {
+  for (int size : {4, 8, 16, 24, 32, 48, 64}) {
+    benchmark->Arg(size);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_SortedMapInsert, 8)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapInsert, 16)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapInsert, 25)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapInsert, 48)->Apply(MapSizes);
+
+BENCHMARK_TEMPLATE(BM_SortedMapFind, 8)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapFind, 16)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapFind, 25)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapFind, 48)->Apply(MapSizes);
+
+BENCHMARK_TEMPLATE(BM_SortedMapIterate, 8)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapIterate, 16)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapIterate, 25)->Apply(MapSizes);
+BENCHMARK_TEMPLATE(BM_SortedMapIterate, 48)->Apply(MapSizes);
+
+}  // namespace
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
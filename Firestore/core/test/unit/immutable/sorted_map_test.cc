@@ -66,6 +66,7 @@ class SortedMapTest : public ::testing::Test {
 
 // NOLINTNEXTLINE: must be a typedef for the gtest macros
 typedef ::testing::Types<SortedMap<int, int>,
+                         SortedMap<int, int, util::Comparator<int>, 4>,
                          impl::ArraySortedMap<int, int>,
                          impl::TreeSortedMap<int, int>>
     TestedTypes;
@@ -267,6 +268,17 @@ TYPED_TEST(SortedMapTest, FindIndex) {
   ASSERT_EQ(5u, map.find_index(50));
 }
 
+TYPED_TEST(SortedMapTest, AtIndex) {
+  std::vector<int> to_insert = Shuffled(Sequence(this->large_number()));
+  TypeParam map = ToMap<TypeParam>(to_insert);
+
+  for (int i = 0; i < this->large_number(); ++i) {
+    auto index = static_cast<typename TypeParam::size_type>(i);
+    ASSERT_EQ(i, map.at_index(index).first);
+    ASSERT_EQ(index, map.find_index(map.at_index(index).first));
+  }
+}
+
 TYPED_TEST(SortedMapTest, MinMax) {
   TypeParam empty;
   auto min = empty.min();
@@ -471,6 +483,82 @@ TYPED_TEST(SortedMapTest, KeysIn) {
   ASSERT_SEQ_EQ(Seq(8, 14), map.keys_in(7, 13));   // in between to in between
 }
 
+TEST(SortedMapTest, FromSortedRange) {
+  using IntMap = SortedMap<int, int>;
+  for (int size : {0, 1, 25, 26, 100}) {
+    std::vector<std::pair<int, int>> pairs = Pairs(Sequence(size));
+    IntMap map = IntMap::FromSortedRange(pairs.begin(), pairs.end());
+    EXPECT_SEQ_EQ(pairs, map);
+  }
+}
+
+TEST(SortedMapTest, BuilderSortsAndKeepsLastValue) {
+  SortedMap<int, int>::Builder builder;
+  for (int i : Shuffled(Sequence(50))) {
+    builder.insert(i, 0);
+  }
+  builder.insert(7, 7);
+  builder.insert(3, 3);
+  EXPECT_EQ(52u, builder.size());
+
+  SortedMap<int, int> map = builder.Build();
+  EXPECT_EQ(50u, map.size());
+  EXPECT_EQ(Sequence(50), Keys(map));
+  EXPECT_TRUE(Found(map, 7, 7));
+  EXPECT_TRUE(Found(map, 3, 3));
+  EXPECT_TRUE(Found(map, 5, 0));
+
+  EXPECT_EQ(0u, builder.size());
+  EXPECT_TRUE(builder.Build().empty());
+}
+
+TEST(SortedMapTest, BuilderMatchesInsert) {
+  std::vector<int> values = Sequence(0, 200, 3);
+  SortedMap<int, int>::Builder builder;
+  for (int value : values) {
+    builder.insert(value, value);
+  }
+  SortedMap<int, int> built = builder.Build();
+  EXPECT_EQ(Collect(ToMap<SortedMap<int, int>>(values)), Collect(built));
+
+  built = built.insert(1, 1).erase(3);
+  EXPECT_TRUE(Found(built, 1, 1));
+  EXPECT_TRUE(NotFound(built, 3));
+}
+
+TEST(SortedMapTest, DiffReportsChangedEntries) {
+  using IntMap = SortedMap<int, int>;
+  for (int size : {10, 200}) {
+    IntMap before = ToMap<IntMap>(Shuffled(Sequence(0, size * 2, 2)));
+    IntMap after = before.erase(4).insert(5, 5).insert(8, 0);
+
+    std::vector<std::pair<int, int>> removed;
+    std::vector<std::pair<int, int>> added;
+    std::vector<int> modified;
+    int visited = 0;
+    IntMap::Diff(before, after,
+                 [&](const std::pair<int, int>* lhs,
+                     const std::pair<int, int>* rhs) {
+                   ++visited;
+                   if (!rhs) {
+                     removed.push_back(*lhs);
+                   } else if (!lhs) {
+                     added.push_back(*rhs);
+                   } else if (lhs->second != rhs->second) {
+                     modified.push_back(lhs->first);
+                   }
+                 });
+
+    EXPECT_EQ((std::vector<std::pair<int, int>>{{4, 4}}), removed);
+    EXPECT_EQ((std::vector<std::pair<int, int>>{{5, 5}}), added);
+    EXPECT_EQ(std::vector<int>{8}, modified);
+    if (size > static_cast<int>(IntMap::kFixedSize)) {
+      // Subtrees untouched by the changes are shared and skipped.
+      EXPECT_LT(visited, size / 2);
+    }
+  }
+}
+
 }  // namespace immutable
 }  // namespace firestore
 }  // namespace firebase
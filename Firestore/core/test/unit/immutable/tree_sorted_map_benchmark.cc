@@ -0,0 +1,156 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/immutable/tree_sorted_map.h"
+#include "Firestore/core/src/util/allocation_tracker.h"
+#include "Firestore/core/src/util/secure_random.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace immutable {
+namespace {
+
+using IntMap = impl::TreeSortedMap<int, int>;
+using StdMap = std::map<int, int>;
+
+std::vector<int> ShuffledKeys(int64_t count) {
+  std::vector<int> keys;
+  for (int i = 0; i < count; ++i) {
+    keys.push_back(i);
+  }
+  util::SecureRandom rng;
+  std::shuffle(keys.begin(), keys.end(), rng);
+  return keys;
+}
+
+IntMap BuildTree(const std::vector<int>& keys) {
+  IntMap map;
+  for (int key : keys) {
+    map = map.insert(key, key);
+  }
+  return map;
+}
+
+StdMap BuildStdMap(const std::vector<int>& keys) {
+  StdMap map;
+  for (int key : keys) {
+    map.emplace(key, key);
+  }
+  return map;
+}
+
+template <typename Map>
+void ReportBytesPerEntry(benchmark::State& state,
+                         Map (*build)(const std::vector<int>&)) {
+  if (!util::AllocationHooksInstalled()) return;
+
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  util::ScopedAllocationCounter counter;
+  Map map = build(keys);
+
+  // The bytes still allocated once the map is built are the ones it retains.
+  const util::AllocationCounts& counts = counter.counts();
+  state.counters["bytes_per_entry"] =
+      static_cast<double>(counts.bytes_allocated - counts.bytes_deallocated) /
+      static_cast<double>(keys.size());
+}
+
+void BM_TreeSortedMapInsert(benchmark::State& state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BuildTree(keys));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  ReportBytesPerEntry(state, BuildTree);
+}
+BENCHMARK(BM_TreeSortedMapInsert)->Range(1 << 6, 1 << 16);
+
+void BM_StdMapInsert(benchmark::State& state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BuildStdMap(keys));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  ReportBytesPerEntry(state, BuildStdMap);
+}
+BENCHMARK(BM_StdMapInsert)->Range(1 << 6, 1 << 16);
+
+void BM_TreeSortedMapIterate(benchmark::State& state) {
+  IntMap map = BuildTree(ShuffledKeys(state.range(0)));
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (const auto& entry : map) {
+      sum += entry.second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TreeSortedMapIterate)->Range(1 << 6, 1 << 16);
+
+void BM_StdMapIterate(benchmark::State& state) {
+  StdMap map = BuildStdMap(ShuffledKeys(state.range(0)));
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (const auto& entry : map) {
+      sum += entry.second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdMapIterate)->Range(1 << 6, 1 << 16);
+
+void BM_TreeSortedMapErase(benchmark::State& state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  IntMap full = BuildTree(keys);
+  for (auto _ : state) {
+    IntMap map = full;
+    for (int key : keys) {
+      map = map.erase(key);
+    }
+    benchmark::DoNotOptimize(map);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TreeSortedMapErase)->Range(1 << 6, 1 << 16);
+
+void BM_StdMapErase(benchmark::State& state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  StdMap full = BuildStdMap(keys);
+  for (auto _ : state) {
+    // Unlike a TreeSortedMap, a std::map must be copied before it can be
+    // modified without affecting other readers, so include the copy.
+    StdMap map = full;
+    for (int key : keys) {
+      map.erase(key);
+    }
+    benchmark::DoNotOptimize(map);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdMapErase)->Range(1 << 6, 1 << 16);
+
+}  // namespace
+}  // namespace immutable
+}  // namespace firestore
+}  // namespace firebase
@@ -29,6 +29,32 @@ namespace impl {
 
 using IntMap = TreeSortedMap<int, int>;
 
+/**
+ * Checks the invariants of a left-leaning red-black tree rooted at `node`
+ * and returns its black height, or -1 if the tree is invalid.
+ */
+int BlackHeight(const IntMap::node_type& node) {
+  if (node.empty()) {
+    return 0;
+  }
+  if (node.right().red()) {
+    return -1;
+  }
+  if (node.red() && node.left().red()) {
+    return -1;
+  }
+  if (node.size() != node.left().size() + 1 + node.right().size()) {
+    return -1;
+  }
+
+  int left = BlackHeight(node.left());
+  int right = BlackHeight(node.right());
+  if (left < 0 || left != right) {
+    return -1;
+  }
+  return left + (node.red() ? 0 : 1);
+}
+
 TEST(TreeSortedMap, EmptySize) {
   IntMap map;
   EXPECT_TRUE(map.empty());
@@ -230,6 +256,34 @@ TEST(TreeSortedMap, InitializerIsSorted) {
   EXPECT_TRUE(std::is_sorted(map.begin(), map.end()));
 }
 
+TEST(TreeSortedMap, FromSortedRangeIsBalanced) {
+  for (int size = 0; size <= 300; ++size) {
+    std::vector<std::pair<int, int>> pairs = Pairs(Sequence(size));
+    IntMap map = IntMap::FromSortedRange(pairs.begin(), pairs.end(), {});
+
+    ASSERT_EQ(static_cast<size_t>(size), map.size());
+    ASSERT_EQ(Color::Black, map.root().color());
+    ASSERT_GE(BlackHeight(map.root()), 0) << "size " << size;
+    ASSERT_SEQ_EQ(pairs, map);
+  }
+}
+
+TEST(TreeSortedMap, FromSortedRangeSupportsMutation) {
+  std::vector<std::pair<int, int>> pairs = Pairs(Sequence(0, 100, 2));
+  IntMap map = IntMap::FromSortedRange(pairs.begin(), pairs.end(), {});
+
+  for (int i = 1; i < 100; i += 2) {
+    map = map.insert(i, i);
+    ASSERT_GE(BlackHeight(map.root()), 0);
+  }
+  for (int i : Shuffled(Sequence(100))) {
+    map = map.erase(i);
+    ASSERT_GE(BlackHeight(map.root()), 0);
+    ASSERT_TRUE(NotFound(map, i));
+  }
+  EXPECT_TRUE(map.empty());
+}
+
 }  // namespace impl
 }  // namespace immutable
 }  // namespace firestore
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/bundle_document_source.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_remote_document_cache.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_map.h"
+#include "Firestore/core/src/model/no_document.h"
+#include "Firestore/core/src/remote/serializer.h"
+#include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/testutil/filesystem_testing.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using bundle::BundleSerializer;
+using model::DatabaseId;
+using model::DocumentKey;
+using model::DocumentMap;
+using model::NoDocument;
+using model::ResourcePath;
+using model::SnapshotVersion;
+using testutil::Doc;
+using testutil::Key;
+using testutil::Map;
+using testutil::Query;
+using testutil::TestTempDir;
+using testutil::Version;
+using util::Path;
+
+const int64_t kMicrosPerSecond = 1000000;
+
+std::string Name(const std::string& path) {
+  return "\"projects/p/databases/default/documents/" + path + "\"";
+}
+
+std::string Time(int seconds) {
+  return "{\"seconds\":" + std::to_string(seconds) + ",\"nanos\":0}";
+}
+
+std::string DocumentMetadata(const std::string& path,
+                             int read_seconds,
+                             bool exists) {
+  return "{\"documentMetadata\":{\"name\":" + Name(path) +
+         ",\"readTime\":" + Time(read_seconds) +
+         ",\"exists\":" + (exists ? "true" : "false") + "}}";
+}
+
+std::string Document(const std::string& path, int update_seconds, int foo) {
+  return "{\"document\":{\"name\":" + Name(path) +
+         ",\"fields\":{\"foo\":{\"integerValue\":\"" + std::to_string(foo) +
+         "\"}},\"createTime\":" + Time(1) +
+         ",\"updateTime\":" + Time(update_seconds) + "}}";
+}
+
+/** Writes a bundle made of the given elements and returns its path. */
+Path WriteBundle(const TestTempDir& dir,
+                 const std::vector<std::string>& elements) {
+  std::string body;
+  for (const std::string& element : elements) {
+    body += std::to_string(element.size()) + element;
+  }
+  std::string metadata = "{\"metadata\":{\"id\":\"bundle\",\"createTime\":" +
+                         Time(10) + ",\"version\":1,\"totalBytes\":" +
+                         std::to_string(body.size()) + "}}";
+
+  Path path = dir.RandomChild();
+  std::ofstream out(path.native_value(), std::ios::binary);
+  out << std::to_string(metadata.size()) << metadata << body;
+  return path;
+}
+
+BundleSerializer Serializer() {
+  return BundleSerializer(remote::Serializer(DatabaseId("p", "default")));
+}
+
+std::unique_ptr<BundleDocumentSource> OpenTestBundle(const TestTempDir& dir) {
+  Path path = WriteBundle(
+      dir, {
+               DocumentMetadata("coll/b", 5, true),
+               Document("coll/b", 2, 2),
+               DocumentMetadata("coll/a", 5, true),
+               Document("coll/a", 1, 1),
+               DocumentMetadata("coll/missing", 5, false),
+               DocumentMetadata("other/c", 6, true),
+               Document("other/c", 3, 3),
+           });
+  auto source = BundleDocumentSource::Open(path, Serializer());
+  EXPECT_TRUE(source.ok()) << source.status().ToString();
+  return std::move(source).ValueOrDie();
+}
+
+}  // namespace
+
+TEST(BundleDocumentSourceTest, ReadsDocumentsByKey) {
+  TestTempDir dir;
+  std::unique_ptr<BundleDocumentSource> source = OpenTestBundle(dir);
+  EXPECT_EQ(source->size(), 4u);
+
+  EXPECT_EQ(source->Get(Key("coll/a")),
+            Doc("coll/a", 1 * kMicrosPerSecond, Map("foo", 1)));
+  EXPECT_EQ(source->Get(Key("other/c")),
+            Doc("other/c", 3 * kMicrosPerSecond, Map("foo", 3)));
+  EXPECT_EQ(source->Get(Key("coll/missing")),
+            NoDocument(Key("coll/missing"), Version(5 * kMicrosPerSecond),
+                       /* has_committed_mutations= */ false));
+  EXPECT_EQ(source->Get(Key("coll/unknown")), absl::nullopt);
+
+  // Documents can be read again, in any order.
+  EXPECT_EQ(source->Get(Key("coll/b")),
+            Doc("coll/b", 2 * kMicrosPerSecond, Map("foo", 2)));
+  EXPECT_EQ(source->Get(Key("coll/a")),
+            Doc("coll/a", 1 * kMicrosPerSecond, Map("foo", 1)));
+}
+
+TEST(BundleDocumentSourceTest, EnumeratesKeysInCollection) {
+  TestTempDir dir;
+  std::unique_ptr<BundleDocumentSource> source = OpenTestBundle(dir);
+
+  std::vector<DocumentKey> keys;
+  source->EnumerateKeys(ResourcePath{"coll"},
+                        [&](const DocumentKey& key, const SnapshotVersion&) {
+                          keys.push_back(key);
+                          return true;
+                        });
+  EXPECT_EQ(keys, (std::vector<DocumentKey>{Key("coll/a"), Key("coll/b"),
+                                            Key("coll/missing")}));
+
+  EXPECT_EQ(source->GetCollectionPaths(),
+            (std::vector<ResourcePath>{ResourcePath{"coll"},
+                                       ResourcePath{"other"}}));
+}
+
+TEST(BundleDocumentSourceTest, RejectsDocumentsWithoutMetadata) {
+  TestTempDir dir;
+  Path path = WriteBundle(dir, {Document("coll/a", 1, 1)});
+  EXPECT_FALSE(BundleDocumentSource::Open(path, Serializer()).ok());
+  EXPECT_FALSE(
+      BundleDocumentSource::Open(dir.RandomChild(), Serializer()).ok());
+}
+
+TEST(BundleDocumentSourceTest, ServesDocumentsBehindLevelDb) {
+  TestTempDir dir;
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting();
+  LevelDbRemoteDocumentCache* cache = persistence->remote_document_cache();
+  cache->AttachBundleDocumentSource(OpenTestBundle(dir));
+
+  persistence->Run("ServesDocumentsBehindLevelDb", [&] {
+    cache->Add(Doc("coll/b", 4 * kMicrosPerSecond, Map("foo", 4)),
+               Version(7 * kMicrosPerSecond));
+
+    EXPECT_EQ(cache->Get(Key("coll/a")),
+              Doc("coll/a", 1 * kMicrosPerSecond, Map("foo", 1)));
+    EXPECT_EQ(cache->Get(Key("coll/b")),
+              Doc("coll/b", 4 * kMicrosPerSecond, Map("foo", 4)));
+
+    DocumentMap matching = cache->GetMatching(Query("coll"), SnapshotVersion());
+    ASSERT_EQ(matching.size(), 2u);
+    EXPECT_EQ(matching.underlying_map().get(Key("coll/a")),
+              Doc("coll/a", 1 * kMicrosPerSecond, Map("foo", 1)));
+    EXPECT_EQ(matching.underlying_map().get(Key("coll/b")),
+              Doc("coll/b", 4 * kMicrosPerSecond, Map("foo", 4)));
+
+    // Only the LevelDB document was read after the bundle's read times.
+    DocumentMap changed =
+        cache->GetMatching(Query("coll"), Version(6 * kMicrosPerSecond));
+    EXPECT_EQ(changed.size(), 1u);
+    EXPECT_TRUE(changed.underlying_map().get(Key("coll/b")));
+  });
+
+  persistence->Shutdown();
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -43,7 +43,7 @@ void CountingQueryEngine::SetLocalDocumentsView(
       local_documents->mutation_queue(), this);
   local_documents_ = absl::make_unique<LocalDocumentsView>(
       remote_documents_.get(), mutation_queue_.get(),
-      local_documents->index_manager());
+      local_documents->overlay_cache(), local_documents->index_manager());
   QueryEngine::SetLocalDocumentsView(local_documents_.get());
 }
 
@@ -146,6 +146,11 @@ void WrappedRemoteDocumentCache::Add(const model::MaybeDocument& document,
   subject_->Add(document, read_time);
 }
 
+void WrappedRemoteDocumentCache::AddAll(
+    const std::vector<DocumentReadTime>& documents) {
+  subject_->AddAll(documents);
+}
+
 void WrappedRemoteDocumentCache::Remove(const model::DocumentKey& key) {
   subject_->Remove(key);
 }
@@ -171,6 +176,31 @@ DocumentMap WrappedRemoteDocumentCache::GetMatching(
   return result;
 }
 
+DocumentMap WrappedRemoteDocumentCache::GetMatchingInCollections(
+    const core::Query& query,
+    const std::vector<model::ResourcePath>& collection_paths,
+    const model::SnapshotVersion& since_read_time) {
+  auto result = subject_->GetMatchingInCollections(query, collection_paths,
+                                                   since_read_time);
+  query_engine_->documents_read_by_query_ += result.size();
+  return result;
+}
+
+DocumentMap WrappedRemoteDocumentCache::GetMatchingCandidates(
+    const core::Query& query, const model::DocumentKeySet& candidate_keys) {
+  auto result = subject_->GetMatchingCandidates(query, candidate_keys);
+  query_engine_->documents_read_by_query_ += result.size();
+  return result;
+}
+
+void WrappedRemoteDocumentCache::EnumerateMatching(
+    const core::Query& query, const DocumentVisitor& visitor) {
+  subject_->EnumerateMatching(query, [&](const model::Document& doc) {
+    ++query_engine_->documents_read_by_query_;
+    return visitor(doc);
+  });
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
@@ -165,6 +165,8 @@ class WrappedRemoteDocumentCache : public RemoteDocumentCache {
   void Add(const model::MaybeDocument& document,
            const model::SnapshotVersion& read_time) override;
 
+  void AddAll(const std::vector<DocumentReadTime>& documents) override;
+
   void Remove(const model::DocumentKey& key) override;
 
   absl::optional<model::MaybeDocument> Get(
@@ -177,6 +179,18 @@ class WrappedRemoteDocumentCache : public RemoteDocumentCache {
       const core::Query& query,
       const model::SnapshotVersion& since_read_time) override;
 
+  model::DocumentMap GetMatchingInCollections(
+      const core::Query& query,
+      const std::vector<model::ResourcePath>& collection_paths,
+      const model::SnapshotVersion& since_read_time) override;
+
+  model::DocumentMap GetMatchingCandidates(
+      const core::Query& query,
+      const model::DocumentKeySet& candidate_keys) override;
+
+  void EnumerateMatching(const core::Query& query,
+                         const DocumentVisitor& visitor) override;
+
  private:
   RemoteDocumentCache* subject_ = nullptr;
   CountingQueryEngine* query_engine_ = nullptr;
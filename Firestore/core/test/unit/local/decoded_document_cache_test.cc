@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/decoded_document_cache.h"
+
+#include <string>
+
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using model::MaybeDocument;
+using testutil::Doc;
+using testutil::Key;
+using testutil::Map;
+
+}  // namespace
+
+TEST(DecodedDocumentCacheTest, HitsOnlyForIdenticalBytes) {
+  DecodedDocumentCache cache;
+  MaybeDocument doc = Doc("coll/a", 1, Map("a", 1));
+  cache.Put(doc, "encoded-v1");
+
+  EXPECT_EQ(cache.Get(Key("coll/a"), "encoded-v1"), doc);
+  EXPECT_EQ(cache.Get(Key("coll/a"), "encoded-v2"), absl::nullopt);
+  EXPECT_EQ(cache.Get(Key("coll/b"), "encoded-v1"), absl::nullopt);
+
+  EXPECT_EQ(cache.hits(), 1u);
+  EXPECT_EQ(cache.misses(), 2u);
+}
+
+TEST(DecodedDocumentCacheTest, PutReplacesEntry) {
+  DecodedDocumentCache cache;
+  MaybeDocument doc1 = Doc("coll/a", 1, Map("a", 1));
+  MaybeDocument doc2 = Doc("coll/a", 2, Map("a", 2));
+  cache.Put(doc1, "v1");
+  size_t size = cache.byte_size();
+  cache.Put(doc2, "v2");
+
+  EXPECT_EQ(cache.byte_size(), size);
+  EXPECT_EQ(cache.Get(Key("coll/a"), "v1"), absl::nullopt);
+  EXPECT_EQ(cache.Get(Key("coll/a"), "v2"), doc2);
+}
+
+TEST(DecodedDocumentCacheTest, Remove) {
+  DecodedDocumentCache cache;
+  cache.Put(Doc("coll/a", 1, Map()), "a");
+  cache.Put(Doc("coll/b", 1, Map()), "b");
+
+  cache.Remove(Key("coll/a"));
+  EXPECT_EQ(cache.Get(Key("coll/a"), "a"), absl::nullopt);
+  EXPECT_NE(cache.Get(Key("coll/b"), "b"), absl::nullopt);
+
+  size_t size = cache.byte_size();
+  EXPECT_EQ(cache.Clear(), size);
+  EXPECT_EQ(cache.Get(Key("coll/b"), "b"), absl::nullopt);
+  EXPECT_EQ(cache.byte_size(), 0u);
+}
+
+TEST(DecodedDocumentCacheTest, EvictsLeastRecentlyUsed) {
+  std::string encoded(100, 'x');
+  DecodedDocumentCache probe;
+  probe.Put(Doc("coll/a", 1, Map()), encoded);
+  size_t entry_size = probe.byte_size();
+
+  DecodedDocumentCache cache(entry_size * 2);
+  cache.Put(Doc("coll/a", 1, Map()), encoded);
+  cache.Put(Doc("coll/b", 1, Map()), encoded);
+
+  // Touch "a" so that "b" is evicted by the next Put.
+  ASSERT_NE(cache.Get(Key("coll/a"), encoded), absl::nullopt);
+  cache.Put(Doc("coll/c", 1, Map()), encoded);
+
+  EXPECT_NE(cache.Get(Key("coll/a"), encoded), absl::nullopt);
+  EXPECT_EQ(cache.Get(Key("coll/b"), encoded), absl::nullopt);
+  EXPECT_NE(cache.Get(Key("coll/c"), encoded), absl::nullopt);
+  EXPECT_EQ(cache.byte_size(), entry_size * 2);
+}
+
+TEST(DecodedDocumentCacheTest, SkipsEntriesLargerThanBudget) {
+  DecodedDocumentCache cache(16);
+  cache.Put(Doc("coll/a", 1, Map()), std::string(100, 'x'));
+  EXPECT_EQ(cache.byte_size(), 0u);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
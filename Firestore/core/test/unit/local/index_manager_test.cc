@@ -23,14 +23,18 @@
 
 #include "Firestore/core/src/local/index_manager.h"
 #include "Firestore/core/src/local/persistence.h"
+#include "Firestore/core/src/model/field_index.h"
 #include "Firestore/core/src/model/resource_path.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
 #include "gtest/gtest.h"
 
 namespace firebase {
 namespace firestore {
 namespace local {
 
+using model::FieldIndex;
 using model::ResourcePath;
+using testutil::Field;
 
 void IndexManagerTest::AssertParents(const std::string& collection_id,
                                      std::vector<std::string> expected) {
@@ -71,6 +75,41 @@ TEST_P(IndexManagerTest, AddAndReadCollectionParentIndexEntries) {
   });
 }
 
+TEST_P(IndexManagerTest, AddAndReadFieldIndexes) {
+  IndexManager* index_manager = persistence->index_manager();
+  persistence->Run("AddAndReadFieldIndexes", [&]() {
+    index_manager->AddFieldIndex(FieldIndex("coll", {Field("a")}));
+    index_manager->AddFieldIndex(FieldIndex("coll", {Field("a")}));
+    index_manager->AddFieldIndex(FieldIndex("coll", {Field("a"), Field("b")}));
+    index_manager->AddFieldIndex(FieldIndex("other", {Field("a")}));
+
+    std::vector<FieldIndex> indexes = index_manager->GetFieldIndexes("coll");
+    ASSERT_EQ(indexes.size(), 2u);
+    EXPECT_EQ(indexes[0], FieldIndex("coll", {Field("a")}));
+    EXPECT_EQ(indexes[1], FieldIndex("coll", {Field("a"), Field("b")}));
+    EXPECT_NE(indexes[0].index_id(), FieldIndex::kUnknownId);
+    EXPECT_NE(indexes[0].index_id(), indexes[1].index_id());
+
+    EXPECT_EQ(index_manager->GetFieldIndexes("other").size(), 1u);
+    EXPECT_TRUE(index_manager->GetFieldIndexes("missing").empty());
+  });
+}
+
+TEST_P(IndexManagerTest, DeleteFieldIndex) {
+  IndexManager* index_manager = persistence->index_manager();
+  persistence->Run("DeleteFieldIndex", [&]() {
+    index_manager->AddFieldIndex(FieldIndex("coll", {Field("a")}));
+    index_manager->AddFieldIndex(FieldIndex("coll", {Field("b")}));
+
+    index_manager->DeleteFieldIndex(FieldIndex("coll", {Field("a")}));
+    index_manager->DeleteFieldIndex(FieldIndex("coll", {Field("c")}));
+
+    std::vector<FieldIndex> indexes = index_manager->GetFieldIndexes("coll");
+    ASSERT_EQ(indexes.size(), 1u);
+    EXPECT_EQ(indexes[0], FieldIndex("coll", {Field("b")}));
+  });
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
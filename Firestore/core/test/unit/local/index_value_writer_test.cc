@@ -0,0 +1,164 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/index_value_writer.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/field_value.h"
+#include "Firestore/core/src/nanopb/byte_string.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using model::DatabaseId;
+using model::FieldValue;
+using nanopb::ByteString;
+using testutil::Array;
+using testutil::Key;
+using testutil::Map;
+using testutil::Value;
+
+std::string Encode(const FieldValue& value) {
+  std::string result;
+  WriteIndexValue(value, &result);
+  return result;
+}
+
+/** Values in ascending order, grouped by values that compare the same. */
+std::vector<std::vector<FieldValue>> SortedValueGroups() {
+  const DatabaseId db("p1", "d1");
+  const DatabaseId other_db("p1", "d2");
+  return {
+      {FieldValue::Null()},
+      {FieldValue::False()},
+      {FieldValue::True()},
+      {FieldValue::Nan()},
+      {Value(-std::numeric_limits<double>::infinity())},
+      {Value(std::numeric_limits<int64_t>::min())},
+      {Value(-1.5)},
+      {Value(-1), Value(-1.0)},
+      {Value(-0.0), Value(0.0), Value(0)},
+      {Value(std::numeric_limits<double>::min())},
+      {Value(1), Value(1.0)},
+      {Value(1.5)},
+      {Value(std::numeric_limits<int64_t>::max())},
+      {Value(std::numeric_limits<double>::infinity())},
+      {FieldValue::FromTimestamp(Timestamp(-1, 0))},
+      {FieldValue::FromTimestamp(Timestamp(100, 0))},
+      {FieldValue::FromTimestamp(Timestamp(100, 1))},
+      {Value("")},
+      {Value(std::string("\0", 1))},
+      {Value("a")},
+      {Value("ab")},
+      {Value("b")},
+      {FieldValue::FromBlob(ByteString())},
+      {FieldValue::FromBlob(ByteString({0x00, 0x01}))},
+      {FieldValue::FromBlob(ByteString("abc"))},
+      {FieldValue::FromReference(db, Key("c1/doc1"))},
+      {FieldValue::FromReference(db, Key("c1/doc1/c2/doc1"))},
+      {FieldValue::FromReference(db, Key("c1/doc2"))},
+      {FieldValue::FromReference(other_db, Key("c1/doc1"))},
+      {FieldValue::FromGeoPoint(GeoPoint(-90, 0))},
+      {FieldValue::FromGeoPoint(GeoPoint(0, -1))},
+      {FieldValue::FromGeoPoint(GeoPoint(0, 1))},
+      {FieldValue::FromGeoPoint(GeoPoint(90, 0))},
+      {Array()},
+      {Array(FieldValue::Null())},
+      {Array(1, "a")},
+      {Array(1, "b")},
+      {Array(2)},
+      {Value(Map())},
+      {Value(Map("a", 1))},
+      {Value(Map("a", 1, "b", 1))},
+      {Value(Map("a", 2))},
+      {Value(Map("b", 0))},
+  };
+}
+
+}  // namespace
+
+TEST(IndexValueWriterTest, EncodingOrderMatchesValueOrder) {
+  std::vector<std::vector<FieldValue>> groups = SortedValueGroups();
+  for (size_t i = 0; i < groups.size(); ++i) {
+    for (const FieldValue& value : groups[i]) {
+      std::string encoded = Encode(value);
+
+      for (const FieldValue& same : groups[i]) {
+        EXPECT_EQ(encoded, Encode(same)) << value << " vs " << same;
+      }
+
+      for (size_t j = i + 1; j < groups.size(); ++j) {
+        for (const FieldValue& greater : groups[j]) {
+          ASSERT_LT(value, greater);
+          EXPECT_LT(encoded, Encode(greater)) << value << " vs " << greater;
+        }
+      }
+    }
+  }
+}
+
+TEST(IndexValueWriterTest, EncodingsOfSequencesSortLexicographically) {
+  std::string a;
+  WriteIndexValue(Value("a"), &a);
+  WriteIndexValue(Value(2), &a);
+
+  std::string b;
+  WriteIndexValue(Value("a"), &b);
+  WriteIndexValue(Value(10), &b);
+
+  std::string c;
+  WriteIndexValue(Value("b"), &c);
+  WriteIndexValue(Value(1), &c);
+
+  EXPECT_LT(a, b);
+  EXPECT_LT(b, c);
+}
+
+TEST(IndexValueWriterTest, BoundsEncloseTypeGroup) {
+  std::vector<std::vector<FieldValue>> groups = SortedValueGroups();
+  for (const auto& group : groups) {
+    for (const FieldValue& value : group) {
+      std::string lower;
+      WriteIndexValueLowerBound(value.type(), &lower);
+      std::string upper;
+      WriteIndexValueUpperBound(value.type(), &upper);
+
+      std::string encoded = Encode(value);
+      for (const auto& other_group : groups) {
+        for (const FieldValue& other : other_group) {
+          std::string other_encoded = Encode(other);
+          bool in_bounds = lower <= other_encoded && other_encoded < upper;
+          EXPECT_EQ(FieldValue::Comparable(value.type(), other.type()),
+                    in_bounds)
+              << value << " vs " << other;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
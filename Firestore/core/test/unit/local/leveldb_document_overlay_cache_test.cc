@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/leveldb_document_overlay_cache.h"
+
+#include <memory>
+#include <vector>
+
+#include "Firestore/core/include/firebase/firestore/timestamp.h"
+#include "Firestore/core/src/auth/user.h"
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/local_documents_view.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/mutation_batch.h"
+#include "Firestore/core/src/model/no_document.h"
+#include "Firestore/core/src/model/patch_mutation.h"
+#include "Firestore/core/src/model/unknown_document.h"
+#include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using auth::User;
+using model::BatchId;
+using model::DocumentState;
+using model::MaybeDocument;
+using model::Mutation;
+using testutil::DeletedDoc;
+using testutil::Doc;
+using testutil::Key;
+using testutil::Map;
+using testutil::PatchMutation;
+using testutil::UnknownDoc;
+using testutil::Version;
+
+}  // namespace
+
+class LevelDbDocumentOverlayCacheTest : public ::testing::Test {
+ public:
+  LevelDbDocumentOverlayCacheTest()
+      : persistence_(LevelDbPersistenceForTesting()),
+        mutation_queue_(persistence_->GetMutationQueueForUser(User("user"))),
+        overlay_cache_(
+            persistence_->GetDocumentOverlayCacheForUser(User("user"))) {
+    persistence_->Run("Start", [&] { mutation_queue_->Start(); });
+  }
+
+ protected:
+  absl::optional<DocumentOverlay> Get(const model::DocumentKey& key) {
+    return persistence_->Run("Get", [&] { return overlay_cache_->Get(key); });
+  }
+
+  void Save(const model::DocumentKey& key, const DocumentOverlay& overlay) {
+    persistence_->Run("Save", [&] { overlay_cache_->Save(key, overlay); });
+  }
+
+  BatchId AddPatch(absl::string_view path) {
+    return persistence_->Run("AddPatch", [&] {
+      std::vector<Mutation> mutations = {PatchMutation(path, Map("a", 1))};
+      return mutation_queue_
+          ->AddMutationBatch(Timestamp::Now(), {}, std::move(mutations))
+          .batch_id();
+    });
+  }
+
+  std::unique_ptr<LevelDbPersistence> persistence_;
+  LevelDbMutationQueue* mutation_queue_ = nullptr;
+  LevelDbDocumentOverlayCache* overlay_cache_ = nullptr;
+};
+
+TEST_F(LevelDbDocumentOverlayCacheTest, RoundTripsOverlays) {
+  model::Document base = Doc("coll/a", 1, Map("a", 1));
+  model::Document local_view =
+      Doc("coll/a", 1, Map("a", 2), DocumentState::kLocalMutations);
+  Save(Key("coll/a"), DocumentOverlay(base, {1, 2, 3}, local_view));
+
+  absl::optional<DocumentOverlay> overlay = Get(Key("coll/a"));
+  ASSERT_TRUE(overlay);
+  EXPECT_TRUE(overlay->IsValidFor(base, {1, 2, 3}));
+  ASSERT_TRUE(overlay->local_view());
+  EXPECT_EQ(*overlay->local_view(), local_view);
+  EXPECT_TRUE(model::Document(*overlay->local_view()).has_local_mutations());
+
+  Save(Key("coll/b"),
+       DocumentOverlay(absl::nullopt, {4}, DeletedDoc("coll/b")));
+  overlay = Get(Key("coll/b"));
+  ASSERT_TRUE(overlay);
+  EXPECT_TRUE(overlay->IsValidFor(absl::nullopt, {4}));
+  EXPECT_EQ(overlay->local_view(), MaybeDocument(DeletedDoc("coll/b")));
+
+  Save(Key("coll/c"),
+       DocumentOverlay(UnknownDoc("coll/c", 2), {5}, absl::nullopt));
+  overlay = Get(Key("coll/c"));
+  ASSERT_TRUE(overlay);
+  EXPECT_TRUE(overlay->IsValidFor(UnknownDoc("coll/c", 2), {5}));
+  EXPECT_EQ(overlay->local_view(), absl::nullopt);
+
+  EXPECT_EQ(Get(Key("coll/d")), absl::nullopt);
+}
+
+TEST_F(LevelDbDocumentOverlayCacheTest, ChecksBaseDocumentAndBatches) {
+  model::Document base = Doc("coll/a", 1, Map());
+  DocumentOverlay overlay(base, {1, 2}, base);
+
+  EXPECT_TRUE(overlay.IsValidFor(base, {1, 2}));
+  EXPECT_FALSE(overlay.IsValidFor(base, {1, 3}));
+  EXPECT_FALSE(overlay.IsValidFor(base, {1}));
+  EXPECT_FALSE(overlay.IsValidFor(Doc("coll/a", 2, Map()), {1, 2}));
+  EXPECT_FALSE(overlay.IsValidFor(DeletedDoc("coll/a", 1), {1, 2}));
+  EXPECT_FALSE(overlay.IsValidFor(
+      Doc("coll/a", 1, Map(), DocumentState::kCommittedMutations), {1, 2}));
+  EXPECT_FALSE(overlay.IsValidFor(absl::nullopt, {1, 2}));
+}
+
+TEST_F(LevelDbDocumentOverlayCacheTest, MutationQueueRemovesOverlays) {
+  BatchId batch_id = AddPatch("coll/a");
+  Save(Key("coll/a"),
+       DocumentOverlay(absl::nullopt, {batch_id}, absl::nullopt));
+  Save(Key("coll/b"), DocumentOverlay(absl::nullopt, {}, absl::nullopt));
+
+  AddPatch("coll/a");
+  EXPECT_EQ(Get(Key("coll/a")), absl::nullopt);
+  EXPECT_NE(Get(Key("coll/b")), absl::nullopt);
+
+  Save(Key("coll/a"),
+       DocumentOverlay(absl::nullopt, {batch_id}, absl::nullopt));
+  persistence_->Run("Remove", [&] {
+    absl::optional<model::MutationBatch> batch =
+        mutation_queue_->LookupMutationBatch(batch_id);
+    ASSERT_TRUE(batch);
+    mutation_queue_->RemoveMutationBatch(*batch);
+  });
+  EXPECT_EQ(Get(Key("coll/a")), absl::nullopt);
+}
+
+TEST_F(LevelDbDocumentOverlayCacheTest, ReadOnlyTransactionsDoNotSave) {
+  persistence_->RunReadOnly("Save", [&] {
+    overlay_cache_->Save(Key("coll/a"),
+                         DocumentOverlay(absl::nullopt, {}, absl::nullopt));
+  });
+  EXPECT_EQ(Get(Key("coll/a")), absl::nullopt);
+}
+
+TEST_F(LevelDbDocumentOverlayCacheTest, LocalDocumentsViewUsesOverlays) {
+  LocalDocumentsView view(persistence_->remote_document_cache(),
+                          mutation_queue_, overlay_cache_,
+                          persistence_->index_manager());
+  persistence_->Run("AddBase", [&] {
+    persistence_->remote_document_cache()->Add(Doc("coll/a", 1, Map("b", 1)),
+                                               Version(1));
+  });
+  AddPatch("coll/a");
+  AddPatch("coll/a");
+  AddPatch("coll/b");
+
+  // Two batches are cheap enough to apply directly.
+  absl::optional<MaybeDocument> doc =
+      persistence_->Run("Get", [&] { return view.GetDocument(Key("coll/a")); });
+  EXPECT_EQ(Get(Key("coll/a")), absl::nullopt);
+
+  AddPatch("coll/a");
+  doc =
+      persistence_->Run("Get", [&] { return view.GetDocument(Key("coll/a")); });
+  EXPECT_EQ(doc, MaybeDocument(Doc("coll/a", 1, Map("b", 1, "a", 1),
+                                   DocumentState::kLocalMutations)));
+  absl::optional<DocumentOverlay> overlay = Get(Key("coll/a"));
+  ASSERT_TRUE(overlay);
+  EXPECT_EQ(overlay->batch_ids().size(), 3u);
+  EXPECT_EQ(overlay->local_view(), doc);
+
+  // A newer remote document makes the overlay stale.
+  persistence_->Run("UpdateBase", [&] {
+    persistence_->remote_document_cache()->Add(Doc("coll/a", 2, Map("b", 2)),
+                                               Version(2));
+  });
+  doc =
+      persistence_->Run("Get", [&] { return view.GetDocument(Key("coll/a")); });
+  EXPECT_EQ(doc, MaybeDocument(Doc("coll/a", 2, Map("b", 2, "a", 1),
+                                   DocumentState::kLocalMutations)));
+  EXPECT_EQ(Get(Key("coll/a"))->local_view(), doc);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -16,9 +16,23 @@
 
 #include "Firestore/core/test/unit/local/index_manager_test.h"
 
+#include <vector>
+
+#include "Firestore/core/src/core/bound.h"
+#include "Firestore/core/src/core/field_filter.h"
+#include "Firestore/core/src/core/query.h"
 #include "Firestore/core/src/local/leveldb_index_manager.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_remote_document_cache.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/document_map.h"
+#include "Firestore/core/src/model/field_index.h"
+#include "Firestore/core/src/model/no_document.h"
+#include "Firestore/core/src/model/resource_path.h"
+#include "Firestore/core/src/util/path.h"
 #include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
 #include "absl/memory/memory.h"
 #include "gtest/gtest.h"
 
@@ -28,16 +42,289 @@ namespace local {
 
 namespace {
 
+using core::Bound;
+using core::Query;
+using model::DocumentKeySet;
+using model::FieldIndex;
+using testutil::Doc;
+using testutil::Field;
+using testutil::Filter;
+using testutil::Key;
+using testutil::Map;
+using testutil::OrderBy;
+using testutil::Value;
+using testutil::Version;
+
 std::unique_ptr<Persistence> PersistenceFactory() {
   return LevelDbPersistenceForTesting();
 }
 
+class LevelDbFieldIndexTest : public ::testing::Test {
+ public:
+  LevelDbFieldIndexTest() : persistence_(LevelDbPersistenceForTesting()) {
+  }
+
+  ~LevelDbFieldIndexTest() override {
+    persistence_->Shutdown();
+  }
+
+ protected:
+  void AddDoc(absl::string_view key, model::FieldValue::Map data) {
+    persistence_->remote_document_cache()->Add(Doc(key, 1, data), Version(1));
+  }
+
+  absl::optional<DocumentKeySet> Match(const Query& query) {
+    return persistence_->index_manager()->GetDocumentsMatchingQuery(query);
+  }
+
+  void AddStandardDocs() {
+    AddDoc("coll/a", Map("count", 1, "name", "a"));
+    AddDoc("coll/b", Map("count", 2, "name", "b"));
+    AddDoc("coll/c", Map("count", 3, "name", "b"));
+    AddDoc("coll/d", Map("name", "d"));
+    AddDoc("coll/e", Map("count", "three"));
+    AddDoc("coll/a/coll/f", Map("count", 2));
+  }
+
+  std::unique_ptr<LevelDbPersistence> persistence_;
+};
+
+DocumentKeySet Keys(std::initializer_list<const char*> paths) {
+  DocumentKeySet result;
+  for (const char* path : paths) {
+    result = result.insert(Key(path));
+  }
+  return result;
+}
+
 }  // namespace
 
 INSTANTIATE_TEST_SUITE_P(LevelDbIndexManagerTest,
                          IndexManagerTest,
                          ::testing::Values(PersistenceFactory));
 
+TEST(LevelDbCollectionParentsTest, ReadsParentsWrittenBeforeRestart) {
+  util::Path dir = LevelDbDir();
+  {
+    auto db = LevelDbPersistenceForTesting(dir);
+    db->Run("AddParents", [&] {
+      db->index_manager()->AddToCollectionParentIndex(
+          model::ResourcePath{"a", "1", "c"});
+      db->index_manager()->AddToCollectionParentIndex(
+          model::ResourcePath{"c"});
+    });
+    db->Shutdown();
+  }
+
+  auto db = LevelDbPersistenceForTesting(dir);
+  db->Run("ReadParents", [&] {
+    IndexManager* index_manager = db->index_manager();
+    index_manager->AddToCollectionParentIndex(
+        model::ResourcePath{"b", "2", "c"});
+    EXPECT_EQ(index_manager->GetCollectionParents("c"),
+              (std::vector<model::ResourcePath>{
+                  model::ResourcePath{},
+                  model::ResourcePath{"a", "1"},
+                  model::ResourcePath{"b", "2"},
+              }));
+  });
+  db->Shutdown();
+}
+
+TEST(LevelDbCollectionParentsTest, RereadsParentsAfterReleasingMemory) {
+  auto db = LevelDbPersistenceForTesting();
+  db->Run("AddParents", [&] {
+    db->index_manager()->AddToCollectionParentIndex(
+        model::ResourcePath{"a", "1", "c"});
+  });
+
+  EXPECT_GT(db->index_manager()->ReleaseMemory(), 0u);
+  EXPECT_EQ(db->index_manager()->ReleaseMemory(), 0u);
+
+  db->Run("ReadParents", [&] {
+    EXPECT_EQ(db->index_manager()->GetCollectionParents("c"),
+              (std::vector<model::ResourcePath>{
+                  model::ResourcePath{"a", "1"},
+              }));
+  });
+  db->Shutdown();
+}
+
+TEST_F(LevelDbFieldIndexTest, NoIndexMeansNoResult) {
+  persistence_->Run("NoIndexMeansNoResult", [&] {
+    AddStandardDocs();
+    EXPECT_EQ(Match(testutil::Query("coll")), absl::nullopt);
+    EXPECT_EQ(Match(testutil::Query("coll").AddingFilter(
+                  Filter("count", "==", 1))),
+              absl::nullopt);
+  });
+}
+
+TEST_F(LevelDbFieldIndexTest, BackfillsAndMatchesEquality) {
+  persistence_->Run("BackfillsAndMatchesEquality", [&] {
+    AddStandardDocs();
+    persistence_->index_manager()->AddFieldIndex(
+        FieldIndex("coll", {Field("count")}));
+
+    EXPECT_EQ(Match(testutil::Query("coll").AddingFilter(
+                  Filter("count", "==", 2))),
+              Keys({"coll/b"}));
+    EXPECT_EQ(Match(testutil::Query("coll/a/coll").AddingFilter(
+                  Filter("count", "==", 2))),
+              Keys({"coll/a/coll/f"}));
+
+    // Integers and doubles share an encoding.
+    EXPECT_EQ(Match(testutil::Query("coll").AddingFilter(
+                  Filter("count", "==", 3.0))),
+              Keys({"coll/c"}));
+
+    // Queries that don't constrain the indexed field can't use the index.
+    EXPECT_EQ(Match(testutil::Query("coll").AddingFilter(
+                  Filter("name", "==", "b"))),
+              absl::nullopt);
+  });
+}
+
+TEST_F(LevelDbFieldIndexTest, MatchesRanges) {
+  persistence_->Run("MatchesRanges", [&] {
+    persistence_->index_manager()->AddFieldIndex(
+        FieldIndex("coll", {Field("count")}));
+    AddStandardDocs();
+
+    EXPECT_EQ(Match(testutil::Query("coll").AddingFilter(
+                  Filter("count", ">=", 2))),
+              Keys({"coll/b", "coll/c"}));
+    // Strict bounds are widened, so the result is a superset.
+    EXPECT_EQ(Match(testutil::Query("coll")
+                        .AddingFilter(Filter("count", ">", 1))
+                        .AddingFilter(Filter("count", "<", 3))),
+              Keys({"coll/a", "coll/b", "coll/c"}));
+    EXPECT_EQ(Match(testutil::Query("coll").AddingFilter(
+                  Filter("count", "<=", 1))),
+              Keys({"coll/a"}));
+    EXPECT_EQ(Match(testutil::Query("coll").AddingFilter(
+                  Filter("count", ">", "a"))),
+              Keys({"coll/e"}));
+  });
+}
+
+TEST_F(LevelDbFieldIndexTest, MatchesCompositeIndex) {
+  persistence_->Run("MatchesCompositeIndex", [&] {
+    persistence_->index_manager()->AddFieldIndex(
+        FieldIndex("coll", {Field("name"), Field("count")}));
+    AddStandardDocs();
+
+    EXPECT_EQ(Match(testutil::Query("coll")
+                        .AddingFilter(Filter("name", "==", "b"))
+                        .AddingFilter(Filter("count", ">=", 3))),
+              Keys({"coll/c"}));
+    EXPECT_EQ(Match(testutil::Query("coll")
+                        .AddingFilter(Filter("name", "==", "b"))
+                        .AddingOrderBy(OrderBy("count"))),
+              Keys({"coll/b", "coll/c"}));
+  });
+}
+
+TEST_F(LevelDbFieldIndexTest, MatchesBounds) {
+  persistence_->Run("MatchesBounds", [&] {
+    persistence_->index_manager()->AddFieldIndex(
+        FieldIndex("coll", {Field("count")}));
+    AddStandardDocs();
+
+    Query query = testutil::Query("coll").AddingOrderBy(OrderBy("count"));
+    // Bounds are inclusive, so the result is a superset.
+    EXPECT_EQ(Match(query.StartingAt(Bound({Value(2)}, false))),
+              Keys({"coll/b", "coll/c", "coll/e"}));
+    EXPECT_EQ(Match(query.StartingAt(Bound({Value(2)}, true))
+                        .EndingAt(Bound({Value(3)}, true))),
+              Keys({"coll/b", "coll/c"}));
+
+    Query descending =
+        testutil::Query("coll").AddingOrderBy(OrderBy("count", "desc"));
+    EXPECT_EQ(Match(descending.StartingAt(Bound({Value(2)}, true))),
+              Keys({"coll/a", "coll/b"}));
+
+    // Bounds narrow a range computed from the filters.
+    EXPECT_EQ(Match(query.AddingFilter(Filter("count", "<=", 2))
+                        .StartingAt(Bound({Value(2)}, true))),
+              Keys({"coll/b"}));
+  });
+}
+
+TEST_F(LevelDbFieldIndexTest, PrefersMoreSelectiveIndex) {
+  persistence_->Run("PrefersMoreSelectiveIndex", [&] {
+    LevelDbIndexManager* index_manager = persistence_->index_manager();
+    index_manager->AddFieldIndex(FieldIndex("coll", {Field("name")}));
+    index_manager->AddFieldIndex(
+        FieldIndex("coll", {Field("name"), Field("count")}));
+    AddStandardDocs();
+
+    EXPECT_EQ(Match(testutil::Query("coll")
+                        .AddingFilter(Filter("name", "==", "b"))
+                        .AddingFilter(Filter("count", "==", 2))),
+              Keys({"coll/b"}));
+  });
+}
+
+TEST_F(LevelDbFieldIndexTest, UpdatesAndRemovesEntries) {
+  persistence_->Run("UpdatesAndRemovesEntries", [&] {
+    persistence_->index_manager()->AddFieldIndex(
+        FieldIndex("coll", {Field("count")}));
+    AddStandardDocs();
+    Query query =
+        testutil::Query("coll").AddingFilter(Filter("count", "==", 2));
+
+    AddDoc("coll/a", Map("count", 2));
+    EXPECT_EQ(Match(query), Keys({"coll/a", "coll/b"}));
+
+    AddDoc("coll/a", Map("other", 2));
+    EXPECT_EQ(Match(query), Keys({"coll/b"}));
+
+    persistence_->remote_document_cache()->Add(testutil::DeletedDoc("coll/b"),
+                                               Version(2));
+    EXPECT_EQ(Match(query), Keys({}));
+
+    AddDoc("coll/c", Map("count", 2));
+    persistence_->remote_document_cache()->Remove(Key("coll/c"));
+    EXPECT_EQ(Match(query), Keys({}));
+  });
+}
+
+TEST_F(LevelDbFieldIndexTest, DeleteFieldIndexRemovesEntries) {
+  persistence_->Run("DeleteFieldIndexRemovesEntries", [&] {
+    LevelDbIndexManager* index_manager = persistence_->index_manager();
+    index_manager->AddFieldIndex(FieldIndex("coll", {Field("count")}));
+    AddStandardDocs();
+    index_manager->DeleteFieldIndex(FieldIndex("coll", {Field("count")}));
+
+    Query query =
+        testutil::Query("coll").AddingFilter(Filter("count", "==", 2));
+    EXPECT_EQ(Match(query), absl::nullopt);
+
+    // Re-adding the index backfills it from scratch.
+    index_manager->AddFieldIndex(FieldIndex("coll", {Field("count")}));
+    EXPECT_EQ(Match(query), Keys({"coll/b"}));
+  });
+}
+
+TEST_F(LevelDbFieldIndexTest, GetMatchingUsesIndex) {
+  persistence_->Run("GetMatchingUsesIndex", [&] {
+    persistence_->index_manager()->AddFieldIndex(
+        FieldIndex("coll", {Field("count")}));
+    AddStandardDocs();
+
+    model::DocumentMap documents =
+        persistence_->remote_document_cache()->GetMatching(
+            testutil::Query("coll").AddingFilter(Filter("count", ">", 1)),
+            model::SnapshotVersion::None());
+    DocumentKeySet keys;
+    for (const auto& kv : documents.underlying_map()) {
+      keys = keys.insert(kv.first);
+    }
+    EXPECT_EQ(keys, Keys({"coll/a", "coll/b", "coll/c"}));
+  });
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
@@ -24,6 +24,7 @@
 
 using firebase::firestore::model::BatchId;
 using firebase::firestore::model::DocumentKey;
+using firebase::firestore::model::ResourcePath;
 using firebase::firestore::model::SnapshotVersion;
 using firebase::firestore::model::TargetId;
 
@@ -223,6 +224,42 @@ TEST(LevelDbDocumentMutationKeyTest, Description) {
       "[document_mutation: user_id=user1 path=foo/bar batch_id=42]", key);
 }
 
+TEST(LevelDbCollectionMutationKeyTest, EncodeDecodeCycle) {
+  LevelDbCollectionMutationKey key;
+  auto encoded = LevelDbCollectionMutationKey::Key(
+      "foo", testutil::Resource("a/b/c"), 42);
+
+  ASSERT_TRUE(key.Decode(encoded));
+  ASSERT_EQ("foo", key.user_id());
+  ASSERT_EQ(testutil::Resource("a/b/c"), key.collection_path());
+  ASSERT_EQ(42, key.batch_id());
+}
+
+TEST(LevelDbCollectionMutationKeyTest, Ordering) {
+  auto key = [](absl::string_view path, BatchId batch_id) {
+    return LevelDbCollectionMutationKey::Key("1", testutil::Resource(path),
+                                             batch_id);
+  };
+
+  // All rows of a collection sort before those of its subcollections.
+  ASSERT_LT(key("foo", 0), key("foo", 1));
+  ASSERT_LT(key("foo", 100), key("foo/bar/baz", 0));
+  ASSERT_LT(key("foo/bar/baz", 0), key("foo2", 0));
+
+  std::string prefix =
+      LevelDbCollectionMutationKey::KeyPrefix("1", testutil::Resource("foo"));
+  ASSERT_TRUE(absl::StartsWith(key("foo", 0), prefix));
+  ASSERT_TRUE(absl::StartsWith(key("foo/bar/baz", 0), prefix));
+  ASSERT_FALSE(absl::StartsWith(key("foo2", 0), prefix));
+}
+
+TEST(LevelDbCollectionMutationKeyTest, Description) {
+  AssertExpectedKeyDescription(
+      "[collection_mutation: user_id=user1 path=foo/bar/baz batch_id=42]",
+      LevelDbCollectionMutationKey::Key("user1",
+                                        testutil::Resource("foo/bar/baz"), 42));
+}
+
 TEST(LevelDbTargetGlobalKeyTest, EncodeDecodeCycle) {
   LevelDbTargetGlobalKey key;
 
@@ -297,6 +334,50 @@ TEST(TargetDocumentKeyTest, Description) {
   ASSERT_EQ("[target_document: target_id=42 path=foo/bar]", DescribeKey(key));
 }
 
+TEST(TargetDocumentBlockKeyTest, EncodeDecodeCycle) {
+  LevelDbTargetDocumentBlockKey key;
+  auto encoded = LevelDbTargetDocumentBlockKey::Key(42, 7);
+  ASSERT_TRUE(key.Decode(encoded));
+  ASSERT_EQ(42, key.target_id());
+  ASSERT_EQ(7, key.block_id());
+}
+
+TEST(TargetDocumentBlockKeyTest, ValueEncodeDecodeCycle) {
+  std::vector<DocumentKey> document_keys{
+      testutil::Key("coll/a"), testutil::Key("coll/ab"),
+      testutil::Key("coll/ab/sub/c"), testutil::Key("coll/b"),
+      testutil::Key("other/x")};
+  std::string encoded =
+      LevelDbTargetDocumentBlockKey::EncodeValue(document_keys);
+
+  std::vector<DocumentKey> decoded;
+  ASSERT_TRUE(LevelDbTargetDocumentBlockKey::DecodeValue(encoded, &decoded));
+  ASSERT_EQ(document_keys, decoded);
+
+  ASSERT_TRUE(LevelDbTargetDocumentBlockKey::DecodeValue("", &decoded));
+  ASSERT_TRUE(decoded.empty());
+  ASSERT_FALSE(LevelDbTargetDocumentBlockKey::DecodeValue(
+      encoded.substr(0, encoded.size() - 1), &decoded));
+}
+
+TEST(TargetDocumentBlockKeyTest, BlockIdsAreStableAndInRange) {
+  // The assignment is persisted, so it must never change.
+  ASSERT_EQ(42,
+            LevelDbTargetDocumentBlockKey::BlockIdFor(testutil::Key("a/b")));
+  for (int i = 0; i < 100; ++i) {
+    int32_t block_id = LevelDbTargetDocumentBlockKey::BlockIdFor(
+        testutil::Key("coll/doc" + std::to_string(i)));
+    ASSERT_GE(block_id, 0);
+    ASSERT_LT(block_id, LevelDbTargetDocumentBlockKey::kBlockCount);
+  }
+}
+
+TEST(TargetDocumentBlockKeyTest, Description) {
+  AssertExpectedKeyDescription(
+      "[target_document_block: target_id=42 block_id=7]",
+      LevelDbTargetDocumentBlockKey::Key(42, 7));
+}
+
 TEST(DocumentTargetKeyTest, EncodeDecodeCycle) {
   LevelDbDocumentTargetKey key;
 
@@ -326,6 +407,20 @@ TEST(DocumentTargetKeyTest, Ordering) {
   ASSERT_LT(DocTargetKey("foo/bar", 42), DocTargetKey("foo/bar", 100));
 }
 
+TEST(DocumentTargetKeyViewTest, EncodeDecodeCycle) {
+  LevelDbDocumentTargetKeyView key;
+
+  auto encoded = DocTargetKey("foo/bar", 42);
+  ASSERT_TRUE(key.Decode(encoded));
+  ASSERT_EQ(key.document_key(), testutil::Key("foo/bar"));
+  ASSERT_EQ(42, key.target_id());
+  ASSERT_FALSE(key.IsSentinel());
+
+  encoded = LevelDbDocumentTargetKey::SentinelKey(testutil::Key("foo/bar"));
+  ASSERT_TRUE(key.Decode(encoded));
+  ASSERT_TRUE(key.IsSentinel());
+}
+
 TEST(RemoteDocumentKeyTest, Prefixing) {
   auto table_key = LevelDbRemoteDocumentKey::KeyPrefix();
 
@@ -371,6 +466,116 @@ TEST(RemoteDocumentKeyTest, Description) {
       LevelDbRemoteDocumentKey::Key(testutil::Key("foo/bar/baz/quux")));
 }
 
+TEST(RemoteDocumentKeyViewTest, EncodeDecodeCycle) {
+  LevelDbRemoteDocumentKeyView key;
+
+  std::vector<std::string> paths{"foo/bar", "foo/bar2", "foo/bar/baz/quux"};
+  for (auto&& path : paths) {
+    auto encoded = RemoteDocKey(path);
+    ASSERT_TRUE(key.Decode(encoded));
+    ASSERT_EQ(key.document_key(), testutil::Key(path));
+    ASSERT_EQ(testutil::Key(path), key.document_key().ToDocumentKey());
+    ASSERT_EQ(testutil::Resource(path).size(),
+              key.document_key().segment_count());
+  }
+}
+
+TEST(RemoteDocumentKeyViewTest, ComparesToDocumentKeys) {
+  LevelDbRemoteDocumentKeyView key;
+
+  auto encoded = RemoteDocKey("foo/bar");
+  ASSERT_TRUE(key.Decode(encoded));
+  ASSERT_NE(key.document_key(), testutil::Key("foo/baz"));
+  ASSERT_NE(key.document_key(), testutil::Key("foo/bar2"));
+  ASSERT_NE(key.document_key(), testutil::Key("foo/ba"));
+  ASSERT_NE(key.document_key(), testutil::Key("foo/bar/baz/quux"));
+
+  // Segments with bytes that need escaping.
+  DocumentKey escaped{ResourcePath{"foo", std::string("b\0\xffr", 4)}};
+  encoded = LevelDbRemoteDocumentKey::Key(escaped);
+  ASSERT_TRUE(key.Decode(encoded));
+  ASSERT_EQ(key.document_key(), escaped);
+  ASSERT_EQ(escaped, key.document_key().ToDocumentKey());
+  ASSERT_NE(key.document_key(), testutil::Key("foo/br"));
+}
+
+TEST(RemoteDocumentKeyViewTest, RejectsOtherKeys) {
+  LevelDbRemoteDocumentKeyView key;
+
+  ASSERT_FALSE(key.Decode(DocTargetKey("foo/bar", 42)));
+  ASSERT_FALSE(key.Decode(RemoteDocKeyPrefix("foo")));
+}
+
+TEST(CollectionDictionaryKeyTest, EncodeDecodeCycle) {
+  LevelDbCollectionDictionaryKey key;
+
+  std::vector<std::string> paths{"foo", "foo/bar/baz"};
+  for (auto&& path : paths) {
+    auto encoded =
+        LevelDbCollectionDictionaryKey::Key(testutil::Resource(path));
+    ASSERT_TRUE(key.Decode(encoded));
+    ASSERT_EQ(testutil::Resource(path), key.collection_path());
+  }
+
+  ASSERT_FALSE(key.Decode(LevelDbCollectionDictionaryGlobalKey::Key()));
+  ASSERT_FALSE(
+      key.Decode(LevelDbCollectionDictionaryKey::Key(testutil::Resource(""))));
+
+  int32_t number = 0;
+  ASSERT_TRUE(LevelDbCollectionDictionaryKey::DecodeValue(
+      LevelDbCollectionDictionaryKey::EncodeValue(1234), &number));
+  ASSERT_EQ(1234, number);
+  ASSERT_FALSE(LevelDbCollectionDictionaryKey::DecodeValue("", &number));
+}
+
+TEST(CollectionDictionaryKeyTest, Description) {
+  AssertExpectedKeyDescription(
+      "[collection_dictionary: path=foo/bar/baz]",
+      LevelDbCollectionDictionaryKey::Key(testutil::Resource("foo/bar/baz")));
+  AssertExpectedKeyDescription(
+      "[collection_dictionary_global:]",
+      LevelDbCollectionDictionaryGlobalKey::Key());
+}
+
+TEST(CollectionDocumentKeyTest, Prefixing) {
+  auto table_key = LevelDbCollectionDocumentKey::KeyPrefix();
+  ASSERT_TRUE(absl::StartsWith(LevelDbCollectionDocumentKey::Key(1, "a"),
+                               table_key));
+  ASSERT_TRUE(absl::StartsWith(LevelDbCollectionDocumentKey::Key(1, "a"),
+                               LevelDbCollectionDocumentKey::KeyPrefix(1)));
+
+  // The documents of collection 1 don't share a prefix with those of 10.
+  ASSERT_FALSE(absl::StartsWith(LevelDbCollectionDocumentKey::Key(10, "a"),
+                                LevelDbCollectionDocumentKey::KeyPrefix(1)));
+}
+
+TEST(CollectionDocumentKeyTest, Ordering) {
+  ASSERT_LT(LevelDbCollectionDocumentKey::Key(1, "bar"),
+            LevelDbCollectionDocumentKey::Key(1, "bar2"));
+  ASSERT_LT(LevelDbCollectionDocumentKey::Key(1, "baz"),
+            LevelDbCollectionDocumentKey::Key(2, "bar"));
+  ASSERT_LT(LevelDbCollectionDocumentKey::Key(2, "bar"),
+            LevelDbCollectionDocumentKey::Key(10, "bar"));
+}
+
+TEST(CollectionDocumentKeyTest, EncodeDecodeCycle) {
+  LevelDbCollectionDocumentKey key;
+
+  auto encoded = LevelDbCollectionDocumentKey::Key(42, "foo-bar");
+  ASSERT_TRUE(key.Decode(encoded));
+  ASSERT_EQ(42, key.collection_number());
+  ASSERT_EQ("foo-bar", key.document_id());
+
+  ASSERT_FALSE(key.Decode(LevelDbCollectionDocumentKey::KeyPrefix(42)));
+  ASSERT_FALSE(key.Decode(RemoteDocKey("foo/bar")));
+}
+
+TEST(CollectionDocumentKeyTest, Description) {
+  AssertExpectedKeyDescription(
+      "[collection_document: collection_number=42 document_id=foo-bar]",
+      LevelDbCollectionDocumentKey::Key(42, "foo-bar"));
+}
+
 TEST(RemoteDocumentReadTimeKeyTest, Ordering) {
   // Different collection paths:
   ASSERT_LT(RemoteDocumentReadTimeKeyPrefix("bar", 1),
@@ -491,6 +696,111 @@ TEST(NamedQueryKeyTest, Description) {
                                LevelDbNamedQueryKey::Key("foo-bar?baz!quux"));
 }
 
+TEST(FieldIndexKeyTest, EncodeDecodeCycle) {
+  LevelDbFieldIndexKey key;
+
+  for (int32_t index_id : {1, 2, 1000}) {
+    auto encoded = LevelDbFieldIndexKey::Key(index_id);
+    bool ok = key.Decode(encoded);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(index_id, key.index_id());
+    ASSERT_TRUE(absl::StartsWith(encoded, LevelDbFieldIndexKey::KeyPrefix()));
+  }
+}
+
+TEST(FieldIndexKeyTest, Description) {
+  AssertExpectedKeyDescription("[field_index: index_id=7]",
+                               LevelDbFieldIndexKey::Key(7));
+}
+
+TEST(IndexEntryKeyTest, Prefixing) {
+  auto index_key = LevelDbIndexEntryKey::KeyPrefix(1);
+
+  ASSERT_TRUE(absl::StartsWith(
+      LevelDbIndexEntryKey::Key(1, "abc", testutil::Key("foo/bar")),
+      index_key));
+  ASSERT_FALSE(absl::StartsWith(
+      LevelDbIndexEntryKey::Key(2, "abc", testutil::Key("foo/bar")),
+      index_key));
+}
+
+TEST(IndexEntryKeyTest, Ordering) {
+  // Entries are ordered by index values first ...
+  ASSERT_LT(LevelDbIndexEntryKey::Key(1, "a", testutil::Key("foo/z")),
+            LevelDbIndexEntryKey::Key(1, "b", testutil::Key("foo/a")));
+  ASSERT_LT(LevelDbIndexEntryKey::Key(1, "a", testutil::Key("foo/z")),
+            LevelDbIndexEntryKey::Key(1, "ab", testutil::Key("foo/a")));
+
+  // ... then by document.
+  ASSERT_LT(LevelDbIndexEntryKey::Key(1, "a", testutil::Key("foo/a")),
+            LevelDbIndexEntryKey::Key(1, "a", testutil::Key("foo/b")));
+
+  // A values prefix sorts no later than all entries with values at least as
+  // large.
+  ASSERT_LE(LevelDbIndexEntryKey::KeyPrefix(1, "a"),
+            LevelDbIndexEntryKey::Key(1, "a", testutil::Key("foo/a")));
+  ASSERT_LE(LevelDbIndexEntryKey::KeyPrefix(1, "a"),
+            LevelDbIndexEntryKey::Key(1, std::string("a\0", 2),
+                                      testutil::Key("foo/a")));
+  ASSERT_GT(LevelDbIndexEntryKey::KeyPrefix(1, "b"),
+            LevelDbIndexEntryKey::Key(1, "a", testutil::Key("foo/a")));
+}
+
+TEST(IndexEntryKeyTest, EncodeDecodeCycle) {
+  LevelDbIndexEntryKey key;
+
+  std::vector<std::string> values{"", "abc", std::string("\0\xff\x01", 3)};
+  for (auto&& value : values) {
+    auto encoded =
+        LevelDbIndexEntryKey::Key(3, value, testutil::Key("foo/bar/baz/qux"));
+    bool ok = key.Decode(encoded);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(3, key.index_id());
+    ASSERT_EQ(value, key.index_values());
+    ASSERT_EQ(testutil::Key("foo/bar/baz/qux"), key.document_key());
+  }
+}
+
+TEST(IndexEntryKeyTest, Description) {
+  AssertExpectedKeyDescription(
+      "[index_entry: index_id=1 index_values=abc path=foo/bar]",
+      LevelDbIndexEntryKey::Key(1, "abc", testutil::Key("foo/bar")));
+}
+
+TEST(IndexDocumentKeyTest, EncodeDecodeCycle) {
+  LevelDbIndexDocumentKey key;
+
+  auto encoded = LevelDbIndexDocumentKey::Key(4, testutil::Key("foo/bar"));
+  bool ok = key.Decode(encoded);
+  ASSERT_TRUE(ok);
+  ASSERT_EQ(4, key.index_id());
+  ASSERT_EQ(testutil::Key("foo/bar"), key.document_key());
+  ASSERT_TRUE(absl::StartsWith(encoded, LevelDbIndexDocumentKey::KeyPrefix(4)));
+}
+
+TEST(IndexDocumentKeyTest, Description) {
+  AssertExpectedKeyDescription("[index_document: index_id=4 path=foo/bar]",
+                               LevelDbIndexDocumentKey::Key(
+                                   4, testutil::Key("foo/bar")));
+}
+
+TEST(MigrationCursorKeyTest, EncodeDecodeCycle) {
+  LevelDbMigrationCursorKey key;
+  ASSERT_TRUE(key.Decode(LevelDbMigrationCursorKey::Key()));
+
+  std::string last_key = LevelDbRemoteDocumentKey::Key(testutil::Key("a/b"));
+  std::string encoded = LevelDbMigrationCursorKey::EncodeValue(6, last_key);
+  int32_t version = 0;
+  std::string decoded;
+  ASSERT_TRUE(
+      LevelDbMigrationCursorKey::DecodeValue(encoded, &version, &decoded));
+  ASSERT_EQ(6, version);
+  ASSERT_EQ(last_key, decoded);
+
+  ASSERT_FALSE(LevelDbMigrationCursorKey::DecodeValue(
+      encoded.substr(0, encoded.size() - 1), &version, &decoded));
+}
+
 #undef AssertExpectedKeyDescription
 
 }  // namespace local
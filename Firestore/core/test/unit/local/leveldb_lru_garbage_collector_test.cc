@@ -20,9 +20,14 @@
 #include "Firestore/core/src/local/leveldb_persistence.h"
 #include "Firestore/core/src/local/lru_garbage_collector.h"
 #include "Firestore/core/src/local/persistence.h"
+#include "Firestore/core/src/local/reference_set.h"
+#include "Firestore/core/src/model/document.h"
 #include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/util/executor.h"
+#include "Firestore/core/src/util/statusor.h"
 #include "Firestore/core/test/unit/local/lru_garbage_collector_test.h"
 #include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
 #include "gtest/gtest.h"
 
 namespace firebase {
@@ -31,6 +36,12 @@ namespace local {
 namespace {
 
 using model::DocumentKey;
+using testutil::Doc;
+using testutil::Key;
+using testutil::Map;
+using testutil::Version;
+using util::Executor;
+using util::StatusOr;
 
 class TestHelper : public LruGarbageCollectorTestHelper {
  public:
@@ -61,6 +72,81 @@ INSTANTIATE_TEST_SUITE_P(LevelDbLruGarbageCollectorTest,
                          LruGarbageCollectorTest,
                          ::testing::Values(Factory));
 
+TEST(LevelDbLruGarbageCollectorCompactionTest, CompactsCollectedDocuments) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting();
+  persistence->EnableBackgroundCompaction(
+      Executor::CreateSerial("LevelDbLruGarbageCollectorCompactionTest"));
+  LevelDbLruReferenceDelegate* delegate = persistence->reference_delegate();
+  ReferenceSet references;
+  delegate->AddInMemoryPins(&references);
+
+  StatusOr<int64_t> initial_size = persistence->CalculateByteSize();
+  ASSERT_TRUE(initial_size.ok());
+
+  std::string contents(10000, 'x');
+  persistence->Run("Add orphaned document", [&] {
+    persistence->remote_document_cache()->Add(
+        Doc("coll/a", 1, Map("contents", contents)), Version(1));
+    delegate->RemoveMutationReference(Key("coll/a"));
+  });
+
+  // The estimate accounts for the write without rescanning the directory.
+  StatusOr<int64_t> grown_size = persistence->CalculateByteSize();
+  ASSERT_TRUE(grown_size.ok());
+  EXPECT_GE(grown_size.ValueOrDie(),
+            initial_size.ValueOrDie() + static_cast<int64_t>(contents.size()));
+
+  persistence->Run("Collect garbage", [&] {
+    EXPECT_EQ(delegate->RemoveOrphanedDocuments(
+                  persistence->current_sequence_number()),
+              1);
+  });
+  persistence->Run("Verify", [&] {
+    EXPECT_EQ(persistence->remote_document_cache()->Get(Key("coll/a")),
+              absl::nullopt);
+  });
+
+  // Shutting down stops the compaction before the database is closed.
+  persistence->Shutdown();
+}
+
+TEST(LevelDbLruGarbageCollectorHistogramTest, EstimatesFromSavedHistogram) {
+  LruParams params = LruParams::Default();
+  params.min_bytes_threshold = 100;
+  params.approximate_sequence_numbers = true;
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting(params);
+  LevelDbLruReferenceDelegate* delegate = persistence->reference_delegate();
+  ReferenceSet references;
+  delegate->AddInMemoryPins(&references);
+
+  for (int i = 0; i < 100; i++) {
+    persistence->Run("Add orphaned document", [&] {
+      model::Document doc = Doc("coll/doc" + std::to_string(i), 1, Map());
+      persistence->remote_document_cache()->Add(doc, Version(1));
+      delegate->RemoveMutationReference(doc.key());
+    });
+  }
+
+  // Without a saved histogram, the first collection counts exactly.
+  LruResults results = persistence->Run("Collect garbage", [&] {
+    return delegate->garbage_collector()->Collect({});
+  });
+  ASSERT_TRUE(results.did_run);
+  EXPECT_EQ(results.sequence_numbers_collected, 10);
+  EXPECT_EQ(results.documents_removed, 10);
+
+  // The second one estimates from the 90 documents the first one kept. Few
+  // enough sequence numbers have been used for the histogram to be exact.
+  results = persistence->Run("Collect garbage", [&] {
+    return delegate->garbage_collector()->Collect({});
+  });
+  ASSERT_TRUE(results.did_run);
+  EXPECT_EQ(results.sequence_numbers_collected, 9);
+  EXPECT_EQ(results.documents_removed, 9);
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
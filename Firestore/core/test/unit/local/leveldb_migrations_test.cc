@@ -16,6 +16,7 @@
 
 #include "Firestore/core/src/local/leveldb_migrations.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <string>
@@ -30,6 +31,7 @@
 #include "Firestore/core/test/unit/local/persistence_testing.h"
 #include "Firestore/core/test/unit/testutil/testutil.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "leveldb/db.h"
@@ -45,6 +47,7 @@ using leveldb::Status;
 using model::BatchId;
 using model::DocumentKey;
 using model::ListenSequenceNumber;
+using model::ResourcePath;
 using model::TargetId;
 using nanopb::Message;
 using testutil::Key;
@@ -459,6 +462,257 @@ TEST_F(LevelDbMigrationsTest, CreateCollectionParentsIndex) {
   }
 }
 
+TEST_F(LevelDbMigrationsTest, ComputesSizeCounters) {
+  LevelDbMigrations::RunMigrations(db_.get(), 6);
+  std::string document_key = LevelDbRemoteDocumentKey::Key(Key("coll/a"));
+  std::string target_key = LevelDbTargetKey::Key(2);
+  std::string mutation_key = LevelDbMutationKey::Key("user", 3);
+  {
+    LevelDbTransaction transaction(db_.get(), "Write rows");
+    transaction.Put(document_key, std::string(10, 'd'));
+    transaction.Put(target_key, std::string(20, 't'));
+    transaction.Put(mutation_key, std::string(30, 'm'));
+    transaction.Commit();
+  }
+
+  LevelDbMigrations::RunMigrations(db_.get(), 7);
+  std::string value;
+  ASSERT_TRUE(db_->Get(leveldb::ReadOptions(), LevelDbSizeCountersKey::Key(),
+                       &value)
+                  .ok());
+  std::vector<int64_t> byte_sizes;
+  ASSERT_TRUE(LevelDbSizeCountersKey::DecodeValue(value, &byte_sizes));
+
+  std::vector<int64_t> expected_sizes = {
+      static_cast<int64_t>(document_key.size() + 10),
+      static_cast<int64_t>(target_key.size() + 20),
+      static_cast<int64_t>(mutation_key.size() + 30),
+  };
+  ASSERT_EQ(byte_sizes, expected_sizes);
+}
+
+TEST_F(LevelDbMigrationsTest, RebuildsCollectionMutationIndex) {
+  LevelDbMigrations::RunMigrations(db_.get(), 7);
+  std::string empty_buffer;
+  std::string stale_key = LevelDbCollectionMutationKey::Key(
+      "user", ResourcePath::FromString("stale"), 1);
+  {
+    LevelDbTransaction transaction(db_.get(), "Write mutations");
+    transaction.Put(LevelDbDocumentMutationKey::Key("user", Key("coll/a"), 2),
+                    empty_buffer);
+    transaction.Put(LevelDbDocumentMutationKey::Key("user", Key("coll/b"), 2),
+                    empty_buffer);
+    transaction.Put(
+        LevelDbDocumentMutationKey::Key("user", Key("coll/a/sub/c"), 3),
+        empty_buffer);
+    transaction.Put(stale_key, empty_buffer);
+    transaction.Commit();
+  }
+
+  LevelDbMigrations::RunMigrations(db_.get(), 8);
+  std::vector<std::string> actual_rows;
+  LevelDbTransaction transaction(db_.get(), "Verify");
+  auto it = transaction.NewIterator();
+  std::string prefix = LevelDbCollectionMutationKey::KeyPrefix();
+  LevelDbCollectionMutationKey row_key;
+  for (it->Seek(prefix); it->Valid() && absl::StartsWith(it->key(), prefix);
+       it->Next()) {
+    ASSERT_TRUE(row_key.Decode(it->key()));
+    actual_rows.push_back(
+        absl::StrCat(row_key.user_id(), ":",
+                     row_key.collection_path().CanonicalString(), ":",
+                     row_key.batch_id()));
+  }
+
+  std::vector<std::string> expected_rows = {"user:coll:2",
+                                            "user:coll/a/sub:3"};
+  ASSERT_EQ(actual_rows, expected_rows);
+}
+
+TEST_F(LevelDbMigrationsTest, ResumesInterruptedMigration) {
+  LevelDbMigrations::RunMigrations(db_.get(), 7);
+  std::string empty_buffer;
+  std::string done_key = LevelDbCollectionMutationKey::Key(
+      "user", ResourcePath::FromString("done"), 1);
+  std::string processed_key =
+      LevelDbDocumentMutationKey::Key("user", Key("coll/a"), 2);
+  {
+    // Simulate a run of migration 8 that was interrupted after processing
+    // the first document_mutation row.
+    LevelDbTransaction transaction(db_.get(), "Write mutations");
+    transaction.Put(processed_key, empty_buffer);
+    transaction.Put(LevelDbDocumentMutationKey::Key("user", Key("other/b"), 3),
+                    empty_buffer);
+    transaction.Put(done_key, empty_buffer);
+    transaction.Put(LevelDbMigrationCursorKey::Key(),
+                    LevelDbMigrationCursorKey::EncodeValue(8, processed_key));
+    transaction.Commit();
+  }
+
+  LevelDbMigrations::RunMigrations(db_.get(), 8);
+  ASSERT_EQ(LevelDbMigrations::ReadSchemaVersion(db_.get()), 8);
+
+  LevelDbTransaction transaction(db_.get(), "Verify");
+  std::string value;
+  // Rows written before the interruption are kept, and processed rows aren't
+  // visited again.
+  ASSERT_TRUE(transaction.Get(done_key, &value).ok());
+  ASSERT_TRUE(transaction
+                  .Get(LevelDbCollectionMutationKey::Key(
+                           "user", ResourcePath::FromString("coll"), 2),
+                       &value)
+                  .IsNotFound());
+  ASSERT_TRUE(transaction
+                  .Get(LevelDbCollectionMutationKey::Key(
+                           "user", ResourcePath::FromString("other"), 3),
+                       &value)
+                  .ok());
+  ASSERT_TRUE(
+      transaction.Get(LevelDbMigrationCursorKey::Key(), &value).IsNotFound());
+}
+
+TEST_F(LevelDbMigrationsTest, BuildsTargetDocumentBlocks) {
+  LevelDbMigrations::RunMigrations(db_.get(), 8);
+  DocumentKey key1 = Key("coll/a");
+  DocumentKey key2 = Key("coll/b");
+  std::string empty_buffer;
+  {
+    LevelDbTransaction transaction(db_.get(), "Write targets");
+    transaction.Put(LevelDbTargetKey::Key(1), empty_buffer);
+    transaction.Put(LevelDbTargetDocumentKey::Key(1, key1), empty_buffer);
+    transaction.Put(LevelDbTargetDocumentKey::Key(1, key2), empty_buffer);
+    transaction.Put(LevelDbDocumentTargetKey::Key(key1, 1), empty_buffer);
+    transaction.Put(LevelDbDocumentTargetKey::Key(key2, 1), empty_buffer);
+    transaction.Put(LevelDbDocumentTargetKey::SentinelKey(key1), "1");
+
+    // Target 2 no longer exists.
+    transaction.Put(LevelDbDocumentTargetKey::Key(key2, 2), empty_buffer);
+    transaction.Commit();
+  }
+
+  LevelDbMigrations::RunMigrations(db_.get(), 9);
+  LevelDbTransaction transaction(db_.get(), "Verify");
+  ASSERT_THAT(LevelDbTargetDocumentKey::Key(1, key1), IsNotFound(&transaction));
+  ASSERT_THAT(LevelDbTargetDocumentKey::Key(1, key2), IsNotFound(&transaction));
+  ASSERT_THAT(LevelDbDocumentTargetKey::Key(key2, 2), IsNotFound(&transaction));
+  ASSERT_THAT(LevelDbDocumentTargetKey::Key(key1, 1), IsFound(&transaction));
+  ASSERT_THAT(LevelDbDocumentTargetKey::SentinelKey(key1),
+              IsFound(&transaction));
+
+  std::vector<DocumentKey> actual_keys;
+  std::string prefix = LevelDbTargetDocumentBlockKey::KeyPrefix();
+  auto it = transaction.NewIterator();
+  LevelDbTargetDocumentBlockKey row_key;
+  for (it->Seek(prefix); it->Valid() && absl::StartsWith(it->key(), prefix);
+       it->Next()) {
+    ASSERT_TRUE(row_key.Decode(it->key()));
+    ASSERT_EQ(row_key.target_id(), 1);
+    std::vector<DocumentKey> block_keys;
+    ASSERT_TRUE(
+        LevelDbTargetDocumentBlockKey::DecodeValue(it->value(), &block_keys));
+    for (const DocumentKey& key : block_keys) {
+      ASSERT_EQ(row_key.block_id(),
+                LevelDbTargetDocumentBlockKey::BlockIdFor(key));
+      actual_keys.push_back(key);
+    }
+  }
+  std::sort(actual_keys.begin(), actual_keys.end());
+  ASSERT_EQ(actual_keys, (std::vector<DocumentKey>{key1, key2}));
+}
+
+TEST_F(LevelDbMigrationsTest, MovesRemoteDocumentsToCollections) {
+  LevelDbMigrations::RunMigrations(db_.get(), 9);
+  std::string legacy_key1 = LevelDbRemoteDocumentKey::Key(Key("coll/a"));
+  std::string legacy_key2 = LevelDbRemoteDocumentKey::Key(Key("coll/b"));
+  std::string legacy_key3 = LevelDbRemoteDocumentKey::Key(Key("coll/a/sub/c"));
+  // Left behind by a client that downgraded after the migration.
+  std::string stale_key = LevelDbCollectionDocumentKey::Key(0, "stale");
+  {
+    LevelDbTransaction transaction(db_.get(), "Write documents");
+    transaction.Put(legacy_key1, "a");
+    transaction.Put(legacy_key2, "bb");
+    transaction.Put(legacy_key3, "ccc");
+    transaction.Put(stale_key, "stale");
+    transaction.Put(LevelDbSizeCountersKey::Key(),
+                    LevelDbSizeCountersKey::EncodeValue({1, 2, 3}));
+    transaction.Commit();
+  }
+
+  LevelDbMigrations::RunMigrations(db_.get(), 10);
+  LevelDbTransaction transaction(db_.get(), "Verify");
+  ASSERT_THAT(legacy_key1, IsNotFound(&transaction));
+  ASSERT_THAT(legacy_key2, IsNotFound(&transaction));
+  ASSERT_THAT(legacy_key3, IsNotFound(&transaction));
+
+  std::map<std::string, int32_t> numbers;
+  std::string prefix = LevelDbCollectionDictionaryKey::KeyPrefix();
+  auto it = transaction.NewIterator();
+  LevelDbCollectionDictionaryKey dictionary_key;
+  for (it->Seek(prefix); it->Valid() && absl::StartsWith(it->key(), prefix);
+       it->Next()) {
+    ASSERT_TRUE(dictionary_key.Decode(it->key()));
+    int32_t number = 0;
+    ASSERT_TRUE(LevelDbCollectionDictionaryKey::DecodeValue(it->value(),
+                                                            &number));
+    numbers[dictionary_key.collection_path().CanonicalString()] = number;
+  }
+  ASSERT_EQ(numbers.size(), 2u);
+  ASSERT_NE(numbers["coll"], numbers["coll/a/sub"]);
+
+  std::map<std::string, std::string> documents;
+  prefix = LevelDbCollectionDocumentKey::KeyPrefix();
+  int64_t table_size = 0;
+  LevelDbCollectionDocumentKey document_key;
+  for (it->Seek(prefix); it->Valid() && absl::StartsWith(it->key(), prefix);
+       it->Next()) {
+    ASSERT_TRUE(document_key.Decode(it->key()));
+    std::string collection =
+        document_key.collection_number() == numbers["coll"] ? "coll"
+                                                            : "coll/a/sub";
+    documents[absl::StrCat(collection, "/", document_key.document_id())] =
+        std::string(it->value());
+    table_size += static_cast<int64_t>(it->key().size() + it->value().size());
+  }
+  ASSERT_EQ(documents, (std::map<std::string, std::string>{
+                           {"coll/a", "a"},
+                           {"coll/b", "bb"},
+                           {"coll/a/sub/c", "ccc"},
+                       }));
+
+  std::string value;
+  ASSERT_TRUE(transaction.Get(LevelDbSizeCountersKey::Key(), &value).ok());
+  std::vector<int64_t> byte_sizes;
+  ASSERT_TRUE(LevelDbSizeCountersKey::DecodeValue(value, &byte_sizes));
+  ASSERT_EQ(byte_sizes, (std::vector<int64_t>{table_size, 2, 3}));
+}
+
+TEST_F(LevelDbMigrationsTest, DropsTargetStates) {
+  LevelDbMigrations::RunMigrations(db_.get(), 10);
+  std::string target_key = LevelDbTargetKey::Key(1);
+  // Left behind by a client that downgraded after the migration.
+  std::string state_key = LevelDbTargetStateKey::Key(1);
+  {
+    LevelDbTransaction transaction(db_.get(), "Write targets");
+    transaction.Put(target_key, std::string(20, 't'));
+    transaction.Put(state_key, std::string(10, 's'));
+    transaction.Put(LevelDbSizeCountersKey::Key(),
+                    LevelDbSizeCountersKey::EncodeValue({1, 2, 3}));
+    transaction.Commit();
+  }
+
+  LevelDbMigrations::RunMigrations(db_.get(), 11);
+  LevelDbTransaction transaction(db_.get(), "Verify");
+  ASSERT_THAT(target_key, IsFound(&transaction));
+  ASSERT_THAT(state_key, IsNotFound(&transaction));
+
+  std::string value;
+  ASSERT_TRUE(transaction.Get(LevelDbSizeCountersKey::Key(), &value).ok());
+  std::vector<int64_t> byte_sizes;
+  ASSERT_TRUE(LevelDbSizeCountersKey::DecodeValue(value, &byte_sizes));
+  int64_t target_size = static_cast<int64_t>(target_key.size() + 20);
+  ASSERT_EQ(byte_sizes, (std::vector<int64_t>{1, target_size, 3}));
+}
+
 TEST_F(LevelDbMigrationsTest, CanDowngrade) {
   // First, run all of the migrations
   LevelDbMigrations::RunMigrations(db_.get());
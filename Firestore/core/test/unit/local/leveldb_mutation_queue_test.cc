@@ -25,6 +25,8 @@
 #include "Firestore/core/src/local/leveldb_key.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
 #include "Firestore/core/src/local/reference_set.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/mutation_batch.h"
 #include "Firestore/core/src/nanopb/byte_string.h"
 #include "Firestore/core/src/nanopb/message.h"
 #include "Firestore/core/src/nanopb/reader.h"
@@ -33,6 +35,7 @@
 #include "Firestore/core/test/unit/local/mutation_queue_test.h"
 #include "Firestore/core/test/unit/local/persistence_testing.h"
 #include "Firestore/core/test/unit/testutil/status_testing.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
 #include "absl/strings/string_view.h"
 #include "gtest/gtest.h"
 #include "leveldb/db.h"
@@ -182,6 +185,58 @@ TEST_F(LevelDbMutationQueueTest, EmptyProtoCanBeUpgraded) {
             ByteString(default_message->last_stream_token));
 }
 
+TEST_F(LevelDbMutationQueueTest, LoadsDocumentMutationIndexOnFirstUse) {
+  std::vector<model::MutationBatch> batches;
+  persistence_->Run("Add", [&] {
+    batches.push_back(AddMutationBatch("foo/bar"));
+    batches.push_back(AddMutationBatch("foo/baz"));
+  });
+  const model::MutationBatch& batch1 = batches[0];
+  const model::MutationBatch& batch2 = batches[1];
+
+  // A new queue for the same user only knows about the batches through
+  // LevelDB.
+  mutation_queue_ = persistence_->GetMutationQueueForUser(User("user"));
+  persistence_->Run("Start", [&] { mutation_queue_->Start(); });
+
+  persistence_->Run("Verify", [&] {
+    // Batches added before the index is loaded must be found too, and batch
+    // IDs continue from the ones in LevelDB.
+    model::MutationBatch batch3 = AddMutationBatch("foo/bar");
+    EXPECT_EQ(batch3.batch_id(), batch2.batch_id() + 1);
+
+    std::vector<model::MutationBatch> found =
+        mutation_queue_->AllMutationBatchesAffectingDocumentKey(
+            testutil::Key("foo/bar"));
+    ASSERT_EQ(found, (std::vector<model::MutationBatch>{batch1, batch3}));
+    mutation_queue_->RemoveMutationBatch(batch3);
+
+    mutation_queue_->RemoveMutationBatch(batch1);
+    EXPECT_TRUE(mutation_queue_
+                    ->AllMutationBatchesAffectingDocumentKey(
+                        testutil::Key("foo/bar"))
+                    .empty());
+    EXPECT_EQ(mutation_queue_->LookupMutationBatch(batch1.batch_id()),
+              absl::nullopt);
+    EXPECT_EQ(mutation_queue_->LookupMutationBatch(batch2.batch_id()), batch2);
+  });
+}
+
+TEST_F(LevelDbMutationQueueTest, ReadOnlyTransactionsReadLevelDb) {
+  std::vector<model::MutationBatch> batches;
+  persistence_->Run("Add", [&] { batches.push_back(AddMutationBatch()); });
+  const model::MutationBatch& batch = batches[0];
+
+  persistence_->RunReadOnly("Read", [&] {
+    std::vector<model::MutationBatch> found =
+        mutation_queue_->AllMutationBatchesAffectingDocumentKeys(
+            model::DocumentKeySet{testutil::Key("foo/bar"),
+                                  testutil::Key("foo/baz")});
+    EXPECT_EQ(found, std::vector<model::MutationBatch>{batch});
+    EXPECT_EQ(mutation_queue_->LookupMutationBatch(batch.batch_id()), batch);
+  });
+}
+
 void LevelDbMutationQueueTest::SetDummyValueForKey(const std::string& key) {
   db_->Put(WriteOptions(), key, kDummy);
 }
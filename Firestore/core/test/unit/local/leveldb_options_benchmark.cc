@@ -0,0 +1,152 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/local/leveldb_options.h"
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_remote_document_cache.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_map.h"
+#include "Firestore/core/src/model/snapshot_version.h"
+#include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+namespace {
+
+using model::DocumentMap;
+using model::SnapshotVersion;
+using testutil::Doc;
+using testutil::Key;
+using testutil::Map;
+
+constexpr int kDocumentCount = 10000;
+constexpr int kCollectionCount = 10;
+
+/** The option variants the benchmarks are run with, selected by range(0). */
+LevelDbOptions OptionsVariant(benchmark::State& state) {
+  LevelDbOptions options = LevelDbOptions::Default();
+  switch (state.range(0)) {
+    case 0:
+      state.SetLabel("no bloom filter");
+      options.bloom_filter_bits_per_key = 0;
+      break;
+    case 1:
+      state.SetLabel("bloom filter");
+      break;
+    case 2:
+      state.SetLabel("64 MB block cache");
+      options.block_cache_size_bytes = 64 * 1024 * 1024;
+      break;
+    case 3:
+      state.SetLabel("256 KB write buffer");
+      options.write_buffer_size_bytes = 256 * 1024;
+      break;
+    default:
+      break;
+  }
+  return options;
+}
+
+std::string DocPath(int i) {
+  return "coll" + std::to_string(i % kCollectionCount) + "/doc" +
+         std::to_string(i);
+}
+
+/**
+ * Creates a persistence with the options of the current variant, containing
+ * `kDocumentCount` documents that have been compacted into table files.
+ */
+std::unique_ptr<LevelDbPersistence> MakePopulatedPersistence(
+    benchmark::State& state) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting(OptionsVariant(state));
+  RemoteDocumentCache* cache = persistence->remote_document_cache();
+
+  constexpr int kBatchSize = 1000;
+  for (int start = 0; start < kDocumentCount; start += kBatchSize) {
+    persistence->Run("Populate documents", [&] {
+      for (int i = start; i < start + kBatchSize; ++i) {
+        cache->Add(Doc(DocPath(i), 1, Map("index", i, "payload", "value")),
+                   testutil::Version(1));
+      }
+    });
+  }
+
+  persistence->ptr()->CompactRange(nullptr, nullptr);
+  return persistence;
+}
+
+void BM_PointLookupPresent(benchmark::State& state) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      MakePopulatedPersistence(state);
+  RemoteDocumentCache* cache = persistence->remote_document_cache();
+
+  int i = 0;
+  for (auto _ : state) {
+    persistence->Run("Point lookup", [&] {
+      benchmark::DoNotOptimize(cache->Get(Key(DocPath(i))));
+    });
+    i = (i + 7919) % kDocumentCount;
+  }
+}
+BENCHMARK(BM_PointLookupPresent)->DenseRange(0, 3);
+
+void BM_PointLookupMissing(benchmark::State& state) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      MakePopulatedPersistence(state);
+  RemoteDocumentCache* cache = persistence->remote_document_cache();
+
+  int i = 0;
+  for (auto _ : state) {
+    persistence->Run("Point lookup", [&] {
+      benchmark::DoNotOptimize(cache->Get(Key(DocPath(i) + "-missing")));
+    });
+    i = (i + 7919) % kDocumentCount;
+  }
+}
+BENCHMARK(BM_PointLookupMissing)->DenseRange(0, 3);
+
+void BM_CollectionScan(benchmark::State& state) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      MakePopulatedPersistence(state);
+  RemoteDocumentCache* cache = persistence->remote_document_cache();
+
+  int i = 0;
+  for (auto _ : state) {
+    core::Query query =
+        testutil::Query("coll" + std::to_string(i % kCollectionCount));
+    persistence->Run("Collection scan", [&] {
+      DocumentMap docs = cache->GetMatching(query, SnapshotVersion::None());
+      benchmark::DoNotOptimize(docs);
+    });
+    ++i;
+  }
+  state.SetItemsProcessed(state.iterations() * kDocumentCount /
+                          kCollectionCount);
+}
+BENCHMARK(BM_CollectionScan)->DenseRange(0, 3);
+
+}  // namespace
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -16,15 +16,25 @@
 
 #include "Firestore/core/src/local/leveldb_remote_document_cache.h"
 
+#include <functional>
 #include <initializer_list>
 #include <memory>
+#include <future>  // NOLINT(build/c++11)
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
 
 #include "Firestore/core/src/local/leveldb_persistence.h"
 #include "Firestore/core/src/local/remote_document_cache.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/document_map.h"
+#include "Firestore/core/src/model/snapshot_version.h"
 #include "Firestore/core/src/util/ordered_code.h"
+#include "Firestore/core/src/util/path.h"
 #include "Firestore/core/test/unit/local/persistence_testing.h"
 #include "Firestore/core/test/unit/local/remote_document_cache_test.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
 #include "absl/memory/memory.h"
 #include "leveldb/db.h"
 
@@ -34,6 +44,13 @@ namespace local {
 namespace {
 
 using leveldb::WriteOptions;
+using model::DocumentKeySet;
+using model::DocumentMap;
+using model::SnapshotVersion;
+using testutil::Doc;
+using testutil::Key;
+using testutil::Map;
+using testutil::Version;
 using util::OrderedCode;
 
 // A dummy document value, useful for testing code that's known to examine only
@@ -41,8 +58,8 @@ using util::OrderedCode;
 const char* kDummy = "1";
 
 /**
- * Writes a dummy row that looks like a remote document key but is different
- * enough that it shouldn't be picked up in scans of the table.
+ * Writes a dummy row that looks like a legacy remote document key but is
+ * different enough that it shouldn't be picked up in scans of the table.
  */
 void WriteDummyRow(LevelDbPersistence* db,
                    const std::string& table_name,
@@ -64,6 +81,27 @@ void WriteDummyRow(LevelDbPersistence* db,
   db->ptr()->Put(WriteOptions(), key, kDummy);
 }
 
+/**
+ * Writes a dummy row that looks like a collection document key but is
+ * different enough that it shouldn't be picked up in scans of the table.
+ */
+void WriteDummyDocumentRow(LevelDbPersistence* db,
+                           const std::string& table_name,
+                           int32_t collection_number,
+                           const std::string& document_id) {
+  // The structure matches LevelDbCollectionDocumentKey::Key().
+  std::string key;
+  OrderedCode::WriteSignedNumIncreasing(&key, 5);  // TableName
+  OrderedCode::WriteString(&key, table_name);
+  OrderedCode::WriteSignedNumIncreasing(&key, 22);  // CollectionNumber
+  OrderedCode::WriteSignedNumIncreasing(&key, collection_number);
+  OrderedCode::WriteSignedNumIncreasing(&key, 15);  // DocumentId
+  OrderedCode::WriteString(&key, document_id);
+  OrderedCode::WriteSignedNumIncreasing(&key, 0);  // Terminator
+
+  db->ptr()->Put(WriteOptions(), key, kDummy);
+}
+
 std::unique_ptr<Persistence> PersistenceFactory() {
   auto persistence = LevelDbPersistenceForTesting();
 
@@ -77,6 +115,11 @@ std::unique_ptr<Persistence> PersistenceFactory() {
   // This row is just after any possible remote document key
   WriteDummyRow(persistence.get(), "remote_documents_a", {"row", "after"});
 
+  // The same for the collection_document table, which the cache reads
+  // instead. The first collection gets number 0.
+  WriteDummyDocumentRow(persistence.get(), "collection_documen", 0, "before");
+  WriteDummyDocumentRow(persistence.get(), "collection_documents", 0, "after");
+
   return persistence;
 }
 
@@ -86,6 +129,178 @@ INSTANTIATE_TEST_SUITE_P(LevelDbRemoteDocumentCacheTest,
                          RemoteDocumentCacheTest,
                          testing::Values(PersistenceFactory));
 
+TEST(LevelDbRemoteDocumentCacheDecodingTest, CachesDecodedDocuments) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting();
+  LevelDbRemoteDocumentCache* cache = persistence->remote_document_cache();
+  const DecodedDocumentCache& decoded = cache->decoded_document_cache();
+
+  persistence->Run("CachesDecodedDocuments", [&] {
+    cache->Add(Doc("coll/a", 1, Map("a", 1)), Version(1));
+    cache->Add(Doc("coll/b", 1, Map("b", 1)), Version(1));
+
+    EXPECT_EQ(cache->Get(Key("coll/a")), Doc("coll/a", 1, Map("a", 1)));
+    EXPECT_EQ(decoded.misses(), 1u);
+    EXPECT_EQ(cache->Get(Key("coll/a")), Doc("coll/a", 1, Map("a", 1)));
+    EXPECT_EQ(decoded.hits(), 1u);
+
+    cache->GetAll(DocumentKeySet{Key("coll/a"), Key("coll/b")});
+    EXPECT_EQ(decoded.hits(), 2u);
+    EXPECT_EQ(decoded.misses(), 2u);
+
+    // Overwriting a document invalidates its entry.
+    cache->Add(Doc("coll/a", 2, Map("a", 2)), Version(2));
+    EXPECT_EQ(cache->Get(Key("coll/a")), Doc("coll/a", 2, Map("a", 2)));
+    EXPECT_EQ(decoded.misses(), 3u);
+
+    cache->Remove(Key("coll/b"));
+    EXPECT_EQ(cache->Get(Key("coll/b")), absl::nullopt);
+  });
+
+  persistence->Shutdown();
+}
+
+TEST(LevelDbRemoteDocumentCacheSnapshotTest, ReadsFromSnapshot) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting();
+  LevelDbRemoteDocumentCache* cache = persistence->remote_document_cache();
+  ASSERT_TRUE(persistence->supports_concurrent_reads());
+
+  persistence->Run("Setup", [&] {
+    cache->Add(Doc("coll/a", 1, Map("a", 1)), Version(1));
+  });
+
+  std::promise<void> read_started;
+  std::promise<void> write_done;
+  std::thread reader([&] {
+    persistence->RunReadOnly("ReadsFromSnapshot", [&] {
+      EXPECT_TRUE(persistence->in_read_only_transaction());
+      EXPECT_EQ(cache->Get(Key("coll/a")), Doc("coll/a", 1, Map("a", 1)));
+      read_started.set_value();
+
+      // Writes committed after the read-only transaction started aren't
+      // visible to it.
+      write_done.get_future().wait();
+      EXPECT_EQ(cache->Get(Key("coll/a")), Doc("coll/a", 1, Map("a", 1)));
+      EXPECT_EQ(cache->Get(Key("coll/b")), absl::nullopt);
+    });
+  });
+
+  read_started.get_future().wait();
+  persistence->Run("Write", [&] {
+    EXPECT_FALSE(persistence->in_read_only_transaction());
+    cache->Add(Doc("coll/a", 2, Map("a", 2)), Version(2));
+    cache->Add(Doc("coll/b", 2, Map("b", 2)), Version(2));
+  });
+  write_done.set_value();
+  reader.join();
+
+  persistence->RunReadOnly("ReadsLatest", [&] {
+    EXPECT_EQ(cache->Get(Key("coll/a")), Doc("coll/a", 2, Map("a", 2)));
+    EXPECT_EQ(cache->Get(Key("coll/b")), Doc("coll/b", 2, Map("b", 2)));
+  });
+
+  persistence->Shutdown();
+}
+
+TEST(LevelDbRemoteDocumentCacheSnapshotTest, DefersCacheCommits) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting();
+  LevelDbRemoteDocumentCache* cache = persistence->remote_document_cache();
+
+  int flushes_scheduled = 0;
+  std::function<void()> pending_flush;
+  persistence->EnableGroupCommit([&](std::function<void()> flush) {
+    ++flushes_scheduled;
+    pending_flush = std::move(flush);
+  });
+
+  persistence->Run("First", [&] {
+    cache->Add(Doc("coll/a", 1, Map("a", 1)), Version(1));
+  });
+  persistence->Run("Second", [&] {
+    // Deferred changes are visible to later transactions.
+    EXPECT_NE(cache->Get(Key("coll/a")), absl::nullopt);
+    cache->Add(Doc("coll/b", 1, Map("b", 1)), Version(1));
+  });
+  EXPECT_EQ(flushes_scheduled, 1);
+
+  // Snapshots only see what has been written to LevelDB.
+  persistence->RunReadOnly("BeforeFlush", [&] {
+    EXPECT_EQ(cache->Get(Key("coll/a")), absl::nullopt);
+  });
+
+  ASSERT_TRUE(pending_flush);
+  pending_flush();
+  persistence->RunReadOnly("AfterFlush", [&] {
+    EXPECT_NE(cache->Get(Key("coll/a")), absl::nullopt);
+    EXPECT_NE(cache->Get(Key("coll/b")), absl::nullopt);
+  });
+
+  // User writes are committed immediately.
+  persistence->Run("UserWrite", TransactionClass::UserWrite, [&] {
+    cache->Add(Doc("coll/c", 1, Map("c", 1)), Version(1));
+  });
+  EXPECT_EQ(flushes_scheduled, 1);
+  persistence->RunReadOnly("AfterUserWrite", [&] {
+    EXPECT_NE(cache->Get(Key("coll/c")), absl::nullopt);
+  });
+
+  persistence->Shutdown();
+}
+
+TEST(LevelDbRemoteDocumentCacheSnapshotTest,
+     FindsCollectionsConcurrentlyWithWrites) {
+  constexpr int kCollectionCount = 50;
+  util::Path dir = LevelDbDir();
+  {
+    std::unique_ptr<LevelDbPersistence> persistence =
+        LevelDbPersistenceForTesting(dir);
+    LevelDbRemoteDocumentCache* cache = persistence->remote_document_cache();
+    persistence->Run("Setup", [&] {
+      for (int i = 0; i < kCollectionCount; ++i) {
+        cache->Add(Doc("read" + std::to_string(i) + "/a", 1, Map("a", i)),
+                   Version(1));
+      }
+    });
+    persistence->Shutdown();
+  }
+
+  // Reopen the database so that no collection numbers are remembered, and
+  // look them up while new collections are assigned numbers on this thread.
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting(std::move(dir));
+  LevelDbRemoteDocumentCache* cache = persistence->remote_document_cache();
+  std::thread reader([&] {
+    for (int i = 0; i < kCollectionCount; ++i) {
+      persistence->RunReadOnly("Read", [&] {
+        DocumentMap results = cache->GetMatching(
+            testutil::Query("read" + std::to_string(i)),
+            SnapshotVersion::None());
+        EXPECT_EQ(results.size(), 1u);
+      });
+    }
+  });
+  for (int i = 0; i < kCollectionCount; ++i) {
+    persistence->Run("Write", [&] {
+      cache->Add(Doc("write" + std::to_string(i) + "/a", 1, Map("a", i)),
+                 Version(1));
+    });
+  }
+  reader.join();
+
+  persistence->RunReadOnly("ReadWritten", [&] {
+    for (int i = 0; i < kCollectionCount; ++i) {
+      EXPECT_EQ(cache->GetMatching(testutil::Query("write" + std::to_string(i)),
+                                   SnapshotVersion::None())
+                    .size(),
+                1u);
+    }
+  });
+
+  persistence->Shutdown();
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/leveldb_size_counters.h"
+
+#include <memory>
+#include <string>
+
+#include "Firestore/core/src/local/leveldb_key.h"
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/leveldb_remote_document_cache.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/util/path.h"
+#include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using testutil::Doc;
+using testutil::Key;
+using testutil::Map;
+using testutil::Version;
+using util::Path;
+
+}  // namespace
+
+TEST(LevelDbSizeCountersTest, TracksRemoteDocuments) {
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting();
+  LevelDbSizeCounters* counters = persistence->size_counters();
+  LevelDbRemoteDocumentCache* cache = persistence->remote_document_cache();
+  EXPECT_EQ(counters->byte_size(SizedTable::RemoteDocuments), 0);
+
+  persistence->Run("Add", [&] {
+    cache->Add(Doc("coll/a", 1, Map("a", std::string(200, 'x'))),
+               Version(1));
+  });
+  int64_t small_size = counters->byte_size(SizedTable::RemoteDocuments);
+  EXPECT_GT(small_size,
+            static_cast<int64_t>(
+                LevelDbCollectionDocumentKey::Key(0, "a").size() + 200));
+
+  // Overwriting a document only accounts for the difference in size.
+  persistence->Run("Update", [&] {
+    cache->Add(Doc("coll/a", 1, Map("a", std::string(1100, 'x'))),
+               Version(1));
+  });
+  int64_t large_size = counters->byte_size(SizedTable::RemoteDocuments);
+  EXPECT_EQ(large_size, small_size + 900);
+  EXPECT_EQ(counters->total_byte_size(), large_size);
+
+  persistence->Run("Remove", [&] {
+    cache->Remove(Key("coll/a"));
+    // Removing a missing document changes nothing.
+    cache->Remove(Key("coll/b"));
+  });
+  EXPECT_EQ(counters->byte_size(SizedTable::RemoteDocuments), 0);
+
+  persistence->Shutdown();
+}
+
+TEST(LevelDbSizeCountersTest, PersistsCounters) {
+  Path dir = LevelDbDir();
+  int64_t saved_size = 0;
+  {
+    std::unique_ptr<LevelDbPersistence> persistence =
+        LevelDbPersistenceForTesting(dir);
+    persistence->Run("Add", [&] {
+      persistence->remote_document_cache()->Add(
+          Doc("coll/a", 1, Map("a", 1)), Version(1));
+    });
+    saved_size =
+        persistence->size_counters()->byte_size(SizedTable::RemoteDocuments);
+    persistence->Shutdown();
+  }
+
+  std::unique_ptr<LevelDbPersistence> persistence =
+      LevelDbPersistenceForTesting(dir);
+  EXPECT_GT(saved_size, 0);
+  EXPECT_EQ(
+      persistence->size_counters()->byte_size(SizedTable::RemoteDocuments),
+      saved_size);
+  persistence->Shutdown();
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
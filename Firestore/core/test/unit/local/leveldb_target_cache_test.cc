@@ -16,6 +16,11 @@
 
 #include "Firestore/core/src/local/leveldb_target_cache.h"
 
+#include <future>  // NOLINT(build/c++11)
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
 #include "Firestore/core/include/firebase/firestore/timestamp.h"
 #include "Firestore/core/src/local/leveldb_key.h"
 #include "Firestore/core/src/local/leveldb_persistence.h"
@@ -135,6 +140,40 @@ TEST_F(LevelDbTargetCacheTest, RemoveMatchingKeysForTargetID) {
   });
 }
 
+TEST_F(LevelDbTargetCacheTest, UpdateTargetWritesTargetState) {
+  persistence_->Run("test_update_target_writes_target_state", [&]() {
+    LevelDbTransaction* transaction =
+        leveldb_persistence()->current_transaction();
+    std::string target_key = LevelDbTargetKey::Key(1);
+    std::string state_key = LevelDbTargetStateKey::Key(1);
+
+    TargetData added = MakeTargetData(query_rooms_, 1, 10, 1);
+    cache_->AddTarget(added);
+    std::string added_value;
+    ASSERT_TRUE(transaction->Get(target_key, &added_value).ok());
+
+    TargetData updated = MakeTargetData(query_rooms_, 1, 20, 2);
+    cache_->UpdateTarget(updated);
+    std::string value;
+    ASSERT_TRUE(transaction->Get(target_key, &value).ok());
+    ASSERT_EQ(value, added_value);
+    ASSERT_TRUE(transaction->Get(state_key, &value).ok());
+
+    ASSERT_EQ(cache_->GetTarget(query_rooms_.ToTarget()), updated);
+    std::vector<ListenSequenceNumber> sequence_numbers;
+    cache_->EnumerateSequenceNumbers(
+        [&](ListenSequenceNumber sequence_number) {
+          sequence_numbers.push_back(sequence_number);
+        });
+    ASSERT_EQ(sequence_numbers, std::vector<ListenSequenceNumber>{20});
+
+    ASSERT_EQ(cache_->RemoveTargets(10, {}), 0u);
+    ASSERT_EQ(cache_->RemoveTargets(20, {}), 1u);
+    ASSERT_TRUE(transaction->Get(target_key, &value).IsNotFound());
+    ASSERT_TRUE(transaction->Get(state_key, &value).IsNotFound());
+  });
+}
+
 // We see user issues where target data is missing for some reason, and the root
 // cause is unknown. This test makes sure the SDK proceeds even when this
 // happens. See: https://github.com/firebase/firebase-ios-sdk/issues/6644
@@ -151,6 +190,31 @@ TEST_F(LevelDbTargetCacheTest, SurvivesMissingTargetData) {
   });
 }
 
+TEST_F(LevelDbTargetCacheTest, ReadOnlyTransactionsDontCacheStaleTargets) {
+  std::promise<void> read_started;
+  std::promise<void> write_done;
+  std::thread reader([&] {
+    persistence_->RunReadOnly("ReadTarget", [&] {
+      read_started.set_value();
+
+      // The target is added after the snapshot was taken, so it isn't visible
+      // here, and that mustn't hide it from later lookups on the worker.
+      write_done.get_future().wait();
+      EXPECT_EQ(cache_->GetTarget(query_rooms_.ToTarget()), absl::nullopt);
+    });
+  });
+
+  read_started.get_future().wait();
+  TargetData target_data = MakeTargetData(query_rooms_);
+  persistence_->Run("AddTarget", [&] { cache_->AddTarget(target_data); });
+  write_done.set_value();
+  reader.join();
+
+  persistence_->Run("AllocateTarget", [&] {
+    EXPECT_EQ(cache_->GetTarget(query_rooms_.ToTarget()), target_data);
+  });
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
@@ -290,6 +290,39 @@ TEST_F(LevelDbTransactionTest, DeletingAheadOfAnIterator) {
   ASSERT_FALSE(it->Valid());
 }
 
+TEST_F(LevelDbTransactionTest, ReadProfiles) {
+  using ReadProfile = LevelDbTransaction::ReadProfile;
+  LevelDbTransaction transaction(db_.get(), "ReadProfiles");
+
+  ReadOptions point = transaction.ReadOptionsFor(ReadProfile::PointRead);
+  EXPECT_TRUE(point.verify_checksums);
+  EXPECT_TRUE(point.fill_cache);
+
+  ReadOptions foreground =
+      transaction.ReadOptionsFor(ReadProfile::ForegroundScan);
+  EXPECT_TRUE(foreground.verify_checksums);
+  EXPECT_TRUE(foreground.fill_cache);
+
+  ReadOptions background =
+      transaction.ReadOptionsFor(ReadProfile::BackgroundScan);
+  EXPECT_FALSE(background.verify_checksums);
+  EXPECT_FALSE(background.fill_cache);
+
+  // Background scans still see the pending changes of the transaction.
+  ASSERT_TRUE(db_->Put(LevelDbTransaction::DefaultWriteOptions(), "key_a",
+                       "committed")
+                  .ok());
+  transaction.Put("key_b", "pending");
+  auto it = transaction.NewIterator(ReadProfile::BackgroundScan);
+  it->Seek("key");
+  ASSERT_TRUE(it->Valid());
+  EXPECT_EQ(it->key(), "key_a");
+  it->Next();
+  ASSERT_TRUE(it->Valid());
+  EXPECT_EQ(it->key(), "key_b");
+  EXPECT_EQ(it->value(), "pending");
+}
+
 TEST_F(LevelDbTransactionTest, ToString) {
   std::string key = LevelDbMutationKey::Key("user1", 42);
   Message<firestore_client_WriteBatch> message;
@@ -314,6 +347,29 @@ TEST_F(LevelDbTransactionTest, ToString) {
             "  - Put [mutation: user_id=user1 batch_id=42] (2 bytes)>");
 }
 
+TEST_F(LevelDbTransactionTest, CountsReadsWritesAndSeeks) {
+  ASSERT_TRUE(db_->Put(WriteOptions(), "committed", "abc").ok());
+
+  LevelDbTransaction transaction(db_.get(), "CountsReadsWritesAndSeeks");
+  transaction.Put("key", "value");
+  transaction.Delete("committed");
+
+  std::string value;
+  ASSERT_TRUE(transaction.Get("key", &value).ok());
+  ASSERT_FALSE(transaction.Get("committed", &value).ok());
+
+  auto iter = transaction.NewIterator();
+  iter->Seek("");
+  iter->Seek("key");
+
+  const TransactionCounters& counters = transaction.counters();
+  ASSERT_EQ(2, counters.reads);
+  ASSERT_EQ(2, counters.writes);
+  ASSERT_EQ(5, counters.bytes_read);
+  ASSERT_EQ(8, counters.bytes_written);
+  ASSERT_EQ(2, counters.seeks);
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
@@ -46,6 +46,7 @@
 #include "Firestore/core/src/nanopb/reader.h"
 #include "Firestore/core/src/nanopb/writer.h"
 #include "Firestore/core/src/remote/serializer.h"
+#include "Firestore/core/src/remote/watch_change.h"
 #include "Firestore/core/src/util/status.h"
 #include "Firestore/core/test/unit/nanopb/nanopb_testing.h"
 #include "Firestore/core/test/unit/testutil/status_testing.h"
@@ -520,6 +521,69 @@ TEST_F(LocalSerializerTest, EncodesDocumentAsMaybeDocument) {
   ExpectRoundTrip(doc, maybe_doc_proto, doc.type());
 }
 
+TEST_F(LocalSerializerTest, DecodesDocumentFieldsLazily) {
+  Document doc =
+      Doc("some/path", /*version=*/42,
+          Map("foo", "bar", "owner", Map("name", "Jonny", "age", 30)),
+          DocumentState::kCommittedMutations);
+
+  ByteString bytes = MakeByteString(serializer.EncodeMaybeDocument(doc));
+  StringReader reader(bytes);
+  auto message = Message<firestore_client_MaybeDocument>::TryParse(&reader);
+  MaybeDocument decoded =
+      serializer.DecodeMaybeDocumentLazily(&reader, std::move(message));
+  EXPECT_OK(reader.status());
+
+  ASSERT_EQ(decoded.type(), MaybeDocument::Type::Document);
+  Document lazy_doc(decoded);
+  EXPECT_EQ(lazy_doc.key(), doc.key());
+  EXPECT_EQ(lazy_doc.version(), doc.version());
+  EXPECT_TRUE(lazy_doc.has_committed_mutations());
+
+  // Fields can be read before and after the whole document is decoded.
+  EXPECT_EQ(lazy_doc.field(Field("owner.name")), testutil::Value("Jonny"));
+  EXPECT_EQ(lazy_doc.field(Field("owner")), doc.field(Field("owner")));
+  EXPECT_EQ(lazy_doc.field(Field("foo.bar")), absl::nullopt);
+  EXPECT_EQ(lazy_doc.field(Field("missing")), absl::nullopt);
+  EXPECT_EQ(lazy_doc, doc);
+  EXPECT_EQ(lazy_doc.field(Field("owner.age")), testutil::Value(30));
+}
+
+TEST_F(LocalSerializerTest, EncodesWatchDocumentFromItsProto) {
+  Document doc = Doc("some/path", /*version=*/42, Map("foo", "bar"));
+
+  v1::ListenResponse response_proto;
+  v1::Document* document_proto =
+      response_proto.mutable_document_change()->mutable_document();
+  document_proto->set_name("projects/p/databases/d/documents/some/path");
+  (*document_proto->mutable_fields())["foo"].set_string_value("bar");
+  document_proto->mutable_create_time()->set_nanos(1000);
+  document_proto->mutable_update_time()->set_nanos(42000);
+  response_proto.mutable_document_change()->add_target_ids(1);
+
+  ByteString bytes = ProtobufSerialize(response_proto);
+  StringReader reader(bytes);
+  auto response =
+      Message<google_firestore_v1_ListenResponse>::TryParse(&reader);
+  std::unique_ptr<remote::WatchChange> change =
+      remote_serializer.DecodeWatchChange(reader.context(), *response);
+  ASSERT_OK(reader.status());
+
+  const auto& document_change =
+      static_cast<const remote::DocumentWatchChange&>(*change);
+  ASSERT_TRUE(document_change.new_document().has_value());
+  MaybeDocument watch_doc = *document_change.new_document();
+  EXPECT_EQ(watch_doc, doc);
+
+  // The memoized proto is encoded as is, except for the create time, and is
+  // only used once.
+  EXPECT_EQ(serializer.EncodeMaybeDocumentToString(watch_doc),
+            nanopb::MakeStdString(serializer.EncodeMaybeDocument(doc)));
+  EXPECT_EQ(Document(watch_doc).TakeProto(), nullptr);
+  EXPECT_EQ(serializer.EncodeMaybeDocumentToString(watch_doc),
+            nanopb::MakeStdString(serializer.EncodeMaybeDocument(doc)));
+}
+
 TEST_F(LocalSerializerTest, EncodesNoDocumentAsMaybeDocument) {
   NoDocument no_doc = DeletedDoc("some/path", /*version=*/42);
 
@@ -0,0 +1,330 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Firestore/core/src/auth/user.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/local_store.h"
+#include "Firestore/core/src/local/local_view_changes.h"
+#include "Firestore/core/src/local/local_write_result.h"
+#include "Firestore/core/src/local/lru_garbage_collector.h"
+#include "Firestore/core/src/local/memory_persistence.h"
+#include "Firestore/core/src/local/query_engine.h"
+#include "Firestore/core/src/local/query_result.h"
+#include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/maybe_document.h"
+#include "Firestore/core/src/model/mutation.h"
+#include "Firestore/core/src/model/set_mutation.h"
+#include "Firestore/core/src/remote/remote_event.h"
+#include "Firestore/core/src/remote/watch_change.h"
+#include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/remote/fake_target_metadata_provider.h"
+#include "Firestore/core/test/unit/testutil/allocation_benchmarking.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "absl/memory/memory.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+namespace {
+
+using auth::User;
+using model::DocumentKeySet;
+using model::MaybeDocument;
+using model::MaybeDocumentMap;
+using model::Mutation;
+using model::TargetId;
+using remote::DocumentWatchChange;
+using remote::FakeTargetMetadataProvider;
+using remote::RemoteEvent;
+using remote::WatchChangeAggregator;
+using testutil::AllocationReporter;
+using testutil::Doc;
+using testutil::Map;
+
+// The benchmarks take the persistence to run against as range(0) and the
+// number of documents in the cache as range(1).
+constexpr int kMemoryPersistence = 0;
+constexpr int kLevelDbPersistence = 1;
+
+constexpr int kBatchSize = 100;
+constexpr int kGroupCount = 10;
+
+void PersistenceAndDatasetSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"leveldb", "documents"});
+  for (int persistence : {kMemoryPersistence, kLevelDbPersistence}) {
+    for (int documents : {100, 1000, 10000}) {
+      benchmark->Args({persistence, documents});
+    }
+  }
+}
+
+std::string DocPath(int i) {
+  return "coll/doc" + std::to_string(i);
+}
+
+std::string GroupDocPath(int i) {
+  return "groups/g" + std::to_string(i % kGroupCount) + "/coll/doc" +
+         std::to_string(i);
+}
+
+MaybeDocument MakeDoc(const std::string& path, int64_t version, int i) {
+  return Doc(path, version, Map("index", i, "payload", "value"));
+}
+
+/**
+ * Creates a remote event that adds the given documents, which must all be in
+ * the same collection, to the given target.
+ */
+RemoteEvent AddedRemoteEvent(const std::vector<MaybeDocument>& docs,
+                             TargetId target_id) {
+  auto metadata_provider =
+      FakeTargetMetadataProvider::CreateEmptyResultProvider(
+          docs[0].key().path().PopLast(), {target_id});
+  WatchChangeAggregator aggregator{&metadata_provider};
+  for (const MaybeDocument& doc : docs) {
+    aggregator.HandleDocumentChange(
+        DocumentWatchChange{{target_id}, {}, doc.key(), doc});
+  }
+  return aggregator.CreateRemoteEvent(docs[0].version());
+}
+
+/**
+ * A local store over the persistence selected by the benchmark arguments.
+ * Garbage collection collects everything that isn't in use, so that the
+ * collection benchmark has a stable amount of work to do.
+ */
+class BenchmarkLocalStore {
+ public:
+  explicit BenchmarkLocalStore(const benchmark::State& state) {
+    LruParams lru_params = LruParams::WithCacheSize(0);
+    lru_params.percentile_to_collect = 100;
+    lru_params.maximum_sequence_numbers_to_collect =
+        std::numeric_limits<int>::max();
+
+    if (state.range(0) == kLevelDbPersistence) {
+      persistence_ = LevelDbPersistenceForTesting(lru_params);
+    } else {
+      persistence_ = MemoryPersistenceWithLruGcForTesting(lru_params);
+    }
+    local_store_ = absl::make_unique<LocalStore>(
+        persistence_.get(), &query_engine_, User::Unauthenticated());
+    local_store_->Start();
+  }
+
+  LocalStore* operator->() {
+    return local_store_.get();
+  }
+
+  LruGarbageCollector* garbage_collector() {
+    return static_cast<LruDelegate*>(persistence_->reference_delegate())
+        ->garbage_collector();
+  }
+
+  /**
+   * Listens to the given query and adds `count` documents, with paths given
+   * by `path_for`, to its results. The listen is marked as current, so that
+   * later executions of the query can start from its results.
+   */
+  template <typename PathFunction>
+  TargetId AddListenResults(const core::Query& query,
+                            int count,
+                            int64_t version,
+                            PathFunction path_for) {
+    TargetId target_id =
+        local_store_->AllocateTarget(query.ToTarget()).target_id();
+    for (int start = 0; start < count; start += kBatchSize) {
+      std::vector<MaybeDocument> docs;
+      for (int i = start; i < std::min(start + kBatchSize, count); ++i) {
+        docs.push_back(MakeDoc(path_for(i), version, i));
+      }
+      local_store_->ApplyRemoteEvent(AddedRemoteEvent(docs, target_id));
+    }
+    local_store_->NotifyLocalViewChanges(
+        {LocalViewChanges(target_id, /* from_cache= */ false,
+                          DocumentKeySet{}, DocumentKeySet{})});
+    return target_id;
+  }
+
+ private:
+  std::unique_ptr<Persistence> persistence_;
+  QueryEngine query_engine_;
+  std::unique_ptr<LocalStore> local_store_;
+};
+
+void BM_ApplyRemoteEvent(benchmark::State& state) {
+  BenchmarkLocalStore store(state);
+  int count = static_cast<int>(state.range(1));
+  TargetId target_id =
+      store.AddListenResults(testutil::Query("coll"), count, 1, DocPath);
+
+  int64_t version = 2;
+  int next = 0;
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<MaybeDocument> docs;
+    for (int i = 0; i < kBatchSize; ++i) {
+      docs.push_back(MakeDoc(DocPath(next), version, next));
+      next = (next + 1) % count;
+    }
+    RemoteEvent event = AddedRemoteEvent(docs, target_id);
+    ++version;
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(store->ApplyRemoteEvent(event));
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_ApplyRemoteEvent)->Apply(PersistenceAndDatasetSizes);
+
+void BM_ExecuteQueryIndexFree(benchmark::State& state) {
+  BenchmarkLocalStore store(state);
+  int count = static_cast<int>(state.range(1));
+  core::Query query = testutil::Query("coll");
+  store.AddListenResults(query, count, 1, DocPath);
+
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    QueryResult result =
+        store->ExecuteQuery(query, /* use_previous_results= */ true);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ExecuteQueryIndexFree)->Apply(PersistenceAndDatasetSizes);
+
+void BM_ExecuteQueryFullScan(benchmark::State& state) {
+  BenchmarkLocalStore store(state);
+  int count = static_cast<int>(state.range(1));
+  core::Query query = testutil::Query("coll");
+  store.AddListenResults(query, count, 1, DocPath);
+
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    QueryResult result =
+        store->ExecuteQuery(query, /* use_previous_results= */ false);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ExecuteQueryFullScan)->Apply(PersistenceAndDatasetSizes);
+
+void BM_ExecuteCollectionGroupQuery(benchmark::State& state) {
+  BenchmarkLocalStore store(state);
+  int count = static_cast<int>(state.range(1));
+  // Each group's documents are added through a listen to its own collection.
+  for (int group = 0; group < kGroupCount; ++group) {
+    auto path_for = [group](int i) {
+      return GroupDocPath(i * kGroupCount + group);
+    };
+    store.AddListenResults(
+        testutil::Query("groups/g" + std::to_string(group) + "/coll"),
+        count / kGroupCount, 1, path_for);
+  }
+
+  core::Query query = testutil::CollectionGroupQuery("coll");
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    QueryResult result =
+        store->ExecuteQuery(query, /* use_previous_results= */ false);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ExecuteCollectionGroupQuery)->Apply(PersistenceAndDatasetSizes);
+
+void BM_WriteLocally(benchmark::State& state) {
+  BenchmarkLocalStore store(state);
+  int count = static_cast<int>(state.range(1));
+  store.AddListenResults(testutil::Query("coll"), count, 1, DocPath);
+
+  int i = 0;
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    std::vector<Mutation> mutations{
+        testutil::SetMutation(DocPath(i), Map("index", i, "payload", "new"))};
+    benchmark::DoNotOptimize(store->WriteLocally(std::move(mutations)));
+    i = (i + 7919) % count;
+  }
+}
+BENCHMARK(BM_WriteLocally)->Apply(PersistenceAndDatasetSizes);
+
+void BM_CollectGarbage(benchmark::State& state) {
+  BenchmarkLocalStore store(state);
+  int count = static_cast<int>(state.range(1));
+
+  int round = 0;
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    // Each round collects the results of a listen that has just stopped.
+    state.PauseTiming();
+    std::string collection = "round" + std::to_string(round++);
+    auto path_for = [&collection](int i) {
+      return collection + "/doc" + std::to_string(i);
+    };
+    TargetId target_id =
+        store.AddListenResults(testutil::Query(collection), count, 1, path_for);
+    store->ReleaseTarget(target_id);
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(
+        store->CollectGarbage(store.garbage_collector()));
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_CollectGarbage)->Apply(PersistenceAndDatasetSizes);
+
+void BM_ApplyBundledDocuments(benchmark::State& state) {
+  BenchmarkLocalStore store(state);
+  int count = static_cast<int>(state.range(1));
+  store.AddListenResults(testutil::Query("coll"), count, 1, DocPath);
+
+  int64_t version = 2;
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    // Every bundle contains newer versions of all the cached documents.
+    state.PauseTiming();
+    MaybeDocumentMap documents;
+    for (int i = 0; i < count; ++i) {
+      documents = documents.insert(testutil::Key(DocPath(i)),
+                                   MakeDoc(DocPath(i), version, i));
+    }
+    std::string bundle_id = "bundle" + std::to_string(version);
+    ++version;
+    state.ResumeTiming();
+
+    store->StartBundledDocuments(bundle_id);
+    benchmark::DoNotOptimize(
+        store->ApplyBundledDocuments(documents, bundle_id));
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ApplyBundledDocuments)->Apply(PersistenceAndDatasetSizes);
+
+}  // namespace
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
@@ -28,6 +28,7 @@
 #include "Firestore/core/src/local/local_write_result.h"
 #include "Firestore/core/src/local/persistence.h"
 #include "Firestore/core/src/local/query_result.h"
+#include "Firestore/core/src/local/target_cache.h"
 #include "Firestore/core/src/local/target_data.h"
 #include "Firestore/core/src/model/delete_mutation.h"
 #include "Firestore/core/src/model/document_map.h"
@@ -58,7 +59,9 @@ using model::DocumentKey;
 using model::DocumentKeySet;
 using model::DocumentMap;
 using model::DocumentState;
+using model::FieldMask;
 using model::FieldValue;
+using model::kBatchIdUnknown;
 using model::ListenSequenceNumber;
 using model::MaybeDocument;
 using model::MaybeDocumentMap;
@@ -67,6 +70,7 @@ using model::MutationBatch;
 using model::MutationBatchResult;
 using model::MutationResult;
 using model::NumericIncrementTransform;
+using model::Precondition;
 using model::ResourcePath;
 using model::SnapshotVersion;
 using model::TargetId;
@@ -82,12 +86,14 @@ using util::Status;
 using testutil::Array;
 using testutil::DeletedDoc;
 using testutil::Doc;
+using testutil::Field;
 using testutil::Key;
 using testutil::Map;
 using testutil::Query;
 using testutil::UnknownDoc;
 using testutil::Value;
 using testutil::Vector;
+using testutil::WrapObject;
 
 std::vector<MaybeDocument> DocMapToVector(const MaybeDocumentMap& docs) {
   std::vector<MaybeDocument> result;
@@ -295,6 +301,7 @@ QueryResult LocalStoreTest::ExecuteQuery(const core::Query& query) {
 
 void LocalStoreTest::ApplyBundledDocuments(
     const std::vector<MaybeDocument>& documents) {
+  local_store_.StartBundledDocuments("");
   last_changes_ =
       local_store_.ApplyBundledDocuments(DocVectorToMap(documents), "");
 }
@@ -434,6 +441,113 @@ TEST_P(LocalStoreTest, HandlesSetMutation) {
   }
 }
 
+TEST_P(LocalStoreTest, HandlesCoalescedWrites) {
+  std::vector<std::vector<Mutation>> batches;
+  batches.push_back({testutil::SetMutation("foo/bar", Map("foo", "bar"))});
+  batches.push_back(
+      {testutil::PatchMutation("foo/bar", Map("foo", "baz"), {}),
+       testutil::SetMutation("foo/baz", Map("bar", "baz"))});
+
+  std::vector<LocalWriteResult> results =
+      local_store_.WriteLocally(std::move(batches));
+  ASSERT_EQ(results.size(), 2u);
+  ASSERT_LT(results[0].batch_id(), results[1].batch_id());
+  ASSERT_EQ(local_store_.GetHighestUnacknowledgedBatchId(),
+            results[1].batch_id());
+
+  // Each write applies on top of the writes before it.
+  last_changes_ = results[0].changes();
+  FSTAssertChanged(
+      Doc("foo/bar", 0, Map("foo", "bar"), DocumentState::kLocalMutations));
+  last_changes_ = results[1].changes();
+  FSTAssertChanged(
+      Doc("foo/bar", 0, Map("foo", "baz"), DocumentState::kLocalMutations),
+      Doc("foo/baz", 0, Map("bar", "baz"), DocumentState::kLocalMutations));
+  FSTAssertContains(
+      Doc("foo/bar", 0, Map("foo", "baz"), DocumentState::kLocalMutations));
+}
+
+TEST_P(LocalStoreTest, SquashesWritesToTheSameDocument) {
+  LocalWriteResult first = local_store_.WriteLocally(
+      {testutil::SetMutation("foo/bar", Map("a", 1, "b", 1))}, kBatchIdUnknown);
+  ASSERT_EQ(first.squashed_batch_id(), kBatchIdUnknown);
+
+  LocalWriteResult second = local_store_.WriteLocally(
+      {testutil::PatchMutation("foo/bar", Map("b", 2, "c", 2))},
+      kBatchIdUnknown);
+  ASSERT_EQ(second.squashed_batch_id(), first.batch_id());
+  ASSERT_EQ(local_store_.GetHighestUnacknowledgedBatchId(), second.batch_id());
+
+  last_changes_ = second.changes();
+  FSTAssertChanged(Doc("foo/bar", 0, Map("a", 1, "b", 2, "c", 2),
+                       DocumentState::kLocalMutations));
+
+  // A single set replaces both writes.
+  absl::optional<MutationBatch> batch =
+      local_store_.GetNextMutationBatch(kBatchIdUnknown);
+  ASSERT_TRUE(batch.has_value());
+  ASSERT_EQ(batch->batch_id(), second.batch_id());
+  ASSERT_EQ(batch->mutations(),
+            std::vector<Mutation>{testutil::SetMutation(
+                "foo/bar", Map("a", 1, "b", 2, "c", 2))});
+  ASSERT_FALSE(local_store_.GetNextMutationBatch(batch->batch_id()));
+}
+
+TEST_P(LocalStoreTest, SquashesPatchesToTheSameDocument) {
+  LocalWriteResult first = local_store_.WriteLocally(
+      {testutil::PatchMutation("foo/bar", Map("a", Map("b", 1)))},
+      kBatchIdUnknown);
+  LocalWriteResult second = local_store_.WriteLocally(
+      {testutil::PatchMutation("foo/bar", Map("a.c", 2, "d", 2))},
+      kBatchIdUnknown);
+  ASSERT_EQ(second.squashed_batch_id(), first.batch_id());
+
+  absl::optional<MutationBatch> batch =
+      local_store_.GetNextMutationBatch(kBatchIdUnknown);
+  ASSERT_TRUE(batch.has_value());
+  ASSERT_EQ(batch->mutations().size(), 1u);
+  model::PatchMutation patch(batch->mutations().front());
+  ASSERT_EQ(patch.precondition(), Precondition::Exists(true));
+  ASSERT_EQ(patch.mask(), FieldMask({Field("a"), Field("d")}));
+  ASSERT_EQ(patch.value(), WrapObject(Map("a", Map("b", 1, "c", 2), "d", 2)));
+}
+
+TEST_P(LocalStoreTest, DoesNotSquashWritesThatCannotBeCombined) {
+  // Without opting in.
+  LocalWriteResult result = local_store_.WriteLocally(
+      {testutil::SetMutation("foo/bar", Map("a", 1))});
+  result = local_store_.WriteLocally(
+      {testutil::SetMutation("foo/bar", Map("a", 2))});
+  ASSERT_EQ(result.squashed_batch_id(), kBatchIdUnknown);
+
+  // Once the newest batch may have been sent.
+  result = local_store_.WriteLocally(
+      {testutil::SetMutation("foo/bar", Map("a", 3))}, result.batch_id());
+  ASSERT_EQ(result.squashed_batch_id(), kBatchIdUnknown);
+
+  // Different documents, deletes and transforms.
+  result = local_store_.WriteLocally(
+      {testutil::SetMutation("foo/baz", Map("a", 4))}, kBatchIdUnknown);
+  ASSERT_EQ(result.squashed_batch_id(), kBatchIdUnknown);
+  result = local_store_.WriteLocally({testutil::DeleteMutation("foo/baz")},
+                                     kBatchIdUnknown);
+  ASSERT_EQ(result.squashed_batch_id(), kBatchIdUnknown);
+  result = local_store_.WriteLocally(
+      {testutil::PatchMutation("foo/baz", Map(),
+                               {testutil::Increment("sum", Value(1))})},
+      kBatchIdUnknown);
+  ASSERT_EQ(result.squashed_batch_id(), kBatchIdUnknown);
+
+  // A patch that may create the document can't be folded into one that
+  // requires it to exist.
+  result = local_store_.WriteLocally(
+      {testutil::PatchMutation("foo/qux", Map("a", 1))}, kBatchIdUnknown);
+  result = local_store_.WriteLocally(
+      {testutil::MergeMutation("foo/qux", Map("b", 1), {Field("b")})},
+      kBatchIdUnknown);
+  ASSERT_EQ(result.squashed_batch_id(), kBatchIdUnknown);
+}
+
 TEST_P(LocalStoreTest, HandlesSetMutationThenDocument) {
   WriteMutation(testutil::SetMutation("foo/bar", Map("foo", "bar")));
   FSTAssertChanged(
@@ -451,6 +565,74 @@ TEST_P(LocalStoreTest, HandlesSetMutationThenDocument) {
       Doc("foo/bar", 2, Map("foo", "bar"), DocumentState::kLocalMutations));
 }
 
+TEST_P(LocalStoreTest, AcknowledgesSeveralBatchesTogether) {
+  core::Query query = Query("foo");
+  AllocateQuery(query);
+
+  WriteMutation(testutil::SetMutation("foo/bar", Map("foo", "bar")));
+  WriteMutation(testutil::SetMutation("foo/baz", Map("foo", "baz")));
+  WriteMutation(testutil::PatchMutation("foo/bar", Map("foo", "patched")));
+  ASSERT_EQ(batches_.size(), 3);
+
+  // The first two batches are acknowledged, the patch is still pending.
+  std::vector<MutationBatchResult> results;
+  for (size_t i = 0; i < 2; ++i) {
+    SnapshotVersion commit_version =
+        testutil::Version(static_cast<int64_t>(i) + 1);
+    results.emplace_back(batches_[i], commit_version,
+                         std::vector<MutationResult>{
+                             MutationResult(commit_version, absl::nullopt)},
+                         ByteString{});
+  }
+  last_changes_ = local_store_.AcknowledgeBatches(results);
+
+  FSTAssertChanged(Doc("foo/bar", 1, Map("foo", "patched"),
+                       DocumentState::kLocalMutations),
+                   Doc("foo/baz", 2, Map("foo", "baz"),
+                       DocumentState::kCommittedMutations));
+}
+
+TEST_P(LocalStoreTest, ReadsSeveralDocumentsAtOnce) {
+  TargetId target_id = AllocateQuery(Query("foo"));
+  ApplyRemoteEvent(
+      UpdateRemoteEvent(Doc("foo/baz", 2, Map("it", "base")), {target_id}, {}));
+  WriteMutation(testutil::SetMutation("foo/bar", Map("foo", "bar")));
+
+  model::OptionalMaybeDocumentMap docs = local_store_.ReadDocuments(
+      DocumentKeySet{Key("foo/bar"), Key("foo/baz"), Key("foo/missing")});
+
+  ASSERT_EQ(docs.size(), 3u);
+  EXPECT_EQ(docs.find(Key("foo/bar"))->second,
+            Doc("foo/bar", 0, Map("foo", "bar"),
+                DocumentState::kLocalMutations));
+  EXPECT_EQ(docs.find(Key("foo/baz"))->second,
+            Doc("foo/baz", 2, Map("it", "base")));
+  EXPECT_EQ(docs.find(Key("foo/missing"))->second, absl::nullopt);
+}
+
+TEST_P(LocalStoreTest, AppliesQueryResults) {
+  TargetId target_id = AllocateQuery(Query("foo"));
+  ApplyRemoteEvent(
+      UpdateRemoteEvent(Doc("foo/baz", 3, Map("it", "new")), {target_id}, {}));
+  WriteMutation(testutil::SetMutation("foo/bar", Map("foo", "bar")));
+
+  // The cached document is newer than the query result and must be kept.
+  std::vector<model::Document> results{Doc("foo/baz", 2, Map("it", "old")),
+                                       Doc("foo/qux", 2, Map("it", "qux"))};
+  model::MaybeDocumentMap changes =
+      local_store_.ApplyQueryResults(results, testutil::Version(2));
+  ASSERT_EQ(changes.size(), 1u);
+  EXPECT_EQ(changes.get(Key("foo/qux")), Doc("foo/qux", 2, Map("it", "qux")));
+
+  model::MaybeDocumentMap view =
+      local_store_.GetLocalViewOfQueryResults(Query("foo"), results);
+  ASSERT_EQ(view.size(), 3u);
+  EXPECT_EQ(view.get(Key("foo/bar")),
+            Doc("foo/bar", 0, Map("foo", "bar"),
+                DocumentState::kLocalMutations));
+  EXPECT_EQ(view.get(Key("foo/baz")), Doc("foo/baz", 2, Map("it", "old")));
+}
+
 TEST_P(LocalStoreTest, HandlesAckThenRejectThenRemoteEvent) {
   // Start a query that requires acks to be held.
   core::Query query = Query("foo");
@@ -1013,6 +1195,32 @@ TEST_P(LocalStoreTest, CanExecuteCollectionQueries) {
                        DocumentState::kLocalMutations)));
 }
 
+TEST_P(LocalStoreTest, UsesPrefetchedResultsOnce) {
+  core::Query query = Query("foo");
+  local_store_.WriteLocally(
+      {testutil::SetMutation("foo/bar", Map("foo", "bar"))});
+
+  // A result stands for the cache contents it was computed from, whatever they
+  // are, so use an empty one to tell it apart from a fresh execution.
+  uint64_t version = local_store_.query_results_version();
+  local_store_.AddPrefetchedResult(query, QueryResult(), version);
+  ASSERT_TRUE(ExecuteQuery(query).documents().empty());
+  ASSERT_EQ(ExecuteQuery(query).documents().size(), 1u);
+
+  // Results computed before a change are dropped.
+  local_store_.WriteLocally(
+      {testutil::SetMutation("foo/baz", Map("foo", "baz"))});
+  local_store_.AddPrefetchedResult(query, QueryResult(), version);
+  ASSERT_EQ(ExecuteQuery(query).documents().size(), 2u);
+
+  // Results are dropped if the cache changes before they're used.
+  local_store_.AddPrefetchedResult(query, QueryResult(),
+                                   local_store_.query_results_version());
+  local_store_.WriteLocally(
+      {testutil::SetMutation("foo/qux", Map("foo", "qux"))});
+  ASSERT_EQ(ExecuteQuery(query).documents().size(), 3u);
+}
+
 TEST_P(LocalStoreTest, CanExecuteMixedCollectionQueries) {
   core::Query query = Query("foo");
   AllocateQuery(query);
@@ -1033,6 +1241,32 @@ TEST_P(LocalStoreTest, CanExecuteMixedCollectionQueries) {
           Doc("foo/bonk", 0, Map("a", "b"), DocumentState::kLocalMutations)));
 }
 
+TEST_P(LocalStoreTest, CountsDocumentsMatchingQueries) {
+  core::Query query =
+      Query("foo").AddingFilter(testutil::Filter("matches", "==", true));
+  AllocateQuery(query);
+  FSTAssertTargetID(2);
+
+  ApplyRemoteEvent(UpdateRemoteEvent(
+      Doc("foo/a", 10, Map("matches", true)), {2}, {}));
+  ApplyRemoteEvent(UpdateRemoteEvent(
+      Doc("foo/b", 10, Map("matches", true)), {2}, {}));
+  ApplyRemoteEvent(UpdateRemoteEvent(
+      Doc("foo/c", 10, Map("matches", true)), {2}, {}));
+
+  // A pending write can make a cached document stop matching, or make a new
+  // one match.
+  WriteMutation(testutil::PatchMutation("foo/b", Map("matches", false)));
+  WriteMutation(testutil::SetMutation("foo/d", Map("matches", true)));
+  WriteMutation(testutil::SetMutation("foo/e", Map("matches", false)));
+
+  ASSERT_EQ(local_store_.CountQuery(query), 3);
+  ASSERT_EQ(local_store_.CountQuery(query.WithLimitToFirst(2)), 2);
+  ASSERT_EQ(local_store_.CountQuery(Query("foo")), 5);
+  ASSERT_EQ(local_store_.CountQuery(Query("foo/d")), 1);
+  ASSERT_EQ(local_store_.CountQuery(Query("foo/f")), 0);
+}
+
 TEST_P(LocalStoreTest, ReadsAllDocumentsForInitialCollectionQueries) {
   core::Query query = Query("foo");
   local_store_.AllocateTarget(query.ToTarget());
@@ -1049,6 +1283,23 @@ TEST_P(LocalStoreTest, ReadsAllDocumentsForInitialCollectionQueries) {
   FSTAssertMutationsRead(/* by_key= */ 0, /* by_query= */ 1);
 }
 
+TEST_P(LocalStoreTest, ReadsOnlyUpToLimitForKeyOrderedLimitQueries) {
+  core::Query query = Query("foo").WithLimitToFirst(2);
+  local_store_.AllocateTarget(query.ToTarget());
+
+  ApplyRemoteEvent(UpdateRemoteEvent(Doc("foo/a", 10, Map()), {2}, {}));
+  ApplyRemoteEvent(UpdateRemoteEvent(Doc("foo/b", 10, Map()), {2}, {}));
+  ApplyRemoteEvent(UpdateRemoteEvent(Doc("foo/c", 10, Map()), {2}, {}));
+  WriteMutation(testutil::SetMutation("foo/bonk", Map()));
+
+  ExecuteQuery(query);
+
+  // Only the first two remote documents are read by the query, plus the base
+  // document of the pending mutation. The view applies the limit afterwards.
+  FSTAssertRemoteDocumentsRead(/* by_key= */ 1, /* by_query= */ 2);
+  FSTAssertQueryReturned("foo/a", "foo/b", "foo/bonk");
+}
+
 TEST_P(LocalStoreTest, PersistsResumeTokens) {
   // This test only works in the absence of the FSTEagerGarbageCollector.
   if (IsGcEager()) return;
@@ -1083,6 +1334,30 @@ TEST_P(LocalStoreTest, PersistsResumeTokens) {
   ASSERT_GT(new_sequence_number, initial_sequence_number);
 }
 
+TEST_P(LocalStoreTest, PersistsResumeTokensKeptInMemory) {
+  core::Query query = Query("foo");
+  TargetData target_data = local_store_.AllocateTarget(query.ToTarget());
+  TargetId target_id = target_data.target_id();
+
+  // The first resume token is persisted right away, but a newer one without
+  // any changes to the target is only kept in memory.
+  ApplyRemoteEvent(NoChangeEvent(target_id, 1000));
+  ApplyRemoteEvent(NoChangeEvent(target_id, 2000));
+
+  auto persisted_token = [&] {
+    return persistence_->Run("Read target", [&] {
+      return persistence_->target_cache()
+          ->GetTarget(query.ToTarget())
+          ->resume_token();
+    });
+  };
+  EXPECT_EQ(persisted_token(), testutil::ResumeToken(1000));
+
+  EXPECT_EQ(local_store_.PersistResumeTokens(), 1u);
+  EXPECT_EQ(persisted_token(), testutil::ResumeToken(2000));
+  EXPECT_EQ(local_store_.PersistResumeTokens(), 0u);
+}
+
 TEST_P(LocalStoreTest, RemoteDocumentKeysForTarget) {
   core::Query query = Query("foo");
   AllocateQuery(query);
@@ -1489,6 +1764,25 @@ TEST_P(LocalStoreTest, HandlesSavingBundledDocuments) {
   FSTAssertQueryDocumentMapping(2, expected_keys);
 }
 
+TEST_P(LocalStoreTest, AddsBundledDocumentChunksToUmbrellaTarget) {
+  local_store_.StartBundledDocuments("bundle");
+  local_store_.ApplyBundledDocuments(
+      DocVectorToMap({Doc("foo/bar", 1, Map("sum", 1))}), "bundle");
+  last_changes_ = local_store_.ApplyBundledDocuments(
+      DocVectorToMap({Doc("foo/baz", 1, Map("sum", 2))}), "bundle");
+  FSTAssertChanged(Doc("foo/baz", 1, Map("sum", 2)));
+  FSTAssertContains(Doc("foo/bar", 1, Map("sum", 1)));
+
+  DocumentKeySet expected_keys({Key("foo/bar"), Key("foo/baz")});
+  FSTAssertQueryDocumentMapping(2, expected_keys);
+
+  // Loading the bundle again starts from an empty umbrella target.
+  local_store_.StartBundledDocuments("bundle");
+  local_store_.ApplyBundledDocuments(
+      DocVectorToMap({Doc("foo/baz", 2, Map("sum", 3))}), "bundle");
+  FSTAssertQueryDocumentMapping(2, DocumentKeySet({Key("foo/baz")}));
+}
+
 TEST_P(LocalStoreTest, HandlesSavingBundledDocumentsWithNewerExistingVersion) {
   core::Query query = Query("foo");
   AllocateQuery(query);
@@ -1507,6 +1801,21 @@ TEST_P(LocalStoreTest, HandlesSavingBundledDocumentsWithNewerExistingVersion) {
   FSTAssertQueryDocumentMapping(4, expected_keys);
 }
 
+TEST_P(LocalStoreTest, FindsStaleBundledDocuments) {
+  core::Query query = Query("foo");
+  AllocateQuery(query);
+  FSTAssertTargetID(2);
+
+  ApplyRemoteEvent(AddedRemoteEvent(Doc("foo/bar", 2, Map("sum", 1337)), {2}));
+  ApplyRemoteEvent(AddedRemoteEvent(Doc("foo/baz", 2, Map("sum", 1337)), {2}));
+
+  model::DocumentVersionMap versions{{Key("foo/bar"), testutil::Version(1)},
+                                     {Key("foo/baz"), testutil::Version(3)},
+                                     {Key("foo/new"), testutil::Version(1)}};
+  EXPECT_EQ(local_store_.FindStaleBundledDocumentsFromSnapshot(versions),
+            DocumentKeySet({Key("foo/bar")}));
+}
+
 TEST_P(LocalStoreTest, HandlesSavingBundledDocumentsWithOlderExistingVersion) {
   core::Query query = Query("foo");
   AllocateQuery(query);
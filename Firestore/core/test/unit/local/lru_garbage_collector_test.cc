@@ -16,6 +16,7 @@
 
 #include "Firestore/core/test/unit/local/lru_garbage_collector_test.h"
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -476,6 +477,52 @@ TEST_P(LruGarbageCollectorTest, RemoveOrphanedDocuments) {
 
 // TODO(gsoltis): write a test that includes limbo documents
 
+TEST_P(LruGarbageCollectorTest, RemoveOrphanedDocumentsPinnedByManyUsers) {
+  NewTestResources();
+
+  // Enough documents to span several batches of pin checks, with every third
+  // one mutated by either user.
+  std::unordered_set<DocumentKey, DocumentKeyHash> expected_retained;
+  std::vector<Mutation> mutations;
+  std::vector<Mutation> other_mutations;
+  persistence_->Run("add orphaned docs", [&] {
+    for (int i = 0; i < 250; i++) {
+      Document doc = CacheADocumentInTransaction();
+      MarkDocumentEligibleForGcInTransaction(doc.key());
+      if (i % 3 == 0) {
+        expected_retained.insert(doc.key());
+        std::vector<Mutation>& queue =
+            i % 2 == 0 ? mutations : other_mutations;
+        queue.push_back(MutationForDocument(doc.key()));
+      }
+    }
+  });
+
+  // Only the current user's queue can be written to, so switch users to queue
+  // the other user's mutations.
+  persistence_->Run("register the other user's mutations", [&] {
+    MutationQueue* other_queue =
+        persistence_->GetMutationQueueForUser(User("other"));
+    other_queue->Start();
+    other_queue->AddMutationBatch(Timestamp::Now(), {},
+                                  std::move(other_mutations));
+  });
+  persistence_->Run("register the mutations", [&] {
+    mutation_queue_ = persistence_->GetMutationQueueForUser(user_);
+    mutation_queue_->Start();
+    mutation_queue_->AddMutationBatch(Timestamp::Now(), {},
+                                      std::move(mutations));
+  });
+
+  int removed = RemoveOrphanedDocuments(1000);
+  ASSERT_EQ(250 - static_cast<int>(expected_retained.size()), removed);
+  persistence_->Run("verify", [&] {
+    for (const DocumentKey& key : expected_retained) {
+      ASSERT_NE(document_cache_->Get(key), absl::nullopt);
+    }
+  });
+}
+
 TEST_P(LruGarbageCollectorTest, RemoveTargetsThenGC) {
   // Setup:
   //   - Create 3 targets, add docs to all of them.
@@ -765,6 +812,76 @@ TEST_P(LruGarbageCollectorTest, GCRan) {
   ASSERT_EQ(100, results.documents_removed);
 }
 
+TEST_P(LruGarbageCollectorTest, RecentlyReadDocumentsAreCollectedLast) {
+  LruParams params = LruParams::Default();
+  params.min_bytes_threshold = 1;
+  NewTestResources(params);
+
+  // Give each orphaned document its own sequence number.
+  std::vector<DocumentKey> keys;
+  for (int i = 0; i < 20; i++) {
+    persistence_->Run("add an orphaned document", [&] {
+      Document doc = CacheADocumentInTransaction();
+      MarkDocumentEligibleForGcInTransaction(doc.key());
+      keys.push_back(doc.key());
+    });
+  }
+
+  // Reading the oldest document makes it the most recently used one.
+  persistence_->reference_delegate()->RecordDocumentAccess(keys[0]);
+
+  // By default, we collect 10% of the 20 sequence numbers.
+  LruResults results =
+      persistence_->Run("GC", [&] { return gc_->Collect({}); });
+  ASSERT_TRUE(results.did_run);
+  ASSERT_EQ(2, results.documents_removed);
+  persistence_->Run("verify", [&] {
+    ASSERT_NE(document_cache_->Get(keys[0]), absl::nullopt);
+    ASSERT_EQ(document_cache_->Get(keys[1]), absl::nullopt);
+    ASSERT_EQ(document_cache_->Get(keys[2]), absl::nullopt);
+    ASSERT_NE(document_cache_->Get(keys[3]), absl::nullopt);
+  });
+}
+
+TEST_P(LruGarbageCollectorTest, GCRanInSlices) {
+  LruParams params = LruParams::Default();
+  params.min_bytes_threshold = 100;
+  NewTestResources(params);
+
+  for (int i = 0; i < 100; i++) {
+    persistence_->Run("Add a target and some documents", [&] {
+      TargetData target_data = AddNextQueryInTransaction();
+      for (int j = 0; j < 10; j++) {
+        Document doc = CacheADocumentInTransaction();
+        AddDocument(doc.key(), target_data.target_id());
+      }
+    });
+  }
+
+  // With no time budget, every slice stops after examining one document.
+  LruResults results;
+  int slices = 0;
+  do {
+    results = persistence_->Run("GC slice", [&] {
+      return gc_->CollectSlice({}, std::chrono::milliseconds(0));
+    });
+    ASSERT_TRUE(results.did_run);
+    ++slices;
+  } while (!results.finished && slices < 10000);
+
+  // Slicing collects the same as collecting in one go does.
+  ASSERT_TRUE(results.finished);
+  ASSERT_EQ(10, results.targets_removed);
+  ASSERT_EQ(100, results.documents_removed);
+
+  // A new collection starts once the previous one is finished.
+  results = persistence_->Run("GC slice", [&] {
+    return gc_->CollectSlice({}, std::chrono::hours(1));
+  });
+  ASSERT_TRUE(results.did_run);
+  ASSERT_TRUE(results.finished);
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
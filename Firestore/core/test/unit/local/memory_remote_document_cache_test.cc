@@ -18,11 +18,17 @@
 
 #include <memory>
 
+#include "Firestore/core/src/local/local_serializer.h"
 #include "Firestore/core/src/local/memory_persistence.h"
 #include "Firestore/core/src/local/reference_delegate.h"
 #include "Firestore/core/src/local/remote_document_cache.h"
+#include "Firestore/core/src/local/sizer.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/remote/serializer.h"
 #include "Firestore/core/test/unit/local/persistence_testing.h"
 #include "Firestore/core/test/unit/local/remote_document_cache_test.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
 #include "absl/memory/memory.h"
 #include "gtest/gtest.h"
 
@@ -31,16 +37,77 @@ namespace firestore {
 namespace local {
 namespace {
 
+using model::MaybeDocument;
+using testutil::Doc;
+using testutil::Key;
+using testutil::Map;
+using testutil::Version;
+
+/** A Sizer that counts the documents it sizes, each of which has size 10. */
+class CountingSizer : public Sizer {
+ public:
+  int64_t CalculateByteSize(const MaybeDocument&) const override {
+    ++sized_documents;
+    return 10;
+  }
+
+  int64_t CalculateByteSize(const model::MutationBatch&) const override {
+    return 0;
+  }
+
+  int64_t CalculateByteSize(const TargetData&) const override {
+    return 0;
+  }
+
+  mutable int sized_documents = 0;
+};
+
 std::unique_ptr<Persistence> PersistenceFactory() {
   return MemoryPersistenceWithEagerGcForTesting();
 }
 
+std::unique_ptr<Persistence> CompactPersistenceFactory() {
+  auto persistence = MemoryPersistenceWithEagerGcForTesting();
+  remote::Serializer remote_serializer{model::DatabaseId("p", "d")};
+  persistence->remote_document_cache()->EnableCompactStorage(
+      LocalSerializer(std::move(remote_serializer)));
+  return persistence;
+}
+
 }  // namespace
 
 INSTANTIATE_TEST_SUITE_P(MemoryRemoteDocumentCacheTest,
                          RemoteDocumentCacheTest,
                          testing::Values(PersistenceFactory));
 
+INSTANTIATE_TEST_SUITE_P(CompactMemoryRemoteDocumentCacheTest,
+                         RemoteDocumentCacheTest,
+                         testing::Values(CompactPersistenceFactory));
+
+TEST(MemoryRemoteDocumentCacheTest, SizesOnlyChangedDocuments) {
+  auto persistence = MemoryPersistenceWithEagerGcForTesting();
+  MemoryRemoteDocumentCache* cache = persistence->remote_document_cache();
+  CountingSizer sizer;
+
+  persistence->Run("add documents", [&] {
+    cache->Add(Doc("coll/a", 1, Map()), Version(1));
+    cache->Add(Doc("coll/b", 1, Map()), Version(1));
+    cache->Add(Doc("coll/c", 1, Map()), Version(1));
+  });
+  ASSERT_EQ(cache->CalculateByteSize(sizer), 30);
+  ASSERT_EQ(sizer.sized_documents, 3);
+
+  persistence->Run("change documents", [&] {
+    cache->Add(Doc("coll/a", 2, Map("foo", "bar")), Version(2));
+    cache->Remove(Key("coll/b"));
+  });
+  ASSERT_EQ(cache->CalculateByteSize(sizer), 20);
+  ASSERT_EQ(sizer.sized_documents, 4);
+
+  ASSERT_EQ(cache->CalculateByteSize(sizer), 20);
+  ASSERT_EQ(sizer.sized_documents, 4);
+}
+
 }  // namespace local
 }  // namespace firestore
 }  // namespace firebase
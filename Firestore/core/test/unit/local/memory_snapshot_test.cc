@@ -0,0 +1,168 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/memory_snapshot.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Firestore/core/include/firebase/firestore/timestamp.h"
+#include "Firestore/core/src/auth/user.h"
+#include "Firestore/core/src/local/local_serializer.h"
+#include "Firestore/core/src/local/memory_mutation_queue.h"
+#include "Firestore/core/src/local/memory_persistence.h"
+#include "Firestore/core/src/local/memory_remote_document_cache.h"
+#include "Firestore/core/src/local/memory_target_cache.h"
+#include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/mutation_batch.h"
+#include "Firestore/core/src/model/no_document.h"
+#include "Firestore/core/src/model/set_mutation.h"
+#include "Firestore/core/src/remote/serializer.h"
+#include "Firestore/core/src/util/path.h"
+#include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/testutil/filesystem_testing.h"
+#include "Firestore/core/test/unit/testutil/status_testing.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+namespace {
+
+using auth::User;
+using core::Query;
+using model::DocumentKeySet;
+using model::MutationBatch;
+using testutil::DeletedDoc;
+using testutil::Doc;
+using testutil::IsNotFound;
+using testutil::IsOk;
+using testutil::Key;
+using testutil::Map;
+using testutil::ResumeToken;
+using testutil::Version;
+using util::Path;
+
+class MemorySnapshotTest : public testing::Test {
+ public:
+  MemorySnapshotTest()
+      : snapshot_(LocalSerializer(remote::Serializer(testutil::DbId()))),
+        persistence_(MemoryPersistenceWithEagerGcForTesting()),
+        restored_(MemoryPersistenceWithEagerGcForTesting()) {
+  }
+
+ protected:
+  TargetData MakeTargetData(Query query, model::TargetId target_id) {
+    return TargetData(query.ToTarget(), target_id, /*sequence_number=*/10,
+                      QueryPurpose::Listen, Version(20), Version(20),
+                      ResumeToken(20));
+  }
+
+  /** Fills `persistence_` with a little of everything a snapshot holds. */
+  void PopulatePersistence() {
+    persistence_->Run("Populate", [&] {
+      RemoteDocumentCache* documents = persistence_->remote_document_cache();
+      documents->Add(Doc("rooms/a", 1, Map("name", "a")), Version(1));
+      documents->Add(DeletedDoc("rooms/b", 2), Version(3));
+
+      TargetCache* targets = persistence_->target_cache();
+      targets->AddTarget(MakeTargetData(testutil::Query("rooms"), 2));
+      targets->AddMatchingKeys(DocumentKeySet{Key("rooms/a")}, 2);
+      targets->SetLastRemoteSnapshotVersion(Version(30));
+
+      MutationQueue* queue = persistence_->GetMutationQueueForUser(User("u"));
+      queue->Start();
+      queue->AddMutationBatch(Timestamp::Now(), {},
+                              {testutil::SetMutation("rooms/c", Map("a", 1))});
+      queue->SetLastStreamToken(ResumeToken(40));
+    });
+  }
+
+  MemorySnapshot snapshot_;
+  std::unique_ptr<MemoryPersistence> persistence_;
+  std::unique_ptr<MemoryPersistence> restored_;
+};
+
+TEST_F(MemorySnapshotTest, RoundTripsContents) {
+  PopulatePersistence();
+  std::string data = snapshot_.Encode(persistence_.get());
+
+  ASSERT_THAT(snapshot_.Decode(data, restored_.get()), IsOk());
+
+  restored_->Run("Verify", [&] {
+    RemoteDocumentCache* documents = restored_->remote_document_cache();
+    EXPECT_EQ(documents->Get(Key("rooms/a")),
+              Doc("rooms/a", 1, Map("name", "a")));
+    EXPECT_EQ(documents->Get(Key("rooms/b")), DeletedDoc("rooms/b", 2));
+
+    TargetCache* targets = restored_->target_cache();
+    absl::optional<TargetData> target =
+        targets->GetTarget(testutil::Query("rooms").ToTarget());
+    ASSERT_TRUE(target.has_value());
+    EXPECT_EQ(*target, MakeTargetData(testutil::Query("rooms"), 2));
+    EXPECT_EQ(targets->GetMatchingKeys(2), DocumentKeySet{Key("rooms/a")});
+    EXPECT_EQ(targets->GetLastRemoteSnapshotVersion(), Version(30));
+    EXPECT_EQ(targets->highest_target_id(), 2);
+
+    MutationQueue* queue = restored_->GetMutationQueueForUser(User("u"));
+    queue->Start();
+    std::vector<MutationBatch> batches = queue->AllMutationBatches();
+    ASSERT_EQ(batches.size(), 1u);
+    EXPECT_EQ(batches[0].mutations(),
+              std::vector<model::Mutation>{
+                  testutil::SetMutation("rooms/c", Map("a", 1))});
+    EXPECT_EQ(queue->GetLastStreamToken(), ResumeToken(40));
+  });
+}
+
+TEST_F(MemorySnapshotTest, RejectsCorruptData) {
+  PopulatePersistence();
+  std::string data = snapshot_.Encode(persistence_.get());
+  std::string empty = snapshot_.Encode(restored_.get());
+
+  EXPECT_FALSE(snapshot_.Decode("not a snapshot", restored_.get()).ok());
+  EXPECT_FALSE(
+      snapshot_.Decode(data.substr(0, data.size() - 1), restored_.get()).ok());
+  EXPECT_FALSE(
+      snapshot_.Decode(data.substr(0, data.size() / 2), restored_.get()).ok());
+
+  // None of the failed attempts may leave partial contents behind.
+  EXPECT_EQ(snapshot_.Encode(restored_.get()), empty);
+}
+
+TEST_F(MemorySnapshotTest, LoadsWrittenFile) {
+  testutil::TestTempDir dir;
+  Path path = dir.Child("snapshot");
+
+  EXPECT_THAT(snapshot_.Load(path, restored_.get()), IsNotFound());
+
+  PopulatePersistence();
+  ASSERT_THAT(MemorySnapshot::Write(path, snapshot_.Encode(persistence_.get())),
+              IsOk());
+  ASSERT_THAT(snapshot_.Load(path, restored_.get()), IsOk());
+
+  EXPECT_EQ(snapshot_.Encode(restored_.get()),
+            snapshot_.Encode(persistence_.get()));
+}
+
+}  // namespace
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
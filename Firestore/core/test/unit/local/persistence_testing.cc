@@ -83,6 +83,18 @@ std::unique_ptr<LevelDbPersistence> LevelDbPersistenceForTesting(
   return LevelDbPersistenceForTesting(LevelDbDir(), lru_params);
 }
 
+std::unique_ptr<LevelDbPersistence> LevelDbPersistenceForTesting(
+    const LevelDbOptions& options) {
+  Path dir = LevelDbDir();
+  auto created = LevelDbPersistence::Create(dir, MakeLocalSerializer(),
+                                            LruParams::Default(), options);
+  if (!created.ok()) {
+    util::ThrowIllegalState("Failed to open leveldb in dir %s: %s",
+                            dir.ToUtf8String(), created.status().ToString());
+  }
+  return std::move(created).ValueOrDie();
+}
+
 std::unique_ptr<LevelDbPersistence> LevelDbPersistenceForTesting() {
   return LevelDbPersistenceForTesting(LevelDbDir());
 }
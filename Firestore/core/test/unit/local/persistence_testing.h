@@ -29,6 +29,7 @@ class Path;
 
 namespace local {
 
+struct LevelDbOptions;
 class LevelDbPersistence;
 struct LruParams;
 class MemoryPersistence;
@@ -67,6 +68,15 @@ std::unique_ptr<LevelDbPersistence> LevelDbPersistenceForTesting(
 std::unique_ptr<LevelDbPersistence> LevelDbPersistenceForTesting(
     LruParams lru_params);
 
+/**
+ * Creates and starts a new LevelDbPersistence instance for testing, destroying
+ * any previous contents if they existed.
+ *
+ * Opens the database with the provided LevelDB tuning options.
+ */
+std::unique_ptr<LevelDbPersistence> LevelDbPersistenceForTesting(
+    const LevelDbOptions& options);
+
 /** Creates and starts a new MemoryPersistence instance for testing. */
 std::unique_ptr<MemoryPersistence> MemoryPersistenceWithEagerGcForTesting();
 
@@ -126,6 +126,8 @@ class QueryEngineTest : public ::testing::Test {
         local_documents_view_(
             remote_document_cache_,
             persistence_->GetMutationQueueForUser(User::Unauthenticated()),
+            persistence_->GetDocumentOverlayCacheForUser(
+                User::Unauthenticated()),
             index_manager_.get()) {
     query_engine_.SetLocalDocumentsView(&local_documents_view_);
   }
@@ -174,6 +176,10 @@ class QueryEngineTest : public ::testing::Test {
     return view.ApplyChanges(view_doc_changes).snapshot()->documents();
   }
 
+  const QueryPlan& last_query_plan() const {
+    return query_engine_.last_query_plan();
+  }
+
  private:
   std::unique_ptr<Persistence> persistence_;
   RemoteDocumentCache* remote_document_cache_ = nullptr;
@@ -192,6 +198,9 @@ TEST_F(QueryEngineTest, UsesTargetMappingForInitialView) {
   DocumentSet docs = ExpectOptimizedCollectionScan(
       [&] { return RunQuery(query, kLastLimboFreeSnapshot); });
   EXPECT_EQ(docs, DocSet(query.Comparator(), {kMatchingDocA, kMatchingDocB}));
+  EXPECT_EQ(last_query_plan().strategy, QueryStrategy::IndexFree);
+  EXPECT_EQ(last_query_plan().estimated_documents_read, 2);
+  EXPECT_EQ(last_query_plan().actual_documents_read, 2);
 }
 
 TEST_F(QueryEngineTest, FiltersNonMatchingInitialResults) {
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/query_planner.h"
+
+#include "Firestore/core/src/core/field_filter.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/local/sizer.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/document_map.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+namespace {
+
+using model::DocumentKeySet;
+using model::DocumentMap;
+using model::MaybeDocument;
+using model::ResourcePath;
+using testutil::Doc;
+using testutil::Filter;
+using testutil::Key;
+using testutil::Map;
+using testutil::Query;
+
+/** A Sizer where every document has the same size. */
+class FixedSizer : public Sizer {
+ public:
+  explicit FixedSizer(int64_t size) : size_(size) {
+  }
+
+  int64_t CalculateByteSize(const MaybeDocument&) const override {
+    return size_;
+  }
+
+  int64_t CalculateByteSize(const model::MutationBatch&) const override {
+    return 0;
+  }
+
+  int64_t CalculateByteSize(const TargetData&) const override {
+    return 0;
+  }
+
+ private:
+  int64_t size_ = 0;
+};
+
+DocumentMap CollectionDocs(int count) {
+  DocumentMap result;
+  for (int i = 0; i < count; ++i) {
+    model::Document doc = Doc("coll/doc" + std::to_string(i), 1, Map());
+    result = result.insert(doc.key(), doc);
+  }
+  return result;
+}
+
+DocumentKeySet Keys(int count) {
+  DocumentKeySet result;
+  for (int i = 0; i < count; ++i) {
+    result = result.insert(Key("coll/doc" + std::to_string(i)));
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(QueryPlannerTest, CollectionScanCostIsUnknownWithoutStats) {
+  QueryPlanner planner;
+  core::Query query = Query("coll").AddingFilter(Filter("a", "==", 1));
+
+  QueryPlan plan = planner.PlanCollectionScan(query, absl::nullopt);
+  EXPECT_EQ(plan.strategy, QueryStrategy::FullCollectionScan);
+  EXPECT_EQ(plan.estimated_documents_read, -1);
+  EXPECT_GT(plan.estimated_cost,
+            planner.PlanIndexFree(query, Keys(1000)).estimated_cost);
+}
+
+TEST(QueryPlannerTest, RecordsOnlyUnfilteredCollectionScans) {
+  QueryPlanner planner;
+  planner.RecordCollectionScan(
+      Query("coll").AddingFilter(Filter("a", "==", 1)), CollectionDocs(2));
+  EXPECT_EQ(planner.GetCollectionStats(ResourcePath{"coll"}), absl::nullopt);
+
+  planner.RecordCollectionScan(Query("coll"), CollectionDocs(5));
+  absl::optional<QueryPlanner::CollectionStats> stats =
+      planner.GetCollectionStats(ResourcePath{"coll"});
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->document_count, 5);
+  EXPECT_EQ(stats->average_document_size, 0);
+}
+
+TEST(QueryPlannerTest, EstimatesFromCollectionStats) {
+  QueryPlanner planner;
+  planner.RecordCollectionScan(Query("coll"), CollectionDocs(10));
+  core::Query query = Query("coll").AddingFilter(Filter("a", "==", 1));
+
+  QueryPlan scan = planner.PlanCollectionScan(query, absl::nullopt);
+  EXPECT_EQ(scan.estimated_documents_read, 10);
+
+  // Point lookups cost more than scanning, so reading most of the collection
+  // by key is more expensive than reading all of it.
+  EXPECT_LT(planner.PlanIndexFree(query, Keys(2)).estimated_cost,
+            scan.estimated_cost);
+  EXPECT_GT(planner.PlanIndexFree(query, Keys(8)).estimated_cost,
+            scan.estimated_cost);
+}
+
+TEST(QueryPlannerTest, UsesIndexCandidates) {
+  QueryPlanner planner;
+  core::Query query = Query("coll").AddingFilter(Filter("a", "==", 1));
+
+  QueryPlan plan = planner.PlanCollectionScan(query, Keys(3));
+  EXPECT_EQ(plan.strategy, QueryStrategy::IndexScan);
+  EXPECT_EQ(plan.estimated_documents_read, 3);
+  EXPECT_EQ(plan.estimated_cost,
+            planner.PlanIndexFree(query, Keys(3)).estimated_cost);
+}
+
+TEST(QueryPlannerTest, WeighsDocumentSize) {
+  FixedSizer sizer(4096);
+  QueryPlanner planner;
+  planner.SetSizer(&sizer);
+  planner.RecordCollectionScan(Query("coll"), CollectionDocs(10));
+  EXPECT_EQ(planner.GetCollectionStats(ResourcePath{"coll"})
+                ->average_document_size,
+            4096);
+
+  // With large documents, decoding dominates and reading fewer documents by
+  // key beats scanning the collection.
+  core::Query query = Query("coll").AddingFilter(Filter("a", "==", 1));
+  EXPECT_LT(planner.PlanIndexFree(query, Keys(8)).estimated_cost,
+            planner.PlanCollectionScan(query, absl::nullopt).estimated_cost);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
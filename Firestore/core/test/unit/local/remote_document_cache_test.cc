@@ -19,6 +19,7 @@
 #include <memory>
 #include <vector>
 
+#include "Firestore/core/src/core/field_filter.h"
 #include "Firestore/core/src/core/query.h"
 #include "Firestore/core/src/local/memory_remote_document_cache.h"
 #include "Firestore/core/src/local/persistence.h"
@@ -27,8 +28,10 @@
 #include "Firestore/core/src/model/document_key_set.h"
 #include "Firestore/core/src/model/document_map.h"
 #include "Firestore/core/src/model/no_document.h"
+#include "Firestore/core/src/model/resource_path.h"
 #include "Firestore/core/src/util/string_apple.h"
 #include "Firestore/core/test/unit/testutil/testutil.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -48,6 +51,7 @@ using model::MaybeDocument;
 using model::MaybeDocumentMap;
 using model::NoDocument;
 using model::OptionalMaybeDocumentMap;
+using model::ResourcePath;
 using model::SnapshotVersion;
 
 using testing::IsSupersetOf;
@@ -55,6 +59,7 @@ using testing::Matches;
 using testing::UnorderedElementsAreArray;
 using testutil::DeletedDoc;
 using testutil::Doc;
+using testutil::Filter;
 using testutil::Map;
 using testutil::Query;
 using testutil::Version;
@@ -127,6 +132,24 @@ TEST_P(RemoteDocumentCacheTest, SetAndReadSeveralDocuments) {
   });
 }
 
+TEST_P(RemoteDocumentCacheTest, AddAllWritesEachDocument) {
+  persistence_->Run("test_add_all_writes_each_document", [&] {
+    // Enough documents to be encoded by several tasks.
+    std::vector<DocumentReadTime> added;
+    std::vector<Document> written;
+    DocumentKeySet keys;
+    for (int i = 0; i < 100; ++i) {
+      Document doc = Doc(absl::StrCat("a/", i), 42, Map("index", i));
+      added.emplace_back(doc, Version(43));
+      written.push_back(doc);
+      keys = keys.insert(doc.key());
+    }
+    cache_->AddAll(added);
+
+    EXPECT_THAT(cache_->GetAll(keys), HasExactlyDocs(written));
+  });
+}
+
 TEST_P(RemoteDocumentCacheTest,
        SetAndReadSeveralDocumentsIncludingMissingDocument) {
   persistence_->Run(
@@ -208,6 +231,162 @@ TEST_P(RemoteDocumentCacheTest, DocumentsMatchingQuery) {
   });
 }
 
+TEST_P(RemoteDocumentCacheTest, DocumentsMatchingInCollections) {
+  persistence_->Run("test_documents_matching_in_collections", [&] {
+    SetTestDocument("a/1/c/1");
+    SetTestDocument("a/1/c/1/c/2");
+    SetTestDocument("a/2/c/1");
+    SetTestDocument("a/2/d/1");
+    SetTestDocument("a/3/c/1");
+    SetTestDocument("c/1");
+
+    core::Query query = testutil::CollectionGroupQuery("c");
+    std::vector<ResourcePath> collection_paths = {
+        ResourcePath::FromString("a/1/c"),
+        ResourcePath::FromString("a/2/c"),
+    };
+    DocumentMap results = cache_->GetMatchingInCollections(
+        query, collection_paths, SnapshotVersion::None());
+    std::vector<Document> docs = {
+        Doc("a/1/c/1", kVersion, kDocData),
+        Doc("a/2/c/1", kVersion, kDocData),
+    };
+    EXPECT_THAT(results.underlying_map(), HasExactlyDocs(docs));
+  });
+}
+
+TEST_P(RemoteDocumentCacheTest, DocumentsMatchingCandidates) {
+  persistence_->Run("test_documents_matching_candidates", [&] {
+    SetTestDocument("b/1");
+    SetTestDocument("b/2");
+    SetTestDocument("b/3");
+    cache_->Add(DeletedDoc("b/4", kVersion), Version(kVersion));
+
+    DocumentKeySet candidates{testutil::Key("b/1"), testutil::Key("b/3"),
+                              testutil::Key("b/4"), testutil::Key("b/5")};
+    DocumentMap results = cache_->GetMatchingCandidates(Query("b"), candidates);
+    std::vector<Document> docs = {
+        Doc("b/1", kVersion, kDocData),
+        Doc("b/3", kVersion, kDocData),
+    };
+    EXPECT_THAT(results.underlying_map(), HasExactlyDocs(docs));
+  });
+}
+
+TEST_P(RemoteDocumentCacheTest, DocumentsMatchingQueryWithFilter) {
+  persistence_->Run("test_documents_matching_query_with_filter", [&] {
+    std::vector<Document> matching;
+    for (int i = 0; i < 100; ++i) {
+      Document doc = Doc("b/" + std::to_string(i), kVersion,
+                         Map("even", i % 2 == 0, "nested", Map("i", i)));
+      cache_->Add(doc, doc.version());
+      if (i % 2 == 0) matching.push_back(doc);
+    }
+
+    core::Query query = Query("b").AddingFilter(Filter("even", "==", true));
+    DocumentMap results = cache_->GetMatching(query, SnapshotVersion::None());
+    EXPECT_THAT(results.underlying_map(), HasExactlyDocs(matching));
+  });
+}
+
+TEST_P(RemoteDocumentCacheTest, DocumentsMatchingQueryWithManyDocuments) {
+  persistence_->Run("test_documents_matching_query_many", [&] {
+    // Enough documents to span several decoding batches.
+    std::vector<Document> docs;
+    for (int i = 0; i < 100; ++i) {
+      docs.push_back(SetTestDocument("b/" + std::to_string(i)));
+    }
+    SetTestDocument("a/1");
+    SetTestDocument("c/1");
+
+    DocumentMap results =
+        cache_->GetMatching(Query("b"), SnapshotVersion::None());
+    EXPECT_THAT(results.underlying_map(), HasExactlyDocs(docs));
+
+    DocumentKeySet keys;
+    for (const Document& doc : docs) {
+      keys = keys.insert(doc.key());
+    }
+    keys = keys.insert(testutil::Key("b/missing"));
+    OptionalMaybeDocumentMap all = cache_->GetAll(keys);
+    EXPECT_EQ(all.size(), 101u);
+    EXPECT_EQ(all.get(testutil::Key("b/missing")).value(), absl::nullopt);
+    EXPECT_EQ(all.get(testutil::Key("b/42")).value(),
+              Doc("b/42", kVersion, kDocData));
+  });
+}
+
+TEST_P(RemoteDocumentCacheTest, DocumentsMatchingQueryWithKeyBounds) {
+  persistence_->Run("test_documents_matching_query_with_key_bounds", [&] {
+    std::vector<Document> docs;
+    for (int i = 0; i < 10; ++i) {
+      docs.push_back(SetTestDocument("b/" + std::to_string(i)));
+    }
+    SetTestDocument("b/5/c/1");
+    SetTestDocument("c/1");
+
+    core::Query query =
+        Query("b")
+            .StartingAt(core::Bound({testutil::Ref("project", "b/3")},
+                                    /* is_before= */ false))
+            .EndingAt(core::Bound({testutil::Ref("project", "b/6")},
+                                  /* is_before= */ false));
+    DocumentMap results = cache_->GetMatching(query, SnapshotVersion::None());
+    EXPECT_THAT(results.underlying_map(),
+                HasExactlyDocs(std::vector<Document>(docs.begin() + 4,
+                                                     docs.begin() + 7)));
+
+    core::Query descending =
+        Query("b")
+            .AddingOrderBy(testutil::OrderBy(model::FieldPath::KeyFieldPath(),
+                                             core::Direction::Descending))
+            .StartingAt(core::Bound({testutil::Ref("project", "b/3")},
+                                    /* is_before= */ true));
+    results = cache_->GetMatching(descending, SnapshotVersion::None());
+    EXPECT_THAT(results.underlying_map(),
+                HasExactlyDocs(std::vector<Document>(docs.begin(),
+                                                     docs.begin() + 4)));
+  });
+}
+
+TEST_P(RemoteDocumentCacheTest, EnumerateMatchingVisitsDocumentsInKeyOrder) {
+  persistence_->Run("test_enumerate_matching", [&] {
+    SetTestDocument("a/1");
+    SetTestDocument("b/3");
+    SetTestDocument("b/1");
+    SetTestDocument("b/1/z/1");
+    SetTestDocument("b/2");
+    SetTestDocument("c/1");
+    cache_->Add(DeletedDoc("b/0", kVersion), Version(kVersion));
+
+    std::vector<DocumentKey> visited;
+    cache_->EnumerateMatching(Query("b"), [&](const Document& doc) {
+      visited.push_back(doc.key());
+      return true;
+    });
+    std::vector<DocumentKey> expected = {
+        testutil::Key("b/1"), testutil::Key("b/2"), testutil::Key("b/3")};
+    EXPECT_EQ(visited, expected);
+  });
+}
+
+TEST_P(RemoteDocumentCacheTest, EnumerateMatchingStopsWhenVisitorReturnsFalse) {
+  persistence_->Run("test_enumerate_matching_stops", [&] {
+    SetTestDocument("b/1");
+    SetTestDocument("b/2");
+    SetTestDocument("b/3");
+
+    std::vector<DocumentKey> visited;
+    cache_->EnumerateMatching(Query("b"), [&](const Document& doc) {
+      visited.push_back(doc.key());
+      return visited.size() < 2;
+    });
+    std::vector<DocumentKey> expected = {testutil::Key("b/1"),
+                                         testutil::Key("b/2")};
+    EXPECT_EQ(visited, expected);
+  });
+}
+
 TEST_P(RemoteDocumentCacheTest, DocumentsMatchingQuerySinceReadTime) {
   persistence_->Run("test_documents_matching_query_since_read_time", [&] {
     SetTestDocument("b/old", /* updateTime= */ 1, /* readTime= */ 11);
@@ -223,6 +402,29 @@ TEST_P(RemoteDocumentCacheTest, DocumentsMatchingQuerySinceReadTime) {
   });
 }
 
+TEST_P(RemoteDocumentCacheTest, MatchingSinceReadTimeOnlyReadsChanges) {
+  persistence_->Run(
+      "test_documents_matching_query_since_read_time_only_reads_changes", [&] {
+        SetTestDocument("b/unchanged", /* updateTime= */ 1, /* readTime= */ 11);
+        SetTestDocument("b/reread", /* updateTime= */ 1, /* readTime= */ 11);
+        SetTestDocument("b/removed", /* updateTime= */ 1, /* readTime= */ 13);
+        SetTestDocument("b/deleted", /* updateTime= */ 1, /* readTime= */ 11);
+        SetTestDocument("a/other", /* updateTime= */ 3, /* readTime= */ 13);
+        SetTestDocument("b/c/d/sub", /* updateTime= */ 3, /* readTime= */ 13);
+
+        SetTestDocument("b/reread", /* updateTime= */ 2, /* readTime= */ 13);
+        cache_->Remove(testutil::Key("b/removed"));
+        cache_->Add(DeletedDoc("b/deleted", 2), Version(13));
+
+        core::Query query = Query("b");
+        DocumentMap results = cache_->GetMatching(query, Version(12));
+        std::vector<Document> docs = {
+            Doc("b/reread", 2, kDocData),
+        };
+        EXPECT_THAT(results.underlying_map(), HasExactlyDocs(docs));
+      });
+}
+
 TEST_P(RemoteDocumentCacheTest, DocumentsMatchingUsesReadTimeNotUpdateTime) {
   persistence_->Run(
       "test_documents_matching_query_uses_read_time_not_update_time", [&] {
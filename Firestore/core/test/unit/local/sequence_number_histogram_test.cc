@@ -0,0 +1,85 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/sequence_number_histogram.h"
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+
+using model::ListenSequenceNumber;
+
+TEST(SequenceNumberHistogramTest, ExactWithUnitBuckets) {
+  SequenceNumberHistogram histogram(1);
+  for (int i = 10; i > 0; i--) {
+    histogram.Add(i * 10);
+  }
+
+  EXPECT_EQ(histogram.count(), 10);
+  EXPECT_EQ(histogram.EstimateNth(1), 10);
+  EXPECT_EQ(histogram.EstimateNth(5), 50);
+  EXPECT_EQ(histogram.EstimateNth(10), 100);
+}
+
+TEST(SequenceNumberHistogramTest, EstimatesErrLow) {
+  // The sequence numbers 0 to 999, so that n of them are less than or equal
+  // to n - 1.
+  SequenceNumberHistogram histogram(100);
+  for (int i = 0; i < 1000; i++) {
+    histogram.Add(i);
+  }
+
+  for (int n : {1, 99, 100, 101, 500, 999, 1000}) {
+    ListenSequenceNumber estimate = histogram.EstimateNth(n);
+    EXPECT_LE(estimate + 1, n);
+    EXPECT_GT(estimate + 1, n - 100);
+  }
+  EXPECT_EQ(histogram.EstimateNth(1000), 999);
+}
+
+TEST(SequenceNumberHistogramTest, SizesBucketsForRange) {
+  SequenceNumberHistogram histogram = SequenceNumberHistogram::ForRange(99, 10);
+  histogram.Add(0);
+  histogram.Add(9);
+  histogram.Add(10);
+
+  EXPECT_EQ(histogram.EstimateNth(1), -1);
+  EXPECT_EQ(histogram.EstimateNth(2), 9);
+  EXPECT_EQ(histogram.EstimateNth(3), 19);
+}
+
+TEST(SequenceNumberHistogramTest, RoundTrips) {
+  SequenceNumberHistogram histogram(7);
+  histogram.Add(3);
+  histogram.Add(3);
+  histogram.Add(100);
+
+  absl::optional<SequenceNumberHistogram> decoded =
+      SequenceNumberHistogram::Decode(histogram.Encode());
+  ASSERT_TRUE(decoded);
+  EXPECT_EQ(decoded->count(), 3);
+  EXPECT_EQ(decoded->Encode(), histogram.Encode());
+  EXPECT_EQ(decoded->EstimateNth(3), histogram.EstimateNth(3));
+
+  EXPECT_EQ(SequenceNumberHistogram::Decode(""), absl::nullopt);
+  EXPECT_EQ(SequenceNumberHistogram::Decode("garbage"), absl::nullopt);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
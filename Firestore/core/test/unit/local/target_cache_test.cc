@@ -169,6 +169,21 @@ TEST_P(TargetCacheTest, SetQueryToNewValue) {
   });
 }
 
+TEST_P(TargetCacheTest, ReadQueryAfterUpdatingIt) {
+  persistence_->Run("test_read_query_after_updating_it", [&] {
+    TargetData target_data1 = MakeTargetData(query_rooms_, 1, 10, 1);
+    cache_->AddTarget(target_data1);
+    ASSERT_EQ(cache_->GetTarget(query_rooms_.ToTarget()), target_data1);
+
+    TargetData target_data2 = MakeTargetData(query_rooms_, 1, 11, 2);
+    cache_->UpdateTarget(target_data2);
+    ASSERT_EQ(cache_->GetTarget(query_rooms_.ToTarget()), target_data2);
+
+    cache_->RemoveTarget(target_data2);
+    ASSERT_EQ(cache_->GetTarget(query_rooms_.ToTarget()), absl::nullopt);
+  });
+}
+
 TEST_P(TargetCacheTest, EnumerateSequenceNumbers) {
   std::unordered_set<ListenSequenceNumber> sequence_numbers;
   persistence_->Run("test_enumerate_sequence_numbers", [&] {
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/local/transaction_stats.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/memory_persistence.h"
+#include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace local {
+namespace {
+
+using std::chrono::microseconds;
+
+TransactionCounters MakeCounters(int64_t reads, int64_t writes) {
+  TransactionCounters counters;
+  counters.reads = reads;
+  counters.writes = writes;
+  counters.bytes_read = reads * 10;
+  counters.bytes_written = writes * 10;
+  counters.seeks = 1;
+  return counters;
+}
+
+}  // namespace
+
+TEST(TransactionStatsTest, AggregatesByLabel) {
+  TransactionStats stats;
+  stats.Record("b", microseconds(3), MakeCounters(1, 2));
+  stats.Record("a", microseconds(100), MakeCounters(0, 1));
+  stats.Record("b", microseconds(5), MakeCounters(4, 0));
+
+  EXPECT_EQ(stats.labels(), (std::vector<std::string>{"a", "b"}));
+  EXPECT_EQ(stats.Get("c"), nullptr);
+
+  const TransactionStats::LabelStats* b = stats.Get("b");
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(b->count(), 2);
+  EXPECT_EQ(b->duration().total(), microseconds(8));
+
+  TransactionCounters totals = b->totals();
+  EXPECT_EQ(totals.reads, 5);
+  EXPECT_EQ(totals.writes, 2);
+  EXPECT_EQ(totals.bytes_read, 50);
+  EXPECT_EQ(totals.bytes_written, 20);
+  EXPECT_EQ(totals.seeks, 2);
+}
+
+TEST(TransactionStatsTest, SubtractsCounters) {
+  TransactionCounters difference = MakeCounters(5, 3) - MakeCounters(2, 1);
+  EXPECT_EQ(difference.reads, 3);
+  EXPECT_EQ(difference.writes, 2);
+  EXPECT_EQ(difference.bytes_read, 30);
+  EXPECT_EQ(difference.bytes_written, 20);
+  EXPECT_EQ(difference.seeks, 0);
+}
+
+TEST(TransactionStatsTest, LevelDbPersistenceRecordsTransactions) {
+  auto persistence = LevelDbPersistenceForTesting();
+  auto stats = std::make_shared<TransactionStats>();
+  persistence->set_transaction_stats(stats);
+
+  persistence->Run("First", [&] {
+    persistence->current_transaction()->Put("key", "value");
+  });
+  persistence->Run("Second", [&] {
+    std::string value;
+    persistence->current_transaction()->Get("key", &value);
+  });
+
+  const TransactionStats::LabelStats* first = stats->Get("First");
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first->count(), 1);
+  EXPECT_EQ(first->totals().writes, 1);
+  EXPECT_EQ(first->totals().reads, 0);
+
+  // Only the reads of the second transaction count towards it, even if it
+  // continued the first one.
+  const TransactionStats::LabelStats* second = stats->Get("Second");
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(second->totals().reads, 1);
+  EXPECT_EQ(second->totals().writes, 0);
+  EXPECT_EQ(second->totals().bytes_read, 5);
+}
+
+TEST(TransactionStatsTest, MemoryPersistenceRecordsDurations) {
+  auto persistence = MemoryPersistenceWithEagerGcForTesting();
+  persistence->Run("Memory", [] {});
+
+  const TransactionStats::LabelStats* stats =
+      persistence->transaction_stats()->Get("Memory");
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->count(), 1);
+  EXPECT_EQ(stats->totals().writes, 0);
+}
+
+}  // namespace local
+}  // namespace firestore
+}  // namespace firebase
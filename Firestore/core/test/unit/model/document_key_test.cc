@@ -155,6 +155,17 @@ TEST(DocumentKey, Comparison) {
   EXPECT_TRUE(ab >= a);
 }
 
+TEST(DocumentKey, Hash) {
+  DocumentKey key = Key("rooms/abc/messages/1");
+  EXPECT_EQ(key.Hash(), Key("rooms/abc/messages/1").Hash());
+  EXPECT_EQ(key.Hash(), DocumentKeyHash{}(key));
+  EXPECT_NE(key.Hash(), Key("rooms/abc/messages/2").Hash());
+
+  const DocumentKey moved = std::move(key);
+  EXPECT_EQ(key.Hash(), DocumentKey().Hash());  // NOLINT: use after move
+  EXPECT_EQ(key, DocumentKey());                // NOLINT: use after move
+}
+
 TEST(DocumentKey, Comparator) {
   DocumentKey abcd = Key("a/b/c/d");
   DocumentKey xyzw = Key("x/y/z/w");
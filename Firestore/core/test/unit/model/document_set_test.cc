@@ -16,11 +16,14 @@
 
 #include "Firestore/core/src/model/document_set.h"
 
+#include <utility>
 #include <vector>
 
 #include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/util/delayed_constructor.h"
 #include "Firestore/core/test/unit/testutil/testutil.h"
+#include "absl/types/optional.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -80,6 +83,20 @@ TEST_F(DocumentSetTest, KeepsDocumentsInTheRightOrder) {
   ASSERT_THAT(set, ElementsAre(doc3_, doc1_, doc2_));
 }
 
+TEST_F(DocumentSetTest, IndexOfAndAt) {
+  DocumentSet set = DocSet(comp_, {doc1_, doc2_, doc3_});
+
+  EXPECT_EQ(set.IndexOf(doc3_.key()), 0);
+  EXPECT_EQ(set.IndexOf(doc1_.key()), 1);
+  EXPECT_EQ(set.IndexOf(doc2_.key()), 2);
+  EXPECT_EQ(set.IndexOf(DocumentKey::FromPathString("docs/4")),
+            DocumentSet::npos);
+
+  EXPECT_EQ(set.At(0), doc3_);
+  EXPECT_EQ(set.At(1), doc1_);
+  EXPECT_EQ(set.At(2), doc2_);
+}
+
 TEST_F(DocumentSetTest, Deletes) {
   DocumentSet set = DocSet(comp_, {doc1_, doc2_, doc3_});
 
@@ -132,6 +149,37 @@ TEST_F(DocumentSetTest, Equality) {
   EXPECT_NE(set1, sorted_set1);
 }
 
+TEST_F(DocumentSetTest, Diff) {
+  DocumentSet before = DocSet(comp_, {doc1_, doc2_});
+  Document doc2_prime = Doc("docs/2", 0, Map("sort", 9));
+  DocumentSet after =
+      before.erase(doc1_.key()).insert(doc2_prime).insert(doc3_);
+
+  std::vector<std::pair<absl::optional<Document>, absl::optional<Document>>>
+      changes;
+  DocumentSet::Diff(before, after,
+                    [&](const absl::optional<Document>& old_doc,
+                        const absl::optional<Document>& new_doc) {
+                      changes.emplace_back(old_doc, new_doc);
+                    });
+
+  ASSERT_EQ(changes.size(), 3);
+  EXPECT_EQ(changes[0].first, doc1_);
+  EXPECT_EQ(changes[0].second, absl::nullopt);
+  EXPECT_EQ(changes[1].first, doc2_);
+  EXPECT_EQ(changes[1].second, doc2_prime);
+  EXPECT_EQ(changes[2].first, absl::nullopt);
+  EXPECT_EQ(changes[2].second, doc3_);
+
+  changes.clear();
+  DocumentSet::Diff(after, after,
+                    [&](const absl::optional<Document>& old_doc,
+                        const absl::optional<Document>& new_doc) {
+                      changes.emplace_back(old_doc, new_doc);
+                    });
+  EXPECT_TRUE(changes.empty());
+}
+
 }  // namespace
 }  // namespace model
 }  // namespace firestore
@@ -16,6 +16,9 @@
 
 #include "Firestore/core/src/model/document.h"
 
+#include <atomic>
+#include <memory>
+
 #include "Firestore/core/src/model/field_path.h"
 #include "Firestore/core/src/model/field_value.h"
 #include "Firestore/core/src/model/unknown_document.h"
@@ -35,6 +38,34 @@ using testutil::Value;
 using testutil::Version;
 using testutil::WrapObject;
 
+namespace {
+
+/** LazyDocumentData over an already decoded value, counting its decodings. */
+class CountingLazyData : public LazyDocumentData {
+ public:
+  explicit CountingLazyData(ObjectValue data) : data_(std::move(data)) {
+  }
+
+  ObjectValue Decode() const override {
+    ++full_decodes;
+    return data_;
+  }
+
+  absl::optional<FieldValue> DecodeField(
+      const FieldPath& path) const override {
+    ++field_decodes;
+    return data_.Get(path);
+  }
+
+  mutable std::atomic<int> full_decodes{0};
+  mutable std::atomic<int> field_decodes{0};
+
+ private:
+  ObjectValue data_;
+};
+
+}  // namespace
+
 TEST(DocumentTest, Constructor) {
   DocumentKey key = Key("messages/first");
   SnapshotVersion version = Version(1001);
@@ -67,6 +98,25 @@ TEST(DocumentTest, ExtractsFields) {
   EXPECT_EQ(doc.field(Field("owner.title")), Value("scallywag"));
 }
 
+TEST(DocumentTest, DecodesLazily) {
+  ObjectValue data = WrapObject("a", 1, "b", Map("c", "d"));
+  auto lazy_data = std::make_shared<CountingLazyData>(data);
+  Document doc(lazy_data, Key("coll/doc"), Version(1), DocumentState::kSynced);
+
+  EXPECT_EQ(doc.field(Field("b.c")), Value("d"));
+  EXPECT_EQ(doc.field(Field("missing")), absl::nullopt);
+  EXPECT_EQ(lazy_data->field_decodes, 2);
+  EXPECT_EQ(lazy_data->full_decodes, 0);
+
+  EXPECT_EQ(doc.data(), data);
+  EXPECT_EQ(doc, Doc("coll/doc", 1, Map("a", 1, "b", Map("c", "d"))));
+  EXPECT_EQ(lazy_data->full_decodes, 1);
+
+  // Once decoded, fields are read from the decoded data.
+  EXPECT_EQ(doc.field(Field("a")), Value(1));
+  EXPECT_EQ(lazy_data->field_decodes, 2);
+}
+
 TEST(DocumentTest, Equality) {
   Document doc = Doc("some/path", 1, Map("a", 1));
   EXPECT_EQ(doc, Doc("some/path", 1, Map("a", 1)));
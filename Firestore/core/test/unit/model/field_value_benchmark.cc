@@ -17,9 +17,20 @@
 #include "Firestore/core/src/model/field_value.h"
 
 #include <limits>
+#include <string>
 #include <vector>
 
+#include "Firestore/Protos/nanopb/google/firestore/v1/document.nanopb.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/field_path.h"
+#include "Firestore/core/src/model/resource_path.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/remote/serializer.h"
+#include "Firestore/core/src/util/allocation_tracker.h"
+#include "Firestore/core/src/util/read_context.h"
 #include "Firestore/core/src/util/secure_random.h"
+#include "Firestore/core/src/util/string_util.h"
+#include "Firestore/core/test/unit/testutil/allocation_benchmarking.h"
 #include "Firestore/core/test/unit/testutil/testutil.h"
 #include "absl/types/variant.h"
 #include "benchmark/benchmark.h"
@@ -31,7 +42,9 @@ namespace {
 
 using Type = FieldValue::Type;
 
+using testutil::AllocationReporter;
 using testutil::Key;
+using util::ScopedAllocationCounter;
 using util::SecureRandom;
 
 std::string RandomString(SecureRandom* rnd, size_t len) {
@@ -84,6 +97,52 @@ BENCHMARK(BM_FieldValueStringHash)
     ->Arg(1 << 9)
     ->Arg(1 << 10);
 
+void BM_FieldValueStringCompare(benchmark::State& state) {
+  // Strings that share all but their last byte, like the segments of paths
+  // to documents in the same collection.
+  auto len = static_cast<size_t>(state.range(0));
+  std::string prefix(len - 1, 'a');
+  FieldValue lhs = FieldValue::FromString(prefix + "a");
+  FieldValue rhs = FieldValue::FromString(prefix + "b");
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lhs.CompareTo(rhs));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FieldValueStringCompare)
+    ->Arg(1 << 2)
+    ->Arg(1 << 4)
+    ->Arg(1 << 6)
+    ->Arg(1 << 8)
+    ->Arg(1 << 10);
+
+void BM_ResourcePathCompare(benchmark::State& state) {
+  std::string collection(static_cast<size_t>(state.range(0)), 'c');
+  ResourcePath lhs{"rooms", collection, "messages", "message1"};
+  ResourcePath rhs{"rooms", collection, "messages", "message2"};
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lhs.CompareTo(rhs));
+  }
+}
+BENCHMARK(BM_ResourcePathCompare)->Arg(1 << 3)->Arg(1 << 6)->Arg(1 << 9);
+
+void BM_IsValidUtf8(benchmark::State& state) {
+  // Mostly ASCII text with a multi-byte character every eight characters.
+  std::string str;
+  while (str.size() < static_cast<size_t>(state.range(0))) {
+    str += "abcdefg\xC3\xA9";
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(util::IsValidUtf8(str));
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(str.size()));
+}
+BENCHMARK(BM_IsValidUtf8)->Arg(1 << 4)->Arg(1 << 8)->Arg(1 << 12);
+
 void BM_FieldValueIntegerFill(benchmark::State& state) {
   std::vector<FieldValue> values;
   for (auto _ : state) {
@@ -159,6 +218,150 @@ void BM_FieldValueCreation(benchmark::State& state) {
 }
 BENCHMARK(BM_FieldValueCreation);
 
+/**
+ * Creates a map like those in typical documents: mostly flags and numbers,
+ * with a few strings and a nested array of numbers.
+ */
+FieldValue ScalarHeavyMap(int64_t fields) {
+  FieldValue::Map map;
+  FieldValue::Array numbers;
+  for (int64_t i = 0; i < fields; ++i) {
+    std::string key = "field" + std::to_string(i);
+    switch (i % 4) {
+      case 0:
+        map = map.insert(key, FieldValue::FromBoolean(i % 8 == 0));
+        break;
+      case 1:
+        map = map.insert(key, FieldValue::FromInteger(i));
+        break;
+      case 2:
+        map = map.insert(key, FieldValue::FromDouble(i * 0.5));
+        break;
+      default:
+        map = map.insert(key, FieldValue::FromString(key));
+        break;
+    }
+    numbers.push_back(FieldValue::FromInteger(i));
+  }
+  map = map.insert("numbers", FieldValue::FromArray(std::move(numbers)));
+  return FieldValue::FromMap(std::move(map));
+}
+
+void BM_FieldValueScalarArrayAllocations(benchmark::State& state) {
+  const int64_t kValues = state.range(0);
+
+  ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    FieldValue::Array values;
+    values.reserve(static_cast<size_t>(kValues));
+    for (int64_t i = 0; i < kValues; ++i) {
+      values.push_back(i % 2 == 0 ? FieldValue::FromInteger(i)
+                                  : FieldValue::FromDouble(i * 0.5));
+    }
+    FieldValue array = FieldValue::FromArray(std::move(values));
+    benchmark::DoNotOptimize(array);
+  }
+
+  state.counters["allocs_per_value"] =
+      static_cast<double>(allocations.counts().allocations) /
+      static_cast<double>(state.iterations() * kValues);
+}
+BENCHMARK(BM_FieldValueScalarArrayAllocations)->Arg(16)->Arg(256);
+
+void BM_FieldValueDecode(benchmark::State& state) {
+  remote::Serializer serializer(DatabaseId("p", "d"));
+  google_firestore_v1_Value proto =
+      serializer.EncodeFieldValue(ScalarHeavyMap(state.range(0)));
+
+  {
+    AllocationReporter allocations(state);
+    for (auto _ : state) {
+      util::ReadContext context;
+      FieldValue value = serializer.DecodeFieldValue(&context, proto);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  nanopb::FreeNanopbMessage(google_firestore_v1_Value_fields, &proto);
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FieldValueDecode)->Arg(8)->Arg(32)->Arg(128);
+
+void BM_FieldValueDecodeStrings(benchmark::State& state) {
+  remote::Serializer serializer(DatabaseId("p", "d"));
+  serializer.set_validates_utf8(state.range(1) != 0);
+
+  FieldValue::Map map;
+  for (int i = 0; i < 32; ++i) {
+    std::string key = "field" + std::to_string(i);
+    map = map.insert(key, FieldValue::FromString(std::string(
+                              static_cast<size_t>(state.range(0)), 'x')));
+  }
+  google_firestore_v1_Value proto =
+      serializer.EncodeFieldValue(FieldValue::FromMap(std::move(map)));
+
+  for (auto _ : state) {
+    util::ReadContext context;
+    FieldValue value = serializer.DecodeFieldValue(&context, proto);
+    benchmark::DoNotOptimize(value);
+  }
+  nanopb::FreeNanopbMessage(google_firestore_v1_Value_fields, &proto);
+
+  state.SetItemsProcessed(state.iterations());
+}
+// Decodes string values of the given length, without and with UTF-8
+// validation.
+BENCHMARK(BM_FieldValueDecodeStrings)
+    ->Args({16, 0})
+    ->Args({16, 1})
+    ->Args({1024, 0})
+    ->Args({1024, 1});
+
+// Patches the given number of fields, nested one level deep, into a document
+// with 1024 fields, either with one `ObjectValue::Set` per field or with an
+// `ObjectValue::Builder`.
+void BM_ObjectValuePatch(benchmark::State& state) {
+  const int64_t kFields = state.range(0);
+  const bool use_builder = state.range(1) != 0;
+
+  ObjectValue::Builder base_builder{ObjectValue::Empty()};
+  for (int i = 0; i < 1024; ++i) {
+    base_builder.Set(FieldPath{"group" + std::to_string(i % 32),
+                               "field" + std::to_string(i)},
+                     FieldValue::FromInteger(i));
+  }
+  ObjectValue base = base_builder.Build();
+
+  std::vector<FieldPath> paths;
+  for (int64_t i = 0; i < kFields; ++i) {
+    paths.push_back(FieldPath{"group" + std::to_string(i % 32),
+                              "field" + std::to_string(i * 7 % 1024)});
+  }
+
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    ObjectValue result;
+    if (use_builder) {
+      ObjectValue::Builder builder{base};
+      for (const FieldPath& path : paths) {
+        builder.Set(path, FieldValue::FromInteger(-1));
+      }
+      result = builder.Build();
+    } else {
+      result = base;
+      for (const FieldPath& path : paths) {
+        result = result.Set(path, FieldValue::FromInteger(-1));
+      }
+    }
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK(BM_ObjectValuePatch)
+    ->Args({8, 0})
+    ->Args({8, 1})
+    ->Args({256, 0})
+    ->Args({256, 1});
+
 }  // namespace
 }  // namespace model
 }  // namespace firestore
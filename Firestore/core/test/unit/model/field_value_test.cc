@@ -23,6 +23,8 @@
 #include <chrono>  // NOLINT(build/c++11)
 #include <climits>
 #include <cmath>
+#include <random>
+#include <string>
 #include <vector>
 
 #include "Firestore/core/src/model/field_mask.h"
@@ -239,6 +241,71 @@ TEST_F(FieldValueTest, DeletesNestedKeys) {
   EXPECT_EQ(ObjectValue::Empty(), mod);
 }
 
+TEST_F(FieldValueTest, BuilderAppliesSetsAndDeletes) {
+  ObjectValue old = WrapObject("a", Map("b", 1, "c", 2), "d", 3);
+  ObjectValue::Builder builder{old};
+  builder.Set(Field("a.b"), Value("mod"));
+  builder.Delete(Field("a.c"));
+  builder.Set(Field("d.e"), Value(4));
+  builder.Delete(Field("f.g"));
+  builder.Set(Field("h"), Value(5));
+
+  EXPECT_EQ(WrapObject("a", Map("b", "mod"), "d", Map("e", 4), "h", 5),
+            builder.Build());
+  EXPECT_EQ(WrapObject("a", Map("b", 1, "c", 2), "d", 3), old);
+}
+
+TEST_F(FieldValueTest, BuilderAppliesOperationsInOrder) {
+  ObjectValue old = WrapObject("a", 1, "b", Map("c", 2));
+  ObjectValue::Builder builder{old};
+  builder.Delete(Field("a.x"));
+  builder.Delete(Field("b"));
+  builder.Set(Field("b.d"), Value(3));
+  builder.Set(Field("e"), WrapObject("f", 4));
+  builder.Delete(Field("e.f"));
+
+  EXPECT_EQ(WrapObject("a", 1, "b", Map("d", 3), "e", Map()), builder.Build());
+}
+
+TEST_F(FieldValueTest, BuilderMatchesSequentialSetsAndDeletes) {
+  // Random operations on a small set of names, so that they often overlap,
+  // on objects both small and large enough to be stored as trees.
+  std::mt19937 generator(42);
+  auto random_path = [&generator] {
+    std::vector<std::string> segments;
+    size_t depth = 1 + generator() % 3;
+    for (size_t i = 0; i != depth; ++i) {
+      int names = i == 0 ? 60 : 3;
+      segments.push_back(std::to_string(generator() % names));
+    }
+    return FieldPath{segments.begin(), segments.end()};
+  };
+
+  for (int round = 0; round != 200; ++round) {
+    ObjectValue base = ObjectValue::Empty();
+    int base_fields = generator() % 100;
+    for (int i = 0; i != base_fields; ++i) {
+      base = base.Set(random_path(), Value(i));
+    }
+
+    ObjectValue expected = base;
+    ObjectValue::Builder builder{base};
+    int operations = 1 + generator() % 40;
+    for (int i = 0; i != operations; ++i) {
+      FieldPath path = random_path();
+      if (generator() % 3 == 0) {
+        expected = expected.Delete(path);
+        builder.Delete(path);
+      } else {
+        expected = expected.Set(path, Value(1000 + i));
+        builder.Set(path, Value(1000 + i));
+      }
+    }
+
+    ASSERT_EQ(expected, builder.Build()) << "in round " << round;
+  }
+}
+
 #if defined(_WIN32)
 #define timegm _mkgmtime
 
@@ -311,6 +378,18 @@ TEST_F(FieldValueTest, Equality) {
 // Validates that NSNumber/CFNumber normalize NaNs to the same values that
 // Firestore does. This uses CoreFoundation's CFNumber instead of NSNumber just
 // to keep the test in a single file.
+TEST_F(FieldValueTest, HashesContainers) {
+  FieldValue array = Value(Array(1, "a", Map("b", 2.0)));
+  FieldValue map = Value(Map("a", Array(1, 2), "b", "c"));
+
+  // Hashes are memoized, but must still agree between equal values.
+  EXPECT_EQ(array.Hash(), array.Hash());
+  EXPECT_EQ(array.Hash(), Value(Array(1, "a", Map("b", 2.0))).Hash());
+  EXPECT_EQ(map.Hash(), map.Hash());
+  EXPECT_EQ(map.Hash(), Value(Map("a", Array(1, 2), "b", "c")).Hash());
+  EXPECT_NE(array.Hash(), map.Hash());
+}
+
 TEST_F(FieldValueTest, CanonicalBitsAreCanonical) {
   double input = ToDouble(kAlternateNanBits);
   CFNumberRef number = CFNumberCreate(nullptr, kCFNumberDoubleType, &input);
@@ -712,6 +791,25 @@ TEST_F(FieldValueTest, Copy) {
   EXPECT_EQ(FieldValue::Null(), clone);
 }
 
+TEST_F(FieldValueTest, Move) {
+  FieldValue integer_value = FieldValue::FromInteger(1L);
+  FieldValue moved_integer = std::move(integer_value);
+  EXPECT_EQ(FieldValue::FromInteger(1L), moved_integer);
+
+  FieldValue string_value = FieldValue::FromString("abc");
+  FieldValue moved_string = std::move(string_value);
+  EXPECT_EQ(FieldValue::FromString("abc"), moved_string);
+  // Moved-from values are left null, and can be reused.
+  EXPECT_EQ(FieldValue::Null(), string_value);  // NOLINT
+  string_value = FieldValue::FromDouble(1.0);
+  EXPECT_EQ(FieldValue::FromDouble(1.0), string_value);
+
+  moved_integer = std::move(moved_string);
+  EXPECT_EQ(FieldValue::FromString("abc"), moved_integer);
+  moved_integer = std::move(*&moved_integer);
+  EXPECT_EQ(FieldValue::FromString("abc"), moved_integer);
+}
+
 TEST_F(FieldValueTest, CompareMixedType) {
   const FieldValue null_value = FieldValue::Null();
   const FieldValue true_value = FieldValue::True();
@@ -409,6 +409,44 @@ TEST(MutationTest, AppliesLocalArrayRemoveTransformWithNonPrimitiveElements) {
   TransformBaseDoc(base_data, transforms, expected);
 }
 
+namespace {
+
+FieldValue IntegerArray(int begin, int end) {
+  FieldValue::Array values;
+  for (int i = begin; i < end; ++i) {
+    values.push_back(Value(i));
+  }
+  return FieldValue::FromArray(std::move(values));
+}
+
+TransformOperation ArrayTransformOf(TransformOperation::Type type,
+                                    const FieldValue& elements) {
+  return ArrayTransform(type, elements.array_value());
+}
+
+}  // namespace
+
+TEST(MutationTest, AppliesLocalArrayUnionTransformToLargeArrays) {
+  // Large arrays are merged by hashing rather than by scanning.
+  auto base_data = Map("array", IntegerArray(0, 100));
+  TransformPairs transforms = {
+      {"array", ArrayTransformOf(TransformOperation::Type::ArrayUnion,
+                                 IntegerArray(50, 150))}};
+  auto expected = Map("array", IntegerArray(0, 150));
+  TransformBaseDoc(base_data, transforms, expected);
+}
+
+TEST(MutationTest, AppliesLocalArrayRemoveTransformToLargeArrays) {
+  FieldValue::Array base = IntegerArray(0, 100).array_value();
+  base.push_back(Value(75));
+  auto base_data = Map("array", FieldValue::FromArray(std::move(base)));
+  TransformPairs transforms = {
+      {"array", ArrayTransformOf(TransformOperation::Type::ArrayRemove,
+                                 IntegerArray(50, 150))}};
+  auto expected = Map("array", IntegerArray(0, 50));
+  TransformBaseDoc(base_data, transforms, expected);
+}
+
 TEST(MutationTest, AppliesServerAckedIncrementTransformToDocuments) {
   Document base_doc = Doc("collection/key", 0, Map("sum", 1));
 
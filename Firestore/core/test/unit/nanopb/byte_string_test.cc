@@ -148,6 +148,39 @@ TEST(ByteStringTest, Release) {
   std::free(released);
 }
 
+TEST(ByteStringTest, CopiesShareBytes) {
+  ByteString original{"foo"};
+  ByteString copy = original;
+  EXPECT_EQ(copy.get(), original.get());
+  EXPECT_EQ(copy, original);
+
+  // Releasing copies the shared bytes, leaving other copies untouched.
+  pb_bytes_array_t* released = copy.release();
+  EXPECT_NE(released, original.get());
+  EXPECT_EQ(copy.get(), nullptr);
+  EXPECT_THAT(original, BytesEq("foo"));
+
+  std::free(released);
+}
+
+TEST(ByteStringTest, Slice) {
+  ByteString original{"foobar"};
+
+  ByteString slice = original.Slice(1, 4);
+  EXPECT_THAT(slice, BytesEq("ooba"));
+  EXPECT_EQ(slice.data(), original.data() + 1);
+  EXPECT_EQ(slice, ByteString{"ooba"});
+  EXPECT_THAT(slice.Slice(2, 2), BytesEq("ba"));
+
+  EXPECT_TRUE(original.Slice(3, 0).empty());
+  EXPECT_EQ(original.Slice(0, original.size()), original);
+
+  // Slices keep the bytes alive, and can be turned into byte arrays.
+  original = ByteString();
+  pb_bytes_array_t* copy = CopyBytesArray(slice);
+  EXPECT_EQ(ByteString::Take(copy), ByteString{"ooba"});
+}
+
 TEST(ByteStringTest, Comparison) {
   ByteString abc{"abc"};
   ByteString def{"def"};
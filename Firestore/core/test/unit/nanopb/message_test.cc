@@ -57,6 +57,17 @@ class MessageTest : public testing::Test {
     return writer.Release();
   }
 
+  /** Returns the same proto as `GoodProto`, backed by a single slice. */
+  grpc::ByteBuffer GoodProtoInOneSlice() const {
+    TestMessage message;
+    message->stream_id = MakeBytesArray("stream_id");
+    message->stream_token = MakeBytesArray("stream_token");
+
+    ByteString bytes = MakeByteString(message);
+    grpc::Slice slice{bytes.data(), bytes.size()};
+    return grpc::ByteBuffer{&slice, 1};
+  }
+
   grpc::ByteBuffer BadProto() const {
     return {};
   }
@@ -81,6 +92,41 @@ TEST_F(MessageTest, Move) {
 }
 #endif  // !__clang_analyzer__
 
+TEST_F(MessageTest, ParsesSingleAndMultipleSliceBuffers) {
+  grpc::ByteBuffer single = GoodProtoInOneSlice();
+  grpc::ByteBuffer multiple = GoodProto();
+  ASSERT_GT(multiple.Length(), 0u);
+
+  for (const grpc::ByteBuffer* buffer : {&single, &multiple}) {
+    ByteBufferReader reader{*buffer};
+    auto message = TestMessage::TryParse(&reader);
+    ASSERT_OK(reader.status());
+    EXPECT_EQ(MakeString(message->stream_id), "stream_id");
+    EXPECT_EQ(MakeString(message->stream_token), "stream_token");
+  }
+}
+
+TEST_F(MessageTest, EncodesIntoExactlySizedBuffers) {
+  TestMessage message;
+  message->stream_id = MakeBytesArray("stream_id");
+  message->stream_token = MakeBytesArray("stream_token");
+
+  size_t size = EncodedSize(message);
+  EXPECT_GT(size, 0u);
+  EXPECT_EQ(MakeByteString(message).size(), size);
+  EXPECT_EQ(MakeStdString(message).size(), size);
+
+  grpc::ByteBuffer buffer = remote::MakeByteBuffer(message);
+  EXPECT_EQ(buffer.Length(), size);
+  grpc::Slice slice;
+  EXPECT_TRUE(buffer.TrySingleSlice(&slice).ok());
+
+  ByteBufferReader reader{buffer};
+  auto parsed = TestMessage::TryParse(&reader);
+  ASSERT_OK(reader.status());
+  EXPECT_EQ(MakeString(parsed->stream_token), "stream_token");
+}
+
 TEST_F(MessageTest, ParseFailure) {
   ByteBufferReader reader{BadProto()};
   auto message = TestMessage::TryParse(&reader);
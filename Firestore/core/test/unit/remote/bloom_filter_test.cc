@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/bloom_filter.h"
+
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+namespace {
+
+using util::StatusOr;
+
+constexpr const char* kPrefix =
+    "projects/test-project/databases/(default)/documents/";
+
+// A 61-bit filter with 3 hashes containing "coll/a" and "coll/b", as computed
+// by the backend's algorithm.
+BloomFilter GoldenFilter() {
+  StatusOr<BloomFilter> filter =
+      BloomFilter::Create({32, 64, 0, 0, 96, 2, 0, 16}, 3, 3);
+  EXPECT_TRUE(filter.ok());
+  return filter.ValueOrDie();
+}
+
+std::string Name(const char* path) {
+  return std::string(kPrefix) + path;
+}
+
+}  // namespace
+
+TEST(BloomFilterTest, ValidatesParameters) {
+  EXPECT_TRUE(BloomFilter::Create({}, 0, 0).ok());
+  EXPECT_TRUE(BloomFilter::Create({0xff}, 7, 1).ok());
+
+  EXPECT_FALSE(BloomFilter::Create({}, 1, 0).ok());
+  EXPECT_FALSE(BloomFilter::Create({0xff}, -1, 1).ok());
+  EXPECT_FALSE(BloomFilter::Create({0xff}, 8, 1).ok());
+  EXPECT_FALSE(BloomFilter::Create({0xff}, 0, 0).ok());
+  EXPECT_FALSE(BloomFilter::Create({0xff}, 0, -1).ok());
+}
+
+TEST(BloomFilterTest, ComputesBitCount) {
+  EXPECT_EQ(BloomFilter::Create({}, 0, 0).ValueOrDie().bit_count(), 0);
+  EXPECT_EQ(BloomFilter::Create({0, 0}, 5, 1).ValueOrDie().bit_count(), 11);
+}
+
+TEST(BloomFilterTest, EmptyFilterContainsNothing) {
+  BloomFilter filter = BloomFilter::Create({}, 0, 0).ValueOrDie();
+  EXPECT_FALSE(filter.MightContain(""));
+  EXPECT_FALSE(filter.MightContain(Name("coll/a")));
+}
+
+TEST(BloomFilterTest, MightContainMatchesBackend) {
+  BloomFilter filter = GoldenFilter();
+  EXPECT_TRUE(filter.MightContain(Name("coll/a")));
+  EXPECT_TRUE(filter.MightContain(Name("coll/b")));
+  EXPECT_FALSE(filter.MightContain(Name("coll/c")));
+  EXPECT_FALSE(filter.MightContain(Name("coll/d")));
+  EXPECT_FALSE(filter.MightContain(Name("coll/e")));
+}
+
+TEST(BloomFilterTest, Equality) {
+  EXPECT_EQ(GoldenFilter(), GoldenFilter());
+  EXPECT_NE(GoldenFilter(), BloomFilter::Create({}, 0, 0).ValueOrDie());
+  EXPECT_NE(BloomFilter::Create({1}, 0, 1).ValueOrDie(),
+            BloomFilter::Create({1}, 0, 2).ValueOrDie());
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
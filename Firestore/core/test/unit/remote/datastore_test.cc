@@ -176,6 +176,15 @@ TEST_F(DatastoreTest, CanShutdownWithNoOperations) {
   Shutdown();
 }
 
+TEST_F(DatastoreTest, CanStartAndShutdownWithSeveralGrpcQueues) {
+  auto sharded = std::make_shared<Datastore>(
+      database_info, worker_queue, credentials, connectivity_monitor.get(),
+      firebase_metadata_provider.get(), /*grpc_queue_count=*/4);
+  sharded->Start();
+  sharded->Shutdown();
+  EXPECT_EQ(sharded->completion_stats().count(), 0);
+}
+
 TEST_F(DatastoreTest, AllowlistedHeaders) {
   GrpcStream::Metadata headers = {
       {"date", "date value"},
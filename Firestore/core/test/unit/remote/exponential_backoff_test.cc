@@ -17,6 +17,7 @@
 #include "Firestore/core/src/remote/exponential_backoff.h"
 
 #include <chrono>  // NOLINT(build/c++11)
+#include <memory>
 
 #include "Firestore/core/src/util/async_queue.h"
 #include "Firestore/core/src/util/executor.h"
@@ -89,6 +90,47 @@ TEST_F(ExponentialBackoffTest, SequentialCallsToBackoffAndRun) {
   Await(finished);
 }
 
+TEST_F(ExponentialBackoffTest, SharedStateHoldsBackOtherBackoffs) {
+  auto state = std::make_shared<ExponentialBackoff::SharedState>();
+  ExponentialBackoff other{queue, TimerId::WriteStreamConnectionBackoff, 1.5,
+                           chr::seconds{5}, chr::seconds{30}};
+  backoff.set_shared_state(state);
+  other.set_shared_state(state);
+
+  queue->EnqueueBlocking([&] {
+    // The first attempt isn't delayed, so it doesn't hold anyone back.
+    backoff.BackoffAndRun([] {});
+    EXPECT_LE(state->next_attempt_time, chr::steady_clock::now());
+
+    // The retry is delayed by at least half the initial delay.
+    backoff.BackoffAndRun([] {});
+    auto next_attempt_time = state->next_attempt_time;
+    EXPECT_GT(next_attempt_time, chr::steady_clock::now() + chr::seconds{2});
+
+    // An undelayed attempt of the other backoff waits for the same time.
+    other.BackoffAndRun([] {});
+    EXPECT_EQ(state->next_attempt_time, next_attempt_time);
+    EXPECT_TRUE(queue->IsScheduled(TimerId::WriteStreamConnectionBackoff));
+
+    backoff.Cancel();
+    other.Cancel();
+  });
+}
+
+TEST_F(ExponentialBackoffTest, HonorsMinimumNextDelay) {
+  auto state = std::make_shared<ExponentialBackoff::SharedState>();
+  backoff.set_shared_state(state);
+  backoff.set_jitter(ExponentialBackoff::Jitter::Full);
+
+  queue->EnqueueBlocking([&] {
+    backoff.SetMinimumNextDelay(chr::seconds{60});
+    backoff.BackoffAndRun([] {});
+    EXPECT_GT(state->next_attempt_time,
+              chr::steady_clock::now() + chr::seconds{59});
+    backoff.Cancel();
+  });
+}
+
 }  // namespace remote
 }  // namespace firestore
 }  // namespace firebase
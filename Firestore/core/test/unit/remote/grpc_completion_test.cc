@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/grpc_completion.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <memory>
+
+#include "Firestore/core/src/util/async_queue.h"
+#include "Firestore/core/test/unit/testutil/async_testing.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+using std::chrono::nanoseconds;
+
+TEST(GrpcCompletionStatsTest, AggregatesLatencies) {
+  GrpcCompletionStats stats;
+  stats.Record(nanoseconds(100));
+  stats.Record(nanoseconds(300));
+  stats.Record(nanoseconds(200));
+
+  EXPECT_EQ(stats.count(), 3);
+  EXPECT_EQ(stats.total_latency(), nanoseconds(600));
+  EXPECT_EQ(stats.max_latency(), nanoseconds(300));
+}
+
+TEST(GrpcCompletionTest, CompleteRecordsLatency) {
+  std::shared_ptr<util::AsyncQueue> worker_queue =
+      testutil::AsyncQueueForTesting();
+  auto stats = std::make_shared<GrpcCompletionStats>();
+
+  bool called = false;
+  auto completion = GrpcCompletion::Create(
+      GrpcCompletion::Type::Read, worker_queue,
+      [&](bool ok, const std::shared_ptr<GrpcCompletion>&) { called = ok; });
+  completion->Complete(true, stats);
+  worker_queue->EnqueueBlocking([] {});
+
+  EXPECT_TRUE(called);
+  EXPECT_EQ(stats->count(), 1);
+  EXPECT_GE(stats->max_latency(), nanoseconds(0));
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
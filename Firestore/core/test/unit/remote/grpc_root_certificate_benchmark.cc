@@ -0,0 +1,76 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+
+#include "Firestore/core/src/remote/grpc_root_certificate_finder.h"
+#include "Firestore/core/src/util/warnings.h"
+#include "benchmark/benchmark.h"
+
+SUPPRESS_DOCUMENTATION_WARNINGS_BEGIN()
+#include "grpcpp/create_channel.h"
+#include "grpcpp/grpcpp.h"
+SUPPRESS_END()
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+namespace {
+
+// These measure the steps of setting up TLS for the first channel, which is on
+// the startup path of every client. `GrpcConnection` does them once per
+// process.
+
+void BM_LoadGrpcRootCertificate(benchmark::State& state) {
+  for (auto _ : state) {
+    std::string certificate = LoadGrpcRootCertificate();
+    benchmark::DoNotOptimize(certificate);
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          LoadGrpcRootCertificate().size());
+}
+BENCHMARK(BM_LoadGrpcRootCertificate);
+
+void BM_CreateSslCredentials(benchmark::State& state) {
+  std::string certificate = LoadGrpcRootCertificate();
+  for (auto _ : state) {
+    grpc::SslCredentialsOptions options;
+    options.pem_root_certs = certificate;
+    std::shared_ptr<grpc::ChannelCredentials> credentials =
+        grpc::SslCredentials(options);
+    benchmark::DoNotOptimize(credentials);
+  }
+}
+BENCHMARK(BM_CreateSslCredentials);
+
+void BM_CreateSecureChannel(benchmark::State& state) {
+  grpc::SslCredentialsOptions options;
+  options.pem_root_certs = LoadGrpcRootCertificate();
+  std::shared_ptr<grpc::ChannelCredentials> credentials =
+      grpc::SslCredentials(options);
+  for (auto _ : state) {
+    std::shared_ptr<grpc::Channel> channel = grpc::CreateCustomChannel(
+        "firestore.googleapis.com", credentials, grpc::ChannelArguments{});
+    benchmark::DoNotOptimize(channel);
+  }
+}
+BENCHMARK(BM_CreateSecureChannel);
+
+}  // namespace
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
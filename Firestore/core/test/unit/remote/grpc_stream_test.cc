@@ -20,6 +20,7 @@
 #include <initializer_list>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -48,6 +49,14 @@ using Type = GrpcCompletion::Type;
 
 namespace {
 
+class StringMessage : public GrpcDecodedMessage {
+ public:
+  explicit StringMessage(std::string value) : value{std::move(value)} {
+  }
+
+  std::string value;
+};
+
 class Observer : public GrpcStreamObserver {
  public:
   void OnStreamStart() override {
@@ -61,6 +70,12 @@ class Observer : public GrpcStreamObserver {
       observed_states.push_back(StringFormat("OnStreamRead(%s)", str));
     }
   }
+  void OnStreamDecodedRead(
+      std::unique_ptr<GrpcDecodedMessage> message) override {
+    observed_states.push_back(StringFormat(
+        "OnStreamDecodedRead(%s)",
+        static_cast<StringMessage&>(*message).value));
+  }
   void OnStreamFinish(const util::Status& status) override {
     observed_states.push_back(StringFormat(
         "OnStreamFinish(%s)", GetFirestoreErrorName(status.code())));
@@ -202,6 +217,30 @@ TEST_F(GrpcStreamTest, ReadIsAutomaticallyReadded) {
                                        "OnStreamRead(bar)"}));
 }
 
+TEST_F(GrpcStreamTest, ReadsAreDecodedOffTheWorkerQueue) {
+  std::thread::id worker_thread;
+  worker_queue->EnqueueBlocking(
+      [&] { worker_thread = std::this_thread::get_id(); });
+
+  std::vector<std::string> decoded_on_worker_queue;
+  stream->SetMessageDecoder([&](const grpc::ByteBuffer& message) {
+    std::string str = ByteBufferToString(message);
+    if (std::this_thread::get_id() == worker_thread) {
+      decoded_on_worker_queue.push_back(str);
+    }
+    return std::unique_ptr<GrpcDecodedMessage>(
+        absl::make_unique<StringMessage>(str + "!"));
+  });
+  worker_queue->EnqueueBlocking([&] { stream->Start(); });
+
+  ForceFinish({{Type::Read, MakeByteBuffer("foo")}});
+  ForceFinish({{Type::Read, MakeByteBuffer("bar")}});
+  EXPECT_EQ(observed_states(),
+            States({"OnStreamStart", "OnStreamDecodedRead(foo!)",
+                    "OnStreamDecodedRead(bar!)"}));
+  EXPECT_TRUE(decoded_on_worker_queue.empty());
+}
+
 TEST_F(GrpcStreamTest, CanAddSeveralWrites) {
   worker_queue->EnqueueBlocking([&] { stream->Start(); });
 
@@ -237,6 +276,20 @@ TEST_F(GrpcStreamTest, CanAddSeveralWrites) {
   EXPECT_EQ(observed_states().back(), "OnStreamRead");
 }
 
+TEST_F(GrpcStreamTest, CountsMessageBytes) {
+  worker_queue->EnqueueBlocking([&] {
+    stream->Start();
+    stream->Write(MakeByteBuffer("hello"));
+  });
+  ForceFinish({{Type::Write, CompletionResult::Ok},
+               {Type::Read, MakeByteBuffer("foo")}});
+
+  worker_queue->EnqueueBlocking([&] {
+    EXPECT_EQ(stream->bytes_written(), 5u);
+    EXPECT_EQ(stream->bytes_read(), 3u);
+  });
+}
+
 // Observer
 
 TEST_F(GrpcStreamTest, ObserverReceivesOnStart) {
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/network_metrics.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+namespace {
+
+using std::chrono::microseconds;
+
+}  // namespace
+
+TEST(NetworkMetricsTest, HistogramBucketsArePowersOfTwo) {
+  LatencyHistogram histogram;
+  histogram.Record(microseconds(0));
+  histogram.Record(microseconds(1));
+  histogram.Record(microseconds(3));
+  histogram.Record(microseconds(4));
+  histogram.Record(microseconds(-5));
+
+  EXPECT_EQ(histogram.count(), 5);
+  EXPECT_EQ(histogram.total(), microseconds(8));
+  EXPECT_EQ(histogram.bucket_count(0), 2);
+  EXPECT_EQ(histogram.bucket_count(1), 1);
+  EXPECT_EQ(histogram.bucket_count(2), 1);
+  EXPECT_EQ(histogram.bucket_count(3), 1);
+
+  EXPECT_EQ(LatencyHistogram::BucketUpperBound(0), microseconds(1));
+  EXPECT_EQ(LatencyHistogram::BucketUpperBound(3), microseconds(8));
+}
+
+TEST(NetworkMetricsTest, LastHistogramBucketIsOpenEnded) {
+  LatencyHistogram histogram;
+  histogram.Record(microseconds::max() / 2);
+
+  size_t last = LatencyHistogram::kBucketCount - 1;
+  EXPECT_EQ(histogram.bucket_count(last), 1);
+  EXPECT_EQ(LatencyHistogram::BucketUpperBound(last), microseconds::max());
+}
+
+TEST(NetworkMetricsTest, StreamMetricsCountMessagesAndBytes) {
+  StreamMetrics metrics;
+  metrics.RecordMessageSent(10);
+  metrics.RecordMessageSent(5);
+  metrics.RecordMessageReceived(100);
+
+  EXPECT_EQ(metrics.messages_sent(), 2);
+  EXPECT_EQ(metrics.bytes_sent(), 15);
+  EXPECT_EQ(metrics.messages_received(), 1);
+  EXPECT_EQ(metrics.bytes_received(), 100);
+}
+
+TEST(NetworkMetricsTest, TransactionMetricsCountAttemptsAndErrors) {
+  NetworkMetrics metrics;
+  TransactionMetrics& transactions = metrics.transactions();
+  transactions.RecordAttempt();
+  transactions.RecordAborted();
+  transactions.RecordAttempt();
+  transactions.RecordFailedPrecondition();
+  transactions.RecordAttempt();
+  transactions.RecordCommit();
+
+  EXPECT_EQ(transactions.attempts(), 3);
+  EXPECT_EQ(transactions.aborted(), 1);
+  EXPECT_EQ(transactions.failed_preconditions(), 1);
+  EXPECT_EQ(transactions.retryable_errors(), 0);
+  EXPECT_EQ(transactions.commits(), 1);
+  EXPECT_EQ(transactions.failures(), 0);
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
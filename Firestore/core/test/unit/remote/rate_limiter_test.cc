@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/rate_limiter.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::minutes;
+using std::chrono::seconds;
+
+const RateLimiter::Clock::time_point kStart{};
+
+RateLimiter MakeLimiter() {
+  return RateLimiter(500, 1.5, minutes(5), 10000, kStart);
+}
+
+}  // namespace
+
+TEST(RateLimiterTest, StartsFull) {
+  RateLimiter limiter = MakeLimiter();
+  EXPECT_TRUE(limiter.TryMakeRequest(400, kStart));
+  EXPECT_TRUE(limiter.TryMakeRequest(100, kStart));
+  EXPECT_FALSE(limiter.TryMakeRequest(1, kStart));
+}
+
+TEST(RateLimiterTest, RefillsOverTime) {
+  RateLimiter limiter = MakeLimiter();
+  EXPECT_TRUE(limiter.TryMakeRequest(500, kStart));
+
+  // 500 tokens per second.
+  EXPECT_EQ(limiter.GetNextRequestDelay(100, kStart), milliseconds(200));
+  EXPECT_FALSE(limiter.TryMakeRequest(100, kStart + milliseconds(100)));
+  EXPECT_TRUE(limiter.TryMakeRequest(100, kStart + milliseconds(200)));
+  EXPECT_EQ(limiter.GetNextRequestDelay(0, kStart + milliseconds(200)),
+            milliseconds(0));
+
+  // The bucket never holds more than its capacity.
+  EXPECT_TRUE(limiter.TryMakeRequest(500, kStart + seconds(10)));
+  EXPECT_FALSE(limiter.TryMakeRequest(1, kStart + seconds(10)));
+}
+
+TEST(RateLimiterTest, RampsUpCapacity) {
+  RateLimiter limiter = MakeLimiter();
+  EXPECT_EQ(limiter.GetMaximumCapacity(kStart), 500);
+  EXPECT_EQ(limiter.GetMaximumCapacity(kStart + minutes(4)), 500);
+  EXPECT_EQ(limiter.GetMaximumCapacity(kStart + minutes(5)), 750);
+  EXPECT_EQ(limiter.GetMaximumCapacity(kStart + minutes(10)), 1125);
+  EXPECT_EQ(limiter.GetMaximumCapacity(kStart + minutes(120)), 10000);
+
+  EXPECT_TRUE(limiter.TryMakeRequest(750, kStart + minutes(5)));
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/core/field_filter.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/document_key_set.h"
+#include "Firestore/core/src/model/types.h"
+#include "Firestore/core/src/remote/remote_event.h"
+#include "Firestore/core/src/remote/watch_change.h"
+#include "Firestore/core/test/unit/remote/fake_target_metadata_provider.h"
+#include "Firestore/core/test/unit/testutil/allocation_benchmarking.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+namespace {
+
+using local::QueryPurpose;
+using local::TargetData;
+using model::Document;
+using model::DocumentKey;
+using model::DocumentKeySet;
+using model::TargetId;
+using testutil::AllocationReporter;
+
+constexpr int kDocumentCount = 100;
+
+/**
+ * Feeds the aggregator a snapshot in which each of `kDocumentCount` documents
+ * changes in all of range(0) query targets, which have previously seen the
+ * documents, plus a limbo resolution for one more document, as happens when
+ * many listeners share their results.
+ */
+void BM_CreateRemoteEvent(benchmark::State& state) {
+  auto target_count = static_cast<TargetId>(state.range(0));
+
+  std::vector<Document> documents;
+  DocumentKeySet synced_keys;
+  for (int i = 0; i < kDocumentCount; ++i) {
+    documents.push_back(testutil::Doc("coll/doc" + std::to_string(i), 2,
+                                      testutil::Map("index", i)));
+    synced_keys = synced_keys.insert(documents.back().key());
+  }
+
+  FakeTargetMetadataProvider provider;
+  std::vector<TargetId> target_ids;
+  for (TargetId target_id = 1; target_id <= target_count; ++target_id) {
+    core::Query query = testutil::Query("coll").AddingFilter(
+        testutil::Filter("index", ">=", target_id % kDocumentCount));
+    provider.SetSyncedKeys(synced_keys,
+                           TargetData(query.ToTarget(), target_id, 0,
+                                      QueryPurpose::Listen));
+    target_ids.push_back(target_id);
+  }
+
+  TargetId limbo_target_id = target_count + 1;
+  Document limbo_document = testutil::Doc("coll/limbo", 2, testutil::Map());
+  provider.SetSyncedKeys(
+      DocumentKeySet{},
+      TargetData(testutil::Query("coll/limbo").ToTarget(), limbo_target_id, 0,
+                 QueryPurpose::LimboResolution));
+
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    WatchChangeAggregator aggregator{&provider};
+    for (const Document& document : documents) {
+      aggregator.HandleDocumentChange(
+          DocumentWatchChange{target_ids, {}, document.key(), document});
+    }
+    aggregator.HandleDocumentChange(DocumentWatchChange{
+        {limbo_target_id}, {}, limbo_document.key(), limbo_document});
+    aggregator.HandleTargetChange(WatchTargetChange{
+        WatchTargetChangeState::Current, {limbo_target_id}});
+
+    benchmark::DoNotOptimize(
+        aggregator.CreateRemoteEvent(testutil::Version(3)));
+  }
+  state.SetItemsProcessed(state.iterations() * kDocumentCount * target_count);
+}
+BENCHMARK(BM_CreateRemoteEvent)->Arg(10)->Arg(100)->Arg(300);
+
+}  // namespace
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
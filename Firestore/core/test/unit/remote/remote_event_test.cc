@@ -25,6 +25,7 @@
 #include "Firestore/core/src/model/document_key.h"
 #include "Firestore/core/src/model/no_document.h"
 #include "Firestore/core/src/model/types.h"
+#include "Firestore/core/src/remote/bloom_filter.h"
 #include "Firestore/core/src/remote/existence_filter.h"
 #include "Firestore/core/src/remote/watch_change.h"
 #include "Firestore/core/test/unit/remote/fake_target_metadata_provider.h"
@@ -599,6 +600,56 @@ TEST_F(RemoteEventTest, ExistenceFilterMismatchRemovesCurrentChanges) {
   ASSERT_TRUE(event.target_changes().at(1) == target_change1);
 }
 
+TEST_F(RemoteEventTest, BloomFilterRemovesChangedDocuments) {
+  std::unordered_map<TargetId, TargetData> target_map = ActiveQueries({1});
+  DocumentKeySet existing_keys{Key("coll/a"), Key("coll/b"), Key("coll/c")};
+
+  WatchChangeAggregator aggregator = CreateAggregator(
+      target_map, no_outstanding_responses_, existing_keys, {});
+  aggregator.HandleTargetChange(
+      WatchTargetChange{WatchTargetChangeState::Current, {1}, resume_token1_});
+
+  // A bloom filter containing just "coll/a" and "coll/b", which identifies
+  // "coll/c" as the document that no longer matches.
+  BloomFilter bloom_filter =
+      BloomFilter::Create({32, 64, 0, 0, 96, 2, 0, 16}, 3, 3).ValueOrDie();
+  ExistenceFilterWatchChange existence_filter{
+      ExistenceFilter{2, bloom_filter}, 1};
+  aggregator.HandleExistenceFilter(existence_filter);
+
+  RemoteEvent event = aggregator.CreateRemoteEvent(testutil::Version(3));
+
+  ASSERT_EQ(event.target_mismatches().size(), 0);
+  ASSERT_EQ(event.document_updates().size(), 0);
+
+  TargetChange target_change{resume_token1_, true, DocumentKeySet{},
+                             DocumentKeySet{}, DocumentKeySet{Key("coll/c")}};
+  ASSERT_TRUE(event.target_changes().at(1) == target_change);
+}
+
+TEST_F(RemoteEventTest, BloomFilterMismatchResetsTarget) {
+  std::unordered_map<TargetId, TargetData> target_map = ActiveQueries({1});
+  DocumentKeySet existing_keys{Key("coll/a"), Key("coll/b"), Key("coll/c")};
+
+  WatchChangeAggregator aggregator = CreateAggregator(
+      target_map, no_outstanding_responses_, existing_keys, {});
+
+  // The bloom filter only accounts for one removed document, so the target
+  // still needs to be reset.
+  BloomFilter bloom_filter =
+      BloomFilter::Create({32, 64, 0, 0, 96, 2, 0, 16}, 3, 3).ValueOrDie();
+  ExistenceFilterWatchChange existence_filter{
+      ExistenceFilter{1, bloom_filter}, 1};
+  aggregator.HandleExistenceFilter(existence_filter);
+
+  RemoteEvent event = aggregator.CreateRemoteEvent(testutil::Version(3));
+
+  ASSERT_EQ(event.target_mismatches().size(), 1);
+  TargetChange target_change{ByteString(), false, DocumentKeySet{},
+                             DocumentKeySet{}, existing_keys};
+  ASSERT_TRUE(event.target_changes().at(1) == target_change);
+}
+
 TEST_F(RemoteEventTest, DocumentUpdate) {
   std::unordered_map<TargetId, TargetData> target_map = ActiveQueries({1});
 
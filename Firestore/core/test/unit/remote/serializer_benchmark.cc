@@ -0,0 +1,300 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Firestore/Protos/nanopb/firestore/bundle.nanopb.h"
+#include "Firestore/Protos/nanopb/google/firestore/v1/firestore.nanopb.h"
+#include "Firestore/core/src/bundle/bundle_element.h"
+#include "Firestore/core/src/bundle/bundle_serializer.h"
+#include "Firestore/core/src/local/local_serializer.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/document.h"
+#include "Firestore/core/src/model/document_key.h"
+#include "Firestore/core/src/model/field_value.h"
+#include "Firestore/core/src/model/mutation.h"
+#include "Firestore/core/src/model/set_mutation.h"
+#include "Firestore/core/src/model/transform_operation.h"
+#include "Firestore/core/src/nanopb/byte_string.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/nanopb/nanopb_util.h"
+#include "Firestore/core/src/nanopb/reader.h"
+#include "Firestore/core/src/remote/remote_objc_bridge.h"
+#include "Firestore/core/src/remote/serializer.h"
+#include "Firestore/core/src/remote/watch_change.h"
+#include "Firestore/core/test/unit/testutil/allocation_benchmarking.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+namespace {
+
+using bundle::BundleSerializer;
+using bundle::JsonReader;
+using local::LocalSerializer;
+using model::DatabaseId;
+using model::Document;
+using model::DocumentKey;
+using model::FieldValue;
+using model::Mutation;
+using model::ObjectValue;
+using model::ServerTimestampTransform;
+using model::TransformOperation;
+using nanopb::ByteString;
+using nanopb::Message;
+using nanopb::StringReader;
+using testutil::AllocationReporter;
+using testutil::Key;
+
+Serializer MakeSerializer() {
+  return Serializer(DatabaseId("p", "default"));
+}
+
+// The shapes of documents the document benchmarks are run with, selected by
+// range(0).
+constexpr int kWideMap = 0;
+constexpr int kDeepNesting = 1;
+constexpr int kLargeArray = 2;
+constexpr int kBigBlob = 3;
+
+ObjectValue DocumentShape(benchmark::State& state) {
+  FieldValue::Map fields;
+  switch (state.range(0)) {
+    case kWideMap:
+      state.SetLabel("1000 fields");
+      for (int i = 0; i < 1000; ++i) {
+        fields = fields.insert(
+            "field" + std::to_string(i),
+            i % 2 == 0 ? FieldValue::FromInteger(i)
+                       : FieldValue::FromString("value " + std::to_string(i)));
+      }
+      break;
+
+    case kDeepNesting: {
+      state.SetLabel("nested 64 levels deep");
+      FieldValue value = FieldValue::FromString("leaf");
+      for (int depth = 0; depth < 64; ++depth) {
+        value = FieldValue::FromMap(FieldValue::Map().insert("nested", value));
+      }
+      fields = fields.insert("root", value);
+      break;
+    }
+
+    case kLargeArray: {
+      state.SetLabel("10000 element array");
+      FieldValue::Array array;
+      for (int i = 0; i < 10000; ++i) {
+        array.push_back(FieldValue::FromInteger(i));
+      }
+      fields = fields.insert("array", FieldValue::FromArray(std::move(array)));
+      break;
+    }
+
+    case kBigBlob: {
+      state.SetLabel("1 MB blob");
+      std::string blob(1024 * 1024, 'x');
+      fields = fields.insert(
+          "blob", FieldValue::FromBlob(ByteString(blob.data(), blob.size())));
+      break;
+    }
+
+    default:
+      break;
+  }
+  return ObjectValue::FromMap(std::move(fields));
+}
+
+/** Encodes a `ListenResponse` that adds the given document to target 1. */
+std::string EncodeDocumentChange(const Serializer& serializer,
+                                 const DocumentKey& key,
+                                 const ObjectValue& value) {
+  Message<google_firestore_v1_ListenResponse> response;
+  response->which_response_type =
+      google_firestore_v1_ListenResponse_document_change_tag;
+  google_firestore_v1_DocumentChange& change = response->document_change;
+  change.document = serializer.EncodeDocument(key, value);
+  change.document.has_update_time = true;
+  change.document.update_time =
+      Serializer::EncodeVersion(testutil::Version(1));
+  change.target_ids_count = 1;
+  change.target_ids = nanopb::MakeArray<int32_t>(1);
+  change.target_ids[0] = 1;
+  return nanopb::MakeStdString(response);
+}
+
+void BM_EncodeDocument(benchmark::State& state) {
+  Serializer serializer = MakeSerializer();
+  ObjectValue value = DocumentShape(state);
+  DocumentKey key = Key("coll/doc");
+
+  size_t bytes = 0;
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    Message<google_firestore_v1_Document> proto;
+    *proto = serializer.EncodeDocument(key, value);
+    ByteString encoded = nanopb::MakeByteString(proto);
+    bytes = encoded.size();
+    benchmark::DoNotOptimize(encoded);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_EncodeDocument)->DenseRange(kWideMap, kBigBlob);
+
+void BM_DecodeDocumentChange(benchmark::State& state) {
+  Serializer serializer = MakeSerializer();
+  WatchStreamSerializer watch_serializer{serializer};
+  std::string bytes =
+      EncodeDocumentChange(serializer, Key("coll/doc"), DocumentShape(state));
+
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    StringReader reader(bytes);
+    auto response = watch_serializer.ParseResponse(&reader);
+    benchmark::DoNotOptimize(
+        watch_serializer.DecodeWatchChange(&reader, *response));
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_DecodeDocumentChange)->DenseRange(kWideMap, kBigBlob);
+
+/**
+ * Decodes a stream of `ListenResponse`s adding range(0) small documents, as
+ * received when a query with many results is first listened to.
+ */
+void BM_DecodeListenResponses(benchmark::State& state) {
+  Serializer serializer = MakeSerializer();
+  WatchStreamSerializer watch_serializer{serializer};
+
+  std::vector<std::string> responses;
+  size_t total_bytes = 0;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    ObjectValue value = ObjectValue::FromMap(
+        testutil::Map("index", i, "name", "document " + std::to_string(i),
+                      "tags", testutil::Array("a", "b", "c")));
+    responses.push_back(EncodeDocumentChange(
+        serializer, Key("coll/doc" + std::to_string(i)), value));
+    total_bytes += responses.back().size();
+  }
+
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    for (const std::string& bytes : responses) {
+      StringReader reader(bytes);
+      auto response = watch_serializer.ParseResponse(&reader);
+      benchmark::DoNotOptimize(
+          watch_serializer.DecodeWatchChange(&reader, *response));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * total_bytes);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecodeListenResponses)->Arg(100)->Arg(1000);
+
+/**
+ * Encodes a `WriteRequest` with range(0) set mutations, each with a server
+ * timestamp and an increment transform.
+ */
+void BM_EncodeWriteRequest(benchmark::State& state) {
+  WriteStreamSerializer write_serializer{MakeSerializer()};
+
+  std::vector<Mutation> mutations;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    mutations.push_back(testutil::SetMutation(
+        "coll/doc" + std::to_string(i),
+        testutil::Map("index", i, "name", "document " + std::to_string(i)),
+        {{"updated", TransformOperation(ServerTimestampTransform())},
+         testutil::Increment("count", FieldValue::FromInteger(1))}));
+  }
+  ByteString stream_token = testutil::ResumeToken(1);
+
+  size_t bytes = 0;
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    auto request =
+        write_serializer.EncodeWriteMutationsRequest(mutations, stream_token);
+    ByteString encoded = nanopb::MakeByteString(request);
+    bytes = encoded.size();
+    benchmark::DoNotOptimize(encoded);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeWriteRequest)->Arg(1)->Arg(100)->Arg(500);
+
+void BM_LocalEncodeDocument(benchmark::State& state) {
+  LocalSerializer serializer{MakeSerializer()};
+  Document doc(DocumentShape(state), Key("coll/doc"), testutil::Version(1),
+               model::DocumentState::kSynced);
+
+  size_t bytes = 0;
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    std::string encoded = serializer.EncodeMaybeDocumentToString(doc);
+    bytes = encoded.size();
+    benchmark::DoNotOptimize(encoded);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_LocalEncodeDocument)->DenseRange(kWideMap, kBigBlob);
+
+void BM_LocalDecodeDocument(benchmark::State& state) {
+  LocalSerializer serializer{MakeSerializer()};
+  Document doc(DocumentShape(state), Key("coll/doc"), testutil::Version(1),
+               model::DocumentState::kSynced);
+  std::string bytes = serializer.EncodeMaybeDocumentToString(doc);
+
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    StringReader reader(bytes);
+    auto proto = Message<firestore_client_MaybeDocument>::TryParse(&reader);
+    benchmark::DoNotOptimize(serializer.DecodeMaybeDocument(&reader, *proto));
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_LocalDecodeDocument)->DenseRange(kWideMap, kBigBlob);
+
+/** Decodes a document element of a binary bundle. */
+void BM_BundleDecodeBinaryDocument(benchmark::State& state) {
+  Serializer serializer = MakeSerializer();
+  BundleSerializer bundle_serializer{serializer};
+
+  Message<firestore_BundleElement> element;
+  element->which_element_type = firestore_BundleElement_document_tag;
+  element->document =
+      serializer.EncodeDocument(Key("coll/doc"), DocumentShape(state));
+  element->document.has_update_time = true;
+  element->document.update_time =
+      Serializer::EncodeVersion(testutil::Version(1));
+  std::string bytes = nanopb::MakeStdString(element);
+
+  AllocationReporter allocations(state);
+  for (auto _ : state) {
+    JsonReader reader;
+    benchmark::DoNotOptimize(
+        bundle_serializer.DecodeBinaryElement(reader, bytes));
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_BundleDecodeBinaryDocument)->DenseRange(kWideMap, kBigBlob);
+
+}  // namespace
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
@@ -954,6 +954,28 @@ TEST_F(SerializerTest, BadStringValue) {
       Status(Error::kErrorDataLoss, "ignored"), bytes);
 }
 
+TEST_F(SerializerTest, ValidatesUtf8OnlyWhenEnabled) {
+  FieldValue model = FieldValue::FromString("a\xC0\xAF");
+  std::vector<uint8_t> bytes = MakeVector(EncodeFieldValue(model));
+
+  {
+    StringReader reader(bytes);
+    auto message = Message<google_firestore_v1_Value>::TryParse(&reader);
+    EXPECT_EQ(serializer.DecodeFieldValue(reader.context(), *message), model);
+    EXPECT_OK(reader.status());
+  }
+
+  serializer.set_validates_utf8(true);
+  ExpectFailedStatusDuringFieldValueDecode(
+      Status(Error::kErrorDataLoss, "ignored"), bytes);
+
+  // Map keys are validated too.
+  ObjectValue object = testutil::WrapObject("\xED\xA0\x80", "value");
+  bytes = MakeVector(EncodeFieldValue(object.AsFieldValue()));
+  ExpectFailedStatusDuringFieldValueDecode(
+      Status(Error::kErrorDataLoss, "ignored"), bytes);
+}
+
 TEST_F(SerializerTest, BadTimestampValue_TooLarge) {
   auto max_ts = FieldValue::FromTimestamp(TimestampInternal::Max());
   std::vector<uint8_t> bytes = MakeVector(EncodeFieldValue(max_ts));
@@ -1204,6 +1226,19 @@ TEST_F(SerializerTest, EncodesFirstLevelKeyQueries) {
   ExpectRoundTrip(model, proto);
 }
 
+TEST_F(SerializerTest, EncodesMultiDocumentQueries) {
+  TargetData model = CreateTargetData(core::Query::ForDocuments(
+      DatabaseId(kProjectId, kDatabaseId), {Key("docs/2"), Key("docs/1")}));
+
+  v1::Target proto;
+  proto.mutable_documents()->add_documents(ResourceName("docs/2"));
+  proto.mutable_documents()->add_documents(ResourceName("docs/1"));
+  proto.set_target_id(1);
+
+  SCOPED_TRACE("EncodesMultiDocumentQueries");
+  ExpectRoundTrip(model, proto);
+}
+
 TEST_F(SerializerTest, EncodesFirstLevelAncestorQueries) {
   TargetData model = CreateTargetData("messages");
 
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/stream_idle_timeout.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+namespace {
+
+using std::chrono::minutes;
+using std::chrono::seconds;
+
+}  // namespace
+
+TEST(StreamIdleTimeoutTest, FixedTimeoutNeverChanges) {
+  StreamIdleTimeout timeout(seconds(60), /* adaptive= */ false);
+  timeout.RecordIdlePeriod(seconds(90));
+  EXPECT_EQ(timeout.timeout(), seconds(60));
+}
+
+TEST(StreamIdleTimeoutTest, StretchesToCoverRecentIdlePeriods) {
+  StreamIdleTimeout timeout(seconds(60), /* adaptive= */ true);
+  timeout.RecordIdlePeriod(seconds(10));
+  EXPECT_EQ(timeout.timeout(), seconds(60));
+
+  timeout.RecordIdlePeriod(seconds(90));
+  EXPECT_EQ(timeout.timeout(), seconds(135));
+
+  // A shorter idle period doesn't immediately undo the stretch.
+  timeout.RecordIdlePeriod(seconds(10));
+  EXPECT_GT(timeout.timeout(), seconds(90));
+}
+
+TEST(StreamIdleTimeoutTest, IsCappedAndIgnoresLongIdlePeriods) {
+  StreamIdleTimeout timeout(seconds(60), /* adaptive= */ true);
+  timeout.RecordIdlePeriod(minutes(4));
+  EXPECT_EQ(timeout.timeout(), StreamIdleTimeout::kMaxAdaptiveTimeout);
+
+  timeout.RecordIdlePeriod(minutes(60));
+  EXPECT_LT(timeout.timeout(), StreamIdleTimeout::kMaxAdaptiveTimeout);
+}
+
+TEST(StreamIdleTimeoutTest, ShrinksBackOnceTheCadenceStops) {
+  StreamIdleTimeout timeout(seconds(60), /* adaptive= */ true);
+  timeout.RecordIdlePeriod(seconds(90));
+  for (int i = 0; i < 10; ++i) {
+    timeout.RecordIdlePeriod(seconds(1));
+  }
+  EXPECT_EQ(timeout.timeout(), seconds(60));
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
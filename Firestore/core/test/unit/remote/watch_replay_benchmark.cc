@@ -0,0 +1,230 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Firestore/Protos/cpp/google/firestore/v1/firestore.pb.h"
+#include "Firestore/core/src/local/leveldb_persistence.h"
+#include "Firestore/core/src/local/memory_persistence.h"
+#include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/remote/remote_objc_bridge.h"
+#include "Firestore/core/src/remote/serializer.h"
+#include "Firestore/core/src/remote/watch_stream_recorder.h"
+#include "Firestore/core/src/util/filesystem.h"
+#include "Firestore/core/src/util/hard_assert.h"
+#include "Firestore/core/src/util/path.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "Firestore/core/test/unit/local/persistence_testing.h"
+#include "Firestore/core/test/unit/remote/watch_stream_replayer.h"
+#include "Firestore/core/test/unit/testutil/testutil.h"
+#include "absl/memory/memory.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+namespace {
+
+using local::LevelDbPersistenceForTesting;
+using local::MemoryPersistenceWithEagerGcForTesting;
+using local::Persistence;
+using local::QueryPurpose;
+using local::TargetData;
+using model::DatabaseId;
+using model::TargetId;
+using util::Filesystem;
+using util::Path;
+using util::StatusOr;
+
+namespace v1 = google::firestore::v1;
+
+/**
+ * Names a recording made with `WatchStreamRecorder` to replay instead of the
+ * synthesized one.
+ */
+const char kRecordingVariable[] = "FIRESTORE_WATCH_RECORDING";
+
+/** Names the project the recording was made against. */
+const char kProjectVariable[] = "FIRESTORE_WATCH_RECORDING_PROJECT";
+
+constexpr TargetId kTargetId = 2;
+constexpr int kDocumentCount = 1000;
+constexpr int kBurstSize = 100;
+constexpr int kUpdateRounds = 5;
+
+DatabaseId RecordingDatabaseId() {
+  const char* project = std::getenv(kProjectVariable);
+  return DatabaseId(project ? project : "project");
+}
+
+RecordedWatchMessage Response(const v1::ListenResponse& response) {
+  RecordedWatchMessage message;
+  message.type = RecordedWatchMessage::Type::Response;
+  message.bytes = response.SerializeAsString();
+  return message;
+}
+
+RecordedWatchMessage TargetChange(v1::TargetChange_TargetChangeType type,
+                                  std::vector<TargetId> target_ids,
+                                  int64_t read_time_seconds = 0) {
+  v1::ListenResponse response;
+  v1::TargetChange* change = response.mutable_target_change();
+  change->set_target_change_type(type);
+  for (TargetId target_id : target_ids) {
+    change->add_target_ids(target_id);
+  }
+  change->set_resume_token("token" + std::to_string(read_time_seconds));
+  if (read_time_seconds != 0) {
+    change->mutable_read_time()->set_seconds(read_time_seconds);
+  }
+  return Response(response);
+}
+
+/**
+ * Synthesizes the traffic of a listen to a collection of `kDocumentCount`
+ * documents that arrive in bursts of `kBurstSize`, and are then all updated
+ * `kUpdateRounds` times, each burst followed by a consistent snapshot.
+ */
+std::vector<RecordedWatchMessage> SynthesizeRecording(
+    const DatabaseId& database_id) {
+  std::vector<RecordedWatchMessage> messages;
+
+  WatchStreamSerializer serializer{Serializer{database_id}};
+  RecordedWatchMessage request;
+  request.type = RecordedWatchMessage::Type::Request;
+  request.bytes = nanopb::MakeStdString(serializer.EncodeWatchRequest(
+      TargetData(testutil::Query("coll").ToTarget(), kTargetId, 0,
+                 QueryPurpose::Listen)));
+  messages.push_back(request);
+
+  messages.push_back(
+      TargetChange(v1::TargetChange_TargetChangeType_ADD, {kTargetId}));
+
+  std::string prefix = "projects/" + database_id.project_id() +
+                       "/databases/" + database_id.database_id() +
+                       "/documents/coll/doc";
+  int64_t version = 1;
+  for (int round = 0; round <= kUpdateRounds; ++round) {
+    for (int i = 0; i < kDocumentCount; ++i) {
+      v1::ListenResponse response;
+      v1::DocumentChange* change = response.mutable_document_change();
+      change->add_target_ids(kTargetId);
+      v1::Document* document = change->mutable_document();
+      document->set_name(prefix + std::to_string(i));
+      document->mutable_update_time()->set_seconds(version);
+      (*document->mutable_fields())["index"].set_integer_value(i);
+      (*document->mutable_fields())["round"].set_integer_value(round);
+      messages.push_back(Response(response));
+
+      if ((i + 1) % kBurstSize == 0) {
+        if (round == 0 && i + 1 == kDocumentCount) {
+          v1::ListenResponse filter;
+          filter.mutable_filter()->set_target_id(kTargetId);
+          filter.mutable_filter()->set_count(kDocumentCount);
+          messages.push_back(Response(filter));
+          messages.push_back(TargetChange(
+              v1::TargetChange_TargetChangeType_CURRENT, {kTargetId}));
+        }
+        messages.push_back(TargetChange(
+            v1::TargetChange_TargetChangeType_NO_CHANGE, {}, version++));
+      }
+    }
+  }
+  return messages;
+}
+
+std::vector<RecordedWatchMessage> LoadRecording(const DatabaseId& database_id) {
+  const char* path = std::getenv(kRecordingVariable);
+  if (!path) {
+    return SynthesizeRecording(database_id);
+  }
+
+  StatusOr<std::string> data =
+      Filesystem::Default()->ReadFile(Path::FromUtf8(path));
+  HARD_ASSERT(data.ok(), "Couldn't read %s: %s", path,
+              data.status().ToString());
+  StatusOr<std::vector<RecordedWatchMessage>> messages =
+      WatchStreamRecorder::Decode(data.ValueOrDie());
+  HARD_ASSERT(messages.ok(), "Couldn't decode %s: %s", path,
+              messages.status().ToString());
+  return messages.ValueOrDie();
+}
+
+/** The persistence the replay runs against, selected by range(0). */
+std::unique_ptr<Persistence> PersistenceVariant(benchmark::State& state) {
+  if (state.range(0) == 0) {
+    state.SetLabel("memory");
+    return MemoryPersistenceWithEagerGcForTesting();
+  }
+  state.SetLabel("leveldb");
+  return LevelDbPersistenceForTesting();
+}
+
+/**
+ * Replays a watch stream recording into a fresh client, reporting the
+ * responses processed per second and the percentiles of the time taken to
+ * raise snapshots.
+ */
+void BM_ReplayWatchStream(benchmark::State& state) {
+  DatabaseId database_id = RecordingDatabaseId();
+  std::vector<RecordedWatchMessage> messages = LoadRecording(database_id);
+
+  size_t responses = 0;
+  std::vector<std::chrono::microseconds> latencies;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto replayer = absl::make_unique<WatchStreamReplayer>(
+        PersistenceVariant(state), database_id);
+    state.ResumeTiming();
+
+    WatchReplayStats stats = replayer->Replay(messages);
+    responses += stats.responses;
+    latencies.insert(latencies.end(), stats.snapshot_latencies.begin(),
+                     stats.snapshot_latencies.end());
+
+    state.PauseTiming();
+    replayer.reset();
+    state.ResumeTiming();
+  }
+
+  WatchReplayStats total;
+  std::sort(latencies.begin(), latencies.end());
+  total.snapshot_latencies = std::move(latencies);
+  state.SetItemsProcessed(static_cast<int64_t>(responses));
+  state.counters["p50_snapshot_us"] = static_cast<double>(
+      total.SnapshotLatencyPercentile(0.5).count());
+  state.counters["p90_snapshot_us"] = static_cast<double>(
+      total.SnapshotLatencyPercentile(0.9).count());
+  state.counters["p99_snapshot_us"] = static_cast<double>(
+      total.SnapshotLatencyPercentile(0.99).count());
+}
+BENCHMARK(BM_ReplayWatchStream)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
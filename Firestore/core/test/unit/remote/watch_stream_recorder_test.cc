@@ -0,0 +1,95 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/watch_stream_recorder.h"
+
+#include <string>
+#include <vector>
+
+#include "Firestore/core/src/util/status.h"
+#include "Firestore/core/src/util/statusor.h"
+#include "Firestore/core/test/unit/testutil/status_testing.h"
+#include "grpcpp/support/slice.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+namespace {
+
+using Type = RecordedWatchMessage::Type;
+using util::Status;
+using util::StatusOr;
+
+grpc::ByteBuffer MakeMessage(const std::string& bytes) {
+  grpc::Slice slice{bytes};
+  return grpc::ByteBuffer{&slice, 1};
+}
+
+}  // namespace
+
+TEST(WatchStreamRecorderTest, RecordsMessagesInOrder) {
+  WatchStreamRecorder recorder;
+  recorder.RecordRequest(MakeMessage("listen"));
+  recorder.RecordResponse(MakeMessage("change"));
+  recorder.RecordClose(Status(Error::kErrorUnavailable, "offline"));
+
+  std::vector<RecordedWatchMessage> messages = recorder.messages();
+  ASSERT_EQ(messages.size(), 3u);
+  EXPECT_EQ(messages[0].type, Type::Request);
+  EXPECT_EQ(messages[0].bytes, "listen");
+  EXPECT_EQ(messages[1].type, Type::Response);
+  EXPECT_EQ(messages[1].bytes, "change");
+  EXPECT_EQ(messages[2].type, Type::Close);
+  EXPECT_EQ(messages[2].bytes, "");
+  EXPECT_EQ(messages[2].close_code, Error::kErrorUnavailable);
+
+  EXPECT_LE(messages[0].offset, messages[1].offset);
+  EXPECT_LE(messages[1].offset, messages[2].offset);
+}
+
+TEST(WatchStreamRecorderTest, DecodesEncodedRecordings) {
+  WatchStreamRecorder recorder;
+  recorder.RecordRequest(MakeMessage("listen"));
+  recorder.RecordResponse(MakeMessage(std::string(1000, 'x')));
+  recorder.RecordResponse(MakeMessage(""));
+  recorder.RecordClose(Status::OK());
+
+  StatusOr<std::vector<RecordedWatchMessage>> decoded =
+      WatchStreamRecorder::Decode(recorder.Encode());
+  ASSERT_OK(decoded.status());
+  EXPECT_EQ(decoded.ValueOrDie(), recorder.messages());
+}
+
+TEST(WatchStreamRecorderTest, RejectsCorruptRecordings) {
+  WatchStreamRecorder recorder;
+  recorder.RecordResponse(MakeMessage("change"));
+  std::string encoded = recorder.Encode();
+
+  EXPECT_EQ(WatchStreamRecorder::Decode("").status().code(),
+            Error::kErrorDataLoss);
+  EXPECT_EQ(WatchStreamRecorder::Decode("not a recording").status().code(),
+            Error::kErrorDataLoss);
+  EXPECT_EQ(WatchStreamRecorder::Decode(encoded.substr(0, encoded.size() - 1))
+                .status()
+                .code(),
+            Error::kErrorDataLoss);
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
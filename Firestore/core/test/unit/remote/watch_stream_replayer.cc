@@ -0,0 +1,458 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/test/unit/remote/watch_stream_replayer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "Firestore/core/src/auth/empty_credentials_provider.h"
+#include "Firestore/core/src/auth/user.h"
+#include "Firestore/core/src/core/sync_engine.h"
+#include "Firestore/core/src/core/target.h"
+#include "Firestore/core/src/core/view_snapshot.h"
+#include "Firestore/core/src/local/local_store.h"
+#include "Firestore/core/src/local/persistence.h"
+#include "Firestore/core/src/local/query_engine.h"
+#include "Firestore/core/src/local/target_data.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/snapshot_version.h"
+#include "Firestore/core/src/nanopb/message.h"
+#include "Firestore/core/src/nanopb/reader.h"
+#include "Firestore/core/src/remote/connectivity_monitor.h"
+#include "Firestore/core/src/remote/datastore.h"
+#include "Firestore/core/src/remote/firebase_metadata_provider.h"
+#include "Firestore/core/src/remote/firebase_metadata_provider_noop.h"
+#include "Firestore/core/src/remote/remote_store.h"
+#include "Firestore/core/src/remote/serializer.h"
+#include "Firestore/core/src/remote/watch_change.h"
+#include "Firestore/core/src/remote/watch_stream.h"
+#include "Firestore/core/src/util/async_queue.h"
+#include "Firestore/core/src/util/executor.h"
+#include "Firestore/core/src/util/status.h"
+#include "Firestore/core/test/unit/remote/create_noop_connectivity_monitor.h"
+#include "absl/memory/memory.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+using auth::EmptyCredentialsProvider;
+using auth::User;
+using core::Query;
+using core::Target;
+using core::ViewSnapshot;
+using local::LocalStore;
+using local::Persistence;
+using local::QueryEngine;
+using local::TargetData;
+using model::DatabaseId;
+using model::OnlineState;
+using model::SnapshotVersion;
+using model::TargetId;
+using nanopb::Message;
+using nanopb::StringReader;
+using util::AsyncQueue;
+using util::Executor;
+using util::Status;
+
+/**
+ * A watch stream that opens as soon as it's started and, instead of talking
+ * to the backend, has responses delivered to it by the replayer.
+ */
+class ReplayWatchStream : public WatchStream {
+ public:
+  ReplayWatchStream(const std::shared_ptr<AsyncQueue>& worker_queue,
+                    Serializer serializer,
+                    GrpcConnection* grpc_connection,
+                    WatchStreamCallback* callback)
+      : WatchStream{worker_queue, std::make_shared<EmptyCredentialsProvider>(),
+                    std::move(serializer), grpc_connection, callback},
+        callback_{callback} {
+  }
+
+  /** The targets the client is listening to, by target ID. */
+  const std::unordered_map<TargetId, TargetData>& active_targets() const {
+    return active_targets_;
+  }
+
+  void Start() override {
+    open_ = true;
+    callback_->OnWatchStreamOpen();
+  }
+
+  void Stop() override {
+    WatchStream::Stop();
+    open_ = false;
+    active_targets_.clear();
+  }
+
+  bool IsStarted() const override {
+    return open_;
+  }
+  bool IsOpen() const override {
+    return open_;
+  }
+
+  void WatchQuery(const TargetData& query) override {
+    active_targets_[query.target_id()] = query;
+  }
+
+  void UnwatchTargetId(TargetId target_id) override {
+    active_targets_.erase(target_id);
+  }
+
+  void Deliver(const WatchChange& change, const SnapshotVersion& version) {
+    callback_->OnWatchStreamChange(change, version);
+  }
+
+  void Fail(const Status& error) {
+    open_ = false;
+    active_targets_.clear();
+    callback_->OnWatchStreamClose(error);
+  }
+
+ private:
+  WatchStreamCallback* callback_ = nullptr;
+  bool open_ = false;
+  std::unordered_map<TargetId, TargetData> active_targets_;
+};
+
+/** A datastore whose watch stream is replayed rather than connected. */
+class ReplayDatastore : public Datastore {
+ public:
+  ReplayDatastore(const core::DatabaseInfo& database_info,
+                  const std::shared_ptr<AsyncQueue>& worker_queue,
+                  ConnectivityMonitor* connectivity_monitor,
+                  FirebaseMetadataProvider* firebase_metadata_provider)
+      : Datastore{database_info, worker_queue,
+                  std::make_shared<EmptyCredentialsProvider>(),
+                  connectivity_monitor, firebase_metadata_provider},
+        database_info_{&database_info},
+        worker_queue_{worker_queue} {
+  }
+
+  std::shared_ptr<WatchStream> CreateWatchStream(
+      WatchStreamCallback* callback) override {
+    watch_stream_ = std::make_shared<ReplayWatchStream>(
+        worker_queue_, Serializer{database_info_->database_id()},
+        grpc_connection(), callback);
+    return watch_stream_;
+  }
+
+  ReplayWatchStream* watch_stream() {
+    return watch_stream_.get();
+  }
+
+ private:
+  const core::DatabaseInfo* database_info_ = nullptr;
+  std::shared_ptr<AsyncQueue> worker_queue_;
+  std::shared_ptr<ReplayWatchStream> watch_stream_;
+};
+
+namespace {
+
+const size_t kMaxConcurrentLimboResolutions = 100;
+
+/**
+ * Replaces the recorded target IDs in `target_ids` with the ones used in the
+ * replay, dropping those that have no replacement. Returns false if all of
+ * them were dropped.
+ */
+bool RemapTargetIds(const std::unordered_map<TargetId, TargetId>& mapping,
+                    int32_t* target_ids,
+                    pb_size_t* count) {
+  if (*count == 0) return true;
+
+  pb_size_t remapped = 0;
+  for (pb_size_t i = 0; i < *count; ++i) {
+    auto found = mapping.find(target_ids[i]);
+    if (found != mapping.end()) {
+      target_ids[remapped++] = found->second;
+    }
+  }
+  *count = remapped;
+  return remapped != 0;
+}
+
+/**
+ * Replaces the recorded target IDs in `response` with the ones used in the
+ * replay. Returns false if none of the targets the response is about are in
+ * the replay, in which case it should be skipped.
+ */
+bool RemapTargetIds(const std::unordered_map<TargetId, TargetId>& mapping,
+                    google_firestore_v1_ListenResponse* response) {
+  switch (response->which_response_type) {
+    case google_firestore_v1_ListenResponse_target_change_tag: {
+      auto& change = response->target_change;
+      return RemapTargetIds(mapping, change.target_ids,
+                            &change.target_ids_count);
+    }
+
+    case google_firestore_v1_ListenResponse_document_change_tag: {
+      auto& change = response->document_change;
+      RemapTargetIds(mapping, change.target_ids, &change.target_ids_count);
+      RemapTargetIds(mapping, change.removed_target_ids,
+                     &change.removed_target_ids_count);
+      return change.target_ids_count != 0 ||
+             change.removed_target_ids_count != 0;
+    }
+
+    case google_firestore_v1_ListenResponse_document_delete_tag: {
+      auto& change = response->document_delete;
+      return RemapTargetIds(mapping, change.removed_target_ids,
+                            &change.removed_target_ids_count);
+    }
+
+    case google_firestore_v1_ListenResponse_document_remove_tag: {
+      auto& change = response->document_remove;
+      return RemapTargetIds(mapping, change.removed_target_ids,
+                            &change.removed_target_ids_count);
+    }
+
+    case google_firestore_v1_ListenResponse_filter_tag: {
+      auto found = mapping.find(response->filter.target_id);
+      if (found == mapping.end()) return false;
+      response->filter.target_id = found->second;
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+/** Makes a query that listens to the same target as `target`. */
+Query ToQuery(const Target& target) {
+  return Query(target.path(), target.collection_group(), target.filters(),
+               target.order_bys(), target.limit(), core::LimitType::First,
+               target.start_at(), target.end_at());
+}
+
+}  // namespace
+
+std::chrono::microseconds WatchReplayStats::SnapshotLatencyPercentile(
+    double fraction) const {
+  if (snapshot_latencies.empty()) {
+    return std::chrono::microseconds(0);
+  }
+
+  auto rank = static_cast<size_t>(
+      std::ceil(fraction * static_cast<double>(snapshot_latencies.size())));
+  size_t index = std::min(std::max<size_t>(rank, 1),
+                          snapshot_latencies.size()) -
+                 1;
+  return snapshot_latencies[index];
+}
+
+WatchStreamReplayer::WatchStreamReplayer(
+    std::unique_ptr<Persistence> persistence, DatabaseId database_id)
+    : worker_queue_{AsyncQueue::Create(Executor::CreateSerial("replay"))},
+      database_info_{std::move(database_id), "persistence", "host",
+                     /*ssl_enabled=*/true},
+      persistence_{std::move(persistence)},
+      query_engine_{absl::make_unique<QueryEngine>()},
+      local_store_{absl::make_unique<LocalStore>(
+          persistence_.get(), query_engine_.get(), User::Unauthenticated())},
+      connectivity_monitor_{CreateNoOpConnectivityMonitor()},
+      firebase_metadata_provider_{CreateFirebaseMetadataProviderNoOp()} {
+  datastore_ = std::make_shared<ReplayDatastore>(
+      database_info_, worker_queue_, connectivity_monitor_.get(),
+      firebase_metadata_provider_.get());
+  remote_store_ = absl::make_unique<RemoteStore>(
+      local_store_.get(), datastore_, worker_queue_,
+      connectivity_monitor_.get(), [this](OnlineState online_state) {
+        sync_engine_->HandleOnlineStateChange(online_state);
+      });
+  sync_engine_ = absl::make_unique<core::SyncEngine>(
+      local_store_.get(), remote_store_.get(), User::Unauthenticated(),
+      kMaxConcurrentLimboResolutions);
+  remote_store_->set_sync_engine(sync_engine_.get());
+  sync_engine_->SetCallback(this);
+
+  worker_queue_->EnqueueBlocking([&] {
+    local_store_->Start();
+    remote_store_->Start();
+  });
+}
+
+WatchStreamReplayer::~WatchStreamReplayer() {
+  worker_queue_->EnqueueBlocking([&] {
+    remote_store_->Shutdown();
+    persistence_->Shutdown();
+  });
+}
+
+WatchReplayStats WatchStreamReplayer::Replay(
+    const std::vector<RecordedWatchMessage>& messages) {
+  WatchReplayStats stats;
+  size_t initial_snapshots = snapshots_;
+
+  for (const RecordedWatchMessage& message : messages) {
+    switch (message.type) {
+      case RecordedWatchMessage::Type::Request:
+        worker_queue_->EnqueueBlocking([&] { ReplayRequest(message); });
+        break;
+
+      case RecordedWatchMessage::Type::Response:
+        ReplayResponse(message, &stats);
+        break;
+
+      case RecordedWatchMessage::Type::Close:
+        worker_queue_->EnqueueBlocking([&] {
+          FinishPendingRemoval();
+
+          // The client closes the stream on its own when it stops needing it,
+          // so only errors are replayed.
+          ReplayWatchStream* stream = datastore_->watch_stream();
+          if (message.close_code != Error::kErrorOk && stream &&
+              stream->IsOpen()) {
+            stream->Fail(Status(message.close_code, "Replayed stream error"));
+          }
+        });
+        break;
+    }
+  }
+  worker_queue_->EnqueueBlocking([&] { FinishPendingRemoval(); });
+
+  std::sort(stats.snapshot_latencies.begin(), stats.snapshot_latencies.end());
+  stats.snapshots = snapshots_ - initial_snapshots;
+  return stats;
+}
+
+void WatchStreamReplayer::ReplayRequest(const RecordedWatchMessage& message) {
+  StringReader reader{message.bytes};
+  auto request =
+      Message<google_firestore_v1_ListenRequest>::TryParse(&reader);
+  if (!reader.ok()) return;
+
+  if (request->which_target_change ==
+      google_firestore_v1_ListenRequest_remove_target_tag) {
+    FinishPendingRemoval();
+    pending_removal_ = request->remove_target;
+    return;
+  }
+
+  const google_firestore_v1_Target& proto = request->add_target;
+  TargetId recorded_id = proto.target_id;
+  if (pending_removal_ == recorded_id) {
+    // The target was reset, which the replay does by itself.
+    pending_removal_.reset();
+  }
+  FinishPendingRemoval();
+
+  // The target is being listened to again after the stream restarted.
+  if (target_ids_.find(recorded_id) != target_ids_.end()) return;
+
+  Serializer serializer{database_info_.database_id()};
+  Target target;
+  if (proto.which_target_type == google_firestore_v1_Target_query_tag) {
+    target = serializer.DecodeQueryTarget(reader.context(),
+                                          proto.target_type.query);
+  } else {
+    target = serializer.DecodeDocumentsTarget(reader.context(),
+                                              proto.target_type.documents);
+  }
+  if (!reader.ok()) return;
+
+  // Targets the client made on its own, such as limbo resolutions, have
+  // already been made in the replay.
+  for (const auto& entry : datastore_->watch_stream()->active_targets()) {
+    bool mapped = std::any_of(
+        target_ids_.begin(), target_ids_.end(),
+        [&](const std::pair<const TargetId, TargetId>& mapping) {
+          return mapping.second == entry.first;
+        });
+    if (!mapped && entry.second.target() == target) {
+      target_ids_[recorded_id] = entry.first;
+      return;
+    }
+  }
+
+  Query query = ToQuery(target);
+  target_ids_[recorded_id] = sync_engine_->Listen(query);
+  queries_.emplace(recorded_id, std::move(query));
+}
+
+void WatchStreamReplayer::ReplayResponse(const RecordedWatchMessage& message,
+                                         WatchReplayStats* stats) {
+  auto start = std::chrono::steady_clock::now();
+  size_t snapshots = snapshots_;
+  bool delivered = false;
+
+  worker_queue_->EnqueueBlocking([&] {
+    FinishPendingRemoval();
+
+    ReplayWatchStream* stream = datastore_->watch_stream();
+    if (!stream || !stream->IsOpen()) return;
+
+    StringReader reader{message.bytes};
+    auto response =
+        Message<google_firestore_v1_ListenResponse>::TryParse(&reader);
+    if (!reader.ok() || !RemapTargetIds(target_ids_, response.get())) return;
+
+    Serializer serializer{database_info_.database_id()};
+    std::unique_ptr<WatchChange> change =
+        serializer.DecodeWatchChange(reader.context(), *response);
+    SnapshotVersion version =
+        serializer.DecodeVersionFromListenResponse(reader.context(), *response);
+    if (!reader.ok()) return;
+
+    stream->Deliver(*change, version);
+    delivered = true;
+  });
+
+  if (!delivered) return;
+
+  ++stats->responses;
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  stats->total_time += elapsed;
+  if (snapshots_ != snapshots) {
+    stats->snapshot_latencies.push_back(elapsed);
+  }
+}
+
+void WatchStreamReplayer::FinishPendingRemoval() {
+  if (!pending_removal_) return;
+
+  TargetId recorded_id = *pending_removal_;
+  pending_removal_.reset();
+
+  // Limbo resolutions end by themselves once the replay resolves them.
+  auto query = queries_.find(recorded_id);
+  if (query != queries_.end()) {
+    sync_engine_->StopListening(query->second);
+    queries_.erase(query);
+  }
+  target_ids_.erase(recorded_id);
+}
+
+void WatchStreamReplayer::OnViewSnapshots(
+    std::vector<ViewSnapshot>&& snapshots) {
+  snapshots_ += snapshots.size();
+}
+
+void WatchStreamReplayer::OnError(const Query&, const Status&) {
+}
+
+void WatchStreamReplayer::HandleOnlineStateChange(OnlineState) {
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
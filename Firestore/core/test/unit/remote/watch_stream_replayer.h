@@ -0,0 +1,154 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_TEST_UNIT_REMOTE_WATCH_STREAM_REPLAYER_H_
+#define FIRESTORE_CORE_TEST_UNIT_REMOTE_WATCH_STREAM_REPLAYER_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Firestore/core/src/core/database_info.h"
+#include "Firestore/core/src/core/query.h"
+#include "Firestore/core/src/core/sync_engine_callback.h"
+#include "Firestore/core/src/model/database_id.h"
+#include "Firestore/core/src/model/types.h"
+#include "Firestore/core/src/remote/watch_stream_recorder.h"
+#include "absl/types/optional.h"
+
+namespace firebase {
+namespace firestore {
+
+namespace core {
+class SyncEngine;
+}  // namespace core
+
+namespace local {
+class LocalStore;
+class Persistence;
+class QueryEngine;
+}  // namespace local
+
+namespace util {
+class AsyncQueue;
+}  // namespace util
+
+namespace remote {
+
+class ConnectivityMonitor;
+class FirebaseMetadataProvider;
+class RemoteStore;
+class ReplayDatastore;
+
+/** What happened while a recording was replayed. */
+struct WatchReplayStats {
+  /** The number of responses delivered to the `RemoteStore`. */
+  size_t responses = 0;
+
+  /** The number of view snapshots the `SyncEngine` raised. */
+  size_t snapshots = 0;
+
+  /** How long delivering all the responses took. */
+  std::chrono::microseconds total_time{0};
+
+  /**
+   * How long it took to raise snapshots from each response that caused some,
+   * in ascending order.
+   */
+  std::vector<std::chrono::microseconds> snapshot_latencies;
+
+  /**
+   * Returns the latency that the given fraction of the snapshot latencies
+   * don't exceed, or zero if no snapshots were raised.
+   */
+  std::chrono::microseconds SnapshotLatencyPercentile(double fraction) const;
+};
+
+/**
+ * Replays a watch stream recording made with `WatchStreamRecorder` against a
+ * real `SyncEngine`, `RemoteStore` and `LocalStore`, in place of the backend,
+ * so that the cost of processing real traffic can be measured without a
+ * network.
+ *
+ * Responses are replayed as fast as they can be processed rather than at the
+ * pace they were recorded. The listens in the recording are made again, and
+ * since the target IDs the client picks for them may differ from the recorded
+ * ones, every target ID in the responses is mapped to the target that was
+ * made in its place. Targets the client makes on its own, such as limbo
+ * resolutions, are matched to the recorded ones by their `Target`.
+ */
+class WatchStreamReplayer : public core::SyncEngineCallback {
+ public:
+  /**
+   * Replays into the given persistence, which must already be started, the
+   * traffic of a stream that was connected to the given database.
+   */
+  WatchStreamReplayer(std::unique_ptr<local::Persistence> persistence,
+                      model::DatabaseId database_id);
+
+  ~WatchStreamReplayer() override;
+
+  /** Replays `messages` in order and returns what happened. */
+  WatchReplayStats Replay(const std::vector<RecordedWatchMessage>& messages);
+
+  // SyncEngineCallback
+  void OnViewSnapshots(std::vector<core::ViewSnapshot>&& snapshots) override;
+  void OnError(const core::Query& query, const util::Status& error) override;
+  void HandleOnlineStateChange(model::OnlineState online_state) override;
+
+ private:
+  void ReplayRequest(const RecordedWatchMessage& message);
+  void ReplayResponse(const RecordedWatchMessage& message,
+                      WatchReplayStats* stats);
+
+  /**
+   * Stops listening to the query whose target removal was recorded last. The
+   * removal is held back until the next message, since the client also
+   * removes a target and adds it right back to reset it after an existence
+   * filter mismatch, which the replay does on its own.
+   */
+  void FinishPendingRemoval();
+
+  std::shared_ptr<util::AsyncQueue> worker_queue_;
+  core::DatabaseInfo database_info_;
+  std::unique_ptr<local::Persistence> persistence_;
+  std::unique_ptr<local::QueryEngine> query_engine_;
+  std::unique_ptr<local::LocalStore> local_store_;
+  std::unique_ptr<ConnectivityMonitor> connectivity_monitor_;
+  std::unique_ptr<FirebaseMetadataProvider> firebase_metadata_provider_;
+  std::shared_ptr<ReplayDatastore> datastore_;
+  std::unique_ptr<RemoteStore> remote_store_;
+  std::unique_ptr<core::SyncEngine> sync_engine_;
+
+  /** Maps the recorded target IDs to the ones used in the replay. */
+  std::unordered_map<model::TargetId, model::TargetId> target_ids_;
+
+  /** The queries listened to for the recorded target IDs. */
+  std::unordered_map<model::TargetId, core::Query> queries_;
+
+  /** The recorded target ID removed by the last request, if any. */
+  absl::optional<model::TargetId> pending_removal_;
+
+  size_t snapshots_ = 0;
+};
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_TEST_UNIT_REMOTE_WATCH_STREAM_REPLAYER_H_
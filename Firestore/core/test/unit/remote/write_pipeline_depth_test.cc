@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/remote/write_pipeline_depth.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace remote {
+
+namespace {
+
+using std::chrono::milliseconds;
+
+}  // namespace
+
+TEST(WritePipelineDepthTest, FixedDepthNeverChanges) {
+  WritePipelineDepth depth(10, /* adaptive= */ false);
+  depth.RecordAck(milliseconds(10), /* pipeline_was_full= */ true);
+  depth.RecordAck(milliseconds(1000), /* pipeline_was_full= */ true);
+  depth.RecordError();
+  EXPECT_EQ(depth.depth(), 10);
+}
+
+TEST(WritePipelineDepthTest, DepthIsAtLeastOne) {
+  EXPECT_EQ(WritePipelineDepth(0).depth(), 1);
+
+  WritePipelineDepth depth(1, /* adaptive= */ true);
+  depth.RecordError();
+  EXPECT_EQ(depth.depth(), 1);
+}
+
+TEST(WritePipelineDepthTest, GrowsOnlyWhileFullAndFast) {
+  WritePipelineDepth depth(10, /* adaptive= */ true);
+  depth.RecordAck(milliseconds(100), /* pipeline_was_full= */ false);
+  EXPECT_EQ(depth.depth(), 10);
+
+  depth.RecordAck(milliseconds(100), /* pipeline_was_full= */ true);
+  depth.RecordAck(milliseconds(150), /* pipeline_was_full= */ true);
+  EXPECT_EQ(depth.depth(), 12);
+}
+
+TEST(WritePipelineDepthTest, ShrinksOnSlowAcksAndErrors) {
+  WritePipelineDepth depth(10, /* adaptive= */ true);
+  depth.RecordAck(milliseconds(100), /* pipeline_was_full= */ true);
+  EXPECT_EQ(depth.depth(), 11);
+
+  depth.RecordAck(milliseconds(1000), /* pipeline_was_full= */ true);
+  EXPECT_EQ(depth.depth(), 10);
+
+  depth.RecordError();
+  EXPECT_EQ(depth.depth(), 5);
+}
+
+TEST(WritePipelineDepthTest, GrowthIsBounded) {
+  WritePipelineDepth depth(WritePipelineDepth::kMaxAdaptiveDepth - 1,
+                           /* adaptive= */ true);
+  for (int i = 0; i != 3; ++i) {
+    depth.RecordAck(milliseconds(100), /* pipeline_was_full= */ true);
+  }
+  EXPECT_EQ(depth.depth(), WritePipelineDepth::kMaxAdaptiveDepth);
+}
+
+}  // namespace remote
+}  // namespace firestore
+}  // namespace firebase
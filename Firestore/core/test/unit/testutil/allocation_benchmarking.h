@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIRESTORE_CORE_TEST_UNIT_TESTUTIL_ALLOCATION_BENCHMARKING_H_
+#define FIRESTORE_CORE_TEST_UNIT_TESTUTIL_ALLOCATION_BENCHMARKING_H_
+
+#include <map>
+#include <string>
+
+#include "Firestore/core/src/util/allocation_tracker.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace testutil {
+
+/**
+ * Counts the allocations made during a benchmark's loop, and reports them per
+ * iteration in the "allocs_per_op" and "alloc_bytes_per_op" counters when it
+ * goes out of scope. Reports nothing unless the benchmark binary links in
+ * `allocation_hooks.cc`.
+ *
+ * Also reports the allocations counted in each `FIRESTORE_ALLOCATION_TAG`
+ * during the loop, per entry into the tag, as "allocs_per_<tag>".
+ */
+class AllocationReporter {
+ public:
+  explicit AllocationReporter(benchmark::State& state) : state_(state) {
+    util::ResetTaggedAllocations();
+  }
+
+  ~AllocationReporter() {
+    if (!util::AllocationHooksInstalled()) return;
+
+    const util::AllocationCounts& counts = counter_.counts();
+    state_.counters["allocs_per_op"] =
+        benchmark::Counter(static_cast<double>(counts.allocations),
+                           benchmark::Counter::kAvgIterations);
+    state_.counters["alloc_bytes_per_op"] =
+        benchmark::Counter(static_cast<double>(counts.bytes_allocated),
+                           benchmark::Counter::kAvgIterations);
+
+    std::map<std::string, int64_t> entries = util::GetTagEntryCounts();
+    for (const auto& tag : util::GetTaggedAllocations()) {
+      int64_t times = entries[tag.first];
+      if (times == 0) continue;
+      state_.counters["allocs_per_" + tag.first] =
+          static_cast<double>(tag.second.allocations) / times;
+    }
+  }
+
+  AllocationReporter(const AllocationReporter&) = delete;
+  AllocationReporter& operator=(const AllocationReporter&) = delete;
+
+ private:
+  benchmark::State& state_;
+  util::ScopedAllocationCounter counter_;
+};
+
+}  // namespace testutil
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIRESTORE_CORE_TEST_UNIT_TESTUTIL_ALLOCATION_BENCHMARKING_H_
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replaces the global `operator new` and `operator delete` so that
+// `util::ScopedAllocationCounter` and `FIRESTORE_ALLOCATION_TAG` count the
+// allocations made in their scope. This file isn't part of any library: add it
+// to the sources of a benchmark or diagnostic binary to opt in.
+//
+// Each block is prefixed with a header recording its size, so that
+// deallocations can be counted in bytes too.
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "Firestore/core/src/util/allocation_tracker.h"
+
+namespace {
+
+using firebase::firestore::util::RecordAllocation;
+using firebase::firestore::util::RecordDeallocation;
+
+struct InstallHooks {
+  InstallHooks() {
+    firebase::firestore::util::MarkAllocationHooksInstalled();
+  }
+} install_hooks;
+
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+void* Allocate(size_t size) noexcept {
+  void* block = std::malloc(size + kHeaderSize);
+  if (!block) return nullptr;
+  RecordAllocation(size);
+  *static_cast<size_t*>(block) = size;
+  return static_cast<char*>(block) + kHeaderSize;
+}
+
+void* AllocateOrThrow(size_t size) {
+  void* result = Allocate(size);
+  if (!result) throw std::bad_alloc();
+  return result;
+}
+
+void Deallocate(void* pointer) noexcept {
+  if (!pointer) return;
+  void* block = static_cast<char*>(pointer) - kHeaderSize;
+  RecordDeallocation(*static_cast<size_t*>(block));
+  std::free(block);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  return AllocateOrThrow(size);
+}
+
+void* operator new[](size_t size) {
+  return AllocateOrThrow(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  Deallocate(pointer);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* pointer, size_t) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  Deallocate(pointer);
+}
+#endif  // defined(__cpp_sized_deallocation)
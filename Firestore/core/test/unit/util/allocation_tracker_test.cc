@@ -0,0 +1,86 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/allocation_tracker.h"
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+// The unit tests don't link in the allocation hooks, so these tests report
+// allocations by hand.
+
+TEST(AllocationTrackerTest, HooksAreNotInstalledInTests) {
+  EXPECT_FALSE(AllocationHooksInstalled());
+}
+
+TEST(AllocationTrackerTest, CountsOnlyWithinScope) {
+  RecordAllocation(8);
+
+  ScopedAllocationCounter counter;
+  RecordAllocation(16);
+  RecordAllocation(32);
+  RecordDeallocation(16);
+
+  EXPECT_EQ(counter.counts().allocations, 2);
+  EXPECT_EQ(counter.counts().bytes_allocated, 48);
+  EXPECT_EQ(counter.counts().deallocations, 1);
+  EXPECT_EQ(counter.counts().bytes_deallocated, 16);
+}
+
+TEST(AllocationTrackerTest, NestedCountersAddToEnclosingCounter) {
+  ScopedAllocationCounter outer;
+  RecordAllocation(1);
+  {
+    ScopedAllocationCounter inner;
+    RecordAllocation(2);
+    EXPECT_EQ(inner.counts().allocations, 1);
+    EXPECT_EQ(outer.counts().allocations, 1);
+  }
+  EXPECT_EQ(outer.counts().allocations, 2);
+  EXPECT_EQ(outer.counts().bytes_allocated, 3);
+}
+
+TEST(AllocationTrackerTest, AggregatesByTag) {
+  ResetTaggedAllocations();
+  for (int i = 0; i < 2; ++i) {
+    ScopedAllocationTag tag("query");
+    RecordAllocation(10);
+    RecordAllocation(10);
+  }
+  {
+    ScopedAllocationTag tag("write");
+    RecordAllocation(5);
+  }
+
+  auto allocations = GetTaggedAllocations();
+  EXPECT_EQ(allocations["query"].allocations, 4);
+  EXPECT_EQ(allocations["query"].bytes_allocated, 40);
+  EXPECT_EQ(allocations["write"].allocations, 1);
+
+  auto entries = GetTagEntryCounts();
+  EXPECT_EQ(entries["query"], 2);
+  EXPECT_EQ(entries["write"], 1);
+
+  ResetTaggedAllocations();
+  EXPECT_TRUE(GetTaggedAllocations().empty());
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
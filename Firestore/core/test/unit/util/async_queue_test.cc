@@ -224,6 +224,64 @@ TEST_P(AsyncQueueTest, CanScheduleOprationsWithRespectsToShutdownState) {
   EXPECT_EQ(steps, "124");
 }
 
+TEST_P(AsyncQueueTest, HigherPriorityOperationsRunFirst) {
+  using Priority = AsyncQueue::Priority;
+  Expectation unblock;
+  Expectation ran;
+  std::string steps;
+
+  // Hold up the queue while the other operations are enqueued.
+  queue->Enqueue([&] { Await(unblock); });
+  queue->Enqueue([&] { steps += '5'; }, Priority::kBackground);
+  queue->Enqueue([&] { steps += '3'; }, Priority::kNetwork);
+  queue->Enqueue([&] { steps += '1'; });
+  queue->Enqueue([&] { steps += '6'; }, Priority::kBackground);
+  queue->Enqueue([&] { steps += '4'; }, Priority::kNetwork);
+  queue->Enqueue([&] { steps += '2'; });
+  queue->Enqueue(ran.AsCallback(), Priority::kBackground);
+  unblock.Fulfill();
+
+  Await(ran);
+  EXPECT_EQ(steps, "123456");
+}
+
+TEST_P(AsyncQueueTest, LowerPriorityOperationsAreNotStarved) {
+  Expectation unblock;
+  Expectation ran;
+  int user_facing_before_background = -1;
+  int user_facing = 0;
+
+  queue->Enqueue([&] { Await(unblock); });
+  queue->Enqueue(
+      [&] { user_facing_before_background = user_facing; },
+      AsyncQueue::Priority::kBackground);
+  for (int i = 0; i < 100; ++i) {
+    queue->Enqueue([&] { ++user_facing; });
+  }
+  queue->Enqueue(ran.AsCallback());
+  unblock.Fulfill();
+
+  Await(ran);
+  EXPECT_GE(user_facing_before_background, 0);
+  EXPECT_LT(user_facing_before_background, 100);
+}
+
+TEST_P(AsyncQueueTest, RestrictedModeRunsOperationsInFifoOrder) {
+  Expectation unblock;
+  Expectation ran;
+  std::string steps;
+
+  queue->Enqueue([&] { Await(unblock); });
+  queue->Enqueue([&] { steps += '1'; }, AsyncQueue::Priority::kBackground);
+  queue->EnterRestrictedMode();
+  queue->EnqueueEvenWhileRestricted([&] { steps += '2'; });
+  queue->EnqueueEvenWhileRestricted(ran.AsCallback());
+  unblock.Fulfill();
+
+  Await(ran);
+  EXPECT_EQ(steps, "12");
+}
+
 TEST_P(AsyncQueueTest, RestrictedModePreventsEnqueue) {
   ASSERT_TRUE(queue->Enqueue([&] {}));
   ASSERT_TRUE(queue->EnqueueEvenWhileRestricted([&] {}));
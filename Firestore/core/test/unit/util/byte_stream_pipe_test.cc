@@ -0,0 +1,121 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/byte_stream_pipe.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "Firestore/core/test/unit/testutil/status_testing.h"
+#include "Firestore/core/test/unit/util/byte_stream_test.h"
+#include "absl/memory/memory.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+namespace {
+
+class ByteStreamPipeFactory : public ByteStreamFactory {
+  std::unique_ptr<ByteStream> CreateByteStream(
+      const std::string& data) override {
+    auto stream = absl::make_unique<ByteStreamPipe>();
+    stream->writer()->Write(data);
+    stream->writer()->Finish();
+    return stream;
+  }
+};
+
+std::unique_ptr<ByteStreamFactory> ExecutorFactory() {
+  return absl::make_unique<ByteStreamPipeFactory>();
+}
+
+INSTANTIATE_TEST_SUITE_P(ByteStreamPipeTest,
+                         ByteStreamTest,
+                         ::testing::Values(ExecutorFactory));
+
+TEST(ByteStreamPipeTest, ReadsWhileWriting) {
+  ByteStreamPipe stream(/*capacity=*/4);
+  std::shared_ptr<ByteStreamPipe::Writer> writer = stream.writer();
+
+  std::thread producer([writer] {
+    for (char c = 'a'; c <= 'z'; ++c) {
+      writer->Write(std::string(3, c));
+    }
+    writer->Finish();
+  });
+
+  std::string actual;
+  std::string expected;
+  for (char c = 'a'; c <= 'z'; ++c) {
+    expected.append(3, c);
+  }
+  while (true) {
+    StatusOr<size_t> read = stream.ReadAppend(5, &actual);
+    ASSERT_OK(read.status());
+    if (read.ValueOrDie() == 0) break;
+  }
+  producer.join();
+
+  EXPECT_EQ(actual, expected);
+}
+
+TEST(ByteStreamPipeTest, PausesWriterWhileFull) {
+  ByteStreamPipe stream(/*capacity=*/4);
+  std::vector<bool> pauses;
+  stream.writer()->SetPauseCallback(
+      [&pauses](bool paused) { pauses.push_back(paused); });
+
+  EXPECT_TRUE(stream.writer()->Write("012"));
+  EXPECT_EQ(pauses, std::vector<bool>{});
+  EXPECT_TRUE(stream.writer()->Write("345"));
+  EXPECT_EQ(pauses, std::vector<bool>{true});
+
+  // The writer resumes once no more than half the capacity is buffered.
+  EXPECT_EQ(stream.Read(3).ValueOrDie(), "012");
+  EXPECT_EQ(pauses, std::vector<bool>{true});
+  EXPECT_EQ(stream.ReadUntil('5', 10).ValueOrDie(), "34");
+  EXPECT_EQ(pauses, (std::vector<bool>{true, false}));
+}
+
+TEST(ByteStreamPipeTest, ReportsWriterErrors) {
+  ByteStreamPipe stream;
+  stream.writer()->Write("012");
+  stream.writer()->Finish(Status(Error::kErrorUnavailable, "offline"));
+
+  StreamReadResult result = stream.Read(10);
+  EXPECT_FALSE(result.ok());
+  EXPECT_EQ(result.status().code(), Error::kErrorUnavailable);
+}
+
+TEST(ByteStreamPipeTest, CancelsWriterWhenDestroyed) {
+  auto stream = absl::make_unique<ByteStreamPipe>(/*capacity=*/2);
+  std::shared_ptr<ByteStreamPipe::Writer> writer = stream->writer();
+  std::vector<bool> pauses;
+  writer->SetPauseCallback(
+      [&pauses](bool paused) { pauses.push_back(paused); });
+  EXPECT_TRUE(writer->Write("012"));
+
+  stream.reset();
+  EXPECT_EQ(pauses, (std::vector<bool>{true, false}));
+  EXPECT_FALSE(writer->Write("345"));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
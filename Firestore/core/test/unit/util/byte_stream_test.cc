@@ -16,6 +16,8 @@
 
 #include "Firestore/core/test/unit/util/byte_stream_test.h"
 
+#include "Firestore/core/test/unit/testutil/status_testing.h"
+
 namespace firebase {
 namespace firestore {
 namespace util {
@@ -265,6 +267,56 @@ TEST_P(ByteStreamTest, ReadsFromInternalBuffer_AppleImpl) {
   EXPECT_TRUE(result.eof());
 }
 
+TEST_P(ByteStreamTest, ReadAppendAppendsInPlace) {
+  auto stream = stream_factory_->CreateByteStream("0123456789");
+  std::string out = "prefix";
+
+  StatusOr<size_t> read = stream->ReadAppend(4, &out);
+  ASSERT_OK(read.status());
+  EXPECT_EQ(read.ValueOrDie(), 4u);
+  EXPECT_EQ(out, "prefix0123");
+
+  read = stream->ReadAppend(100, &out);
+  ASSERT_OK(read.status());
+  EXPECT_EQ(read.ValueOrDie(), 6u);
+  EXPECT_EQ(out, "prefix0123456789");
+
+  read = stream->ReadAppend(100, &out);
+  ASSERT_OK(read.status());
+  EXPECT_EQ(read.ValueOrDie(), 0u);
+}
+
+TEST_P(ByteStreamTest, ReadAppendAfterReadUntil) {
+  auto stream = stream_factory_->CreateByteStream("12{3456789");
+  auto result = stream->ReadUntil('{', 16);
+  EXPECT_EQ(result.ValueOrDie(), "12");
+
+  std::string out;
+  StatusOr<size_t> read = stream->ReadAppend(3, &out);
+  ASSERT_OK(read.status());
+  EXPECT_EQ(out, "{34");
+
+  read = stream->ReadAppend(100, &out);
+  ASSERT_OK(read.status());
+  EXPECT_EQ(out, "{3456789");
+}
+
+TEST_P(ByteStreamTest, ReadAppendReadsLargeStream) {
+  auto source = LargeString();
+  auto stream = stream_factory_->CreateByteStream(source);
+  std::string actual;
+  uint64_t i = 0;
+  for (; i < kMaxIterations; ++i) {
+    StatusOr<size_t> read = stream->ReadAppend(4096, &actual);
+    ASSERT_OK(read.status());
+    if (read.ValueOrDie() == 0) {
+      break;
+    }
+  }
+  EXPECT_LE(i, kMaxIterations);
+  EXPECT_EQ(actual, source);
+}
+
 }  // namespace
 }  // namespace util
 }  // namespace firestore
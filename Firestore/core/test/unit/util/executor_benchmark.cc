@@ -0,0 +1,169 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <mutex>               // NOLINT(build/c++11)
+
+#include "Firestore/core/src/util/async_queue.h"
+#include "Firestore/core/src/util/executor_std.h"
+#include "Firestore/core/src/util/executor_work_stealing.h"
+#include "Firestore/core/test/unit/testutil/allocation_benchmarking.h"
+#include "absl/memory/memory.h"
+#include "benchmark/benchmark.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+namespace {
+
+const int kOperationsPerIteration = 1000;
+
+/** Lets the benchmark thread wait until a number of operations have run. */
+class Countdown {
+ public:
+  void Reset(int count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    remaining_ = count;
+  }
+
+  void CountDown() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--remaining_ == 0) done_.notify_one();
+  }
+
+  void Await() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return remaining_ == 0; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable done_;
+  int remaining_ = 0;
+};
+
+/**
+ * Submits small operations from the benchmark thread, the way most callers of
+ * a concurrent executor do.
+ */
+template <typename ExecutorT>
+void BM_ExternalSubmission(benchmark::State& state) {
+  ExecutorT executor(static_cast<int>(state.range(0)));
+  Countdown countdown;
+  std::atomic<int> sink{0};
+
+  for (auto _ : state) {
+    countdown.Reset(kOperationsPerIteration);
+    for (int i = 0; i < kOperationsPerIteration; ++i) {
+      executor.Execute([&] {
+        sink.fetch_add(1, std::memory_order_relaxed);
+        countdown.CountDown();
+      });
+    }
+    countdown.Await();
+  }
+  state.SetItemsProcessed(state.iterations() * kOperationsPerIteration);
+}
+
+/**
+ * Submits a few operations that each submit many more from the worker that
+ * runs them, which keeps them on that worker's run queue unless stolen.
+ */
+template <typename ExecutorT>
+void BM_FanOut(benchmark::State& state) {
+  const int parents = 10;
+  const int children = kOperationsPerIteration / parents;
+
+  ExecutorT executor(static_cast<int>(state.range(0)));
+  Countdown countdown;
+  std::atomic<int> sink{0};
+
+  for (auto _ : state) {
+    countdown.Reset(parents * children);
+    for (int i = 0; i < parents; ++i) {
+      executor.Execute([&] {
+        for (int j = 0; j < children; ++j) {
+          executor.Execute([&] {
+            sink.fetch_add(1, std::memory_order_relaxed);
+            countdown.CountDown();
+          });
+        }
+      });
+    }
+    countdown.Await();
+  }
+  state.SetItemsProcessed(state.iterations() * parents * children);
+}
+
+/**
+ * Submits trivial operations, which only capture a pointer, to measure the
+ * per-operation overhead (including allocations) of the executor itself.
+ */
+template <typename ExecutorT>
+void BM_ExecuteTrivial(benchmark::State& state) {
+  ExecutorT executor(1);
+  Countdown countdown;
+
+  testutil::AllocationReporter allocations(state);
+  for (auto _ : state) {
+    countdown.Reset(1);
+    executor.Execute([&countdown] { countdown.CountDown(); });
+    countdown.Await();
+  }
+}
+
+/** Like `BM_ExecuteTrivial`, but going through an `AsyncQueue`. */
+void BM_EnqueueTrivial(benchmark::State& state) {
+  auto queue = AsyncQueue::Create(absl::make_unique<ExecutorStd>(1));
+  Countdown countdown;
+
+  testutil::AllocationReporter allocations(state);
+  for (auto _ : state) {
+    countdown.Reset(1);
+    queue->Enqueue([&countdown] { countdown.CountDown(); });
+    countdown.Await();
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_ExecuteTrivial, ExecutorStd)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ExecuteTrivial, ExecutorWorkStealing)->UseRealTime();
+BENCHMARK(BM_EnqueueTrivial)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ExternalSubmission, ExecutorStd)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ExternalSubmission, ExecutorWorkStealing)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_FanOut, ExecutorStd)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_FanOut, ExecutorWorkStealing)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
@@ -64,6 +64,22 @@ TEST_F(ExecutorLibdispatchOnlyTests, NameReturnsLabelOfTheQueue) {
   Await(ran);
 }
 
+TEST_F(ExecutorLibdispatchOnlyTests, PriorityMapsToQualityOfService) {
+  auto qos_class_of = [](const std::unique_ptr<Executor>& executor) {
+    auto libdispatch = static_cast<ExecutorLibdispatch*>(executor.get());
+    return dispatch_queue_get_qos_class(libdispatch->dispatch_queue(), nullptr);
+  };
+
+  EXPECT_EQ(qos_class_of(Executor::CreateSerial("serial")),
+            QOS_CLASS_UNSPECIFIED);
+  EXPECT_EQ(qos_class_of(Executor::CreateSerial(
+                "serial", Executor::Priority::UserInitiated)),
+            QOS_CLASS_USER_INITIATED);
+  EXPECT_EQ(qos_class_of(Executor::CreateConcurrent(
+                "concurrent", 2, Executor::Priority::Utility)),
+            QOS_CLASS_UTILITY);
+}
+
 TEST_F(ExecutorLibdispatchOnlyTests,
        ExecuteBlockingOnTheCurrentQueueIsNotAllowed) {
   Expectation ran;
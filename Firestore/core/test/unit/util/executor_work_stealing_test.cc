@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/executor_work_stealing.h"
+
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <future>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+
+#include "Firestore/core/test/unit/util/executor_test.h"
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+namespace {
+
+std::unique_ptr<Executor> ExecutorFactory(int threads) {
+  return absl::make_unique<ExecutorWorkStealing>(threads);
+}
+
+}  // namespace
+
+INSTANTIATE_TEST_SUITE_P(ExecutorTestWorkStealing,
+                         ExecutorTest,
+                         ::testing::Values(ExecutorFactory));
+
+TEST(ExecutorWorkStealingTest, RunsOperationsSubmittedFromWorkers) {
+  ExecutorWorkStealing executor(4);
+
+  const int fan_out = 100;
+  std::atomic<int> remaining{fan_out * fan_out};
+  std::promise<void> done;
+
+  for (int i = 0; i < fan_out; ++i) {
+    executor.Execute([&] {
+      for (int j = 0; j < fan_out; ++j) {
+        executor.Execute([&] {
+          if (--remaining == 0) done.set_value();
+        });
+      }
+    });
+  }
+
+  auto status = done.get_future().wait_for(std::chrono::seconds(5));
+  EXPECT_EQ(status, std::future_status::ready);
+}
+
+TEST(ExecutorWorkStealingTest, IdleWorkersStealFromBusyWorkers) {
+  const int threads = 4;
+  ExecutorWorkStealing executor(threads);
+
+  // A single operation submits work from one worker; the other workers can
+  // only get to it by stealing. All of them have to run concurrently for the
+  // counter to reach the number of threads.
+  std::atomic<int> running{0};
+  std::promise<void> all_running;
+
+  executor.Execute([&] {
+    for (int i = 0; i < threads - 1; ++i) {
+      executor.Execute([&] {
+        if (++running == threads - 1) all_running.set_value();
+        while (running < threads) {
+          std::this_thread::yield();
+        }
+      });
+    }
+  });
+
+  auto status = all_running.get_future().wait_for(std::chrono::seconds(5));
+  EXPECT_EQ(status, std::future_status::ready);
+  ++running;
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
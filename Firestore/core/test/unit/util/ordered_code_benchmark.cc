@@ -14,6 +14,11 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
 #include "Firestore/core/src/util/ordered_code.h"
 #include "Firestore/core/src/util/secure_random.h"
 #include "benchmark/benchmark.h"
@@ -61,3 +66,130 @@ BENCHMARK(BM_SkipToNextSpecialByte)
     ->Arg(1 << 9)
     ->Arg(1 << 10)
     ->Arg(1 << 15);
+
+/**
+ * Makes strings of the given length in which about one byte in 128 needs to
+ * be escaped.
+ */
+static std::vector<std::string> MakeStrings(int64_t len) {
+  SecureRandom rnd;
+  const int kValues = 1024;
+  std::vector<std::string> values(kValues);
+  for (std::string& s : values) {
+    std::generate_n(std::back_inserter(s), len, [&]() -> char {
+      if (rnd.OneIn(128)) return rnd.OneIn(2) ? '\0' : '\xff';
+      return static_cast<char>(rnd.Uniform(254) + 1);
+    });
+  }
+  return values;
+}
+
+static void BM_WriteString(benchmark::State& state) {
+  std::vector<std::string> values = MakeStrings(state.range(0));
+
+  size_t index = 0;
+  int64_t total_bytes = 0;
+  std::string dest;
+  for (auto _ : state) {
+    const std::string& value = values[index++ % values.size()];
+    dest.clear();
+    OrderedCode::WriteString(&dest, value);
+    total_bytes += static_cast<int64_t>(value.size());
+  }
+  state.SetBytesProcessed(total_bytes);
+}
+BENCHMARK(BM_WriteString)->Arg(1 << 4)->Arg(1 << 6)->Arg(1 << 10)->Arg(1 << 15);
+
+static void BM_ReadString(benchmark::State& state) {
+  std::vector<std::string> values = MakeStrings(state.range(0));
+  std::vector<std::string> encoded;
+  for (const std::string& value : values) {
+    encoded.emplace_back();
+    OrderedCode::WriteString(&encoded.back(), value);
+  }
+
+  size_t index = 0;
+  int64_t total_bytes = 0;
+  std::string result;
+  for (auto _ : state) {
+    absl::string_view src = encoded[index++ % encoded.size()];
+    result.clear();
+    bool ok = OrderedCode::ReadString(&src, &result);
+    benchmark::DoNotOptimize(ok);
+    total_bytes += static_cast<int64_t>(result.size());
+  }
+  state.SetBytesProcessed(total_bytes);
+}
+BENCHMARK(BM_ReadString)->Arg(1 << 4)->Arg(1 << 6)->Arg(1 << 10)->Arg(1 << 15);
+
+/**
+ * Writes a key shaped like the LevelDB keys of documents: a table name, then
+ * a labeled string for each path segment, then a terminator.
+ */
+static void WriteDocumentKey(std::string* dest,
+                             const std::vector<std::string>& segments) {
+  OrderedCode::WriteSignedNumIncreasing(dest, 5);
+  OrderedCode::WriteString(dest, "remote_document");
+  for (const std::string& segment : segments) {
+    OrderedCode::WriteSignedNumIncreasing(dest, 62);
+    OrderedCode::WriteString(dest, segment);
+  }
+  OrderedCode::WriteSignedNumIncreasing(dest, 0);
+}
+
+/** Makes paths like "users/<id>/posts/<id>" with 20-character ids. */
+static std::vector<std::vector<std::string>> MakeDocumentPaths() {
+  SecureRandom rnd;
+  const int kValues = 1024;
+  std::vector<std::vector<std::string>> paths(kValues);
+  for (std::vector<std::string>& path : paths) {
+    for (const char* collection : {"users", "posts"}) {
+      path.push_back(collection);
+      std::string id;
+      std::generate_n(std::back_inserter(id), 20, [&] {
+        return static_cast<char>('a' + rnd.Uniform(26));
+      });
+      path.push_back(id);
+    }
+  }
+  return paths;
+}
+
+static void BM_WriteDocumentKey(benchmark::State& state) {
+  std::vector<std::vector<std::string>> paths = MakeDocumentPaths();
+
+  size_t index = 0;
+  std::string dest;
+  for (auto _ : state) {
+    dest.clear();
+    WriteDocumentKey(&dest, paths[index++ % paths.size()]);
+    benchmark::DoNotOptimize(dest.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WriteDocumentKey);
+
+static void BM_ReadDocumentKey(benchmark::State& state) {
+  std::vector<std::string> keys;
+  for (const std::vector<std::string>& path : MakeDocumentPaths()) {
+    keys.emplace_back();
+    WriteDocumentKey(&keys.back(), path);
+  }
+
+  size_t index = 0;
+  std::string segment;
+  for (auto _ : state) {
+    absl::string_view src = keys[index++ % keys.size()];
+    int64_t label = 0;
+    bool ok = OrderedCode::ReadSignedNumIncreasing(&src, &label);
+    ok = ok && OrderedCode::ReadString(&src, nullptr);
+    while (ok && OrderedCode::ReadSignedNumIncreasing(&src, &label) &&
+           label != 0) {
+      segment.clear();
+      ok = OrderedCode::ReadString(&src, &segment);
+    }
+    benchmark::DoNotOptimize(ok);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReadDocumentKey);
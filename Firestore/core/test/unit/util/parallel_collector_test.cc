@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/parallel_collector.h"
+
+#include <memory>
+#include <vector>
+
+#include "Firestore/core/src/util/background_queue.h"
+#include "Firestore/core/src/util/executor.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+
+TEST(ParallelCollectorTest, EmptyResult) {
+  ParallelCollector<int> collector;
+  EXPECT_TRUE(collector.Result().empty());
+
+  collector.NewShard();
+  collector.NewShard();
+  EXPECT_TRUE(collector.Result().empty());
+}
+
+TEST(ParallelCollectorTest, ConcatenatesShardsInCreationOrder) {
+  ParallelCollector<int> collector;
+  std::vector<int>* first = collector.NewShard();
+  std::vector<int>* second = collector.NewShard();
+  second->push_back(3);
+  first->push_back(1);
+  first->push_back(2);
+
+  EXPECT_EQ(collector.Result(), (std::vector<int>{1, 2, 3}));
+}
+
+TEST(ParallelCollectorTest, CollectsFromConcurrentTasks) {
+  std::unique_ptr<Executor> executor =
+      Executor::CreateConcurrent("ParallelCollectorTest", 4);
+  BackgroundQueue tasks(executor.get());
+  ParallelCollector<int> collector;
+
+  constexpr int kShards = 100;
+  constexpr int kPerShard = 10;
+  for (int i = 0; i < kShards; ++i) {
+    std::vector<int>* shard = collector.NewShard();
+    tasks.Execute([shard, i] {
+      for (int j = 0; j < kPerShard; ++j) {
+        shard->push_back(i * kPerShard + j);
+      }
+    });
+  }
+  tasks.AwaitAll();
+
+  std::vector<int> result = collector.Result();
+  ASSERT_EQ(result.size(), static_cast<size_t>(kShards * kPerShard));
+  for (size_t i = 0; i < result.size(); ++i) {
+    EXPECT_EQ(result[i], static_cast<int>(i));
+  }
+}
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
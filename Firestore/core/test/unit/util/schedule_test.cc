@@ -19,6 +19,7 @@
 #include <chrono>  // NOLINT(build/c++11)
 #include <cstdlib>
 #include <string>
+#include <vector>
 
 #include "Firestore/core/src/util/task.h"
 #include "Firestore/core/test/unit/testutil/async_testing.h"
@@ -150,6 +151,66 @@ TEST_F(ScheduleTest, Ordering) {
   EXPECT_EQ(values, expected);
 }
 
+TEST_F(ScheduleTest, RemoveId) {
+  schedule.Push(Task::Create(nullptr, start_time, 1, 10u, [] {}));
+  schedule.Push(
+      Task::Create(nullptr, start_time + chr::minutes(1), 2, 20u, [] {}));
+
+  EXPECT_EQ(schedule.RemoveId(30u), nullptr);
+  EXPECT_EQ(Value(schedule.RemoveId(20u)), 2);
+  EXPECT_EQ(schedule.RemoveId(20u), nullptr);
+  EXPECT_EQ(Value(schedule.RemoveId(10u)), 1);
+  EXPECT_TRUE(schedule.empty());
+}
+
+TEST_F(ScheduleTest, ContainsIdAndTag) {
+  schedule.Push(Task::Create(nullptr, start_time, 1, 10u, [] {}));
+  schedule.Push(
+      Task::Create(nullptr, start_time + chr::minutes(1), 1, 20u, [] {}));
+
+  EXPECT_TRUE(schedule.ContainsId(10u));
+  EXPECT_TRUE(schedule.ContainsId(20u));
+  EXPECT_FALSE(schedule.ContainsId(30u));
+  EXPECT_TRUE(schedule.ContainsTag(1));
+  EXPECT_FALSE(schedule.ContainsTag(2));
+
+  // The tag stays scheduled as long as any entry with it is.
+  EXPECT_EQ(Value(schedule.RemoveId(10u)), 1);
+  EXPECT_TRUE(schedule.ContainsTag(1));
+  EXPECT_EQ(Value(schedule.RemoveId(20u)), 1);
+  EXPECT_FALSE(schedule.ContainsTag(1));
+}
+
+TEST_F(ScheduleTest, OrderingAcrossTimerWheelLevels) {
+  // Delays spanning several levels of the timer wheel, pushed in a
+  // deliberately non-sorted order.
+  Push(4, start_time + chr::milliseconds(300));
+  Push(1, start_time + chr::milliseconds(2));
+  Push(3, start_time + chr::milliseconds(100));
+  Push(5, start_time + chr::milliseconds(300));
+  Push(2, start_time + chr::milliseconds(70));
+
+  std::vector<int> values;
+  while (!schedule.empty()) {
+    values.push_back(PopBlocking());
+  }
+  const std::vector<int> expected = {1, 2, 3, 4, 5};
+  EXPECT_EQ(values, expected);
+  EXPECT_GE(Now(), start_time + chr::milliseconds(300));
+}
+
+TEST_F(ScheduleTest, RemoveIfRemovesTheEarliestMatch) {
+  Push(1, start_time + chr::seconds(30));
+  Push(1, start_time + chr::milliseconds(20));
+  Push(2, start_time + chr::seconds(10));
+
+  Task* removed = schedule.RemoveIf([](const Task& t) { return t.tag() == 1; });
+  ASSERT_NE(removed, nullptr);
+  EXPECT_EQ(removed->target_time(), start_time + chr::milliseconds(20));
+  removed->Release();
+  EXPECT_EQ(schedule.size(), 2u);
+}
+
 TEST_F(ScheduleTest, AddingEntryUnblocksEmptyQueue) {
   const auto future = Async([&] {
     ASSERT_NONE_DUE();
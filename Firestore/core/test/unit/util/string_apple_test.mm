@@ -33,6 +33,8 @@ class StringAppleTest : public testing::Test {
         "",
         "a",
         "abc def",
+        // ASCII with an embedded null, which can't be read as a C string.
+        {"ab\0cd", 5},
         u8"æ",
         // Note: Each one of the three embedded universal character names
         // (\u-escaped) maps to three chars, so the total length of the string
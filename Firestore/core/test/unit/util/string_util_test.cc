@@ -37,6 +37,32 @@ TEST(StringUtil, ImmediateSuccessor) {
   EXPECT_EQ(ImmediateSuccessor(""), std::string("\0", 1));
 }
 
+TEST(StringUtil, IsValidUtf8) {
+  EXPECT_TRUE(IsValidUtf8(""));
+  EXPECT_TRUE(IsValidUtf8("plain ASCII text longer than a word"));
+  EXPECT_TRUE(IsValidUtf8(std::string("\0", 1)));
+  EXPECT_TRUE(IsValidUtf8("\xC3\xA9t\xC3\xA9"));             // été
+  EXPECT_TRUE(IsValidUtf8("abcdefgh\xE2\x82\xAC"));          // abcdefgh€
+  EXPECT_TRUE(IsValidUtf8("\xF0\x9F\x98\x80 after a word"));  // 😀
+  EXPECT_TRUE(IsValidUtf8("\xED\x9F\xBF"));                  // U+D7FF
+  EXPECT_TRUE(IsValidUtf8("\xF4\x8F\xBF\xBF"));              // U+10FFFF
+
+  // Stray continuation bytes and invalid lead bytes.
+  EXPECT_FALSE(IsValidUtf8("abc\x80"));
+  EXPECT_FALSE(IsValidUtf8("\xFF"));
+  // Truncated characters, including at the end of a word-sized chunk.
+  EXPECT_FALSE(IsValidUtf8("\xE2\x82"));
+  EXPECT_FALSE(IsValidUtf8("abcdefg\xC3"));
+  EXPECT_FALSE(IsValidUtf8("\xE2\x82z"));
+  // Overlong encodings.
+  EXPECT_FALSE(IsValidUtf8("\xC0\xAF"));
+  EXPECT_FALSE(IsValidUtf8("\xE0\x80\xAF"));
+  EXPECT_FALSE(IsValidUtf8("\xF0\x80\x80\xAF"));
+  // Surrogates and characters above U+10FFFF.
+  EXPECT_FALSE(IsValidUtf8("\xED\xA0\x80"));
+  EXPECT_FALSE(IsValidUtf8("\xF4\x90\x80\x80"));
+}
+
 }  // namespace util
 }  // namespace firestore
 }  // namespace firebase
@@ -316,6 +316,16 @@ TEST_F(TaskTest, AvoidsDeadlockDuringOperationDestruction) {
   ASSERT_EQ(steps, "1234");
 }
 
+TEST_F(TaskTest, RecyclesMemoryOfDeletedTasks) {
+  Task* task = Task::Create(nullptr, [] {});
+  const void* address = task;
+  task->ExecuteAndRelease();
+
+  task = Task::Create(nullptr, [] {});
+  EXPECT_EQ(task, address);
+  task->Release();
+}
+
 }  // namespace util
 }  // namespace firestore
 }  // namespace firebase
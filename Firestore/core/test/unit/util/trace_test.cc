@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Firestore/core/src/util/trace.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace firestore {
+namespace util {
+namespace {
+
+class RecordingTraceSink : public TraceSink {
+ public:
+  void BeginSpan(const char* name, uint64_t span_id) override {
+    events.push_back(std::string("begin ") + name);
+    span_ids.push_back(span_id);
+  }
+
+  void EndSpan(const char* name,
+               uint64_t span_id,
+               std::chrono::steady_clock::duration duration) override {
+    events.push_back(std::string("end ") + name);
+    span_ids.push_back(span_id);
+    EXPECT_GE(duration.count(), 0);
+  }
+
+  std::vector<std::string> events;
+  std::vector<uint64_t> span_ids;
+};
+
+class TraceTest : public testing::Test {
+ public:
+  ~TraceTest() override {
+    SetTraceSink(nullptr);
+  }
+
+  RecordingTraceSink sink;
+};
+
+}  // namespace
+
+TEST_F(TraceTest, DoesNothingWithoutASink) {
+  SetTraceSink(nullptr);
+  { FIRESTORE_TRACE_SPAN("Outer"); }
+  EXPECT_TRUE(sink.events.empty());
+}
+
+#if FIRESTORE_TRACING_ENABLED
+
+TEST_F(TraceTest, ReportsNestedSpans) {
+  SetTraceSink(&sink);
+  {
+    FIRESTORE_TRACE_SPAN("Outer");
+    { FIRESTORE_TRACE_SPAN("Inner"); }
+  }
+
+  EXPECT_EQ(sink.events, (std::vector<std::string>{
+                             "begin Outer", "begin Inner", "end Inner",
+                             "end Outer"}));
+  ASSERT_EQ(sink.span_ids.size(), 4u);
+  EXPECT_NE(sink.span_ids[0], sink.span_ids[1]);
+  EXPECT_EQ(sink.span_ids[1], sink.span_ids[2]);
+  EXPECT_EQ(sink.span_ids[0], sink.span_ids[3]);
+}
+
+TEST_F(TraceTest, EndsSpansOnTheSinkTheyBeganOn) {
+  RecordingTraceSink other;
+  SetTraceSink(&sink);
+  {
+    FIRESTORE_TRACE_SPAN("Span");
+    SetTraceSink(&other);
+  }
+
+  EXPECT_EQ(sink.events,
+            (std::vector<std::string>{"begin Span", "end Span"}));
+  EXPECT_TRUE(other.events.empty());
+}
+
+#endif  // FIRESTORE_TRACING_ENABLED
+
+}  // namespace util
+}  // namespace firestore
+}  // namespace firebase
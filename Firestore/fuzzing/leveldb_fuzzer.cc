@@ -17,6 +17,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "Firestore/core/src/local/leveldb_key.h"
 #include "Firestore/core/src/local/leveldb_util.h"
@@ -27,6 +28,7 @@ using firebase::firestore::local::LevelDbMutationKey;
 using firebase::firestore::local::LevelDbMutationQueueKey;
 using firebase::firestore::local::LevelDbQueryTargetKey;
 using firebase::firestore::local::LevelDbRemoteDocumentKey;
+using firebase::firestore::local::LevelDbTargetDocumentBlockKey;
 using firebase::firestore::local::LevelDbTargetDocumentKey;
 using firebase::firestore::local::LevelDbTargetGlobalKey;
 using firebase::firestore::local::LevelDbTargetKey;
@@ -132,6 +134,16 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
     // Ignore caught errors and assertions.
   }
 
+  // Test LevelDbTargetDocumentBlockKey methods.
+  try {
+    LevelDbTargetDocumentBlockKey key;
+    (void)key.Decode(str);
+    std::vector<firebase::firestore::model::DocumentKey> document_keys;
+    (void)LevelDbTargetDocumentBlockKey::DecodeValue(str, &document_keys);
+  } catch (...) {
+    // Ignore caught errors and assertions.
+  }
+
   // Test LevelDbDocumentTargetKey methods.
   try {
     ResourcePath rp = ResourcePath::FromString(str);
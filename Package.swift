@@ -585,6 +585,7 @@ let package = Package(
         "core/src/util/filesystem_win.cc",
         "core/src/util/hard_assert_stdio.cc",
         "core/src/util/log_stdio.cc",
+        "core/src/util/mapped_file_win.cc",
         "core/src/util/secure_random_openssl.cc",
       ],
       sources: [